@@ -28,6 +28,7 @@
 #include <graphene/app/application.hpp>
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/get_config.hpp>
+#include <graphene/chain/supply_totals.hpp>
 #include <graphene/utilities/key_conversion.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
 #include <graphene/chain/transaction_object.hpp>
@@ -68,11 +69,19 @@ namespace graphene { namespace app {
        return true;
     }
 
+    std::shared_ptr<database_api> login_api::session_database_api()
+    {
+       if( !_session_database_api )
+          _session_database_api = std::make_shared< database_api >( std::ref( *_app.chain_database() ),
+                                                                    &( _app.get_options() ) );
+       return _session_database_api;
+    }
+
     void login_api::enable_api( const std::string& api_name )
     {
        if( api_name == "database_api" )
        {
-          _database_api = std::make_shared< database_api >(std::ref(*_app.chain_database()), &(_app.get_options()));
+          _database_api = session_database_api();
        }
        else if( api_name == "block_api" )
        {
@@ -84,7 +93,7 @@ namespace graphene { namespace app {
        }
        else if( api_name == "history_api" )
        {
-          _history_api = std::make_shared< history_api >( _app );
+          _history_api = std::make_shared< history_api >( _app, session_database_api() );
        }
        else if( api_name == "network_node_api" )
        {
@@ -96,7 +105,7 @@ namespace graphene { namespace app {
        }
        else if( api_name == "asset_api" )
        {
-          _asset_api = std::make_shared< asset_api >( std::ref( *_app.chain_database() ) );
+          _asset_api = std::make_shared< asset_api >( std::ref( *_app.chain_database() ), &(_app.get_options()) );
        }
        else if( api_name == "debug_api" )
        {
@@ -114,11 +123,52 @@ namespace graphene { namespace app {
     vector<optional<signed_block>> block_api::get_blocks(uint32_t block_num_from, uint32_t block_num_to)const
     {
        FC_ASSERT( block_num_to >= block_num_from );
-       vector<optional<signed_block>> res;
-       for(uint32_t block_num=block_num_from; block_num<=block_num_to; block_num++) {
-          res.push_back(_db.fetch_block_by_number(block_num));
+       FC_ASSERT( uint64_t(block_num_to) - block_num_from < 1000, "At most 1000 blocks can be asked for at once" );
+       return _db.fetch_blocks_by_number( block_num_from, block_num_to );
+    }
+
+    vector<optional<vector<char>>> block_api::get_raw_blocks(uint32_t block_num_from, uint32_t block_num_to)const
+    {
+       FC_ASSERT( block_num_to >= block_num_from );
+       FC_ASSERT( uint64_t(block_num_to) - block_num_from < 1000, "At most 1000 blocks can be asked for at once" );
+       return _db.fetch_raw_blocks_by_number( block_num_from, block_num_to );
+    }
+
+    vector<state_diff> block_api::get_state_diffs(const block_id_type& after, uint32_t limit)const
+    {
+       FC_ASSERT( limit <= 100 );
+       return _db.get_state_diffs( after, limit );
+    }
+
+    raw_block_range block_api::get_raw_block_range(uint32_t block_num_from, uint32_t limit)const
+    {
+       FC_ASSERT( limit <= 1000 );
+       raw_block_range result;
+       result.first_block_num = block_num_from;
+       const uint32_t last_irreversible = _db.get_dynamic_global_properties().last_irreversible_block_num;
+       if( limit == 0 || block_num_from > last_irreversible )
+          return result;
+       const uint32_t block_num_to = std::min<uint64_t>( last_irreversible, uint64_t(block_num_from) + limit - 1 );
+
+       vector<block_id_type> ids;
+       vector< vector<char> > data;
+       _db.get_block_database().fetch_raw_range( block_num_from, block_num_to, ids, data );
+       size_t total_size = 0;
+       for( const auto& d : data )
+          total_size += d.size();
+       result.blocks.reserve( total_size );
+       result.entries.resize( data.size() );
+       for( size_t i = 0; i < data.size(); ++i )
+       {
+          if( data[i].empty() )
+             continue;
+          index_entry& e = result.entries[i];
+          e.block_pos  = result.blocks.size();
+          e.block_size = data[i].size();
+          e.block_id   = ids[i];
+          result.blocks.insert( result.blocks.end(), data[i].begin(), data[i].end() );
        }
-       return res;
+       return result;
     }
 
     network_broadcast_api::network_broadcast_api(application& a):_app(a)
@@ -152,7 +202,7 @@ namespace graphene { namespace app {
 
     void network_broadcast_api::broadcast_transaction(const signed_transaction& trx)
     {
-       trx.validate();
+       _app.chain_database()->prevalidate_transaction(trx);
        _app.chain_database()->push_transaction(trx);
        if( _app.p2p_node() != nullptr )
           _app.p2p_node()->broadcast_transaction(trx);
@@ -167,7 +217,7 @@ namespace graphene { namespace app {
 
     void network_broadcast_api::broadcast_transaction_with_callback(confirmation_callback cb, const signed_transaction& trx)
     {
-       trx.validate();
+       _app.chain_database()->prevalidate_transaction(trx);
        _callbacks[trx.id()] = cb;
        _app.chain_database()->push_transaction(trx);
        if( _app.p2p_node() != nullptr )
@@ -210,6 +260,11 @@ namespace graphene { namespace app {
        return _app.p2p_node()->set_advanced_node_parameters(params);
     }
 
+    fc::variant_object network_node_api::get_metrics() const
+    {
+       return _app.p2p_node()->network_get_metrics();
+    }
+
     fc::api<network_broadcast_api> login_api::network_broadcast()const
     {
        FC_ASSERT(_network_broadcast_api);
@@ -258,31 +313,47 @@ namespace graphene { namespace app {
        return *_debug_api;
     }
 
+    namespace {
+       const account_history_sequence_index& get_account_history_index( const database& db )
+       {
+          return dynamic_cast<const primary_index<account_transaction_history_index>&>(
+                    db.get_index_type<account_transaction_history_index>() )
+                       .get_secondary_index<account_history_sequence_index>();
+       }
+    }
+
+    history_api::history_api( application& app, std::shared_ptr<graphene::app::database_api> db_api )
+    : _app( app ),
+      _database_api( db_api ? db_api : std::make_shared< graphene::app::database_api >( std::ref( *app.chain_database() ),
+                                                                                       &( app.get_options() ) ) )
+    {
+    }
+
     vector<operation_history_object> history_api::get_account_history( account_id_type account, 
                                                                        operation_history_id_type stop, 
                                                                        unsigned limit, 
                                                                        operation_history_id_type start ) const
     {
-       FC_ASSERT( _app.chain_database() );
-       const auto& db = *_app.chain_database();       
-       FC_ASSERT( limit <= 100 );
-       vector<operation_history_object> result;
-       const auto& stats = account(db).statistics(db);
-       if( stats.most_recent_op == account_transaction_history_id_type() ) return result;
-       const account_transaction_history_object* node = &stats.most_recent_op(db);
-       if( start == operation_history_id_type() )
-          start = node->operation_id;
-          
-       while(node && node->operation_id.instance.value > stop.instance.value && result.size() < limit)
-       {
-          if( node->operation_id.instance.value <= start.instance.value )
-             result.push_back( node->operation_id(db) );
-          if( node->next == account_transaction_history_id_type() )
-             node = nullptr;
-          else node = &node->next(db);
-       }
-       
-       return result;
+       return read_state( __func__, [&]() {
+          FC_ASSERT( _app.chain_database() );
+          const auto& db = *_app.chain_database();       
+          FC_ASSERT( limit <= 100 );
+          vector<operation_history_object> result;
+          if( auto store = _app.get_account_history_store() )
+          {
+             if( limit == 0 ) return result;
+             store->visit_account_history( account(db).uid, optional<uint16_t>(), 0,
+                                           [&]( uint32_t, operation_history_id_type id ) -> bool {
+                if( id.instance.value <= stop.instance.value )
+                   return false;
+                if( start == operation_history_id_type() || id.instance.value <= start.instance.value )
+                   result.push_back( *store->get_operation( id ) );
+                return result.size() < limit;
+             } );
+             return result;
+          }
+          return get_account_history_by_op_ids( account, flat_set<uint16_t>(), start, stop, limit );
+       } );
     }
     
     vector<operation_history_object> history_api::get_account_history_operations( account_id_type account, 
@@ -291,143 +362,172 @@ namespace graphene { namespace app {
                                                                        operation_history_id_type stop,
                                                                        unsigned limit) const
     {
-       FC_ASSERT( _app.chain_database() );
+       return read_state( __func__, [&]() {
+          FC_ASSERT( _app.chain_database() );
+          const auto& db = *_app.chain_database();
+          FC_ASSERT( limit <= 100 );
+          vector<operation_history_object> result;
+          if( limit == 0 || operation_id < 0 ) return result;
+          if( auto store = _app.get_account_history_store() )
+          {
+             store->visit_account_history( account(db).uid, optional<uint16_t>( operation_id ), 0,
+                                           [&]( uint32_t, operation_history_id_type id ) -> bool {
+                if( id.instance.value <= stop.instance.value )
+                   return false;
+                if( start == operation_history_id_type() || id.instance.value <= start.instance.value )
+                   result.push_back( *store->get_operation( id ) );
+                return result.size() < limit;
+             } );
+             return result;
+          }
+          return get_account_history_by_op_ids( account, flat_set<uint16_t>( { uint16_t( operation_id ) } ), start, stop, limit );
+       } );
+    }
+
+    vector<operation_history_object> history_api::get_account_history_by_op_ids( account_id_type account,
+                                                                                 const flat_set<uint16_t>& op_types,
+                                                                                 operation_history_id_type start,
+                                                                                 operation_history_id_type stop,
+                                                                                 unsigned limit ) const
+    {
        const auto& db = *_app.chain_database();
-       FC_ASSERT( limit <= 100 );
+       const auto& hist_idx = get_account_history_index( db );
+       const auto& acc = account(db);
        vector<operation_history_object> result;
-       const auto& stats = account(db).statistics(db);
-       if( stats.most_recent_op == account_transaction_history_id_type() ) return result;
-       const account_transaction_history_object* node = &stats.most_recent_op(db);
-       if( start == operation_history_id_type() )
-          start = node->operation_id;
-
-       while(node && node->operation_id.instance.value > stop.instance.value && result.size() < limit)
-       {
-          if( node->operation_id.instance.value <= start.instance.value ) {
-
-             if(node->operation_id(db).op.which() == operation_id)
-               result.push_back( node->operation_id(db) );
-             }
-          if( node->next == account_transaction_history_id_type() )
-             node = nullptr;
-          else node = &node->next(db);
-       }
+       // the operations with an id in (stop, start], the operation ids grow with the sequence
+       const uint32_t start_seq = ( start == operation_history_id_type() ? acc.statistics(db).total_ops
+                                                                          : hist_idx.last_sequence_until( acc.uid, start ) );
+       const uint32_t stop_seq = hist_idx.last_sequence_until( acc.uid, stop ) + 1;
+       for( const auto& e : hist_idx.get_history( acc.uid, op_types, stop_seq, start_seq, limit ) )
+          result.push_back( e.operation_id(db) );
        return result;
     }
 
-
     vector<std::pair<uint32_t,operation_history_object>> history_api::get_relative_account_history( account_uid_type account,
                                                                                                     optional<uint16_t> op_type,
                                                                                                     uint32_t stop,
                                                                                                     unsigned limit,
                                                                                                     uint32_t start) const
     {
-       FC_ASSERT( _app.chain_database() );
-       const auto& db = *_app.chain_database();
-       FC_ASSERT(limit <= 100);
-       vector<std::pair<uint32_t,operation_history_object>> result;
-       const auto& stats = db.get_account_statistics_by_uid( account );
-       if( start == 0 )
-          start = stats.total_ops;
-       else
-          start = min( stats.total_ops, start );
-
-
-       if( start >= stop && start > stats.removed_ops && limit > 0 )
-       {
-          const auto& hist_idx = db.get_index_type<account_transaction_history_index>();
+       flat_set<uint16_t> op_types;
+       if( op_type.valid() )
+          op_types.insert( *op_type );
+       return get_relative_account_history_by_types( account, op_types, stop, limit, start );
+    }
 
-          if( !op_type.valid() )
+    vector<std::pair<uint32_t,operation_history_object>> history_api::get_relative_account_history_by_types(
+                                                                                      account_uid_type account,
+                                                                                      const flat_set<uint16_t>& op_types,
+                                                                                      uint32_t stop,
+                                                                                      unsigned limit,
+                                                                                      uint32_t start) const
+    {
+       return read_state( __func__, [&]() {
+          FC_ASSERT( _app.chain_database() );
+          const auto& db = *_app.chain_database();
+          FC_ASSERT(limit <= 100);
+          if( auto store = _app.get_account_history_store() )
           {
-             const auto& by_seq_idx = hist_idx.indices().get<by_seq>();
-
-             auto itr = by_seq_idx.upper_bound( boost::make_tuple( account, start ) );
-             auto itr_stop = by_seq_idx.lower_bound( boost::make_tuple( account, stop ) );
-         
-             do
+             if( op_types.size() <= 1 )
+                return store->get_account_history( account,
+                                                   op_types.empty() ? optional<uint16_t>() : optional<uint16_t>( *op_types.begin() ),
+                                                   stop, start, limit );
+             // the latest ones of each type, merged
+             vector<std::pair<uint32_t,operation_history_object>> result;
+             for( uint16_t type : op_types )
              {
-                --itr;
-                result.push_back( std::make_pair( itr->sequence, itr->operation_id(db) ) );
+                auto of_type = store->get_account_history( account, type, stop, start, limit );
+                result.insert( result.end(), of_type.begin(), of_type.end() );
              }
-             while ( itr != itr_stop && result.size() < limit );
+             std::sort( result.begin(), result.end(), []( const std::pair<uint32_t,operation_history_object>& a,
+                                                          const std::pair<uint32_t,operation_history_object>& b ) {
+                return a.first > b.first;
+             } );
+             if( result.size() > limit )
+                result.resize( limit );
+             return result;
           }
+          vector<std::pair<uint32_t,operation_history_object>> result;
+          const auto& stats = db.get_account_statistics_by_uid( account );
+          if( start == 0 )
+             start = stats.total_ops;
           else
-          {
-             const auto& by_type_seq_idx = hist_idx.indices().get<by_type_seq>();
-
-             auto itr = by_type_seq_idx.upper_bound( boost::make_tuple( account, *op_type, start ) );
-             auto itr_stop = by_type_seq_idx.lower_bound( boost::make_tuple( account, *op_type, stop ) );
+             start = min( stats.total_ops, start );
 
-             if( itr != itr_stop )
-             {
-                do
-                {
-                   --itr;
-                   result.push_back( std::make_pair( itr->sequence, itr->operation_id(db) ) );
-                }
-                while ( itr != itr_stop && result.size() < limit );
-             }
+          if( start >= stop && start > stats.removed_ops && limit > 0 )
+          {
+             for( const auto& e : get_account_history_index( db ).get_history( account, op_types, stop, start, limit ) )
+                result.push_back( std::make_pair( e.sequence, e.operation_id(db) ) );
           }
-       }
-       return result;
+          return result;
+       } );
     }
 
     vector<bucket_object> history_api::get_market_history(std::string asset_a, std::string asset_b,
        uint32_t bucket_seconds, fc::time_point_sec start, fc::time_point_sec end)const
     {
        try {
-          FC_ASSERT(_app.chain_database());
-          const auto& db = *_app.chain_database();
-          asset_aid_type a = database_api.get_asset_id_from_string(asset_a);
-          asset_aid_type b = database_api.get_asset_id_from_string(asset_b);
-          vector<bucket_object> result;
-          result.reserve(200);
-
-          if (a > b) std::swap(a, b);
+          return read_state( __func__, [&]() {
+             FC_ASSERT(_app.chain_database());
+             const auto& db = *_app.chain_database();
+             asset_aid_type a = _database_api->get_asset_id_from_string(asset_a);
+             asset_aid_type b = _database_api->get_asset_id_from_string(asset_b);
+             vector<bucket_object> result;
+             result.reserve(200);
+
+             if (a > b) std::swap(a, b);
+
+             const auto& bidx = db.get_index_type<bucket_index>();
+             const auto& rings = dynamic_cast<const primary_index<bucket_index>&>( bidx )
+                                    .get_secondary_index<graphene::market_history::bucket_ring_index>();
+             if( rings.get_buckets( a, b, bucket_seconds, start, end, 200, result ) )
+                return result;
 
-          const auto& bidx = db.get_index_type<bucket_index>();
-          const auto& by_key_idx = bidx.indices().get<by_key>();
+             const auto& by_key_idx = bidx.indices().get<by_key>();
 
-          auto itr = by_key_idx.lower_bound(bucket_key(a, b, bucket_seconds, start));
-          while (itr != by_key_idx.end() && itr->key.open <= end && result.size() < 200)
-          {
-             if (!(itr->key.base == a && itr->key.quote == b && itr->key.seconds == bucket_seconds))
+             auto itr = by_key_idx.lower_bound(bucket_key(a, b, bucket_seconds, start));
+             while (itr != by_key_idx.end() && itr->key.open <= end && result.size() < 200)
              {
-                return result;
+                if (!(itr->key.base == a && itr->key.quote == b && itr->key.seconds == bucket_seconds))
+                {
+                   return result;
+                }
+                result.push_back(*itr);
+                ++itr;
              }
-             result.push_back(*itr);
-             ++itr;
-          }
-          return result;
+             return result;
+          } );
        } FC_CAPTURE_AND_RETHROW((asset_a)(asset_b)(bucket_seconds)(start)(end))
     }
 
     vector<order_history_object> history_api::get_fill_order_history(std::string asset_a, std::string asset_b, uint32_t limit)const
     {
        try {
-          FC_ASSERT(_app.chain_database());
-          const auto& db = *_app.chain_database();
-          asset_aid_type a = database_api.get_asset_id_from_string(asset_a);
-          asset_aid_type b = database_api.get_asset_id_from_string(asset_b);
-          if (a > b) std::swap(a, b);
-          const auto& history_idx = db.get_index_type<graphene::market_history::history_index>().indices().get<by_key>();
-          history_key hkey;
-          hkey.base = a;
-          hkey.quote = b;
-          hkey.sequence = std::numeric_limits<int64_t>::min();
-
-          uint32_t count = 0;
-          auto itr = history_idx.lower_bound(hkey);
-          vector<order_history_object> result;
-          while (itr != history_idx.end() && count < limit)
-          {
-             if (itr->key.base != a || itr->key.quote != b) break;
-             result.push_back(*itr);
-             ++itr;
-             ++count;
-          }
+          return read_state( __func__, [&]() {
+             FC_ASSERT(_app.chain_database());
+             const auto& db = *_app.chain_database();
+             asset_aid_type a = _database_api->get_asset_id_from_string(asset_a);
+             asset_aid_type b = _database_api->get_asset_id_from_string(asset_b);
+             if (a > b) std::swap(a, b);
+             const auto& history_idx = db.get_index_type<graphene::market_history::history_index>().indices().get<by_key>();
+             history_key hkey;
+             hkey.base = a;
+             hkey.quote = b;
+             hkey.sequence = std::numeric_limits<int64_t>::min();
+
+             uint32_t count = 0;
+             auto itr = history_idx.lower_bound(hkey);
+             vector<order_history_object> result;
+             while (itr != history_idx.end() && count < limit)
+             {
+                if (itr->key.base != a || itr->key.quote != b) break;
+                result.push_back(*itr);
+                ++itr;
+                ++count;
+             }
 
-          return result;
+             return result;
+          } );
        } FC_CAPTURE_AND_RETHROW((asset_a)(asset_b)(limit))
     }
 
@@ -502,19 +602,36 @@ namespace graphene { namespace app {
     }
 
     // asset_api
-    asset_api::asset_api(graphene::chain::database& db) : _db(db) { }
+    asset_api::asset_api(graphene::chain::database& db, const application_options* app_options)
+      : _db(db), _app_options(app_options) { }
     asset_api::~asset_api() { }
 
-    vector<account_asset_balance> asset_api::get_asset_holders( asset_aid_type asset_id ) const {
+    namespace detail {
+      const account_balance_totals_index& get_balance_totals( const graphene::chain::database& db )
+      {
+        const auto& idx = dynamic_cast<const primary_index<account_balance_index>&>( db.get_index_type<account_balance_index>() );
+        return idx.get_secondary_index<account_balance_totals_index>();
+      }
+    }
 
-      const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
-      auto range = bal_idx.equal_range( asset_id );
+    vector<account_asset_balance> asset_api::get_asset_holders( asset_aid_type asset_id, uint32_t start, uint32_t limit ) const {
+
+      const uint64_t api_limit_get_asset_holders = _app_options ? _app_options->api_limit_get_asset_holders : 100;
+      FC_ASSERT( limit <= api_limit_get_asset_holders );
 
       vector<account_asset_balance> result;
+      if( start >= detail::get_balance_totals( _db ).holder_count( asset_id ) )
+        return result;
 
-      for( const account_balance_object& bal : boost::make_iterator_range( range.first, range.second ) )
+      const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
+      auto range = bal_idx.equal_range( asset_id );
+      auto itr = range.first;
+      std::advance( itr, start ); // the holders come first, there are at least start of them
+
+      result.reserve( limit );
+      for( const account_balance_object& bal : boost::make_iterator_range( itr, range.second ) )
       {
-        if( bal.balance.value == 0 ) break; // ordered
+        if( bal.balance.value == 0 || result.size() >= limit ) break; // ordered
 
         account_asset_balance aab;
         aab.account_uid = bal.owner;
@@ -528,28 +645,19 @@ namespace graphene { namespace app {
     // get number of asset holders.
     uint64_t asset_api::get_asset_holders_count( asset_aid_type asset_id ) const {
 
-      const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
-      auto range = bal_idx.equal_range( asset_id );
-      // TODO FIXME filter out accounts with balance == 0
-      uint64_t count = boost::distance(range) - 1;
-
-      return count;
+      return detail::get_balance_totals( _db ).holder_count( asset_id );
     }
     // function to get vector of system assets with holders count.
     vector<asset_holders> asset_api::get_all_asset_holders() const {
             
       vector<asset_holders> result;
+      const auto& totals = detail::get_balance_totals( _db );
             
       for( const asset_object& asset_obj : _db.get_index_type<asset_index>().indices() )
       {
-        const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
-        auto range = bal_idx.equal_range( asset_obj.asset_id );
-        // TODO FIXME filter out accounts with balance == 0
-        uint64_t count = boost::distance(range) - 1;
-                
         asset_holders ah;
         ah.asset_id  = asset_obj.asset_id;
-        ah.count     = count;
+        ah.count     = totals.holder_count( asset_obj.asset_id );
 
         result.push_back(ah);
       }
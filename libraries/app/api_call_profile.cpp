@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/app/api_call_profile.hpp>
+
+#include <graphene/utilities/metrics.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace app {
+
+void api_call_profiler::record( const char* method, fc::microseconds queued, fc::microseconds run, bool failed )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   api_call_profile& p = _profiles[method];
+   if( p.method.empty() )
+      p.method = method;
+   ++p.count;
+   if( failed )
+      ++p.failed;
+   p.queued_us += std::max<int64_t>( queued.count(), 0 );
+   p.run_us += std::max<int64_t>( run.count(), 0 );
+   p.max_run_us = std::max<uint64_t>( p.max_run_us, std::max<int64_t>( run.count(), 0 ) );
+
+   if( _metrics == nullptr )
+      return;
+   auto itr = _method_metrics.find( p.method );
+   if( itr == _method_metrics.end() )
+   {
+      const graphene::utilities::metrics_registry::labels_type labels = { { "method", p.method } };
+      method_metrics m;
+      m.run_seconds = &_metrics->histogram( "yoyow_api_call_seconds", "Time the database API calls ran",
+                                            graphene::utilities::metrics_registry::exponential_bounds( 0.0001, 4, 9 ),
+                                            labels );
+      m.failures = &_metrics->counter( "yoyow_api_call_failures_total", "Database API calls which threw", labels );
+      itr = _method_metrics.emplace( p.method, m ).first;
+   }
+   itr->second.run_seconds->observe( std::max<int64_t>( run.count(), 0 ) / 1000000.0 );
+   if( failed )
+      itr->second.failures->add();
+   _queued_seconds->observe( std::max<int64_t>( queued.count(), 0 ) / 1000000.0 );
+}
+
+void api_call_profiler::set_metrics( graphene::utilities::metrics_registry* metrics )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _metrics = metrics;
+   _method_metrics.clear();
+   _queued_seconds = metrics == nullptr ? nullptr
+                   : &metrics->histogram( "yoyow_api_call_queued_seconds",
+                                          "Time the database API calls waited for the previous call of their session "
+                                          "and for an API thread",
+                                          graphene::utilities::metrics_registry::exponential_bounds( 0.0001, 4, 9 ) );
+}
+
+std::vector<api_call_profile> api_call_profiler::get_profiles()const
+{
+   std::vector<api_call_profile> result;
+   std::lock_guard<std::mutex> lock( _mutex );
+   result.reserve( _profiles.size() );
+   for( const auto& p : _profiles )
+      result.push_back( p.second );
+   return result;
+}
+
+void api_call_profiler::reset()
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _profiles.clear();
+}
+
+api_call_timer::~api_call_timer()
+{
+   if( _profiler == nullptr )
+      return;
+   const fc::time_point finished = _finished.valid() ? *_finished : fc::time_point::now();
+   _profiler->record( _method, _started - _created, finished - _started, !_finished.valid() );
+}
+
+api_call_budget::api_call_budget( uint64_t rate_us_per_second, uint64_t burst_us )
+: _rate_us_per_second( rate_us_per_second ),
+  _burst_us( std::max<uint64_t>( burst_us, rate_us_per_second ) ),
+  _available_us( _burst_us ),
+  _last_refill( fc::time_point::now() )
+{
+}
+
+void api_call_budget::refill( fc::time_point now )
+{
+   const int64_t elapsed_us = ( now - _last_refill ).count();
+   if( elapsed_us <= 0 )
+      return;
+   const int64_t refilled = int64_t( double( _rate_us_per_second ) * elapsed_us / 1000000 );
+   if( refilled == 0 )
+      return;
+   _available_us = std::min( _burst_us, _available_us + refilled );
+   _last_refill = now;
+}
+
+void api_call_budget::admit( const char* method, fc::time_point now )
+{
+   if( _rate_us_per_second == 0 )
+      return;
+   refill( now );
+   FC_ASSERT( _available_us > 0,
+              "API budget of the connection exceeded by ${m}, retry in ${w} ms",
+              ("m",method)("w", ( -_available_us * 1000 ) / int64_t( _rate_us_per_second ) + 1) );
+}
+
+void api_call_budget::charge( fc::microseconds cost )
+{
+   if( _rate_us_per_second == 0 )
+      return;
+   _available_us -= std::max<int64_t>( cost.count(), 0 );
+}
+
+int64_t api_call_budget::available_us( fc::time_point now )
+{
+   refill( now );
+   return _available_us;
+}
+
+} } // graphene::app
@@ -22,34 +22,49 @@
  * THE SOFTWARE.
  */
 #include <graphene/app/api.hpp>
+#include <graphene/app/api_call_profile.hpp>
 #include <graphene/app/api_access.hpp>
 #include <graphene/app/application.hpp>
+#include <graphene/app/json_reader.hpp>
+#include <graphene/app/json_stream.hpp>
+#include <graphene/app/object_change_feed.hpp>
+#include <graphene/app/packed_rpc.hpp>
 #include <graphene/app/plugin.hpp>
 
 #include <graphene/chain/protocol/fee_schedule.hpp>
 #include <graphene/chain/protocol/types.hpp>
 
+#include <graphene/db/node_pool.hpp>
+
 #include <graphene/egenesis/egenesis.hpp>
 
 #include <graphene/net/core_messages.hpp>
 #include <graphene/net/exceptions.hpp>
 
+#include <graphene/utilities/async_log.hpp>
+#include <graphene/utilities/cpu_affinity.hpp>
 #include <graphene/utilities/key_conversion.hpp>
+#include <graphene/utilities/metrics.hpp>
+#include <graphene/utilities/thread_pool.hpp>
 
 #include <fc/smart_ref_impl.hpp>
 
 #include <fc/io/fstream.hpp>
 #include <fc/rpc/api_connection.hpp>
 #include <fc/rpc/websocket_api.hpp>
+#include <fc/network/http/server.hpp>
 #include <fc/network/resolve.hpp>
 #include <fc/crypto/base64.hpp>
+#include <fc/crypto/hex.hpp>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/signals2.hpp>
 #include <boost/range/algorithm/reverse.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <csignal>
 #include <iostream>
+#include <sstream>
 
 #include <fc/log/file_appender.hpp>
 #include <fc/log/logger.hpp>
@@ -58,6 +73,16 @@
 #include <boost/range/adaptor/reversed.hpp>
 
 
+GRAPHENE_PACKED_RPC_API( graphene::app::database_api )
+GRAPHENE_PACKED_RPC_API( graphene::app::network_broadcast_api )
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::chain::genesis_state_type )
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::chain::genesis_state_type::initial_account_type )
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::chain::genesis_state_type::initial_asset_type )
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::chain::genesis_state_type::initial_account_balance_type )
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::chain::genesis_state_type::initial_witness_type )
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::chain::genesis_state_type::initial_committee_member_type )
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::chain::genesis_state_type::initial_platform_type )
+
 namespace graphene { namespace app {
 using net::item_hash_t;
 using net::item_id;
@@ -124,12 +149,361 @@ namespace detail {
       return initial_state;
    }
 
+   /**
+    * A websocket API connection which writes the answers of the large database API calls listed in
+    * @ref add_streamed_calls() with write_json(), without turning the whole result into an fc::variant first. The
+    * answer is written straight into the message sent, as the connection only sends whole messages. A streamed call
+    * which fails is answered with its error, every other message is handled as usual by the base class.
+    *
+    * Only the calls of the database API registered first on the connection, which has the id 0 and the name
+    * "database", are streamed.
+    *
+    * A message starting with @ref packed_call_prefix is a packed_rpc_request, hex encoded so it travels in the same
+    * text messages as JSON, and is answered the same way with a packed_rpc_response, see packed_rpc.hpp.
+    */
+   class streaming_api_connection : public fc::rpc::websocket_api_connection
+   {
+   public:
+      streaming_api_connection( fc::http::websocket_connection& c, uint32_t max_depth,
+                                const fc::api<database_api>& db_api, const std::shared_ptr<login_api>& login )
+      : fc::rpc::websocket_api_connection( c, max_depth ), _ws( c ), _max_depth( max_depth ), _db_api( db_api ),
+        _login( login )
+      {
+         add_streamed_calls();
+         c.on_message_handler( [this]( const std::string& msg )
+         {
+            if( is_packed_call( msg ) )
+            {
+               _ws.send_message( packed_reply( msg ) );
+               return;
+            }
+            auto reply = streamed_reply( msg );
+            if( !reply.valid() )
+               reply = broadcast_reply( msg );
+            if( reply.valid() )
+               _ws.send_message( *reply );
+            else
+               on_message( msg, true );
+         } );
+         c.on_http_handler( [this]( const std::string& msg ) -> std::string
+         {
+            if( is_packed_call( msg ) )
+               return packed_reply( msg );
+            auto reply = streamed_reply( msg );
+            if( !reply.valid() )
+               reply = broadcast_reply( msg );
+            return reply.valid() ? *reply : on_message( msg, false );
+         } );
+      }
+
+      /// Makes @p api callable with packed calls, the first one added has the id 0
+      template<typename Api>
+      void register_packed_api( const fc::api<Api>& api )
+      {
+         _packed_apis.add_api( api );
+      }
+
+      static const char packed_call_prefix = '#';
+
+   private:
+      static bool is_packed_call( const std::string& msg )
+      {
+         return !msg.empty() && msg[0] == packed_call_prefix;
+      }
+
+      std::string packed_reply( const std::string& msg )
+      {
+         vector<char> request( ( msg.size() - 1 ) / 2 );
+         if( fc::from_hex( msg.substr( 1 ), request.data(), request.size() ) != request.size() )
+            request.clear(); // answered with the unpacking error
+         const vector<char> response = _packed_apis.call( request );
+         return packed_call_prefix + fc::to_hex( response.data(), response.size() );
+      }
+
+      typedef std::function<void( const fc::variants&, std::ostream& )> streamed_call;
+
+      void add_streamed_calls()
+      {
+         auto db_api = _db_api;
+         auto max_depth = _max_depth;
+         _streamed_calls["get_objects"] = [db_api,max_depth]( const fc::variants& a, std::ostream& out )
+         {
+            FC_ASSERT( a.size() == 1 );
+            write_json( out, db_api->get_objects( a[0].as<vector<object_id_type>>( max_depth ) ), max_depth );
+         };
+         _streamed_calls["list_objects_page"] = [db_api,max_depth]( const fc::variants& a, std::ostream& out )
+         {
+            FC_ASSERT( a.size() == 5 );
+            write_json( out, db_api->list_objects_page( a[0].as_string(), a[1].get_array(), a[2].as_string(),
+                                                        a[3].as_uint64(), a[4].as<vector<string>>( max_depth ) ),
+                        max_depth );
+         };
+         _streamed_calls["get_post_profits_detail"] = [db_api,max_depth]( const fc::variants& a, std::ostream& out )
+         {
+            FC_ASSERT( a.size() == 5 );
+            write_json( out, db_api->get_post_profits_detail( a[0].as_uint64(), a[1].as_uint64(),
+                                                              a[2].as<account_uid_type>( max_depth ),
+                                                              a[3].as<account_uid_type>( max_depth ),
+                                                              a[4].as<post_pid_type>( max_depth ) ),
+                        max_depth );
+         };
+         _streamed_calls["get_platform_profits_detail"] = [db_api,max_depth]( const fc::variants& a, std::ostream& out )
+         {
+            FC_ASSERT( a.size() == 5 );
+            write_json( out, db_api->get_platform_profits_detail( a[0].as_uint64(), a[1].as_uint64(),
+                                                                  a[2].as<account_uid_type>( max_depth ),
+                                                                  a[3].as_uint64(), a[4].as_uint64() ),
+                        max_depth );
+         };
+         _streamed_calls["get_poster_profits_detail"] = [db_api,max_depth]( const fc::variants& a, std::ostream& out )
+         {
+            FC_ASSERT( a.size() == 5 );
+            write_json( out, db_api->get_poster_profits_detail( a[0].as_uint64(), a[1].as_uint64(),
+                                                                a[2].as<account_uid_type>( max_depth ),
+                                                                a[3].as_uint64(), a[4].as_uint64() ),
+                        max_depth );
+         };
+         _streamed_calls["lookup_platforms"] = [db_api,max_depth]( const fc::variants& a, std::ostream& out )
+         {
+            FC_ASSERT( a.size() == 3 );
+            write_json( out, db_api->lookup_platforms( a[0].as<account_uid_type>( max_depth ), a[1].as_uint64(),
+                                                       a[2].as<data_sorting_type>( max_depth ) ),
+                        max_depth );
+         };
+         _streamed_calls["lookup_witnesses"] = [db_api,max_depth]( const fc::variants& a, std::ostream& out )
+         {
+            FC_ASSERT( a.size() == 3 );
+            write_json( out, db_api->lookup_witnesses( a[0].as<account_uid_type>( max_depth ), a[1].as_uint64(),
+                                                       a[2].as<data_sorting_type>( max_depth ) ),
+                        max_depth );
+         };
+         _streamed_calls["lookup_committee_members"] = [db_api,max_depth]( const fc::variants& a, std::ostream& out )
+         {
+            FC_ASSERT( a.size() == 3 );
+            write_json( out, db_api->lookup_committee_members( a[0].as<account_uid_type>( max_depth ),
+                                                               a[1].as_uint64(),
+                                                               a[2].as<data_sorting_type>( max_depth ) ),
+                        max_depth );
+         };
+      }
+
+      /// An output stream appending to a string, so that an answer is written in the message it is sent as
+      class string_output_buf : public std::streambuf
+      {
+      public:
+         explicit string_output_buf( std::string& out ) : _out( out ) {}
+
+      protected:
+         int_type overflow( int_type c ) override
+         {
+            if( !traits_type::eq_int_type( c, traits_type::eof() ) )
+               _out.push_back( traits_type::to_char_type( c ) );
+            return traits_type::not_eof( c );
+         }
+         std::streamsize xsputn( const char* s, std::streamsize n ) override
+         {
+            _out.append( s, n );
+            return n;
+         }
+
+      private:
+         std::string& _out;
+      };
+
+      /// The answer to @p msg if it is a streamed call, with the error of the call if it fails, otherwise nothing
+      fc::optional<std::string> streamed_reply( const std::string& msg )const
+      {
+         // skip parsing the messages which can't be a streamed call
+         bool maybe_streamed = false;
+         for( const auto& c : _streamed_calls )
+            if( msg.find( c.first ) != std::string::npos )
+               maybe_streamed = true;
+         if( !maybe_streamed )
+            return fc::optional<std::string>();
+
+         std::string id;
+         std::string jsonrpc;
+         fc::variants params;
+         std::map<std::string, streamed_call>::const_iterator itr;
+         // the messages which can't be read here are left to the base class, which answers them with the error
+         try
+         {
+            const fc::variant_object request = fc::json::from_string( msg ).get_object();
+            if( !request.contains( "id" ) || !request.contains( "method" ) || !request.contains( "params" )
+                  || request["method"].as_string() != "call" )
+               return fc::optional<std::string>();
+            params = request["params"].get_array();
+            if( params.size() != 3 || !params[2].is_array() )
+               return fc::optional<std::string>();
+            if( params[0].is_string() ? params[0].as_string() != "database" : params[0].as_uint64() != 0 )
+               return fc::optional<std::string>();
+            itr = _streamed_calls.find( params[1].as_string() );
+            if( itr == _streamed_calls.end() )
+               return fc::optional<std::string>();
+            id = fc::json::to_string( request["id"] );
+            if( request.contains( "jsonrpc" ) )
+               jsonrpc = fc::json::to_string( request["jsonrpc"] );
+         }
+         catch( const fc::exception& )
+         {
+            return fc::optional<std::string>();
+         }
+         catch( const std::exception& )
+         {
+            return fc::optional<std::string>();
+         }
+
+         // the call isn't made again by the base class when it fails
+         try
+         {
+            std::string reply = "{\"id\":" + id;
+            if( !jsonrpc.empty() )
+               reply += ",\"jsonrpc\":" + jsonrpc;
+            reply += ",\"result\":";
+            {
+               string_output_buf buf( reply );
+               std::ostream out( &buf );
+               itr->second( params[2].get_array(), out );
+            }
+            reply += '}';
+            return reply;
+         }
+         catch( const fc::exception& e )
+         {
+            return error_reply( id, jsonrpc, e.to_detail_string(), fc::json::to_string( fc::variant( e, _max_depth ) ) );
+         }
+         catch( const std::exception& e )
+         {
+            return error_reply( id, jsonrpc, e.what(), std::string() );
+         }
+      }
+
+      /**
+       * The answer to @p msg if it is a broadcast_transaction call, with the error of the call if it fails, otherwise
+       * nothing. The transaction is read with read_json(), without parsing the message into an fc::variant first.
+       *
+       * The call is made whatever API id it names, as only the network broadcast API has the method.
+       */
+      fc::optional<std::string> broadcast_reply( const std::string& msg )const
+      {
+         if( msg.find( "\"broadcast_transaction\"" ) == std::string::npos )
+            return fc::optional<std::string>();
+
+         std::string id;
+         std::string jsonrpc;
+         fc::optional<signed_transaction> trx;
+         // the messages which can't be read here are left to the base class, which answers them with the error
+         try
+         {
+            json_reader in( msg );
+            std::string method;
+            in.expect( '{' );
+            do
+            {
+               const std::string name = in.read_string();
+               in.expect( ':' );
+               if( name == "id" )
+               {
+                  // written back as it is, so only a number or a string
+                  const char c = in.peek();
+                  if( c == '"' )
+                     id = fc::json::to_string( fc::variant( in.read_string() ) );
+                  else if( c == '-' || ( c >= '0' && c <= '9' ) )
+                  {
+                     id = in.read_number();
+                     fc::json::from_string( id );
+                  }
+                  else
+                     return fc::optional<std::string>();
+               }
+               else if( name == "jsonrpc" )
+                  jsonrpc = fc::json::to_string( fc::variant( in.read_string() ) );
+               else if( name == "method" )
+                  method = in.read_string();
+               else if( name == "params" )
+               {
+                  in.expect( '[' );
+                  in.skip_value( _max_depth );
+                  in.expect( ',' );
+                  if( in.read_string() != "broadcast_transaction" )
+                     return fc::optional<std::string>();
+                  in.expect( ',' );
+                  in.expect( '[' );
+                  trx = signed_transaction();
+                  read_json( in, *trx, _max_depth );
+                  in.expect( ']' );
+                  in.expect( ']' );
+               }
+               else
+                  in.skip_value( _max_depth );
+            } while( in.accept( ',' ) );
+            in.expect( '}' );
+            if( id.empty() || method != "call" || !trx.valid() || !in.at_end() )
+               return fc::optional<std::string>();
+         }
+         catch( const fc::exception& )
+         {
+            return fc::optional<std::string>();
+         }
+         catch( const std::exception& )
+         {
+            return fc::optional<std::string>();
+         }
+
+         // the transaction isn't evaluated again by the base class when it fails
+         try
+         {
+            _login->network_broadcast()->broadcast_transaction( *trx );
+         }
+         catch( const fc::exception& e )
+         {
+            return error_reply( id, jsonrpc, e.to_detail_string(), fc::json::to_string( fc::variant( e, _max_depth ) ) );
+         }
+         catch( const std::exception& e )
+         {
+            return error_reply( id, jsonrpc, e.what(), std::string() );
+         }
+         std::ostringstream out;
+         out << "{\"id\":" << id;
+         if( !jsonrpc.empty() )
+            out << ",\"jsonrpc\":" << jsonrpc;
+         out << ",\"result\":null}";
+         return out.str();
+      }
+
+      /**
+       * The answer to a failed call like the base class makes it, @p id, @p jsonrpc and @p data being JSON texts,
+       * @p jsonrpc and @p data left out if empty
+       */
+      static std::string error_reply( const std::string& id, const std::string& jsonrpc, const std::string& message,
+                                      const std::string& data )
+      {
+         std::ostringstream out;
+         out << "{\"id\":" << id;
+         if( !jsonrpc.empty() )
+            out << ",\"jsonrpc\":" << jsonrpc;
+         out << ",\"error\":{\"code\":1,\"message\":" << fc::json::to_string( fc::variant( message ) );
+         if( !data.empty() )
+            out << ",\"data\":" << data;
+         out << "}}";
+         return out.str();
+      }
+
+      fc::http::websocket_connection&       _ws;
+      uint32_t                              _max_depth;
+      fc::api<database_api>                 _db_api;
+      std::shared_ptr<login_api>            _login;
+      std::map<std::string, streamed_call>  _streamed_calls;
+      packed_rpc_apis                       _packed_apis;
+   };
+
    class application_impl : public net::node_delegate
    {
    public:
       fc::optional<fc::temp_file> _lock_file;
       bool _is_block_producer = false;
       bool _force_validate = false;
+      bool _undo_memory_halt_requested = false;
       application_options _app_options;
 
       void reset_p2p_node(const fc::path& data_dir)
@@ -138,6 +512,11 @@ namespace detail {
 
          _p2p_network->load_configuration(data_dir / "p2p");
          _p2p_network->set_node_delegate(this);
+         if( _options->count("p2p-io-threads") )
+            _p2p_network->set_io_threads( _options->at("p2p-io-threads").as<uint32_t>() );
+         const std::vector<uint32_t> p2p_cpus = thread_cpus( "p2p-cpus" );
+         if( !p2p_cpus.empty() )
+            _p2p_network->set_thread_affinity( p2p_cpus );
 
          if( _options->count("seed-node") )
          {
@@ -242,12 +621,15 @@ namespace detail {
 
       void new_connection( const fc::http::websocket_connection_ptr& c )
       {
-         auto wsc = std::make_shared<fc::rpc::websocket_api_connection>(*c, GRAPHENE_NET_MAX_NESTED_OBJECTS);
          auto login = std::make_shared<graphene::app::login_api>( std::ref(*_self) );
          login->enable_api("database_api");
+         auto db_api = login->database();
+         auto wsc = std::make_shared<streaming_api_connection>(*c, GRAPHENE_NET_MAX_NESTED_OBJECTS, db_api, login);
 
-         wsc->register_api(login->database());
+         wsc->register_api(db_api);
          wsc->register_api(fc::api<graphene::app::login_api>(login));
+         wsc->register_packed_api(db_api);
+         wsc->register_packed_api(fc::api<graphene::app::login_api>(login));
          c->set_session_data( wsc );
 
          std::string username = "*";
@@ -305,6 +687,50 @@ namespace detail {
          _websocket_tls_server->start_accept();
       } FC_CAPTURE_AND_RETHROW() }
 
+      void reset_metrics_server()
+      { try {
+         if( !_options->count("metrics-endpoint") )
+            return;
+
+         _api_calls.set_metrics( &_metrics );
+         auto* peers = &_metrics.gauge( "yoyow_p2p_peers", "Connected peers" );
+         auto* syncing_peers = &_metrics.gauge( "yoyow_p2p_syncing_peers",
+                                                "Connected peers the node is fetching the blocks it misses from" );
+         auto* bytes_read = &_metrics.counter( "yoyow_p2p_read_bytes_total", "Bytes received from the peers" );
+         auto* bytes_written = &_metrics.counter( "yoyow_p2p_written_bytes_total", "Bytes sent to the peers" );
+         auto* finished_syncing = &_metrics.gauge( "yoyow_finished_syncing", "1 once the node caught up with the network" );
+         _metrics.add_collector( [=]() {
+            finished_syncing->set( _is_finished_syncing ? 1 : 0 );
+            if( !_p2p_network )
+               return;
+            peers->set( _p2p_network->get_connection_count() );
+            const fc::variant_object usage = _p2p_network->network_get_usage_stats();
+            syncing_peers->set( usage["peers_syncing_from"].as_uint64() );
+            // the node counts the totals, the counters catch up with them
+            bytes_read->add( usage["total_bytes_read"].as_uint64() - bytes_read->value() );
+            bytes_written->add( usage["total_bytes_written"].as_uint64() - bytes_written->value() );
+         } );
+
+         _metrics_server = std::make_shared<fc::http::server>();
+         ilog("Configured metrics to be served on http://${ip}/metrics", ("ip",_options->at("metrics-endpoint").as<string>()));
+         _metrics_server->listen( fc::ip::endpoint::from_string(_options->at("metrics-endpoint").as<string>()) );
+         // on_request() must come after listen()
+         _metrics_server->on_request( [this]( const fc::http::request& req, const fc::http::server::response& resp )
+         {
+            if( req.path != "/metrics" )
+            {
+               resp.set_status( fc::http::reply::NotFound );
+               resp.set_length( 0 );
+               return;
+            }
+            const string body = _metrics.render();
+            resp.add_header( "Content-Type", "text/plain; version=0.0.4" );
+            resp.set_status( fc::http::reply::OK );
+            resp.set_length( body.size() );
+            resp.write( body.c_str(), body.size() );
+         } );
+      } FC_CAPTURE_AND_RETHROW() }
+
       explicit application_impl(application* self)
          : _self(self),
            _chain_db(std::make_shared<chain::database>())
@@ -349,6 +775,12 @@ namespace detail {
          if (_options->count("api-limit-get-htlc-by")) {
             _app_options.api_limit_get_htlc_by = _options->at("api-limit-get-htlc-by").as<uint64_t>();
          }
+         if (_options->count("api-budget-per-second")) {
+            _app_options.api_budget_us_per_second = _options->at("api-budget-per-second").as<uint64_t>() * 1000;
+         }
+         if (_options->count("api-budget-burst")) {
+            _app_options.api_budget_burst_us = _options->at("api-budget-burst").as<uint64_t>() * 1000;
+         }
       }
 
       void startup()
@@ -361,7 +793,9 @@ namespace detail {
             {
                std::string genesis_str;
                fc::read_file_contents( _options->at("genesis-json").as<boost::filesystem::path>(), genesis_str );
-               genesis_state_type genesis = fc::json::from_string( genesis_str ).as<genesis_state_type>( 20 );
+               const bool binary_genesis = is_binary_genesis_state( genesis_str );
+               genesis_state_type genesis = binary_genesis ? load_binary_genesis_state( genesis_str )
+                                                           : read_json<genesis_state_type>( genesis_str, 20 );
                bool modified_genesis = false;
                if( _options->count("genesis-timestamp") )
                {
@@ -384,19 +818,14 @@ namespace detail {
                   genesis_str += "BOGUS";
                   genesis.initial_chain_id = fc::sha256::hash( genesis_str );
                }
-               else
+               else if( !binary_genesis )
                   genesis.initial_chain_id = fc::sha256::hash( genesis_str );
                return genesis;
             }
             else
             {
-               std::string egenesis_json;
-               graphene::egenesis::compute_egenesis_json( egenesis_json );
-               FC_ASSERT( egenesis_json != "" );
-               FC_ASSERT( graphene::egenesis::get_egenesis_json_hash() == fc::sha256::hash( egenesis_json ) );
-               auto genesis = fc::json::from_string( egenesis_json ).as<genesis_state_type>( 20 );
-               genesis.initial_chain_id = fc::sha256::hash( egenesis_json );
-               return genesis;
+               FC_ASSERT( graphene::egenesis::has_egenesis(), "No genesis state was compiled in, use --genesis-json" );
+               return graphene::egenesis::get_egenesis();
             }
          };
          if (_options->count("active-post-periods"))
@@ -417,11 +846,95 @@ namespace detail {
             _chain_db->set_custom_vote_remain_time(_options->at("custom-vote-remain-time").as<uint32_t>());
          }    
 
+         if( _options->count("block-database-mmap") )
+            _chain_db->set_block_database_mmap( _options->at("block-database-mmap").as<bool>() );
+
+         if( _options->count("block-database-compression") )
+            _chain_db->set_block_database_compression( _options->at("block-database-compression").as<bool>() );
+         if( _options->count("block-cache-size") )
+            _chain_db->set_block_cache_size( _options->at("block-cache-size").as<uint32_t>() );
+         if( _options->count("block-ids-kept") )
+            _chain_db->set_block_ids_kept( _options->at("block-ids-kept").as<uint32_t>() );
+         if( _options->count("block-database-write-batch") )
+            _chain_db->set_block_database_write_batch( _options->at("block-database-write-batch").as<uint32_t>() );
+         if( _options->count("block-database-sync-writes") )
+            _chain_db->set_block_database_sync_writes( _options->at("block-database-sync-writes").as<bool>() );
+
+         if( _options->count("object-archive") )
+            _chain_db->set_object_archive_enabled( _options->at("object-archive").as<bool>() );
+         if( _options->count("applied-operations-log") )
+            _chain_db->set_applied_operations_log_enabled( _options->at("applied-operations-log").as<bool>() );
+
+         if( _options->count("fork-database-memory-limit") )
+            _chain_db->set_fork_database_memory_limit( _options->at("fork-database-memory-limit").as<uint64_t>() * 1024 * 1024 );
+
+         if( _options->count("undo-database-memory-limit") )
+         {
+            _chain_db->set_undo_database_memory_limit( _options->at("undo-database-memory-limit").as<uint64_t>() * 1024 * 1024 );
+            // halt through the signal handlers of the node, which save the state on the way out
+            _chain_db->undo_memory_limit_exceeded.connect( [this]( uint64_t memory_bytes ) {
+               if( _undo_memory_halt_requested )
+                  return;
+               _undo_memory_halt_requested = true;
+               elog( "Undo database uses ${m} bytes, over its limit of ${l} bytes, shutting down. "
+                     "The last irreversible block is ${i}, head block is ${h}",
+                     ("m",memory_bytes)("l",_chain_db->get_undo_database_stats().memory_limit)
+                     ("i",_chain_db->get_dynamic_global_properties().last_irreversible_block_num)
+                     ("h",_chain_db->head_block_num()) );
+               std::raise( SIGTERM );
+            } );
+         }
+
+         if( _options->count("signature-key-cache-size") )
+            _chain_db->set_signature_key_cache_size( _options->at("signature-key-cache-size").as<uint32_t>() );
+         if( _options->count("recent-transactions-kept") )
+            _chain_db->set_recent_transactions_kept( _options->at("recent-transactions-kept").as<uint32_t>() );
+
+         if( _options->count("max-state-deltas") )
+         {
+            auto max_deltas = _options->at("max-state-deltas").as<uint32_t>();
+            _chain_db->set_incremental_flush( max_deltas > 0, max_deltas );
+         }
+
+         if( _options->count("worker-threads") )
+            _chain_db->set_worker_threads( _options->at("worker-threads").as<uint32_t>() );
+         const std::vector<uint32_t> worker_cpus = thread_cpus( "worker-cpus" );
+         if( !worker_cpus.empty() )
+            _chain_db->pin_worker_threads( worker_cpus );
+
          if (_options->count("check_invariants_interval")){
             auto interval=_options->at("check_invariants_interval").as<uint32_t>();
             FC_ASSERT(interval> 0);
             _chain_db->set_check_invariants_interval(interval);
          }
+         if( _options->count("check-invariants-async") )
+            _chain_db->set_check_invariants_async( _options->at("check-invariants-async").as<bool>() );
+         if( _options->count("check-supply-totals") )
+            _chain_db->set_check_supply_totals( _options->at("check-supply-totals").as<bool>() );
+         if( _options->count("evaluation-profile-log-interval") )
+            _chain_db->set_evaluation_profile_log_interval( _options->at("evaluation-profile-log-interval").as<uint32_t>() );
+         if( _options->count("block-profiles-kept") )
+            _chain_db->get_block_profiler().set_max_size( _options->at("block-profiles-kept").as<uint32_t>() );
+         // before opening the database so that the replayed blocks are measured too
+         if( _options->count("metrics-endpoint") )
+            _chain_db->set_metrics( &_metrics );
+         if( _options->count("slot-timings-kept") )
+            _chain_db->get_slot_timings().set_blocks_kept( _options->at("slot-timings-kept").as<uint32_t>() );
+         if( _options->count("state-diffs-kept") )
+            _chain_db->set_state_diffs_kept( _options->at("state-diffs-kept").as<uint32_t>() );
+         if( _options->count("block-profile-log") )
+            _chain_db->set_slow_block_log_threshold( int64_t( _options->at("block-profile-log").as<uint32_t>() ) * 1000 );
+         if( _options->count("max-pending-transactions") )
+            _chain_db->set_max_pending_transactions( _options->at("max-pending-transactions").as<uint32_t>() );
+         if( _options->count("pending-transaction-log-interval") )
+            _chain_db->set_pending_transaction_log_interval( _options->at("pending-transaction-log-interval").as<uint32_t>() );
+         if( _options->count("log-index-memory-on-exit") )
+            _chain_db->set_log_index_memory_on_close( _options->at("log-index-memory-on-exit").as<bool>() );
+         if( _options->count("index-huge-pages") )
+            graphene::db::node_pool::set_use_huge_pages( _options->at("index-huge-pages").as<bool>() );
+         // connected before opening the database so that the subscribers also get the replayed blocks
+         if( _block_feed && !_block_feed->empty() )
+            _block_feed->connect( *_chain_db );
 
 
          if( _options->count("resync-blockchain") )
@@ -443,6 +956,10 @@ namespace detail {
          if( _options->count("replay-blockchain") )
             _chain_db->wipe( _data_dir / "blockchain", false );
 
+         if( _options->count("import-state-snapshot") )
+            _chain_db->import_state_snapshot( _options->at("import-state-snapshot").as<boost::filesystem::path>(),
+                                              _data_dir / "blockchain", GRAPHENE_CURRENT_DB_VERSION );
+
          try
          {
             _chain_db->open( _data_dir / "blockchain", initial_state, GRAPHENE_CURRENT_DB_VERSION );
@@ -453,6 +970,17 @@ namespace detail {
             throw;
          }
 
+         if( _options->count("export-state-snapshot") )
+            _chain_db->export_state_snapshot( _options->at("export-state-snapshot").as<boost::filesystem::path>() );
+
+         if( _options->count("object-change-log-size") && _options->at("object-change-log-size").as<uint32_t>() > 0 )
+         {
+            _object_change_feed.reset( new object_change_feed( _options->at("object-change-log-size").as<uint32_t>() ) );
+            _object_change_feed->load( object_change_log_file(), _chain_db->head_block_id() );
+            _object_change_feed->connect( *_chain_db );
+            _app_options.object_changes = _object_change_feed.get();
+         }
+
          if( _options->count("force-validate") )
          {
             ilog( "All transaction signatures will be validated" );
@@ -501,6 +1029,7 @@ namespace detail {
          reset_p2p_node(_data_dir);
          reset_websocket_server();
          reset_websocket_tls_server();
+         reset_metrics_server();
       } FC_LOG_AND_RETHROW() }
 
       optional< api_access_info > get_api_access_info(const string& username)const
@@ -544,24 +1073,43 @@ namespace detail {
        *
        * @throws exception if error validating the item, otherwise the item is safe to broadcast on.
        */
+      virtual void prepare_sync_blocks( const std::vector<const graphene::net::block_message*>& blocks ) override
+      { try {
+         // the witness keys don't depend on the chain state, recover them for the whole backlog at once
+         vector<const signed_block*> to_precompute;
+         to_precompute.reserve( blocks.size() );
+         for( const graphene::net::block_message* blk_msg : blocks )
+            to_precompute.push_back( &blk_msg->block );
+         _chain_db->precompute_block_signees( to_precompute );
+      } FC_CAPTURE_AND_RETHROW() }
+
       virtual bool handle_block(const graphene::net::block_message& blk_msg, bool sync_mode,
                                 std::vector<fc::uint160_t>& contained_transaction_message_ids) override
       { try {
 
-         auto latency = fc::time_point::now() - blk_msg.block.timestamp;
+         const fc::time_point received = fc::time_point::now();
+         auto latency = received - blk_msg.block.timestamp;
          if (!sync_mode || blk_msg.block.block_num() % 10000 == 0)
          {
+            // written by the log thread, only plain values are captured, the block itself only if it's dumped
             const auto& witness_account = _chain_db->get_account_by_uid( blk_msg.block.witness );
-            auto last_irr = _chain_db->get_dynamic_global_properties().last_irreversible_block_num;
-            ilog("Got block: #${n} ${bid} time: ${t} latency: ${l} ms from: ${u}/${w}  irreversible: ${i} (-${d})",
-                 ("t",blk_msg.block.timestamp)
-                 ("n", blk_msg.block.block_num())
-                 ("bid", blk_msg.block.id())
-                 ("l", (latency.count()/1000))
-                 ("u",witness_account.uid)
-                 ("w",witness_account.name)
-                 ("i",last_irr)("d",blk_msg.block.block_num()-last_irr) );
-            dlog( "${b}", ("b",blk_msg.block) );
+            const account_uid_type witness_uid = witness_account.uid;
+            const string witness_name = witness_account.name;
+            const uint32_t last_irr = _chain_db->get_dynamic_global_properties().last_irreversible_block_num;
+            const uint32_t block_num = blk_msg.block.block_num();
+            const block_id_type block_id = blk_msg.block.id();
+            const fc::time_point_sec timestamp = blk_msg.block.timestamp;
+            const int64_t latency_ms = latency.count()/1000;
+            async_ilog("Got block: #${n} ${bid} time: ${t} latency: ${l} ms from: ${u}/${w}  irreversible: ${i} (-${d})",
+                 ("t",timestamp)
+                 ("n",block_num)
+                 ("bid",block_id)
+                 ("l",latency_ms)
+                 ("u",witness_uid)
+                 ("w",witness_name)
+                 ("i",last_irr)("d",block_num-last_irr) );
+            const signed_block& block = blk_msg.block;
+            async_dlog( "${b}", ("b",block) );
          }
          FC_ASSERT( (latency.count()/1000) > -2500, "Rejecting block with timestamp in the future" );
 
@@ -570,7 +1118,23 @@ namespace detail {
             // you can help the network code out by throwing a block_older_than_undo_history exception.
             // when the net code sees that, it will stop trying to push blocks from that chain, but
             // leave that peer connected so that they can get sync blocks from us
+            // the transactions already in the pending state were received or pushed here, the node isn't
+            // fetching them, only the message ids of the others are needed below. The transaction ids are
+            // kept by the block and used again while it's pushed.
+            std::vector<const processed_transaction*> unseen_transactions;
+            if (!sync_mode)
+            {
+               for (const processed_transaction& transaction : blk_msg.block.transactions)
+               {
+                  if (!_chain_db->is_known_transaction(transaction.id()))
+                     unseen_transactions.push_back(&transaction);
+               }
+            }
+
             bool result = _chain_db->push_block(blk_msg.block, (_is_block_producer | _force_validate) ? database::skip_nothing : ( database::skip_transaction_signatures | database::skip_invariants_check ) );
+            if (!sync_mode)
+               _chain_db->get_slot_timings().record_received( blk_msg.block.witness, blk_msg.block.block_num(),
+                                                              blk_msg.block.timestamp, received );
             // the block was accepted, so we now know all of the transactions contained in the block
             if (!sync_mode)
             {
@@ -579,9 +1143,9 @@ namespace detail {
                // happens, there's no reason to fetch the transactions, so  construct a list of the
                // transaction message ids we no longer need.
                // during sync, it is unlikely that we'll see any old
-               for (const processed_transaction& transaction : blk_msg.block.transactions)
+               for (const processed_transaction* transaction : unseen_transactions)
                {
-                  graphene::net::trx_message transaction_message(transaction);
+                  graphene::net::trx_message transaction_message(*transaction);
                   contained_transaction_message_ids.push_back(graphene::net::message(transaction_message).id());
                }
             }
@@ -603,19 +1167,23 @@ namespace detail {
          }
       } FC_CAPTURE_AND_RETHROW( (blk_msg)(sync_mode) ) }
 
-      virtual void handle_transaction(const graphene::net::trx_message& transaction_message) override
+      virtual void handle_transaction(graphene::net::trx_message&& transaction_message) override
       { try {
          static fc::time_point last_call;
          static int trx_count = 0;
          ++trx_count;
          auto now = fc::time_point::now();
          if( now - last_call > fc::seconds(1) ) {
-            ilog("Got ${c} transactions from network", ("c",trx_count) );
+            const int count = trx_count;
+            async_ilog("Got ${c} transactions from network", ("c",count) );
             last_call = now;
             trx_count = 0;
          }
 
-         _chain_db->push_transaction( transaction_message.trx );
+         // the stateless checks run on a worker thread, other messages are handled on this thread meanwhile
+         _chain_db->prevalidate_transaction( transaction_message.trx );
+         // only moved away when it's accepted, it's still there to be reported otherwise
+         _chain_db->push_transaction( std::move(transaction_message.trx) );
       } FC_CAPTURE_AND_RETHROW( (transaction_message) ) }
 
       virtual void handle_message(const message& message_to_process) override
@@ -695,13 +1263,20 @@ namespace detail {
         // ilog("Request for item ${id}", ("id", id));
          if( id.item_type == graphene::net::block_message_type )
          {
-            auto opt_block = _chain_db->fetch_block_by_id(id.item_hash);
-            if( !opt_block )
+            auto raw_block = _chain_db->fetch_raw_block_by_id(id.item_hash);
+            if( !raw_block )
                elog("Couldn't find block ${id} -- corresponding ID in our chain is ${id2}",
                     ("id", id.item_hash)("id2", _chain_db->get_block_id_for_num(block_header::num_from_id(id.item_hash))));
-            FC_ASSERT( opt_block.valid() );
-            // ilog("Serving up block #${num}", ("num", opt_block->block_num()));
-            return block_message(std::move(*opt_block));
+            FC_ASSERT( raw_block.valid() );
+            // ilog("Serving up block #${num}", ("num", block_header::num_from_id(id.item_hash)));
+            // a block_message is the serialized block followed by its id, the stored bytes are used as they are
+            message result;
+            result.msg_type = graphene::net::block_message_type;
+            result.data = std::move(*raw_block);
+            const vector<char> packed_id = fc::raw::pack( block_id_type( id.item_hash ) );
+            result.data.insert( result.data.end(), packed_id.begin(), packed_id.end() );
+            result.size = (uint32_t)result.data.size();
+            return result;
          }
          return trx_message( _chain_db->get_recent_transaction( id.item_hash ) );
       } FC_CAPTURE_AND_RETHROW( (id) ) }
@@ -944,16 +1519,56 @@ namespace detail {
          return _chain_db->get_global_properties().parameters.block_interval;
       }
 
+      fc::path object_change_log_file()const
+      {
+         return _data_dir / "object_changes.bin";
+      }
+
+      /// saves the object change log, before the database is closed
+      void save_object_changes()
+      {
+         if( _object_change_feed && _chain_db )
+         {
+            try
+            {
+               _object_change_feed->save( object_change_log_file(), _chain_db->head_block_id() );
+            }
+            catch( const fc::exception& e )
+            {
+               elog( "Unable to save the object change log: ${e}", ("e",e.to_detail_string()) );
+            }
+         }
+      }
+
       application* _self;
 
       fc::path _data_dir;
       const bpo::variables_map* _options = nullptr;
       api_access _apiaccess;
+      /// the CPUs the node could run on before chain-cpus pinned the main thread, empty if it isn't pinned
+      std::vector<uint32_t> _unpinned_cpus;
+
+      /// the CPUs the threads configured by @p option are pinned to, empty to leave them where they are
+      std::vector<uint32_t> thread_cpus( const char* option )const
+      {
+         if( _options->count( option ) )
+            return graphene::utilities::parse_cpu_list( _options->at( option ).as<string>() );
+         return _unpinned_cpus;
+      }
 
+      /// declared first so that it outlives everything which updates it
+      graphene::utilities::metrics_registry                 _metrics;
+      /// declared first so that it is gone last, after the servers whose calls it runs
+      std::unique_ptr<graphene::utilities::thread_pool>     _api_thread_pool;
+      api_call_profiler                                     _api_calls;
       std::shared_ptr<graphene::chain::database>            _chain_db;
+      std::shared_ptr<graphene::chain::account_history_store> _account_history_store;
+      std::unique_ptr<block_feed>                           _block_feed;
+      std::unique_ptr<object_change_feed>                   _object_change_feed;
       std::shared_ptr<graphene::net::node>                  _p2p_network;
       std::shared_ptr<fc::http::websocket_server>      _websocket_server;
       std::shared_ptr<fc::http::websocket_tls_server>  _websocket_tls_server;
+      std::shared_ptr<fc::http::server>                _metrics_server;
 
       std::map<string, std::shared_ptr<abstract_plugin>> _active_plugins;
       std::map<string, std::shared_ptr<abstract_plugin>> _available_plugins;
@@ -969,11 +1584,15 @@ application::application()
 
 application::~application()
 {
+   my->_metrics_server.reset();
    if( my->_p2p_network )
    {
       my->_p2p_network->close();
       my->_p2p_network.reset();
    }
+   if( my->_block_feed )
+      my->_block_feed->flush();
+   my->save_object_changes();
    if( my->_chain_db )
    {
       my->_chain_db->close();
@@ -985,17 +1604,42 @@ void application::set_program_options(boost::program_options::options_descriptio
 {
    configuration_file_options.add_options()
          ("p2p-endpoint", bpo::value<string>(), "Endpoint for P2P node to listen on")
+         ("p2p-io-threads", bpo::value<uint32_t>(), "Number of threads the P2P connections encrypt and decrypt large messages on, 0 to use the P2P thread (default)")
          ("seed-node,s", bpo::value<vector<string>>()->composing(), "P2P nodes to connect to on startup (may specify multiple times)")
          ("seed-nodes", bpo::value<string>()->composing(), "JSON array of P2P nodes to connect to on startup")
          ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("rpc-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:8090"), "Endpoint for websocket RPC to listen on")
          ("rpc-tls-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:8089"), "Endpoint for TLS websocket RPC to listen on")
+         ("metrics-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:8093"), "Endpoint to serve the node metrics on over HTTP at /metrics, in the Prometheus text format")
          ("server-pem,p", bpo::value<string>()->implicit_value("server.pem"), "The TLS certificate file for this server")
          ("server-pem-password,P", bpo::value<string>()->implicit_value(""), "Password for this certificate")
-         ("genesis-json", bpo::value<boost::filesystem::path>(), "File to read Genesis State from")
+         ("genesis-json", bpo::value<boost::filesystem::path>(), "File to read Genesis State from, in JSON or in the binary format of genesis_update")
          ("dbg-init-key", bpo::value<string>(), "Block signing key to use for init witnesses, overrides genesis file")
          ("api-access", bpo::value<boost::filesystem::path>(), "JSON file specifying API permissions")
          ("plugins", bpo::value<string>(), "Space-separated list of plugins to activate")
+         ("block-database-mmap", bpo::value<bool>(), "Serve block lookups from memory mapped block database files (default: false)")
+         ("block-database-compression", bpo::value<bool>(), "Store new blocks compressed in the block database, blocks already stored are kept as they are (default: false)")
+         ("block-cache-size", bpo::value<uint32_t>(), "Number of the last stored blocks kept in memory for peers and API clients, 0 to disable (default: 256)")
+         ("block-ids-kept", bpo::value<uint32_t>(), "Number of the last blocks whose ids are kept in memory to answer the sync requests of peers, 0 to keep all of them, 20 bytes each (default: 65536)")
+         ("block-database-write-batch", bpo::value<uint32_t>(), "Number of blocks stored in memory before they are written to the block database files at once, the blocks not written are fetched again from peers after a crash, 1 to write every block (default: 16)")
+         ("block-database-sync-writes", bpo::value<bool>(), "Sync each batch of block writes to the disk before going on (default: false)")
+         ("object-archive", bpo::value<bool>(), "Keep the past versions of the objects on disk to look up the objects at any block from where the archive started, replay the blockchain to start it at genesis (default: false)")
+         ("applied-operations-log", bpo::value<bool>(), "Keep the operations applied by each block on disk, so that the plugins keeping their data on disk, like account_history with history-on-disk, can be enabled later without replaying the blockchain (default: false)")
+         ("fork-database-memory-limit", bpo::value<uint64_t>(), "Megabytes of blocks the fork database keeps in memory, older blocks are spilled to disk, 0 for no limit (default)")
+         ("undo-database-memory-limit", bpo::value<uint64_t>(), "Megabytes the undo states of the reversible blocks may use before the node shuts down, 0 for no limit (default)")
+         ("signature-key-cache-size", bpo::value<uint32_t>(), "Number of keys recovered from transaction signatures kept to check the same transactions again, 0 to disable (default: 100000)")
+         ("recent-transactions-kept", bpo::value<uint32_t>(), "Number of the last transactions kept to answer peers and API clients asking for them by id, 0 to keep none (default: 20000)")
+         ("max-state-deltas", bpo::value<uint32_t>(), "Save only changed objects on shutdown, keeping up to this many deltas on top of the last full state snapshot before compacting them, 0 to always save the full state (default)")
+         ("worker-threads", bpo::value<uint32_t>(), "Number of worker threads used for parallel work such as signature recovery and loading the object database, 0 to disable (default)")
+         ("api-threads", bpo::value<uint32_t>(), "Number of threads serving read-only database API calls beside block processing, 0 to serve them on the main thread (default)")
+         ("chain-cpus", bpo::value<string>(), "CPUs the main thread, which applies and produces the blocks, runs on, as a list like 0-3,8 or as node<n> for the CPUs of a NUMA node (default: all the CPUs the node may run on)")
+         ("p2p-cpus", bpo::value<string>(), "CPUs the P2P thread and the P2P io threads run on, in the format of chain-cpus (default: all the CPUs the node may run on)")
+         ("worker-cpus", bpo::value<string>(), "CPUs the worker threads, which recover signatures among others, run on, in the format of chain-cpus (default: all the CPUs the node may run on)")
+         ("api-cpus", bpo::value<string>(), "CPUs the API threads run on, in the format of chain-cpus (default: all the CPUs the node may run on)")
+         ("plugin-cpus", bpo::value<string>(), "CPUs the threads of the asynchronous plugins run on, in the format of chain-cpus (default: all the CPUs the node may run on)")
+         ("api-budget-per-second", bpo::value<uint64_t>(), "Milliseconds of API thread time each connection may use per second, its calls are rejected while it's over budget, 0 for no limit (default)")
+         ("api-budget-burst", bpo::value<uint64_t>(), "Milliseconds of API thread time a connection may save up while idle and spend at once (default: the budget per second)")
+         ("object-change-log-size", bpo::value<uint32_t>(), "Number of the last object changes kept for get_object_changes, saved on shutdown, 0 to disable the log (default)")
          ;
    command_line_options.add(configuration_file_options);
    command_line_options.add_options()
@@ -1005,10 +1649,25 @@ void application::set_program_options(boost::program_options::options_descriptio
           "invalid file is found, it will be replaced with an example Genesis State.")
          ("replay-blockchain", "Rebuild object graph by replaying all blocks")
          ("resync-blockchain", "Delete all blocks and re-sync with network from scratch")
+         ("import-state-snapshot", bpo::value<boost::filesystem::path>(), "Replace the state and delete the blocks with the state snapshot in this directory, then sync from its head block")
+         ("export-state-snapshot", bpo::value<boost::filesystem::path>(), "Write a snapshot of the state at the head block to this new directory after opening the database")
          ("force-validate", "Force validation of all transactions")
          ("genesis-timestamp", bpo::value<uint32_t>(), "Replace timestamp from genesis.json with current time plus this many seconds (experts only!)")
          ("active-post-periods", bpo::value<uint32_t>(), "Record active post object that be created in the last few periods")
          ("check_invariants_interval", bpo::value<uint32_t>(),"check core balance, prepaid, csaf, voter of all account when per check_invariants_interval blocks, don`t check if unset this option")
+         ("check-invariants-async", bpo::value<bool>()->implicit_value(true), "Run the check_invariants_interval check right after the block instead of while applying it, only logging failures")
+         ("check-supply-totals", bpo::value<bool>()->implicit_value(true), "Check the supply of every asset against running totals after each fully validated block, without scanning the accounts")
+         ("evaluation-profile-log-interval", bpo::value<uint32_t>(), "Log the time spent in the evaluators of each operation type every this many blocks, 0 to never log it (default)")
+         ("block-profiles-kept", bpo::value<uint32_t>(), "Number of the last applied blocks the phase durations are kept of for the API, 0 to keep none (default: 1000)")
+         ("slot-timings-kept", bpo::value<uint32_t>(), "Number of the last blocks of each witness the times after their slot they were signed or received at are kept of for the API, 0 to keep none (default: 1000)")
+         ("state-diffs-kept", bpo::value<uint32_t>(), "Number of the last applied blocks the object changes are kept of for replica nodes to fetch through the block API, 0 to keep none (default)")
+         ("block-profile-log", bpo::value<uint32_t>(), "Log the phase durations of every block which takes at least this many milliseconds to apply, 0 to log none (default)")
+         ("max-pending-transactions", bpo::value<uint32_t>(), "Number of pending transactions beyond which only those paying a higher fee rate than the lowest pending one are accepted, 0 for no limit (default)")
+         ("pending-transaction-log-interval", bpo::value<uint32_t>(), "Log the number, size and age of the pending transactions, their re-apply time and rejections every this many blocks, 0 to never log them (default)")
+         ("log-index-memory-on-exit", bpo::value<bool>()->implicit_value(true), "Log the number of objects and the estimated memory of each index when the node exits")
+         ("index-huge-pages", bpo::value<bool>()->implicit_value(true), "Allocate the nodes of the post, active post and score indexes in 2 MiB chunks backed by huge pages where the system supports it")
+         ("async-plugins", bpo::value<bool>()->implicit_value(true), "Run the plugins that support it on their own threads, fed with the changes of each applied block")
+         ("async-plugin-queued-blocks", bpo::value<uint32_t>(), "Number of blocks a plugin running on its own thread may fall behind before applying blocks waits for it (default: 16)")
          ("advertising-remain-time", bpo::value<uint32_t>(), "clear advertising order object after remaining time")
          ("custom-vote-remain-time", bpo::value<uint32_t>(), "clear custom vote object and cast custom vote object after remaining time")
          ;
@@ -1021,6 +1680,38 @@ void application::initialize(const fc::path& data_dir, const boost::program_opti
    my->_data_dir = data_dir;
    my->_options = &options;
 
+   // this is the thread the blocks are applied and produced on. The threads it creates afterwards start with its
+   // CPUs, so those of the other options are given all the CPUs the node could run on unless they are set.
+   if( options.count("chain-cpus") )
+   {
+      const std::vector<uint32_t> all_cpus = graphene::utilities::current_thread_cpus();
+      if( graphene::utilities::pin_current_thread( graphene::utilities::parse_cpu_list( options.at("chain-cpus").as<string>() ) ) )
+         my->_unpinned_cpus = all_cpus;
+      else
+         wlog( "Threads can't be pinned to CPUs on this platform, the CPU options are ignored" );
+   }
+
+   if( options.count("async-plugins") && options.at("async-plugins").as<bool>() )
+   {
+      uint32_t max_queued_blocks = block_feed::default_max_queued_blocks;
+      if( options.count("async-plugin-queued-blocks") )
+         max_queued_blocks = options.at("async-plugin-queued-blocks").as<uint32_t>();
+      my->_block_feed.reset( new block_feed( max_queued_blocks ) );
+      const std::vector<uint32_t> plugin_cpus = my->thread_cpus( "plugin-cpus" );
+      if( !plugin_cpus.empty() )
+         my->_block_feed->set_cpus( plugin_cpus );
+   }
+
+   my->_app_options.api_calls = &my->_api_calls;
+   if( options.count("api-threads") && options.at("api-threads").as<uint32_t>() > 0 )
+   {
+      my->_api_thread_pool.reset( new graphene::utilities::thread_pool( options.at("api-threads").as<uint32_t>(), "api" ) );
+      const std::vector<uint32_t> api_cpus = my->thread_cpus( "api-cpus" );
+      if( !api_cpus.empty() )
+         my->_api_thread_pool->pin_threads( api_cpus );
+      my->_app_options.api_thread_pool = my->_api_thread_pool.get();
+   }
+
    if( options.count("create-genesis-json") )
    {
       fc::path genesis_out = options.at("create-genesis-json").as<boost::filesystem::path>();
@@ -1091,6 +1782,26 @@ std::shared_ptr<chain::database> application::chain_database() const
    return my->_chain_db;
 }
 
+const fc::path& application::data_dir() const
+{
+   return my->_data_dir;
+}
+
+void application::set_account_history_store( std::shared_ptr<chain::account_history_store> store )
+{
+   my->_account_history_store = store;
+}
+
+std::shared_ptr<chain::account_history_store> application::get_account_history_store() const
+{
+   return my->_account_history_store;
+}
+
+block_feed* application::get_block_feed() const
+{
+   return my->_block_feed.get();
+}
+
 void application::set_block_production(bool producing_blocks)
 {
    my->_is_block_producer = producing_blocks;
@@ -1133,11 +1844,15 @@ void application::shutdown()
 {
    if( my->_p2p_network )
       my->_p2p_network->close();
+   if( my->_block_feed )
+      my->_block_feed->flush();
+   my->save_object_changes();
    if( my->_chain_db )
    {
       my->_chain_db->close();
       my->_chain_db = nullptr;
    }
+   graphene::utilities::flush_async_log();
 }
 
 void application::initialize_plugins( const boost::program_options::variables_map& options )
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/app/block_feed.hpp>
+#include <graphene/utilities/cpu_affinity.hpp>
+
+#include <fc/smart_ref_impl.hpp>
+
+#include <map>
+
+namespace graphene { namespace app {
+
+const uint32_t block_feed::default_max_queued_blocks;
+
+block_feed::block_feed( uint32_t max_queued_blocks )
+   : _max_queued_blocks( std::max<uint32_t>( max_queued_blocks, 1 ) )
+{}
+
+block_feed::~block_feed()
+{
+   _applied_block_connection.disconnect();
+   flush();
+}
+
+void block_feed::subscribe( const std::string& name, const vector<std::string>& dependencies, handler_type handler )
+{
+   FC_ASSERT( !_started, "subscribers must be added before blocks are fed" );
+   for( const auto& s : _subscribers )
+      FC_ASSERT( s->name != name, "${n} is already subscribed", ("n",name) );
+   std::unique_ptr<subscriber> s( new subscriber );
+   s->name = name;
+   s->dependency_names = dependencies;
+   s->handler = std::move( handler );
+   _subscribers.push_back( std::move( s ) );
+}
+
+void block_feed::start()
+{
+   std::map<std::string,size_t> by_name;
+   for( size_t i = 0; i < _subscribers.size(); ++i )
+      by_name[ _subscribers[i]->name ] = i;
+
+   // depth first, a subscriber goes after all of its dependencies
+   vector< std::unique_ptr<subscriber> > ordered;
+   vector<int> state( _subscribers.size(), 0 ); // 0 not visited, 1 being visited, 2 done
+   std::function<void(size_t)> visit = [&]( size_t i ) {
+      if( state[i] == 2 )
+         return;
+      FC_ASSERT( state[i] == 0, "circular dependency of ${n}", ("n",_subscribers[i]->name) );
+      state[i] = 1;
+      for( const auto& dep : _subscribers[i]->dependency_names )
+      {
+         auto itr = by_name.find( dep );
+         if( itr == by_name.end() )
+            wlog( "${d}, a dependency of ${n}, doesn't run asynchronously", ("d",dep)("n",_subscribers[i]->name) );
+         else
+            visit( itr->second );
+      }
+      state[i] = 2;
+      ordered.push_back( std::move( _subscribers[i] ) );
+   };
+   for( size_t i = 0; i < _subscribers.size(); ++i )
+      visit( i );
+   _subscribers = std::move( ordered );
+
+   by_name.clear();
+   for( size_t i = 0; i < _subscribers.size(); ++i )
+   {
+      subscriber& s = *_subscribers[i];
+      for( const auto& dep : s.dependency_names )
+      {
+         auto itr = by_name.find( dep );
+         if( itr != by_name.end() )
+            s.dependencies.push_back( itr->second );
+      }
+      by_name[s.name] = i;
+      s.thread.reset( new fc::thread( s.name ) );
+      if( !_cpus.empty() && !graphene::utilities::pin_thread( *s.thread, _cpus ) )
+         wlog( "Thread ${n} can't be pinned to CPUs on this platform", ("n",s.name) );
+   }
+   _started = true;
+}
+
+void block_feed::connect( chain::database& db )
+{
+   if( !_started )
+      start();
+   _applied_block_connection = db.applied_block.connect( [this,&db]( const signed_block& b ) {
+      push( collect_changes( db, b ) );
+   } );
+}
+
+applied_block_changes_ptr block_feed::collect_changes( const chain::database& db, const signed_block& b )const
+{
+   std::shared_ptr<applied_block_changes> changes = std::make_shared<applied_block_changes>();
+   changes->block = b;
+   changes->block_num = b.block_num();
+   changes->last_irreversible_block_num = db.get_dynamic_global_properties().last_irreversible_block_num;
+   changes->applied_operations = db.share_applied_operations();
+   changes->impacted_accounts = db.share_applied_operations_impacted_accounts();
+   if( db._undo_db.enabled() && db._undo_db.size() > 0 )
+   {
+      const auto& head_undo = db._undo_db.head();
+      changes->new_ids.assign( head_undo.new_ids.begin(), head_undo.new_ids.end() );
+      const vector<object_id_type> appended_ids = db._undo_db.appended_ids( head_undo );
+      changes->new_ids.insert( changes->new_ids.end(), appended_ids.begin(), appended_ids.end() );
+      changes->changed_ids.reserve( head_undo.old_values.size() + head_undo.old_deltas.size() );
+      for( const auto& item : head_undo.old_values )
+         changes->changed_ids.push_back( item.first );
+      for( const auto& item : head_undo.old_deltas )
+         changes->changed_ids.push_back( item.first );
+      changes->removed_ids.reserve( head_undo.removed.size() );
+      for( const auto& item : head_undo.removed )
+         changes->removed_ids.push_back( item.first );
+   }
+   return changes;
+}
+
+void block_feed::push( const applied_block_changes_ptr& changes )
+{
+   if( !_started )
+      start();
+   vector< std::shared_future<void> > done( _subscribers.size() );
+   for( size_t i = 0; i < _subscribers.size(); ++i )
+   {
+      subscriber& s = *_subscribers[i];
+      while( !s.queued.empty() && s.queued.front().wait_for( std::chrono::seconds(0) ) == std::future_status::ready )
+         s.queued.pop_front();
+      // back-pressure, the chain thread is blocked until the subscriber catches up
+      if( s.queued.size() >= _max_queued_blocks )
+      {
+         s.queued.front().wait();
+         s.queued.pop_front();
+      }
+
+      vector< std::shared_future<void> > dependencies;
+      for( size_t d : s.dependencies )
+         dependencies.push_back( done[d] );
+      std::shared_ptr< std::promise<void> > finished = std::make_shared< std::promise<void> >();
+      done[i] = finished->get_future().share();
+      s.queued.push_back( done[i] );
+
+      subscriber* sp = &s;
+      s.thread->async( [sp,changes,dependencies,finished]() {
+         for( const auto& d : dependencies )
+            d.wait();
+         try {
+            sp->handler( *changes );
+         } catch( const fc::exception& e ) {
+            elog( "${n} failed to process block ${b}: ${e}",
+                  ("n",sp->name)("b",changes->block_num)("e",e.to_detail_string()) );
+         } catch( const std::exception& e ) {
+            elog( "${n} failed to process block ${b}: ${e}", ("n",sp->name)("b",changes->block_num)("e",e.what()) );
+         }
+         finished->set_value();
+      }, "block_feed" );
+   }
+}
+
+void block_feed::flush()
+{
+   for( const auto& s : _subscribers )
+   {
+      for( const auto& f : s->queued )
+         f.wait();
+      s->queued.clear();
+   }
+}
+
+} } // graphene::app
@@ -25,18 +25,27 @@
 #include <graphene/app/database_api.hpp>
 #include <graphene/app/util.hpp>
 #include <graphene/chain/get_config.hpp>
+#include <graphene/chain/object_counts.hpp>
+#include <graphene/chain/order_book_index.hpp>
+#include <graphene/chain/post_feed_index.hpp>
 #include <graphene/utilities/string_escape.hpp>
+#include <graphene/utilities/thread_pool.hpp>
 
-#include <fc/bloom_filter.hpp>
 #include <fc/smart_ref_impl.hpp>
 
 #include <fc/crypto/hex.hpp>
+#include <fc/io/json.hpp>
+#include <fc/thread/mutex.hpp>
+#include <fc/thread/scoped_lock.hpp>
 
+#include <boost/iterator/transform_iterator.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <boost/rational.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
+#include <boost/thread/locks.hpp>
 
 #include <cctype>
+#include <mutex>
 
 #include <cfenv>
 #include <iostream>
@@ -58,6 +67,165 @@ signed_block_with_info::signed_block_with_info( const signed_block& block )
 }
 
 
+class database_api_impl;
+
+/**
+ * @brief the object subscriptions of all database_api sessions of one database
+ *
+ * Subscribed object ids and accounts are mapped to the sessions interested in them, so the changes of a block only
+ * visit the sessions which care about them, and every changed object is converted to a variant once and shared by
+ * all of them.
+ */
+class subscription_registry
+{
+   public:
+      explicit subscription_registry( graphene::chain::database& db ):_db(db){}
+
+      /// the registry shared by all sessions of @p db, created on first use
+      static std::shared_ptr<subscription_registry> get( graphene::chain::database& db );
+
+      void add_session( database_api_impl* session, bool notify_remove_create );
+      void remove_session( database_api_impl* session,
+                           const std::unordered_set<object_id_type>& objects,
+                           const std::set<account_uid_type>& accounts );
+      void add_object( database_api_impl* session, object_id_type id );
+      void add_account( database_api_impl* session, account_uid_type uid );
+
+   private:
+      typedef std::unordered_set<database_api_impl*> session_set;
+
+      void on_block_objects_changed( const object_change_log& changes );
+      void dispatch( bool notify_remove_create, bool full_object, const vector<object_id_type>& ids,
+                     std::function<const flat_set<account_uid_type>&()> impacted_accounts,
+                     std::function<const object*(object_id_type id)> find_object );
+
+      graphene::chain::database&                         _db;
+      /// sessions with a subscribe callback, mapped to whether they want all created and removed objects
+      std::unordered_map<database_api_impl*, bool>       _sessions;
+      std::unordered_map<object_id_type, session_set>    _object_sessions;
+      std::unordered_map<account_uid_type, session_set>  _account_sessions;
+      boost::signals2::scoped_connection                 _change_log_connection;
+};
+
+/**
+ * @brief the results of read calls for the current head block, shared by all database_api sessions of one database
+ *
+ * Wallets and explorers poll calls like the global properties, the witnesses or the top markets much more often
+ * than blocks come, and get the same result until the next block. Such a result is computed once per head block,
+ * state of the pending transactions, method and arguments, and copied out to the other callers.
+ */
+class block_result_cache
+{
+   public:
+      /// the cache shared by all sessions of @p db, created on first use
+      static std::shared_ptr<block_result_cache> get( graphene::chain::database& db );
+
+      /// the head block and database::pending_state_revision() the results are computed for
+      typedef std::pair<block_id_type, uint64_t> state_type;
+
+      /// @return the state of @p db the results of the calls made now are computed for
+      static state_type current_state( const graphene::chain::database& db )
+      {
+         return state_type( db.head_block_id(), db.pending_state_revision() );
+      }
+
+      /**
+       * @return the result of @p method with @p args computed for @p head, calling @p compute if there is none yet
+       * Everything computed for another head block or pending state is dropped first, the key is made of @p args
+       * before @p compute is called.
+       */
+      template<typename Result, typename Compute, typename... Args>
+      Result fetch( const state_type& head, Compute&& compute, const char* method, const Args&... args )
+      {
+         vector<char> key = make_key( method, args... );
+         {
+            std::lock_guard<std::mutex> guard( _mutex );
+            if( head != _head )
+            {
+               _head = head;
+               _results.clear();
+            }
+            auto itr = _results.find( key );
+            if( itr != _results.end() )
+               return *std::static_pointer_cast<const Result>( itr->second );
+         }
+         Result result = compute();
+         std::lock_guard<std::mutex> guard( _mutex );
+         // different arguments in every call would only fill memory
+         if( head == _head && _results.size() < max_results )
+            _results.emplace( std::move( key ), std::make_shared<Result>( result ) );
+         return result;
+      }
+
+   private:
+      static const size_t max_results = 1000;
+
+      template<typename... Args>
+      static vector<char> make_key( const char* method, const Args&... args )
+      {
+         const std::string name( method );
+         fc::datastream<size_t> size_stream;
+         pack_all( size_stream, name, args... );
+         vector<char> key( size_stream.tellp() );
+         fc::datastream<char*> stream( key.data(), key.size() );
+         pack_all( stream, name, args... );
+         return key;
+      }
+
+      template<typename Stream>
+      static void pack_all( Stream& ) {}
+
+      template<typename Stream, typename T, typename... Rest>
+      static void pack_all( Stream& s, const T& v, const Rest&... rest )
+      {
+         fc::raw::pack( s, v );
+         pack_all( s, rest... );
+      }
+
+      /// the API threads may fetch at the same time
+      std::mutex                                            _mutex;
+      state_type                                            _head;
+      std::map< vector<char>, std::shared_ptr<const void> > _results;
+};
+
+/**
+ * @brief the depth subscriptions of all database_api sessions of one database
+ *
+ * The levels changed by a block are taken from the order book index once and handed to every session subscribed
+ * to their market. The updates of each market are numbered, so that a client can tell which ones a snapshot
+ * already includes and whether it missed any.
+ */
+class market_depth_feed
+{
+   public:
+      typedef std::pair<asset_aid_type, asset_aid_type> market_type;
+
+      explicit market_depth_feed( graphene::chain::database& db ):_db(db){}
+
+      /// the feed shared by all sessions of @p db, created on first use
+      static std::shared_ptr<market_depth_feed> get( graphene::chain::database& db );
+
+      /// @p market has the smaller asset first
+      void add_session( database_api_impl* session, const market_type& market );
+      void remove_session( database_api_impl* session, const market_type& market );
+
+      /// the number of the last update of @p market, only read and changed while holding the state
+      uint64_t sequence( const market_type& market )const
+      {
+         auto itr = _sequences.find( market );
+         return itr != _sequences.end() ? itr->second : 0;
+      }
+
+   private:
+      const limit_order_book_index& book()const;
+      void on_applied_block( const signed_block& b );
+
+      graphene::chain::database&                                       _db;
+      std::map< market_type, std::unordered_set<database_api_impl*> >  _sessions;
+      std::map< market_type, uint64_t >                                _sequences;
+      boost::signals2::scoped_connection                               _applied_block_connection;
+};
+
 class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 {
    public:
@@ -66,6 +234,10 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 
       // Objects
       fc::variants get_objects(const vector<object_id_type>& ids)const;
+      fc::variants get_objects_at_block(const vector<object_id_type>& ids, uint32_t block_num)const;
+      object_changes_page get_object_changes(uint64_t from_sequence, uint32_t limit)const;
+      object_page list_objects_page(const string& list, const fc::variants& args, const string& cursor,
+                                    uint32_t limit, const vector<string>& fields)const;
 
       // Subscriptions
       void set_subscribe_callback( std::function<void(const variant&)> cb, bool notify_remove_create );
@@ -86,8 +258,20 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       chain_id_type get_chain_id()const;
       dynamic_global_property_object get_dynamic_global_properties()const;
 
+      // Profiling
+      vector<operation_profile> get_evaluation_profile()const;
+      vector<block_profile> get_block_profiles( uint32_t limit )const;
+      vector<witness_slot_timing> get_witness_slot_timings()const;
+      undo_database_stats get_undo_database_stats()const;
+      fork_switch_stats get_fork_switch_stats()const;
+      pending_transaction_stats get_pending_transaction_stats()const;
+      vector<api_call_profile> get_api_call_profile()const;
+
       // Keys
       vector<vector<account_uid_type>> get_key_references( vector<public_key_type> key )const;
+      flat_set<account_uid_type> get_key_account_uids( const vector<public_key_type>& keys )const;
+      /// the accounts referring to each key, see account_member_index
+      const graphene::chain::account_member_index::key_memberships_type& get_key_memberships()const;
       bool is_public_key_registered(string public_key) const;
 
       // Accounts
@@ -96,6 +280,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       std::map<string,full_account> get_full_accounts( const vector<string>& names_or_ids, bool subscribe );
       std::map<account_uid_type,full_account> get_full_accounts_by_uid( const vector<account_uid_type>& uids,
                                                                         const full_account_query_options& options );
+      std::map<account_uid_type,fc::variant_object> get_full_account_sections( const vector<account_uid_type>& uids,
+                                                                               const full_account_query_options& options );
       vector<pledge_balance_object> get_account_core_asset_pledge(account_uid_type account_uid)const;
       account_statistics_object get_account_statistics_by_uid(account_uid_type uid)const;
       optional<account_object> get_account_by_name( string name )const;
@@ -137,6 +323,7 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
                                                uint32_t limit,
                                                data_sorting_type order_by )const;
       uint64_t get_platform_count()const;
+      vector<platform_vote_profit_object> get_platform_vote_profits( account_uid_type platform )const;
       optional<post_object> get_post( const account_uid_type platform_owner,
                                       const account_uid_type poster_uid,
                                       const post_pid_type post_pid )const;
@@ -159,6 +346,10 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
                                        const object_id_type   lower_bound_score,
                                        const uint32_t         limit,
                                        const bool             list_cur_period)const;
+      post_score_totals get_post_score_totals(const account_uid_type platform,
+                                              const account_uid_type poster_uid,
+                                              const post_pid_type    post_pid,
+                                              const bool             cur_period)const;
 
       optional<license_object> get_license(const account_uid_type platform,
                                            const license_lid_type license_lid)const;
@@ -196,6 +387,9 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
                                                                         const uint32_t         lower_bound_index,
                                                                         uint32_t               limit)const;
 
+      vector<active_post_receiptor_object> list_active_post_receiptors(const active_post_id_type active_post,
+                                                                       const account_uid_type lower_bound_receiptor,
+                                                                       uint32_t limit)const;
       vector<Poster_Period_Profit_Detail> get_poster_profits_detail(const uint32_t         begin_period,
                                                                     const uint32_t         end_period,
                                                                     const account_uid_type poster,
@@ -229,6 +423,9 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 
       void subscribe_to_market(std::function<void(const variant&)> callback, const std::string& a, const std::string& b);
       void unsubscribe_from_market(const std::string& a, const std::string& b);
+      market_depth get_market_depth(const string& base, const string& quote, uint32_t limit)const;
+      void subscribe_to_market_depth(std::function<void(const variant&)> callback, const std::string& base, const std::string& quote);
+      void unsubscribe_from_market_depth(const std::string& base, const std::string& quote);
 
       market_ticker                      get_ticker(const string& base, const string& quote, bool skip_order_book = false)const;
       market_volume                      get_24_volume(const string& base, const string& quote)const;
@@ -261,6 +458,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       processed_transaction validate_transaction( const signed_transaction& trx )const;
       vector< fc::variant > get_required_fees( const vector<operation>& ops, asset_id_type id )const;
       vector< required_fee_data > get_required_fee_data( const vector<operation>& ops )const;
+      vector<transaction_requirements> get_transaction_requirements( const vector<signed_transaction>& trxs,
+                                                                     const flat_set<public_key_type>& available_keys )const;
 
       // Proposed transactions
       vector<proposal_object> get_proposed_transactions( account_uid_type uid )const;
@@ -268,36 +467,25 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
    //private:
       static string price_to_string(const price& _price, const asset_object& _base, const asset_object& _quote);
 
-      template<typename T>
-      void subscribe_to_item( const T& i )const
+      /// the bloom filter this replaced was sized for this many items, keep memory per session bounded the same way
+      static const size_t max_subscribed_objects = 10000;
+
+      void subscribe_to_item( object_id_type id )const
       {
-         auto vec = fc::raw::pack(i);
-         if( !_subscribe_callback )
+         if( !_subscribe_callback || _subscribed_objects.size() >= max_subscribed_objects )
             return;
 
-         if( !is_subscribed_to_item(i) )
-         {
-            _subscribe_filter.insert( vec.data(), vec.size() );
-         }
+         if( _subscribed_objects.insert( id ).second )
+            _subscriptions->add_object( const_cast<database_api_impl*>( this ), id );
       }
 
-      template<typename T>
-      bool is_subscribed_to_item( const T& i )const
+      void subscribe_to_account( account_uid_type uid )
       {
          if( !_subscribe_callback )
-            return false;
-
-         return _subscribe_filter.contains( i );
-      }
-
-      bool is_impacted_account( const flat_set<account_uid_type>& accounts)
-      {
-         if( !_subscribed_accounts.size() || !accounts.size() )
-            return false;
+            return;
 
-         return std::any_of(accounts.begin(), accounts.end(), [this](const account_uid_type& account) {
-            return _subscribed_accounts.find(account) != _subscribed_accounts.end();
-         });
+         if( _subscribed_accounts.insert( uid ).second )
+            _subscriptions->add_account( this, uid );
       }
 
       const account_object* get_account_from_string(const std::string& name_or_id) const
@@ -309,10 +497,7 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
             account = _db.find_account_by_uid(fc::variant(name_or_id).as<account_uid_type>(1));
          else
          {
-            const auto& idx = _db.get_index_type<account_index>().indices().get<by_name>();
-            auto itr = idx.find(name_or_id);
-            if (itr != idx.end())
-               account = &*itr;
+            account = _db.find_account_by_name(name_or_id);
          }
          FC_ASSERT(account, "no such account");
          return account;
@@ -377,30 +562,81 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
           return result;
       }
 
-      void broadcast_updates( const vector<variant>& updates );
-      void handle_object_changed(bool force_notify, bool full_object, const vector<object_id_type>& ids, const flat_set<account_uid_type>& impacted_accounts, std::function<const object*(object_id_type id)> find_object);
+      /**
+       * Runs @p read on one of the API threads when there are any, holding the state shared so that no block or
+       * transaction is applied meanwhile, and right here otherwise. Only for calls which neither change the session
+       * nor read the block files.
+       *
+       * A session runs one call at a time on the API threads, the others wait in order, so a client sending many
+       * expensive calls delays its own calls, not the calls of the other sessions. The calls are recorded by
+       * @p method in the api_call_profiler of the application, and charged to the api_call_budget of the session,
+       * which rejects them once it's used up.
+       */
+      template<typename Read>
+      auto read_state( const char* method, Read&& read )const -> decltype( read() )
+      {
+         typedef decltype( read() ) result_type;
+         _budget.admit( method );
+         api_call_timer timer( _app_options ? _app_options->api_calls : nullptr, method );
+         // charged whether the call succeeds or not
+         auto charge = [this,&timer]() { _budget.charge( timer.run_time() ); };
+         graphene::utilities::thread_pool* pool = _app_options ? _app_options->api_thread_pool : nullptr;
+         try
+         {
+            if( pool == nullptr || pool->size() == 0 )
+            {
+               result_type result = read();
+               timer.done();
+               charge();
+               return result;
+            }
+            fc::scoped_lock<fc::mutex> session_lock( _api_call_mutex );
+            result_type result = pool->get_thread( _next_api_thread++ ).async( [this,&read,&timer]() -> result_type {
+               boost::shared_lock<boost::shared_mutex> lock( _db.state_mutex() );
+               timer.started();
+               return read();
+            }, "api_read" ).wait();
+            timer.done();
+            charge();
+            return result;
+         }
+         catch( ... )
+         {
+            charge();
+            throw;
+         }
+      }
 
-      /** called every time a block is applied to report the objects that were changed */
-      void on_objects_new(const vector<object_id_type>& ids, const flat_set<account_uid_type>& impacted_accounts);
-      void on_objects_changed(const vector<object_id_type>& ids, const flat_set<account_uid_type>& impacted_accounts);
-      void on_objects_removed(const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_uid_type>& impacted_accounts);
+      /** called by the subscription_registry with the objects of an applied block this session is subscribed to */
+      void broadcast_updates( const vector<variant>& updates );
       void on_applied_block();
+      /** called by the market_depth_feed with the levels of a subscribed market changed by a block */
+      void broadcast_depth_update( const market_depth_feed::market_type& market, uint64_t sequence,
+                                   const vector<limit_order_book_index::level_type>& levels );
 
       bool _notify_remove_create = false;
-      mutable fc::bloom_filter _subscribe_filter;
+      mutable std::unordered_set<object_id_type> _subscribed_objects;
       std::set<account_uid_type> _subscribed_accounts;
+      std::shared_ptr<subscription_registry> _subscriptions;
+      std::shared_ptr<block_result_cache> _block_results;
+      std::shared_ptr<market_depth_feed> _depth_feed;
       std::function<void(const fc::variant&)> _subscribe_callback;
       std::function<void(const fc::variant&)> _pending_trx_callback;
       std::function<void(const fc::variant&)> _block_applied_callback;
 
-      boost::signals2::scoped_connection                                                   _new_connection;
-      boost::signals2::scoped_connection                                                   _change_connection;
-      boost::signals2::scoped_connection                                                   _removed_connection;
       boost::signals2::scoped_connection                                                   _applied_block_connection;
       boost::signals2::scoped_connection                                                   _pending_trx_connection;
       map< pair<asset_aid_type, asset_aid_type>, std::function<void(const variant&)> >     _market_subscriptions;
+      /// by market with the smaller asset first, the base asset the session asked for and its callback
+      map< pair<asset_aid_type, asset_aid_type>,
+           pair< asset_aid_type, std::function<void(const variant&)> > >                   _market_depth_subscriptions;
       graphene::chain::database&                                                           _db;
       const application_options* _app_options = nullptr;
+      mutable uint32_t _next_api_thread = 0;
+      /// held by the call of the session running on the API threads
+      mutable fc::mutex _api_call_mutex;
+      /// the API thread time left to the session
+      mutable api_call_budget _budget;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -415,18 +651,11 @@ database_api::database_api(graphene::chain::database& db, const application_opti
 database_api::~database_api() {}
 
 database_api_impl::database_api_impl(graphene::chain::database& db, const application_options* app_options) 
-   : _db(db), _app_options(app_options)
+   : _subscriptions(subscription_registry::get(db)), _block_results(block_result_cache::get(db)),
+     _depth_feed(market_depth_feed::get(db)), _db(db), _app_options(app_options),
+     _budget( app_options ? app_options->api_budget_us_per_second : 0, app_options ? app_options->api_budget_burst_us : 0 )
 {
    wlog("creating database api ${x}", ("x",int64_t(this)) );
-   _new_connection = _db.new_objects.connect([this](const vector<object_id_type>& ids, const flat_set<account_uid_type>& impacted_accounts) {
-                                on_objects_new(ids, impacted_accounts);
-                                });
-   _change_connection = _db.changed_objects.connect([this](const vector<object_id_type>& ids, const flat_set<account_uid_type>& impacted_accounts) {
-                                on_objects_changed(ids, impacted_accounts);
-                                });
-   _removed_connection = _db.removed_objects.connect([this](const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_uid_type>& impacted_accounts) {
-                                on_objects_removed(ids, objs, impacted_accounts);
-                                });
    _applied_block_connection = _db.applied_block.connect([this](const signed_block&){ on_applied_block(); });
 
    _pending_trx_connection = _db.on_pending_transaction.connect([this](const signed_transaction& trx ){
@@ -437,6 +666,9 @@ database_api_impl::database_api_impl(graphene::chain::database& db, const applic
 database_api_impl::~database_api_impl()
 {
    elog("freeing database api ${x}", ("x",int64_t(this)) );
+   _subscriptions->remove_session( this, _subscribed_objects, _subscribed_accounts );
+   for( const auto& item : _market_depth_subscriptions )
+      _depth_feed->remove_session( this, item.first );
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -515,6 +747,18 @@ fc::variants database_api::get_objects(const vector<object_id_type>& ids)const
    return my->get_objects( ids );
 }
 
+namespace {
+
+/// the variant of @p obj returned by the API, a post with the content kept in the post content store
+fc::variant api_object_variant( const database& db, const object& obj )
+{
+   if( obj.id.space() == post_object::space_id && obj.id.type() == post_object::type_id )
+      return fc::variant( db.with_post_content( static_cast<const post_object&>( obj ) ), GRAPHENE_MAX_NESTED_OBJECTS );
+   return obj.to_variant();
+}
+
+}
+
 fc::variants database_api_impl::get_objects(const vector<object_id_type>& ids)const
 {
    if( _subscribe_callback )  {
@@ -533,13 +777,238 @@ fc::variants database_api_impl::get_objects(const vector<object_id_type>& ids)co
    std::transform(ids.begin(), ids.end(), std::back_inserter(result),
                   [this](object_id_type id) -> fc::variant {
       if(auto obj = _db.find_object(id))
-         return obj->to_variant();
+         return api_object_variant( _db, *obj );
       return {};
    });
 
    return result;
 }
 
+fc::variants database_api::get_objects_at_block(const vector<object_id_type>& ids, uint32_t block_num)const
+{
+   return my->read_state( __func__, [&]() { return my->get_objects_at_block( ids, block_num ); } );
+}
+
+fc::variants database_api_impl::get_objects_at_block(const vector<object_id_type>& ids, uint32_t block_num)const
+{
+   FC_ASSERT( ids.size() <= 100 );
+   fc::variants result;
+   result.reserve(ids.size());
+   for( const object_id_type& id : ids )
+   {
+      unique_ptr<object> obj = _db.find_object_at_block( id, block_num );
+      result.push_back( obj ? api_object_variant( _db, *obj ) : fc::variant() );
+   }
+   return result;
+}
+
+object_changes_page database_api::get_object_changes(uint64_t from_sequence, uint32_t limit)const
+{
+   return my->get_object_changes( from_sequence, limit );
+}
+
+object_changes_page database_api_impl::get_object_changes(uint64_t from_sequence, uint32_t limit)const
+{
+   FC_ASSERT( limit <= 1000 );
+   FC_ASSERT( _app_options && _app_options->object_changes, "The object change log is disabled on this node" );
+   return _app_options->object_changes->get_changes( from_sequence, limit );
+}
+
+namespace {
+
+/// where the next page of a list starts, see database_api::list_objects_page()
+struct object_page_cursor
+{
+   string           list;
+   /// of the arguments of the list, to reject a cursor given with other arguments
+   fc::ripemd160    args_digest;
+   object_id_type   next_id;
+};
+
+template<typename Stream>
+void pack_page_cursor( Stream& s, const object_page_cursor& cursor )
+{
+   fc::raw::pack( s, cursor.list );
+   fc::raw::pack( s, cursor.args_digest );
+   fc::raw::pack( s, cursor.next_id );
+}
+
+string encode_page_cursor( const object_page_cursor& cursor )
+{
+   fc::datastream<size_t> size_stream;
+   pack_page_cursor( size_stream, cursor );
+   vector<char> data( size_stream.tellp() );
+   fc::datastream<char*> stream( data.data(), data.size() );
+   pack_page_cursor( stream, cursor );
+   return fc::to_hex( data.data(), data.size() );
+}
+
+object_page_cursor decode_page_cursor( const string& encoded )
+{ try {
+   FC_ASSERT( encoded.size() % 2 == 0 );
+   vector<char> data( encoded.size() / 2 );
+   FC_ASSERT( fc::from_hex( encoded, data.data(), data.size() ) == data.size() );
+   fc::datastream<const char*> stream( data.data(), data.size() );
+   object_page_cursor cursor;
+   fc::raw::unpack( stream, cursor.list );
+   fc::raw::unpack( stream, cursor.args_digest );
+   fc::raw::unpack( stream, cursor.next_id );
+   return cursor;
+} FC_RETHROW_EXCEPTIONS( error, "Invalid cursor ${c}", ("c",encoded) ) }
+
+/// @return @p value with only the @p fields it has, all of them if there are none
+fc::variant project_fields( const fc::variant& value, const vector<string>& fields )
+{
+   if( fields.empty() )
+      return value;
+   const fc::variant_object& obj = value.get_object();
+   fc::mutable_variant_object result;
+   for( const string& field : fields )
+   {
+      auto itr = obj.find( field );
+      if( itr != obj.end() )
+         result( field, itr->value() );
+   }
+   return fc::variant( result );
+}
+
+/// the post of an entry of the post feed, to page through the feed like through an index of the posts
+struct post_feed_post
+{
+   typedef const post_object& result_type;
+   const post_object& operator()( const post_feed_index::entry& e )const { return *e.post; }
+};
+
+/// adds the objects from @p itr on which are still in the list to @p page, and the cursor of the one following them
+template<typename Itr, typename InList>
+void fill_page( const database& db, object_page& page, object_page_cursor& position, Itr itr, Itr end, InList in_list,
+                uint32_t limit, const vector<string>& fields )
+{
+   for( ; itr != end && in_list( *itr ); ++itr )
+   {
+      if( page.objects.size() == limit )
+      {
+         position.next_id = itr->id;
+         page.next_cursor = encode_page_cursor( position );
+         return;
+      }
+      page.objects.push_back( project_fields( api_object_variant( db, *itr ), fields ) );
+   }
+}
+
+}
+
+object_page database_api::list_objects_page(const string& list, const fc::variants& args, const string& cursor,
+                                            uint32_t limit, const vector<string>& fields)const
+{
+   return my->read_state( __func__, [&]() { return my->list_objects_page( list, args, cursor, limit, fields ); } );
+}
+
+object_page database_api_impl::list_objects_page(const string& list, const fc::variants& args, const string& cursor,
+                                                 uint32_t limit, const vector<string>& fields)const
+{
+   FC_ASSERT( limit <= 100 );
+   object_page_cursor position;
+   position.list = list;
+   position.args_digest = fc::ripemd160::hash( fc::json::to_string( fc::variant( args ) ) );
+   const bool first_page = cursor.empty();
+   if( !first_page )
+   {
+      const object_page_cursor previous = decode_page_cursor( cursor );
+      FC_ASSERT( previous.list == list && previous.args_digest == position.args_digest,
+                 "The cursor is one of another list or of other arguments" );
+      position.next_id = previous.next_id;
+   }
+   auto arg = [&args]( size_t i ) -> uint64_t {
+      FC_ASSERT( i < args.size(), "Missing argument ${i} of the list", ("i",i) );
+      return args[i].as_uint64();
+   };
+
+   object_page page;
+   page.head_block_num = _db.head_block_num();
+   const object_id_type& next_id = position.next_id;
+   if( list == "posts_by_platform" )
+   {
+      const account_uid_type platform = arg( 0 );
+      const auto& idx = _db.get_index_type<post_index>().indices().get<by_platform_id>();
+      auto itr = first_page ? idx.lower_bound( std::make_tuple( platform ) )
+                            : idx.lower_bound( std::make_tuple( platform, next_id ) );
+      fill_page( _db, page, position, itr, idx.end(),
+                 [platform]( const post_object& p ) { return p.platform == platform; }, limit, fields );
+   }
+   else if( list == "posts_by_platform_poster" )
+   {
+      const account_uid_type platform = arg( 0 );
+      const account_uid_type poster = arg( 1 );
+      const auto& idx = _db.get_index_type<post_index>().indices().get<by_platform_poster>();
+      auto itr = first_page ? idx.lower_bound( std::make_tuple( platform, poster ) )
+                            : idx.lower_bound( std::make_tuple( platform, poster, next_id ) );
+      fill_page( _db, page, position, itr, idx.end(),
+                 [platform,poster]( const post_object& p ) { return p.platform == platform && p.poster == poster; },
+                 limit, fields );
+   }
+   else if( list == "scores" )
+   {
+      const account_uid_type platform = arg( 0 );
+      const account_uid_type poster = arg( 1 );
+      const post_pid_type post_pid = arg( 2 );
+      const auto& idx = _db.get_index_type<score_index>().indices().get<by_posts_pids>();
+      auto itr = first_page ? idx.lower_bound( std::make_tuple( platform, poster, post_pid ) )
+                            : idx.lower_bound( std::make_tuple( platform, poster, post_pid, next_id ) );
+      fill_page( _db, page, position, itr, idx.end(), [platform,poster,post_pid]( const score_object& s ) {
+                    return s.platform == platform && s.poster == poster && s.post_pid == post_pid;
+                 }, limit, fields );
+   }
+   else if( list == "licenses" )
+   {
+      const account_uid_type platform = arg( 0 );
+      const auto& idx = _db.get_index_type<license_index>().indices().get<by_platform>();
+      auto itr = first_page ? idx.lower_bound( std::make_tuple( platform ) )
+                            : idx.lower_bound( std::make_tuple( platform, next_id ) );
+      fill_page( _db, page, position, itr, idx.end(),
+                 [platform]( const license_object& l ) { return l.platform == platform; }, limit, fields );
+   }
+   else if( list == "advertising_orders_by_purchaser" )
+   {
+      const account_uid_type purchaser = arg( 0 );
+      const auto& idx = _db.get_index_type<advertising_order_index>().indices().get<by_advertising_user_id>();
+      auto itr = first_page ? idx.lower_bound( std::make_tuple( purchaser ) )
+                            : idx.lower_bound( std::make_tuple( purchaser, next_id ) );
+      fill_page( _db, page, position, itr, idx.end(),
+                 [purchaser]( const advertising_order_object& o ) { return o.user == purchaser; }, limit, fields );
+   }
+   else if( list == "post_feed" )
+   {
+      const account_uid_type platform = arg( 0 );
+      const auto& posts = dynamic_cast<const primary_index<post_index>&>( _db.get_index_type<post_index>() );
+      const post_feed_index* feed = posts.find_secondary_index<post_feed_index>();
+      FC_ASSERT( feed != nullptr, "The post feed is not kept on this node, it needs the post_feed non-consensus index" );
+      auto itr = feed->lower_bound( platform );
+      if( !first_page )
+      {
+         const auto& by_id_idx = posts.indices().get<by_id>();
+         auto next = by_id_idx.find( next_id );
+         FC_ASSERT( next != by_id_idx.end(), "The post of the cursor is gone" );
+         itr = feed->lower_bound( platform, next->create_time, next_id );
+      }
+      fill_page( _db, page, position, boost::make_transform_iterator( itr, post_feed_post() ),
+                 boost::make_transform_iterator( feed->end(), post_feed_post() ),
+                 [platform]( const post_object& p ) { return p.platform == platform; }, limit, fields );
+   }
+   else if( list == "cast_custom_votes_by_voter" )
+   {
+      const account_uid_type voter = arg( 0 );
+      const auto& idx = _db.get_index_type<cast_custom_vote_index>().indices().get<by_cast_custom_vote_id>();
+      auto itr = first_page ? idx.lower_bound( std::make_tuple( voter ) )
+                            : idx.lower_bound( std::make_tuple( voter, next_id ) );
+      fill_page( _db, page, position, itr, idx.end(),
+                 [voter]( const cast_custom_vote_object& v ) { return v.voter == voter; }, limit, fields );
+   }
+   else
+      FC_THROW( "Unknown list ${l}", ("l",list) );
+   return page;
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Subscriptions                                                    //
@@ -554,16 +1023,14 @@ void database_api::set_subscribe_callback( std::function<void(const variant&)> c
 void database_api_impl::set_subscribe_callback( std::function<void(const variant&)> cb, bool notify_remove_create )
 {
    //edump((clear_filter));
-   _subscribe_callback = cb;
-   _notify_remove_create = notify_remove_create;
+   _subscriptions->remove_session( this, _subscribed_objects, _subscribed_accounts );
+   _subscribed_objects.clear();
    _subscribed_accounts.clear();
 
-   static fc::bloom_parameters param;
-   param.projected_element_count    = 10000;
-   param.false_positive_probability = 1.0/100;
-   param.maximum_size = 1024*8*8*2;
-   param.compute_optimal_parameters();
-   _subscribe_filter = fc::bloom_filter(param);
+   _subscribe_callback = cb;
+   _notify_remove_create = notify_remove_create;
+   if( _subscribe_callback )
+      _subscriptions->add_session( this, notify_remove_create );
 }
 
 void database_api::set_pending_transaction_callback( std::function<void(const variant&)> cb )
@@ -670,7 +1137,7 @@ processed_transaction database_api_impl::get_transaction(uint32_t block_num, uin
 
 chain_property_object database_api::get_chain_properties()const
 {
-   return my->get_chain_properties();
+   return my->read_state( __func__, [&]() { return my->get_chain_properties(); } );
 }
 
 chain_property_object database_api_impl::get_chain_properties()const
@@ -680,12 +1147,14 @@ chain_property_object database_api_impl::get_chain_properties()const
 
 global_property_object database_api::get_global_properties()const
 {
-   return my->get_global_properties();
+   return my->read_state( __func__, [&]() { return my->get_global_properties(); } );
 }
 
 global_property_object database_api_impl::get_global_properties()const
 {
-   return _db.get(global_property_id_type());
+   return _block_results->fetch<global_property_object>( block_result_cache::current_state( _db ), [this]() {
+      return _db.get(global_property_id_type());
+   }, "get_global_properties" );
 }
 
 fc::variant_object database_api::get_config()const
@@ -710,12 +1179,97 @@ chain_id_type database_api_impl::get_chain_id()const
 
 dynamic_global_property_object database_api::get_dynamic_global_properties()const
 {
-   return my->get_dynamic_global_properties();
+   return my->read_state( __func__, [&]() { return my->get_dynamic_global_properties(); } );
 }
 
 dynamic_global_property_object database_api_impl::get_dynamic_global_properties()const
 {
-   return _db.get(dynamic_global_property_id_type());
+   return _block_results->fetch<dynamic_global_property_object>( block_result_cache::current_state( _db ), [this]() {
+      return _db.get(dynamic_global_property_id_type());
+   }, "get_dynamic_global_properties" );
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+// Profiling                                                        //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+vector<operation_profile> database_api::get_evaluation_profile()const
+{
+   return my->get_evaluation_profile();
+}
+
+vector<operation_profile> database_api_impl::get_evaluation_profile()const
+{
+   // the profiler is locked internally
+   return _db.get_evaluation_profiler().get_profiles();
+}
+
+vector<block_profile> database_api::get_block_profiles( uint32_t limit )const
+{
+   return my->get_block_profiles( limit );
+}
+
+vector<block_profile> database_api_impl::get_block_profiles( uint32_t limit )const
+{
+   FC_ASSERT( limit <= 1000 );
+   // the profiler is locked internally
+   return _db.get_block_profiler().get_recent( limit );
+}
+
+vector<witness_slot_timing> database_api::get_witness_slot_timings()const
+{
+   return my->get_witness_slot_timings();
+}
+
+vector<witness_slot_timing> database_api_impl::get_witness_slot_timings()const
+{
+   // the tracker is locked internally
+   return _db.get_slot_timings().get_timings();
+}
+
+undo_database_stats database_api::get_undo_database_stats()const
+{
+   return my->read_state( __func__, [&]() { return my->get_undo_database_stats(); } );
+}
+
+undo_database_stats database_api_impl::get_undo_database_stats()const
+{
+   return _db.get_undo_database_stats();
+}
+
+fork_switch_stats database_api::get_fork_switch_stats()const
+{
+   return my->read_state( __func__, [&]() { return my->get_fork_switch_stats(); } );
+}
+
+fork_switch_stats database_api_impl::get_fork_switch_stats()const
+{
+   return _db.get_fork_switch_stats();
+}
+
+pending_transaction_stats database_api::get_pending_transaction_stats()const
+{
+   return my->read_state( __func__, [&]() { return my->get_pending_transaction_stats(); } );
+}
+
+pending_transaction_stats database_api_impl::get_pending_transaction_stats()const
+{
+   return _db.get_pending_transaction_stats();
+}
+
+vector<api_call_profile> database_api::get_api_call_profile()const
+{
+   return my->get_api_call_profile();
+}
+
+vector<api_call_profile> database_api_impl::get_api_call_profile()const
+{
+   // the profiler is locked internally
+   if( _app_options == nullptr || _app_options->api_calls == nullptr )
+      return {};
+   return _app_options->api_calls->get_profiles();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -726,7 +1280,7 @@ dynamic_global_property_object database_api_impl::get_dynamic_global_properties(
 
 vector<vector<account_uid_type>> database_api::get_key_references( vector<public_key_type> key )const
 {
-   return my->get_key_references( key );
+   return my->read_state( __func__, [&]() { return my->get_key_references( key ); } );
 }
 
 /**
@@ -738,20 +1292,16 @@ vector<vector<account_uid_type>> database_api_impl::get_key_references( vector<p
    FC_ASSERT(keys.size() <= api_limit_get_key_references);
 
    wdump( (keys) );
+   const auto& refs = get_key_memberships();
    vector< vector<account_uid_type> > final_result;
    final_result.reserve(keys.size());
 
    for( auto& key : keys )
    {
-      subscribe_to_item( key );
-
-      const auto& idx = _db.get_index_type<account_index>();
-      const auto& aidx = dynamic_cast<const primary_index<account_index>&>(idx);
-      const auto& refs = aidx.get_secondary_index<graphene::chain::account_member_index>();
-      auto itr = refs.account_to_key_memberships.find(key);
+      auto itr = refs.find(key);
       vector<account_uid_type> result;
 
-      if( itr != refs.account_to_key_memberships.end() )
+      if( itr != refs.end() )
       {
          result.reserve( itr->second.size() );
          for( auto item : itr->second ) result.push_back(item);
@@ -759,12 +1309,35 @@ vector<vector<account_uid_type>> database_api_impl::get_key_references( vector<p
       final_result.emplace_back( std::move(result) );
    }
 
-   for( auto i : final_result )
-      subscribe_to_item(i);
-
    return final_result;
 }
 
+flat_set<account_uid_type> database_api::get_key_account_uids( const vector<public_key_type>& keys )const
+{
+   return my->read_state( __func__, [&]() { return my->get_key_account_uids( keys ); } );
+}
+
+flat_set<account_uid_type> database_api_impl::get_key_account_uids( const vector<public_key_type>& keys )const
+{
+   FC_ASSERT( keys.size() <= _app_options->api_limit_get_key_references );
+
+   const auto& refs = get_key_memberships();
+   flat_set<account_uid_type> result;
+   for( const auto& key : keys )
+   {
+      auto itr = refs.find( key );
+      if( itr != refs.end() )
+         result.insert( itr->second.begin(), itr->second.end() );
+   }
+   return result;
+}
+
+const graphene::chain::account_member_index::key_memberships_type& database_api_impl::get_key_memberships()const
+{
+   const auto& aidx = dynamic_cast<const primary_index<account_index>&>( _db.get_index_type<account_index>() );
+   return aidx.get_secondary_index<graphene::chain::account_member_index>().account_to_key_memberships;
+}
+
 bool database_api::is_public_key_registered(string public_key) const
 {
     return my->is_public_key_registered(public_key);
@@ -862,10 +1435,7 @@ std::map<std::string, full_account> database_api_impl::get_full_accounts( const
           account = _db.find(fc::variant( account_name_or_id ).as<account_id_type>( 1 ));
       }else
       {
-          const auto& idx = _db.get_index_type<account_index>().indices().get<by_name>();
-          auto itr = idx.find(account_name_or_id);
-          if (itr != idx.end())
-             account = &*itr;
+          account = _db.find_account_by_name(account_name_or_id);
       }
 
       if (account == nullptr)
@@ -874,7 +1444,7 @@ std::map<std::string, full_account> database_api_impl::get_full_accounts( const
       if( subscribe )
       {
          FC_ASSERT( std::distance(_subscribed_accounts.begin(), _subscribed_accounts.end()) < 100 );
-         _subscribed_accounts.insert( account->uid );
+         subscribe_to_account( account->uid );
          subscribe_to_item( account->id );
       }
 
@@ -927,43 +1497,66 @@ std::map<std::string, full_account> database_api_impl::get_full_accounts( const
 std::map<account_uid_type,full_account> database_api::get_full_accounts_by_uid( const vector<account_uid_type>& uids,
                                                                                 const full_account_query_options& options )
 {
-   return my->get_full_accounts_by_uid( uids, options );
+   return my->read_state( __func__, [&]() { return my->get_full_accounts_by_uid( uids, options ); } );
 }
 
+namespace {
+
+bool is_set( const optional<bool>& option )
+{
+   return option.valid() && *option;
+}
+
+} // anonymous namespace
+
 std::map<account_uid_type,full_account> database_api_impl::get_full_accounts_by_uid( const vector<account_uid_type>& uids,
                                                                                      const full_account_query_options& options )
 {
    std::map<account_uid_type, full_account> results;
 
+   // the indexes are looked up once for all the accounts
+   const auto& witness_votes_by_voter = _db.get_index_type<witness_vote_index>().indices().get<by_voter_seq>();
+   const auto& committee_votes_by_voter = _db.get_index_type<committee_member_vote_index>().indices().get<by_voter_seq>();
+   const auto& platform_votes_by_voter = _db.get_index_type<platform_vote_index>().indices().get<by_platform_voter_seq>();
+   const auto& assets_by_issuer = _db.get_index_type<asset_index>().indices().get<by_issuer>();
+   const auto& balances_by_account = _db.get_index_type<account_balance_index>().indices().get<by_account_asset>();
+
+   const bool need_statistics = is_set( options.fetch_statistics ) || is_set( options.fetch_voter_object )
+                                || is_set( options.fetch_witness_votes ) || is_set( options.fetch_committee_member_votes )
+                                || is_set( options.fetch_platform_votes );
+
    for( const account_uid_type uid : uids )
    {
+      if( results.find( uid ) != results.end() )
+         continue;
       const account_object* account = _db.find_account_by_uid( uid );
       if (account == nullptr)
          continue;
 
-      const auto& account_stats = _db.get_account_statistics_struct_by_uid( uid );
-      full_account acnt;
-      if( options.fetch_account_object.valid() && *options.fetch_account_object == true )
+      full_account& acnt = results[uid];
+      if( is_set( options.fetch_account_object ) )
          acnt.account = *account;
-      if( options.fetch_statistics.valid() && *options.fetch_statistics == true )
+      account_statistics_object account_stats;
+      if( need_statistics )
+         account_stats = _db.get_account_statistics_struct_by_uid( uid );
+      if( is_set( options.fetch_statistics ) )
          acnt.statistics = account_stats;
-      if( options.fetch_csaf_leases_in.valid() && *options.fetch_csaf_leases_in == true )
+      if( is_set( options.fetch_csaf_leases_in ) )
          acnt.csaf_leases_in = get_csaf_leases_by_to( uid, 0, 100 );
-      if( options.fetch_csaf_leases_out.valid() && *options.fetch_csaf_leases_out == true )
+      if( is_set( options.fetch_csaf_leases_out ) )
          acnt.csaf_leases_out = get_csaf_leases_by_from( uid, 0, 100 );
-      if( options.fetch_voter_object.valid() && *options.fetch_voter_object == true && account_stats.is_voter )
+      if( is_set( options.fetch_voter_object ) && account_stats.is_voter )
          acnt.voter = *_db.find_voter( uid, account_stats.last_voter_sequence );
       // witness
-      if( options.fetch_witness_object.valid() && *options.fetch_witness_object == true )
+      if( is_set( options.fetch_witness_object ) )
       {
          const witness_object* wit = _db.find_witness_by_uid( uid );
          if( wit != nullptr )
             acnt.witness = *wit;
       }
-      if( options.fetch_witness_votes.valid() && *options.fetch_witness_votes == true && account_stats.is_voter )
+      if( is_set( options.fetch_witness_votes ) && account_stats.is_voter )
       {
-         auto range = _db.get_index_type<witness_vote_index>().indices().get<by_voter_seq>()
-                         .equal_range( std::make_tuple( uid, account_stats.last_voter_sequence ) );
+         auto range = witness_votes_by_voter.equal_range( std::make_tuple( uid, account_stats.last_voter_sequence ) );
          std::for_each(range.first, range.second,
                     [&acnt] (const witness_vote_object& o) {
                        if( acnt.witness_votes.empty() || acnt.witness_votes.back() != o.witness_uid )
@@ -971,16 +1564,15 @@ std::map<account_uid_type,full_account> database_api_impl::get_full_accounts_by_
                     });
       }
       // committee member
-      if( options.fetch_committee_member_object.valid() && *options.fetch_committee_member_object == true )
+      if( is_set( options.fetch_committee_member_object ) )
       {
          const committee_member_object* com = _db.find_committee_member_by_uid( uid );
          if( com != nullptr )
             acnt.committee_member = *com;
       }
-      if( options.fetch_committee_member_votes.valid() && *options.fetch_committee_member_votes == true && account_stats.is_voter )
+      if( is_set( options.fetch_committee_member_votes ) && account_stats.is_voter )
       {
-         auto range = _db.get_index_type<committee_member_vote_index>().indices().get<by_voter_seq>()
-                         .equal_range( std::make_tuple( uid, account_stats.last_voter_sequence ) );
+         auto range = committee_votes_by_voter.equal_range( std::make_tuple( uid, account_stats.last_voter_sequence ) );
          std::for_each(range.first, range.second,
                     [&acnt] (const committee_member_vote_object& o) {
                        if( acnt.committee_member_votes.empty() || acnt.committee_member_votes.back() != o.committee_member_uid )
@@ -988,16 +1580,15 @@ std::map<account_uid_type,full_account> database_api_impl::get_full_accounts_by_
                     });
       }
       // platform
-      if( options.fetch_platform_object.valid() && *options.fetch_platform_object == true )
+      if( is_set( options.fetch_platform_object ) )
       {
          const platform_object* pf = _db.find_platform_by_owner( uid );
          if( pf != nullptr )
             acnt.platform = *pf;
       }
-      if( options.fetch_platform_votes.valid() && *options.fetch_platform_votes == true && account_stats.is_voter )
+      if( is_set( options.fetch_platform_votes ) && account_stats.is_voter )
       {
-         auto range = _db.get_index_type<platform_vote_index>().indices().get<by_platform_voter_seq>()
-                         .equal_range( std::make_tuple( uid, account_stats.last_voter_sequence ) );
+         auto range = platform_votes_by_voter.equal_range( std::make_tuple( uid, account_stats.last_voter_sequence ) );
          std::for_each(range.first, range.second,
                     [&acnt] (const platform_vote_object& o) {
                        if( acnt.platform_votes.empty() || acnt.platform_votes.back() != o.platform_owner )
@@ -1005,27 +1596,72 @@ std::map<account_uid_type,full_account> database_api_impl::get_full_accounts_by_
                     });
       }
       // get assets issued by user
-      if( options.fetch_assets.valid() && *options.fetch_assets == true )
+      if( is_set( options.fetch_assets ) )
       {
-         auto asset_range = _db.get_index_type<asset_index>().indices().get<by_issuer>()
-                               .equal_range( account->uid );
+         auto asset_range = assets_by_issuer.equal_range( account->uid );
          std::for_each(asset_range.first, asset_range.second,
                     [&acnt] (const asset_object& asset_obj) {
                        acnt.assets.emplace_back( asset_obj.asset_id );
                     });
       }
       // Add the account's balances
-      if( options.fetch_balances.valid() && *options.fetch_balances == true )
+      if( is_set( options.fetch_balances ) )
       {
-         auto balance_range = _db.get_index_type<account_balance_index>().indices().get<by_account_asset>()
-                                 .equal_range( account->uid );
+         auto balance_range = balances_by_account.equal_range( account->uid );
          std::for_each(balance_range.first, balance_range.second,
                     [&acnt](const account_balance_object& balance) {
                        acnt.balances.emplace_back( balance );
                     });
       }
+      if( is_set( options.fetch_pledges ) )
+         acnt.pledges = get_account_core_asset_pledge( uid );
+   }
+   return results;
+}
 
-      results[uid] = acnt;
+std::map<account_uid_type,fc::variant_object> database_api::get_full_account_sections(
+      const vector<account_uid_type>& uids, const full_account_query_options& options )
+{
+   return my->read_state( __func__, [&]() { return my->get_full_account_sections( uids, options ); } );
+}
+
+std::map<account_uid_type,fc::variant_object> database_api_impl::get_full_account_sections(
+      const vector<account_uid_type>& uids, const full_account_query_options& options )
+{
+   std::map<account_uid_type,fc::variant_object> results;
+   for( const auto& item : get_full_accounts_by_uid( uids, options ) )
+   {
+      const full_account& acnt = item.second;
+      fc::mutable_variant_object sections;
+      if( is_set( options.fetch_account_object ) )
+         sections( "account", fc::variant( acnt.account, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_statistics ) )
+         sections( "statistics", fc::variant( acnt.statistics, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_csaf_leases_in ) )
+         sections( "csaf_leases_in", fc::variant( acnt.csaf_leases_in, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_csaf_leases_out ) )
+         sections( "csaf_leases_out", fc::variant( acnt.csaf_leases_out, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_voter_object ) )
+         sections( "voter", fc::variant( acnt.voter, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_witness_object ) )
+         sections( "witness", fc::variant( acnt.witness, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_witness_votes ) )
+         sections( "witness_votes", fc::variant( acnt.witness_votes, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_committee_member_object ) )
+         sections( "committee_member", fc::variant( acnt.committee_member, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_committee_member_votes ) )
+         sections( "committee_member_votes", fc::variant( acnt.committee_member_votes, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_platform_object ) )
+         sections( "platform", fc::variant( acnt.platform, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_platform_votes ) )
+         sections( "platform_votes", fc::variant( acnt.platform_votes, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_assets ) )
+         sections( "assets", fc::variant( acnt.assets, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_balances ) )
+         sections( "balances", fc::variant( acnt.balances, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      if( is_set( options.fetch_pledges ) )
+         sections( "pledges", fc::variant( acnt.pledges, GRAPHENE_MAX_NESTED_OBJECTS ) );
+      results[item.first] = sections;
    }
    return results;
 }
@@ -1056,7 +1692,7 @@ vector<pledge_balance_object> database_api_impl::get_account_core_asset_pledge(a
 
 account_statistics_object database_api::get_account_statistics_by_uid(account_uid_type uid)const
 {
-    return my->get_account_statistics_by_uid(uid);
+   return my->read_state( __func__, [&]() { return my->get_account_statistics_by_uid(uid); } );
 }
 
 account_statistics_object database_api_impl::get_account_statistics_by_uid(account_uid_type uid)const
@@ -1074,15 +1710,14 @@ std::pair<fc::uint128_t, share_type> database_api::compute_coin_seconds_earned(c
 
 optional<account_object> database_api::get_account_by_name( string name )const
 {
-   return my->get_account_by_name( name );
+   return my->read_state( __func__, [&]() { return my->get_account_by_name( name ); } );
 }
 
 optional<account_object> database_api_impl::get_account_by_name( string name )const
 {
-   const auto& idx = _db.get_index_type<account_index>().indices().get<by_name>();
-   auto itr = idx.find(name);
-   if (itr != idx.end())
-      return *itr;
+   const account_object* account = _db.find_account_by_name(name);
+   if (account != nullptr)
+      return *account;
    return optional<account_object>();
 }
 
@@ -1109,25 +1744,24 @@ vector<account_uid_type> database_api_impl::get_account_references( account_uid_
 
 vector<optional<account_object>> database_api::lookup_account_names(const vector<string>& account_names)const
 {
-   return my->lookup_account_names( account_names );
+   return my->read_state( __func__, [&]() { return my->lookup_account_names( account_names ); } );
 }
 
 vector<optional<account_object>> database_api_impl::lookup_account_names(const vector<string>& account_names)const
 {
-   const auto& accounts_by_name = _db.get_index_type<account_index>().indices().get<by_name>();
    vector<optional<account_object> > result;
    result.reserve(account_names.size());
    std::transform(account_names.begin(), account_names.end(), std::back_inserter(result),
-                  [&accounts_by_name](const string& name) -> optional<account_object> {
-      auto itr = accounts_by_name.find(name);
-      return itr == accounts_by_name.end()? optional<account_object>() : *itr;
+                  [this](const string& name) -> optional<account_object> {
+      const account_object* account = _db.find_account_by_name(name);
+      return account == nullptr ? optional<account_object>() : *account;
    });
    return result;
 }
 
 map<string,account_uid_type> database_api::lookup_accounts_by_name(const string& lower_bound_name, uint32_t limit)const
 {
-   return my->lookup_accounts_by_name( lower_bound_name, limit );
+   return my->read_state( __func__, [&]() { return my->lookup_accounts_by_name( lower_bound_name, limit ); } );
 }
 
 map<string,account_uid_type> database_api_impl::lookup_accounts_by_name(const string& lower_bound_name, uint32_t limit)const
@@ -1155,19 +1789,16 @@ uint64_t database_api::get_account_auth_platform_count(const account_uid_type pl
 
 uint64_t database_api_impl::get_account_auth_platform_count(const account_uid_type platform)const
 {
-   const auto& idx = _db.get_index_type<account_auth_platform_index>().indices().get<by_platform_account>();
-   auto range = idx.equal_range(boost::make_tuple(platform));
-
-   int count = boost::distance(range);
-
-   return count;
+   const auto& idx = dynamic_cast<const primary_index<account_auth_platform_index>&>(
+                        _db.get_index_type<account_auth_platform_index>() );
+   return idx.get_secondary_index<graphene::chain::account_auth_platform_count_index>().account_count( platform );
 }
 
 vector<account_auth_platform_object> database_api::list_account_auth_platform_by_platform(const account_uid_type platform,
                                                                                           const account_uid_type lower_bound_account,
                                                                                           const uint32_t limit)const
 {
-   return my->list_account_auth_platform_by_platform(platform, lower_bound_account, limit);
+   return my->read_state( __func__, [&]() { return my->list_account_auth_platform_by_platform(platform, lower_bound_account, limit); } );
 }
 
 vector<account_auth_platform_object> database_api_impl::list_account_auth_platform_by_platform(const account_uid_type platform,
@@ -1192,7 +1823,7 @@ vector<account_auth_platform_object> database_api::list_account_auth_platform_by
                                                                                          const account_uid_type lower_bound_platform,
                                                                                          const uint32_t limit)const
 {
-   return my->list_account_auth_platform_by_account(account, lower_bound_platform, limit);
+   return my->read_state( __func__, [&]() { return my->list_account_auth_platform_by_account(account, lower_bound_platform, limit); } );
 }
 
 vector<account_auth_platform_object> database_api_impl::list_account_auth_platform_by_account(const account_uid_type account,
@@ -1348,7 +1979,7 @@ vector<csaf_lease_object> database_api_impl::get_csaf_leases_by_to( const accoun
 
 vector<optional<platform_object>> database_api::get_platforms( const vector<account_uid_type>& account_uids )const
 {
-    return my->get_platforms( account_uids );
+   return my->read_state( __func__, [&]() { return my->get_platforms( account_uids ); } );
 }
 
 vector<optional<platform_object>> database_api_impl::get_platforms(const vector<account_uid_type>& platform_uids)const
@@ -1382,7 +2013,7 @@ fc::optional<platform_object> database_api_impl::get_platform_by_account(account
 vector<platform_object> database_api::lookup_platforms( const account_uid_type lower_bound_uid,
                                               uint32_t limit, data_sorting_type order_by )const
 {
-    return my->lookup_platforms( lower_bound_uid, limit, order_by );
+   return my->read_state( __func__, [&]() { return my->lookup_platforms( lower_bound_uid, limit, order_by ); } );
 }
 
 vector<platform_object> database_api_impl::lookup_platforms( const account_uid_type lower_bound_uid,
@@ -1390,38 +2021,13 @@ vector<platform_object> database_api_impl::lookup_platforms( const account_uid_t
                                                             data_sorting_type order_by )const
 {
    FC_ASSERT( limit <= 101 );
-   vector<platform_object> result;
-
-   if( order_by == order_by_uid )
-   {
-      const auto& idx = _db.get_index_type<platform_index>().indices().get<by_valid>();
-      auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_uid ) );
-      while( itr != idx.end() && limit > 0 ) // assume false < true
-      {
-         result.push_back( *itr );
-         ++itr;
-         --limit;
-      }
-   }
-   else
-   {
-      account_uid_type new_lower_bound_uid = lower_bound_uid;
-      const platform_object* lower_bound_obj = _db.find_platform_by_owner( lower_bound_uid );
-      uint64_t lower_bound_shares = -1;
-      if( lower_bound_obj == nullptr )
-         new_lower_bound_uid = 0;
-      else
-      {
-         if( order_by == order_by_votes )
-            lower_bound_shares = lower_bound_obj->total_votes;
-         else // by pledge
-            lower_bound_shares = lower_bound_obj->pledge;
-      }
+   return _block_results->fetch< vector<platform_object> >( block_result_cache::current_state( _db ), [&]() -> vector<platform_object> {
+      vector<platform_object> result;
 
-      if( order_by == order_by_votes )
+      if( order_by == order_by_uid )
       {
-         const auto& idx = _db.get_index_type<platform_index>().indices().get<by_platform_votes>();
-         auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_shares, new_lower_bound_uid ) );
+         const auto& idx = _db.get_index_type<platform_index>().indices().get<by_valid>();
+         auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_uid ) );
          while( itr != idx.end() && limit > 0 ) // assume false < true
          {
             result.push_back( *itr );
@@ -1429,20 +2035,47 @@ vector<platform_object> database_api_impl::lookup_platforms( const account_uid_t
             --limit;
          }
       }
-      else // by pledge
+      else
       {
-         const auto& idx = _db.get_index_type<platform_index>().indices().get<by_platform_pledge>();
-         auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_shares, new_lower_bound_uid ) );
-         while( itr != idx.end() && limit > 0 ) // assume false < true
+         account_uid_type new_lower_bound_uid = lower_bound_uid;
+         const platform_object* lower_bound_obj = _db.find_platform_by_owner( lower_bound_uid );
+         uint64_t lower_bound_shares = -1;
+         if( lower_bound_obj == nullptr )
+            new_lower_bound_uid = 0;
+         else
+         {
+            if( order_by == order_by_votes )
+               lower_bound_shares = lower_bound_obj->total_votes;
+            else // by pledge
+               lower_bound_shares = lower_bound_obj->pledge;
+         }
+
+         if( order_by == order_by_votes )
+         {
+            const auto& idx = _db.get_index_type<platform_index>().indices().get<by_platform_votes>();
+            auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_shares, new_lower_bound_uid ) );
+            while( itr != idx.end() && limit > 0 ) // assume false < true
+            {
+               result.push_back( *itr );
+               ++itr;
+               --limit;
+            }
+         }
+         else // by pledge
          {
-            result.push_back( *itr );
-            ++itr;
-            --limit;
+            const auto& idx = _db.get_index_type<platform_index>().indices().get<by_platform_pledge>();
+            auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_shares, new_lower_bound_uid ) );
+            while( itr != idx.end() && limit > 0 ) // assume false < true
+            {
+               result.push_back( *itr );
+               ++itr;
+               --limit;
+            }
          }
       }
-   }
 
-   return result;
+      return result;
+   }, "lookup_platforms", lower_bound_uid, limit, order_by );
 }
 
 uint64_t database_api::get_platform_count()const
@@ -1452,14 +2085,28 @@ uint64_t database_api::get_platform_count()const
 
 uint64_t database_api_impl::get_platform_count()const
 {
-   return _db.get_index_type< platform_index >().indices().get< by_valid >().count(true);
+   const auto& idx = dynamic_cast<const primary_index<platform_index>&>( _db.get_index_type<platform_index>() );
+   return idx.get_secondary_index<graphene::chain::valid_platform_count_index>().valid_count();
+}
+
+vector<platform_vote_profit_object> database_api::get_platform_vote_profits( account_uid_type platform )const
+{
+   return my->read_state( __func__, [&]() { return my->get_platform_vote_profits( platform ); } );
+}
+
+vector<platform_vote_profit_object> database_api_impl::get_platform_vote_profits( account_uid_type platform )const
+{
+   const platform_id_type platform_id = _db.get_platform_by_owner( platform ).id;
+   const auto& idx = _db.get_index_type<platform_vote_profit_index>().indices().get<by_platform_award_time>();
+   auto range = idx.equal_range( std::make_tuple( platform_id ) );
+   return vector<platform_vote_profit_object>( range.first, range.second );
 }
 
 optional<post_object> database_api::get_post(const account_uid_type platform_owner,
                                              const account_uid_type poster_uid,
                                              const post_pid_type post_pid )const
 {
-   return my->get_post(platform_owner, poster_uid, post_pid);
+   return my->read_state( __func__, [&]() { return my->get_post(platform_owner, poster_uid, post_pid); } );
 }
 
 optional<post_object> database_api_impl::get_post(const account_uid_type platform_owner,
@@ -1468,7 +2115,7 @@ optional<post_object> database_api_impl::get_post(const account_uid_type platfor
 {
    if (auto o = _db.find_post_by_platform(platform_owner, poster_uid, post_pid))
    {
-      return *o;
+      return _db.with_post_content(*o);
    }
    return{};
 }
@@ -1498,7 +2145,7 @@ vector<score_object> database_api::get_scores_by_uid(const account_uid_type  sco
                                                      const object_id_type lower_bound_score,
                                                      const uint32_t limit)const
 {
-   return my->get_scores_by_uid(scorer, period, lower_bound_score, limit);
+   return my->read_state( __func__, [&]() { return my->get_scores_by_uid(scorer, period, lower_bound_score, limit); } );
 }
 
 vector<score_object> database_api_impl::get_scores_by_uid(const account_uid_type  scorer,
@@ -1531,7 +2178,7 @@ vector<score_object> database_api::list_scores(const account_uid_type platform,
                                                const uint32_t         limit,
                                                const bool             list_cur_period)const
 {
-   return my->list_scores(platform, poster_uid, post_pid, lower_bound_score, limit, list_cur_period);
+   return my->read_state( __func__, [&]() { return my->list_scores(platform, poster_uid, post_pid, lower_bound_score, limit, list_cur_period); } );
 }
 
 vector<score_object> database_api_impl::list_scores(const account_uid_type platform,
@@ -1574,6 +2221,27 @@ vector<score_object> database_api_impl::list_scores(const account_uid_type platf
    return result;
 }
 
+post_score_totals database_api::get_post_score_totals(const account_uid_type platform,
+                                                     const account_uid_type poster_uid,
+                                                     const post_pid_type    post_pid,
+                                                     const bool             cur_period)const
+{
+   return my->read_state( __func__, [&]() { return my->get_post_score_totals(platform, poster_uid, post_pid, cur_period); } );
+}
+
+post_score_totals database_api_impl::get_post_score_totals(const account_uid_type platform,
+                                                          const account_uid_type poster_uid,
+                                                          const post_pid_type    post_pid,
+                                                          const bool             cur_period)const
+{
+   const auto& score_idx = dynamic_cast<const primary_index<score_index>&>( _db.get_index_type<score_index>() );
+   const auto& totals = score_idx.get_secondary_index<post_score_totals_index>();
+   if (cur_period)
+      return totals.period_totals(platform, poster_uid, post_pid,
+                                  _db.get_dynamic_global_properties().current_active_post_sequence);
+   return totals.totals(platform, poster_uid, post_pid);
+}
+
 optional<license_object> database_api::get_license(const account_uid_type platform, const license_lid_type license_lid)const
 {
    return my->get_license(platform, license_lid);
@@ -1591,7 +2259,7 @@ optional<license_object> database_api_impl::get_license(const account_uid_type p
 
 vector<license_object> database_api::list_licenses(const account_uid_type platform, const object_id_type lower_bound_license, const uint32_t limit)const
 {
-   return my->list_licenses(platform, lower_bound_license, limit);
+   return my->read_state( __func__, [&]() { return my->list_licenses(platform, lower_bound_license, limit); } );
 }
 
 vector<license_object> database_api_impl::list_licenses(const account_uid_type platform, const object_id_type lower_bound_license, const uint32_t limit)const
@@ -1613,7 +2281,7 @@ vector<license_object> database_api_impl::list_licenses(const account_uid_type p
 
 vector<advertising_object> database_api::list_advertisings(const account_uid_type platform, const advertising_aid_type lower_bound_advertising, const uint32_t limit)const
 {
-   return my->list_advertisings(platform, lower_bound_advertising, limit);
+   return my->read_state( __func__, [&]() { return my->list_advertisings(platform, lower_bound_advertising, limit); } );
 }
 
 vector<advertising_object> database_api_impl::list_advertisings(const account_uid_type platform, const advertising_aid_type lower_bound_advertising, const uint32_t limit)const
@@ -1711,12 +2379,14 @@ vector<custom_vote_object> database_api_impl::lookup_custom_votes(const account_
       result.push_back(*itr);
       ++itr;
    }
+   for (auto& v : result)
+      v.vote_result = _db.get_custom_vote_result(v);
    return result;
 }
 
 vector<custom_vote_object> database_api::list_custom_votes(optional<custom_vote_id_type> lower_bound_custom_vote_id, optional<bool> is_finished, uint32_t limit)const
 {
-   return my->list_custom_votes(lower_bound_custom_vote_id, is_finished, limit);
+   return my->read_state( __func__, [&]() { return my->list_custom_votes(lower_bound_custom_vote_id, is_finished, limit); } );
 }
 
 vector<custom_vote_object> database_api_impl::list_custom_votes(optional<custom_vote_id_type> lower_bound_custom_vote_id, optional<bool> is_finished, uint32_t limit)const
@@ -1754,6 +2424,8 @@ vector<custom_vote_object> database_api_impl::list_custom_votes(optional<custom_
          ++itr;
       }
    }
+   for (auto& v : result)
+      v.vote_result = _db.get_custom_vote_result(v);
    return result;
 }
 
@@ -1813,7 +2485,7 @@ vector<active_post_object> database_api::get_post_profits_detail(const uint32_t
                                                                  const account_uid_type poster,
                                                                  const post_pid_type    post_pid)const
 {
-   return my->get_post_profits_detail(begin_period, end_period, platform, poster, post_pid);
+   return my->read_state( __func__, [&]() { return my->get_post_profits_detail(begin_period, end_period, platform, poster, post_pid); } );
 }
 
 vector<active_post_object> database_api_impl::get_post_profits_detail(const uint32_t         begin_period,
@@ -1845,7 +2517,7 @@ vector<Platform_Period_Profit_Detail> database_api::get_platform_profits_detail(
                                                                                 const uint32_t         lower_bound_index,
                                                                                 uint32_t               limit)const
 {
-   return my->get_platform_profits_detail(begin_period, end_period, platform, lower_bound_index, limit);
+   return my->read_state( __func__, [&]() { return my->get_platform_profits_detail(begin_period, end_period, platform, lower_bound_index, limit); } );
 }
 
 vector<Platform_Period_Profit_Detail> database_api_impl::get_platform_profits_detail(const uint32_t         begin_period,
@@ -1859,21 +2531,21 @@ vector<Platform_Period_Profit_Detail> database_api_impl::get_platform_profits_de
    FC_ASSERT(limit <= 100);
    uint32_t begin_index = 0;
    vector<Platform_Period_Profit_Detail> vtr_profit_details;
+   const platform_object& platform_obj = _db.get_platform_by_owner(platform);
    for (int i = begin_period; i <= end_period; ++i)
    {
-      const platform_object& platform_obj = _db.get_platform_by_owner(platform);
-      auto iter_profit = platform_obj.period_profits.find(i);
+      const platform_period_profit_object* profit = _db.find_platform_period_profit(platform_obj.id, i);
 
-      if (iter_profit != platform_obj.period_profits.end()){
+      if (profit != nullptr){
          Platform_Period_Profit_Detail detail;
          detail.cur_period = i;
          detail.platform_account = platform;
          detail.platform_name = platform_obj.name;
-         detail.foward_profits = iter_profit->second.foward_profits;
-         detail.post_profits = iter_profit->second.post_profits;
-         detail.post_profits_by_platform = iter_profit->second.post_profits_by_platform;
-         detail.platform_profits = iter_profit->second.platform_profits;
-         detail.rewards_profits = iter_profit->second.rewards_profits;
+         detail.foward_profits = profit->foward_profits;
+         detail.post_profits = profit->post_profits;
+         detail.post_profits_by_platform = profit->post_profits_by_platform;
+         detail.platform_profits = profit->platform_profits;
+         detail.rewards_profits = profit->rewards_profits;
 
          const auto& idx = _db.get_index_type<active_post_index>().indices().get<by_platforms>();
          auto itr_begin = idx.lower_bound(std::make_tuple(platform, i));
@@ -1892,13 +2564,36 @@ vector<Platform_Period_Profit_Detail> database_api_impl::get_platform_profits_de
    return vtr_profit_details;
 }
 
+vector<active_post_receiptor_object> database_api::list_active_post_receiptors(const active_post_id_type active_post,
+                                                                              const account_uid_type lower_bound_receiptor,
+                                                                              uint32_t limit)const
+{
+   return my->read_state( __func__, [&]() { return my->list_active_post_receiptors(active_post, lower_bound_receiptor, limit); } );
+}
+
+vector<active_post_receiptor_object> database_api_impl::list_active_post_receiptors(const active_post_id_type active_post,
+                                                                                   const account_uid_type lower_bound_receiptor,
+                                                                                   uint32_t limit)const
+{
+   FC_ASSERT(limit <= 100);
+   vector<active_post_receiptor_object> result;
+   const auto& idx = _db.get_index_type<active_post_receiptor_index>().indices().get<by_active_post_receiptor>();
+   auto itr = idx.lower_bound(std::make_tuple(active_post, lower_bound_receiptor));
+   while (itr != idx.end() && itr->active_post == active_post && limit--)
+   {
+      result.push_back(*itr);
+      ++itr;
+   }
+   return result;
+}
+
 vector<Poster_Period_Profit_Detail> database_api::get_poster_profits_detail(const uint32_t         begin_period,
                                                                             const uint32_t         end_period,
                                                                             const account_uid_type poster,
                                                                             const uint32_t         lower_bound_index,
                                                                             uint32_t               limit)const
 {
-   return my->get_poster_profits_detail(begin_period, end_period, poster, lower_bound_index, limit);
+   return my->read_state( __func__, [&]() { return my->get_poster_profits_detail(begin_period, end_period, poster, lower_bound_index, limit); } );
 }
 
 vector<Poster_Period_Profit_Detail> database_api_impl::get_poster_profits_detail(const uint32_t         begin_period,
@@ -1924,17 +2619,18 @@ vector<Poster_Period_Profit_Detail> database_api_impl::get_poster_profits_detail
       auto itr = apt_idx.lower_bound(std::make_tuple(poster, start));
       bool exist = false;
 
-      while (itr != apt_idx.end() && itr->receiptor_details.count(poster)
+      const active_post_receiptor_object* receipts = nullptr;
+      while (itr != apt_idx.end() && (receipts = _db.find_active_post_receiptor(itr->get_id(), poster)) != nullptr
          && itr->period_sequence == start && itr->poster == poster)
       {
-         ppd.total_forward += itr->receiptor_details.at(poster).forward;
-         ppd.total_post_award += itr->receiptor_details.at(poster).post_award;
+         ppd.total_forward += receipts->forward;
+         ppd.total_post_award += receipts->post_award;
          if (begin_index >= lower_bound_index && limit) {
             ppd.active_objects.push_back(*itr);
             --limit;
          }
 
-         for (const auto& r : itr->receiptor_details.at(poster).rewards)
+         for (const auto& r : receipts->rewards)
          {
             if (ppd.total_rewards.count(r.first))
                ppd.total_rewards[r.first] += r.second;
@@ -1962,18 +2658,19 @@ uint64_t database_api::get_posts_count(optional<account_uid_type> platform, opti
 
 uint64_t database_api_impl::get_posts_count(optional<account_uid_type> platform, optional<account_uid_type> poster)const
 {
-   const auto& post_idx = _db.get_index_type<post_index>().indices().get<by_post_pid>();
+   const auto& post_idx = dynamic_cast<const primary_index<post_index>&>( _db.get_index_type<post_index>() );
+   const auto& counts = post_idx.get_secondary_index<graphene::chain::post_count_index>();
    if (platform.valid()) {
       if (poster.valid())
-         return post_idx.count(std::make_tuple(*platform, *poster));
+         return counts.post_count(*platform, *poster);
       else
-         return post_idx.count(*platform);
+         return counts.post_count(*platform);
    }
    else {
       if (poster.valid())
          FC_ASSERT(false, "platform should be valid when poster is valid");
       else
-         return post_idx.size();
+         return post_idx.indices().size();
    }
 }
 
@@ -2002,7 +2699,7 @@ vector<post_object> database_api::get_posts_by_platform_poster( const account_ui
                                       const object_id_type lower_bound_post,
                                       const uint32_t limit )const
 {
-   return my->get_posts_by_platform_poster(platform_owner, poster, lower_bound_post, limit);
+   return my->read_state( __func__, [&]() { return my->get_posts_by_platform_poster(platform_owner, poster, lower_bound_post, limit); } );
 }
 
 vector<post_object> database_api_impl::get_posts_by_platform_poster( const account_uid_type platform_owner,
@@ -2020,7 +2717,7 @@ vector<post_object> database_api_impl::get_posts_by_platform_poster( const accou
       auto itr = post_idx.lower_bound(std::make_tuple(platform_owner, *poster, lower_bound_post));
       while (itr != post_idx.end() && count < limit && itr->platform == platform_owner && itr->poster == *poster)
       {
-         result.push_back(*itr);
+         result.push_back(_db.with_post_content(*itr));
          ++itr;
          ++count;
       }
@@ -2030,7 +2727,7 @@ vector<post_object> database_api_impl::get_posts_by_platform_poster( const accou
       auto itr = post_idx.lower_bound(std::make_tuple(platform_owner, lower_bound_post));
       while (itr != post_idx.end() && count < limit && itr->platform == platform_owner)
       {
-         result.push_back(*itr);
+         result.push_back(_db.with_post_content(*itr));
          ++itr;
          ++count;
       }
@@ -2046,7 +2743,7 @@ vector<post_object> database_api_impl::get_posts_by_platform_poster( const accou
 
 vector<asset> database_api::get_account_balances(account_uid_type uid, const flat_set<asset_aid_type>& assets)const
 {
-   return my->get_account_balances(uid, assets);
+   return my->read_state( __func__, [&]() { return my->get_account_balances(uid, assets); } );
 }
 
 vector<asset> database_api_impl::get_account_balances(account_uid_type acnt, const flat_set<asset_aid_type>& assets)const
@@ -2078,10 +2775,9 @@ vector<asset> database_api::get_named_account_balances(const std::string& name,
 
 vector<asset> database_api_impl::get_named_account_balances(const std::string& name, const flat_set<asset_aid_type>& assets) const
 {
-   const auto& accounts_by_name = _db.get_index_type<account_index>().indices().get<by_name>();
-   auto itr = accounts_by_name.find(name);
-   FC_ASSERT(itr != accounts_by_name.end());
-   return get_account_balances(itr->get_uid(), assets);
+   const account_object* account = _db.find_account_by_name(name);
+   FC_ASSERT(account != nullptr);
+   return get_account_balances(account->get_uid(), assets);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -2122,7 +2818,7 @@ vector<optional<asset_object_with_data>> database_api_impl::get_assets(const vec
 
 vector<asset_object_with_data> database_api::list_assets(const string& lower_bound_symbol, uint32_t limit)const
 {
-   return my->list_assets(lower_bound_symbol, limit);
+   return my->read_state( __func__, [&]() { return my->list_assets(lower_bound_symbol, limit); } );
 }
 
 vector<asset_object_with_data> database_api_impl::list_assets(const string& lower_bound_symbol, uint32_t limit)const
@@ -2148,7 +2844,7 @@ vector<asset_object_with_data> database_api_impl::list_assets(const string& lowe
 
 vector<optional<asset_object_with_data>> database_api::lookup_asset_symbols(const vector<string>& symbols_or_ids)const
 {
-   return my->lookup_asset_symbols(symbols_or_ids);
+   return my->read_state( __func__, [&]() { return my->lookup_asset_symbols(symbols_or_ids); } );
 }
 
 vector<optional<asset_object_with_data>> database_api_impl::lookup_asset_symbols(const vector<string>& symbols_or_ids)const
@@ -2187,7 +2883,7 @@ vector<optional<asset_object_with_data>> database_api_impl::lookup_asset_symbols
 
 vector<limit_order_object> database_api::get_limit_orders(std::string a, std::string b, uint32_t limit)const
 {
-   return my->get_limit_orders(a, b, limit);
+   return my->read_state( __func__, [&]() { return my->get_limit_orders(a, b, limit); } );
 }
 
 /**
@@ -2366,6 +3062,67 @@ void database_api_impl::unsubscribe_from_market(const std::string& a, const std:
    _market_subscriptions.erase(std::make_pair(asset_a_id, asset_b_id));
 }
 
+market_depth database_api::get_market_depth(const string& base, const string& quote, uint32_t limit)const
+{
+   return my->read_state( __func__, [&]() { return my->get_market_depth(base, quote, limit); } );
+}
+
+market_depth database_api_impl::get_market_depth(const string& base, const string& quote, uint32_t limit)const
+{
+   FC_ASSERT( limit <= 500 );
+
+   market_depth result;
+   result.base = get_asset_from_string(base)->asset_id;
+   result.quote = get_asset_from_string(quote)->asset_id;
+   FC_ASSERT( result.base != result.quote );
+   result.sequence = _depth_feed->sequence( std::make_pair( std::min( result.base, result.quote ),
+                                                            std::max( result.base, result.quote ) ) );
+   result.head_block_num = _db.head_block_num();
+
+   const limit_order_book_index& book = dynamic_cast<const primary_index<limit_order_index>&>(
+         _db.get_index_type<limit_order_index>() ).get_secondary_index<limit_order_book_index>();
+   auto copy_side = [limit]( const limit_order_book_index::side_type* side, vector< pair<price, share_type> >& levels ) {
+      if( side == nullptr )
+         return;
+      levels.reserve( std::min<size_t>( limit, side->size() ) );
+      for( auto itr = side->rbegin(); itr != side->rend() && levels.size() < limit; ++itr )
+         levels.push_back( *itr );
+   };
+   copy_side( book.find_side( result.base, result.quote ), result.bids );
+   copy_side( book.find_side( result.quote, result.base ), result.asks );
+   return result;
+}
+
+void database_api::subscribe_to_market_depth(std::function<void(const variant&)> callback, const std::string& base, const std::string& quote)
+{
+   my->subscribe_to_market_depth(callback, base, quote);
+}
+
+void database_api_impl::subscribe_to_market_depth(std::function<void(const variant&)> callback, const std::string& base, const std::string& quote)
+{
+   const auto base_id = get_asset_from_string(base)->asset_id;
+   const auto quote_id = get_asset_from_string(quote)->asset_id;
+   FC_ASSERT( base_id != quote_id );
+   const auto market = std::make_pair( std::min( base_id, quote_id ), std::max( base_id, quote_id ) );
+   _market_depth_subscriptions[market] = std::make_pair( base_id, callback );
+   _depth_feed->add_session( this, market );
+}
+
+void database_api::unsubscribe_from_market_depth(const std::string& base, const std::string& quote)
+{
+   my->unsubscribe_from_market_depth(base, quote);
+}
+
+void database_api_impl::unsubscribe_from_market_depth(const std::string& base, const std::string& quote)
+{
+   const auto base_id = get_asset_from_string(base)->asset_id;
+   const auto quote_id = get_asset_from_string(quote)->asset_id;
+   FC_ASSERT( base_id != quote_id );
+   const auto market = std::make_pair( std::min( base_id, quote_id ), std::max( base_id, quote_id ) );
+   if( _market_depth_subscriptions.erase( market ) )
+      _depth_feed->remove_session( this, market );
+}
+
 string database_api_impl::price_to_string(const price& _price, const asset_object& _base, const asset_object& _quote)
 {
    try {
@@ -2380,7 +3137,7 @@ string database_api_impl::price_to_string(const price& _price, const asset_objec
 
 market_ticker database_api::get_ticker(const string& base, const string& quote)const
 {
-   return my->get_ticker(base, quote);
+   return my->read_state( __func__, [&]() { return my->get_ticker(base, quote); } );
 }
 
 market_ticker database_api_impl::get_ticker(const string& base, const string& quote, bool skip_order_book)const
@@ -2392,29 +3149,35 @@ market_ticker database_api_impl::get_ticker(const string& base, const string& qu
    FC_ASSERT(assets[0], "Invalid base asset symbol: ${s}", ("s", base));
    FC_ASSERT(assets[1], "Invalid quote asset symbol: ${s}", ("s", quote));
 
-   auto base_id = assets[0]->asset_id;
-   auto quote_id = assets[1]->asset_id;
-   if (base_id > quote_id) std::swap(base_id, quote_id);
-   const auto& ticker_idx = _db.get_index_type<graphene::market_history::market_ticker_index>().indices().get<by_market>();
-   auto itr = ticker_idx.find(std::make_tuple(base_id, quote_id));
-   const fc::time_point_sec now = _db.head_block_time();
-   if (itr != ticker_idx.end())
-   {
-      order_book orders;
-      if (!skip_order_book)
+   auto build = [&]() -> market_ticker {
+      auto base_id = assets[0]->asset_id;
+      auto quote_id = assets[1]->asset_id;
+      if (base_id > quote_id) std::swap(base_id, quote_id);
+      const auto& ticker_idx = _db.get_index_type<graphene::market_history::market_ticker_index>().indices().get<by_market>();
+      auto itr = ticker_idx.find(std::make_tuple(base_id, quote_id));
+      const fc::time_point_sec now = _db.head_block_time();
+      if (itr != ticker_idx.end())
       {
-         orders = get_order_book(assets[0]->symbol, assets[1]->symbol, 1);
+         order_book orders;
+         if (!skip_order_book)
+         {
+            orders = get_order_book(assets[0]->symbol, assets[1]->symbol, 1);
+         }
+         return market_ticker(*itr, now, *assets[0], *assets[1], orders);
       }
-      return market_ticker(*itr, now, *assets[0], *assets[1], orders);
-   }
-   // if no ticker is found for this market we return an empty ticker
-   market_ticker empty_result(now, *assets[0], *assets[1]);
-   return empty_result;
+      // if no ticker is found for this market we return an empty ticker
+      market_ticker empty_result(now, *assets[0], *assets[1]);
+      return empty_result;
+   };
+   if (skip_order_book)
+      return build();
+   return _block_results->fetch<market_ticker>(block_result_cache::current_state( _db ), build, "get_ticker",
+                                               assets[0]->asset_id, assets[1]->asset_id);
 }
 
 market_volume database_api::get_24_volume(const string& base, const string& quote)const
 {
-   return my->get_24_volume(base, quote);
+   return my->read_state( __func__, [&]() { return my->get_24_volume(base, quote); } );
 }
 
 market_volume database_api_impl::get_24_volume(const string& base, const string& quote)const
@@ -2433,7 +3196,7 @@ market_volume database_api_impl::get_24_volume(const string& base, const string&
 
 order_book database_api::get_order_book(const string& base, const string& quote, unsigned limit)const
 {
-   return my->get_order_book(base, quote, limit);
+   return my->read_state( __func__, [&]() { return my->get_order_book(base, quote, limit); } );
 }
 
 order_book database_api_impl::get_order_book(const string& base, const string& quote, unsigned limit)const
@@ -2480,31 +3243,40 @@ order_book database_api_impl::get_order_book(const string& base, const string& q
 
 vector<market_ticker> database_api::get_top_markets(uint32_t limit)const
 {
-   return my->get_top_markets(limit);
+   return my->read_state( __func__, [&]() { return my->get_top_markets(limit); } );
 }
 
 vector<market_ticker> database_api_impl::get_top_markets(uint32_t limit)const
 {
    FC_ASSERT(_app_options && _app_options->has_market_history_plugin, "Market history plugin is not enabled.");
 
-   FC_ASSERT(limit <= 100);
+   const uint32_t max_limit = 100;
+   FC_ASSERT(limit <= max_limit);
 
-   const auto& volume_idx = _db.get_index_type<graphene::market_history::market_ticker_index>().indices().get<by_volume>();
-   auto itr = volume_idx.rbegin();
-   vector<market_ticker> result;
-   result.reserve(limit);
-   const fc::time_point_sec now = _db.head_block_time();
+   // the top markets are the same for every limit, so only the largest one is built
+   auto build = [&]() -> vector<market_ticker> {
+      const auto& volume_idx = _db.get_index_type<graphene::market_history::market_ticker_index>().indices().get<by_volume>();
+      auto itr = volume_idx.rbegin();
+      vector<market_ticker> result;
+      result.reserve(max_limit);
+      const fc::time_point_sec now = _db.head_block_time();
 
-   while (itr != volume_idx.rend() && result.size() < limit)
-   {
-      const asset_object base = _db.get_asset_by_aid(itr->base);
-      const asset_object quote = _db.get_asset_by_aid(itr->quote);
-      order_book orders;
-      orders = get_order_book(base.symbol, quote.symbol, 1);
+      while (itr != volume_idx.rend() && result.size() < max_limit)
+      {
+         const asset_object base = _db.get_asset_by_aid(itr->base);
+         const asset_object quote = _db.get_asset_by_aid(itr->quote);
+         order_book orders;
+         orders = get_order_book(base.symbol, quote.symbol, 1);
 
-      result.emplace_back(market_ticker(*itr, now, base, quote, orders));
-      ++itr;
-   }
+         result.emplace_back(market_ticker(*itr, now, base, quote, orders));
+         ++itr;
+      }
+      return result;
+   };
+   vector<market_ticker> result = _block_results->fetch< vector<market_ticker> >(
+         block_result_cache::current_state( _db ), build, "get_top_markets");
+   if (result.size() > limit)
+      result.resize(limit);
    return result;
 }
 
@@ -2514,7 +3286,7 @@ vector<market_trade> database_api::get_trade_history(const string& base,
    fc::time_point_sec stop,
    unsigned limit)const
 {
-   return my->get_trade_history(base, quote, start, stop, limit);
+   return my->read_state( __func__, [&]() { return my->get_trade_history(base, quote, start, stop, limit); } );
 }
 
 vector<market_trade> database_api_impl::get_trade_history(const string& base,
@@ -2604,7 +3376,7 @@ vector<market_trade> database_api::get_trade_history_by_sequence(
    fc::time_point_sec stop,
    unsigned limit)const
 {
-   return my->get_trade_history_by_sequence(base, quote, start, stop, limit);
+   return my->read_state( __func__, [&]() { return my->get_trade_history_by_sequence(base, quote, start, stop, limit); } );
 }
 
 vector<market_trade> database_api_impl::get_trade_history_by_sequence(
@@ -2711,19 +3483,21 @@ vector<market_trade> database_api_impl::get_trade_history_by_sequence(
 
 vector<optional<witness_object>> database_api::get_witnesses(const vector<account_uid_type>& witness_uids)const
 {
-   return my->get_witnesses( witness_uids );
+   return my->read_state( __func__, [&]() { return my->get_witnesses( witness_uids ); } );
 }
 
 vector<optional<witness_object>> database_api_impl::get_witnesses(const vector<account_uid_type>& witness_uids)const
 {
-   vector<optional<witness_object>> result; result.reserve(witness_uids.size());
-   std::transform(witness_uids.begin(), witness_uids.end(), std::back_inserter(result),
-                  [this](account_uid_type uid) -> optional<witness_object> {
-      if( auto o = _db.find_witness_by_uid( uid ) )
-         return *o;
-      return {};
-   });
-   return result;
+   return _block_results->fetch< vector<optional<witness_object>> >( block_result_cache::current_state( _db ), [&]() -> vector<optional<witness_object>> {
+      vector<optional<witness_object>> result; result.reserve(witness_uids.size());
+      std::transform(witness_uids.begin(), witness_uids.end(), std::back_inserter(result),
+                     [this](account_uid_type uid) -> optional<witness_object> {
+         if( auto o = _db.find_witness_by_uid( uid ) )
+            return *o;
+         return {};
+      });
+      return result;
+   }, "get_witnesses", witness_uids );
 }
 
 fc::optional<witness_object> database_api::get_witness_by_account(account_uid_type account)const
@@ -2743,45 +3517,20 @@ fc::optional<witness_object> database_api_impl::get_witness_by_account(account_u
 vector<witness_object> database_api::lookup_witnesses(const account_uid_type lower_bound_uid, uint32_t limit,
                                                       data_sorting_type order_by)const
 {
-   return my->lookup_witnesses( lower_bound_uid, limit, order_by );
+   return my->read_state( __func__, [&]() { return my->lookup_witnesses( lower_bound_uid, limit, order_by ); } );
 }
 
 vector<witness_object> database_api_impl::lookup_witnesses(const account_uid_type lower_bound_uid, uint32_t limit,
                                                            data_sorting_type order_by)const
 {
    FC_ASSERT( limit <= 101 );
-   vector<witness_object> result;
-
-   if( order_by == order_by_uid )
-   {
-      const auto& idx = _db.get_index_type<witness_index>().indices().get<by_valid>();
-      auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_uid ) );
-      while( itr != idx.end() && limit > 0 ) // assume false < true
-      {
-         result.push_back( *itr );
-         ++itr;
-         --limit;
-      }
-   }
-   else
-   {
-      account_uid_type new_lower_bound_uid = lower_bound_uid;
-      const witness_object* lower_bound_obj = _db.find_witness_by_uid( lower_bound_uid );
-      uint64_t lower_bound_shares = -1;
-      if( lower_bound_obj == nullptr )
-         new_lower_bound_uid = 0;
-      else
-      {
-         if( order_by == order_by_votes )
-            lower_bound_shares = lower_bound_obj->total_votes;
-         else // by pledge
-            lower_bound_shares = lower_bound_obj->pledge;
-      }
+   return _block_results->fetch< vector<witness_object> >( block_result_cache::current_state( _db ), [&]() -> vector<witness_object> {
+      vector<witness_object> result;
 
-      if( order_by == order_by_votes )
+      if( order_by == order_by_uid )
       {
-         const auto& idx = _db.get_index_type<witness_index>().indices().get<by_votes>();
-         auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_shares, new_lower_bound_uid ) );
+         const auto& idx = _db.get_index_type<witness_index>().indices().get<by_valid>();
+         auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_uid ) );
          while( itr != idx.end() && limit > 0 ) // assume false < true
          {
             result.push_back( *itr );
@@ -2789,20 +3538,47 @@ vector<witness_object> database_api_impl::lookup_witnesses(const account_uid_typ
             --limit;
          }
       }
-      else // by pledge
+      else
       {
-         const auto& idx = _db.get_index_type<witness_index>().indices().get<by_pledge>();
-         auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_shares, new_lower_bound_uid ) );
-         while( itr != idx.end() && limit > 0 ) // assume false < true
+         account_uid_type new_lower_bound_uid = lower_bound_uid;
+         const witness_object* lower_bound_obj = _db.find_witness_by_uid( lower_bound_uid );
+         uint64_t lower_bound_shares = -1;
+         if( lower_bound_obj == nullptr )
+            new_lower_bound_uid = 0;
+         else
          {
-            result.push_back( *itr );
-            ++itr;
-            --limit;
+            if( order_by == order_by_votes )
+               lower_bound_shares = lower_bound_obj->total_votes;
+            else // by pledge
+               lower_bound_shares = lower_bound_obj->pledge;
+         }
+
+         if( order_by == order_by_votes )
+         {
+            const auto& idx = _db.get_index_type<witness_index>().indices().get<by_votes>();
+            auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_shares, new_lower_bound_uid ) );
+            while( itr != idx.end() && limit > 0 ) // assume false < true
+            {
+               result.push_back( *itr );
+               ++itr;
+               --limit;
+            }
+         }
+         else // by pledge
+         {
+            const auto& idx = _db.get_index_type<witness_index>().indices().get<by_pledge>();
+            auto itr = idx.lower_bound( std::make_tuple( true, lower_bound_shares, new_lower_bound_uid ) );
+            while( itr != idx.end() && limit > 0 ) // assume false < true
+            {
+               result.push_back( *itr );
+               ++itr;
+               --limit;
+            }
          }
       }
-   }
 
-   return result;
+      return result;
+   }, "lookup_witnesses", lower_bound_uid, limit, order_by );
 }
 
 uint64_t database_api::get_witness_count()const
@@ -2812,7 +3588,8 @@ uint64_t database_api::get_witness_count()const
 
 uint64_t database_api_impl::get_witness_count()const
 {
-   return _db.get_index_type<witness_index>().indices().get<by_valid>().count( true );
+   const auto& idx = dynamic_cast<const primary_index<witness_index>&>( _db.get_index_type<witness_index>() );
+   return idx.get_secondary_index<graphene::chain::valid_witness_count_index>().valid_count();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -2823,19 +3600,21 @@ uint64_t database_api_impl::get_witness_count()const
 
 vector<optional<committee_member_object>> database_api::get_committee_members(const vector<account_uid_type>& committee_member_uids)const
 {
-   return my->get_committee_members( committee_member_uids );
+   return my->read_state( __func__, [&]() { return my->get_committee_members( committee_member_uids ); } );
 }
 
 vector<optional<committee_member_object>> database_api_impl::get_committee_members(const vector<account_uid_type>& committee_member_uids)const
 {
-   vector<optional<committee_member_object>> result; result.reserve(committee_member_uids.size());
-   std::transform(committee_member_uids.begin(), committee_member_uids.end(), std::back_inserter(result),
-                  [this](account_uid_type uid) -> optional<committee_member_object> {
-      if( auto o = _db.find_committee_member_by_uid( uid ) )
-         return *o;
-      return {};
-   });
-   return result;
+   return _block_results->fetch< vector<optional<committee_member_object>> >( block_result_cache::current_state( _db ), [&]() -> vector<optional<committee_member_object>> {
+      vector<optional<committee_member_object>> result; result.reserve(committee_member_uids.size());
+      std::transform(committee_member_uids.begin(), committee_member_uids.end(), std::back_inserter(result),
+                     [this](account_uid_type uid) -> optional<committee_member_object> {
+         if( auto o = _db.find_committee_member_by_uid( uid ) )
+            return *o;
+         return {};
+      });
+      return result;
+   }, "get_committee_members", committee_member_uids );
 }
 
 fc::optional<committee_member_object> database_api::get_committee_member_by_account(account_uid_type account)const
@@ -2855,7 +3634,7 @@ fc::optional<committee_member_object> database_api_impl::get_committee_member_by
 vector<committee_member_object> database_api::lookup_committee_members(const account_uid_type lower_bound_uid, uint32_t limit,
                                                                        data_sorting_type order_by)const
 {
-   return my->lookup_committee_members( lower_bound_uid, limit, order_by );
+   return my->read_state( __func__, [&]() { return my->lookup_committee_members( lower_bound_uid, limit, order_by ); } );
 }
 
 vector<committee_member_object> database_api_impl::lookup_committee_members(const account_uid_type lower_bound_uid, uint32_t limit,
@@ -2924,12 +3703,14 @@ uint64_t database_api::get_committee_member_count()const
 
 uint64_t database_api_impl::get_committee_member_count()const
 {
-   return _db.get_index_type<committee_member_index>().indices().get<by_valid>().count( true );
+   const auto& idx = dynamic_cast<const primary_index<committee_member_index>&>(
+                        _db.get_index_type<committee_member_index>() );
+   return idx.get_secondary_index<graphene::chain::valid_committee_member_count_index>().valid_count();
 }
 
 vector<committee_proposal_object> database_api::list_committee_proposals()const
 {
-   return my->list_committee_proposals();
+   return my->read_state( __func__, [&]() { return my->list_committee_proposals(); } );
 }
 
 vector<committee_proposal_object> database_api_impl::list_committee_proposals()const
@@ -3055,10 +3836,7 @@ bool database_api_impl::verify_account_authority( const string& name_or_id, cons
       account = _db.find(fc::variant(name_or_id ).as<account_id_type>( 1 ));
    else
    {
-      const auto& idx = _db.get_index_type<account_index>().indices().get<by_name>();
-      auto itr = idx.find(name_or_id);
-      if (itr != idx.end())
-         account = &*itr;
+      account = _db.find_account_by_name(name_or_id);
    }
    FC_ASSERT( account, "no such account" );
 
@@ -3198,6 +3976,71 @@ vector< required_fee_data > database_api_impl::get_required_fee_data( const vect
    return result;
 }
 
+vector<transaction_requirements> database_api::get_transaction_requirements( const vector<signed_transaction>& trxs,
+                                                                           const flat_set<public_key_type>& available_keys )const
+{
+   return my->read_state( __func__, [&]() { return my->get_transaction_requirements( trxs, available_keys ); } );
+}
+
+vector<transaction_requirements> database_api_impl::get_transaction_requirements( const vector<signed_transaction>& trxs,
+                                                                                const flat_set<public_key_type>& available_keys )const
+{
+   FC_ASSERT( trxs.size() <= 100, "At most 100 transactions at once" );
+
+   const chain_id_type chain_id = _db.get_chain_id();
+   const bool enable_hardfork_04 = _db.get_dynamic_global_properties().enabled_hardfork_version >= ENABLE_HEAD_FORK_04;
+   const uint32_t max_authority_depth = _db.get_global_properties().parameters.max_authority_depth;
+   const auto& fs = _db.current_fee_schedule();
+
+   vector<transaction_requirements> results( trxs.size() );
+   // each chunk of transactions remembers the accounts it has looked up
+   auto check_chunk = [&]( size_t begin, size_t end ) {
+      std::map<account_uid_type, const account_object*> accounts;
+      auto get_account = [&]( account_uid_type uid ) -> const account_object& {
+         auto itr = accounts.find( uid );
+         if( itr == accounts.end() )
+            itr = accounts.emplace( uid, &_db.get_account_by_uid( uid ) ).first;
+         return *itr->second;
+      };
+      for( size_t i = begin; i < end; ++i )
+      {
+         const signed_transaction& trx = trxs[i];
+         auto signatures = trx.get_required_signatures( chain_id,
+                                                        available_keys,
+                                                        [&]( account_uid_type uid ){ return &get_account( uid ).owner; },
+                                                        [&]( account_uid_type uid ){ return &get_account( uid ).active; },
+                                                        [&]( account_uid_type uid ){ return &get_account( uid ).secondary; },
+                                                        enable_hardfork_04,
+                                                        max_authority_depth );
+         transaction_requirements& result = results[i];
+         result.usable_keys = std::move( std::get<0>( signatures ) );
+         result.missing_keys = std::move( std::get<1>( signatures ) );
+         result.redundant_signatures = std::move( std::get<2>( signatures ) );
+         result.fees.reserve( trx.operations.size() );
+         for( const operation& op : trx.operations )
+         {
+            const auto& fee_pair = fs.calculate_fee_pair( op );
+            result.fees.push_back( { op.visit( fee_payer_uid_visitor() ), fee_pair.first.value, fee_pair.second.value } );
+         }
+      }
+   };
+
+   // no block is applied while the workers read: either an API thread holds the state shared, or this is the
+   // chain thread and parallel_for() blocks it
+   graphene::utilities::thread_pool* pool = _db.get_thread_pool();
+   const size_t chunks = ( pool == nullptr || pool->size() == 0 ) ? 1 : std::min<size_t>( pool->size(), trxs.size() );
+   if( chunks <= 1 )
+      check_chunk( 0, trxs.size() );
+   else
+   {
+      const size_t chunk_size = ( trxs.size() + chunks - 1 ) / chunks;
+      pool->parallel_for( chunks, [&]( size_t c ) {
+         check_chunk( std::min( trxs.size(), c * chunk_size ), std::min( trxs.size(), ( c + 1 ) * chunk_size ) );
+      } );
+   }
+   return results;
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Proposed transactions                                            //
@@ -3231,6 +4074,11 @@ vector<proposal_object> database_api_impl::get_proposed_transactions( account_ui
    return result;
 }
 
+void database_api::read_state( const char* method, const std::function<void()>& read )const
+{
+   my->read_state( method, [&]() { read(); return true; } );
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Private methods                                                  //
@@ -3249,10 +4097,137 @@ void database_api_impl::broadcast_updates( const vector<variant>& updates )
 }
 
 
-void database_api_impl::on_objects_removed( const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_uid_type>& impacted_accounts)
+void database_api_impl::broadcast_depth_update( const market_depth_feed::market_type& market, uint64_t sequence,
+                                                const vector<limit_order_book_index::level_type>& levels )
+{
+   auto itr = _market_depth_subscriptions.find( market );
+   if( itr == _market_depth_subscriptions.end() )
+      return;
+
+   market_depth update;
+   update.base = itr->second.first;
+   update.quote = ( update.base == market.first ? market.second : market.first );
+   update.sequence = sequence;
+   update.head_block_num = _db.head_block_num();
+   for( const auto& level : levels )
+   {
+      if( level.first.base.asset_id == update.base )
+         update.bids.push_back( level );
+      else
+         update.asks.push_back( level );
+   }
+   // best first, like get_market_depth()
+   auto better = []( const limit_order_book_index::level_type& a, const limit_order_book_index::level_type& b ) {
+      return b.first < a.first;
+   };
+   std::sort( update.bids.begin(), update.bids.end(), better );
+   std::sort( update.asks.begin(), update.asks.end(), better );
+
+   auto capture_this = shared_from_this();
+   fc::async([capture_this,market,update](){
+      auto itr = capture_this->_market_depth_subscriptions.find( market );
+      if( itr != capture_this->_market_depth_subscriptions.end() )
+         itr->second.second( fc::variant( update, GRAPHENE_MAX_NESTED_OBJECTS ) );
+   });
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+// Subscription registry                                            //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<subscription_registry> subscription_registry::get( graphene::chain::database& db )
+{
+   static std::map< const graphene::chain::database*, std::weak_ptr<subscription_registry> > registries;
+   auto& registry = registries[&db];
+   auto result = registry.lock();
+   if( !result )
+   {
+      result = std::make_shared<subscription_registry>( db );
+      registry = result;
+   }
+   return result;
+}
+
+std::shared_ptr<block_result_cache> block_result_cache::get( graphene::chain::database& db )
+{
+   static std::map< const graphene::chain::database*, std::weak_ptr<block_result_cache> > caches;
+   auto& cache = caches[&db];
+   auto result = cache.lock();
+   if( !result )
+   {
+      result = std::make_shared<block_result_cache>();
+      cache = result;
+   }
+   return result;
+}
+
+void subscription_registry::add_session( database_api_impl* session, bool notify_remove_create )
+{
+   _sessions[session] = notify_remove_create;
+   // only listen to object changes while somebody is subscribed, so that idle nodes cost nothing per block
+   if( !_change_log_connection.connected() )
+      _change_log_connection = _db.block_objects_changed.connect([this](const object_change_log& changes) {
+                                   on_block_objects_changed(changes);
+                                   });
+}
+
+void subscription_registry::remove_session( database_api_impl* session,
+                                            const std::unordered_set<object_id_type>& objects,
+                                            const std::set<account_uid_type>& accounts )
+{
+   for( const auto& id : objects )
+   {
+      auto itr = _object_sessions.find( id );
+      if( itr == _object_sessions.end() )
+         continue;
+      itr->second.erase( session );
+      if( itr->second.empty() )
+         _object_sessions.erase( itr );
+   }
+   for( const auto& uid : accounts )
+   {
+      auto itr = _account_sessions.find( uid );
+      if( itr == _account_sessions.end() )
+         continue;
+      itr->second.erase( session );
+      if( itr->second.empty() )
+         _account_sessions.erase( itr );
+   }
+   _sessions.erase( session );
+   if( _sessions.empty() )
+      _change_log_connection.disconnect();
+}
+
+void subscription_registry::add_object( database_api_impl* session, object_id_type id )
+{
+   _object_sessions[id].insert( session );
+}
+
+void subscription_registry::add_account( database_api_impl* session, account_uid_type uid )
+{
+   _account_sessions[uid].insert( session );
+}
+
+void subscription_registry::on_block_objects_changed( const object_change_log& changes )
 {
-   handle_object_changed(_notify_remove_create, false, ids, impacted_accounts,
-      [objs](object_id_type id) -> const object* {
+   auto find_in_db = std::bind(&object_database::find_object, &_db, std::placeholders::_1);
+
+   dispatch( true, true, changes.new_ids,
+      [&changes]() -> const flat_set<account_uid_type>& { return changes.new_accounts_impacted(); },
+      find_in_db
+   );
+
+   dispatch( false, true, changes.changed_ids,
+      [&changes]() -> const flat_set<account_uid_type>& { return changes.changed_accounts_impacted(); },
+      find_in_db
+   );
+
+   const auto& objs = changes.removed_objects;
+   dispatch( true, false, changes.removed_ids,
+      [&changes]() -> const flat_set<account_uid_type>& { return changes.removed_accounts_impacted(); },
+      [&objs](object_id_type id) -> const object* {
          auto it = std::find_if(
                objs.begin(), objs.end(),
                [id](const object* o) {return o != nullptr && o->id == id;});
@@ -3265,48 +4240,139 @@ void database_api_impl::on_objects_removed( const vector<object_id_type>& ids, c
    );
 }
 
-void database_api_impl::on_objects_new(const vector<object_id_type>& ids, const flat_set<account_uid_type>& impacted_accounts)
+void subscription_registry::dispatch( bool notify_remove_create, bool full_object, const vector<object_id_type>& ids,
+                                      std::function<const flat_set<account_uid_type>&()> impacted_accounts,
+                                      std::function<const object*(object_id_type id)> find_object )
 {
-   handle_object_changed(_notify_remove_create, true, ids, impacted_accounts,
-      std::bind(&object_database::find_object, &_db, std::placeholders::_1)
-   );
+   if( ids.empty() || _sessions.empty() )
+      return;
+
+   // sessions which get every id of this kind of change
+   session_set everything;
+   if( notify_remove_create )
+   {
+      for( const auto& item : _sessions )
+         if( item.second )
+            everything.insert( item.first );
+   }
+   // the impacted accounts are shared by all the ids, a session subscribed to any of them gets all the ids as well
+   if( !_account_sessions.empty() )
+   {
+      for( const auto& uid : impacted_accounts() )
+      {
+         auto itr = _account_sessions.find( uid );
+         if( itr != _account_sessions.end() )
+            everything.insert( itr->second.begin(), itr->second.end() );
+      }
+   }
+
+   std::unordered_map< database_api_impl*, vector<variant> > updates;
+   for( const auto& id : ids )
+   {
+      auto itr = _object_sessions.find( id );
+      if( everything.empty() && itr == _object_sessions.end() )
+         continue;
+
+      // converted once, variant objects are shared between copies
+      variant value;
+      if( full_object )
+      {
+         auto obj = find_object( id );
+         if( obj == nullptr )
+            continue;
+         // with the content of a post, as get_objects() returns it
+         value = api_object_variant( _db, *obj );
+      }
+      else
+         value = fc::variant( id, 1 );
+
+      for( auto session : everything )
+         updates[session].push_back( value );
+      if( itr != _object_sessions.end() )
+      {
+         for( auto session : itr->second )
+            if( everything.find( session ) == everything.end() )
+               updates[session].push_back( value );
+      }
+   }
+
+   for( const auto& item : updates )
+      item.first->broadcast_updates( item.second );
+}
+
+//////////////////////////////////////////////////////////////////////
+//                                                                  //
+// Market depth feed                                                //
+//                                                                  //
+//////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<market_depth_feed> market_depth_feed::get( graphene::chain::database& db )
+{
+   static std::map< const graphene::chain::database*, std::weak_ptr<market_depth_feed> > feeds;
+   auto& feed = feeds[&db];
+   auto result = feed.lock();
+   if( !result )
+   {
+      result = std::make_shared<market_depth_feed>( db );
+      feed = result;
+   }
+   return result;
 }
 
-void database_api_impl::on_objects_changed(const vector<object_id_type>& ids, const flat_set<account_uid_type>& impacted_accounts)
+const limit_order_book_index& market_depth_feed::book()const
 {
-   handle_object_changed(false, true, ids, impacted_accounts,
-      std::bind(&object_database::find_object, &_db, std::placeholders::_1)
-   );
+   return dynamic_cast<const primary_index<limit_order_index>&>( _db.get_index_type<limit_order_index>() )
+            .get_secondary_index<limit_order_book_index>();
 }
 
-void database_api_impl::handle_object_changed(bool force_notify, bool full_object, const vector<object_id_type>& ids, const flat_set<account_uid_type>& impacted_accounts, std::function<const object*(object_id_type id)> find_object)
+void market_depth_feed::add_session( database_api_impl* session, const market_type& market )
 {
-   if( _subscribe_callback )
+   _sessions[market].insert( session );
+   // only track the levels while somebody is subscribed, so that idle nodes cost nothing per order
+   if( !_applied_block_connection.connected() )
    {
-      vector<variant> updates;
-
-      for(auto id : ids)
-      {
-         if( force_notify || is_subscribed_to_item(id) || is_impacted_account(impacted_accounts) )
-         {
-            if( full_object )
-            {
-               auto obj = find_object(id);
-               if( obj )
-               {
-                  updates.emplace_back( obj->to_variant() );
-               }
-            }
-            else
-            {
-               updates.emplace_back( fc::variant( id, 1 ) );
-            }
-         }
-      }
+      book().set_track_changes( true );
+      _applied_block_connection = _db.applied_block.connect([this](const signed_block& b) {
+                                     on_applied_block( b );
+                                     });
+   }
+}
 
-      broadcast_updates(updates);
+void market_depth_feed::remove_session( database_api_impl* session, const market_type& market )
+{
+   auto itr = _sessions.find( market );
+   if( itr == _sessions.end() )
+      return;
+   itr->second.erase( session );
+   if( itr->second.empty() )
+      _sessions.erase( itr );
+   if( _sessions.empty() && _applied_block_connection.connected() )
+   {
+      _applied_block_connection.disconnect();
+      book().set_track_changes( false );
    }
+}
 
+void market_depth_feed::on_applied_block( const signed_block& )
+{
+   // levels changed by popped blocks or pending transactions are taken with the next block, with their amounts
+   // at that time
+   const auto levels = book().take_changed_levels();
+   std::map< market_type, vector<limit_order_book_index::level_type> > changes;
+   for( const auto& level : levels )
+   {
+      const asset_aid_type a = level.first.base.asset_id;
+      const asset_aid_type b = level.first.quote.asset_id;
+      const market_type market( std::min( a, b ), std::max( a, b ) );
+      if( _sessions.find( market ) != _sessions.end() )
+         changes[market].push_back( level );
+   }
+   for( const auto& item : changes )
+   {
+      const uint64_t sequence = ++_sequences[item.first];
+      for( auto session : _sessions[item.first] )
+         session->broadcast_depth_update( item.first, sequence, item.second );
+   }
 }
 
 /** note: this method cannot yield because it is called in the middle of
@@ -40,6 +40,7 @@
 
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -86,7 +87,8 @@ namespace graphene { namespace app {
    class history_api
    {
       public:
-         history_api(application& app) :_app(app), database_api(std::ref(*app.chain_database()), &(app.get_options())){}
+         /// @p db_api is the database API of the connection, the calls are charged to its budget, a new one if null
+         history_api( application& app, std::shared_ptr<graphene::app::database_api> db_api = nullptr );
 
          /**
           * @brief Get operations relevant to the specificed account
@@ -136,6 +138,24 @@ namespace graphene { namespace app {
                                                                                             unsigned limit = 100,
                                                                                             uint32_t start = 0) const;
 
+         /**
+          * @brief Get operations of any of several types relevant to the specified account, like
+          * @ref get_relative_account_history.
+          * @param account The account whose history should be queried
+          * @param op_types Only query for these operation types, all types if empty
+          * @param stop Sequence number of earliest operation
+          * @param limit Maximum number of operations to retrieve (must not exceed 100)
+          * @param start Sequence number of the most recent operation to retrieve, 0 for the most recent operation
+          * @return A list of operations performed by account, with a sequence number for
+          *         each operation, ordered from most recent to oldest.
+          */
+         vector<std::pair<uint32_t,operation_history_object>> get_relative_account_history_by_types(
+                                                                                      account_uid_type account,
+                                                                                      const flat_set<uint16_t>& op_types,
+                                                                                      uint32_t stop = 0,
+                                                                                      unsigned limit = 100,
+                                                                                      uint32_t start = 0) const;
+
          /**
          * @brief Get OHLCV data of a trading pair in a time range
          * @param a Asset symbol or ID in a trading pair
@@ -153,8 +173,36 @@ namespace graphene { namespace app {
          vector<order_history_object> get_fill_order_history(std::string a, std::string b, uint32_t limit)const;
 
       private:
+           /// the operations with an id in (stop, start] of one of @p op_types, or of any type if it's empty
+           vector<operation_history_object> get_account_history_by_op_ids( account_id_type account,
+                                                                           const flat_set<uint16_t>& op_types,
+                                                                           operation_history_id_type start,
+                                                                           operation_history_id_type stop,
+                                                                           unsigned limit )const;
+
+           /// runs @p read through the database API of the connection, see database_api::read_state()
+           template<typename Read>
+           auto read_state( const char* method, Read&& read )const -> decltype( read() )
+           {
+              optional<decltype( read() )> result;
+              _database_api->read_state( method, [&]() { result = read(); } );
+              return std::move( *result );
+           }
+
            application& _app;
-           graphene::app::database_api database_api;
+           std::shared_ptr<graphene::app::database_api> _database_api;
+   };
+
+   /**
+    * @brief Serialized blocks of a range as they are stored in the block database
+    */
+   struct raw_block_range
+   {
+      uint32_t                 first_block_num = 0;
+      /// entry i is the entry of block first_block_num + i, its block_pos is the offset of the block in blocks
+      vector<index_entry>      entries;
+      /// the packed blocks, back to back
+      vector<char>             blocks;
    };
 
    /**
@@ -167,6 +215,32 @@ namespace graphene { namespace app {
       ~block_api();
 
       vector<optional<signed_block>> get_blocks(uint32_t block_num_from, uint32_t block_num_to)const;
+      /**
+       * @brief Get the serialized blocks of a range, without converting them to JSON
+       * @return the packed bytes of each block, in hex, or null for a block that doesn't exist
+       *
+       * Irreversible blocks are copied from the block database as they are stored.
+       */
+      vector<optional<vector<char>>> get_raw_blocks(uint32_t block_num_from, uint32_t block_num_to)const;
+      /**
+       * @brief Get the index entries and the packed bytes of a range of irreversible blocks in one buffer
+       * @param block_num_from first block of the range
+       * @param limit maximum number of blocks to return, at most 1000
+       *
+       * The range stops at the last irreversible block, so the blocks returned are never switched. Entries of blocks
+       * that aren't stored have a block_size of 0.
+       */
+      raw_block_range get_raw_block_range(uint32_t block_num_from, uint32_t limit)const;
+      /**
+       * @brief Get the changes of the object database made by the blocks after a block, for replica nodes
+       * @param after the head block of the replica
+       * @param limit maximum number of blocks to return, at most 100
+       *
+       * Only the changes of the last blocks are kept, see the state-diffs-kept option. When @p after was switched
+       * away the changes start after the last irreversible block, the replica pops its blocks from there on. Empty
+       * when the changes that follow @p after aren't kept any more.
+       */
+      vector<state_diff> get_state_diffs(const block_id_type& after, uint32_t limit)const;
 
    private:
       graphene::chain::database& _db;
@@ -265,6 +339,12 @@ namespace graphene { namespace app {
           */
          std::vector<net::potential_peer_record> get_potential_peers() const;
 
+         /**
+          * @brief Get p2p metrics for monitoring: message counts and bytes by type, per-peer queue depth and
+          *        round trip delay, inventory sizes and node delegate call latency histograms
+          */
+         fc::variant_object get_metrics() const;
+
       private:
          application& _app;
    };
@@ -313,15 +393,23 @@ namespace graphene { namespace app {
    class asset_api
    {
       public:
-         asset_api(graphene::chain::database& db);
+         asset_api(graphene::chain::database& db, const application_options* app_options = nullptr);
          ~asset_api();
 
-         vector<account_asset_balance> get_asset_holders( asset_aid_type asset_id )const;
+         /**
+          * @brief Get the accounts holding an asset, largest balances first
+          * @param asset_id the asset
+          * @param start number of holders to skip
+          * @param limit maximum number of holders to return, at most api-limit-get-asset-holders
+          */
+         vector<account_asset_balance> get_asset_holders( asset_aid_type asset_id, uint32_t start, uint32_t limit )const;
+         /// @return number of accounts with a balance of the asset which is not zero
          uint64_t get_asset_holders_count( asset_aid_type asset_id )const;
          vector<asset_holders> get_all_asset_holders() const;
 
       private:
          graphene::chain::database& _db;
+         const application_options* _app_options;
    };
 
    /**
@@ -366,7 +454,11 @@ namespace graphene { namespace app {
          void enable_api( const string& api_name );
       private:
 
+         /// the database API of the connection, created with the first API reading the state through it
+         std::shared_ptr<database_api> session_database_api();
+
          application& _app;
+         std::shared_ptr<database_api> _session_database_api;
          optional< fc::api<block_api> > _block_api;
          optional< fc::api<database_api> > _database_api;
          optional< fc::api<network_broadcast_api> > _network_broadcast_api;
@@ -390,16 +482,21 @@ FC_REFLECT( graphene::app::verify_range_proof_rewind_result,
 
 FC_REFLECT( graphene::app::account_asset_balance, (account_uid)(amount) );
 FC_REFLECT( graphene::app::asset_holders, (asset_id)(count) );
+FC_REFLECT( graphene::app::raw_block_range, (first_block_num)(entries)(blocks) );
 
 FC_API(graphene::app::history_api,
        //(get_account_history)
        //(get_account_history_operations)
        (get_relative_account_history)
+       (get_relative_account_history_by_types)
        (get_market_history)
        (get_fill_order_history)
      )
 FC_API(graphene::app::block_api,
        (get_blocks)
+       (get_raw_blocks)
+       (get_raw_block_range)
+       (get_state_diffs)
      )
 FC_API(graphene::app::network_broadcast_api,
        (broadcast_transaction)
@@ -413,6 +510,7 @@ FC_API(graphene::app::network_node_api,
        (get_potential_peers)
        (get_advanced_node_parameters)
        (set_advanced_node_parameters)
+       (get_metrics)
      )
 FC_API(graphene::app::crypto_api,
        (blind_sign)
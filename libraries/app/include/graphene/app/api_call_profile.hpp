@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/types.hpp>
+
+#include <fc/time.hpp>
+
+#include <map>
+#include <mutex>
+
+namespace graphene { namespace utilities {
+   class metrics_registry;
+   class metric_counter;
+   class metric_histogram;
+} }
+
+namespace graphene { namespace app {
+
+   using std::string;
+
+   /**
+    *  @brief Calls of one database API method, with the time they waited and the time they ran, in microseconds.
+    */
+   struct api_call_profile
+   {
+      string   method;
+      uint64_t count = 0;
+      /// of the count calls, the ones which threw
+      uint64_t failed = 0;
+      /// waiting for the previous call of the same session and for an API thread
+      uint64_t queued_us = 0;
+      uint64_t run_us = 0;
+      uint64_t max_run_us = 0;
+   };
+
+   /**
+    *  @brief Collects the api_call_profile of every database API method called since the node started.
+    *
+    *  The profiler is locked internally, the calls are recorded by the sessions and read from any thread.
+    */
+   class api_call_profiler
+   {
+      public:
+         void record( const char* method, fc::microseconds queued, fc::microseconds run, bool failed );
+
+         /// @return the profiles of the methods which were called, ordered by name
+         std::vector<api_call_profile> get_profiles()const;
+         void reset();
+
+         /// Also exports the calls to @p metrics from now on: the time they ran and the failures by method, and the
+         /// time they were queued
+         void set_metrics( graphene::utilities::metrics_registry* metrics );
+
+      private:
+         struct method_metrics
+         {
+            graphene::utilities::metric_histogram* run_seconds;
+            graphene::utilities::metric_counter*   failures;
+         };
+
+         mutable std::mutex                     _mutex;
+         std::map<string,api_call_profile>      _profiles;
+         graphene::utilities::metrics_registry* _metrics = nullptr;
+         graphene::utilities::metric_histogram* _queued_seconds = nullptr;
+         std::map<string,method_metrics>        _method_metrics;
+   };
+
+   /**
+    *  @brief Times one call, from its creation to started() and from there to done(), and records it on destruction.
+    *
+    *  A call destroyed before done() was called is recorded as failed. Nothing is recorded without a profiler.
+    */
+   class api_call_timer
+   {
+      public:
+         api_call_timer( api_call_profiler* profiler, const char* method )
+         : _profiler( profiler ), _method( method ), _created( fc::time_point::now() ), _started( _created ) {}
+         ~api_call_timer();
+
+         void started() { _started = fc::time_point::now(); }
+         void done() { _finished = fc::time_point::now(); }
+         /// the time the call ran, up to now if it isn't done
+         fc::microseconds run_time()const { return ( _finished.valid() ? *_finished : fc::time_point::now() ) - _started; }
+
+      private:
+         api_call_profiler*           _profiler;
+         const char*                  _method;
+         fc::time_point               _created;
+         fc::time_point               _started;
+         fc::optional<fc::time_point> _finished;
+   };
+
+   /**
+    *  @brief A token bucket of API thread time, in microseconds, refilled at a fixed rate up to a burst.
+    *
+    *  Every call of a session is charged the time it ran, which is what the rows it scanned and the results it built
+    *  cost. A session in debt has its calls rejected until the bucket is refilled. A rate of 0 admits everything.
+    */
+   class api_call_budget
+   {
+      public:
+         api_call_budget( uint64_t rate_us_per_second = 0, uint64_t burst_us = 0 );
+
+         /// throws if the bucket is empty, with the time to wait before calling again
+         void admit( const char* method, fc::time_point now = fc::time_point::now() );
+         void charge( fc::microseconds cost );
+         int64_t available_us( fc::time_point now = fc::time_point::now() );
+
+      private:
+         void refill( fc::time_point now );
+
+         uint64_t       _rate_us_per_second;
+         int64_t        _burst_us;
+         int64_t        _available_us;
+         fc::time_point _last_refill;
+   };
+
+} } // graphene::app
+
+FC_REFLECT( graphene::app::api_call_profile, (method)(count)(failed)(queued_us)(run_us)(max_run_us) )
@@ -24,8 +24,10 @@
 #pragma once
 
 #include <graphene/app/api_access.hpp>
+#include <graphene/app/block_feed.hpp>
 #include <graphene/net/node.hpp>
 #include <graphene/chain/database.hpp>
+#include <graphene/chain/account_history_store.hpp>
 
 #include <boost/program_options.hpp>
 
@@ -34,6 +36,8 @@ namespace graphene { namespace app {
    using std::string;
 
    class abstract_plugin;
+   class object_change_feed;
+   class api_call_profiler;
 
    class application_options
    {
@@ -48,6 +52,16 @@ namespace graphene { namespace app {
       uint64_t api_limit_get_asset_holders = 100;
       uint64_t api_limit_get_key_references = 100;
       uint64_t api_limit_get_htlc_by = 100;
+      /// threads serving the read-only database API calls beside the chain thread, none when null
+      graphene::utilities::thread_pool* api_thread_pool = nullptr;
+      /// the calls of the read-only database API methods, not recorded when null
+      api_call_profiler* api_calls = nullptr;
+      /// API thread time each session may use per second, in microseconds, and how much it may save up, see
+      /// api_call_budget, 0 for no limit
+      uint64_t api_budget_us_per_second = 0;
+      uint64_t api_budget_burst_us = 0;
+      /// the log of the object changes, disabled when null
+      const object_change_feed* object_changes = nullptr;
    };
 
    class application
@@ -96,6 +110,14 @@ namespace graphene { namespace app {
 
          net::node_ptr                    p2p_node();
          std::shared_ptr<chain::database> chain_database()const;
+         const fc::path&                  data_dir()const;
+
+         /// Set by the account_history plugin when it keeps the account histories on disk, for history_api
+         void set_account_history_store( std::shared_ptr<chain::account_history_store> store );
+         std::shared_ptr<chain::account_history_store> get_account_history_store()const;
+
+         /// The feed plugins running on their own threads subscribe to, null unless async-plugins is set
+         block_feed* get_block_feed()const;
 
          void set_block_production(bool producing_blocks);
          fc::optional< api_access_info > get_api_access_info( const string& username )const;
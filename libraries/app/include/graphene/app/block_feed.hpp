@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/operation_history_object.hpp>
+
+#include <fc/thread/thread.hpp>
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace graphene { namespace app {
+   using namespace graphene::chain;
+
+   /**
+    * @brief What applying a block did, as handed to the subscribers of a @ref block_feed
+    *
+    * It's built on the chain thread once the block is applied and never modified afterwards, so subscribers can
+    * read it from their own threads. They must not read the database.
+    */
+   struct applied_block_changes
+   {
+      signed_block                                 block;
+      uint32_t                                     block_num = 0;
+      uint32_t                                     last_irreversible_block_num = 0;
+      /// shared with the database, see database::share_applied_operations()
+      database::applied_operations_ptr             applied_operations
+            = std::make_shared< const vector< optional<operation_history_object> > >();
+      /// accounts impacted by each of applied_operations, see database::get_applied_operations_impacted_accounts()
+      database::applied_operations_impacted_ptr    impacted_accounts
+            = std::make_shared< const vector< flat_set<account_uid_type> > >();
+      /// left empty when the block was applied without undo history, e.g. early in a replay
+      vector<object_id_type>                       new_ids;
+      vector<object_id_type>                       changed_ids;
+      vector<object_id_type>                       removed_ids;
+   };
+   typedef std::shared_ptr<const applied_block_changes> applied_block_changes_ptr;
+
+   /**
+    * @brief Hands the changes of every applied block to subscribers running on their own threads
+    *
+    * Each subscriber gets the blocks in the order they were applied, after the subscribers it depends on are done
+    * with them. A subscriber may fall behind by a bounded number of blocks, after that the chain thread waits for
+    * it before going on with the next block.
+    */
+   class block_feed
+   {
+      public:
+         typedef std::function<void(const applied_block_changes&)> handler_type;
+
+         static const uint32_t default_max_queued_blocks = 16;
+
+         explicit block_feed( uint32_t max_queued_blocks = default_max_queued_blocks );
+         ~block_feed();
+
+         /**
+          * Adds a subscriber, before the database is opened. Dependencies which never subscribe are ignored.
+          * @param name name of the subscriber, usually the plugin name
+          * @param dependencies names of the subscribers which must be done with a block before this one gets it
+          * @param handler called with each block, on the thread of the subscriber
+          */
+         void subscribe( const std::string& name, const vector<std::string>& dependencies, handler_type handler );
+         bool empty()const { return _subscribers.empty(); }
+         /// Restricts the threads of the subscribers to @p cpus, takes effect when they are started
+         void set_cpus( const vector<uint32_t>& cpus ) { _cpus = cpus; }
+
+         /// Feeds the blocks applied by @p db from now on
+         void connect( chain::database& db );
+         /// Hands @p changes to the subscribers, waiting for the ones which are too far behind
+         void push( const applied_block_changes_ptr& changes );
+         /// Waits until every subscriber is done with every block pushed so far
+         void flush();
+
+      private:
+         struct subscriber
+         {
+            std::string                            name;
+            vector<std::string>                    dependency_names;
+            vector<size_t>                         dependencies;
+            handler_type                           handler;
+            std::unique_ptr<fc::thread>            thread;
+            std::deque< std::shared_future<void> > queued;
+         };
+
+         /// orders the subscribers so that dependencies come first, and starts their threads
+         void start();
+         applied_block_changes_ptr collect_changes( const chain::database& db, const signed_block& b )const;
+
+         uint32_t                                  _max_queued_blocks;
+         bool                                      _started = false;
+         vector<uint32_t>                          _cpus;
+         vector< std::unique_ptr<subscriber> >     _subscribers;
+         boost::signals2::scoped_connection        _applied_block_connection;
+   };
+
+} } // graphene::app
@@ -23,7 +23,10 @@
  */
 #pragma once
 
+#include <graphene/app/api_call_profile.hpp>
 #include <graphene/app/full_account.hpp>
+#include <graphene/app/json_stream.hpp>
+#include <graphene/app/object_change_feed.hpp>
 
 #include <graphene/chain/protocol/types.hpp>
 
@@ -34,6 +37,7 @@
 #include <graphene/chain/chain_property_object.hpp>
 #include <graphene/chain/committee_member_object.hpp>
 #include <graphene/chain/csaf_object.hpp>
+#include <graphene/chain/object_counts.hpp>
 #include <graphene/chain/operation_history_object.hpp>
 #include <graphene/chain/proposal_object.hpp>
 #include <graphene/chain/witness_object.hpp>
@@ -78,6 +82,23 @@ struct order_book
    vector< order >             asks;
 };
 
+/**
+ * The amounts for sale at each price of a market, see database_api::get_market_depth(), or the levels of a market
+ * changed by a block, see database_api::subscribe_to_market_depth()
+ */
+struct market_depth
+{
+   asset_aid_type             base;
+   asset_aid_type             quote;
+   /// number of the last update of the market included, counted per market
+   uint64_t                   sequence = 0;
+   uint32_t                   head_block_num = 0;
+   /// levels of the orders selling base, best first, with the amount of base for sale; 0 when a level is gone
+   vector< pair<price, share_type> > bids;
+   /// levels of the orders selling quote, best first, with the amount of quote for sale; 0 when a level is gone
+   vector< pair<price, share_type> > asks;
+};
+
 struct market_ticker
 {
    time_point_sec             time;
@@ -128,6 +149,19 @@ struct required_fee_data
    int64_t          min_real_fee;
 };
 
+/// What a transaction needs before it can be broadcast, see database_api::get_transaction_requirements()
+struct transaction_requirements
+{
+   /// the available keys which are enough to sign the transaction
+   flat_set<public_key_type>  usable_keys;
+   /// the keys still needed, beside the available ones
+   flat_set<public_key_type>  missing_keys;
+   /// the signatures of the transaction which are not needed
+   flat_set<signature_type>   redundant_signatures;
+   /// the fees of the operations, in order
+   vector<required_fee_data>  fees;
+};
+
 struct full_account_query_options
 {
    optional<bool> fetch_account_object;
@@ -143,6 +177,7 @@ struct full_account_query_options
    optional<bool> fetch_platform_votes;
    optional<bool> fetch_assets;
    optional<bool> fetch_balances;
+   optional<bool> fetch_pledges;
 };
 
 enum data_sorting_type
@@ -171,6 +206,17 @@ struct asset_object_with_data : public asset_object
    asset_dynamic_data_object dynamic_asset_data;
 };
 
+/// A page of a list of objects, see database_api::list_objects_page()
+struct object_page
+{
+   /// the objects, with only the requested fields if any were
+   vector<variant> objects;
+   /// to pass to get the next page, empty after the last page
+   string          next_cursor;
+   /// the head block the page was read at
+   uint32_t        head_block_num = 0;
+};
+
 struct Platform_Period_Profit_Detail
 {
     uint32_t                               cur_period;
@@ -223,6 +269,51 @@ class database_api
        */
       fc::variants get_objects(const vector<object_id_type>& ids)const;
 
+      /**
+       * @brief Get the objects corresponding to the provided IDs as they were at the end of a block
+       * @param ids IDs of the objects to retrieve
+       * @param block_num Number of the block, from the last irreversible block to the head block, or from the
+       *        start of the object archive on nodes running with object-archive enabled
+       * @return The objects retrieved, in the order they are mentioned in ids
+       *
+       * Calls pinned to the same block keep returning the same objects while new blocks are applied, until the
+       * block becomes irreversible, or for good with the object archive. The changes of pending transactions are
+       * left out. If any of the provided IDs did not map to an object then, a null variant is returned in its
+       * position.
+       */
+      fc::variants get_objects_at_block(const vector<object_id_type>& ids, uint32_t block_num)const;
+
+      /**
+       * @brief Get the objects created, modified and removed since a point of the object change log
+       * @param from_sequence Sequence number of the first change to return, the next_sequence of the last page
+       * @param limit Maximum number of changes to return, at most 1000
+       * @return The changes, and where to go on from
+       *
+       * The log is only kept when the node runs with object-change-log-size. When the first_sequence of the page is
+       * above from_sequence, older changes were dropped and the objects have to be scanned again.
+       */
+      object_changes_page get_object_changes(uint64_t from_sequence, uint32_t limit)const;
+
+      /**
+       * @brief Get a page of one of the lists of objects
+       * @param list Name of the list, with its arguments in parentheses:
+       *             "posts_by_platform" (platform), "posts_by_platform_poster" (platform, poster),
+       *             "post_feed" (platform) newest first, if the node keeps the post_feed non-consensus index,
+       *             "scores" (platform, poster, post_pid), "licenses" (platform),
+       *             "advertising_orders_by_purchaser" (purchaser), "cast_custom_votes_by_voter" (voter)
+       * @param args The arguments of the list
+       * @param cursor Empty for the first page, the next_cursor of the previous page otherwise
+       * @param limit Maximum number of objects to return, at most 100
+       * @param fields Names of the fields of the objects to return, all fields if empty
+       * @return The page of the list, in the order of the matching list call
+       *
+       * The cursor holds the position of the next page, so every page takes a single lookup however far into the
+       * list it is. A cursor stays valid while blocks are applied, the objects added or removed meanwhile before
+       * its position are skipped.
+       */
+      object_page list_objects_page(const string& list, const fc::variants& args, const string& cursor,
+                                    uint32_t limit, const vector<string>& fields)const;
+
       ///////////////////
       // Subscriptions //
       ///////////////////
@@ -304,12 +395,66 @@ class database_api
        */
       dynamic_global_property_object get_dynamic_global_properties()const;
 
+      ///////////////
+      // Profiling //
+      ///////////////
+
+      /**
+       * @brief Get the time spent in the evaluators of each operation type, and the objects they changed
+       * @return the profiles of the operation types this node applied since it started or the profile was last
+       *         logged, see the evaluation-profile-log-interval option
+       */
+      vector<operation_profile> get_evaluation_profile()const;
+
+      /**
+       * @brief Get the time spent in each phase of applying the last blocks
+       * @param limit Maximum number of blocks to return, at most 1000
+       * @return the profiles of the last blocks this node applied, the latest first
+       */
+      vector<block_profile> get_block_profiles( uint32_t limit )const;
+
+      /**
+       * @brief Get how long after their slot time the last blocks of each witness were signed or received
+       * @return histograms in milliseconds of the blocks this node signed and the blocks it received outside of
+       *         syncing, per witness, ordered by witness, see the slot-timings-kept option
+       */
+      vector<witness_slot_timing> get_witness_slot_timings()const;
+
+      /**
+       * @brief Get the number of undo states kept for the reversible blocks and an estimate of their memory
+       */
+      undo_database_stats get_undo_database_stats()const;
+
+      /**
+       * @brief Get the number and the duration of the switches to other forks this node did since it started
+       */
+      fork_switch_stats get_fork_switch_stats()const;
+
+      /**
+       * @brief Get the number, size and age of the pending transactions, the time this node took to apply them
+       *        again after each block and the reasons the transactions pushed to it were rejected
+       */
+      pending_transaction_stats get_pending_transaction_stats()const;
+
+      /**
+       * @brief Get the number of calls of each read-only database API method, the time they waited and ran
+       * @return the profiles of the methods called on this node since it started, ordered by name
+       */
+      vector<api_call_profile> get_api_call_profile()const;
+
       //////////
       // Keys //
       //////////
 
       vector<vector<account_uid_type>> get_key_references( vector<public_key_type> key )const;
 
+      /**
+       * @brief Get the accounts which refer to any of some keys in their authorities
+       * @param keys the keys, at most api-limit-get-key-references
+       * @return the uids of the accounts, each one once
+       */
+      flat_set<account_uid_type> get_key_account_uids( const vector<public_key_type>& keys )const;
+
      /**
       * Determine whether a textual representation of a public key
       * (in Base-58 format) is *currently* linked
@@ -366,6 +511,18 @@ class database_api
       std::map<account_uid_type,full_account> get_full_accounts_by_uid( const vector<account_uid_type>& uids,
                                                                         const full_account_query_options& options );
 
+      /**
+       * @brief Fetch the requested sections of the specified accounts
+       * @param uids Each item must be the UID of an account to retrieve, repeated ones are fetched once
+       * @param options Which sections to fetch
+       * @return Map of uid to an object with only the fields of @ref full_account selected in @ref options
+       *
+       * Same as @ref get_full_accounts_by_uid but the sections which were not asked for are left out of the result
+       * instead of being returned empty.
+       */
+      std::map<account_uid_type,fc::variant_object> get_full_account_sections( const vector<account_uid_type>& uids,
+                                                                               const full_account_query_options& options );
+
       vector<pledge_balance_object> get_account_core_asset_pledge(account_uid_type account_uid)const;
 
       account_statistics_object get_account_statistics_by_uid(account_uid_type uid)const;
@@ -500,6 +657,13 @@ class database_api
        */
       uint64_t get_platform_count()const;
 
+      /**
+       * @brief Get the latest awards by votes of a platform
+       * @param platform uid of the platform owner
+       * @return The awards, oldest first
+       */
+      vector<platform_vote_profit_object> get_platform_vote_profits(account_uid_type platform)const;
+
       /**
        * @brief Get a post
        * @param platform_owner uid of the platform
@@ -528,6 +692,19 @@ class database_api
                                        const uint32_t         limit,
                                        const bool             list_cur_period = true)const;
 
+      /**
+       * @brief Get the number of scores of a post, and the sums of their csaf and of their csaf * score
+       * @param platform uid of the platform
+       * @param poster_uid uid of the poster
+       * @param post_pid pid of the post
+       * @param cur_period true for the scores of the current award period only, false for all unexpired scores
+       * @return The totals, kept up to date as the scores are created and expire, so no scores are read
+       */
+      post_score_totals get_post_score_totals(const account_uid_type platform,
+                                              const account_uid_type poster_uid,
+                                              const post_pid_type    post_pid,
+                                              const bool             cur_period = true)const;
+
       optional<license_object> get_license(const account_uid_type platform,
                                            const license_lid_type license_lid)const;
 
@@ -566,6 +743,17 @@ class database_api
                                                                         const uint32_t         lower_bound_index,
                                                                         uint32_t               limit)const;
 
+      /**
+       * @brief List the receipts of the accounts from an active post
+       * @param active_post ID of the active post
+       * @param lower_bound_receiptor Lower bound of the first receiptor to return
+       * @param limit Maximum number of results to return -- must not exceed 100
+       * @return The receipts ordered by receiptor
+       */
+      vector<active_post_receiptor_object> list_active_post_receiptors(const active_post_id_type active_post,
+                                                                       const account_uid_type lower_bound_receiptor,
+                                                                       uint32_t limit)const;
+
       vector<Poster_Period_Profit_Detail> get_poster_profits_detail(const uint32_t         begin_period,
                                                                     const uint32_t         end_period,
                                                                     const account_uid_type poster,
@@ -693,6 +881,37 @@ class database_api
       */
       void unsubscribe_from_market(const std::string& a, const std::string& b);
 
+      /**
+      * @brief Returns the levels of the market base:quote, with the amounts of all orders at each price summed up
+      * @param base symbol or ID of the base asset
+      * @param quote symbol or ID of the quote asset
+      * @param limit number of levels of each side, capped at 500
+      * @return the depth, numbered with the last update of subscribe_to_market_depth() it includes
+      *
+      * Unlike get_order_book() the levels are kept up to date by the chain and aren't gathered from the orders.
+      */
+      market_depth get_market_depth(const string& base, const string& quote, uint32_t limit = 50)const;
+
+      /**
+      * @brief Request the levels of the market between two assets changed by each block
+      * @param callback called with a market_depth holding only the changed levels of the market
+      * @param base symbol or ID of the base asset
+      * @param quote symbol or ID of the quote asset
+      *
+      * The updates of a market are numbered one after the other. A client subscribes first, then gets a snapshot
+      * with get_market_depth() and applies the updates numbered after the snapshot; a gap in the numbers means
+      * an update was missed and a new snapshot is needed.
+      */
+      void subscribe_to_market_depth(std::function<void(const variant&)> callback,
+         const std::string& base, const std::string& quote);
+
+      /**
+      * @brief Unsubscribe from the depth updates of a given market
+      * @param base symbol or ID of the base asset
+      * @param quote symbol or ID of the quote asset
+      */
+      void unsubscribe_from_market_depth(const std::string& base, const std::string& quote);
+
       /**
       * @brief Returns the ticker for the market assetA:assetB
       * @param a String name of the first asset
@@ -876,6 +1095,16 @@ class database_api
        */
       vector< required_fee_data > get_required_fee_data( const vector<operation>& ops )const;
 
+      /**
+       * The signatures and fees of many transactions at once, as @ref get_required_signatures and
+       * @ref get_required_fee_data would give them. The transactions are checked in parallel on the chain workers,
+       * all against the same state.
+       * @param trxs the transactions, at most 100
+       * @param available_keys the keys the transactions can be signed with
+       */
+      vector<transaction_requirements> get_transaction_requirements( const vector<signed_transaction>& trxs,
+                                                                     const flat_set<public_key_type>& available_keys )const;
+
       ///////////////////////////
       // Proposed transactions //
       ///////////////////////////
@@ -884,6 +1113,13 @@ class database_api
        *  @return the set of proposed transactions relevant to the specified account id.
        */
       vector<proposal_object> get_proposed_transactions( account_uid_type uid )const;
+
+      /**
+       * Runs @p read the way the read-only methods of this API run: on the API threads under the state lock,
+       * recorded as @p method in the API call profile and charged to the API budget of this session. Not reflected,
+       * the other APIs of a connection read the state through the database API of the connection.
+       */
+      void read_state( const char* method, const std::function<void()>& read )const;
   
    private:
       std::shared_ptr< database_api_impl > my;
@@ -893,12 +1129,16 @@ class database_api
 
 FC_REFLECT(graphene::app::order, (price)(quote)(base));
 FC_REFLECT(graphene::app::order_book, (base)(quote)(bids)(asks));
+FC_REFLECT(graphene::app::market_depth, (base)(quote)(sequence)(head_block_num)(bids)(asks));
 FC_REFLECT(graphene::app::market_ticker,
            (time)(base)(quote)(latest)(lowest_ask)(highest_bid)(percent_change)(base_volume)(quote_volume));
 FC_REFLECT(graphene::app::market_volume, (time)(base)(quote)(base_volume)(quote_volume));
 FC_REFLECT(graphene::app::market_trade, (sequence)(date)(price)(amount)(value)(side1_account_id)(side2_account_id));
 
 FC_REFLECT( graphene::app::required_fee_data, (fee_payer_uid)(min_fee)(min_real_fee) );
+FC_REFLECT( graphene::app::transaction_requirements, (usable_keys)(missing_keys)(redundant_signatures)(fees) );
+
+FC_REFLECT( graphene::app::object_page, (objects)(next_cursor)(head_block_num) );
 
 FC_REFLECT( graphene::app::full_account_query_options,
             (fetch_account_object)
@@ -914,6 +1154,7 @@ FC_REFLECT( graphene::app::full_account_query_options,
             (fetch_platform_votes)
             (fetch_assets)
             (fetch_balances)
+            (fetch_pledges)
           );
 
 FC_REFLECT(graphene::app::Platform_Period_Profit_Detail,
@@ -934,6 +1175,12 @@ FC_REFLECT(graphene::app::Poster_Period_Profit_Detail,
           (total_post_award)
           (active_objects));
 
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::app::object_page )
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::app::Platform_Period_Profit_Detail )
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::app::Poster_Period_Profit_Detail )
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::chain::transaction )
+GRAPHENE_JSON_STREAM_MEMBERS( graphene::chain::signed_transaction )
+
 FC_REFLECT_ENUM( graphene::app::data_sorting_type,
                  (order_by_uid)
                  (order_by_votes)
@@ -949,6 +1196,9 @@ FC_REFLECT_DERIVED( graphene::app::asset_object_with_data, (graphene::chain::ass
 FC_API( graphene::app::database_api,
    // Objects
    (get_objects)
+   (get_objects_at_block)
+   (get_object_changes)
+   (list_objects_page)
 
    // Subscriptions
    (set_subscribe_callback)
@@ -970,8 +1220,18 @@ FC_API( graphene::app::database_api,
    (get_chain_id)
    (get_dynamic_global_properties)
 
+   // Profiling
+   (get_evaluation_profile)
+   (get_block_profiles)
+   (get_witness_slot_timings)
+   (get_undo_database_stats)
+   (get_fork_switch_stats)
+   (get_pending_transaction_stats)
+   (get_api_call_profile)
+
    // Keys
    (get_key_references)
+   (get_key_account_uids)
    (is_public_key_registered)
 
    // Accounts
@@ -979,6 +1239,7 @@ FC_API( graphene::app::database_api,
    (get_accounts_by_uid)
    //(get_full_accounts)
    (get_full_accounts_by_uid)
+   (get_full_account_sections)
    (get_account_core_asset_pledge)
    (get_account_statistics_by_uid)
    (compute_coin_seconds_earned)
@@ -1000,18 +1261,21 @@ FC_API( graphene::app::database_api,
    (get_platform_by_account)
    (lookup_platforms)
    (get_platform_count)
+   (get_platform_vote_profits)
    (get_post)
    (get_posts_by_platform_poster)
    (get_posts_count)
    (get_score)
    (get_scores_by_uid)
    (list_scores)
+   (get_post_score_totals)
    (get_license)
    (list_licenses)
    (get_advertising)
    (list_advertisings)
    (get_post_profits_detail)
    (get_platform_profits_detail)
+   (list_active_post_receiptors)
    (get_poster_profits_detail)
    (get_score_profit)
 
@@ -1037,6 +1301,9 @@ FC_API( graphene::app::database_api,
    (get_account_all_limit_orders)
    (subscribe_to_market)
    (unsubscribe_from_market)
+   (get_market_depth)
+   (subscribe_to_market_depth)
+   (unsubscribe_from_market_depth)
    (get_ticker)
    (get_24_volume)
    (get_order_book)
@@ -1066,6 +1333,7 @@ FC_API( graphene::app::database_api,
    //(validate_transaction)
    //(get_required_fees)
    (get_required_fee_data)
+   (get_transaction_requirements)
 
    // Proposed transactions
    //(get_proposed_transactions)
@@ -51,6 +51,7 @@ namespace graphene { namespace app {
       vector<account_uid_type>         platform_votes;
       vector<asset_aid_type>           assets;
       vector<account_balance_object>   balances;
+      vector<pledge_balance_object>    pledges;
    };
 
 } }
@@ -73,4 +74,5 @@ FC_REFLECT( graphene::app::full_account,
             (platform_votes)
             (assets)
             (balances)
+            (pledges)
           )
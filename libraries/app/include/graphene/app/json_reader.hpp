@@ -0,0 +1,433 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/app/json_stream.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/variant.hpp>
+
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @file
+ * Reads JSON straight into the values it describes, without building an fc::variant tree of the whole text and
+ * converting it afterwards, the counterpart of json_stream.hpp.
+ *
+ * The structs marked with @ref GRAPHENE_JSON_STREAM_MEMBERS are read member by member, and so are vectors,
+ * optionals, strings, booleans and integers. Any other value, such as an operation, a key or a time, is cut out of
+ * the text and converted through fc::variant on its own, so the result is the same as fc::json::from_string()
+ * followed by as<T>(): unknown members are skipped and missing ones keep their default values.
+ *
+ * The strings are scanned 16 bytes at a time for their end where SSE2 is available.
+ */
+
+namespace graphene { namespace app {
+
+   /// The position in a JSON text being read by read_json()
+   class json_reader
+   {
+      public:
+         json_reader( const char* begin, const char* end ) : _begin( begin ), _pos( begin ), _end( end ) {}
+         explicit json_reader( const std::string& text ) : json_reader( text.data(), text.data() + text.size() ) {}
+
+         /// @return the next character after the whitespace, 0 at the end of the text
+         char peek()
+         {
+            while( _pos < _end && ( *_pos == ' ' || *_pos == '\n' || *_pos == '\r' || *_pos == '\t' ) )
+               ++_pos;
+            return _pos < _end ? *_pos : 0;
+         }
+         /// Consumes @p c if it is the next character
+         bool accept( char c )
+         {
+            if( peek() != c )
+               return false;
+            ++_pos;
+            return true;
+         }
+         void expect( char c )
+         {
+            FC_ASSERT( accept( c ), "Expected '${c}' at offset ${o} of the JSON text",
+                       ("c",std::string( 1, c ))("o",offset()) );
+         }
+         bool accept_literal( const char* literal )
+         {
+            peek();
+            const size_t size = std::char_traits<char>::length( literal );
+            if( size_t( _end - _pos ) < size || std::char_traits<char>::compare( _pos, literal, size ) != 0 )
+               return false;
+            _pos += size;
+            return true;
+         }
+         bool at_end() { return peek() == 0; }
+         size_t offset()const { return _pos - _begin; }
+
+         std::string read_string()
+         {
+            expect( '"' );
+            std::string result;
+            while( true )
+            {
+               const char* special = find_quote_or_backslash( _pos, _end );
+               FC_ASSERT( special < _end, "Unterminated string in the JSON text" );
+               result.append( _pos, special );
+               _pos = special + 1;
+               if( *special == '"' )
+                  return result;
+               read_escape( result );
+            }
+         }
+
+         /// @return the text of a number, which may also be given as a string like fc writes the big integers
+         std::string read_number()
+         {
+            if( peek() == '"' )
+               return read_string();
+            const char* start = _pos;
+            while( _pos < _end && ( ( *_pos >= '0' && *_pos <= '9' ) || *_pos == '-' || *_pos == '+'
+                                    || *_pos == '.' || *_pos == 'e' || *_pos == 'E' ) )
+               ++_pos;
+            FC_ASSERT( _pos > start, "Expected a number at offset ${o} of the JSON text", ("o",offset()) );
+            return std::string( start, _pos );
+         }
+
+         /// Skips the next value, @return its text
+         std::string skip_value( uint32_t max_depth )
+         {
+            const char c = peek();
+            const char* start = _pos;
+            if( c == '"' )
+               skip_string();
+            else if( c == '{' || c == '[' )
+            {
+               uint32_t depth = 0;
+               do
+               {
+                  FC_ASSERT( _pos < _end, "Unterminated JSON value" );
+                  const char d = *_pos;
+                  if( d == '"' )
+                     skip_string();
+                  else
+                  {
+                     if( d == '{' || d == '[' )
+                        FC_ASSERT( ++depth <= max_depth, "Recursion depth exceeded" );
+                     else if( d == '}' || d == ']' )
+                        --depth;
+                     ++_pos;
+                  }
+               } while( depth > 0 );
+            }
+            else
+            {
+               while( _pos < _end && *_pos != ',' && *_pos != '}' && *_pos != ']' && *_pos != ' '
+                      && *_pos != '\n' && *_pos != '\r' && *_pos != '\t' )
+                  ++_pos;
+               FC_ASSERT( _pos > start, "Expected a value at offset ${o} of the JSON text", ("o",offset()) );
+            }
+            return std::string( start, _pos );
+         }
+
+         /// Reads the next value through fc::variant
+         fc::variant read_variant( uint32_t max_depth )
+         {
+            return fc::json::from_string( skip_value( max_depth ), fc::json::legacy_parser, max_depth );
+         }
+
+      private:
+         static const char* find_quote_or_backslash( const char* p, const char* end )
+         {
+#if defined(__SSE2__)
+            const __m128i quote = _mm_set1_epi8( '"' );
+            const __m128i backslash = _mm_set1_epi8( '\\' );
+            for( ; end - p >= 16; p += 16 )
+            {
+               const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+               const int mask = _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( chunk, quote ),
+                                                                 _mm_cmpeq_epi8( chunk, backslash ) ) );
+               if( mask != 0 )
+                  return p + __builtin_ctz( mask );
+            }
+#endif
+            while( p < end && *p != '"' && *p != '\\' )
+               ++p;
+            return p;
+         }
+
+         void skip_string()
+         {
+            ++_pos;
+            while( true )
+            {
+               _pos = find_quote_or_backslash( _pos, _end );
+               FC_ASSERT( _pos < _end, "Unterminated string in the JSON text" );
+               if( *_pos++ == '"' )
+                  return;
+               FC_ASSERT( _pos < _end, "Unterminated string in the JSON text" );
+               ++_pos;
+            }
+         }
+
+         uint32_t read_hex4()
+         {
+            FC_ASSERT( _end - _pos >= 4, "Truncated \\u escape in the JSON text" );
+            uint32_t result = 0;
+            for( int i = 0; i < 4; ++i, ++_pos )
+            {
+               const char c = *_pos;
+               result <<= 4;
+               if( c >= '0' && c <= '9' )      result |= c - '0';
+               else if( c >= 'a' && c <= 'f' ) result |= c - 'a' + 10;
+               else if( c >= 'A' && c <= 'F' ) result |= c - 'A' + 10;
+               else FC_THROW( "Invalid \\u escape in the JSON text" );
+            }
+            return result;
+         }
+
+         /// decodes the escape after a backslash into @p out
+         void read_escape( std::string& out )
+         {
+            FC_ASSERT( _pos < _end, "Unterminated string in the JSON text" );
+            const char c = *_pos++;
+            switch( c )
+            {
+               case '"':  out += '"'; return;
+               case '\\': out += '\\'; return;
+               case '/':  out += '/'; return;
+               case 'b':  out += '\b'; return;
+               case 'f':  out += '\f'; return;
+               case 'n':  out += '\n'; return;
+               case 'r':  out += '\r'; return;
+               case 't':  out += '\t'; return;
+               case 'u':  break;
+               default:   FC_THROW( "Invalid escape '\\${c}' in the JSON text", ("c",std::string( 1, c )) );
+            }
+            uint32_t code = read_hex4();
+            if( code >= 0xd800 && code < 0xdc00 && _end - _pos >= 6 && _pos[0] == '\\' && _pos[1] == 'u' )
+            {
+               _pos += 2;
+               const uint32_t low = read_hex4();
+               FC_ASSERT( low >= 0xdc00 && low < 0xe000, "Invalid surrogate pair in the JSON text" );
+               code = 0x10000 + ( ( code - 0xd800 ) << 10 ) + ( low - 0xdc00 );
+            }
+            if( code < 0x80 )
+               out += char( code );
+            else if( code < 0x800 )
+            {
+               out += char( 0xc0 | ( code >> 6 ) );
+               out += char( 0x80 | ( code & 0x3f ) );
+            }
+            else if( code < 0x10000 )
+            {
+               out += char( 0xe0 | ( code >> 12 ) );
+               out += char( 0x80 | ( ( code >> 6 ) & 0x3f ) );
+               out += char( 0x80 | ( code & 0x3f ) );
+            }
+            else
+            {
+               out += char( 0xf0 | ( code >> 18 ) );
+               out += char( 0x80 | ( ( code >> 12 ) & 0x3f ) );
+               out += char( 0x80 | ( ( code >> 6 ) & 0x3f ) );
+               out += char( 0x80 | ( code & 0x3f ) );
+            }
+         }
+
+         const char* _begin;
+         const char* _pos;
+         const char* _end;
+   };
+
+   template<typename T>
+   void read_json( json_reader& in, T& value, uint32_t max_depth );
+   template<typename T>
+   void read_json( json_reader& in, std::vector<T>& values, uint32_t max_depth );
+   template<typename T>
+   void read_json( json_reader& in, fc::optional<T>& value, uint32_t max_depth );
+
+   inline void read_json( json_reader& in, std::string& value, uint32_t )
+   {
+      value = in.read_string();
+   }
+
+   /// fc writes the byte vectors as hex strings
+   inline void read_json( json_reader& in, std::vector<char>& value, uint32_t max_depth )
+   {
+      fc::from_variant( in.read_variant( max_depth ), value, max_depth );
+   }
+
+   inline void read_json( json_reader& in, bool& value, uint32_t )
+   {
+      if( in.accept_literal( "true" ) )
+         value = true;
+      else
+      {
+         FC_ASSERT( in.accept_literal( "false" ), "Expected a boolean at offset ${o} of the JSON text", ("o",in.offset()) );
+         value = false;
+      }
+   }
+
+namespace detail {
+
+   template<typename T>
+   class json_member_reader
+   {
+      public:
+         json_member_reader( json_reader& in, T& value, const std::string& name, uint32_t max_depth )
+         : _in( in ), _value( value ), _name( name ), _max_depth( max_depth ) {}
+
+         template<typename Member, class Class, Member (Class::*member)>
+         void operator()( const char* name )const
+         {
+            if( !found && _name == name )
+            {
+               read_json( _in, _value.*member, _max_depth );
+               found = true;
+            }
+         }
+
+         mutable bool   found = false;
+
+      private:
+         json_reader&        _in;
+         T&                  _value;
+         const std::string&  _name;
+         uint32_t            _max_depth;
+   };
+
+   /// the structs read member by member
+   template<typename T>
+   void read_json_value( json_reader& in, T& value, uint32_t max_depth, std::integral_constant<int,1> )
+   {
+      FC_ASSERT( max_depth > 0, "Recursion depth exceeded" );
+      in.expect( '{' );
+      if( in.accept( '}' ) )
+         return;
+      do
+      {
+         const std::string name = in.read_string();
+         in.expect( ':' );
+         json_member_reader<T> reader( in, value, name, max_depth - 1 );
+         fc::reflector<T>::visit( reader );
+         if( !reader.found )
+            in.skip_value( max_depth - 1 );
+      } while( in.accept( ',' ) );
+      in.expect( '}' );
+   }
+
+   /// the integers, as numbers or as strings
+   template<typename T>
+   void read_json_value( json_reader& in, T& value, uint32_t, std::integral_constant<int,2> )
+   {
+      const std::string text = in.read_number();
+      char* end = nullptr;
+      errno = 0;
+      bool in_range;
+      if( std::is_signed<T>::value )
+      {
+         const long long v = std::strtoll( text.c_str(), &end, 10 );
+         in_range = ( v >= (long long)std::numeric_limits<T>::min() && v <= (long long)std::numeric_limits<T>::max() );
+         value = T( v );
+      }
+      else
+      {
+         const unsigned long long v = std::strtoull( text.c_str(), &end, 10 );
+         in_range = ( text[0] != '-' && v <= (unsigned long long)std::numeric_limits<T>::max() );
+         value = T( v );
+      }
+      FC_ASSERT( !text.empty() && end == text.c_str() + text.size() && errno == 0 && in_range,
+                 "Invalid integer '${t}' in the JSON text", ("t",text) );
+   }
+
+   /// anything else, through fc::variant
+   template<typename T>
+   void read_json_value( json_reader& in, T& value, uint32_t max_depth, std::integral_constant<int,0> )
+   {
+      fc::from_variant( in.read_variant( max_depth ), value, max_depth );
+   }
+
+   template<typename T>
+   using json_read_kind = std::integral_constant< int, json_stream_members<T>::value ? 1
+                                                     : ( std::is_integral<T>::value ? 2 : 0 ) >;
+
+} // detail
+
+   /// Reads @p value from @p in as fc::json::from_string() and fc::variant::as() would
+   template<typename T>
+   void read_json( json_reader& in, T& value, uint32_t max_depth )
+   {
+      detail::read_json_value( in, value, max_depth, detail::json_read_kind<T>() );
+   }
+
+   template<typename T>
+   void read_json( json_reader& in, std::vector<T>& values, uint32_t max_depth )
+   {
+      FC_ASSERT( max_depth > 0, "Recursion depth exceeded" );
+      values.clear();
+      in.expect( '[' );
+      if( in.accept( ']' ) )
+         return;
+      do
+      {
+         values.emplace_back();
+         read_json( in, values.back(), max_depth - 1 );
+      } while( in.accept( ',' ) );
+      in.expect( ']' );
+   }
+
+   template<typename T>
+   void read_json( json_reader& in, fc::optional<T>& value, uint32_t max_depth )
+   {
+      if( in.accept_literal( "null" ) )
+      {
+         value.reset();
+         return;
+      }
+      value = T();
+      read_json( in, *value, max_depth );
+   }
+
+   /// Reads the whole @p text as one value of type T
+   template<typename T>
+   T read_json( const std::string& text, uint32_t max_depth )
+   {
+      json_reader in( text );
+      T value;
+      read_json( in, value, max_depth );
+      FC_ASSERT( in.at_end(), "Unexpected text after the JSON value at offset ${o}", ("o",in.offset()) );
+      return value;
+   }
+
+} } // graphene::app
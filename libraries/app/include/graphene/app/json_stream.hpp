@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2018 Abit More, and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/variant.hpp>
+
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @file
+ * Writes API results as JSON straight into an output stream, without converting the whole result to an
+ * fc::variant and then to a string first.
+ *
+ * Vectors and optionals are written element by element, and so are the members of the structs marked with
+ * @ref GRAPHENE_JSON_STREAM_MEMBERS. Any other value, such as an object, an id, an asset or a map, is converted
+ * through fc::variant on its own, so the output is exactly what fc::json gives for the whole result, and at most one
+ * element is held as a variant at a time.
+ *
+ * Only structs whose JSON form is their reflected members can be marked: a type with its own to_variant(), such
+ * as public_key_type, must keep going through fc::variant.
+ */
+
+namespace graphene { namespace app {
+
+   /// Whether the members of T are written one by one, see @ref GRAPHENE_JSON_STREAM_MEMBERS
+   template<typename T>
+   struct json_stream_members : std::false_type {};
+
+   template<typename T>
+   void write_json( std::ostream& out, const T& value, uint32_t max_depth );
+   template<typename T>
+   void write_json( std::ostream& out, const std::vector<T>& values, uint32_t max_depth );
+   template<typename T>
+   void write_json( std::ostream& out, const fc::optional<T>& value, uint32_t max_depth );
+
+namespace detail {
+
+   template<typename T>
+   class json_member_writer
+   {
+      public:
+         json_member_writer( std::ostream& out, const T& value, uint32_t max_depth )
+         : _out( out ), _value( value ), _max_depth( max_depth ) {}
+
+         template<typename Member, class Class, Member (Class::*member)>
+         void operator()( const char* name )const
+         {
+            if( !_first )
+               _out << ',';
+            _first = false;
+            _out << '"' << name << "\":";
+            write_json( _out, _value.*member, _max_depth );
+         }
+
+      private:
+         std::ostream&  _out;
+         const T&       _value;
+         uint32_t       _max_depth;
+         mutable bool   _first = true;
+   };
+
+   template<typename T>
+   void write_json_value( std::ostream& out, const T& value, uint32_t max_depth, std::true_type )
+   {
+      FC_ASSERT( max_depth > 0, "Recursion depth exceeded" );
+      out << '{';
+      fc::reflector<T>::visit( json_member_writer<T>( out, value, max_depth - 1 ) );
+      out << '}';
+   }
+
+   template<typename T>
+   void write_json_value( std::ostream& out, const T& value, uint32_t max_depth, std::false_type )
+   {
+      out << fc::json::to_string( fc::variant( value, max_depth ) );
+   }
+
+} // detail
+
+   /// Writes @p value as fc::json would write fc::variant( value, max_depth )
+   template<typename T>
+   void write_json( std::ostream& out, const T& value, uint32_t max_depth )
+   {
+      detail::write_json_value( out, value, max_depth, json_stream_members<T>() );
+   }
+
+   template<typename T>
+   void write_json( std::ostream& out, const std::vector<T>& values, uint32_t max_depth )
+   {
+      FC_ASSERT( max_depth > 0, "Recursion depth exceeded" );
+      out << '[';
+      for( auto itr = values.begin(); itr != values.end(); ++itr )
+      {
+         if( itr != values.begin() )
+            out << ',';
+         write_json( out, *itr, max_depth - 1 );
+      }
+      out << ']';
+   }
+
+   template<typename T>
+   void write_json( std::ostream& out, const fc::optional<T>& value, uint32_t max_depth )
+   {
+      if( value.valid() )
+         write_json( out, *value, max_depth );
+      else
+         out << "null";
+   }
+
+} } // graphene::app
+
+/// Marks a struct reflected with FC_REFLECT to be written member by member, use at global scope
+#define GRAPHENE_JSON_STREAM_MEMBERS( TYPE ) \
+namespace graphene { namespace app { \
+   template<> struct json_stream_members< TYPE > : std::true_type {}; \
+} }
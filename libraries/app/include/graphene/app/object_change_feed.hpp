@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2018 Abit More, and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/database.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <deque>
+#include <mutex>
+
+namespace graphene { namespace app {
+   using namespace graphene::chain;
+
+   enum object_change_type
+   {
+      object_created  = 0,
+      object_modified = 1,
+      object_removed  = 2,
+      /// the object was changed by a block which was popped, e.g. on a fork switch, and must be read again
+      object_reverted = 3
+   };
+
+   struct object_change
+   {
+      uint64_t             sequence = 0;
+      /// the head block when the change was logged
+      uint32_t             block_num = 0;
+      object_id_type       id;
+      object_change_type   type = object_created;
+   };
+
+   /// Changes of the log from a sequence number on, see database_api::get_object_changes()
+   struct object_changes_page
+   {
+      vector<object_change>   changes;
+      /// where to go on reading from
+      uint64_t                next_sequence = 0;
+      /**
+       * the oldest change still kept: when it's above the sequence asked for, changes were dropped in between and
+       * the reader has to scan the objects again
+       */
+      uint64_t                first_sequence = 0;
+   };
+
+   /**
+    * @brief A sequence numbered log of the objects created, modified and removed by the applied blocks
+    *
+    * Readers keep the sequence number they got to and come back for the changes since, instead of scanning the
+    * objects or subscribing in a session. Only the ids are logged, the objects are read with get_objects().
+    *
+    * The log keeps a bounded number of changes, and is saved when the node shuts down so readers can go on after a
+    * restart. The sequence numbers go on from the saved ones, even when the saved changes don't fit the state
+    * loaded and are dropped.
+    */
+   class object_change_feed
+   {
+      public:
+         explicit object_change_feed( size_t max_changes );
+
+         /// Logs the changes of the blocks applied by @p db from now on
+         void connect( chain::database& db );
+
+         /// @return at most @p limit changes from @p from_sequence on, safe to call from the API threads
+         object_changes_page get_changes( uint64_t from_sequence, uint32_t limit )const;
+
+         /// Loads the saved changes, only going on with their sequence numbers if they weren't saved at @p head_block
+         void load( const fc::path& file, const block_id_type& head_block );
+         void save( const fc::path& file, const block_id_type& head_block )const;
+
+      private:
+         void on_block_objects_changed( const chain::database& db, const object_change_log& changes );
+         void append( uint32_t block_num, object_id_type id, object_change_type type );
+
+         size_t                               _max_changes;
+         mutable std::mutex                   _mutex;
+         std::deque<object_change>            _changes;
+         uint64_t                             _next_sequence = 1;
+         uint32_t                             _last_block_num = 0;
+         boost::signals2::scoped_connection   _connection;
+   };
+
+} } // graphene::app
+
+FC_REFLECT_ENUM( graphene::app::object_change_type, (object_created)(object_modified)(object_removed)(object_reverted) )
+FC_REFLECT( graphene::app::object_change, (sequence)(block_num)(id)(type) )
+FC_REFLECT( graphene::app::object_changes_page, (changes)(next_sequence)(first_sequence) )
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2018 Abit More, and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <fc/api.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/io/datastream.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/io/raw_variant.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @file
+ * Calls of the RPC APIs with arguments and results packed with fc::raw, as an alternative to JSON.
+ *
+ * A call is a packed @ref packed_rpc_request whose @c args are the arguments packed one after another, the answer a
+ * packed @ref packed_rpc_response whose @c result is the packed result. An API returned by a call, such as
+ * login_api::network_broadcast(), is added to the APIs of the connection and its id is the result.
+ *
+ * The API ids of the packed calls are counted apart from the JSON ones. Methods which take a callback can't be
+ * called this way.
+ */
+
+namespace graphene { namespace app {
+
+   struct packed_rpc_request
+   {
+      uint64_t            id = 0;
+      uint32_t            api_id = 0;
+      std::string         method;
+      std::vector<char>   args;
+   };
+
+   struct packed_rpc_response
+   {
+      uint64_t            id = 0;
+      bool                ok = false;
+      std::vector<char>   result;
+      /// why the call failed, if it did
+      std::string         error;
+   };
+
+   /// Whether an API returned by a packed call can be called with packed calls, see @ref GRAPHENE_PACKED_RPC_API
+   template<typename Api>
+   struct packed_rpc_api : std::false_type {};
+
+namespace detail {
+
+   template<typename T>
+   struct is_callback : std::false_type {};
+   template<typename R, typename... Args>
+   struct is_callback< std::function<R(Args...)> > : std::true_type {};
+
+   template<typename... Args>
+   struct has_callback : std::false_type {};
+   template<typename Arg0, typename... Args>
+   struct has_callback<Arg0, Args...>
+      : std::integral_constant< bool, is_callback< typename std::decay<Arg0>::type >::value
+                                      || has_callback<Args...>::value > {};
+
+   template<typename R, typename Arg0, typename... Args>
+   std::function<R(Args...)> bind_first_arg( const std::function<R(Arg0,Args...)>& f, Arg0 a0 )
+   {
+      return [=]( Args... args ) { return f( a0, args... ); };
+   }
+
+   template<typename R>
+   R call_with_packed_args( const std::function<R()>& f, fc::datastream<const char*>& ds )
+   {
+      FC_ASSERT( ds.remaining() == 0, "Too many arguments" );
+      return f();
+   }
+
+   template<typename R, typename Arg0, typename... Args>
+   R call_with_packed_args( const std::function<R(Arg0,Args...)>& f, fc::datastream<const char*>& ds )
+   {
+      typename std::decay<Arg0>::type a0;
+      fc::raw::unpack( ds, a0 );
+      return call_with_packed_args( bind_first_arg<R,Arg0,Args...>( f, a0 ), ds );
+   }
+
+} // detail
+
+   /**
+    * The APIs of one connection which can be called with packed calls.
+    */
+   class packed_rpc_apis
+   {
+      public:
+         /// @return the id of @p api in the packed calls
+         template<typename Api>
+         uint32_t add_api( const fc::api<Api>& api )
+         {
+            _apis.emplace_back();
+            const uint32_t api_id = _apis.size() - 1;
+            api->visit( method_adder<Api>( *this, api_id, api ) );
+            return api_id;
+         }
+
+         /// @return the packed response to the packed @p request, with the error if the call failed
+         std::vector<char> call( const std::vector<char>& request )
+         {
+            packed_rpc_response response;
+            try
+            {
+               const packed_rpc_request req = fc::raw::unpack<packed_rpc_request>( request );
+               response.id = req.id;
+               FC_ASSERT( req.api_id < _apis.size(), "Unknown API ${id}", ("id",req.api_id) );
+               auto itr = _apis[req.api_id].find( req.method );
+               FC_ASSERT( itr != _apis[req.api_id].end(), "Unknown method ${m}", ("m",req.method) );
+               // the call can add an API, so the method is not called in place
+               const method m = itr->second;
+               fc::datastream<const char*> ds( req.args.data(), req.args.size() );
+               response.result = m( ds );
+               response.ok = true;
+            }
+            catch( const fc::exception& e )
+            {
+               response.error = e.to_string();
+            }
+            catch( const std::exception& e )
+            {
+               response.error = e.what();
+            }
+            return fc::raw::pack( response );
+         }
+
+      private:
+         typedef std::function<std::vector<char>( fc::datastream<const char*>& )> method;
+
+         template<typename R>
+         std::vector<char> pack_result( const R& result )
+         {
+            return fc::raw::pack( result );
+         }
+
+         template<typename Api>
+         std::vector<char> pack_result( const fc::api<Api>& result )
+         {
+            return pack_api( result, packed_rpc_api<Api>() );
+         }
+
+         template<typename Api>
+         std::vector<char> pack_api( const fc::api<Api>& result, std::true_type )
+         {
+            return fc::raw::pack( add_api( result ) );
+         }
+
+         template<typename Api>
+         std::vector<char> pack_api( const fc::api<Api>&, std::false_type )
+         {
+            FC_THROW( "This API can't be called with packed calls" );
+         }
+
+         template<typename R, typename... Args>
+         struct invoker
+         {
+            static std::vector<char> invoke( packed_rpc_apis& apis, const std::function<R(Args...)>& f,
+                                             fc::datastream<const char*>& ds )
+            {
+               return apis.pack_result( detail::call_with_packed_args( f, ds ) );
+            }
+         };
+
+         template<typename... Args>
+         struct invoker<void, Args...>
+         {
+            static std::vector<char> invoke( packed_rpc_apis&, const std::function<void(Args...)>& f,
+                                             fc::datastream<const char*>& ds )
+            {
+               detail::call_with_packed_args( f, ds );
+               return std::vector<char>();
+            }
+         };
+
+         template<typename Api>
+         class method_adder
+         {
+            public:
+               method_adder( packed_rpc_apis& apis, uint32_t api_id, const fc::api<Api>& api )
+               : _apis( apis ), _api_id( api_id ), _api( api ) {}
+
+               template<typename R, typename... Args>
+               void operator()( const char* name, std::function<R(Args...)>& memb )const
+               {
+                  add( name, memb, detail::has_callback<Args...>() );
+               }
+
+            private:
+               template<typename R, typename... Args>
+               void add( const char*, std::function<R(Args...)>&, std::true_type )const {}
+
+               template<typename R, typename... Args>
+               void add( const char* name, std::function<R(Args...)>& memb, std::false_type )const
+               {
+                  packed_rpc_apis& apis = _apis;
+                  const fc::api<Api> api = _api; // keeps the API alive
+                  const std::function<R(Args...)> f = memb;
+                  apis._apis[_api_id][name] = [&apis,api,f]( fc::datastream<const char*>& ds ) -> std::vector<char>
+                  {
+                     return invoker<R,Args...>::invoke( apis, f, ds );
+                  };
+               }
+
+               packed_rpc_apis&  _apis;
+               uint32_t          _api_id;
+               fc::api<Api>      _api;
+         };
+
+         std::vector< std::map<std::string, method> > _apis;
+   };
+
+} } // graphene::app
+
+FC_REFLECT( graphene::app::packed_rpc_request, (id)(api_id)(method)(args) )
+FC_REFLECT( graphene::app::packed_rpc_response, (id)(ok)(result)(error) )
+
+/// Lets an API returned by a packed call be called with packed calls, use at global scope
+#define GRAPHENE_PACKED_RPC_API( API ) \
+namespace graphene { namespace app { \
+   template<> struct packed_rpc_api< API > : std::true_type {}; \
+} }
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2018 Abit More, and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/app/object_change_feed.hpp>
+
+#include <fc/io/fstream.hpp>
+#include <fc/io/raw.hpp>
+
+#include <fstream>
+
+namespace graphene { namespace app { namespace detail {
+
+   struct saved_object_changes
+   {
+      block_id_type           head_block;
+      uint64_t                next_sequence = 1;
+      vector<object_change>   changes;
+   };
+
+} } } // graphene::app::detail
+
+FC_REFLECT( graphene::app::detail::saved_object_changes, (head_block)(next_sequence)(changes) )
+
+namespace graphene { namespace app {
+
+object_change_feed::object_change_feed( size_t max_changes )
+   : _max_changes( std::max<size_t>( max_changes, 1 ) )
+{}
+
+void object_change_feed::connect( chain::database& db )
+{
+   _connection = db.block_objects_changed.connect( [this,&db]( const object_change_log& changes ) {
+      on_block_objects_changed( db, changes );
+   });
+}
+
+void object_change_feed::on_block_objects_changed( const chain::database& db, const object_change_log& changes )
+{
+   const uint32_t block_num = db.head_block_num();
+   std::lock_guard<std::mutex> guard( _mutex );
+   if( block_num <= _last_block_num )
+   {
+      // blocks were popped since the last one logged, the objects they changed have to be read again
+      flat_set<object_id_type> reverted;
+      for( auto itr = _changes.rbegin(); itr != _changes.rend() && itr->block_num >= block_num; ++itr )
+         if( itr->type != object_reverted )
+            reverted.insert( itr->id );
+      for( const object_id_type& id : reverted )
+         append( block_num, id, object_reverted );
+   }
+   _last_block_num = block_num;
+
+   for( const object_id_type& id : changes.new_ids )
+      append( block_num, id, object_created );
+   for( const object_id_type& id : changes.changed_ids )
+      append( block_num, id, object_modified );
+   for( const object_id_type& id : changes.removed_ids )
+      append( block_num, id, object_removed );
+}
+
+void object_change_feed::append( uint32_t block_num, object_id_type id, object_change_type type )
+{
+   object_change change;
+   change.sequence = _next_sequence++;
+   change.block_num = block_num;
+   change.id = id;
+   change.type = type;
+   _changes.push_back( change );
+   if( _changes.size() > _max_changes )
+      _changes.pop_front();
+}
+
+object_changes_page object_change_feed::get_changes( uint64_t from_sequence, uint32_t limit )const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   object_changes_page page;
+   page.first_sequence = _changes.empty() ? _next_sequence : _changes.front().sequence;
+   page.next_sequence = std::min( std::max( from_sequence, page.first_sequence ), _next_sequence );
+   // the kept sequence numbers have no gaps
+   const size_t begin = page.next_sequence - page.first_sequence;
+   const size_t end = std::min<size_t>( _changes.size(), begin + limit );
+   page.changes.assign( _changes.begin() + begin, _changes.begin() + end );
+   page.next_sequence += page.changes.size();
+   return page;
+}
+
+void object_change_feed::load( const fc::path& file, const block_id_type& head_block )
+{
+   if( !fc::exists( file ) )
+      return;
+   detail::saved_object_changes saved;
+   try
+   {
+      string data;
+      fc::read_file_contents( file, data );
+      saved = fc::raw::unpack<detail::saved_object_changes>( vector<char>( data.begin(), data.end() ) );
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "Unable to load the object change log from ${f}, starting a new one: ${e}", ("f",file)("e",e.to_detail_string()) );
+      return;
+   }
+
+   std::lock_guard<std::mutex> guard( _mutex );
+   _next_sequence = std::max( _next_sequence, saved.next_sequence );
+   _changes.clear();
+   if( saved.head_block != head_block )
+   {
+      wlog( "The object change log was saved at another block, its readers have to scan the objects again" );
+      return;
+   }
+   auto begin = saved.changes.size() > _max_changes ? saved.changes.end() - _max_changes : saved.changes.begin();
+   _changes.assign( begin, saved.changes.end() );
+   _last_block_num = block_header::num_from_id( head_block );
+}
+
+void object_change_feed::save( const fc::path& file, const block_id_type& head_block )const
+{ try {
+   detail::saved_object_changes saved;
+   saved.head_block = head_block;
+   {
+      std::lock_guard<std::mutex> guard( _mutex );
+      saved.next_sequence = _next_sequence;
+      saved.changes.assign( _changes.begin(), _changes.end() );
+   }
+   const vector<char> packed = fc::raw::pack( saved );
+   std::ofstream out( file.generic_string().c_str(), std::ios::binary | std::ios::out | std::ios::trunc );
+   out.write( packed.data(), packed.size() );
+   out.close();
+   FC_ASSERT( !out.fail(), "Unable to write ${f}", ("f",file) );
+} FC_CAPTURE_AND_RETHROW( (file) ) }
+
+} } // graphene::app
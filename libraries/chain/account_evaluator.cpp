@@ -90,10 +90,7 @@ void_result account_create_evaluator::do_evaluate( const account_create_operatio
       auto current_account_itr = acnt_indx.indices().get<by_uid>().find( op.uid );
       FC_ASSERT( current_account_itr == acnt_indx.indices().get<by_uid>().end(), "account uid already exists." );
    }
-   {
-      auto current_account_itr = acnt_indx.indices().get<by_name>().find( op.name );
-      FC_ASSERT( current_account_itr == acnt_indx.indices().get<by_name>().end(), "account name already exists." );
-   }
+   FC_ASSERT( d.find_account_by_name( op.name ) == nullptr, "account name already exists." );
 
    return void_result();
 } FC_CAPTURE_AND_RETHROW( (op) ) }
@@ -290,6 +287,8 @@ void_result account_update_auth_evaluator::do_apply( const account_update_auth_o
          a.memo_key = *o.memo_key;
       a.last_update_time = d.head_block_time();
    });
+   if( o.owner || o.active || o.secondary )
+      d.get_account_authority_cache().invalidate( o.uid );
 
    return void_result();
 } FC_CAPTURE_AND_RETHROW( (o) ) }
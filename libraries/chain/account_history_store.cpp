@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/account_history_store.hpp>
+#include <graphene/chain/protocol/fee_schedule.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+namespace graphene { namespace chain {
+
+namespace {
+   /// What the head file holds, it is written after the files it describes so that what follows is ignored on open
+   struct store_head
+   {
+      uint32_t flushed_block_num = 0;
+      uint32_t padding = 0;
+      uint64_t flushed_ops = 0;
+      uint64_t record_count = 0;
+   };
+
+   void open_file( std::fstream& stream, const fc::path& filename )
+   {
+      stream.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+      if( !fc::exists( filename ) )
+         stream.open( filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc );
+      else
+         stream.open( filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+   }
+
+   uint64_t stream_size( std::fstream& stream )
+   {
+      stream.seekg( 0, stream.end );
+      return stream.tellg();
+   }
+}
+
+const uint64_t account_history_store::ops_per_segment;
+const uint32_t account_history_store::checkpoint_interval;
+const uint64_t account_history_store::no_record;
+
+account_history_store::account_history_store() {}
+
+account_history_store::~account_history_store()
+{
+   close();
+}
+
+void account_history_store::open( const fc::path& dir )
+{ try {
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   close();
+   fc::create_directories( dir );
+   _dir = dir;
+
+   store_head head;
+   if( fc::exists( _dir / "head" ) )
+   {
+      std::ifstream head_file( ( _dir / "head" ).generic_string().c_str(), std::ios::in | std::ios::binary );
+      head_file.read( (char*)&head, sizeof(head) );
+      FC_ASSERT( uint64_t( head_file.gcount() ) == sizeof(head), "account history head file is corrupted" );
+   }
+   _flushed_block_num = head.flushed_block_num;
+   _flushed_ops       = head.flushed_ops;
+   _next_op           = head.flushed_ops;
+
+   open_file( _records, _dir / "accounts" );
+   const uint64_t records_on_disk = stream_size( _records ) / sizeof(account_record);
+   FC_ASSERT( records_on_disk >= head.record_count, "account history records are missing",
+              ("on_disk",records_on_disk)("expected",head.record_count) );
+
+   // rebuild the in-memory index, records past the head were written after the last flush and are overwritten
+   const size_t batch_size = 4096;
+   vector<account_record> batch;
+   _records.seekg( 0, _records.beg );
+   while( _record_count < head.record_count )
+   {
+      batch.resize( std::min<uint64_t>( batch_size, head.record_count - _record_count ) );
+      _records.read( (char*)batch.data(), batch.size() * sizeof(account_record) );
+      for( const account_record& r : batch )
+      {
+         account_head& h = _heads[r.account];
+         h.total_ops   = r.sequence;
+         h.flushed_ops = r.sequence;
+         h.last_record = _record_count;
+         if( ( r.sequence - 1 ) % checkpoint_interval == 0 )
+            h.checkpoints.push_back( _record_count );
+         _last_of_type[ std::make_pair( r.account, r.operation_type ) ] = _record_count;
+         ++_record_count;
+      }
+   }
+
+   _open = true;
+   ilog( "Opened account history store with ${o} operations up to block ${b}",
+         ("o",_flushed_ops)("b",_flushed_block_num) );
+} FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+void account_history_store::set_cache_size( size_t max_ops )
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   _cache_max_size = max_ops;
+}
+
+uint32_t account_history_store::flushed_block_num()const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   return _flushed_block_num;
+}
+
+bool account_history_store::is_open()const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   return _open;
+}
+
+void account_history_store::close()
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   if( !_open )
+      return;
+   _records.close();
+   _segments.clear();
+   _heads.clear();
+   _last_of_type.clear();
+   _pending.clear();
+   _cache.clear();
+   _cache_order.clear();
+   _flushed_block_num = 0;
+   _next_op = 0;
+   _flushed_ops = 0;
+   _record_count = 0;
+   _open = false;
+}
+
+account_history_store::segment& account_history_store::get_segment( uint64_t segment_num )const
+{
+   auto itr = _segments.find( segment_num );
+   if( itr != _segments.end() )
+      return *itr->second;
+
+   std::unique_ptr<segment> s( new segment );
+   const string name = "operations-" + fc::to_string( segment_num );
+   open_file( s->data, _dir / ( name + ".dat" ) );
+   open_file( s->index, _dir / ( name + ".idx" ) );
+   segment& result = *s;
+   _segments[segment_num] = std::move( s );
+   return result;
+}
+
+operation_history_id_type account_history_store::append( const operation_history_object& op,
+                                                         const flat_set<account_uid_type>& accounts )
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   FC_ASSERT( _open );
+   FC_ASSERT( op.block_num > _flushed_block_num, "block ${b} is already in the account history store",
+              ("b",op.block_num)("flushed",_flushed_block_num) );
+   FC_ASSERT( _pending.empty() || _pending.back().op.block_num <= op.block_num );
+
+   pending_op p;
+   p.op = op;
+   p.op.id = operation_history_id_type( _next_op++ );
+   p.accounts.reserve( accounts.size() );
+   for( const account_uid_type account : accounts )
+      p.accounts.emplace_back( account, ++_heads[account].total_ops );
+   _pending.push_back( std::move( p ) );
+   return _pending.back().op.id;
+}
+
+void account_history_store::discard_from_block( uint32_t block_num )
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   while( !_pending.empty() && _pending.back().op.block_num >= block_num )
+   {
+      for( const auto& a : _pending.back().accounts )
+         --_heads[a.first].total_ops;
+      --_next_op;
+      _pending.pop_back();
+   }
+}
+
+void account_history_store::flush_until_block( uint32_t block_num )
+{ try {
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   if( !_open || block_num <= _flushed_block_num )
+      return;
+
+   while( !_pending.empty() && _pending.front().op.block_num <= block_num )
+   {
+      const pending_op& p = _pending.front();
+      write_operation( p.op );
+      const uint16_t op_type = p.op.op.which();
+      for( const auto& a : p.accounts )
+      {
+         account_head& h = _heads[a.first];
+         uint64_t& last_of_type = _last_of_type.emplace( std::make_pair( a.first, op_type ), no_record ).first->second;
+
+         account_record r;
+         r.account        = a.first;
+         r.operation      = p.op.id.instance.value;
+         r.prev           = h.last_record;
+         r.prev_same_type = last_of_type;
+         r.sequence       = a.second;
+         r.operation_type = op_type;
+         write_record( r );
+
+         h.last_record = _record_count;
+         h.flushed_ops = a.second;
+         if( ( a.second - 1 ) % checkpoint_interval == 0 )
+            h.checkpoints.push_back( _record_count );
+         last_of_type = _record_count;
+         ++_record_count;
+      }
+      ++_flushed_ops;
+      _pending.pop_front();
+   }
+   _flushed_block_num = block_num;
+
+   for( auto& s : _segments )
+   {
+      s.second->data.flush();
+      s.second->index.flush();
+   }
+   _records.flush();
+   save_head();
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+void account_history_store::write_operation( const operation_history_object& op )
+{
+   const uint64_t num = op.id.instance.value;
+   segment& s = get_segment( num / ops_per_segment );
+   const vector<char> data = fc::raw::pack( op );
+
+   op_index_entry e;
+   s.data.seekp( 0, s.data.end );
+   e.pos  = s.data.tellp();
+   e.size = data.size();
+   s.data.write( data.data(), data.size() );
+   s.index.seekp( sizeof(e) * ( num % ops_per_segment ) );
+   s.index.write( (const char*)&e, sizeof(e) );
+}
+
+void account_history_store::write_record( const account_record& r )
+{
+   _records.seekp( sizeof(r) * _record_count );
+   _records.write( (const char*)&r, sizeof(r) );
+}
+
+account_history_store::account_record account_history_store::read_record( uint64_t record_num )const
+{
+   FC_ASSERT( record_num < _record_count );
+   account_record r;
+   _records.seekg( sizeof(r) * record_num );
+   _records.read( (char*)&r, sizeof(r) );
+   return r;
+}
+
+uint64_t account_history_store::find_record( const account_head& head, uint32_t sequence )const
+{
+   FC_ASSERT( sequence > 0 && sequence <= head.flushed_ops );
+   // start from the closest checkpoint after the sequence and walk back
+   const size_t c = ( sequence - 1 ) / checkpoint_interval + 1;
+   uint64_t record;
+   uint32_t record_seq;
+   if( c < head.checkpoints.size() )
+   {
+      record     = head.checkpoints[c];
+      record_seq = c * checkpoint_interval + 1;
+   }
+   else
+   {
+      record     = head.last_record;
+      record_seq = head.flushed_ops;
+   }
+   for( ; record_seq > sequence; --record_seq )
+      record = read_record( record ).prev;
+   return record;
+}
+
+void account_history_store::save_head()const
+{
+   store_head head;
+   head.flushed_block_num = _flushed_block_num;
+   head.flushed_ops       = _flushed_ops;
+   head.record_count      = _record_count;
+   std::ofstream head_file( ( _dir / "head" ).generic_string().c_str(),
+                            std::ios::out | std::ios::binary | std::ios::trunc );
+   head_file.write( (const char*)&head, sizeof(head) );
+}
+
+uint32_t account_history_store::total_ops( account_uid_type account )const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   auto itr = _heads.find( account );
+   return itr != _heads.end() ? itr->second.total_ops : 0;
+}
+
+optional<operation_history_object> account_history_store::get_operation( operation_history_id_type id )const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   const uint64_t num = id.instance.value;
+   if( !_open || num >= _next_op )
+      return optional<operation_history_object>();
+   if( num >= _flushed_ops )
+      return _pending[ num - _flushed_ops ].op;
+
+   auto itr = _cache.find( num );
+   if( itr != _cache.end() )
+      return itr->second;
+
+   segment& s = get_segment( num / ops_per_segment );
+   op_index_entry e;
+   s.index.seekg( sizeof(e) * ( num % ops_per_segment ) );
+   s.index.read( (char*)&e, sizeof(e) );
+   vector<char> data( e.size );
+   s.data.seekg( e.pos );
+   s.data.read( data.data(), e.size );
+   operation_history_object result = fc::raw::unpack<operation_history_object>( data );
+
+   if( _cache_max_size > 0 )
+   {
+      while( _cache_order.size() >= _cache_max_size )
+      {
+         _cache.erase( _cache_order.front() );
+         _cache_order.pop_front();
+      }
+      _cache.emplace( num, result );
+      _cache_order.push_back( num );
+   }
+   return result;
+}
+
+void account_history_store::visit_account_history( account_uid_type account, optional<uint16_t> op_type, uint32_t start,
+                                                   const std::function<bool(uint32_t,operation_history_id_type)>& visitor )const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   auto head_itr = _heads.find( account );
+   if( head_itr == _heads.end() )
+      return;
+   const account_head& h = head_itr->second;
+   if( start == 0 || start > h.total_ops )
+      start = h.total_ops;
+
+   // the operations of the reversible blocks, the most recent first
+   for( auto itr = _pending.rbegin(); itr != _pending.rend(); ++itr )
+   {
+      if( op_type.valid() && itr->op.op.which() != *op_type )
+         continue;
+      for( const auto& a : itr->accounts )
+      {
+         if( a.first == account && a.second <= start && !visitor( a.second, itr->op.id ) )
+            return;
+      }
+   }
+
+   start = std::min( start, h.flushed_ops );
+   if( start == 0 )
+      return;
+   uint64_t record;
+   if( !op_type.valid() )
+      record = find_record( h, start );
+   else if( start == h.flushed_ops )
+   {
+      auto itr = _last_of_type.find( std::make_pair( account, *op_type ) );
+      record = ( itr != _last_of_type.end() ? itr->second : no_record );
+   }
+   else
+   {
+      record = find_record( h, start );
+      while( record != no_record )
+      {
+         const account_record r = read_record( record );
+         if( r.operation_type == *op_type )
+            break;
+         record = r.prev;
+      }
+   }
+
+   while( record != no_record )
+   {
+      const account_record r = read_record( record );
+      if( !visitor( r.sequence, operation_history_id_type( r.operation ) ) )
+         return;
+      record = op_type.valid() ? r.prev_same_type : r.prev;
+   }
+}
+
+vector< std::pair<uint32_t,operation_history_object> > account_history_store::get_account_history(
+      account_uid_type account, optional<uint16_t> op_type, uint32_t stop, uint32_t start, uint32_t limit )const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   vector< std::pair<uint32_t,operation_history_object> > result;
+   if( limit == 0 )
+      return result;
+   visit_account_history( account, op_type, start, [&]( uint32_t sequence, operation_history_id_type id ) -> bool {
+      if( sequence < stop )
+         return false;
+      optional<operation_history_object> op = get_operation( id );
+      FC_ASSERT( op.valid(), "operation ${id} is missing from the account history store", ("id",id) );
+      result.emplace_back( sequence, std::move( *op ) );
+      return result.size() < limit;
+   } );
+   return result;
+}
+
+} } // graphene::chain
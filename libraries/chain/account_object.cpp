@@ -27,6 +27,9 @@
 #include <graphene/chain/hardfork.hpp>
 #include <fc/uint128.hpp>
 
+#include <cstring>
+#include <random>
+
 namespace graphene { namespace chain {
 
 share_type cut_fee(share_type a, uint16_t p)
@@ -56,12 +59,8 @@ std::pair<fc::uint128_t, share_type> _account_statistics_object::compute_coin_se
 }
 
 
-std::pair<fc::uint128_t, share_type> _account_statistics_object::compute_coin_seconds_earned(const uint64_t window, const fc::time_point_sec now, const database& db, const uint8_t enable_hard_fork_type)const
+share_type _account_statistics_object::get_effective_balance(const database& db, const uint8_t enable_hard_fork_type)const
 {
-   fc::time_point_sec now_rounded((now.sec_since_epoch() / 60) * 60);
-   // check average coins and max coin-seconds
-   share_type new_average_coins;
-   fc::uint128_t max_coin_seconds;
    share_type effective_balance;
    switch (enable_hard_fork_type){
    case ENABLE_HEAD_FORK_NONE :
@@ -76,7 +75,7 @@ std::pair<fc::uint128_t, share_type> _account_statistics_object::compute_coin_se
       break;
    case ENABLE_HEAD_FORK_05 :
       if (pledge_balance_ids.count(pledge_balance_type::Lock_balance)) {
-         auto pledge_balance_obj = pledge_balance_ids.at(pledge_balance_type::Lock_balance)(db);
+         const auto& pledge_balance_obj = pledge_balance_ids.at(pledge_balance_type::Lock_balance)(db);
          if (GRAPHENE_CORE_ASSET_AID == pledge_balance_obj.asset_id)
             effective_balance = pledge_balance_obj.pledge;
       } 
@@ -84,6 +83,16 @@ std::pair<fc::uint128_t, share_type> _account_statistics_object::compute_coin_se
    default:
       break;
    }
+   return effective_balance;
+}
+
+std::pair<fc::uint128_t, share_type> _account_statistics_object::compute_coin_seconds_earned(const uint64_t window, const fc::time_point_sec now, const database& db, const uint8_t enable_hard_fork_type)const
+{
+   fc::time_point_sec now_rounded((now.sec_since_epoch() / 60) * 60);
+   // check average coins and max coin-seconds
+   share_type new_average_coins;
+   fc::uint128_t max_coin_seconds;
+   share_type effective_balance = get_effective_balance(db, enable_hard_fork_type);
 
    if (now_rounded <= average_coins_last_update)
       new_average_coins = average_coins;
@@ -137,6 +146,75 @@ void _account_statistics_object::update_coin_seconds_earned(const uint64_t windo
    average_coins_last_update = now_rounded;
 }
 
+void coin_seconds_batch::add(const _account_statistics_object& s, const database& db, const uint8_t enable_hard_fork_type)
+{
+   _stats.push_back(&s);
+   _effective_balance.push_back(s.get_effective_balance(db, enable_hard_fork_type).value);
+   _average_coins.push_back(s.average_coins.value);
+   _average_coins_last_update.push_back(s.average_coins_last_update.sec_since_epoch());
+   _coin_seconds_hi.push_back(s.coin_seconds_earned.high_bits());
+   _coin_seconds_lo.push_back(s.coin_seconds_earned.low_bits());
+   _coin_seconds_last_update.push_back(s.coin_seconds_earned_last_update.sec_since_epoch());
+   _changed.push_back(0);
+}
+
+void coin_seconds_batch::compute(const uint64_t window, const fc::time_point_sec now)
+{
+   _now_rounded = fc::time_point_sec((now.sec_since_epoch() / 60) * 60);
+   const uint32_t now_rounded = _now_rounded.sec_since_epoch();
+   const size_t count = _stats.size();
+
+   // same steps as compute_coin_seconds_earned(), one field at a time
+   for (size_t i = 0; i < count; ++i)
+      _changed[i] = (now_rounded > _coin_seconds_last_update[i] || now_rounded > _average_coins_last_update[i]);
+
+   for (size_t i = 0; i < count; ++i)
+   {
+      if (!_changed[i] || now_rounded <= _average_coins_last_update[i])
+         continue;
+      const uint64_t delta_seconds = now_rounded - _average_coins_last_update[i];
+      if (delta_seconds >= window)
+         _average_coins[i] = _effective_balance[i];
+      else
+      {
+         const uint64_t old_seconds = window - delta_seconds;
+         fc::uint128_t max_coin_seconds = fc::uint128_t(_average_coins[i]) * old_seconds
+                                        + fc::uint128_t(_effective_balance[i]) * delta_seconds;
+         _average_coins[i] = (max_coin_seconds / window).to_uint64();
+      }
+   }
+
+   for (size_t i = 0; i < count; ++i)
+   {
+      if (!_changed[i])
+         continue;
+      fc::uint128_t coin_seconds_earned(_coin_seconds_hi[i], _coin_seconds_lo[i]);
+      if (now_rounded > _coin_seconds_last_update[i])
+      {
+         fc::uint128_t delta_coin_seconds = _effective_balance[i];
+         delta_coin_seconds *= int64_t(now_rounded - _coin_seconds_last_update[i]);
+         coin_seconds_earned += delta_coin_seconds;
+      }
+      // kill rounding issue
+      const fc::uint128_t max_coin_seconds = fc::uint128_t(_average_coins[i]) * window;
+      if (coin_seconds_earned > max_coin_seconds)
+         coin_seconds_earned = max_coin_seconds;
+      _coin_seconds_hi[i] = coin_seconds_earned.high_bits();
+      _coin_seconds_lo[i] = coin_seconds_earned.low_bits();
+   }
+}
+
+void coin_seconds_batch::apply(size_t i, _account_statistics_object& s)const
+{
+   FC_ASSERT(i < _stats.size() && _stats[i] == &s, "statistics object doesn't match the batch");
+   if (!_changed[i])
+      return;
+   s.coin_seconds_earned = fc::uint128_t(_coin_seconds_hi[i], _coin_seconds_lo[i]);
+   s.coin_seconds_earned_last_update = _now_rounded;
+   s.average_coins = _average_coins[i];
+   s.average_coins_last_update = _now_rounded;
+}
+
 void _account_statistics_object::set_coin_seconds_earned(const fc::uint128_t new_coin_seconds, const fc::time_point_sec now)
 {
    fc::time_point_sec now_rounded( ( now.sec_since_epoch() / 60 ) * 60 );
@@ -156,40 +234,87 @@ void _account_statistics_object::add_uncollected_market_fee(asset_aid_type asset
    }
 }
 
+size_t account_member_index::public_key_hash::operator()( const public_key_type& key )const
+{
+   static const uint64_t seed = ( uint64_t( std::random_device()() ) << 32 ) | std::random_device()();
+   // the finalizer of splitmix64, every bit of the result depends on every bit of the input
+   auto mix = []( uint64_t x ) {
+      x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+      x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebull;
+      return x ^ ( x >> 31 );
+   };
+   // the parity byte, then the x coordinate
+   uint64_t h = mix( seed ^ uint8_t( key.key_data.data[0] ) );
+   for( size_t offset = 1; offset + sizeof(uint64_t) <= key.key_data.size(); offset += sizeof(uint64_t) )
+   {
+      uint64_t word;
+      std::memcpy( &word, key.key_data.data + offset, sizeof(word) );
+      h = mix( h ^ word );
+   }
+   return size_t( h );
+}
+
 set<account_uid_type> account_member_index::get_account_members(const account_object& a)const
+{
+   return get_account_members( a.owner, a.active, a.secondary );
+}
+set<public_key_type> account_member_index::get_key_members(const account_object& a)const
+{
+   return get_key_members( a.owner, a.active, a.memo_key );
+}
+set<account_uid_type> account_member_index::get_account_members( const authority& owner, const authority& active,
+                                                                  const authority& secondary )
 {
    set<account_uid_type> result;
-   for( auto auth : a.owner.account_uid_auths )
+   for( const auto& auth : owner.account_uid_auths )
       result.insert(auth.first.uid);
-   for( auto auth : a.active.account_uid_auths )
+   for( const auto& auth : active.account_uid_auths )
       result.insert(auth.first.uid);
-   for( auto auth : a.secondary.account_uid_auths )
+   for( const auto& auth : secondary.account_uid_auths )
       result.insert(auth.first.uid);
    return result;
 }
-set<public_key_type> account_member_index::get_key_members(const account_object& a)const
+set<public_key_type> account_member_index::get_key_members( const authority& owner, const authority& active,
+                                                            const public_key_type& memo_key )
 {
    set<public_key_type> result;
-   for( auto auth : a.owner.key_auths )
+   for( const auto& auth : owner.key_auths )
       result.insert(auth.first);
-   for( auto auth : a.active.key_auths )
+   for( const auto& auth : active.key_auths )
       result.insert(auth.first);
-   result.insert( a.memo_key );
+   result.insert( memo_key );
    return result;
 }
 
+namespace {
+
+template<typename Memberships, typename Member>
+void remove_membership( Memberships& memberships, const Member& member, account_uid_type uid )
+{
+   auto itr = memberships.find( member );
+   if( itr == memberships.end() )
+      return;
+   itr->second.erase( uid );
+   if( itr->second.empty() )
+      memberships.erase( itr );
+}
+
+} // anonymous namespace
+
 void account_member_index::object_inserted(const object& obj)
 {
     assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
     const account_object& a = static_cast<const account_object&>(obj);
 
-    auto account_members = get_account_members(a);
-    for( auto item : account_members )
-       account_to_account_memberships[item].insert(a.uid);
+    // inserted straight away, without collecting the members first, as a member listed twice is inserted once
+    for( const authority* auth : { &a.owner, &a.active, &a.secondary } )
+       for( const auto& item : auth->account_uid_auths )
+          account_to_account_memberships[item.first.uid].insert(a.uid);
 
-    auto key_members = get_key_members(a);
-    for( auto item : key_members )
-       account_to_key_memberships[item].insert(a.uid);
+    for( const authority* auth : { &a.owner, &a.active } )
+       for( const auto& item : auth->key_auths )
+          account_to_key_memberships[item.first].insert(a.uid);
+    account_to_key_memberships[a.memo_key].insert(a.uid);
 }
 
 void account_member_index::object_removed(const object& obj)
@@ -199,21 +324,22 @@ void account_member_index::object_removed(const object& obj)
 
     auto key_members = get_key_members(a);
     for( auto item : key_members )
-       account_to_key_memberships[item].erase( a.uid );
+       remove_membership( account_to_key_memberships, item, a.uid );
 
     auto account_members = get_account_members(a);
     for( auto item : account_members )
-       account_to_account_memberships[item].erase( a.uid );
+       remove_membership( account_to_account_memberships, item, a.uid );
 }
 
 void account_member_index::about_to_modify(const object& before)
 {
-   before_key_members.clear();
-   before_account_members.clear();
    assert( dynamic_cast<const account_object*>(&before) ); // for debug only
    const account_object& a = static_cast<const account_object&>(before);
-   before_key_members     = get_key_members(a);
-   before_account_members = get_account_members(a);
+   // assigning keeps the storage of the copies, so this doesn't allocate once they are big enough
+   before_owner     = a.owner;
+   before_active    = a.active;
+   before_secondary = a.secondary;
+   before_memo_key  = a.memo_key;
 }
 
 void account_member_index::object_modified(const object& after)
@@ -221,7 +347,13 @@ void account_member_index::object_modified(const object& after)
     assert( dynamic_cast<const account_object*>(&after) ); // for debug only
     const account_object& a = static_cast<const account_object&>(after);
 
+    if( a.owner == before_owner && a.active == before_active && a.secondary == before_secondary
+        && a.memo_key == before_memo_key )
+       return;
+
     {
+       const set<account_uid_type> before_account_members = get_account_members( before_owner, before_active,
+                                                                                before_secondary );
        set<account_uid_type> after_account_members = get_account_members(a);
        vector<account_uid_type> removed; removed.reserve(before_account_members.size());
        std::set_difference(before_account_members.begin(), before_account_members.end(),
@@ -229,7 +361,7 @@ void account_member_index::object_modified(const object& after)
                            std::inserter(removed, removed.end()));
 
        for( auto itr = removed.begin(); itr != removed.end(); ++itr )
-          account_to_account_memberships[*itr].erase(a.uid);
+          remove_membership( account_to_account_memberships, *itr, a.uid );
 
        vector<account_uid_type> added; added.reserve(after_account_members.size());
        std::set_difference(after_account_members.begin(), after_account_members.end(),
@@ -242,6 +374,7 @@ void account_member_index::object_modified(const object& after)
 
 
     {
+       const set<public_key_type> before_key_members = get_key_members( before_owner, before_active, before_memo_key );
        set<public_key_type> after_key_members = get_key_members(a);
 
        vector<public_key_type> removed; removed.reserve(before_key_members.size());
@@ -250,7 +383,7 @@ void account_member_index::object_modified(const object& after)
                            std::inserter(removed, removed.end()));
 
        for( auto itr = removed.begin(); itr != removed.end(); ++itr )
-          account_to_key_memberships[*itr].erase(a.uid);
+          remove_membership( account_to_key_memberships, *itr, a.uid );
 
        vector<public_key_type> added; added.reserve(after_key_members.size());
        std::set_difference(after_key_members.begin(), after_key_members.end(),
@@ -262,6 +395,118 @@ void account_member_index::object_modified(const object& after)
     }
 }
 
+void pledge_release_queue_index::add( const pledge_balance_object& p )
+{
+   if( !p.releasing_pledges.empty() )
+      _due[p.earliest_release_block_number()].insert( p.id );
+}
+
+void pledge_release_queue_index::remove( const pledge_balance_id_type id, uint64_t release_block )
+{
+   auto itr = _due.find( release_block );
+   if( itr == _due.end() )
+      return;
+   itr->second.erase( id );
+   if( itr->second.empty() )
+      _due.erase( itr );
+}
+
+void pledge_release_queue_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const pledge_balance_object*>(&obj) ); // for debug only
+   add( static_cast<const pledge_balance_object&>(obj) );
+}
+
+void pledge_release_queue_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const pledge_balance_object*>(&obj) ); // for debug only
+   const pledge_balance_object& p = static_cast<const pledge_balance_object&>(obj);
+   remove( p.id, p.earliest_release_block_number() );
+}
+
+void pledge_release_queue_index::about_to_modify( const object& before )
+{
+   assert( dynamic_cast<const pledge_balance_object*>(&before) ); // for debug only
+   before_release_block = static_cast<const pledge_balance_object&>(before).earliest_release_block_number();
+}
+
+void pledge_release_queue_index::object_modified( const object& after )
+{
+   assert( dynamic_cast<const pledge_balance_object*>(&after) ); // for debug only
+   const pledge_balance_object& p = static_cast<const pledge_balance_object&>(after);
+   if( p.earliest_release_block_number() == before_release_block )
+      return;
+   remove( p.id, before_release_block );
+   add( p );
+}
+
+vector<pledge_balance_id_type> pledge_release_queue_index::due_until( uint32_t block_num )const
+{
+   vector<pledge_balance_id_type> result;
+   for( auto itr = _due.begin(); itr != _due.end() && itr->first <= block_num; ++itr )
+      result.insert( result.end(), itr->second.begin(), itr->second.end() );
+   return result;
+}
+
+void voter_proxy_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const voter_object*>(&obj) ); // for debug only
+   const voter_object& v = static_cast<const voter_object&>(obj);
+   _voters[std::make_pair( v.uid, v.sequence )] = &v;
+   _chains.clear();
+}
+
+void voter_proxy_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const voter_object*>(&obj) ); // for debug only
+   const voter_object& v = static_cast<const voter_object&>(obj);
+   _voters.erase( std::make_pair( v.uid, v.sequence ) );
+   _chains.clear();
+}
+
+void voter_proxy_index::about_to_modify( const object& before )
+{
+   assert( dynamic_cast<const voter_object*>(&before) ); // for debug only
+   const voter_object& v = static_cast<const voter_object&>(before);
+   _proxy_before = std::make_pair( v.proxy_uid, v.proxy_sequence );
+}
+
+void voter_proxy_index::object_modified( const object& after )
+{
+   assert( dynamic_cast<const voter_object*>(&after) ); // for debug only
+   const voter_object& v = static_cast<const voter_object&>(after);
+   if( std::make_pair( v.proxy_uid, v.proxy_sequence ) != _proxy_before )
+      _chains.clear();
+}
+
+const voter_object* voter_proxy_index::find( account_uid_type uid, uint32_t sequence )const
+{
+   auto itr = _voters.find( std::make_pair( uid, sequence ) );
+   return itr != _voters.end() ? itr->second : nullptr;
+}
+
+const vector<const voter_object*>& voter_proxy_index::proxy_chain( const voter_object& voter, uint8_t max_level )const
+{
+   if( max_level != _chains_max_level )
+   {
+      _chains.clear();
+      _chains_max_level = max_level;
+   }
+   auto itr = _chains.find( &voter );
+   if( itr != _chains.end() )
+      return itr->second;
+
+   vector<const voter_object*> chain;
+   const voter_object* current = &voter;
+   while( current->proxy_uid != GRAPHENE_PROXY_TO_SELF_ACCOUNT_UID && chain.size() < max_level )
+   {
+      current = find( current->proxy_uid, current->proxy_sequence );
+      FC_ASSERT( current != nullptr, "proxy of voter ${u} not found", ("u",voter.uid) );
+      chain.push_back( current );
+   }
+   return _chains.emplace( &voter, std::move( chain ) ).first->second;
+}
+
 void account_referrer_index::object_inserted( const object& obj )
 {
 }
@@ -275,4 +520,39 @@ void account_referrer_index::object_modified( const object& after  )
 {
 }
 
+void account_name_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
+   const account_object& a = static_cast<const account_object&>(obj);
+   _accounts[a.name] = &a;
+}
+
+void account_name_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
+   _accounts.erase( static_cast<const account_object&>(obj).name );
+}
+
+void account_name_index::about_to_modify( const object& before )
+{
+   assert( dynamic_cast<const account_object*>(&before) ); // for debug only
+   _name_before = static_cast<const account_object&>(before).name;
+}
+
+void account_name_index::object_modified( const object& after )
+{
+   assert( dynamic_cast<const account_object*>(&after) ); // for debug only
+   const account_object& a = static_cast<const account_object&>(after);
+   if( a.name == _name_before )
+      return;
+   _accounts.erase( _name_before );
+   _accounts[a.name] = &a;
+}
+
+const account_object* account_name_index::find( const string& name )const
+{
+   auto itr = _accounts.find( name );
+   return itr == _accounts.end() ? nullptr : itr->second;
+}
+
 } } // graphene::chain
@@ -6,6 +6,7 @@
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/hardfork.hpp>
 #include <graphene/chain/is_authorized_asset.hpp>
+#include <graphene/chain/object_counts.hpp>
 #include <graphene/chain/protocol/chain_parameters.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
 
@@ -100,18 +101,22 @@ void_result advertising_buy_evaluator::do_evaluate(const operation_type& op)
          "start time should be more than current time and not more than next ten years");
       FC_ASSERT((advertising_obj->last_order_sequence + 1) == op.advertising_order_oid, "advertising_order_oid ${pid} is invalid.", ("pid", op.advertising_order_oid));
 
-      const auto& idx = d.get_index_type<advertising_order_index>().indices().get<by_advertising_order_state>();
-      auto itr = idx.lower_bound(std::make_tuple(advertising_accepted, op.platform, op.advertising_aid));
-
       FC_ASSERT(advertising_obj->unit_time <= 10 * 365 * 86400 / op.buy_number, "advertising purchasing time should not more than ten years ");
 
       time_point_sec end_time = op.start_time + advertising_obj->unit_time * op.buy_number;
-      while (itr != idx.end() && itr->advertising_aid == op.advertising_aid && itr->platform == op.platform && itr->status == advertising_accepted) {
-         if (op.start_time >= itr->end_time || end_time <= itr->start_time) {
-            ++itr;
-            continue;
+      const auto& orders = dynamic_cast<const primary_index<advertising_order_index>&>( d.get_index_type<advertising_order_index>() );
+      if (orders.get_secondary_index<advertising_order_count_index>().order_count(op.platform, op.advertising_aid, advertising_accepted) > 0)
+      {
+         // only the accepted orders ending after the start may conflict
+         const auto& idx = orders.indices().get<by_advertising_order_end>();
+         auto itr = idx.upper_bound(std::make_tuple(advertising_accepted, op.platform, op.advertising_aid, op.start_time));
+         while (itr != idx.end() && itr->advertising_aid == op.advertising_aid && itr->platform == op.platform && itr->status == advertising_accepted) {
+            if (end_time <= itr->start_time) {
+               ++itr;
+               continue;
+            }
+            FC_ASSERT(false, "purchasing date have a conflict, buy advertising failed");
          }
-         FC_ASSERT(false, "purchasing date have a conflict, buy advertising failed");
       }
 
       necessary_balance = advertising_obj->unit_price * op.buy_number;
@@ -212,8 +217,14 @@ advertising_confirm_result advertising_confirm_evaluator::do_apply(const operati
 
          result.emplace(advertising_order_obj->user, 0);
 
-         const auto& idx = d.get_index_type<advertising_order_index>().indices().get<by_advertising_order_state>();
-         auto itr = idx.lower_bound(std::make_tuple(advertising_undetermined, op.platform, op.advertising_aid));
+         // the conflicting undetermined orders are refunded, in the order of by_advertising_order_state as the
+         // result keeps the first refund of each user
+         const auto& orders = dynamic_cast<const primary_index<advertising_order_index>&>( d.get_index_type<advertising_order_index>() );
+         const auto& counts = orders.get_secondary_index<advertising_order_count_index>();
+         const bool any_undetermined = counts.order_count(op.platform, op.advertising_aid, advertising_undetermined) > 0;
+         const auto& idx = orders.indices().get<by_advertising_order_state>();
+         auto itr = any_undetermined ? idx.lower_bound(std::make_tuple(advertising_undetermined, op.platform, op.advertising_aid))
+                                     : idx.end();
 
          vector<std::reference_wrapper<const advertising_order_object>> refs;
          while (itr != idx.end() && itr->platform == op.platform && itr->advertising_aid == op.advertising_aid && itr->status == advertising_undetermined)
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/applied_operations_log.hpp>
+#include <graphene/chain/protocol/fee_schedule.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+namespace graphene { namespace chain {
+
+namespace {
+   /// What the head file holds, it is written after the files it describes so that what follows is ignored on open
+   struct log_head
+   {
+      uint32_t first_block_num = 0;
+      uint32_t flushed_block_num = 0;
+      uint64_t data_size = 0;
+   };
+
+   void open_file( std::fstream& stream, const fc::path& filename )
+   {
+      stream.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+      if( !fc::exists( filename ) )
+         stream.open( filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc );
+      else
+         stream.open( filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+   }
+
+   uint64_t stream_size( std::fstream& stream )
+   {
+      stream.seekg( 0, stream.end );
+      return stream.tellg();
+   }
+}
+
+applied_operations_log::applied_operations_log() {}
+
+applied_operations_log::~applied_operations_log()
+{
+   close();
+}
+
+void applied_operations_log::open( const fc::path& dir )
+{ try {
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   close();
+   fc::create_directories( dir );
+   _dir = dir;
+
+   log_head head;
+   if( fc::exists( _dir / "head" ) )
+   {
+      std::ifstream head_file( ( _dir / "head" ).generic_string().c_str(), std::ios::in | std::ios::binary );
+      head_file.read( (char*)&head, sizeof(head) );
+      FC_ASSERT( uint64_t( head_file.gcount() ) == sizeof(head), "applied operations log head file is corrupted" );
+   }
+   _first_block_num   = head.first_block_num;
+   _flushed_block_num = head.flushed_block_num;
+   _data_size         = head.data_size;
+
+   open_file( _data, _dir / "operations" );
+   open_file( _blocks, _dir / "blocks" );
+   const uint64_t blocks = ( _first_block_num > 0 ? _flushed_block_num + 1 - _first_block_num : 0 );
+   FC_ASSERT( stream_size( _data ) >= _data_size && stream_size( _blocks ) >= blocks * sizeof(block_record),
+              "applied operations log files are missing data" );
+
+   _open = true;
+   ilog( "Opened applied operations log from block ${f} to ${b}", ("f",_first_block_num)("b",_flushed_block_num) );
+} FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+bool applied_operations_log::is_open()const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   return _open;
+}
+
+void applied_operations_log::close()
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   if( !_open )
+      return;
+   _blocks.close();
+   _data.close();
+   _pending.clear();
+   _first_block_num = 0;
+   _flushed_block_num = 0;
+   _data_size = 0;
+   _open = false;
+}
+
+uint32_t applied_operations_log::first_block_num()const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   return _first_block_num;
+}
+
+uint32_t applied_operations_log::last_block_num()const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   return _pending.empty() ? _flushed_block_num : _pending.back().block_num;
+}
+
+uint32_t applied_operations_log::flushed_block_num()const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   return _flushed_block_num;
+}
+
+void applied_operations_log::append_block( uint32_t block_num,
+                                           const vector< optional<operation_history_object> >& operations )
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   FC_ASSERT( _open );
+   FC_ASSERT( _first_block_num == 0 || block_num == last_block_num() + 1,
+              "blocks must be added to the applied operations log in order",
+              ("block",block_num)("last",last_block_num()) );
+   if( _first_block_num == 0 )
+   {
+      _first_block_num = block_num;
+      _flushed_block_num = block_num - 1;
+   }
+
+   pending_block b;
+   b.block_num = block_num;
+   b.operations.reserve( operations.size() );
+   for( const auto& op : operations )
+   {
+      if( op.valid() )
+         b.operations.push_back( *op );
+   }
+   _pending.push_back( std::move( b ) );
+}
+
+void applied_operations_log::discard_from_block( uint32_t block_num )
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   FC_ASSERT( _first_block_num == 0 || block_num > _flushed_block_num,
+              "block ${b} is already written to the applied operations log", ("b",block_num)("flushed",_flushed_block_num) );
+   while( !_pending.empty() && _pending.back().block_num >= block_num )
+      _pending.pop_back();
+   if( _flushed_block_num + 1 == _first_block_num && _pending.empty() )
+   {
+      _first_block_num = 0;
+      _flushed_block_num = 0;
+   }
+}
+
+void applied_operations_log::flush_until_block( uint32_t block_num )
+{ try {
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   if( !_open || _pending.empty() || _pending.front().block_num > block_num )
+      return;
+
+   _data.seekp( _data_size );
+   _blocks.seekp( sizeof(block_record) * ( _pending.front().block_num - _first_block_num ) );
+   while( !_pending.empty() && _pending.front().block_num <= block_num )
+   {
+      const pending_block& b = _pending.front();
+      const vector<char> data = fc::raw::pack( b.operations );
+      block_record r;
+      r.pos       = _data_size;
+      r.size      = data.size();
+      r.block_num = b.block_num;
+      _data.write( data.data(), data.size() );
+      _blocks.write( (const char*)&r, sizeof(r) );
+      _data_size += data.size();
+      _flushed_block_num = b.block_num;
+      _pending.pop_front();
+   }
+
+   _data.flush();
+   _blocks.flush();
+   save_head();
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+optional< vector<operation_history_object> > applied_operations_log::get_block( uint32_t block_num )const
+{ try {
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   optional< vector<operation_history_object> > result;
+   if( !_open || _first_block_num == 0 || block_num < _first_block_num )
+      return result;
+   if( block_num > _flushed_block_num )
+   {
+      for( const pending_block& b : _pending )
+      {
+         if( b.block_num == block_num )
+            return b.operations;
+      }
+      return result;
+   }
+
+   block_record r;
+   _blocks.seekg( sizeof(r) * ( block_num - _first_block_num ) );
+   _blocks.read( (char*)&r, sizeof(r) );
+   FC_ASSERT( r.block_num == block_num, "applied operations log is corrupted at block ${b}", ("b",block_num) );
+   vector<char> data( r.size );
+   _data.seekg( r.pos );
+   _data.read( data.data(), data.size() );
+   result = fc::raw::unpack< vector<operation_history_object> >( data );
+   return result;
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+void applied_operations_log::save_head()const
+{
+   log_head head;
+   head.first_block_num   = _first_block_num;
+   head.flushed_block_num = _flushed_block_num;
+   head.data_size         = _data_size;
+   // written beside the head and renamed over it, so that a crash leaves either the old head or the new one
+   const fc::path tmp_file = _dir / "head.tmp";
+   {
+      std::ofstream head_file( tmp_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+      head_file.write( (const char*)&head, sizeof(head) );
+      head_file.flush();
+      FC_ASSERT( head_file.good(), "Unable to write ${f}", ("f",tmp_file) );
+   }
+   fc::rename( tmp_file, _dir / "head" );
+}
+
+} } // graphene::chain
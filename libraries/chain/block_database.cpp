@@ -22,23 +22,57 @@
  * THE SOFTWARE.
  */
 #include <graphene/chain/block_database.hpp>
+#include <graphene/chain/config.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
 #include <fc/io/raw.hpp>
+#include <fc/interprocess/file_mapping.hpp>
 #include <fc/smart_ref_impl.hpp>
 
-namespace graphene { namespace chain {
+#include <zlib.h>
+#include <limits>
 
-struct index_entry
-{
-   uint64_t      block_pos = 0;
-   uint32_t      block_size = 0;
-   block_id_type block_id;
-};
- }}
-FC_REFLECT( graphene::chain::index_entry, (block_pos)(block_size)(block_id) );
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace graphene { namespace chain {
 
+namespace {
+   /**
+    * Compresses a serialized block to a frame: the size of the block followed by its zlib stream.
+    * @return false if the frame isn't smaller than the block
+    */
+   bool compress_block_data( const vector<char>& data, vector<char>& frame )
+   {
+      const uint32_t raw_size = data.size();
+      uLongf stream_size = compressBound( data.size() );
+      frame.resize( sizeof(raw_size) + stream_size );
+      memcpy( frame.data(), (const char*)&raw_size, sizeof(raw_size) );
+      if( compress2( (Bytef*)frame.data() + sizeof(raw_size), &stream_size, (const Bytef*)data.data(), data.size(),
+                     GRAPHENE_BLOCK_DATABASE_COMPRESSION_LEVEL ) != Z_OK )
+         return false;
+      frame.resize( sizeof(raw_size) + stream_size );
+      return frame.size() < data.size();
+   }
+
+   /// makes what was written to file so far durable, a no-op where there's no fsync()
+   void sync_file( const fc::path& file )
+   {
+#ifndef _WIN32
+      const int fd = ::open( file.generic_string().c_str(), O_RDONLY );
+      FC_ASSERT( fd >= 0, "Unable to open ${f} to sync it", ("f",file) );
+      const int result = ::fsync( fd );
+      ::close( fd );
+      FC_ASSERT( result == 0, "Unable to sync ${f}", ("f",file) );
+#endif
+   }
+}
+
+block_database::block_database() {}
+
+block_database::~block_database() {}
+
 void block_database::open( const fc::path& dbdir )
 { try {
    fc::create_directories(dbdir);
@@ -46,18 +80,43 @@ void block_database::open( const fc::path& dbdir )
    _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
 
    _index_filename = dbdir / "index";
+   _blocks_filename = dbdir / "blocks";
    if( !fc::exists( _index_filename ) )
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+     _blocks.open( _blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
    }
    else
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+     _blocks.open( _blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
    }
+   _index_entries = fc::file_size( _index_filename ) / sizeof(index_entry);
+   _blocks_written = fc::file_size( _blocks_filename );
+   load_recent_ids();
 } FC_CAPTURE_AND_RETHROW( (dbdir) ) }
 
+void block_database::load_recent_ids()const
+{
+   // room for the chain to grow before the ids wrap around, unless less are to be kept
+   const uint64_t size = std::min<uint64_t>( _ids_kept, std::max<uint64_t>( GRAPHENE_BLOCK_DATABASE_RECENT_IDS,
+                                                                            uint64_t(_index_entries) * 2 ) );
+   _recent_ids.assign( size, block_id_type() );
+   if( _index_entries == 0 )
+      return;
+   const uint32_t first = _index_entries > size ? _index_entries - size : 0;
+   // read in chunks, all the ids may be kept
+   vector<index_entry> entries;
+   for( uint64_t chunk = first; chunk < _index_entries; chunk += GRAPHENE_BLOCK_DATABASE_RECENT_IDS )
+   {
+      const uint32_t last = std::min<uint64_t>( _index_entries, chunk + GRAPHENE_BLOCK_DATABASE_RECENT_IDS ) - 1;
+      fetch_index_entries( chunk, last, entries );
+      for( size_t i = 0; i < entries.size(); ++i )
+         if( entries[i].block_size > 0 )
+            _recent_ids[ ( chunk + i ) % _recent_ids.size() ] = entries[i].block_id;
+   }
+}
+
 bool block_database::is_open()const
 {
   return _blocks.is_open();
@@ -65,16 +124,192 @@ bool block_database::is_open()const
 
 void block_database::close()
 {
+  if( is_open() )
+     write_pending();
+  unmap();
   _blocks.close();
   _block_num_to_pos.close();
+  _index_entries = 0;
+  _recent_ids.clear();
+  _cache.clear();
+  _blocks_written = 0;
+  _pending_data.clear();
+  _pending_entries.clear();
+}
+
+void block_database::set_ids_kept( uint32_t count )
+{
+   _ids_kept = count > 0 ? count : std::numeric_limits<uint32_t>::max();
+   if( is_open() )
+      load_recent_ids();
+}
+
+void block_database::set_cache_size( uint32_t size )
+{
+   _cache_size = size;
+   while( _cache.size() > _cache_size )
+      _cache.erase( _cache.begin() );
+}
+
+const block_database::cached_block* block_database::find_cached( uint32_t block_num )const
+{
+   auto itr = _cache.find( block_num );
+   return itr != _cache.end() ? &itr->second : nullptr;
 }
 
 void block_database::flush()
 {
+  write_pending();
   _blocks.flush();
   _block_num_to_pos.flush();
 }
 
+void block_database::write_pending()const
+{
+   if( _pending_entries.empty() )
+      return;
+   if( !_pending_data.empty() )
+   {
+      _blocks.seekp( _blocks_written );
+      _blocks.write( _pending_data.data(), _pending_data.size() );
+      _blocks_written += _pending_data.size();
+      _pending_data.clear();
+   }
+   // one write per run of consecutive block numbers, a fork switch leaves a single run
+   vector<index_entry> run;
+   auto itr = _pending_entries.begin();
+   while( itr != _pending_entries.end() )
+   {
+      const uint32_t first = itr->first;
+      run.clear();
+      for( ; itr != _pending_entries.end() && itr->first == first + run.size(); ++itr )
+         run.push_back( itr->second );
+      _block_num_to_pos.seekp( sizeof(index_entry) * uint64_t(first) );
+      _block_num_to_pos.write( (const char*)run.data(), run.size() * sizeof(index_entry) );
+   }
+   _pending_entries.clear();
+   _blocks.flush();
+   _block_num_to_pos.flush();
+   if( _sync_writes )
+   {
+      sync_file( _blocks_filename );
+      sync_file( _index_filename );
+   }
+}
+
+void block_database::unmap()const
+{
+   _index_region.reset();
+   _index_mapping.reset();
+   _blocks_region.reset();
+   _blocks_mapping.reset();
+}
+
+void block_database::remap( bool index_file, uint64_t required_size )const
+{
+   std::fstream& stream = index_file ? _block_num_to_pos : _blocks;
+   std::unique_ptr<fc::file_mapping>& mapping = index_file ? _index_mapping : _blocks_mapping;
+   std::unique_ptr<fc::mapped_region>& region = index_file ? _index_region : _blocks_region;
+   const fc::path& filename = index_file ? _index_filename : _blocks_filename;
+
+   // make sure everything written through the stream is visible through the mapping
+   stream.flush();
+   const uint64_t file_size = fc::file_size( filename );
+   if( file_size < required_size || file_size == 0 )
+      return;
+   if( region && region->get_size() >= file_size )
+      return;
+
+   region.reset();
+   mapping.reset( new fc::file_mapping( filename.generic_string().c_str(), fc::read_only ) );
+   region.reset( new fc::mapped_region( *mapping, fc::read_only, 0, file_size ) );
+}
+
+bool block_database::read_index_entry( uint32_t block_num, index_entry& e )const
+{
+   write_pending();
+   const uint64_t index_pos = sizeof(e) * uint64_t(block_num);
+   if( _use_mmap )
+   {
+      if( !_index_region || _index_region->get_size() < index_pos + sizeof(e) )
+         remap( true, index_pos + sizeof(e) );
+      if( !_index_region || _index_region->get_size() < index_pos + sizeof(e) )
+         return false;
+      memcpy( (char*)&e, (const char*)_index_region->get_address() + index_pos, sizeof(e) );
+      return true;
+   }
+
+   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+   if ( _block_num_to_pos.tellg() < int64_t(index_pos + sizeof(e)) )
+      return false;
+   _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
+   _block_num_to_pos.read( (char*)&e, sizeof(e) );
+   return true;
+}
+
+void block_database::fetch_index_entries( uint32_t first, uint32_t last, vector<index_entry>& entries )const
+{
+   write_pending();
+   entries.clear();
+   const uint64_t first_pos = sizeof(index_entry) * uint64_t(first);
+   const uint64_t wanted_size = sizeof(index_entry) * ( uint64_t(last) - first + 1 );
+   uint64_t index_size = 0;
+   if( _use_mmap )
+   {
+      if( !_index_region || _index_region->get_size() < first_pos + wanted_size )
+         remap( true, first_pos + sizeof(index_entry) );
+      if( _index_region )
+         index_size = _index_region->get_size();
+   }
+   else
+   {
+      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+      index_size = _block_num_to_pos.tellg();
+   }
+   if( index_size < first_pos + sizeof(index_entry) )
+      return;
+
+   const size_t count = std::min( wanted_size, index_size - first_pos ) / sizeof(index_entry);
+   entries.resize( count );
+   if( _use_mmap )
+      memcpy( (char*)entries.data(), (const char*)_index_region->get_address() + first_pos, count * sizeof(index_entry) );
+   else
+   {
+      _block_num_to_pos.seekg( first_pos, _block_num_to_pos.beg );
+      _block_num_to_pos.read( (char*)entries.data(), count * sizeof(index_entry) );
+   }
+}
+
+const char* block_database::mapped_block_data( const index_entry& e )const
+{
+   const uint64_t end_pos = e.block_pos + e.stored_size();
+   if( !_blocks_region || _blocks_region->get_size() < end_pos )
+      remap( false, end_pos );
+   if( !_blocks_region || _blocks_region->get_size() < end_pos )
+      return nullptr;
+   return (const char*)_blocks_region->get_address() + e.block_pos;
+}
+
+void block_database::decode_block_data( const index_entry& e, const char* stored, vector<char>& data )
+{
+   const uint32_t size = e.stored_size();
+   if( !e.is_compressed() )
+   {
+      data.assign( stored, stored + size );
+      return;
+   }
+
+   uint32_t raw_size = 0;
+   FC_ASSERT( size > sizeof(raw_size), "Compressed block frame is too short" );
+   memcpy( (char*)&raw_size, stored, sizeof(raw_size) );
+   FC_ASSERT( raw_size < index_entry::compressed_flag, "Bad size in compressed block frame" );
+   data.resize( raw_size );
+   uLongf decoded_size = raw_size;
+   const int result = uncompress( (Bytef*)data.data(), &decoded_size,
+                                  (const Bytef*)stored + sizeof(raw_size), size - sizeof(raw_size) );
+   FC_ASSERT( result == Z_OK && decoded_size == raw_size, "Unable to decompress block frame", ("result",result) );
+}
+
 void block_database::store( const block_id_type& _id, const signed_block& b )
 {
    block_id_type id = _id;
@@ -84,19 +319,64 @@ void block_database::store( const block_id_type& _id, const signed_block& b )
       elog( "id argument of block_database::store() was not initialized for block ${id}", ("id", id) );
    }
    auto num = block_header::num_from_id(id);
-   _block_num_to_pos.seekp( sizeof( index_entry ) * num );
    index_entry e;
-   _blocks.seekp( 0, _blocks.end );
-   auto vec = fc::raw::pack( b );
-   e.block_pos  = _blocks.tellp();
-   e.block_size = vec.size();
+   auto raw = std::make_shared<vector<char>>( fc::raw::pack( b ) );
+   const vector<char>* vec = raw.get();
+   vector<char> frame;
+   uint32_t flags = 0;
+   if( _compress && compress_block_data( *raw, frame ) )
+   {
+      vec = &frame;
+      flags = index_entry::compressed_flag;
+   }
+   e.block_pos  = _blocks_written + _pending_data.size();
+   e.block_size = uint32_t( vec->size() ) | flags;
    e.block_id   = id;
-   _blocks.write( vec.data(), vec.size() );
-   _block_num_to_pos.write( (char*)&e, sizeof(e) );
+   _pending_data.insert( _pending_data.end(), vec->begin(), vec->end() );
+   _pending_entries[num] = e;
+   if( _pending_entries.size() >= _write_batch || _pending_data.size() >= GRAPHENE_BLOCK_DATABASE_MAX_WRITE_BATCH_BYTES )
+      write_pending();
+
+   if( num >= _index_entries )
+   {
+      // while the ids haven't wrapped around, block n is at n, the vector grows in place up to _ids_kept
+      if( num >= _recent_ids.size() && _recent_ids.size() < _ids_kept && _index_entries <= _recent_ids.size() )
+         _recent_ids.resize( std::min<uint64_t>( _ids_kept, std::max<uint64_t>( _recent_ids.size() * 2, uint64_t(num) + 1 ) ) );
+      // the numbers skipped have empty entries
+      const uint64_t first_skipped = std::max<uint64_t>( _index_entries,
+                                                         uint64_t(num) + 1 - std::min<uint64_t>( num + 1, _recent_ids.size() ) );
+      for( uint64_t n = first_skipped; n < num; ++n )
+         _recent_ids[ n % _recent_ids.size() ] = block_id_type();
+      _index_entries = num + 1;
+   }
+   if( is_recent( num ) )
+      _recent_ids[ num % _recent_ids.size() ] = id;
+
+   if( _cache_size > 0 )
+   {
+      _cache[num] = cached_block{ id, std::make_shared<const signed_block>( b ), std::move( raw ) };
+      while( _cache.size() > _cache_size )
+         _cache.erase( _cache.begin() );
+   }
 }
 
 void block_database::remove( const block_id_type& id )
 { try {
+   const uint32_t num = block_header::num_from_id(id);
+   // a block not written yet is removed in memory, e.g. by a fork switch within the batch
+   auto pending = _pending_entries.find( num );
+   if( pending != _pending_entries.end() )
+   {
+      if( pending->second.block_id == id && pending->second.block_size > 0 )
+      {
+         pending->second.block_size = 0;
+         if( is_recent( num ) && _recent_ids[ num % _recent_ids.size() ] == id )
+            _recent_ids[ num % _recent_ids.size() ] = block_id_type();
+         _cache.erase( num );
+      }
+      return;
+   }
+
    index_entry e;
    auto index_pos = sizeof(e)*block_header::num_from_id(id);
    _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
@@ -111,6 +391,12 @@ void block_database::remove( const block_id_type& id )
       e.block_size = 0;
       _block_num_to_pos.seekp( sizeof(e)*block_header::num_from_id(id) );
       _block_num_to_pos.write( (char*)&e, sizeof(e) );
+      if( _use_mmap )
+         _block_num_to_pos.flush();
+
+      if( is_recent( num ) && _recent_ids[ num % _recent_ids.size() ] == id )
+         _recent_ids[ num % _recent_ids.size() ] = block_id_type();
+      _cache.erase( num );
    }
 } FC_CAPTURE_AND_RETHROW( (id) ) }
 
@@ -119,13 +405,15 @@ bool block_database::contains( const block_id_type& id )const
    if( id == block_id_type() )
       return false;
 
+   const uint32_t num = block_header::num_from_id(id);
+   if( num >= _index_entries )
+      return false;
+   if( is_recent( num ) )
+      return _recent_ids[ num % _recent_ids.size() ] == id;
+
    index_entry e;
-   auto index_pos = sizeof(e)*block_header::num_from_id(id);
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() < index_pos + sizeof(e) )
+   if( !read_index_entry( num, e ) )
       return false;
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
 
    return e.block_id == id && e.block_size > 0;
 }
@@ -133,15 +421,13 @@ bool block_database::contains( const block_id_type& id )const
 block_id_type block_database::fetch_block_id( uint32_t block_num )const
 {
    assert( block_num != 0 );
+   if( is_recent( block_num ) && _recent_ids[ block_num % _recent_ids.size() ] != block_id_type() )
+      return _recent_ids[ block_num % _recent_ids.size() ];
+
    index_entry e;
-   auto index_pos = sizeof(e)*block_num;
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() <= int64_t(index_pos) )
+   if( !read_index_entry( block_num, e ) )
       FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
 
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
    FC_ASSERT( e.block_id != block_id_type(), "Empty block_id in block_database (maybe corrupt on disk?)" );
    return e.block_id;
 }
@@ -150,24 +436,22 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
 {
    try
    {
+      const uint32_t num = block_header::num_from_id(id);
+      if( num >= _index_entries
+          || ( is_recent( num ) && _recent_ids[ num % _recent_ids.size() ] != id ) )
+         return optional<signed_block>();
+
+      const cached_block* cached = find_cached( num );
+      if( cached != nullptr && cached->id == id )
+         return *cached->block;
+
       index_entry e;
-      auto index_pos = sizeof(e)*block_header::num_from_id(id);
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
+      if( !read_index_entry( num, e ) )
          return {};
 
-      _block_num_to_pos.seekg( index_pos );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
       if( e.block_id != id ) return optional<signed_block>();
 
-      vector<char> data( e.block_size );
-      _blocks.seekg( e.block_pos );
-      if (e.block_size)
-         _blocks.read( data.data(), e.block_size );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+      return read_block( e );
    }
    catch (const fc::exception&)
    {
@@ -182,21 +466,100 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
 {
    try
    {
+      const cached_block* cached = find_cached( block_num );
+      if( cached != nullptr )
+         return *cached->block;
+
       index_entry e;
-      auto index_pos = sizeof(e)*block_num;
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
+      if( !read_index_entry( block_num, e ) )
          return {};
 
-      _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
+      return read_block( e );
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<signed_block>();
+}
 
-      vector<char> data( e.block_size );
+signed_block block_database::read_block( const index_entry& e )const
+{
+   signed_block result;
+   if( _use_mmap )
+   {
+      const char* data = mapped_block_data( e );
+      FC_ASSERT( data != nullptr, "Block data is beyond the end of the blocks file" );
+      if( e.is_compressed() )
+      {
+         vector<char> decoded;
+         decode_block_data( e, data, decoded );
+         result = fc::raw::unpack<signed_block>(decoded);
+      }
+      else
+      {
+         // unpack straight from the mapping, no intermediate copy
+         fc::datastream<const char*> ds( data, e.block_size );
+         fc::raw::unpack( ds, result );
+      }
+   }
+   else
+   {
+      vector<char> data( e.stored_size() );
       _blocks.seekg( e.block_pos );
-      _blocks.read( data.data(), e.block_size );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+      if( e.stored_size() )
+         _blocks.read( data.data(), e.stored_size() );
+      if( e.is_compressed() )
+      {
+         vector<char> decoded;
+         decode_block_data( e, data.data(), decoded );
+         data.swap( decoded );
+      }
+      result = fc::raw::unpack<signed_block>(data);
+   }
+   FC_ASSERT( result.id() == e.block_id );
+   return result;
+}
+
+bool block_database::fetch_raw_by_number( uint32_t block_num, block_id_type& id, vector<char>& data )const
+{
+   try
+   {
+      const cached_block* cached = find_cached( block_num );
+      if( cached != nullptr )
+      {
+         id = cached->id;
+         data = *cached->data;
+         return true;
+      }
+
+      index_entry e;
+      if( !read_index_entry( block_num, e ) || e.block_size == 0 )
+         return false;
+
+      if( _use_mmap )
+      {
+         const char* mapped = mapped_block_data( e );
+         if( mapped == nullptr )
+            return false;
+         decode_block_data( e, mapped, data );
+      }
+      else
+      {
+         data.resize( e.stored_size() );
+         _blocks.seekg( e.block_pos );
+         _blocks.read( data.data(), e.stored_size() );
+         if( e.is_compressed() )
+         {
+            vector<char> decoded;
+            decode_block_data( e, data.data(), decoded );
+            data.swap( decoded );
+         }
+      }
+      id = e.block_id;
+      return true;
    }
    catch (const fc::exception&)
    {
@@ -204,12 +567,148 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
    catch (const std::exception&)
    {
    }
-   return optional<signed_block>();
+   return false;
+}
+
+void block_database::fetch_raw_range( uint32_t first, uint32_t last,
+                                      vector<block_id_type>& ids, vector< vector<char> >& data )const
+{
+   ids.clear();
+   data.clear();
+   if( first > last )
+      return;
+   ids.resize( uint64_t(last) - first + 1 );
+   data.resize( ids.size() );
+
+   vector<index_entry> entries;
+   try
+   {
+      fetch_index_entries( first, last, entries );
+   }
+   catch (const fc::exception&)
+   {
+      return;
+   }
+   catch (const std::exception&)
+   {
+      return;
+   }
+
+   // the cached blocks are copied, their entries are skipped below
+   for( size_t k = 0; k < entries.size(); ++k )
+   {
+      const cached_block* cached = entries[k].block_size > 0 ? find_cached( first + k ) : nullptr;
+      if( cached != nullptr )
+      {
+         ids[k] = cached->id;
+         data[k] = *cached->data;
+         entries[k].block_size = 0;
+      }
+   }
+
+   size_t i = 0;
+   while( i < entries.size() )
+   {
+      if( entries[i].block_size == 0 )
+      {
+         ++i;
+         continue;
+      }
+      // extend the run while the next block starts where this one ends
+      const uint64_t run_pos = entries[i].block_pos;
+      uint64_t run_end = run_pos + entries[i].stored_size();
+      size_t j = i + 1;
+      while( j < entries.size() && entries[j].block_size > 0 && entries[j].block_pos == run_end
+             && run_end + entries[j].stored_size() - run_pos <= GRAPHENE_BLOCK_DATABASE_MAX_RANGE_READ )
+      {
+         run_end += entries[j].stored_size();
+         ++j;
+      }
+
+      try
+      {
+         const char* run_data = nullptr;
+         vector<char> buffer;
+         if( _use_mmap )
+         {
+            index_entry run;
+            run.block_pos  = run_pos;
+            run.block_size = run_end - run_pos;
+            run_data = mapped_block_data( run );
+         }
+         else
+         {
+            buffer.resize( run_end - run_pos );
+            _blocks.seekg( run_pos );
+            _blocks.read( buffer.data(), buffer.size() );
+            run_data = buffer.data();
+         }
+         if( run_data != nullptr )
+         {
+            for( size_t k = i; k < j; ++k )
+            {
+               const char* block_data = run_data + ( entries[k].block_pos - run_pos );
+               decode_block_data( entries[k], block_data, data[k] );
+               ids[k] = entries[k].block_id;
+            }
+         }
+      }
+      catch (const fc::exception&)
+      {
+      }
+      catch (const std::exception&)
+      {
+      }
+      i = j;
+   }
 }
 
+uint32_t block_database::export_range( uint32_t first, uint32_t last, const fc::path& dir )const
+{ try {
+   FC_ASSERT( first <= last );
+   fc::create_directories( dir );
+   std::ofstream index_out( ( dir / "index" ).generic_string().c_str(), std::ios::binary | std::ios::out | std::ios::trunc );
+   std::ofstream blocks_out( ( dir / "blocks" ).generic_string().c_str(), std::ios::binary | std::ios::out | std::ios::trunc );
+   index_out.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   blocks_out.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+
+   // the entries keep their positions, so prior to first the index has empty entries
+   const index_entry empty;
+   for( uint32_t n = 0; n < first; ++n )
+      index_out.write( (const char*)&empty, sizeof(empty) );
+
+   uint32_t exported = 0;
+   uint64_t blocks_pos = 0;
+   vector<block_id_type> ids;
+   vector< vector<char> > data;
+   // ranges are bounded so a large export doesn't hold all the blocks in memory
+   const uint32_t batch = 1000;
+   for( uint64_t batch_first = first; batch_first <= last; batch_first += batch )
+   {
+      const uint32_t batch_last = std::min<uint64_t>( last, batch_first + batch - 1 );
+      fetch_raw_range( batch_first, batch_last, ids, data );
+      for( size_t i = 0; i < data.size(); ++i )
+      {
+         index_entry e;
+         if( !data[i].empty() )
+         {
+            e.block_pos  = blocks_pos;
+            e.block_size = data[i].size();
+            e.block_id   = ids[i];
+            blocks_out.write( data[i].data(), data[i].size() );
+            blocks_pos += data[i].size();
+            ++exported;
+         }
+         index_out.write( (const char*)&e, sizeof(e) );
+      }
+   }
+   return exported;
+} FC_CAPTURE_AND_RETHROW( (first)(last)(dir) ) }
+
 optional<index_entry> block_database::last_index_entry()const {
    try
    {
+      write_pending();
       index_entry e;
 
       _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
@@ -221,23 +720,35 @@ optional<index_entry> block_database::last_index_entry()const {
 
       _blocks.seekg( 0, _block_num_to_pos.end );
       const std::streampos blocks_size = _blocks.tellg();
+      bool truncated = false;
       while( pos > 0 )
       {
          pos -= sizeof(index_entry);
          _block_num_to_pos.seekg( pos );
          _block_num_to_pos.read( (char*)&e, sizeof(e) );
          if( _block_num_to_pos.gcount() == sizeof(e) && e.block_size > 0
-                && e.block_pos + e.block_size <= blocks_size )
+                && e.block_pos + e.stored_size() <= blocks_size )
             try
             {
-               vector<char> data( e.block_size );
+               vector<char> data( e.stored_size() );
                _blocks.seekg( e.block_pos );
-               _blocks.read( data.data(), e.block_size );
-               if( _blocks.gcount() == e.block_size )
+               _blocks.read( data.data(), e.stored_size() );
+               if( _blocks.gcount() == e.stored_size() )
                {
+                  if( e.is_compressed() )
+                  {
+                     vector<char> decoded;
+                     decode_block_data( e, data.data(), decoded );
+                     data.swap( decoded );
+                  }
                   const signed_block block = fc::raw::unpack<signed_block>(data);
                   if( block.id() == e.block_id )
+                  {
+                     // the numbers the ids are kept of moved back
+                     if( truncated )
+                        load_recent_ids();
                      return e;
+                  }
                }
             }
             catch (const fc::exception&)
@@ -246,8 +757,14 @@ optional<index_entry> block_database::last_index_entry()const {
             catch (const std::exception&)
             {
             }
+         // the mapping must not outlive the part of the file that is cut off
+         unmap();
          fc::resize_file( _index_filename, pos );
+         _index_entries = pos / sizeof(index_entry);
+         truncated = true;
       }
+      if( truncated )
+         load_recent_ids();
    }
    catch (const fc::exception&)
    {
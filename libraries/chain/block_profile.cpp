@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/block_profile.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace chain {
+
+void block_profiler::record( const block_profile& profile )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( _max_size == 0 )
+      return;
+   if( _profiles.size() >= _max_size )
+      _profiles.pop_front();
+   _profiles.push_back( profile );
+}
+
+vector<block_profile> block_profiler::get_recent( uint32_t limit )const
+{
+   vector<block_profile> result;
+   std::lock_guard<std::mutex> lock( _mutex );
+   result.reserve( std::min<size_t>( limit, _profiles.size() ) );
+   for( auto itr = _profiles.rbegin(); itr != _profiles.rend() && result.size() < limit; ++itr )
+      result.push_back( *itr );
+   return result;
+}
+
+void block_profiler::set_max_size( size_t max_size )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _max_size = max_size;
+   while( _profiles.size() > _max_size )
+      _profiles.pop_front();
+}
+
+size_t block_profiler::get_max_size()const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   return _max_size;
+}
+
+} } // graphene::chain
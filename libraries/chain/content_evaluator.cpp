@@ -458,7 +458,7 @@ void_result post_evaluator::do_evaluate( const post_operation& op )
    if (d.head_block_time() >= HARDFORK_0_4_TIME){
       FC_ASSERT(op.extensions.valid(), "post_operation must include extension from HARDFORK_0_4_TIME.");
       ext_para = &op.extensions->value;
-      account_uid_type sign_account = sigs.real_secondary_uid(op.poster, 1);
+      account_uid_type sign_account = sigs->real_secondary_uid(op.poster, 1);
       if (sign_account != op.poster)
          auth_object = d.find_account_auth_platform_object_by_account_platform(op.poster, sign_account);
 
@@ -589,14 +589,14 @@ object_id_type post_evaluator::do_apply( const post_operation& o )
          {
             const auto& apt_idx = d.get_index_type<active_post_index>().indices().get<by_post_pid>();
             auto apt_itr = apt_idx.find(std::make_tuple(*o.origin_platform, *o.origin_poster, dpo.current_active_post_sequence, *o.origin_post_pid));
+            const active_post_object* active_post = nullptr;
             if (apt_itr != apt_idx.end())
             {
                d.modify(*apt_itr, [&](active_post_object& obj)
                {
                   obj.forward_award += forwardprice.value;
-                  for (const auto& p : receiptors)
-                     obj.insert_receiptor(p.first, 0, p.second);
                });
+               active_post = &(*apt_itr);
             }
             else
             {
@@ -604,26 +604,26 @@ object_id_type post_evaluator::do_apply( const post_operation& o )
                expiration_time += d.get_global_properties().parameters.get_extension_params().post_award_expiration;
                if (expiration_time >= d.head_block_time())
                {
-                  d.create<active_post_object>([&](active_post_object& obj)
+                  active_post = &d.create<active_post_object>([&](active_post_object& obj)
                   {
                      obj.platform = *o.origin_platform;
                      obj.poster = *o.origin_poster;
                      obj.post_pid = *o.origin_post_pid;
                      obj.period_sequence = dpo.current_active_post_sequence;
                      obj.forward_award += forwardprice.value;
-                     for (const auto& p : receiptors)
-                        obj.insert_receiptor(p.first, 0, p.second);
                   });
                }
             }
+            if (active_post != nullptr)
+            {
+               for (const auto& p : receiptors)
+                  d.add_active_post_receipts(*active_post, p.first, 0, p.second);
+            }
          }
 
          const platform_object* plat_obj = d.find_platform_by_owner(origin_post->platform);
          if (plat_obj){
-            d.modify(*plat_obj, [&](platform_object& obj)
-            {
-               obj.add_period_profits(dpo.current_active_post_sequence, d.get_active_post_periods(), asset(), surplus.convert_to<int64_t>(), 0, 0);
-            });
+            d.add_platform_period_profits(*plat_obj, dpo.current_active_post_sequence, asset(), surplus.convert_to<int64_t>(), 0, 0);
          }
       }
 
@@ -636,9 +636,9 @@ object_id_type post_evaluator::do_apply( const post_operation& o )
          obj.origin_post_pid = o.origin_post_pid;
          obj.origin_platform = o.origin_platform;
          obj.hash_value = o.hash_value;
-         obj.extra_data = o.extra_data;
+         d.set_post_content( o.extra_data, obj.extra_data, obj.extra_data_ref );
          obj.title = o.title;
-         obj.body = o.body;
+         d.set_post_content( o.body, obj.body, obj.body_ref );
          obj.create_time = d.head_block_time();
          obj.last_update_time = d.head_block_time();
          obj.score_settlement = false;
@@ -690,7 +690,7 @@ void_result post_update_evaluator::do_evaluate( const operation_type& op )
    d.get_platform_by_owner( op.platform ); // make sure pid exists
    const account_object* poster_account = &d.get_account_by_uid( op.poster );
    const _account_statistics_object* account_stats = &d.get_account_statistics_by_uid(op.poster);
-   account_uid_type sign_account = sigs.real_secondary_uid(op.poster, 1);
+   account_uid_type sign_account = sigs->real_secondary_uid(op.poster, 1);
 
    if (d.head_block_time() >= HARDFORK_0_4_TIME){
       bool is_update_content = op.hash_value.valid() || op.extra_data.valid() || op.title.valid() || op.body.valid();
@@ -724,7 +724,7 @@ void_result post_update_evaluator::do_evaluate( const operation_type& op )
       {
          account_uid_type receiptor_uid = *(ext_para->receiptor);
          d.get_account_by_uid(receiptor_uid);
-         account_uid_type sign_account_receiptor = sigs.real_secondary_uid(receiptor_uid, 1);
+         account_uid_type sign_account_receiptor = sigs->real_secondary_uid(receiptor_uid, 1);
          if (sign_account_receiptor != receiptor_uid){
             auto receiptor_auth_object = d.find_account_auth_platform_object_by_account_platform(receiptor_uid, sign_account_receiptor);
             if (receiptor_auth_object){
@@ -802,11 +802,11 @@ object_id_type post_update_evaluator::do_apply( const operation_type& o )
       if (o.hash_value.valid())
          obj.hash_value = *o.hash_value;
       if (o.extra_data.valid())
-         obj.extra_data = *o.extra_data;
+         d.set_post_content( *o.extra_data, obj.extra_data, obj.extra_data_ref );
       if (o.title.valid())
          obj.title = *o.title;
       if (o.body.valid())
-         obj.body = *o.body;
+         d.set_post_content( *o.body, obj.body, obj.body_ref );
 
       if (ext_para && d.head_block_time() >= HARDFORK_0_4_TIME)
       {
@@ -859,7 +859,7 @@ void_result score_create_evaluator::do_evaluate(const operation_type& op)
       FC_ASSERT(op.csaf <= global_params.max_csaf_per_approval, "The score_create_operation`s member points is over the maximum limit");
 
       const _account_statistics_object* account_stats = &d.get_account_statistics_by_uid(op.from_account_uid);
-      account_uid_type sign_account = sigs.real_secondary_uid(op.from_account_uid, 1);
+      account_uid_type sign_account = sigs->real_secondary_uid(op.from_account_uid, 1);
       if (sign_account != 0 && sign_account != op.from_account_uid){
          auth_object = d.find_account_auth_platform_object_by_account_platform(op.from_account_uid, sign_account);
       }
@@ -878,7 +878,10 @@ void_result score_create_evaluator::do_evaluate(const operation_type& op)
          "Insufficient csaf: unable to score, because account: ${f} `s member points [${c}] is less than needed [${n}]",
          ("f", op.from_account_uid)("c", account_stats->csaf)("n", op.csaf));
 
-      FC_ASSERT(d.find_score(op.platform, op.poster, op.post_pid, op.from_account_uid) == nullptr, "only score a post once");
+      // an expired score which isn't removed yet can be replaced, see database::clear_expired_scores()
+      const score_object* score = d.find_score(op.platform, op.poster, op.post_pid, op.from_account_uid);
+      FC_ASSERT(score == nullptr || (d.head_block_time() >= HARDFORK_0_6_TIME && score->create_time <= d.get_score_expiration_time()),
+         "only score a post once");
 
       return void_result();
    }FC_CAPTURE_AND_RETHROW((op))
@@ -893,6 +896,8 @@ object_id_type score_create_evaluator::do_apply(const operation_type& op)
       d.modify(*account_stats, [&](_account_statistics_object& s) {
          s.csaf -= op.csaf;
       });
+      if (const score_object* expired_score = d.find_score(op.platform, op.poster, op.post_pid, op.from_account_uid))
+         d.remove(*expired_score);
       const dynamic_global_property_object& dpo = d.get_dynamic_global_properties();
       const auto& new_score_object = d.create<score_object>([&](score_object& obj)
       {
@@ -1010,16 +1015,14 @@ void_result reward_evaluator::do_apply(const operation_type& op)
 
       const platform_object* plat_obj = d.find_platform_by_owner(post->platform);
       if (plat_obj){
-         d.modify(*plat_obj, [&](platform_object& obj)
-         {
-            obj.add_period_profits(dpo.current_active_post_sequence, d.get_active_post_periods(), ast, 0, 0, 0);
-         });
+         d.add_platform_period_profits(*plat_obj, dpo.current_active_post_sequence, ast, 0, 0, 0);
       }
 
       if (dpo.content_award_enable)
       {
          const auto& apt_idx = d.get_index_type<active_post_index>().indices().get<by_post_pid>();
          auto apt_itr = apt_idx.find(std::make_tuple(op.platform, op.poster, dpo.current_active_post_sequence, op.post_pid));
+         const active_post_object* active_post = nullptr;
          if (apt_itr != apt_idx.end())
          {
             d.modify(*apt_itr, [&](active_post_object& s) {
@@ -1027,17 +1030,15 @@ void_result reward_evaluator::do_apply(const operation_type& op)
                   s.total_rewards.at(op.amount.asset_id) += op.amount.amount;
                else
                   s.total_rewards.emplace(op.amount.asset_id, op.amount.amount);
-
-               for (const auto& p : receiptors)
-                  s.insert_reward_receiptor(p.first, p.second);
             });
+            active_post = &(*apt_itr);
          }
          else
          {
             time_point_sec expiration_time = post->create_time;
             if ((expiration_time += d.get_global_properties().parameters.get_extension_params().post_award_expiration) >= d.head_block_time())
             {
-               d.create<active_post_object>([&](active_post_object& obj)
+               active_post = &d.create<active_post_object>([&](active_post_object& obj)
                {
                   obj.platform = op.platform;
                   obj.poster = op.poster;
@@ -1045,12 +1046,14 @@ void_result reward_evaluator::do_apply(const operation_type& op)
                   obj.total_csaf = 0;
                   obj.period_sequence = dpo.current_active_post_sequence;
                   obj.total_rewards.emplace(op.amount.asset_id, op.amount.amount);
-
-                  for (const auto& p : receiptors)
-                     obj.insert_reward_receiptor(p.first, p.second);
                });
             }
          }
+         if (active_post != nullptr)
+         {
+            for (const auto& p : receiptors)
+               d.add_active_post_reward_receipts(*active_post, p.first, p.second);
+         }
       }
 
       return void_result();
@@ -1070,7 +1073,7 @@ void_result reward_proxy_evaluator::do_evaluate(const operation_type& op)
       FC_ASSERT((origin_post.permission_flags & post_object::Post_Permission_Reward) > 0, "post_object ${p} not allowed to reward.", ("p", op.post_pid));
       const _account_statistics_object* account_stats = &d.get_account_statistics_by_uid(op.from_account_uid);
 
-      account_uid_type sign_account = sigs.real_secondary_uid(op.from_account_uid, 1);
+      account_uid_type sign_account = sigs->real_secondary_uid(op.from_account_uid, 1);
       FC_ASSERT(op.platform == sign_account, "reward_proxy must signed by platform. ");
       auth_object = &d.get_account_auth_platform_object_by_account_platform(op.from_account_uid, op.platform);
       FC_ASSERT((auth_object->permission_flags & account_auth_platform_object::Platform_Permission_Reward) > 0,
@@ -1135,16 +1138,14 @@ void_result reward_proxy_evaluator::do_apply(const operation_type& op)
 
       const platform_object* plat_obj = d.find_platform_by_owner(post->platform);
       if (plat_obj){
-         d.modify(*plat_obj, [&](platform_object& obj)
-         {
-            obj.add_period_profits(dpo.current_active_post_sequence, d.get_active_post_periods(), asset(surplus.convert_to<int64_t>()), 0, 0, 0);
-         });
+         d.add_platform_period_profits(*plat_obj, dpo.current_active_post_sequence, asset(surplus.convert_to<int64_t>()), 0, 0, 0);
       }
 
       if (dpo.content_award_enable)
       {
          const auto& apt_idx = d.get_index_type<active_post_index>().indices().get<by_post_pid>();
          auto apt_itr = apt_idx.find(std::make_tuple(op.platform, op.poster, dpo.current_active_post_sequence, op.post_pid));
+         const active_post_object* active_post = nullptr;
          if (apt_itr != apt_idx.end())
          {
             d.modify(*apt_itr, [&](active_post_object& s) {
@@ -1152,16 +1153,15 @@ void_result reward_proxy_evaluator::do_apply(const operation_type& op)
                   s.total_rewards.at(GRAPHENE_CORE_ASSET_AID) += op.amount;
                else
                   s.total_rewards.emplace(GRAPHENE_CORE_ASSET_AID, op.amount);
-               for (const auto& p : receiptors)
-                  s.insert_reward_receiptor(p.first, p.second);
             });
+            active_post = &(*apt_itr);
          }
          else
          {
             time_point_sec expiration_time = post->create_time;
             if ((expiration_time += d.get_global_properties().parameters.get_extension_params().post_award_expiration) >= d.head_block_time())
             {
-               d.create<active_post_object>([&](active_post_object& obj)
+               active_post = &d.create<active_post_object>([&](active_post_object& obj)
                {
                   obj.platform = op.platform;
                   obj.poster = op.poster;
@@ -1169,11 +1169,14 @@ void_result reward_proxy_evaluator::do_apply(const operation_type& op)
                   obj.total_csaf = 0;
                   obj.period_sequence = dpo.current_active_post_sequence;
                   obj.total_rewards.emplace(GRAPHENE_CORE_ASSET_AID, op.amount);
-                  for (const auto& p : receiptors)
-                     obj.insert_reward_receiptor(p.first, p.second);
                });
             }
          }
+         if (active_post != nullptr)
+         {
+            for (const auto& p : receiptors)
+               d.add_active_post_reward_receipts(*active_post, p.first, p.second);
+         }
       }
 
       return void_result();
@@ -1219,7 +1222,7 @@ void_result buyout_evaluator::do_evaluate(const operation_type& op)
       }
 
       const _account_statistics_object* account_stats = &d.get_account_statistics_by_uid(op.from_account_uid);
-      account_uid_type sign_account = sigs.real_secondary_uid(op.from_account_uid, 1);
+      account_uid_type sign_account = sigs->real_secondary_uid(op.from_account_uid, 1);
       if (sign_account != op.from_account_uid)
          auth_object = d.find_account_auth_platform_object_by_account_platform(op.from_account_uid, sign_account);
 
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/content_store.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/interprocess/file_mapping.hpp>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <cstring>
+
+namespace graphene { namespace chain {
+
+content_store::content_store() {}
+
+content_store::~content_store()
+{
+   close();
+}
+
+void content_store::open( const fc::path& dir )
+{ try {
+   close();
+   std::lock_guard<std::mutex> guard( _mutex );
+   fc::create_directories( dir );
+   _filename = dir / "contents";
+   if( !fc::exists( _filename ) )
+      std::ofstream( _filename.generic_string().c_str(), std::ios::out | std::ios::binary );
+
+   // index the values, a value cut short by a crash while it was written is dropped
+   const uint64_t size_on_disk = fc::file_size( _filename );
+   {
+      std::ifstream in( _filename.generic_string().c_str(), std::ios::in | std::ios::binary );
+      uint64_t pos = 0;
+      value_header header;
+      while( pos + sizeof(header) <= size_on_disk )
+      {
+         in.seekg( pos );
+         in.read( (char*)&header, sizeof(header) );
+         if( pos + sizeof(header) + header.size > size_on_disk )
+            break;
+         _positions[header.hash] = pos + sizeof(header);
+         pos += sizeof(header) + header.size;
+      }
+      _file_size = pos;
+   }
+   if( _file_size < size_on_disk )
+   {
+      wlog( "Dropping ${n} bytes of a value cut short at the end of ${f}",
+            ("n",size_on_disk - _file_size)("f",_filename.generic_string()) );
+      boost::filesystem::resize_file( _filename, _file_size );
+   }
+
+   _file.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   _file.open( _filename.generic_string().c_str(), std::ios::in | std::ios::out | std::ios::binary );
+   _file.seekp( 0, _file.end );
+} FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+bool content_store::is_open()const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   return _file.is_open();
+}
+
+void content_store::close()
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   _region.reset();
+   _mapping.reset();
+   if( _file.is_open() )
+      _file.close();
+   _positions.clear();
+   _unwritten.clear();
+   _file_size = 0;
+}
+
+content_ref content_store::put( const std::string& value, uint32_t block_num )
+{ try {
+   content_ref ref;
+   ref.hash = fc::ripemd160::hash( value.data(), value.size() );
+   ref.size = value.size();
+
+   std::lock_guard<std::mutex> guard( _mutex );
+   FC_ASSERT( _file.is_open(), "The content store isn't open" );
+   if( _positions.count( ref.hash ) )
+      return ref;
+   auto itr = _unwritten.find( ref.hash );
+   if( itr == _unwritten.end() )
+   {
+      unwritten_value& unwritten = _unwritten[ref.hash];
+      unwritten.value = value;
+      unwritten.block_num = block_num;
+   }
+   else if( block_num != 0 && ( itr->second.block_num == 0 || block_num < itr->second.block_num ) )
+      itr->second.block_num = block_num;
+   return ref;
+} FC_CAPTURE_AND_RETHROW( (value.size())(block_num) ) }
+
+void content_store::discard_pending()
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   for( auto itr = _unwritten.begin(); itr != _unwritten.end(); )
+   {
+      if( itr->second.block_num == 0 )
+         itr = _unwritten.erase( itr );
+      else
+         ++itr;
+   }
+}
+
+void content_store::discard_from_block( uint32_t block_num )
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   for( auto itr = _unwritten.begin(); itr != _unwritten.end(); )
+   {
+      if( itr->second.block_num >= block_num )
+         itr = _unwritten.erase( itr );
+      else
+         ++itr;
+   }
+}
+
+void content_store::flush_until_block( uint32_t block_num )
+{ try {
+   std::lock_guard<std::mutex> guard( _mutex );
+   if( !_file.is_open() )
+      return;
+   bool written = false;
+   for( auto itr = _unwritten.begin(); itr != _unwritten.end(); )
+   {
+      if( itr->second.block_num == 0 || itr->second.block_num > block_num )
+      {
+         ++itr;
+         continue;
+      }
+      const std::string& value = itr->second.value;
+      value_header header;
+      header.hash = itr->first;
+      header.size = value.size();
+      _file.write( (const char*)&header, sizeof(header) );
+      _file.write( value.data(), value.size() );
+      _positions[header.hash] = _file_size + sizeof(header);
+      _file_size += sizeof(header) + value.size();
+      itr = _unwritten.erase( itr );
+      written = true;
+   }
+   if( written )
+      _file.flush();
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+bool content_store::contains( const content_ref& ref )const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   return _positions.count( ref.hash ) != 0 || _unwritten.count( ref.hash ) != 0;
+}
+
+std::string content_store::get( const content_ref& ref )const
+{ try {
+   std::lock_guard<std::mutex> guard( _mutex );
+   auto unwritten = _unwritten.find( ref.hash );
+   if( unwritten != _unwritten.end() )
+      return unwritten->second.value;
+   auto itr = _positions.find( ref.hash );
+   FC_ASSERT( itr != _positions.end(), "Content ${h} isn't in the content store", ("h",ref.hash) );
+   if( ref.size == 0 )
+      return std::string();
+   const char* data = mapped_value( itr->second, ref.size );
+   FC_ASSERT( data != nullptr, "Content ${h} is past the end of the content store", ("h",ref.hash) );
+   return std::string( data, ref.size );
+} FC_CAPTURE_AND_RETHROW( (ref) ) }
+
+uint64_t content_store::value_count()const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   return _positions.size() + _unwritten.size();
+}
+
+uint64_t content_store::file_size()const
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   return _file_size;
+}
+
+const char* content_store::mapped_value( uint64_t pos, uint32_t size )const
+{
+   const uint64_t end_pos = pos + size;
+   if( !_region || _region->get_size() < end_pos )
+   {
+      // make sure everything written through the stream is visible through the mapping
+      _file.flush();
+      if( _file_size < end_pos || _file_size == 0 )
+         return nullptr;
+      _region.reset();
+      _mapping.reset( new fc::file_mapping( _filename.generic_string().c_str(), fc::read_only ) );
+      _region.reset( new fc::mapped_region( *_mapping, fc::read_only, 0, _file_size ) );
+   }
+   return (const char*)_region->get_address() + pos;
+}
+
+} } // graphene::chain
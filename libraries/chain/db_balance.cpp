@@ -35,11 +35,10 @@ namespace graphene { namespace chain {
 
 asset database::get_balance(account_uid_type owner, asset_aid_type asset_id) const
 {
-   auto& index = get_index_type<account_balance_index>().indices().get<by_account_asset>();
-   auto itr = index.find(boost::make_tuple(owner, asset_id));
-   if( itr == index.end() )
+   const account_balance_object* balance_obj = find_account_balance( owner, asset_id );
+   if( balance_obj == nullptr )
       return asset(0, asset_id);
-   return itr->get_balance();
+   return balance_obj->get_balance();
 }
 
 asset database::get_balance(const account_object& owner, const asset_object& asset_obj) const
@@ -69,14 +68,32 @@ void database::adjust_balance(const account_object& account, asset delta )
    adjust_balance( account.uid, delta );
 }
 
+const account_balance_object* database::find_account_balance( account_uid_type owner, asset_aid_type asset_id )const
+{
+   const auto& index = get_index_type<account_balance_index>().indices().get<by_account_asset>();
+   auto itr = index.find( boost::make_tuple( owner, asset_id ) );
+   return itr != index.end() ? &*itr : nullptr;
+}
+
 void database::adjust_balance(account_uid_type account, asset delta )
-{ try {
+{
    if( delta.amount == 0 )
       return;
+   adjust_balance( account, delta, find_account_balance( account, delta.asset_id ) );
+}
 
-   auto& index = get_index_type<account_balance_index>().indices().get<by_account_asset>();
-   auto itr = index.find(boost::make_tuple(account, delta.asset_id));
-   if(itr == index.end())
+void database::adjust_balance( const account_balance_object& balance, asset delta )
+{
+   FC_ASSERT( balance.asset_type == delta.asset_id, "The balance object is of asset ${a}, not ${d}",
+              ("a",balance.asset_type)("d",delta.asset_id) );
+   if( delta.amount == 0 )
+      return;
+   adjust_balance( balance.owner, delta, &balance );
+}
+
+void database::adjust_balance( account_uid_type account, asset delta, const account_balance_object* balance_obj )
+{ try {
+   if( balance_obj == nullptr )
    {
       FC_ASSERT( delta.amount > 0, "Insufficient Balance: account ${a}'s balance of ${b} is less than required ${r}",
                  ("a",account)
@@ -89,12 +106,12 @@ void database::adjust_balance(account_uid_type account, asset delta )
       });
    } else {
       if( delta.amount < 0 )
-         FC_ASSERT( itr->get_balance() >= -delta,
+         FC_ASSERT( balance_obj->get_balance() >= -delta,
                     "Insufficient Balance: account ${a}'s balance of ${b} is less than required ${r}",
                     ("a",account)
-                    ("b",to_pretty_string(itr->get_balance()))
+                    ("b",to_pretty_string(balance_obj->get_balance()))
                     ("r",to_pretty_string(-delta)) );
-      modify(*itr, [delta](account_balance_object& b) {
+      modify(*balance_obj, [delta](account_balance_object& b) {
          b.adjust_balance(delta);
       });
    }
@@ -119,7 +136,7 @@ void database::adjust_balance(account_uid_type account, asset delta )
       }
       const uint64_t csaf_window = get_global_properties().parameters.csaf_accumulate_window;
       const dynamic_global_property_object& dpo = get_dynamic_global_properties();
-      modify(account_stats, [&](_account_statistics_object& s) {
+      modify_fields<_account_statistics_object::core_balance_fields>(account_stats, [&](_account_statistics_object& s) {
          if (dpo.enabled_hardfork_version < ENABLE_HEAD_FORK_05)//HARDFORK_05 time, only locked balance produce coin second
             s.update_coin_seconds_earned(csaf_window, head_block_time(), *this, dpo.enabled_hardfork_version);
          s.core_balance += delta.amount;
@@ -183,4 +200,17 @@ void database::deposit_witness_pay(const witness_object& wit, share_type amount,
    return;
 }
 
+void database::update_coin_seconds_earned(coin_seconds_batch& batch)
+{
+   batch.compute(get_global_properties().parameters.csaf_accumulate_window, head_block_time());
+   for (size_t i = 0; i < batch.size(); ++i)
+   {
+      if (!batch.changed(i))
+         continue;
+      modify(batch.get(i), [&](_account_statistics_object& s) {
+         batch.apply(i, s);
+      });
+   }
+}
+
 } }
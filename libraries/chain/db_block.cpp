@@ -34,12 +34,20 @@
 #include <graphene/chain/transaction_object.hpp>
 #include <graphene/chain/witness_object.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
+#include <graphene/chain/protocol/sign_state.hpp>
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/evaluator.hpp>
+#include <graphene/chain/impacted.hpp>
 #include <graphene/chain/chain_property_object.hpp>
 
+#include <graphene/utilities/metrics.hpp>
+#include <graphene/utilities/thread_pool.hpp>
+
 #include <fc/smart_ref_impl.hpp>
 
+#include <numeric>
+#include <set>
+
 namespace graphene { namespace chain {
 
 bool database::is_known_block( const block_id_type& id )const
@@ -79,6 +87,18 @@ optional<signed_block> database::fetch_block_by_id( const block_id_type& id )con
    return b->data;
 }
 
+optional<vector<char>> database::fetch_raw_block_by_id( const block_id_type& id )const
+{
+   auto b = _fork_db.fetch_block( id );
+   if( b )
+      return fc::raw::pack( b->data );
+   block_id_type stored_id;
+   vector<char> data;
+   if( _block_id_to_block.fetch_raw_by_number( block_header::num_from_id( id ), stored_id, data ) && stored_id == id )
+      return data;
+   return optional<vector<char>>();
+}
+
 optional<signed_block> database::fetch_block_by_number( uint32_t num )const
 {
    auto results = _fork_db.fetch_block_by_number(num);
@@ -88,12 +108,84 @@ optional<signed_block> database::fetch_block_by_number( uint32_t num )const
       return _block_id_to_block.fetch_by_number(num);
 }
 
+vector<optional<signed_block>> database::fetch_blocks_by_number( uint32_t first, uint32_t last )const
+{
+   vector<optional<signed_block>> result;
+   // there are no blocks past the head block
+   last = std::min( last, head_block_num() );
+   if( first > last )
+      return result;
+   result.resize( uint64_t(last) - first + 1 );
+
+   // blocks above the last irreversible block may still be switched, look them up in the fork database
+   const uint32_t last_irreversible = get_dynamic_global_properties().last_irreversible_block_num;
+   vector<block_id_type> ids;
+   vector< vector<char> > data;
+   if( first <= last_irreversible )
+      _block_id_to_block.fetch_raw_range( first, std::min( last, last_irreversible ), ids, data );
+
+   auto unpack = [&ids,&data,&result]( size_t i ) {
+      if( data[i].empty() )
+         return;
+      try {
+         signed_block block = fc::raw::unpack<signed_block>( data[i] );
+         if( block.id() == ids[i] )
+            result[i] = std::move( block );
+      } catch( const fc::exception& ) {
+         // a block that can't be decoded is treated like a missing block, same as fetch_by_number()
+      }
+   };
+   if( _thread_pool && data.size() > 1 )
+      _thread_pool->parallel_for( data.size(), unpack );
+   else
+   {
+      for( size_t i = 0; i < data.size(); ++i )
+         unpack( i );
+   }
+
+   for( size_t i = 0; i < result.size(); ++i )
+   {
+      if( !result[i].valid() )
+         result[i] = fetch_block_by_number( first + i );
+   }
+   return result;
+}
+
+vector<optional<vector<char>>> database::fetch_raw_blocks_by_number( uint32_t first, uint32_t last )const
+{
+   vector<optional<vector<char>>> result;
+   // there are no blocks past the head block
+   last = std::min( last, head_block_num() );
+   if( first > last )
+      return result;
+   result.resize( uint64_t(last) - first + 1 );
+
+   const uint32_t last_irreversible = get_dynamic_global_properties().last_irreversible_block_num;
+   vector<block_id_type> ids;
+   vector< vector<char> > data;
+   if( first <= last_irreversible )
+      _block_id_to_block.fetch_raw_range( first, std::min( last, last_irreversible ), ids, data );
+
+   for( size_t i = 0; i < result.size(); ++i )
+   {
+      if( i < data.size() && !data[i].empty() )
+         result[i] = std::move( data[i] );
+      else
+      {
+         optional<signed_block> block = fetch_block_by_number( first + i );
+         if( block.valid() )
+            result[i] = fc::raw::pack( *block );
+      }
+   }
+   return result;
+}
+
 const signed_transaction& database::get_recent_transaction(const transaction_id_type& trx_id) const
 {
-   auto& index = get_index_type<transaction_index>().indices().get<by_trx_id>();
-   auto itr = index.find(trx_id);
-   FC_ASSERT(itr != index.end());
-   return itr->trx;
+   const signed_transaction* trx = _recent_transactions.find(trx_id);
+   // one applied in an undo session which failed as a whole, e.g. a block, may still be there
+   FC_ASSERT(trx != nullptr && is_known_transaction(trx_id));
+   return *trx;
 }
 
 std::vector<block_id_type> database::get_block_ids_on_fork(block_id_type head_of_fork) const
@@ -123,27 +215,74 @@ std::vector<block_id_type> database::get_block_ids_on_fork(block_id_type head_of
 bool database::push_block(const signed_block& new_block, uint32_t skip)
 {
 //   idump((new_block.block_num())(new_block.id())(new_block.timestamp)(new_block.previous));
+   state_write_scope write_scope( *this );
+   // the id is needed by the fork database, apply_block() and the block database, hash the header only once
+   new_block.precompute_id();
+   // the ids are kept by the copies in the fork database, the block of the caller may be changed and pushed again
+   auto forget_ids = [&new_block]() {
+      new_block.precomputed_id.reset();
+      new_block.precomputed_signee.reset();
+      for( const auto& trx : new_block.transactions )
+      {
+         trx.precomputed_id.reset();
+         trx.validated = false;
+      }
+   };
    bool result;
-   detail::with_skip_flags( *this, skip, [&]()
-   {
-      detail::without_pending_transactions( *this, std::move(_pending_tx),
-      [&]()
+   const uint32_t pending_before = _pending_tx.size();
+   fc::time_point reapply_start;
+   try {
+      detail::with_skip_flags( *this, skip, [&]()
       {
-         result = _push_block(new_block);
+         detail::without_pending_transactions( *this, std::move(_pending_tx), std::move(_pending_tx_authorities),
+                                               std::move(_pending_tx_received),
+         [&]()
+         {
+            result = _push_block(new_block);
+            reapply_start = fc::time_point::now();
+         });
       });
-   });
+   } catch( ... ) {
+      forget_ids();
+      throw;
+   }
+   forget_ids();
+
+   // the pending transactions were applied again when without_pending_transactions() returned
+   const int64_t reapply_us = ( fc::time_point::now() - reapply_start ).count();
+   ++_pending_tx_stats.reapply_count;
+   _pending_tx_stats.last_reapply_us = reapply_us;
+   _pending_tx_stats.max_reapply_us = std::max( _pending_tx_stats.max_reapply_us, reapply_us );
+   _pending_tx_stats.total_reapply_us += reapply_us;
+   _pending_tx_stats.last_reapply_before = pending_before;
+   _pending_tx_stats.last_reapply_after = _pending_tx.size();
+   if( _pending_tx_log_interval > 0 && head_block_num() % _pending_tx_log_interval == 0 )
+      ilog( "Pending transactions at block ${n}: ${s}", ("n",head_block_num())("s",get_pending_transaction_stats()) );
    return result;
 }
 
 bool database::_push_block(const signed_block& new_block)
 { try {
    uint32_t skip = get_node_properties().skip_flags;
-   if( !(skip&skip_fork_db) )
+   item_ptr new_item;
+   // the trusted blocks extending the head can't be switched away from, the fork database is caught up after them
+   const bool bypass_fork_db = new_block.previous == head_block_id() && is_checkpointed( new_block.block_num() );
+   if( bypass_fork_db )
+      _fork_db_behind_head = true;
+   else if( !(skip&skip_fork_db) && _fork_db_behind_head )
+   {
+      _fork_db.reset();
+      if( head_block_num() > 0 )
+         _fork_db.start_block( *fetch_block_by_number( head_block_num() ) );
+      _fork_db_behind_head = false;
+   }
+   if( !(skip&skip_fork_db) && !bypass_fork_db )
    {
       /// TODO: if the block is greater than the head block and before the next maitenance interval
       // verify that the block signer is in the current set of active witnesses.
 
       shared_ptr<fork_item> new_head = _fork_db.push_block(new_block);
+      new_item = new_head;
       //If the head block from the longest chain does not build off of the current head, we need to switch forks.
       if( new_head->data.previous != head_block_id() )
       {
@@ -152,11 +291,36 @@ bool database::_push_block(const signed_block& new_block)
          if( new_head->data.block_num() > head_block_num() )
          {
             wlog( "Switching to fork: ${id}", ("id",new_head->data.id()) );
+            const fc::time_point switch_start = fc::time_point::now();
+            // the blocks applied before are applied on top of the same ancestors, their checks pass again
+            const uint32_t reapply_skip = skip | skip_witness_signature | skip_transaction_signatures | skip_merkle_check;
+            auto apply_fork_item = [&]( const item_ptr& item ) {
+               auto session = _undo_db.start_undo_session();
+               apply_block( item->data, item->applied ? reapply_skip : skip );
+               _block_id_to_block.store( item->id, item->data );
+               session.commit();
+               ++_fork_switch_stats.blocks_applied;
+               if( item->applied )
+                  ++_fork_switch_stats.blocks_reapplied;
+               item->applied = true;
+            };
+            auto record_switch = [&]() {
+               const int64_t duration_us = ( fc::time_point::now() - switch_start ).count();
+               ++_fork_switch_stats.switch_count;
+               _fork_switch_stats.total_duration_us += duration_us;
+               _fork_switch_stats.max_duration_us = std::max( _fork_switch_stats.max_duration_us, duration_us );
+               _fork_switch_stats.last_duration_us = duration_us;
+               _fork_switch_stats.last_head_block_num = head_block_num();
+               _fork_switch_stats.last_switch_time = switch_start;
+            };
             auto branches = _fork_db.fetch_branch_from(new_head->data.id(), head_block_id());
 
             // pop blocks until we hit the forked block
             while( head_block_id() != branches.second.back()->data.previous )
+            {
                pop_block();
+               ++_fork_switch_stats.blocks_popped;
+            }
 
             // push all blocks on the new fork
             for( auto ritr = branches.first.rbegin(); ritr != branches.first.rend(); ++ritr )
@@ -164,10 +328,7 @@ bool database::_push_block(const signed_block& new_block)
                 ilog( "pushing blocks from fork ${n} ${id}", ("n",(*ritr)->data.block_num())("id",(*ritr)->data.id()) );
                 optional<fc::exception> except;
                 try {
-                   undo_database::session session = _undo_db.start_undo_session();
-                   apply_block( (*ritr)->data, skip );
-                   _block_id_to_block.store( (*ritr)->id, (*ritr)->data );
-                   session.commit();
+                   apply_fork_item( *ritr );
                 }
                 catch ( const fc::exception& e ) { except = e; }
                 if( except )
@@ -183,19 +344,24 @@ bool database::_push_block(const signed_block& new_block)
 
                    // pop all blocks from the bad fork
                    while( head_block_id() != branches.second.back()->data.previous )
+                   {
                       pop_block();
+                      ++_fork_switch_stats.blocks_popped;
+                   }
 
                    // restore all blocks from the good fork
                    for( auto ritr = branches.second.rbegin(); ritr != branches.second.rend(); ++ritr )
                    {
-                      auto session = _undo_db.start_undo_session();
-                      apply_block( (*ritr)->data, skip );
-                      _block_id_to_block.store( new_block.id(), (*ritr)->data );
-                      session.commit();
+                      // applied before the switch
+                      (*ritr)->applied = true;
+                      apply_fork_item( *ritr );
                    }
+                   ++_fork_switch_stats.failed_count;
+                   record_switch();
                    throw *except;
                 }
             }
+            record_switch();
             return true;
          }
          else return false;
@@ -207,6 +373,9 @@ bool database::_push_block(const signed_block& new_block)
       apply_block(new_block, skip);
       _block_id_to_block.store(new_block.id(), new_block);
       session.commit();
+      // so it is applied again without its checks if the node switches away and back
+      if( new_item && new_item->id == new_block.id() )
+         new_item->applied = true;
    } catch ( const fc::exception& e ) {
       elog("Failed to push new block:\n${e}", ("e", e.to_detail_string()));
       _fork_db.remove(new_block.id());
@@ -226,16 +395,31 @@ bool database::_push_block(const signed_block& new_block)
  * queues.
  */
 processed_transaction database::push_transaction( const signed_transaction& trx, uint32_t skip )
+{
+   return push_transaction( signed_transaction( trx ), skip );
+}
+
+processed_transaction database::push_transaction( signed_transaction&& trx, uint32_t skip )
 { try {
+   state_write_scope write_scope( *this );
    processed_transaction result;
    detail::with_skip_flags( *this, skip, [&]()
    {
-      result = _push_transaction( trx );
+      result = _push_transaction( std::move(trx) );
    } );
    return result;
 } FC_CAPTURE_AND_RETHROW( (trx) ) }
 
-processed_transaction database::_push_transaction( const signed_transaction& trx )
+processed_transaction database::_push_transaction( const signed_transaction& trx,
+                                                   const optional<signed_information>& authority,
+                                                   fc::time_point received )
+{
+   return _push_transaction( signed_transaction( trx ), authority, received );
+}
+
+processed_transaction database::_push_transaction( signed_transaction&& trx,
+                                                   const optional<signed_information>& authority,
+                                                   fc::time_point received )
 {
    // If this is the first transaction pushed after applying a block, start a new undo session.
    // This allows us to quickly rewind to the clean state of the head block, in case a new block arrives.
@@ -247,23 +431,108 @@ processed_transaction database::_push_transaction( const signed_transaction& trx
    // _apply_transaction fails.  If we make it to merge(), we
    // apply the changes.
 
+   const size_t packed_size = fc::raw::pack_size( trx );
+   const uint64_t rate = fee_rate( trx, packed_size );
+   const bool admitted = !pending_transactions_full()
+                         || ( _pending_tx.size() < 2 * size_t( _max_pending_transactions )
+                              && rate > *_pending_tx_fee_rates.begin() );
+   if( !admitted )
+      ++_pending_tx_stats.rejected_full;
+   GRAPHENE_ASSERT( admitted,
+                    pending_transactions_full,
+                    "There are ${n} pending transactions already, with a lowest fee rate of ${r} per KiB",
+                    ("n",_pending_tx.size())("r",*_pending_tx_fee_rates.begin()) );
+
    auto temp_session = _undo_db.start_undo_session();
-   auto processed_trx = _apply_transaction( trx );
+   optional<signed_information> checked_authority = authority;
+   processed_transaction processed_trx;
+   try {
+      processed_trx = _apply_transaction( std::move(trx), &checked_authority );
+   } catch( const fc::exception& e ) {
+      // trx is left untouched when it fails
+      count_rejected_transaction( trx, e );
+      throw;
+   }
    _pending_tx.push_back(processed_trx);
+   _pending_tx_authorities.push_back( std::move(checked_authority) );
+   _pending_tx_fee_rates.insert( rate );
+   _pending_tx_received.push_back( received == fc::time_point() ? fc::time_point::now() : received );
+   _pending_tx_bytes += packed_size;
+   ++_pending_tx_stats.accepted;
+   ++_pending_state_revision;
 
    // notify_changed_objects();
    // The transaction applied successfully. Merge its changes into the pending block session.
    temp_session.merge();
 
-   // notify anyone listening to pending transactions
-   on_pending_transaction( trx );
+   // notify anyone listening to pending transactions, trx has been moved away by now
+   on_pending_transaction( processed_trx );
    return processed_trx;
 }
 
+void database::count_rejected_transaction( const signed_transaction& trx, const fc::exception& e )
+{
+   const fc::time_point_sec now = head_block_time();
+   if( is_known_transaction( trx.id() ) )
+      ++_pending_tx_stats.rejected_duplicate;
+   else if( head_block_num() > 0 && ( trx.expiration < now || trx.expiration >
+                                      now + get_global_properties().parameters.maximum_time_until_expiration ) )
+      ++_pending_tx_stats.rejected_expired;
+   else if( dynamic_cast<const graphene::chain::transaction_exception*>( &e ) != nullptr
+            && e.code() != graphene::chain::insufficient_fee::code_value )
+      ++_pending_tx_stats.rejected_authority;
+   else
+      ++_pending_tx_stats.rejected_other;
+}
+
+void database::prevalidate_transaction( const signed_transaction& trx )
+{
+   if( !_thread_pool || _thread_pool->size() == 0 || trx.signees.valid()
+         || _prevalidations_in_flight >= _thread_pool->size() * GRAPHENE_MAX_PREVALIDATIONS_PER_THREAD )
+   {
+      trx.validate();
+      trx.precompute_id();
+      return;
+   }
+
+   const bool recover_keys = need_authority_check( trx, get_node_properties().skip_flags );
+   const chain_id_type chain_id = get_chain_id();
+   signature_key_cache* cache = &_signature_key_cache;
+   auto task = _thread_pool->get_thread( _next_prevalidation_thread++ ).async( [&trx,chain_id,recover_keys,cache]() {
+      trx.validate();
+      trx.precompute_id();
+      if( recover_keys )
+      {
+         try {
+            trx.signees = trx.get_signature_keys( chain_id, cache );
+         } catch( const fc::exception& ) {
+            // leave it to _apply_transaction() to recover the keys again and report the error
+         }
+      }
+   }, "prevalidate_transaction" );
+
+   ++_prevalidations_in_flight;
+   try {
+      task.wait();
+   } catch( ... ) {
+      --_prevalidations_in_flight;
+      throw;
+   }
+   --_prevalidations_in_flight;
+}
+
 processed_transaction database::validate_transaction( const signed_transaction& trx )
 {
-   auto session = _undo_db.start_undo_session();
-   return _apply_transaction( trx );
+   // the transaction is applied to the state and undone afterwards, the readers mustn't see it meanwhile
+   state_write_scope write_scope( *this );
+   processed_transaction result;
+   {
+      auto session = _undo_db.start_undo_session();
+      result = _apply_transaction( trx );
+   }
+   // it was new to the chain or it wouldn't have applied
+   _recent_transactions.remove( trx.id() );
+   return result;
 }
 
 processed_transaction database::push_proposal(const proposal_object& proposal, const signed_information& sigs)
@@ -274,8 +543,10 @@ processed_transaction database::push_proposal(const proposal_object& proposal, c
    eval_state.operation_results.reserve(proposal.proposed_transaction.operations.size());
    processed_transaction ptrx(proposal.proposed_transaction);
    eval_state._trx = &ptrx;
-   size_t old_applied_ops_size = _applied_ops.size();
+   size_t old_applied_ops_size = _applied_ops->size();
 
+   // the operations are undone on their own if one of them fails, the batched copy wouldn't be
+   dynamic_global_property_batch_pause dgp_pause( *this );
    try {
       auto session = _undo_db.start_undo_session(true);
       for( auto& op : proposal.proposed_transaction.operations )
@@ -283,7 +554,12 @@ processed_transaction database::push_proposal(const proposal_object& proposal, c
       remove(proposal);
       session.merge();
    } catch ( const fc::exception& e ) {
-      _applied_ops.resize( old_applied_ops_size );
+      _applied_ops->resize( old_applied_ops_size );
+      // the impacted accounts of the operations applied before the proposal stay, they may be shared already
+      if( _applied_ops_impacted->size() > old_applied_ops_size )
+         _applied_ops_impacted->resize( old_applied_ops_size );
+      // the undone changes may have removed accounts which were cached
+      _account_authority_cache.clear();
       elog( "e", ("e",e.to_detail_string() ) );
       throw;
    }
@@ -299,6 +575,7 @@ signed_block database::generate_block(
    uint32_t skip /* = 0 */
    )
 { try {
+   state_write_scope write_scope( *this );
    signed_block result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -307,6 +584,35 @@ signed_block database::generate_block(
    return result;
 } FC_CAPTURE_AND_RETHROW() }
 
+signed_block database::generate_empty_blocks( uint32_t count, uint32_t skip )
+{ try {
+   state_write_scope write_scope( *this );
+   FC_ASSERT( _pending_tx.empty(), "Clear the pending transactions before generating empty blocks" );
+   _pending_tx_session.reset();
+
+   signed_block block;
+   _quiet_blocks = true;
+   try
+   {
+      for( uint32_t i = 0; i < count; ++i )
+      {
+         block = signed_block();
+         block.previous = head_block_id();
+         block.timestamp = get_slot_time( 1 );
+         block.witness = get_scheduled_witness( 1 );
+         block.transaction_merkle_root = block.calculate_merkle_root();
+         push_block( block, skip | skip_witness_signature );
+      }
+   }
+   catch( ... )
+   {
+      _quiet_blocks = false;
+      throw;
+   }
+   _quiet_blocks = false;
+   return block;
+} FC_CAPTURE_AND_RETHROW( (count) ) }
+
 signed_block database::_generate_block(
    fc::time_point_sec when,
    account_uid_type witness_uid,
@@ -325,11 +631,56 @@ signed_block database::_generate_block(
    if( !(skip & skip_witness_signature) )
       FC_ASSERT( witness_obj.signing_key == block_signing_private_key.get_public_key() );
 
+   working_block working;
+   if( _prepared_block.valid() && _prepared_block->block.previous == head_block_id()
+         && _prepared_block->block.timestamp == when && _prepared_block->block.witness == witness_uid
+         && _prepared_block_clears == _pending_tx_clears )
+   {
+      // built by prepare_block() on the same state, the transactions pushed since are kept for the next block
+      working = std::move( *_prepared_block );
+   }
+   else
+      working = _build_pending_block( when, witness_uid, _pending_tx );
+   _prepared_block.reset();
+   signed_block& pending_block = working.block;
+
+   _pending_tx_session.reset();
+
+   // We have temporarily broken the invariant that
+   // _pending_tx_session is the result of applying _pending_tx, as
+   // _pending_tx now consists of the set of postponed transactions.
+   // However, the push_block() call below will re-create the
+   // _pending_tx_session.
+
+   pending_block.transaction_merkle_root = signed_block::calculate_merkle_root( std::move(working.merkle_digests) );
+
+   if( !(skip & skip_witness_signature) )
+      pending_block.sign( block_signing_private_key );
+   const fc::time_point signed_time = fc::time_point::now();
+
+   // TODO:  Move this to _push_block() so session is restored.
+   if( !(skip & skip_block_size_check) )
+   {
+      FC_ASSERT( working.packed_size <= get_global_properties().parameters.maximum_block_size );
+   }
+
+   push_block( pending_block, skip );
+   _slot_timings.record_signed( witness_uid, pending_block.block_num(), when, signed_time );
+
+   return pending_block;
+} FC_CAPTURE_AND_RETHROW( (witness_uid) ) }
+
+database::working_block database::_build_pending_block( const fc::time_point_sec when, account_uid_type witness_uid,
+                                                        const vector<processed_transaction>& transactions )
+{
    static const size_t max_block_header_size = fc::raw::pack_size( signed_block_header() ) + 4;
    auto maximum_block_size = get_global_properties().parameters.maximum_block_size;
-   size_t total_block_size = max_block_header_size;
 
-   signed_block pending_block;
+   working_block working;
+   working.packed_size = max_block_header_size;
+   working.merkle_digests.reserve( transactions.size() );
+   signed_block& pending_block = working.block;
+   pending_block.transactions.reserve( transactions.size() );
 
    //
    // The following code throws away existing pending_tx_session and
@@ -352,16 +703,20 @@ signed_block database::_generate_block(
    update_global_dynamic_data(pending_block);
 
    uint64_t postponed_tx_count = 0;
-   // pop pending state (reset to head block state)
-   for( const processed_transaction& tx : _pending_tx )
+   // the ones which fail are tried once more after the others, they may depend on a transaction of another fee
+   // payer which was ranked below them
+   vector<size_t> failed;
+   auto try_apply = [&]( size_t i, bool last_try )
    {
-      size_t new_total_size = total_block_size + fc::raw::pack_size( tx );
+      const processed_transaction& tx = transactions[i];
+      const size_t tx_size = fc::raw::pack_size( tx );
+      size_t new_total_size = working.packed_size + tx_size;
 
       // postpone transaction if it would make block too big
       if( new_total_size >= maximum_block_size )
       {
          postponed_tx_count++;
-         continue;
+         return;
       }
 
       try
@@ -370,47 +725,66 @@ signed_block database::_generate_block(
          processed_transaction ptx = _apply_transaction( tx );
          temp_session.merge();
 
-         // We have to recompute pack_size(ptx) because it may be different
-         // than pack_size(tx) (i.e. if one or more results increased
-         // their size)
-         total_block_size += fc::raw::pack_size( ptx );
-         pending_block.transactions.push_back( ptx );
+         // The size of ptx may be different than that of tx, if one or more results
+         // changed their size. Only the results are packed again to find out.
+         working.packed_size += tx_size - fc::raw::pack_size( tx.operation_results )
+                                        + fc::raw::pack_size( ptx.operation_results );
+         working.merkle_digests.push_back( ptx.merkle_digest() );
+         pending_block.transactions.push_back( std::move(ptx) );
       }
       catch ( const fc::exception& e )
       {
+         if( !last_try )
+         {
+            failed.push_back( i );
+            return;
+         }
          // Do nothing, transaction will not be re-applied
          wlog( "Transaction was not processed while generating block due to ${e}", ("e", e) );
          wlog( "The transaction was ${t}", ("t", tx) );
       }
-   }
+   };
+   // pop pending state (reset to head block state)
+   for( const size_t i : order_by_fee_rate( transactions ) )
+      try_apply( i, false );
+   for( const size_t i : failed )
+      try_apply( i, true );
    if( postponed_tx_count > 0 )
    {
       wlog( "Postponed ${n} transactions due to block size limit", ("n", postponed_tx_count) );
    }
 
-   _pending_tx_session.reset();
-
-   // We have temporarily broken the invariant that
-   // _pending_tx_session is the result of applying _pending_tx, as
-   // _pending_tx now consists of the set of postponed transactions.
-   // However, the push_block() call below will re-create the
-   // _pending_tx_session.
-
-   pending_block.transaction_merkle_root = pending_block.calculate_merkle_root();
-
-   if( !(skip & skip_witness_signature) )
-      pending_block.sign( block_signing_private_key );
+   return working;
+}
 
-   // TODO:  Move this to _push_block() so session is restored.
-   if( !(skip & skip_block_size_check) )
+void database::prepare_block(
+   fc::time_point_sec when,
+   account_uid_type witness_uid,
+   uint32_t skip
+   )
+{ try {
+   state_write_scope write_scope( *this );
+   detail::with_skip_flags( *this, skip, [&]()
    {
-      FC_ASSERT( fc::raw::pack_size(pending_block) <= get_global_properties().parameters.maximum_block_size );
-   }
-
-   push_block( pending_block, skip );
+      _prepared_block.reset();
+      uint32_t slot_num = get_slot_at_time( when );
+      FC_ASSERT( slot_num > 0 );
+      FC_ASSERT( get_scheduled_witness( slot_num ) == witness_uid );
 
-   return pending_block;
-} FC_CAPTURE_AND_RETHROW( (witness_uid) ) }
+      // the block is built on the head block state, which is then rewound and the pending state rebuilt
+      const vector<processed_transaction> transactions = _pending_tx;
+      optional<working_block> prepared;
+      detail::without_pending_transactions( *this, std::move(_pending_tx), std::move(_pending_tx_authorities),
+                                            std::move(_pending_tx_received),
+      [&]()
+      {
+         prepared = _build_pending_block( when, witness_uid, transactions );
+         _pending_tx_session.reset();
+      });
+      _prepared_block = std::move( prepared );
+      _prepared_block_clears = _pending_tx_clears;
+   } );
+} FC_CAPTURE_AND_RETHROW( (when)(witness_uid) ) }
 
 /**
  * Removes the most recent block from the database and
@@ -418,13 +792,24 @@ signed_block database::_generate_block(
  */
 void database::pop_block()
 { try {
+   state_write_scope write_scope( *this );
    _pending_tx_session.reset();
    auto head_id = head_block_id();
    optional<signed_block> head_block = fetch_block_by_id( head_id );
    GRAPHENE_ASSERT( head_block.valid(), pop_empty_chain, "there are no blocks to pop" );
 
-   _fork_db.pop_block();
+   if( !_fork_db_behind_head )
+      _fork_db.pop_block();
+   if( _object_archive.is_open() )
+      _object_archive.discard_from_block( head_block_num() );
+   if( _applied_operations_log.is_open() )
+      _applied_operations_log.discard_from_block( head_block_num() );
+   if( _post_contents.is_open() )
+      _post_contents.discard_from_block( head_block_num() );
    pop_undo();
+   ++_head_block_changes;
+   for( const auto& trx : head_block->transactions )
+      _recent_transactions.remove( trx.id() );
 
    _popped_tx.insert( _popped_tx.begin(), head_block->transactions.begin(), head_block->transactions.end() );
 
@@ -432,27 +817,379 @@ void database::pop_block()
 
 void database::clear_pending()
 { try {
+   state_write_scope write_scope( *this );
    assert( (_pending_tx.size() == 0) || _pending_tx_session.valid() );
+   // undone with the pending session, they are added again if they apply again
+   for( const auto& trx : _pending_tx )
+      _recent_transactions.remove( trx.id() );
    _pending_tx.clear();
+   _pending_tx_authorities.clear();
+   _pending_tx_fee_rates.clear();
+   _pending_tx_received.clear();
+   _pending_tx_bytes = 0;
+   ++_pending_tx_clears;
+   ++_pending_state_revision;
    _pending_tx_session.reset();
+   if( _post_contents.is_open() )
+      _post_contents.discard_pending();
+} FC_CAPTURE_AND_RETHROW() }
+
+void database::apply_state_diff( const state_diff& diff )
+{ try {
+   state_write_scope write_scope( *this );
+   FC_ASSERT( !_applied_operations_log.is_open(),
+              "The state diffs can't be applied while the applied operations log is kept, they don't have the operations" );
+   const uint32_t block_num = diff.block.block_num();
+   FC_ASSERT( block_num <= head_block_num() + 1, "The state diff of block ${n} doesn't follow the head block ${h}",
+              ("n",block_num)("h",head_block_num()) );
+   clear_pending();
+   // the other node switched forks, back to the block this one builds on
+   while( head_block_num() >= block_num )
+      pop_block();
+   _popped_tx.clear();
+   FC_ASSERT( head_block_id() == diff.block.previous, "The state diff of block ${n} is of another chain",
+              ("n",block_num) );
+
+   const block_id_type block_id = diff.block.id();
+   if( !_fork_db_behind_head )
+      _fork_db.push_block( diff.block );
+   try {
+      const vector< std::pair<uint8_t,uint8_t> > registered = registered_indexes();
+      auto session = _undo_db.start_undo_session();
+      ++_head_block_changes;
+      if( _post_contents.is_open() )
+         _post_contents.discard_from_block( block_num );
+      for( const auto& value : diff.contents )
+         _post_contents.put( value, block_num );
+      for( const auto& changes : diff.indexes )
+      {
+         // the indexes of plugins that aren't enabled here
+         const auto key = std::make_pair( changes.next_id.space(), changes.next_id.type() );
+         if( std::find( registered.begin(), registered.end(), key ) == registered.end() )
+            continue;
+         apply_packed_changes( changes.next_id, changes.objects );
+      }
+      for( const auto& trx : diff.block.transactions )
+         _recent_transactions.add( trx.id(), trx );
+      _recent_transactions.remove_expired( head_block_time() );
+      update_undo_db_size();
+      _block_id_to_block.store( block_id, diff.block );
+      if( !_quiet_blocks )
+         notify_changed_objects();
+      session.commit();
+   } catch( const fc::exception& e ) {
+      elog( "Failed to apply the state diff of block ${n}: ${e}", ("n",block_num)("e",e.to_detail_string()) );
+      _fork_db.remove( block_id );
+      throw;
+   }
+
+   if( _post_contents.is_open() )
+      _post_contents.flush_until_block( get_dynamic_global_properties().last_irreversible_block_num );
+   if( !_quiet_blocks )
+      applied_block( diff.block );
+   if( _object_archive.is_open() && _undo_db.enabled() )
+      archive_head_block( block_num );
+   // a replica can feed other replicas in turn
+   if( _state_diffs_kept > 0 )
+   {
+      if( _state_diffs.find( block_id ) == _state_diffs.end() )
+         _state_diff_order.push_back( block_id );
+      _state_diffs[ block_id ] = diff;
+      set_state_diffs_kept( _state_diffs_kept );
+   }
 } FC_CAPTURE_AND_RETHROW() }
 
+void database::set_state_diffs_kept( uint32_t count )
+{
+   _state_diffs_kept = count;
+   while( _state_diff_order.size() > _state_diffs_kept )
+   {
+      _state_diffs.erase( _state_diff_order.front() );
+      _state_diff_order.pop_front();
+   }
+}
+
+vector<state_diff> database::get_state_diffs( const block_id_type& after, uint32_t limit )const
+{
+   // back from the head block along the kept diffs, to the block the caller has
+   vector<const state_diff*> chain;
+   block_id_type id = head_block_id();
+   while( id != after )
+   {
+      auto itr = _state_diffs.find( id );
+      if( itr == _state_diffs.end() )
+         break;
+      chain.push_back( &itr->second );
+      id = itr->second.block.previous;
+   }
+   if( id != after )
+   {
+      // a block switched away is above the last irreversible block, the diffs from there on replace it
+      const uint32_t last_irreversible = get_dynamic_global_properties().last_irreversible_block_num;
+      if( block_header::num_from_id( after ) <= last_irreversible || block_header::num_from_id( id ) > last_irreversible )
+         return vector<state_diff>();
+      while( !chain.empty() && chain.back()->block.block_num() <= last_irreversible )
+         chain.pop_back();
+   }
+   vector<state_diff> result;
+   result.reserve( std::min<size_t>( chain.size(), limit ) );
+   for( auto itr = chain.rbegin(); itr != chain.rend() && result.size() < limit; ++itr )
+      result.push_back( **itr );
+   return result;
+}
+
+void database::record_state_diff( const signed_block& block )
+{
+   const undo_state& state = _undo_db.head();
+   std::map< std::pair<uint8_t,uint8_t>, state_diff_index > changes;
+   std::set<fc::ripemd160> content_hashes;
+   vector<string> contents;
+   auto add_content = [&]( const optional<content_ref>& ref ) {
+      if( ref.valid() && content_hashes.insert( ref->hash ).second )
+         contents.push_back( _post_contents.get( *ref ) );
+   };
+   auto add = [&]( object_id_type id ) {
+      const object* obj = find_object( id );
+      if( obj && id.space() == post_object::space_id && id.type() == post_object::type_id )
+      {
+         const post_object& post = static_cast<const post_object&>( *obj );
+         add_content( post.body_ref );
+         add_content( post.extra_data_ref );
+      }
+      changes[ std::make_pair( id.space(), id.type() ) ].objects.emplace_back( id, obj ? obj->pack() : vector<char>() );
+   };
+   // the removals go first, a new object may take the unique keys of a removed one
+   for( const auto& item : state.removed )
+      add( item.first );
+   for( const auto& item : state.old_values )
+      add( item.first );
+   for( const auto& item : state.old_deltas )
+      add( item.first );
+   for( const auto& id : state.new_ids )
+      add( id );
+   for( const auto& id : _undo_db.appended_ids( state ) )
+      add( id );
+   // the indexes whose next id moved without an object left, e.g. of objects created and removed by the block
+   for( const auto& item : state.old_index_next_ids )
+      changes[ std::make_pair( item.first.space(), item.first.type() ) ];
+
+   state_diff diff;
+   diff.block = block;
+   diff.contents = std::move( contents );
+   diff.indexes.reserve( changes.size() );
+   for( auto& item : changes )
+   {
+      item.second.next_id = get_index( item.first.first, item.first.second ).get_next_id();
+      diff.indexes.push_back( std::move( item.second ) );
+   }
+
+   const block_id_type block_id = block.id();
+   if( _state_diffs.find( block_id ) == _state_diffs.end() )
+      _state_diff_order.push_back( block_id );
+   _state_diffs[ block_id ] = std::move( diff );
+   set_state_diffs_kept( _state_diffs_kept );
+}
+
+void database::archive_head_block( uint32_t block_num )
+{
+   // the blocks replayed from the block database may be archived already
+   if( block_num <= _object_archive.last_block_num() && _object_archive.first_block_num() > 0 )
+      return;
+   const undo_state& state = _undo_db.head();
+   flat_set<object_id_type> ids;
+   for( const auto& item : state.removed )
+      ids.insert( item.first );
+   for( const auto& item : state.old_values )
+      ids.insert( item.first );
+   for( const auto& item : state.old_deltas )
+      ids.insert( item.first );
+   ids.insert( state.new_ids.begin(), state.new_ids.end() );
+   for( const auto& id : _undo_db.appended_ids( state ) )
+      ids.insert( id );
+
+   vector< std::pair<object_id_type, vector<char>> > old_values;
+   old_values.reserve( ids.size() );
+   for( const object_id_type& id : ids )
+   {
+      unique_ptr<object> old_value = _undo_db.find_previous_version( id, 1 );
+      old_values.emplace_back( id, old_value ? old_value->pack() : vector<char>() );
+   }
+   _object_archive.append_block( block_num, std::move( old_values ) );
+   _object_archive.flush_until_block( get_dynamic_global_properties().last_irreversible_block_num );
+}
+
+bool database::pending_transactions_full()const
+{
+   return _max_pending_transactions > 0 && _pending_tx.size() >= _max_pending_transactions;
+}
+
+pending_transaction_stats database::get_pending_transaction_stats()const
+{
+   pending_transaction_stats result = _pending_tx_stats;
+   result.count = _pending_tx.size();
+   result.bytes = _pending_tx_bytes;
+   if( !_pending_tx_received.empty() )
+   {
+      // the ages at the ranks of the oldest, the median and the 90th percentile, from the latest pushed
+      vector<fc::time_point> times = _pending_tx_received;
+      std::sort( times.begin(), times.end(), std::greater<fc::time_point>() );
+      const fc::time_point now = fc::time_point::now();
+      result.oldest_age_us = ( now - times.back() ).count();
+      result.median_age_us = ( now - times[ times.size() / 2 ] ).count();
+      result.p90_age_us    = ( now - times[ times.size() * 9 / 10 ] ).count();
+   }
+   return result;
+}
+
+namespace {
+
+struct fee_amount_visitor
+{
+   typedef share_type result_type;
+   template<typename Op>
+   share_type operator()( const Op& op )const { return amount( op.fee ); }
+   static share_type amount( const fee_type& fee ) { return fee.total.amount; }
+   static share_type amount( const asset& fee ) { return fee.amount; }
+};
+
+struct fee_payer_visitor
+{
+   typedef account_uid_type result_type;
+   template<typename Op>
+   account_uid_type operator()( const Op& op )const { return op.fee_payer_uid(); }
+};
+
+} // anonymous namespace
+
+uint64_t database::fee_rate( const signed_transaction& trx )
+{
+   return fee_rate( trx, fc::raw::pack_size( trx ) );
+}
+
+uint64_t database::fee_rate( const signed_transaction& trx, size_t packed_size )
+{
+   share_type fees = 0;
+   for( const auto& op : trx.operations )
+      fees += op.visit( fee_amount_visitor() );
+   if( fees <= 0 )
+      return 0;
+   return uint64_t( fees.value ) * 1024 / std::max<size_t>( 1, packed_size );
+}
+
+vector<size_t> database::order_by_fee_rate( const vector<processed_transaction>& transactions )
+{
+   // the rate a transaction is ranked by is capped by the ranks of the earlier transactions of its fee payers
+   vector<uint64_t> ranks( transactions.size() );
+   flat_map<account_uid_type, uint64_t> payer_ranks;
+   for( size_t i = 0; i < transactions.size(); ++i )
+   {
+      flat_set<account_uid_type> payers;
+      for( const auto& op : transactions[i].operations )
+         payers.insert( op.visit( fee_payer_visitor() ) );
+      uint64_t rank = fee_rate( transactions[i] );
+      for( const auto payer : payers )
+      {
+         auto itr = payer_ranks.find( payer );
+         if( itr != payer_ranks.end() )
+            rank = std::min( rank, itr->second );
+      }
+      for( const auto payer : payers )
+         payer_ranks[payer] = rank;
+      ranks[i] = rank;
+   }
+
+   vector<size_t> order( transactions.size() );
+   std::iota( order.begin(), order.end(), size_t( 0 ) );
+   std::stable_sort( order.begin(), order.end(), [&ranks]( size_t a, size_t b ) { return ranks[a] > ranks[b]; } );
+   return order;
+}
+
+database::state_write_scope::state_write_scope( database& db ) : _db( db )
+{
+   if( _db._state_write_depth++ == 0 )
+      _db._state_mutex.lock();
+}
+
+database::state_write_scope::~state_write_scope()
+{
+   if( --_db._state_write_depth == 0 )
+      _db._state_mutex.unlock();
+}
+
+bool database::head_block_changed_authorities()const
+{
+   if( !_undo_db.enabled() || _undo_db.size() == 0 )
+      return true;
+
+   // the undo state of the head block holds the previous value of every object the block changed
+   const undo_state& state = _undo_db.head();
+   auto is_type = []( const object_id_type& id, uint8_t space_id, uint8_t type_id ) {
+      return id.space() == space_id && id.type() == type_id;
+   };
+   for( const auto& item : state.removed )
+   {
+      if( is_type( item.first, account_object::space_id, account_object::type_id ) )
+         return true;
+   }
+   for( const auto& item : state.old_deltas )
+   {
+      if( is_type( item.first, account_object::space_id, account_object::type_id ) )
+         return true;
+   }
+   for( const auto& item : state.old_values )
+   {
+      if( is_type( item.first, account_object::space_id, account_object::type_id ) )
+      {
+         const account_object& before = static_cast<const account_object&>( *item.second );
+         const account_object& after = static_cast<const account_object&>( get_object( item.first ) );
+         if( !( before.owner == after.owner ) || !( before.active == after.active )
+               || !( before.secondary == after.secondary ) )
+            return true;
+      }
+      else if( is_type( item.first, global_property_object::space_id, global_property_object::type_id ) )
+      {
+         const global_property_object& before = static_cast<const global_property_object&>( *item.second );
+         if( before.parameters.max_authority_depth != get_global_properties().parameters.max_authority_depth )
+            return true;
+      }
+      else if( is_type( item.first, dynamic_global_property_object::space_id, dynamic_global_property_object::type_id ) )
+      {
+         const dynamic_global_property_object& before = static_cast<const dynamic_global_property_object&>( *item.second );
+         if( before.enabled_hardfork_version != get_dynamic_global_properties().enabled_hardfork_version )
+            return true;
+      }
+   }
+   return false;
+}
+
 uint32_t database::push_applied_operation( const operation& op )
 {
-   _applied_ops.emplace_back(op);
-   operation_history_object& oh = *(_applied_ops.back());
+   _applied_ops->emplace_back( op );
+   operation_history_object& oh = *(_applied_ops->back());
    oh.block_timestamp = _current_block_time;
    oh.block_num    = _current_block_num;
    oh.trx_in_block = _current_trx_in_block;
    oh.op_in_trx    = _current_op_in_trx;
    oh.virtual_op   = _current_virtual_op++;
-   return _applied_ops.size() - 1;
+   return _applied_ops->size() - 1;
+}
+uint32_t database::push_applied_operation( operation&& op )
+{
+   _applied_ops->emplace_back( std::move( op ) );
+   operation_history_object& oh = *(_applied_ops->back());
+   oh.block_timestamp = _current_block_time;
+   oh.block_num    = _current_block_num;
+   oh.trx_in_block = _current_trx_in_block;
+   oh.op_in_trx    = _current_op_in_trx;
+   oh.virtual_op   = _current_virtual_op++;
+   return _applied_ops->size() - 1;
 }
 void database::set_applied_operation_result( uint32_t op_id, const operation_result& result )
 {
-   assert( op_id < _applied_ops.size() );
-   if( _applied_ops[op_id] )
-      _applied_ops[op_id]->result = result;
+   assert( op_id < _applied_ops->size() );
+   auto& applied_op = (*_applied_ops)[op_id];
+   if( applied_op )
+      applied_op->result = result;
    else
    {
       elog( "Could not set operation result (head_block_num=${b})", ("b", head_block_num()) );
@@ -460,29 +1197,82 @@ void database::set_applied_operation_result( uint32_t op_id, const operation_res
 }
 
 const vector<optional< operation_history_object > >& database::get_applied_operations() const
+{
+   return *_applied_ops;
+}
+
+const vector< flat_set<account_uid_type> >& database::get_applied_operations_impacted_accounts()const
+{
+   const auto& ops = *_applied_ops;
+   auto& impacted = *_applied_ops_impacted;
+   if( impacted.size() < ops.size() )
+   {
+      impacted.reserve( ops.size() );
+      for( size_t i = impacted.size(); i < ops.size(); ++i )
+      {
+         impacted.emplace_back();
+         if( ops[i].valid() )
+            operation_history_get_impacted_account_uids( *ops[i], impacted.back() );
+      }
+   }
+   return impacted;
+}
+
+database::applied_operations_ptr database::share_applied_operations()const
 {
    return _applied_ops;
 }
 
+database::applied_operations_impacted_ptr database::share_applied_operations_impacted_accounts()const
+{
+   get_applied_operations_impacted_accounts();
+   return _applied_ops_impacted;
+}
+
+void database::clear_applied_operations()
+{
+   // a shared list is left to its observers, an unshared one keeps its capacity for the next block
+   if( _applied_ops.use_count() > 1 )
+      _applied_ops = std::make_shared< vector<optional<operation_history_object> > >();
+   else
+      _applied_ops->clear();
+   if( _applied_ops_impacted.use_count() > 1 )
+      _applied_ops_impacted = std::make_shared< vector< flat_set<account_uid_type> > >();
+   else
+      _applied_ops_impacted->clear();
+}
+
 //////////////////// private methods ////////////////////
 
 void database::apply_block( const signed_block& next_block, uint32_t skip )
 {
    auto block_num = next_block.block_num();
-   if( _checkpoints.size() && _checkpoints.rbegin()->second != block_id_type() )
+   if( is_checkpointed( block_num ) )
    {
       auto itr = _checkpoints.find( block_num );
       if( itr != _checkpoints.end() )
          FC_ASSERT( next_block.id() == itr->second, "Block did not match checkpoint", ("checkpoint",*itr)("block_id",next_block.id()) );
 
-      if( _checkpoints.rbegin()->first >= block_num )
-         skip = ~0;// WE CAN SKIP ALMOST EVERYTHING
+      skip = ~0;// WE CAN SKIP ALMOST EVERYTHING
    }
 
-   detail::with_skip_flags( *this, skip, [&]()
+   _account_authority_cache.begin_block();
+   try
    {
-      _apply_block( next_block );
-   } );
+      detail::with_skip_flags( *this, skip, [&]()
+      {
+         _apply_block( next_block );
+      } );
+   }
+   catch( ... )
+   {
+      _account_authority_cache.end_block();
+      throw;
+   }
+   _account_authority_cache.end_block();
+   // the undo states grow while the last irreversible block doesn't move
+   if( _undo_db.over_memory_limit() )
+      undo_memory_limit_exceeded( _undo_db.memory_usage() );
    return;
 }
 
@@ -490,18 +1280,54 @@ void database::_apply_block( const signed_block& next_block )
 { try {
    uint32_t next_block_num = next_block.block_num();
    uint32_t skip = get_node_properties().skip_flags;
-   _applied_ops.clear();
+   clear_applied_operations();
+   _cleanup_counts = cleanup_counts();
+   ++_head_block_changes;
+
+   block_profile profile;
+   profile.block_num = next_block_num;
+   profile.transaction_count = next_block.transactions.size();
+   const fc::time_point block_start = fc::time_point::now();
+   fc::time_point phase_start = block_start;
+   // sets the duration of the phase which ends now
+   auto end_phase = [&]( int64_t& duration_us )
+   {
+      const fc::time_point now = fc::time_point::now();
+      duration_us = ( now - phase_start ).count();
+      phase_start = now;
+   };
+
+   if( !(skip & skip_merkle_check) )
+   {
+      const checksum_type merkle_root = calculate_merkle_root( next_block );
+      FC_ASSERT( next_block.transaction_merkle_root == merkle_root, "", ("next_block.transaction_merkle_root",next_block.transaction_merkle_root)("calc",merkle_root)("next_block",next_block)("id",next_block.id()) );
+   }
 
-   FC_ASSERT( (skip & skip_merkle_check) || next_block.transaction_merkle_root == next_block.calculate_merkle_root(), "", ("next_block.transaction_merkle_root",next_block.transaction_merkle_root)("calc",next_block.calculate_merkle_root())("next_block",next_block)("id",next_block.id()) );
+   end_phase( profile.merkle_check_us );
 
    const witness_object& signing_witness = validate_block_header(skip, next_block);
+   end_phase( profile.header_validation_us );
 
    _current_block_time   = next_block.timestamp;
    _current_block_num    = next_block_num;
    _current_trx_in_block = 0;
 
+   // the post contents left by a failed attempt to apply a block of this number are dropped, the ones put from
+   // now on are kept with the block until it is irreversible
+   if( _post_contents.is_open() )
+      _post_contents.discard_from_block( next_block_num );
+   struct applying_block_reset
+   {
+      uint32_t& num;
+      ~applying_block_reset() { num = 0; }
+   } applying_block{ _applying_block_num };
+   _applying_block_num = next_block_num;
+
    update_global_dynamic_data(next_block);
 
+   precompute_signature_keys( next_block, skip );
+   end_phase( profile.block_setup_us );
+
    //dlog("before apply_transaction");
    for( const auto& trx : next_block.transactions )
    {
@@ -515,9 +1341,13 @@ void database::_apply_block( const signed_block& next_block )
       ++_current_trx_in_block;
    }
 
+   end_phase( profile.transactions_us );
+
    //dlog("after apply_transaction");
    execute_committee_proposals();
    update_undo_db_size();
+   // the passes below change the dynamic global properties many times, they are modified once when they're done
+   dynamic_global_property_batch dgp_batch( *this );
    update_signing_witness(signing_witness, next_block);
    update_last_irreversible_block();
 
@@ -530,6 +1360,8 @@ void database::_apply_block( const signed_block& next_block )
 
    //dlog("after update_withdraw_permissions");
    clear_expired_csaf_leases();
+   end_phase( profile.block_end_us );
+
    update_average_witness_pledges();
 
    //release pledges, including:
@@ -556,7 +1388,7 @@ void database::_apply_block( const signed_block& next_block )
    if (head_block_time() >= HARDFORK_0_4_TIME && dpo.enabled_hardfork_version < ENABLE_HEAD_FORK_04)
    {
       update_reduce_witness_csaf();
-      modify(dpo, [&](dynamic_global_property_object& dp)
+      modify_dynamic_global_properties( [&](dynamic_global_property_object& dp)
       {
          dp.enabled_hardfork_version = ENABLE_HEAD_FORK_04;
       });
@@ -571,7 +1403,7 @@ void database::_apply_block( const signed_block& next_block )
       //update account that created before hardfork_0_5_time registrar,referrer,registrar_percent, referrer_percent
       update_account_reg_info();
       update_core_asset_flags();
-      modify(dpo, [&](dynamic_global_property_object& dp)
+      modify_dynamic_global_properties( [&](dynamic_global_property_object& dp)
       {
          dp.total_witness_pledge += dpo.resign_witness_pledge_before_05;
          dp.enabled_hardfork_version = ENABLE_HEAD_FORK_05;
@@ -579,7 +1411,7 @@ void database::_apply_block( const signed_block& next_block )
 
       if (dpo.budget_pool >= GRAPHENE_HARDFORK_DESTORY_BUDGET_POOL_AMOUNT)
       {
-         modify(dpo, [&](dynamic_global_property_object& dp)
+         modify_dynamic_global_properties( [&](dynamic_global_property_object& dp)
          {
             dp.budget_pool -= GRAPHENE_HARDFORK_DESTORY_BUDGET_POOL_AMOUNT;
          });
@@ -600,25 +1432,66 @@ void database::_apply_block( const signed_block& next_block )
    if (dpo.enabled_hardfork_version >= ENABLE_HEAD_FORK_05)
       update_average_platform_pledges();
 
+   end_phase( profile.maintenance_us );
+
    //dlog("before update_witness_schedule");
    update_witness_schedule();
+   dgp_batch.flush();
    if( !_node_property_object.debug_updates.empty() )
       apply_debug_updates();
+   end_phase( profile.witness_schedule_us );
 
    //dlog("before check invariants");
+   if( _check_supply_totals && !(skip & skip_invariants_check) && _node_property_object.debug_updates.empty() )
+      check_supply_totals();
    if(next_block.block_num()%_check_invariants_interval==0)
    {
-      check_invariants();
+      if( _check_invariants_async )
+         schedule_invariants_check();
+      else
+         check_invariants();
    }
+   end_phase( profile.invariants_us );
 
    //dlog("before notify applied block");
    // notify observers that the block has been applied
    // TODO catch exceptions thrown by plugins but not the core
-   applied_block( next_block ); //emit
-   _applied_ops.clear();
+   // logged before the observers see the block, so that one catching up from the log doesn't miss it
+   if( _applied_operations_log.is_open()
+       && ( _applied_operations_log.first_block_num() == 0 || next_block_num > _applied_operations_log.last_block_num() ) )
+   {
+      _applied_operations_log.append_block( next_block_num, *_applied_ops );
+      _applied_operations_log.flush_until_block( get_dynamic_global_properties().last_irreversible_block_num );
+   }
+   if( _post_contents.is_open() )
+      _post_contents.flush_until_block( get_dynamic_global_properties().last_irreversible_block_num );
+   if( !_quiet_blocks || !_applied_ops->empty() )
+      applied_block( next_block ); //emit
+   if( _state_diffs_kept > 0 && _undo_db.enabled() )
+      record_state_diff( next_block );
+   if( _object_archive.is_open() && _undo_db.enabled() )
+      archive_head_block( next_block_num );
+   clear_applied_operations();
+   end_phase( profile.applied_block_us );
+
+   if( _evaluation_profile_log_interval > 0 && next_block_num % _evaluation_profile_log_interval == 0 )
+      log_evaluation_profile();
    
    //dlog("before notify changed objects");
-   notify_changed_objects();
+   if( !_quiet_blocks )
+      notify_changed_objects();
+   end_phase( profile.notify_changed_objects_us );
+
+   profile.total_us = ( phase_start - block_start ).count();
+   _block_profiler.record( profile );
+   if( _block_apply_seconds != nullptr )
+   {
+      _block_apply_seconds->observe( profile.total_us / 1000000.0 );
+      _blocks_applied->add();
+      _transactions_applied->add( profile.transaction_count );
+   }
+   if( _slow_block_log_threshold_us > 0 && profile.total_us >= _slow_block_log_threshold_us )
+      wlog( "Slow block ${n}: ${p}", ("n",next_block_num)("p",profile) );
 } FC_CAPTURE_AND_RETHROW( (next_block.block_num())(next_block) )  }
 
 
@@ -633,12 +1506,33 @@ processed_transaction database::apply_transaction(const signed_transaction& trx,
    return result;
 }
 
-processed_transaction database::_apply_transaction(const signed_transaction& trx)
+processed_transaction database::_apply_transaction( const signed_transaction& trx, optional<signed_information>* authority )
+{
+   auto operation_results = _apply_transaction_operations( trx, authority );
+   processed_transaction ptrx( trx );
+   ptrx.operation_results = std::move( operation_results );
+   return ptrx;
+}
+
+processed_transaction database::_apply_transaction( signed_transaction&& trx, optional<signed_information>* authority )
+{
+   auto operation_results = _apply_transaction_operations( trx, authority );
+   processed_transaction ptrx( std::move(trx) );
+   ptrx.operation_results = std::move( operation_results );
+   return ptrx;
+}
+
+vector<operation_result> database::_apply_transaction_operations( const signed_transaction& trx,
+                                                                  optional<signed_information>* authority )
 { try {
    uint32_t skip = get_node_properties().skip_flags;
 
    if( true || !(skip&skip_validate) )   /* issue #505 explains why this skip_flag is disabled */
-      trx.validate();
+   {
+      if( !trx.validated )
+         trx.validate();
+      trx.validated = false;
+   }
 
    auto& trx_idx = get_mutable_index_type<transaction_index>();
    const chain_id_type& chain_id = get_chain_id();
@@ -651,39 +1545,26 @@ processed_transaction database::_apply_transaction(const signed_transaction& trx
 
    signed_information sigs;
 
-   auto to_check_transaction = [&](){
-       for (const auto& op : trx.operations)
-       {
-           if (op.which() == operation::tag< transfer_operation >::value ||
-               op.which() == operation::tag< post_operation >::value || 
-               op.which() == operation::tag< post_update_operation >::value ||
-               op.which() == operation::tag< reward_proxy_operation >::value || 
-               op.which() == operation::tag< buyout_operation >::value ||
-               op.which() == operation::tag< score_create_operation >::value )
-           {
-               return true;
-           }
-       }
-       return false;
-   };
-   if (!(skip & (skip_transaction_signatures | skip_authority_check)) || to_check_transaction())
-   {
-      if(!(skip&skip_uint_test)){
-         //auto get_active = [&]( account_id_type id ) { return &id(*this).active; };
-         //auto get_owner  = [&]( account_id_type id ) { return &id(*this).owner;  };
-         //trx.verify_authority( chain_id, get_active, get_owner, get_global_properties().parameters.max_authority_depth );
-
-         auto get_owner_by_uid      = [&]( account_uid_type uid ) { return &(this->get_account_by_uid(uid).owner);     };
-         auto get_active_by_uid     = [&]( account_uid_type uid ) { return &(this->get_account_by_uid(uid).active);    };
-         auto get_secondary_by_uid  = [&]( account_uid_type uid ) { return &(this->get_account_by_uid(uid).secondary); };
-         sigs = trx.verify_authority(chain_id,
-                               get_owner_by_uid,
-                               get_active_by_uid,
-                               get_secondary_by_uid,
-                               get_dynamic_global_properties().enabled_hardfork_version >= ENABLE_HEAD_FORK_04,
-                               chain_parameters.max_authority_depth );
-      }
+   if( need_authority_check( trx, skip ) && authority != nullptr && authority->valid() )
+      sigs = **authority;
+   else if( need_authority_check( trx, skip ) )
+   {
+      //auto get_active = [&]( account_id_type id ) { return &id(*this).active; };
+      //auto get_owner  = [&]( account_id_type id ) { return &id(*this).owner;  };
+      //trx.verify_authority( chain_id, get_active, get_owner, get_global_properties().parameters.max_authority_depth );
+
+      if( !trx.signees.valid() )
+         trx.signees = trx.get_signature_keys( chain_id, &_signature_key_cache );
+      sigs = verify_authority_with( get_authority_resolver(),
+                                    trx.operations,
+                                    *trx.signees,
+                                    get_dynamic_global_properties().enabled_hardfork_version >= ENABLE_HEAD_FORK_04,
+                                    chain_parameters.max_authority_depth );
+      if( authority != nullptr )
+         *authority = sigs;
    }
+   // the precomputed keys are not needed any more, don't keep them in transaction_object or pending state
+   trx.signees.reset();
 
    //Skip all manner of expiration and TaPoS checking if we're on block 1; It's impossible that the transaction is
    //expired, and TaPoS makes no sense as no blocks exist.
@@ -691,7 +1572,8 @@ processed_transaction database::_apply_transaction(const signed_transaction& trx
    {
       if( !(skip & skip_tapos_check) )
       {
-         const auto& tapos_block_summary = block_summary_id_type( trx.ref_block_num )(*this);
+         // the ring holds all the 0x10000 values of ref_block_num since genesis
+         const auto& tapos_block_summary = _block_summary_index->at( trx.ref_block_num );
 
          //Verify TaPoS block summary has correct ID prefix, and that this block's time is not past the expiration
          FC_ASSERT( trx.ref_block_prefix == tapos_block_summary.block_id._hash[1] );
@@ -709,24 +1591,192 @@ processed_transaction database::_apply_transaction(const signed_transaction& trx
    {
       create<transaction_object>([&](transaction_object& transaction) {
          transaction.trx_id = trx_id;
-         transaction.trx = trx;
+         transaction.expiration = trx.expiration;
       });
    }
 
    eval_state.operation_results.reserve(trx.operations.size());
 
    //Finally process the operations
-   processed_transaction ptrx(trx);
    _current_op_in_trx = 0;
-   for( const auto& op : ptrx.operations )
+   for( const auto& op : trx.operations )
    {
       eval_state.operation_results.emplace_back(apply_operation(eval_state, op, sigs));
       ++_current_op_in_trx;
    }
-   ptrx.operation_results = std::move(eval_state.operation_results);
 
-   return ptrx;
+   // only once it applied, the undo session it's in removes it again if it's undone
+   if( !(skip & skip_transaction_dupe_check) )
+      _recent_transactions.add(trx_id, trx);
+
+   return std::move(eval_state.operation_results);
 } FC_CAPTURE_AND_RETHROW( (trx) ) }
+bool database::need_authority_check( const signed_transaction& trx, uint32_t skip )const
+{
+   if( skip & skip_uint_test )
+      return false;
+   if( !(skip & (skip_transaction_signatures | skip_authority_check)) )
+      return true;
+   for( const auto& op : trx.operations )
+   {
+      if( op.which() == operation::tag< transfer_operation >::value ||
+          op.which() == operation::tag< post_operation >::value ||
+          op.which() == operation::tag< post_update_operation >::value ||
+          op.which() == operation::tag< reward_proxy_operation >::value ||
+          op.which() == operation::tag< buyout_operation >::value ||
+          op.which() == operation::tag< score_create_operation >::value )
+         return true;
+   }
+   return false;
+}
+
+void database::precompute_signature_keys( const signed_block& next_block, uint32_t skip )
+{
+   if( !_thread_pool || _thread_pool->size() == 0 || next_block.transactions.size() < 2 )
+      return;
+
+   // the ids of all transactions are hashed and their operations validated along, _apply_transaction() needs
+   // them, with whether the keys are to be recovered
+   vector< std::pair<const signed_transaction*,bool> > to_precompute;
+   to_precompute.reserve( next_block.transactions.size() );
+   for( const auto& trx : next_block.transactions )
+   {
+      const bool recover_keys = !trx.signees.valid() && need_authority_check( trx, skip );
+      if( recover_keys || !trx.precomputed_id.valid() || !trx.validated )
+         to_precompute.emplace_back( &trx, recover_keys );
+   }
+   if( to_precompute.size() < 2 )
+      return;
+
+   const chain_id_type& chain_id = get_chain_id();
+   signature_key_cache& cache = _signature_key_cache;
+   _thread_pool->parallel_for( to_precompute.size(), [&to_precompute,&chain_id,&cache]( size_t i ) {
+      const signed_transaction& trx = *to_precompute[i].first;
+      trx.precompute_id();
+      if( !trx.validated )
+      {
+         try {
+            trx.validate();
+            trx.validated = true;
+         } catch( const fc::exception& ) {
+            // _apply_transaction() validates it again and reports the error
+         }
+      }
+      if( !to_precompute[i].second )
+         return;
+      try {
+         trx.signees = trx.get_signature_keys( chain_id, &cache );
+      } catch( const fc::exception& ) {
+         // leave it to _apply_transaction() to recover the keys again and report the error
+      }
+   });
+}
+
+void database::precompute_block_signees( const vector<const signed_block*>& blocks )
+{
+   if( !_thread_pool || _thread_pool->size() == 0 || blocks.size() < 2 )
+      return;
+   // the signatures of the checkpointed blocks aren't checked
+   vector<const signed_block*> to_recover;
+   to_recover.reserve( blocks.size() );
+   for( const signed_block* b : blocks )
+      if( !is_checkpointed( b->block_num() ) )
+         to_recover.push_back( b );
+   _thread_pool->parallel_for( to_recover.size(), [&to_recover]( size_t i ) {
+      to_recover[i]->precompute_signee();
+   });
+}
+
+checksum_type database::calculate_merkle_root( const signed_block& block )const
+{
+   if( !_thread_pool || _thread_pool->size() == 0 )
+      return block.calculate_merkle_root();
+   graphene::utilities::thread_pool& pool = *_thread_pool;
+   return block.calculate_merkle_root( [&pool]( size_t count, const std::function<void(size_t)>& f ) {
+      pool.parallel_for( count, f );
+   }, GRAPHENE_PARALLEL_MERKLE_MIN_HASHES );
+}
+
+void database::set_worker_threads( uint32_t num_threads )
+{
+   if( num_threads == 0 )
+      _thread_pool.reset();
+   else
+      _thread_pool.reset( new graphene::utilities::thread_pool( num_threads, "chain-worker" ) );
+}
+
+uint32_t database::get_worker_threads()const
+{
+   return _thread_pool ? _thread_pool->size() : 0;
+}
+
+void database::pin_worker_threads( const vector<uint32_t>& cpus )
+{
+   if( _thread_pool )
+      _thread_pool->pin_threads( cpus );
+}
+
+void database::set_metrics( graphene::utilities::metrics_registry* metrics )
+{
+   if( metrics == nullptr )
+   {
+      _block_apply_seconds = nullptr;
+      _blocks_applied = nullptr;
+      _transactions_applied = nullptr;
+      return;
+   }
+   _block_apply_seconds = &metrics->histogram( "yoyow_block_apply_seconds", "Time to apply a block",
+                                               graphene::utilities::metrics_registry::exponential_bounds( 0.001, 2, 14 ) );
+   _blocks_applied = &metrics->counter( "yoyow_blocks_applied_total", "Blocks applied since the node started" );
+   _transactions_applied = &metrics->counter( "yoyow_transactions_applied_total",
+                                              "Transactions applied in blocks since the node started" );
+
+   auto* head_block = &metrics->gauge( "yoyow_head_block_number", "Number of the head block" );
+   auto* head_block_age = &metrics->gauge( "yoyow_head_block_age_seconds", "Time since the head block was produced" );
+   auto* undo_states = &metrics->gauge( "yoyow_undo_states", "Undo states kept for the reversible blocks" );
+   auto* undo_bytes = &metrics->gauge( "yoyow_undo_bytes", "Memory held by the undo states" );
+   auto* pending_count = &metrics->gauge( "yoyow_pending_transactions", "Transactions waiting for a block" );
+   auto* pending_bytes = &metrics->gauge( "yoyow_pending_transaction_bytes", "Packed size of the pending transactions" );
+   metrics->add_collector( [=]() {
+      head_block->set( head_block_num() );
+      head_block_age->set( ( fc::time_point::now() - head_block_time() ).to_seconds() );
+      const undo_database_stats undo = _undo_db.get_stats();
+      undo_states->set( undo.state_count );
+      undo_bytes->set( undo.memory_bytes );
+      pending_count->set( _pending_tx.size() );
+      pending_bytes->set( _pending_tx_bytes );
+   } );
+}
+
+namespace {
+   struct operation_type_name_visitor
+   {
+      typedef string result_type;
+      template<typename T>
+      string operator()( const T& )const
+      {
+         string name = fc::get_typename<T>::name();
+         auto pos = name.rfind( ':' );
+         return pos == string::npos ? name : name.substr( pos + 1 );
+      }
+   };
+}
+
+void database::log_evaluation_profile()
+{
+   const auto profiles = _evaluation_profiler.get_profiles();
+   _evaluation_profiler.reset();
+   ilog( "Evaluation profile of the last ${n} blocks:", ("n",_evaluation_profile_log_interval) );
+   for( const auto& p : profiles )
+   {
+      operation op;
+      op.set_which( p.operation_type );
+      ilog( "  ${op}: ${c} ops, evaluate ${e} us, apply ${a} us, histogram ${h}, created ${cr}, modified ${m}, removed ${r}",
+            ("op",op.visit( operation_type_name_visitor() ))("c",p.count)("e",p.evaluate_us)("a",p.apply_us)
+            ("h",p.histogram)("cr",p.objects_created)("m",p.objects_modified)("r",p.objects_removed) );
+   }
+}
+
 void database::handle_non_consensus_index(const operation & op){
    if(op.which()==operation::tag<custom_vote_cast_operation>::value)
       update_non_consensus_index(op);
@@ -737,12 +1787,18 @@ operation_result database::apply_operation(transaction_evaluation_state& eval_st
    uint64_t u_which = uint64_t( i_which );
    FC_ASSERT( i_which >= 0, "Negative operation tag in operation ${op}", ("op",op) );
    FC_ASSERT( u_which < _operation_evaluators.size(), "No registered evaluator for operation ${op}", ("op",op) );
-   unique_ptr<op_evaluator>& eval = _operation_evaluators[ u_which ];
-   FC_ASSERT( eval, "No registered evaluator for operation ${op}", ("op",op) );
+   const operation_evaluate_function evaluate = _operation_evaluators[ u_which ];
+   FC_ASSERT( evaluate != nullptr, "No registered evaluator for operation ${op}", ("op",op) );
    auto op_id = push_applied_operation( op );
-   auto result = eval->evaluate( eval_state, op, true, sigs);
+   const auto changes_before = get_change_counts();
+   auto result = evaluate( eval_state, op, true, sigs );
    set_applied_operation_result( op_id, result );
    handle_non_consensus_index(op);
+   const auto& changes = get_change_counts();
+   _evaluation_profiler.record( i_which, eval_state.last_evaluate_time, eval_state.last_apply_time,
+                                changes.created - changes_before.created,
+                                changes.modified - changes_before.modified,
+                                changes.removed - changes_before.removed );
    return result;
 } FC_CAPTURE_AND_RETHROW( (op) ) }
 
@@ -771,8 +1827,7 @@ const witness_object& database::validate_block_header( uint32_t skip, const sign
 
 void database::create_block_summary(const signed_block& next_block)
 {
-   block_summary_id_type sid(next_block.block_num() & 0xffff );
-   modify( sid(*this), [&](block_summary_object& p) {
+   modify( _block_summary_index->at( next_block.block_num() & 0xffff ), [&](block_summary_object& p) {
          p.block_id = next_block.id();
    });
 }
@@ -787,5 +1842,11 @@ bool database::before_last_checkpoint()const
 {
    return (_checkpoints.size() > 0) && (_checkpoints.rbegin()->first >= head_block_num());
 }
+
+bool database::is_checkpointed( uint32_t block_num )const
+{
+   return _checkpoints.size() && _checkpoints.rbegin()->second != block_id_type()
+          && _checkpoints.rbegin()->first >= block_num;
+}
    
 } }
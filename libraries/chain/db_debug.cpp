@@ -169,8 +169,15 @@ void database::apply_debug_updates()
       debug_apply_update( *this, update );
 }
 
+void database::debug_update_state( const fc::variant_object& update )
+{
+   debug_apply_update( *this, update );
+}
+
 void database::debug_update( const fc::variant_object& update )
 {
+   // readers don't get to see the chain between popping the head block and pushing it again
+   state_write_scope write_scope( *this );
    block_id_type head_id = head_block_id();
    auto it = _node_property_object.debug_updates.find( head_id );
    if( it == _node_property_object.debug_updates.end() )
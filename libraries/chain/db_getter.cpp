@@ -29,6 +29,7 @@
 #include <graphene/chain/global_property_object.hpp>
 #include <graphene/chain/advertising_object.hpp>
 #include <graphene/chain/pledge_mining_object.hpp>
+#include <graphene/chain/hardfork.hpp>
 
 #include <fc/smart_ref_impl.hpp>
 
@@ -36,7 +37,13 @@ namespace graphene { namespace chain {
 
 const asset_object& database::get_core_asset() const
 {
-   return get(asset_id_type());
+   auto obj = _core_asset.load( std::memory_order_acquire );
+   if( obj == nullptr )
+   {
+      obj = &get(asset_id_type());
+      _core_asset.store( obj, std::memory_order_release );
+   }
+   return *obj;
 }
 
 const asset_object& database::get_asset_by_aid( asset_aid_type aid )const
@@ -59,17 +66,46 @@ const asset_object* database::find_asset_by_aid( asset_aid_type aid )const
 
 const global_property_object& database::get_global_properties()const
 {
-   return get( global_property_id_type() );
+   auto obj = _global_properties.load( std::memory_order_acquire );
+   if( obj == nullptr )
+   {
+      obj = &get( global_property_id_type() );
+      _global_properties.store( obj, std::memory_order_release );
+   }
+   return *obj;
 }
 
 const chain_property_object& database::get_chain_properties()const
 {
-   return get( chain_property_id_type() );
+   auto obj = _chain_properties.load( std::memory_order_acquire );
+   if( obj == nullptr )
+   {
+      obj = &get( chain_property_id_type() );
+      _chain_properties.store( obj, std::memory_order_release );
+   }
+   return *obj;
 }
 
 const dynamic_global_property_object&database::get_dynamic_global_properties() const
 {
-   return get( dynamic_global_property_id_type() );
+   if( _batched_dynamic_global_properties.valid() )
+      return *_batched_dynamic_global_properties;
+   auto obj = _dynamic_global_properties.load( std::memory_order_acquire );
+   if( obj == nullptr )
+   {
+      obj = &get( dynamic_global_property_id_type() );
+      _dynamic_global_properties.store( obj, std::memory_order_release );
+   }
+   return *obj;
+}
+
+hardfork_rules database::get_hardfork_rules()const
+{
+   const dynamic_global_property_object& dpo = get_dynamic_global_properties();
+   hardfork_rules rules;
+   rules.head_fork_05   = dpo.enabled_hardfork_version >= ENABLE_HEAD_FORK_05;
+   rules.after_0_6_time = dpo.time >= HARDFORK_0_6_TIME;
+   return rules;
 }
 
 const fee_schedule&  database::current_fee_schedule()const
@@ -79,17 +115,17 @@ const fee_schedule&  database::current_fee_schedule()const
 
 time_point_sec database::head_block_time()const
 {
-   return get( dynamic_global_property_id_type() ).time;
+   return get_dynamic_global_properties().time;
 }
 
 uint32_t database::head_block_num()const
 {
-   return get( dynamic_global_property_id_type() ).head_block_number;
+   return get_dynamic_global_properties().head_block_number;
 }
 
 block_id_type database::head_block_id()const
 {
-   return get( dynamic_global_property_id_type() ).head_block_id;
+   return get_dynamic_global_properties().head_block_id;
 }
 
 decltype( chain_parameters::block_interval ) database::block_interval( )const
@@ -117,6 +153,60 @@ uint32_t database::last_non_undoable_block_num() const
    return head_block_num() - _undo_db.size();
 }
 
+/// the number of undo states of the pending transactions, on top of those of the blocks
+static size_t pending_undo_states( const undo_database& undo_db, bool pending_session )
+{
+   return ( pending_session && undo_db.size() > 0 ) ? 1 : 0;
+}
+
+uint32_t database::earliest_versioned_block_num()const
+{
+   if( !_undo_db.enabled() )
+      return head_block_num();
+   const size_t block_states = _undo_db.size() - pending_undo_states( _undo_db, _pending_tx_session.valid() );
+   return head_block_num() - std::min<size_t>( block_states, head_block_num() );
+}
+
+uint32_t database::earliest_lookup_block_num()const
+{
+   const uint32_t versioned = earliest_versioned_block_num();
+   const uint32_t first_archived = _object_archive.first_block_num();
+   // the archive holds the values the objects had before its first block
+   if( first_archived > 0 && _object_archive.last_block_num() >= versioned )
+      return std::min( first_archived - 1, versioned );
+   return versioned;
+}
+
+unique_ptr<object> database::find_object_at_block( object_id_type id, uint32_t block_num )const
+{
+   FC_ASSERT( block_num <= head_block_num(), "Block ${n} is not applied yet", ("n",block_num) );
+   FC_ASSERT( block_num >= earliest_lookup_block_num(),
+              "The object versions of block ${n} are not kept anymore, the earliest block is ${e}",
+              ("n",block_num)("e",earliest_lookup_block_num()) );
+   const uint32_t versioned = earliest_versioned_block_num();
+   if( block_num < versioned )
+   {
+      vector<char> value;
+      if( !_object_archive.find_value_after( id, block_num, value ) )
+      {
+         // not changed until the last archived block, which the undo history reaches
+         const uint32_t last_archived = std::min( _object_archive.last_block_num(), head_block_num() );
+         FC_ASSERT( last_archived >= versioned );
+         return find_object_at_block( id, last_archived );
+      }
+      if( value.empty() )
+         return unique_ptr<object>();
+      return get_index( id.space(), id.type() ).unpack_object( value );
+   }
+   if( !_undo_db.enabled() )
+   {
+      const object* obj = find_object( id );
+      return obj != nullptr ? obj->clone() : unique_ptr<object>();
+   }
+   const size_t states = ( head_block_num() - block_num ) + pending_undo_states( _undo_db, _pending_tx_session.valid() );
+   return _undo_db.find_previous_version( id, states );
+}
+
 const account_object& database::get_account_by_uid( account_uid_type uid )const
 {
    const auto& accounts_by_uid = get_index_type<account_index>().indices().get<by_uid>();
@@ -135,6 +225,11 @@ const account_object* database::find_account_by_uid( account_uid_type uid )const
       return nullptr;
 }
 
+const account_object* database::find_account_by_name( const string& name )const
+{
+   return _account_name_index->find( name );
+}
+
 const optional<account_id_type> database::find_account_id_by_uid( account_uid_type uid )const
 {
    const auto& accounts_by_uid = get_index_type<account_index>().indices().get<by_uid>();
@@ -192,7 +287,7 @@ account_statistics_object database::get_account_statistics_struct_by_uid(account
 
    obj.uncollected_witness_pay  = ant.uncollected_witness_pay;
    obj.uncollected_pledge_bonus = ant.uncollected_pledge_bonus;
-   obj.uncollected_market_fees  = ant.uncollected_market_fees;
+   obj.uncollected_market_fees.insert( ant.uncollected_market_fees.begin(), ant.uncollected_market_fees.end() );
    obj.uncollected_score_bonus  = ant.uncollected_score_bonus;
 
    obj.witness_last_confirmed_block_num = ant.witness_last_confirmed_block_num;
@@ -258,12 +353,7 @@ const account_auth_platform_object& database::get_account_auth_platform_object_b
 
 const voter_object* database::find_voter( account_uid_type uid, uint32_t sequence )const
 {
-   const auto& idx = get_index_type<voter_index>().indices().get<by_uid_seq>();
-   auto itr = idx.find( std::make_tuple( uid, sequence) );
-   if( itr != idx.end() )
-      return &(*itr);
-   else
-      return nullptr;
+   return _voter_proxy_index->find( uid, sequence );
 }
 
 const witness_object& database::get_witness_by_uid( account_uid_type uid )const
@@ -390,6 +480,27 @@ const platform_object* database::find_platform_by_owner( account_uid_type owner
       return nullptr;
 }
 
+const active_post_receiptor_object* database::find_active_post_receiptor( active_post_id_type active_post,
+                                                                         account_uid_type receiptor )const
+{
+   const auto& idx = get_index_type<active_post_receiptor_index>().indices().get<by_active_post_receiptor>();
+   auto itr = idx.find( std::make_tuple( active_post, receiptor ) );
+   if( itr != idx.end() )
+      return &(*itr);
+   else
+      return nullptr;
+}
+
+const platform_period_profit_object* database::find_platform_period_profit( platform_id_type platform, uint32_t period )const
+{
+   const auto& idx = get_index_type<platform_period_profit_index>().indices().get<by_platform_period>();
+   auto itr = idx.find( std::make_tuple( platform, period ) );
+   if( itr != idx.end() )
+      return &(*itr);
+   else
+      return nullptr;
+}
+
 const platform_object* database::find_platform_by_sequence(account_uid_type owner, uint32_t sequence)const
 {
     const auto& idx = get_index_type<platform_index>().indices().get<by_valid>();
@@ -437,6 +548,22 @@ const post_object* database::find_post_by_platform( account_uid_type platform,
       return nullptr;
 }
 
+post_object database::with_post_content( const post_object& post )const
+{
+   post_object result = post;
+   if( result.body_ref.valid() )
+   {
+      result.body = _post_contents.get( *result.body_ref );
+      result.body_ref.reset();
+   }
+   if( result.extra_data_ref.valid() )
+   {
+      result.extra_data = _post_contents.get( *result.extra_data_ref );
+      result.extra_data_ref.reset();
+   }
+   return result;
+}
+
 const license_object& database::get_license_by_platform(account_uid_type platform, license_lid_type license_lid)const
 {
     const auto& license_by_lid = get_index_type<license_index>().indices().get<by_license_lid>();
@@ -483,6 +610,11 @@ const score_object* database::find_score(account_uid_type platform,
         return nullptr;
 }
 
+time_point_sec database::get_score_expiration_time()const
+{
+    return head_block_time() - get_global_properties().parameters.get_extension_params().approval_expiration;
+}
+
 const advertising_object*  database::find_advertising(account_uid_type platform, advertising_aid_type advertising_aid)const
 {
     const auto& advertising_by_aid = get_index_type<advertising_index>().indices().get<by_advertising_platform>();
@@ -540,4 +672,22 @@ const custom_vote_object* database::find_custom_vote_by_vid(account_uid_type cre
       return nullptr;
 }
 
+vector<uint64_t> database::get_custom_vote_result(const custom_vote_object& vote)const
+{
+   vector<uint64_t> result = vote.vote_result;
+   const auto& cast_idx = get_index_type<cast_custom_vote_index>().indices().get<by_custom_vote_vid>();
+   const auto& weight_idx = get_index_type<custom_vote_weight_index>().indices().get<by_voter_asset>();
+   auto itr = cast_idx.lower_bound(std::make_tuple(vote.custom_vote_creator, vote.vote_vid));
+   for (; itr != cast_idx.end() && itr->custom_vote_creator == vote.custom_vote_creator && itr->custom_vote_vid == vote.vote_vid; ++itr)
+   {
+      auto weight_itr = weight_idx.find(std::make_tuple(itr->voter, itr->vote_asset_id));
+      if (weight_itr == weight_idx.end() || itr->vote_expired_time < weight_itr->settled_until)
+         continue; // settled already
+      const share_type unsettled = weight_itr->weight - itr->weight_snapshot;
+      for (const auto& v : itr->vote_result)
+         result.at(v) += unsettled.value;
+   }
+   return result;
+}
+
 } }
@@ -42,6 +42,9 @@
 #include <graphene/chain/witness_object.hpp>
 #include <graphene/chain/witness_schedule_object.hpp>
 #include <graphene/chain/pledge_mining_object.hpp>
+#include <graphene/chain/object_counts.hpp>
+#include <graphene/chain/order_book_index.hpp>
+#include <graphene/chain/supply_totals.hpp>
 
 #include <graphene/chain/account_evaluator.hpp>
 #include <graphene/chain/asset_evaluator.hpp>
@@ -160,12 +163,27 @@ const uint8_t custom_vote_object::type_id;
 const uint8_t cast_custom_vote_object::space_id;
 const uint8_t cast_custom_vote_object::type_id;
 
+const uint8_t custom_vote_weight_object::space_id;
+const uint8_t custom_vote_weight_object::type_id;
+
 const uint8_t pledge_mining_object::space_id;
 const uint8_t pledge_mining_object::type_id;
 
 const uint8_t pledge_balance_object::space_id;
 const uint8_t pledge_balance_object::type_id;
 
+const uint8_t content_award_settlement_object::space_id;
+const uint8_t content_award_settlement_object::type_id;
+
+const uint8_t platform_period_profit_object::space_id;
+const uint8_t platform_period_profit_object::type_id;
+
+const uint8_t platform_vote_profit_object::space_id;
+const uint8_t platform_vote_profit_object::type_id;
+
+const uint8_t active_post_receiptor_object::space_id;
+const uint8_t active_post_receiptor_object::type_id;
+
 void database::initialize_evaluators()
 {
    _operation_evaluators.resize(255);
@@ -232,6 +250,10 @@ void database::initialize_evaluators()
 void database::initialize_indexes()
 {
    reset_indexes();
+   _global_properties = nullptr;
+   _dynamic_global_properties = nullptr;
+   _chain_properties = nullptr;
+   _core_asset = nullptr;
    _undo_db.set_max_size( GRAPHENE_MIN_UNDO_HISTORY );
 
    //Protocol object indexes
@@ -239,16 +261,22 @@ void database::initialize_indexes()
 
    auto acnt_index = add_index< primary_index<account_index> >();
    acnt_index->add_secondary_index<account_member_index>();
-   acnt_index->add_secondary_index<account_referrer_index>();
+   _account_name_index = acnt_index->add_secondary_index<account_name_index>();
 
-   add_index< primary_index<platform_index> >();
-   add_index< primary_index<post_index> >();
+   auto platform_idx = add_index< primary_index<platform_index> >();
+   platform_idx->add_secondary_index<valid_platform_count_index>();
+   auto post_idx = add_index< primary_index<post_index> >();
+   post_idx->add_secondary_index<post_count_index>();
    add_index< primary_index<active_post_index> >();
 
-   add_index< primary_index<committee_member_index> >();
+   auto committee_member_idx = add_index< primary_index<committee_member_index> >();
+   committee_member_idx->add_secondary_index<valid_committee_member_count_index>();
    add_index< primary_index<committee_proposal_index> >();
-   add_index< primary_index<witness_index> >();
-   add_index< primary_index<limit_order_index > >();
+   auto witness_idx = add_index< primary_index<witness_index> >();
+   witness_idx->add_secondary_index<valid_witness_count_index>();
+   auto limit_order_idx = add_index< primary_index<limit_order_index > >();
+   limit_order_idx->add_secondary_index<limit_order_totals_index>();
+   limit_order_idx->add_secondary_index<limit_order_book_index>();
    //add_index< primary_index<call_order_index > >();
 
    auto prop_index = add_index< primary_index<proposal_index > >();
@@ -256,29 +284,42 @@ void database::initialize_indexes()
 
    //Implementation object indexes
    add_index< primary_index<transaction_index                             > >();
-   add_index< primary_index<account_balance_index                         > >();
+   auto balance_idx = add_index< primary_index<account_balance_index      > >();
+   balance_idx->add_secondary_index<account_balance_totals_index>();
    add_index< primary_index<simple_index<global_property_object          >> >();
    add_index< primary_index<simple_index<dynamic_global_property_object  >> >();
-   add_index< primary_index<account_statistics_index                      > >();
-   add_index< primary_index<voter_index                                   > >();
+   auto statistics_idx = add_index< primary_index<account_statistics_index > >();
+   statistics_idx->add_secondary_index<account_statistics_totals_index>();
+   _voter_proxy_index = add_index< primary_index<voter_index > >()->add_secondary_index<voter_proxy_index>();
    add_index< primary_index<registrar_takeover_index                      > >();
    add_index< primary_index<witness_vote_index                            > >();
    add_index< primary_index<platform_vote_index                           > >();
-   add_index< primary_index<score_index                                   > >();
+   auto score_idx = add_index< primary_index<score_index                  > >();
+   score_idx->add_secondary_index<post_score_totals_index>();
+   score_idx->add_secondary_index<score_create_time_count_index>();
    add_index< primary_index<license_index                                 > >();
    add_index< primary_index<advertising_index                             > >();
-   add_index< primary_index<advertising_order_index                       > >();
+   auto advertising_order_idx = add_index< primary_index<advertising_order_index > >();
+   advertising_order_idx->add_secondary_index<advertising_order_count_index>();
    add_index< primary_index<custom_vote_index                             > >();
    add_index< primary_index<cast_custom_vote_index                        > >();
-   add_index< primary_index<account_auth_platform_index                   > >();
+   add_index< primary_index<custom_vote_weight_index                      > >();
+   auto auth_platform_idx = add_index< primary_index<account_auth_platform_index > >();
+   auth_platform_idx->add_secondary_index<account_auth_platform_count_index>();
    add_index< primary_index<pledge_mining_index                           > >();
    add_index< primary_index<committee_member_vote_index                   > >();
    add_index< primary_index<csaf_lease_index                              > >();
-   add_index< primary_index<pledge_balance_index                          > >();
+   auto pledge_balance_idx = add_index< primary_index<pledge_balance_index > >();
+   pledge_balance_idx->add_secondary_index<pledge_balance_totals_index>();
+   pledge_balance_idx->add_secondary_index<pledge_release_queue_index>();
    add_index< primary_index<simple_index<asset_dynamic_data_object       >> >();
-   add_index< primary_index<flat_index<  block_summary_object            >> >();
+   _block_summary_index = add_index< primary_index<flat_index<  block_summary_object            >> >();
    add_index< primary_index<simple_index<chain_property_object          > > >();
    add_index< primary_index<simple_index<witness_schedule_object        > > >();
+   add_index< primary_index<simple_index<content_award_settlement_object > > >();
+   add_index< primary_index<platform_period_profit_index                  > >();
+   add_index< primary_index<platform_vote_profit_index                    > >();
+   add_index< primary_index<active_post_receiptor_index                   > >();
 }
 
 void database::init_genesis(const genesis_state_type& genesis_state)
@@ -303,6 +344,13 @@ void database::init_genesis(const genesis_state_type& genesis_state)
    } inhibitor(*this);
 
    transaction_evaluation_state genesis_eval_state(this);
+   // Nothing reports the operations of the genesis, so their records are dropped right away instead of keeping
+   // one of every initial account in memory
+   auto apply_genesis_operation = [&]( const operation& op ) -> operation_result {
+      operation_result result = apply_operation( genesis_eval_state, op );
+      clear_applied_operations();
+      return result;
+   };
 
    flat_index<block_summary_object>& bsi = get_mutable_index_type< flat_index<block_summary_object> >();
    bsi.resize(0xffff+1);
@@ -465,7 +513,7 @@ void database::init_genesis(const genesis_state_type& genesis_state)
          cop.memo_key = tmp_active_key;
       else
          cop.memo_key = account.memo_key;
-      account_id_type account_id(apply_operation(genesis_eval_state, cop).get<object_id_type>());
+      account_id_type account_id(apply_genesis_operation(cop).get<object_id_type>());
 
       modify( get( account_id ), [&account](account_object& a) {
          a.reg_info.registrar = account.registrar;
@@ -537,7 +585,7 @@ void database::init_genesis(const genesis_state_type& genesis_state)
       witness_create_operation op;
       op.account = get_account_uid(witness.owner_name);
       op.block_signing_key = witness.block_signing_key;
-      apply_operation(genesis_eval_state, op);
+      apply_genesis_operation(op);
    });
 
    // Create initial committee members
@@ -545,7 +593,7 @@ void database::init_genesis(const genesis_state_type& genesis_state)
                  [&](const genesis_state_type::initial_committee_member_type& member) {
       committee_member_create_operation op;
       op.account = get_account_uid(member.owner_name);
-      apply_operation(genesis_eval_state, op);
+      apply_genesis_operation(op);
    });
 
    // Create initial platforms
@@ -23,12 +23,17 @@
  */
 
 #include <graphene/chain/database.hpp>
+#include <graphene/chain/db_with.hpp>
 
 #include <graphene/chain/operation_history_object.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
 
+#include <graphene/utilities/thread_pool.hpp>
+
 #include <fc/io/fstream.hpp>
+#include <fc/io/raw.hpp>
 
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -43,6 +48,8 @@ database::database()
 
 database::~database()
 {
+   if( _invariants_check.valid() && !_invariants_check.ready() )
+      _invariants_check.cancel_and_wait( "database destroyed" );
    clear_pending();
 }
 
@@ -61,6 +68,11 @@ void database::reindex( fc::path data_dir )
    const auto last_block_num = last_block->block_num();
    uint32_t flush_point = last_block_num < 10000 ? 0 : last_block_num - 10000;
    uint32_t undo_point = last_block_num < 50 ? 0 : last_block_num - 50;
+   // the object archive takes the old values of the objects from the undo states of the blocks it is missing
+   if( _object_archive.is_open() )
+      undo_point = std::min( undo_point, _object_archive.last_block_num() + 1 );
+   const uint32_t replay_skip = replay_skip_flags;
+   block_read_ahead read_ahead( *this, _block_id_to_block, head_block_num() + 1, last_block_num, replay_skip );
 
    ilog( "Replaying blocks, starting at ${next}...", ("next",head_block_num() + 1) );
    if( head_block_num() >= undo_point )
@@ -76,10 +88,12 @@ void database::reindex( fc::path data_dir )
       if( i == flush_point )
       {
          ilog( "Writing database to disk at block ${i}", ("i",i) );
-         flush();
+         _post_contents.flush_until_block( head_block_num() );
+         flush_incremental();
          ilog( "Done" );
       }
-      fc::optional< signed_block > block = _block_id_to_block.fetch_by_number(i);
+      uint32_t skip = replay_skip;
+      fc::optional< signed_block > block = read_ahead.next( skip );
       if( !block.valid() )
       {
          wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
@@ -100,23 +114,11 @@ void database::reindex( fc::path data_dir )
          break;
       }
       if( i < undo_point )
-         apply_block(*block, skip_witness_signature |
-                             skip_transaction_signatures |
-                             skip_transaction_dupe_check |
-                             skip_tapos_check |
-                             skip_witness_schedule_check |
-                             skip_invariants_check |
-                             skip_authority_check);
+         apply_block(*block, skip);
       else
       {
          _undo_db.enable();
-         push_block(*block, skip_witness_signature |
-                            skip_transaction_signatures |
-                            skip_transaction_dupe_check |
-                            skip_tapos_check |
-                            skip_witness_schedule_check |
-                            skip_invariants_check |
-                            skip_authority_check);
+         push_block(*block, skip);
       }
    }
    _undo_db.enable();
@@ -124,13 +126,99 @@ void database::reindex( fc::path data_dir )
    ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
 
+const uint32_t database::replay_skip_flags;
+
+database::block_read_ahead::block_read_ahead( const database& db, const block_database& source,
+                                              uint32_t first, uint32_t last, uint32_t skip )
+   : _db( db ), _source( source ), _last( last ), _skip( skip ), _chain_id( db.get_chain_id() ),
+     _next_to_read( first ), _next_to_return( first )
+{
+   if( _db._thread_pool && _db._thread_pool->size() > 0 )
+      _max_read_ahead = _db._thread_pool->size() * GRAPHENE_REPLAY_READ_AHEAD_PER_THREAD;
+}
+
+database::block_read_ahead::~block_read_ahead()
+{
+   // the workers refer to this, to the database and to the source, they have to be done before any of them goes away,
+   // also when a block failed to apply and its exception unwinds the caller, so nothing may be thrown from here
+   for( auto& f : _read_ahead )
+   {
+      try {
+         f.wait();
+      } catch( ... ) {}
+   }
+}
+
+void database::block_read_ahead::fill()
+{
+   while( _read_ahead.size() < _max_read_ahead && _next_to_read <= _last )
+   {
+      auto id = std::make_shared<block_id_type>();
+      auto data = std::make_shared< vector<char> >();
+      if( !_source.fetch_raw_by_number( _next_to_read, *id, *data ) )
+         data.reset();
+      const database& db = _db;
+      const chain_id_type chain_id = _chain_id;
+      const uint32_t skip = _skip;
+      _read_ahead.emplace_back( _db._thread_pool->get_thread( _next_worker++ ).async( [&db,id,data,chain_id,skip]() -> decoded_block {
+         decoded_block result;
+         if( !data )
+            return result;
+         try {
+            result.block = fc::raw::unpack<signed_block>( *data );
+            if( result.block->id() != *id )
+               return decoded_block();
+            // if the merkle root doesn't match, leave it to apply_block() to report it
+            result.merkle_checked = ( result.block->transaction_merkle_root == result.block->calculate_merkle_root() );
+            for( const auto& trx : result.block->transactions )
+            {
+               if( db.need_authority_check( trx, skip ) )
+               {
+                  try {
+                     trx.signees = trx.get_signature_keys( chain_id );
+                  } catch( const fc::exception& ) {}
+               }
+            }
+         } catch( const fc::exception& ) {
+            // a block that can't be decoded is treated like a missing block, same as fetch_by_number()
+            return decoded_block();
+         }
+         return result;
+      }, "replay_decode" ) );
+      ++_next_to_read;
+   }
+}
+
+optional<signed_block> database::block_read_ahead::next( uint32_t& skip )
+{
+   if( _next_to_return > _last )
+      return optional<signed_block>();
+   const uint32_t block_num = _next_to_return++;
+   if( _max_read_ahead == 0 )
+      return _source.fetch_by_number( block_num );
+
+   fill();
+   // taken off the queue first, so that a failed decode isn't returned again
+   fc::future<decoded_block> pending = _read_ahead.front();
+   _read_ahead.pop_front();
+   decoded_block decoded = pending.wait();
+   if( decoded.merkle_checked )
+      skip |= skip_merkle_check;
+   return std::move( decoded.block );
+}
+
 void database::wipe(const fc::path& data_dir, bool include_blocks)
 {
    ilog("Wiping database", ("include_blocks", include_blocks));
    close();
    object_database::wipe(data_dir);
+   fc::remove_all( data_dir / "post_contents" );
    if( include_blocks )
+   {
       fc::remove_all( data_dir / "database" );
+      fc::remove_all( data_dir / "object_archive" );
+      fc::remove_all( data_dir / "applied_operations" );
+   }
 }
 
 void database::open(
@@ -140,6 +228,7 @@ void database::open(
 {
    try
    {
+      state_write_scope write_scope( *this );
       bool wipe_object_db = false;
       if( !fc::exists( data_dir / "db_version" ) )
          wipe_object_db = true;
@@ -158,13 +247,46 @@ void database::open(
           version_file.close();
       }
 
-      object_database::open(data_dir);
+      if( wipe_object_db )
+      {
+         fc::remove_all( data_dir / "post_contents" );
+         fc::remove_all( data_dir / "object_archive" );
+         fc::remove_all( data_dir / "applied_operations" );
+      }
+      object_database::open( data_dir, _thread_pool.get() );
+      _post_contents.open( data_dir / "post_contents" );
+      if( _object_archive_enabled )
+         _object_archive.open( data_dir / "object_archive" );
+      if( _applied_operations_log_enabled )
+         _applied_operations_log.open( data_dir / "applied_operations" );
+      _db_version = db_version;
+
+      if( _imported_snapshot.valid() )
+      {
+         FC_ASSERT( find(global_property_id_type()), "The imported state snapshot was not loaded" );
+         FC_ASSERT( head_block_id() == _imported_snapshot->head_block_id
+                    && get_chain_id() == _imported_snapshot->chain_id,
+                    "The loaded state doesn't match the imported state snapshot",
+                    ("head_block_id",head_block_id())("snapshot",*_imported_snapshot) );
+         ilog( "Loaded the state snapshot of block ${n}", ("n",head_block_num()) );
+         _imported_snapshot.reset();
+      }
 
       _block_id_to_block.open(data_dir / "database" / "block_num_to_block");
+      _fork_db.set_memory_limit( _fork_db_memory_limit, data_dir / "database" / "fork_db" );
 
       if( !find(global_property_id_type()) )
          init_genesis(genesis_loader());
 
+      if( _object_archive.is_open() && _object_archive.first_block_num() > 0 )
+         FC_ASSERT( _object_archive.last_block_num() >= head_block_num(),
+                    "The object archive stops at block ${a}, before the head block ${h}, replay the blockchain to fill it",
+                    ("a",_object_archive.last_block_num())("h",head_block_num()) );
+      if( _applied_operations_log.is_open() && _applied_operations_log.first_block_num() > 0 )
+         FC_ASSERT( _applied_operations_log.last_block_num() >= head_block_num(),
+                    "The applied operations log stops at block ${a}, before the head block ${h}, replay the blockchain to fill it",
+                    ("a",_applied_operations_log.last_block_num())("h",head_block_num()) );
+
       fc::optional<block_id_type> last_block = _block_id_to_block.last_id();
       if( last_block.valid() )
       {
@@ -173,15 +295,205 @@ void database::open(
                     ("last_block->id", last_block)("head_block_id",head_block_num()) );
          reindex( data_dir );
       }
+
+      // after the replay, which put the head branch back into the fork database
+      if( fc::exists( saved_forks_file() ) )
+      {
+         try
+         {
+            const uint32_t loaded = _fork_db.load_forks( saved_forks_file() );
+            if( loaded > 0 )
+               ilog( "Loaded ${n} blocks of other forks", ("n",loaded) );
+         }
+         catch ( const fc::exception& e )
+         {
+            wlog( "Unable to load the blocks of other forks: ${e}", ("e", e) );
+            fc::remove( saved_forks_file() );
+         }
+      }
    }
    FC_CAPTURE_LOG_AND_RETHROW( (data_dir) )
 }
 
+namespace {
+   fc::path state_snapshot_file_path( const fc::path& dir, const state_snapshot_file& f )
+   {
+      return dir / fc::to_string( uint64_t(f.space) ) / fc::to_string( uint64_t(f.type) );
+   }
+
+   fc::sha256 checksum_file( const fc::path& file )
+   {
+      std::ifstream in( file.generic_string(), std::ios::in | std::ios::binary );
+      FC_ASSERT( in, "Unable to read ${f}", ("f",file) );
+      fc::sha256::encoder enc;
+      std::vector<char> buffer( 1024 * 1024 );
+      while( in )
+      {
+         in.read( buffer.data(), buffer.size() );
+         if( in.gcount() > 0 )
+            enc.write( buffer.data(), in.gcount() );
+      }
+      return enc.result();
+   }
+
+   /// calls f(i) for every i in [0, count), on the threads of pool if there are any
+   template<typename Functor>
+   void for_each_snapshot_file( graphene::utilities::thread_pool* pool, size_t count, Functor&& f )
+   {
+      if( pool && pool->size() > 0 )
+         pool->parallel_for( count, f );
+      else
+      {
+         for( size_t i = 0; i < count; ++i )
+            f( i );
+      }
+   }
+}
+
+void database::export_state_snapshot( const fc::path& dir )
+{ try {
+   FC_ASSERT( !fc::exists( dir ), "${d} already exists", ("d",dir) );
+   state_write_scope write_scope( *this );
+   detail::without_pending_transactions( *this, std::move(_pending_tx), std::move(_pending_tx_authorities),
+                                         std::move(_pending_tx_received),
+   [&]()
+   {
+      state_snapshot_manifest manifest;
+      manifest.db_version = _db_version;
+      manifest.chain_id = get_chain_id();
+      manifest.head_block_id = head_block_id();
+      for( const auto& ids : registered_indexes() )
+      {
+         state_snapshot_file f;
+         f.space = ids.first;
+         f.type = ids.second;
+         manifest.files.push_back( f );
+         fc::create_directories( state_snapshot_file_path( dir, f ).parent_path() );
+      }
+
+      // indexes don't share any state while saving, so each one can be saved on its own thread
+      for_each_snapshot_file( _thread_pool.get(), manifest.files.size(), [&]( size_t i )
+      {
+         state_snapshot_file& f = manifest.files[i];
+         const fc::path file = state_snapshot_file_path( dir, f );
+         get_mutable_index( f.space, f.type ).save( file );
+         f.size = fc::file_size( file );
+         f.checksum = checksum_file( file );
+      } );
+
+      // the post content store is only appended to, once the values of the blocks up to the head are written a
+      // copy of the file holds every value referenced
+      _post_contents.flush_until_block( head_block_num() );
+      fc::copy( _post_contents.filename(), dir / "post_contents" );
+      manifest.post_contents_size = fc::file_size( dir / "post_contents" );
+      manifest.post_contents_checksum = checksum_file( dir / "post_contents" );
+
+      // the manifest is written last, a snapshot without one is incomplete
+      std::ofstream out( ( dir / "manifest" ).generic_string().c_str(),
+                         std::ios::out | std::ios::binary | std::ios::trunc );
+      FC_ASSERT( out, "Unable to write the manifest of the state snapshot" );
+      fc::raw::pack( out, manifest );
+      out.close();
+      ilog( "Exported the state snapshot of block ${n} to ${d}", ("n",head_block_num())("d",dir) );
+   } );
+} FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+void database::import_state_snapshot( const fc::path& snapshot_dir, const fc::path& data_dir,
+                                      const std::string& db_version )
+{ try {
+   FC_ASSERT( fc::exists( snapshot_dir / "manifest" ), "${d} doesn't contain a complete state snapshot",
+              ("d",snapshot_dir) );
+   std::string packed_manifest;
+   fc::read_file_contents( snapshot_dir / "manifest", packed_manifest );
+   const auto manifest = fc::raw::unpack<state_snapshot_manifest>(
+                            std::vector<char>( packed_manifest.begin(), packed_manifest.end() ) );
+   FC_ASSERT( manifest.version == GRAPHENE_STATE_SNAPSHOT_VERSION, "Unsupported state snapshot version ${v}",
+              ("v",manifest.version) );
+   FC_ASSERT( manifest.db_version == db_version, "The state snapshot was written by database version ${s}, not ${v}",
+              ("s",manifest.db_version)("v",db_version) );
+
+   ilog( "Importing the state snapshot in ${d}", ("d",snapshot_dir) );
+   // the files are checked as copied, so that the copies are known to be good
+   const fc::path tmp_dir = data_dir / "object_database.tmp";
+   fc::remove_all( tmp_dir );
+   for( const auto& f : manifest.files )
+      fc::create_directories( state_snapshot_file_path( tmp_dir, f ).parent_path() );
+   for_each_snapshot_file( _thread_pool.get(), manifest.files.size(), [&]( size_t i )
+   {
+      const state_snapshot_file& f = manifest.files[i];
+      const fc::path file = state_snapshot_file_path( tmp_dir, f );
+      fc::copy( state_snapshot_file_path( snapshot_dir, f ), file );
+      FC_ASSERT( fc::file_size( file ) == f.size && checksum_file( file ) == f.checksum,
+                 "Corrupt state snapshot file ${f}", ("f",state_snapshot_file_path( snapshot_dir, f )) );
+   } );
+
+   const fc::path tmp_contents = data_dir / "post_contents.tmp";
+   fc::remove( tmp_contents );
+   fc::copy( snapshot_dir / "post_contents", tmp_contents );
+   FC_ASSERT( fc::file_size( tmp_contents ) == manifest.post_contents_size
+              && checksum_file( tmp_contents ) == manifest.post_contents_checksum,
+              "Corrupt state snapshot file ${f}", ("f",snapshot_dir / "post_contents") );
+
+   fc::remove_all( data_dir / "object_database" );
+   fc::remove_all( data_dir / "database" );
+   fc::remove_all( data_dir / "post_contents" );
+   // the blocks before the snapshot aren't there anymore, the archive and the log start again after it
+   fc::remove_all( data_dir / "object_archive" );
+   fc::remove_all( data_dir / "applied_operations" );
+   fc::rename( tmp_dir, data_dir / "object_database" );
+   fc::create_directories( data_dir / "post_contents" );
+   fc::rename( tmp_contents, data_dir / "post_contents" / "contents" );
+   std::ofstream version_file( (data_dir / "db_version").generic_string().c_str(),
+                               std::ios::out | std::ios::binary | std::ios::trunc );
+   version_file.write( db_version.c_str(), db_version.size() );
+   version_file.close();
+
+   _imported_snapshot = manifest;
+} FC_CAPTURE_AND_RETHROW( (snapshot_dir)(data_dir) ) }
+
+void database::log_index_memory_stats()const
+{
+   const auto stats = get_index_memory_stats();
+   uint64_t total_bytes = 0;
+   for( const auto& s : stats )
+      total_bytes += s.total_bytes;
+   ilog( "Index memory: ${b} bytes in ${n} indexes", ("b",total_bytes)("n",stats.size()) );
+   for( const auto& s : stats )
+      ilog( "  ${t}: ${c} objects, ${o} object bytes, ${d} dynamic bytes, ${k} container bytes",
+            ("t",s.object_type)("c",s.object_count)("o",s.object_bytes)("d",s.dynamic_bytes)("k",s.container_bytes) );
+}
+
+fc::path database::saved_forks_file()const
+{
+   return get_data_dir() / "database" / "fork_db_forks";
+}
+
 void database::close(bool rewind)
 {
+   state_write_scope write_scope( *this );
    // TODO:  Save pending tx's on close()
    clear_pending();
 
+   if( _invariants_check.valid() && !_invariants_check.ready() )
+      _invariants_check.cancel_and_wait( "database closed" );
+
+   // the blocks of the other forks aren't in the block database, they are kept for the next start before the head
+   // branch is popped from the fork database
+   if( _block_id_to_block.is_open() && !_fork_db_behind_head && _fork_db.head() )
+   {
+      try
+      {
+         const uint32_t saved = _fork_db.save_forks( saved_forks_file(),
+                                                     get_dynamic_global_properties().last_irreversible_block_num );
+         if( saved > 0 )
+            ilog( "Saved ${n} blocks of other forks", ("n",saved) );
+      }
+      catch ( const fc::exception& e )
+      {
+         wlog( "Unable to save the blocks of other forks: ${e}", ("e", e) );
+      }
+   }
+
    // pop all of the blocks that we can given our undo history, this should
    // throw when there is no more undo history to pop
    if( rewind )
@@ -209,13 +521,31 @@ void database::close(bool rewind)
    // DB state (issue #336).
    clear_pending();
 
-   object_database::flush();
+   if( _log_index_memory_on_close )
+      log_index_memory_stats();
+
+   // the values are written out before the objects referencing them
+   _post_contents.flush_until_block( head_block_num() );
+   object_database::flush_incremental();
    object_database::close();
+   _post_contents.close();
+   // like the objects, the archive is kept as of the head block left after the rewind
+   if( _object_archive.is_open() )
+   {
+      _object_archive.flush_until_block( head_block_num() );
+      _object_archive.close();
+   }
+   if( _applied_operations_log.is_open() )
+   {
+      _applied_operations_log.flush_until_block( head_block_num() );
+      _applied_operations_log.close();
+   }
 
    if( _block_id_to_block.is_open() )
       _block_id_to_block.close();
 
    _fork_db.reset();
+   _fork_db_behind_head = false;
 }
 
 } }
@@ -80,7 +80,7 @@ void database::cancel_limit_order( const limit_order_object& order, bool create_
    adjust_balance(order.seller, refunded);
 
    if( create_virtual_op )
-      push_applied_operation( vop );
+      push_applied_operation( std::move( vop ) );
 
    remove(order);
 }
@@ -160,15 +160,21 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
 
    bool finished = false; // whether the new order is gone
 
+   // the assets and the taker are the same in every fill
+   order_match_context context( *this, new_order_object, true );
+
    // still need to check limit orders
    while (!finished && limit_itr != limit_end)
    {
       auto old_limit_itr = limit_itr;
       ++limit_itr;
       // match returns 2 when only the old order was fully filled. In this case, we keep matching; otherwise, we stop.
-      finished = ( match( new_order_object, *old_limit_itr, old_limit_itr->sell_price ) != 2 );
+      finished = ( match( new_order_object, *old_limit_itr, old_limit_itr->sell_price, context ) != 2 );
    }
 
+   if( context.taker_proceeds.amount > 0 )
+      adjust_balance( context.taker_seller.uid, context.taker_proceeds );
+
    const limit_order_object* updated_order_object = find< limit_order_object >( order_id );
    if( updated_order_object == nullptr )
       return true;
@@ -187,6 +193,28 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
  *  3 - both were filled
  */
 int database::match( const limit_order_object& usd, const limit_order_object& core, const price& match_price )
+{
+   order_match_context context( *this, usd, false );
+   return match( usd, core, match_price, context );
+}
+
+database::order_match_context::order_match_context( database& db, const limit_order_object& taker, bool defer_proceeds )
+   : taker_seller( db.get_account_by_uid( taker.seller ) ),
+     taker_receive_asset( db.get_asset_by_aid( taker.receive_asset_id() ) ),
+     maker_receive_asset( db.get_asset_by_aid( taker.sell_asset_id() ) ),
+     defer_taker_proceeds( false ),
+     taker_proceeds( 0, taker.receive_asset_id() )
+{
+   if( defer_proceeds && taker.receive_asset_id() != GRAPHENE_CORE_ASSET_AID )
+   {
+      const auto& balances = db.get_index_type<account_balance_index>().indices().get<by_account_asset>();
+      defer_taker_proceeds = ( balances.find( boost::make_tuple( taker.seller, taker.receive_asset_id() ) )
+                               != balances.end() );
+   }
+}
+
+int database::match( const limit_order_object& usd, const limit_order_object& core, const price& match_price,
+                     order_match_context& context )
 {
    FC_ASSERT( usd.sell_price.quote.asset_id == core.sell_price.base.asset_id );
    FC_ASSERT( usd.sell_price.base.asset_id  == core.sell_price.quote.asset_id );
@@ -230,25 +258,43 @@ int database::match( const limit_order_object& usd, const limit_order_object& co
    usd_pays  = core_receives;
 
    int result = 0;
-   result |= fill_limit_order( usd, usd_pays, usd_receives, cull_taker, match_price, false ); // the first param is taker
-   result |= fill_limit_order( core, core_pays, core_receives, true, match_price, true ) << 1; // the second param is maker
+   // the first param is taker
+   result |= fill_limit_order( usd, usd_pays, usd_receives, cull_taker, match_price, false,
+                               context.taker_seller, context.taker_receive_asset,
+                               context.defer_taker_proceeds ? &context.taker_proceeds : nullptr );
+   // the second param is maker
+   result |= fill_limit_order( core, core_pays, core_receives, true, match_price, true,
+                               get_account_by_uid( core.seller ), context.maker_receive_asset, nullptr ) << 1;
    FC_ASSERT( result != 0 );
    return result;
 }
 
 bool database::fill_limit_order( const limit_order_object& order, const asset& pays, const asset& receives, bool cull_if_small,
                            const price& fill_price, const bool is_maker )
+{
+   return fill_limit_order( order, pays, receives, cull_if_small, fill_price, is_maker,
+                            get_account_by_uid( order.seller ), get_asset_by_aid( receives.asset_id ), nullptr );
+}
+
+bool database::fill_limit_order( const limit_order_object& order, const asset& pays, const asset& receives, bool cull_if_small,
+                           const price& fill_price, const bool is_maker, const account_object& seller,
+                           const asset_object& recv_asset, asset* deferred_receives )
 { try {
     cull_if_small |= false;
 
    FC_ASSERT( order.amount_for_sale().asset_id == pays.asset_id );
    FC_ASSERT( pays.asset_id != receives.asset_id );
-
-   const account_object& seller = get_account_by_uid(order.seller);
-   const asset_object& recv_asset = get_asset_by_aid(receives.asset_id);
+   assert( seller.uid == order.seller && recv_asset.asset_id == receives.asset_id );
 
    auto issuer_fees = pay_market_fees(seller, recv_asset, receives);
-   pay_order( seller, receives - issuer_fees, pays );
+   if( deferred_receives != nullptr )
+   {
+      // the core in orders and the votes still change fill by fill, adjust_balance() skips a zero amount
+      *deferred_receives += receives - issuer_fees;
+      pay_order( seller, recv_asset.amount(0), pays );
+   }
+   else
+      pay_order( seller, receives - issuer_fees, pays );
 
    assert( pays.asset_id != receives.asset_id );
    push_applied_operation( fill_order_operation( order.id, order.seller, pays, receives, issuer_fees, fill_price, is_maker ) );
@@ -425,6 +425,24 @@ void transaction_get_impacted_account_uids( const transaction& tx, flat_set<acco
       operation_get_impacted_account_uids( op, result );
 }
 
+void operation_history_get_impacted_account_uids( const operation_history_object& op, flat_set<account_uid_type>& result )
+{
+   vector<authority> other;
+   operation_get_required_uid_authorities( op.op, result, result, result, other, true );
+
+   operation_get_impacted_account_uids( op.op, result );
+
+   for( const auto& a : other )
+      for( const auto& item : a.account_uid_auths )
+         result.insert( item.first.uid );
+
+   if( op.result.which() == operation_result::tag<advertising_confirm_result>::value )
+   {
+      for( const auto& r : op.result.get<advertising_confirm_result>() )
+         result.insert( r.first );
+   }
+}
+
 void get_relevant_accounts( const object* obj, flat_set<account_uid_type>& accounts )
 {
    if( obj->id.space() == protocol_ids )
@@ -555,12 +573,10 @@ void get_relevant_accounts( const object* obj, flat_set<account_uid_type>& accou
                accounts.insert( aobj->from );
                accounts.insert( aobj->to );
                break;
-           } case impl_transaction_object_type:{
-              const auto& aobj = dynamic_cast<const transaction_object*>(obj);
-              assert( aobj != nullptr );
-              transaction_get_impacted_account_uids( aobj->trx, accounts );
+           } case impl_transaction_object_type:
+              // the accounts of the transaction are notified through its operations
               break;
-           } case impl_block_summary_object_type:
+             case impl_block_summary_object_type:
               break;
              case impl_account_transaction_history_object_type:
               break;
@@ -572,62 +588,104 @@ void get_relevant_accounts( const object* obj, flat_set<account_uid_type>& accou
               break;
              case impl_pledge_balance_object_type:
               break;
+             case impl_content_award_settlement_object_type:
+              break;
+             case impl_platform_period_profit_object_type:
+              break;
+             case impl_platform_vote_profit_object_type:
+              break;
+             case impl_custom_vote_weight_object_type:
+              break;
+             case impl_active_post_receiptor_object_type:
+              break;
+      }
+   }
+}
+
+const flat_set<account_uid_type>& object_change_log::new_accounts_impacted()const
+{
+   if( !_new_accounts_impacted.valid() )
+   {
+      _new_accounts_impacted = flat_set<account_uid_type>();
+      for( const auto& id : new_ids )
+      {
+         auto obj = _db.find_object( id );
+         if( obj != nullptr )
+            get_relevant_accounts( obj, *_new_accounts_impacted );
       }
    }
+   return *_new_accounts_impacted;
+}
+
+const flat_set<account_uid_type>& object_change_log::changed_accounts_impacted()const
+{
+   if( !_changed_accounts_impacted.valid() )
+   {
+      _changed_accounts_impacted = flat_set<account_uid_type>();
+      for( const auto obj : changed_old_values )
+         get_relevant_accounts( obj, *_changed_accounts_impacted );
+   }
+   return *_changed_accounts_impacted;
+}
+
+const flat_set<account_uid_type>& object_change_log::removed_accounts_impacted()const
+{
+   if( !_removed_accounts_impacted.valid() )
+   {
+      _removed_accounts_impacted = flat_set<account_uid_type>();
+      for( const auto obj : removed_objects )
+         get_relevant_accounts( obj, *_removed_accounts_impacted );
+   }
+   return *_removed_accounts_impacted;
 }
 
 void database::notify_changed_objects()
 { try {
    if( _undo_db.enabled() )
    {
+      if( new_objects.empty() && changed_objects.empty() && removed_objects.empty() && block_objects_changed.empty() )
+         return;
+
       const auto& head_undo = _undo_db.head();
 
-      // New
-      if( !new_objects.empty() )
+      object_change_log changes( *this );
+      changes.new_ids.reserve( head_undo.new_ids.size() );
+      for( const auto& item : head_undo.new_ids )
+        changes.new_ids.push_back( item );
+      // the objects of append-only indexes are only known by the next id the index had
+      const vector<object_id_type> appended_ids = _undo_db.appended_ids( head_undo );
+      changes.new_ids.insert( changes.new_ids.end(), appended_ids.begin(), appended_ids.end() );
+
+      changes.changed_ids.reserve( head_undo.old_values.size() + head_undo.old_deltas.size() );
+      changes.changed_old_values.reserve( head_undo.old_values.size() + head_undo.old_deltas.size() );
+      for( const auto& item : head_undo.old_values )
       {
-        vector<object_id_type> new_ids;  new_ids.reserve(head_undo.new_ids.size());
-        flat_set<account_uid_type> new_accounts_impacted;
-        for( const auto& item : head_undo.new_ids )
-        {
-          new_ids.push_back(item);
-          auto obj = find_object(item);
-          if(obj != nullptr)
-            get_relevant_accounts(obj, new_accounts_impacted);
-        }
-
-        new_objects(new_ids, new_accounts_impacted);
+        changes.changed_ids.push_back( item.first );
+        changes.changed_old_values.push_back( item.second.get() );
       }
-
-      // Changed
-      if( !changed_objects.empty() )
+      // the fields of a delta don't name accounts, so the current value has the same accounts as the old one
+      for( const auto& item : head_undo.old_deltas )
       {
-        vector<object_id_type> changed_ids;  changed_ids.reserve(head_undo.old_values.size());
-        flat_set<account_uid_type> changed_accounts_impacted;
-        for( const auto& item : head_undo.old_values )
-        {
-          changed_ids.push_back(item.first);
-          get_relevant_accounts(item.second.get(), changed_accounts_impacted);
-        }
-
-        changed_objects(changed_ids, changed_accounts_impacted);
+        changes.changed_ids.push_back( item.first );
+        changes.changed_old_values.push_back( &get_object( item.first ) );
       }
 
-      // Removed
-      if( !removed_objects.empty() )
+      changes.removed_ids.reserve( head_undo.removed.size() );
+      changes.removed_objects.reserve( head_undo.removed.size() );
+      for( const auto& item : head_undo.removed )
       {
-        vector<object_id_type> removed_ids; removed_ids.reserve( head_undo.removed.size() );
-        vector<const object*> removed; removed.reserve( head_undo.removed.size() );
-        flat_set<account_uid_type> removed_accounts_impacted;
-        for( const auto& item : head_undo.removed )
-        {
-          removed_ids.emplace_back( item.first );
-          auto obj = item.second.get();
-          removed.emplace_back( obj );
-          get_relevant_accounts(obj, removed_accounts_impacted);
-        }
-
-        removed_objects(removed_ids, removed, removed_accounts_impacted);
+        changes.removed_ids.push_back( item.first );
+        changes.removed_objects.push_back( item.second.get() );
       }
+
+      block_objects_changed( changes );
+
+      if( !new_objects.empty() )
+        new_objects( changes.new_ids, changes.new_accounts_impacted() );
+      if( !changed_objects.empty() )
+        changed_objects( changes.changed_ids, changes.changed_accounts_impacted() );
+      if( !removed_objects.empty() )
+        removed_objects( changes.removed_ids, changes.removed_objects, changes.removed_accounts_impacted() );
    }
 } FC_CAPTURE_AND_LOG( (0) ) }
 
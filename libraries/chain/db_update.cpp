@@ -28,16 +28,22 @@
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/global_property_object.hpp>
 #include <graphene/chain/hardfork.hpp>
+#include <graphene/chain/object_counts.hpp>
 #include <graphene/chain/proposal_object.hpp>
 #include <graphene/chain/transaction_object.hpp>
 #include <graphene/chain/witness_object.hpp>
 #include <graphene/chain/advertising_object.hpp>
+#include <graphene/chain/supply_totals.hpp>
 
 #include <graphene/chain/protocol/fee_schedule.hpp>
 
+#include <graphene/utilities/thread_pool.hpp>
+
 #include <fc/uint128.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
 
+#include <unordered_map>
+
 namespace graphene { namespace chain {
 
 void database::update_global_dynamic_data( const signed_block& b )
@@ -52,25 +58,32 @@ void database::update_global_dynamic_data( const signed_block& b )
    
    //skip miss block when uint test
    if(!(get_node_properties().skip_flags&skip_uint_test))
+   {
+      // a witness may miss several of the slots, it is modified once with the count
+      flat_map< account_uid_type, uint32_t > missed_by_witness;
       for( uint32_t i = 0; i < missed_blocks; ++i ) {
-         const auto& witness_missed = get_witness_by_uid( get_scheduled_witness( i+1 ) );
-         if(  witness_missed.account != b.witness ) {
-            /*
-            const auto& witness_account = witness_missed.account(*this);
-            if( (fc::time_point::now() - b.timestamp) < fc::seconds(30) )
-               wlog( "Witness ${name} missed block ${n} around ${t}", ("name",witness_account.name)("n",b.block_num())("t",b.timestamp) );
-               */
-
-            modify( witness_missed, [&]( witness_object& w ) {
-              w.total_missed++;
-              if( w.last_confirmed_block_num + gpo.parameters.max_witness_inactive_blocks < b.block_num() )
-                 w.signing_key = public_key_type();
-            });
-            modify(get_account_statistics_by_uid(witness_missed.account), [&](_account_statistics_object& s) {
-              s.witness_total_missed++;
-            });
-         }
+         const account_uid_type witness_missed = get_scheduled_witness( i+1 );
+         if(  witness_missed != b.witness )
+            ++missed_by_witness[ witness_missed ];
+      }
+      for( const auto& missed : missed_by_witness ) {
+         /*
+         const auto& witness_account = witness_missed.account(*this);
+         if( (fc::time_point::now() - b.timestamp) < fc::seconds(30) )
+            wlog( "Witness ${name} missed block ${n} around ${t}", ("name",witness_account.name)("n",b.block_num())("t",b.timestamp) );
+            */
+
+         const auto& witness_missed = get_witness_by_uid( missed.first );
+         modify( witness_missed, [&]( witness_object& w ) {
+           w.total_missed += missed.second;
+           if( w.last_confirmed_block_num + gpo.parameters.max_witness_inactive_blocks < b.block_num() )
+              w.signing_key = public_key_type();
+         });
+         modify(get_account_statistics_by_uid(witness_missed.account), [&](_account_statistics_object& s) {
+           s.witness_total_missed += missed.second;
+         });
       }
+   }
 
    // dynamic global properties updating
    modify( _dgp, [&]( dynamic_global_property_object& dgp ){
@@ -113,6 +126,20 @@ void database::update_undo_db_size()
    _fork_db.set_max_size( _dgp.head_block_number - _dgp.last_irreversible_block_num + 1 );
 }
 
+void database::set_post_content( const string& value, string& field, optional<content_ref>& ref )
+{
+   if( value.size() <= GRAPHENE_POST_CONTENT_INLINE_MAX || !_post_contents.is_open() )
+   {
+      field = value;
+      ref.reset();
+   }
+   else
+   {
+      field.clear();
+      ref = _post_contents.put( value, _applying_block_num );
+   }
+}
+
 void database::update_signing_witness(const witness_object& signing_witness, const signed_block& new_block)
 {
    const global_property_object& gpo = get_global_properties();
@@ -149,7 +176,7 @@ void database::update_signing_witness(const witness_object& signing_witness, con
 
    if( budget_remained > 0 )
    {
-      modify( dpo, [&]( dynamic_global_property_object& _dpo )
+      modify_dynamic_global_properties( [&]( dynamic_global_property_object& _dpo )
       {
          _dpo.budget_pool += budget_remained;
       } );
@@ -246,7 +273,7 @@ void database::update_last_irreversible_block()
 
    if( new_last_irreversible_block_num > dpo.last_irreversible_block_num )
    {
-      modify( dpo, [&]( dynamic_global_property_object& _dpo )
+      modify_dynamic_global_properties( [&]( dynamic_global_property_object& _dpo )
       {
          _dpo.last_irreversible_block_num = new_last_irreversible_block_num;
       } );
@@ -257,10 +284,10 @@ void database::clear_expired_transactions()
 { try {
    //Look for expired transactions in the deduplication list, and remove them.
    //Transactions must have expired by at least two forking windows in order to be removed.
-   auto& transaction_idx = static_cast<transaction_index&>(get_mutable_index(implementation_ids, impl_transaction_object_type));
-   const auto& dedupe_index = transaction_idx.indices().get<by_expiration>();
-   while( (!dedupe_index.empty()) && (head_block_time() > dedupe_index.begin()->trx.expiration) )
-      transaction_idx.remove(*dedupe_index.begin());
+   const auto& dedupe_index = get_index_type<transaction_index>().indices().get<by_expiration>();
+   _cleanup_counts.expired_transactions += remove_range<transaction_index, by_expiration>(
+         dedupe_index.begin(), dedupe_index.lower_bound( head_block_time() ) );
+   _recent_transactions.remove_expired(head_block_time());
 } FC_CAPTURE_AND_RETHROW() }
 
 void database::clear_expired_proposals()
@@ -269,6 +296,7 @@ void database::clear_expired_proposals()
    while( !proposal_expiration_index.empty() && proposal_expiration_index.begin()->expiration_time <= head_block_time() )
    {
       const proposal_object& proposal = *proposal_expiration_index.begin();
+      ++_cleanup_counts.expired_proposals;
       processed_transaction result;
       try {
          auto value = proposal.is_authorized_to_execute(*this);
@@ -292,11 +320,21 @@ void database::clear_active_post()
    if (dpo.current_active_post_sequence <= _latest_active_post_periods)
       return;
 
+   uint64_t first_kept_period = dpo.current_active_post_sequence - _latest_active_post_periods + 1;
+   // the posts of a period that is still being settled are kept until it is settled
+   const auto* settlement = find(content_award_settlement_id_type());
+   if (settlement != nullptr && settlement->is_settling())
+      first_kept_period = std::min(first_kept_period, settlement->period_sequence);
+
    const auto& apt_idx = get_index_type<active_post_index>().indices().get<by_period_sequence>();
-   const auto& apt_end = apt_idx.lower_bound(dpo.current_active_post_sequence - _latest_active_post_periods + 1);
+   const auto& apt_end = apt_idx.lower_bound(first_kept_period);
+   const auto& receiptor_idx = get_index_type<active_post_receiptor_index>().indices().get<by_active_post_receiptor>();
    auto apt_itr = apt_idx.begin();
    while (apt_itr != apt_end)
    {
+      auto receiptor_itr = receiptor_idx.lower_bound(std::make_tuple(apt_itr->get_id()));
+      while (receiptor_itr != receiptor_idx.end() && receiptor_itr->active_post == apt_itr->get_id())
+         remove(*receiptor_itr++);
       remove(*apt_itr);
       apt_itr = apt_idx.begin();
    }
@@ -304,63 +342,67 @@ void database::clear_active_post()
 
 void database::clear_unnecessary_objects()
 {
+   // From HARDFORK_0_6_TIME at most GRAPHENE_MAX_UNNECESSARY_OBJECTS_REMOVED_PER_BLOCK objects are removed per block,
+   // and every block removes the expired objects instead of every tenth one, so a pass which reached the limit goes
+   // on in the next block. Whether there is work left is only told by the indexes: the objects are removed in index
+   // order, and a custom vote is only removed after its cast votes.
    const auto block_time = head_block_time();
-   switch (head_block_num() % 10) {
-   case 0: 
+   const bool budgeted = block_time >= HARDFORK_0_6_TIME;
+   const uint32_t max_removed = budgeted ? GRAPHENE_MAX_UNNECESSARY_OBJECTS_REMOVED_PER_BLOCK : uint32_t(-1);
+   uint32_t removed = 0;
+
+   if ((budgeted || head_block_num() % 10 == 0) && block_time >= time_point_sec(_advertising_order_remaining_time))
    {
-      if (block_time < time_point_sec(_advertising_order_remaining_time))
-         break;
       const auto& ado_idx = get_index_type<advertising_order_index>().indices().get<by_clear_time>();
       const auto& ado_end = ado_idx.lower_bound(block_time - _advertising_order_remaining_time);
       auto ado_itr = ado_idx.begin();
 
-      while (ado_itr != ado_end) {
+      while (ado_itr != ado_end && removed < max_removed) {
          remove(*ado_itr);
+         ++removed;
+         ++_cleanup_counts.advertising_orders;
          ado_itr = ado_idx.begin();
       }
-      break;
    }
-   case 3:
+
+   if ((budgeted || head_block_num() % 10 == 3) && block_time >= time_point_sec(_custom_vote_remaining_time))
    {
-      if (block_time < time_point_sec(_custom_vote_remaining_time))
-         break;
       const auto& custom_vote_idx = get_index_type<custom_vote_index>().indices().get<by_expired_time>();
       const auto& custom_vote_end = custom_vote_idx.lower_bound(block_time - _custom_vote_remaining_time);
+      const auto& cast_vote_idx = get_index_type<cast_custom_vote_index>().indices().get<by_custom_vote_vid>();
       auto custom_vote_itr = custom_vote_idx.begin();
 
-      while (custom_vote_itr != custom_vote_end) {
-         const auto& cast_vote_idx = get_index_type<cast_custom_vote_index>().indices().get<by_custom_vote_vid>();
-         auto cast_vote_itr = cast_vote_idx.lower_bound(std::make_tuple(custom_vote_itr->custom_vote_creator, custom_vote_itr->vote_vid));
+      while (custom_vote_itr != custom_vote_end && removed < max_removed) {
+         // the cast votes go first, so the custom vote left for the next block still leads to the rest of them
+         const auto cast_vote_key = std::make_tuple(custom_vote_itr->custom_vote_creator, custom_vote_itr->vote_vid);
+         auto cast_vote_itr = cast_vote_idx.lower_bound(cast_vote_key);
+         const auto cast_vote_end = cast_vote_idx.upper_bound(cast_vote_key);
 
-         while (cast_vote_itr != cast_vote_idx.end() && cast_vote_itr->custom_vote_creator == custom_vote_itr->custom_vote_creator &&
-            cast_vote_itr->custom_vote_vid == custom_vote_itr->vote_vid) {
-            auto del = cast_vote_itr;
-            ++cast_vote_itr;
-            remove(*del);    
-         } 
+         auto cast_vote_last = cast_vote_itr;
+         while (cast_vote_last != cast_vote_end && removed < max_removed) {
+            ++cast_vote_last;
+            ++removed;
+         }
+         const bool cast_votes_left = cast_vote_last != cast_vote_end;
+         _cleanup_counts.cast_custom_votes += remove_range<cast_custom_vote_index, by_custom_vote_vid>(cast_vote_itr, cast_vote_last);
+         if (cast_votes_left || removed >= max_removed)
+            break;
 
          remove(*custom_vote_itr);
+         ++removed;
+         ++_cleanup_counts.custom_votes;
          custom_vote_itr = custom_vote_idx.begin();
       }
-      break;
-   }
-   default:
-      break;
    }
-
 }
 
 void database::update_reduce_witness_csaf()
 {
-    const uint64_t csaf_window = get_global_properties().parameters.csaf_accumulate_window;
     const auto& witness_idx = get_index_type<witness_index>().indices();
+    coin_seconds_batch batch;
     for (auto itr = witness_idx.begin(); itr != witness_idx.end(); ++itr)
-    {
-        const _account_statistics_object& statistics_obj = get_account_statistics_by_uid(itr->account);
-        modify(statistics_obj, [&](_account_statistics_object& s) {
-            s.update_coin_seconds_earned(csaf_window, head_block_time(), *this, ENABLE_HEAD_FORK_NONE);
-        });
-    }
+        batch.add(get_account_statistics_by_uid(itr->account), *this, ENABLE_HEAD_FORK_NONE);
+    update_coin_seconds_earned(batch);
 }
 
 void database::update_account_permission()
@@ -401,15 +443,11 @@ void database::update_core_asset_flags()
 
 void database::update_account_feepoint()
 {
-   const uint64_t csaf_window = get_global_properties().parameters.csaf_accumulate_window;
    const auto& account_idx = get_index_type<account_statistics_index>().indices();
-   const dynamic_global_property_object& dpo = get_dynamic_global_properties();
+   coin_seconds_batch batch;
    for (auto itr = account_idx.begin(); itr != account_idx.end(); ++itr)
-   {
-      modify(*itr, [&](_account_statistics_object& s) {
-         s.update_coin_seconds_earned(csaf_window, head_block_time(), *this, ENABLE_HEAD_FORK_04);
-      });
-   }
+      batch.add(*itr, *this, ENABLE_HEAD_FORK_04);
+   update_coin_seconds_earned(batch);
 }
 
 std::tuple<set<std::tuple<score_id_type, share_type, bool>>, share_type>
@@ -435,6 +473,8 @@ database::get_effective_csaf(const active_post_object& active_post)
    
    set<std::tuple<score_id_type, share_type, bool>> effective_csaf_container;
 
+   // the expired scores still waiting to be removed don't count, see clear_expired_scores()
+   const time_point_sec expiration_time = get_score_expiration_time();
    const auto& index = get_index_type<score_index>().indices().get<by_period_sequence>();
    auto itr = index.lower_bound(std::make_tuple(
                                   active_post.platform,  
@@ -445,6 +485,11 @@ database::get_effective_csaf(const active_post_object& active_post)
    while (itr != index.end() && itr->platform == active_post.platform && itr->poster == active_post.poster && 
       itr->post_pid == active_post.post_pid && itr->period_sequence == active_post.period_sequence)
    {        
+      if (itr->create_time <= expiration_time)
+      {
+         ++itr;
+         continue;
+      }
       total_csaf = total_csaf + itr->csaf.value;
       share_type effective_casf = 0;
       if (total_csaf <= turn_point_first)
@@ -494,14 +539,26 @@ database::get_effective_csaf(const active_post_object& active_post)
 
 void database::clear_expired_scores()
 {
-   const auto& global_params = get_global_properties().parameters.get_extension_params();
-	const auto& score_expiration_index = get_index_type<score_index>().indices().get<by_create_time>();
+   const time_point_sec expiration_time = get_score_expiration_time();
+   const auto& score_expiration_index = get_index_type<score_index>().indices().get<by_create_time>();
+
+   // from the hardfork the removal of a big batch is spread over the next blocks
+   uint32_t budget = head_block_time() >= HARDFORK_0_6_TIME ? GRAPHENE_EXPIRED_SCORES_PER_BLOCK : uint32_t(-1);
+   const auto expired_end = score_expiration_index.upper_bound(expiration_time);
+   auto expired_last = score_expiration_index.begin();
+   while (budget > 0 && expired_last != expired_end)
+   {
+      ++expired_last;
+      --budget;
+   }
+   _cleanup_counts.expired_scores += remove_range<score_index, by_create_time>(score_expiration_index.begin(), expired_last);
 
-	while (!score_expiration_index.empty() && score_expiration_index.begin()->create_time <= head_block_time()-global_params.approval_expiration)
-	{
-		const score_object& score = *score_expiration_index.begin();
-		remove(score);
-	}
+   if (budget == 0)
+   {
+      const auto& scores = dynamic_cast<const primary_index<score_index>&>( get_index_type<score_index>() );
+      _cleanup_counts.expired_scores_backlog =
+            scores.get_secondary_index<score_create_time_count_index>().created_until(expiration_time);
+   }
 }
 
 void database::clear_expired_limit_orders()
@@ -512,12 +569,13 @@ void database::clear_expired_limit_orders()
    {
       const limit_order_object& limit_order = *limit_order_expiration_index.begin();
       cancel_limit_order(limit_order);
+      ++_cleanup_counts.expired_limit_orders;
    }
 }
 
 void database::update_maintenance_flag( bool new_maintenance_flag )
 {
-   modify( get_dynamic_global_properties(), [&]( dynamic_global_property_object& dpo )
+   modify_dynamic_global_properties( [&]( dynamic_global_property_object& dpo )
    {
       auto maintenance_flag = dynamic_global_property_object::maintenance_flag;
       dpo.dynamic_flags =
@@ -534,20 +592,28 @@ void database::clear_expired_csaf_leases()
    const auto& idx = get_index_type<csaf_lease_index>().indices().get<by_expiration>();
    auto itr = idx.begin();
    const dynamic_global_property_object& dpo = get_dynamic_global_properties();
+
+   // the leases expiring together are often of the same accounts, their statistics are modified once per account:
+   // the coin seconds are settled up to the head block time before the leased amounts change, like they were
+   // for each lease, a second settlement at the same time adds nothing
+   flat_map<account_uid_type, std::pair<share_type, share_type>> leased_out_and_in;
    while( itr != idx.end() && itr->expiration <= head_time )
    {
-      modify(get_account_statistics_by_uid(itr->from), [&](_account_statistics_object& s) {
-         if (dpo.enabled_hardfork_version < ENABLE_HEAD_FORK_05)
-            s.update_coin_seconds_earned(csaf_window, head_time, *this, dpo.enabled_hardfork_version);
-         s.core_leased_out -= itr->amount;
-      });
-      modify(get_account_statistics_by_uid(itr->to), [&](_account_statistics_object& s) {
+      leased_out_and_in[itr->from].first += itr->amount;
+      leased_out_and_in[itr->to].second += itr->amount;
+      remove( *itr );
+      ++_cleanup_counts.expired_csaf_leases;
+      itr = idx.begin();
+   }
+
+   for( const auto& item : leased_out_and_in )
+   {
+      modify(get_account_statistics_by_uid(item.first), [&](_account_statistics_object& s) {
          if (dpo.enabled_hardfork_version < ENABLE_HEAD_FORK_05)
             s.update_coin_seconds_earned(csaf_window, head_time, *this, dpo.enabled_hardfork_version);
-         s.core_leased_in -= itr->amount;
+         s.core_leased_out -= item.second.first;
+         s.core_leased_in -= item.second.second;
       });
-      remove( *itr );
-      itr = idx.begin();
    }
 }
 
@@ -555,10 +621,15 @@ void database::update_average_witness_pledges()
 {
    const auto head_num = head_block_num();
    const auto& idx = get_index_type<witness_index>().indices().get<by_pledge_next_update>();
+   // from the hardfork the updates due at a window boundary are spread over the next blocks,
+   // the ones left behind stay first in the index
+   uint32_t budget = head_block_time() >= HARDFORK_0_6_TIME ? GRAPHENE_AVERAGE_PLEDGES_PER_BLOCK : uint32_t(-1);
    auto itr = idx.begin();
-   while( itr != idx.end() && itr->average_pledge_next_update_block <= head_num && itr->is_valid )
+   while( budget > 0 && itr != idx.end() && itr->average_pledge_next_update_block <= head_num && itr->is_valid )
    {
       update_witness_avg_pledge( *itr );
+      ++_cleanup_counts.witness_average_pledges;
+      --budget;
       itr = idx.begin();
    }
 }
@@ -567,10 +638,14 @@ void database::update_average_platform_pledges()
 {
    const auto head_num = head_block_num();
    const auto& idx = get_index_type<platform_index>().indices().get<by_pledge_next_update>();
+   // same budget as update_average_witness_pledges()
+   uint32_t budget = head_block_time() >= HARDFORK_0_6_TIME ? GRAPHENE_AVERAGE_PLEDGES_PER_BLOCK : uint32_t(-1);
    auto itr = idx.begin();
-   while (itr != idx.end() && itr->average_pledge_next_update_block <= head_num && itr->is_valid)
+   while (budget > 0 && itr != idx.end() && itr->average_pledge_next_update_block <= head_num && itr->is_valid)
    {
       update_platform_avg_pledge(*itr);
+      ++_cleanup_counts.platform_average_pledges;
+      --budget;
       itr = idx.begin();
    }
 }
@@ -658,12 +733,15 @@ void database::update_voter_effective_votes()
 {
    const auto head_num = head_block_num();
    const auto& idx = get_index_type<voter_index>().indices().get<by_votes_next_update>();
+   // many of the voters vote for the same candidates, modify each of them once
+   candidate_vote_batch batch( *this );
    auto itr = idx.begin();
    while( itr != idx.end() && itr->effective_votes_next_update_block <= head_num )
    {
       update_voter_effective_votes( *itr );
       itr = idx.begin();
    }
+   batch.flush();
 }
 
 void database::invalidate_expired_governance_voters()
@@ -676,6 +754,7 @@ void database::invalidate_expired_governance_voters()
 
    uint32_t voters_processed = 0;
    const auto& idx = get_index_type<voter_index>().indices().get<by_valid>();
+   candidate_vote_batch batch( *this );
    auto itr = idx.lower_bound( std::make_tuple( true, GRAPHENE_PROXY_TO_SELF_ACCOUNT_UID ) );
    while( itr != idx.end() && itr->is_valid && itr->proxy_uid == GRAPHENE_PROXY_TO_SELF_ACCOUNT_UID
          && itr->effective_last_vote_block <= max_last_vote_block )
@@ -686,6 +765,7 @@ void database::invalidate_expired_governance_voters()
       // this voter become invalid.
       invalidate_voter( voter );
    }
+   batch.flush();
    if( voters_processed > 0 )
       ilog( "Invalidated ${n} expired voters", ("n",voters_processed) );
 }
@@ -741,7 +821,7 @@ void database::update_committee()
       });
 
       // update dynamic global property object
-      modify( dpo, [&]( dynamic_global_property_object& dp )
+      modify_dynamic_global_properties( [&]( dynamic_global_property_object& dp )
       {
          dp.next_committee_update_block += gpo.parameters.committee_update_interval;
       });
@@ -764,7 +844,7 @@ void database::adjust_budgets()
                                - 86400 * 365 * gparams.maintenance_skip_slots / gparams.maintenance_interval;
       uint64_t new_budget = ( fc::uint128_t( core_reserved.value ) * gparams.budget_adjust_target
                               / blocks_per_year / GRAPHENE_100_PERCENT ).to_uint64();
-      modify( dpo, [&]( dynamic_global_property_object& _dpo )
+      modify_dynamic_global_properties( [&]( dynamic_global_property_object& _dpo )
       {
          _dpo.total_budget_per_block = new_budget;
          _dpo.next_budget_adjust_block += gpo.parameters.budget_adjust_interval;
@@ -1244,6 +1324,195 @@ void database::execute_committee_proposal( const committee_proposal_object& prop
    }
 }
 
+namespace detail {
+
+   /// pointers to every object of an index, so that a scan over it can be split into partitions
+   template<typename Index>
+   vector<const typename Index::object_type*> index_object_pointers( const Index& idx )
+   {
+      vector<const typename Index::object_type*> result;
+      const auto& objs = idx.indices();
+      result.reserve( objs.size() );
+      for( const auto& o : objs )
+         result.push_back( &o );
+      return result;
+   }
+
+   /**
+    * Calls map(object, partial) for every object with one Partial per partition, then folds the partials together
+    * with Partial::merge(). The partitions are scanned on the worker threads when there are any, any exception
+    * thrown by map is rethrown here.
+    */
+   template<typename Partial, typename Object, typename Map>
+   Partial invariants_map_reduce( graphene::utilities::thread_pool* pool, const vector<const Object*>& objs, Map map )
+   {
+      const size_t min_partition_size = 1024;
+      size_t partitions = 1;
+      if( pool != nullptr && pool->size() > 0 && objs.size() >= 2 * min_partition_size )
+         partitions = std::min<size_t>( pool->size(), objs.size() / min_partition_size );
+
+      vector<Partial> partials( partitions );
+      const size_t chunk = ( objs.size() + partitions - 1 ) / partitions;
+      auto scan = [&]( size_t p ) {
+         const size_t end = std::min( objs.size(), ( p + 1 ) * chunk );
+         for( size_t i = p * chunk; i < end; ++i )
+            map( *objs[i], partials[p] );
+      };
+      if( partitions == 1 )
+         scan( 0 );
+      else
+         pool->parallel_for( partitions, scan );
+
+      Partial result;
+      for( const auto& partial : partials )
+         result.merge( partial );
+      return result;
+   }
+
+   struct invariants_balance_sums
+   {
+      map<asset_aid_type, share_type> total_balances;
+      map<asset_aid_type, uint64_t>   holder_counts;
+      share_type                      total_core_balance = 0;
+
+      void merge( const invariants_balance_sums& o )
+      {
+         for( const auto& item : o.total_balances )
+            total_balances[item.first] += item.second;
+         for( const auto& item : o.holder_counts )
+            holder_counts[item.first] += item.second;
+         total_core_balance += o.total_core_balance;
+      }
+   };
+
+   struct invariants_statistics_sums
+   {
+      map<asset_aid_type, share_type> uncollected_market_fees;
+      share_type total_core_balance = 0;
+      share_type total_core_non_bal = 0;
+      share_type total_core_leased_in = 0;
+      share_type total_core_leased_out = 0;
+      share_type total_core_witness_pledge = 0;
+      share_type total_core_committee_member_pledge = 0;
+      share_type total_core_platform_pledge = 0;
+      uint64_t   total_voting_accounts = 0;
+      share_type total_voting_core_balance = 0;
+
+      void merge( const invariants_statistics_sums& o )
+      {
+         for( const auto& item : o.uncollected_market_fees )
+            uncollected_market_fees[item.first] += item.second;
+         total_core_balance += o.total_core_balance;
+         total_core_non_bal += o.total_core_non_bal;
+         total_core_leased_in += o.total_core_leased_in;
+         total_core_leased_out += o.total_core_leased_out;
+         total_core_witness_pledge += o.total_core_witness_pledge;
+         total_core_committee_member_pledge += o.total_core_committee_member_pledge;
+         total_core_platform_pledge += o.total_core_platform_pledge;
+         total_voting_accounts += o.total_voting_accounts;
+         total_voting_core_balance += o.total_voting_core_balance;
+      }
+   };
+
+   struct invariants_voter_sums
+   {
+      uint64_t total_voters = 0;
+      uint64_t total_witnesses_voted = 0;
+      uint64_t total_committee_members_voted = 0;
+      uint64_t total_platform_voted = 0;
+      uint64_t total_voter_votes = 0;
+      fc::uint128_t total_voter_witness_votes;
+      fc::uint128_t total_voter_committee_member_votes;
+      fc::uint128_t total_voter_platform_votes;
+      vector<share_type> total_got_proxied_votes;
+      vector<share_type> total_proxied_votes;
+
+      void resize( size_t levels )
+      {
+         total_got_proxied_votes.resize( levels );
+         total_proxied_votes.resize( levels );
+      }
+
+      void merge( const invariants_voter_sums& o )
+      {
+         total_voters += o.total_voters;
+         total_witnesses_voted += o.total_witnesses_voted;
+         total_committee_members_voted += o.total_committee_members_voted;
+         total_platform_voted += o.total_platform_voted;
+         total_voter_votes += o.total_voter_votes;
+         total_voter_witness_votes += o.total_voter_witness_votes;
+         total_voter_committee_member_votes += o.total_voter_committee_member_votes;
+         total_voter_platform_votes += o.total_voter_platform_votes;
+         resize( std::max( total_proxied_votes.size(), o.total_proxied_votes.size() ) );
+         for( size_t i = 0; i < o.total_proxied_votes.size(); ++i )
+         {
+            total_got_proxied_votes[i] += o.total_got_proxied_votes[i];
+            total_proxied_votes[i] += o.total_proxied_votes[i];
+         }
+      }
+   };
+
+   /// the running totals kept by the Totals secondary index of Index
+   template<typename Totals, typename Index>
+   const Totals& get_supply_totals( const database& db )
+   {
+      const auto& idx = dynamic_cast<const primary_index<Index>&>( db.get_index_type<Index>() );
+      return idx.template get_secondary_index<Totals>();
+   }
+
+   inline share_type supply_total_of( const map<asset_aid_type, share_type>& totals, asset_aid_type asset_id )
+   {
+      auto itr = totals.find( asset_id );
+      return itr != totals.end() ? itr->second : share_type();
+   }
+
+} // detail
+
+void database::check_supply_totals()
+{
+   const auto& balance_totals = detail::get_supply_totals<account_balance_totals_index, account_balance_index>( *this );
+   const auto& stats_totals = detail::get_supply_totals<account_statistics_totals_index, account_statistics_index>( *this );
+   const auto& order_totals = detail::get_supply_totals<limit_order_totals_index, limit_order_index>( *this );
+
+   FC_ASSERT( stats_totals.total_core_leased_in == stats_totals.total_core_leased_out );
+   FC_ASSERT( stats_totals.total_core_balance == detail::supply_total_of( balance_totals.total_balances, GRAPHENE_CORE_ASSET_AID ) );
+
+   // the same sum as check_invariants() does, but with the balances, statistics and orders taken from the totals
+   share_type core_not_in_accounts = get_dynamic_global_properties().budget_pool + stats_totals.total_core_non_balance;
+   for( const witness_object& witness_obj : get_index_type<witness_index>().indices() )
+      core_not_in_accounts += ( witness_obj.need_distribute_bonus - witness_obj.already_distribute_bonus );
+   const auto& adt_idx = dynamic_cast<const primary_index<advertising_order_index>&>( get_index_type<advertising_order_index>() );
+   core_not_in_accounts += adt_idx.get_secondary_index<advertising_order_count_index>().undetermined_balance();
+
+   for( const asset_object& asset_obj : get_index_type<asset_index>().indices() )
+   {
+      const auto& dyn_data = asset_obj.dynamic_data( *this );
+      share_type total = detail::supply_total_of( balance_totals.total_balances, asset_obj.asset_id )
+                       + detail::supply_total_of( stats_totals.total_uncollected_market_fees, asset_obj.asset_id )
+                       + detail::supply_total_of( order_totals.total_for_sale, asset_obj.asset_id )
+                       + dyn_data.accumulated_fees;
+      if( asset_obj.asset_id == GRAPHENE_CORE_ASSET_AID )
+         total += core_not_in_accounts;
+      FC_ASSERT( total == dyn_data.current_supply, "supply of asset ${a} doesn't match the running totals",
+                 ("a",asset_obj.asset_id)("total",total)("current_supply",dyn_data.current_supply) );
+   }
+}
+
+void database::schedule_invariants_check()
+{
+   if( _invariants_check.valid() && !_invariants_check.ready() )
+      return; // the one already scheduled will catch up with the latest state
+
+   const uint32_t block_num = head_block_num();
+   _invariants_check = fc::async( [this,block_num]() {
+      try {
+         check_invariants();
+      } catch( const fc::exception& e ) {
+         elog( "Invariants check scheduled at block ${n} failed: ${e}", ("n",block_num)("e",e.to_detail_string()) );
+      }
+   }, "check_invariants" );
+}
+
 void database::check_invariants()
 {
    const auto head_num = head_block_num();
@@ -1257,24 +1526,25 @@ void database::check_invariants()
    FC_ASSERT( wso.next_schedule_block_num > head_num );
    //if( head_block_num() >= 1285 ) { idump( (dpo) ); }
 
-   map<asset_aid_type, share_type> total_balances;
-   const auto& balance_index = get_index_type<account_balance_index>().indices();
-   for (const account_balance_object& b : balance_index)
-      total_balances[b.asset_type] += b.balance;
+   // The biggest indexes are scanned as a map-reduce over partitions, on the worker threads if there are any.
+   graphene::utilities::thread_pool* pool = _thread_pool.get();
 
-   share_type total_core_balance = 0;
-   share_type total_core_non_bal = dpo.budget_pool;
-   share_type total_core_leased_in = 0;
-   share_type total_core_leased_out = 0;
-   share_type total_core_witness_pledge = 0;
-   share_type total_core_committee_member_pledge = 0;
-   share_type total_core_platform_pledge = 0;
-
-   uint64_t total_voting_accounts = 0;
-   share_type total_voting_core_balance = 0;
+   const auto balance_sums = detail::invariants_map_reduce<detail::invariants_balance_sums>( pool,
+         detail::index_object_pointers( get_index_type<account_balance_index>() ),
+         []( const account_balance_object& b, detail::invariants_balance_sums& sums )
+   {
+      FC_ASSERT( b.balance >= 0 );
+      sums.total_balances[b.asset_type] += b.balance;
+      if( b.balance != 0 )
+         ++sums.holder_counts[b.asset_type];
+      if( b.asset_type == GRAPHENE_CORE_ASSET_AID )
+         sums.total_core_balance += b.balance;
+   });
+   map<asset_aid_type, share_type> total_balances = balance_sums.total_balances;
 
-   const auto& acc_stats_idx = get_index_type<account_statistics_index>().indices();
-   for( const auto& s: acc_stats_idx )
+   const auto stats_sums = detail::invariants_map_reduce<detail::invariants_statistics_sums>( pool,
+         detail::index_object_pointers( get_index_type<account_statistics_index>() ),
+         [this,head_num]( const _account_statistics_object& s, detail::invariants_statistics_sums& sums )
    {
       //if( head_block_num() >= 1285 ) { idump( (s) ); }
       FC_ASSERT( s.core_balance == get_balance( s.owner, GRAPHENE_CORE_ASSET_AID ).amount );
@@ -1293,29 +1563,42 @@ void database::check_invariants()
       }
 
       for (const auto & p : s.uncollected_market_fees)
-         total_balances[p.first] += p.second;
+         sums.uncollected_market_fees[p.first] += p.second;
 
       auto iter_fee = s.uncollected_market_fees.find(GRAPHENE_CORE_ASSET_AID);
       share_type uncollect_market_fee = iter_fee != s.uncollected_market_fees.end() ? iter_fee->second : 0;
 
-      total_core_balance += s.core_balance;
-      total_core_non_bal += (s.prepaid + s.uncollected_witness_pay + s.uncollected_pledge_bonus + s.uncollected_score_bonus + uncollect_market_fee);
-      total_core_leased_in += s.core_leased_in;
-      total_core_leased_out += s.core_leased_out;
+      sums.total_core_balance += s.core_balance;
+      sums.total_core_non_bal += (s.prepaid + s.uncollected_witness_pay + s.uncollected_pledge_bonus + s.uncollected_score_bonus + uncollect_market_fee);
+      sums.total_core_leased_in += s.core_leased_in;
+      sums.total_core_leased_out += s.core_leased_out;
       if (s.pledge_balance_ids.count(pledge_balance_type::Witness))
-         total_core_witness_pledge += get(s.pledge_balance_ids.at(pledge_balance_type::Witness)).pledge;
+         sums.total_core_witness_pledge += get(s.pledge_balance_ids.at(pledge_balance_type::Witness)).pledge;
       if (s.pledge_balance_ids.count(pledge_balance_type::Commitment))
-         total_core_committee_member_pledge += get(s.pledge_balance_ids.at(pledge_balance_type::Commitment)).pledge;
+         sums.total_core_committee_member_pledge += get(s.pledge_balance_ids.at(pledge_balance_type::Commitment)).pledge;
       if (s.pledge_balance_ids.count(pledge_balance_type::Platform))
-         total_core_platform_pledge += get(s.pledge_balance_ids.at(pledge_balance_type::Platform)).pledge;
+         sums.total_core_platform_pledge += get(s.pledge_balance_ids.at(pledge_balance_type::Platform)).pledge;
       FC_ASSERT(s.core_balance >= s.core_leased_out + s.total_mining_pledge + s.get_all_pledge_balance(GRAPHENE_CORE_ASSET_AID, *this));
 
       if( s.is_voter )
       {
-         ++total_voting_accounts;
-         total_voting_core_balance += s.get_votes_from_core_balance();
+         ++sums.total_voting_accounts;
+         sums.total_voting_core_balance += s.get_votes_from_core_balance();
       }
-   }
+   });
+
+   for( const auto& p : stats_sums.uncollected_market_fees )
+      total_balances[p.first] += p.second;
+
+   const share_type total_core_balance = stats_sums.total_core_balance;
+   share_type total_core_non_bal = dpo.budget_pool + stats_sums.total_core_non_bal;
+   const share_type total_core_leased_in = stats_sums.total_core_leased_in;
+   const share_type total_core_leased_out = stats_sums.total_core_leased_out;
+   const share_type total_core_witness_pledge = stats_sums.total_core_witness_pledge;
+   const share_type total_core_committee_member_pledge = stats_sums.total_core_committee_member_pledge;
+   const share_type total_core_platform_pledge = stats_sums.total_core_platform_pledge;
+   const uint64_t total_voting_accounts = stats_sums.total_voting_accounts;
+   const share_type total_voting_core_balance = stats_sums.total_voting_core_balance;
 
    for (const limit_order_object& o : get_index_type<limit_order_index>().indices())
    {
@@ -1343,6 +1626,9 @@ void database::check_invariants()
        total_advertising_released += advertising_iter->released_balance;
        ++advertising_iter;
    }
+   FC_ASSERT( total_advertising_released ==
+              dynamic_cast<const primary_index<advertising_order_index>&>( get_index_type<advertising_order_index>() )
+                 .get_secondary_index<advertising_order_count_index>().undetermined_balance() );
    total_balances[GRAPHENE_CORE_ASSET_AID] += total_advertising_released + total_core_non_bal;
 
    for (const asset_object& asset_obj : get_index_type<asset_index>().indices())
@@ -1359,67 +1645,83 @@ void database::check_invariants()
    }
    FC_ASSERT( total_core_leased_out == total_core_leased );
 
-   share_type total_core_balance_indexed = 0;
-   const auto& acc_bal_idx = get_index_type<account_balance_index>().indices();
-   for( const auto& s: acc_bal_idx )
-   {
-      FC_ASSERT( s.balance >= 0 );
-      if( s.asset_type == GRAPHENE_CORE_ASSET_AID)
-         total_core_balance_indexed += s.balance;
-   }
-   FC_ASSERT( total_core_balance == total_core_balance_indexed );
-
-   uint64_t total_voters = 0;
-   uint64_t total_witnesses_voted = 0;
-   uint64_t total_committee_members_voted = 0;
-   uint64_t total_platform_voted = 0;
-   uint64_t total_voter_votes = 0;
-   fc::uint128_t total_voter_witness_votes;
-   fc::uint128_t total_voter_committee_member_votes;
-   fc::uint128_t total_voter_platform_votes;
-   vector<share_type> total_got_proxied_votes;
-   vector<share_type> total_proxied_votes;
-   total_got_proxied_votes.resize( gpo.parameters.max_governance_voting_proxy_level );
-   total_proxied_votes.resize( gpo.parameters.max_governance_voting_proxy_level );
-   const auto& voter_idx = get_index_type<voter_index>().indices();
-   for( const auto& s: voter_idx )
+   FC_ASSERT( total_core_balance == balance_sums.total_core_balance );
+
+   // the running totals used by check_supply_totals() must agree with the scan
+   {
+      const auto& balance_totals = detail::get_supply_totals<account_balance_totals_index, account_balance_index>( *this );
+      const auto& stats_totals = detail::get_supply_totals<account_statistics_totals_index, account_statistics_index>( *this );
+      const auto& pledge_totals = detail::get_supply_totals<pledge_balance_totals_index, pledge_balance_index>( *this );
+      for( const auto& item : balance_sums.total_balances )
+         FC_ASSERT( detail::supply_total_of( balance_totals.total_balances, item.first ) == item.second );
+      for( const auto& item : balance_totals.total_balances )
+         FC_ASSERT( detail::supply_total_of( balance_sums.total_balances, item.first ) == item.second );
+      FC_ASSERT( balance_totals.holder_counts == balance_sums.holder_counts );
+      for( const auto& item : stats_sums.uncollected_market_fees )
+         FC_ASSERT( detail::supply_total_of( stats_totals.total_uncollected_market_fees, item.first ) == item.second );
+      FC_ASSERT( stats_totals.total_core_balance == total_core_balance );
+      FC_ASSERT( stats_totals.total_core_non_balance == stats_sums.total_core_non_bal );
+      FC_ASSERT( stats_totals.total_core_leased_in == total_core_leased_in );
+      FC_ASSERT( stats_totals.total_core_leased_out == total_core_leased_out );
+      FC_ASSERT( pledge_totals.total_pledge( pledge_balance_type::Witness ) == total_core_witness_pledge );
+      FC_ASSERT( pledge_totals.total_pledge( pledge_balance_type::Commitment ) == total_core_committee_member_pledge );
+      FC_ASSERT( pledge_totals.total_pledge( pledge_balance_type::Platform ) == total_core_platform_pledge );
+   }
+
+   const size_t proxy_levels = gpo.parameters.max_governance_voting_proxy_level;
+   auto voter_sums = detail::invariants_map_reduce<detail::invariants_voter_sums>( pool,
+         detail::index_object_pointers( get_index_type<voter_index>() ),
+         [this,head_num,proxy_levels]( const voter_object& s, detail::invariants_voter_sums& sums )
    {
       if( s.is_valid )
       {
+         sums.resize( proxy_levels );
          FC_ASSERT( s.effective_votes_next_update_block > head_num );
          const auto& stats = get_account_statistics_by_uid( s.uid );
          FC_ASSERT( stats.last_voter_sequence == s.sequence );
          FC_ASSERT(stats.get_votes_from_core_balance() == s.votes);
-         ++total_voters;
-         total_voter_votes += s.votes;
-         total_witnesses_voted += s.number_of_witnesses_voted;
-         total_committee_members_voted += s.number_of_committee_members_voted;
-         total_platform_voted += s.number_of_platform_voted;
+         ++sums.total_voters;
+         sums.total_voter_votes += s.votes;
+         sums.total_witnesses_voted += s.number_of_witnesses_voted;
+         sums.total_committee_members_voted += s.number_of_committee_members_voted;
+         sums.total_platform_voted += s.number_of_platform_voted;
          if( s.proxy_uid == GRAPHENE_PROXY_TO_SELF_ACCOUNT_UID )
          {
-            total_voter_witness_votes += fc::uint128_t( s.total_votes() ) * s.number_of_witnesses_voted;
-            total_voter_committee_member_votes += fc::uint128_t( s.total_votes() ) * s.number_of_committee_members_voted;
-            total_voter_platform_votes += fc::uint128_t( s.total_votes() ) * s.number_of_platform_voted;
+            sums.total_voter_witness_votes += fc::uint128_t( s.total_votes() ) * s.number_of_witnesses_voted;
+            sums.total_voter_committee_member_votes += fc::uint128_t( s.total_votes() ) * s.number_of_committee_members_voted;
+            sums.total_voter_platform_votes += fc::uint128_t( s.total_votes() ) * s.number_of_platform_voted;
          }
          else
          {
             FC_ASSERT( s.number_of_witnesses_voted == 0 );
             FC_ASSERT( s.number_of_committee_members_voted == 0 );
             FC_ASSERT( s.number_of_platform_voted == 0 );
-            total_proxied_votes[0] += s.effective_votes;
-            for( size_t i = 1; i < gpo.parameters.max_governance_voting_proxy_level; ++i )
-               total_proxied_votes[i] += s.proxied_votes[i-1];
+            sums.total_proxied_votes[0] += s.effective_votes;
+            for( size_t i = 1; i < proxy_levels; ++i )
+               sums.total_proxied_votes[i] += s.proxied_votes[i-1];
          }
          const auto& account = get_account_by_uid(s.uid);
          if (account.referrer_by_platform){
              const platform_object* plat = find_platform_by_sequence(account.reg_info.referrer, account.referrer_by_platform);
              if (plat)
-                 total_voter_platform_votes += s.effective_votes;
-         }   
-         for( size_t i = 0; i < gpo.parameters.max_governance_voting_proxy_level; ++i )
-            total_got_proxied_votes[i] += s.proxied_votes[i];
+                 sums.total_voter_platform_votes += s.effective_votes;
+         }
+         for( size_t i = 0; i < proxy_levels; ++i )
+            sums.total_got_proxied_votes[i] += s.proxied_votes[i];
       }
-   }
+   });
+   voter_sums.resize( proxy_levels );
+
+   const uint64_t total_voters = voter_sums.total_voters;
+   const uint64_t total_witnesses_voted = voter_sums.total_witnesses_voted;
+   const uint64_t total_committee_members_voted = voter_sums.total_committee_members_voted;
+   const uint64_t total_platform_voted = voter_sums.total_platform_voted;
+   const uint64_t total_voter_votes = voter_sums.total_voter_votes;
+   const fc::uint128_t total_voter_witness_votes = voter_sums.total_voter_witness_votes;
+   const fc::uint128_t total_voter_committee_member_votes = voter_sums.total_voter_committee_member_votes;
+   const fc::uint128_t total_voter_platform_votes = voter_sums.total_voter_platform_votes;
+   const vector<share_type>& total_got_proxied_votes = voter_sums.total_got_proxied_votes;
+   const vector<share_type>& total_proxied_votes = voter_sums.total_proxied_votes;
    FC_ASSERT( total_voting_accounts == total_voters );
    FC_ASSERT( total_voting_core_balance == total_voter_votes );
    for( size_t i = 0; i < gpo.parameters.max_governance_voting_proxy_level; ++i )
@@ -1430,11 +1732,13 @@ void database::check_invariants()
    share_type total_witness_pledges;
    fc::uint128_t total_witness_received_votes;
    const auto& wit_idx = get_index_type<witness_index>().indices();
+   // the updates over the budget of the last block are still due
+   const bool witness_pledge_updates_left = _cleanup_counts.witness_average_pledges >= GRAPHENE_AVERAGE_PLEDGES_PER_BLOCK;
    for( const auto& s: wit_idx )
    {
       if( s.is_valid )
       {
-         FC_ASSERT( s.average_pledge_next_update_block > head_num );
+         FC_ASSERT( witness_pledge_updates_left || s.average_pledge_next_update_block > head_num );
          FC_ASSERT( s.by_pledge_scheduled_time >= wso.current_by_pledge_time );
          FC_ASSERT( s.by_vote_scheduled_time >= wso.current_by_vote_time );
          const auto& stats = get_account_statistics_by_uid( s.account );
@@ -1466,10 +1770,12 @@ void database::check_invariants()
    share_type total_platform_pledges;
    fc::uint128_t total_platform_received_votes;
    const auto& pla_idx = get_index_type<platform_index>().indices();
+   const bool platform_pledge_updates_left = _cleanup_counts.platform_average_pledges >= GRAPHENE_AVERAGE_PLEDGES_PER_BLOCK;
    for( const auto& s: pla_idx )
    {
       if( s.is_valid )
       {
+         FC_ASSERT( platform_pledge_updates_left || s.average_pledge_next_update_block > head_num );
          const auto& stats = get_account_statistics_by_uid( s.owner );
          FC_ASSERT( stats.last_platform_sequence == s.sequence );
          total_platform_pledges += s.pledge;
@@ -1525,7 +1831,15 @@ void database::adjust_platform_votes( const platform_object& platform, share_typ
 {
    if( delta == 0 || !platform.is_valid )
       return;
-   modify( platform, [&]( platform_object& pla )
+   if( _batching_candidate_votes )
+      _batched_platform_votes[ platform.id ] += delta;
+   else
+      apply_platform_votes( platform, delta );
+}
+
+void database::apply_platform_votes( const platform_object& platform, share_type delta )
+{
+   modify_fields<platform_object::vote_fields>( platform, [&]( platform_object& pla )
    {
       pla.total_votes += delta.value;
    } );
@@ -1533,21 +1847,59 @@ void database::adjust_platform_votes( const platform_object& platform, share_typ
 
 void database::update_pledge_mining_bonus()
 {
+   // Pays the bonus of the due witnesses to their pledgers. The pledge mining objects are not modified, the witness
+   // remembers the pass in bonus_paid_block_num instead, and the bonuses of a pledger mining with several of the
+   // witnesses are added to its statistics at once.
    const auto& wit_idx = get_index_type<witness_index>().indices().get<by_pledge_mining_bonus>();
+   const auto& pmg_idx = get_index_type<pledge_mining_index>().indices().get<by_pledge_witness>();
    auto wit_itr = wit_idx.lower_bound(head_block_num());
    vector<std::reference_wrapper<const witness_object>> refs;
+   std::map<account_uid_type, share_type> pledger_bonuses;
    while (wit_itr != wit_idx.end()) {
-      update_pledge_mining_bonus_by_witness(*wit_itr);
-      refs.emplace_back(std::cref(*wit_itr));
+      const witness_object& witness_obj = *wit_itr;
+      share_type send_bonus = 0;
+      auto pmg_itr = pmg_idx.lower_bound(witness_obj.account);
+      while (pmg_itr != pmg_idx.end() && pmg_itr->witness == witness_obj.account)
+      {
+         const share_type pledge = get(pmg_itr->pledge_id).pledge;
+         if (pledge > 0)
+         {
+            share_type bonus_per_pledge = witness_obj.accumulate_bonus_per_pledge(
+                                             pledge_mining_bonus_block_num(*pmg_itr, witness_obj) + 1);
+            share_type total_bonus = ((uint128_t)bonus_per_pledge.value * pledge.value
+               / GRAPHENE_PLEDGE_BONUS_PRECISION).to_uint64();
+            if (total_bonus > 0)
+            {
+               pledger_bonuses[pmg_itr->pledge_account] += total_bonus;
+               send_bonus += total_bonus;
+            }
+         }
+         ++pmg_itr;
+      }
+      modify(get_account_statistics_by_uid(witness_obj.account), [&](_account_statistics_object& o)
+      {
+         o.uncollected_witness_pay += (witness_obj.need_distribute_bonus
+            - witness_obj.already_distribute_bonus
+            - send_bonus);
+      });
+      refs.emplace_back(std::cref(witness_obj));
       ++wit_itr;
    }
 
+   for (const auto& bonus : pledger_bonuses)
+   {
+      modify(get_account_statistics_by_uid(bonus.first), [&](_account_statistics_object& o) {
+         o.uncollected_pledge_bonus += bonus.second;
+      });
+   }
+
    std::for_each(refs.begin(), refs.end(), [&](const witness_object& witness_obj) {
       modify(witness_obj, [&](witness_object& wit) {
          wit.unhandled_bonus = 0;
          wit.need_distribute_bonus = 0;
          wit.already_distribute_bonus = 0;
          wit.last_update_bonus_block_num = head_block_num();
+         wit.bonus_paid_block_num = head_block_num();
          wit.bonus_per_pledge.clear();
       });
    });
@@ -1560,7 +1912,8 @@ void database::update_pledge_mining_bonus_by_witness(const witness_object& witne
    auto pmg_itr = pmg_idx.lower_bound(witness_obj.account);
    while (pmg_itr != pmg_idx.end() && pmg_itr->witness == witness_obj.account)
    {
-      share_type bonus_per_pledge = witness_obj.accumulate_bonus_per_pledge(pmg_itr->last_bonus_block_num + 1);
+      share_type bonus_per_pledge = witness_obj.accumulate_bonus_per_pledge(
+                                       pledge_mining_bonus_block_num(*pmg_itr, witness_obj) + 1);
       send_bonus += update_pledge_mining_bonus_by_account(*pmg_itr, bonus_per_pledge);
       ++pmg_itr;
    }
@@ -1586,11 +1939,24 @@ share_type database::update_pledge_mining_bonus_by_account(const pledge_mining_o
    }
    modify(pledge_mining_obj, [&](pledge_mining_object& o) {
       o.last_bonus_block_num = head_block_num();
+      o.last_update_block_num = head_block_num();
    });
     
    return total_bonus;
 }
 
+uint32_t database::pledge_mining_bonus_block_num(const pledge_mining_object& pledge_mining_obj,
+                                                 const witness_object& witness_obj)const
+{
+   // The pledge only changes together with last_update_block_num, so a pledge mining object which has a pledge now
+   // had it in every pass since. A pass in block N runs after the transactions of block N, which see head block
+   // number N - 1, so the ones of block N + 1 see N and are after it.
+   if (witness_obj.bonus_paid_block_num > pledge_mining_obj.last_update_block_num
+       && get(pledge_mining_obj.pledge_id).pledge > 0)
+      return witness_obj.bonus_paid_block_num;
+   return pledge_mining_obj.last_bonus_block_num;
+}
+
 void database::update_platform_avg_pledge( const account_uid_type uid )
 {
    update_platform_avg_pledge( get_platform_by_owner( uid ) );
@@ -1722,12 +2088,529 @@ void database::clear_resigned_platform_votes()
    }
 }
 
+namespace detail {
+
+   /**
+    * The platforms taking part in a content award. The posts of a period are shared by a lot fewer platforms, so
+    * each platform is only looked up once per award.
+    */
+   class content_award_platforms
+   {
+      public:
+         content_award_platforms( const database& db, share_type min_votes ):_db(db),_min_votes(min_votes){}
+
+         bool is_eligible( account_uid_type owner )
+         {
+            auto itr = _eligible.find( owner );
+            if( itr == _eligible.end() )
+            {
+               const platform_object* pla = _db.find_platform_by_owner( owner );
+               const bool eligible = !( pla == nullptr || !pla->is_valid || pla->total_votes < _min_votes );
+               itr = _eligible.emplace( owner, eligible ).first;
+            }
+            return itr->second;
+         }
+
+         void add_csaf( account_uid_type owner, share_type csaf ){ _csaf[owner] += csaf; }
+
+         /// the csaf added by add_csaf() by platform
+         flat_map<account_uid_type, share_type> csaf_by_platform()const
+         {
+            vector< std::pair<account_uid_type, share_type> > sorted( _csaf.begin(), _csaf.end() );
+            std::sort( sorted.begin(), sorted.end() );
+            flat_map<account_uid_type, share_type> result;
+            result.reserve( sorted.size() );
+            for( const auto& item : sorted )
+               result.emplace_hint( result.end(), item );
+            return result;
+         }
+
+      private:
+         const database&                                     _db;
+         share_type                                          _min_votes;
+         std::unordered_map<account_uid_type, bool>          _eligible;
+         std::unordered_map<account_uid_type, share_type>    _csaf;
+   };
+
+} // detail
+
+share_type database::get_post_approval_csaf(const active_post_object& active_post)const
+{
+   const auto& params = get_global_properties().parameters.extension_parameters;
+   const auto& idx = get_index_type<score_index>().indices().get<by_period_sequence>();
+   auto itr = idx.lower_bound(std::make_tuple(active_post.platform, active_post.poster, active_post.post_pid, active_post.period_sequence));
+
+   // the expired scores still waiting to be removed don't count, see clear_expired_scores()
+   const time_point_sec expiration_time = get_score_expiration_time();
+   boost::multiprecision::int128_t approval_amount = 0;
+   while (itr != idx.end() && itr->platform == active_post.platform && itr->poster == active_post.poster &&
+      itr->post_pid == active_post.post_pid && itr->period_sequence == active_post.period_sequence)
+   {
+      if (itr->create_time <= expiration_time)
+      {
+         ++itr;
+         continue;
+      }
+      approval_amount += (boost::multiprecision::int128_t)itr->csaf.value * itr->score * params.casf_modulus
+         / (5 * GRAPHENE_100_PERCENT);
+      ++itr;
+   }
+   return approval_amount.convert_to<int64_t>();
+}
+
+vector<share_type> database::get_post_approval_csafs(const vector<const active_post_object*>& posts)const
+{
+   vector<share_type> approvals(posts.size());
+   // only reads the score index, nothing is modified until all the sums are known
+   auto sum = [this, &posts, &approvals](size_t i) { approvals[i] = get_post_approval_csaf(*posts[i]); };
+   if (_thread_pool && _thread_pool->size() > 0 && posts.size() >= GRAPHENE_PARALLEL_APPROVAL_MIN_POSTS)
+      _thread_pool->parallel_for(posts.size(), sum);
+   else
+   {
+      for (size_t i = 0; i < posts.size(); ++i)
+         sum(i);
+   }
+   return approvals;
+}
+
+template<bool HeadFork05>
+void database::award_content_post(const active_post_object& active_post,
+                                  share_type post_effective_csaf,
+                                  share_type post_approval_csaf,
+                                  const content_award_totals& totals,
+                                  content_award_payouts& payouts)
+{
+   const auto& params = get_global_properties().parameters.extension_parameters;
+
+   share_type post_earned = (totals.content_award_amount * post_effective_csaf.value /
+      totals.total_effective_csaf_amount.value).to_uint64();
+   share_type score_earned = 0;
+   share_type receiptor_earned = 0;
+   if (!HeadFork05)
+      score_earned = ((uint128_t)post_earned.value * GRAPHENE_DEFAULT_SCORE_RECEIPTS_RATIO / GRAPHENE_100_PERCENT).to_uint64();
+   else
+      score_earned = ((uint128_t)post_earned.value * params.scorer_earnings_rate / GRAPHENE_100_PERCENT).to_uint64(); 
+   if (post_approval_csaf >= 0)
+      receiptor_earned = post_earned - score_earned;
+   else
+      receiptor_earned = ((uint128_t)((post_earned - score_earned).value)*params.receiptor_award_modulus / GRAPHENE_100_PERCENT).to_uint64();
+
+   const auto& post = get_post_by_platform(active_post.platform, active_post.poster, active_post.post_pid);
+   share_type temp = receiptor_earned;
+   flat_map<account_uid_type, share_type> receiptor;
+   for (const auto& r : post.receiptors)
+   {
+      if (r.first == post.platform)
+         continue;
+      share_type to_add = ((uint128_t)receiptor_earned.value * r.second.cur_ratio / GRAPHENE_100_PERCENT).to_uint64();
+
+      ///adjust_balance(r.first, asset(to_add));
+      payouts.adjust_balance_map.add(r.first, to_add);
+      receiptor.emplace(r.first, to_add);
+      temp -= to_add;
+   }
+   payouts.adjust_balance_map.add(post.platform, temp);
+   receiptor.emplace(post.platform, temp);
+
+   share_type award_only_from_platform;
+   if (post.poster == post.platform)
+      award_only_from_platform = ((uint128_t)receiptor_earned.value * GRAPHENE_DEFAULT_PLATFORM_RECEIPTS_RATIO /
+      GRAPHENE_100_PERCENT).to_uint64();
+   else
+      award_only_from_platform = temp;
+   if (payouts.platform_receiptor_award.count(post.platform))
+   {
+      payouts.platform_receiptor_award.at(post.platform).first += temp;
+      payouts.platform_receiptor_award.at(post.platform).second += award_only_from_platform;
+   }
+   else
+   {
+      payouts.platform_receiptor_award.emplace(post.platform, std::make_pair(temp, award_only_from_platform));
+   }
+
+   modify(active_post, [&](active_post_object& act)
+   {
+      act.positive_win = post_approval_csaf >= 0;
+      act.post_award = receiptor_earned;
+   });
+   for (const auto& r : receiptor)
+      add_active_post_receipts(active_post, r.first, r.second);
+
+   if (post.score_settlement)
+      return;
+   //result <set<score id, effective csaf for the score, is or not approve>, total effective csaf to award>
+   auto result = get_effective_csaf(active_post);
+   uint128_t total_award_csaf = (uint128_t)std::get<1>(result).value;
+   share_type actual_score_earned = 0;
+   for (const auto& e : std::get<0>(result))
+   {
+      uint128_t effective_csaf_per_account = (uint128_t)std::get<1>(e).value;
+      share_type to_add = 0;
+      if (post_approval_csaf < 0 && !std::get<2>(e))
+         to_add = (effective_csaf_per_account * score_earned.value * params.disapprove_award_modulus /
+         (total_award_csaf * GRAPHENE_100_PERCENT)).to_uint64();
+      else
+         to_add = (effective_csaf_per_account * score_earned.value / total_award_csaf).to_uint64();
+      const auto& score_obj = get(std::get<0>(e));
+      modify(score_obj, [&](score_object& obj)
+      {
+         obj.profits = to_add;
+      });
+
+      //registrar and referrer get part of earning
+      if (HeadFork05)
+      {
+         share_type to_registrar_and_referrer = ((uint128_t)to_add.value * params.registrar_referrer_rate_from_score / GRAPHENE_100_PERCENT).to_uint64();
+         payouts.registrar_and_referrer_award.add(score_obj.from_account_uid, to_registrar_and_referrer);
+         payouts.adjust_balance_map.add(score_obj.from_account_uid, to_add - to_registrar_and_referrer);
+      }
+      else
+         payouts.adjust_balance_map.add(score_obj.from_account_uid, to_add);
+
+      actual_score_earned += to_add;
+   }
+
+   modify(active_post, [&](active_post_object& act)
+   {
+      act.post_award = actual_score_earned + receiptor_earned;
+   });
+
+   modify(post, [&](post_object& act)
+   {
+      act.score_settlement = true;
+   });
+}
+
+void database::account_amounts::sum_by_account()
+{
+   std::stable_sort(entries.begin(), entries.end(),
+                    [](const std::pair<account_uid_type, share_type>& a, const std::pair<account_uid_type, share_type>& b) {
+                       return a.first < b.first;
+                    });
+   auto out = entries.begin();
+   for (auto itr = entries.begin(); itr != entries.end(); ++itr)
+   {
+      if (out != entries.begin() && std::prev(out)->first == itr->first)
+         std::prev(out)->second += itr->second;
+      else
+         *out++ = *itr;
+   }
+   entries.erase(out, entries.end());
+}
+
+template<typename Lambda>
+static void update_active_post_receiptor(database& db,
+                                         const active_post_object& active_post,
+                                         account_uid_type receiptor,
+                                         const Lambda& update)
+{
+   if (const auto* receipts = db.find_active_post_receiptor(active_post.get_id(), receiptor))
+   {
+      db.modify(*receipts, update);
+      return;
+   }
+   db.create<active_post_receiptor_object>([&](active_post_receiptor_object& r)
+   {
+      r.active_post = active_post.get_id();
+      r.receiptor = receiptor;
+      update(r);
+   });
+   db.modify(active_post, [](active_post_object& act) { ++act.receiptor_count; });
+}
+
+void database::add_active_post_receipts(const active_post_object& active_post,
+                                        account_uid_type receiptor,
+                                        share_type post_award,
+                                        share_type forward)
+{
+   update_active_post_receiptor(*this, active_post, receiptor, [&](active_post_receiptor_object& r)
+   {
+      r.forward += forward;
+      r.post_award += post_award;
+   });
+}
+
+void database::add_active_post_reward_receipts(const active_post_object& active_post, account_uid_type receiptor, asset reward)
+{
+   update_active_post_receiptor(*this, active_post, receiptor, [&](active_post_receiptor_object& r)
+   {
+      r.rewards[reward.asset_id] += reward.amount;
+   });
+}
+
+void database::add_platform_period_profits(const platform_object& platform,
+                                           uint32_t   period,
+                                           asset      reward_profit,
+                                           share_type forward_profit,
+                                           share_type post_profit,
+                                           share_type platform_profit,
+                                           share_type post_profit_by_platform)
+{
+   auto update = [&](platform_period_profit_object& p)
+   {
+      if (reward_profit != asset())
+         p.rewards_profits[reward_profit.asset_id] += reward_profit.amount;
+      p.foward_profits   += forward_profit;
+      p.post_profits     += post_profit;
+      p.platform_profits += platform_profit;
+      p.post_profits_by_platform += post_profit_by_platform;
+   };
+
+   if (const auto* profit = find_platform_period_profit(platform.id, period))
+   {
+      modify(*profit, update);
+      return;
+   }
+
+   const auto& idx = get_index_type<platform_period_profit_index>().indices().get<by_platform_period>();
+   auto range = idx.equal_range(std::make_tuple(platform.get_id()));
+   if (range.first != range.second && (uint32_t)std::distance(range.first, range.second) >= _latest_active_post_periods)
+      remove(*range.first);
+   create<platform_period_profit_object>([&](platform_period_profit_object& p)
+   {
+      p.platform = platform.id;
+      p.period_sequence = period;
+      update(p);
+   });
+}
+
+void database::add_platform_vote_profit(const platform_object& platform, time_point_sec award_time, share_type profit)
+{
+   const auto& idx = get_index_type<platform_vote_profit_index>().indices().get<by_platform_award_time>();
+   auto range = idx.equal_range(std::make_tuple(platform.get_id()));
+   if (range.first != range.second && (uint32_t)std::distance(range.first, range.second) >= _latest_active_post_periods)
+      remove(*range.first);
+   create<platform_vote_profit_object>([&](platform_vote_profit_object& p)
+   {
+      p.platform = platform.id;
+      p.award_time = award_time;
+      p.profit = profit;
+   });
+}
+
+share_type database::pay_content_award_payouts(uint64_t period_sequence, content_award_payouts& payouts)
+{
+   share_type actual_awards = 0;
+
+   for (const auto& p : payouts.platform_receiptor_award)
+   {
+      ///adjust_balance(p.first, asset(p.second.first));
+      if (auto platform = find_platform_by_owner(p.first))
+      {
+         add_platform_period_profits(*platform, period_sequence, asset(), 0, p.second.first, 0, p.second.second);
+      }
+   }
+
+   //registrar and referrer bonus from score earning
+   payouts.registrar_and_referrer_award.sum_by_account();
+   account_amounts bonus_map;
+   for (const auto& r : payouts.registrar_and_referrer_award.entries)
+   {
+      const auto& account_obj = get_account_by_uid(r.first);
+      share_type to_registrar = ((uint128_t)r.second.value * account_obj.reg_info.registrar_percent
+         / GRAPHENE_100_PERCENT).to_uint64();
+      bonus_map.add(account_obj.reg_info.registrar, to_registrar);
+      bonus_map.add(account_obj.reg_info.referrer, r.second - to_registrar);
+   }
+   bonus_map.sum_by_account();
+   for (const auto& r : bonus_map.entries)
+   {
+      modify(get_account_statistics_by_uid(r.first), [&](_account_statistics_object& s)
+      {
+         s.uncollected_score_bonus += r.second;
+      });
+      actual_awards += r.second;
+   }
+
+   payouts.adjust_balance_map.sum_by_account();
+   for (const auto& a : payouts.adjust_balance_map.entries)
+   {
+      actual_awards += a.second;
+      adjust_balance(a.first, asset(a.second));
+   }
+
+   return actual_awards;
+}
+
+void database::award_content_platforms(uint64_t period_sequence,
+                                       uint128_t platform_award_amount,
+                                       share_type total_csaf_amount,
+                                       const flat_map<account_uid_type, share_type>& platform_csaf_amount,
+                                       content_award_payouts& payouts)
+{
+   for (const auto& p : platform_csaf_amount)
+   {
+      share_type to_add = (platform_award_amount * p.second.value /
+         total_csaf_amount.value).to_uint64();
+      ///adjust_balance(p.first, asset(to_add));
+      payouts.adjust_balance_map.add(p.first, to_add);
+
+      if (auto platform = find_platform_by_owner(p.first))
+      {
+         add_platform_period_profits(*platform, period_sequence, asset(), 0, 0, to_add);
+      }
+   }
+}
+
+void database::begin_content_award_settlement()
+{
+   const dynamic_global_property_object& dpo = get_dynamic_global_properties();
+   const auto& params = get_global_properties().parameters.extension_parameters;
+   const auto period_seconds = (dpo.next_content_award_time - dpo.last_content_award_time).to_seconds();
+
+   const auto& apt_idx = get_index_type<active_post_index>().indices().get<by_period_sequence>();
+   auto apt_itr = apt_idx.lower_bound(dpo.current_active_post_sequence);
+   if (apt_itr == apt_idx.end() || apt_itr->period_sequence != dpo.current_active_post_sequence)
+      return; // nothing to award
+
+   auto update = [&](content_award_settlement_object& s)
+   {
+      s.stage = content_award_settlement_object::scanning;
+      s.period_sequence = dpo.current_active_post_sequence;
+      s.first_post = apt_itr->id;
+      s.next_post = apt_itr->id;
+      s.content_award_amount = 0;
+      if (params.total_content_award_amount > 0)
+         s.content_award_amount = ((uint128_t)(params.total_content_award_amount.value) * period_seconds / (86400 * 365)).to_uint64();
+      s.platform_award_amount = 0;
+      if (params.total_platform_content_award_amount > 0)
+         s.platform_award_amount = ((uint128_t)(params.total_content_award_amount.value) * period_seconds / (86400 * 365)).to_uint64();
+      s.total_csaf_amount = 0;
+      s.total_effective_csaf_amount = 0;
+      s.platform_csaf_amount.clear();
+   };
+
+   if (const auto* settlement = find(content_award_settlement_id_type()))
+   {
+      FC_ASSERT(!settlement->is_settling(), "the previous content awards should have been settled");
+      modify(*settlement, update);
+   }
+   else
+      create<content_award_settlement_object>(update);
+}
+
+void database::settle_content_awards(uint32_t max_posts)
+{
+   const content_award_settlement_object* settlement = find(content_award_settlement_id_type());
+   if (settlement == nullptr || !settlement->is_settling())
+      return;
+
+   const auto& params = get_global_properties().parameters.extension_parameters;
+   const auto& apt_idx = get_index_type<active_post_index>().indices().get<by_id>();
+   auto apt_itr = apt_idx.lower_bound(settlement->next_post);
+   auto in_period = [&]() -> bool {
+      return apt_itr != apt_idx.end() && apt_itr->period_sequence == settlement->period_sequence;
+   };
+
+   if (settlement->stage == content_award_settlement_object::scanning)
+   {
+      share_type total_csaf_amount = 0;
+      share_type total_effective_csaf_amount = 0;
+      detail::content_award_platforms platforms(*this, params.platform_content_award_min_votes);
+      vector<const active_post_object*> effective_posts;
+      for (; max_posts > 0 && in_period(); ++apt_itr, --max_posts)
+      {
+         if (!platforms.is_eligible(apt_itr->platform))
+            continue;
+
+         if (apt_itr->total_csaf >= params.min_effective_csaf)
+            effective_posts.push_back(&(*apt_itr));
+
+         platforms.add_csaf(apt_itr->platform, apt_itr->total_csaf);
+         total_csaf_amount += apt_itr->total_csaf;
+      }
+
+      const vector<share_type> approvals = get_post_approval_csafs(effective_posts);
+      for (size_t i = 0; i < effective_posts.size(); ++i)
+      {
+         share_type csaf = effective_posts[i]->total_csaf + approvals[i];
+         if (csaf > 0)
+         {
+            total_effective_csaf_amount += csaf;
+            modify(*effective_posts[i], [&](active_post_object& act)
+            {
+               act.effective_csaf = csaf;
+               act.approval_amount = approvals[i];
+            });
+         }
+      }
+
+      const bool scanned = !in_period();
+      const auto platform_csaf_amount = platforms.csaf_by_platform();
+      modify(*settlement, [&](content_award_settlement_object& s)
+      {
+         s.total_csaf_amount += total_csaf_amount;
+         s.total_effective_csaf_amount += total_effective_csaf_amount;
+         for (const auto& p : platform_csaf_amount)
+            s.platform_csaf_amount[p.first] += p.second;
+         if (scanned)
+         {
+            s.stage = content_award_settlement_object::paying;
+            s.next_post = s.first_post;
+         }
+         else
+            s.next_post = apt_itr->id;
+      });
+      if (!scanned)
+         return;
+      apt_itr = apt_idx.lower_bound(settlement->next_post);
+   }
+
+   content_award_payouts payouts;
+   if (settlement->content_award_amount > 0 && settlement->total_effective_csaf_amount > 0)
+   {
+      content_award_totals totals;
+      totals.content_award_amount = (uint128_t)settlement->content_award_amount.value;
+      totals.total_effective_csaf_amount = settlement->total_effective_csaf_amount;
+      const auto award_post = get_hardfork_rules().head_fork_05 ? &database::award_content_post<true>
+                                                                : &database::award_content_post<false>;
+      for (; max_posts > 0 && in_period(); ++apt_itr, --max_posts)
+      {
+         if (apt_itr->effective_csaf > 0)
+            (this->*award_post)(*apt_itr, apt_itr->effective_csaf, apt_itr->approval_amount, totals, payouts);
+      }
+   }
+   else
+      apt_itr = apt_idx.end();
+
+   const bool paid = !in_period();
+   if (paid && settlement->platform_award_amount > 0 && settlement->total_csaf_amount > 0)
+      award_content_platforms(settlement->period_sequence, (uint128_t)settlement->platform_award_amount.value,
+                              settlement->total_csaf_amount, settlement->platform_csaf_amount, payouts);
+
+   share_type actual_awards = pay_content_award_payouts(settlement->period_sequence, payouts);
+   if (actual_awards > 0)
+   {
+      modify_dynamic_global_properties( [&](dynamic_global_property_object& _dpo)
+      {
+         _dpo.budget_pool -= actual_awards;
+      });
+   }
+
+   modify(*settlement, [&](content_award_settlement_object& s)
+   {
+      if (paid)
+      {
+         s.stage = content_award_settlement_object::idle;
+         s.platform_csaf_amount.clear();
+      }
+      else
+         s.next_post = apt_itr->id;
+   });
+}
+
 void database::process_content_platform_awards()
 { 
+   // continue the settlement of the previous period, if there is one
+   settle_content_awards(GRAPHENE_CONTENT_AWARD_POSTS_PER_BLOCK);
+
    const dynamic_global_property_object& dpo = get_dynamic_global_properties();
    const auto block_time = head_block_time();
    if (block_time >= dpo.next_content_award_time)
    {
+      // a period can only end once the previous one is settled
+      settle_content_awards(uint32_t(-1));
+
       const global_property_object& gpo = get_global_properties();
       const auto& params = gpo.parameters.get_extension_params();
 
@@ -1737,7 +2620,7 @@ void database::process_content_platform_awards()
          if (dpo.next_content_award_time != time_point_sec(0))
          {
             clear_active_post();
-            modify(dpo, [&](dynamic_global_property_object& _dpo)
+            modify_dynamic_global_properties( [&](dynamic_global_property_object& _dpo)
             {
                _dpo.last_content_award_time = time_point_sec(0);
                _dpo.next_content_award_time = time_point_sec(0);
@@ -1750,7 +2633,7 @@ void database::process_content_platform_awards()
       if (dpo.next_content_award_time == time_point_sec(0))//start platform and post award
       {
          clear_active_post();
-         modify(dpo, [&](dynamic_global_property_object& _dpo)
+         modify_dynamic_global_properties( [&](dynamic_global_property_object& _dpo)
          {
             _dpo.last_content_award_time = block_time;
             _dpo.next_content_award_time = block_time + params.content_award_interval;
@@ -1761,9 +2644,10 @@ void database::process_content_platform_awards()
       }
 
       share_type actual_awards = 0;
+      const hardfork_rules rules = get_hardfork_rules();
 
       bool can_award = false;
-      if (dpo.enabled_hardfork_version >= ENABLE_HEAD_FORK_05)
+      if (rules.head_fork_05)
       {
          fc::uint128_t award_two_periods = (fc::uint128_t)(params.total_content_award_amount + params.total_platform_content_award_amount).value*2*
             (dpo.next_content_award_time - dpo.last_content_award_time).to_seconds() / (86400 * 365);
@@ -1772,212 +2656,75 @@ void database::process_content_platform_awards()
          can_award = dpo.budget_pool >= (params.total_content_award_amount + params.total_platform_content_award_amount);
       }    
 
-      if (can_award)
+      if (can_award && rules.after_0_6_time)
+      {
+         // paid by the next blocks, see settle_content_awards()
+         begin_content_award_settlement();
+      }
+      else if (can_award)
       {
          //notify witness plugin skip block
-         modify(dpo, [&](dynamic_global_property_object& _dpo)
+         modify_dynamic_global_properties( [&](dynamic_global_property_object& _dpo)
          {
             _dpo.content_award_skip_flag = true;
          });
 
          share_type total_csaf_amount = 0;
          share_type total_effective_csaf_amount = 0;
-         map<account_uid_type, share_type> platform_csaf_amount;
-         //<active post object, post effective csaf, (csaf * score / 5)*modulus>
-         vector<std::tuple<active_post_object*, share_type, share_type>> post_effective_casf;
+         detail::content_award_platforms platforms(*this, params.platform_content_award_min_votes);
+         struct effective_post
+         {
+            const active_post_object* post;
+            share_type                effective_csaf;
+            share_type                approval_csaf; ///< (csaf * score / 5)*modulus
+         };
+         vector<effective_post> post_effective_casf;
+         vector<const active_post_object*> effective_posts;
 
          const auto& apt_idx = get_index_type<active_post_index>().indices().get<by_period_sequence>();
          auto apt_itr = apt_idx.lower_bound(dpo.current_active_post_sequence);
          while (apt_itr != apt_idx.end() && apt_itr->period_sequence == dpo.current_active_post_sequence)
          {
-            if (dpo.enabled_hardfork_version >= ENABLE_HEAD_FORK_05) 
+            if (rules.head_fork_05 && !platforms.is_eligible(apt_itr->platform))
             {
-               const platform_object* pla = find_platform_by_owner(apt_itr->platform);
-               if (pla == nullptr || !pla->is_valid || pla->total_votes < params.platform_content_award_min_votes) 
-               {
-                  ++apt_itr;
-                  continue;
-               }  
+               ++apt_itr;
+               continue;
             }
 
             if (apt_itr->total_csaf >= params.min_effective_csaf)
-            {
-               const auto& idx = get_index_type<score_index>().indices().get<by_period_sequence>();
-               auto itr = idx.lower_bound(std::make_tuple(apt_itr->platform, apt_itr->poster, apt_itr->post_pid, apt_itr->period_sequence));
+               effective_posts.push_back(&(*apt_itr));
 
-               boost::multiprecision::int128_t approval_amount = 0;
-               while (itr != idx.end() && itr->platform == apt_itr->platform && itr->poster == apt_itr->poster &&
-                  itr->post_pid == apt_itr->post_pid && itr->period_sequence == apt_itr->period_sequence)
-               {
-                  approval_amount += (boost::multiprecision::int128_t)itr->csaf.value * itr->score * params.casf_modulus
-                     / (5 * GRAPHENE_100_PERCENT);
-                  ++itr;
-               }
-               share_type csaf = apt_itr->total_csaf + approval_amount.convert_to<int64_t>();
-               if (csaf > 0)
-               {
-                  total_effective_csaf_amount += csaf;
-                  post_effective_casf.emplace_back(std::make_tuple((active_post_object*)&(*apt_itr), csaf, approval_amount.convert_to<int64_t>()));
-               }
-            }
-
-            if (platform_csaf_amount.find(apt_itr->platform) != platform_csaf_amount.end())
-               platform_csaf_amount.at(apt_itr->platform) += apt_itr->total_csaf;
-            else
-               platform_csaf_amount.emplace(apt_itr->platform, apt_itr->total_csaf);
+            platforms.add_csaf(apt_itr->platform, apt_itr->total_csaf);
             total_csaf_amount += apt_itr->total_csaf;
 
             ++apt_itr;
          }
 
-         std::map<account_uid_type, share_type> adjust_balance_map;
+         const vector<share_type> approvals = get_post_approval_csafs(effective_posts);
+         for (size_t i = 0; i < effective_posts.size(); ++i)
+         {
+            share_type csaf = effective_posts[i]->total_csaf + approvals[i];
+            if (csaf > 0)
+            {
+               total_effective_csaf_amount += csaf;
+               post_effective_casf.push_back({ effective_posts[i], csaf, approvals[i] });
+            }
+         }
+
+         content_award_payouts payouts;
 
          if (params.total_content_award_amount > 0 && total_effective_csaf_amount > 0)
          {
             //compute per period award amount 
-            uint128_t content_award_amount_per_period = (uint128_t)(params.total_content_award_amount.value) *
+            content_award_totals totals;
+            totals.content_award_amount = (uint128_t)(params.total_content_award_amount.value) *
                (dpo.next_content_award_time - dpo.last_content_award_time).to_seconds() / (86400 * 365);
+            totals.total_effective_csaf_amount = total_effective_csaf_amount;
 
-            flat_map<account_uid_type, std::pair<share_type, share_type>> platform_receiptor_award;
-            std::map<account_uid_type, share_type> registrar_and_referrer_award;
-            for (auto itr = post_effective_casf.begin(); itr != post_effective_casf.end(); ++itr)
-            {
-               share_type post_earned = (content_award_amount_per_period * std::get<1>(*itr).value /
-                  total_effective_csaf_amount.value).to_uint64();
-               share_type score_earned = 0;
-               share_type receiptor_earned = 0;
-               if (dpo.enabled_hardfork_version < ENABLE_HEAD_FORK_05)
-                  score_earned = ((uint128_t)post_earned.value * GRAPHENE_DEFAULT_SCORE_RECEIPTS_RATIO / GRAPHENE_100_PERCENT).to_uint64();
-               else
-                  score_earned = ((uint128_t)post_earned.value * params.scorer_earnings_rate / GRAPHENE_100_PERCENT).to_uint64(); 
-               if (std::get<2>(*itr) >= 0)
-                  receiptor_earned = post_earned - score_earned;
-               else
-                  receiptor_earned = ((uint128_t)((post_earned - score_earned).value)*params.receiptor_award_modulus / GRAPHENE_100_PERCENT).to_uint64();
-
-               const auto& post = get_post_by_platform(std::get<0>(*itr)->platform, std::get<0>(*itr)->poster, std::get<0>(*itr)->post_pid);
-               share_type temp = receiptor_earned;
-               flat_map<account_uid_type, share_type> receiptor;
-               for (const auto& r : post.receiptors)
-               {
-                  if (r.first == post.platform)
-                     continue;
-                  share_type to_add = ((uint128_t)receiptor_earned.value * r.second.cur_ratio / GRAPHENE_100_PERCENT).to_uint64();
-
-                  ///adjust_balance(r.first, asset(to_add));
-                  adjust_balance_map[r.first] += to_add;
-                  receiptor.emplace(r.first, to_add);
-                  temp -= to_add;
-               }
-               adjust_balance_map[post.platform] += temp;
-               receiptor.emplace(post.platform, temp);
-
-               share_type award_only_from_platform;
-               if (post.poster == post.platform)
-                  award_only_from_platform = ((uint128_t)receiptor_earned.value * GRAPHENE_DEFAULT_PLATFORM_RECEIPTS_RATIO /
-                  GRAPHENE_100_PERCENT).to_uint64();
-               else
-                  award_only_from_platform = temp;
-               if (platform_receiptor_award.count(post.platform))
-               {
-                  platform_receiptor_award.at(post.platform).first += temp;
-                  platform_receiptor_award.at(post.platform).second += award_only_from_platform;
-               }
-               else
-               {
-                  platform_receiptor_award.emplace(post.platform, std::make_pair(temp, award_only_from_platform));
-               }
-
-               modify(*(std::get<0>(*itr)), [&](active_post_object& act)
-               {
-                  act.positive_win = std::get<2>(*itr) >= 0;
-                  act.post_award = receiptor_earned;
-                  for (const auto& r : receiptor)
-                     act.insert_receiptor(r.first, r.second);
-               });
-
-               if (post.score_settlement)
-                  continue;
-               //result <set<score id, effective csaf for the score, is or not approve>, total effective csaf to award>
-               auto result = get_effective_csaf(*(std::get<0>(*itr)));
-               uint128_t total_award_csaf = (uint128_t)std::get<1>(result).value;
-               share_type actual_score_earned = 0;
-               for (const auto& e : std::get<0>(result))
-               {
-                  uint128_t effective_csaf_per_account = (uint128_t)std::get<1>(e).value;
-                  share_type to_add = 0;
-                  if (std::get<2>(*itr) < 0 && !std::get<2>(e))
-                     to_add = (effective_csaf_per_account * score_earned.value * params.disapprove_award_modulus /
-                     (total_award_csaf * GRAPHENE_100_PERCENT)).to_uint64();
-                  else
-                     to_add = (effective_csaf_per_account * score_earned.value / total_award_csaf).to_uint64();
-                  const auto& score_obj = get(std::get<0>(e));
-                  modify(score_obj, [&](score_object& obj)
-                  {
-                     obj.profits = to_add;
-                  });
-
-                  //registrar and referrer get part of earning
-                  if (dpo.enabled_hardfork_version >= ENABLE_HEAD_FORK_05)
-                  {
-                     share_type to_registrar_and_referrer = ((uint128_t)to_add.value * params.registrar_referrer_rate_from_score / GRAPHENE_100_PERCENT).to_uint64();
-                     registrar_and_referrer_award[score_obj.from_account_uid] += to_registrar_and_referrer;
-                     adjust_balance_map[score_obj.from_account_uid] += (to_add - to_registrar_and_referrer);
-                  }
-                  else
-                     adjust_balance_map[score_obj.from_account_uid] += to_add;
-
-                  actual_score_earned += to_add;
-               }
-
-               modify(*(std::get<0>(*itr)), [&](active_post_object& act)
-               {
-                  act.post_award = actual_score_earned + receiptor_earned;
-               });
-
-               modify(post, [&](post_object& act)
-               {
-                  act.score_settlement = true;
-               });
-            }
-
-            for (const auto& p : platform_receiptor_award)
-            {
-               ///adjust_balance(p.first, asset(p.second.first));
-               if (auto platform = find_platform_by_owner(p.first))
-               {
-                  modify(*platform, [&](platform_object& pla)
-                  {
-                     pla.add_period_profits(
-                        dpo.current_active_post_sequence,
-                        _latest_active_post_periods,
-                        asset(),
-                        0,
-                        p.second.first,
-                        0,
-                        p.second.second);
-                  });
-               }
-            }
-
-            //registrar and referrer bonus from score earning
-            map<account_uid_type, share_type> bonus_map;
-            for (const auto& r : registrar_and_referrer_award)
-            {
-               auto account_obj = get_account_by_uid(r.first);
-               share_type to_registrar = ((uint128_t)r.second.value * account_obj.reg_info.registrar_percent
-                  / GRAPHENE_100_PERCENT).to_uint64();
-               bonus_map[account_obj.reg_info.registrar] += to_registrar;
-               bonus_map[account_obj.reg_info.referrer] += (r.second - to_registrar);
-            }
-            for (const auto& r : bonus_map)
-            {
-               modify(get_account_statistics_by_uid(r.first), [&](_account_statistics_object& s)
-               {
-                  s.uncollected_score_bonus += r.second;
-               });
-               actual_awards += r.second;
-            }
+            const auto award_post = rules.head_fork_05 ? &database::award_content_post<true>
+                                                       : &database::award_content_post<false>;
+            for (const auto& e : post_effective_casf)
+               (this->*award_post)(*e.post, e.effective_csaf, e.approval_csaf, totals, payouts);
          }
 
          if (params.total_platform_content_award_amount > 0 && total_csaf_amount > 0)
@@ -1986,37 +2733,14 @@ void database::process_content_platform_awards()
             uint128_t content_platform_award_amount_per_period = (uint128_t)(params.total_content_award_amount.value) *
                (dpo.next_content_award_time - dpo.last_content_award_time).to_seconds() / (86400 * 365);
 
-            for (const auto& p : platform_csaf_amount)
-            {
-               share_type to_add = (content_platform_award_amount_per_period * p.second.value /
-                  total_csaf_amount.value).to_uint64();
-               ///adjust_balance(p.first, asset(to_add));
-               adjust_balance_map[p.first] += to_add;
-
-               if (auto platform = find_platform_by_owner(p.first))
-               {
-                  modify(*platform, [&](platform_object& pla)
-                  {
-                     pla.add_period_profits(
-                        dpo.current_active_post_sequence,
-                        _latest_active_post_periods,
-                        asset(),
-                        0,
-                        0,
-                        to_add);
-                  });
-               }
-            }
+            award_content_platforms(dpo.current_active_post_sequence, content_platform_award_amount_per_period,
+                                    total_csaf_amount, platforms.csaf_by_platform(), payouts);
          }
 
-         for (const auto& a : adjust_balance_map)
-         {
-            actual_awards += a.second;
-            adjust_balance(a.first, asset(a.second));
-         }
+         actual_awards = pay_content_award_payouts(dpo.current_active_post_sequence, payouts);
       }
 
-      modify(dpo, [&](dynamic_global_property_object& _dpo)
+      modify_dynamic_global_properties( [&](dynamic_global_property_object& _dpo)
       {
          _dpo.last_content_award_time = block_time;
          _dpo.next_content_award_time = block_time + params.content_award_interval;
@@ -2030,7 +2754,7 @@ void database::process_content_platform_awards()
    }
    else if (dpo.content_award_skip_flag)
    {
-      modify(dpo, [&](dynamic_global_property_object& _dpo)
+      modify_dynamic_global_properties( [&](dynamic_global_property_object& _dpo)
       {
          _dpo.content_award_skip_flag = false;
       });
@@ -2061,7 +2785,8 @@ void database::process_platform_voted_awards()
 
          if (dpo.next_platform_voted_award_time > time_point_sec(0) && can_award)
          {
-            flat_map<account_uid_type, uint64_t> platforms;
+            // platform => votes, in the order of the owners
+            vector<std::pair<const platform_object*, uint64_t>> platforms;
 
             uint128_t total_votes = 0;
             const auto& pla_idx = get_index_type<platform_index>().indices().get<by_platform_votes>();
@@ -2072,11 +2797,15 @@ void database::process_platform_voted_awards()
                if (pla_itr->total_votes < params.platform_award_min_votes)
                   break;
                //a account only has a platform
-               platforms.emplace(pla_itr->owner, pla_itr->total_votes);
+               platforms.emplace_back(&(*pla_itr), pla_itr->total_votes);
                total_votes += pla_itr->total_votes;
                ++pla_itr;
                --limit;
             }
+            std::sort(platforms.begin(), platforms.end(),
+                      [](const std::pair<const platform_object*, uint64_t>& a, const std::pair<const platform_object*, uint64_t>& b) {
+                         return a.first->owner < b.first->owner;
+                      });
             if (platforms.size() > 0)
             {
                //compute per period award amount 
@@ -2085,37 +2814,30 @@ void database::process_platform_voted_awards()
 
                share_type platform_award_basic = (value * params.platform_award_basic_rate / GRAPHENE_100_PERCENT).to_uint64();
                share_type platform_average_award_basic = platform_award_basic / platforms.size();
-               flat_map<account_uid_type, share_type> platform_award;
-               for (const auto& p : platforms)
-                  platform_award.emplace(p.first, platform_average_award_basic);
+               vector<share_type> platform_award(platforms.size(), platform_average_award_basic);
                actual_awards = platform_average_award_basic * platforms.size();
 
                if (total_votes > 0)
                {
                   share_type platform_award_by_votes = value.to_uint64() - platform_award_basic;
-                  for (const auto& p : platforms)
+                  for (size_t i = 0; i < platforms.size(); ++i)
                   {
-                     share_type to_add = ((uint128_t)platform_award_by_votes.value * p.second / total_votes).to_uint64();
+                     share_type to_add = ((uint128_t)platform_award_by_votes.value * platforms[i].second / total_votes).to_uint64();
                      actual_awards += to_add;
-                     platform_award.at(p.first) += to_add;
+                     platform_award[i] += to_add;
                   }
                }
 
-               for (const auto& p : platform_award)
+               for (size_t i = 0; i < platforms.size(); ++i)
                {
-                  adjust_balance(p.first, asset(p.second));
-                  const auto& platform = get_platform_by_owner(p.first);
-                  modify(platform, [&](platform_object& pla)
-                  {
-                     if (pla.vote_profits.size() >= _latest_active_post_periods)
-                        pla.vote_profits.erase(pla.vote_profits.begin());
-                     pla.vote_profits.emplace(block_time, p.second);
-                  });
+                  const platform_object& platform = *platforms[i].first;
+                  adjust_balance(platform.owner, asset(platform_award[i]));
+                  add_platform_vote_profit(platform, block_time, platform_award[i]);
                }
             }
          }
 
-         modify(dpo, [&](dynamic_global_property_object& _dpo)
+         modify_dynamic_global_properties( [&](dynamic_global_property_object& _dpo)
          {
             _dpo.last_platform_voted_award_time = block_time;
             _dpo.next_platform_voted_award_time = block_time + params.platform_award_interval;
@@ -2127,7 +2849,7 @@ void database::process_platform_voted_awards()
       }
       else if (dpo.next_platform_voted_award_time != time_point_sec(0))
       {
-         modify(dpo, [&](dynamic_global_property_object& _dpo)
+         modify_dynamic_global_properties( [&](dynamic_global_property_object& _dpo)
          {
             _dpo.last_platform_voted_award_time = time_point_sec(0);
             _dpo.next_platform_voted_award_time = time_point_sec(0);
@@ -2139,12 +2861,12 @@ void database::process_platform_voted_awards()
 void database::process_pledge_balance_release()
 {
    const auto head_num = head_block_num();
-   const auto& pledge_idx = get_index_type<pledge_balance_index>().indices().get<by_earliest_release_block_number>();
+   const auto& pledges = dynamic_cast<const primary_index<pledge_balance_index>&>( get_index_type<pledge_balance_index>() );
 
-   //release pledge balance 
-   auto itr_pledge = pledge_idx.begin();
-   while (itr_pledge != pledge_idx.end() && itr_pledge->earliest_release_block_number() <= head_num)
+   //release pledge balance, the releases of each object are all handled at once so the ids taken stay valid
+   for (const pledge_balance_id_type id : pledges.get_secondary_index<pledge_release_queue_index>().due_until(head_num))
    {
+      const pledge_balance_object* itr_pledge = &id(*this);
       const dynamic_global_property_object& dpo = get_dynamic_global_properties();
       if (dpo.enabled_hardfork_version == ENABLE_HEAD_FORK_04 && itr_pledge->type == pledge_balance_type::Witness){
          const uint64_t csaf_window = get_global_properties().parameters.csaf_accumulate_window;
@@ -2184,9 +2906,70 @@ void database::process_pledge_balance_release()
          }
          remove(*itr_pledge);
       }
-
-      itr_pledge = pledge_idx.begin();
    }
 }
 
+database::dynamic_global_property_batch::dynamic_global_property_batch( database& db )
+   : _db( db ), _owner( !db._batching_dynamic_global_properties )
+{
+   if( !_owner )
+      return;
+   // copied right away, so that every reference got from get_dynamic_global_properties() in the batch is the copy
+   _db._batched_dynamic_global_properties = _db.get_dynamic_global_properties();
+   _db._batched_dynamic_global_properties_changed = false;
+   _db._batching_dynamic_global_properties = true;
+}
+
+database::dynamic_global_property_batch::~dynamic_global_property_batch()
+{
+   if( !_owner )
+      return;
+   _db._batched_dynamic_global_properties.reset();
+   _db._batching_dynamic_global_properties = false;
+}
+
+void database::dynamic_global_property_batch::flush()
+{
+   if( !_owner )
+      return;
+   _db.write_batched_dynamic_global_properties();
+   _db._batching_dynamic_global_properties = false;
+   _owner = false;
+}
+
+database::dynamic_global_property_batch_pause::dynamic_global_property_batch_pause( database& db )
+   : _db( db ), _paused( db._batching_dynamic_global_properties )
+{
+   if( !_paused )
+      return;
+   _db.write_batched_dynamic_global_properties();
+   _db._batching_dynamic_global_properties = false;
+}
+
+database::dynamic_global_property_batch_pause::~dynamic_global_property_batch_pause()
+{
+   if( !_paused )
+      return;
+   // copied again in the same place, the references to the copy got before the pause see the current values
+   _db._batched_dynamic_global_properties = _db.get_dynamic_global_properties();
+   _db._batched_dynamic_global_properties_changed = false;
+   _db._batching_dynamic_global_properties = true;
+}
+
+void database::write_batched_dynamic_global_properties()
+{
+   if( !_batched_dynamic_global_properties.valid() )
+      return;
+   // forgotten first, so that get_dynamic_global_properties() finds the object itself
+   const dynamic_global_property_object batched = std::move( *_batched_dynamic_global_properties );
+   _batched_dynamic_global_properties.reset();
+   if( !_batched_dynamic_global_properties_changed )
+      return;
+   _batched_dynamic_global_properties_changed = false;
+   modify( get_dynamic_global_properties(), [&]( dynamic_global_property_object& dpo )
+   {
+      dpo = batched;
+   } );
+}
+
 } }
@@ -90,17 +90,15 @@ void database::adjust_voter_votes( const voter_object& voter, share_type delta )
 {
    const auto max_level = get_global_properties().parameters.max_governance_voting_proxy_level;
 
-   const voter_object* current_voter = &voter;
-   uint8_t level = 0;
-   while( current_voter->proxy_uid != GRAPHENE_PROXY_TO_SELF_ACCOUNT_UID && level < max_level )
+   const vector<const voter_object*> chain = _voter_proxy_index->proxy_chain( voter, max_level );
+   for( uint8_t level = 0; level < chain.size(); ++level )
    {
-      current_voter = find_voter( current_voter->proxy_uid, current_voter->proxy_sequence );
-      modify( *current_voter, [&]( voter_object& v )
+      modify( *chain[level], [&]( voter_object& v )
       {
          v.proxied_votes[level] += delta.value;
       } );
-      ++level;
    }
+   const voter_object* current_voter = chain.empty() ? &voter : chain.back();
 
    if( current_voter->proxy_uid == GRAPHENE_PROXY_TO_SELF_ACCOUNT_UID )
    {
@@ -221,25 +219,24 @@ void database::adjust_voter_proxy_votes( const voter_object& voter, vector<share
 {
    const auto max_level = get_global_properties().parameters.max_governance_voting_proxy_level;
 
-   const voter_object* current_voter = &voter;
-   uint8_t level = 0;
+   const vector<const voter_object*> chain = _voter_proxy_index->proxy_chain( voter, max_level );
    vector<const voter_object*> vec;
    if( update_last_vote )
-      vec.push_back( current_voter );
-   while( level < max_level )
    {
-      current_voter = find_voter( current_voter->proxy_uid, current_voter->proxy_sequence );
-      if( update_last_vote )
-         vec.push_back( current_voter );
-      modify( *current_voter, [&]( voter_object& v )
+      vec.push_back( &voter );
+      vec.insert( vec.end(), chain.begin(), chain.end() );
+   }
+   for( uint8_t level = 0; level < chain.size(); ++level )
+   {
+      modify( *chain[level], [&]( voter_object& v )
       {
          for( uint8_t j = level; j < max_level; ++j )
             v.proxied_votes[j] += delta[j-level].value;
       } );
-      if( current_voter->proxy_uid == GRAPHENE_PROXY_TO_SELF_ACCOUNT_UID )
-         break;
-      ++level;
    }
+   const voter_object* current_voter = chain.empty() ? &voter : chain.back();
+   // the level of the last proxy, which votes itself if its chain ends before max_level
+   const uint8_t level = chain.empty() ? 0 : chain.size() - 1;
 
    if( update_last_vote )
    {
@@ -518,10 +515,59 @@ void database::adjust_committee_member_votes( const committee_member_object& com
    if( delta == 0 || !committee_member.is_valid )
       return;
 
+   if( _batching_candidate_votes )
+      _batched_committee_member_votes[ committee_member.id ] += delta;
+   else
+      apply_committee_member_votes( committee_member, delta );
+}
+
+void database::apply_committee_member_votes( const committee_member_object& committee_member, share_type delta )
+{
    modify( committee_member, [&]( committee_member_object& w )
    {
       w.total_votes += delta.value;
    } );
 }
 
+database::candidate_vote_batch::candidate_vote_batch( database& db )
+   : _db( db ), _owner( !db._batching_candidate_votes )
+{
+   _db._batching_candidate_votes = true;
+}
+
+database::candidate_vote_batch::~candidate_vote_batch()
+{
+   if( !_owner )
+      return;
+   _db._batched_witness_votes.clear();
+   _db._batched_platform_votes.clear();
+   _db._batched_committee_member_votes.clear();
+   _db._batching_candidate_votes = false;
+}
+
+void database::candidate_vote_batch::flush()
+{
+   if( !_owner )
+      return;
+   // stop batching first, so that the candidates are modified here
+   _db._batching_candidate_votes = false;
+   // the candidates were valid when the deltas were batched, and nothing in a batched pass invalidates them
+   for( const auto& p : _db._batched_witness_votes )
+      _db.apply_witness_votes( p.first( _db ), p.second );
+   for( const auto& p : _db._batched_platform_votes )
+   {
+      if( p.second != 0 )
+         _db.apply_platform_votes( p.first( _db ), p.second );
+   }
+   for( const auto& p : _db._batched_committee_member_votes )
+   {
+      if( p.second != 0 )
+         _db.apply_committee_member_votes( p.first( _db ), p.second );
+   }
+   _db._batched_witness_votes.clear();
+   _db._batched_platform_votes.clear();
+   _db._batched_committee_member_votes.clear();
+   _owner = false;
+}
+
 } }
@@ -135,26 +135,29 @@ void database::update_witness_schedule()
       // update by_vote_schedule
       if( rest_added > 0 )
       {
+         // check for overflow before modifying any of them, a reset overwrites them all anyway
          bool reset_by_vote_time = false;
          for( auto& wit : by_vote_processed )
          {
-            fc::uint128_t new_time = new_by_vote_time + GRAPHENE_VIRTUAL_LAP_LENGTH / ( wit->total_votes + 1 );
-            if( new_time < new_by_vote_time ) // overflow
+            if( new_by_vote_time + GRAPHENE_VIRTUAL_LAP_LENGTH / ( wit->total_votes + 1 ) < new_by_vote_time )
             {
                reset_by_vote_time = true;
                break;
             }
-            modify( *wit, [&]( witness_object& w )
-            {
-               w.by_vote_position             = fc::uint128_t();
-               w.by_vote_position_last_update = new_by_vote_time;
-               w.by_vote_scheduled_time       = new_time;
-            } );
          }
          if( reset_by_vote_time )
             reset_witness_by_vote_schedule();
          else
          {
+            for( auto& wit : by_vote_processed )
+            {
+               modify_fields<witness_object::vote_schedule_fields>( *wit, [&]( witness_object& w )
+               {
+                  w.by_vote_position             = fc::uint128_t();
+                  w.by_vote_position_last_update = new_by_vote_time;
+                  w.by_vote_scheduled_time       = new_by_vote_time + GRAPHENE_VIRTUAL_LAP_LENGTH / ( w.total_votes + 1 );
+               } );
+            }
             modify( wso, [&](witness_schedule_object& o )
             {
                 o.current_by_vote_time = new_by_vote_time;
@@ -188,27 +191,32 @@ void database::update_witness_schedule()
       // update by_pledge_schedule
       if( pledge_added > 0 )
       {
+         // check for overflow before modifying any of them, a reset overwrites them all anyway
          bool reset_by_pledge_time = false;
          for( auto& wit : by_pledge_processed )
          {
             //total_mining_pledge defalt value is 0 ,so don`t need hardfork logic
-            fc::uint128_t new_time = new_by_pledge_time + GRAPHENE_VIRTUAL_LAP_LENGTH / (wit->average_pledge + wit->total_mining_pledge + 1);
-            if( new_time < new_by_pledge_time ) // overflow
+            if( new_by_pledge_time + GRAPHENE_VIRTUAL_LAP_LENGTH / (wit->average_pledge + wit->total_mining_pledge + 1)
+                  < new_by_pledge_time )
             {
                reset_by_pledge_time = true;
                break;
             }
-            modify( *wit, [&]( witness_object& w )
-            {
-               w.by_pledge_position             = fc::uint128_t();
-               w.by_pledge_position_last_update = new_by_pledge_time;
-               w.by_pledge_scheduled_time       = new_time;
-            } );
          }
          if( reset_by_pledge_time )
             reset_witness_by_pledge_schedule();
          else
          {
+            for( auto& wit : by_pledge_processed )
+            {
+               modify_fields<witness_object::pledge_schedule_fields>( *wit, [&]( witness_object& w )
+               {
+                  w.by_pledge_position             = fc::uint128_t();
+                  w.by_pledge_position_last_update = new_by_pledge_time;
+                  w.by_pledge_scheduled_time       = new_by_pledge_time
+                                                     + GRAPHENE_VIRTUAL_LAP_LENGTH / (w.average_pledge + w.total_mining_pledge + 1);
+               } );
+            }
             modify( wso, [&](witness_schedule_object& o )
             {
                 o.current_by_pledge_time = new_by_pledge_time;
@@ -226,7 +234,7 @@ void database::update_witness_schedule()
       const dynamic_global_property_object& dpo = get_dynamic_global_properties();
       if (pledge_added > 0)
          witness_pay_by_pledge = get_witness_pay_by_pledge(gpo, dpo, pledge_added);
-      modify(dpo, [&](dynamic_global_property_object& _dpo)
+      modify_dynamic_global_properties( [&](dynamic_global_property_object& _dpo)
       {
          _dpo.by_pledge_witness_pay_per_block = witness_pay_by_pledge;
       });
@@ -372,7 +380,7 @@ void database::reset_witness_by_pledge_schedule()
    const auto& idx = get_index_type<witness_index>().indices().get<by_valid>();
    for( auto itr = idx.lower_bound( true ); itr != idx.end(); ++itr )
    {
-      modify( *itr, [&]( witness_object& w )
+      modify_fields<witness_object::pledge_schedule_fields>( *itr, [&]( witness_object& w )
       {
          w.by_pledge_position             = fc::uint128_t();
          w.by_pledge_position_last_update = fc::uint128_t();
@@ -392,7 +400,7 @@ void database::reset_witness_by_vote_schedule()
    const auto& idx = get_index_type<witness_index>().indices().get<by_valid>();
    for( auto itr = idx.lower_bound( true ); itr != idx.end(); ++itr )
    {
-      modify( *itr, [&]( witness_object& w )
+      modify_fields<witness_object::vote_schedule_fields>( *itr, [&]( witness_object& w )
       {
          w.by_vote_position             = fc::uint128_t();
          w.by_vote_position_last_update = fc::uint128_t();
@@ -406,8 +414,18 @@ void database::adjust_witness_votes( const witness_object& witness, share_type d
    if( delta == 0 || !witness.is_valid )
       return;
 
+   if( _batching_candidate_votes )
+      _batched_witness_votes[ witness.id ] += delta;
+   else
+      apply_witness_votes( witness, delta );
+}
+
+void database::apply_witness_votes( const witness_object& witness, share_type delta )
+{
+   // Note: delta can be 0 when batched deltas cancel out, the position is still brought up to date then, the same
+   //       as the separate calls would do
    const witness_schedule_object& wso = witness_schedule_id_type()(*this);
-   modify( witness, [&]( witness_object& w )
+   modify_fields<witness_object::vote_schedule_fields>( witness, [&]( witness_object& w )
    {
       // update position
       if( wso.current_by_vote_time > w.by_vote_position_last_update )
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/evaluation_profile.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace chain {
+
+const std::vector<int64_t>& operation_profile::bucket_bounds()
+{
+   static const std::vector<int64_t> bounds = { 10, 100, 1000, 10000, 100000 };
+   return bounds;
+}
+
+void evaluation_profiler::record( int32_t operation_type, fc::microseconds evaluate_time, fc::microseconds apply_time,
+                                  uint64_t objects_created, uint64_t objects_modified, uint64_t objects_removed )
+{
+   FC_ASSERT( operation_type >= 0 );
+   const auto& bounds = operation_profile::bucket_bounds();
+   const int64_t total_us = evaluate_time.count() + apply_time.count();
+   const size_t bucket = std::upper_bound( bounds.begin(), bounds.end(), total_us ) - bounds.begin();
+
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( size_t(operation_type) >= _profiles.size() )
+      _profiles.resize( operation_type + 1 );
+   operation_profile& p = _profiles[ operation_type ];
+   if( p.histogram.empty() )
+   {
+      p.operation_type = operation_type;
+      p.histogram.resize( bounds.size() + 1 );
+   }
+   ++p.count;
+   p.evaluate_us += evaluate_time.count();
+   p.apply_us += apply_time.count();
+   ++p.histogram[ bucket ];
+   p.objects_created += objects_created;
+   p.objects_modified += objects_modified;
+   p.objects_removed += objects_removed;
+}
+
+vector<operation_profile> evaluation_profiler::get_profiles()const
+{
+   vector<operation_profile> result;
+   std::lock_guard<std::mutex> lock( _mutex );
+   for( const auto& p : _profiles )
+   {
+      if( p.count > 0 )
+         result.push_back( p );
+   }
+   return result;
+}
+
+void evaluation_profiler::reset()
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _profiles.clear();
+}
+
+} } // graphene::chain
@@ -42,9 +42,17 @@ database& generic_evaluator::db()const { return trx_state->db(); }
    { try {
       trx_state   = &eval_state;
       //check_required_authorities(op);
+      const auto start = fc::time_point::now();
       auto result = evaluate( op );
+      const auto evaluated = fc::time_point::now();
+      eval_state.last_evaluate_time = evaluated - start;
+      eval_state.last_apply_time = fc::microseconds();
 
-      if( apply ) result = this->apply( op );
+      if( apply )
+      {
+         result = this->apply( op );
+         eval_state.last_apply_time = fc::time_point::now() - evaluated;
+      }
       return result;
    } FC_CAPTURE_AND_RETHROW() }
 
@@ -180,4 +188,16 @@ database& generic_evaluator::db()const { return trx_state->db(); }
       return db().to_pretty_core_string( amount );
    }
 
+   const account_balance_object* transaction_evaluation_state::find_balance( account_uid_type owner, asset_aid_type asset_id )
+   {
+      const auto key = std::make_pair( owner, asset_id );
+      auto itr = _balances.find( key );
+      if( itr != _balances.end() )
+         return itr->second;
+      const account_balance_object* balance = db().find_account_balance( owner, asset_id );
+      if( balance != nullptr )
+         _balances.emplace( key, balance );
+      return balance;
+   }
+
 } }
@@ -24,8 +24,11 @@
 #include <graphene/chain/fork_database.hpp>
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
+#include <fc/io/raw.hpp>
 #include <fc/smart_ref_impl.hpp>
 
+#include <algorithm>
+
 namespace graphene { namespace chain {
 fork_database::fork_database()
 {
@@ -34,6 +37,10 @@ void fork_database::reset()
 {
    _head.reset();
    _index.clear();
+   _memory_bytes = 0;
+   _spilled_bytes = 0;
+   _spilled_count = 0;
+   _spill_end = 0;
 }
 
 void fork_database::pop_block()
@@ -41,13 +48,15 @@ void fork_database::pop_block()
    FC_ASSERT( _head, "no blocks to pop" );
    auto prev = _head->prev.lock();
    FC_ASSERT( prev, "poping block would leave head block null" );
+   _load( prev );
     _head = prev;
 }
 
 void     fork_database::start_block(signed_block b)
 {
    auto item = std::make_shared<fork_item>(std::move(b));
-   _index.insert(item);
+   if( _index.insert(item).second )
+      _on_insert( item );
    _head = item;
 }
 
@@ -89,7 +98,8 @@ void  fork_database::_push_block(const item_ptr& item)
       item->prev = *itr;
    }
 
-   _index.insert(item);
+   if( _index.insert(item).second )
+      _on_insert( item );
    if( !_head ) _head = item;
    else if( item->num > _head->num )
    {
@@ -98,11 +108,16 @@ void  fork_database::_push_block(const item_ptr& item)
 //      ilog( "min block in fork DB ${n}, max_size: ${m}", ("n",min_num)("m",_max_size) );
       auto& num_idx = _index.get<block_num>();
       while( num_idx.size() && (*num_idx.begin())->num < min_num )
+      {
+         _on_erase( *num_idx.begin() );
          num_idx.erase( num_idx.begin() );
+      }
       
       _unlinked_index.get<block_num>().erase(_head->num - _max_size);
    }
    //_push_next( item );
+   _compact_spill_file();
+   _enforce_memory_limit();
 }
 
 /**
@@ -137,11 +152,15 @@ void fork_database::set_max_size( uint32_t s )
       while( itr != by_num_idx.end() )
       {
          if( (*itr)->num < std::max(int64_t(0),int64_t(_head->num) - _max_size) )
+         {
+            _on_erase( *itr );
             by_num_idx.erase(itr);
+         }
          else
             break;
          itr = by_num_idx.begin();
       }
+      _compact_spill_file();
    }
    { /// unlinked_index
       auto& by_num_idx = _unlinked_index.get<block_num>();
@@ -173,7 +192,10 @@ item_ptr fork_database::fetch_block(const block_id_type& id)const
    auto& index = _index.get<block_id>();
    auto itr = index.find(id);
    if( itr != index.end() )
+   {
+      _load( *itr );
       return *itr;
+   }
    auto& unlinked_index = _unlinked_index.get<block_id>();
    auto unlinked_itr = unlinked_index.find(id);
    if( unlinked_itr != unlinked_index.end() )
@@ -188,7 +210,10 @@ vector<item_ptr> fork_database::fetch_block_by_number(uint32_t num)const
    while( itr != _index.get<block_num>().end() )
    {
       if( (*itr)->num == num )
+      {
+         _load( *itr );
          result.push_back( *itr );
+      }
       else
          break;
       ++itr;
@@ -237,17 +262,228 @@ pair<fork_database::branch_type,fork_database::branch_type>
       result.first.push_back(first_branch);
       result.second.push_back(second_branch);
    }
+   for( const auto& item : result.first )
+      _load( item );
+   for( const auto& item : result.second )
+      _load( item );
    return result;
 } FC_CAPTURE_AND_RETHROW( (first)(second) ) }
 
 void fork_database::set_head(shared_ptr<fork_item> h)
 {
+   if( h )
+      _load( h );
    _head = h;
 }
 
 void fork_database::remove(block_id_type id)
 {
-   _index.get<block_id>().erase(id);
+   auto& index = _index.get<block_id>();
+   auto itr = index.find(id);
+   if( itr == index.end() )
+      return;
+   _on_erase( *itr );
+   index.erase(itr);
+   _compact_spill_file();
+}
+
+void fork_database::set_memory_limit( uint64_t max_bytes, const fc::path& spill_dir )
+{ try {
+   if( _spill_file.is_open() )
+   {
+      // blocks only in the old file would be lost
+      FC_ASSERT( _spilled_count == 0, "can't move the fork database spill file while blocks are spilled to it" );
+      _spill_file.close();
+   }
+   _memory_limit = max_bytes;
+   if( _memory_limit == 0 )
+      return;
+   fc::create_directories( spill_dir );
+   _spill_filename = spill_dir / "blocks";
+   _spill_file.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   // the fork database isn't kept across restarts, so neither is the file
+   _spill_file.open( _spill_filename.generic_string().c_str(),
+                     std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc );
+   _spill_end = 0;
+   _enforce_memory_limit();
+} FC_CAPTURE_AND_RETHROW( (max_bytes)(spill_dir) ) }
+
+uint32_t fork_database::save_forks( const fc::path& file, uint32_t min_num )const
+{ try {
+   set<block_id_type> head_branch;
+   for( item_ptr item = _head; item; item = item->prev.lock() )
+      head_branch.insert( item->id );
+
+   std::ofstream out( file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+   FC_ASSERT( out, "Unable to write ${f}", ("f",file) );
+   uint32_t count = 0;
+   // by number, so that every block comes after the one it builds on
+   for( const item_ptr& item : _index.get<block_num>() )
+   {
+      if( item->num <= min_num || item->invalid || head_branch.count( item->id ) )
+         continue;
+      _load( item );
+      const vector<char> packed = fc::raw::pack( item->data );
+      const uint32_t size = packed.size();
+      out.put( item->applied ? 1 : 0 );
+      out.write( (const char*)&size, sizeof(size) );
+      out.write( packed.data(), packed.size() );
+      ++count;
+   }
+   out.close();
+   FC_ASSERT( out, "Unable to write ${f}", ("f",file) );
+   return count;
+} FC_CAPTURE_AND_RETHROW( (file)(min_num) ) }
+
+uint32_t fork_database::load_forks( const fc::path& file )
+{ try {
+   uint32_t count = 0;
+   {
+      std::ifstream in( file.generic_string().c_str(), std::ios::in | std::ios::binary );
+      FC_ASSERT( in, "Unable to read ${f}", ("f",file) );
+      vector<char> packed;
+      char applied = 0;
+      uint32_t size = 0;
+      while( _head && in.get( applied ) && in.read( (char*)&size, sizeof(size) ) )
+      {
+         packed.resize( size );
+         if( !in.read( packed.data(), size ) )
+            break;
+         auto item = std::make_shared<fork_item>( fc::raw::unpack<signed_block>( packed ) );
+         item->applied = applied != 0;
+         if( item->num > _head->num || is_known_block( item->id ) )
+            continue;
+         try
+         {
+            _push_block( item );
+            ++count;
+         }
+         catch( const fc::exception& e )
+         {
+            // the block it builds on is gone, or it is too old now
+            dlog( "Dropping saved fork block ${id}: ${e}", ("id",item->id)("e",e.to_string()) );
+         }
+      }
+   }
+   fc::remove( file );
+   return count;
+} FC_CAPTURE_AND_RETHROW( (file) ) }
+
+fork_database_stats fork_database::get_stats()const
+{
+   fork_database_stats stats;
+   stats.item_count    = _index.size();
+   stats.spilled_count = _spilled_count;
+   stats.memory_bytes  = _memory_bytes;
+   stats.spilled_bytes = _spilled_bytes;
+   return stats;
+}
+
+void fork_database::_on_insert( const item_ptr& item )
+{
+   item->size = fc::raw::pack_size( item->data );
+   _memory_bytes += item->size;
+}
+
+void fork_database::_on_erase( const item_ptr& item )
+{
+   if( item->spill_pos.valid() )
+   {
+      _spilled_bytes -= item->size;
+      --_spilled_count;
+      if( _spilled_count == 0 )
+         _spill_end = 0;
+   }
+   else
+      _memory_bytes -= item->size;
+}
+
+void fork_database::_enforce_memory_limit()
+{
+   if( _memory_limit == 0 || _memory_bytes <= _memory_limit )
+      return;
+   const uint32_t spilled_before = _spilled_count;
+   auto& num_idx = _index.get<block_num>();
+   for( auto itr = num_idx.begin(); itr != num_idx.end() && _memory_bytes > _memory_limit; ++itr )
+   {
+      // the head and the blocks handed out, e.g. the branches of a fork switch in progress, stay in memory
+      if( !(*itr)->spill_pos.valid() && itr->use_count() == 1 )
+         _spill( *itr );
+   }
+   if( spilled_before == 0 && _spilled_count > 0 )
+      wlog( "Fork database over its memory limit of ${l} bytes, spilling ${n} blocks to disk",
+            ("l",_memory_limit)("n",_spilled_count) );
 }
 
+void fork_database::_spill( const item_ptr& item )
+{ try {
+   vector<char> data = fc::raw::pack( item->data );
+   _spill_file.seekp( _spill_end );
+   _spill_file.write( data.data(), data.size() );
+   _spill_file.flush();
+   item->spill_pos = _spill_end;
+   _spill_end += data.size();
+
+   vector<processed_transaction>().swap( item->data.transactions );
+   _memory_bytes -= item->size;
+   _spilled_bytes += item->size;
+   ++_spilled_count;
+} FC_CAPTURE_AND_RETHROW( (item->id)(item->num) ) }
+
+void fork_database::_load( const item_ptr& item )const
+{ try {
+   if( !item->spill_pos.valid() )
+      return;
+   vector<char> data( item->size );
+   _spill_file.seekg( *item->spill_pos );
+   _spill_file.read( data.data(), data.size() );
+   signed_block block = fc::raw::unpack<signed_block>( data );
+   FC_ASSERT( block.id() == item->id, "spilled block doesn't match the fork database" );
+   item->data = std::move( block );
+   item->spill_pos.reset();
+   _spilled_bytes -= item->size;
+   _memory_bytes += item->size;
+   --_spilled_count;
+   if( _spilled_count == 0 )
+      _spill_end = 0;
+   _compact_spill_file();
+} FC_CAPTURE_AND_RETHROW( (item->id)(item->num) ) }
+
+void fork_database::_compact_spill_file()const
+{ try {
+   // the space of the blocks that left the file is only taken back once it outweighs the blocks still spilled
+   const uint64_t dead_bytes = _spill_end - _spilled_bytes;
+   if( _spilled_count == 0 || dead_bytes <= _spilled_bytes || dead_bytes < _memory_limit )
+      return;
+
+   vector<item_ptr> spilled;
+   spilled.reserve( _spilled_count );
+   for( const item_ptr& item : _index )
+      if( item->spill_pos.valid() )
+         spilled.push_back( item );
+   std::sort( spilled.begin(), spilled.end(), []( const item_ptr& a, const item_ptr& b ) {
+      return *a->spill_pos < *b->spill_pos;
+   });
+
+   // moving the blocks towards the start in file order never overwrites a block not moved yet
+   uint64_t end = 0;
+   vector<char> data;
+   for( const item_ptr& item : spilled )
+   {
+      if( *item->spill_pos != end )
+      {
+         data.resize( item->size );
+         _spill_file.seekg( *item->spill_pos );
+         _spill_file.read( data.data(), data.size() );
+         _spill_file.seekp( end );
+         _spill_file.write( data.data(), data.size() );
+         item->spill_pos = end;
+      }
+      end += item->size;
+   }
+   _spill_file.flush();
+   fc::resize_file( _spill_filename, end );
+   _spill_end = end;
+} FC_CAPTURE_AND_RETHROW( (_spill_filename)(_spill_end)(_spilled_bytes)(_spilled_count) ) }
+
 } } // graphene::chain
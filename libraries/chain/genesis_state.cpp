@@ -28,6 +28,14 @@
 #include <fc/smart_ref_impl.hpp>   // required for gcc in release mode
 #include <graphene/chain/protocol/fee_schedule.hpp>
 
+#include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+
+#include <zlib.h>
+
+#include <cstring>
+#include <fstream>
+
 namespace graphene { namespace chain {
 
 chain_id_type genesis_state_type::compute_chain_id() const
@@ -35,4 +43,77 @@ chain_id_type genesis_state_type::compute_chain_id() const
    return initial_chain_id;
 }
 
+/// never the start of a JSON document
+static const char   binary_genesis_magic[] = "\0YOYOWGENESIS1\n";
+static const size_t binary_genesis_magic_size = sizeof( binary_genesis_magic ) - 1;
+
+bool is_binary_genesis_state( const string& file_contents )
+{
+   return file_contents.size() >= binary_genesis_magic_size
+          && std::memcmp( file_contents.data(), binary_genesis_magic, binary_genesis_magic_size ) == 0;
+}
+
+genesis_state_type load_binary_genesis_state( const string& file_contents )
+{ try {
+   FC_ASSERT( is_binary_genesis_state( file_contents ), "Not a binary genesis state" );
+   fc::datastream<const char*> ds( file_contents.data() + binary_genesis_magic_size,
+                                   file_contents.size() - binary_genesis_magic_size );
+   genesis_state_type genesis;
+   fc::raw::unpack( ds, genesis );
+   FC_ASSERT( ds.remaining() == 0, "Unexpected data after the binary genesis state" );
+   const chain_id_type declared_chain_id = genesis.initial_chain_id;
+   genesis.initial_chain_id = chain_id_type();
+   FC_ASSERT( json_genesis_chain_id( genesis ) == declared_chain_id,
+              "The chain id ${c} of the binary genesis state isn't the one of the genesis it holds",
+              ("c",declared_chain_id) );
+   genesis.initial_chain_id = declared_chain_id;
+   return genesis;
+} FC_CAPTURE_AND_RETHROW() }
+
+chain_id_type json_genesis_chain_id( const genesis_state_type& genesis )
+{
+   return fc::sha256::hash( fc::json::to_pretty_string( fc::variant( genesis, 20 ) ) );
+}
+
+void save_binary_genesis_state( const genesis_state_type& genesis, const fc::path& filename )
+{ try {
+   const std::vector<char> packed = fc::raw::pack( genesis );
+   std::ofstream out( filename.generic_string().c_str(), std::ios::binary | std::ios::out | std::ios::trunc );
+   out.write( binary_genesis_magic, binary_genesis_magic_size );
+   out.write( packed.data(), packed.size() );
+   out.close();
+   FC_ASSERT( !out.fail(), "Unable to write ${f}", ("f",filename) );
+} FC_CAPTURE_AND_RETHROW( (filename) ) }
+
+vector<char> compress_genesis_state( const genesis_state_type& genesis )
+{ try {
+   const vector<char> packed = fc::raw::pack( genesis );
+   const uint32_t raw_size = packed.size();
+   uLongf stream_size = compressBound( packed.size() );
+   vector<char> result( sizeof(raw_size) + stream_size );
+   std::memcpy( result.data(), &raw_size, sizeof(raw_size) );
+   const int status = compress2( (Bytef*)result.data() + sizeof(raw_size), &stream_size,
+                                 (const Bytef*)packed.data(), packed.size(), Z_BEST_COMPRESSION );
+   FC_ASSERT( status == Z_OK, "Unable to compress the genesis state", ("status",status) );
+   result.resize( sizeof(raw_size) + stream_size );
+   return result;
+} FC_CAPTURE_AND_RETHROW() }
+
+genesis_state_type decompress_genesis_state( const char* data, size_t size )
+{ try {
+   uint32_t raw_size = 0;
+   FC_ASSERT( size > sizeof(raw_size), "The compressed genesis state is too short" );
+   std::memcpy( &raw_size, data, sizeof(raw_size) );
+   vector<char> packed( raw_size );
+   uLongf decoded_size = raw_size;
+   const int status = uncompress( (Bytef*)packed.data(), &decoded_size,
+                                  (const Bytef*)data + sizeof(raw_size), size - sizeof(raw_size) );
+   FC_ASSERT( status == Z_OK && decoded_size == raw_size, "Unable to decompress the genesis state", ("status",status) );
+   fc::datastream<const char*> ds( packed.data(), packed.size() );
+   genesis_state_type genesis;
+   fc::raw::unpack( ds, genesis );
+   FC_ASSERT( ds.remaining() == 0, "Unexpected data after the compressed genesis state" );
+   return genesis;
+} FC_CAPTURE_AND_RETHROW() }
+
 } } // graphene::chain
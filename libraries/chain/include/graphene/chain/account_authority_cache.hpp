@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/account_object.hpp>
+
+#include <unordered_map>
+
+namespace graphene { namespace chain {
+
+   class database;
+
+   /**
+    *  @brief Accounts whose authorities were looked up while the current block is applied.
+    *
+    *  Every transaction of a block resolves the owner, active or secondary authority of the accounts it requires,
+    *  and of the accounts listed in those authorities, through the by_uid index of the accounts. The same accounts
+    *  tend to sign many transactions of a block, so the accounts found are kept by uid until the block is applied.
+    *
+    *  The cache only holds entries between begin_block() and end_block(), it's bypassed otherwise. The account
+    *  objects are modified in place, an entry is invalidated anyway when the authorities of its account change,
+    *  and the whole cache is cleared when changes are undone, the undone objects may have been removed.
+    *
+    *  It is only used by the chain thread, it isn't locked.
+    */
+   class account_authority_cache
+   {
+      public:
+         /// @return the account, looking it up in the database if it isn't cached or the cache isn't active
+         const account_object& get_account( const database& db, account_uid_type uid )
+         {
+            if( _active )
+            {
+               auto itr = _accounts.find( uid );
+               if( itr != _accounts.end() )
+                  return *itr->second;
+            }
+            return lookup_account( db, uid );
+         }
+
+         const authority* owner( const database& db, account_uid_type uid )     { return &get_account( db, uid ).owner;     }
+         const authority* active( const database& db, account_uid_type uid )    { return &get_account( db, uid ).active;    }
+         const authority* secondary( const database& db, account_uid_type uid ) { return &get_account( db, uid ).secondary; }
+
+         /// Starts caching, called when a block starts to be applied
+         void begin_block();
+         /// Stops caching and drops the entries, called when a block is applied or failed to apply
+         void end_block();
+         bool is_active()const { return _active; }
+
+         /// Drops the entry of the account, called when its authorities change
+         void invalidate( account_uid_type uid ) { _accounts.erase( uid ); }
+         void clear() { _accounts.clear(); }
+         size_t size()const { return _accounts.size(); }
+
+      private:
+         const account_object& lookup_account( const database& db, account_uid_type uid );
+
+         bool                                                          _active = false;
+         std::unordered_map< account_uid_type, const account_object* > _accounts;
+   };
+
+   /**
+    *  Authority resolver of sign_state and verify_authority_with(), looking the accounts up through the
+    *  account authority cache, see database::get_authority_resolver().
+    */
+   struct account_authority_resolver
+   {
+      const authority* owner( account_uid_type uid )const     { return cache.owner( db, uid );     }
+      const authority* active( account_uid_type uid )const    { return cache.active( db, uid );    }
+      const authority* secondary( account_uid_type uid )const { return cache.secondary( db, uid ); }
+
+      const database&          db;
+      account_authority_cache& cache;
+   };
+
+} } // graphene::chain
@@ -56,8 +56,8 @@ public:
    void_result do_apply( const operation_type& o ) ;
 
    const account_object* acnt = nullptr;
-   flat_map<public_key_type,weight_type>::const_iterator itr_active;
-   flat_map<public_key_type,weight_type>::const_iterator itr_secondary;
+   authority::key_auth_map::const_iterator itr_active;
+   authority::key_auth_map::const_iterator itr_secondary;
    weight_type active_weight = 0;
    weight_type secondary_weight = 0;
 };
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/operation_history_object.hpp>
+
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief Account history kept in files instead of the object database.
+    *
+    *  Operations are appended to a log split into segments of a fixed number of operations, each made of a data
+    *  file and an index of fixed size entries, so an operation is found by its id with one index read. The account
+    *  histories are a file of fixed size records, each pointing back to the previous record of the same account
+    *  and to the previous one of the same account and operation type.
+    *
+    *  Only operations of irreversible blocks are written. The operations of the blocks after the last irreversible
+    *  one are kept in memory, discarded again if their block is replaced after a fork switch, and written out once
+    *  their block becomes irreversible. Nothing goes through the undo database.
+    *
+    *  What stays in memory is, for each account, the number of operations, the last record and one record out of
+    *  every @ref checkpoint_interval, and a small cache of recently read operations.
+    *
+    *  It may be written from another thread than the one reading it, every call takes a lock.
+    */
+   class account_history_store
+   {
+      public:
+         /// number of operations in one segment of the operation log
+         static const uint64_t ops_per_segment     = 1 << 22;
+         /// every record with a sequence of n * checkpoint_interval + 1 has its position kept in memory
+         static const uint32_t checkpoint_interval = 64;
+
+         account_history_store();
+         ~account_history_store();
+
+         /// Opens or creates the store in @p dir, the account histories are read back to rebuild the in-memory index
+         void open( const fc::path& dir );
+         bool is_open()const;
+         void close();
+
+         /// Number of recently read operations to cache
+         void set_cache_size( size_t max_ops );
+
+         /// Last block the operations of which are on disk, blocks up to it are not appended again while replaying
+         uint32_t flushed_block_num()const;
+
+         /**
+          * Adds an operation to the histories of @p accounts. Operations must be appended in the order they are
+          * applied, and only for blocks after flushed_block_num().
+          * @return the id assigned to the operation
+          */
+         operation_history_id_type append( const operation_history_object& op, const flat_set<account_uid_type>& accounts );
+         /// Discards the operations of @p block_num and later blocks, which are about to be applied again
+         void discard_from_block( uint32_t block_num );
+         /// Writes out the operations of the blocks up to @p block_num
+         void flush_until_block( uint32_t block_num );
+
+         /// @return the number of operations in the history of @p account
+         uint32_t total_ops( account_uid_type account )const;
+         optional<operation_history_object> get_operation( operation_history_id_type id )const;
+         /**
+          * Calls @p visitor with the sequence and the operation id of the entries of the history of @p account, from
+          * sequence @p start (the most recent if 0) down, of type @p op_type only if set, until it returns false.
+          * The store stays locked while @p visitor runs, it may call the other methods of the store.
+          */
+         void visit_account_history( account_uid_type account, optional<uint16_t> op_type, uint32_t start,
+                                     const std::function<bool(uint32_t,operation_history_id_type)>& visitor )const;
+         /**
+          * @return the operations of the history of @p account with a sequence in [stop, start] and of type
+          *         @p op_type if set, the most recent first, with their sequence
+          */
+         vector< std::pair<uint32_t,operation_history_object> > get_account_history( account_uid_type account,
+                                                                                     optional<uint16_t> op_type,
+                                                                                     uint32_t stop, uint32_t start,
+                                                                                     uint32_t limit )const;
+
+      private:
+         static const uint64_t no_record = uint64_t(-1);
+
+         /// Entry of the index file of a segment, the entry of operation n is at (n % ops_per_segment) * sizeof
+         struct op_index_entry
+         {
+            uint64_t pos  = 0;
+            uint32_t size = 0;
+            uint32_t padding = 0;
+         };
+         /// Record of the account histories file, record n is at n * sizeof(account_record)
+         struct account_record
+         {
+            account_uid_type account = 0;
+            uint64_t         operation = 0;
+            uint64_t         prev = no_record;          ///< previous record of the account
+            uint64_t         prev_same_type = no_record; ///< previous record of the account and operation type
+            uint32_t         sequence = 0;
+            uint16_t         operation_type = 0;
+            uint16_t         padding = 0;
+         };
+         struct account_head
+         {
+            uint32_t         total_ops = 0;     ///< including the pending ones
+            uint32_t         flushed_ops = 0;   ///< on disk
+            uint64_t         last_record = no_record;
+            vector<uint64_t> checkpoints;       ///< record of sequence n * checkpoint_interval + 1 at n
+         };
+         struct pending_op
+         {
+            operation_history_object op;
+            vector< std::pair<account_uid_type,uint32_t> > accounts; ///< with the sequence in their history
+         };
+         struct segment
+         {
+            std::fstream data;
+            std::fstream index;
+         };
+
+         segment& get_segment( uint64_t segment_num )const;
+         void     write_operation( const operation_history_object& op );
+         void     write_record( const account_record& r );
+         account_record read_record( uint64_t record_num )const;
+         /// record of @p sequence, which must be on disk
+         uint64_t find_record( const account_head& head, uint32_t sequence )const;
+         void     save_head()const;
+
+         mutable std::recursive_mutex               _mutex;
+         fc::path                                   _dir;
+         bool                                       _open = false;
+         uint32_t                                   _flushed_block_num = 0;
+         uint64_t                                   _next_op = 0;          ///< id instance of the next operation
+         uint64_t                                   _flushed_ops = 0;      ///< operations on disk
+         uint64_t                                   _record_count = 0;
+         mutable std::fstream                       _records;
+         mutable std::map< uint64_t, std::unique_ptr<segment> > _segments;
+         std::map< account_uid_type, account_head > _heads;
+         std::map< std::pair<account_uid_type,uint16_t>, uint64_t > _last_of_type;
+         std::deque<pending_op>                     _pending;
+
+         size_t                                     _cache_max_size = 10000;
+         mutable std::map< uint64_t, operation_history_object > _cache;
+         mutable std::deque<uint64_t>               _cache_order;
+   };
+
+} } // graphene::chain
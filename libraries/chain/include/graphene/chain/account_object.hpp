@@ -26,7 +26,9 @@
 #include <graphene/db/generic_index.hpp>
 #include <graphene/chain/hardfork.hpp>
 #include <boost/multi_index/composite_key.hpp>
+#include <cstring>
 #include <numeric>
+#include <unordered_map>
 
 namespace graphene { namespace chain {
    class database;
@@ -229,7 +231,7 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
          /**
          * uncollected fee by market trading.
          */
-         map<asset_aid_type, share_type> uncollected_market_fees;
+         flat_map<asset_aid_type, share_type> uncollected_market_fees;
          /**
          * uncollected bonus, registrar and referrer form score
          */
@@ -316,6 +318,10 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
          std::pair<fc::uint128_t, share_type> compute_coin_seconds_earned(const uint64_t window, const fc::time_point_sec now, const database& db, const uint8_t enable_hard_fork_type = ENABLE_HEAD_FORK_NONE)const;
 
          std::pair<fc::uint128_t, share_type> compute_coin_seconds_earned_fix(const uint64_t window, const fc::time_point_sec now, const database& db, uint8_t enable_hard_fork_type)const;
+         /**
+          * The balance that earns coin seconds since the given hard fork
+          */
+         share_type get_effective_balance(const database& db, const uint8_t enable_hard_fork_type = ENABLE_HEAD_FORK_NONE)const;
          /**
           * Update coin_seconds_earned and
           * coin_seconds_earned_last_update fields due to passing of time
@@ -331,6 +337,32 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
 
          void add_uncollected_market_fee(asset_aid_type asset_aid, share_type amount);
 
+         /// the fields changed by core balance adjustments, for object_database::modify_fields()
+         struct core_balance_fields
+         {
+            explicit core_balance_fields( const _account_statistics_object& s )
+            : core_balance( s.core_balance ),
+              average_coins( s.average_coins ),
+              average_coins_last_update( s.average_coins_last_update ),
+              coin_seconds_earned( s.coin_seconds_earned ),
+              coin_seconds_earned_last_update( s.coin_seconds_earned_last_update ) {}
+
+            void restore( _account_statistics_object& s )const
+            {
+               s.core_balance                    = core_balance;
+               s.average_coins                   = average_coins;
+               s.average_coins_last_update       = average_coins_last_update;
+               s.coin_seconds_earned             = coin_seconds_earned;
+               s.coin_seconds_earned_last_update = coin_seconds_earned_last_update;
+            }
+
+            share_type         core_balance;
+            share_type         average_coins;
+            fc::time_point_sec average_coins_last_update;
+            fc::uint128_t      coin_seconds_earned;
+            fc::time_point_sec coin_seconds_earned_last_update;
+         };
+
          uint64_t get_votes_from_core_balance()const{
             return core_balance.value + total_core_in_orders.value;
          }
@@ -339,7 +371,7 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
          share_type get_all_pledge_balance(asset_aid_type asset_id,const DB& db)const{
             share_type res=0;
             for(const auto & type_id:pledge_balance_ids){
-               auto pledge_balance_obj = db.get(type_id.second);
+               const auto& pledge_balance_obj = db.get(type_id.second);
                if(pledge_balance_obj.asset_id==asset_id)
                   res+=pledge_balance_obj.total_unrelease_pledge();
             }
@@ -348,7 +380,7 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
          template<class DB>
          share_type get_pledge_balance(asset_aid_type asset_id,pledge_balance_type type,const DB& db)const{
             if(pledge_balance_ids.count(type)!=0){
-               pledge_balance_object pledge_balance_obj=db.get(pledge_balance_ids.at(type));
+               const pledge_balance_object& pledge_balance_obj=db.get(pledge_balance_ids.at(type));
                if(pledge_balance_obj.asset_id==asset_id)
                   return pledge_balance_obj.total_unrelease_pledge();     
             }
@@ -358,7 +390,7 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
          template<class DB>
          share_type get_releasing_pledge(asset_aid_type asset_id, pledge_balance_type type, const DB& db) const {
             if (pledge_balance_ids.count(type) != 0){
-               auto pledge_balance_obj = db.get(pledge_balance_ids.at(type));
+               const auto& pledge_balance_obj = db.get(pledge_balance_ids.at(type));
                if (pledge_balance_obj.asset_id == asset_id)
                   return pledge_balance_obj.total_releasing_pledge;
             }
@@ -378,10 +410,49 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
                get_pledge_balance(GRAPHENE_CORE_ASSET_AID, exclude_type, db);
          }
 
-         map<pledge_balance_type,pledge_balance_id_type> pledge_balance_ids;
+         // flat maps, as an object is copied as a whole every time it's modified (see undo_database::on_modify)
+         // and these only ever hold a few entries
+         flat_map<pledge_balance_type,pledge_balance_id_type> pledge_balance_ids;
       
    };
 
+   /**
+    * @brief Coin seconds of a batch of accounts, recomputed all at once
+    *
+    * Meant for the passes that go through lots of accounts, like the ones done at hard forks. The values the
+    * computation works on are copied out of the account statistics into one array per field, the 128-bit coin
+    * seconds split into a high and a low 64-bit lane, so that compute() is a plain loop over contiguous arrays
+    * instead of hopping between objects.
+    *
+    * The results are the same as the ones of @ref _account_statistics_object::update_coin_seconds_earned().
+    */
+   class coin_seconds_batch
+   {
+      public:
+         /// adds an account to the batch, its effective balance is taken since the given hard fork
+         void add( const _account_statistics_object& s, const database& db, const uint8_t enable_hard_fork_type );
+         /// recomputes the coin seconds of all the accounts of the batch at the given time
+         void compute( const uint64_t window, const fc::time_point_sec now );
+
+         size_t size()const { return _stats.size(); }
+         const _account_statistics_object& get( size_t i )const { return *_stats[i]; }
+         /// whether compute() changed anything for the i-th account, same as update_coin_seconds_earned() not returning early
+         bool changed( size_t i )const { return _changed[i] != 0; }
+         /// stores the coin seconds computed for the i-th account
+         void apply( size_t i, _account_statistics_object& s )const;
+
+      private:
+         vector<const _account_statistics_object*> _stats;
+         vector<int64_t>                           _effective_balance;
+         vector<int64_t>                           _average_coins;
+         vector<uint32_t>                          _average_coins_last_update;
+         vector<uint64_t>                          _coin_seconds_hi;
+         vector<uint64_t>                          _coin_seconds_lo;
+         vector<uint32_t>                          _coin_seconds_last_update;
+         vector<uint8_t>                           _changed;
+         fc::time_point_sec                        _now_rounded;
+   };
+
 
    // copy struct from _account_statistics_object
    struct account_statistics_object
@@ -841,6 +912,9 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
    /**
     *  @brief This secondary index will allow a reverse lookup of all accounts that a particular key or account
     *  is an potential signing authority.
+    *
+    *  The memberships only depend on the authorities and the memo key. A modification that changes none of them,
+    *  which is most of them, is detected by comparing these fields and leaves the memberships untouched.
     */
    class account_member_index : public secondary_index
    {
@@ -851,17 +925,38 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
          virtual void object_modified( const object& after  ) override;
 
 
-         /** given an account or key, map it to the set of accounts that reference it in an active or owner authority */
+         /**
+          * hashes a key with a seed chosen when the process starts, so that keys can't be made up to fall in the
+          * same buckets
+          */
+         struct public_key_hash
+         {
+            size_t operator()( const public_key_type& key )const;
+         };
+
+         typedef std::unordered_map< public_key_type, flat_set<account_uid_type>, public_key_hash > key_memberships_type;
+
+         /**
+          * given an account or key, map it to the sorted accounts that reference it in an authority or as memo key;
+          * entries without accounts are erased
+          */
          map< account_uid_type, set<account_uid_type> > account_to_account_memberships;
-         map< public_key_type, set<account_uid_type> > account_to_key_memberships;
+         key_memberships_type                           account_to_key_memberships;
 
 
       protected:
          set<account_uid_type>  get_account_members( const account_object& a )const;
          set<public_key_type>  get_key_members( const account_object& a )const;
-
-         set<account_uid_type>  before_account_members;
-         set<public_key_type>  before_key_members;
+         static set<account_uid_type> get_account_members( const authority& owner, const authority& active,
+                                                           const authority& secondary );
+         static set<public_key_type>  get_key_members( const authority& owner, const authority& active,
+                                                       const public_key_type& memo_key );
+
+         /// the fields the memberships depend on, as they were before the modification
+         authority        before_owner;
+         authority        before_active;
+         authority        before_secondary;
+         public_key_type  before_memo_key;
    };
 
 
@@ -880,22 +975,67 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
          /** maps the referrer to the set of accounts that they have referred */
          map< account_uid_type, set<account_uid_type> > referred_by;
    };
+
+   /**
+    *  @brief This secondary index finds an account by its exact name with one hash of the name, instead of the
+    *  string comparisons down the by_name tree. Lookups of name ranges still use the by_name index.
+    */
+   class account_name_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         /// @return the account named @p name, or nullptr if there is none
+         const account_object* find( const string& name )const;
+
+      private:
+         std::unordered_map< string, const account_object* > _accounts;
+         /// the name of the account being modified, as it was before the modification
+         string                                              _name_before;
+   };
    
    /**
     * @ingroup object_index
     */
    struct by_pledge_type;
-   struct by_earliest_release_block_number;
    
    typedef multi_index_container<
       pledge_balance_object,
       indexed_by<
-         ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
-         ordered_non_unique< tag<by_earliest_release_block_number>,const_mem_fun< pledge_balance_object, uint64_t, &pledge_balance_object::earliest_release_block_number > >
+         ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >
       >
    > pledge_balance_object_multi_index_type;
    
    typedef generic_index<pledge_balance_object, pledge_balance_object_multi_index_type> pledge_balance_index;
+
+   /**
+    *  @brief The pledge balances with releasing pledges, bucketed by the block their earliest release is due at.
+    *
+    *  A block only takes the buckets due at it, and a modification which doesn't change the earliest release,
+    *  e.g. of the pledge only, leaves the queue untouched.
+    */
+   class pledge_release_queue_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         /// @return the pledge balances with a release due at or before @p block_num, by due block then by id
+         vector<pledge_balance_id_type> due_until( uint32_t block_num )const;
+
+      private:
+         void add( const pledge_balance_object& p );
+         void remove( const pledge_balance_id_type id, uint64_t release_block );
+
+         map< uint64_t, flat_set<pledge_balance_id_type> > _due;
+         /// the earliest release before the modification
+         uint64_t before_release_block = 0;
+   };
    
    struct by_account_asset;
    struct by_asset_balance;
@@ -1020,6 +1160,41 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
     */
    typedef generic_index<voter_object, voter_multi_index_type> voter_index;
 
+   /**
+    *  @brief The voters by uid and sequence in a hash table, and the proxies the votes of each voter go through.
+    *
+    *  The proxy chain of a voter is cached until a voter is created or removed or changes its proxy, so adjusting
+    *  the votes of a voter on each balance change doesn't look up its proxies again.
+    */
+   class voter_proxy_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         const voter_object* find( account_uid_type uid, uint32_t sequence )const;
+         /**
+          * @return the proxies the votes of @p voter go through, at most @p max_level of them, the last one votes
+          *         itself unless it's the max_level-th one
+          */
+         const vector<const voter_object*>& proxy_chain( const voter_object& voter, uint8_t max_level )const;
+
+      private:
+         typedef std::pair< account_uid_type, uint32_t > voter_key;
+         struct voter_key_hash
+         {
+            size_t operator()( const voter_key& k )const { return std::hash<uint64_t>()( ( k.first << 20 ) ^ k.second ); }
+         };
+
+         std::unordered_map< voter_key, const voter_object*, voter_key_hash >      _voters;
+         mutable std::unordered_map< const voter_object*, vector<const voter_object*> > _chains;
+         mutable uint8_t                                                           _chains_max_level = 0;
+         /// the proxy before the modification
+         voter_key                                                                 _proxy_before;
+   };
+
 
    struct by_original;
    struct by_takeover;
@@ -1275,3 +1450,12 @@ FC_REFLECT_DERIVED(graphene::chain::account_auth_platform_object,
                   (account)(platform)
                   (max_limit)(cur_used)(is_active)(permission_flags)(memo))
 
+
+GRAPHENE_DB_PRIMARY_INDEX( graphene::chain::account_balance_object,
+                           graphene::db::primary_index<graphene::chain::account_balance_index> )
+GRAPHENE_DB_PRIMARY_INDEX( graphene::chain::_account_statistics_object,
+                           graphene::db::primary_index<graphene::chain::account_statistics_index> )
+GRAPHENE_DB_PRIMARY_INDEX( graphene::chain::pledge_balance_object,
+                           graphene::db::primary_index<graphene::chain::pledge_balance_index> )
+GRAPHENE_DB_PRIMARY_INDEX( graphene::chain::voter_object,
+                           graphene::db::primary_index<graphene::chain::voter_index> )
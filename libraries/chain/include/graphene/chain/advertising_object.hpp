@@ -52,6 +52,7 @@ namespace graphene { namespace chain {
    struct by_clear_time{};
    struct by_advertising_order_state{};
    struct by_advertising_user_id{};
+   struct by_advertising_order_end{};
 
    typedef multi_index_container<
       advertising_order_object,
@@ -67,6 +68,13 @@ namespace graphene { namespace chain {
                              member< advertising_order_object, advertising_state,          &advertising_order_object::status >,
                              member< advertising_order_object, account_uid_type,           &advertising_order_object::platform >,
                              member< advertising_order_object, advertising_aid_type,       &advertising_order_object::advertising_aid >> >,
+         // for the orders of an advertising which end after a time, e.g. the ones a new order may conflict with
+         ordered_non_unique< tag<by_advertising_order_end>,
+                             composite_key<advertising_order_object,
+                             member< advertising_order_object, advertising_state,          &advertising_order_object::status >,
+                             member< advertising_order_object, account_uid_type,           &advertising_order_object::platform >,
+                             member< advertising_order_object, advertising_aid_type,       &advertising_order_object::advertising_aid >,
+                             member< advertising_order_object, time_point_sec,             &advertising_order_object::end_time >> >,
          
          ordered_non_unique< tag<by_clear_time>, const_mem_fun<advertising_order_object, time_point_sec, &advertising_order_object::get_clear_time  >>,
          ordered_unique< tag<by_advertising_user_id>,
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/operation_history_object.hpp>
+
+#include <deque>
+#include <fstream>
+#include <mutex>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief The operations applied by each block, real and virtual, kept in files.
+    *
+    *  Whatever is derived from the applied operations alone, like the account histories, can be built again from
+    *  the log for the blocks it covers without applying them again. The operations of each block are appended
+    *  packed to a file, with a record of fixed size for each block in another.
+    *
+    *  Like the account_history_store, only blocks up to the last irreversible one are written, the later ones are
+    *  kept in memory and discarded again when they are popped.
+    *
+    *  It may be read from other threads than the one writing it, every call takes a lock.
+    */
+   class applied_operations_log
+   {
+      public:
+         applied_operations_log();
+         ~applied_operations_log();
+
+         /// Opens or creates the log in @p dir, what was written after the last flush is dropped
+         void open( const fc::path& dir );
+         bool is_open()const;
+         void close();
+
+         /// First block logged, 0 if none is
+         uint32_t first_block_num()const;
+         /// Last block logged, written or not
+         uint32_t last_block_num()const;
+         uint32_t flushed_block_num()const;
+
+         /// Adds the operations applied by @p block_num, the blocks must be appended in order
+         void append_block( uint32_t block_num, const vector< optional<operation_history_object> >& operations );
+         /// Discards the blocks from @p block_num on, which are about to be popped, they must not be written yet
+         void discard_from_block( uint32_t block_num );
+         /// Writes out the blocks up to @p block_num
+         void flush_until_block( uint32_t block_num );
+
+         /// @return the operations applied by @p block_num, written or not, nothing if it isn't logged
+         optional< vector<operation_history_object> > get_block( uint32_t block_num )const;
+
+      private:
+         /// Record of the blocks file, the record of block n is at ( n - first block ) * sizeof(block_record)
+         struct block_record
+         {
+            uint64_t pos = 0;
+            uint32_t size = 0;
+            uint32_t block_num = 0;
+         };
+         struct pending_block
+         {
+            uint32_t block_num = 0;
+            vector<operation_history_object> operations;
+         };
+
+         void save_head()const;
+
+         mutable std::recursive_mutex  _mutex;
+         fc::path                      _dir;
+         bool                          _open = false;
+         uint32_t                      _first_block_num = 0;
+         uint32_t                      _flushed_block_num = 0;
+         uint64_t                      _data_size = 0;
+         mutable std::fstream          _blocks;
+         mutable std::fstream          _data;
+         std::deque<pending_block>     _pending;
+   };
+
+} } // graphene::chain
@@ -23,32 +23,180 @@
  */
 #pragma once
 #include <fstream>
+#include <map>
+#include <memory>
+#include <graphene/chain/config.hpp>
 #include <graphene/chain/protocol/block.hpp>
 
+namespace fc { class file_mapping; class mapped_region; }
+
 namespace graphene { namespace chain {
-   struct index_entry;
+   /// Entry of the index file, the entry of block n is stored at n * sizeof(index_entry)
+   struct index_entry
+   {
+      /// set in block_size if the block is stored as a compressed frame
+      static const uint32_t compressed_flag = 0x80000000;
+
+      uint64_t      block_pos = 0;
+      uint32_t      block_size = 0; ///< 0 if the block was removed
+      block_id_type block_id;
+
+      /// number of bytes the block takes in the blocks file
+      uint32_t stored_size()const { return block_size & ~compressed_flag; }
+      bool     is_compressed()const { return ( block_size & compressed_flag ) != 0; }
+   };
 
    class block_database 
    {
       public:
+         block_database();
+         ~block_database();
+
+         /**
+          * When enabled, lookups are served from read-only memory mappings of the index and blocks files
+          * instead of seeking and reading through the file streams. Writes always go through the streams.
+          * Must be called before open().
+          */
+         void set_use_mmap( bool enable ) { _use_mmap = enable; }
+         bool use_mmap()const { return _use_mmap; }
+         /**
+          * When enabled, the blocks stored from now on are written as zlib frames, each block in a frame of its own
+          * that is decoded without the others, so lookups by number stay a single read. A frame is only kept if
+          * it's smaller than the block. Blocks already stored are left as they are, a file can hold both kinds.
+          * The serialized blocks returned by the raw lookups and copied by export_range() are always uncompressed.
+          */
+         void set_compression( bool enable ) { _compress = enable; }
+         bool compression()const { return _compress; }
+         /**
+          * Number of the last stored blocks kept in memory, both unpacked and serialized, so the lookups of the
+          * blocks at the head of the chain, by number, by id or raw, don't read the files nor unpack anything.
+          * 0 disables the cache. The cache follows store() and remove(), it holds what the files hold.
+          */
+         void     set_cache_size( uint32_t size );
+         uint32_t cache_size()const { return _cache_size; }
+         /**
+          * Number of the last block numbers whose ids are kept in memory, see contains() and fetch_block_id().
+          * 0 keeps the ids of all the blocks, 20 bytes per block, so the block ids the p2p sync negotiation walks
+          * never come from the index file.
+          */
+         void     set_ids_kept( uint32_t count );
+         uint32_t ids_kept()const { return _ids_kept; }
+         /**
+          * Number of stored blocks kept in memory before they are written to the files together: the blocks with a
+          * single append to the blocks file, their index entries with one write per run of consecutive numbers.
+          * Lookups and remove() see the blocks not written yet, a lookup going to the files writes them first.
+          * The blocks not written yet are lost if the node stops without close(), they are fetched again from
+          * peers then. 0 or 1 writes every block as it's stored.
+          */
+         void     set_write_batch( uint32_t blocks ) { _write_batch = blocks; }
+         uint32_t write_batch()const { return _write_batch; }
+         /// When enabled, each batch of writes is synced to the disk before store() returns, see set_write_batch()
+         void     set_sync_writes( bool enable ) { _sync_writes = enable; }
+         bool     sync_writes()const { return _sync_writes; }
+
          void open( const fc::path& dbdir );
          bool is_open()const;
+         /// Writes the batch of blocks not written yet and flushes the files, see set_write_batch()
          void flush();
          void close();
 
          void store( const block_id_type& id, const signed_block& b );
          void remove( const block_id_type& id );
 
+         /**
+          * The ids of the blocks of the last ids_kept() numbers of the index are kept in
+          * memory, so contains() and fetch_block_id() of these, and of the numbers past the end of the index, don't
+          * read the index file, and fetch_optional() only reads the blocks that are stored.
+          */
          bool                   contains( const block_id_type& id )const;
          block_id_type          fetch_block_id( uint32_t block_num )const;
          optional<signed_block> fetch_optional( const block_id_type& id )const;
          optional<signed_block> fetch_by_number( uint32_t block_num )const;
+         /**
+          * Reads the serialized block stored at block_num without unpacking it.
+          * @return false if there is no block stored at block_num
+          */
+         bool                   fetch_raw_by_number( uint32_t block_num, block_id_type& id, vector<char>& data )const;
+         /**
+          * Reads the serialized blocks stored at [first, last] without unpacking them. The index entries of the range
+          * are read at once, and blocks lying back to back in the blocks file are read together with one read.
+          * On return ids and data hold last - first + 1 elements; the data of a block that isn't stored is empty.
+          */
+         void                   fetch_raw_range( uint32_t first, uint32_t last,
+                                                 vector<block_id_type>& ids, vector< vector<char> >& data )const;
+         /// reads the entries of [first, last] the index has, stops early at the end of the index
+         void                   fetch_index_entries( uint32_t first, uint32_t last, vector<index_entry>& entries )const;
+         /**
+          * Copies the stored blocks of [first, last] as they are to the index and blocks files of a block database
+          * in dir, which is created if needed and must not be open. Blocks that aren't stored are skipped.
+          * @return the number of blocks copied
+          */
+         uint32_t               export_range( uint32_t first, uint32_t last, const fc::path& dir )const;
          optional<signed_block> last()const;
          optional<block_id_type> last_id()const;
       private:
          optional<index_entry> last_index_entry()const;
+         /// @return true and the entry if the index has an entry for block_num
+         bool read_index_entry( uint32_t block_num, index_entry& e )const;
+         /// @return true if the id of the block stored at block_num, if any, is in _recent_ids
+         bool is_recent( uint32_t block_num )const
+         {
+            return block_num < _index_entries && uint64_t(block_num) + _recent_ids.size() >= _index_entries;
+         }
+         /// fills _recent_ids from the index file
+         void load_recent_ids()const;
+         /// writes the blocks stored since the last write and their index entries, see set_write_batch()
+         void write_pending()const;
+         /// reads and unpacks the block the entry points to, throws if it can't be read or doesn't match the entry
+         signed_block read_block( const index_entry& e )const;
+         /// @return pointer to the mapped bytes of the block, or nullptr if the blocks file is too short
+         const char* mapped_block_data( const index_entry& e )const;
+         /// stores the serialized block in data from the stored_size() bytes of the blocks file at stored
+         static void decode_block_data( const index_entry& e, const char* stored, vector<char>& data );
+         /// a block kept by the cache, see set_cache_size()
+         struct cached_block
+         {
+            block_id_type                        id;
+            std::shared_ptr<const signed_block>  block;
+            std::shared_ptr<const vector<char>>  data;
+         };
+         /// @return the cached block stored at block_num, nullptr if it isn't cached
+         const cached_block* find_cached( uint32_t block_num )const;
+         /// (re)maps the files if they have grown past the current mappings
+         void remap( bool index_file, uint64_t required_size )const;
+         void unmap()const;
+
          fc::path _index_filename;
+         fc::path _blocks_filename;
          mutable std::fstream _blocks;
          mutable std::fstream _block_num_to_pos;
+
+         bool _use_mmap = false;
+         bool _compress = false;
+
+         uint32_t                          _cache_size = GRAPHENE_DEFAULT_BLOCK_CACHE_SIZE;
+         /// the blocks stored last, by number
+         std::map<uint32_t, cached_block>  _cache;
+
+         uint32_t                      _ids_kept = GRAPHENE_BLOCK_DATABASE_RECENT_IDS;
+
+         uint32_t                                 _write_batch = GRAPHENE_DEFAULT_BLOCK_DATABASE_WRITE_BATCH;
+         bool                                     _sync_writes = false;
+         /// bytes of the blocks file written so far, the pending blocks go after them
+         mutable uint64_t                         _blocks_written = 0;
+         /// the blocks stored since the last write, back to back
+         mutable vector<char>                     _pending_data;
+         /// the index entries of the blocks stored, or removed, since the last write
+         mutable std::map<uint32_t, index_entry>  _pending_entries;
+         /// number of entries of the index file
+         mutable uint32_t              _index_entries = 0;
+         /// ids of the blocks stored at the numbers is_recent() is true of, the id of block n is at n % size()
+         mutable vector<block_id_type> _recent_ids;
+         mutable std::unique_ptr<fc::file_mapping>  _index_mapping;
+         mutable std::unique_ptr<fc::mapped_region> _index_region;
+         mutable std::unique_ptr<fc::file_mapping>  _blocks_mapping;
+         mutable std::unique_ptr<fc::mapped_region> _blocks_region;
    };
 } }
+
+FC_REFLECT( graphene::chain::index_entry, (block_pos)(block_size)(block_id) )
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/types.hpp>
+
+#include <fc/time.hpp>
+
+#include <deque>
+#include <mutex>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief Time spent in each phase of applying a block, in microseconds.
+    */
+   struct block_profile
+   {
+      uint32_t block_num = 0;
+      uint32_t transaction_count = 0;
+
+      int64_t  merkle_check_us = 0;
+      int64_t  header_validation_us = 0;
+      /// update_global_dynamic_data() and the recovery of the signature keys
+      int64_t  block_setup_us = 0;
+      int64_t  transactions_us = 0;
+      /// committee proposals, signing witness, irreversibility and the removal of expired objects
+      int64_t  block_end_us = 0;
+      /// pledges, votes, committee, budgets, content awards, pledge mining bonuses and hard fork updates
+      int64_t  maintenance_us = 0;
+      int64_t  witness_schedule_us = 0;
+      int64_t  invariants_us = 0;
+      int64_t  applied_block_us = 0;
+      int64_t  notify_changed_objects_us = 0;
+      int64_t  total_us = 0;
+   };
+
+   /**
+    *  @brief Keeps the block_profile of the last applied blocks.
+    *
+    *  The profiler is locked internally, so it can be read from other threads while blocks are applied.
+    */
+   class block_profiler
+   {
+      public:
+         explicit block_profiler( size_t max_size = GRAPHENE_DEFAULT_BLOCK_PROFILES_KEPT ):_max_size( max_size ){}
+
+         void record( const block_profile& profile );
+
+         /// @return the profiles of the last @p limit applied blocks, the latest first
+         vector<block_profile> get_recent( uint32_t limit )const;
+
+         void   set_max_size( size_t max_size );
+         size_t get_max_size()const;
+
+      private:
+         mutable std::mutex        _mutex;
+         size_t                    _max_size;
+         /// the oldest first
+         std::deque<block_profile> _profiles;
+   };
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::block_profile,
+            (block_num)(transaction_count)
+            (merkle_check_us)(header_validation_us)(block_setup_us)(transactions_us)(block_end_us)
+            (maintenance_us)(witness_schedule_us)(invariants_us)(applied_block_us)(notify_changed_objects_us)
+            (total_us) )
@@ -55,6 +55,22 @@
 
 #define GRAPHENE_MIN_UNDO_HISTORY 10
 #define GRAPHENE_MAX_UNDO_HISTORY 10000
+#define GRAPHENE_REPLAY_READ_AHEAD_PER_THREAD 16 ///< number of blocks decoded ahead of apply per worker thread while replaying
+#define GRAPHENE_MAX_PREVALIDATIONS_PER_THREAD 64 ///< incoming transactions checked concurrently per worker thread before falling back to the chain thread
+#define GRAPHENE_PARALLEL_MERKLE_MIN_HASHES 64 ///< number of transaction digests or hash pairs from which a merkle tree level is hashed on the worker threads
+#define GRAPHENE_PARALLEL_APPROVAL_MIN_POSTS 16 ///< number of active posts from which the approvals of a content award scan are summed on the worker threads
+#define GRAPHENE_DEFAULT_SIGNATURE_KEY_CACHE_SIZE 100000 ///< number of keys recovered from transaction signatures kept to check the same transactions again
+#define GRAPHENE_DEFAULT_BLOCK_CACHE_SIZE 256 ///< number of the last blocks stored in the block database kept in memory
+#define GRAPHENE_DEFAULT_RECENT_TRANSACTIONS_KEPT 20000 ///< number of the last transactions kept to answer peers and API clients asking for them by id
+#define GRAPHENE_DEFAULT_BLOCK_PROFILES_KEPT 1000 ///< number of the last applied blocks the phase durations are kept of
+#define GRAPHENE_DEFAULT_SLOT_TIMINGS_KEPT 1000 ///< number of the last signed and received blocks of each witness the times after their slot are kept of
+#define GRAPHENE_POST_CONTENT_INLINE_MAX 256 ///< bytes of post body or extra data from which it is kept in the post content store instead of the post object
+#define GRAPHENE_STATE_SNAPSHOT_VERSION 2 ///< format version of the state snapshots, see state_snapshot_manifest
+#define GRAPHENE_BLOCK_DATABASE_MAX_RANGE_READ (16*1024*1024) ///< bytes of contiguous block data read from the blocks file at once by a range lookup
+#define GRAPHENE_BLOCK_DATABASE_COMPRESSION_LEVEL 6 ///< zlib level of the compressed blocks of the block database
+#define GRAPHENE_BLOCK_DATABASE_RECENT_IDS (64*1024) ///< default number of the last block numbers of the block database whose ids are kept in memory
+#define GRAPHENE_DEFAULT_BLOCK_DATABASE_WRITE_BATCH 16 ///< number of blocks the block database stores in memory before writing them to its files at once
+#define GRAPHENE_BLOCK_DATABASE_MAX_WRITE_BATCH_BYTES (16*1024*1024) ///< bytes of stored blocks from which the block database writes them out whatever the batch size
 
 #define GRAPHENE_MIN_BLOCK_SIZE_LIMIT (GRAPHENE_MIN_TRANSACTION_SIZE_LIMIT*5) // 5 transactions per block
 #define GRAPHENE_MIN_TRANSACTION_EXPIRATION_LIMIT (GRAPHENE_MAX_BLOCK_INTERVAL * 5) // 5 transactions per block
@@ -173,6 +189,7 @@
 #define GRAPHENE_MAX_RESIGNED_COMMITTEE_VOTES_PER_BLOCK       (10000)
 #define GRAPHENE_MAX_CSAF_COLLECTING_TIME_OFFSET              (300) // 5 minutes
 #define GRAPHENE_MAX_RESIGNED_PLATFORM_VOTES_PER_BLOCK        (10000)
+#define GRAPHENE_MAX_UNNECESSARY_OBJECTS_REMOVED_PER_BLOCK    (10000) // expired advertising orders, custom votes and cast custom votes, after HARDFORK_0_6_TIME
 
 // committee proposal pass thresholds
 #define GRAPHENE_CPPT_FEE_DEFAULT                                 (uint16_t(5001)) // 50.01%
@@ -254,7 +271,7 @@
 #define GRAPHENE_RECENTLY_MISSED_COUNT_INCREMENT             4
 #define GRAPHENE_RECENTLY_MISSED_COUNT_DECREMENT             3
 
-#define GRAPHENE_CURRENT_DB_VERSION                          "YYW2.1"
+#define GRAPHENE_CURRENT_DB_VERSION                          "YYW2.5"
 
 #define GRAPHENE_IRREVERSIBLE_THRESHOLD                      (75 * GRAPHENE_1_PERCENT)
 
@@ -354,6 +371,9 @@
 #define GRAPHENE_DEFAULT_POSTER_MIN_RECEIPTS_RATIO (GRAPHENE_1_PERCENT*uint32_t(25)) //the min ratio of poster`s receipt from post_object 2500 means 25.00%
 #define GRAPHENE_DEFAULT_SCORE_RECEIPTS_RATIO (GRAPHENE_1_PERCENT*uint32_t(25)) //the ratio of score`s receipt from post_object 2500 means 25.00%
 #define GRAPHENE_MAX_PLATFORM_LIMIT_PREPAID (uint64_t(-1)>>1)
+#define GRAPHENE_CONTENT_AWARD_POSTS_PER_BLOCK 1000 //the number of active posts settled per block after HARDFORK_0_6_TIME
+#define GRAPHENE_EXPIRED_SCORES_PER_BLOCK 10000 //the maximum number of expired scores removed per block after HARDFORK_0_6_TIME
+#define GRAPHENE_AVERAGE_PLEDGES_PER_BLOCK 1000 //the maximum number of witness or platform average pledges updated per block after HARDFORK_0_6_TIME
 
 #define GRAPHENE_ADVERTISING_CONFIRM_TIME (uint32_t(60*60*24*7)) //remaining time that platform confirm advertising_buy
 ///@}
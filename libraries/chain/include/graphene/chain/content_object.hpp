@@ -3,7 +3,9 @@
  */
 #pragma once
 #include <graphene/chain/protocol/operations.hpp>
+#include <graphene/chain/content_store.hpp>
 #include <graphene/db/generic_index.hpp>
+#include <graphene/db/node_pool.hpp>
 #include <boost/multi_index/composite_key.hpp>
 
 namespace graphene { namespace chain {
@@ -22,15 +24,6 @@ namespace graphene { namespace chain {
          static const uint8_t space_id = protocol_ids;
          static const uint8_t type_id  = platform_object_type;
 
-         struct Platform_Period_Profits
-         {
-             map<asset_aid_type, share_type>        rewards_profits;
-             share_type                             foward_profits    = 0;
-             share_type                             post_profits      = 0; //if poster and platform is the same account , include post,platform and buyout profits from content
-             share_type                             post_profits_by_platform = 0;//only platform from content
-             share_type                             platform_profits  = 0;
-         };
-         
          /// The owner account's uid.
          account_uid_type owner = 0;
          /// The platform's name.
@@ -51,9 +44,6 @@ namespace graphene { namespace chain {
          fc::time_point_sec  average_pledge_last_update;
          uint32_t            average_pledge_next_update_block;
 
-         map<time_point_sec, share_type>        vote_profits;
-         map<uint32_t, Platform_Period_Profits> period_profits;
-
          // Other information (api interface address, other URL, platform introduction, etc.)
          string extra_data = "{}";
 
@@ -61,44 +51,15 @@ namespace graphene { namespace chain {
          time_point_sec last_update_time;
 
          platform_id_type get_id()const { return id; }
-         void add_period_profits(uint32_t   period,
-                                 uint32_t   lastest_periods,
-                                 asset      reward_profit = asset(),
-                                 share_type forward_profit = 0,
-                                 share_type post_profit = 0,
-                                 share_type platform_profit = 0,
-                                 share_type post_profit_by_platform = 0
-                                 )
+
+         /// the fields changed by votes, for object_database::modify_fields()
+         struct vote_fields
          {
-             auto iter = period_profits.find(period);
-             if (iter != period_profits.end())
-             {
-                 if (reward_profit != asset()){
-                     auto iter_reward = iter->second.rewards_profits.find(reward_profit.asset_id);
-                     if (iter_reward != iter->second.rewards_profits.end())
-                         iter_reward->second += reward_profit.amount;
-                     else
-                         iter->second.rewards_profits.emplace(reward_profit.asset_id, reward_profit.amount);
-                 }
-                 iter->second.foward_profits   += forward_profit;
-                 iter->second.post_profits     += post_profit;
-                 iter->second.platform_profits += platform_profit;
-                 iter->second.post_profits_by_platform += post_profit_by_platform;
-             }
-             else
-             {
-                 if (period_profits.size() >= lastest_periods)
-                     period_profits.erase(period_profits.begin());
-                 Platform_Period_Profits profits;
-                 if (reward_profit != asset())
-                     profits.rewards_profits.emplace(reward_profit.asset_id, reward_profit.amount);
-                 profits.foward_profits   = forward_profit;
-                 profits.post_profits     = post_profit;
-                 profits.platform_profits = platform_profit;
-                 profits.post_profits_by_platform = post_profit_by_platform;
-                 period_profits.emplace(period, profits);
-             }
-         }
+            explicit vote_fields( const platform_object& p ):total_votes( p.total_votes ){}
+            void restore( platform_object& p )const { p.total_votes = total_votes; }
+
+            uint64_t total_votes;
+         };
    };
 
 
@@ -176,6 +137,95 @@ namespace graphene { namespace chain {
     */
    typedef generic_index<platform_object, platform_multi_index_type> platform_index;
 
+   /**
+    * @brief The profits of a platform in an active post period
+    * @ingroup object
+    * @ingroup implementation
+    *
+    * Only the latest periods are kept, see database::add_platform_period_profits().
+    */
+   class platform_period_profit_object : public graphene::db::abstract_object<platform_period_profit_object>
+   {
+      public:
+         static const uint8_t space_id = implementation_ids;
+         static const uint8_t type_id  = impl_platform_period_profit_object_type;
+
+         platform_id_type                       platform;
+         uint32_t                               period_sequence = 0;
+
+         map<asset_aid_type, share_type>        rewards_profits;
+         share_type                             foward_profits    = 0;
+         share_type                             post_profits      = 0; //if poster and platform is the same account , include post,platform and buyout profits from content
+         share_type                             post_profits_by_platform = 0;//only platform from content
+         share_type                             platform_profits  = 0;
+   };
+
+   struct by_platform_period{};
+
+   /**
+    * @ingroup object_index
+    */
+   typedef multi_index_container<
+      platform_period_profit_object,
+      indexed_by<
+         ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
+         ordered_unique< tag<by_platform_period>,
+            composite_key<
+               platform_period_profit_object,
+               member<platform_period_profit_object, platform_id_type, &platform_period_profit_object::platform>,
+               member<platform_period_profit_object, uint32_t,         &platform_period_profit_object::period_sequence>
+            >
+         >
+      >
+   > platform_period_profit_multi_index_type;
+
+   /**
+    * @ingroup object_index
+    */
+   typedef generic_index<platform_period_profit_object, platform_period_profit_multi_index_type> platform_period_profit_index;
+
+   /**
+    * @brief A platform award by votes received by a platform
+    * @ingroup object
+    * @ingroup implementation
+    *
+    * Only the latest awards are kept, see database::add_platform_vote_profit().
+    */
+   class platform_vote_profit_object : public graphene::db::abstract_object<platform_vote_profit_object>
+   {
+      public:
+         static const uint8_t space_id = implementation_ids;
+         static const uint8_t type_id  = impl_platform_vote_profit_object_type;
+
+         platform_id_type    platform;
+         time_point_sec      award_time;
+         share_type          profit = 0;
+   };
+
+   struct by_platform_award_time{};
+
+   /**
+    * @ingroup object_index
+    */
+   typedef multi_index_container<
+      platform_vote_profit_object,
+      indexed_by<
+         ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
+         ordered_unique< tag<by_platform_award_time>,
+            composite_key<
+               platform_vote_profit_object,
+               member<platform_vote_profit_object, platform_id_type, &platform_vote_profit_object::platform>,
+               member<platform_vote_profit_object, time_point_sec,   &platform_vote_profit_object::award_time>
+            >
+         >
+      >
+   > platform_vote_profit_multi_index_type;
+
+   /**
+    * @ingroup object_index
+    */
+   typedef generic_index<platform_vote_profit_object, platform_vote_profit_multi_index_type> platform_vote_profit_index;
+
    /**
     * @brief This class represents a platform voting on the object graph
     * @ingroup object
@@ -270,6 +320,10 @@ namespace graphene { namespace chain {
          string                       extra_data; ///< category, tags and etc
          string                       title;
          string                       body;
+         /// set instead of body and extra_data when they are kept in the post content store, see
+         /// database::set_post_content()
+         optional<content_ref>        body_ref;
+         optional<content_ref>        extra_data_ref;
 
          time_point_sec create_time;
          time_point_sec last_update_time;
@@ -345,7 +399,8 @@ namespace graphene { namespace chain {
                                    std::greater<object_id_type> >
 
          >
-      >
+      >,
+      node_pool_allocator<post_object>
    > post_multi_index_type;
 
    /**
@@ -365,13 +420,6 @@ namespace graphene { namespace chain {
        static const uint8_t space_id = protocol_ids;
        static const uint8_t type_id = active_post_object_type;
 
-       struct receiptor_detail
-       {
-          share_type  forward;
-          share_type  post_award;
-          map<asset_aid_type, share_type> rewards;
-       };
-
        /// The platform's pid.
        account_uid_type                       platform;
        /// The poster's uid.
@@ -388,42 +436,17 @@ namespace graphene { namespace chain {
        bool                                   positive_win = true;
        share_type                             post_award;
        share_type                             forward_award;
-       map<account_uid_type, receiptor_detail> receiptor_details;
+       /// number of the active_post_receiptor_objects of the post
+       uint32_t                               receiptor_count = 0;
 
-       void insert_receiptor(account_uid_type uid, share_type post_award = 0, share_type forward = 0)
-       {
-          if (receiptor_details.count(uid))
-          {
-             receiptor_details.at(uid).forward += forward;
-             receiptor_details.at(uid).post_award += post_award;
-          }
-          else
-          {
-             receiptor_detail detail;
-             detail.forward = forward;
-             detail.post_award = post_award;
-             receiptor_details.emplace(uid, detail);
-          }
-       }
-       void insert_reward_receiptor(account_uid_type uid, asset reward)
-       {
-          if (receiptor_details.count(uid))
-          {
-             if (receiptor_details.at(uid).rewards.count(reward.asset_id))
-                receiptor_details.at(uid).rewards.at(reward.asset_id) += reward.amount;
-             else
-                receiptor_details.at(uid).rewards.emplace(reward.asset_id, reward.amount);
-          }
-          else
-          {
-             receiptor_detail detail;
-             detail.rewards.emplace(reward.asset_id, reward.amount);
-             receiptor_details.emplace(uid, detail);
-          }
-       }
+       /// effective csaf of the post and the part of it from the scores, set while settling the content awards
+       share_type                             effective_csaf;
+       share_type                             approval_amount;
+
+       active_post_id_type get_id()const { return id; }
 
        bool is_get_profit()const {
-          if (post_award == 0 && forward_award == 0 && receiptor_details.size() == 0)
+          if (post_award == 0 && forward_award == 0 && receiptor_count == 0)
              return false;
           else
              return true;
@@ -475,7 +498,8 @@ namespace graphene { namespace chain {
                >
             >,
           ordered_non_unique< tag<by_period_sequence>, member<active_post_object, uint64_t, &active_post_object::period_sequence> >
-		 >
+		 >,
+       node_pool_allocator<active_post_object>
 	 > active_post_multi_index_type;
 
 	 /**
@@ -483,6 +507,91 @@ namespace graphene { namespace chain {
 	 */
 	 typedef generic_index<active_post_object, active_post_multi_index_type> active_post_index;
 
+   /**
+    * @brief The receipts of an account from an active post
+    * @ingroup object
+    * @ingroup implementation
+    *
+    * Kept apart from active_post_object so that a post with many receiptors doesn't copy all of them when it is
+    * modified. Removed with the active post.
+    */
+   class active_post_receiptor_object : public graphene::db::abstract_object<active_post_receiptor_object>
+   {
+      public:
+         static const uint8_t space_id = implementation_ids;
+         static const uint8_t type_id  = impl_active_post_receiptor_object_type;
+
+         active_post_id_type                active_post;
+         account_uid_type                   receiptor = 0;
+
+         share_type                         forward;
+         share_type                         post_award;
+         map<asset_aid_type, share_type>    rewards;
+   };
+
+   struct by_active_post_receiptor{};
+
+   /**
+    * @ingroup object_index
+    */
+   typedef multi_index_container<
+      active_post_receiptor_object,
+      indexed_by<
+         ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
+         ordered_unique< tag<by_active_post_receiptor>,
+            composite_key<
+               active_post_receiptor_object,
+               member<active_post_receiptor_object, active_post_id_type, &active_post_receiptor_object::active_post>,
+               member<active_post_receiptor_object, account_uid_type,    &active_post_receiptor_object::receiptor>
+            >
+         >
+      >
+   > active_post_receiptor_multi_index_type;
+
+   /**
+    * @ingroup object_index
+    */
+   typedef generic_index<active_post_receiptor_object, active_post_receiptor_multi_index_type> active_post_receiptor_index;
+
+   /**
+   * @brief This class tracks the settlement of the content awards of a finished period
+   * @ingroup object
+   * @ingroup implementation
+   *
+   * From HARDFORK_0_6_TIME the content awards of a period are not paid by the block that ends the period, but by
+   * the following blocks, GRAPHENE_CONTENT_AWARD_POSTS_PER_BLOCK active posts at a time: the posts are scanned for
+   * their effective csaf first, then paid in proportion to it, and the platforms are paid last.
+   * There is only one such object, it stays idle between two settlements.
+   */
+   class content_award_settlement_object : public graphene::db::abstract_object<content_award_settlement_object>
+   {
+   public:
+      static const uint8_t space_id = implementation_ids;
+      static const uint8_t type_id = impl_content_award_settlement_object_type;
+
+      enum settlement_stage
+      {
+         idle     = 0,
+         scanning = 1, ///< computing the effective csaf of the posts
+         paying   = 2  ///< paying the posts and their scorers
+      };
+
+      uint8_t              stage = idle;
+      /// period sequence of the active posts being settled
+      uint64_t             period_sequence = 0;
+      /// the active posts of a period have increasing ids, the first one of the period and the next one to settle
+      active_post_id_type  first_post;
+      active_post_id_type  next_post;
+
+      share_type           content_award_amount;
+      share_type           platform_award_amount;
+      share_type           total_csaf_amount;
+      share_type           total_effective_csaf_amount;
+      flat_map<account_uid_type, share_type> platform_csaf_amount;
+
+      bool is_settling()const { return stage != idle; }
+   };
+
    /**
    * @brief This class represents scores for a post
    * @ingroup object
@@ -568,7 +677,8 @@ namespace graphene { namespace chain {
                                   std::less<object_id_type >>
                                   >,
 		  ordered_non_unique< tag<by_create_time>,member< score_object, time_point_sec, &score_object::create_time> >
-       >
+       >,
+      node_pool_allocator<score_object>
    > score_multi_index_type;
 
    /**
@@ -631,18 +741,23 @@ namespace graphene { namespace chain {
    typedef generic_index<license_object, license_multi_index_type> license_index;
 }}
 
-FC_REFLECT( graphene::chain::platform_object::Platform_Period_Profits,
-                    (rewards_profits)(foward_profits)(post_profits)(post_profits_by_platform)(platform_profits))
-
 FC_REFLECT_DERIVED( graphene::chain::platform_object,
                     (graphene::db::object),
                     (owner)(name)(sequence)(is_valid)(total_votes)(url)
                     (pledge)(pledge_last_update)(average_pledge)(average_pledge_last_update)(average_pledge_next_update_block)
-                    (vote_profits)(period_profits)
                     (extra_data)
                     (create_time)(last_update_time)
                   )
 
+FC_REFLECT_DERIVED( graphene::chain::platform_period_profit_object, (graphene::db::object),
+                    (platform)(period_sequence)
+                    (rewards_profits)(foward_profits)(post_profits)(post_profits_by_platform)(platform_profits)
+                  )
+
+FC_REFLECT_DERIVED( graphene::chain::platform_vote_profit_object, (graphene::db::object),
+                    (platform)(award_time)(profit)
+                  )
+
 FC_REFLECT_DERIVED( graphene::chain::platform_vote_object, (graphene::db::object),
                     (voter_uid)
                     (voter_sequence)
@@ -655,17 +770,28 @@ FC_REFLECT_DERIVED( graphene::chain::post_object,
                     (platform)(poster)(post_pid)(post_type)(origin_poster)(origin_post_pid)(origin_platform)
                     (hash_value)(extra_data)(title)(body)
                     (create_time)(last_update_time)(receiptors)(forward_price)(license_lid)(permission_flags)(score_settlement)
+                    (body_ref)(extra_data_ref)
                   )
 
-FC_REFLECT( graphene::chain::active_post_object::receiptor_detail,
-                    (forward)(post_award)(rewards))
+FC_REFLECT_DERIVED( graphene::chain::active_post_receiptor_object,
+                    (graphene::db::object),
+                    (active_post)(receiptor)(forward)(post_award)(rewards)
+                  )
 
 FC_REFLECT_DERIVED( graphene::chain::active_post_object,
 										(graphene::db::object),
                     (platform)(poster)(post_pid)(total_csaf)(total_rewards)(period_sequence)
-                    (positive_win)(post_award)(forward_award)(receiptor_details)
+                    (positive_win)(post_award)(forward_award)(receiptor_count)
+                    (effective_csaf)(approval_amount)
 									)
 
+FC_REFLECT_DERIVED( graphene::chain::content_award_settlement_object,
+                    (graphene::db::object),
+                    (stage)(period_sequence)(first_post)(next_post)
+                    (content_award_amount)(platform_award_amount)(total_csaf_amount)(total_effective_csaf_amount)
+                    (platform_csaf_amount)
+                  )
+
 FC_REFLECT_DERIVED(graphene::chain::score_object,
 					     (graphene::db::object),
                     (from_account_uid)(platform)(poster)(post_pid)(score)(csaf)(period_sequence)(profits)(create_time)
@@ -673,4 +799,13 @@ FC_REFLECT_DERIVED(graphene::chain::score_object,
 
 FC_REFLECT_DERIVED(graphene::chain::license_object,
                     (graphene::db::object), (license_lid)(platform)(license_type)(hash_value)(extra_data)(title)(body)(create_time)
-					   )
\ No newline at end of file
+					   )
+
+GRAPHENE_DB_PRIMARY_INDEX( graphene::chain::platform_object,
+                           graphene::db::primary_index<graphene::chain::platform_index> )
+GRAPHENE_DB_PRIMARY_INDEX( graphene::chain::post_object,
+                           graphene::db::primary_index<graphene::chain::post_index> )
+GRAPHENE_DB_PRIMARY_INDEX( graphene::chain::active_post_object,
+                           graphene::db::primary_index<graphene::chain::active_post_index> )
+GRAPHENE_DB_PRIMARY_INDEX( graphene::chain::score_object,
+                           graphene::db::primary_index<graphene::chain::score_index> )
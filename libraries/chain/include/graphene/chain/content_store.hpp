@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <fc/crypto/ripemd160.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace fc { class file_mapping; class mapped_region; }
+
+namespace graphene { namespace chain {
+
+   /// Reference of an object to a value kept in a @ref content_store
+   struct content_ref
+   {
+      fc::ripemd160 hash;
+      uint32_t      size = 0;
+   };
+
+   /**
+    *  @brief Big values of objects, e.g. the bodies of the posts, kept in a file instead of the object database.
+    *
+    *  The values are appended to a single file, each after its hash and size, and found by their hash, so a value
+    *  stored again, e.g. by the same transaction applied in a block after it was pending, is stored once. A new value
+    *  is kept in memory with the number of the first block which stored it until that block is written out, usually
+    *  once it is irreversible, and dropped if the block is popped or the value was only stored by pending
+    *  transactions. Nothing written is ever removed or overwritten: the objects keep the reference of their value,
+    *  and the undo states the reference of the previous one, which is still there when the change is undone.
+    *
+    *  Values are read through a read-only memory mapping of the file. What stays in memory is the offset of each
+    *  value by hash. The store may be read from other threads than the one writing it, every call takes a lock.
+    */
+   class content_store
+   {
+      public:
+         content_store();
+         ~content_store();
+
+         /// Opens or creates the store in @p dir, a value cut short at the end of the file is dropped
+         void open( const fc::path& dir );
+         bool is_open()const;
+         /// The file holding the values
+         const fc::path& filename()const { return _filename; }
+         void close();
+
+         /**
+          * Stores @p value if it isn't there yet, in memory until flush_until_block() reaches @p block_num
+          * @param block_num the block applying the value, 0 for a pending or validated transaction
+          */
+         content_ref put( const std::string& value, uint32_t block_num );
+         bool contains( const content_ref& ref )const;
+         /// @return the value of @p ref, which must be in the store
+         std::string get( const content_ref& ref )const;
+
+         /// Drops the values only stored by pending transactions, which are about to be undone
+         void discard_pending();
+         /// Drops the values first stored by the blocks from @p block_num on, which are about to be popped
+         void discard_from_block( uint32_t block_num );
+         /// Writes out the values stored by the blocks up to @p block_num
+         void flush_until_block( uint32_t block_num );
+
+         /// Number of values, written out or not, and bytes of the file
+         uint64_t value_count()const;
+         uint64_t file_size()const;
+
+      private:
+         /// what precedes each value in the file
+         struct value_header
+         {
+            fc::ripemd160 hash;
+            uint32_t      size = 0;
+         };
+         /// a value which isn't written out yet
+         struct unwritten_value
+         {
+            std::string value;
+            /// the first block which stored it, 0 if only pending transactions did
+            uint32_t    block_num = 0;
+         };
+
+         /// @return the mapped bytes of the value at @p pos, nullptr if the file is too short
+         const char* mapped_value( uint64_t pos, uint32_t size )const;
+
+         mutable std::mutex                             _mutex;
+         fc::path                                       _filename;
+         mutable std::fstream                           _file;
+         uint64_t                                       _file_size = 0;
+         /// position of each value after its header
+         std::unordered_map<fc::ripemd160, uint64_t>    _positions;
+         std::unordered_map<fc::ripemd160, unwritten_value> _unwritten;
+         mutable std::unique_ptr<fc::file_mapping>      _mapping;
+         mutable std::unique_ptr<fc::mapped_region>     _region;
+   };
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::content_ref, (hash)(size) )
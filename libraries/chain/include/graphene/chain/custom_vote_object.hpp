@@ -28,6 +28,9 @@ namespace graphene { namespace chain {
       std::set<uint8_t>          vote_result;
     
       time_point_sec             vote_expired_time;
+
+      /// custom_vote_weight_object::weight of the voter when its balance changes were last added to the custom vote
+      share_type                 weight_snapshot = 0;
    };
      
    struct by_custom_vote_vid{};
@@ -76,6 +79,50 @@ namespace graphene { namespace chain {
    */
    typedef generic_index<cast_custom_vote_object, cast_custom_vote_multi_index_type> cast_custom_vote_index;
 
+   /**
+   * @brief The balance changes of a voter who cast custom votes
+   * @ingroup object
+   * @ingroup implementation
+   *
+   * The balance changes are added to the custom votes of a cast only when it expires or is cast again, until then
+   * database::get_custom_vote_result() adds weight - cast_custom_vote_object::weight_snapshot. The casts expired
+   * before settled_until have been added already.
+   */
+   class custom_vote_weight_object : public graphene::db::abstract_object<custom_vote_weight_object>
+   {
+   public:
+      static const uint8_t space_id = implementation_ids;
+      static const uint8_t type_id = impl_custom_vote_weight_object_type;
+
+      account_uid_type           voter;
+      asset_aid_type             vote_asset_id;
+      share_type                 weight = 0;
+      time_point_sec             settled_until;
+   };
+
+   struct by_voter_asset{};
+
+   /**
+   * @ingroup object_index
+   */
+   typedef multi_index_container<
+      custom_vote_weight_object,
+      indexed_by<
+      ordered_unique< tag<by_id>, member< object, object_id_type,  &object::id > >,
+      ordered_unique< tag<by_voter_asset>,
+         composite_key<
+            custom_vote_weight_object,
+            member< custom_vote_weight_object, account_uid_type,   &custom_vote_weight_object::voter>,
+            member< custom_vote_weight_object, asset_aid_type,     &custom_vote_weight_object::vote_asset_id>>
+         >
+      >
+   > custom_vote_weight_multi_index_type;
+
+   /**
+   * @ingroup object_index
+   */
+   typedef generic_index<custom_vote_weight_object, custom_vote_weight_multi_index_type> custom_vote_weight_index;
+
 
    /**
    * @brief This class custom vote
@@ -101,6 +148,7 @@ namespace graphene { namespace chain {
       uint8_t                    maximum_selected_items;
 
       std::vector<string>        options;
+      /// without the balance changes of the voters not settled yet, see database::get_custom_vote_result()
       std::vector<uint64_t>      vote_result;
    };
 
@@ -139,4 +187,8 @@ FC_REFLECT_DERIVED( graphene::chain::custom_vote_object,
 
 FC_REFLECT_DERIVED( graphene::chain::cast_custom_vote_object,
                    (graphene::db::object),
-                   (voter)(custom_vote_creator)(custom_vote_vid)(vote_asset_id)(vote_result)(vote_expired_time))
\ No newline at end of file
+                   (voter)(custom_vote_creator)(custom_vote_vid)(vote_asset_id)(vote_result)(vote_expired_time)(weight_snapshot))
+
+FC_REFLECT_DERIVED( graphene::chain::custom_vote_weight_object,
+                   (graphene::db::object),
+                   (voter)(vote_asset_id)(weight)(settled_until))
\ No newline at end of file
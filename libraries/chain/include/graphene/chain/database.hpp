@@ -32,28 +32,85 @@
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/fork_database.hpp>
 #include <graphene/chain/block_database.hpp>
+#include <graphene/chain/object_archive.hpp>
+#include <graphene/chain/applied_operations_log.hpp>
 #include <graphene/chain/genesis_state.hpp>
+#include <graphene/chain/signature_key_cache.hpp>
+#include <graphene/chain/recent_transaction_cache.hpp>
+#include <graphene/chain/account_authority_cache.hpp>
+#include <graphene/chain/state_snapshot.hpp>
+#include <graphene/chain/block_profile.hpp>
+#include <graphene/chain/slot_timing.hpp>
+#include <graphene/chain/state_diff.hpp>
+#include <graphene/chain/pending_transaction_stats.hpp>
+#include <graphene/chain/hardfork_rules.hpp>
+#include <graphene/chain/evaluation_profile.hpp>
 #include <graphene/chain/evaluator.hpp>
 
 #include <graphene/db/object_database.hpp>
 #include <graphene/db/object.hpp>
 #include <graphene/db/simple_index.hpp>
+#include <graphene/db/flat_index.hpp>
 #include <fc/signals.hpp>
+#include <fc/thread/future.hpp>
 
 #include <graphene/chain/protocol/protocol.hpp>
 
+#include <boost/thread/shared_mutex.hpp>
+
 #include <fc/log/logger.hpp>
 
+#include <atomic>
+#include <deque>
 #include <map>
+#include <set>
+
+namespace graphene { namespace utilities {
+   class thread_pool;
+   class metrics_registry;
+   class metric_counter;
+   class metric_histogram;
+} }
 
 namespace graphene { namespace chain {
    using graphene::db::abstract_object;
    using graphene::db::object;
-   class op_evaluator;
    class transaction_evaluation_state;
 
    struct budget_record;
 
+   /**
+    * @brief all objects created, modified and removed by one applied block
+    *
+    * The ids are kept in separate arrays per kind of change. The accounts impacted by each kind of change are
+    * only computed the first time they are asked for, which is rare as most subscribers only filter by object id.
+    * A change log and the object pointers in it are only valid while the signal carrying it is being emitted.
+    */
+   class object_change_log
+   {
+      public:
+         explicit object_change_log( const db::object_database& db ):_db(db){}
+
+         vector<object_id_type>  new_ids;
+         vector<object_id_type>  changed_ids;
+         vector<object_id_type>  removed_ids;
+         /// last value of every removed object, in the same order as removed_ids
+         vector<const object*>   removed_objects;
+         /// value of every changed object before the block, in the same order as changed_ids,
+         /// the current value for the objects only changed through object_database::modify_fields()
+         vector<const object*>   changed_old_values;
+
+         const flat_set<account_uid_type>& new_accounts_impacted()const;
+         const flat_set<account_uid_type>& changed_accounts_impacted()const;
+         const flat_set<account_uid_type>& removed_accounts_impacted()const;
+
+      private:
+         const db::object_database&                     _db;
+         mutable optional< flat_set<account_uid_type> > _new_accounts_impacted;
+         mutable optional< flat_set<account_uid_type> > _changed_accounts_impacted;
+         mutable optional< flat_set<account_uid_type> > _removed_accounts_impacted;
+   };
+
    /**
     *   @class database
     *   @brief tracks the blockchain state in an extensible manner
@@ -110,6 +167,56 @@ namespace graphene { namespace chain {
           */
          void reindex(fc::path data_dir);
 
+         /// the checks reindex() skips, the blocks of the own block database having been checked before
+         static const uint32_t replay_skip_flags = skip_witness_signature |
+                                                   skip_transaction_signatures |
+                                                   skip_transaction_dupe_check |
+                                                   skip_tapos_check |
+                                                   skip_witness_schedule_check |
+                                                   skip_invariants_check |
+                                                   skip_authority_check;
+
+         /**
+          * @brief Reads the blocks [first, last] of a block database in order, as reindex() does
+          *
+          * When worker threads are available, blocks are read ahead of the caller and handed to the workers to be
+          * unpacked and pre-validated (block id, merkle root, signature keys), so that only applying them is left
+          * to the caller. The queue of pending blocks is bounded to keep memory usage flat.
+          */
+         class block_read_ahead
+         {
+            public:
+               /// @param skip the flags the blocks will be applied with, to tell which signature keys are needed
+               block_read_ahead( const database& db, const block_database& source, uint32_t first, uint32_t last,
+                                 uint32_t skip );
+               ~block_read_ahead();
+
+               /**
+                * @return the next block, null when it is missing or can't be decoded
+                * @param skip gets skip_merkle_check added when the merkle root of the block was checked already
+                */
+               optional<signed_block> next( uint32_t& skip );
+
+            private:
+               struct decoded_block
+               {
+                  optional<signed_block> block;
+                  bool                   merkle_checked = false;
+               };
+               void fill();
+
+               const database&                         _db;
+               const block_database&                   _source;
+               const uint32_t                          _last;
+               const uint32_t                          _skip;
+               const chain_id_type                     _chain_id;
+               size_t                                  _max_read_ahead = 0;
+               uint32_t                                _next_to_read;
+               uint32_t                                _next_to_return;
+               uint32_t                                _next_worker = 0;
+               std::deque< fc::future<decoded_block> > _read_ahead;
+         };
+
          /**
           * @brief wipe Delete database from disk, and potentially the raw chain as well.
           * @param include_blocks If true, delete the raw chain as well as the database.
@@ -119,6 +226,25 @@ namespace graphene { namespace chain {
          void wipe(const fc::path& data_dir, bool include_blocks);
          void close(bool rewind = true);
 
+         /**
+          * @brief Write the state at the head block to a state snapshot in @p dir
+          *
+          * The pending transactions are left out. The indexes are saved and checksummed on the worker threads,
+          * see set_worker_threads(). @p dir must not exist yet.
+          */
+         void export_state_snapshot( const fc::path& dir );
+         /**
+          * @brief Replace the state in @p data_dir with the state snapshot in @p snapshot_dir
+          *
+          * Must be called before open(), which then loads the snapshot like a flushed state. The snapshot is
+          * checked against its manifest first, on the worker threads. The blocks in @p data_dir are removed, since
+          * they don't belong to the new state, so the node starts at the head block of the snapshot.
+          */
+         void import_state_snapshot( const fc::path& snapshot_dir, const fc::path& data_dir,
+                                     const std::string& db_version );
+         /// the version open() was called with, which the state snapshots it exports are written with
+         const std::string& get_db_version()const { return _db_version; }
+
          //////////////////// db_block.cpp ////////////////////
 
          /**
@@ -130,7 +256,17 @@ namespace graphene { namespace chain {
          block_id_type              get_block_id_for_num( uint32_t block_num )const; // get from disk directly
          block_id_type              fetch_block_id_for_num( uint32_t block_num )const; // check fork db first
          optional<signed_block>     fetch_block_by_id( const block_id_type& id )const;
+         /// Serialized block of the id, a block stored on disk is copied without being unpacked
+         optional<vector<char>>     fetch_raw_block_by_id( const block_id_type& id )const;
          optional<signed_block>     fetch_block_by_number( uint32_t num )const;
+         /**
+          *  Same as calling fetch_block_by_number() for every number in [first, last], but the irreversible blocks are
+          *  read from disk with range reads and unpacked on the worker threads. @p last is lowered to the head block.
+          */
+         vector<optional<signed_block>>  fetch_blocks_by_number( uint32_t first, uint32_t last )const;
+         /// Serialized blocks of [first, last] up to the head block, the irreversible ones are copied from disk without
+         /// being unpacked
+         vector<optional<vector<char>>>  fetch_raw_blocks_by_number( uint32_t first, uint32_t last )const;
          const signed_transaction&  get_recent_transaction( const transaction_id_type& trx_id )const;
          std::vector<block_id_type> get_block_ids_on_fork(block_id_type head_of_fork) const;
 
@@ -143,11 +279,51 @@ namespace graphene { namespace chain {
          void                              add_checkpoints( const flat_map<uint32_t,block_id_type>& checkpts );
          const flat_map<uint32_t,block_id_type> get_checkpoints()const { return _checkpoints; }
          bool before_last_checkpoint()const;
+         /**
+          * @return true if the block is at or before the last checkpoint and the checkpoints have ids. Such blocks
+          * are trusted: they are applied without any check, their signatures aren't recovered and, while they
+          * extend the head block, they bypass the fork database.
+          */
+         bool is_checkpointed( uint32_t block_num )const;
 
          bool push_block( const signed_block& b, uint32_t skip = skip_nothing );
+         /**
+          * Recovers the witness keys of blocks about to be pushed on the worker threads, e.g. the backlog of blocks
+          * received while syncing, results are cached in signed_block_header::precomputed_signee until the block is
+          * pushed. The blocks must not be pushed or changed concurrently.
+          */
+         void precompute_block_signees( const vector<const signed_block*>& blocks );
          processed_transaction push_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
+         /**
+          * Like above, but when the transaction is admitted to the pending state it is moved there instead of being
+          * copied, e.g. a transaction just decoded from the network. @p trx is left untouched when it fails.
+          */
+         processed_transaction push_transaction( signed_transaction&& trx, uint32_t skip = skip_nothing );
          bool _push_block( const signed_block& b );
-         processed_transaction _push_transaction( const signed_transaction& trx );
+         /**
+          * @param authority when it holds the result of an earlier authority check of @p trx which is known to
+          *                  still hold, it is used instead of checking the authority again, see
+          *                  head_block_changed_authorities()
+          * @param received  when @p trx was first pushed, for the age of the pending transactions, now if unset
+          */
+         processed_transaction _push_transaction( const signed_transaction& trx,
+                                                  const optional<signed_information>& authority = optional<signed_information>(),
+                                                  fc::time_point received = fc::time_point() );
+         processed_transaction _push_transaction( signed_transaction&& trx,
+                                                  const optional<signed_information>& authority = optional<signed_information>(),
+                                                  fc::time_point received = fc::time_point() );
+
+         /**
+          * Runs the checks of an incoming transaction which don't depend on chain state, i.e. validate() and
+          * recovering the signature keys, so that push_transaction() only has the stateful part left to do.
+          *
+          * With worker threads the checks run on one of them while the calling (chain) thread is free to
+          * process other transactions and blocks in the meantime. Without worker threads, or when too many
+          * transactions are already in flight, only validate() is run inline.
+          *
+          * @throws fc::exception if the transaction fails validate()
+          */
+         void prevalidate_transaction( const signed_transaction& trx );
 
          ///@throws fc::exception if the proposed transaction fails to apply.
          processed_transaction push_proposal(const proposal_object& proposal, const signed_information& sigs);
@@ -164,9 +340,115 @@ namespace graphene { namespace chain {
             const fc::ecc::private_key& block_signing_private_key
             );
 
+         /**
+          * Produces @p count empty blocks in a row, each one at the next slot by its scheduled witness, for tests
+          * and benchmarks which go through many blocks. The blocks are applied like any other. They aren't
+          * signed, and no pending block is built for them. They don't emit the object change signals, and they
+          * emit applied_block only when they have operations, e.g. virtual ones. There must be no pending
+          * transactions.
+          * @return the last block
+          */
+         signed_block generate_empty_blocks( uint32_t count, uint32_t skip );
+
+         /**
+          * Builds the unsigned block generate_block() would produce at @p when from the current pending
+          * transactions, ahead of the slot. If neither the head block changes nor the pending state is cleared
+          * in the meantime, generate_block() only has to sign and push it. Transactions pushed after this are
+          * then left pending for the next block.
+          */
+         void prepare_block(
+            const fc::time_point_sec when,
+            account_uid_type witness_uid,
+            uint32_t skip
+            );
+
          void pop_block();
          void clear_pending();
 
+         /**
+          * Applies the changes a block made on another node, e.g. the primary node of a replica, instead of the
+          * block itself: no transaction is evaluated, no signature is checked and no maintenance is done. The block
+          * is stored as if it was pushed. When it doesn't build on the head block, the blocks down to the one it
+          * builds on are popped first. The pending transactions are dropped. It can't be used with the applied
+          * operations log, the diff doesn't have the operations of the block.
+          */
+         void apply_state_diff( const state_diff& diff );
+         /// Keeps the state diffs of the last @p count blocks applied for get_state_diffs(), 0 (the default) for none
+         void set_state_diffs_kept( uint32_t count );
+         uint32_t get_state_diffs_kept()const { return _state_diffs_kept; }
+         /**
+          * @return the kept state diffs of the blocks after @p after up to the head block, at most @p limit of them.
+          * When @p after isn't on the current chain, e.g. it was switched away, they start after the last
+          * irreversible block. Empty when the diffs that follow aren't kept.
+          */
+         vector<state_diff> get_state_diffs( const block_id_type& after, uint32_t limit )const;
+
+         /**
+          * Keeps about @p count transactions pending at most, 0 (the default) for no limit. Once there are @p count,
+          * a transaction is only accepted if it pays a higher fee rate than the lowest pending one, and the lowest
+          * ones are dropped when the pending transactions are applied again after the next block. Never more than
+          * twice @p count are kept.
+          */
+         void set_max_pending_transactions( uint32_t count ) { _max_pending_transactions = count; }
+         uint32_t get_max_pending_transactions()const { return _max_pending_transactions; }
+         /// @return whether the limit of set_max_pending_transactions() is reached
+         bool pending_transactions_full()const;
+
+         /// @return the fee per KiB paid by @p trx, counting the fees paid from balance, prepaid and CSAF alike
+         static uint64_t fee_rate( const signed_transaction& trx );
+         /// Like above, with the packed size of @p trx already known
+         static uint64_t fee_rate( const signed_transaction& trx, size_t packed_size );
+         /**
+          * @return the order to apply @p transactions in when building a block: by decreasing fee_rate(), except
+          * that a transaction is never put before an earlier one of the same fee payer, as it may depend on it.
+          * The pending transactions are applied again after a block in the order they arrived in instead.
+          */
+         static vector<size_t> order_by_fee_rate( const vector<processed_transaction>& transactions );
+
+         /// Size and age of the pending transactions, and the time to apply them again and the rejections so far
+         pending_transaction_stats get_pending_transaction_stats()const;
+         /// Logs get_pending_transaction_stats() every @p blocks pushed blocks, 0 (the default) to never log them
+         void set_pending_transaction_log_interval( uint32_t blocks ) { _pending_tx_log_interval = blocks; }
+
+         /**
+          * Held shared by the threads which read the state beside the chain thread, e.g. the API threads, and
+          * exclusively by the chain thread while it changes the state, see state_write_scope.
+          */
+         boost::shared_mutex& state_mutex()const { return _state_mutex; }
+
+         /**
+          * The workers checking the signatures of blocks and transactions, null when there are none. A reader
+          * holding state_mutex() shared can fan its work out to them as long as its tasks don't take the lock.
+          */
+         graphene::utilities::thread_pool* get_thread_pool()const { return _thread_pool.get(); }
+
+         /**
+          * Holds state_mutex() exclusively for its lifetime, unless an outer scope on the chain thread already
+          * does. Every public call which changes the state opens one.
+          */
+         class state_write_scope
+         {
+            public:
+               explicit state_write_scope( database& db );
+               ~state_write_scope();
+            private:
+               database& _db;
+         };
+
+         /**
+          * @return true unless the last block is known to have left all account authorities, the authority
+          *         depth limit and the enabled hard fork unchanged, i.e. unless the authority checks of the
+          *         pending transactions made before the block still hold after it
+          */
+         bool head_block_changed_authorities()const;
+         /**
+          * @return the number of blocks applied or popped so far, head_block_changed_authorities() only tells
+          *         about the changes since the pending transactions were checked when it went up by one since
+          */
+         uint64_t head_block_changes()const { return _head_block_changes; }
+         /// @return a number which changes whenever the pending state does, i.e. a transaction is pushed or it is cleared
+         uint64_t pending_state_revision()const { return _pending_state_revision; }
+
          /**
           *  This method is used to track appied operations during the evaluation of a block, these
           *  operations should include any operation actually included in a transaction as well
@@ -177,8 +459,70 @@ namespace graphene { namespace chain {
           *  @return the op_id which can be used to set the result after it has finished being applied.
           */
          uint32_t  push_applied_operation( const operation& op );
+         /// Moves in @p op, for the virtual operations built only to be pushed
+         uint32_t  push_applied_operation( operation&& op );
          void      set_applied_operation_result( uint32_t op_id, const operation_result& r );
          const vector<optional< operation_history_object > >& get_applied_operations()const;
+         /**
+          *  The accounts impacted by each of get_applied_operations(), in the same order, see
+          *  operation_history_get_impacted_account_uids(). They are computed once for all the observers, the first
+          *  time this is called after the operations of the block are applied, so it's called from the chain thread.
+          */
+         const vector< flat_set<account_uid_type> >& get_applied_operations_impacted_accounts()const;
+
+         typedef std::shared_ptr< const vector< optional<operation_history_object> > > applied_operations_ptr;
+         typedef std::shared_ptr< const vector< flat_set<account_uid_type> > >        applied_operations_impacted_ptr;
+         /**
+          *  Shares the applied operations and their impacted accounts with an applied_block observer which keeps
+          *  them past the signal, instead of copying them. The database starts new lists for the next block rather
+          *  than clearing shared ones, so they are never modified afterwards.
+          */
+         applied_operations_ptr share_applied_operations()const;
+         applied_operations_impacted_ptr share_applied_operations_impacted_accounts()const;
+
+         /// Number of objects each of the cleanup passes of the last applied block handled, not part of the state
+         struct cleanup_counts
+         {
+            uint32_t expired_transactions = 0;
+            uint32_t expired_proposals = 0;
+            uint32_t expired_scores = 0;
+            uint32_t expired_limit_orders = 0;
+            uint32_t expired_csaf_leases = 0;
+            uint32_t advertising_orders = 0;
+            uint32_t custom_votes = 0;
+            uint32_t cast_custom_votes = 0;
+            uint32_t witness_average_pledges = 0;
+            uint32_t platform_average_pledges = 0;
+            /// expired scores left to be removed by the next blocks
+            uint64_t expired_scores_backlog = 0;
+         };
+         const cleanup_counts& get_last_cleanup_counts()const { return _cleanup_counts; }
+
+         /// Time and changes of the operations applied so far, in the pending state and in blocks, not part of the state
+         evaluation_profiler& get_evaluation_profiler() { return _evaluation_profiler; }
+         const evaluation_profiler& get_evaluation_profiler()const { return _evaluation_profiler; }
+         /// Logs the evaluation profile and resets it every @p blocks applied blocks, 0 (the default) to never log it
+         void set_evaluation_profile_log_interval( uint32_t blocks ) { _evaluation_profile_log_interval = blocks; }
+
+         /// Durations of the phases of the last applied blocks, not part of the state
+         block_profiler& get_block_profiler() { return _block_profiler; }
+         const block_profiler& get_block_profiler()const { return _block_profiler; }
+         /// How long after their slot time the blocks of each witness were signed by this node or received by it,
+         /// not part of the state
+         slot_timing_tracker& get_slot_timings() { return _slot_timings; }
+         const slot_timing_tracker& get_slot_timings()const { return _slot_timings; }
+         /**
+          *  Exports the time to apply each block and the applied blocks and transactions to @p metrics, and the undo
+          *  states and pending transactions when it is rendered, which must then be on the thread of the database.
+          *  Nothing is exported when null (the default).
+          */
+         void set_metrics( graphene::utilities::metrics_registry* metrics );
+         /// Logs the profile of every block which takes at least @p threshold_us to apply, 0 (the default) to log none
+         void set_slow_block_log_threshold( int64_t threshold_us ) { _slow_block_log_threshold_us = threshold_us; }
+
+         /// Logs get_index_memory_stats() when the database is closed, off by default as it goes through all objects
+         void set_log_index_memory_on_close( bool enable ) { _log_index_memory_on_close = enable; }
+         void log_index_memory_stats()const;
 
          string to_pretty_string( const asset& a )const;
          string to_pretty_core_string( const share_type amount )const;
@@ -193,6 +537,13 @@ namespace graphene { namespace chain {
           */
          fc::signal<void(const signed_block&)>           applied_block;
 
+         /**
+          *  Emitted after a block has been applied while the undo states use more memory than the limit set
+          *  with set_undo_database_memory_limit(), with the memory they use. It's emitted again after every
+          *  block until they fit, so the node can shut down cleanly before it runs out of memory.
+          */
+         fc::signal<void(uint64_t)>                      undo_memory_limit_exceeded;
+
          /**
           * This signal is emitted any time a new transaction is added to the pending
           * block state.
@@ -215,6 +566,13 @@ namespace graphene { namespace chain {
           * pointer to the last value of every object that was removed.
           */
          fc::signal<void(const vector<object_id_type>&, const vector<const object*>&, const flat_set<account_uid_type>&)>  removed_objects;
+
+         /**
+          *  Emitted once after a block has been applied with all the objects it created, changed and removed.
+          *  Unlike the three signals above the impacted accounts are computed on demand. When nothing is
+          *  connected to any of these signals no change log is built at all. The callback should not yield.
+          */
+         fc::signal<void(const object_change_log&)>                                  block_objects_changed;
       
          /** this signal is emitted any time account balance adjust for update vote
           */
@@ -295,6 +653,27 @@ namespace graphene { namespace chain {
          void clear_voter_committee_member_votes( const voter_object& voter );
          void clear_voter_platform_votes( const voter_object& voter );
          uint32_t process_invalid_proxied_voters( const voter_object& proxy, uint32_t max_voters_to_process );
+         void apply_witness_votes( const witness_object& witness, share_type delta );
+         void apply_platform_votes( const platform_object& platform, share_type delta );
+         void apply_committee_member_votes( const committee_member_object& committee_member, share_type delta );
+
+         /**
+          * While a batch is open, adjust_witness_votes(), adjust_platform_votes() and
+          * adjust_committee_member_votes() only add the deltas up per candidate, flush() modifies each candidate
+          * once with the sum. Only for passes which don't read the votes of the candidates before flush(). The
+          * deltas are dropped if the batch is left without flush(), e.g. by an exception. A batch opened inside
+          * another one does nothing, the outer one flushes.
+          */
+         class candidate_vote_batch
+         {
+            public:
+               explicit candidate_vote_batch( database& db );
+               ~candidate_vote_batch();
+               void flush();
+            private:
+               database& _db;
+               bool      _owner;
+         };
 
          //////////////////// db_getter.cpp ////////////////////
       public:
@@ -308,6 +687,8 @@ namespace graphene { namespace chain {
          const dynamic_global_property_object&  get_dynamic_global_properties()const;
          const node_property_object&            get_node_properties()const;
          const fee_schedule&                    current_fee_schedule()const;
+         /// the hard fork rules in effect at the head block, resolve them once before going through many objects
+         hardfork_rules                         get_hardfork_rules()const;
 
          time_point_sec   head_block_time()const;
          uint32_t         head_block_num()const;
@@ -321,8 +702,24 @@ namespace graphene { namespace chain {
 
          uint32_t last_non_undoable_block_num() const;
 
+         /// @return the first block whose objects are in the undo history, the blocks before it can't be undone
+         uint32_t earliest_versioned_block_num()const;
+         /// @return the first block find_object_at_block() can look at, before earliest_versioned_block_num() if
+         ///         the object archive covers older blocks
+         uint32_t earliest_lookup_block_num()const;
+         /**
+          * @return a copy of the object @p id as of the end of block @p block_num, without the changes of the
+          *         later blocks and of the pending transactions, nullptr if it didn't exist then
+          *
+          * The old values are taken from the undo states of the reversible blocks, so readers can pin a block
+          * and keep seeing the same versions while the next blocks are applied, and from the object archive for
+          * the older blocks. @p block_num must be between earliest_lookup_block_num() and the head block.
+          */
+         unique_ptr<object> find_object_at_block( object_id_type id, uint32_t block_num )const;
+
          const account_object& get_account_by_uid( account_uid_type uid )const;
          const account_object* find_account_by_uid( account_uid_type uid )const;
+         const account_object* find_account_by_name( const string& name )const;
          const optional<account_id_type> find_account_id_by_uid( account_uid_type uid )const;
          const _account_statistics_object& get_account_statistics_by_uid( account_uid_type uid )const;
          account_statistics_object get_account_statistics_struct_by_uid(account_uid_type uid)const;
@@ -360,6 +757,9 @@ namespace graphene { namespace chain {
          const platform_object& get_platform_by_owner( account_uid_type owner )const;
          const platform_object* find_platform_by_sequence( account_uid_type owner, uint32_t sequence )const;
          const platform_object* find_platform_by_owner(account_uid_type owner)const;
+         const platform_period_profit_object* find_platform_period_profit(platform_id_type platform, uint32_t period)const;
+         const active_post_receiptor_object* find_active_post_receiptor(active_post_id_type active_post,
+                                                                        account_uid_type receiptor)const;
          const platform_vote_object* find_platform_vote( account_uid_type voter_uid,
                                                         uint32_t         voter_sequence,
                                                         account_uid_type platform_owner,
@@ -372,6 +772,15 @@ namespace graphene { namespace chain {
                                               account_uid_type poster,
                                               post_pid_type post_pid )const;
 
+         /// Returns a copy of @p post with body and extra_data read back from the content store
+         post_object with_post_content( const post_object& post )const;
+         /**
+          * Stores @p value inline in @p field when small, otherwise in the content store and sets @p ref. The
+          * content store only writes out the values of the blocks which became irreversible.
+          */
+         void set_post_content( const string& value, string& field, optional<content_ref>& ref );
+         const content_store& get_post_contents()const { return _post_contents; }
+
          const license_object& get_license_by_platform(account_uid_type platform, license_lid_type license_lid)const;
          const license_object* find_license_by_platform(account_uid_type platform, license_lid_type license_lid)const;
          const score_object& get_score(account_uid_type platform,
@@ -382,6 +791,15 @@ namespace graphene { namespace chain {
                                         account_uid_type poster,
                                         post_pid_type post_pid,
                                         account_uid_type from_account)const;
+         /**
+          * @return the scores created at or before this time have expired. From HARDFORK_0_6_TIME only a limited
+          *         number of them is removed per block, the ones left count as removed already.
+          */
+         time_point_sec get_score_expiration_time()const;
+         /// sum of the scores of a post weighed by their csaf, (csaf * score / 5) * casf_modulus
+         share_type get_post_approval_csaf(const active_post_object& active_post)const;
+         /// get_post_approval_csaf() of each post, in order, computed on the worker threads when there are enough posts
+         vector<share_type> get_post_approval_csafs(const vector<const active_post_object*>& posts)const;
 
          const advertising_object*  find_advertising(account_uid_type platform, advertising_aid_type advertising_aid)const;
          const advertising_object&  get_advertising(account_uid_type platform, advertising_aid_type advertising_aid)const;
@@ -391,6 +809,8 @@ namespace graphene { namespace chain {
 
          const custom_vote_object& get_custom_vote_by_vid(account_uid_type creator, custom_vote_vid_type vote_vid)const;
          const custom_vote_object* find_custom_vote_by_vid(account_uid_type creator, custom_vote_vid_type vote_vid)const;
+         /// @return the vote result of a custom vote with the balance changes of its voters not settled yet
+         vector<uint64_t> get_custom_vote_result(const custom_vote_object& vote)const;
 
          //////////////////// db_init.cpp ////////////////////
 
@@ -403,7 +823,7 @@ namespace graphene { namespace chain {
          void register_evaluator()
          {
             _operation_evaluators[
-               operation::tag<typename EvaluatorType::operation_type>::value].reset( new op_evaluator_impl<EvaluatorType>() );
+               operation::tag<typename EvaluatorType::operation_type>::value] = &evaluate_operation<EvaluatorType>;
          }
 
          //////////////////// db_balance.cpp ////////////////////
@@ -419,6 +839,8 @@ namespace graphene { namespace chain {
          asset get_balance(const account_object& owner, const asset_object& asset_obj)const;
          /// This is an overloaded method.
          asset get_balance(const account_object& owner, asset_aid_type asset_id)const;
+         /// @return the balance object of owner in asset_id, nullptr if the account never held the asset
+         const account_balance_object* find_account_balance( account_uid_type owner, asset_aid_type asset_id )const;
 
          /**
           * @brief Adjust a particular account's balance in a given asset by a delta
@@ -427,16 +849,26 @@ namespace graphene { namespace chain {
           */
          void adjust_balance(account_uid_type account, asset delta);
          void adjust_balance(const account_object& account, asset delta);
+         /// Adjusts the balance of an account already found, e.g. through transaction_evaluation_state::find_balance()
+         void adjust_balance(const account_balance_object& balance, asset delta);
 
          // helper to handle witness pay
          void deposit_witness_pay(const witness_object& wit, share_type amount, scheduled_witness_type wit_type);
 
+         /**
+          * @brief Recompute the coin seconds of all the accounts of a batch at the head block time and store them
+          * @param batch accounts added with the hard fork their effective balance is taken from
+          */
+         void update_coin_seconds_earned(coin_seconds_batch& batch);
+
 
          //////////////////// db_debug.cpp ////////////////////
 
          void debug_dump();
          void apply_debug_updates();
          void debug_update( const fc::variant_object& update );
+         /// Applies @p update to the state as it is, unlike debug_update() it isn't applied again with the head block
+         void debug_update_state( const fc::variant_object& update );
 
          //////////////////// db_notify.cpp ////////////////////
 
@@ -469,11 +901,43 @@ namespace graphene { namespace chain {
          ///@{
          int match(const limit_order_object& taker, const limit_order_object& maker, const price& trade_price);
 
+         /**
+         * What all fills of one taker order share: the assets of the market and the taker's account, looked up
+         * once, and the taker's proceeds, which apply_order() adds to its balance after the last fill.
+         */
+         struct order_match_context
+         {
+            /// @param defer_proceeds whether the taker's proceeds may wait, see @ref defer_taker_proceeds
+            order_match_context( database& db, const limit_order_object& taker, bool defer_proceeds );
+
+            const account_object& taker_seller;
+            const asset_object&   taker_receive_asset;
+            const asset_object&   maker_receive_asset;
+            /**
+            * Only when the taker already has a balance of a non-core receive asset, so that no balance object is
+            * created in another order and no coin seconds or votes are updated in another way than fill by fill.
+            */
+            bool                  defer_taker_proceeds;
+            /// what the fills paid to the taker so far, after the market fees, while it is deferred
+            asset                 taker_proceeds;
+         };
+
+         int match(const limit_order_object& taker, const limit_order_object& maker, const price& trade_price,
+                   order_match_context& context);
+         ///@}
+
          /**
          * @return true if the order was completely filled and thus freed.
          */
          bool fill_limit_order(const limit_order_object& order, const asset& pays, const asset& receives, bool cull_if_small,
              const price& fill_price, const bool is_maker);
+         /**
+         * Same as above with the seller and the receive asset already looked up. When @p deferred_receives isn't
+         * null the seller's proceeds are added to it instead of to the seller's balance.
+         */
+         bool fill_limit_order(const limit_order_object& order, const asset& pays, const asset& receives, bool cull_if_small,
+             const price& fill_price, const bool is_maker, const account_object& seller, const asset_object& recv_asset,
+             asset* deferred_receives);
 
          // helpers to fill_order
          void pay_order(const account_object& receiver, const asset& receives, const asset& pays);
@@ -493,9 +957,13 @@ namespace graphene { namespace chain {
 
       private:
          optional<undo_database::session>       _pending_tx_session;
-         vector< unique_ptr<op_evaluator> >     _operation_evaluators;
+         /// by operation tag, null for the operations without an evaluator
+         vector< operation_evaluate_function >  _operation_evaluators;
 
          uint32_t                               _check_invariants_interval = uint32_t(-1);
+         bool                                   _check_invariants_async = false;
+         bool                                   _check_supply_totals = false;
+         fc::future<void>                       _invariants_check;
          uint32_t                               _advertising_order_remaining_time = 86400*365;
          uint32_t                               _custom_vote_remaining_time = 86400*365;
 
@@ -509,6 +977,65 @@ namespace graphene { namespace chain {
          operation_result      apply_operation(transaction_evaluation_state& eval_state, const operation& op, const signed_information& sigs = signed_information());
 
          void set_check_invariants_interval(uint32_t interval){ _check_invariants_interval = interval; }
+         /**
+          * If enabled, the periodic invariants check doesn't run while applying the block but is scheduled right
+          * after it on the calling thread, and failures are only logged since the block is already accepted.
+          */
+         void set_check_invariants_async(bool enable){ _check_invariants_async = enable; }
+         /**
+          * If enabled, the supply of every asset is checked against the running balance, pledge and order totals
+          * after each block that is applied without skip_invariants_check. It doesn't scan the accounts, so it's
+          * cheap enough to be done on every block, unlike the full invariants check.
+          */
+         void set_check_supply_totals(bool enable){ _check_supply_totals = enable; }
+         /**
+          * Sets the number of worker threads used for CPU bound work that can run outside of the
+          * main thread, such as recovering signature keys of the transactions in a block.
+          * 0 (the default) means everything runs on the calling thread.
+          */
+         void set_worker_threads( uint32_t num_threads );
+         uint32_t get_worker_threads()const;
+         /// Restricts the worker threads to @p cpus, see graphene::utilities::parse_cpu_list()
+         void pin_worker_threads( const vector<uint32_t>& cpus );
+         /// Serve block lookups from memory mappings of the block database files, must be set before open()
+         void set_block_database_mmap( bool enable ) { _block_id_to_block.set_use_mmap( enable ); }
+         /// Store new blocks compressed, see block_database::set_compression()
+         void set_block_database_compression( bool enable ) { _block_id_to_block.set_compression( enable ); }
+         /// Number of the last stored blocks kept in memory, see block_database::set_cache_size()
+         void set_block_cache_size( uint32_t size ) { _block_id_to_block.set_cache_size( size ); }
+         /// Number of the last block numbers whose ids are kept in memory, 0 for all, see block_database::set_ids_kept()
+         void set_block_ids_kept( uint32_t count ) { _block_id_to_block.set_ids_kept( count ); }
+         /// Number of blocks stored in memory before they are written at once, see block_database::set_write_batch()
+         void set_block_database_write_batch( uint32_t blocks ) { _block_id_to_block.set_write_batch( blocks ); }
+         /// Sync each batch of block writes to the disk, see block_database::set_sync_writes()
+         void set_block_database_sync_writes( bool enable ) { _block_id_to_block.set_sync_writes( enable ); }
+         /// Keep the past versions of the objects in an object_archive, so find_object_at_block() can look at any
+         /// block from where it started, must be set before open()
+         void set_object_archive_enabled( bool enable ) { _object_archive_enabled = enable; }
+         const object_archive& get_object_archive()const { return _object_archive; }
+         /// Keep the operations applied by each block in an applied_operations_log, must be set before open()
+         void set_applied_operations_log_enabled( bool enable ) { _applied_operations_log_enabled = enable; }
+         const applied_operations_log& get_applied_operations_log()const { return _applied_operations_log; }
+         /// Read access to the stored blocks, including their serialized form and index entries
+         const block_database& get_block_database()const { return _block_id_to_block; }
+         /// Memory limit of the blocks of the fork database, 0 for none, see fork_database::set_memory_limit(), must be set before open()
+         void set_fork_database_memory_limit( uint64_t max_bytes ) { _fork_db_memory_limit = max_bytes; }
+         fork_database_stats get_fork_database_stats()const { return _fork_db.get_stats(); }
+         /// The switches to other forks done since the node started
+         const fork_switch_stats& get_fork_switch_stats()const { return _fork_switch_stats; }
+         /// Memory limit of the undo states, 0 for none, see undo_memory_limit_exceeded
+         void set_undo_database_memory_limit( uint64_t max_bytes ) { _undo_db.set_memory_limit( max_bytes ); }
+         undo_database_stats get_undo_database_stats()const { return _undo_db.get_stats(); }
+         /// Number of keys recovered from transaction signatures to keep, 0 to recover the keys every time
+         void set_signature_key_cache_size( size_t max_size ) { _signature_key_cache.set_max_size( max_size ); }
+         const signature_key_cache& get_signature_key_cache()const { return _signature_key_cache; }
+         /// Number of the last transactions kept for get_recent_transaction(), 0 to keep none
+         void set_recent_transactions_kept( size_t max_size ) { _recent_transactions.set_max_size( max_size ); }
+         const recent_transaction_cache& get_recent_transactions()const { return _recent_transactions; }
+         /// Accounts whose authorities were looked up while the current block is applied
+         account_authority_cache& get_account_authority_cache() { return _account_authority_cache; }
+         /// Resolves account authorities for verify_authority_with(), through the account authority cache
+         account_authority_resolver get_authority_resolver() { return account_authority_resolver{ *this, _account_authority_cache }; }
          void set_advertising_remain_time(uint32_t time){ _advertising_order_remaining_time = time; }
          void set_custom_vote_remain_time(uint32_t time){ _custom_vote_remaining_time = time; }
          /**
@@ -519,8 +1046,49 @@ namespace graphene { namespace chain {
 
       private:
 
+         /// Where close() keeps the blocks of the other forks for open(), see fork_database::save_forks()
+         fc::path              saved_forks_file()const;
          void                  _apply_block( const signed_block& next_block );
-         processed_transaction _apply_transaction( const signed_transaction& trx );
+         /// keeps the changes of @p block, whose undo state is the head one, see set_state_diffs_kept()
+         void                  record_state_diff( const signed_block& block );
+         /// adds the old values of the objects changed by block @p block_num, whose undo state is the head one,
+         /// to the object archive
+         void                  archive_head_block( uint32_t block_num );
+         /// A block being generated, with what is needed to finish it taken as its transactions were added
+         struct working_block
+         {
+            signed_block        block;
+            /// merkle digests of the transactions of the block
+            vector<digest_type> merkle_digests;
+            /// upper bound of the packed size of the signed block
+            size_t              packed_size = 0;
+         };
+         /// Applies @p transactions again on top of the head block in a new pending session, as the block at @p when
+         working_block         _build_pending_block( const fc::time_point_sec when, account_uid_type witness_uid,
+                                                     const vector<processed_transaction>& transactions );
+         /**
+          * @param authority when set and valid, the authority check is skipped and its content used instead,
+          *                  when set and not valid, it receives the result of the authority check if one is made
+          */
+         processed_transaction _apply_transaction( const signed_transaction& trx,
+                                                   optional<signed_information>* authority = nullptr );
+         /// Like above, but @p trx is moved into the result when it is applied successfully
+         processed_transaction _apply_transaction( signed_transaction&& trx,
+                                                   optional<signed_information>* authority = nullptr );
+         /// Counts @p trx in the rejections of get_pending_transaction_stats() by the reason it failed with @p e
+         void count_rejected_transaction( const signed_transaction& trx, const fc::exception& e );
+         /// Everything _apply_transaction() does except building the processed transaction
+         vector<operation_result> _apply_transaction_operations( const signed_transaction& trx,
+                                                                 optional<signed_information>* authority );
+
+         /// @return true if the authority of the transaction need to be checked with the given skip flags
+         bool need_authority_check( const signed_transaction& trx, uint32_t skip )const;
+         /// Recovers signature keys, hashes the ids and validates the operations of all transactions in the block on
+         /// the worker threads, results are cached in signed_transaction::signees, signed_transaction::precomputed_id
+         /// and signed_transaction::validated
+         void precompute_signature_keys( const signed_block& next_block, uint32_t skip );
+         /// signed_block::calculate_merkle_root() with the digests of big blocks hashed on the worker threads
+         checksum_type calculate_merkle_root( const signed_block& block )const;
 
          ///Steps involved in applying a new block
          ///@{
@@ -533,16 +1101,88 @@ namespace graphene { namespace chain {
 
          //////////////////// db_update.cpp ////////////////////
       public:
+         /**
+          * Apply the items of an approved proposal. The items are checked against the state at execution, not
+          * at approval: the accounts, registrars and pledges they refer to may change in between.
+          */
          void execute_committee_proposal( const committee_proposal_object& proposal, bool silent_fail = false );
          void set_active_post_periods(const uint32_t& periods){ _latest_active_post_periods = periods; }
          uint32_t get_active_post_periods()const{ return _latest_active_post_periods; }
+         /// adds to the profits of a platform in a period, only the latest get_active_post_periods() periods are kept
+         void add_platform_period_profits(const platform_object& platform,
+                                          uint32_t   period,
+                                          asset      reward_profit = asset(),
+                                          share_type forward_profit = 0,
+                                          share_type post_profit = 0,
+                                          share_type platform_profit = 0,
+                                          share_type post_profit_by_platform = 0);
+         /// records an award by votes of a platform, only the latest get_active_post_periods() awards are kept
+         void add_platform_vote_profit(const platform_object& platform, time_point_sec award_time, share_type profit);
+         /// adds to the receipts of an account from an active post
+         void add_active_post_receipts(const active_post_object& active_post,
+                                       account_uid_type receiptor,
+                                       share_type post_award,
+                                       share_type forward = 0);
+         /// adds to the rewards an account received from an active post
+         void add_active_post_reward_receipts(const active_post_object& active_post, account_uid_type receiptor, asset reward);
+
+         /**
+          * While a batch is open, modify_dynamic_global_properties() changes a copy of the dynamic global
+          * properties, which get_dynamic_global_properties() returns meanwhile, and flush() writes the copy back
+          * with one modify(). So the passes at the end of a block modify, undo-save and notify the object once
+          * instead of once each. The copy is dropped if the batch is left without flush(), e.g. by an exception.
+          * A batch opened inside another one does nothing, the outer one flushes.
+          */
+         class dynamic_global_property_batch
+         {
+            public:
+               explicit dynamic_global_property_batch( database& db );
+               ~dynamic_global_property_batch();
+               void flush();
+            private:
+               database& _db;
+               bool      _owner;
+         };
+         /**
+          * Writes the copy of an open dynamic_global_property_batch back and changes the object in place until
+          * the pause is left, for changes with an undo session of their own, such as the operations of a proposal.
+          * The batch copies the object again in the same place afterwards. References to the object itself got
+          * during the pause are not to be used after it.
+          */
+         class dynamic_global_property_batch_pause
+         {
+            public:
+               explicit dynamic_global_property_batch_pause( database& db );
+               ~dynamic_global_property_batch_pause();
+            private:
+               database& _db;
+               bool      _paused;
+         };
+
+         /// modifies the dynamic global properties, or their copy while a dynamic_global_property_batch is open
+         template<typename Lambda>
+         void modify_dynamic_global_properties( const Lambda& m )
+         {
+            if( _batching_dynamic_global_properties )
+            {
+               m( *_batched_dynamic_global_properties );
+               _batched_dynamic_global_properties_changed = true;
+            }
+            else
+               modify( get_dynamic_global_properties(), m );
+         }
       private:
+         /// writes the copy of the open dynamic_global_property_batch back if it was changed, and forgets it
+         void write_batched_dynamic_global_properties();
+         /// adjusts the balance, balance_obj is the balance object of account in the asset, nullptr if there's none
+         void adjust_balance( account_uid_type account, asset delta, const account_balance_object* balance_obj );
          void update_global_dynamic_data( const signed_block& b );
          void update_undo_db_size();
          void update_signing_witness(const witness_object& signing_witness, const signed_block& new_block);
          share_type get_witness_pay_by_pledge(const global_property_object& gpo, const dynamic_global_property_object& dpo, const uint16_t by_pledge_witness_count);
          void update_last_irreversible_block();
          void clear_expired_transactions();
+         void log_evaluation_profile();
          void clear_expired_proposals();
          void clear_active_post();
          void clear_unnecessary_objects();//advertising order, custom vote and cast custom vote
@@ -567,12 +1207,61 @@ namespace graphene { namespace chain {
          void update_voter_effective_votes();
          void adjust_budgets();
          void update_committee();
+         /// only the proposals due at the head block are visited, through by_approved_closing_block
          void clear_unapproved_committee_proposals();
+         /// only the proposals due at the head block are visited, through by_approved_execution_block
          void execute_committee_proposals();
          void check_invariants();
+         void check_supply_totals();
+         void schedule_invariants_check();
          void clear_resigned_platform_votes();
          void process_content_platform_awards();
          void process_platform_voted_awards();
+
+         /// amounts a content award is shared out by
+         struct content_award_totals
+         {
+            fc::uint128_t content_award_amount;
+            share_type    total_effective_csaf_amount;
+         };
+         /**
+          * Amounts by account, appended in any order while going through the posts and summed up by account once
+          * at the end, which is much cheaper than keeping a map up to date for every amount.
+          */
+         struct account_amounts
+         {
+            vector< std::pair<account_uid_type, share_type> > entries;
+
+            void add( account_uid_type uid, share_type amount ){ entries.emplace_back( uid, amount ); }
+            /// sorts the entries by account and sums up the ones of the same account
+            void sum_by_account();
+         };
+         /// content award payments collected while going through the posts, paid by pay_content_award_payouts()
+         struct content_award_payouts
+         {
+            account_amounts adjust_balance_map;
+            /// platform => (receipts of its posts, receipts only from the platform)
+            flat_map<account_uid_type, std::pair<share_type, share_type>> platform_receiptor_award;
+            account_amounts registrar_and_referrer_award;
+         };
+         /// @tparam HeadFork05 whether the ENABLE_HEAD_FORK_05 rules apply, see hardfork_rules::head_fork_05
+         template<bool HeadFork05>
+         void award_content_post(const active_post_object& active_post,
+                                 share_type post_effective_csaf,
+                                 share_type post_approval_csaf,
+                                 const content_award_totals& totals,
+                                 content_award_payouts& payouts);
+         void award_content_platforms(uint64_t period_sequence,
+                                      fc::uint128_t platform_award_amount,
+                                      share_type total_csaf_amount,
+                                      const flat_map<account_uid_type, share_type>& platform_csaf_amount,
+                                      content_award_payouts& payouts);
+         /// @return the total paid
+         share_type pay_content_award_payouts(uint64_t period_sequence, content_award_payouts& payouts);
+         /// starts settling the content awards of the current period, see @ref content_award_settlement_object
+         void begin_content_award_settlement();
+         /// settles the content awards of at most max_posts active posts of the period being settled
+         void settle_content_awards(uint32_t max_posts);
          void process_pledge_balance_release();
 
          void update_platform_avg_pledge( const account_uid_type uid );
@@ -584,6 +1273,12 @@ namespace graphene { namespace chain {
          void update_pledge_mining_bonus();
          void update_pledge_mining_bonus_by_witness(const witness_object& witness_obj);
          share_type update_pledge_mining_bonus_by_account(const pledge_mining_object& pledge_mining_obj, share_type bonus_per_pledge);
+         /**
+          * @return the head block number up to which @p pledge_mining_obj got the bonus of its witness @p witness_obj,
+          *         i.e. the one of the last periodic pass when it had a pledge then, else its last_bonus_block_num
+          */
+         uint32_t pledge_mining_bonus_block_num(const pledge_mining_object& pledge_mining_obj,
+                                                const witness_object& witness_obj)const;
 
 
       public:
@@ -594,7 +1289,29 @@ namespace graphene { namespace chain {
       private:
 
          vector< processed_transaction >        _pending_tx;
+         /// result of the authority check of each transaction of _pending_tx, if it was checked
+         vector< optional<signed_information> > _pending_tx_authorities;
+         /// incremented whenever _pending_tx is cleared
+         uint64_t                               _pending_tx_clears = 0;
+         /// fee_rate() of every transaction of _pending_tx
+         std::multiset<uint64_t>                _pending_tx_fee_rates;
+         /// when each transaction of _pending_tx was first pushed
+         vector< fc::time_point >               _pending_tx_received;
+         /// packed size of all the transactions of _pending_tx
+         uint64_t                               _pending_tx_bytes = 0;
+         /// the counters of get_pending_transaction_stats()
+         pending_transaction_stats              _pending_tx_stats;
+         uint32_t                               _pending_tx_log_interval = 0;
+         uint32_t                               _max_pending_transactions = 0;
+         /// see prepare_block(), with the value of _pending_tx_clears it was built at
+         optional<working_block>                _prepared_block;
+         uint64_t                               _prepared_block_clears = 0;
+         /// see head_block_changes()
+         uint64_t                               _head_block_changes = 0;
+         /// see pending_state_revision()
+         uint64_t                               _pending_state_revision = 0;
          fork_database                          _fork_db;
+         uint64_t                               _fork_db_memory_limit = 0;
 
          /**
           *  Note: we can probably store blocks by block num rather than
@@ -613,19 +1330,95 @@ namespace graphene { namespace chain {
           * order they occur and is cleared after the applied_block signal is
           * emited.
           */
-         vector<optional<operation_history_object> >  _applied_ops;
+         std::shared_ptr< vector<optional<operation_history_object> > > _applied_ops
+               = std::make_shared< vector<optional<operation_history_object> > >();
+         /// impacted accounts of the first operations of _applied_ops, cleared along with it
+         mutable std::shared_ptr< vector< flat_set<account_uid_type> > > _applied_ops_impacted
+               = std::make_shared< vector< flat_set<account_uid_type> > >();
+         /// clears the lists of applied operations, or starts new ones if they are shared
+         void clear_applied_operations();
+         cleanup_counts                               _cleanup_counts;
+         evaluation_profiler                          _evaluation_profiler;
+         uint32_t                                     _evaluation_profile_log_interval = 0;
+         block_profiler                               _block_profiler;
+         slot_timing_tracker                          _slot_timings;
+         uint32_t                                     _state_diffs_kept = 0;
+         /// the state diffs kept by block id, and the ids in the order they were applied
+         std::map<block_id_type, state_diff>          _state_diffs;
+         std::deque<block_id_type>                    _state_diff_order;
+
+         /// the big post bodies and extra data, see set_post_content()
+         content_store                                _post_contents;
+         bool                                         _object_archive_enabled = false;
+         object_archive                               _object_archive;
+         bool                                         _applied_operations_log_enabled = false;
+         applied_operations_log                       _applied_operations_log;
+         fork_switch_stats                            _fork_switch_stats;
+         const voter_proxy_index*                     _voter_proxy_index = nullptr;
+         const account_name_index*                    _account_name_index = nullptr;
+         /// the ring of the block summaries of the last 0x10000 blocks, indexed by the low 16 bits of the block numbers
+         const flat_index<block_summary_object>*      _block_summary_index = nullptr;
+         /**
+          * The singleton objects, remembered by their getters the first time they are found and forgotten by
+          * initialize_indexes(). They are never removed, and undo restores them in place, so they don't move.
+          * The API threads may look them up first, concurrently, each of them finding the same object.
+          */
+         mutable std::atomic<const global_property_object*>         _global_properties{ nullptr };
+         mutable std::atomic<const dynamic_global_property_object*> _dynamic_global_properties{ nullptr };
+         mutable std::atomic<const chain_property_object*>          _chain_properties{ nullptr };
+         mutable std::atomic<const asset_object*>                   _core_asset{ nullptr };
+         int64_t                                      _slow_block_log_threshold_us = 0;
+         bool                                         _log_index_memory_on_close = false;
+         /// see set_metrics(), null when not exported
+         graphene::utilities::metric_histogram*       _block_apply_seconds = nullptr;
+         graphene::utilities::metric_counter*         _blocks_applied = nullptr;
+         graphene::utilities::metric_counter*         _transactions_applied = nullptr;
+         /// set by generate_empty_blocks() to leave out the notifications of the blocks
+         bool                                         _quiet_blocks = false;
+         /// the version open() was called with
+         std::string                                  _db_version;
+         /// the snapshot import_state_snapshot() put in place, checked against the state by open()
+         optional<state_snapshot_manifest>            _imported_snapshot;
 
          time_point_sec                    _current_block_time;
          uint32_t                          _current_block_num    = 0;
          uint16_t                          _current_trx_in_block = 0;
          uint16_t                          _current_op_in_trx    = 0;
          uint16_t                          _current_virtual_op   = 0;
+         /// the block _apply_block() is applying, 0 outside of it, e.g. for the pending transactions
+         uint32_t                          _applying_block_num   = 0;
 
          flat_map<uint32_t,block_id_type>  _checkpoints;
+         /// checkpointed blocks were pushed without the fork database, it doesn't hold the head block
+         bool                              _fork_db_behind_head = false;
 
          node_property_object              _node_property_object;
 
+         std::unique_ptr<graphene::utilities::thread_pool> _thread_pool;
+         mutable boost::shared_mutex       _state_mutex;
+         /// number of nested state_write_scope, only touched by the chain thread
+         uint32_t                          _state_write_depth = 0;
+         uint32_t                          _prevalidations_in_flight = 0;
+         uint32_t                          _next_prevalidation_thread = 0;
+         /// keys recovered when a transaction is pushed, applied in a block or generated into a block
+         signature_key_cache               _signature_key_cache;
+         /// full transactions of the transaction_objects, not part of the state
+         recent_transaction_cache          _recent_transactions;
+         /// accounts whose authorities were looked up, only filled while a block is applied
+         account_authority_cache           _account_authority_cache;
+
          uint32_t                          _latest_active_post_periods = 10;
+
+         /// vote deltas of the open candidate_vote_batch
+         bool                                             _batching_candidate_votes = false;
+         std::map< witness_id_type, share_type >          _batched_witness_votes;
+         std::map< platform_id_type, share_type >         _batched_platform_votes;
+         std::map< committee_member_id_type, share_type > _batched_committee_member_votes;
+
+         /// the copy of the dynamic global properties of the open dynamic_global_property_batch
+         bool                                             _batching_dynamic_global_properties = false;
+         optional<dynamic_global_property_object>         _batched_dynamic_global_properties;
+         bool                                             _batched_dynamic_global_properties_changed = false;
    };
 
    namespace detail
@@ -68,38 +68,75 @@ struct skip_flags_restorer
  */
 struct pending_transactions_restorer
 {
-   pending_transactions_restorer( database& db, std::vector<processed_transaction>&& pending_transactions )
-      : _db(db), _pending_transactions( std::move(pending_transactions) )
+   pending_transactions_restorer( database& db, std::vector<processed_transaction>&& pending_transactions,
+                                  std::vector< optional<signed_information> >&& pending_authorities,
+                                  std::vector<fc::time_point>&& pending_times )
+      : _db(db), _pending_transactions( std::move(pending_transactions) ),
+        _pending_authorities( std::move(pending_authorities) ), _pending_times( std::move(pending_times) ),
+        _head_block_changes( db.head_block_changes() )
    {
       _db.clear_pending();
    }
 
    ~pending_transactions_restorer()
    {
-      for( const auto& tx : _db._popped_tx )
+      // the transactions are not needed here afterwards, they are moved into the pending state when they apply
+      for( auto& tx : _db._popped_tx )
       {
          try {
             if( !_db.is_known_transaction( tx.id() ) ) {
                // since push_transaction() takes a signed_transaction,
                // the operation_results field will be ignored.
-               _db._push_transaction( tx );
+               _db._push_transaction( std::move(tx) );
             }
          } catch ( const fc::exception&  ) {
          }
       }
+      // The pending transactions still have to be applied again on top of the new head, but unless a fork was
+      // switched, several blocks were applied or the authorities were changed by the block, their earlier
+      // authority checks still hold. A fork switch only leaves _popped_tx empty when the popped blocks had no
+      // transactions, so the blocks applied and popped since are counted instead.
+      // Once one of them fails or is left out that is not known anymore, it could have changed an authority the
+      // next ones rely on.
+      // They are applied again in the order they arrived in, as one may depend on an earlier one of another fee
+      // payer, e.g. funding its payer or creating its account. Once there are too many, the fee rates tell which
+      // ones are left out, those paying the lowest, as a block would take them last.
+      const uint64_t changes = _db.head_block_changes() - _head_block_changes;
+      bool reuse_authorities = _db._popped_tx.empty()
+                               && ( changes == 0 || ( changes == 1 && !_db.head_block_changed_authorities() ) );
       _db._popped_tx.clear();
-      for( const processed_transaction& tx : _pending_transactions )
+      const uint32_t max_pending = _db.get_max_pending_transactions();
+      vector<bool> left_out( _pending_transactions.size(), false );
+      if( max_pending > 0 && _pending_transactions.size() > max_pending )
       {
+         const vector<size_t> order = database::order_by_fee_rate( _pending_transactions );
+         for( size_t n = max_pending; n < order.size(); ++n )
+            left_out[ order[n] ] = true;
+      }
+      for( size_t i = 0; i < _pending_transactions.size() && !_db.pending_transactions_full(); ++i )
+      {
+         processed_transaction& tx = _pending_transactions[i];
+         if( left_out[i] )
+         {
+            reuse_authorities = false;
+            continue;
+         }
          try
          {
             if( !_db.is_known_transaction( tx.id() ) ) {
                // since push_transaction() takes a signed_transaction,
                // the operation_results field will be ignored.
-               _db._push_transaction( tx );
+               // they keep the time they were first pushed at
+               const fc::time_point received = i < _pending_times.size() ? _pending_times[i] : fc::time_point();
+               if( reuse_authorities && i < _pending_authorities.size() )
+                  _db._push_transaction( std::move(tx), _pending_authorities[i], received );
+               else
+                  _db._push_transaction( std::move(tx), optional<signed_information>(), received );
             }
          }
          catch( const fc::exception& e )
          {
+            reuse_authorities = false;
             /*
             wlog( "Pending transaction became invalid after switching to block ${b}  ${t}", ("b", _db.head_block_id())("t",_db.head_block_time()) );
             wlog( "The invalid pending transaction caused exception ${e}", ("e", e.to_detail_string() ) );
@@ -110,6 +147,10 @@ struct pending_transactions_restorer
 
    database& _db;
    std::vector< processed_transaction > _pending_transactions;
+   std::vector< optional<signed_information> > _pending_authorities;
+   std::vector< fc::time_point > _pending_times;
+   /// head_block_changes() when the pending transactions were taken out
+   uint64_t _head_block_changes;
 };
 
 /**
@@ -140,9 +181,12 @@ template< typename Lambda >
 void without_pending_transactions(
    database& db,
    std::vector<processed_transaction>&& pending_transactions,
+   std::vector< optional<signed_information> >&& pending_authorities,
+   std::vector<fc::time_point>&& pending_times,
    Lambda callback )
 {
-    pending_transactions_restorer restorer( db, std::move(pending_transactions) );
+    pending_transactions_restorer restorer( db, std::move(pending_transactions), std::move(pending_authorities),
+                                            std::move(pending_times) );
     callback();
     return;
 }
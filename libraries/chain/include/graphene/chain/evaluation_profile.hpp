@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/types.hpp>
+
+#include <fc/time.hpp>
+
+#include <mutex>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief Time spent in the evaluators of one operation type, and the objects they changed.
+    *
+    *  The time of an operation which executes a proposal includes the operations of the proposal.
+    */
+   struct operation_profile
+   {
+      /// upper bounds of the histogram buckets, in microseconds, the last bucket has no bound
+      static const std::vector<int64_t>& bucket_bounds();
+
+      int32_t  operation_type = 0;
+      uint64_t count = 0;
+      /// time spent in do_evaluate() and in do_apply(), with the fee handling around them
+      uint64_t evaluate_us = 0;
+      uint64_t apply_us = 0;
+      /// number of operations by total evaluate and apply time, see bucket_bounds()
+      vector<uint64_t> histogram;
+      uint64_t objects_created = 0;
+      uint64_t objects_modified = 0;
+      uint64_t objects_removed = 0;
+   };
+
+   /**
+    *  @brief Collects the operation_profile of every operation type applied since the profiler was last reset.
+    *
+    *  Operations that fail are not recorded. The profiler is locked internally, so it can be read from other
+    *  threads while operations are applied.
+    */
+   class evaluation_profiler
+   {
+      public:
+         void record( int32_t operation_type, fc::microseconds evaluate_time, fc::microseconds apply_time,
+                      uint64_t objects_created, uint64_t objects_modified, uint64_t objects_removed );
+
+         /// @return the profiles of the operation types which were applied, ordered by operation type
+         vector<operation_profile> get_profiles()const;
+         void reset();
+
+      private:
+         mutable std::mutex        _mutex;
+         /// indexed by operation type, count is 0 for the types not applied yet
+         vector<operation_profile> _profiles;
+   };
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::operation_profile,
+            (operation_type)(count)(evaluate_us)(apply_us)(histogram)
+            (objects_created)(objects_modified)(objects_removed) )
@@ -51,7 +51,8 @@ namespace graphene { namespace chain {
 
       database& db()const;
 
-      void set_signed_information(const signed_information& s){ sigs = s; }
+      /// @p s must outlive the evaluator, it is referred to and not copied
+      void set_signed_information(const signed_information& s){ sigs = &s; }
 
       //void check_required_authorities(const operation& op);
    protected:
@@ -104,27 +105,25 @@ namespace graphene { namespace chain {
       const account_object*            fee_paying_account = nullptr;
       const _account_statistics_object* fee_paying_account_statistics = nullptr;
       transaction_evaluation_state*    trx_state;
-      signed_information               sigs;
+      const signed_information*        sigs = nullptr;
    };
 
-   class op_evaluator
-   {
-   public:
-      virtual ~op_evaluator(){}
-      virtual operation_result evaluate(transaction_evaluation_state& eval_state, const operation& op, bool apply, const signed_information& sigs) = 0;
-   };
+   /// Evaluates and, if apply is set, applies an operation of one type, see evaluate_operation()
+   typedef operation_result (*operation_evaluate_function)( transaction_evaluation_state& eval_state, const operation& op,
+                                                            bool apply, const signed_information& sigs );
 
+   /**
+    * The operation_evaluate_function of the operations of evaluator T. The evaluator is constructed on the stack for
+    * each operation, and as its type is known here, the calls to it are bound at compile time.
+    */
    template<typename T>
-   class op_evaluator_impl : public op_evaluator
+   operation_result evaluate_operation( transaction_evaluation_state& eval_state, const operation& op, bool apply,
+                                        const signed_information& sigs )
    {
-   public:
-      virtual operation_result evaluate(transaction_evaluation_state& eval_state, const operation& op, bool apply = true, const signed_information& sigs = signed_information()) override
-      {
-         T eval;
-         eval.set_signed_information(sigs);
-         return eval.start_evaluate(eval_state, op, apply);
-      }
-   };
+      T eval;
+      eval.set_signed_information(sigs);
+      return eval.start_evaluate(eval_state, op, apply);
+   }
 
    template<typename DerivedEvaluator>
    class evaluator : public generic_evaluator
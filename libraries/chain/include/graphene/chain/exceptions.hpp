@@ -86,6 +86,7 @@ namespace graphene { namespace chain {
    FC_DECLARE_DERIVED_EXCEPTION( invalid_committee_approval,        graphene::chain::transaction_exception, 3030006, "committee account cannot directly approve transaction" )
    FC_DECLARE_DERIVED_EXCEPTION( insufficient_fee,                  graphene::chain::transaction_exception, 3030007, "insufficient fee" )
    FC_DECLARE_DERIVED_EXCEPTION( tx_missing_secondary_auth,         graphene::chain::transaction_exception, 3030008, "missing required secondary authority" )
+   FC_DECLARE_DERIVED_EXCEPTION( pending_transactions_full,         graphene::chain::transaction_exception, 3030009, "too many pending transactions" )
 
    FC_DECLARE_DERIVED_EXCEPTION( invalid_pts_address,               graphene::chain::utility_exception, 3060001, "invalid pts address" )
    FC_DECLARE_DERIVED_EXCEPTION( insufficient_feeds,                graphene::chain::chain_exception, 37006, "insufficient feeds" )
@@ -30,6 +30,9 @@
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 
+#include <fc/filesystem.hpp>
+
+#include <fstream>
 
 namespace graphene { namespace chain {
    using boost::multi_index_container;
@@ -49,11 +52,54 @@ namespace graphene { namespace chain {
        * building on top of it.
        */
       bool                  invalid = false;
+      /**
+       * The block was applied once. Its ancestors are fixed by its id, so applying it again starts from the same state
+       * and the signatures and the merkle root checked then don't need to be checked again.
+       */
+      bool                  applied = false;
       block_id_type         id;
+      /**
+       * The transactions are left out while the block is spilled to disk, the header is always there.
+       * The blocks returned by the fork_database are complete.
+       */
       signed_block          data;
+      /// packed size of the complete block
+      uint32_t              size = 0;
+      /// where the block is in the spill file while it is spilled, see fork_database::set_memory_limit()
+      optional<uint64_t>    spill_pos;
    };
    typedef shared_ptr<fork_item> item_ptr;
 
+   /// number and size of the blocks of a fork_database
+   struct fork_database_stats
+   {
+      uint32_t item_count    = 0;
+      /// of the item_count blocks, the ones spilled to disk
+      uint32_t spilled_count = 0;
+      /// packed size of the blocks held in memory
+      uint64_t memory_bytes  = 0;
+      /// packed size of the blocks spilled to disk
+      uint64_t spilled_bytes = 0;
+   };
+
+   /// the switches of the head block to another fork done since the node started
+   struct fork_switch_stats
+   {
+      uint32_t switch_count        = 0;
+      /// of the switch_count switches, the ones that failed and went back to the original fork
+      uint32_t failed_count        = 0;
+      uint64_t blocks_popped       = 0;
+      uint64_t blocks_applied      = 0;
+      /// of the blocks_applied blocks, the ones applied before, whose signatures and merkle roots weren't checked again
+      uint64_t blocks_reapplied    = 0;
+      int64_t  total_duration_us   = 0;
+      int64_t  max_duration_us     = 0;
+      int64_t  last_duration_us    = 0;
+      /// head block number after the last switch
+      uint32_t last_head_block_num = 0;
+      fc::time_point last_switch_time;
+   };
+
 
    /**
     *  As long as blocks are pushed in order the fork
@@ -110,15 +156,61 @@ namespace graphene { namespace chain {
 
          void set_max_size( uint32_t s );
 
+         /**
+          *  Limits the memory used by the blocks to about max_bytes, 0 for no limit (the default). Over the
+          *  limit, the oldest blocks are written to a file in spill_dir, in the format of the block_database
+          *  blocks file, and their transactions dropped from memory until they are fetched again. This keeps the
+          *  memory flat while the last irreversible block doesn't move, e.g. when too many witnesses are missing.
+          */
+         void set_memory_limit( uint64_t max_bytes, const fc::path& spill_dir );
+         fork_database_stats get_stats()const;
+
+         /**
+          *  Writes the blocks above @p min_num which are not on the branch of the head to @p file, with their applied
+          *  flags, for load_forks() after a restart. The blocks of the head branch are in the block database already.
+          *  @return the number of blocks written
+          */
+         uint32_t save_forks( const fc::path& file, uint32_t min_num )const;
+         /**
+          *  Adds back the blocks written by save_forks() which link to the blocks known by now and are not above the
+          *  head, which doesn't change, then removes @p file.
+          *  @return the number of blocks added
+          */
+         uint32_t load_forks( const fc::path& file );
+
       private:
          /** @return a pointer to the newly pushed item */
          void _push_block(const item_ptr& b );
          void _push_next(const item_ptr& newly_inserted);
 
+         /// keep the sizes up to date when items are added to or removed from _index
+         void _on_insert( const item_ptr& item );
+         void _on_erase( const item_ptr& item );
+         /// spills the oldest blocks nobody else holds on to until the blocks in memory fit the memory limit
+         void _enforce_memory_limit();
+         void _spill( const item_ptr& item );
+         /// reads back the transactions of a spilled block
+         void _load( const item_ptr& item )const;
+         /// moves the spilled blocks to the start of the spill file once most of the file belongs to blocks that left it
+         void _compact_spill_file()const;
+
          uint32_t                 _max_size = 1024;
 
          fork_multi_index_type    _unlinked_index;
          fork_multi_index_type    _index;
          shared_ptr<fork_item>    _head;
+
+         uint64_t                 _memory_limit = 0;
+         fc::path                 _spill_filename;
+         mutable std::fstream     _spill_file;
+         /// the file is written from the start again once no block is spilled anymore
+         mutable uint64_t         _spill_end = 0;
+         mutable uint64_t         _memory_bytes = 0;
+         mutable uint64_t         _spilled_bytes = 0;
+         mutable uint32_t         _spilled_count = 0;
    };
 } } // graphene::chain
+
+FC_REFLECT( graphene::chain::fork_switch_stats,
+            (switch_count)(failed_count)(blocks_popped)(blocks_applied)(blocks_reapplied)
+            (total_duration_us)(max_duration_us)(last_duration_us)(last_head_block_num)(last_switch_time) )
@@ -28,6 +28,7 @@
 #include <graphene/chain/immutable_chain_parameters.hpp>
 
 #include <fc/crypto/sha256.hpp>
+#include <fc/filesystem.hpp>
 
 #include <string>
 #include <vector>
@@ -133,6 +134,28 @@ struct genesis_state_type {
    chain_id_type compute_chain_id() const;
 };
 
+/**
+ * The binary form of a genesis state is a header followed by the packed genesis_state_type, it loads much faster
+ * than the JSON of a big genesis. Unlike the JSON form its chain id is the initial_chain_id it holds, which
+ * genesis_update sets to the chain id of the JSON file it was made from. load_binary_genesis_state() checks it
+ * against json_genesis_chain_id() of the genesis it holds.
+ */
+bool is_binary_genesis_state( const string& file_contents );
+genesis_state_type load_binary_genesis_state( const string& file_contents );
+void save_binary_genesis_state( const genesis_state_type& genesis, const fc::path& filename );
+/**
+ * @return the chain id of @p genesis given as JSON, the hash of its JSON text as genesis_update writes it. The
+ *         initial_chain_id of @p genesis is written too, genesis_update leaves it empty when it writes a binary form.
+ */
+chain_id_type json_genesis_chain_id( const genesis_state_type& genesis );
+
+/**
+ * The compressed form of a genesis state, embedded by embed_genesis: the size of the packed genesis_state_type
+ * followed by its zlib stream.
+ */
+vector<char> compress_genesis_state( const genesis_state_type& genesis );
+genesis_state_type decompress_genesis_state( const char* data, size_t size );
+
 } } // namespace graphene::chain
 
 FC_REFLECT(graphene::chain::genesis_state_type::initial_account_type,
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+namespace graphene { namespace chain {
+
+   /**
+    * @brief The hard fork rules in effect at the head block
+    *
+    * Resolved once by database::get_hardfork_rules() before going through a batch of objects, so that the loops
+    * don't compare the enabled hard fork version and the hard fork times again for every object, and so that the
+    * code of each rule set can be picked once, e.g. as an instantiation of a template taking the rule as a
+    * parameter.
+    */
+   struct hardfork_rules
+   {
+      /// dynamic_global_property_object::enabled_hardfork_version >= ENABLE_HEAD_FORK_05
+      bool head_fork_05   = false;
+      /// head block time >= HARDFORK_0_6_TIME
+      bool after_0_6_time = false;
+   };
+
+} } // graphene::chain
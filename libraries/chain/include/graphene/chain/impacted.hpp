@@ -45,6 +45,14 @@ void transaction_get_impacted_account_uids(
    flat_set<account_uid_type>& result
    );
 
+/**
+ * The accounts in the history of which an applied operation goes: the accounts it impacts, the accounts whose
+ * authorities it requires, and the accounts its result refers to.
+ */
+void operation_history_get_impacted_account_uids(
+   const operation_history_object& op,
+   flat_set<account_uid_type>& result );
+
 void get_relevant_accounts( const object* obj, flat_set<account_uid_type>& accounts );
 
 } } // graphene::app
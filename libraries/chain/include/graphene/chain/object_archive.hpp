@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/types.hpp>
+
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief The past versions of the objects, kept in files to look up the state as of any archived block.
+    *
+    *  For every block it holds the values the objects it changed had before it, taken from its undo state: the
+    *  value of an object as of block n is the value saved by the first block after n which changed it, or the
+    *  current one if none did. Nothing is ever removed, the archive grows with every change.
+    *
+    *  The values are appended to a file, and a record of fixed size for each, pointing back to the previous
+    *  record of the same object, to another. What stays in memory is, for each object ever changed, the last
+    *  record and one record out of every @ref checkpoint_interval with its block, so a lookup reads at most
+    *  checkpoint_interval records.
+    *
+    *  Like the account_history_store, only blocks up to the last irreversible one are written, the later ones are
+    *  kept in memory and discarded again when they are popped.
+    *
+    *  It may be read from other threads than the one writing it, every call takes a lock.
+    */
+   class object_archive
+   {
+      public:
+         /// every n * checkpoint_interval-th version of an object has its record kept in memory
+         static const uint32_t checkpoint_interval = 64;
+
+         object_archive();
+         ~object_archive();
+
+         /// Opens or creates the archive in @p dir, what was written after the last flush is dropped
+         void open( const fc::path& dir );
+         bool is_open()const;
+         void close();
+
+         /// First block archived, 0 if none is, the state is known as of the block before it on
+         uint32_t first_block_num()const;
+         /// Last block archived, written or not
+         uint32_t last_block_num()const;
+         uint32_t flushed_block_num()const;
+
+         /**
+          * Adds the values the objects changed by @p block_num had before it, empty for the objects it created.
+          * Blocks must be appended in order, each right after the previous one.
+          */
+         void append_block( uint32_t block_num, vector< std::pair<object_id_type, vector<char>> >&& old_values );
+         /// Discards the blocks from @p block_num on, which are about to be popped, they must not be written yet
+         void discard_from_block( uint32_t block_num );
+         /// Writes out the blocks up to @p block_num
+         void flush_until_block( uint32_t block_num );
+
+         /**
+          * Looks for the first archived block after @p block_num which changed @p id.
+          * @return false if no block did, the object is the same as it is at the last archived block; otherwise
+          *         true and the packed value @p id had before that block in @p value, empty if it didn't exist
+          */
+         bool find_value_after( object_id_type id, uint32_t block_num, vector<char>& value )const;
+
+         /// Number of versions archived, written or not
+         uint64_t version_count()const;
+
+      private:
+         static const uint64_t no_record = uint64_t(-1);
+
+         /// Record of the versions file, record n is at n * sizeof(version_record)
+         struct version_record
+         {
+            uint64_t object = 0;           ///< object_id_type::number
+            uint64_t prev = no_record;     ///< previous version of the object
+            uint64_t value_pos = 0;
+            uint32_t value_size = 0;       ///< 0 if the object didn't exist
+            uint32_t block_num = 0;        ///< the block which changed the object from this value
+         };
+         struct object_head
+         {
+            uint64_t last_record = no_record;
+            uint32_t versions = 0;
+            /// the block and the record of version n * checkpoint_interval at n
+            vector< std::pair<uint32_t,uint64_t> > checkpoints;
+         };
+         struct pending_block
+         {
+            uint32_t block_num = 0;
+            std::unordered_map< uint64_t, vector<char> > old_values;
+         };
+
+         void           add_record( const version_record& r );
+         version_record read_record( uint64_t record_num )const;
+         void           save_head()const;
+
+         mutable std::recursive_mutex                _mutex;
+         fc::path                                    _dir;
+         bool                                        _open = false;
+         uint32_t                                    _first_block_num = 0;
+         uint32_t                                    _flushed_block_num = 0;
+         uint64_t                                    _record_count = 0;
+         uint64_t                                    _values_size = 0;
+         mutable std::fstream                        _records;
+         mutable std::fstream                        _values;
+         std::unordered_map< uint64_t, object_head > _heads;
+         std::deque<pending_block>                   _pending;
+         uint64_t                                    _pending_versions = 0;
+   };
+
+} } // graphene::chain
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/advertising_object.hpp>
+#include <graphene/chain/committee_member_object.hpp>
+#include <graphene/chain/content_object.hpp>
+#include <graphene/chain/witness_object.hpp>
+
+/**
+ * @file
+ * Counts of objects kept up to date as the objects change, for the count API calls, and the totals of the scores
+ * of the posts.
+ *
+ * Counting a range of an ordered index takes time linear in the size of the range, e.g. the posts of a big
+ * platform. Like the supply totals, each count is a secondary index of the counted objects, so it follows the
+ * changes made while undoing, popping blocks or loading the database too.
+ */
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief Number of posts of each platform, and of each poster on each platform.
+    */
+   class post_count_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         uint64_t post_count( account_uid_type platform )const;
+         uint64_t post_count( account_uid_type platform, account_uid_type poster )const;
+
+      private:
+         map< account_uid_type, uint64_t >                             _platform_counts;
+         map< std::pair< account_uid_type, account_uid_type >, uint64_t > _poster_counts;
+   };
+
+   /// The scores of a post, or of a post in one award period
+   struct post_score_totals
+   {
+      uint64_t   score_count = 0;
+      share_type total_csaf;
+      /// sum of csaf * score
+      share_type total_weighted_score;
+   };
+
+   /**
+    *  @brief Totals of the scores of each post, and of each post in each award period.
+    *
+    *  The scores are created once and removed when they expire, their csaf and score never change, so only
+    *  creating and removing them changes the totals.
+    */
+   class post_score_totals_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+
+         post_score_totals totals( account_uid_type platform, account_uid_type poster, post_pid_type post_pid )const;
+         post_score_totals period_totals( account_uid_type platform, account_uid_type poster, post_pid_type post_pid,
+                                          uint64_t period_sequence )const;
+
+      private:
+         void add( const score_object& s, int64_t sign );
+
+         typedef std::tuple< account_uid_type, account_uid_type, post_pid_type > post_key;
+         typedef std::tuple< account_uid_type, account_uid_type, post_pid_type, uint64_t > period_key;
+         map< post_key, post_score_totals >   _post_totals;
+         map< period_key, post_score_totals > _period_totals;
+   };
+
+   /**
+    *  @brief Number of scores created at each time, for the number of expired scores left to remove.
+    *
+    *  The scores of a block are all created at its time, so there is one entry per block with scores.
+    */
+   class score_create_time_count_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+
+         /// @return the number of scores created at or before @p time
+         uint64_t created_until( time_point_sec time )const;
+
+      private:
+         map< time_point_sec, uint64_t > _counts;
+   };
+
+   /**
+    *  @brief Number of accounts which authorized each platform.
+    */
+   class account_auth_platform_count_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         uint64_t account_count( account_uid_type platform )const;
+
+      private:
+         map< account_uid_type, uint64_t > _platform_counts;
+   };
+
+   /**
+    *  @brief Number of undetermined and of accepted orders of each advertising, and the balance the undetermined
+    *  orders hold.
+    */
+   class advertising_order_count_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         /// @return number of orders of the advertising with @p status, which is undetermined or accepted
+         uint64_t order_count( account_uid_type platform, advertising_aid_type aid, advertising_state status )const;
+         /// @return sum of the released balances of the undetermined orders
+         share_type undetermined_balance()const { return _undetermined_balance; }
+
+      private:
+         typedef std::tuple< advertising_state, account_uid_type, advertising_aid_type > order_key;
+         map< order_key, uint64_t > _order_counts;
+         share_type                 _undetermined_balance;
+   };
+
+   /**
+    *  @brief Number of the objects of ObjectType which are valid, e.g. the witnesses which did not resign.
+    */
+   template< typename ObjectType >
+   class valid_object_count_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override { add( obj, true ); }
+         virtual void object_removed( const object& obj ) override { add( obj, false ); }
+         virtual void about_to_modify( const object& before ) override { add( before, false ); }
+         virtual void object_modified( const object& after  ) override { add( after, true ); }
+
+         uint64_t valid_count()const { return _valid_count; }
+
+      private:
+         void add( const object& obj, bool added )
+         {
+            assert( dynamic_cast<const ObjectType*>(&obj) ); // for debug only
+            if( !static_cast<const ObjectType&>(obj).is_valid )
+               return;
+            if( added )
+               ++_valid_count;
+            else
+               --_valid_count;
+         }
+
+         uint64_t _valid_count = 0;
+   };
+
+   typedef valid_object_count_index< platform_object >         valid_platform_count_index;
+   typedef valid_object_count_index< witness_object >          valid_witness_count_index;
+   typedef valid_object_count_index< committee_member_object > valid_committee_member_count_index;
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::post_score_totals, (score_count)(total_csaf)(total_weighted_score) )
@@ -23,8 +23,9 @@
  */
 #pragma once
 #include <graphene/chain/protocol/operations.hpp>
-#include <graphene/db/object.hpp>
+#include <graphene/db/generic_index.hpp>
 #include <boost/multi_index/composite_key.hpp>
+#include <unordered_map>
 
 namespace graphene { namespace chain {
 
@@ -50,6 +51,7 @@ namespace graphene { namespace chain {
          static const uint8_t type_id  = operation_history_object_type;
 
          operation_history_object( const operation& o ):op(o){}
+         operation_history_object( operation&& o ):op(std::move(o)){}
          operation_history_object(){}
 
          operation         op;
@@ -114,42 +116,84 @@ typedef multi_index_container<
 
 typedef generic_index<operation_history_object, operation_history_multi_index_type> operation_history_index;
 
-struct by_seq;
-struct by_type_seq;
-struct by_op;
-struct by_opid;
-
+/**
+ * The account histories are looked up by sequence with @ref account_history_sequence_index and the references to
+ * an operation are counted by @ref operation_reference_count_index instead of ordered indices here, which would
+ * cost a tree node per entry and per index.
+ */
 typedef multi_index_container<
    account_transaction_history_object,
    indexed_by<
-      ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
-      ordered_unique< tag<by_seq>,
-         composite_key< account_transaction_history_object,
-            member< account_transaction_history_object, account_uid_type, &account_transaction_history_object::account>,
-            member< account_transaction_history_object, uint32_t, &account_transaction_history_object::sequence>
-         >
-      >,
-      ordered_unique< tag<by_type_seq>,
-         composite_key< account_transaction_history_object,
-            member< account_transaction_history_object, account_uid_type, &account_transaction_history_object::account>,
-            member< account_transaction_history_object, uint16_t, &account_transaction_history_object::operation_type>,
-            member< account_transaction_history_object, uint32_t, &account_transaction_history_object::sequence>
-         >
-      >,
-      ordered_unique< tag<by_op>,
-         composite_key< account_transaction_history_object,
-            member< account_transaction_history_object, account_uid_type, &account_transaction_history_object::account>,
-            member< account_transaction_history_object, operation_history_id_type, &account_transaction_history_object::operation_id>
-         >
-      >,
-      ordered_non_unique< tag<by_opid>,
-         member< account_transaction_history_object, operation_history_id_type, &account_transaction_history_object::operation_id>
-      >
+      ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >
    >
 > account_transaction_history_multi_index_type;
 
 typedef generic_index<account_transaction_history_object, account_transaction_history_multi_index_type> account_transaction_history_index;
 
+   /**
+    *  @brief The account history entries of every account as a compact array sorted by sequence.
+    *
+    *  Entries are appended at the end, trimmed from the front (max-ops-per-account) and removed from the end
+    *  or put back at the front by undo, so each array stays sorted and is searched by binary search.
+    *  Trimmed entries are reclaimed once they make up half of the array.
+    */
+   class account_history_sequence_index : public secondary_index
+   {
+      public:
+         struct entry
+         {
+            account_transaction_history_id_type  id;
+            operation_history_id_type            operation_id;
+            uint32_t                             sequence = 0;
+            uint16_t                             operation_type = 0;
+         };
+
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+
+         /**
+          * @return the entries of @p account with a sequence from @p stop to @p start, of one of @p op_types
+          *         unless it's empty, latest first, at most @p limit
+          */
+         vector<entry> get_history( account_uid_type account, const flat_set<uint16_t>& op_types,
+                                    uint32_t stop, uint32_t start, uint32_t limit )const;
+         /// @return the sequence of the latest entry of @p account with an operation id up to @p op, 0 if there's none
+         uint32_t last_sequence_until( account_uid_type account, operation_history_id_type op )const;
+         /// @return the earliest entry of @p account, nullptr if there's none
+         const entry* earliest( account_uid_type account )const;
+         /// @return number of entries of @p account
+         size_t size( account_uid_type account )const;
+
+      private:
+         struct account_entries
+         {
+            vector<entry>                      entries;
+            /// number of trimmed entries at the front of entries
+            size_t                             first = 0;
+            /// sequences of the entries by operation type
+            flat_map< uint16_t, vector<uint32_t> > type_sequences;
+         };
+
+         std::unordered_map< account_uid_type, account_entries > _accounts;
+   };
+
+   /**
+    *  @brief Number of account history entries referring to each operation, so that partial-operations can
+    *  remove an operation along with its last reference.
+    */
+   class operation_reference_count_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+
+         /// @return number of account history entries referring to @p op
+         uint32_t references( operation_history_id_type op )const;
+
+      private:
+         std::unordered_map< uint64_t, uint32_t > _references;
+   };
+
    
 } } // graphene::chain
 
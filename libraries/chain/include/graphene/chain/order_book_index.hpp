@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/market_object.hpp>
+
+#include <map>
+#include <set>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief The amounts for sale in the limit orders of every market, summed by price
+    *
+    *  As a secondary index of the limit orders it follows every order created, filled, cancelled or expired, and
+    *  every change undone or popped. While @ref set_track_changes() is on, the levels changed are remembered until
+    *  @ref take_changed_levels() is called, so the depth of the markets can be followed without reading the orders.
+    */
+   class limit_order_book_index : public secondary_index
+   {
+      public:
+         /// the levels of the orders selling one asset for another, by sell price, the best is the last
+         typedef std::map< price, share_type > side_type;
+         /// a level with the amount now for sale at its price, 0 when there are no orders left there
+         typedef std::pair< price, share_type > level_type;
+
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         /// @return the levels of the orders selling @p sell_asset for @p receive_asset, null when there are none
+         const side_type* find_side( asset_aid_type sell_asset, asset_aid_type receive_asset )const;
+
+         /// the tracking is left to the readers of the book and isn't part of it, hence const
+         void set_track_changes( bool track )const;
+         /// @return the levels changed since the last call, in no particular order
+         vector<level_type> take_changed_levels()const;
+
+      private:
+         void add( const limit_order_object& o, int64_t sign );
+
+         std::map< std::pair<asset_aid_type,asset_aid_type>, side_type > _sides;
+         mutable bool                                                     _track_changes = false;
+         mutable std::set< price >                                        _changed_levels;
+   };
+
+} } // graphene::chain
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <fc/reflect/reflect.hpp>
+
+#include <cstdint>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief Size and age of the pending transactions, the time to apply them again after each block and the
+    *  reasons the transactions pushed to this node were rejected, not part of the state.
+    *
+    *  The counters are kept since the node started, the rest is computed when the stats are requested.
+    */
+   struct pending_transaction_stats
+   {
+      uint32_t count = 0;
+      /// packed size of the pending transactions
+      uint64_t bytes = 0;
+      /// time since the pending transactions were first pushed to this node
+      int64_t  oldest_age_us = 0;
+      int64_t  median_age_us = 0;
+      int64_t  p90_age_us    = 0;
+
+      /// times the pending transactions were applied again after a block was pushed
+      uint64_t reapply_count     = 0;
+      int64_t  last_reapply_us   = 0;
+      int64_t  max_reapply_us    = 0;
+      int64_t  total_reapply_us  = 0;
+      /// pending transactions before and after they were last applied again, the others got in the block or failed
+      uint32_t last_reapply_before = 0;
+      uint32_t last_reapply_after  = 0;
+
+      uint64_t accepted = 0;
+      /// set_max_pending_transactions() was reached and the fee rate was too low
+      uint64_t rejected_full      = 0;
+      uint64_t rejected_duplicate = 0;
+      /// expired, or expiring too far in the future
+      uint64_t rejected_expired   = 0;
+      /// missing authorities or superfluous signatures
+      uint64_t rejected_authority = 0;
+      /// failed to validate or apply otherwise, e.g. an operation failed to evaluate
+      uint64_t rejected_other     = 0;
+   };
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::pending_transaction_stats,
+            (count)(bytes)(oldest_age_us)(median_age_us)(p90_age_us)
+            (reapply_count)(last_reapply_us)(max_reapply_us)(total_reapply_us)
+            (last_reapply_before)(last_reapply_after)
+            (accepted)(rejected_full)(rejected_duplicate)(rejected_expired)(rejected_authority)(rejected_other) )
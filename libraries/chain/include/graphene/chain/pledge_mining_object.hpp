@@ -25,6 +25,8 @@ namespace graphene { namespace chain {
          account_uid_type     witness;
          uint32_t             last_bonus_block_num = 0;
          pledge_balance_id_type pledge_id;
+         /// head block number of the last change of the pledge or of last_bonus_block_num
+         uint32_t             last_update_block_num = 0;
 
    };
 
@@ -67,4 +69,8 @@ FC_REFLECT_DERIVED( graphene::chain::pledge_mining_object, (graphene::db::object
                     (witness)
                     (last_bonus_block_num)
                     (pledge_id)
+                    (last_update_block_num)
                   )
+
+GRAPHENE_DB_PRIMARY_INDEX( graphene::chain::pledge_mining_object,
+                           graphene::db::primary_index<graphene::chain::pledge_mining_index> )
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#pragma once
+
+#include <graphene/chain/content_object.hpp>
+
+#include <set>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief The posts of every platform ordered by create time, newest first, for the feeds of the platforms
+    *
+    *  It isn't part of the consensus state and only kept when the non_consensus plugin is configured with the
+    *  "post_feed" index, see database_api::list_objects_page(). As a secondary index of the posts it follows the
+    *  posts created as well as every change undone or popped.
+    */
+   class post_feed_index : public secondary_index
+   {
+      public:
+         struct entry
+         {
+            account_uid_type   platform;
+            time_point_sec     create_time;
+            object_id_type     id;
+            const post_object* post;
+
+            /// by platform, then newest first
+            friend bool operator < ( const entry& a, const entry& b )
+            {
+               return std::tie( a.platform, b.create_time, b.id ) < std::tie( b.platform, a.create_time, a.id );
+            }
+         };
+         typedef std::set< entry >::const_iterator const_iterator;
+
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+
+         /// @return the first post of @p platform created at or before @p create_time, and not after @p id then
+         const_iterator lower_bound( account_uid_type platform,
+                                     time_point_sec create_time = time_point_sec::maximum(),
+                                     object_id_type id = object_id_type( post_object::space_id,
+                                                                         post_object::type_id,
+                                                                         GRAPHENE_DB_MAX_INSTANCE_ID ) )const;
+         const_iterator end()const { return _entries.end(); }
+
+      private:
+         // the platform and the create time of a post never change, so modifying a post doesn't move it
+         std::set< entry > _entries;
+   };
+
+} } // graphene::chain
@@ -53,6 +53,11 @@ class proposal_object : public abstract_object<proposal_object>
       flat_set<account_uid_type>     available_owner_approvals;
       flat_set<public_key_type>      available_key_approvals;
 
+      /**
+       * Verify the authorities of the proposed transaction against the available approvals, from scratch: the
+       * authorities of the accounts may have changed since the last approval. The authorities are looked up
+       * through the account authority cache while a block is applied.
+       */
       std::pair<bool, signed_information> is_authorized_to_execute(database& db)const;
 };
 
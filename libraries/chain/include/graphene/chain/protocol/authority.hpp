@@ -68,6 +68,10 @@ namespace graphene { namespace chain {
          { return std::tie( a.uid, a.auth_type ) <  std::tie( b.uid, b.auth_type ); }
       };
 
+      // nearly all authorities hold a single key or account, those are kept without allocating
+      typedef small_flat_map<account_uid_auth_type,weight_type,1> account_uid_auth_map;
+      typedef small_flat_map<public_key_type,weight_type,1>       key_auth_map;
+
       void add_authority( const public_key_type& k, weight_type w )
       {
          key_auths[k] = w;
@@ -125,8 +129,8 @@ namespace graphene { namespace chain {
       }
 
       uint32_t                              weight_threshold = 0;
-      flat_map<account_uid_auth_type,weight_type> account_uid_auths;
-      flat_map<public_key_type,weight_type> key_auths;
+      account_uid_auth_map                  account_uid_auths;
+      key_auth_map                          key_auths;
    };
 
 /**
@@ -25,11 +25,28 @@
 #include <graphene/chain/protocol/block_header.hpp>
 #include <graphene/chain/protocol/transaction.hpp>
 
+#include <functional>
+
 namespace graphene { namespace chain {
 
    struct signed_block : public signed_block_header
    {
+      /**
+       * Calls its second argument for every index below its first argument, in any order and possibly on several
+       * threads at once, and returns when all calls are done.
+       */
+      typedef std::function<void(size_t, const std::function<void(size_t)>&)> for_each_index_type;
+
       checksum_type calculate_merkle_root()const;
+      /**
+       * Same as calculate_merkle_root(), the transaction digests and the hashes of the tree levels of at least
+       * @p min_parallel elements are computed through @p for_each.
+       */
+      checksum_type calculate_merkle_root( const for_each_index_type& for_each, size_t min_parallel )const;
+      /// @return the merkle root of transactions with the given merkle digests, in order
+      static checksum_type calculate_merkle_root( vector<digest_type> digests );
+      static checksum_type calculate_merkle_root( vector<digest_type> digests, const for_each_index_type& for_each,
+                                                  size_t min_parallel );
       vector<processed_transaction> transactions;
    };
 
@@ -46,8 +46,24 @@ namespace graphene { namespace chain {
       fc::ecc::public_key        signee()const;
       void                       sign( const fc::ecc::private_key& signer );
       bool                       validate_signee( const fc::ecc::public_key& expected_signee )const;
+      /// computes id() once and keeps it in @ref precomputed_id
+      const block_id_type&       precompute_id()const;
+      /// recovers signee() once and keeps it in @ref precomputed_signee, does nothing if the signature is invalid
+      void                       precompute_signee()const;
 
       signature_type             witness_signature;
+
+      /**
+       * The id computed ahead of time by precompute_id(), returned by id() instead of hashing the header again.
+       * This is not serialized, and is reset by sign(). Code changing the header after precompute_id() must reset it.
+       */
+      mutable optional<block_id_type> precomputed_id;
+
+      /**
+       * The key recovered ahead of time by precompute_signee(), returned by signee() instead of recovering it again,
+       * see database::precompute_block_signees(). Not serialized either, and reset by sign().
+       */
+      mutable optional<public_key_type> precomputed_signee;
    };
 
 } } // graphene::chain
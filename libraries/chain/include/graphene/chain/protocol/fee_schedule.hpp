@@ -54,6 +54,12 @@ namespace graphene { namespace chain {
 
       void zero_all_fees();
 
+      /**
+       *  @return the fee parameters of the operation type @p which, or the default ones of the type when the
+       *          schedule has none. Found by position in a complete schedule, see @ref parameters.
+       */
+      const fee_parameters& get_parameters( int which )const;
+
       /**
        *  Validates all of the parameters are present and accounted for.
        */
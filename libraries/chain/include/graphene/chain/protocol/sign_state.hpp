@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <graphene/chain/protocol/transaction.hpp>
+#include <graphene/chain/exceptions.hpp>
+
+namespace graphene { namespace chain {
+
+extern const flat_set<public_key_type> empty_public_key_set;
+
+/**
+ *  Resolves the owner, active and secondary authorities of accounts through three callables,
+ *  for callers that hold the callbacks separately, e.g. the std::function based verify_authority().
+ *
+ *  An authority resolver is any type with const owner(uid), active(uid) and secondary(uid) members returning
+ *  a const authority*, sign_state and verify_authority_with() are templated on it so the lookups can be inlined.
+ */
+template<typename OwnerGetter, typename ActiveGetter, typename SecondaryGetter>
+struct authority_getters_resolver
+{
+   const authority* owner( account_uid_type uid )const     { return get_owner( uid );     }
+   const authority* active( account_uid_type uid )const    { return get_active( uid );    }
+   const authority* secondary( account_uid_type uid )const { return get_secondary( uid ); }
+
+   const OwnerGetter&     get_owner;
+   const ActiveGetter&    get_active;
+   const SecondaryGetter& get_secondary;
+};
+
+template<typename OwnerGetter, typename ActiveGetter, typename SecondaryGetter>
+authority_getters_resolver<OwnerGetter, ActiveGetter, SecondaryGetter> make_authority_resolver(
+      const OwnerGetter& get_owner, const ActiveGetter& get_active, const SecondaryGetter& get_secondary )
+{
+   return authority_getters_resolver<OwnerGetter, ActiveGetter, SecondaryGetter>{ get_owner, get_active, get_secondary };
+}
+
+template<typename AuthorityResolver>
+struct sign_state
+{
+      /** returns true if we have a signature for this key or can
+       * produce a signature for this key, else returns false.
+       */
+      bool signed_by( const public_key_type& k )
+      {
+         auto itr = provided_signatures.find(k);
+         if( itr == provided_signatures.end() )
+         {
+            auto pk = available_keys.find(k);
+            if( pk != available_keys.end() )
+            {
+               used_keys.insert(k);
+               return provided_signatures[k] = true;
+            }
+            return false;
+         }
+         return itr->second = true;
+      }
+
+      std::tuple<bool,bool,flat_set<public_key_type>> check_authority( const authority::account_uid_auth_type& uid_auth )
+      {
+         if( approved_by_uid_auth.find( uid_auth ) != approved_by_uid_auth.end() )
+            return std::make_tuple( true, true, empty_public_key_set );
+
+         signed_information::sign_tree parent(uid_auth.uid);
+         std::tuple<bool, bool, flat_set<public_key_type>> result;
+         if (uid_auth.auth_type == authority::secondary_auth)
+         {
+            result = check_authority(resolver.secondary(uid_auth.uid), parent);
+            if (std::get<0>(result))
+               sigs.secondary.emplace(uid_auth.uid, parent);
+            return result;
+         }
+         else if (uid_auth.auth_type == authority::active_auth)
+         {
+            result = check_authority(resolver.active(uid_auth.uid), parent);
+            if (std::get<0>(result))
+               sigs.active.emplace(uid_auth.uid, parent);
+            return result;
+         }
+         else // if( uid_auth.auth_type == authority::owner_auth )
+         {
+            result = check_authority(resolver.owner(uid_auth.uid), parent);
+            if (std::get<0>(result))
+               sigs.owner.emplace(uid_auth.uid, parent);
+            return result;
+         }
+      }
+
+      /**
+       *  Checks to see if we have signatures of the active authorites of
+       *  the accounts specified in authority or the keys specified.
+       *  If the result is false,
+       *     returns if it's possible to satisfy the authority as the second item in the tuple,
+       *     and the missed keys as the third item in the tuple
+       */
+      std::tuple<bool,bool,flat_set<public_key_type>> check_authority( const authority* au, signed_information::sign_tree& parent, uint32_t depth = 0 )
+      {
+         if( au == nullptr )
+         {
+            flat_set<public_key_type> s;
+            s.insert( public_key_type() );
+            return std::make_tuple( false, false, s );
+         }
+
+         const authority& auth = *au;
+
+         uint32_t total_weight = 0;
+         uint32_t total_possible_weight = 0;
+         flat_set<public_key_type> missed_keys;
+         for( const auto& k : auth.key_auths )
+         {
+            const public_key_type& kf = k.first;
+            if( kf != public_key_type() )
+               total_possible_weight += k.second;
+            if( signed_by( kf ) )
+            {
+               total_weight += k.second;
+               parent.pub_keys.emplace(kf);
+               if (total_weight >= auth.weight_threshold)
+                  return std::make_tuple(true, true, empty_public_key_set);    
+            }
+            else
+            {
+               if( kf != public_key_type() )
+                  missed_keys.insert( kf );
+            }
+         }
+
+         for( const auto& a : auth.account_uid_auths )
+         {
+            if( approved_by_uid_auth.find( a.first ) == approved_by_uid_auth.end() )
+            {
+               if( depth == max_recursion )
+                  continue;
+
+               signed_information::sign_tree child(a.first.uid);
+               std::tuple<bool, bool, flat_set<public_key_type>> result;
+               if (a.first.auth_type == authority::secondary_auth)
+                  result = check_authority(resolver.secondary(a.first.uid), child, depth + 1);
+               else if (a.first.auth_type == authority::active_auth)
+                  result = check_authority(resolver.active(a.first.uid), child, depth + 1);
+               else // if( a.first.auth_type == authority::owner_auth )
+                  result = check_authority(resolver.owner(a.first.uid), child, depth + 1);
+               if( std::get<0>( result ) )
+               {
+                  total_possible_weight += a.second;
+                  approved_by_uid_auth.insert( a.first );
+                  total_weight += a.second;
+                  parent.children.emplace(child);
+                  if( total_weight >= auth.weight_threshold )
+                     return std::make_tuple( true, true, empty_public_key_set );
+               }
+               else
+               {
+                  if( std::get<1>( result ) )
+                  {
+                     total_possible_weight += a.second;
+                     for( const auto& k : std::get<2>( result ) )
+                        missed_keys.insert( k );
+                  }
+               }
+            }
+            else
+            {
+               total_possible_weight += a.second;
+               total_weight += a.second;
+               signed_information::sign_tree child(a.first.uid);
+               parent.children.emplace(child);
+               if( total_weight >= auth.weight_threshold )
+                  return std::make_tuple( true, true, empty_public_key_set );
+            }
+         }
+
+         if (total_possible_weight >= auth.weight_threshold)
+            return std::make_tuple(total_weight >= auth.weight_threshold, true, missed_keys);
+         else
+         {
+            flat_set<public_key_type> s;
+            s.insert( public_key_type() );
+            return std::make_tuple( false, false, s );
+         }
+      }
+
+      const flat_set<public_key_type>& get_used_keys()
+      {
+         return used_keys;
+      }
+
+      vector<public_key_type> get_unused_signature_keys()
+      {
+         vector<public_key_type> remove_sigs;
+         for( const auto& sig : provided_signatures )
+            if( !sig.second ) remove_sigs.push_back( sig.first );
+
+         return remove_sigs;
+      }
+
+      bool remove_unused_signatures()
+      {
+         vector<public_key_type> remove_sigs;
+         for( const auto& sig : provided_signatures )
+            if( !sig.second ) remove_sigs.push_back( sig.first );
+
+         for( auto& sig : remove_sigs )
+            provided_signatures.erase(sig);
+
+         return remove_sigs.size() != 0;
+      }
+
+      sign_state( const flat_map<public_key_type,signature_type>& sigs,
+                  const AuthorityResolver& r,
+                  const flat_set<public_key_type>& keys = empty_public_key_set )
+      : resolver(r), available_keys(keys)
+      {
+         for( const auto& key_sig : sigs )
+            provided_signatures[ key_sig.first ] = false;
+
+         approved_by_uid_auth.emplace( GRAPHENE_TEMP_ACCOUNT_UID, authority::owner_auth );
+         approved_by_uid_auth.emplace( GRAPHENE_TEMP_ACCOUNT_UID, authority::active_auth );
+         approved_by_uid_auth.emplace( GRAPHENE_TEMP_ACCOUNT_UID, authority::secondary_auth );
+      }
+
+      const AuthorityResolver&                                resolver;
+
+      const flat_set<public_key_type>&                        available_keys;
+      flat_set<public_key_type>                               used_keys;
+
+      flat_map<public_key_type,bool>             provided_signatures; // the bool means "is_used"
+      flat_set<authority::account_uid_auth_type> approved_by_uid_auth;
+      uint32_t                                   max_recursion = GRAPHENE_MAX_SIG_CHECK_DEPTH;
+      signed_information                         sigs;
+};
+
+/**
+ *  Same as verify_authority(), with the authorities of accounts looked up through @p resolver,
+ *  see authority_getters_resolver.
+ */
+template<typename AuthorityResolver>
+signed_information verify_authority_with( const AuthorityResolver& resolver,
+                          const vector<operation>& ops, const flat_map<public_key_type,signature_type>& sigs,
+                          bool enabled_hardfork,
+                          uint32_t max_recursion_depth = GRAPHENE_MAX_SIG_CHECK_DEPTH,
+                          bool allow_committe = false,
+                          const flat_set<account_uid_type>& owner_uid_approvals = flat_set<account_uid_type>(),
+                          const flat_set<account_uid_type>& active_uid_approvals = flat_set<account_uid_type>(),
+                          const flat_set<account_uid_type>& secondary_uid_approvals = flat_set<account_uid_type>())
+{ try {
+   flat_set<account_uid_type> required_owner_uids;
+   flat_set<account_uid_type> required_active_uids;
+   flat_set<account_uid_type> required_secondary_uids;
+   vector<authority> other;
+
+   for( const auto& op : ops )
+      operation_get_required_uid_authorities( op, required_owner_uids, required_active_uids, required_secondary_uids, other,enabled_hardfork);
+
+   if( !allow_committe )
+      GRAPHENE_ASSERT( required_active_uids.find(GRAPHENE_COMMITTEE_ACCOUNT_UID) == required_active_uids.end(),
+                       invalid_committee_approval, "Committee account may only propose transactions" );
+
+   // don't remove duplicates: if a transaction requires all the authorities, satisfy it
+   /*
+   for( const auto& uid : required_owner_uids )
+   {
+      required_active_uids.erase( uid );
+      required_secondary_uids.erase( uid );
+   }
+   for( const auto& uid : required_active_uids )
+   {
+      required_secondary_uids.erase( uid );
+   }
+   */
+
+   sign_state<AuthorityResolver> s( sigs, resolver );
+   s.max_recursion = max_recursion_depth;
+   for( auto& uid : owner_uid_approvals )
+      s.approved_by_uid_auth.emplace( uid, authority::owner_auth );
+   for( auto& uid : active_uid_approvals )
+      s.approved_by_uid_auth.emplace( uid, authority::active_auth );
+   for( auto& uid : secondary_uid_approvals )
+      s.approved_by_uid_auth.emplace( uid, authority::secondary_auth );
+
+   // TODO: review order to minimize number of signatures
+   //       when changing the order, make sure to change get_required_signatures(...) as well, and set a hard fork
+
+   // fetch all of the top level authorities
+   for( auto uid : required_owner_uids )
+   {
+      GRAPHENE_ASSERT( std::get<0>( s.check_authority( authority::account_uid_auth_type( uid, authority::owner_auth ) ) ),
+                       tx_missing_owner_auth,
+                       "Missing Owner Authority, account uid: ${uid}",
+                       ( "uid", uid ) ( "owner", *resolver.owner( uid ) )
+                     );
+   }
+
+   // Can't use owner key to sign a transaction that requires active key
+   for( auto uid : required_active_uids )
+   {
+      GRAPHENE_ASSERT( std::get<0>( s.check_authority( authority::account_uid_auth_type( uid, authority::active_auth ) ) ),
+                       tx_missing_active_auth,
+                       "Missing Active Authority, account uid: ${uid}",
+                       ( "uid", uid ) ( "active", *resolver.active( uid ) )
+                     );
+   }
+
+   // Can't use owner or active key to sign a transaction that requires secondary key
+   for( auto uid : required_secondary_uids )
+   {
+      GRAPHENE_ASSERT( std::get<0>( s.check_authority( authority::account_uid_auth_type( uid, authority::secondary_auth ) ) ),
+                       tx_missing_secondary_auth,
+                       "Missing Secondary Authority, account uid: ${uid}",
+                       ( "uid", uid ) ( "secondary", *resolver.secondary( uid ) )
+                     );
+   }
+
+   for( const auto& auth : other )
+   {
+      auto s_tree=signed_information::sign_tree();
+      GRAPHENE_ASSERT(std::get<0>(s.check_authority(&auth, s_tree)), tx_missing_other_auth, "Missing Authority: ${auth}", ("auth", auth)("sigs", sigs));
+   }
+
+   GRAPHENE_ASSERT(
+      !s.remove_unused_signatures(),
+      tx_irrelevant_sig,
+      "Unnecessary signature(s) detected"
+      );
+
+   return s.sigs;
+
+} FC_CAPTURE_AND_RETHROW( (ops)(sigs) ) }
+
+} } // graphene::chain
@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <fc/container/flat.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/io/raw_fwd.hpp>
+#include <fc/io/varint.hpp>
+#include <fc/variant.hpp>
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graphene { namespace chain {
+
+/**
+ *  @brief A vector keeping up to N elements inside the object itself, it only allocates when it grows beyond them.
+ *
+ *  Used for the containers of the protocol types which nearly always hold one or two elements, e.g. the signatures
+ *  of a transaction. It's serialized the same way as std::vector.
+ */
+template< typename T, size_t N >
+class small_vector
+{
+   static_assert( N > 0, "use std::vector without inline elements" );
+
+   public:
+      typedef T         value_type;
+      typedef T*        iterator;
+      typedef const T*  const_iterator;
+      typedef T&        reference;
+      typedef const T&  const_reference;
+      typedef size_t    size_type;
+
+      small_vector() {}
+      small_vector( std::initializer_list<T> init ) { assign( init.begin(), init.end() ); }
+      template< typename InputIt >
+      small_vector( InputIt first, InputIt last ) { assign( first, last ); }
+      small_vector( const std::vector<T>& v ) { assign( v.begin(), v.end() ); }
+      small_vector( const small_vector& o ) { assign( o.begin(), o.end() ); }
+      small_vector( small_vector&& o ) { take( o ); }
+      ~small_vector() { clear(); release(); }
+
+      small_vector& operator=( const small_vector& o )
+      {
+         if( this != &o )
+            assign( o.begin(), o.end() );
+         return *this;
+      }
+      small_vector& operator=( small_vector&& o )
+      {
+         if( this != &o )
+         {
+            clear();
+            release();
+            take( o );
+         }
+         return *this;
+      }
+
+      operator std::vector<T>()const { return std::vector<T>( begin(), end() ); }
+
+      iterator       begin()       { return data(); }
+      const_iterator begin()const  { return data(); }
+      const_iterator cbegin()const { return data(); }
+      iterator       end()         { return data() + _size; }
+      const_iterator end()const    { return data() + _size; }
+      const_iterator cend()const   { return data() + _size; }
+
+      T*       data()       { return _heap != nullptr ? _heap : inline_data(); }
+      const T* data()const  { return _heap != nullptr ? _heap : inline_data(); }
+
+      size_t size()const     { return _size; }
+      bool   empty()const    { return _size == 0; }
+      size_t capacity()const { return _capacity; }
+      /// whether the elements are kept inside the object
+      bool   is_inline()const { return _heap == nullptr; }
+
+      T&       operator[]( size_t i )       { return data()[i]; }
+      const T& operator[]( size_t i )const  { return data()[i]; }
+      T&       at( size_t i )       { FC_ASSERT( i < _size ); return data()[i]; }
+      const T& at( size_t i )const  { FC_ASSERT( i < _size ); return data()[i]; }
+      T&       front()       { return data()[0]; }
+      const T& front()const  { return data()[0]; }
+      T&       back()        { return data()[_size - 1]; }
+      const T& back()const   { return data()[_size - 1]; }
+
+      void reserve( size_t n )
+      {
+         if( n > _capacity )
+            reallocate( n );
+      }
+
+      template< typename... Args >
+      T& emplace_back( Args&&... args )
+      {
+         if( _size == _capacity )
+         {
+            // the arguments may refer to an element, construct the new one before moving them
+            T value( std::forward<Args>( args )... );
+            reallocate( _capacity * 2 );
+            new( data() + _size ) T( std::move( value ) );
+         }
+         else
+            new( data() + _size ) T( std::forward<Args>( args )... );
+         return data()[_size++];
+      }
+      void push_back( const T& value ) { emplace_back( value ); }
+      void push_back( T&& value )      { emplace_back( std::move( value ) ); }
+
+      iterator insert( const_iterator pos, T value )
+      {
+         const size_t index = pos - begin();
+         if( index == _size )
+         {
+            emplace_back( std::move( value ) );
+            return begin() + index;
+         }
+         reserve( _size + 1 );
+         T* d = data();
+         new( d + _size ) T( std::move( d[_size - 1] ) );
+         std::move_backward( d + index, d + _size - 1, d + _size );
+         d[index] = std::move( value );
+         ++_size;
+         return d + index;
+      }
+
+      iterator erase( const_iterator pos ) { return erase( pos, pos + 1 ); }
+      iterator erase( const_iterator first, const_iterator last )
+      {
+         T* d = data();
+         T* f = d + ( first - d );
+         T* l = d + ( last - d );
+         if( f != l )
+         {
+            T* new_end = std::move( l, d + _size, f );
+            destroy( new_end, d + _size );
+            _size = new_end - d;
+         }
+         return f;
+      }
+
+      void pop_back() { destroy( end() - 1, end() ); --_size; }
+
+      void resize( size_t n )
+      {
+         if( n < _size )
+         {
+            destroy( begin() + n, end() );
+            _size = n;
+            return;
+         }
+         reserve( n );
+         for( T* d = data(); _size < n; ++_size )
+            new( d + _size ) T();
+      }
+
+      template< typename InputIt >
+      void assign( InputIt first, InputIt last )
+      {
+         clear();
+         reserve( std::distance( first, last ) );
+         for( ; first != last; ++first )
+            emplace_back( *first );
+      }
+
+      void clear()
+      {
+         destroy( begin(), end() );
+         _size = 0;
+      }
+
+      friend bool operator == ( const small_vector& a, const small_vector& b )
+      { return a.size() == b.size() && std::equal( a.begin(), a.end(), b.begin() ); }
+      friend bool operator != ( const small_vector& a, const small_vector& b )
+      { return !( a == b ); }
+      friend bool operator < ( const small_vector& a, const small_vector& b )
+      { return std::lexicographical_compare( a.begin(), a.end(), b.begin(), b.end() ); }
+
+   private:
+      T*       inline_data()       { return reinterpret_cast<T*>( &_inline ); }
+      const T* inline_data()const  { return reinterpret_cast<const T*>( &_inline ); }
+
+      static void destroy( T* first, T* last )
+      {
+         for( ; first != last; ++first )
+            first->~T();
+      }
+
+      /// moves the elements to a heap buffer of the given capacity
+      void reallocate( size_t new_capacity )
+      {
+         T* buffer = static_cast<T*>( ::operator new( new_capacity * sizeof(T) ) );
+         T* d = data();
+         for( size_t i = 0; i < _size; ++i )
+         {
+            new( buffer + i ) T( std::move( d[i] ) );
+            d[i].~T();
+         }
+         release();
+         _heap = buffer;
+         _capacity = new_capacity;
+      }
+
+      /// frees the heap buffer, the elements must have been destroyed or moved
+      void release()
+      {
+         if( _heap != nullptr )
+            ::operator delete( _heap );
+         _heap = nullptr;
+         _capacity = N;
+      }
+
+      /// takes the elements of o, which must be empty and inline
+      void take( small_vector& o )
+      {
+         if( o._heap != nullptr )
+         {
+            _heap = o._heap;
+            _size = o._size;
+            _capacity = o._capacity;
+            o._heap = nullptr;
+            o._size = 0;
+            o._capacity = N;
+            return;
+         }
+         for( size_t i = 0; i < o._size; ++i )
+            new( inline_data() + i ) T( std::move( o.inline_data()[i] ) );
+         _size = o._size;
+         o.clear();
+      }
+
+      typename std::aligned_storage< sizeof(T) * N, alignof(T) >::type _inline;
+      T*                                                                _heap = nullptr;
+      uint32_t                                                          _size = 0;
+      uint32_t                                                          _capacity = N;
+};
+
+/**
+ *  @brief A sorted map kept in a small_vector, for the maps of the protocol types which nearly always hold one or
+ *  two entries, e.g. the keys and accounts of an authority.
+ *
+ *  It has the interface of flat_map the protocol code uses, and is serialized the same way as flat_map.
+ */
+template< typename K, typename V, size_t N >
+class small_flat_map
+{
+   public:
+      typedef K                                          key_type;
+      typedef V                                          mapped_type;
+      typedef std::pair<K,V>                             value_type;
+      typedef small_vector<value_type,N>                 container_type;
+      typedef typename container_type::iterator          iterator;
+      typedef typename container_type::const_iterator    const_iterator;
+      typedef size_t                                     size_type;
+
+      small_flat_map() {}
+      small_flat_map( std::initializer_list<value_type> init ) { insert( init.begin(), init.end() ); }
+      template< typename InputIt >
+      small_flat_map( InputIt first, InputIt last ) { insert( first, last ); }
+      small_flat_map( const fc::flat_map<K,V>& m ) : _items( m.begin(), m.end() ) {}
+
+      operator fc::flat_map<K,V>()const { return fc::flat_map<K,V>( begin(), end() ); }
+
+      iterator       begin()       { return _items.begin(); }
+      const_iterator begin()const  { return _items.begin(); }
+      const_iterator cbegin()const { return _items.begin(); }
+      iterator       end()         { return _items.end(); }
+      const_iterator end()const    { return _items.end(); }
+      const_iterator cend()const   { return _items.end(); }
+
+      size_t size()const  { return _items.size(); }
+      bool   empty()const { return _items.empty(); }
+      void   clear()      { _items.clear(); }
+      void   reserve( size_t n ) { _items.reserve( n ); }
+
+      iterator lower_bound( const K& k )
+      {
+         return std::lower_bound( begin(), end(), k, []( const value_type& a, const K& b ) { return a.first < b; } );
+      }
+      const_iterator lower_bound( const K& k )const
+      {
+         return std::lower_bound( begin(), end(), k, []( const value_type& a, const K& b ) { return a.first < b; } );
+      }
+
+      iterator find( const K& k )
+      {
+         iterator itr = lower_bound( k );
+         return ( itr != end() && !( k < itr->first ) ) ? itr : end();
+      }
+      const_iterator find( const K& k )const
+      {
+         const_iterator itr = lower_bound( k );
+         return ( itr != end() && !( k < itr->first ) ) ? itr : end();
+      }
+      size_t count( const K& k )const { return find( k ) != end() ? 1 : 0; }
+
+      V& at( const K& k )
+      {
+         iterator itr = find( k );
+         FC_ASSERT( itr != end(), "key not found" );
+         return itr->second;
+      }
+      const V& at( const K& k )const
+      {
+         const_iterator itr = find( k );
+         FC_ASSERT( itr != end(), "key not found" );
+         return itr->second;
+      }
+
+      V& operator[]( const K& k )
+      {
+         iterator itr = lower_bound( k );
+         if( itr == end() || k < itr->first )
+            itr = _items.insert( itr, value_type( k, V() ) );
+         return itr->second;
+      }
+
+      std::pair<iterator,bool> insert( const value_type& value )
+      {
+         iterator itr = lower_bound( value.first );
+         if( itr != end() && !( value.first < itr->first ) )
+            return std::make_pair( itr, false );
+         return std::make_pair( _items.insert( itr, value ), true );
+      }
+      template< typename InputIt >
+      void insert( InputIt first, InputIt last )
+      {
+         for( ; first != last; ++first )
+            insert( value_type( *first ) );
+      }
+      template< typename... Args >
+      std::pair<iterator,bool> emplace( Args&&... args )
+      {
+         return insert( value_type( std::forward<Args>( args )... ) );
+      }
+
+      size_t erase( const K& k )
+      {
+         iterator itr = find( k );
+         if( itr == end() )
+            return 0;
+         _items.erase( itr );
+         return 1;
+      }
+      iterator erase( const_iterator pos ) { return _items.erase( pos ); }
+      iterator erase( const_iterator first, const_iterator last ) { return _items.erase( first, last ); }
+
+      friend bool operator == ( const small_flat_map& a, const small_flat_map& b ) { return a._items == b._items; }
+      friend bool operator != ( const small_flat_map& a, const small_flat_map& b ) { return a._items != b._items; }
+      friend bool operator <  ( const small_flat_map& a, const small_flat_map& b ) { return a._items <  b._items; }
+
+   private:
+      container_type _items;
+};
+
+} } // graphene::chain
+
+namespace fc {
+
+template< typename T, size_t N >
+void to_variant( const graphene::chain::small_vector<T,N>& value, fc::variant& var, uint32_t max_depth )
+{
+   to_variant( std::vector<T>( value.begin(), value.end() ), var, max_depth );
+}
+
+template< typename T, size_t N >
+void from_variant( const fc::variant& var, graphene::chain::small_vector<T,N>& value, uint32_t max_depth )
+{
+   std::vector<T> v;
+   from_variant( var, v, max_depth );
+   value.assign( v.begin(), v.end() );
+}
+
+template< typename K, typename V, size_t N >
+void to_variant( const graphene::chain::small_flat_map<K,V,N>& value, fc::variant& var, uint32_t max_depth )
+{
+   to_variant( fc::flat_map<K,V>( value ), var, max_depth );
+}
+
+template< typename K, typename V, size_t N >
+void from_variant( const fc::variant& var, graphene::chain::small_flat_map<K,V,N>& value, uint32_t max_depth )
+{
+   fc::flat_map<K,V> m;
+   from_variant( var, m, max_depth );
+   value = graphene::chain::small_flat_map<K,V,N>( m );
+}
+
+namespace raw {
+
+// declared ahead of fc/io/raw.hpp like the other overloads, so that the reflected types holding them find them
+
+template< typename Stream, typename T, size_t N >
+void pack( Stream& s, const graphene::chain::small_vector<T,N>& value, uint32_t _max_depth=FC_PACK_MAX_DEPTH )
+{
+   FC_ASSERT( _max_depth > 0 );
+   --_max_depth;
+   fc::raw::pack( s, unsigned_int( (uint32_t)value.size() ), _max_depth );
+   for( const auto& item : value )
+      fc::raw::pack( s, item, _max_depth );
+}
+
+template< typename Stream, typename T, size_t N >
+void unpack( Stream& s, graphene::chain::small_vector<T,N>& value, uint32_t _max_depth=FC_PACK_MAX_DEPTH )
+{
+   FC_ASSERT( _max_depth > 0 );
+   --_max_depth;
+   unsigned_int size;
+   fc::raw::unpack( s, size, _max_depth );
+   FC_ASSERT( size.value * sizeof(T) < MAX_ARRAY_ALLOC_SIZE );
+   value.clear();
+   value.resize( size.value );
+   for( auto& item : value )
+      fc::raw::unpack( s, item, _max_depth );
+}
+
+template< typename Stream, typename K, typename V, size_t N >
+void pack( Stream& s, const graphene::chain::small_flat_map<K,V,N>& value, uint32_t _max_depth=FC_PACK_MAX_DEPTH )
+{
+   FC_ASSERT( _max_depth > 0 );
+   --_max_depth;
+   fc::raw::pack( s, unsigned_int( (uint32_t)value.size() ), _max_depth );
+   for( const auto& item : value )
+      fc::raw::pack( s, item, _max_depth );
+}
+
+template< typename Stream, typename K, typename V, size_t N >
+void unpack( Stream& s, graphene::chain::small_flat_map<K,V,N>& value, uint32_t _max_depth=FC_PACK_MAX_DEPTH )
+{
+   FC_ASSERT( _max_depth > 0 );
+   --_max_depth;
+   unsigned_int size;
+   fc::raw::unpack( s, size, _max_depth );
+   FC_ASSERT( size.value * sizeof(std::pair<K,V>) < MAX_ARRAY_ALLOC_SIZE );
+   value.clear();
+   value.reserve( size.value );
+   for( uint32_t i = 0; i < size.value; ++i )
+   {
+      std::pair<K,V> item;
+      fc::raw::unpack( s, item, _max_depth );
+      value.insert( item );
+   }
+}
+
+} // fc::raw
+
+} // fc
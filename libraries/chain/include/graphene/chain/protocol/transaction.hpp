@@ -29,6 +29,8 @@
 
 namespace graphene { namespace chain {
 
+   class signature_key_cache;
+
    /**
     * @defgroup transactions Transactions
     *
@@ -140,44 +142,35 @@ namespace graphene { namespace chain {
 
       account_uid_type real_owner_uid(account_uid_type uid, uint32_t depth)const
       {
-         if (owner.find(uid) == owner.end())
-            return account_uid_type(0);
-
-         sign_tree root = owner.at(uid);
-         while (root.pub_keys.empty() && root.children.size() == 1 && depth)
-         {
-            root = *(root.children.begin());
-            --depth;
-         }
-         return root.uid;
+         return real_uid(owner, uid, depth);
       }
 
       account_uid_type real_active_uid(account_uid_type uid, uint32_t depth)const
       {
-         if (active.find(uid) == active.end())
-            return account_uid_type(0);
-
-         sign_tree root = active.at(uid);
-         while (root.pub_keys.empty() && root.children.size() == 1 && depth)
-         {
-            root = *(root.children.begin());
-            --depth;
-         }
-         return root.uid;
+         return real_uid(active, uid, depth);
       }
 
       account_uid_type real_secondary_uid(account_uid_type uid, uint32_t depth)const
       {
-         if (secondary.find(uid) == secondary.end())
+         return real_uid(secondary, uid, depth);
+      }
+
+   private:
+      /// follows the chain of single child authorities without keys of @p uid, down to @p depth levels
+      static account_uid_type real_uid(const flat_map<account_uid_type, sign_tree>& trees, account_uid_type uid,
+                                       uint32_t depth)
+      {
+         auto itr = trees.find(uid);
+         if (itr == trees.end())
             return account_uid_type(0);
 
-         sign_tree root = secondary.at(uid);
-         while (root.pub_keys.empty() && root.children.size() == 1 && depth)
+         const sign_tree* root = &itr->second;
+         while (root->pub_keys.empty() && root->children.size() == 1 && depth)
          {
-            root = *(root.children.begin());
+            root = &*(root->children.begin());
             --depth;
          }
-         return root.uid;
+         return root->uid;
       }
 
    };
@@ -241,12 +234,43 @@ namespace graphene { namespace chain {
          ) const;
       */
 
-      flat_map<public_key_type,signature_type> get_signature_keys( const chain_id_type& chain_id )const;
+      /**
+       * @param cache when set, keys recovered before are looked up in it instead of being recovered again,
+       *              and the newly recovered keys are added to it
+       */
+      flat_map<public_key_type,signature_type> get_signature_keys( const chain_id_type& chain_id,
+                                                                   signature_key_cache* cache = nullptr )const;
+
+      /// nearly all transactions have a single signature, it's kept without allocating
+      small_vector<signature_type,1> signatures;
+
+      /**
+       * Keys recovered from @ref signatures ahead of time, see database::precompute_signature_keys().
+       * When set, verify_authority() uses these instead of recovering the keys again.
+       * This is not serialized, and is reset whenever the signatures are changed through sign() or clear().
+       */
+      mutable optional< flat_map<public_key_type,signature_type> > signees;
+
+      /**
+       * The id computed ahead of time by precompute_id(), returned by id() instead of packing and hashing the
+       * transaction again. This is not serialized, and is reset by clear(). Code changing the transaction after
+       * precompute_id() must reset it.
+       */
+      mutable optional<transaction_id_type> precomputed_id;
+
+      /**
+       * Set when validate() passed ahead of time, see database::precompute_signature_keys(), so that it isn't run
+       * again when the transaction is applied. This is not serialized, and is reset by clear(). Code changing the
+       * transaction after it was set must reset it.
+       */
+      mutable bool validated = false;
 
-      vector<signature_type> signatures;
+      transaction_id_type id()const { return precomputed_id.valid() ? *precomputed_id : transaction::id(); }
+      /// computes id() once and keeps it in @ref precomputed_id
+      const transaction_id_type& precompute_id()const;
 
       /// Removes all operations and signatures
-      void clear() { operations.clear(); signatures.clear(); }
+      void clear() { operations.clear(); signatures.clear(); signees.reset(); precomputed_id.reset(); validated = false; }
    };
 
 signed_information verify_authority(const vector<operation>& ops, const flat_map<public_key_type, signature_type>& sigs,
@@ -291,6 +315,8 @@ void get_authority_uid( const authority* au,
    {
       processed_transaction( const signed_transaction& trx = signed_transaction() )
          : signed_transaction(trx){}
+      processed_transaction( signed_transaction&& trx )
+         : signed_transaction( std::move(trx) ){}
 
       vector<operation_result> operation_results;
 
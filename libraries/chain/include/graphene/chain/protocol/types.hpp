@@ -36,6 +36,7 @@
 #include <fc/string.hpp>
 
 #include <graphene/chain/protocol/ext.hpp>
+#include <graphene/chain/protocol/small_containers.hpp>
 
 #include <fc/io/raw.hpp>
 #include <fc/uint128.hpp>
@@ -190,6 +191,11 @@ namespace graphene { namespace chain {
       impl_account_auth_platform_object_type,
       impl_pledge_mining_object_type,
       impl_pledge_balance_object_type,
+      impl_content_award_settlement_object_type,
+      impl_platform_period_profit_object_type,
+      impl_platform_vote_profit_object_type,
+      impl_custom_vote_weight_object_type,
+      impl_active_post_receiptor_object_type,
       IMPL_OBJECT_TYPE_COUNT ///< Sentry value which contains the number of different impl object types
    };
 
@@ -243,6 +249,11 @@ namespace graphene { namespace chain {
    class witness_schedule_object;
    class score_object;
    class pledge_balance_object;
+   class content_award_settlement_object;
+   class platform_period_profit_object;
+   class platform_vote_profit_object;
+   class custom_vote_weight_object;
+   class active_post_receiptor_object;
 
    typedef object_id< implementation_ids, impl_global_property_object_type,  global_property_object>                    global_property_id_type;
    typedef object_id< implementation_ids, impl_dynamic_global_property_object_type,  dynamic_global_property_object>    dynamic_global_property_id_type;
@@ -272,6 +283,11 @@ namespace graphene { namespace chain {
    typedef object_id< implementation_ids, impl_account_auth_platform_object_type, account_auth_platform_object>         account_auth_platform_id_type;
    typedef object_id< implementation_ids, impl_pledge_mining_object_type,    pledge_mining_object>                      pledge_mining_id_type;
    typedef object_id< implementation_ids, impl_pledge_balance_object_type,   pledge_balance_object>                     pledge_balance_id_type;
+   typedef object_id< implementation_ids, impl_content_award_settlement_object_type, content_award_settlement_object>  content_award_settlement_id_type;
+   typedef object_id< implementation_ids, impl_platform_period_profit_object_type, platform_period_profit_object>      platform_period_profit_id_type;
+   typedef object_id< implementation_ids, impl_platform_vote_profit_object_type,   platform_vote_profit_object>        platform_vote_profit_id_type;
+   typedef object_id< implementation_ids, impl_custom_vote_weight_object_type,     custom_vote_weight_object>          custom_vote_weight_id_type;
+   typedef object_id< implementation_ids, impl_active_post_receiptor_object_type,  active_post_receiptor_object>       active_post_receiptor_id_type;
 
    typedef fc::array<char, GRAPHENE_MAX_ASSET_SYMBOL_LENGTH>    symbol_type;
    typedef fc::ripemd160                                        block_id_type;
@@ -416,6 +432,11 @@ FC_REFLECT_ENUM( graphene::chain::impl_object_type,
                  (impl_account_auth_platform_object_type)
                  (impl_pledge_mining_object_type)
                  (impl_pledge_balance_object_type)
+                 (impl_content_award_settlement_object_type)
+                 (impl_platform_period_profit_object_type)
+                 (impl_platform_vote_profit_object_type)
+                 (impl_custom_vote_weight_object_type)
+                 (impl_active_post_receiptor_object_type)
                  (IMPL_OBJECT_TYPE_COUNT)
                )
 
@@ -456,6 +477,7 @@ FC_REFLECT_TYPENAME( graphene::chain::block_summary_id_type )
 FC_REFLECT_TYPENAME( graphene::chain::account_transaction_history_id_type )
 FC_REFLECT_TYPENAME( graphene::chain::pledge_mining_id_type)
 FC_REFLECT_TYPENAME( graphene::chain::pledge_balance_id_type)
+FC_REFLECT_TYPENAME( graphene::chain::content_award_settlement_id_type)
 
 FC_REFLECT( graphene::chain::void_t, )
 
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/transaction.hpp>
+
+#include <list>
+#include <unordered_map>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief The last transactions included in the chain or in the pending state, by id.
+    *
+    *  Only the id and the expiration of a transaction are kept in the state to detect duplicates, see
+    *  transaction_object. The full transactions are only needed to answer peers and API clients asking for a
+    *  recent transaction, so they are kept here, outside of the undo history and of the state snapshots, up
+    *  to a number of transactions and until they expire.
+    *
+    *  A transaction is added once it applied, and removed when the block or the pending state it applied in is
+    *  undone, it is added again if it applies again.
+    */
+   class recent_transaction_cache
+   {
+      public:
+         explicit recent_transaction_cache( size_t max_size = GRAPHENE_DEFAULT_RECENT_TRANSACTIONS_KEPT );
+
+         /// Keeps the transaction, drops the oldest one if the cache is full
+         void add( const transaction_id_type& id, const signed_transaction& trx );
+         /// Drops the transaction if it is kept
+         void remove( const transaction_id_type& id );
+         /// @return the transaction, nullptr if it isn't kept
+         const signed_transaction* find( const transaction_id_type& id )const;
+         /// Drops the oldest transactions as long as they expired before @p now
+         void remove_expired( time_point_sec now );
+
+         /// Number of transactions to keep, 0 disables the cache, shrinks the cache if needed
+         void   set_max_size( size_t max_size );
+         size_t get_max_size()const { return _max_size; }
+         size_t size()const { return _entries.size(); }
+
+         void clear();
+
+      private:
+         typedef std::list< std::pair< transaction_id_type, signed_transaction > > entry_list;
+
+         void shrink_to( size_t max_size );
+
+         size_t     _max_size;
+         /// oldest first
+         entry_list _entries;
+         std::unordered_map< transaction_id_type, entry_list::iterator, std::hash<transaction_id_type> > _index;
+   };
+
+} } // graphene::chain
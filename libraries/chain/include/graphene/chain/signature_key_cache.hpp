@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/types.hpp>
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief Least recently used cache of the public keys recovered from transaction signatures.
+    *
+    *  A transaction is usually checked when it's pushed to the pending state, again when the block including it
+    *  is applied, and on witnesses once more when the block is generated. The key recovered from a signature
+    *  only depends on the signature and the signed digest, so it is recovered once and looked up afterwards,
+    *  see signed_transaction::get_signature_keys().
+    *
+    *  The cache is locked internally, it is used from the chain thread and from the worker threads at the same time.
+    */
+   class signature_key_cache
+   {
+      public:
+         explicit signature_key_cache( size_t max_size = GRAPHENE_DEFAULT_SIGNATURE_KEY_CACHE_SIZE );
+
+         /// @return the key recovered from the signature of the digest, recovering it if it isn't cached
+         public_key_type get_key( const digest_type& digest, const signature_type& sig );
+
+         /// Number of entries to keep, 0 disables the cache, shrinks the cache if needed
+         void   set_max_size( size_t max_size );
+         size_t get_max_size()const;
+         size_t size()const;
+
+         void clear();
+
+      private:
+         struct entry_key
+         {
+            digest_type    digest;
+            signature_type sig;
+
+            bool operator == ( const entry_key& other )const { return digest == other.digest && sig == other.sig; }
+         };
+         struct entry_key_hash
+         {
+            size_t operator()( const entry_key& k )const;
+         };
+         typedef std::list< std::pair< entry_key, public_key_type > > entry_list;
+
+         void shrink_to( size_t max_size );
+
+         mutable std::mutex _mutex;
+         size_t             _max_size;
+         /// most recently used first
+         entry_list         _entries;
+         std::unordered_map< entry_key, entry_list::iterator, entry_key_hash > _index;
+   };
+
+} } // graphene::chain
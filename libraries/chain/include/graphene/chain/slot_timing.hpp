@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/types.hpp>
+
+#include <fc/time.hpp>
+
+#include <deque>
+#include <map>
+#include <mutex>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief Histogram of the times after their slot time at which blocks were signed or received, in milliseconds.
+    */
+   struct slot_timing_histogram
+   {
+      /// upper bounds of the buckets, the last bucket counts the later blocks
+      vector<int64_t>  bounds_ms;
+      vector<uint32_t> counts;
+      uint32_t         count = 0;
+      int64_t          min_ms = 0;
+      int64_t          median_ms = 0;
+      int64_t          p90_ms = 0;
+      int64_t          max_ms = 0;
+   };
+
+   /**
+    *  @brief Timing of the last blocks of one witness, relative to the time of their slot.
+    */
+   struct witness_slot_timing
+   {
+      account_uid_type      witness = 0;
+      uint32_t              last_block_num = 0;
+      /// when this node signed the blocks it produced for the witness
+      slot_timing_histogram signed_after_slot;
+      /// when this node received the blocks of the witness from the network
+      slot_timing_histogram received_after_slot;
+   };
+
+   /**
+    *  @brief Keeps, per witness, how long after its slot time each of the last blocks was signed or received.
+    *
+    *  Blocks received while syncing are not recorded, they are long past their slot. The tracker is locked
+    *  internally, so it can be read from other threads while blocks are applied.
+    */
+   class slot_timing_tracker
+   {
+      public:
+         explicit slot_timing_tracker( size_t blocks_kept = GRAPHENE_DEFAULT_SLOT_TIMINGS_KEPT )
+         : _blocks_kept( blocks_kept ) {}
+
+         void record_signed( account_uid_type witness, uint32_t block_num, fc::time_point_sec slot_time,
+                             fc::time_point signed_time );
+         void record_received( account_uid_type witness, uint32_t block_num, fc::time_point_sec slot_time,
+                               fc::time_point received_time );
+
+         /// @return the timings of the witnesses with recorded blocks, ordered by witness
+         vector<witness_slot_timing> get_timings()const;
+
+         /// Number of the last signed and received blocks kept per witness, 0 to keep none
+         void   set_blocks_kept( size_t blocks_kept );
+         size_t get_blocks_kept()const;
+
+      private:
+         struct witness_samples
+         {
+            uint32_t            last_block_num = 0;
+            /// the oldest first
+            std::deque<int64_t> signed_ms;
+            std::deque<int64_t> received_ms;
+         };
+
+         void record( std::deque<int64_t> witness_samples::* samples, account_uid_type witness, uint32_t block_num,
+                      fc::time_point_sec slot_time, fc::time_point time );
+
+         mutable std::mutex                          _mutex;
+         size_t                                      _blocks_kept;
+         std::map<account_uid_type,witness_samples> _witnesses;
+   };
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::slot_timing_histogram, (bounds_ms)(counts)(count)(min_ms)(median_ms)(p90_ms)(max_ms) )
+FC_REFLECT( graphene::chain::witness_slot_timing, (witness)(last_block_num)(signed_after_slot)(received_after_slot) )
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/block.hpp>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief The objects of one index changed by a block
+    */
+   struct state_diff_index
+   {
+      /// the next id of the index after the block
+      object_id_type next_id;
+      /// the packed value of each object created or modified by the block, empty for an object it removed
+      vector< std::pair<object_id_type, vector<char>> > objects;
+   };
+
+   /**
+    *  @brief The changes a block made to the object database, taken from its undo state
+    *
+    *  A replica node applies them instead of the block, without evaluating its transactions, see
+    *  database::apply_state_diff().
+    */
+   struct state_diff
+   {
+      signed_block             block;
+      vector<state_diff_index> indexes;
+      /// the values in the post content store referenced by the changed posts
+      vector<string>           contents;
+   };
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::state_diff_index, (next_id)(objects) )
+FC_REFLECT( graphene::chain::state_diff, (block)(indexes)(contents) )
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/types.hpp>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief One index file of a state snapshot, at <snapshot>/<space>/<type>.
+    */
+   struct state_snapshot_file
+   {
+      uint8_t     space = 0;
+      uint8_t     type = 0;
+      uint64_t    size = 0;
+      fc::sha256  checksum;
+   };
+
+   /**
+    *  @brief Describes a state snapshot, saved packed to <snapshot>/manifest.
+    *
+    *  A snapshot holds every index of the object database as saved by object_database::flush(), one file per
+    *  index, see database::export_state_snapshot() and database::import_state_snapshot(), and a copy of the post
+    *  content store at <snapshot>/post_contents.
+    */
+   struct state_snapshot_manifest
+   {
+      uint32_t                    version = GRAPHENE_STATE_SNAPSHOT_VERSION;
+      /// the database version of the node which wrote the snapshot, it is only loaded by nodes of that version
+      string                      db_version;
+      chain_id_type               chain_id;
+      /// the block the state is the result of
+      block_id_type               head_block_id;
+      vector<state_snapshot_file> files;
+      uint64_t                    post_contents_size = 0;
+      fc::sha256                  post_contents_checksum;
+   };
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::state_snapshot_file, (space)(type)(size)(checksum) )
+FC_REFLECT( graphene::chain::state_snapshot_manifest, (version)(db_version)(chain_id)(head_block_id)(files)
+                                                   (post_contents_size)(post_contents_checksum) )
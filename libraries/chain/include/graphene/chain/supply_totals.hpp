@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/market_object.hpp>
+
+/**
+ * @file
+ * Running totals of the amounts that make up the supply of every asset.
+ *
+ * Each total is a secondary index of the index holding the amounts, so it follows every change of the objects,
+ * including the ones made while undoing, popping blocks or loading the database, and is never out of step with
+ * the state. @ref database::check_supply_totals() checks the supply with them without scanning the accounts,
+ * @ref database::check_invariants() checks them against a full scan.
+ */
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief Sum of the account balances of each asset, and number of accounts with a balance of each asset.
+    */
+   class account_balance_totals_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         uint64_t holder_count( asset_aid_type asset_id )const
+         {
+            auto itr = holder_counts.find( asset_id );
+            return itr != holder_counts.end() ? itr->second : 0;
+         }
+
+         map< asset_aid_type, share_type > total_balances;
+         /** balances which are not zero, assets without any are left out */
+         map< asset_aid_type, uint64_t >   holder_counts;
+   };
+
+   /**
+    *  @brief Sums of the core asset amounts kept in the account statistics, and of the uncollected market fees.
+    */
+   class account_statistics_totals_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         share_type total_core_balance;
+         /** prepaid, uncollected witness pay, pledge bonus, score bonus and core market fees */
+         share_type total_core_non_balance;
+         share_type total_core_leased_in;
+         share_type total_core_leased_out;
+         map< asset_aid_type, share_type > total_uncollected_market_fees;
+
+      protected:
+         void add( const _account_statistics_object& s, int64_t sign );
+   };
+
+   /**
+    *  @brief Sum of the pledges of each type.
+    */
+   class pledge_balance_totals_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         share_type total_pledge( pledge_balance_type type )const
+         {
+            auto itr = total_pledges.find( type );
+            return itr != total_pledges.end() ? itr->second : share_type();
+         }
+
+         map< pledge_balance_type, share_type > total_pledges;
+   };
+
+   /**
+    *  @brief Sum of the amounts for sale in limit orders of each asset.
+    */
+   class limit_order_totals_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         map< asset_aid_type, share_type > total_for_sale;
+   };
+
+} } // graphene::chain
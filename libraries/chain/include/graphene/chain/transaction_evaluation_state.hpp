@@ -26,6 +26,7 @@
 
 namespace graphene { namespace chain {
    class database;
+   class account_balance_object;
    struct signed_transaction;
 
    /**
@@ -40,6 +41,13 @@ namespace graphene { namespace chain {
 
 
          database& db()const { assert( _db ); return *_db; }
+
+         /**
+          * The balance object of owner in asset_id, found once for all the operations of the transaction, nullptr if
+          * there is none yet. Balance objects are never removed, the pointers stay valid while the transaction is
+          * applied; a balance object created later is found by the next call.
+          */
+         const account_balance_object* find_balance( account_uid_type owner, asset_aid_type asset_id );
          vector<operation_result> operation_results;
 
          const signed_transaction*        _trx = nullptr;
@@ -47,5 +55,10 @@ namespace graphene { namespace chain {
          bool                             _is_proposed_trx = false;
          bool                             skip_fee = false;
          bool                             skip_fee_schedule_check = false;
+         /// time the evaluator of the last operation spent evaluating and applying it, for the evaluation profile
+         fc::microseconds                 last_evaluate_time;
+         fc::microseconds                 last_apply_time;
+      private:
+         flat_map< std::pair<account_uid_type,asset_aid_type>, const account_balance_object* > _balances;
    };
 } } // namespace graphene::chain
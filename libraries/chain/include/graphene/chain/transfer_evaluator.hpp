@@ -42,6 +42,9 @@ namespace graphene { namespace chain {
          const _account_statistics_object* to_account_stats = nullptr;
          asset asset_from_balance, asset_from_prepaid, asset_to_balance, asset_to_prepaid;
          const account_auth_platform_object* auth_object=nullptr;
+         /// the balances of the accounts in the asset, nullptr if they have none yet
+         const account_balance_object* from_balance_obj = nullptr;
+         const account_balance_object* to_balance_obj = nullptr;
 
    };
 
@@ -85,6 +85,9 @@ namespace graphene { namespace chain {
          share_type          need_distribute_bonus;
          share_type          already_distribute_bonus;
          uint32_t            last_update_bonus_block_num = 0;
+         /// head block number of the last periodic pass which paid the bonus to the pledgers with a pledge, it
+         /// leaves their pledge mining objects alone, see database::pledge_mining_bonus_block_num()
+         uint32_t            bonus_paid_block_num = 0;
 
          uint32_t get_bonus_block_num()const {
             if (total_mining_pledge > 0 && (!bonus_per_pledge.empty() || unhandled_bonus > 0))
@@ -108,6 +111,49 @@ namespace graphene { namespace chain {
 
             return result;
          }
+
+         /// the fields changed by votes and by the by vote rotation, for object_database::modify_fields()
+         struct vote_schedule_fields
+         {
+            explicit vote_schedule_fields( const witness_object& w )
+            : total_votes( w.total_votes ),
+              by_vote_position( w.by_vote_position ),
+              by_vote_position_last_update( w.by_vote_position_last_update ),
+              by_vote_scheduled_time( w.by_vote_scheduled_time ) {}
+
+            void restore( witness_object& w )const
+            {
+               w.total_votes                  = total_votes;
+               w.by_vote_position             = by_vote_position;
+               w.by_vote_position_last_update = by_vote_position_last_update;
+               w.by_vote_scheduled_time       = by_vote_scheduled_time;
+            }
+
+            uint64_t      total_votes;
+            fc::uint128_t by_vote_position;
+            fc::uint128_t by_vote_position_last_update;
+            fc::uint128_t by_vote_scheduled_time;
+         };
+
+         /// the fields changed by the by pledge rotation, for object_database::modify_fields()
+         struct pledge_schedule_fields
+         {
+            explicit pledge_schedule_fields( const witness_object& w )
+            : by_pledge_position( w.by_pledge_position ),
+              by_pledge_position_last_update( w.by_pledge_position_last_update ),
+              by_pledge_scheduled_time( w.by_pledge_scheduled_time ) {}
+
+            void restore( witness_object& w )const
+            {
+               w.by_pledge_position             = by_pledge_position;
+               w.by_pledge_position_last_update = by_pledge_position_last_update;
+               w.by_pledge_scheduled_time       = by_pledge_scheduled_time;
+            }
+
+            fc::uint128_t by_pledge_position;
+            fc::uint128_t by_pledge_position_last_update;
+            fc::uint128_t by_pledge_scheduled_time;
+         };
    };
 
    struct by_account;
@@ -298,6 +344,7 @@ FC_REFLECT_DERIVED( graphene::chain::witness_object, (graphene::db::object),
                     (need_distribute_bonus)
                     (already_distribute_bonus)
                     (last_update_bonus_block_num)
+                    (bonus_paid_block_num)
                   )
 
 FC_REFLECT_DERIVED( graphene::chain::witness_vote_object, (graphene::db::object),
@@ -305,4 +352,7 @@ FC_REFLECT_DERIVED( graphene::chain::witness_vote_object, (graphene::db::object)
                     (voter_sequence)
                     (witness_uid)
                     (witness_sequence)
-                  )
\ No newline at end of file
+                  )
+
+GRAPHENE_DB_PRIMARY_INDEX( graphene::chain::witness_object,
+                           graphene::db::primary_index<graphene::chain::witness_index> )
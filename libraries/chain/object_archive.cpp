@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/object_archive.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/io/raw.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace chain {
+
+namespace {
+   /// What the head file holds, it is written after the files it describes so that what follows is ignored on open
+   struct archive_head
+   {
+      uint32_t first_block_num = 0;
+      uint32_t flushed_block_num = 0;
+      uint64_t record_count = 0;
+      uint64_t values_size = 0;
+   };
+
+   void open_file( std::fstream& stream, const fc::path& filename )
+   {
+      stream.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+      if( !fc::exists( filename ) )
+         stream.open( filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc );
+      else
+         stream.open( filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+   }
+
+   uint64_t stream_size( std::fstream& stream )
+   {
+      stream.seekg( 0, stream.end );
+      return stream.tellg();
+   }
+}
+
+const uint32_t object_archive::checkpoint_interval;
+const uint64_t object_archive::no_record;
+
+object_archive::object_archive() {}
+
+object_archive::~object_archive()
+{
+   close();
+}
+
+void object_archive::open( const fc::path& dir )
+{ try {
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   close();
+   fc::create_directories( dir );
+   _dir = dir;
+
+   archive_head head;
+   if( fc::exists( _dir / "head" ) )
+   {
+      std::ifstream head_file( ( _dir / "head" ).generic_string().c_str(), std::ios::in | std::ios::binary );
+      head_file.read( (char*)&head, sizeof(head) );
+      FC_ASSERT( uint64_t( head_file.gcount() ) == sizeof(head), "object archive head file is corrupted" );
+   }
+   _first_block_num   = head.first_block_num;
+   _flushed_block_num = head.flushed_block_num;
+   _values_size       = head.values_size;
+
+   open_file( _values, _dir / "values" );
+   FC_ASSERT( stream_size( _values ) >= _values_size, "object archive values are missing",
+              ("on_disk",stream_size( _values ))("expected",_values_size) );
+   open_file( _records, _dir / "versions" );
+   const uint64_t records_on_disk = stream_size( _records ) / sizeof(version_record);
+   FC_ASSERT( records_on_disk >= head.record_count, "object archive versions are missing",
+              ("on_disk",records_on_disk)("expected",head.record_count) );
+
+   // rebuild the in-memory heads, records past the head were written after the last flush and are overwritten
+   const size_t batch_size = 4096;
+   vector<version_record> batch;
+   _records.seekg( 0, _records.beg );
+   while( _record_count < head.record_count )
+   {
+      batch.resize( std::min<uint64_t>( batch_size, head.record_count - _record_count ) );
+      _records.read( (char*)batch.data(), batch.size() * sizeof(version_record) );
+      for( const version_record& r : batch )
+      {
+         object_head& h = _heads[r.object];
+         if( h.versions % checkpoint_interval == 0 )
+            h.checkpoints.emplace_back( r.block_num, _record_count );
+         h.last_record = _record_count;
+         ++h.versions;
+         ++_record_count;
+      }
+   }
+
+   _open = true;
+   ilog( "Opened object archive with ${n} versions of ${o} objects from block ${f} to ${b}",
+         ("n",_record_count)("o",_heads.size())("f",_first_block_num)("b",_flushed_block_num) );
+} FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+bool object_archive::is_open()const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   return _open;
+}
+
+void object_archive::close()
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   if( !_open )
+      return;
+   _records.close();
+   _values.close();
+   _heads.clear();
+   _pending.clear();
+   _pending_versions = 0;
+   _first_block_num = 0;
+   _flushed_block_num = 0;
+   _record_count = 0;
+   _values_size = 0;
+   _open = false;
+}
+
+uint32_t object_archive::first_block_num()const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   return _first_block_num;
+}
+
+uint32_t object_archive::last_block_num()const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   return _pending.empty() ? _flushed_block_num : _pending.back().block_num;
+}
+
+uint32_t object_archive::flushed_block_num()const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   return _flushed_block_num;
+}
+
+uint64_t object_archive::version_count()const
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   return _record_count + _pending_versions;
+}
+
+void object_archive::append_block( uint32_t block_num, vector< std::pair<object_id_type, vector<char>> >&& old_values )
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   FC_ASSERT( _open );
+   FC_ASSERT( _first_block_num == 0 || block_num == last_block_num() + 1,
+              "blocks must be added to the object archive in order",
+              ("block",block_num)("last",last_block_num()) );
+   if( _first_block_num == 0 )
+   {
+      _first_block_num = block_num;
+      _flushed_block_num = block_num - 1;
+   }
+
+   pending_block b;
+   b.block_num = block_num;
+   b.old_values.reserve( old_values.size() );
+   for( auto& v : old_values )
+      b.old_values.emplace( v.first.number, std::move( v.second ) );
+   _pending_versions += b.old_values.size();
+   _pending.push_back( std::move( b ) );
+}
+
+void object_archive::discard_from_block( uint32_t block_num )
+{
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   FC_ASSERT( _first_block_num == 0 || block_num > _flushed_block_num,
+              "block ${b} is already written to the object archive", ("b",block_num)("flushed",_flushed_block_num) );
+   while( !_pending.empty() && _pending.back().block_num >= block_num )
+   {
+      _pending_versions -= _pending.back().old_values.size();
+      _pending.pop_back();
+   }
+   if( _record_count == 0 && _pending.empty() )
+   {
+      _first_block_num = 0;
+      _flushed_block_num = 0;
+   }
+}
+
+void object_archive::flush_until_block( uint32_t block_num )
+{ try {
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   if( !_open || _pending.empty() || _pending.front().block_num > block_num )
+      return;
+
+   _values.seekp( _values_size );
+   while( !_pending.empty() && _pending.front().block_num <= block_num )
+   {
+      const pending_block& b = _pending.front();
+      // written in the order of the objects so that a flush doesn't depend on how the map is laid out
+      vector<uint64_t> objects;
+      objects.reserve( b.old_values.size() );
+      for( const auto& v : b.old_values )
+         objects.push_back( v.first );
+      std::sort( objects.begin(), objects.end() );
+      for( const uint64_t object : objects )
+      {
+         const vector<char>& value = b.old_values.find( object )->second;
+         version_record r;
+         r.object     = object;
+         r.value_pos  = _values_size;
+         r.value_size = value.size();
+         r.block_num  = b.block_num;
+         if( !value.empty() )
+         {
+            _values.write( value.data(), value.size() );
+            _values_size += value.size();
+         }
+         add_record( r );
+      }
+      _pending_versions -= b.old_values.size();
+      _flushed_block_num = b.block_num;
+      _pending.pop_front();
+   }
+
+   _values.flush();
+   _records.flush();
+   save_head();
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+void object_archive::add_record( const version_record& record )
+{
+   object_head& h = _heads[record.object];
+   version_record r = record;
+   r.prev = h.last_record;
+   _records.seekp( sizeof(r) * _record_count );
+   _records.write( (const char*)&r, sizeof(r) );
+
+   if( h.versions % checkpoint_interval == 0 )
+      h.checkpoints.emplace_back( r.block_num, _record_count );
+   h.last_record = _record_count;
+   ++h.versions;
+   ++_record_count;
+}
+
+object_archive::version_record object_archive::read_record( uint64_t record_num )const
+{
+   FC_ASSERT( record_num < _record_count );
+   version_record r;
+   _records.seekg( sizeof(r) * record_num );
+   _records.read( (char*)&r, sizeof(r) );
+   return r;
+}
+
+bool object_archive::find_value_after( object_id_type id, uint32_t block_num, vector<char>& value )const
+{ try {
+   std::lock_guard<std::recursive_mutex> guard( _mutex );
+   value.clear();
+   if( !_open )
+      return false;
+
+   auto head_itr = ( block_num < _flushed_block_num ? _heads.find( id.number ) : _heads.end() );
+   if( head_itr != _heads.end() )
+   {
+      // start from the first checkpoint after the block, or the last version, and walk back
+      const object_head& h = head_itr->second;
+      auto c = std::upper_bound( h.checkpoints.begin(), h.checkpoints.end(), block_num,
+                                 []( uint32_t b, const std::pair<uint32_t,uint64_t>& p ) { return b < p.first; } );
+      version_record r = read_record( c != h.checkpoints.end() ? c->second : h.last_record );
+      if( r.block_num > block_num )
+      {
+         while( r.prev != no_record )
+         {
+            const version_record prev = read_record( r.prev );
+            if( prev.block_num <= block_num )
+               break;
+            r = prev;
+         }
+         if( r.value_size > 0 )
+         {
+            value.resize( r.value_size );
+            _values.seekg( r.value_pos );
+            _values.read( value.data(), value.size() );
+         }
+         return true;
+      }
+   }
+
+   for( const pending_block& b : _pending )
+   {
+      if( b.block_num <= block_num )
+         continue;
+      auto itr = b.old_values.find( id.number );
+      if( itr != b.old_values.end() )
+      {
+         value = itr->second;
+         return true;
+      }
+   }
+   return false;
+} FC_CAPTURE_AND_RETHROW( (id)(block_num) ) }
+
+void object_archive::save_head()const
+{
+   archive_head head;
+   head.first_block_num   = _first_block_num;
+   head.flushed_block_num = _flushed_block_num;
+   head.record_count      = _record_count;
+   head.values_size       = _values_size;
+   // written beside the head and renamed over it, so that a crash leaves either the old head or the new one
+   const fc::path tmp_file = _dir / "head.tmp";
+   {
+      std::ofstream head_file( tmp_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+      head_file.write( (const char*)&head, sizeof(head) );
+      head_file.flush();
+      FC_ASSERT( head_file.good(), "Unable to write ${f}", ("f",tmp_file) );
+   }
+   fc::rename( tmp_file, _dir / "head" );
+}
+
+} } // graphene::chain
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/object_counts.hpp>
+
+namespace graphene { namespace chain {
+
+namespace {
+
+   template< typename Key >
+   void decrement_count( map< Key, uint64_t >& counts, const Key& key )
+   {
+      auto itr = counts.find( key );
+      assert( itr != counts.end() && itr->second > 0 );
+      if( --itr->second == 0 )
+         counts.erase( itr );
+   }
+
+   template< typename Key >
+   void add_score( map< Key, post_score_totals >& totals, const Key& key, const score_object& s, int64_t sign )
+   {
+      auto itr = totals.find( key );
+      if( itr == totals.end() )
+      {
+         assert( sign > 0 );
+         itr = totals.emplace( key, post_score_totals() ).first;
+      }
+      post_score_totals& t = itr->second;
+      t.score_count += sign;
+      t.total_csaf += s.csaf * sign;
+      t.total_weighted_score += s.csaf * int64_t( s.score ) * sign;
+      if( t.score_count == 0 )
+         totals.erase( itr );
+   }
+
+   template< typename Key >
+   post_score_totals find_totals( const map< Key, post_score_totals >& totals, const Key& key )
+   {
+      auto itr = totals.find( key );
+      return itr != totals.end() ? itr->second : post_score_totals();
+   }
+
+   template< typename Key >
+   uint64_t find_count( const map< Key, uint64_t >& counts, const Key& key )
+   {
+      auto itr = counts.find( key );
+      return itr != counts.end() ? itr->second : 0;
+   }
+
+}
+
+void post_count_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const post_object*>(&obj) ); // for debug only
+   const post_object& p = static_cast<const post_object&>(obj);
+   ++_platform_counts[p.platform];
+   ++_poster_counts[std::make_pair( p.platform, p.poster )];
+}
+
+void post_count_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const post_object*>(&obj) ); // for debug only
+   const post_object& p = static_cast<const post_object&>(obj);
+   decrement_count( _platform_counts, p.platform );
+   decrement_count( _poster_counts, std::make_pair( p.platform, p.poster ) );
+}
+
+void post_count_index::about_to_modify( const object& before )
+{
+   object_removed( before );
+}
+
+void post_count_index::object_modified( const object& after )
+{
+   object_inserted( after );
+}
+
+uint64_t post_count_index::post_count( account_uid_type platform )const
+{
+   return find_count( _platform_counts, platform );
+}
+
+uint64_t post_count_index::post_count( account_uid_type platform, account_uid_type poster )const
+{
+   return find_count( _poster_counts, std::make_pair( platform, poster ) );
+}
+
+void post_score_totals_index::add( const score_object& s, int64_t sign )
+{
+   add_score( _post_totals, std::make_tuple( s.platform, s.poster, s.post_pid ), s, sign );
+   add_score( _period_totals, std::make_tuple( s.platform, s.poster, s.post_pid, s.period_sequence ), s, sign );
+}
+
+void post_score_totals_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const score_object*>(&obj) ); // for debug only
+   add( static_cast<const score_object&>(obj), 1 );
+}
+
+void post_score_totals_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const score_object*>(&obj) ); // for debug only
+   add( static_cast<const score_object&>(obj), -1 );
+}
+
+post_score_totals post_score_totals_index::totals( account_uid_type platform, account_uid_type poster,
+                                                   post_pid_type post_pid )const
+{
+   return find_totals( _post_totals, std::make_tuple( platform, poster, post_pid ) );
+}
+
+post_score_totals post_score_totals_index::period_totals( account_uid_type platform, account_uid_type poster,
+                                                          post_pid_type post_pid, uint64_t period_sequence )const
+{
+   return find_totals( _period_totals, std::make_tuple( platform, poster, post_pid, period_sequence ) );
+}
+
+void score_create_time_count_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const score_object*>(&obj) ); // for debug only
+   ++_counts[static_cast<const score_object&>(obj).create_time];
+}
+
+void score_create_time_count_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const score_object*>(&obj) ); // for debug only
+   decrement_count( _counts, static_cast<const score_object&>(obj).create_time );
+}
+
+uint64_t score_create_time_count_index::created_until( time_point_sec time )const
+{
+   uint64_t result = 0;
+   for( auto itr = _counts.begin(); itr != _counts.end() && itr->first <= time; ++itr )
+      result += itr->second;
+   return result;
+}
+
+void account_auth_platform_count_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const account_auth_platform_object*>(&obj) ); // for debug only
+   ++_platform_counts[static_cast<const account_auth_platform_object&>(obj).platform];
+}
+
+void account_auth_platform_count_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const account_auth_platform_object*>(&obj) ); // for debug only
+   decrement_count( _platform_counts, static_cast<const account_auth_platform_object&>(obj).platform );
+}
+
+void account_auth_platform_count_index::about_to_modify( const object& before )
+{
+   object_removed( before );
+}
+
+void account_auth_platform_count_index::object_modified( const object& after )
+{
+   object_inserted( after );
+}
+
+uint64_t account_auth_platform_count_index::account_count( account_uid_type platform )const
+{
+   return find_count( _platform_counts, platform );
+}
+
+void advertising_order_count_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const advertising_order_object*>(&obj) ); // for debug only
+   const advertising_order_object& o = static_cast<const advertising_order_object&>(obj);
+   if( o.status != advertising_undetermined && o.status != advertising_accepted )
+      return;
+   ++_order_counts[std::make_tuple( o.status, o.platform, o.advertising_aid )];
+   if( o.status == advertising_undetermined )
+      _undetermined_balance += o.released_balance;
+}
+
+void advertising_order_count_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const advertising_order_object*>(&obj) ); // for debug only
+   const advertising_order_object& o = static_cast<const advertising_order_object&>(obj);
+   if( o.status != advertising_undetermined && o.status != advertising_accepted )
+      return;
+   decrement_count( _order_counts, std::make_tuple( o.status, o.platform, o.advertising_aid ) );
+   if( o.status == advertising_undetermined )
+      _undetermined_balance -= o.released_balance;
+}
+
+void advertising_order_count_index::about_to_modify( const object& before )
+{
+   object_removed( before );
+}
+
+void advertising_order_count_index::object_modified( const object& after )
+{
+   object_inserted( after );
+}
+
+uint64_t advertising_order_count_index::order_count( account_uid_type platform, advertising_aid_type aid,
+                                                     advertising_state status )const
+{
+   return find_count( _order_counts, std::make_tuple( status, platform, aid ) );
+}
+
+} } // graphene::chain
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/operation_history_object.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace chain {
+
+namespace {
+   typedef account_history_sequence_index::entry history_entry;
+
+   bool entry_before( const history_entry& e, uint32_t sequence ) { return e.sequence < sequence; }
+   bool before_entry( uint32_t sequence, const history_entry& e ) { return sequence < e.sequence; }
+}
+
+void account_history_sequence_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const account_transaction_history_object*>(&obj) ); // for debug only
+   const auto& h = static_cast<const account_transaction_history_object&>(obj);
+
+   entry e;
+   e.id             = h.id;
+   e.operation_id   = h.operation_id;
+   e.sequence       = h.sequence;
+   e.operation_type = h.operation_type;
+
+   auto& a = _accounts[h.account];
+   if( a.first == a.entries.size() || h.sequence > a.entries.back().sequence )
+      a.entries.push_back( e );
+   else
+   {
+      // put back by undo
+      const auto begin = a.entries.begin() + a.first;
+      auto itr = std::lower_bound( begin, a.entries.end(), h.sequence, entry_before );
+      if( itr == begin && a.first > 0 )
+         a.entries[--a.first] = e;
+      else
+         a.entries.insert( itr, e );
+   }
+
+   auto& seqs = a.type_sequences[h.operation_type];
+   if( seqs.empty() || h.sequence > seqs.back() )
+      seqs.push_back( h.sequence );
+   else
+      seqs.insert( std::lower_bound( seqs.begin(), seqs.end(), h.sequence ), h.sequence );
+}
+
+void account_history_sequence_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const account_transaction_history_object*>(&obj) ); // for debug only
+   const auto& h = static_cast<const account_transaction_history_object&>(obj);
+
+   auto aitr = _accounts.find( h.account );
+   if( aitr == _accounts.end() )
+      return;
+   auto& a = aitr->second;
+
+   const auto begin = a.entries.begin() + a.first;
+   auto itr = std::lower_bound( begin, a.entries.end(), h.sequence, entry_before );
+   if( itr == a.entries.end() || itr->sequence != h.sequence )
+      return;
+   if( itr == begin )
+      ++a.first;
+   else
+      a.entries.erase( itr );
+
+   auto titr = a.type_sequences.find( h.operation_type );
+   if( titr != a.type_sequences.end() )
+   {
+      auto& seqs = titr->second;
+      auto sitr = std::lower_bound( seqs.begin(), seqs.end(), h.sequence );
+      if( sitr != seqs.end() && *sitr == h.sequence )
+         seqs.erase( sitr );
+      if( seqs.empty() )
+         a.type_sequences.erase( titr );
+   }
+
+   if( a.first == a.entries.size() )
+      _accounts.erase( aitr );
+   else if( a.first * 2 >= a.entries.size() )
+   {
+      a.entries.erase( a.entries.begin(), a.entries.begin() + a.first );
+      a.first = 0;
+   }
+}
+
+vector<account_history_sequence_index::entry> account_history_sequence_index::get_history(
+      account_uid_type account, const flat_set<uint16_t>& op_types, uint32_t stop, uint32_t start, uint32_t limit )const
+{
+   vector<entry> result;
+   auto aitr = _accounts.find( account );
+   if( aitr == _accounts.end() || start < stop )
+      return result;
+   const auto& a = aitr->second;
+   const auto begin = a.entries.begin() + a.first;
+
+   if( op_types.empty() )
+   {
+      auto itr = std::upper_bound( begin, a.entries.end(), start, before_entry );
+      while( itr != begin && result.size() < limit )
+      {
+         --itr;
+         if( itr->sequence < stop )
+            break;
+         result.push_back( *itr );
+      }
+      return result;
+   }
+
+   // one cursor per type, each just after its latest sequence not taken yet, merged latest first
+   typedef std::pair< vector<uint32_t>::const_iterator, const vector<uint32_t>* > cursor;
+   vector<cursor> cursors;
+   for( uint16_t type : op_types )
+   {
+      auto titr = a.type_sequences.find( type );
+      if( titr != a.type_sequences.end() )
+         cursors.emplace_back( std::upper_bound( titr->second.begin(), titr->second.end(), start ), &titr->second );
+   }
+   while( result.size() < limit )
+   {
+      cursor* latest = nullptr;
+      for( auto& c : cursors )
+      {
+         if( c.first != c.second->begin() && ( latest == nullptr || *( c.first - 1 ) > *( latest->first - 1 ) ) )
+            latest = &c;
+      }
+      if( latest == nullptr )
+         break;
+      const uint32_t seq = *( --latest->first );
+      if( seq < stop )
+         break;
+      auto itr = std::lower_bound( begin, a.entries.end(), seq, entry_before );
+      assert( itr != a.entries.end() && itr->sequence == seq );
+      result.push_back( *itr );
+   }
+   return result;
+}
+
+uint32_t account_history_sequence_index::last_sequence_until( account_uid_type account, operation_history_id_type op )const
+{
+   auto aitr = _accounts.find( account );
+   if( aitr == _accounts.end() )
+      return 0;
+   const auto& a = aitr->second;
+   const auto begin = a.entries.begin() + a.first;
+   // the operation ids grow with the sequence
+   auto itr = std::upper_bound( begin, a.entries.end(), op,
+                                []( operation_history_id_type o, const entry& e ) { return o < e.operation_id; } );
+   return itr == begin ? 0 : ( itr - 1 )->sequence;
+}
+
+const account_history_sequence_index::entry* account_history_sequence_index::earliest( account_uid_type account )const
+{
+   auto aitr = _accounts.find( account );
+   if( aitr == _accounts.end() )
+      return nullptr;
+   return &aitr->second.entries[aitr->second.first];
+}
+
+size_t account_history_sequence_index::size( account_uid_type account )const
+{
+   auto aitr = _accounts.find( account );
+   if( aitr == _accounts.end() )
+      return 0;
+   return aitr->second.entries.size() - aitr->second.first;
+}
+
+void operation_reference_count_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const account_transaction_history_object*>(&obj) ); // for debug only
+   ++_references[static_cast<const account_transaction_history_object&>(obj).operation_id.instance.value];
+}
+
+void operation_reference_count_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const account_transaction_history_object*>(&obj) ); // for debug only
+   auto itr = _references.find( static_cast<const account_transaction_history_object&>(obj).operation_id.instance.value );
+   if( itr != _references.end() && --itr->second == 0 )
+      _references.erase( itr );
+}
+
+uint32_t operation_reference_count_index::references( operation_history_id_type op )const
+{
+   auto itr = _references.find( op.instance.value );
+   return itr == _references.end() ? 0 : itr->second;
+}
+
+} } // graphene::chain
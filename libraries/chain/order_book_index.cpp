@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/order_book_index.hpp>
+
+namespace graphene { namespace chain {
+
+void limit_order_book_index::add( const limit_order_object& o, int64_t sign )
+{
+   const auto market = std::make_pair( o.sell_asset_id(), o.receive_asset_id() );
+   side_type& side = _sides[market];
+   auto itr = side.find( o.sell_price );
+   if( itr == side.end() )
+      itr = side.emplace( o.sell_price, share_type() ).first;
+   itr->second += o.for_sale * sign;
+   if( _track_changes )
+      _changed_levels.insert( itr->first );
+   if( itr->second == 0 )
+   {
+      side.erase( itr );
+      if( side.empty() )
+         _sides.erase( market );
+   }
+}
+
+void limit_order_book_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const limit_order_object*>(&obj) ); // for debug only
+   add( static_cast<const limit_order_object&>(obj), 1 );
+}
+
+void limit_order_book_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const limit_order_object*>(&obj) ); // for debug only
+   add( static_cast<const limit_order_object&>(obj), -1 );
+}
+
+void limit_order_book_index::about_to_modify( const object& before )
+{
+   object_removed( before );
+}
+
+void limit_order_book_index::object_modified( const object& after )
+{
+   object_inserted( after );
+}
+
+const limit_order_book_index::side_type* limit_order_book_index::find_side( asset_aid_type sell_asset,
+                                                                            asset_aid_type receive_asset )const
+{
+   auto itr = _sides.find( std::make_pair( sell_asset, receive_asset ) );
+   return itr != _sides.end() ? &itr->second : nullptr;
+}
+
+void limit_order_book_index::set_track_changes( bool track )const
+{
+   _track_changes = track;
+   if( !track )
+      _changed_levels.clear();
+}
+
+vector<limit_order_book_index::level_type> limit_order_book_index::take_changed_levels()const
+{
+   vector<level_type> result;
+   result.reserve( _changed_levels.size() );
+   for( const price& p : _changed_levels )
+   {
+      const side_type* side = find_side( p.base.asset_id, p.quote.asset_id );
+      share_type amount;
+      if( side != nullptr )
+      {
+         auto itr = side->find( p );
+         if( itr != side->end() )
+            amount = itr->second;
+      }
+      result.emplace_back( p, amount );
+   }
+   _changed_levels.clear();
+   return result;
+}
+
+} } // graphene::chain
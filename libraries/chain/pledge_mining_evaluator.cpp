@@ -62,11 +62,18 @@ void_result pledge_mining_update_evaluator::do_apply(const pledge_mining_update_
       share_type send_bonus = 0;
       if (pledge_mining_obj)
       {
-         share_type bonus_per_pledge = witness_obj->accumulate_bonus_per_pledge(pledge_mining_obj->last_bonus_block_num + 1);
+         share_type bonus_per_pledge = witness_obj->accumulate_bonus_per_pledge(
+                                          d.pledge_mining_bonus_block_num(*pledge_mining_obj, *witness_obj) + 1);
          send_bonus = d.update_pledge_mining_bonus_by_account(*pledge_mining_obj, bonus_per_pledge);
          share_type delta_available_balance=0;
          const pledge_balance_object& pledge_balance_obj=pledge_mining_obj->pledge_id(d);
          delta_pledge_to_witness=op.new_pledge-pledge_balance_obj.pledge;
+         if (pledge_balance_obj.pledge == 0) // left alone by update_pledge_mining_bonus_by_account()
+         {
+            d.modify(*pledge_mining_obj, [&](pledge_mining_object& obj) {
+               obj.last_update_block_num = block_num;
+            });
+         }
       
          d.modify(pledge_balance_obj, [&](pledge_balance_object& obj) {
             delta_available_balance = obj.update_pledge(op.new_pledge, block_num + params.mining_pledge_release_delay,d);
@@ -85,6 +92,7 @@ void_result pledge_mining_update_evaluator::do_apply(const pledge_mining_update_
             obj.pledge_account = op.pledge_account;
             obj.witness = op.witness;
             obj.last_bonus_block_num = block_num;
+            obj.last_update_block_num = block_num;
             obj.pledge_id=pledge_balance_obj.id;
          });
          d.modify(pledge_balance_obj, [&](pledge_balance_object& s) {
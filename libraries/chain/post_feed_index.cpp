@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#include <graphene/chain/post_feed_index.hpp>
+
+namespace graphene { namespace chain {
+
+void post_feed_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const post_object*>(&obj) ); // for debug only
+   const post_object& p = static_cast<const post_object&>(obj);
+   _entries.insert( entry{ p.platform, p.create_time, p.id, &p } );
+}
+
+void post_feed_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const post_object*>(&obj) ); // for debug only
+   const post_object& p = static_cast<const post_object&>(obj);
+   _entries.erase( entry{ p.platform, p.create_time, p.id, &p } );
+}
+
+post_feed_index::const_iterator post_feed_index::lower_bound( account_uid_type platform, time_point_sec create_time,
+                                                              object_id_type id )const
+{
+   return _entries.lower_bound( entry{ platform, create_time, id, nullptr } );
+}
+
+} } // graphene::chain
@@ -24,12 +24,12 @@
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/proposal_object.hpp>
+#include <graphene/chain/protocol/sign_state.hpp>
 
 namespace graphene { namespace chain {
 
 std::pair<bool, signed_information> proposal_object::is_authorized_to_execute(database& db) const
 {
-   transaction_evaluation_state dry_run_eval(&db);
    signed_information sigs;
 
    try {
@@ -40,11 +40,9 @@ std::pair<bool, signed_information> proposal_object::is_authorized_to_execute(da
            map[key] = st;
        }
        bool enable_hardfork_04 = db.get_dynamic_global_properties().enabled_hardfork_version >= ENABLE_HEAD_FORK_04;
-       sigs = verify_authority( proposed_transaction.operations,
+       sigs = verify_authority_with( db.get_authority_resolver(),
+                       proposed_transaction.operations,
                        map,
-                       [&]( account_uid_type uid ){ return &(db.get_account_by_uid(uid).owner); },
-                       [&]( account_uid_type uid ){ return &(db.get_account_by_uid(uid).active); },
-                       [&]( account_uid_type uid ){ return &(db.get_account_by_uid(uid).secondary); },
                        enable_hardfork_04,
                        db.get_global_properties().parameters.max_authority_depth,
                        true, /* allow committeee */
@@ -39,6 +39,8 @@ namespace graphene { namespace chain {
 
    block_id_type signed_block_header::id()const
    {
+      if( precomputed_id.valid() )
+         return *precomputed_id;
       auto tmp = fc::sha224::hash( *this );
       tmp._hash[0] = fc::endian_reverse_u32(block_num()); // store the block num in the ID, 160 bits is plenty for the hash
       static_assert( sizeof(tmp._hash[0]) == 4, "should be 4 bytes" );
@@ -49,12 +51,34 @@ namespace graphene { namespace chain {
 
    fc::ecc::public_key signed_block_header::signee()const
    {
+      if( precomputed_signee.valid() )
+         return *precomputed_signee;
       return fc::ecc::public_key( witness_signature, digest(), true/*enforce canonical*/ );
    }
 
+   void signed_block_header::precompute_signee()const
+   {
+      if( precomputed_signee.valid() )
+         return;
+      try {
+         precomputed_signee = public_key_type( fc::ecc::public_key( witness_signature, digest(), true/*enforce canonical*/ ) );
+      } catch( const fc::exception& ) {
+         // left to signee() to fail again when the block is validated
+      }
+   }
+
    void signed_block_header::sign( const fc::ecc::private_key& signer )
    {
       witness_signature = signer.sign_compact( digest() );
+      precomputed_id.reset();
+      precomputed_signee.reset();
+   }
+
+   const block_id_type& signed_block_header::precompute_id()const
+   {
+      if( !precomputed_id.valid() )
+         precomputed_id = id();
+      return *precomputed_id;
    }
 
    bool signed_block_header::validate_signee( const fc::ecc::public_key& expected_signee )const
@@ -64,13 +88,49 @@ namespace graphene { namespace chain {
 
    checksum_type signed_block::calculate_merkle_root()const
    {
-      if( transactions.size() == 0 ) 
-         return checksum_type();
-
       vector<digest_type> ids;
       ids.resize( transactions.size() );
       for( uint32_t i = 0; i < transactions.size(); ++i )
          ids[i] = transactions[i].merkle_digest();
+      return calculate_merkle_root( std::move(ids) );
+   }
+
+   checksum_type signed_block::calculate_merkle_root( const for_each_index_type& for_each, size_t min_parallel )const
+   {
+      if( transactions.size() < min_parallel )
+         return calculate_merkle_root();
+      vector<digest_type> ids;
+      ids.resize( transactions.size() );
+      for_each( ids.size(), [this,&ids]( size_t i ) {
+         ids[i] = transactions[i].merkle_digest();
+      });
+      return calculate_merkle_root( std::move(ids), for_each, min_parallel );
+   }
+
+   checksum_type signed_block::calculate_merkle_root( vector<digest_type> ids, const for_each_index_type& for_each,
+                                                      size_t min_parallel )
+   {
+      // the pairs of a level are hashed into a vector of their own, as concurrent pairs can't overwrite the level
+      // in place, until the level is small enough for the serial version
+      vector<digest_type> next;
+      while( ids.size() / 2 >= std::max<size_t>( min_parallel, 1 ) )
+      {
+         const size_t pairs = ids.size() / 2;
+         next.resize( pairs + ( ids.size() & 1 ) );
+         for_each( pairs, [&ids,&next]( size_t i ) {
+            next[i] = digest_type::hash( std::make_pair( ids[2*i], ids[2*i+1] ) );
+         });
+         if( ids.size() & 1 )
+            next.back() = ids.back();
+         ids.swap( next );
+      }
+      return calculate_merkle_root( std::move(ids) );
+   }
+
+   checksum_type signed_block::calculate_merkle_root( vector<digest_type> ids )
+   {
+      if( ids.size() == 0 )
+         return checksum_type();
 
       vector<digest_type>::size_type current_number_of_hashes = ids.size();
       while( current_number_of_hashes > 1 )
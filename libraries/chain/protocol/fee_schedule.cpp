@@ -207,13 +207,32 @@ namespace graphene { namespace chain {
       this->scale = 0;
    }
 
+   const fee_parameters& fee_schedule::get_parameters( int which )const
+   {
+      // the default parameters of every type, built once, serve as the keys when looking for a type too
+      static const vector<fee_parameters> defaults = []() -> vector<fee_parameters> {
+         vector<fee_parameters> result( fee_parameters().count() );
+         for( int i = 0; i < fee_parameters().count(); ++i )
+            result[i].set_which(i);
+         return result;
+      }();
+      FC_ASSERT( which >= 0 && which < fee_parameters().count() );
+
+      // parameters is sorted by type without duplicates, so in a complete schedule every type is at its own place
+      if( size_t(which) < parameters.size() )
+      {
+         const fee_parameters& p = *( parameters.begin() + which );
+         if( p.which() == which )
+            return p;
+      }
+      auto itr = parameters.find( defaults[which] );
+      return itr != parameters.end() ? *itr : defaults[which];
+   }
+
    asset fee_schedule::calculate_fee( const operation& op, const price& core_exchange_rate )const
    {
       //idump( (op)(core_exchange_rate) );
-      fee_parameters params; params.set_which(op.which());
-      auto itr = parameters.find(params);
-      if( itr != parameters.end() ) params = *itr;
-      auto base_value = op.visit( calc_fee_visitor( params ) );
+      auto base_value = op.visit( calc_fee_visitor( get_parameters( op.which() ) ) );
       auto scaled = fc::uint128(base_value) * scale;
       scaled /= GRAPHENE_100_PERCENT;
       FC_ASSERT( scaled <= GRAPHENE_MAX_SHARE_SUPPLY );
@@ -230,10 +249,7 @@ namespace graphene { namespace chain {
 
    std::pair<share_type,share_type> fee_schedule::calculate_fee_pair( const operation& op )const
    {
-      fee_parameters params; params.set_which(op.which());
-      auto itr = parameters.find(params);
-      if( itr != parameters.end() ) params = *itr;
-      return op.visit( calc_fee_pair_visitor( params ) );
+      return op.visit( calc_fee_pair_visitor( get_parameters( op.which() ) ) );
    }
 
    void fee_schedule::set_fee_with_csaf( operation& op )const
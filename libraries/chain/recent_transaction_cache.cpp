@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/recent_transaction_cache.hpp>
+
+namespace graphene { namespace chain {
+
+recent_transaction_cache::recent_transaction_cache( size_t max_size )
+   : _max_size( max_size )
+{
+}
+
+void recent_transaction_cache::add( const transaction_id_type& id, const signed_transaction& trx )
+{
+   if( _max_size == 0 || _index.find( id ) != _index.end() )
+      return;
+   _entries.emplace_back( id, trx );
+   _index.emplace( id, std::prev( _entries.end() ) );
+   shrink_to( _max_size );
+}
+
+void recent_transaction_cache::remove( const transaction_id_type& id )
+{
+   auto itr = _index.find( id );
+   if( itr == _index.end() )
+      return;
+   _entries.erase( itr->second );
+   _index.erase( itr );
+}
+
+const signed_transaction* recent_transaction_cache::find( const transaction_id_type& id )const
+{
+   auto itr = _index.find( id );
+   return itr != _index.end() ? &itr->second->second : nullptr;
+}
+
+void recent_transaction_cache::remove_expired( time_point_sec now )
+{
+   while( !_entries.empty() && now > _entries.front().second.expiration )
+   {
+      _index.erase( _entries.front().first );
+      _entries.pop_front();
+   }
+}
+
+void recent_transaction_cache::set_max_size( size_t max_size )
+{
+   _max_size = max_size;
+   shrink_to( _max_size );
+}
+
+void recent_transaction_cache::clear()
+{
+   _index.clear();
+   _entries.clear();
+}
+
+void recent_transaction_cache::shrink_to( size_t max_size )
+{
+   while( _entries.size() > max_size )
+   {
+      _index.erase( _entries.front().first );
+      _entries.pop_front();
+   }
+}
+
+} } // graphene::chain
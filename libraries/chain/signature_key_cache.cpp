@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/signature_key_cache.hpp>
+
+#include <cstring>
+
+namespace graphene { namespace chain {
+
+size_t signature_key_cache::entry_key_hash::operator()( const entry_key& k )const
+{
+   // the digest is a hash already, and so is the r value following the recovery id byte of the signature
+   uint64_t r;
+   std::memcpy( &r, k.sig.data + 1, sizeof(r) );
+   return size_t( k.digest._hash[0] ^ r );
+}
+
+signature_key_cache::signature_key_cache( size_t max_size )
+   : _max_size( max_size )
+{
+}
+
+public_key_type signature_key_cache::get_key( const digest_type& digest, const signature_type& sig )
+{
+   entry_key k{ digest, sig };
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      auto itr = _index.find( k );
+      if( itr != _index.end() )
+      {
+         _entries.splice( _entries.begin(), _entries, itr->second );
+         return itr->second->second;
+      }
+   }
+
+   // recover without holding the lock, other threads may be recovering other keys in the meantime
+   public_key_type key = fc::ecc::public_key( sig, digest );
+
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( _max_size == 0 || _index.find( k ) != _index.end() )
+      return key;
+   _entries.emplace_front( k, key );
+   _index.emplace( k, _entries.begin() );
+   shrink_to( _max_size );
+   return key;
+}
+
+void signature_key_cache::set_max_size( size_t max_size )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _max_size = max_size;
+   shrink_to( _max_size );
+}
+
+size_t signature_key_cache::get_max_size()const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   return _max_size;
+}
+
+size_t signature_key_cache::size()const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   return _entries.size();
+}
+
+void signature_key_cache::clear()
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _index.clear();
+   _entries.clear();
+}
+
+void signature_key_cache::shrink_to( size_t max_size )
+{
+   while( _entries.size() > max_size )
+   {
+      _index.erase( _entries.back().first );
+      _entries.pop_back();
+   }
+}
+
+} } // graphene::chain
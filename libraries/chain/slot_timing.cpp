@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/slot_timing.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace chain {
+
+namespace {
+
+   slot_timing_histogram make_histogram( const std::deque<int64_t>& samples )
+   {
+      slot_timing_histogram result;
+      result.bounds_ms = { 0, 100, 250, 500, 1000, 1500, 2000, 3000, 5000 };
+      result.counts.resize( result.bounds_ms.size() + 1 );
+      result.count = samples.size();
+      if( samples.empty() )
+         return result;
+      for( int64_t ms : samples )
+         ++result.counts[ std::lower_bound( result.bounds_ms.begin(), result.bounds_ms.end(), ms ) - result.bounds_ms.begin() ];
+      vector<int64_t> sorted( samples.begin(), samples.end() );
+      std::sort( sorted.begin(), sorted.end() );
+      result.min_ms = sorted.front();
+      result.median_ms = sorted[ sorted.size() / 2 ];
+      result.p90_ms = sorted[ sorted.size() * 9 / 10 ];
+      result.max_ms = sorted.back();
+      return result;
+   }
+
+}
+
+void slot_timing_tracker::record( std::deque<int64_t> witness_samples::* samples, account_uid_type witness,
+                                  uint32_t block_num, fc::time_point_sec slot_time, fc::time_point time )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( _blocks_kept == 0 )
+      return;
+   witness_samples& w = _witnesses[witness];
+   w.last_block_num = std::max( w.last_block_num, block_num );
+   std::deque<int64_t>& kept = w.*samples;
+   if( kept.size() >= _blocks_kept )
+      kept.pop_front();
+   kept.push_back( ( time - fc::time_point( slot_time ) ).count() / 1000 );
+}
+
+void slot_timing_tracker::record_signed( account_uid_type witness, uint32_t block_num, fc::time_point_sec slot_time,
+                                         fc::time_point signed_time )
+{
+   record( &witness_samples::signed_ms, witness, block_num, slot_time, signed_time );
+}
+
+void slot_timing_tracker::record_received( account_uid_type witness, uint32_t block_num, fc::time_point_sec slot_time,
+                                           fc::time_point received_time )
+{
+   record( &witness_samples::received_ms, witness, block_num, slot_time, received_time );
+}
+
+vector<witness_slot_timing> slot_timing_tracker::get_timings()const
+{
+   vector<witness_slot_timing> result;
+   std::lock_guard<std::mutex> lock( _mutex );
+   result.reserve( _witnesses.size() );
+   for( const auto& w : _witnesses )
+   {
+      witness_slot_timing timing;
+      timing.witness = w.first;
+      timing.last_block_num = w.second.last_block_num;
+      timing.signed_after_slot = make_histogram( w.second.signed_ms );
+      timing.received_after_slot = make_histogram( w.second.received_ms );
+      result.push_back( std::move( timing ) );
+   }
+   return result;
+}
+
+void slot_timing_tracker::set_blocks_kept( size_t blocks_kept )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _blocks_kept = blocks_kept;
+   for( auto itr = _witnesses.begin(); itr != _witnesses.end(); )
+   {
+      while( itr->second.signed_ms.size() > _blocks_kept )
+         itr->second.signed_ms.pop_front();
+      while( itr->second.received_ms.size() > _blocks_kept )
+         itr->second.received_ms.pop_front();
+      if( itr->second.signed_ms.empty() && itr->second.received_ms.empty() )
+         itr = _witnesses.erase( itr );
+      else
+         ++itr;
+   }
+}
+
+size_t slot_timing_tracker::get_blocks_kept()const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   return _blocks_kept;
+}
+
+} } // graphene::chain
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/supply_totals.hpp>
+
+namespace graphene { namespace chain {
+
+// The old value of a modified object is taken out in about_to_modify() and the new one added in object_modified().
+
+void account_balance_totals_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const account_balance_object*>(&obj) ); // for debug only
+   const account_balance_object& b = static_cast<const account_balance_object&>(obj);
+   total_balances[b.asset_type] += b.balance;
+   if( b.balance != 0 )
+      ++holder_counts[b.asset_type];
+}
+
+void account_balance_totals_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const account_balance_object*>(&obj) ); // for debug only
+   const account_balance_object& b = static_cast<const account_balance_object&>(obj);
+   total_balances[b.asset_type] -= b.balance;
+   if( b.balance != 0 )
+   {
+      auto itr = holder_counts.find( b.asset_type );
+      assert( itr != holder_counts.end() && itr->second > 0 );
+      if( --itr->second == 0 )
+         holder_counts.erase( itr );
+   }
+}
+
+void account_balance_totals_index::about_to_modify( const object& before )
+{
+   object_removed( before );
+}
+
+void account_balance_totals_index::object_modified( const object& after )
+{
+   object_inserted( after );
+}
+
+void account_statistics_totals_index::add( const _account_statistics_object& s, int64_t sign )
+{
+   share_type core_market_fees;
+   for( const auto& p : s.uncollected_market_fees )
+   {
+      total_uncollected_market_fees[p.first] += p.second * sign;
+      if( p.first == GRAPHENE_CORE_ASSET_AID )
+         core_market_fees = p.second;
+   }
+   total_core_balance     += s.core_balance * sign;
+   total_core_non_balance += ( s.prepaid + s.uncollected_witness_pay + s.uncollected_pledge_bonus
+                               + s.uncollected_score_bonus + core_market_fees ) * sign;
+   total_core_leased_in   += s.core_leased_in * sign;
+   total_core_leased_out  += s.core_leased_out * sign;
+}
+
+void account_statistics_totals_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const _account_statistics_object*>(&obj) ); // for debug only
+   add( static_cast<const _account_statistics_object&>(obj), 1 );
+}
+
+void account_statistics_totals_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const _account_statistics_object*>(&obj) ); // for debug only
+   add( static_cast<const _account_statistics_object&>(obj), -1 );
+}
+
+void account_statistics_totals_index::about_to_modify( const object& before )
+{
+   object_removed( before );
+}
+
+void account_statistics_totals_index::object_modified( const object& after )
+{
+   object_inserted( after );
+}
+
+void pledge_balance_totals_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const pledge_balance_object*>(&obj) ); // for debug only
+   const pledge_balance_object& p = static_cast<const pledge_balance_object&>(obj);
+   total_pledges[p.type] += p.pledge;
+}
+
+void pledge_balance_totals_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const pledge_balance_object*>(&obj) ); // for debug only
+   const pledge_balance_object& p = static_cast<const pledge_balance_object&>(obj);
+   total_pledges[p.type] -= p.pledge;
+}
+
+void pledge_balance_totals_index::about_to_modify( const object& before )
+{
+   object_removed( before );
+}
+
+void pledge_balance_totals_index::object_modified( const object& after )
+{
+   object_inserted( after );
+}
+
+void limit_order_totals_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const limit_order_object*>(&obj) ); // for debug only
+   const limit_order_object& o = static_cast<const limit_order_object&>(obj);
+   total_for_sale[o.sell_asset_id()] += o.for_sale;
+}
+
+void limit_order_totals_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const limit_order_object*>(&obj) ); // for debug only
+   const limit_order_object& o = static_cast<const limit_order_object&>(obj);
+   total_for_sale[o.sell_asset_id()] -= o.for_sale;
+}
+
+void limit_order_totals_index::about_to_modify( const object& before )
+{
+   object_removed( before );
+}
+
+void limit_order_totals_index::object_modified( const object& after )
+{
+   object_inserted( after );
+}
+
+} } // graphene::chain
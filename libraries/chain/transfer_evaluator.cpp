@@ -41,7 +41,7 @@ void_result transfer_evaluator::do_evaluate( const transfer_operation& op )
    validate_authorized_asset(d, *from_account, transfer_asset_object, "'from' ");
    validate_authorized_asset(d, *to_account, transfer_asset_object, "'to' ");
 
-   account_uid_type sign_account = sigs.real_secondary_uid(op.from, 1);
+   account_uid_type sign_account = sigs->real_secondary_uid(op.from, 1);
    if (!op.some_from_balance())
    {
       if (sign_account != op.from)
@@ -124,9 +124,13 @@ void_result transfer_evaluator::do_evaluate( const transfer_operation& op )
             asset_to_balance.amount = 0;
       }
 
+      // the balance objects are found once for all the transfers of the transaction
+      if (asset_to_balance.amount > 0)
+         to_balance_obj = trx_state->find_balance(to_account->uid, op.amount.asset_id);
       if (asset_from_balance.amount > 0)
       {
-         const auto& from_balance = d.get_balance(*from_account, transfer_asset_object);
+         from_balance_obj = trx_state->find_balance(from_account->uid, op.amount.asset_id);
+         const asset from_balance = from_balance_obj ? from_balance_obj->get_balance() : asset(0, op.amount.asset_id);
          bool sufficient_balance = (from_balance.amount >= asset_from_balance.amount);
          FC_ASSERT(sufficient_balance,
             "Insufficient Balance: ${balance}, unable to transfer '${a}' from account '${f}' to '${t}'.",
@@ -144,7 +148,12 @@ void_result transfer_evaluator::do_apply( const transfer_operation& o )
 { try {
    database& d = db();
    if (asset_from_balance.amount > 0)
-      d.adjust_balance(*from_account, -asset_from_balance);
+   {
+      if (from_balance_obj)
+         d.adjust_balance(*from_balance_obj, -asset_from_balance);
+      else
+         d.adjust_balance(*from_account, -asset_from_balance);
+   }
    if (asset_from_prepaid.amount > 0){
       d.modify(*from_account_stats, [&](_account_statistics_object& s)
       {
@@ -160,7 +169,12 @@ void_result transfer_evaluator::do_apply( const transfer_operation& o )
       }
    }
    if (asset_to_balance.amount > 0)
-      d.adjust_balance(*to_account, asset_to_balance);
+   {
+      if (to_balance_obj)
+         d.adjust_balance(*to_balance_obj, asset_to_balance);
+      else
+         d.adjust_balance(*to_account, asset_to_balance);
+   }
    if (asset_to_prepaid.amount > 0)
       d.modify(*to_account_stats, [&](_account_statistics_object& s)
    {
@@ -52,6 +52,13 @@ namespace graphene { namespace db {
          }
 
          virtual void modify( const object& obj, const std::function<void(object&)>& modify_callback ) override
+         {
+            modify_object( static_cast<const T&>(obj), modify_callback );
+         }
+
+         /// modify() without type erasure of the callback, see primary_index_of
+         template<typename Lambda>
+         void modify_object( const T& obj, const Lambda& modify_callback )
          {
             assert( obj.id.instance() < _objects.size() );
             modify_callback( _objects[obj.id.instance()] );
@@ -66,6 +73,8 @@ namespace graphene { namespace db {
             return _objects[instance];
          }
 
+         virtual const object& insert_loaded( object&& obj )override { return flat_index::insert( std::move( obj ) ); }
+
          virtual void remove( const object& obj ) override
          {
             assert( nullptr != dynamic_cast<const T*>(&obj) );
@@ -118,6 +127,14 @@ namespace graphene { namespace db {
          const_iterator end()const   { return const_iterator(_objects.end());   }
 
          size_t size()const{ return _objects.size(); }
+         /// the object of @p instance without the type erasure of find(), @p instance must be below size()
+         const T& at( uint64_t instance )const
+         {
+            assert( instance < _objects.size() );
+            return _objects[instance];
+         }
+         /// the capacity of the vector beyond its size
+         size_t container_bytes()const { return ( _objects.capacity() - _objects.size() ) * sizeof(T); }
 
          void resize( uint32_t s ) { 
             _objects.resize(s); 
@@ -27,6 +27,9 @@
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
+#include <boost/mpl/size.hpp>
+
+#include <deque>
 
 namespace graphene { namespace chain {
 
@@ -38,6 +41,10 @@ namespace graphene { namespace chain {
     *  Almost all objects can be tracked and managed via a boost::multi_index container that uses
     *  an unordered_unique key on the object ID.  This template class adapts the generic index interface
     *  to work with arbitrary boost multi_index containers on the same type.
+    *
+    *  Besides the container, the index keeps a pointer to each object by instance number, so find() by id is a
+    *  lookup in an array instead of a descent of the by_id tree. The array spans the instances from the lowest to
+    *  the highest one in the index, removed objects leave a null pointer in between.
     */
    template<typename ObjectType, typename MultiIndexType>
    class generic_index : public index
@@ -51,9 +58,21 @@ namespace graphene { namespace chain {
             assert( nullptr != dynamic_cast<ObjectType*>(&obj) );
             auto insert_result = _indices.insert( std::move( static_cast<ObjectType&>(obj) ) );
             FC_ASSERT( insert_result.second, "Could not insert object, most likely a uniqueness constraint was violated" );
+            set_instance( *insert_result.first );
             return *insert_result.first;
          }
 
+         /// the first index of the container is by id, the loaded objects are appended to it without searching
+         virtual const object& insert_loaded( object&& obj )override
+         {
+            assert( nullptr != dynamic_cast<ObjectType*>(&obj) );
+            const size_t old_size = _indices.size();
+            auto itr = _indices.insert( _indices.end(), std::move( static_cast<ObjectType&>(obj) ) );
+            FC_ASSERT( _indices.size() > old_size, "Could not insert object, most likely a uniqueness constraint was violated" );
+            set_instance( *itr );
+            return *itr;
+         }
+
          virtual const object&  create(const std::function<void(object&)>& constructor )override
          {
             ObjectType item;
@@ -62,29 +81,55 @@ namespace graphene { namespace chain {
             auto insert_result = _indices.insert( std::move(item) );
             FC_ASSERT(insert_result.second, "Could not create object! Most likely a uniqueness constraint is violated.");
             use_next_id();
+            set_instance( *insert_result.first );
             return *insert_result.first;
          }
 
          virtual void modify( const object& obj, const std::function<void(object&)>& m )override
          {
             assert( nullptr != dynamic_cast<const ObjectType*>(&obj) );
-            auto ok = _indices.modify( _indices.iterator_to( static_cast<const ObjectType&>(obj) ),
-                                       [&m]( ObjectType& o ){ m(o); } );
+            modify_object( static_cast<const ObjectType&>(obj), m );
+         }
+
+         /// modify() without type erasure of m, see primary_index_of
+         template<typename Lambda>
+         void modify_object( const ObjectType& obj, const Lambda& m )
+         {
+            const uint64_t instance = obj.id.instance();
+            auto ok = _indices.modify( _indices.iterator_to( obj ), [&m]( ObjectType& o ){ m(o); } );
+            // the container erases an object it can't keep after the modification
+            if( !ok )
+               clear_instance( instance );
             FC_ASSERT( ok, "Could not modify object, most likely a index constraint was violated" );
          }
 
          virtual void remove( const object& obj )override
          {
+            const uint64_t instance = obj.id.instance();
             _indices.erase( _indices.iterator_to( static_cast<const ObjectType&>(obj) ) );
+            clear_instance( instance );
+         }
+
+         /// removes [first, last) of the index of the container tagged Tag with a single erase
+         template<typename Tag, typename Iterator>
+         void remove_range( Iterator first, Iterator last )
+         {
+            for( auto itr = first; itr != last; ++itr )
+               null_instance( itr->id.instance() );
+            _indices.template get<Tag>().erase( first, last );
+            trim_instances();
          }
 
          virtual const object* find( object_id_type id )const override
          {
             static_assert(std::is_same<typename MultiIndexType::key_type, object_id_type>::value,
                           "First index of MultiIndexType MUST be object_id_type!");
-            auto itr = _indices.find( id );
-            if( itr == _indices.end() ) return nullptr;
-            return &*itr;
+            if( id.space() != ObjectType::space_id || id.type() != ObjectType::type_id )
+               return nullptr;
+            const uint64_t instance = id.instance();
+            if( instance < _first_instance || instance - _first_instance >= _by_instance.size() )
+               return nullptr;
+            return _by_instance[ instance - _first_instance ];
          }
 
          virtual void inspect_all_objects(std::function<void (const object&)> inspector)const override
@@ -97,6 +142,13 @@ namespace graphene { namespace chain {
 
          const index_type& indices()const { return _indices; }
 
+         /// about three pointers per object for each index of the container, and the array of pointers by instance
+         size_t container_bytes()const
+         {
+            const size_t index_count = boost::mpl::size<typename index_type::index_type_list>::value;
+            return _indices.size() * index_count * 3 * sizeof(void*) + _by_instance.size() * sizeof(const ObjectType*);
+         }
+
          virtual fc::uint128 hash()const override {
             fc::uint128 result;
             for( const auto& ptr : _indices )
@@ -108,8 +160,51 @@ namespace graphene { namespace chain {
          }
 
       private:
+         void set_instance( const ObjectType& obj )
+         {
+            const uint64_t instance = obj.id.instance();
+            if( _by_instance.empty() )
+               _first_instance = instance;
+            else if( instance < _first_instance )
+            {
+               _by_instance.insert( _by_instance.begin(), _first_instance - instance, nullptr );
+               _first_instance = instance;
+            }
+            if( instance - _first_instance >= _by_instance.size() )
+               _by_instance.resize( instance - _first_instance + 1, nullptr );
+            _by_instance[ instance - _first_instance ] = &obj;
+         }
+
+         void clear_instance( uint64_t instance )
+         {
+            null_instance( instance );
+            trim_instances();
+         }
+
+         void null_instance( uint64_t instance )
+         {
+            if( instance < _first_instance || instance - _first_instance >= _by_instance.size() )
+               return;
+            _by_instance[ instance - _first_instance ] = nullptr;
+         }
+
+         void trim_instances()
+         {
+            // objects are mostly removed oldest first, or newest first when undoing, keep the ends trimmed
+            while( !_by_instance.empty() && _by_instance.front() == nullptr )
+            {
+               _by_instance.pop_front();
+               ++_first_instance;
+            }
+            while( !_by_instance.empty() && _by_instance.back() == nullptr )
+               _by_instance.pop_back();
+         }
+
          fc::uint128 _current_hash;
          index_type  _indices;
+         /// the object of instance _first_instance + i is at i, nullptr if there is none
+         std::deque<const ObjectType*> _by_instance;
+         uint64_t                      _first_instance = 0;
    };
 
    /**
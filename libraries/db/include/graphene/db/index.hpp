@@ -45,10 +45,32 @@ namespace graphene { namespace db {
          virtual void on_add( const object& obj ){}
          /** called just before obj is removed */
          virtual void on_remove( const object& obj ){}
+         /** called just before objs are removed at once, see primary_index::remove_range() */
+         virtual void on_remove_batch( const vector<const object*>& objs ) { for( const object* obj : objs ) on_remove( *obj ); }
          /** called just after obj is modified with new value*/
          virtual void on_modify( const object& obj ){}
    };
 
+   /**
+    *  @brief Approximate memory held by the objects of an index and its containers, not counting the secondary
+    *  indexes, see index::get_memory_stats()
+    */
+   struct index_memory_stats
+   {
+      uint8_t     space_id = 0;
+      uint8_t     type_id = 0;
+      std::string object_type;
+      uint64_t    object_count = 0;
+      /// sizeof the objects
+      uint64_t    object_bytes = 0;
+      /// packed size of the objects beyond the one of a default object, i.e. mostly what their strings and
+      /// containers hold, a lower bound of the heap those take
+      uint64_t    dynamic_bytes = 0;
+      /// nodes of the containers holding the objects and lookup arrays, or unused capacity of a vector
+      uint64_t    container_bytes = 0;
+      uint64_t    total_bytes = 0;
+   };
+
    /**
     *  @class index
     *  @brief abstract base class for accessing objects indexed in various ways.
@@ -77,12 +99,36 @@ namespace graphene { namespace db {
          virtual void           use_next_id() = 0;
          virtual void           set_next_id( object_id_type id ) = 0;
 
+         /**
+          * @return the undo states only keep the next id of this index, and roll back by removing the objects
+          *         created from it on, see @ref append_only_index
+          */
+         virtual bool           undo_appends_only()const { return false; }
+
          virtual const object&  load( const std::vector<char>& data ) = 0;
+         /**
+          *  Replaces the object with the given id by the serialized object in data, or removes it
+          *  if data is empty. Observers are not notified and no undo history is recorded, this is
+          *  only meant for replaying incremental snapshots while opening the database.
+          */
+         virtual void           load_delta( object_id_type id, const std::vector<char>& data ) = 0;
+         /**
+          *  Same as load_delta() but as a change of the database: the object is modified, created or removed
+          *  with undo history recorded and observers notified, see object_database::apply_packed_changes().
+          */
+         virtual void           apply_packed( object_id_type id, const std::vector<char>& data ) = 0;
+         /** Unpacks an object of this index packed by object::pack(), without adding it */
+         virtual std::unique_ptr<object> unpack_object( const std::vector<char>& data )const = 0;
          /**
           *  Polymorphically insert by moving an object into the index.
           *  this should throw if the object is already in the database.
           */
          virtual const object& insert( object&& obj ) = 0;
+         /**
+          *  Inserts an object read by open(). The objects of a file are in id order, an index may use that
+          *  to insert them faster.
+          */
+         virtual const object& insert_loaded( object&& obj ) = 0;
 
          /**
           * Builds a new object and assigns it the next available ID and then
@@ -127,6 +173,8 @@ namespace graphene { namespace db {
          }
 
          virtual void               inspect_all_objects(std::function<void(const object&)> inspector)const = 0;
+         /// Goes through all the objects, so it takes time linear in their number
+         virtual index_memory_stats get_memory_stats()const = 0;
          virtual fc::uint128        hash()const = 0;
          virtual void               add_observer( const shared_ptr<index_observer>& ) = 0;
 
@@ -161,9 +209,15 @@ namespace graphene { namespace db {
          /** called just before obj is removed */
          void on_remove( const object& obj );
 
+         /** called just before objs are removed at once */
+         void on_remove_batch( const vector<const object*>& objs );
+
          /** called just after obj is modified */
          void on_modify( const object& obj );
 
+         /** called just before the next id of the index is skipped without creating an object */
+         void on_use_next_id( object_id_type next_id );
+
          template<typename T>
          T* add_secondary_index()
          {
@@ -173,13 +227,22 @@ namespace graphene { namespace db {
 
          template<typename T>
          const T& get_secondary_index()const
+         {
+            const T* result = find_secondary_index<T>();
+            if( result != nullptr ) return *result;
+            FC_THROW_EXCEPTION( fc::assert_exception, "invalid index type" );
+         }
+
+         /// @return the secondary index of type T, null when none was added, e.g. an optional one
+         template<typename T>
+         const T* find_secondary_index()const
          {
             for( const auto& item : _sindex )
             {
                const T* result = dynamic_cast<const T*>(item.get());
-               if( result != nullptr ) return *result;
+               if( result != nullptr ) return result;
             }
-            FC_THROW_EXCEPTION( fc::assert_exception, "invalid index type" );
+            return nullptr;
          }
 
       protected:
@@ -223,6 +286,10 @@ namespace graphene { namespace db {
             return fc::sha256::hash(desc);
          }
 
+         /**
+          *  The objects of the file are stored as packed vectors: the size of the packed object followed by it.
+          *  They are unpacked straight from the mapped file and moved into the index.
+          */
          virtual void open( const path& db )override
          { 
             if( !fc::exists( db ) ) return;
@@ -235,28 +302,40 @@ namespace graphene { namespace db {
             fc::raw::unpack(ds, open_ver);
             FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
             try {
-               vector<char> tmp;
-               while( true ) 
+               while( ds.remaining() > 0 )
                {
-                  fc::raw::unpack( ds, tmp );
-                  load( tmp );
+                  fc::unsigned_int size;
+                  fc::raw::unpack( ds, size );
+                  FC_ASSERT( size.value <= ds.remaining(), "Truncated object in the index file" );
+                  fc::datastream<const char*> object_ds( ds.pos(), size.value );
+                  object_type obj;
+                  fc::raw::unpack( object_ds, obj );
+                  ds.skip( size.value );
+                  const auto& result = DerivedIndex::insert_loaded( std::move( obj ) );
+                  for( const auto& item : _sindex )
+                     item->object_inserted( result );
                }
             } catch ( const fc::exception&  ){}
          }
 
+         /// writes the objects in the format open() reads, packing each one straight to the file
          virtual void save( const path& db ) override 
          {
-            std::ofstream out( db.generic_string(), 
-                               std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+            std::vector<char> buffer( 1024 * 1024 );
+            std::ofstream out;
+            out.rdbuf()->pubsetbuf( buffer.data(), buffer.size() );
+            out.open( db.generic_string(), std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
             FC_ASSERT( out );
             auto ver  = get_object_version();
             fc::raw::pack( out, _next_id );
             fc::raw::pack( out, ver );
             this->inspect_all_objects( [&]( const object& o ) {
-                auto vec = fc::raw::pack( static_cast<const object_type&>(o) );
-                auto packed_vec = fc::raw::pack( vec );
-                out.write( packed_vec.data(), packed_vec.size() );
+                const object_type& obj = static_cast<const object_type&>(o);
+                fc::raw::pack( out, fc::unsigned_int( fc::raw::pack_size( obj ) ) );
+                fc::raw::pack( out, obj );
             });
+            out.close();
+            FC_ASSERT( !out.fail(), "Unable to write ${f}", ("f",db) );
          }
 
          virtual const object&  load( const std::vector<char>& data )override
@@ -268,6 +347,45 @@ namespace graphene { namespace db {
          }
 
 
+         virtual void load_delta( object_id_type id, const std::vector<char>& data )override
+         {
+            const object* existing = DerivedIndex::find( id );
+            if( existing != nullptr )
+            {
+               for( const auto& item : _sindex )
+                  item->object_removed( *existing );
+               DerivedIndex::remove( *existing );
+            }
+            if( !data.empty() )
+               load( data );
+         }
+
+         virtual std::unique_ptr<object> unpack_object( const std::vector<char>& data )const override
+         {
+            std::unique_ptr<object_type> obj( new object_type() );
+            fc::raw::unpack( data, *obj );
+            return std::move( obj );
+         }
+
+         virtual void apply_packed( object_id_type id, const std::vector<char>& data )override
+         {
+            const object* existing = DerivedIndex::find( id );
+            if( data.empty() )
+            {
+               if( existing != nullptr )
+                  remove( *existing );
+               return;
+            }
+            object_type obj = fc::raw::unpack<object_type>( data );
+            FC_ASSERT( obj.id == id, "Packed object ${o} doesn't have the id ${i}", ("o",obj.id)("i",id) );
+            // modified in place, so that an append-only index doesn't see a removal and a creation of the same id
+            if( existing != nullptr )
+               modify_object( static_cast<const object_type&>( *existing ),
+                              [&obj]( object_type& o ) { o = std::move( obj ); } );
+            else
+               insert( std::move( obj ) );
+         }
+
          virtual const object&  create(const std::function<void(object&)>& constructor )override
          {
             const auto& result = DerivedIndex::create( constructor );
@@ -294,12 +412,41 @@ namespace graphene { namespace db {
             DerivedIndex::remove(obj);
          }
 
+         /**
+          * Removes the objects in [first, last) of the index tagged Tag of the container, as remove() does for
+          * each of them, but with the undo state saved and the observers called once for all of them, and the
+          * range erased from the container at once.
+          * @return the number of objects removed
+          */
+         template<typename Tag, typename Iterator>
+         size_t remove_range( Iterator first, Iterator last )
+         {
+            vector<const object*> objs;
+            for( auto itr = first; itr != last; ++itr )
+               objs.push_back( &*itr );
+            if( objs.empty() )
+               return 0;
+            for( const object* obj : objs )
+               for( const auto& item : _sindex )
+                  item->object_removed( *obj );
+            on_remove_batch( objs );
+            DerivedIndex::template remove_range<Tag>( first, last );
+            return objs.size();
+         }
+
          virtual void modify( const object& obj, const std::function<void(object&)>& m )override
+         {
+            modify_object( static_cast<const object_type&>(obj), m );
+         }
+
+         /// modify() without type erasure of m, object_database::modify() calls it for the types of primary_index_of
+         template<typename Lambda>
+         void modify_object( const object_type& obj, const Lambda& m )
          {
             save_undo( obj );
             for( const auto& item : _sindex )
                item->about_to_modify( obj );
-            DerivedIndex::modify( obj, m );
+            DerivedIndex::modify_object( obj, m );
             for( const auto& item : _sindex )
                item->object_modified( obj );
             on_modify( obj );
@@ -328,8 +475,74 @@ namespace graphene { namespace db {
             obj.id = id;
          }
 
+         virtual index_memory_stats get_memory_stats()const override
+         {
+            index_memory_stats stats;
+            stats.space_id = object_type::space_id;
+            stats.type_id = object_type::type_id;
+            stats.object_type = fc::get_typename<object_type>::name();
+            const size_t default_size = fc::raw::pack_size( object_type() );
+            this->inspect_all_objects( [&]( const object& o ) {
+               ++stats.object_count;
+               const size_t size = fc::raw::pack_size( static_cast<const object_type&>(o) );
+               if( size > default_size )
+                  stats.dynamic_bytes += size - default_size;
+            });
+            stats.object_bytes = stats.object_count * sizeof( object_type );
+            stats.container_bytes = DerivedIndex::container_bytes();
+            stats.total_bytes = stats.object_bytes + stats.dynamic_bytes + stats.container_bytes;
+            return stats;
+         }
+
       private:
          object_id_type _next_id;
    };
 
+   /**
+    * @class append_only_index
+    * @brief A primary index for objects outside of consensus that are mostly appended, such as histories
+    *
+    * Undo states don't keep the ids of the objects created in this index, only the next id it had before the
+    * first one was created or skipped. Undoing removes every object from that id on and resets the next id.
+    * Objects created before are still tracked as usual when modified or removed.
+    */
+   template<typename DerivedIndex>
+   class append_only_index : public primary_index<DerivedIndex>
+   {
+      public:
+         append_only_index( object_database& db ):primary_index<DerivedIndex>(db){}
+
+         virtual bool undo_appends_only()const override { return true; }
+
+         /** skipped ids are given back on undo like the ones used by new objects */
+         virtual void use_next_id()override
+         {
+            this->on_use_next_id( this->get_next_id() );
+            primary_index<DerivedIndex>::use_next_id();
+         }
+   };
+
+   /**
+    * The index type the objects of type T are added with, if declared with GRAPHENE_DB_PRIMARY_INDEX.
+    * object_database::modify() of these objects casts the index to it and calls its modify_object() with the lambda,
+    * which can be inlined, instead of calling the virtual modify() with a std::function wrapping it.
+    */
+   template<typename T>
+   struct primary_index_of
+   {
+      typedef void type;
+   };
+
 } } // graphene::db
+
+/**
+ * Declares INDEX, the type given to add_index(), as the index of OBJECT objects, see primary_index_of.
+ * Must be used at global scope.
+ */
+#define GRAPHENE_DB_PRIMARY_INDEX( OBJECT, INDEX ) \
+   namespace graphene { namespace db { \
+      template<> struct primary_index_of< OBJECT > { typedef INDEX type; }; \
+   } }
+
+FC_REFLECT( graphene::db::index_memory_stats,
+            (space_id)(type_id)(object_type)(object_count)(object_bytes)(dynamic_bytes)(container_bytes)(total_bytes) )
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace graphene { namespace db {
+
+   /**
+    * @class node_pool
+    * @brief slab allocator for the nodes of the containers of one index
+    *
+    * Nodes of each size are carved out of chunks holding only nodes of that size, and the nodes freed are kept on
+    * a free list of their size for the next ones. The nodes of an index end up packed together instead of being
+    * scattered over the heap among everything else allocated meanwhile, which helps the passes going through the
+    * index, and the heap doesn't get fragmented by nodes coming and going. The chunks are only released when the
+    * pool goes away, along with the index.
+    *
+    * Like the index it belongs to, a pool is used by one thread at a time.
+    */
+   class node_pool
+   {
+      public:
+         static const size_t chunk_size      = 64 * 1024;
+         static const size_t huge_chunk_size = 2 * 1024 * 1024;
+         /// nodes bigger than this are not worth the wasted chunk space and go to the heap instead
+         static const size_t max_node_size   = chunk_size / 4;
+
+         node_pool() = default;
+         ~node_pool();
+
+         node_pool( const node_pool& ) = delete;
+         node_pool& operator = ( const node_pool& ) = delete;
+
+         void* allocate( size_t size );
+         /// @p size must be the one @p p was allocated with
+         void  deallocate( void* p, size_t size );
+
+         /// bytes of the chunks held, used or not
+         uint64_t reserved_bytes()const { return _reserved_bytes; }
+
+         /**
+          * Makes the pools take chunks of huge_chunk_size from now on, aligned on it and advised to be backed by
+          * huge pages where the system supports it, e.g. transparent huge pages on Linux
+          */
+         static void set_use_huge_pages( bool enable ) { _use_huge_pages = enable; }
+         static bool use_huge_pages() { return _use_huge_pages; }
+
+      private:
+         static const size_t alignment = alignof(std::max_align_t);
+
+         struct free_node
+         {
+            free_node* next;
+         };
+         /// the nodes of one size, rounded up to alignment
+         struct size_class
+         {
+            free_node* free_list = nullptr;
+            /// the part of the last chunk not handed out yet
+            char*      next = nullptr;
+            char*      end = nullptr;
+         };
+         struct chunk
+         {
+            void* data;
+            bool  huge;
+         };
+
+         void new_chunk( size_class& sc );
+
+         /// by size / alignment
+         std::vector<size_class> _classes;
+         std::vector<chunk>      _chunks;
+         uint64_t                _reserved_bytes = 0;
+
+         static std::atomic<bool> _use_huge_pages;
+   };
+
+   /**
+    * @brief Allocator of the nodes of a container from a node_pool
+    *
+    * A default constructed allocator creates its own pool, which is shared by its copies and by the allocators it
+    * is rebound to for other types. Giving it as the allocator of the multi_index_container of a generic_index
+    * thus gives each index its own pool, e.g.
+    *
+    *    typedef multi_index_container< post_object, indexed_by< ... >, node_pool_allocator<post_object> >
+    *
+    * Only single nodes come from the pool, arrays such as the buckets of hashed indexes come from the heap.
+    */
+   template<typename T>
+   class node_pool_allocator
+   {
+      public:
+         typedef T              value_type;
+         typedef T*             pointer;
+         typedef const T*       const_pointer;
+         typedef T&             reference;
+         typedef const T&       const_reference;
+         typedef std::size_t    size_type;
+         typedef std::ptrdiff_t difference_type;
+
+         template<typename U>
+         struct rebind { typedef node_pool_allocator<U> other; };
+
+         node_pool_allocator():_pool( std::make_shared<node_pool>() ){}
+         template<typename U>
+         node_pool_allocator( const node_pool_allocator<U>& other ):_pool( other.pool() ){}
+
+         T* allocate( size_type n, const void* = nullptr )
+         {
+            if( n == 1 )
+               return static_cast<T*>( _pool->allocate( sizeof(T) ) );
+            return static_cast<T*>( ::operator new( n * sizeof(T) ) );
+         }
+
+         void deallocate( T* p, size_type n )
+         {
+            if( n == 1 )
+               _pool->deallocate( p, sizeof(T) );
+            else
+               ::operator delete( p );
+         }
+
+         template<typename U, typename... Args>
+         void construct( U* p, Args&&... args ) { ::new( (void*)p ) U( std::forward<Args>(args)... ); }
+         template<typename U>
+         void destroy( U* p ) { p->~U(); }
+
+         pointer       address( reference x )const { return std::addressof( x ); }
+         const_pointer address( const_reference x )const { return std::addressof( x ); }
+         size_type     max_size()const { return size_type(-1) / sizeof(T); }
+
+         const std::shared_ptr<node_pool>& pool()const { return _pool; }
+
+      private:
+         std::shared_ptr<node_pool> _pool;
+   };
+
+   template<typename T, typename U>
+   bool operator == ( const node_pool_allocator<T>& a, const node_pool_allocator<U>& b ) { return a.pool() == b.pool(); }
+   template<typename T, typename U>
+   bool operator != ( const node_pool_allocator<T>& a, const node_pool_allocator<U>& b ) { return a.pool() != b.pool(); }
+
+} } // graphene::db
@@ -27,6 +27,8 @@
 #include <fc/crypto/city.hpp>
 #include <fc/uint128.hpp>
 
+#include <new>
+
 #define MAX_NESTING (200)
 
 namespace graphene { namespace db {
@@ -74,6 +76,10 @@ namespace graphene { namespace db {
 
          /// these methods are implemented for derived classes by inheriting abstract_object<DerivedClass>
          virtual unique_ptr<object> clone()const = 0;
+         /// number of bytes clone_to() needs
+         virtual size_t             clone_size()const = 0;
+         /// copy constructs this object in place into @p buffer, which the caller owns
+         virtual object*            clone_to( void* buffer )const = 0;
          virtual void               move_from( object& obj ) = 0;
          virtual variant            to_variant()const  = 0;
          virtual vector<char>       pack()const = 0;
@@ -95,6 +101,11 @@ namespace graphene { namespace db {
          {
             return unique_ptr<object>(new DerivedClass( *static_cast<const DerivedClass*>(this) ));
          }
+         virtual size_t clone_size()const { return sizeof(DerivedClass); }
+         virtual object* clone_to( void* buffer )const
+         {
+            return new (buffer) DerivedClass( *static_cast<const DerivedClass*>(this) );
+         }
 
          virtual void    move_from( object& obj )
          {
@@ -29,6 +29,10 @@
 #include <fc/log/logger.hpp>
 
 #include <map>
+#include <type_traits>
+#include <unordered_set>
+
+namespace graphene { namespace utilities { class thread_pool; } }
 
 namespace graphene { namespace db {
 
@@ -42,15 +46,61 @@ namespace graphene { namespace db {
          object_database();
          ~object_database();
 
-         void reset_indexes() { _index.clear(); _index.resize(255); }
+         void reset_indexes() { _index.clear(); _index.resize(255); _index_by_key.clear(); }
 
-         void open(const fc::path& data_dir );
+         /**
+          * Loads all registered indexes from data_dir. If a thread pool is given, the index files are
+          * unpacked concurrently on its threads, each index being loaded by a single thread.
+          */
+         void open( const fc::path& data_dir, graphene::utilities::thread_pool* pool = nullptr );
 
          /**
           * Saves the complete state of the object_database to disk, this could take a while
           */
          void flush();
+
+         /**
+          * Saves only the objects that were created, modified or removed since the last flush, as a delta
+          * file on top of the last full snapshot; open() replays the deltas in order. Falls back to a full
+          * flush() when there is no snapshot yet, when incremental flushing is disabled, or when the
+          * configured maximum number of deltas is reached, which compacts them into a new snapshot.
+          */
+         void flush_incremental();
+
+         /**
+          * Enables tracking of changed objects so that flush_incremental() can be used.
+          * @param max_deltas number of delta files to keep before compacting them into a full snapshot
+          */
+         void set_incremental_flush( bool enable, uint32_t max_deltas = 16 );
+         bool incremental_flush_enabled()const { return _track_changes; }
+
+         /// Number of objects created, modified and removed through the indexes since the database was constructed
+         struct change_counts
+         {
+            uint64_t created = 0;
+            uint64_t modified = 0;
+            uint64_t removed = 0;
+         };
+         const change_counts& get_change_counts()const { return _change_counts; }
+
+         /// Time the last open() took to load the file of an index
+         struct index_load_time
+         {
+            uint8_t  space_id = 0;
+            uint8_t  type_id = 0;
+            uint64_t file_size = 0;
+            int64_t  microseconds = 0;
+         };
+         /// @return the load times of the indexes by the last open(), slowest first
+         const vector<index_load_time>& get_index_load_times()const { return _index_load_times; }
+
+         /// @return the approximate memory of each registered index, the biggest first, see index::get_memory_stats()
+         vector<index_memory_stats> get_index_memory_stats()const;
+
          void wipe(const fc::path& data_dir); // remove from disk
+
+         /// @return the space and type ids of the registered indexes
+         vector< std::pair<uint8_t,uint8_t> > registered_indexes()const;
          void close();
 
          template<typename T, typename F>
@@ -73,7 +123,7 @@ namespace graphene { namespace db {
          }
          template<typename T>
          const index&  get_index()const { return get_index(T::space_id,T::type_id); }
-         const index&  get_index(uint8_t space_id, uint8_t type_id)const;
+         const index&  get_index(uint8_t space_id, uint8_t type_id)const { return registered_index(space_id,type_id); }
          const index&  get_index(object_id_type id)const { return get_index(id.space(),id.type()); }
          /// @}
 
@@ -86,11 +136,43 @@ namespace graphene { namespace db {
 
          const object& insert( object&& obj ) { return get_mutable_index(obj.id).insert( std::move(obj) ); }
          void          remove( const object& obj ) { get_mutable_index(obj.id).remove( obj ); }
+         /**
+          * Removes the objects in [first, last) of the index tagged Tag of IndexType, e.g. the expired ones of an
+          * index by expiration. Same as remove() of each of them, but the undo state is looked up once, the
+          * observers are called once with all of them and the container erases the range at once.
+          * @return the number of objects removed
+          */
+         template<typename IndexType, typename Tag, typename Iterator>
+         size_t remove_range( Iterator first, Iterator last ) {
+            return get_mutable_index_type< primary_index<IndexType> >().template remove_range<Tag>( first, last );
+         }
          template<typename T, typename Lambda>
          void modify( const T& obj, const Lambda& m ) {
-            get_mutable_index(obj.id).modify(obj,m);
+            modify_in_index( obj, m, std::is_void< typename primary_index_of<T>::type >() );
+         }
+         /**
+          * Same as modify(), for modifications that only change the fields captured by Fields, see
+          * field_undo_delta. Only those fields are saved for undo instead of a copy of the whole object, which
+          * is worth it for big objects that are modified often in the same few fields.
+          *
+          * @note m must not change anything that Fields doesn't restore, or undoing it leaves the change in place.
+          */
+         template<typename Fields, typename T, typename Lambda>
+         void modify_fields( const T& obj, const Lambda& m ) {
+            typedef field_undo_delta<T, Fields> delta_type;
+            _undo_db.on_modify_fields( obj, typeid(delta_type), [&obj]() -> undo_delta_ptr {
+               return undo_delta_ptr( new delta_type( obj ) );
+            } );
+            modify_in_index( obj, m, std::is_void< typename primary_index_of<T>::type >() );
          }
 
+         /**
+          * Applies the objects of an index changed elsewhere, e.g. by the same block on another node: each entry
+          * is the packed value of an object, which replaces or creates it, or empty to remove it. The next id of
+          * the index is then set to @p next_id. The changes are recorded in the undo history like any other.
+          */
+         void apply_packed_changes( object_id_type next_id,
+                                    const vector< std::pair<object_id_type, vector<char>> >& objects );
          ///@}
 
          template<typename T>
@@ -136,6 +218,10 @@ namespace graphene { namespace db {
             assert(!_index[ObjectType::space_id][ObjectType::type_id]);
             unique_ptr<index> indexptr( new IndexType(*this) );
             _index[ObjectType::space_id][ObjectType::type_id] = std::move(indexptr);
+            const size_t key = index_key( ObjectType::space_id, ObjectType::type_id );
+            if( _index_by_key.size() <= key )
+               _index_by_key.resize( ( size_t(ObjectType::space_id) + 1 ) << 8, nullptr );
+            _index_by_key[key] = _index[ObjectType::space_id][ObjectType::type_id].get();
             return static_cast<IndexType*>(_index[ObjectType::space_id][ObjectType::type_id].get());
          }
 
@@ -152,6 +238,19 @@ namespace graphene { namespace db {
          /** public for testing purposes only... should be private in practice. */
          undo_database                          _undo_db;
      protected:
+         /// the index of T isn't known at compile time, goes through the virtual modify()
+         template<typename T, typename Lambda>
+         void modify_in_index( const T& obj, const Lambda& m, std::true_type ) {
+            get_mutable_index(obj.id).modify(obj,m);
+         }
+         template<typename T, typename Lambda>
+         void modify_in_index( const T& obj, const Lambda& m, std::false_type ) {
+            typedef typename primary_index_of<T>::type index_type;
+            index& idx = get_mutable_index(obj.id);
+            assert( nullptr != dynamic_cast<index_type*>(&idx) );
+            static_cast<index_type&>(idx).modify_object( obj, m );
+         }
+
          template<typename IndexType>
          IndexType&    get_mutable_index_type() {
             static_assert( std::is_base_of<index,IndexType>::value, "Type must be an index type" );
@@ -160,18 +259,45 @@ namespace graphene { namespace db {
          template<typename T>
          index& get_mutable_index()                   { return get_mutable_index(T::space_id,T::type_id); }
          index& get_mutable_index(object_id_type id)  { return get_mutable_index(id.space(),id.type());   }
-         index& get_mutable_index(uint8_t space_id, uint8_t type_id);
+         index& get_mutable_index(uint8_t space_id, uint8_t type_id) { return registered_index(space_id,type_id); }
 
      private:
+         static size_t index_key( uint8_t space_id, uint8_t type_id ) { return ( size_t(space_id) << 8 ) | type_id; }
+         /**
+          * The index lookup of all the get_index() variants. The typed ones pass constant ids, so it's a bounds check
+          * and a load from a constant offset of _index_by_key.
+          */
+         index& registered_index( uint8_t space_id, uint8_t type_id )const
+         {
+            const size_t key = index_key( space_id, type_id );
+            if( key < _index_by_key.size() && _index_by_key[key] != nullptr )
+               return *_index_by_key[key];
+            throw_missing_index( space_id, type_id );
+         }
+         [[noreturn]] void throw_missing_index( uint8_t space_id, uint8_t type_id )const;
 
          friend class base_primary_index;
          friend class undo_database;
          void save_undo( const object& obj );
          void save_undo_add( const object& obj );
          void save_undo_remove( const object& obj );
+         void save_undo_remove_batch( const vector<const object*>& objs );
+         void save_undo_next_id( object_id_type next_id );
+
+         fc::path delta_dir()const;
+         void     load_deltas();
 
          fc::path                                                  _data_dir;
          vector< vector< unique_ptr<index> > >                     _index;
+         /// the registered indexes of _index by index_key(), nullptr for the ids without one
+         vector< index* >                                          _index_by_key;
+
+         bool                                                      _track_changes = false;
+         uint32_t                                                  _max_deltas = 16;
+         uint32_t                                                  _delta_count = 0;
+         std::unordered_set<object_id_type>                        _changed_ids;
+         change_counts                                             _change_counts;
+         vector<index_load_time>                                   _index_load_times;
    };
 
 } } // graphene::db
@@ -54,6 +54,13 @@ namespace graphene { namespace db {
          }
 
          virtual void modify( const object& obj, const std::function<void(object&)>& modify_callback ) override
+         {
+            modify_object( static_cast<const T&>(obj), modify_callback );
+         }
+
+         /// modify() without type erasure of the callback, see primary_index_of
+         template<typename Lambda>
+         void modify_object( const T& obj, const Lambda& modify_callback )
          {
             assert( obj.id.instance() < _objects.size() );
             modify_callback( *_objects[obj.id.instance()] );
@@ -69,6 +76,8 @@ namespace graphene { namespace db {
             return *_objects[instance];
          }
 
+         virtual const object& insert_loaded( object&& obj )override { return simple_index::insert( std::move( obj ) ); }
+
          virtual void remove( const object& obj ) override
          {
             assert( nullptr != dynamic_cast<const T*>(&obj) );
@@ -142,6 +151,8 @@ namespace graphene { namespace db {
          const_iterator end()const   { return const_iterator(_objects, _objects.end());   }
 
          size_t size()const { return _objects.size(); }
+         /// the vector of pointers to the objects
+         size_t container_bytes()const { return _objects.capacity() * sizeof(unique_ptr<object>); }
       private:
          vector< unique_ptr<object> > _objects;
    };
@@ -24,7 +24,12 @@
 #pragma once
 #include <graphene/db/object.hpp>
 #include <deque>
+#include <functional>
+#include <memory>
+#include <typeinfo>
+#include <vector>
 #include <fc/exception/exception.hpp>
+#include <fc/optional.hpp>
 
 namespace graphene { namespace db {
 
@@ -32,12 +37,123 @@ namespace graphene { namespace db {
    using fc::flat_set;
    class object_database;
 
+   /**
+    * @class undo_arena
+    * @brief bump allocator for the object copies held by one undo_state
+    *
+    * Copies are carved out of fixed size chunks which are only released all at once, when the undo state
+    * goes away. Released chunks are handed back to the free list of the owning undo_database so that the
+    * next sessions can reuse them instead of going back to the heap.
+    */
+   class undo_arena
+   {
+      public:
+         typedef std::vector< std::unique_ptr<char[]> > chunk_list;
+
+         static const size_t chunk_size      = 64 * 1024;
+         /// requests bigger than this are not worth the wasted chunk space and go to the heap instead
+         static const size_t max_object_size = chunk_size / 4;
+         static const size_t max_free_chunks = 64;
+
+         explicit undo_arena( chunk_list* free_chunks = nullptr ):_free_chunks(free_chunks){}
+         ~undo_arena() { release(); }
+
+         undo_arena( const undo_arena& ) = delete;
+         undo_arena& operator = ( const undo_arena& ) = delete;
+
+         /** @return a suitably aligned buffer of @p size bytes, or nullptr if the caller should use the heap */
+         void* allocate( size_t size );
+         /** takes over the chunks of @p other, e.g. when two undo states are merged */
+         void  absorb( undo_arena& other );
+         /** gives back all chunks, objects allocated from them must already be destroyed */
+         void  release();
+
+      private:
+         chunk_list   _chunks;
+         size_t       _used = chunk_size;
+         chunk_list*  _free_chunks;
+   };
+
+   /** destroys an undo copy, only freeing the memory if it was not carved out of an undo_arena */
+   struct undo_object_deleter
+   {
+      explicit undo_object_deleter( bool from_arena = false ):in_arena(from_arena){}
+      void operator()( object* obj )const
+      {
+         if( in_arena )
+            obj->~object();
+         else
+            delete obj;
+      }
+      bool in_arena;
+   };
+   typedef std::unique_ptr< object, undo_object_deleter > undo_object_ptr;
+
+   /**
+    * @class undo_delta
+    * @brief the previous value of some of the fields of an object, to undo a modification that only changed those
+    *
+    * Two deltas of the same type capture the same fields, see object_database::modify_fields().
+    */
+   class undo_delta
+   {
+      public:
+         virtual ~undo_delta(){}
+         /** writes the captured fields back into @p obj */
+         virtual void restore( object& obj )const = 0;
+         /** @return the memory held by the delta */
+         virtual size_t size()const = 0;
+   };
+   typedef std::unique_ptr< undo_delta > undo_delta_ptr;
+
+   /**
+    * A delta of the fields of Object captured by Fields, which must be constructible from const Object& and
+    * have a restore( Object& )const method.
+    */
+   template<typename Object, typename Fields>
+   class field_undo_delta : public undo_delta
+   {
+      public:
+         explicit field_undo_delta( const Object& obj ):_fields( obj ){}
+         virtual void restore( object& obj )const override
+         {
+            assert( nullptr != dynamic_cast<Object*>( &obj ) );
+            _fields.restore( static_cast<Object&>( obj ) );
+         }
+         virtual size_t size()const override { return sizeof( *this ); }
+
+      private:
+         Fields _fields;
+   };
+
    struct undo_state
    {
-      unordered_map<object_id_type, unique_ptr<object> > old_values;
+      explicit undo_state( undo_arena::chunk_list* free_chunks = nullptr ):arena(free_chunks){}
+
+      /// declared first so that it outlives the copies stored in old_values and removed
+      undo_arena                                         arena;
+      unordered_map<object_id_type, undo_object_ptr>     old_values;
+      /// objects only modified through object_database::modify_fields(), an object is never in both maps
+      unordered_map<object_id_type, undo_delta_ptr>      old_deltas;
+      /// also the watermark of an append-only index, the objects of which from that id on are new in this state
       unordered_map<object_id_type, object_id_type>      old_index_next_ids;
+      /// objects created in this state, except those of append-only indexes
       std::unordered_set<object_id_type>                 new_ids;
-      unordered_map<object_id_type, unique_ptr<object> > removed;
+      unordered_map<object_id_type, undo_object_ptr>     removed;
+      /// estimate of the memory taken by the entries above, see undo_database::memory_usage()
+      size_t                                             bytes = 0;
+   };
+
+   /// number and memory of the states of an undo_database
+   struct undo_database_stats
+   {
+      uint32_t state_count      = 0;
+      uint32_t max_state_count  = 0;
+      uint64_t memory_bytes     = 0;
+      /// 0 for no limit
+      uint64_t memory_limit     = 0;
+      /// of memory_bytes, the part held by the latest state
+      uint64_t head_state_bytes = 0;
    };
 
 
@@ -100,6 +216,10 @@ namespace graphene { namespace db {
           * This should be called just after an object is created
           */
          void on_create( const object& obj );
+         /**
+          * This should be called just before the next id of an append-only index is skipped
+          */
+         void on_use_next_id( object_id_type next_id );
          /**
           * This should be called just before an object is modified
           *
@@ -108,6 +228,16 @@ namespace graphene { namespace db {
           * be removed if we undo.
           */
          void on_modify( const object& obj );
+         /**
+          * This should be called just before an object is modified in a way that only changes the fields captured
+          * by the deltas of type @p delta_type, made by @p make_delta
+          *
+          * Only the delta is stored if the object isn't in this undo state yet. If the object already has a delta
+          * of another type, both are turned into a full copy of the object. The on_modify() call of the
+          * modification that follows is then skipped.
+          */
+         void on_modify_fields( const object& obj, const std::type_info& delta_type,
+                                const std::function<undo_delta_ptr()>& make_delta );
          /**
           * This should be called just before an object is removed.
           *
@@ -117,6 +247,11 @@ namespace graphene { namespace db {
           * want to re-delete it if this state is undone.
           */
          void on_remove( const object& obj );
+         /**
+          * Same as on_remove() of each of @p objs in turn, for bulk removals: the undo state is looked up once and
+          * its map of removed objects grown once for all of them.
+          */
+         void on_remove_batch( const vector<const object*>& objs );
 
          /**
           *  Removes the last committed session,
@@ -132,16 +267,69 @@ namespace graphene { namespace db {
 
          const undo_state& head()const;
 
+         /**
+          *  @return an estimate of the memory held by all undo states: the copies of the objects, the deltas and
+          *  the map entries. Entries dropped while merging are still counted until the merged state goes away.
+          */
+         uint64_t memory_usage()const { return _memory_bytes; }
+         /**
+          *  The memory the undo states may use, 0 for no limit (the default). The limit isn't enforced here, as
+          *  dropping states would lose the ability to switch forks, see over_memory_limit().
+          */
+         void     set_memory_limit( uint64_t max_bytes ) { _memory_limit = max_bytes; }
+         uint64_t memory_limit()const { return _memory_limit; }
+         bool     over_memory_limit()const { return _memory_limit != 0 && _memory_bytes > _memory_limit; }
+         undo_database_stats get_stats()const;
+
+         /**
+          *  @return a copy of the object @p id as it was before the changes of the latest @p states undo states,
+          *  nullptr if it didn't exist then. The current object is copied and the values those states saved of
+          *  it are applied to the copy, the latest state first, so the state itself isn't changed.
+          */
+         unique_ptr<object> find_previous_version( object_id_type id, size_t states )const;
+
+         /** @return the ids of the objects created in @p state in append-only indexes, which aren't in new_ids */
+         vector<object_id_type> appended_ids( const undo_state& state )const;
+
       private:
          void undo();
          void merge();
          void commit();
 
+         /** @return the object was created in @p state */
+         bool                   is_new( const undo_state& state, object_id_type id )const;
+         /** removes the objects @p state created in append-only indexes */
+         void                   remove_appended( const undo_state& state );
+         /** saves the value of @p obj before its removal in @p state, see on_remove() */
+         void                   save_removed( undo_state& state, const object& obj );
+
+         static undo_object_ptr copy_object( undo_state& state, const object& obj );
+         /** @return a copy of @p obj with the fields of @p delta restored, i.e. its value before the delta was made */
+         static undo_object_ptr copy_object( undo_state& state, const object& obj, const undo_delta& delta );
+         /** @return the fields of the previous on_modify_fields() call were saved, and on_modify() is to skip them */
+         bool                   modify_saved( const object& obj );
+
+         /// the memory of one map entry, in addition to what it points to
+         static const size_t     entry_bytes = 64;
+         void                   add_bytes( undo_state& state, size_t bytes );
+         /// drops the latest or oldest state, keeping the memory usage up to date
+         void                   pop_back_state();
+         void                   pop_front_state();
+
          uint32_t                _active_sessions = 0;
          bool                    _disabled = true;
+         /// chunks released by popped undo states, must be declared before (destroyed after) _stack
+         undo_arena::chunk_list  _free_chunks;
          std::deque<undo_state>  _stack;
          object_database&        _db;
          size_t                  _max_size = 256;
+         uint64_t                _memory_bytes = 0;
+         uint64_t                _memory_limit = 0;
+         /// the object on_modify_fields() was last called for, until the following on_modify()
+         fc::optional<object_id_type> _fields_saved;
    };
 
 } } // graphene::db
+
+FC_REFLECT( graphene::db::undo_database_stats,
+            (state_count)(max_state_count)(memory_bytes)(memory_limit)(head_state_bytes) )
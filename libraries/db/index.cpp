@@ -38,6 +38,12 @@ namespace graphene { namespace db {
    void base_primary_index::on_remove( const object& obj )
    { _db.save_undo_remove( obj ); for( auto ob : _observers ) ob->on_remove( obj ); }
 
+   void base_primary_index::on_remove_batch( const vector<const object*>& objs )
+   { _db.save_undo_remove_batch( objs ); for( auto ob : _observers ) ob->on_remove_batch( objs ); }
+
    void base_primary_index::on_modify( const object& obj )
    {for( auto ob : _observers ) ob->on_modify(  obj ); }
+
+   void base_primary_index::on_use_next_id( object_id_type next_id )
+   { _db.save_undo_next_id( next_id ); }
 } } // graphene::chain
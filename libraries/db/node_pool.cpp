@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <graphene/db/node_pool.hpp>
+
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace graphene { namespace db {
+
+std::atomic<bool> node_pool::_use_huge_pages( false );
+
+node_pool::~node_pool()
+{
+   for( const auto& c : _chunks )
+   {
+      if( c.huge )
+         std::free( c.data );
+      else
+         ::operator delete( c.data );
+   }
+}
+
+void* node_pool::allocate( size_t size )
+{
+   if( size > max_node_size )
+      return ::operator new( size );
+   const size_t index = ( size + alignment - 1 ) / alignment;
+   if( index >= _classes.size() )
+      _classes.resize( index + 1 );
+   size_class& sc = _classes[index];
+   if( sc.free_list != nullptr )
+   {
+      free_node* node = sc.free_list;
+      sc.free_list = node->next;
+      return node;
+   }
+   const size_t rounded = index * alignment;
+   if( sc.next == nullptr || size_t( sc.end - sc.next ) < rounded )
+      new_chunk( sc );
+   void* result = sc.next;
+   sc.next += rounded;
+   return result;
+}
+
+void node_pool::deallocate( void* p, size_t size )
+{
+   if( size > max_node_size )
+   {
+      ::operator delete( p );
+      return;
+   }
+   size_class& sc = _classes[ ( size + alignment - 1 ) / alignment ];
+   free_node* node = static_cast<free_node*>( p );
+   node->next = sc.free_list;
+   sc.free_list = node;
+}
+
+void node_pool::new_chunk( size_class& sc )
+{
+   // what is left of the previous chunk of the class is wasted, it's less than one node
+   chunk c{ nullptr, false };
+   size_t size = chunk_size;
+#ifdef __linux__
+   if( _use_huge_pages )
+   {
+      void* data = nullptr;
+      if( posix_memalign( &data, huge_chunk_size, huge_chunk_size ) == 0 )
+      {
+#ifdef MADV_HUGEPAGE
+         madvise( data, huge_chunk_size, MADV_HUGEPAGE );
+#endif
+         c = chunk{ data, true };
+         size = huge_chunk_size;
+      }
+   }
+#endif
+   if( c.data == nullptr )
+      c.data = ::operator new( chunk_size );
+   _chunks.push_back( c );
+   _reserved_bytes += size;
+   sc.next = static_cast<char*>( c.data );
+   sc.end = sc.next + size;
+}
+
+} } // graphene::db
@@ -23,10 +23,16 @@
  */
 #include <graphene/db/object_database.hpp>
 
+#include <graphene/utilities/thread_pool.hpp>
+
 #include <fc/io/raw.hpp>
 #include <fc/container/flat.hpp>
 #include <fc/uint128.hpp>
 
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
 namespace graphene { namespace db {
 
 object_database::object_database()
@@ -51,21 +57,10 @@ const object& object_database::get_object( object_id_type id )const
    return get_index(id.space(),id.type()).get( id );
 }
 
-const index& object_database::get_index(uint8_t space_id, uint8_t type_id)const
-{
-   FC_ASSERT( _index.size() > space_id, "", ("space_id",space_id)("type_id",type_id)("index.size",_index.size()) );
-   FC_ASSERT( _index[space_id].size() > type_id, "", ("space_id",space_id)("type_id",type_id)("index[space_id].size",_index[space_id].size()) );
-   const auto& tmp = _index[space_id][type_id];
-   FC_ASSERT( tmp );
-   return *tmp;
-}
-index& object_database::get_mutable_index(uint8_t space_id, uint8_t type_id)
+void object_database::throw_missing_index( uint8_t space_id, uint8_t type_id )const
 {
-   FC_ASSERT( _index.size() > space_id, "", ("space_id",space_id)("type_id",type_id)("index.size",_index.size()) );
-   FC_ASSERT( _index[space_id].size() > type_id , "", ("space_id",space_id)("type_id",type_id)("index[space_id].size",_index[space_id].size()) );
-   const auto& idx = _index[space_id][type_id];
-   FC_ASSERT( idx, "", ("space",space_id)("type",type_id) );
-   return *idx;
+   FC_THROW_EXCEPTION( fc::assert_exception, "No index registered for space ${space} type ${type}",
+                       ("space",space_id)("type",type_id) );
 }
 
 void object_database::flush()
@@ -85,8 +80,108 @@ void object_database::flush()
       fc::rename( _data_dir / "object_database", _data_dir / "object_database.old" );
    fc::rename( _data_dir / "object_database.tmp", _data_dir / "object_database" );
    fc::remove_all( _data_dir / "object_database.old" );
+
+   // the new snapshot contains everything, old deltas went away with the old snapshot directory
+   _changed_ids.clear();
+   _delta_count = 0;
+}
+
+void object_database::set_incremental_flush( bool enable, uint32_t max_deltas )
+{
+   _track_changes = enable;
+   _max_deltas = max_deltas;
+   if( !enable )
+      _changed_ids.clear();
+}
+
+fc::path object_database::delta_dir()const
+{
+   return _data_dir / "object_database" / "delta";
+}
+
+void object_database::flush_incremental()
+{
+   if( !_track_changes || _delta_count >= _max_deltas || !fc::exists( _data_dir / "object_database" ) )
+   {
+      flush();
+      return;
+   }
+   if( _changed_ids.empty() )
+      return;
+
+   // group the changes by index, so that each index record carries its next id
+   std::map< std::pair<uint8_t,uint8_t>, vector< std::pair<object_id_type, vector<char>> > > changes;
+   for( const auto& id : _changed_ids )
+   {
+      const object* obj = find_object( id );
+      changes[ std::make_pair( id.space(), id.type() ) ].emplace_back( id, obj ? obj->pack() : vector<char>() );
+   }
+
+   fc::create_directories( delta_dir() );
+   const fc::path delta_file = delta_dir() / fc::to_string( uint64_t(_delta_count + 1) );
+   const fc::path tmp_file = delta_dir() / "tmp";
+   {
+      std::ofstream out( tmp_file.generic_string(), std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+      FC_ASSERT( out );
+      for( const auto& item : changes )
+      {
+         fc::raw::pack( out, get_index( item.first.first, item.first.second ).get_next_id() );
+         fc::raw::pack( out, item.second );
+      }
+   }
+   // a delta only becomes visible to open() once it is completely written
+   fc::rename( tmp_file, delta_file );
+   ++_delta_count;
+   _changed_ids.clear();
 }
 
+void object_database::load_deltas()
+{ try {
+   _delta_count = 0;
+   if( !fc::exists( delta_dir() ) )
+      return;
+   for( uint32_t seq = 1; ; ++seq )
+   {
+      const fc::path delta_file = delta_dir() / fc::to_string( uint64_t(seq) );
+      if( !fc::exists( delta_file ) )
+         break;
+
+      std::ifstream in( delta_file.generic_string(), std::ifstream::binary );
+      FC_ASSERT( in );
+      std::vector<char> data( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+      fc::datastream<const char*> ds( data.data(), data.size() );
+      while( ds.remaining() > 0 )
+      {
+         object_id_type next_id;
+         vector< std::pair<object_id_type, vector<char>> > entries;
+         fc::raw::unpack( ds, next_id );
+         fc::raw::unpack( ds, entries );
+         // skip indexes that are not registered any more, e.g. of a plugin that is not enabled, like open() does
+         if( _index[next_id.space()].size() <= next_id.type() || !_index[next_id.space()][next_id.type()] )
+            continue;
+         index& idx = get_mutable_index( next_id.space(), next_id.type() );
+         for( const auto& entry : entries )
+            idx.load_delta( entry.first, entry.second );
+         idx.set_next_id( next_id );
+      }
+      _delta_count = seq;
+   }
+   ilog( "Applied ${n} incremental object database snapshots", ("n", _delta_count) );
+} FC_CAPTURE_AND_RETHROW() }
+
+void object_database::apply_packed_changes( object_id_type next_id,
+                                            const vector< std::pair<object_id_type, vector<char>> >& objects )
+{ try {
+   index& idx = get_mutable_index( next_id.space(), next_id.type() );
+   for( const auto& entry : objects )
+      idx.apply_packed( entry.first, entry.second );
+   if( idx.get_next_id() != next_id )
+   {
+      save_undo_next_id( idx.get_next_id() );
+      idx.set_next_id( next_id );
+   }
+} FC_CAPTURE_AND_RETHROW( (next_id) ) }
+
 void object_database::wipe(const fc::path& data_dir)
 {
    close();
@@ -95,7 +190,30 @@ void object_database::wipe(const fc::path& data_dir)
    ilog("Done wiping object databse.");
 }
 
-void object_database::open(const fc::path& data_dir)
+vector< std::pair<uint8_t,uint8_t> > object_database::registered_indexes()const
+{
+   vector< std::pair<uint8_t,uint8_t> > result;
+   for( uint32_t space = 0; space < _index.size(); ++space )
+      for( uint32_t type = 0; type < _index[space].size(); ++type )
+         if( _index[space][type] )
+            result.emplace_back( uint8_t(space), uint8_t(type) );
+   return result;
+}
+
+vector<index_memory_stats> object_database::get_index_memory_stats()const
+{
+   vector<index_memory_stats> result;
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            result.push_back( idx->get_memory_stats() );
+   std::sort( result.begin(), result.end(), []( const index_memory_stats& a, const index_memory_stats& b ) {
+      return a.total_bytes > b.total_bytes;
+   } );
+   return result;
+}
+
+void object_database::open( const fc::path& data_dir, graphene::utilities::thread_pool* pool )
 { try {
    _data_dir = data_dir;
    if( fc::exists( _data_dir / "object_database" / "lock" ) )
@@ -104,10 +222,69 @@ void object_database::open(const fc::path& data_dir)
        return;
    }
    ilog("Opening object database from ${d} ...", ("d", data_dir));
+   struct index_file
+   {
+      index*   idx;
+      fc::path file;
+      uint64_t size;
+      int64_t  microseconds;
+   };
+   vector<index_file> to_open;
    for( uint32_t space = 0; space < _index.size(); ++space )
       for( uint32_t type = 0; type  < _index[space].size(); ++type )
          if( _index[space][type] )
-            _index[space][type]->open( _data_dir / "object_database" / fc::to_string(space)/fc::to_string(type) );
+         {
+            fc::path file = _data_dir / "object_database" / fc::to_string(space)/fc::to_string(type);
+            to_open.push_back( index_file{ _index[space][type].get(), file, fc::exists( file ) ? fc::file_size( file ) : 0, 0 } );
+         }
+
+   const auto open_index = []( index_file& item ) {
+      const fc::time_point start = fc::time_point::now();
+      item.idx->open( item.file );
+      item.microseconds = ( fc::time_point::now() - start ).count();
+   };
+   if( pool == nullptr || pool->size() == 0 )
+   {
+      for( auto& item : to_open )
+         open_index( item );
+   }
+   else
+   {
+      // Indexes don't share any state while loading, so each one can be unpacked on its own thread.
+      // Hand out the biggest files first, round robin, to keep the threads evenly busy.
+      std::sort( to_open.begin(), to_open.end(), []( const index_file& a, const index_file& b ) {
+         return a.size > b.size;
+      });
+      vector< fc::future<void> > results;
+      results.reserve( to_open.size() );
+      for( size_t i = 0; i < to_open.size(); ++i )
+      {
+         index_file* item = &to_open[i];
+         results.emplace_back( pool->get_thread( i ).async( [item,&open_index]() { open_index( *item ); }, "open_index" ) );
+      }
+      graphene::utilities::thread_pool::wait_all( results );
+   }
+
+   _index_load_times.clear();
+   _index_load_times.reserve( to_open.size() );
+   for( const auto& item : to_open )
+   {
+      index_load_time t;
+      t.space_id     = item.idx->object_space_id();
+      t.type_id      = item.idx->object_type_id();
+      t.file_size    = item.size;
+      t.microseconds = item.microseconds;
+      _index_load_times.push_back( t );
+   }
+   std::sort( _index_load_times.begin(), _index_load_times.end(), []( const index_load_time& a, const index_load_time& b ) {
+      return a.microseconds > b.microseconds;
+   });
+   for( size_t i = 0; i < _index_load_times.size() && i < 5 && _index_load_times[i].file_size > 0; ++i )
+      ilog( "Loaded index ${s}.${t} of ${b} bytes in ${ms} ms",
+            ("s",_index_load_times[i].space_id)("t",_index_load_times[i].type_id)
+            ("b",_index_load_times[i].file_size)("ms",_index_load_times[i].microseconds / 1000) );
+   load_deltas();
+   _changed_ids.clear();
    ilog( "Done opening object database." );
 
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
@@ -120,17 +297,40 @@ void object_database::pop_undo()
 
 void object_database::save_undo( const object& obj )
 {
+   ++_change_counts.modified;
    _undo_db.on_modify( obj );
+   if( _track_changes )
+      _changed_ids.insert( obj.id );
 }
 
 void object_database::save_undo_add( const object& obj )
 {
+   ++_change_counts.created;
    _undo_db.on_create( obj );
+   if( _track_changes )
+      _changed_ids.insert( obj.id );
 }
 
 void object_database::save_undo_remove(const object& obj)
 {
+   ++_change_counts.removed;
    _undo_db.on_remove( obj );
+   if( _track_changes )
+      _changed_ids.insert( obj.id );
+}
+
+void object_database::save_undo_remove_batch( const vector<const object*>& objs )
+{
+   _change_counts.removed += objs.size();
+   _undo_db.on_remove_batch( objs );
+   if( _track_changes )
+      for( const object* obj : objs )
+         _changed_ids.insert( obj->id );
+}
+
+void object_database::save_undo_next_id( object_id_type next_id )
+{
+   _undo_db.on_use_next_id( next_id );
 }
 
 } } // namespace graphene::db
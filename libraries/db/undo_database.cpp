@@ -25,8 +25,189 @@
 #include <graphene/db/undo_database.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <cstddef>
+
 namespace graphene { namespace db {
 
+void* undo_arena::allocate( size_t size )
+{
+   if( size > max_object_size )
+      return nullptr;
+   const size_t alignment = alignof(std::max_align_t);
+   size = ( size + alignment - 1 ) & ~( alignment - 1 );
+   if( _used + size > chunk_size )
+   {
+      if( _free_chunks != nullptr && !_free_chunks->empty() )
+      {
+         _chunks.push_back( std::move( _free_chunks->back() ) );
+         _free_chunks->pop_back();
+      }
+      else
+         _chunks.emplace_back( new char[chunk_size] );
+      _used = 0;
+   }
+   void* result = _chunks.back().get() + _used;
+   _used += size;
+   return result;
+}
+
+void undo_arena::absorb( undo_arena& other )
+{
+   if( other._chunks.empty() )
+      return;
+   // keep allocating from our current chunk, the absorbed ones are only held on to
+   std::unique_ptr<char[]> current;
+   if( !_chunks.empty() )
+   {
+      current = std::move( _chunks.back() );
+      _chunks.pop_back();
+   }
+   for( auto& chunk : other._chunks )
+      _chunks.push_back( std::move( chunk ) );
+   if( current )
+      _chunks.push_back( std::move( current ) );
+   else
+      _used = other._used;
+   other._chunks.clear();
+   other._used = chunk_size;
+}
+
+void undo_arena::release()
+{
+   for( auto& chunk : _chunks )
+   {
+      if( _free_chunks != nullptr && _free_chunks->size() < max_free_chunks )
+         _free_chunks->push_back( std::move( chunk ) );
+   }
+   _chunks.clear();
+   _used = chunk_size;
+}
+
+undo_object_ptr undo_database::copy_object( undo_state& state, const object& obj )
+{
+   void* buffer = state.arena.allocate( obj.clone_size() );
+   if( buffer == nullptr )
+      return undo_object_ptr( obj.clone().release() );
+   return undo_object_ptr( obj.clone_to( buffer ), undo_object_deleter( true ) );
+}
+
+undo_object_ptr undo_database::copy_object( undo_state& state, const object& obj, const undo_delta& delta )
+{
+   undo_object_ptr result = copy_object( state, obj );
+   delta.restore( *result );
+   return result;
+}
+
+bool undo_database::is_new( const undo_state& state, object_id_type id )const
+{
+   if( state.new_ids.find( id ) != state.new_ids.end() )
+      return true;
+   auto itr = state.old_index_next_ids.find( object_id_type( id.space(), id.type(), 0 ) );
+   if( itr == state.old_index_next_ids.end() || id.instance() < itr->second.instance() )
+      return false;
+   return _db.get_index( id ).undo_appends_only();
+}
+
+vector<object_id_type> undo_database::appended_ids( const undo_state& state )const
+{
+   vector<object_id_type> result;
+   for( const auto& item : state.old_index_next_ids )
+   {
+      const index& idx = _db.get_index( item.first.space(), item.first.type() );
+      if( !idx.undo_appends_only() )
+         continue;
+      const uint64_t end = idx.get_next_id().instance();
+      for( uint64_t i = item.second.instance(); i < end; ++i )
+      {
+         const object_id_type id( item.first.space(), item.first.type(), i );
+         if( idx.find( id ) != nullptr )
+            result.push_back( id );
+      }
+   }
+   return result;
+}
+
+unique_ptr<object> undo_database::find_previous_version( object_id_type id, size_t states )const
+{
+   FC_ASSERT( states <= _stack.size() );
+   unique_ptr<object> result;
+   if( const object* current = _db.find_object( id ) )
+      result = current->clone();
+   for( auto itr = _stack.rbegin(); itr != _stack.rbegin() + states; ++itr )
+   {
+      const undo_state& state = *itr;
+      if( is_new( state, id ) )
+      {
+         result.reset();
+         continue;
+      }
+      auto value_itr = state.old_values.find( id );
+      if( value_itr != state.old_values.end() )
+      {
+         result = value_itr->second->clone();
+         continue;
+      }
+      auto removed_itr = state.removed.find( id );
+      if( removed_itr != state.removed.end() )
+      {
+         result = removed_itr->second->clone();
+         continue;
+      }
+      auto delta_itr = state.old_deltas.find( id );
+      if( delta_itr != state.old_deltas.end() )
+      {
+         assert( result );
+         delta_itr->second->restore( *result );
+      }
+   }
+   return result;
+}
+
+void undo_database::remove_appended( const undo_state& state )
+{
+   for( const object_id_type& id : appended_ids( state ) )
+      _db.remove( _db.get_object( id ) );
+}
+
+void undo_database::add_bytes( undo_state& state, size_t bytes )
+{
+   state.bytes += bytes;
+   _memory_bytes += bytes;
+}
+
+void undo_database::pop_back_state()
+{
+   _memory_bytes -= _stack.back().bytes;
+   _stack.pop_back();
+}
+
+void undo_database::pop_front_state()
+{
+   _memory_bytes -= _stack.front().bytes;
+   _stack.pop_front();
+}
+
+undo_database_stats undo_database::get_stats()const
+{
+   undo_database_stats stats;
+   stats.state_count     = _stack.size();
+   stats.max_state_count = _max_size;
+   stats.memory_bytes    = _memory_bytes;
+   stats.memory_limit    = _memory_limit;
+   if( !_stack.empty() )
+      stats.head_state_bytes = _stack.back().bytes;
+   return stats;
+}
+
+bool undo_database::modify_saved( const object& obj )
+{
+   if( !_fields_saved.valid() )
+      return false;
+   const bool saved = ( *_fields_saved == obj.id );
+   _fields_saved.reset();
+   return saved;
+}
+
 void undo_database::enable()  { _disabled = false; }
 void undo_database::disable() { _disabled = true; }
 
@@ -38,9 +219,9 @@ undo_database::session undo_database::start_undo_session( bool force_enable )
       _disabled = false;
 
    while( size() > max_size() )
-      _stack.pop_front();
+      pop_front_state();
 
-   _stack.emplace_back();
+   _stack.emplace_back( &_free_chunks );
    ++_active_sessions;
    return session(*this, disable_on_exit );
 }
@@ -49,47 +230,132 @@ void undo_database::on_create( const object& obj )
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_free_chunks );
    auto& state = _stack.back();
    auto index_id = object_id_type( obj.id.space(), obj.id.type(), 0 );
    auto itr = state.old_index_next_ids.find( index_id );
    if( itr == state.old_index_next_ids.end() )
+   {
       state.old_index_next_ids[index_id] = obj.id;
-   state.new_ids.insert(obj.id);
+      add_bytes( state, entry_bytes );
+   }
+   // the objects of append-only indexes are new as of the next id kept above
+   if( !_db.get_index( obj.id ).undo_appends_only() && state.new_ids.insert(obj.id).second )
+      add_bytes( state, entry_bytes );
+}
+void undo_database::on_use_next_id( object_id_type next_id )
+{
+   if( _disabled ) return;
+
+   if( _stack.empty() )
+      _stack.emplace_back( &_free_chunks );
+   auto& state = _stack.back();
+   auto index_id = object_id_type( next_id.space(), next_id.type(), 0 );
+   if( state.old_index_next_ids.find( index_id ) == state.old_index_next_ids.end() )
+   {
+      state.old_index_next_ids[index_id] = next_id;
+      add_bytes( state, entry_bytes );
+   }
 }
 void undo_database::on_modify( const object& obj )
 {
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_free_chunks );
+   if( modify_saved( obj ) )
+      return;
    auto& state = _stack.back();
-   if( state.new_ids.find(obj.id) != state.new_ids.end() )
+   if( is_new( state, obj.id ) )
       return;
    auto itr =  state.old_values.find(obj.id);
    if( itr != state.old_values.end() ) return;
-   state.old_values[obj.id] = obj.clone();
+   auto delta_itr = state.old_deltas.find(obj.id);
+   if( delta_itr != state.old_deltas.end() )
+   {
+      // the fields outside of the delta are still unchanged, so the current value gives the rest of the copy
+      state.old_values[obj.id] = copy_object( state, obj, *delta_itr->second );
+      state.old_deltas.erase( delta_itr );
+      add_bytes( state, obj.clone_size() + entry_bytes );
+      return;
+   }
+   state.old_values[obj.id] = copy_object( state, obj );
+   add_bytes( state, obj.clone_size() + entry_bytes );
+}
+void undo_database::on_modify_fields( const object& obj, const std::type_info& delta_type,
+                                      const std::function<undo_delta_ptr()>& make_delta )
+{
+   _fields_saved.reset();
+   if( _disabled ) return;
+
+   if( _stack.empty() )
+      _stack.emplace_back( &_free_chunks );
+   auto& state = _stack.back();
+   _fields_saved = obj.id;
+   if( is_new( state, obj.id ) )
+      return;
+   if( state.old_values.find(obj.id) != state.old_values.end() )
+      return;
+   auto delta_itr = state.old_deltas.find(obj.id);
+   if( delta_itr == state.old_deltas.end() )
+   {
+      undo_delta_ptr delta = make_delta();
+      add_bytes( state, delta->size() + entry_bytes );
+      state.old_deltas[obj.id] = std::move( delta );
+      return;
+   }
+   if( typeid( *delta_itr->second ) == delta_type )
+      return;
+   state.old_values[obj.id] = copy_object( state, obj, *delta_itr->second );
+   state.old_deltas.erase( delta_itr );
+   add_bytes( state, obj.clone_size() + entry_bytes );
 }
 void undo_database::on_remove( const object& obj )
 {
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_free_chunks );
+   save_removed( _stack.back(), obj );
+}
+void undo_database::on_remove_batch( const vector<const object*>& objs )
+{
+   if( _disabled || objs.empty() ) return;
+
+   if( _stack.empty() )
+      _stack.emplace_back( &_free_chunks );
    undo_state& state = _stack.back();
+   state.removed.reserve( state.removed.size() + objs.size() );
+   for( const object* obj : objs )
+      save_removed( state, *obj );
+}
+void undo_database::save_removed( undo_state& state, const object& obj )
+{
    if( state.new_ids.count(obj.id) )
    {
       state.new_ids.erase(obj.id);
       return;
    }
+   // a new object of an append-only index, nothing left to remove on undo
+   if( is_new( state, obj.id ) )
+      return;
    if( state.old_values.count(obj.id) )
    {
       state.removed[obj.id] = std::move(state.old_values[obj.id]);
       state.old_values.erase(obj.id);
       return;
    }
+   auto delta_itr = state.old_deltas.find(obj.id);
+   if( delta_itr != state.old_deltas.end() )
+   {
+      state.removed[obj.id] = copy_object( state, obj, *delta_itr->second );
+      state.old_deltas.erase( delta_itr );
+      add_bytes( state, obj.clone_size() + entry_bytes );
+      return;
+   }
    if( state.removed.count(obj.id) ) return;
-   state.removed[obj.id] = obj.clone();
+   state.removed[obj.id] = copy_object( state, obj );
+   add_bytes( state, obj.clone_size() + entry_bytes );
 }
 
 void undo_database::undo()
@@ -103,11 +369,16 @@ void undo_database::undo()
    {
       _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
    }
+   for( auto& item : state.old_deltas )
+   {
+      _db.modify( _db.get_object( item.first ), [&]( object& obj ){ item.second->restore( obj ); } );
+   }
 
    for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
    {
       _db.remove( _db.get_object(*ritr) );
    }
+   remove_appended( state );
 
    for( auto& item : state.old_index_next_ids )
    {
@@ -117,7 +388,7 @@ void undo_database::undo()
    for( auto& item : state.removed )
       _db.insert( std::move(*item.second) );
 
-   _stack.pop_back();
+   pop_back_state();
    enable();
    --_active_sessions;
 } FC_CAPTURE_AND_RETHROW() }
@@ -127,7 +398,7 @@ void undo_database::merge()
    FC_ASSERT( _active_sessions > 0 );
    if( _active_sessions == 1 && _stack.size() == 1 )
    {
-      _stack.pop_back();
+      pop_back_state();
       --_active_sessions;
       return;
    }
@@ -135,6 +406,24 @@ void undo_database::merge()
    auto& state = _stack.back();
    auto& prev_state = _stack[_stack.size()-2];
 
+   // Nothing in prev_state to compose with, e.g. the first transaction of a pending block or a session only
+   // opened around a nested one: state becomes the merged state as it is, in constant time.
+   if( prev_state.old_values.empty() && prev_state.old_deltas.empty() && prev_state.old_index_next_ids.empty()
+       && prev_state.new_ids.empty() && prev_state.removed.empty() )
+   {
+      std::swap( prev_state.old_values, state.old_values );
+      std::swap( prev_state.old_deltas, state.old_deltas );
+      std::swap( prev_state.old_index_next_ids, state.old_index_next_ids );
+      std::swap( prev_state.new_ids, state.new_ids );
+      std::swap( prev_state.removed, state.removed );
+      prev_state.arena.absorb( state.arena );
+      prev_state.bytes += state.bytes;
+      state.bytes = 0;
+      _stack.pop_back();
+      --_active_sessions;
+      return;
+   }
+
    // An object's relationship to a state can be:
    // in new_ids            : new
    // in old_values (was=X) : upd(was=X)
@@ -177,10 +466,13 @@ void undo_database::merge()
 
    // We can only be outside type A/AB (the nop path) if B is not nop, so it suffices to iterate through B's three containers.
 
+   // Deltas are updates too. An update of prev_state only held as a delta starts from the value of the object
+   // at the end of prev_state with the delta restored, e.g. (was=Y) with the delta restored is (was=X).
+   //
    // *+upd
    for( auto& obj : state.old_values )
    {
-      if( prev_state.new_ids.find(obj.second->id) != prev_state.new_ids.end() )
+      if( is_new( prev_state, obj.second->id ) )
       {
          // new+upd -> new, type A
          continue;
@@ -190,12 +482,55 @@ void undo_database::merge()
          // upd(was=X) + upd(was=Y) -> upd(was=X), type A
          continue;
       }
+      auto prev_delta = prev_state.old_deltas.find(obj.second->id);
+      if( prev_delta != prev_state.old_deltas.end() )
+      {
+         // upd(delta) + upd(was=Y) -> upd(was=X), type C
+         prev_delta->second->restore( *obj.second );
+         prev_state.old_values[obj.second->id] = std::move(obj.second);
+         prev_state.old_deltas.erase( prev_delta );
+         continue;
+      }
       // del+upd -> N/A
       assert( prev_state.removed.find(obj.second->id) == prev_state.removed.end() );
       // nop+upd(was=Y) -> upd(was=Y), type B
       prev_state.old_values[obj.second->id] = std::move(obj.second);
    }
 
+   // *+upd(delta)
+   for( auto& item : state.old_deltas )
+   {
+      if( is_new( prev_state, item.first ) )
+      {
+         // new+upd -> new, type A
+         continue;
+      }
+      if( prev_state.old_values.find(item.first) != prev_state.old_values.end() )
+      {
+         // upd(was=X) + upd(delta) -> upd(was=X), type A
+         continue;
+      }
+      auto prev_delta = prev_state.old_deltas.find(item.first);
+      if( prev_delta != prev_state.old_deltas.end() )
+      {
+         // same fields, upd(delta X) + upd(delta Y) -> upd(delta X), type A
+         if( typeid( *prev_delta->second ) == typeid( *item.second ) )
+            continue;
+         // otherwise upd(was=X), type C: the current value with both deltas restored, the latest first
+         const object& current = _db.get_object( item.first );
+         undo_object_ptr old_value = copy_object( prev_state, current, *item.second );
+         add_bytes( prev_state, current.clone_size() );
+         prev_delta->second->restore( *old_value );
+         prev_state.old_values[item.first] = std::move(old_value);
+         prev_state.old_deltas.erase( prev_delta );
+         continue;
+      }
+      // del+upd -> N/A
+      assert( prev_state.removed.find(item.first) == prev_state.removed.end() );
+      // nop+upd(delta) -> upd(delta), type B
+      prev_state.old_deltas[item.first] = std::move(item.second);
+   }
+
    // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
    for( auto id : state.new_ids )
       prev_state.new_ids.insert(id);
@@ -220,7 +555,7 @@ void undo_database::merge()
    // *+del
    for( auto& obj : state.removed )
    {
-      if( prev_state.new_ids.find(obj.second->id) != prev_state.new_ids.end() )
+      if( is_new( prev_state, obj.second->id ) )
       {
          // new + del -> nop (type C)
          prev_state.new_ids.erase(obj.second->id);
@@ -234,11 +569,24 @@ void undo_database::merge()
          prev_state.old_values.erase(obj.second->id);
          continue;
       }
+      auto prev_delta = prev_state.old_deltas.find(obj.second->id);
+      if( prev_delta != prev_state.old_deltas.end() )
+      {
+         // upd(delta) + del(was=Y) -> del(was=X)
+         prev_delta->second->restore( *obj.second );
+         prev_state.removed[obj.second->id] = std::move(obj.second);
+         prev_state.old_deltas.erase( prev_delta );
+         continue;
+      }
       // del + del -> N/A
       assert( prev_state.removed.find( obj.second->id ) == prev_state.removed.end() );
       // nop + del(was=Y) -> del(was=Y)
       prev_state.removed[obj.second->id] = std::move(obj.second);
    }
+   // copies moved into prev_state still live in this state's chunks
+   prev_state.arena.absorb( state.arena );
+   prev_state.bytes += state.bytes;
+   state.bytes = 0;
    _stack.pop_back();
    --_active_sessions;
 }
@@ -261,11 +609,16 @@ void undo_database::pop_commit()
       {
          _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
       }
+      for( auto& item : state.old_deltas )
+      {
+         _db.modify( _db.get_object( item.first ), [&]( object& obj ){ item.second->restore( obj ); } );
+      }
 
       for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
       {
          _db.remove( _db.get_object(*ritr) );
       }
+      remove_appended( state );
 
       for( auto& item : state.old_index_next_ids )
       {
@@ -275,7 +628,7 @@ void undo_database::pop_commit()
       for( auto& item : state.removed )
          _db.insert( std::move(*item.second) );
 
-      _stack.pop_back();
+      pop_back_state();
    }
    catch ( const fc::exception& e )
    {
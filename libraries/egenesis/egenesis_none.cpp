@@ -33,14 +33,20 @@ chain_id_type get_egenesis_chain_id()
    return chain_id_type();
 }
 
-void compute_egenesis_json( std::string& result )
+bool has_egenesis()
 {
-   result = "";
+   return false;
+}
+
+genesis_state_type get_egenesis()
+{
+   FC_THROW( "No genesis state was compiled in" );
 }
 
 fc::sha256 get_egenesis_json_hash()
 {
-   return fc::sha256::hash( "" );
+   // the hash of the empty string
+   return fc::sha256( "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" );
 }
 
 } }
@@ -25,6 +25,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string.hpp>
@@ -77,71 +78,22 @@ fc::path get_path(
    return result;
 }
 
-void convert_to_c_array(
-   const std::string& src,
-   std::string& dest,
-   int width = 40 )
+/// writes the bytes as the initializer of an unsigned char array, 16 per line
+void convert_to_byte_array(
+   const std::vector<char>& src,
+   std::string& dest )
 {
-   dest.reserve( src.length() * 6 / 5 );
-   bool needs_comma = false;
-   int row = 0;
-   for( std::string::size_type i=0; i<src.length(); i+=width )
+   static const char digits[] = "0123456789abcdef";
+   dest.reserve( src.size() * 6 );
+   for( size_t i = 0; i < src.size(); ++i )
    {
-      std::string::size_type j = std::min( i+width, src.length() );
-      if( needs_comma )
-         dest.append(",\n");
-      dest.append("\"");
-      for( std::string::size_type k=i; k<j; k++ )
-      {
-         char c = src[k];
-         switch(c)
-         {
-            // use most short escape sequences
-            case '\"': dest.append("\\\""); break;
-            case '\?': dest.append("\\\?"); break;
-            case '\\': dest.append("\\\\"); break;
-            case '\a': dest.append( "\\a"); break;
-            case '\b': dest.append( "\\b"); break;
-            case '\f': dest.append( "\\f"); break;
-            case '\n': dest.append( "\\n"); break;
-            case '\r': dest.append( "\\r"); break;
-            case '\t': dest.append( "\\t"); break;
-            case '\v': dest.append( "\\v"); break;
-
-            // single quote and misc. ASCII is OK
-            case '\'':
-            case ' ': case '!': case '#': case '$': case '%': case '&': case '(': case ')':
-            case '*': case '+': case ',': case '-': case '.': case '/':
-            case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
-            case ':': case ';': case '<': case '=': case '>': case '@':
-            case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H': case 'I': case 'J':
-            case 'K': case 'L': case 'M': case 'N': case 'O': case 'P': case 'Q': case 'R': case 'S': case 'T':
-            case 'U': case 'V': case 'W': case 'X': case 'Y': case 'Z':
-            case '[': case ']': case '^': case '_': case '`':
-            case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g': case 'h': case 'i': case 'j':
-            case 'k': case 'l': case 'm': case 'n': case 'o': case 'p': case 'q': case 'r': case 's': case 't':
-            case 'u': case 'v': case 'w': case 'x': case 'y': case 'z':
-            case '{': case '|': case '}': case '~':
-               dest.append(&c, 1);
-               break;
-
-            // use shortest octal escape for everything else
-            default:
-               dest.append("\\");
-               char dg[3];
-               dg[0] = '0' + ((c >> 6) & 3);
-               dg[1] = '0' + ((c >> 3) & 7);
-               dg[2] = '0' + ((c     ) & 7);
-               int start = (dg[0] == '0' ? (dg[1] == '0' ? 2 : 1) : 0);
-               dest.append( dg+start, 3-start );
-         }
-      }
-      dest.append("\"");
-      needs_comma = true;
-      row++;
+      const unsigned char c = src[i];
+      dest.append( "0x" );
+      dest.push_back( digits[ c >> 4 ] );
+      dest.push_back( digits[ c & 15 ] );
+      if( i + 1 < src.size() )
+         dest.append( ( i % 16 == 15 ) ? ",\n" : "," );
    }
-   std::cerr << "\n";
-   return;
 }
 
 struct egenesis_info
@@ -150,9 +102,8 @@ struct egenesis_info
    fc::optional< chain_id_type > chain_id;
    fc::optional< std::string > genesis_json;
    fc::optional< fc::sha256 > genesis_json_hash;
-   fc::optional< std::string > genesis_json_array;
-   int genesis_json_array_width,
-       genesis_json_array_height;
+   fc::optional< std::vector<char> > genesis_data;
+   fc::optional< std::string > genesis_data_array;
 
    void fillin()
    {
@@ -180,16 +131,14 @@ struct egenesis_info
       // init chain_id from genesis_json_hash
       if( !chain_id.valid() )
          chain_id = genesis_json_hash;
-      // init genesis_json_array from genesis_json
-      if( !genesis_json_array.valid() )
+      // init genesis_data_array from genesis, the JSON is only needed for its hash
+      if( !genesis_data_array.valid() )
       {
-         genesis_json_array = std::string();
-         // TODO: gzip
-         int width = 40;
-         convert_to_c_array( *genesis_json, *genesis_json_array, width );
-         int height = (genesis_json->length() + width-1) / width;
-         genesis_json_array_width = width;
-         genesis_json_array_height = height;
+         genesis_data = compress_genesis_state( *genesis );
+         genesis_data_array = std::string();
+         convert_to_byte_array( *genesis_data, *genesis_data_array );
+         std::cerr << "embed_genesis:  Genesis JSON of " << genesis_json->length() << " bytes embedded as "
+                   << genesis_data->size() << " compressed bytes\n";
       }
    }
 };
@@ -256,11 +205,9 @@ int main( int argc, char** argv )
       ;
    if( info.genesis_json.valid() )
    {
-      template_context["genesis_json_length"] = info.genesis_json->length();
-      template_context["genesis_json_array"] = (*info.genesis_json_array);
+      template_context["genesis_data_size"] = info.genesis_data->size();
+      template_context["genesis_data_array"] = (*info.genesis_data_array);
       template_context["genesis_json_hash"] = (*info.genesis_json_hash).str();
-      template_context["genesis_json_array_width"] = info.genesis_json_array_width;
-      template_context["genesis_json_array_height"] = info.genesis_json_array_height;
    }
 
    for( const std::string& src_dest : options["tmplsub"].as< std::vector< std::string > >() )
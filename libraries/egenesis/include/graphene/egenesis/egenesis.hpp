@@ -39,12 +39,19 @@ namespace graphene { namespace egenesis {
 graphene::chain::chain_id_type get_egenesis_chain_id();
 
 /**
- * Get the egenesis JSON, or the empty string if none was compiled in.
+ * Whether a genesis state was compiled in, without decoding it.
  */
-void compute_egenesis_json( std::string& result );
+bool has_egenesis();
 
 /**
- * The file returned by compute_egenesis_json() should have this hash.
+ * Get the built-in genesis state. It is embedded compressed and decoded by each call, so only call it when the
+ * genesis state is needed, i.e. for a new database. Its initial_chain_id is get_egenesis_json_hash().
+ * @throws fc::exception if none was compiled in
+ */
+graphene::chain::genesis_state_type get_egenesis();
+
+/**
+ * The hash of the genesis JSON the egenesis was built from, computed by embed_genesis.
  */
 fc::sha256 get_egenesis_json_hash();
 
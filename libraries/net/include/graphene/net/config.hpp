@@ -81,6 +81,14 @@
 
 #define GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING      200
 
+/**
+ * During sync, blocks are requested in batches of this many, striped over the
+ * peers we're syncing with, so that consecutive blocks arrive from different
+ * peers in parallel.  A peer is sent more batches as soon as it has room for
+ * them, it doesn't need to return everything it was asked for first.
+ */
+#define GRAPHENE_NET_SYNC_REQUEST_BATCH_SIZE                 50
+
 /**
  * During normal operation, how many items will be fetched from each
  * peer at a time.  This will only come into play when the network
@@ -104,6 +112,35 @@
 
 #define GRAPHENE_NET_MAX_TRX_PER_SECOND                      1000
 
+/**
+ * Transactions are relayed to each peer through a token bucket refilled at this many per second, holding up to
+ * the burst size, so that a flood of transactions can't fill the send queue ahead of blocks.  Block messages
+ * skip ahead of everything else queued.  A rate of 0 turns the shaping off.
+ */
+#define GRAPHENE_NET_DEFAULT_PEER_TRX_RELAY_RATE             GRAPHENE_NET_MAX_TRX_PER_SECOND
+#define GRAPHENE_NET_DEFAULT_PEER_TRX_RELAY_BURST            (2 * GRAPHENE_NET_MAX_TRX_PER_SECOND)
+
+/**
+ * Reads and writes on a connection at least this large are encrypted or
+ * decrypted on the p2p I/O threads, when there are any; smaller ones aren't
+ * worth the switch to another thread.
+ */
+#define GRAPHENE_NET_MIN_OFFLOADED_CRYPTO_SIZE               4096
+
 #define GRAPHENE_NET_MAX_NESTED_OBJECTS                      (250)
 
-#define MAXIMUM_PEERDB_SIZE 1000
\ No newline at end of file
+#define MAXIMUM_PEERDB_SIZE 1000
+
+/**
+ * Peer scores (see potential_peer_record::get_score()).  Each measure scores from 0 to
+ * GRAPHENE_NET_PEER_SCORE_PER_MEASURE, delays falling linearly to 0 at their bound below, download speed rising
+ * linearly to the full score at its bound.  New samples are weighted 1/GRAPHENE_NET_PEER_SCORE_SAMPLE_WEIGHT
+ * in the running averages.
+ */
+#define GRAPHENE_NET_PEER_SCORE_PER_MEASURE                  1000
+#define GRAPHENE_NET_PEER_SCORE_MAX_ROUND_TRIP_DELAY_MS      1000
+#define GRAPHENE_NET_PEER_SCORE_MAX_BLOCK_DELIVERY_DELAY_MS  3000
+#define GRAPHENE_NET_PEER_SCORE_FULL_DOWNLOAD_SPEED          (64 * 1024)
+#define GRAPHENE_NET_PEER_SCORE_SAMPLE_WEIGHT                4
+/// connections shorter than this don't give a download speed sample
+#define GRAPHENE_NET_PEER_SCORE_MIN_CONNECTION_TIME_SEC      60
\ No newline at end of file
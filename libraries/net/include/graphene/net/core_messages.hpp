@@ -44,6 +44,9 @@ namespace graphene { namespace net {
   using graphene::chain::block_id_type;
   using graphene::chain::transaction_id_type;
   using graphene::chain::signed_block;
+  using graphene::chain::signed_block_header;
+  using graphene::chain::processed_transaction;
+  using graphene::chain::operation_result;
 
   typedef fc::ecc::public_key_data node_id_t;
   typedef fc::ripemd160 item_hash_t;
@@ -86,6 +89,9 @@ namespace graphene { namespace net {
     check_firewall_reply_message_type            = 5015,
     get_current_connections_request_message_type = 5016,
     get_current_connections_reply_message_type   = 5017,
+    compact_block_message_type                   = 5018,
+    fetch_compact_block_transactions_message_type = 5019,
+    compact_block_transactions_message_type      = 5020,
     core_message_type_last                       = 5099
   };
 
@@ -175,6 +181,45 @@ namespace graphene { namespace net {
     {}
   };
 
+  /**
+   * Sent instead of a block_message in reply to a request for a recently broadcast block, to a peer that
+   * announced support for it in its hello.  The peer rebuilds the block from the transactions in its message
+   * cache and fetches the ones it doesn't have with a fetch_compact_block_transactions_message.
+   */
+  struct compact_block_message
+  {
+    static const core_message_type_enum type;
+
+    struct compact_transaction
+    {
+      transaction_id_type           id;
+      /// operation results aren't part of the transactions peers relay, so they're sent along
+      std::vector<operation_result> operation_results;
+    };
+
+    /// hash of the block_message this stands for, the item hash the peer requested
+    item_hash_t                       block_message_hash;
+    signed_block_header               header;
+    std::vector<compact_transaction>  transactions;
+  };
+
+  struct fetch_compact_block_transactions_message
+  {
+    static const core_message_type_enum type;
+
+    item_hash_t           block_message_hash;
+    std::vector<uint32_t> transaction_indexes;
+  };
+
+  struct compact_block_transactions_message
+  {
+    static const core_message_type_enum type;
+
+    item_hash_t                        block_message_hash;
+    /// in the order of the requested indexes
+    std::vector<processed_transaction> transactions;
+  };
+
   struct item_not_available_message
   {
     static const core_message_type_enum type;
@@ -424,10 +469,17 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (check_firewall_reply_message_type)
                  (get_current_connections_request_message_type)
                  (get_current_connections_reply_message_type)
+                 (compact_block_message_type)
+                 (fetch_compact_block_transactions_message_type)
+                 (compact_block_transactions_message_type)
                  (core_message_type_last) )
 
 FC_REFLECT( graphene::net::trx_message, (trx) )
 FC_REFLECT( graphene::net::block_message, (block)(block_id) )
+FC_REFLECT( graphene::net::compact_block_message::compact_transaction, (id)(operation_results) )
+FC_REFLECT( graphene::net::compact_block_message, (block_message_hash)(header)(transactions) )
+FC_REFLECT( graphene::net::fetch_compact_block_transactions_message, (block_message_hash)(transaction_indexes) )
+FC_REFLECT( graphene::net::compact_block_transactions_message, (block_message_hash)(transactions) )
 
 FC_REFLECT( graphene::net::item_id, (item_type)
                                (item_hash) )
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/net/core_messages.hpp>
+
+#include <fc/time.hpp>
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+namespace graphene { namespace net {
+
+  /**
+   * The items advertised between us and our peers recently, shared by all peer connections.
+   *
+   * Every item is numbered once, in the order it was first seen, so what each peer knows of it is a bit in a
+   * peer_inventory_set rather than an entry in a hash set of its own.  Items are expired in the order they were
+   * numbered, which drops the oldest numbers from the front of every peer's bitset.
+   */
+  class inventory_tracker
+  {
+  public:
+    /// @return the number of the item, numbering it now if it isn't tracked yet
+    uint64_t add( const item_id& item, fc::time_point_sec now );
+    /// @return true and the number of the item in sequence if it is tracked
+    bool find( const item_id& item, uint64_t& sequence ) const;
+    /// drops the items first seen before oldest_to_keep
+    void expire( fc::time_point_sec oldest_to_keep );
+
+    /// records that we advertised the item to a peer, which we only do for items we have
+    void set_advertised_to_a_peer( uint64_t sequence );
+    bool was_advertised_to_a_peer( const item_id& item ) const;
+
+    /// the number of the oldest item still tracked
+    uint64_t first_sequence() const { return _first_sequence; }
+    size_t   size() const { return _items.size(); }
+
+  private:
+    struct tracked_item
+    {
+      item_id            item;
+      fc::time_point_sec first_seen;
+      bool               advertised_to_a_peer;
+    };
+    std::deque<tracked_item>              _items; ///< in order of number, and so of the time they were first seen
+    std::unordered_map<item_id, uint64_t> _sequence_by_item;
+    uint64_t                              _first_sequence = 0; ///< number of _items.front()
+  };
+
+  /**
+   * The part of the shared inventory_tracker one peer knows about in one direction, as a bitset over the item
+   * numbers.  Items expired from the tracker are dropped from the set the next time it is expired.
+   */
+  class peer_inventory_set
+  {
+  public:
+    explicit peer_inventory_set( std::shared_ptr<inventory_tracker> tracker );
+
+    bool contains( const item_id& item ) const;
+    bool contains( uint64_t sequence ) const;
+    void insert( const item_id& item, fc::time_point_sec now );
+    void insert( uint64_t sequence );
+    void erase( const item_id& item );
+    /// expires old items from the shared tracker, then drops them from this set
+    void expire( fc::time_point_sec oldest_to_keep );
+
+    size_t size() const { return _size; }
+
+  private:
+    std::shared_ptr<inventory_tracker> _tracker;
+    std::deque<uint64_t>               _words; ///< bit i of _words[j] is item number 64 * (_first_word + j) + i
+    uint64_t                           _first_word = 0;
+    size_t                             _size = 0;
+  };
+
+} } // graphene::net
@@ -29,6 +29,9 @@
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <cstring>
+#include <memory>
+
 namespace graphene { namespace net {
 
   /**
@@ -108,8 +111,31 @@ namespace graphene { namespace net {
      }
   };
 
+  /**
+   *  A message in the form it is encrypted and written to the socket: the header and data, zero-padded to a
+   *  multiple of 16 bytes.  The buffer is never changed once built, so one packed_message can be queued for
+   *  any number of connections, each of them only encrypting it.
+   */
+  struct packed_message
+  {
+     uint32_t                                  msg_type = 0;
+     std::shared_ptr<const std::vector<char> > buffer;
+
+     packed_message(){}
 
+     explicit packed_message( const message& m )
+     :msg_type( m.msg_type )
+     {
+        std::shared_ptr<std::vector<char> > padded = std::make_shared<std::vector<char> >( 16 * ((sizeof(message_header) + m.data.size() + 15) / 16) );
+        memcpy( padded->data(), (const char*)static_cast<const message_header*>(&m), sizeof(message_header) );
+        if( m.data.size() )
+           memcpy( padded->data() + sizeof(message_header), m.data.data(), m.data.size() );
+        buffer = padded;
+     }
 
+     /// the number of bytes that go on the wire, including the header and padding
+     size_t size()const { return buffer ? buffer->size() : 0; }
+  };
 
 } } // graphene::net
 
@@ -25,6 +25,8 @@
 #include <fc/network/tcp_socket.hpp>
 #include <graphene/net/message.hpp>
 
+namespace fc { class thread; }
+
 namespace graphene { namespace net {
 
   namespace detail { class message_oriented_connection_impl; }
@@ -50,8 +52,12 @@ namespace graphene { namespace net {
        void accept();
        void bind(const fc::ip::endpoint& local_endpoint);
        void connect_to(const fc::ip::endpoint& remote_endpoint);
+       /// see stcp_socket::set_crypto_thread(), must be set before the connection is accepted or connected
+       void set_crypto_thread(fc::thread* crypto_thread);
 
        void send_message(const message& message_to_send);
+       /// sends an already packed message, the buffer is shared rather than copied
+       void send_message(const packed_message& message_to_send);
        void close_connection();
        void destroy_connection();
 
@@ -79,14 +79,23 @@ namespace graphene { namespace net {
           */
          virtual bool handle_block( const graphene::net::block_message& blk_msg, bool sync_mode, 
                                     std::vector<fc::uint160_t>& contained_transaction_message_ids ) = 0;
+
+         /**
+          *  @brief Called with the blocks received while syncing, before they are passed to handle_block()
+          *  one at a time, so that the work not depending on the chain state is done for all of them at once.
+          */
+         virtual void prepare_sync_blocks( const std::vector<const graphene::net::block_message*>& blocks ) = 0;
          
          /**
           *  @brief Called when a new transaction comes in from the network
           *
+          *  The message is handed over, so that the decoded transaction can be moved
+          *  into long-lived storage when it is accepted instead of being copied.
+          *
           *  @throws exception if error validating the item, otherwise the item is
           *          safe to broadcast on.
           */
-         virtual void handle_transaction( const graphene::net::trx_message& trx_msg ) = 0;
+         virtual void handle_transaction( graphene::net::trx_message&& trx_msg ) = 0;
 
          /**
           *  @brief Called when a new message comes in from the network other than a
@@ -285,8 +294,26 @@ namespace graphene { namespace net {
 
         void set_total_bandwidth_limit(uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second);
 
+        /**
+         *  Encrypt and decrypt the large messages of the connections on this many threads, so that the crypto work
+         *  of many peers doesn't hold up the p2p thread.  Applies to the connections made afterwards, the number of
+         *  threads can't be lowered.  0 (the default) keeps everything on the p2p thread.
+         */
+        void set_io_threads(uint32_t num_threads);
+        /**
+         *  Restricts the p2p thread and the io threads, including those added later, to the given CPUs, see
+         *  graphene::utilities::parse_cpu_list().
+         */
+        void set_thread_affinity(const std::vector<uint32_t>& cpus);
+
         fc::variant_object network_get_info() const;
         fc::variant_object network_get_usage_stats() const;
+        /**
+         *  Counters for monitoring propagation: messages and bytes sent and received by message type since startup,
+         *  the send queue depth, round trip delay and traffic of each connected peer, the inventory statistics and
+         *  the node delegate call statistics including latency histograms.
+         */
+        fc::variant_object network_get_metrics() const;
 
         std::vector<potential_peer_record> get_potential_peers() const;
 
@@ -309,7 +336,13 @@ namespace graphene { namespace net {
 
       void      sync_from(const item_id& current_head_block, const std::vector<uint32_t>& hard_fork_block_numbers) override {}
       void      broadcast(const message& item_to_broadcast) override;
-      void      add_node_delegate(node_delegate* node_delegate_to_add);
+      /**
+       * Adds a node receiving what is broadcast. A message reaches it @p latency after it is sent, and it is sent
+       * after the messages before it at @p bytes_per_second, without a limit if 0. The messages to one node are
+       * delivered in order.
+       */
+      void      add_node_delegate(node_delegate* node_delegate_to_add,
+                                  fc::microseconds latency = fc::microseconds(), uint64_t bytes_per_second = 0);
 
       virtual uint32_t get_connection_count() const override { return 8; }
     private:
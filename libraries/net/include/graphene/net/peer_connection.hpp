@@ -27,6 +27,7 @@
 #include <graphene/net/peer_database.hpp>
 #include <graphene/net/message_oriented_connection.hpp>
 #include <graphene/net/stcp_socket.hpp>
+#include <graphene/net/inventory_tracker.hpp>
 #include <graphene/net/config.hpp>
 
 #include <boost/tuple/tuple.hpp>
@@ -68,7 +69,9 @@ namespace graphene { namespace net
       virtual void on_message(peer_connection* originating_peer,
                               const message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
-      virtual message get_message_for_item(const item_id& item) = 0;
+      virtual packed_message get_message_for_item(const item_id& item) = 0;
+      /// called after a queued message has been written to the peer
+      virtual void on_message_sent(peer_connection* destination_peer, const packed_message& sent_message) = 0;
     };
 
     class peer_connection;
@@ -123,7 +126,8 @@ namespace graphene { namespace net
           enqueue_time(enqueue_time)
         {}
 
-        virtual message get_message(peer_connection_delegate* node) = 0;
+        virtual packed_message get_message(peer_connection_delegate* node) = 0;
+        virtual uint32_t get_message_type() const = 0;
         /** returns roughly the number of bytes of memory the message is consuming while
          * it is sitting on the queue
          */
@@ -132,7 +136,8 @@ namespace graphene { namespace net
       };
 
       /* when you queue up a 'real_queued_message', a full copy of the message is
-       * stored on the heap until it is sent
+       * stored on the heap until it is sent.  This is only used for messages that get
+       * the send time patched in, all others are queued as a 'shared_queued_message'
        */
       struct real_queued_message : queued_message
       {
@@ -145,7 +150,24 @@ namespace graphene { namespace net
           message_send_time_field_offset(message_send_time_field_offset)
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        packed_message get_message(peer_connection_delegate* node) override;
+        uint32_t get_message_type() const override { return message_to_send.msg_type; }
+        size_t get_size_in_queue() override;
+      };
+
+      /* when you queue up a 'shared_queued_message', the message is packed once and the
+       * buffer is shared with every other queue it was put on
+       */
+      struct shared_queued_message : queued_message
+      {
+        packed_message message_to_send;
+
+        shared_queued_message(packed_message message_to_send) :
+          message_to_send(std::move(message_to_send))
+        {}
+
+        packed_message get_message(peer_connection_delegate* node) override;
+        uint32_t get_message_type() const override { return message_to_send.msg_type; }
         size_t get_size_in_queue() override;
       };
 
@@ -161,14 +183,27 @@ namespace graphene { namespace net
           item_to_send(std::move(item_to_send))
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        packed_message get_message(peer_connection_delegate* node) override;
+        uint32_t get_message_type() const override { return item_to_send.item_type; }
         size_t get_size_in_queue() override;
       };
 
 
       size_t _total_queued_messages_size;
-      std::queue<std::unique_ptr<queued_message>, std::list<std::unique_ptr<queued_message> > > _queued_messages;
+      typedef std::queue<std::unique_ptr<queued_message>, std::list<std::unique_ptr<queued_message> > > queued_message_queue;
+      queued_message_queue _queued_messages;
+      queued_message_queue _queued_block_messages; /// sent before anything in _queued_messages
       fc::future<void> _send_queued_messages_done;
+
+      /// token bucket shaping the transactions relayed to this peer, see GRAPHENE_NET_DEFAULT_PEER_TRX_RELAY_RATE
+      /// @{
+      uint32_t       _transaction_relay_rate;
+      uint32_t       _transaction_relay_burst;
+      double         _transaction_relay_tokens;
+      fc::time_point _transaction_relay_tokens_updated;
+      /// @}
+      /// takes a token for relaying a transaction, or returns how long to wait for the next one
+      fc::microseconds take_transaction_relay_token();
     public:
       fc::time_point connection_initiation_time;
       fc::time_point connection_closed_time;
@@ -207,6 +242,7 @@ namespace graphene { namespace net
       fc::optional<fc::time_point_sec> fc_git_revision_unix_timestamp;
       fc::optional<std::string> platform;
       fc::optional<uint32_t> bitness;
+      bool supports_compact_blocks; /// the peer announced in its hello that it can rebuild blocks from compact_block_messages
 
       // for inbound connections, these fields record what the peer sent us in
       // its hello message.  For outbound, they record what we sent the peer
@@ -250,10 +286,20 @@ namespace graphene { namespace net
                                                                                                             std::hash<item_id> >,
                                                                           boost::multi_index::ordered_non_unique<boost::multi_index::tag<timestamp_index>,
                                                                                                                  boost::multi_index::member<timestamped_item_id, fc::time_point_sec, &timestamped_item_id::timestamp> > > > timestamped_items_set_type;
-      timestamped_items_set_type inventory_peer_advertised_to_us;
-      timestamped_items_set_type inventory_advertised_to_peer;
+      /// both are views of the node's shared inventory_tracker
+      peer_inventory_set inventory_peer_advertised_to_us;
+      peer_inventory_set inventory_advertised_to_peer;
 
       item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
+
+      /// a compact block from this peer we're fetching the missing transactions of
+      struct partial_compact_block
+      {
+        compact_block_message                              compact;
+        std::vector<fc::optional<processed_transaction> >  transactions;
+        bool                                               all_transactions_requested = false;
+      };
+      fc::optional<partial_compact_block> compact_block_being_completed;
       /// @}
 
       // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -272,13 +318,16 @@ namespace graphene { namespace net
 #endif
       bool _currently_handling_message; // true while we're in the middle of handling a message from the remote system
     private:
-      peer_connection(peer_connection_delegate* delegate);
+      peer_connection(peer_connection_delegate* delegate, std::shared_ptr<inventory_tracker> inventory);
       void destroy();
     public:
-      static peer_connection_ptr make_shared(peer_connection_delegate* delegate); // use this instead of the constructor
+      static peer_connection_ptr make_shared(peer_connection_delegate* delegate,
+                                             std::shared_ptr<inventory_tracker> inventory); // use this instead of the constructor
       virtual ~peer_connection();
 
       fc::tcp_socket& get_socket();
+      /// thread the connection encrypts and decrypts large messages on, must be set before accepting or connecting
+      void set_crypto_thread(fc::thread* crypto_thread) { _message_connection.set_crypto_thread(crypto_thread); }
       void accept_connection();
       void connect_to(const fc::ip::endpoint& remote_endpoint, fc::optional<fc::ip::endpoint> local_endpoint = fc::optional<fc::ip::endpoint>());
 
@@ -287,6 +336,7 @@ namespace graphene { namespace net
 
       void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
       void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
+      void send_message(const packed_message& message_to_send);
       void send_item(const item_id& item_to_send);
       void close_connection();
       void destroy_connection();
@@ -294,6 +344,11 @@ namespace graphene { namespace net
       uint64_t get_total_bytes_sent() const;
       uint64_t get_total_bytes_received() const;
 
+      size_t get_queued_message_count() const { return _queued_messages.size() + _queued_block_messages.size(); }
+      /// transactions per second relayed to this peer, at most burst at once; 0 for no limit
+      void set_transaction_relay_rate(uint32_t transactions_per_second, uint32_t burst);
+      size_t get_total_queued_messages_size() const { return _total_queued_messages_size; }
+
       fc::time_point get_last_message_sent_time() const;
       fc::time_point get_last_message_received_time() const;
 
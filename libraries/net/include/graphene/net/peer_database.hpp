@@ -53,6 +53,23 @@ namespace graphene { namespace net {
     uint32_t                          number_of_failed_connection_attempts;
     fc::optional<fc::exception>       last_error;
 
+    /// @name how well the peer served us in past connections, kept across restarts, see get_score()
+    /// @{
+    fc::optional<uint32_t>            round_trip_delay_ms;     ///< running average
+    fc::optional<uint32_t>            block_delivery_delay_ms; ///< running average of the delay from block time to the block reaching us
+    fc::optional<uint32_t>            download_bytes_per_second; ///< running average over connections of a minute or longer
+    /// @}
+
+    void add_round_trip_delay_sample(fc::microseconds round_trip_delay);
+    void add_block_delivery_delay_sample(fc::microseconds delivery_delay);
+    void add_download_speed_sample(uint64_t bytes_per_second);
+    /**
+     * Higher is better.  Latency, block delivery delay and download speed each add up to
+     * GRAPHENE_NET_PEER_SCORE_PER_MEASURE, a peer not measured yet gets half of that for the measure,
+     * so new peers are still given a chance against measured slow ones.
+     */
+    uint32_t get_score() const;
+
     potential_peer_record() :
       number_of_successful_connection_attempts(0),
     number_of_failed_connection_attempts(0){}
@@ -119,4 +136,5 @@ namespace graphene { namespace net {
 } } // end namespace graphene::net
 
 FC_REFLECT_ENUM(graphene::net::potential_peer_last_connection_disposition, (never_attempted_to_connect)(last_connection_failed)(last_connection_rejected)(last_connection_handshaking_failed)(last_connection_succeeded))
-FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(last_error) )
+FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(last_error)
+                                              (round_trip_delay_ms)(block_delivery_delay_ms)(download_bytes_per_second) )
@@ -26,6 +26,8 @@
 #include <fc/crypto/aes.hpp>
 #include <fc/crypto/elliptic.hpp>
 
+namespace fc { class thread; }
+
 namespace graphene { namespace net {
 
 /**
@@ -53,6 +55,16 @@ class stcp_socket : public virtual fc::iostream
     virtual void     flush();
     virtual void     close();
 
+    /**
+     * Encryption and decryption of large reads and writes is done on this thread instead of the calling one, which
+     * waits for it without blocking its other tasks. nullptr (the default) does everything on the calling thread.
+     */
+    void             set_crypto_thread( fc::thread* crypto_thread ) { _crypto_thread = crypto_thread; }
+    /// reads and decrypts exactly len bytes, a multiple of 16
+    void             read_decrypted( char* buffer, size_t len );
+    /// encrypts and writes exactly len bytes, a multiple of 16, the buffer must not be changed until this returns
+    void             write_encrypted( const std::shared_ptr<const char>& buffer, size_t len );
+
     using istream::get;
     void             get( char& c ) { read( &c, 1 ); }
     fc::sha512       get_shared_secret() const { return _shared_secret; }
@@ -64,8 +76,10 @@ class stcp_socket : public virtual fc::iostream
     fc::array<char,8>    _buf;
     //uint32_t             _buf_len;
     fc::tcp_socket       _sock;
-    fc::aes_encoder      _send_aes;
-    fc::aes_decoder      _recv_aes;
+    // shared with the tasks running on the crypto thread, which may outlive a canceled read or write
+    std::shared_ptr<fc::aes_encoder> _send_aes;
+    std::shared_ptr<fc::aes_decoder> _recv_aes;
+    fc::thread*          _crypto_thread;
     std::shared_ptr<char> _read_buffer;
     std::shared_ptr<char> _write_buffer;
 #ifndef NDEBUG
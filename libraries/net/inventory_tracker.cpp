@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/net/inventory_tracker.hpp>
+
+#include <bitset>
+#include <cassert>
+
+namespace graphene { namespace net {
+
+  uint64_t inventory_tracker::add( const item_id& item, fc::time_point_sec now )
+  {
+    auto iter = _sequence_by_item.find( item );
+    if( iter != _sequence_by_item.end() )
+      return iter->second;
+    const uint64_t sequence = _first_sequence + _items.size();
+    _items.push_back( tracked_item{ item, now, false } );
+    _sequence_by_item.insert( std::make_pair( item, sequence ) );
+    return sequence;
+  }
+
+  bool inventory_tracker::find( const item_id& item, uint64_t& sequence ) const
+  {
+    auto iter = _sequence_by_item.find( item );
+    if( iter == _sequence_by_item.end() )
+      return false;
+    sequence = iter->second;
+    return true;
+  }
+
+  void inventory_tracker::expire( fc::time_point_sec oldest_to_keep )
+  {
+    while( !_items.empty() && _items.front().first_seen < oldest_to_keep )
+    {
+      _sequence_by_item.erase( _items.front().item );
+      _items.pop_front();
+      ++_first_sequence;
+    }
+  }
+
+  void inventory_tracker::set_advertised_to_a_peer( uint64_t sequence )
+  {
+    assert( sequence < _first_sequence + _items.size() );
+    // the item may have expired since it was numbered
+    if( sequence >= _first_sequence )
+      _items[ sequence - _first_sequence ].advertised_to_a_peer = true;
+  }
+
+  bool inventory_tracker::was_advertised_to_a_peer( const item_id& item ) const
+  {
+    uint64_t sequence;
+    return find( item, sequence ) && _items[ sequence - _first_sequence ].advertised_to_a_peer;
+  }
+
+  peer_inventory_set::peer_inventory_set( std::shared_ptr<inventory_tracker> tracker ) :
+    _tracker( std::move( tracker ) )
+  {}
+
+  bool peer_inventory_set::contains( const item_id& item ) const
+  {
+    uint64_t sequence;
+    return _tracker->find( item, sequence ) && contains( sequence );
+  }
+
+  bool peer_inventory_set::contains( uint64_t sequence ) const
+  {
+    const uint64_t word = sequence / 64;
+    if( word < _first_word || word >= _first_word + _words.size() )
+      return false;
+    return ( _words[ word - _first_word ] >> ( sequence % 64 ) ) & 1;
+  }
+
+  void peer_inventory_set::insert( const item_id& item, fc::time_point_sec now )
+  {
+    insert( _tracker->add( item, now ) );
+  }
+
+  void peer_inventory_set::insert( uint64_t sequence )
+  {
+    if( sequence < _tracker->first_sequence() )
+      return; // expired since it was numbered
+    const uint64_t word = sequence / 64;
+    if( _words.empty() )
+      _first_word = word;
+    for( ; word < _first_word; --_first_word )
+      _words.push_front( 0 );
+    while( word >= _first_word + _words.size() )
+      _words.push_back( 0 );
+    uint64_t& bits = _words[ word - _first_word ];
+    const uint64_t mask = uint64_t(1) << ( sequence % 64 );
+    if( !( bits & mask ) )
+    {
+      bits |= mask;
+      ++_size;
+    }
+  }
+
+  void peer_inventory_set::erase( const item_id& item )
+  {
+    uint64_t sequence;
+    if( !_tracker->find( item, sequence ) || !contains( sequence ) )
+      return;
+    _words[ sequence / 64 - _first_word ] &= ~( uint64_t(1) << ( sequence % 64 ) );
+    --_size;
+  }
+
+  void peer_inventory_set::expire( fc::time_point_sec oldest_to_keep )
+  {
+    _tracker->expire( oldest_to_keep );
+    const uint64_t first_sequence = _tracker->first_sequence();
+    const uint64_t first_word = first_sequence / 64;
+    while( !_words.empty() && _first_word < first_word )
+    {
+      _size -= std::bitset<64>( _words.front() ).count();
+      _words.pop_front();
+      ++_first_word;
+    }
+    if( _words.empty() )
+    {
+      _first_word = first_word;
+      return;
+    }
+    // the first word may still hold some expired items
+    if( _first_word == first_word && first_sequence % 64 )
+    {
+      const uint64_t expired_bits = _words.front() & ( ( uint64_t(1) << ( first_sequence % 64 ) ) - 1 );
+      _size -= std::bitset<64>( expired_bits ).count();
+      _words.front() &= ~expired_bits;
+    }
+  }
+
+} } // graphene::net
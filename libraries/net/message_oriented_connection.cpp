@@ -73,12 +73,13 @@ namespace graphene { namespace net {
       void accept();
       void connect_to(const fc::ip::endpoint& remote_endpoint);
       void bind(const fc::ip::endpoint& local_endpoint);
+      void set_crypto_thread(fc::thread* crypto_thread) { _sock.set_crypto_thread(crypto_thread); }
 
       message_oriented_connection_impl(message_oriented_connection* self,
                                        message_oriented_connection_delegate* delegate = nullptr);
       ~message_oriented_connection_impl();
 
-      void send_message(const message& message_to_send);
+      void send_message(const packed_message& message_to_send);
       void close_connection();
       void destroy_connection();
 
@@ -167,7 +168,7 @@ namespace graphene { namespace net {
           std::copy(buffer + sizeof(message_header), buffer + sizeof(buffer), m.data.begin());
           if (remaining_bytes_with_padding)
           {
-            _sock.read(&m.data[LEFTOVER], remaining_bytes_with_padding);
+            _sock.read_decrypted(&m.data[LEFTOVER], remaining_bytes_with_padding);
             _bytes_received += remaining_bytes_with_padding;
           }
           m.data.resize(m.size); // truncate off the padding bytes
@@ -226,7 +227,7 @@ namespace graphene { namespace net {
         throw *exception_to_rethrow;
     }
 
-    void message_oriented_connection_impl::send_message(const message& message_to_send)
+    void message_oriented_connection_impl::send_message(const packed_message& message_to_send)
     {
       VERIFY_CORRECT_THREAD();
 #if 0 // this gets too verbose
@@ -255,15 +256,12 @@ namespace graphene { namespace net {
 
       try
       {
-        size_t size_of_message_and_header = sizeof(message_header) + message_to_send.size;
-        if( message_to_send.size > MAX_MESSAGE_SIZE )
+        FC_ASSERT( message_to_send.buffer, "trying to send an empty packed message" );
+        const size_t size_with_padding = message_to_send.size();
+        if( reinterpret_cast<const message_header*>(message_to_send.buffer->data())->size > MAX_MESSAGE_SIZE )
            elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
-        //pad the message we send to a multiple of 16 bytes
-        size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::unique_ptr<char[]> padded_message(new char[size_with_padding]);
-        memcpy(padded_message.get(), (char*)&message_to_send, sizeof(message_header));
-        memcpy(padded_message.get() + sizeof(message_header), message_to_send.data.data(), message_to_send.size );
-        _sock.write(padded_message.get(), size_with_padding);
+        // the buffer may be shared with the send queues of other connections, it is only read from here
+        _sock.write_encrypted(std::shared_ptr<const char>(message_to_send.buffer, message_to_send.buffer->data()), size_with_padding);
         _sock.flush();
         _bytes_sent += size_with_padding;
         _last_message_sent_time = fc::time_point::now();
@@ -366,7 +364,17 @@ namespace graphene { namespace net {
     my->bind(local_endpoint);
   }
 
+  void message_oriented_connection::set_crypto_thread(fc::thread* crypto_thread)
+  {
+    my->set_crypto_thread(crypto_thread);
+  }
+
   void message_oriented_connection::send_message(const message& message_to_send)
+  {
+    my->send_message(packed_message(message_to_send));
+  }
+
+  void message_oriented_connection::send_message(const packed_message& message_to_send)
   {
     my->send_message(message_to_send);
   }
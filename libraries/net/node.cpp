@@ -29,6 +29,8 @@
 #include <forward_list>
 #include <iostream>
 #include <algorithm>
+#include <functional>
+#include <array>
 #include <tuple>
 #include <boost/tuple/tuple.hpp>
 #include <boost/circular_buffer.hpp>
@@ -81,6 +83,8 @@
 #include <graphene/chain/config.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
 
+#include <graphene/utilities/cpu_affinity.hpp>
+
 #include <fc/git_revision.hpp>
 
 //#define ENABLE_DEBUG_ULOGS
@@ -139,6 +143,9 @@ namespace graphene { namespace net {
       {
         message_hash_type message_hash;
         message           message_body;
+        packed_message    packed_body; // packed once here, shared by the send queues of all peers it goes to
+        // for a block, its compact_block_message, packed the first time a peer fetches it and shared the same way
+        mutable packed_message packed_compact_block;
         uint32_t          block_clock_when_received;
 
         // for network performance stats
@@ -152,6 +159,7 @@ namespace graphene { namespace net {
                       fc::uint160_t            message_contents_hash ) :
           message_hash( message_hash ),
           message_body( message_body ),
+          packed_body( message_body ),
           block_clock_when_received( block_clock_when_received ),
           propagation_data( propagation_data ),
           message_contents_hash( message_contents_hash )
@@ -179,7 +187,23 @@ namespace graphene { namespace net {
       void cache_message( const message& message_to_cache, const message_hash_type& hash_of_message_to_cache,
                         const message_propagation_data& propagation_data, const fc::uint160_t& message_content_hash );
       message get_message( const message_hash_type& hash_of_message_to_lookup );
+      /// @return the cached message with the given hash, it's only valid until the cache is next changed
+      const message* find_message( const message_hash_type& hash_of_message_to_lookup ) const;
+      /// @return the packed form of the cached message with the given hash, if any
+      fc::optional<packed_message> find_packed_message( const message_hash_type& hash_of_message_to_lookup ) const;
+      /// @return the id of the cached block message with the given hash, if any
+      fc::optional<block_id_type> find_block_id( const message_hash_type& hash_of_message_to_lookup ) const;
+      /**
+       * @return the compact_block_message of the cached block message with the given hash, if any; it is built on
+       * the first call only, later calls return the same buffer
+       */
+      fc::optional<packed_message> find_packed_compact_block( const message_hash_type& hash_of_message_to_lookup ) const;
+      /// @return the packed form of a cached message of the given type with the given contents hash, if any
+      fc::optional<packed_message> find_packed_message_by_contents( const fc::uint160_t& hash_of_message_contents_to_lookup,
+                                                                   uint32_t msg_type ) const;
       message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
+      /// @return the cached transaction with the given id, if any
+      fc::optional<signed_transaction> find_transaction( const transaction_id_type& id ) const;
       size_t size() const { return _message_cache.size(); }
     };
 
@@ -212,6 +236,61 @@ namespace graphene { namespace net {
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
     }
 
+    const message* blockchain_tied_message_cache::find_message( const message_hash_type& hash_of_message_to_lookup ) const
+    {
+      auto iter = _message_cache.get<message_hash_index>().find( hash_of_message_to_lookup );
+      if( iter != _message_cache.get<message_hash_index>().end() )
+        return &iter->message_body;
+      return nullptr;
+    }
+
+    fc::optional<packed_message> blockchain_tied_message_cache::find_packed_message( const message_hash_type& hash_of_message_to_lookup ) const
+    {
+      auto iter = _message_cache.get<message_hash_index>().find( hash_of_message_to_lookup );
+      if( iter != _message_cache.get<message_hash_index>().end() )
+        return iter->packed_body;
+      return fc::optional<packed_message>();
+    }
+
+    fc::optional<block_id_type> blockchain_tied_message_cache::find_block_id( const message_hash_type& hash_of_message_to_lookup ) const
+    {
+      auto iter = _message_cache.get<message_hash_index>().find( hash_of_message_to_lookup );
+      if( iter != _message_cache.get<message_hash_index>().end() && iter->message_body.msg_type == block_message_type )
+        return block_id_type( iter->message_contents_hash );
+      return fc::optional<block_id_type>();
+    }
+
+    fc::optional<packed_message> blockchain_tied_message_cache::find_packed_compact_block( const message_hash_type& hash_of_message_to_lookup ) const
+    {
+      auto iter = _message_cache.get<message_hash_index>().find( hash_of_message_to_lookup );
+      if( iter == _message_cache.get<message_hash_index>().end() || iter->message_body.msg_type != block_message_type )
+        return fc::optional<packed_message>();
+      if( !iter->packed_compact_block.buffer )
+      {
+        const graphene::net::block_message full_block = iter->message_body.as<graphene::net::block_message>();
+        compact_block_message compact;
+        compact.block_message_hash = hash_of_message_to_lookup;
+        compact.header = full_block.block;
+        compact.transactions.reserve(full_block.block.transactions.size());
+        for (const processed_transaction& trx : full_block.block.transactions)
+          compact.transactions.push_back(compact_block_message::compact_transaction{trx.id(), trx.operation_results});
+        iter->packed_compact_block = packed_message(message(compact));
+      }
+      return iter->packed_compact_block;
+    }
+
+    fc::optional<packed_message> blockchain_tied_message_cache::find_packed_message_by_contents( const fc::uint160_t& hash_of_message_contents_to_lookup,
+                                                                                                uint32_t msg_type ) const
+    {
+      auto range = _message_cache.get<message_contents_hash_index>().equal_range( hash_of_message_contents_to_lookup );
+      for( auto iter = range.first; iter != range.second; ++iter )
+      {
+        if( iter->message_body.msg_type == msg_type )
+          return iter->packed_body;
+      }
+      return fc::optional<packed_message>();
+    }
+
     message_propagation_data blockchain_tied_message_cache::get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const
     {
       if( hash_of_message_contents_to_lookup != fc::uint160_t() )
@@ -224,6 +303,17 @@ namespace graphene { namespace net {
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
     }
 
+    fc::optional<signed_transaction> blockchain_tied_message_cache::find_transaction( const transaction_id_type& id ) const
+    {
+      auto range = _message_cache.get<message_contents_hash_index>().equal_range( id );
+      for( auto iter = range.first; iter != range.second; ++iter )
+      {
+        if( iter->message_body.msg_type == trx_message_type )
+          return iter->message_body.as<trx_message>().trx;
+      }
+      return fc::optional<signed_transaction>();
+    }
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     // This specifies configuration info for the local node.  It's stored as JSON
@@ -277,12 +367,18 @@ namespace graphene { namespace net { namespace detail {
     };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // upper bounds in microseconds of the buckets of the delegate call latency histograms, the last bucket is unbounded
+    const int64_t call_latency_bucket_limits[] = { 100, 1000, 10000, 100000, 500000, 1000000 };
+
     class statistics_gathering_node_delegate_wrapper : public node_delegate
     {
     private:
       node_delegate *_node_delegate;
       fc::thread *_thread;
 
+      // number of calls by total duration (delays included), bucket i holds the calls shorter than call_latency_bucket_limits[i]
+      typedef std::array<uint64_t, sizeof(call_latency_bucket_limits) / sizeof(call_latency_bucket_limits[0]) + 1> call_latency_histogram;
+
       typedef boost::accumulators::accumulator_set<int64_t, boost::accumulators::stats<boost::accumulators::tag::min,
                                                                                        boost::accumulators::tag::rolling_mean,
                                                                                        boost::accumulators::tag::max,
@@ -291,6 +387,7 @@ namespace graphene { namespace net { namespace detail {
 #define NODE_DELEGATE_METHOD_NAMES (has_item) \
                                    (handle_message) \
                                    (handle_block) \
+                                   (prepare_sync_blocks) \
                                    (handle_transaction) \
                                    (get_block_ids) \
                                    (get_item) \
@@ -309,7 +406,8 @@ namespace graphene { namespace net { namespace detail {
 #define DECLARE_ACCUMULATOR(r, data, method_name) \
       mutable call_stats_accumulator BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _execution_accumulator)); \
       mutable call_stats_accumulator BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _delay_before_accumulator)); \
-      mutable call_stats_accumulator BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _delay_after_accumulator));
+      mutable call_stats_accumulator BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _delay_after_accumulator)); \
+      mutable call_latency_histogram BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _latency_histogram));
       BOOST_PP_SEQ_FOR_EACH(DECLARE_ACCUMULATOR, unused, NODE_DELEGATE_METHOD_NAMES)
 #undef DECLARE_ACCUMULATOR
 
@@ -323,6 +421,7 @@ namespace graphene { namespace net { namespace detail {
         call_stats_accumulator* _execution_accumulator;
         call_stats_accumulator* _delay_before_accumulator;
         call_stats_accumulator* _delay_after_accumulator;
+        call_latency_histogram* _latency_histogram;
       public:
         class actual_execution_measurement_helper
         {
@@ -341,12 +440,14 @@ namespace graphene { namespace net { namespace detail {
         call_statistics_collector(const char* method_name,
                                   call_stats_accumulator* execution_accumulator,
                                   call_stats_accumulator* delay_before_accumulator,
-                                  call_stats_accumulator* delay_after_accumulator) :
+                                  call_stats_accumulator* delay_after_accumulator,
+                                  call_latency_histogram* latency_histogram) :
           _call_requested_time(fc::time_point::now()),
           _method_name(method_name),
           _execution_accumulator(execution_accumulator),
           _delay_before_accumulator(delay_before_accumulator),
-          _delay_after_accumulator(delay_after_accumulator)
+          _delay_after_accumulator(delay_after_accumulator),
+          _latency_histogram(latency_histogram)
         {}
         ~call_statistics_collector()
         {
@@ -358,6 +459,8 @@ namespace graphene { namespace net { namespace detail {
           (*_execution_accumulator)(actual_execution_time.count());
           (*_delay_before_accumulator)(delay_before.count());
           (*_delay_after_accumulator)(delay_after.count());
+          ++(*_latency_histogram)[std::upper_bound(std::begin(call_latency_bucket_limits), std::end(call_latency_bucket_limits),
+                                                   total_duration.count()) - std::begin(call_latency_bucket_limits)];
           if (total_duration > fc::milliseconds(500))
           {
             ilog("Call to method node_delegate::${method} took ${total_duration}us, longer than our target maximum of 500ms",
@@ -387,7 +490,8 @@ namespace graphene { namespace net { namespace detail {
       bool has_item( const net::item_id& id ) override;
       void handle_message( const message& ) override;
       bool handle_block( const graphene::net::block_message& block_message, bool sync_mode, std::vector<fc::uint160_t>& contained_transaction_message_ids ) override;
-      void handle_transaction( const graphene::net::trx_message& transaction_message ) override;
+      void prepare_sync_blocks( const std::vector<const graphene::net::block_message*>& blocks ) override;
+      void handle_transaction( graphene::net::trx_message&& transaction_message ) override;
       std::vector<item_hash_t> get_block_ids(const std::vector<item_hash_t>& blockchain_synopsis,
                                              uint32_t& remaining_item_count,
                                              uint32_t limit = 2000) override;
@@ -413,6 +517,11 @@ namespace graphene { namespace net { namespace detail {
 #ifdef P2P_IN_DEDICATED_THREAD
       std::shared_ptr<fc::thread> _thread;
 #endif // P2P_IN_DEDICATED_THREAD
+      /// threads the connections encrypt and decrypt large messages on, assigned round robin
+      std::vector<std::shared_ptr<fc::thread> > _io_threads;
+      uint32_t             _next_io_thread = 0;
+      /// the CPUs the p2p and io threads are restricted to, empty for any
+      std::vector<uint32_t> _cpus;
       std::unique_ptr<statistics_gathering_node_delegate_wrapper> _delegate;
       fc::sha256           _chain_id;
 
@@ -453,6 +562,8 @@ namespace graphene { namespace net { namespace detail {
       active_sync_requests_map              _active_sync_requests; /// list of sync blocks we've asked for from peers but have not yet received
       std::list<graphene::net::block_message> _new_received_sync_items; /// list of sync blocks we've just received but haven't yet tried to process
       std::list<graphene::net::block_message> _received_sync_items; /// list of sync blocks we've received, but can't yet process because we are still missing blocks that come earlier in the chain
+      typedef std::unordered_map<graphene::net::block_id_type, std::list<graphene::net::block_message>::iterator> received_sync_items_index;
+      received_sync_items_index             _received_sync_items_by_id; /// the blocks of both lists above by id
       // @}
 
       fc::future<void> _process_backlog_of_sync_blocks_done;
@@ -481,6 +592,10 @@ namespace graphene { namespace net { namespace detail {
       fc::promise<void>::ptr        _retrigger_advertise_inventory_loop_promise;
       fc::future<void>              _advertise_inventory_loop_done;
       std::unordered_set<item_id>   _new_inventory; /// list of items we have received but not yet advertised to our peers
+      std::shared_ptr<inventory_tracker> _inventory; /// items advertised to and by all peers, see peer_connection::inventory_advertised_to_peer
+      fc::microseconds              _last_advertise_inventory_time; /// time taken by the last iteration of the advertise inventory loop
+      fc::microseconds              _max_advertise_inventory_time;
+      uint32_t                      _last_advertise_inventory_item_count = 0; /// number of new items the last iteration advertised
       // @}
 
       fc::future<void>     _terminate_inactive_connections_loop_done;
@@ -548,6 +663,19 @@ namespace graphene { namespace net { namespace detail {
       boost::circular_buffer<uint32_t> _average_network_write_speed_hours;
       unsigned _average_network_usage_second_counter;
       unsigned _average_network_usage_minute_counter;
+      /** bytes read and written since the node started, as counted by update_bandwidth_data() */
+      uint64_t _total_bytes_read = 0;
+      uint64_t _total_bytes_written = 0;
+
+      /// number and size of the messages of one type sent and received since startup, for network_get_metrics()
+      struct message_type_statistics
+      {
+        uint64_t received_count = 0;
+        uint64_t received_bytes = 0;
+        uint64_t sent_count = 0;
+        uint64_t sent_bytes = 0;
+      };
+      std::map<uint32_t, message_type_statistics> _message_statistics;
 
       fc::time_point_sec _bandwidth_monitor_last_update_time;
       fc::future<void> _bandwidth_monitor_loop_done;
@@ -578,6 +706,10 @@ namespace graphene { namespace net { namespace detail {
       unsigned _maximum_number_of_blocks_to_handle_at_one_time;
       unsigned _maximum_number_of_sync_blocks_to_prefetch;
       unsigned _maximum_blocks_per_peer_during_syncing;
+      unsigned _sync_request_batch_size;
+      /// the transaction relay shaping of each peer, see peer_connection::set_transaction_relay_rate()
+      uint32_t _peer_transaction_relay_rate;
+      uint32_t _peer_transaction_relay_burst;
 
       std::list<fc::future<void> > _handle_message_calls_in_progress;
 
@@ -587,6 +719,8 @@ namespace graphene { namespace net { namespace detail {
       void save_node_configuration();
 
       void p2p_network_connect_loop();
+      /// applies update to the peer database record of the peer, if it has one
+      void update_potential_peer_record(peer_connection* peer, const std::function<void(potential_peer_record&)>& update);
       void trigger_p2p_network_connect_loop();
 
       bool have_already_received_sync_item( const item_hash_t& item_hash );
@@ -689,6 +823,14 @@ namespace graphene { namespace net { namespace detail {
       void process_block_during_normal_operation(peer_connection* originating_peer, const graphene::net::block_message& block_message, const message_hash_type& message_hash);
       void process_block_message(peer_connection* originating_peer, const message& message_to_process, const message_hash_type& message_hash);
 
+      void on_compact_block_message(peer_connection* originating_peer, const compact_block_message& compact_block_message_received);
+      void on_fetch_compact_block_transactions_message(peer_connection* originating_peer,
+                                                       const fetch_compact_block_transactions_message& fetch_message_received);
+      void on_compact_block_transactions_message(peer_connection* originating_peer,
+                                                 const compact_block_transactions_message& transactions_message_received);
+      /// rebuilds the block once every transaction of the compact block is known and processes it like a block_message
+      void complete_compact_block(peer_connection* originating_peer);
+
       void process_ordinary_message(peer_connection* originating_peer, const message& message_to_process, const message_hash_type& message_hash);
 
       void start_synchronizing();
@@ -751,12 +893,19 @@ namespace graphene { namespace net { namespace detail {
       void                       set_allowed_peers( const std::vector<node_id_t>& allowed_peers );
       void                       clear_peer_database();
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
+      void                       set_io_threads( uint32_t num_threads );
+      void                       set_thread_affinity( const std::vector<uint32_t>& cpus );
+      /// creates a connection that uses the next I/O thread, if there are any
+      peer_connection_ptr        create_peer_connection();
       void                       disable_peer_advertising();
       fc::variant_object         get_call_statistics() const;
-      message                    get_message_for_item(const item_id& item) override;
+      packed_message             get_message_for_item(const item_id& item) override;
+      void                       on_message_sent(peer_connection* destination_peer, const packed_message& sent_message) override;
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
+      fc::variant_object         network_get_metrics() const;
+      fc::variant_object         get_inventory_statistics() const;
 
       bool is_hard_fork_block(uint32_t block_number) const;
       uint32_t get_next_known_hard_fork_block_number(uint32_t block_number) const;
@@ -805,6 +954,7 @@ namespace graphene { namespace net { namespace detail {
       _suspend_fetching_sync_blocks(false),
       _items_to_fetch_updated(false),
       _items_to_fetch_sequence_counter(0),
+      _inventory(std::make_shared<inventory_tracker>()),
       _recent_block_interval_in_seconds(GRAPHENE_MAX_BLOCK_INTERVAL),
       _user_agent_string(user_agent),
       _desired_number_of_connections(GRAPHENE_NET_DEFAULT_DESIRED_CONNECTIONS),
@@ -827,7 +977,10 @@ namespace graphene { namespace net { namespace detail {
       _node_is_shutting_down(false),
       _maximum_number_of_blocks_to_handle_at_one_time(MAXIMUM_NUMBER_OF_BLOCKS_TO_HANDLE_AT_ONE_TIME),
       _maximum_number_of_sync_blocks_to_prefetch(MAXIMUM_NUMBER_OF_BLOCKS_TO_PREFETCH),
-      _maximum_blocks_per_peer_during_syncing(GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING)
+      _maximum_blocks_per_peer_during_syncing(GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING),
+      _sync_request_batch_size(GRAPHENE_NET_SYNC_REQUEST_BATCH_SIZE),
+      _peer_transaction_relay_rate(GRAPHENE_NET_DEFAULT_PEER_TRX_RELAY_RATE),
+      _peer_transaction_relay_burst(GRAPHENE_NET_DEFAULT_PEER_TRX_RELAY_BURST)
     {
       _rate_limiter.set_actual_rate_time_constant(fc::seconds(2));
       fc::rand_pseudo_bytes(&_node_id.data[0], (int)_node_id.size());
@@ -923,9 +1076,9 @@ namespace graphene { namespace net { namespace detail {
             bool initiated_connection_this_pass = false;
             _potential_peer_database_updated = false;
 
-            for (peer_database::iterator iter = _potential_peer_db.begin();
-                 iter != _potential_peer_db.end() && is_wanting_new_connections();
-                 ++iter)
+            // try the peers that served us best in the past first
+            std::vector<std::pair<uint32_t, fc::ip::endpoint> > candidates;
+            for (peer_database::iterator iter = _potential_peer_db.begin(); iter != _potential_peer_db.end(); ++iter)
             {
               fc::microseconds delay_until_retry = fc::seconds((iter->number_of_failed_connection_attempts + 1) * _peer_connection_retry_timeout);
 
@@ -934,10 +1087,20 @@ namespace graphene { namespace net { namespace detail {
                     iter->last_connection_disposition != last_connection_rejected &&
                     iter->last_connection_disposition != last_connection_handshaking_failed) ||
                    (fc::time_point::now() - iter->last_connection_attempt_time) > delay_until_retry))
-              {
-                connect_to_endpoint(iter->endpoint);
-                initiated_connection_this_pass = true;
-              }
+                candidates.emplace_back(iter->get_score(), iter->endpoint);
+            }
+            std::stable_sort(candidates.begin(), candidates.end(),
+                             [](const std::pair<uint32_t, fc::ip::endpoint>& a, const std::pair<uint32_t, fc::ip::endpoint>& b) {
+                               return a.first > b.first;
+                             });
+
+            for (auto iter = candidates.begin(); iter != candidates.end() && is_wanting_new_connections(); ++iter)
+            {
+              // connecting can yield, so recheck
+              if (is_connection_to_endpoint_in_progress(iter->second))
+                continue;
+              connect_to_endpoint(iter->second);
+              initiated_connection_this_pass = true;
             }
 
             if (!initiated_connection_this_pass && !_potential_peer_database_updated)
@@ -981,6 +1144,20 @@ namespace graphene { namespace net { namespace detail {
       }// while(!canceled)
     }
 
+    void node_impl::update_potential_peer_record(peer_connection* peer, const std::function<void(potential_peer_record&)>& update)
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::optional<fc::ip::endpoint> endpoint = peer->get_endpoint_for_connecting();
+      if (!endpoint)
+        return;
+      fc::optional<potential_peer_record> updated_peer_record = _potential_peer_db.lookup_entry_for_endpoint(*endpoint);
+      if (updated_peer_record)
+      {
+        update(*updated_peer_record);
+        _potential_peer_db.update_entry(*updated_peer_record);
+      }
+    }
+
     void node_impl::trigger_p2p_network_connect_loop()
     {
       VERIFY_CORRECT_THREAD();
@@ -993,10 +1170,7 @@ namespace graphene { namespace net { namespace detail {
     bool node_impl::have_already_received_sync_item( const item_hash_t& item_hash )
     {
       VERIFY_CORRECT_THREAD();
-      return std::find_if(_received_sync_items.begin(), _received_sync_items.end(),
-                          [&item_hash]( const graphene::net::block_message& message ) { return message.block_id == item_hash; } ) != _received_sync_items.end() ||
-             std::find_if(_new_received_sync_items.begin(), _new_received_sync_items.end(),
-                          [&item_hash]( const graphene::net::block_message& message ) { return message.block_id == item_hash; } ) != _new_received_sync_items.end();                          ;
+      return _received_sync_items_by_id.find(item_hash) != _received_sync_items_by_id.end();
     }
 
     void node_impl::request_sync_item_from_peer( const peer_connection_ptr& peer, const item_hash_t& item_to_request )
@@ -1040,39 +1214,66 @@ namespace graphene { namespace net { namespace detail {
             ASSERT_TASK_NOT_PREEMPTED();
             std::set<item_hash_t> sync_items_to_request;
 
-            // for each idle peer that we're syncing with
+            // the window is every block we've requested or received but not yet passed to the client,
+            // it bounds the memory used by blocks arriving ahead of the ones the client needs next
+            const size_t blocks_in_window = _active_sync_requests.size() + _received_sync_items_by_id.size();
+            size_t window_space = _maximum_number_of_sync_blocks_to_prefetch > blocks_in_window ?
+                                  _maximum_number_of_sync_blocks_to_prefetch - blocks_in_window : 0;
+
+            // the peers we're syncing with that aren't busy fetching item ids or normal items, and have room for more
+            // requests; each one is scanned through its list of items from where the previous round left off
+            std::vector<std::pair<peer_connection_ptr, unsigned> > peers_to_request_from;
             for( const peer_connection_ptr& peer : _active_connections )
             {
               if( peer->we_need_sync_items_from_peer &&
-                  sync_item_requests_to_send.find(peer) == sync_item_requests_to_send.end() && // if we've already scheduled a request for this peer, don't consider scheduling another
-                  peer->idle() )
+                  !peer->inhibit_fetching_sync_blocks &&
+                  !peer->item_ids_requested_from_peer &&
+                  peer->items_requested_from_peer.empty() &&
+                  peer->sync_items_requested_from_peer.size() < _maximum_blocks_per_peer_during_syncing )
+                peers_to_request_from.push_back( std::make_pair( peer, 0u ) );
+            }
+
+            // hand out batches round robin, so that the lowest blocks we need are spread over all the peers
+            bool scheduled_this_round = true;
+            while( window_space > 0 && scheduled_this_round )
+            {
+              scheduled_this_round = false;
+              for( auto& peer_and_position : peers_to_request_from )
               {
-                if (!peer->inhibit_fetching_sync_blocks)
+                const peer_connection_ptr& peer = peer_and_position.first;
+                unsigned& i = peer_and_position.second;
+                std::vector<item_hash_t>& requests_for_peer = sync_item_requests_to_send[peer];
+                unsigned scheduled_for_peer = 0;
+                // loop through the items it has that we don't yet have on our blockchain
+                for( ; i < peer->ids_of_items_to_get.size() &&
+                       scheduled_for_peer < _sync_request_batch_size &&
+                       window_space > 0 &&
+                       peer->sync_items_requested_from_peer.size() + requests_for_peer.size() < _maximum_blocks_per_peer_during_syncing;
+                     ++i )
                 {
-                  // loop through the items it has that we don't yet have on our blockchain
-                  for( unsigned i = 0; i < peer->ids_of_items_to_get.size(); ++i )
+                  const item_hash_t& item_to_potentially_request = peer->ids_of_items_to_get[i];
+                  // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
+                  if( !have_already_received_sync_item(item_to_potentially_request) && // already got it, but for some reson it's still in our list of items to fetch
+                      sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&  // we have already decided to request it from another peer during this iteration
+                      _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end() ) // we've requested it in a previous iteration and we're still waiting for it to arrive
                   {
-                    item_hash_t item_to_potentially_request = peer->ids_of_items_to_get[i];
-                    // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
-                    if( !have_already_received_sync_item(item_to_potentially_request) && // already got it, but for some reson it's still in our list of items to fetch
-                        sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&  // we have already decided to request it from another peer during this iteration
-                        _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end() ) // we've requested it in a previous iteration and we're still waiting for it to arrive
-                    {
-                      // then schedule a request from this peer
-                      sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
-                      sync_items_to_request.insert( item_to_potentially_request );
-                      if (sync_item_requests_to_send[peer].size() >= _maximum_blocks_per_peer_during_syncing)
-                        break;
-                    }
+                    // then schedule a request from this peer
+                    requests_for_peer.push_back(item_to_potentially_request);
+                    sync_items_to_request.insert( item_to_potentially_request );
+                    ++scheduled_for_peer;
+                    --window_space;
                   }
                 }
+                if( scheduled_for_peer > 0 )
+                  scheduled_this_round = true;
               }
             }
           } // end non-preemptable section
 
           // make all the requests we scheduled in the loop above
           for( auto sync_item_request : sync_item_requests_to_send )
-            request_sync_items_from_peer( sync_item_request.first, sync_item_request.second );
+            if( !sync_item_request.second.empty() )
+              request_sync_items_from_peer( sync_item_request.first, sync_item_request.second );
           sync_item_requests_to_send.clear();
         }
         else
@@ -1101,7 +1302,7 @@ namespace graphene { namespace net { namespace detail {
     {
       for( const peer_connection_ptr& peer : _active_connections )
       {
-        if (peer->inventory_peer_advertised_to_us.find(item) != peer->inventory_peer_advertised_to_us.end() )
+        if (peer->inventory_peer_advertised_to_us.contains(item))
           return true;
       }
       return false;
@@ -1162,7 +1363,7 @@ namespace graphene { namespace net { namespace detail {
               const peer_connection_ptr& peer = peer_iter->peer;
               // if they have the item and we haven't already decided to ask them for too many other items
               if (peer_iter->item_ids.size() < GRAPHENE_NET_MAX_ITEMS_PER_PEER_DURING_NORMAL_OPERATION &&
-                  peer->inventory_peer_advertised_to_us.find(item_iter->item) != peer->inventory_peer_advertised_to_us.end())
+                  peer->inventory_peer_advertised_to_us.contains(item_iter->item))
               {
                 if (item_iter->item.item_type == graphene::net::trx_message_type && peer->is_transaction_fetching_inhibited())
                   next_peer_unblocked_time = std::min(peer->transaction_fetching_inhibited_until, next_peer_unblocked_time);
@@ -1249,6 +1450,15 @@ namespace graphene { namespace net { namespace detail {
         // we're computing the messages)
         std::list<std::pair<peer_connection_ptr, item_ids_inventory_message> > inventory_messages_to_send;
 
+        // number the new items once in the shared inventory, so checking and marking them
+        // for each peer below is a bit test instead of a hash lookup
+        const fc::time_point start_time = fc::time_point::now();
+        const fc::time_point_sec now(start_time);
+        std::vector<std::pair<item_id, uint64_t> > numbered_inventory_to_advertise;
+        numbered_inventory_to_advertise.reserve(inventory_to_advertise.size());
+        for (const item_id& item_to_advertise : inventory_to_advertise)
+          numbered_inventory_to_advertise.emplace_back(item_to_advertise, _inventory->add(item_to_advertise, now));
+
         for (const peer_connection_ptr& peer : _active_connections)
         {
           // only advertise to peers who are in sync with us
@@ -1261,18 +1471,15 @@ namespace graphene { namespace net { namespace detail {
             // group the items we need to send by type, because we'll need to send one inventory message per type
             unsigned total_items_to_send_to_this_peer = 0;
             p2pddump((inventory_to_advertise));
-            for (const item_id& item_to_advertise : inventory_to_advertise)
+            for (const auto& numbered_item : numbered_inventory_to_advertise)
             {
-              if (peer->inventory_advertised_to_peer.find(item_to_advertise) != peer->inventory_advertised_to_peer.end() )
-                 p2pddump((*peer->inventory_advertised_to_peer.find(item_to_advertise)));
-              if (peer->inventory_peer_advertised_to_us.find(item_to_advertise) != peer->inventory_peer_advertised_to_us.end() )
-                 p2pddump((*peer->inventory_peer_advertised_to_us.find(item_to_advertise)));
-
-              if (peer->inventory_advertised_to_peer.find(item_to_advertise) == peer->inventory_advertised_to_peer.end() &&
-                  peer->inventory_peer_advertised_to_us.find(item_to_advertise) == peer->inventory_peer_advertised_to_us.end())
+              const item_id& item_to_advertise = numbered_item.first;
+              if (!peer->inventory_advertised_to_peer.contains(numbered_item.second) &&
+                  !peer->inventory_peer_advertised_to_us.contains(numbered_item.second))
               {
                 items_to_advertise_by_type[item_to_advertise.item_type].push_back(item_to_advertise.item_hash);
-                peer->inventory_advertised_to_peer.insert(peer_connection::timestamped_item_id(item_to_advertise, fc::time_point::now()));
+                peer->inventory_advertised_to_peer.insert(numbered_item.second);
+                _inventory->set_advertised_to_a_peer(numbered_item.second);
                 ++total_items_to_send_to_this_peer;
                 if (item_to_advertise.item_type == trx_message_type)
                   testnetlog("advertising transaction ${id} to peer ${endpoint}", ("id", item_to_advertise.item_hash)("endpoint", peer->get_remote_endpoint()));
@@ -1293,6 +1500,13 @@ namespace graphene { namespace net { namespace detail {
           iter->first->send_message(iter->second);
         inventory_messages_to_send.clear();
 
+        if (!inventory_to_advertise.empty())
+        {
+          _last_advertise_inventory_time = fc::time_point::now() - start_time;
+          _max_advertise_inventory_time = std::max(_max_advertise_inventory_time, _last_advertise_inventory_time);
+          _last_advertise_inventory_item_count = (uint32_t)inventory_to_advertise.size();
+        }
+
         if (_new_inventory.empty())
         {
           _retrigger_advertise_inventory_loop_promise = fc::promise<void>::ptr(new fc::promise<void>("graphene::net::retrigger_advertise_inventory_loop"));
@@ -1549,6 +1763,8 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
       _average_network_read_speed_seconds.push_back(bytes_read_this_second);
       _average_network_write_speed_seconds.push_back(bytes_written_this_second);
+      _total_bytes_read += bytes_read_this_second;
+      _total_bytes_written += bytes_written_this_second;
       ++_average_network_usage_second_counter;
       if (_average_network_usage_second_counter >= 60)
       {
@@ -1763,6 +1979,9 @@ namespace graphene { namespace net { namespace detail {
     {
       VERIFY_CORRECT_THREAD();
       message_hash_type message_hash = received_message.id();
+      message_type_statistics& statistics = _message_statistics[received_message.msg_type];
+      ++statistics.received_count;
+      statistics.received_bytes += received_message.size;
       dlog("handling message ${type} ${hash} size ${size} from peer ${endpoint}",
            ("type", graphene::net::core_message_type_enum(received_message.msg_type))("hash", message_hash)
            ("size", received_message.size)
@@ -1805,6 +2024,15 @@ namespace graphene { namespace net { namespace detail {
       case core_message_type_enum::block_message_type:
         process_block_message(originating_peer, received_message, message_hash);
         break;
+      case core_message_type_enum::compact_block_message_type:
+        on_compact_block_message(originating_peer, received_message.as<compact_block_message>());
+        break;
+      case core_message_type_enum::fetch_compact_block_transactions_message_type:
+        on_fetch_compact_block_transactions_message(originating_peer, received_message.as<fetch_compact_block_transactions_message>());
+        break;
+      case core_message_type_enum::compact_block_transactions_message_type:
+        on_compact_block_transactions_message(originating_peer, received_message.as<compact_block_transactions_message>());
+        break;
       case core_message_type_enum::current_time_request_message_type:
         on_current_time_request_message(originating_peer, received_message.as<current_time_request_message>());
         break;
@@ -1857,6 +2085,7 @@ namespace graphene { namespace net { namespace detail {
       user_data["bitness"] = uint32_t(sizeof(void*) * 8);
 
       user_data["node_id"] = fc::variant( _node_id, 1 );
+      user_data["compact_blocks"] = true;
 
       item_hash_t head_block_id = _delegate->get_head_block_id();
       user_data["last_known_block_hash"] = fc::variant( head_block_id, 1 );
@@ -1888,6 +2117,8 @@ namespace graphene { namespace net { namespace detail {
         originating_peer->node_id = user_data["node_id"].as<node_id_t>( 1 );
       if (user_data.contains("last_known_fork_block_number"))
         originating_peer->last_known_fork_block_number = user_data["last_known_fork_block_number"].as<uint32_t>( 1 );
+      if (user_data.contains("compact_blocks"))
+        originating_peer->supports_compact_blocks = user_data["compact_blocks"].as_bool();
     }
 
     void node_impl::on_hello_message( peer_connection* originating_peer, const hello_message& hello_message_received )
@@ -2739,21 +2970,21 @@ namespace graphene { namespace net { namespace detail {
       }
     }
 
-    message node_impl::get_message_for_item(const item_id& item)
+    packed_message node_impl::get_message_for_item(const item_id& item)
     {
+      fc::optional<packed_message> cached_message = _message_cache.find_packed_message(item.item_hash);
+      // blocks are queued by block id, which is not the hash of the block message
+      if (!cached_message && item.item_type == block_message_type)
+        cached_message = _message_cache.find_packed_message_by_contents(item.item_hash, block_message_type);
+      if (cached_message)
+        return *cached_message;
       try
       {
-        return _message_cache.get_message(item.item_hash);
+        return packed_message(_delegate->get_item(item));
       }
       catch (fc::key_not_found_exception&)
       {}
-      try
-      {
-        return _delegate->get_item(item);
-      }
-      catch (fc::key_not_found_exception&)
-      {}
-      return item_not_available_message(item);
+      return packed_message(message(item_not_available_message(item)));
     }
 
     void node_impl::on_fetch_items_message(peer_connection* originating_peer, const fetch_items_message& fetch_items_message_received)
@@ -2764,26 +2995,41 @@ namespace graphene { namespace net { namespace detail {
            ("type", fetch_items_message_received.item_type)
            ("endpoint", originating_peer->get_remote_endpoint()));
 
-      fc::optional<message> last_block_message_sent;
+      fc::optional<block_id_type> last_block_id_sent;
 
-      std::list<message> reply_messages;
+      // blocks are queued by id and looked up again when they reach the front of the send queue, everything
+      // else is queued packed.  Messages from the cache are queued with the buffer they were packed in once,
+      // so a transaction fetched by many peers is not copied for each of them
+      struct queued_reply
+      {
+        fc::optional<item_id> item;
+        packed_message        packed;
+      };
+      std::list<queued_reply> reply_messages;
       for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
       {
-        try
+        const message* cached_message = _message_cache.find_message(item_hash);
+        if (cached_message)
         {
-          message requested_message = _message_cache.get_message(item_hash);
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
-               ("id", requested_message.id()));
-          reply_messages.push_back(requested_message);
-          if (fetch_items_message_received.item_type == block_message_type)
-            last_block_message_sent = requested_message;
+               ("id", item_hash));
+          if (fetch_items_message_received.item_type == block_message_type && cached_message->msg_type == block_message_type)
+          {
+            const block_id_type block_id = *_message_cache.find_block_id(item_hash);
+            last_block_id_sent = block_id;
+            // the block was broadcast recently, so the peer has most likely seen its transactions already.  The
+            // compact block is built for the first peer asking and shared with the others
+            if (originating_peer->supports_compact_blocks)
+              reply_messages.push_back(queued_reply{fc::optional<item_id>(), *_message_cache.find_packed_compact_block(item_hash)});
+            else
+              reply_messages.push_back(queued_reply{item_id(block_message_type, block_id), packed_message()});
+          }
+          else
+            reply_messages.push_back(queued_reply{fc::optional<item_id>(), *_message_cache.find_packed_message(item_hash)});
           continue;
         }
-        catch (fc::key_not_found_exception&)
-        {
-           // it wasn't in our local cache, that's ok ask the client
-        }
+        // it wasn't in our local cache, that's ok ask the client
 
         item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
         try
@@ -2793,33 +3039,37 @@ namespace graphene { namespace net { namespace detail {
                ("id", requested_message.id())
                ("size", requested_message.size)
                ("endpoint", originating_peer->get_remote_endpoint()));
-          reply_messages.push_back(requested_message);
-          if (fetch_items_message_received.item_type == block_message_type)
-            last_block_message_sent = requested_message;
+          if (requested_message.msg_type == block_message_type)
+          {
+            const block_id_type block_id = requested_message.as<graphene::net::block_message>().block_id;
+            last_block_id_sent = block_id;
+            reply_messages.push_back(queued_reply{item_id(block_message_type, block_id), packed_message()});
+          }
+          else
+            reply_messages.push_back(queued_reply{fc::optional<item_id>(), packed_message(requested_message)});
           continue;
         }
         catch (fc::key_not_found_exception&)
         {
-          reply_messages.push_back(item_not_available_message(item_to_fetch));
+          reply_messages.push_back(queued_reply{fc::optional<item_id>(), packed_message(message(item_not_available_message(item_to_fetch)))});
           dlog("received item request from peer ${endpoint} but we don't have it",
                ("endpoint", originating_peer->get_remote_endpoint()));
         }
       }
 
       // if we sent them a block, update our record of the last block they've seen accordingly
-      if (last_block_message_sent)
+      if (last_block_id_sent)
       {
-        graphene::net::block_message block = last_block_message_sent->as<graphene::net::block_message>();
-        originating_peer->last_block_delegate_has_seen = block.block_id;
-        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
+        originating_peer->last_block_delegate_has_seen = *last_block_id_sent;
+        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(*last_block_id_sent);
       }
 
-      for (const message& reply : reply_messages)
+      for (const queued_reply& reply : reply_messages)
       {
-        if (reply.msg_type == block_message_type)
-          originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+        if (reply.item)
+          originating_peer->send_item(*reply.item);
         else
-          originating_peer->send_message(reply);
+          originating_peer->send_message(reply.packed);
       }
     }
 
@@ -2870,18 +3120,15 @@ namespace graphene { namespace net { namespace detail {
       for( const item_hash_t& item_hash : item_ids_inventory_message_received.item_hashes_available )
       {
         item_id advertised_item_id(item_ids_inventory_message_received.item_type, item_hash);
-        bool we_advertised_this_item_to_a_peer = false;
+        bool we_advertised_this_item_to_a_peer = _inventory->was_advertised_to_a_peer(advertised_item_id);
         bool we_requested_this_item_from_a_peer = false;
-        for (const peer_connection_ptr peer : _active_connections)
-        {
-          if (peer->inventory_advertised_to_peer.find(advertised_item_id) != peer->inventory_advertised_to_peer.end())
-          {
-            we_advertised_this_item_to_a_peer = true;
-            break;
-          }
-          if (peer->items_requested_from_peer.find(advertised_item_id) != peer->items_requested_from_peer.end())
-            we_requested_this_item_from_a_peer = true;
-        }
+        if (!we_advertised_this_item_to_a_peer)
+          for (const peer_connection_ptr peer : _active_connections)
+            if (peer->items_requested_from_peer.find(advertised_item_id) != peer->items_requested_from_peer.end())
+            {
+              we_requested_this_item_from_a_peer = true;
+              break;
+            }
 
         // if we have already advertised it to a peer, we must have it, no need to do anything else
         if (!we_advertised_this_item_to_a_peer)
@@ -2893,7 +3140,7 @@ namespace graphene { namespace net { namespace detail {
                originating_peer->is_inventory_advertised_to_us_list_full_for_transactions()) ||
               originating_peer->is_inventory_advertised_to_us_list_full())
             break;
-          originating_peer->inventory_peer_advertised_to_us.insert(peer_connection::timestamped_item_id(advertised_item_id, fc::time_point::now()));
+          originating_peer->inventory_peer_advertised_to_us.insert(advertised_item_id, fc::time_point::now());
           if (!we_requested_this_item_from_a_peer)
           {
             if (_recently_failed_items.find(item_id(item_ids_inventory_message_received.item_type, item_hash)) != _recently_failed_items.end())
@@ -2989,6 +3236,9 @@ namespace graphene { namespace net { namespace detail {
           if (updated_peer_record)
           {
             updated_peer_record->last_seen_time = fc::time_point::now();
+            fc::microseconds connection_duration = fc::time_point::now() - originating_peer->get_connection_time();
+            if (connection_duration >= fc::seconds(GRAPHENE_NET_PEER_SCORE_MIN_CONNECTION_TIME_SEC))
+              updated_peer_record->add_download_speed_sample(originating_peer->get_total_bytes_received() * 1000000 / connection_duration.count());
             _potential_peer_db.update_entry(*updated_peer_record);
           }
         }
@@ -3258,86 +3508,102 @@ namespace graphene { namespace net { namespace detail {
       std::set<peer_connection_ptr> peers_we_need_to_sync_to;
       std::map<peer_connection_ptr, fc::oexception> peers_with_rejected_block;
 
+      // let the client do the work which doesn't depend on the chain state, e.g. recovering the witness keys,
+      // for the whole backlog at once rather than block by block
+      _received_sync_items.splice(_received_sync_items.begin(), _new_received_sync_items);
+      std::vector<const graphene::net::block_message*> blocks_to_prepare;
+      for (const graphene::net::block_message& received_block : _received_sync_items)
+        if (!received_block.block.precomputed_signee.valid())
+          blocks_to_prepare.push_back(&received_block);
+      if (blocks_to_prepare.size() > 1)
+        _delegate->prepare_sync_blocks(blocks_to_prepare);
+
       do
       {
-        std::copy(std::make_move_iterator(_new_received_sync_items.begin()),
-                  std::make_move_iterator(_new_received_sync_items.end()),
-                  std::front_inserter(_received_sync_items));
-        _new_received_sync_items.clear();
+        // splicing keeps the iterators in _received_sync_items_by_id valid
+        _received_sync_items.splice(_received_sync_items.begin(), _new_received_sync_items);
         dlog("currently ${count} sync items to consider", ("count", _received_sync_items.size()));
 
         block_processed_this_iteration = false;
-        for (auto received_block_iter = _received_sync_items.begin();
-             received_block_iter != _received_sync_items.end();
-             ++received_block_iter)
+
+        // the next block on the active chain or one of the forks is at the front of a peer's list of items,
+        // so look those up rather than searching the blocks we have on hand
+        received_sync_items_index::iterator next_block_iter = _received_sync_items_by_id.end();
+        for (const peer_connection_ptr& peer : _active_connections)
         {
+          ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
+          if (!peer->ids_of_items_to_get.empty())
+          {
+            next_block_iter = _received_sync_items_by_id.find(peer->ids_of_items_to_get.front());
+            if (next_block_iter != _received_sync_items_by_id.end())
+              break;
+          }
+        }
 
-          // find out if this block is the next block on the active chain or one of the forks
-          bool potential_first_block = false;
+        // if there is one, process it, remove it from all sync peers lists
+        if (next_block_iter != _received_sync_items_by_id.end())
+        {
+          std::list<graphene::net::block_message>::iterator received_block_iter = next_block_iter->second;
+          const graphene::net::block_id_type next_block_id = received_block_iter->block_id;
           for (const peer_connection_ptr& peer : _active_connections)
           {
             ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
             if (!peer->ids_of_items_to_get.empty() &&
-                peer->ids_of_items_to_get.front() == received_block_iter->block_id)
+                peer->ids_of_items_to_get.front() == next_block_id)
             {
-              potential_first_block = true;
               peer->ids_of_items_to_get.pop_front();
-              peer->ids_of_items_being_processed.insert(received_block_iter->block_id);
+              peer->ids_of_items_being_processed.insert(next_block_id);
             }
           }
 
-          // if it is, process it, remove it from all sync peers lists
-          if (potential_first_block)
+          graphene::net::block_message block_message_to_process = std::move(*received_block_iter);
+          _received_sync_items_by_id.erase(next_block_iter);
+          _received_sync_items.erase(received_block_iter);
+          block_processed_this_iteration = true;
+
+          // we can get into an interesting situation near the end of synchronization.  We can be in
+          // sync with one peer who is sending us the last block on the chain via a regular inventory
+          // message, while at the same time still be synchronizing with a peer who is sending us the
+          // block through the sync mechanism.  Further, we must request both blocks because
+          // we don't know they're the same (for the peer in normal operation, it has only told us the
+          // message id, for the peer in the sync case we only known the block_id).
+          if (std::find(_most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
+                        next_block_id) == _most_recent_blocks_accepted.end())
           {
-            // we can get into an interesting situation near the end of synchronization.  We can be in
-            // sync with one peer who is sending us the last block on the chain via a regular inventory
-            // message, while at the same time still be synchronizing with a peer who is sending us the
-            // block through the sync mechanism.  Further, we must request both blocks because
-            // we don't know they're the same (for the peer in normal operation, it has only told us the
-            // message id, for the peer in the sync case we only known the block_id).
-            if (std::find(_most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
-                          received_block_iter->block_id) == _most_recent_blocks_accepted.end())
-            {
-              graphene::net::block_message block_message_to_process = *received_block_iter;
-              _received_sync_items.erase(received_block_iter);
-              _handle_message_calls_in_progress.emplace_back(fc::async([this, block_message_to_process](){
-                send_sync_block_to_node_delegate(block_message_to_process);
-              }, "send_sync_block_to_node_delegate"));
-              ++blocks_processed;
-              block_processed_this_iteration = true;
-            }
-            else
+            _handle_message_calls_in_progress.emplace_back(fc::async([this, block_message_to_process](){
+              send_sync_block_to_node_delegate(block_message_to_process);
+            }, "send_sync_block_to_node_delegate"));
+            ++blocks_processed;
+          }
+          else
+          {
+            dlog("Already received and accepted this block (presumably through normal inventory mechanism), treating it as accepted");
+            std::vector< peer_connection_ptr > peers_needing_next_batch;
+            for (const peer_connection_ptr& peer : _active_connections)
             {
-              dlog("Already received and accepted this block (presumably through normal inventory mechanism), treating it as accepted");
-              std::vector< peer_connection_ptr > peers_needing_next_batch;
-              for (const peer_connection_ptr& peer : _active_connections)
+              auto items_being_processed_iter = peer->ids_of_items_being_processed.find(next_block_id);
+              if (items_being_processed_iter != peer->ids_of_items_being_processed.end())
               {
-                auto items_being_processed_iter = peer->ids_of_items_being_processed.find(received_block_iter->block_id);
-                if (items_being_processed_iter != peer->ids_of_items_being_processed.end())
+                peer->ids_of_items_being_processed.erase(items_being_processed_iter);
+                dlog("Removed item from ${endpoint}'s list of items being processed, still processing ${len} blocks",
+                     ("endpoint", peer->get_remote_endpoint())("len", peer->ids_of_items_being_processed.size()));
+
+                // if we just processed the last item in our list from this peer, we will want to
+                // send another request to find out if we are now in sync (this is normally handled in
+                // send_sync_block_to_node_delegate)
+                if (peer->ids_of_items_to_get.empty() &&
+                    peer->number_of_unfetched_item_ids == 0 &&
+                    peer->ids_of_items_being_processed.empty())
                 {
-                  peer->ids_of_items_being_processed.erase(items_being_processed_iter);
-                  dlog("Removed item from ${endpoint}'s list of items being processed, still processing ${len} blocks",
-                       ("endpoint", peer->get_remote_endpoint())("len", peer->ids_of_items_being_processed.size()));
-
-                  // if we just processed the last item in our list from this peer, we will want to
-                  // send another request to find out if we are now in sync (this is normally handled in
-                  // send_sync_block_to_node_delegate)
-                  if (peer->ids_of_items_to_get.empty() &&
-                      peer->number_of_unfetched_item_ids == 0 &&
-                      peer->ids_of_items_being_processed.empty())
-                  {
-                    dlog("We received last item in our list for peer ${endpoint}, setup to do a sync check", ("endpoint", peer->get_remote_endpoint()));
-                    peers_needing_next_batch.push_back( peer );
-                  }
+                  dlog("We received last item in our list for peer ${endpoint}, setup to do a sync check", ("endpoint", peer->get_remote_endpoint()));
+                  peers_needing_next_batch.push_back( peer );
                 }
               }
-              for( const peer_connection_ptr& peer : peers_needing_next_batch )
-                fetch_next_batch_of_item_ids_from_peer(peer.get());
             }
-
-            break; // start iterating _received_sync_items from the beginning
-          } // end if potential_first_block
-        } // end for each block in _received_sync_items
+            for( const peer_connection_ptr& peer : peers_needing_next_batch )
+              fetch_next_batch_of_item_ids_from_peer(peer.get());
+          }
+        } // end if there is a next block
 
         if (_handle_message_calls_in_progress.size() >= _maximum_number_of_blocks_to_handle_at_one_time)
         {
@@ -3372,7 +3638,11 @@ namespace graphene { namespace net { namespace detail {
 
       // add it to the front of _received_sync_items, then process _received_sync_items to try to
       // pass as many messages as possible to the client.
-      _new_received_sync_items.push_front( block_message_to_process );
+      if (_received_sync_items_by_id.find(block_message_to_process.block_id) == _received_sync_items_by_id.end())
+      {
+        _new_received_sync_items.push_front( block_message_to_process );
+        _received_sync_items_by_id[block_message_to_process.block_id] = _new_received_sync_items.begin();
+      }
       trigger_process_backlog_of_sync_blocks();
     }
 
@@ -3407,6 +3677,12 @@ namespace graphene { namespace net { namespace detail {
                 ("id", block_message_to_process.block_id));
           _most_recent_blocks_accepted.push_back(block_message_to_process.block_id);
 
+          // this peer was the first to bring us the block
+          const fc::microseconds delivery_delay = message_receive_time - fc::time_point(block_message_to_process.block.timestamp);
+          update_potential_peer_record(originating_peer, [&delivery_delay](potential_peer_record& record) {
+            record.add_block_delivery_delay_sample(delivery_delay);
+          });
+
           bool new_transaction_discovered = false;
           for (const item_hash_t& transaction_message_hash : contained_transaction_message_ids)
           {
@@ -3439,8 +3715,7 @@ namespace graphene { namespace net { namespace detail {
         {
           ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
 
-          auto iter = peer->inventory_peer_advertised_to_us.find(block_message_item_id);
-          if (iter != peer->inventory_peer_advertised_to_us.end())
+          if (peer->inventory_peer_advertised_to_us.contains(block_message_item_id))
           {
             // this peer offered us the item.  It will eventually expire from the peer's
             // inventory_peer_advertised_to_us list after some time has passed (currently 2 minutes).
@@ -3523,6 +3798,145 @@ namespace graphene { namespace net { namespace detail {
         disconnect_from_peer(peer.get(), disconnect_reason, true, *disconnect_exception);
       }
     }
+    void node_impl::on_compact_block_message(peer_connection* originating_peer, const compact_block_message& compact_block_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_id block_item(block_message_type, compact_block_message_received.block_message_hash);
+      if (originating_peer->items_requested_from_peer.find(block_item) == originating_peer->items_requested_from_peer.end())
+      {
+        wlog("received a compact block ${hash} I didn't ask for from peer ${endpoint}, ignoring it",
+             ("hash", compact_block_message_received.block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+        return;
+      }
+
+      // a newer compact block replaces any one still being completed, which will time out and be fetched again
+      peer_connection::partial_compact_block partial;
+      partial.compact = compact_block_message_received;
+      partial.transactions.resize(compact_block_message_received.transactions.size());
+      fetch_compact_block_transactions_message missing;
+      missing.block_message_hash = compact_block_message_received.block_message_hash;
+      for (uint32_t i = 0; i < partial.transactions.size(); ++i)
+      {
+        fc::optional<signed_transaction> trx = _message_cache.find_transaction(compact_block_message_received.transactions[i].id);
+        if (trx)
+        {
+          processed_transaction ptrx(*trx);
+          ptrx.operation_results = compact_block_message_received.transactions[i].operation_results;
+          partial.transactions[i] = std::move(ptrx);
+        }
+        else
+          missing.transaction_indexes.push_back(i);
+      }
+      originating_peer->compact_block_being_completed = std::move(partial);
+
+      if (missing.transaction_indexes.empty())
+        complete_compact_block(originating_peer);
+      else
+      {
+        dlog("fetching ${n} of ${total} transactions of compact block ${hash} from peer ${endpoint}",
+             ("n", missing.transaction_indexes.size())("total", compact_block_message_received.transactions.size())
+             ("hash", compact_block_message_received.block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+        originating_peer->send_message(missing);
+      }
+    }
+
+    void node_impl::on_fetch_compact_block_transactions_message(peer_connection* originating_peer,
+                                                                const fetch_compact_block_transactions_message& fetch_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_id block_item(block_message_type, fetch_message_received.block_message_hash);
+      message block_message_found;
+      try
+      {
+        block_message_found = _message_cache.get_message(fetch_message_received.block_message_hash);
+      }
+      catch (fc::key_not_found_exception&)
+      {
+        // the block has dropped out of the cache since we sent the compact block, let the peer fetch it elsewhere
+        originating_peer->send_message(item_not_available_message(block_item));
+        return;
+      }
+
+      const graphene::net::block_message full_block = block_message_found.as<graphene::net::block_message>();
+      compact_block_transactions_message reply;
+      reply.block_message_hash = fetch_message_received.block_message_hash;
+      reply.transactions.reserve(fetch_message_received.transaction_indexes.size());
+      for (uint32_t index : fetch_message_received.transaction_indexes)
+      {
+        if (index >= full_block.block.transactions.size())
+        {
+          originating_peer->send_message(item_not_available_message(block_item));
+          return;
+        }
+        reply.transactions.push_back(full_block.block.transactions[index]);
+      }
+      originating_peer->send_message(reply);
+    }
+
+    void node_impl::on_compact_block_transactions_message(peer_connection* originating_peer,
+                                                          const compact_block_transactions_message& transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      if (!originating_peer->compact_block_being_completed ||
+          originating_peer->compact_block_being_completed->compact.block_message_hash != transactions_message_received.block_message_hash)
+      {
+        wlog("received transactions of compact block ${hash} I'm not completing from peer ${endpoint}, ignoring them",
+             ("hash", transactions_message_received.block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+        return;
+      }
+
+      peer_connection::partial_compact_block& partial = *originating_peer->compact_block_being_completed;
+      auto next_transaction = transactions_message_received.transactions.begin();
+      for (uint32_t i = 0; i < partial.transactions.size() && next_transaction != transactions_message_received.transactions.end(); ++i)
+      {
+        if (partial.all_transactions_requested || !partial.transactions[i])
+          partial.transactions[i] = *next_transaction++;
+      }
+      complete_compact_block(originating_peer);
+    }
+
+    void node_impl::complete_compact_block(peer_connection* originating_peer)
+    {
+      VERIFY_CORRECT_THREAD();
+      peer_connection::partial_compact_block& partial = *originating_peer->compact_block_being_completed;
+      signed_block block;
+      static_cast<signed_block_header&>(block) = partial.compact.header;
+      block.transactions.reserve(partial.transactions.size());
+      for (const fc::optional<processed_transaction>& trx : partial.transactions)
+      {
+        if (!trx)
+        {
+          // the peer sent fewer transactions than we asked for, leave the block to time out and be fetched elsewhere
+          originating_peer->compact_block_being_completed.reset();
+          return;
+        }
+        block.transactions.push_back(*trx);
+      }
+
+      const graphene::net::block_message rebuilt_block(block);
+      message rebuilt_message(rebuilt_block);
+      message_hash_type rebuilt_hash = rebuilt_message.id();
+      if (rebuilt_hash != partial.compact.block_message_hash && !partial.all_transactions_requested)
+      {
+        // one of our cached transactions differs from the one in the block (e.g. in its signatures),
+        // so fetch all of them from the peer rather than guess which one
+        dlog("compact block ${hash} from peer ${endpoint} didn't match after rebuilding it, fetching all of its transactions",
+             ("hash", partial.compact.block_message_hash)("endpoint", originating_peer->get_remote_endpoint()));
+        partial.all_transactions_requested = true;
+        fetch_compact_block_transactions_message fetch_all;
+        fetch_all.block_message_hash = partial.compact.block_message_hash;
+        for (uint32_t i = 0; i < partial.transactions.size(); ++i)
+          fetch_all.transaction_indexes.push_back(i);
+        originating_peer->send_message(fetch_all);
+        return;
+      }
+
+      originating_peer->compact_block_being_completed.reset();
+      // if the hash still doesn't match, the peer sent us something else than what we asked for,
+      // which process_block_message() handles like any unrequested block
+      process_block_message(originating_peer, rebuilt_message, rebuilt_hash);
+    }
+
     void node_impl::process_block_message(peer_connection* originating_peer,
                                           const message& message_to_process,
                                           const message_hash_type& message_hash)
@@ -3567,6 +3981,12 @@ namespace graphene { namespace net { namespace detail {
               else
                 trigger_fetch_sync_items_loop();
             }
+            else
+            {
+              // the peer has room for more requests now, keep the window full rather than waiting for
+              // everything it was asked for
+              trigger_fetch_sync_items_loop();
+            }
             return;
           }
           catch (const fc::canceled_exception& e)
@@ -3622,6 +4042,10 @@ namespace graphene { namespace net { namespace detail {
                                                          (current_time_reply_message_received.reply_transmitted_time - reply_received_time)).count() / 2);
       originating_peer->round_trip_delay = (reply_received_time - current_time_reply_message_received.request_sent_time) -
                                            (current_time_reply_message_received.reply_transmitted_time - current_time_reply_message_received.request_received_time);
+      const fc::microseconds round_trip_delay = originating_peer->round_trip_delay;
+      update_potential_peer_record(originating_peer, [&round_trip_delay](potential_peer_record& record) {
+        record.add_round_trip_delay_sample(round_trip_delay);
+      });
     }
 
     void node_impl::forward_firewall_check_to_next_available_peer(firewall_check_state_data* firewall_check_state)
@@ -3702,7 +4126,7 @@ namespace graphene { namespace net { namespace detail {
         {
           // we're not connected to them, so we need to set up a connection to them
           // to test.
-          peer_connection_ptr peer_for_testing(peer_connection::make_shared(this));
+          peer_connection_ptr peer_for_testing(create_peer_connection());
           peer_for_testing->firewall_check_state = new firewall_check_state_data;
           peer_for_testing->firewall_check_state->endpoint_to_test = check_firewall_message_received.endpoint_to_check;
           peer_for_testing->firewall_check_state->expected_node_id = check_firewall_message_received.node_id;
@@ -3898,7 +4322,7 @@ namespace graphene { namespace net { namespace detail {
           {
             trx_message transaction_message_to_process = message_to_process.as<trx_message>();
             dlog("passing message containing transaction ${trx} to client", ("trx", transaction_message_to_process.trx.id()));
-            _delegate->handle_transaction(transaction_message_to_process);
+            _delegate->handle_transaction(std::move(transaction_message_to_process));
           }
           else
             _delegate->handle_message( message_to_process );
@@ -4258,7 +4682,7 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
       while ( !_accept_loop_complete.canceled() )
       {
-        peer_connection_ptr new_peer(peer_connection::make_shared(this));
+        peer_connection_ptr new_peer(create_peer_connection());
 
         try
         {
@@ -4684,7 +5108,7 @@ namespace graphene { namespace net { namespace detail {
                            ("endpoint", remote_endpoint));
 
       dlog("node_impl::connect_to_endpoint(${endpoint})", ("endpoint", remote_endpoint));
-      peer_connection_ptr new_peer(peer_connection::make_shared(this));
+      peer_connection_ptr new_peer(create_peer_connection());
       new_peer->set_remote_endpoint(remote_endpoint);
       initiate_connect_to(new_peer);
     }
@@ -4771,6 +5195,7 @@ namespace graphene { namespace net { namespace detail {
       ilog( "node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size() ) );
       ilog( "node._new_inventory size: ${size}", ("size", _new_inventory.size() ) );
       ilog( "node._message_cache size: ${size}", ("size", _message_cache.size() ) );
+      ilog( "node._inventory size: ${size}", ("size", _inventory->size() ) );
       for( const peer_connection_ptr& peer : _active_connections )
       {
         ilog( "  peer ${endpoint}", ("endpoint", peer->get_remote_endpoint() ) );
@@ -5012,6 +5437,19 @@ namespace graphene { namespace net { namespace detail {
         _maximum_number_of_sync_blocks_to_prefetch = params["maximum_number_of_sync_blocks_to_prefetch"].as<uint32_t>(1);
       if (params.contains("maximum_blocks_per_peer_during_syncing"))
         _maximum_blocks_per_peer_during_syncing = params["maximum_blocks_per_peer_during_syncing"].as<uint32_t>(1);
+      if (params.contains("sync_request_batch_size"))
+        _sync_request_batch_size = std::max<uint32_t>(1, params["sync_request_batch_size"].as<uint32_t>(1));
+      if (params.contains("peer_transaction_relay_rate") || params.contains("peer_transaction_relay_burst"))
+      {
+        if (params.contains("peer_transaction_relay_rate"))
+          _peer_transaction_relay_rate = params["peer_transaction_relay_rate"].as<uint32_t>(1);
+        if (params.contains("peer_transaction_relay_burst"))
+          _peer_transaction_relay_burst = params["peer_transaction_relay_burst"].as<uint32_t>(1);
+        for (const peer_connection_ptr& peer : _active_connections)
+          peer->set_transaction_relay_rate(_peer_transaction_relay_rate, _peer_transaction_relay_burst);
+        for (const peer_connection_ptr& peer : _handshaking_connections)
+          peer->set_transaction_relay_rate(_peer_transaction_relay_rate, _peer_transaction_relay_burst);
+      }
 
       _desired_number_of_connections = std::min(_desired_number_of_connections, _maximum_number_of_connections);
 
@@ -5031,6 +5469,9 @@ namespace graphene { namespace net { namespace detail {
       result["maximum_number_of_blocks_to_handle_at_one_time"] = _maximum_number_of_blocks_to_handle_at_one_time;
       result["maximum_number_of_sync_blocks_to_prefetch"] = _maximum_number_of_sync_blocks_to_prefetch;
       result["maximum_blocks_per_peer_during_syncing"] = _maximum_blocks_per_peer_during_syncing;
+      result["sync_request_batch_size"] = _sync_request_batch_size;
+      result["peer_transaction_relay_rate"] = _peer_transaction_relay_rate;
+      result["peer_transaction_relay_burst"] = _peer_transaction_relay_burst;
       return result;
     }
 
@@ -5079,6 +5520,45 @@ namespace graphene { namespace net { namespace detail {
       _rate_limiter.set_download_limit( download_bytes_per_second );
     }
 
+    void node_impl::set_io_threads( uint32_t num_threads )
+    {
+      VERIFY_CORRECT_THREAD();
+      // connections keep a pointer to their thread, so the threads can only be added
+      if( num_threads <= _io_threads.size() )
+        return;
+      for( uint32_t i = _io_threads.size(); i < num_threads; ++i )
+      {
+        _io_threads.push_back( std::make_shared<fc::thread>( "p2p_io_" + std::to_string( i ) ) );
+        if( !_cpus.empty() && !graphene::utilities::pin_thread( *_io_threads.back(), _cpus ) )
+          wlog( "Thread ${n} can't be pinned to CPUs on this platform", ("n",_io_threads.back()->name()) );
+      }
+    }
+
+    void node_impl::set_thread_affinity( const std::vector<uint32_t>& cpus )
+    {
+      VERIFY_CORRECT_THREAD();
+      _cpus = cpus;
+#ifdef P2P_IN_DEDICATED_THREAD
+      // otherwise this is the thread of the application, which isn't the node's to pin
+      graphene::utilities::pin_current_thread( cpus );
+#endif // P2P_IN_DEDICATED_THREAD
+      for( const auto& t : _io_threads )
+      {
+        if( !graphene::utilities::pin_thread( *t, cpus ) )
+          wlog( "Thread ${n} can't be pinned to CPUs on this platform", ("n",t->name()) );
+      }
+    }
+
+    peer_connection_ptr node_impl::create_peer_connection()
+    {
+      VERIFY_CORRECT_THREAD();
+      peer_connection_ptr new_peer( peer_connection::make_shared( this, _inventory ) );
+      new_peer->set_transaction_relay_rate( _peer_transaction_relay_rate, _peer_transaction_relay_burst );
+      if( !_io_threads.empty() )
+        new_peer->set_crypto_thread( _io_threads[ _next_io_thread++ % _io_threads.size() ].get() );
+      return new_peer;
+    }
+
     void node_impl::disable_peer_advertising()
     {
       VERIFY_CORRECT_THREAD();
@@ -5129,6 +5609,96 @@ namespace graphene { namespace net { namespace detail {
       result["usage_by_second"] = fc::variant( network_usage_by_second, 2 );
       result["usage_by_minute"] = fc::variant( network_usage_by_minute, 2 );
       result["usage_by_hour"] = fc::variant( network_usage_by_hour, 2 );
+      result["total_bytes_read"] = _total_bytes_read;
+      result["total_bytes_written"] = _total_bytes_written;
+      uint32_t peers_syncing_from = 0;
+      for( const peer_connection_ptr& peer : _active_connections )
+        if( peer->we_need_sync_items_from_peer )
+          ++peers_syncing_from;
+      result["peers_syncing_from"] = peers_syncing_from;
+      result["inventory"] = get_inventory_statistics();
+      return result;
+    }
+
+    fc::variant_object node_impl::get_inventory_statistics() const
+    {
+      VERIFY_CORRECT_THREAD();
+      uint64_t inventory_advertised_to_peers = 0;
+      uint64_t inventory_peers_advertised_to_us = 0;
+      for( const peer_connection_ptr& peer : _active_connections )
+      {
+        inventory_advertised_to_peers += peer->inventory_advertised_to_peer.size();
+        inventory_peers_advertised_to_us += peer->inventory_peer_advertised_to_us.size();
+      }
+      fc::mutable_variant_object inventory;
+      inventory["tracked_items"] = _inventory->size();
+      inventory["advertised_to_peers"] = inventory_advertised_to_peers;
+      inventory["peers_advertised_to_us"] = inventory_peers_advertised_to_us;
+      inventory["new_items_to_advertise"] = _new_inventory.size();
+      inventory["last_advertise_item_count"] = _last_advertise_inventory_item_count;
+      inventory["last_advertise_time_us"] = _last_advertise_inventory_time.count();
+      inventory["max_advertise_time_us"] = _max_advertise_inventory_time.count();
+      return inventory;
+    }
+
+    void node_impl::on_message_sent(peer_connection* destination_peer, const packed_message& sent_message)
+    {
+      VERIFY_CORRECT_THREAD();
+      message_type_statistics& statistics = _message_statistics[sent_message.msg_type];
+      ++statistics.sent_count;
+      statistics.sent_bytes += sent_message.size();
+    }
+
+    fc::variant_object node_impl::network_get_metrics() const
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::mutable_variant_object messages;
+      for (const auto& type_and_statistics : _message_statistics)
+      {
+        const message_type_statistics& statistics = type_and_statistics.second;
+        fc::mutable_variant_object statistics_for_type;
+        statistics_for_type["received_count"] = statistics.received_count;
+        statistics_for_type["received_bytes"] = statistics.received_bytes;
+        statistics_for_type["sent_count"] = statistics.sent_count;
+        statistics_for_type["sent_bytes"] = statistics.sent_bytes;
+        std::string type_name;
+        try
+        {
+          type_name = fc::variant(core_message_type_enum(type_and_statistics.first), 1).as_string();
+        }
+        catch (const fc::exception&)
+        {
+          type_name = std::to_string(type_and_statistics.first);
+        }
+        messages[type_name] = statistics_for_type;
+      }
+
+      std::vector<fc::variant> peers;
+      peers.reserve(_active_connections.size());
+      for (const peer_connection_ptr& peer : _active_connections)
+      {
+        fc::mutable_variant_object peer_metrics;
+        fc::optional<fc::ip::endpoint> endpoint = peer->get_remote_endpoint();
+        peer_metrics["addr"] = endpoint ? (std::string)*endpoint : std::string();
+        peer_metrics["round_trip_delay_us"] = peer->round_trip_delay.count();
+        peer_metrics["clock_offset_us"] = peer->clock_offset.count();
+        peer_metrics["queued_messages"] = peer->get_queued_message_count();
+        peer_metrics["queued_bytes"] = peer->get_total_queued_messages_size();
+        peer_metrics["bytes_sent"] = peer->get_total_bytes_sent();
+        peer_metrics["bytes_received"] = peer->get_total_bytes_received();
+        peer_metrics["items_requested"] = peer->items_requested_from_peer.size();
+        peer_metrics["sync_items_requested"] = peer->sync_items_requested_from_peer.size();
+        peers.emplace_back(peer_metrics);
+      }
+
+      fc::mutable_variant_object result;
+      result["messages"] = messages;
+      result["peers"] = peers;
+      result["items_to_fetch"] = _items_to_fetch.size();
+      result["received_sync_items"] = _received_sync_items.size() + _new_received_sync_items.size();
+      result["message_cache_size"] = _message_cache.size();
+      result["inventory"] = get_inventory_statistics();
+      result["delegate_calls"] = _delegate->get_call_statistics();
       return result;
     }
 
@@ -5289,6 +5859,16 @@ namespace graphene { namespace net { namespace detail {
     INVOKE_IN_IMPL(set_total_bandwidth_limit, upload_bytes_per_second, download_bytes_per_second);
   }
 
+  void node::set_io_threads(uint32_t num_threads)
+  {
+    INVOKE_IN_IMPL(set_io_threads, num_threads);
+  }
+
+  void node::set_thread_affinity(const std::vector<uint32_t>& cpus)
+  {
+    INVOKE_IN_IMPL(set_thread_affinity, cpus);
+  }
+
   void node::disable_peer_advertising()
   {
     INVOKE_IN_IMPL(disable_peer_advertising);
@@ -5309,6 +5889,11 @@ namespace graphene { namespace net { namespace detail {
     INVOKE_IN_IMPL(network_get_usage_stats);
   }
 
+  fc::variant_object node::network_get_metrics() const
+  {
+    INVOKE_IN_IMPL(network_get_metrics);
+  }
+
   void node::close()
   {
     INVOKE_IN_IMPL(close);
@@ -5317,9 +5902,15 @@ namespace graphene { namespace net { namespace detail {
   struct simulated_network::node_info
   {
     node_delegate* delegate;
+    fc::microseconds latency;
+    uint64_t bytes_per_second;
+    /// when the link has sent the messages queued so far
+    fc::time_point link_free_time;
     fc::future<void> message_sender_task_done;
-    std::queue<message> messages_to_deliver;
-    node_info(node_delegate* delegate) : delegate(delegate) {}
+    /// the messages with the time they reach the node
+    std::queue<std::pair<message, fc::time_point>> messages_to_deliver;
+    node_info(node_delegate* delegate, fc::microseconds latency, uint64_t bytes_per_second) :
+      delegate(delegate), latency(latency), bytes_per_second(bytes_per_second) {}
   };
 
   simulated_network::~simulated_network()
@@ -5335,9 +5926,12 @@ namespace graphene { namespace net { namespace detail {
   {
     while (!destination_node->messages_to_deliver.empty())
     {
+      const fc::time_point arrival_time = destination_node->messages_to_deliver.front().second;
+      if (arrival_time > fc::time_point::now())
+        fc::usleep(arrival_time - fc::time_point::now());
       try
       {
-        const message& message_to_deliver = destination_node->messages_to_deliver.front();
+        const message& message_to_deliver = destination_node->messages_to_deliver.front().first;
         if (message_to_deliver.msg_type == trx_message_type)
           destination_node->delegate->handle_transaction(message_to_deliver.as<trx_message>());
         else if (message_to_deliver.msg_type == block_message_type)
@@ -5358,17 +5952,27 @@ namespace graphene { namespace net { namespace detail {
 
   void simulated_network::broadcast( const message& item_to_broadcast  )
   {
+    const fc::time_point now = fc::time_point::now();
     for (node_info* network_node_info : network_nodes)
     {
-      network_node_info->messages_to_deliver.emplace(item_to_broadcast);
+      fc::time_point sent_time = now;
+      if (network_node_info->bytes_per_second > 0)
+      {
+        const uint64_t bytes = sizeof(message_header) + item_to_broadcast.data.size();
+        sent_time = std::max(now, network_node_info->link_free_time)
+                    + fc::microseconds(bytes * 1000000 / network_node_info->bytes_per_second);
+        network_node_info->link_free_time = sent_time;
+      }
+      network_node_info->messages_to_deliver.emplace(item_to_broadcast, sent_time + network_node_info->latency);
       if (!network_node_info->message_sender_task_done.valid() || network_node_info->message_sender_task_done.ready())
         network_node_info->message_sender_task_done = fc::async([=](){ message_sender(network_node_info); }, "simulated_network_sender");
     }
   }
 
-  void simulated_network::add_node_delegate( node_delegate* node_delegate_to_add )
+  void simulated_network::add_node_delegate( node_delegate* node_delegate_to_add, fc::microseconds latency,
+                                             uint64_t bytes_per_second )
   {
-    network_nodes.push_back(new node_info(node_delegate_to_add));
+    network_nodes.push_back(new node_info(node_delegate_to_add, latency, bytes_per_second));
   }
 
   namespace detail
@@ -5377,7 +5981,8 @@ namespace graphene { namespace net { namespace detail {
 #define INITIALIZE_ACCUMULATOR(r, data, method_name) \
       , BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _execution_accumulator))(boost::accumulators::tag::rolling_window::window_size = ROLLING_WINDOW_SIZE) \
       , BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _delay_before_accumulator))(boost::accumulators::tag::rolling_window::window_size = ROLLING_WINDOW_SIZE) \
-      , BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _delay_after_accumulator))(boost::accumulators::tag::rolling_window::window_size = ROLLING_WINDOW_SIZE)
+      , BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _delay_after_accumulator))(boost::accumulators::tag::rolling_window::window_size = ROLLING_WINDOW_SIZE) \
+      , BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _latency_histogram))()
 
 
     statistics_gathering_node_delegate_wrapper::statistics_gathering_node_delegate_wrapper(node_delegate* delegate, fc::thread* thread_for_delegate_calls) :
@@ -5391,8 +5996,10 @@ namespace graphene { namespace net { namespace detail {
     {
       fc::mutable_variant_object statistics;
       std::ostringstream note;
-      note << "All times are in microseconds, mean is the average of the last " << ROLLING_WINDOW_SIZE << " call times";
+      note << "All times are in microseconds, mean is the average of the last " << ROLLING_WINDOW_SIZE << " call times, "
+              "latency_histogram counts all calls by total duration into the buckets bounded by _latency_histogram_bounds";
       statistics["_note"] = note.str();
+      statistics["_latency_histogram_bounds"] = fc::variant( std::vector<int64_t>(std::begin(call_latency_bucket_limits), std::end(call_latency_bucket_limits)), 1 );
 
 #define ADD_STATISTICS_FOR_METHOD(r, data, method_name) \
       fc::mutable_variant_object BOOST_PP_CAT(method_name, _stats); \
@@ -5409,6 +6016,8 @@ namespace graphene { namespace net { namespace detail {
       BOOST_PP_CAT(method_name, _stats)["delay_after_max"] = boost::accumulators::max(BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _delay_after_accumulator))); \
       BOOST_PP_CAT(method_name, _stats)["delay_after_sum"] = boost::accumulators::sum(BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _delay_after_accumulator))); \
       BOOST_PP_CAT(method_name, _stats)["count"] = boost::accumulators::count(BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _execution_accumulator))); \
+      BOOST_PP_CAT(method_name, _stats)["latency_histogram"] = fc::variant( std::vector<uint64_t>(BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _latency_histogram)).begin(), \
+                                                                                                 BOOST_PP_CAT(_, BOOST_PP_CAT(method_name, _latency_histogram)).end()), 1 ); \
       statistics[BOOST_PP_STRINGIZE(method_name)] = BOOST_PP_CAT(method_name, _stats);
 
       BOOST_PP_SEQ_FOR_EACH(ADD_STATISTICS_FOR_METHOD, unused, NODE_DELEGATE_METHOD_NAMES)
@@ -5426,7 +6035,8 @@ namespace graphene { namespace net { namespace detail {
       call_statistics_collector statistics_collector(#method_name, \
                                                      &_ ## method_name ## _execution_accumulator, \
                                                      &_ ## method_name ## _delay_before_accumulator, \
-                                                     &_ ## method_name ## _delay_after_accumulator); \
+                                                     &_ ## method_name ## _delay_after_accumulator, \
+                                                     &_ ## method_name ## _latency_histogram); \
       if (_thread->is_current()) \
       { \
         call_statistics_collector::actual_execution_measurement_helper helper(statistics_collector); \
@@ -5458,7 +6068,8 @@ namespace graphene { namespace net { namespace detail {
     call_statistics_collector statistics_collector(#method_name, \
                                                    &_ ## method_name ## _execution_accumulator, \
                                                    &_ ## method_name ## _delay_before_accumulator, \
-                                                   &_ ## method_name ## _delay_after_accumulator); \
+                                                   &_ ## method_name ## _delay_after_accumulator, \
+                                                   &_ ## method_name ## _latency_histogram); \
     if (_thread->is_current()) \
     { \
       call_statistics_collector::actual_execution_measurement_helper helper(statistics_collector); \
@@ -5486,9 +6097,14 @@ namespace graphene { namespace net { namespace detail {
       INVOKE_AND_COLLECT_STATISTICS(handle_block, block_message, sync_mode, contained_transaction_message_ids);
     }
 
-    void statistics_gathering_node_delegate_wrapper::handle_transaction( const graphene::net::trx_message& transaction_message )
+    void statistics_gathering_node_delegate_wrapper::prepare_sync_blocks( const std::vector<const graphene::net::block_message*>& blocks )
+    {
+      INVOKE_AND_COLLECT_STATISTICS(prepare_sync_blocks, blocks);
+    }
+
+    void statistics_gathering_node_delegate_wrapper::handle_transaction( graphene::net::trx_message&& transaction_message )
     {
-      INVOKE_AND_COLLECT_STATISTICS(handle_transaction, transaction_message);
+      INVOKE_AND_COLLECT_STATISTICS(handle_transaction, std::move(transaction_message));
     }
 
     std::vector<item_hash_t> statistics_gathering_node_delegate_wrapper::get_block_ids(const std::vector<item_hash_t>& blockchain_synopsis,
@@ -44,7 +44,7 @@
 
 namespace graphene { namespace net
   {
-    message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
+    packed_message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
     {
       if (message_send_time_field_offset != (size_t)-1)
       {
@@ -55,13 +55,23 @@ namespace graphene { namespace net
         memcpy(message_to_send.data.data() + message_send_time_field_offset,
                packed_current_time.data(), packed_current_time.size());
       }
-      return message_to_send;
+      return packed_message(message_to_send);
     }
     size_t peer_connection::real_queued_message::get_size_in_queue()
     {
       return message_to_send.data.size();
     }
-    message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
+
+    packed_message peer_connection::shared_queued_message::get_message(peer_connection_delegate*)
+    {
+      return message_to_send;
+    }
+    size_t peer_connection::shared_queued_message::get_size_in_queue()
+    {
+      return message_to_send.size();
+    }
+
+    packed_message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
     {
       return node->get_message_for_item(item_to_send);
     }
@@ -71,10 +81,14 @@ namespace graphene { namespace net
       return sizeof(item_id);
     }
 
-    peer_connection::peer_connection(peer_connection_delegate* delegate) :
+    peer_connection::peer_connection(peer_connection_delegate* delegate, std::shared_ptr<inventory_tracker> inventory) :
       _node(delegate),
       _message_connection(this),
       _total_queued_messages_size(0),
+      _transaction_relay_rate(GRAPHENE_NET_DEFAULT_PEER_TRX_RELAY_RATE),
+      _transaction_relay_burst(GRAPHENE_NET_DEFAULT_PEER_TRX_RELAY_BURST),
+      _transaction_relay_tokens(GRAPHENE_NET_DEFAULT_PEER_TRX_RELAY_BURST),
+      _transaction_relay_tokens_updated(fc::time_point::now()),
       direction(peer_connection_direction::unknown),
       is_firewalled(firewalled_state::unknown),
       our_state(our_connection_state::disconnected),
@@ -82,10 +96,13 @@ namespace graphene { namespace net
       their_state(their_connection_state::disconnected),
       we_have_requested_close(false),
       negotiation_status(connection_negotiation_status::disconnected),
+      supports_compact_blocks(false),
       number_of_unfetched_item_ids(0),
       peer_needs_sync_items_from_us(true),
       we_need_sync_items_from_peer(true),
       inhibit_fetching_sync_blocks(false),
+      inventory_peer_advertised_to_us(inventory),
+      inventory_advertised_to_peer(inventory),
       transaction_fetching_inhibited_until(fc::time_point::min()),
       last_known_fork_block_number(0),
       firewall_check_state(nullptr),
@@ -97,7 +114,8 @@ namespace graphene { namespace net
     {
     }
 
-    peer_connection_ptr peer_connection::make_shared(peer_connection_delegate* delegate)
+    peer_connection_ptr peer_connection::make_shared(peer_connection_delegate* delegate,
+                                                     std::shared_ptr<inventory_tracker> inventory)
     {
       // The lifetime of peer_connection objects is managed by shared_ptrs in node.  The peer_connection
       // is responsible for notifying the node when it should be deleted, and the process of deleting it
@@ -107,7 +125,7 @@ namespace graphene { namespace net
       // current task yields.  In the (not uncommon) case where it is the task executing
       // connect_to or read_loop, this allows the task to finish before the destructor is forced
       // to cancel it.
-      return peer_connection_ptr(new peer_connection(delegate));
+      return peer_connection_ptr(new peer_connection(delegate, inventory));
       //, [](peer_connection* peer_to_delete){ fc::async([peer_to_delete](){delete peer_to_delete;}); });
     }
 
@@ -292,16 +310,28 @@ namespace graphene { namespace net
         ~counter() { assert(_send_message_queue_tasks_counter == 1); --_send_message_queue_tasks_counter; /* dlog("leaving peer_connection::send_queued_messages_task()"); */ }
       } concurrent_invocation_counter(_send_message_queue_tasks_running);
 #endif
-      while (!_queued_messages.empty())
+      while (!_queued_block_messages.empty() || !_queued_messages.empty())
       {
-        _queued_messages.front()->transmission_start_time = fc::time_point::now();
-        message message_to_send = _queued_messages.front()->get_message(_node);
+        queued_message_queue& queue = !_queued_block_messages.empty() ? _queued_block_messages : _queued_messages;
+        if (&queue == &_queued_messages && queue.front()->get_message_type() == trx_message_type)
+        {
+          fc::microseconds delay_until_next_token = take_transaction_relay_token();
+          if (delay_until_next_token > fc::microseconds())
+          {
+            // blocks queued meanwhile are sent when we wake up, ahead of the transaction
+            fc::usleep(delay_until_next_token);
+            continue;
+          }
+        }
+        queue.front()->transmission_start_time = fc::time_point::now();
+        packed_message message_to_send = queue.front()->get_message(_node);
         try
         {
           //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
           //     "to send message of type ${type} for peer ${endpoint}",
           //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
           _message_connection.send_message(message_to_send);
+          _node->on_message_sent(this, message_to_send);
           //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
           //     ("endpoint", get_remote_endpoint()));
         }
@@ -331,18 +361,50 @@ namespace graphene { namespace net
         {
           elog("message_oriented_exception::send_message() threw an unhandled exception");
         }
-        _queued_messages.front()->transmission_finish_time = fc::time_point::now();
-        _total_queued_messages_size -= _queued_messages.front()->get_size_in_queue();
-        _queued_messages.pop();
+        queue.front()->transmission_finish_time = fc::time_point::now();
+        _total_queued_messages_size -= queue.front()->get_size_in_queue();
+        queue.pop();
       }
       //dlog("leaving peer_connection::send_queued_messages_task() due to queue exhaustion");
     }
 
+    fc::microseconds peer_connection::take_transaction_relay_token()
+    {
+      VERIFY_CORRECT_THREAD();
+      if (_transaction_relay_rate == 0)
+        return fc::microseconds();
+      fc::time_point now = fc::time_point::now();
+      _transaction_relay_tokens = std::min<double>(_transaction_relay_burst,
+                                                   _transaction_relay_tokens +
+                                                   double((now - _transaction_relay_tokens_updated).count()) * _transaction_relay_rate / 1000000);
+      _transaction_relay_tokens_updated = now;
+      if (_transaction_relay_tokens >= 1)
+      {
+        _transaction_relay_tokens -= 1;
+        return fc::microseconds();
+      }
+      return fc::microseconds(int64_t((1 - _transaction_relay_tokens) * 1000000 / _transaction_relay_rate) + 1);
+    }
+
+    void peer_connection::set_transaction_relay_rate(uint32_t transactions_per_second, uint32_t burst)
+    {
+      VERIFY_CORRECT_THREAD();
+      _transaction_relay_rate = transactions_per_second;
+      _transaction_relay_burst = std::max<uint32_t>(burst, 1);
+      _transaction_relay_tokens = std::min<double>(_transaction_relay_tokens, _transaction_relay_burst);
+    }
+
     void peer_connection::send_queueable_message(std::unique_ptr<queued_message>&& message_to_send)
     {
       VERIFY_CORRECT_THREAD();
       _total_queued_messages_size += message_to_send->get_size_in_queue();
-      _queued_messages.emplace(std::move(message_to_send));
+      const uint32_t message_type = message_to_send->get_message_type();
+      if (message_type == block_message_type ||
+          message_type == compact_block_message_type ||
+          message_type == compact_block_transactions_message_type)
+        _queued_block_messages.emplace(std::move(message_to_send));
+      else
+        _queued_messages.emplace(std::move(message_to_send));
       if (_total_queued_messages_size > GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES)
       {
         elog("send queue exceeded maximum size of ${max} bytes (current size ${current} bytes)",
@@ -375,7 +437,19 @@ namespace graphene { namespace net
       VERIFY_CORRECT_THREAD();
       //dlog("peer_connection::send_message() enqueueing message of type ${type} for peer ${endpoint}",
       //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-      std::unique_ptr<queued_message> message_to_enqueue(new real_queued_message(message_to_send, message_send_time_field_offset));
+      if (message_send_time_field_offset != (size_t)-1)
+      {
+        std::unique_ptr<queued_message> message_to_enqueue(new real_queued_message(message_to_send, message_send_time_field_offset));
+        send_queueable_message(std::move(message_to_enqueue));
+      }
+      else
+        send_message(packed_message(message_to_send));
+    }
+
+    void peer_connection::send_message(const packed_message& message_to_send)
+    {
+      VERIFY_CORRECT_THREAD();
+      std::unique_ptr<queued_message> message_to_enqueue(new shared_queued_message(message_to_send));
       send_queueable_message(std::move(message_to_enqueue));
     }
 
@@ -481,16 +555,14 @@ namespace graphene { namespace net
       fc::time_point_sec oldest_inventory_to_keep(fc::time_point::now() - fc::minutes(GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES));
 
       // expire old items from inventory_advertised_to_peer
-      auto oldest_inventory_to_keep_iter = inventory_advertised_to_peer.get<timestamp_index>().lower_bound(oldest_inventory_to_keep);
-      auto begin_iter = inventory_advertised_to_peer.get<timestamp_index>().begin();
-      unsigned number_of_elements_advertised_to_peer_to_discard = std::distance(begin_iter, oldest_inventory_to_keep_iter);
-      inventory_advertised_to_peer.get<timestamp_index>().erase(begin_iter, oldest_inventory_to_keep_iter);
+      size_t number_of_elements_advertised_to_peer_to_discard = inventory_advertised_to_peer.size();
+      inventory_advertised_to_peer.expire(oldest_inventory_to_keep);
+      number_of_elements_advertised_to_peer_to_discard -= inventory_advertised_to_peer.size();
 
       // also expire items from inventory_peer_advertised_to_us
-      oldest_inventory_to_keep_iter = inventory_peer_advertised_to_us.get<timestamp_index>().lower_bound(oldest_inventory_to_keep);
-      begin_iter = inventory_peer_advertised_to_us.get<timestamp_index>().begin();
-      unsigned number_of_elements_peer_advertised_to_discard = std::distance(begin_iter, oldest_inventory_to_keep_iter);
-      inventory_peer_advertised_to_us.get<timestamp_index>().erase(begin_iter, oldest_inventory_to_keep_iter);
+      size_t number_of_elements_peer_advertised_to_discard = inventory_peer_advertised_to_us.size();
+      inventory_peer_advertised_to_us.expire(oldest_inventory_to_keep);
+      number_of_elements_peer_advertised_to_discard -= inventory_peer_advertised_to_us.size();
       dlog("Expiring old inventory for peer ${peer}: removing ${to_peer} items advertised to peer (${remain_to_peer} left), and ${to_us} advertised to us (${remain_to_us} left)",
            ("peer", get_remote_endpoint())
            ("to_peer", number_of_elements_advertised_to_peer_to_discard)("remain_to_peer", inventory_advertised_to_peer.size())
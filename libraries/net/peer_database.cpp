@@ -37,9 +37,61 @@
 
 #include <graphene/net/config.hpp>
 
+#include <algorithm>
+#include <limits>
 
 
 namespace graphene { namespace net {
+
+  namespace
+  {
+    void add_sample(fc::optional<uint32_t>& average, uint64_t sample)
+    {
+      sample = std::min<uint64_t>(sample, std::numeric_limits<uint32_t>::max());
+      if (!average)
+        average = (uint32_t)sample;
+      else
+        average = (uint32_t)((uint64_t(*average) * (GRAPHENE_NET_PEER_SCORE_SAMPLE_WEIGHT - 1) + sample) / GRAPHENE_NET_PEER_SCORE_SAMPLE_WEIGHT);
+    }
+
+    uint32_t score_for_delay(const fc::optional<uint32_t>& delay_ms, uint32_t max_delay_ms)
+    {
+      if (!delay_ms)
+        return GRAPHENE_NET_PEER_SCORE_PER_MEASURE / 2;
+      if (*delay_ms >= max_delay_ms)
+        return 0;
+      return (uint32_t)(uint64_t(GRAPHENE_NET_PEER_SCORE_PER_MEASURE) * (max_delay_ms - *delay_ms) / max_delay_ms);
+    }
+  }
+
+  void potential_peer_record::add_round_trip_delay_sample(fc::microseconds round_trip_delay)
+  {
+    add_sample(round_trip_delay_ms, std::max<int64_t>(round_trip_delay.count(), 0) / 1000);
+  }
+
+  void potential_peer_record::add_block_delivery_delay_sample(fc::microseconds delivery_delay)
+  {
+    add_sample(block_delivery_delay_ms, std::max<int64_t>(delivery_delay.count(), 0) / 1000);
+  }
+
+  void potential_peer_record::add_download_speed_sample(uint64_t bytes_per_second)
+  {
+    add_sample(download_bytes_per_second, bytes_per_second);
+  }
+
+  uint32_t potential_peer_record::get_score() const
+  {
+    uint32_t score = score_for_delay(round_trip_delay_ms, GRAPHENE_NET_PEER_SCORE_MAX_ROUND_TRIP_DELAY_MS) +
+                     score_for_delay(block_delivery_delay_ms, GRAPHENE_NET_PEER_SCORE_MAX_BLOCK_DELIVERY_DELAY_MS);
+    if (!download_bytes_per_second)
+      score += GRAPHENE_NET_PEER_SCORE_PER_MEASURE / 2;
+    else
+      score += (uint32_t)(uint64_t(GRAPHENE_NET_PEER_SCORE_PER_MEASURE) *
+                          std::min<uint64_t>(*download_bytes_per_second, GRAPHENE_NET_PEER_SCORE_FULL_DOWNLOAD_SPEED) /
+                          GRAPHENE_NET_PEER_SCORE_FULL_DOWNLOAD_SPEED);
+    return score;
+  }
+
   namespace detail
   {
     using namespace boost::multi_index;
@@ -31,15 +31,20 @@
 #include <fc/log/logger.hpp>
 #include <fc/network/ip.hpp>
 #include <fc/exception/exception.hpp>
+#include <fc/thread/thread.hpp>
 
 #include <graphene/net/stcp_socket.hpp>
+#include <graphene/net/config.hpp>
 
 namespace graphene { namespace net {
 
 stcp_socket::stcp_socket()
 //:_buf_len(0)
+   : _send_aes(std::make_shared<fc::aes_encoder>()),
+     _recv_aes(std::make_shared<fc::aes_decoder>()),
+     _crypto_thread(nullptr)
 #ifndef NDEBUG
-   : _read_buffer_in_use(false),
+   , _read_buffer_in_use(false),
      _write_buffer_in_use(false)
 #endif
 {
@@ -62,9 +67,9 @@ void stcp_socket::do_key_exchange()
 
   _shared_secret = _priv_key.get_shared_secret( rpub );
 //    ilog("shared secret ${s}", ("s", shared_secret) );
-  _send_aes.init( fc::sha256::hash( (char*)&_shared_secret, sizeof(_shared_secret) ), 
+  _send_aes->init( fc::sha256::hash( (char*)&_shared_secret, sizeof(_shared_secret) ), 
                   fc::city_hash_crc_128((char*)&_shared_secret,sizeof(_shared_secret) ) );
-  _recv_aes.init( fc::sha256::hash( (char*)&_shared_secret, sizeof(_shared_secret) ), 
+  _recv_aes->init( fc::sha256::hash( (char*)&_shared_secret, sizeof(_shared_secret) ), 
                   fc::city_hash_crc_128((char*)&_shared_secret,sizeof(_shared_secret) ) );
 }
 
@@ -112,7 +117,7 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
       _sock.read(_read_buffer, 16 - (s%16), s);
       s += 16-(s%16);
     }
-    _recv_aes.decode( _read_buffer.get(), s, buffer );
+    _recv_aes->decode( _read_buffer.get(), s, buffer );
     return s;
 } FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
 
@@ -152,7 +157,7 @@ size_t stcp_socket::writesome( const char* buffer, size_t len )
      * for now because we are going to upgrade to something
      * better.
      */
-    uint32_t ciphertext_len = _send_aes.encode( buffer, len, _write_buffer.get() );
+    uint32_t ciphertext_len = _send_aes->encode( buffer, len, _write_buffer.get() );
     assert(ciphertext_len == len);
     _sock.write( _write_buffer, ciphertext_len );
     return ciphertext_len;
@@ -163,6 +168,44 @@ size_t stcp_socket::writesome( const std::shared_ptr<const char>& buf, size_t le
   return writesome(buf.get() + offset, len);
 }
 
+void stcp_socket::read_decrypted( char* buffer, size_t len )
+{ try {
+    assert( (len % 16) == 0 );
+    if( !_crypto_thread || len < GRAPHENE_NET_MIN_OFFLOADED_CRYPTO_SIZE )
+    {
+      read( buffer, len );
+      return;
+    }
+
+    std::shared_ptr<char> ciphertext(new char[len], [](char* p){ delete[] p; });
+    std::shared_ptr<char> plaintext(new char[len], [](char* p){ delete[] p; });
+    _sock.read( ciphertext, len, 0 );
+    // the stream is decrypted in order, as this waits for the decryption before anything else is read
+    std::shared_ptr<fc::aes_decoder> recv_aes = _recv_aes;
+    _crypto_thread->async( [recv_aes, ciphertext, plaintext, len]() {
+      recv_aes->decode( ciphertext.get(), len, plaintext.get() );
+    }, "stcp_decrypt" ).wait();
+    memcpy( buffer, plaintext.get(), len );
+} FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
+
+void stcp_socket::write_encrypted( const std::shared_ptr<const char>& buffer, size_t len )
+{ try {
+    assert( (len % 16) == 0 );
+    if( !_crypto_thread || len < GRAPHENE_NET_MIN_OFFLOADED_CRYPTO_SIZE )
+    {
+      write( buffer.get(), len );
+      return;
+    }
+
+    std::shared_ptr<char> ciphertext(new char[len], [](char* p){ delete[] p; });
+    std::shared_ptr<fc::aes_encoder> send_aes = _send_aes;
+    _crypto_thread->async( [send_aes, buffer, ciphertext, len]() {
+      uint32_t ciphertext_len = send_aes->encode( buffer.get(), len, ciphertext.get() );
+      FC_ASSERT( ciphertext_len == len );
+    }, "stcp_encrypt" ).wait();
+    _sock.write( ciphertext, len );
+} FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
+
 void stcp_socket::flush()
 {
   _sock.flush();
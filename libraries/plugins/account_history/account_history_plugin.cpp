@@ -26,6 +26,7 @@
 
 #include <graphene/chain/impacted.hpp>
 #include <graphene/chain/account_evaluator.hpp>
+#include <graphene/chain/account_history_store.hpp>
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/config.hpp>
 #include <graphene/chain/database.hpp>
@@ -36,6 +37,11 @@
 #include <fc/smart_ref_impl.hpp>
 #include <fc/thread/thread.hpp>
 
+#include <boost/thread/shared_mutex.hpp>
+
+#include <atomic>
+#include <mutex>
+
 namespace graphene { namespace account_history {
 
 namespace detail
@@ -55,6 +61,15 @@ class account_history_plugin_impl
        * and will process/index all operations that were applied in the block.
        */
       void update_account_histories( const signed_block& b );
+      /** same as update_account_histories() when the account histories are kept in @ref _store,
+       *  it doesn't use the database and may run on another thread
+       */
+      void store_account_histories( uint32_t block_num, uint32_t last_irreversible_block_num,
+                                    const vector< optional<operation_history_object> >& applied_operations,
+                                    const vector< flat_set<account_uid_type> >& impacted_accounts );
+      /** starts catch_up() if @ref _store is behind the head block and the applied operations log has the blocks */
+      void start_catch_up();
+      void stop_catch_up();
 
       graphene::chain::database& database()
       {
@@ -64,11 +79,40 @@ class account_history_plugin_impl
       account_history_plugin& _self;
       flat_set<account_uid_type> _tracked_accounts;
       bool _partial_operations = false;
-      primary_index< operation_history_index >* _oho_index;
+      append_only_index< operation_history_index >* _oho_index;
       uint32_t _max_ops_per_account = -1;
+      /** set if the account histories are kept on disk instead of in the object database */
+      std::shared_ptr<account_history_store> _store;
+      const account_history_sequence_index* _sequence_index = nullptr;
+      /** set with partial-operations only */
+      const operation_reference_count_index* _reference_index = nullptr;
    private:
-      /** add one history record, then check and remove the earliest history record */
+      void append_account_histories( uint32_t block_num, uint32_t last_irreversible_block_num,
+                                     const vector< optional<operation_history_object> >& applied_operations,
+                                     const vector< flat_set<account_uid_type> >& impacted_accounts );
+      /**
+       * Adds the blocks the store is missing from the applied operations log, on @ref _catch_up_thread while the
+       * node goes on. The applied blocks are left to it until it reaches the head block, then it hands over to
+       * store_account_histories() with the chain stopped for the last blocks. If it fails, the applied blocks are
+       * added by store_account_histories() from then on, without the blocks it couldn't add.
+       */
+      void catch_up();
+      /// catch_up() from @p block_num, which is left at the first block not added
+      void add_logged_blocks( uint32_t& block_num );
+
+      std::mutex                  _catch_up_mutex;
+      bool                        _catching_up = false;
+      std::atomic<bool>           _stop_catch_up{ false };
+      std::unique_ptr<fc::thread> _catch_up_thread;
+      fc::future<void>            _catch_up_done;
+
+      /** add one history record, the account is pruned at the end of the block if it has too many */
       void add_account_history( const account_uid_type account_uid, const operation_history_id_type op_id, uint16_t op_type );
+      /** remove the earliest history records of the accounts with too many, all of them at once */
+      void prune_account_histories();
+
+      /** accounts with more than _max_ops_per_account history records in the block being processed */
+      flat_set<account_uid_type> _accounts_to_prune;
 };
 
 account_history_plugin_impl::~account_history_plugin_impl()
@@ -76,26 +120,172 @@ account_history_plugin_impl::~account_history_plugin_impl()
    return;
 }
 
+void account_history_plugin_impl::store_account_histories( uint32_t block_num, uint32_t last_irreversible_block_num,
+                                                           const vector< optional<operation_history_object> >& applied_operations,
+                                                           const vector< flat_set<account_uid_type> >& impacted_accounts )
+{
+   std::lock_guard<std::mutex> guard( _catch_up_mutex );
+   // catch_up() takes the block from the applied operations log
+   if( _catching_up )
+      return;
+   append_account_histories( block_num, last_irreversible_block_num, applied_operations, impacted_accounts );
+}
+
+void account_history_plugin_impl::start_catch_up()
+{
+   const graphene::chain::database& db = database();
+   const applied_operations_log& log = db.get_applied_operations_log();
+   const uint32_t next_block = _store->flushed_block_num() + 1;
+   if( next_block > db.head_block_num() )
+      return;
+   if( !log.is_open() || log.first_block_num() == 0 || log.first_block_num() > next_block )
+   {
+      wlog( "The account history store has the blocks up to ${s} only, the blocks to the head block ${h} are missing, "
+            "enable applied-operations-log and replay the blockchain to add them",
+            ("s",next_block - 1)("h",db.head_block_num()) );
+      return;
+   }
+   ilog( "Adding blocks ${s} to ${h} to the account history store from the applied operations log",
+         ("s",next_block)("h",db.head_block_num()) );
+   _catching_up = true;
+   _catch_up_thread.reset( new fc::thread( "account_history_catch_up" ) );
+   _catch_up_done = _catch_up_thread->async( [this]() { catch_up(); }, "account history catch up" );
+}
+
+void account_history_plugin_impl::stop_catch_up()
+{
+   if( !_catch_up_thread )
+      return;
+   _stop_catch_up = true;
+   try
+   {
+      _catch_up_done.wait();
+   }
+   catch( const fc::exception& e )
+   {
+      elog( "Catching up with the account histories failed: ${e}", ("e",e.to_detail_string()) );
+   }
+   _catch_up_thread->quit();
+   _catch_up_thread.reset();
+}
+
+void account_history_plugin_impl::catch_up()
+{
+   uint32_t block_num = _store->flushed_block_num() + 1;
+   try
+   {
+      add_logged_blocks( block_num );
+      return;
+   }
+   catch( const fc::exception& e )
+   {
+      elog( "Catching up with the account histories failed at block ${b}: ${e}",
+            ("b",block_num)("e",e.to_detail_string()) );
+   }
+   catch( const std::exception& e )
+   {
+      elog( "Catching up with the account histories failed at block ${b}: ${e}", ("b",block_num)("e",e.what()) );
+   }
+   std::lock_guard<std::mutex> guard( _catch_up_mutex );
+   // the operations of the failed block added already
+   if( block_num > _store->flushed_block_num() )
+      _store->discard_from_block( block_num );
+   _catching_up = false;
+   elog( "The account histories miss the operations of the blocks from ${b} to the next block applied, "
+         "replay the blockchain to add them", ("b",block_num) );
+}
+
+void account_history_plugin_impl::add_logged_blocks( uint32_t& block_num )
+{
+   const graphene::chain::database& db = database();
+   const applied_operations_log& log = db.get_applied_operations_log();
+   // written out every so many blocks rather than for each one
+   const uint32_t flush_interval = 1000;
+   auto add_block = [&]( uint32_t last_irreversible_block_num ) {
+      optional< vector<operation_history_object> > ops = log.get_block( block_num );
+      FC_ASSERT( ops.valid(), "block ${b} is missing from the applied operations log", ("b",block_num) );
+      vector< optional<operation_history_object> > applied_operations;
+      vector< flat_set<account_uid_type> > impacted_accounts( ops->size() );
+      applied_operations.reserve( ops->size() );
+      for( size_t i = 0; i < ops->size(); ++i )
+      {
+         operation_history_get_impacted_account_uids( (*ops)[i], impacted_accounts[i] );
+         applied_operations.emplace_back( std::move( (*ops)[i] ) );
+      }
+      append_account_histories( block_num, last_irreversible_block_num, applied_operations, impacted_accounts );
+   };
+
+   for( ; block_num <= log.flushed_block_num() && !_stop_catch_up; ++block_num )
+   {
+      const bool flush = ( block_num % flush_interval == 0 || block_num == log.flushed_block_num() );
+      add_block( flush ? block_num : _store->flushed_block_num() );
+   }
+   if( _stop_catch_up )
+      return;
+
+   // the reversible blocks, with the chain held so that no block is applied or popped until the blocks applied
+   // afterwards go to store_account_histories()
+   boost::shared_lock<boost::shared_mutex> state_lock( db.state_mutex() );
+   const uint32_t last_irreversible_block_num = log.flushed_block_num();
+   for( ; block_num <= log.last_block_num(); ++block_num )
+      add_block( last_irreversible_block_num );
+   std::lock_guard<std::mutex> guard( _catch_up_mutex );
+   _catching_up = false;
+   ilog( "The account history store caught up with block ${b}", ("b",block_num - 1) );
+}
+
+void account_history_plugin_impl::append_account_histories( uint32_t block_num, uint32_t last_irreversible_block_num,
+                                                            const vector< optional<operation_history_object> >& applied_operations,
+                                                            const vector< flat_set<account_uid_type> >& impacted_accounts )
+{
+   // after a fork switch the operations of the replaced blocks are still there
+   _store->discard_from_block( block_num );
+   // when replaying, the blocks up to the last flushed one are in the store already
+   if( block_num > _store->flushed_block_num() )
+   {
+      for( size_t i = 0; i < applied_operations.size(); ++i )
+      {
+         const optional< operation_history_object >& o_op = applied_operations[i];
+         if( !o_op.valid() )
+            continue;
+         const flat_set<account_uid_type>& impacted_uids = impacted_accounts[i];
+         if( !_tracked_accounts.empty() )
+         {
+            flat_set<account_uid_type> tracked_uids;
+            for( auto account_uid : impacted_uids )
+               if( _tracked_accounts.find( account_uid ) != _tracked_accounts.end() )
+                  tracked_uids.insert( account_uid );
+            if( !tracked_uids.empty() )
+               _store->append( *o_op, tracked_uids );
+         }
+         else if( !impacted_uids.empty() )
+            _store->append( *o_op, impacted_uids );
+      }
+   }
+   _store->flush_until_block( last_irreversible_block_num );
+}
+
 void account_history_plugin_impl::update_account_histories( const signed_block& b )
 {
    graphene::chain::database& db = database();
+   if( _store )
+   {
+      store_account_histories( b.block_num(), db.get_dynamic_global_properties().last_irreversible_block_num,
+                               db.get_applied_operations(), db.get_applied_operations_impacted_accounts() );
+      return;
+   }
    const vector<optional< operation_history_object > >& hist = db.get_applied_operations();
-   bool is_first = true;
-   auto skip_oho_id = [&is_first,&db,this]() {
-      if( is_first && db._undo_db.enabled() ) // this ensures that the current id is rolled back on undo
-      {
-         db.remove( db.create<operation_history_object>( []( operation_history_object& obj) {} ) );
-         is_first = false;
-      }
-      else
-         _oho_index->use_next_id();
+   const vector< flat_set<account_uid_type> >& impacted = db.get_applied_operations_impacted_accounts();
+   // the history indexes are append-only, a skipped id is rolled back on undo like a used one
+   auto skip_oho_id = [this]() {
+      _oho_index->use_next_id();
    };
-   for( const optional< operation_history_object >& o_op : hist )
+   for( size_t i = 0; i < hist.size(); ++i )
    {
+      const optional< operation_history_object >& o_op = hist[i];
       optional<operation_history_object> oho;
 
       auto create_oho = [&]() {
-         is_first = false;
          return optional<operation_history_object>( db.create<operation_history_object>( [&]( operation_history_object& h )
          {
             if( o_op.valid() )
@@ -124,22 +314,7 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
       const operation_history_object& op = *o_op;
 
       // get the set of accounts this operation applies to
-      flat_set<account_uid_type> impacted_uids;
-      vector<authority> other;
-      operation_get_required_uid_authorities( op.op, impacted_uids, impacted_uids, impacted_uids, other,true);
-
-      graphene::chain::operation_get_impacted_account_uids( op.op, impacted_uids );
-
-      for( auto& a : other )
-         for( auto& item : a.account_uid_auths )
-            impacted_uids.insert( item.first.uid );
-
-      if (op.result.which() == operation_result::tag<advertising_confirm_result>::value)
-      {
-         auto result = op.result.get< advertising_confirm_result >();
-         for (auto& r : result)
-            impacted_uids.insert(r.first);
-      }
+      const flat_set<account_uid_type>& impacted_uids = impacted[i];
 
       // for each operation this account applies to that is in the config link it into the history
       if( _tracked_accounts.size() == 0 )
@@ -185,6 +360,7 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
       if ( _partial_operations && !oho.valid() )
          skip_oho_id();
    }
+   prune_account_histories();
 }
 
 void account_history_plugin_impl::add_account_history( const account_uid_type account_uid, const operation_history_id_type op_id, uint16_t op_type )
@@ -204,48 +380,44 @@ void account_history_plugin_impl::add_account_history( const account_uid_type ac
        obj.most_recent_op = ath.id;
        obj.total_ops = ath.sequence;
    });
-   // remove the earliest account history entry if too many
    // _max_ops_per_account is guaranteed to be non-zero outside
    if( stats_obj.total_ops - stats_obj.removed_ops > _max_ops_per_account )
+      _accounts_to_prune.insert( account_uid );
+}
+
+void account_history_plugin_impl::prune_account_histories()
+{
+   graphene::chain::database& db = database();
+   for( auto account_uid : _accounts_to_prune )
    {
-      // look for the earliest entry
-      const auto& his_idx = db.get_index_type<account_transaction_history_index>();
-      const auto& by_seq_idx = his_idx.indices().get<by_seq>();
-      auto itr = by_seq_idx.lower_bound( boost::make_tuple( account_uid, 0 ) );
-      // make sure don't remove the one just added
-      if( itr != by_seq_idx.end() && itr->account == account_uid && itr->id != ath.id )
+      const auto& stats_obj = db.get_account_by_uid(account_uid).statistics(db);
+      uint32_t kept = stats_obj.total_ops - stats_obj.removed_ops;
+      uint32_t removed = 0;
+      while( kept > _max_ops_per_account )
       {
-         // if found, remove the entry, and adjust account stats object
-         const auto remove_op_id = itr->operation_id;
-         const auto itr_remove = itr;
-         ++itr;
-         db.remove( *itr_remove );
-         db.modify( stats_obj, [&]( _account_statistics_object& obj ){
-             obj.removed_ops = obj.removed_ops + 1;
-         });
-         // modify previous node's next pointer
-         // this should be always true, but just have a check here
-         if( itr != by_seq_idx.end() && itr->account == account_uid )
-         {
-            db.modify( *itr, [&]( account_transaction_history_object& obj ){
-               obj.next = account_transaction_history_id_type();
-            });
-         }
-         // else need to modify the head pointer, but it shouldn't be true
-
+         const auto* earliest = _sequence_index->earliest( account_uid );
+         // make sure don't remove the latest one
+         if( earliest == nullptr || earliest->id == stats_obj.most_recent_op )
+            break;
+         const auto remove_op_id = earliest->operation_id;
+         db.remove( earliest->id(db) );
+         --kept;
+         ++removed;
          // remove the operation history entry if configured and no reference left
-         if( _partial_operations )
-         {
-            // check for references
-            const auto& by_opid_idx = his_idx.indices().get<by_opid>();
-            if( by_opid_idx.find( remove_op_id ) == by_opid_idx.end() )
-            {
-               // if no reference, remove
-               db.remove( remove_op_id(db) );
-            }
-         }
+         if( _partial_operations && _reference_index->references( remove_op_id ) == 0 )
+            db.remove( remove_op_id(db) );
       }
+      if( removed == 0 )
+         continue;
+      db.modify( stats_obj, [&]( _account_statistics_object& obj ){
+          obj.removed_ops = obj.removed_ops + removed;
+      });
+      // the earliest entry left doesn't point to the removed ones
+      db.modify( _sequence_index->earliest( account_uid )->id(db), [&]( account_transaction_history_object& obj ){
+         obj.next = account_transaction_history_id_type();
+      });
    }
+   _accounts_to_prune.clear();
 }
 
 } // end namespace detail
@@ -278,27 +450,58 @@ void account_history_plugin::plugin_set_program_options(
          ("track-account", boost::program_options::value<string>()->default_value("[]"), "Account ID to track history for (specified as a JSON array)")
          ("partial-operations", boost::program_options::value<bool>(), "Keep only those operations in memory that are related to account history tracking")
          ("max-ops-per-account", boost::program_options::value<uint32_t>(), "Maximum number of operations per account will be kept in memory")
+         ("history-on-disk", boost::program_options::value<bool>()->default_value(false),
+          "Keep the full account histories in files under the data directory instead of in memory, "
+          "partial-operations and max-ops-per-account are ignored then")
          ;
    cfg.add(cli);
 }
 
 void account_history_plugin::plugin_initialize(const boost::program_options::variables_map& options)
 {
-   database().applied_block.connect( [&]( const signed_block& b){ my->update_account_histories(b); } );
-   my->_oho_index = database().add_index< primary_index< operation_history_index > >();
-   database().add_index< primary_index< account_transaction_history_index > >();
+   my->_oho_index = database().add_index< append_only_index< operation_history_index > >();
+   auto ath_index = database().add_index< append_only_index< account_transaction_history_index > >();
+   my->_sequence_index = ath_index->add_secondary_index< account_history_sequence_index >();
 
    LOAD_VALUE_FLAT_SET(options, "track-account", my->_tracked_accounts, graphene::chain::account_uid_type);
    if (options.count("partial-operations")) {
        my->_partial_operations = options["partial-operations"].as<bool>();
    }
+   if( my->_partial_operations )
+       my->_reference_index = ath_index->add_secondary_index< operation_reference_count_index >();
    if (options.count("max-ops-per-account")) {
        my->_max_ops_per_account = options["max-ops-per-account"].as<uint32_t>();
    }
+   if( options.count("history-on-disk") && options["history-on-disk"].as<bool>() )
+   {
+       my->_store = std::make_shared<account_history_store>();
+       my->_store->open( app().data_dir() / "blockchain" / "account_history" );
+       app().set_account_history_store( my->_store );
+   }
+
+   if( my->_store && app().get_block_feed() != nullptr )
+   {
+       // only the store is written then, which can be done on another thread
+       detail::account_history_plugin_impl* impl = my.get();
+       app().get_block_feed()->subscribe( plugin_name(), vector<string>(),
+                                          [impl]( const graphene::app::applied_block_changes& changes ) {
+          impl->store_account_histories( changes.block_num, changes.last_irreversible_block_num,
+                                         *changes.applied_operations, *changes.impacted_accounts );
+       } );
+   }
+   else
+       database().applied_block.connect( [&]( const signed_block& b){ my->update_account_histories(b); } );
 }
 
 void account_history_plugin::plugin_startup()
 {
+   if( my->_store )
+      my->start_catch_up();
+}
+
+void account_history_plugin::plugin_shutdown()
+{
+   my->stop_catch_up();
 }
 
 flat_set<account_uid_type> account_history_plugin::tracked_accounts() const
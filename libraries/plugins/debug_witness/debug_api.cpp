@@ -1,5 +1,6 @@
 
 #include <fc/filesystem.hpp>
+#include <fc/thread/thread.hpp>
 #include <fc/optional.hpp>
 #include <fc/variant_object.hpp>
 #include <fc/smart_ref_impl.hpp>
@@ -15,6 +16,8 @@
 #include <graphene/debug_witness/debug_api.hpp>
 #include <graphene/debug_witness/debug_witness.hpp>
 
+#include <limits>
+
 namespace graphene { namespace debug_witness {
 
 namespace detail {
@@ -25,10 +28,16 @@ class debug_api_impl
       explicit debug_api_impl( graphene::app::application& _app );
 
       void debug_push_blocks( const std::string& src_filename, uint32_t count );
+      void debug_replay_blocks( const std::string& src_filename, uint32_t count );
       void debug_generate_blocks( const std::string& debug_key, uint32_t count );
+      std::vector< debug_scenario_result > debug_run_scenarios( const std::string& debug_key,
+                                                                const std::vector< debug_scenario >& scenarios );
       void debug_update_object( const fc::variant_object& update );
       void debug_stream_json_objects( const std::string& filename );
       void debug_stream_json_objects_flush();
+      void debug_stream_binary_objects( const std::string& filename, const std::vector< std::string >& object_types );
+      void debug_stream_binary_objects_flush();
+      std::vector< graphene::db::index_memory_stats > debug_get_index_memory_stats();
       std::shared_ptr< graphene::debug_witness_plugin::debug_witness_plugin > get_plugin();
 
       graphene::app::application& app;
@@ -73,6 +82,63 @@ void debug_api_impl::debug_push_blocks( const std::string& src_filename, uint32_
    }
 }
 
+void debug_api_impl::debug_replay_blocks( const std::string& src_filename, uint32_t count )
+{
+   if( count == 0 )
+      return;
+
+   std::shared_ptr< graphene::chain::database > db = app.chain_database();
+   fc::path src_path = fc::path( src_filename );
+   FC_ASSERT( fc::is_directory( src_path ), "${fn} is not a block_database", ("fn", src_filename) );
+
+   ilog( "Replaying ${n} from block_database ${fn}", ("n", count)("fn", src_filename) );
+   graphene::chain::block_database bdb;
+   bdb.open( src_path );
+   const uint32_t first_block = db->head_block_num()+1;
+   const uint32_t last_block = std::min<uint64_t>( std::numeric_limits<uint32_t>::max(), uint64_t(first_block) + count - 1 );
+   const uint32_t replay_skip = graphene::chain::database::replay_skip_flags;
+   graphene::chain::database::block_read_ahead read_ahead( *db, bdb, first_block, last_block, replay_skip );
+
+   const fc::time_point start = fc::time_point::now();
+   fc::time_point last_report = start;
+   uint32_t pushed = 0;
+   auto blocks_per_second = [&]( const fc::time_point& now ) -> double {
+      const int64_t elapsed = ( now - start ).count();
+      return elapsed > 0 ? double(pushed) * 1000000 / elapsed : 0;
+   };
+   for( ; pushed < count; ++pushed )
+   {
+      uint32_t skip = replay_skip;
+      fc::optional< graphene::chain::signed_block > block = read_ahead.next( skip );
+      if( !block.valid() )
+      {
+         wlog( "Block database ${fn} only contained ${i} of ${n} requested blocks", ("i", pushed)("n", count)("fn", src_filename) );
+         break;
+      }
+      try
+      {
+         db->push_block( *block, skip );
+      }
+      catch( const fc::exception& e )
+      {
+         // the blocks after it wouldn't link
+         elog( "Got exception pushing block ${bn} : ${bid} (${i} of ${n})", ("bn", block->block_num())("bid", block->id())("i", pushed)("n", count) );
+         elog( "Exception backtrace: ${bt}", ("bt", e.to_detail_string()) );
+         break;
+      }
+      const fc::time_point now = fc::time_point::now();
+      if( now - last_report >= fc::seconds( 10 ) )
+      {
+         ilog( "Replayed ${i} of ${n} blocks, head block ${h}, ${r} blocks/s",
+               ("i", pushed + 1)("n", count)("h", db->head_block_num())("r", blocks_per_second( now )) );
+         last_report = now;
+      }
+   }
+   const fc::time_point end = fc::time_point::now();
+   ilog( "Replayed ${i} blocks in ${t} sec, ${r} blocks/s",
+         ("i", pushed)("t", double( ( end - start ).count() ) / 1000000)("r", blocks_per_second( end )) );
+}
+
 void debug_api_impl::debug_generate_blocks( const std::string& debug_key, uint32_t count )
 {
    if( count == 0 )
@@ -99,6 +165,117 @@ void debug_api_impl::debug_generate_blocks( const std::string& debug_key, uint32
    }
 }
 
+namespace {
+   /**
+    * runs @p scenario on a database loaded from the state snapshot in @p snapshot_dir, written with @p db_version, in
+    * @p data_dir
+    */
+   debug_scenario_result run_scenario( const fc::path& snapshot_dir, const std::string& db_version,
+                                       const fc::path& data_dir, const fc::ecc::private_key& debug_private_key,
+                                       const debug_scenario& scenario )
+   {
+      debug_scenario_result result;
+      try
+      {
+         graphene::chain::database db;
+         db.import_state_snapshot( snapshot_dir, data_dir, db_version );
+         db.open( data_dir, []() -> graphene::chain::genesis_state_type {
+            FC_THROW( "The sandbox is loaded from a state snapshot" );
+         }, db_version );
+
+         for( const fc::variant_object& update : scenario.updates )
+            db.debug_update_state( update );
+
+         const graphene::chain::public_key_type debug_public_key = debug_private_key.get_public_key();
+         for( uint32_t i = 0; i < scenario.blocks; ++i )
+         {
+            graphene::chain::account_uid_type scheduled_witness = db.get_scheduled_witness( 1 );
+            fc::time_point_sec scheduled_time = db.get_slot_time( 1 );
+            const auto& witness = db.get_witness_by_uid( scheduled_witness );
+            if( witness.signing_key != debug_public_key )
+            {
+               fc::limited_mutable_variant_object update( GRAPHENE_MAX_NESTED_OBJECTS );
+               update("_action", "update")("id", witness.id)("signing_key", debug_public_key);
+               db.debug_update_state( update );
+            }
+            db.generate_block( scheduled_time, scheduled_witness, debug_private_key, graphene::chain::database::skip_nothing );
+         }
+
+         result.head_block_num = db.head_block_num();
+         for( const auto& id : scenario.watched_objects )
+         {
+            const graphene::db::object* obj = db.find_object( id );
+            result.objects.push_back( obj != nullptr ? obj->to_variant() : fc::variant() );
+         }
+         db.close( false );
+      }
+      catch( const fc::exception& e )
+      {
+         result.error = e.to_string();
+      }
+      catch( const std::exception& e )
+      {
+         result.error = e.what();
+      }
+      return result;
+   }
+}
+
+std::vector< debug_scenario_result > debug_api_impl::debug_run_scenarios( const std::string& debug_key,
+                                                                          const std::vector< debug_scenario >& scenarios )
+{
+   FC_ASSERT( scenarios.size() <= 16, "At most 16 scenarios can run at once" );
+   fc::optional<fc::ecc::private_key> debug_private_key = graphene::utilities::wif_to_key( debug_key );
+   FC_ASSERT( debug_private_key.valid() );
+   std::vector< debug_scenario_result > results;
+   if( scenarios.empty() )
+      return results;
+
+   // every scenario starts from a copy of the current state and runs on its own thread
+   fc::temp_directory work_dir( app.data_dir() );
+   const fc::path snapshot_dir = work_dir.path() / "snapshot";
+   app.chain_database()->export_state_snapshot( snapshot_dir );
+   const std::string db_version = app.chain_database()->get_db_version();
+
+   std::vector< std::unique_ptr<fc::thread> > threads;
+   // the threads use the snapshot and the scenarios, they are stopped and joined before those are gone whatever
+   // happens
+   struct threads_stopper
+   {
+      std::vector< std::unique_ptr<fc::thread> >& threads;
+      ~threads_stopper()
+      {
+         for( auto& thread : threads )
+            thread->quit();
+      }
+   } stopper{ threads };
+   std::vector< fc::future<debug_scenario_result> > runs;
+   for( size_t i = 0; i < scenarios.size(); ++i )
+   {
+      threads.emplace_back( new fc::thread( "debug_scenario" ) );
+      const fc::path data_dir = work_dir.path() / ( "scenario_" + std::to_string( i ) );
+      const debug_scenario& scenario = scenarios[i];
+      const fc::ecc::private_key& key = *debug_private_key;
+      runs.push_back( threads.back()->async( [&snapshot_dir,&db_version,data_dir,&key,&scenario]() {
+         return run_scenario( snapshot_dir, db_version, data_dir, key, scenario );
+      }, "debug_scenario" ) );
+   }
+   for( auto& run : runs )
+   {
+      try
+      {
+         results.push_back( run.wait() );
+      }
+      catch( const fc::exception& e )
+      {
+         debug_scenario_result failed;
+         failed.error = e.to_string();
+         results.push_back( failed );
+      }
+   }
+   return results;
+}
+
 void debug_api_impl::debug_update_object( const fc::variant_object& update )
 {
    std::shared_ptr< graphene::chain::database > db = app.chain_database();
@@ -120,6 +297,22 @@ void debug_api_impl::debug_stream_json_objects_flush()
    get_plugin()->flush_json_object_stream();
 }
 
+void debug_api_impl::debug_stream_binary_objects( const std::string& filename,
+                                                  const std::vector< std::string >& object_types )
+{
+   get_plugin()->set_binary_object_stream( filename, object_types );
+}
+
+void debug_api_impl::debug_stream_binary_objects_flush()
+{
+   get_plugin()->flush_binary_object_stream();
+}
+
+std::vector< graphene::db::index_memory_stats > debug_api_impl::debug_get_index_memory_stats()
+{
+   return app.chain_database()->get_index_memory_stats();
+}
+
 } // detail
 
 debug_api::debug_api( graphene::app::application& app )
@@ -132,11 +325,22 @@ void debug_api::debug_push_blocks( std::string source_filename, uint32_t count )
    my->debug_push_blocks( source_filename, count );
 }
 
+void debug_api::debug_replay_blocks( std::string source_filename, uint32_t count )
+{
+   my->debug_replay_blocks( source_filename, count );
+}
+
 void debug_api::debug_generate_blocks( std::string debug_key, uint32_t count )
 {
    my->debug_generate_blocks( debug_key, count );
 }
 
+std::vector< debug_scenario_result > debug_api::debug_run_scenarios( std::string debug_key,
+                                                                    std::vector< debug_scenario > scenarios )
+{
+   return my->debug_run_scenarios( debug_key, scenarios );
+}
+
 void debug_api::debug_update_object( fc::variant_object update )
 {
    my->debug_update_object( update );
@@ -152,5 +356,20 @@ void debug_api::debug_stream_json_objects_flush()
    my->debug_stream_json_objects_flush();
 }
 
+void debug_api::debug_stream_binary_objects( std::string filename, std::vector< std::string > object_types )
+{
+   my->debug_stream_binary_objects( filename, object_types );
+}
+
+void debug_api::debug_stream_binary_objects_flush()
+{
+   my->debug_stream_binary_objects_flush();
+}
+
+std::vector< graphene::db::index_memory_stats > debug_api::debug_get_index_memory_stats()
+{
+   return my->debug_get_index_memory_stats();
+}
+
 
 } } // graphene::debug_witness
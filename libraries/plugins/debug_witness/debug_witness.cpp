@@ -31,6 +31,9 @@
 #include <fc/smart_ref_impl.hpp>
 #include <fc/thread/thread.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <iostream>
 
 using namespace graphene::debug_witness_plugin;
@@ -39,6 +42,14 @@ using std::vector;
 
 namespace bpo = boost::program_options;
 
+/// appends an integer the way fc::raw packs it
+template<typename T>
+static void append_raw( std::vector<char>& out, const T& value )
+{
+   const char* bytes = reinterpret_cast<const char*>( &value );
+   out.insert( out.end(), bytes, bytes + sizeof(T) );
+}
+
 debug_witness_plugin::~debug_witness_plugin() {}
 
 void debug_witness_plugin::plugin_set_program_options(
@@ -49,7 +60,9 @@ void debug_witness_plugin::plugin_set_program_options(
    command_line_options.add_options()
          ("private-key", bpo::value<vector<string>>()->composing()->multitoken()->
           DEFAULT_VALUE_VECTOR(std::make_pair(chain::public_key_type(default_priv_key.get_public_key()), graphene::utilities::key_to_wif(default_priv_key))),
-          "Tuple of [PublicKey, WIF private key] (may specify multiple times)");
+          "Tuple of [PublicKey, WIF private key] (may specify multiple times)")
+         ("object-stream-buffer-size", bpo::value<uint64_t>()->default_value(64 * 1024 * 1024),
+          "Bytes buffered by the binary object stream before the chain waits for its writer thread");
    config_file_options.add(command_line_options);
 }
 
@@ -62,6 +75,8 @@ void debug_witness_plugin::plugin_initialize(const boost::program_options::varia
 { try {
    ilog("debug_witness plugin:  plugin_initialize() begin");
    _options = &options;
+   if( options.count("object-stream-buffer-size") )
+      _object_stream_buffer_size = options["object-stream-buffer-size"].as<uint64_t>();
 
    if( options.count("private-key") )
    {
@@ -118,6 +133,24 @@ void debug_witness_plugin::on_changed_objects( const std::vector<graphene::db::o
          }
       }
    }
+   if( _binary_object_stream )
+   {
+      const chain::database& db = database();
+      for( const graphene::db::object_id_type& oid : ids )
+      {
+         if( !is_streamed_binary( oid ) )
+            continue;
+         const graphene::db::object* obj = db.find_object( oid );
+         if( obj != nullptr )
+         {
+            begin_binary_record( 1 );
+            append_raw( _record, oid.number );
+            const std::vector<char> packed = obj->pack();
+            _record.insert( _record.end(), packed.begin(), packed.end() );
+            write_binary_record();
+         }
+      }
+   }
 }
 
 void debug_witness_plugin::on_removed_objects( const std::vector<graphene::db::object_id_type>& ids, const std::vector<const graphene::db::object*> objs, const fc::flat_set<graphene::chain::account_uid_type>& impacted_accounts )
@@ -129,6 +162,17 @@ void debug_witness_plugin::on_removed_objects( const std::vector<graphene::db::o
          (*_json_object_stream) << "{\"id\":" << fc::json::to_string( obj->id ) << "}\n";
       }
    }
+   if( _binary_object_stream )
+   {
+      for( const graphene::db::object* obj : objs )
+      {
+         if( !is_streamed_binary( obj->id ) )
+            continue;
+         begin_binary_record( 2 );
+         append_raw( _record, obj->id.number );
+         write_binary_record();
+      }
+   }
 }
 
 void debug_witness_plugin::on_applied_block( const graphene::chain::signed_block& b )
@@ -137,6 +181,30 @@ void debug_witness_plugin::on_applied_block( const graphene::chain::signed_block
    {
       (*_json_object_stream) << "{\"bn\":" << fc::to_string( b.block_num() ) << "}\n";
    }
+   if( _binary_object_stream )
+   {
+      begin_binary_record( 0 );
+      append_raw( _record, b.block_num() );
+      write_binary_record();
+   }
+}
+
+bool debug_witness_plugin::is_streamed_binary( graphene::db::object_id_type id )const
+{
+   return _binary_object_types.empty() || _binary_object_types.count( uint16_t( id.space() << 8 | id.type() ) ) > 0;
+}
+
+void debug_witness_plugin::begin_binary_record( uint8_t kind )
+{
+   _record.resize( sizeof(uint32_t) );
+   _record.push_back( char(kind) );
+}
+
+void debug_witness_plugin::write_binary_record()
+{
+   const uint32_t size = _record.size() - sizeof(uint32_t);
+   std::memcpy( _record.data(), &size, sizeof(size) );
+   _binary_object_stream->write( _record );
 }
 
 void debug_witness_plugin::set_json_object_stream( const std::string& filename )
@@ -155,6 +223,35 @@ void debug_witness_plugin::flush_json_object_stream()
       _json_object_stream->flush();
 }
 
+void debug_witness_plugin::set_binary_object_stream( const std::string& filename,
+                                                     const std::vector<std::string>& object_types )
+{
+   fc::flat_set< uint16_t > types;
+   for( const std::string& t : object_types )
+   {
+      const auto dot = t.find( '.' );
+      const auto is_number = []( const std::string& s ) {
+         return !s.empty() && s.size() <= 3 && std::all_of( s.begin(), s.end(), []( char c ) { return std::isdigit( c ); } );
+      };
+      FC_ASSERT( dot != std::string::npos && is_number( t.substr( 0, dot ) ) && is_number( t.substr( dot + 1 ) ),
+                 "Invalid object type ${t}, expected space.type", ("t",t) );
+      const uint32_t space = std::stoul( t.substr( 0, dot ) );
+      const uint32_t type = std::stoul( t.substr( dot + 1 ) );
+      FC_ASSERT( space <= 0xff && type <= 0xff, "Invalid object type ${t}", ("t",t) );
+      types.insert( uint16_t( space << 8 | type ) );
+   }
+
+   _binary_object_stream.reset();
+   _binary_object_types = std::move( types );
+   _binary_object_stream.reset( new graphene::utilities::async_file_writer( filename, _object_stream_buffer_size ) );
+}
+
+void debug_witness_plugin::flush_binary_object_stream()
+{
+   if( _binary_object_stream )
+      _binary_object_stream->flush();
+}
+
 void debug_witness_plugin::plugin_shutdown()
 {
    if( _json_object_stream )
@@ -162,5 +259,6 @@ void debug_witness_plugin::plugin_shutdown()
       _json_object_stream->close();
       _json_object_stream.reset();
    }
+   _binary_object_stream.reset();
    return;
 }
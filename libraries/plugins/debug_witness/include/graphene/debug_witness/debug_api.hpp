@@ -26,7 +26,11 @@
 #include <memory>
 #include <string>
 
+#include <graphene/db/index.hpp>
+#include <graphene/db/object_id.hpp>
+
 #include <fc/api.hpp>
+#include <fc/optional.hpp>
 #include <fc/variant_object.hpp>
 
 namespace graphene { namespace app {
@@ -39,6 +43,26 @@ namespace detail {
 class debug_api_impl;
 }
 
+/// A what-if run of debug_api::debug_run_scenarios()
+struct debug_scenario
+{
+   /// object updates applied first, in the format of debug_update_object()
+   std::vector< fc::variant_object >               updates;
+   /// number of blocks then generated
+   uint32_t                                        blocks = 0;
+   /// objects returned as they are at the end
+   std::vector< graphene::db::object_id_type >     watched_objects;
+};
+
+struct debug_scenario_result
+{
+   uint32_t                                        head_block_num = 0;
+   /// the watched objects in the order asked for, null when they don't exist
+   std::vector< fc::variant >                      objects;
+   /// set when the scenario failed
+   fc::optional< std::string >                     error;
+};
+
 class debug_api
 {
    public:
@@ -49,11 +73,25 @@ class debug_api
        */
       void debug_push_blocks( std::string src_filename, uint32_t count );
 
+      /**
+       * Push blocks from existing database as fast as reindexing does: with the checks reindex skips, the blocks
+       * decoded ahead on the worker threads, and the progress and throughput logged. For blocks known to be valid.
+       */
+      void debug_replay_blocks( std::string src_filename, uint32_t count );
+
       /**
        * Generate blocks locally.
        */
       void debug_generate_blocks( std::string debug_key, uint32_t count );
 
+      /**
+       * Run what-if scenarios concurrently, each on its own copy of the current state, which is left unchanged.
+       * The copies are made from a state snapshot, so the scenarios can update objects and generate blocks
+       * with @p debug_key without affecting each other, see debug_scenario. At most 16 scenarios.
+       */
+      std::vector< debug_scenario_result > debug_run_scenarios( std::string debug_key,
+                                                                std::vector< debug_scenario > scenarios );
+
       /**
        * Directly manipulate database objects (will undo and re-apply last block with new changes post-applied).
        */
@@ -82,15 +120,42 @@ class debug_api
        */
       void debug_stream_json_objects_flush();
 
+      /**
+       * Stream the changed objects to file in binary, written by a background thread. Much cheaper for the chain
+       * than the JSON stream, see debug_witness_plugin::set_binary_object_stream() for the format.
+       *
+       * @param object_types the "space.type" of the objects to stream, e.g. "1.2", all objects when empty
+       */
+      void debug_stream_binary_objects( std::string filename, std::vector< std::string > object_types );
+
+      /**
+       * Wait until the binary stream is written and flush it.
+       */
+      void debug_stream_binary_objects_flush();
+
+      /**
+       * Get the number of objects of each index and an estimate of the memory they and the index take, computed by
+       * going through all the objects while the chain waits. The biggest index first.
+       */
+      std::vector< graphene::db::index_memory_stats > debug_get_index_memory_stats();
+
       std::shared_ptr< detail::debug_api_impl > my;
 };
 
 } }
 
+FC_REFLECT( graphene::debug_witness::debug_scenario, (updates)(blocks)(watched_objects) )
+FC_REFLECT( graphene::debug_witness::debug_scenario_result, (head_block_num)(objects)(error) )
+
 FC_API(graphene::debug_witness::debug_api,
        (debug_push_blocks)
+       (debug_replay_blocks)
        (debug_generate_blocks)
+       (debug_run_scenarios)
        (debug_update_object)
        (debug_stream_json_objects)
        (debug_stream_json_objects_flush)
+       (debug_stream_binary_objects)
+       (debug_stream_binary_objects_flush)
+       (debug_get_index_memory_stats)
      )
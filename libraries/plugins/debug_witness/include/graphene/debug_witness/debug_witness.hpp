@@ -26,6 +26,7 @@
 #include <graphene/app/plugin.hpp>
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/protocol/types.hpp>
+#include <graphene/utilities/async_file_writer.hpp>
 
 #include <fc/thread/future.hpp>
 #include <fc/container/flat.hpp>
@@ -50,17 +51,42 @@ public:
    void set_json_object_stream( const std::string& filename );
    void flush_json_object_stream();
 
+   /**
+    * Streams the changes to @p filename in binary, written by a background thread. Each change is a record:
+    *
+    *    uint32  size of the rest of the record
+    *    uint8   kind: 0 applied block, 1 changed object, 2 removed object
+    *    then for an applied block the uint32 block number, for a changed object the uint64 object id followed by
+    *    the object packed with fc::raw, for a removed object the uint64 object id
+    *
+    * The integers are little endian, like fc::raw packs them.
+    *
+    * @param object_types the "space.type" of the objects to stream, e.g. "1.2", all objects when empty
+    */
+   void set_binary_object_stream( const std::string& filename, const std::vector<std::string>& object_types );
+   void flush_binary_object_stream();
+
 private:
 
    void on_changed_objects( const std::vector<graphene::db::object_id_type>& ids, const fc::flat_set<graphene::chain::account_uid_type>& impacted_accounts );
    void on_removed_objects( const std::vector<graphene::db::object_id_type>& ids, const std::vector<const graphene::db::object*> objs, const fc::flat_set<graphene::chain::account_uid_type>& impacted_accounts );
    void on_applied_block( const graphene::chain::signed_block& b );
 
+   bool is_streamed_binary( graphene::db::object_id_type id )const;
+   /// starts a record of the binary stream in _record
+   void begin_binary_record( uint8_t kind );
+   void write_binary_record();
+
    boost::program_options::variables_map _options;
 
    std::map<chain::public_key_type, fc::ecc::private_key> _private_keys;
 
    std::shared_ptr< std::ofstream > _json_object_stream;
+   std::unique_ptr< graphene::utilities::async_file_writer > _binary_object_stream;
+   /// the (space << 8 | type) of the objects streamed in binary, all when empty
+   fc::flat_set< uint16_t > _binary_object_types;
+   std::vector< char > _record;
+   uint64_t _object_stream_buffer_size = 64 * 1024 * 1024;
    boost::signals2::scoped_connection _applied_block_conn;
    boost::signals2::scoped_connection _changed_objects_conn;
    boost::signals2::scoped_connection _removed_objects_conn;
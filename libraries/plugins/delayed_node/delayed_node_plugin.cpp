@@ -42,10 +42,42 @@ struct delayed_node_plugin_impl {
    fc::http::websocket_client client;
    std::shared_ptr<fc::rpc::websocket_api_connection> client_connection;
    fc::api<graphene::app::database_api> database_api;
+   /// the block API of the trusted node, not set when the node doesn't give access to it
+   fc::optional< fc::api<graphene::app::block_api> > block_api;
    boost::signals2::scoped_connection client_connection_closed;
-   graphene::chain::block_id_type last_received_remote_head;
-   graphene::chain::block_id_type last_processed_remote_head;
+   uint32_t blocks_per_request = 100;
+   /// follows the head block of the trusted node by applying its state diffs, see database::apply_state_diff()
+   bool apply_state_diffs = false;
+   bool syncing = false;
+   bool sync_requested = false;
+
+   /// @return the blocks from @p first on, at most up to @p last, or just the first one without the block API
+   std::vector<graphene::chain::signed_block> fetch_blocks( uint32_t first, uint32_t last );
 };
+
+std::vector<graphene::chain::signed_block> delayed_node_plugin_impl::fetch_blocks( uint32_t first, uint32_t last )
+{
+   std::vector<graphene::chain::signed_block> blocks;
+   if( block_api.valid() )
+   {
+      // a range of packed blocks in one call, only irreversible ones are returned
+      graphene::app::raw_block_range range = (*block_api)->get_raw_block_range( first, last - first + 1 );
+      blocks.reserve( range.entries.size() );
+      for( const auto& e : range.entries )
+      {
+         if( e.block_size == 0 || e.block_pos + e.block_size > range.blocks.size() )
+            break;
+         fc::datastream<const char*> ds( range.blocks.data() + e.block_pos, e.block_size );
+         blocks.emplace_back();
+         fc::raw::unpack( ds, blocks.back() );
+      }
+      return blocks;
+   }
+   fc::optional<graphene::chain::signed_block> block = database_api->get_block( first );
+   if( block.valid() )
+      blocks.push_back( std::move( *block ) );
+   return blocks;
+}
 }
 
 delayed_node_plugin::delayed_node_plugin()
@@ -59,6 +91,12 @@ void delayed_node_plugin::plugin_set_program_options(bpo::options_description& c
 {
    cli.add_options()
          ("trusted-node", boost::program_options::value<std::string>()->required(), "RPC endpoint of a trusted validating node (required)")
+         ("delayed-node-blocks-per-request", boost::program_options::value<uint32_t>()->default_value(100),
+          "Number of blocks fetched from the trusted node in one call while catching up, at most 1000")
+         ("delayed-node-apply-state-diffs", boost::program_options::bool_switch()->default_value(false),
+          "Run as a replica of the trusted node: follow its head block by applying the object changes of its blocks "
+          "instead of evaluating them, the trusted node must keep them (state-diffs-kept) and run the same plugins, "
+          "applied-operations-log can't be enabled then")
          ;
    cfg.add(cli);
 }
@@ -70,11 +108,39 @@ void delayed_node_plugin::connect()
    my->client_connection_closed = my->client_connection->closed.connect([this] {
       connection_failed();
    });
+
+   my->block_api.reset();
+   try
+   {
+      auto login = my->client_connection->get_remote_api<graphene::app::login_api>(1);
+      my->block_api = login->block();
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "The block API of the trusted node isn't available, fetching one block per call: ${e}",
+            ("e", e.to_string()) );
+   }
+
+   // a sync is started by every block the trusted node applies instead of polling it
+   my->database_api->set_block_applied_callback([this]( const fc::variant& )
+   {
+      schedule_sync();
+   } );
+   schedule_sync();
 }
 
 void delayed_node_plugin::plugin_initialize(const boost::program_options::variables_map& options)
 {
    my->remote_endpoint = "ws://" + options.at("trusted-node").as<std::string>();
+   if( options.count("delayed-node-blocks-per-request") )
+      my->blocks_per_request = std::max<uint32_t>( 1, std::min<uint32_t>( 1000,
+                                  options.at("delayed-node-blocks-per-request").as<uint32_t>() ) );
+   if( options.count("delayed-node-apply-state-diffs") )
+      my->apply_state_diffs = options.at("delayed-node-apply-state-diffs").as<bool>();
+   // the state diffs don't have the operations of their blocks
+   FC_ASSERT( !my->apply_state_diffs || !options.count("applied-operations-log")
+              || !options.at("applied-operations-log").as<bool>(),
+              "delayed-node-apply-state-diffs and applied-operations-log can't be enabled together" );
 }
 
 void delayed_node_plugin::sync_with_trusted_node()
@@ -85,9 +151,11 @@ void delayed_node_plugin::sync_with_trusted_node()
    while( true )
    {
       graphene::chain::dynamic_global_property_object remote_dpo = my->database_api->get_dynamic_global_properties();
-      if( remote_dpo.last_irreversible_block_num <= db.head_block_num() )
+      const uint32_t last = remote_dpo.last_irreversible_block_num;
+      if( last <= db.head_block_num() )
       {
-         if( remote_dpo.last_irreversible_block_num < db.head_block_num() )
+         // a replica is ahead of the last irreversible block of the trusted node
+         if( last < db.head_block_num() && !my->apply_state_diffs )
          {
             wlog( "Trusted node seems to be behind delayed node" );
          }
@@ -98,52 +166,88 @@ void delayed_node_plugin::sync_with_trusted_node()
          break;
       }
       pass_count++;
-      while( remote_dpo.last_irreversible_block_num > db.head_block_num() )
+
+      auto fetch = [this,last]( uint32_t first ) {
+         const uint32_t window_end = std::min<uint64_t>( last, uint64_t(first) + my->blocks_per_request - 1 );
+         return fc::async( [this,first,window_end]() { return my->fetch_blocks( first, window_end ); },
+                           "delayed_node_fetch" );
+      };
+      auto pending = fetch( db.head_block_num() + 1 );
+      while( true )
       {
-         fc::optional<graphene::chain::signed_block> block = my->database_api->get_block( db.head_block_num()+1 );
-         FC_ASSERT(block, "Trusted node claims it has blocks it doesn't actually have.");
-         ilog("Pushing block #${n}", ("n", block->block_num()));
-         db.push_block(*block);
-         synced_blocks++;
+         std::vector<graphene::chain::signed_block> blocks = pending.wait();
+         FC_ASSERT( !blocks.empty(), "Trusted node claims it has blocks it doesn't actually have." );
+         FC_ASSERT( blocks.front().block_num() == db.head_block_num() + 1, "Trusted node returned other blocks" );
+         const uint32_t next = blocks.back().block_num() + 1;
+         const bool more = ( next <= last );
+         if( more )
+         {
+            // the next window is requested before this one is pushed, yielding lets the request go out
+            pending = fetch( next );
+            fc::yield();
+         }
+         for( const auto& block : blocks )
+         {
+            ilog("Pushing block #${n}", ("n", block.block_num()));
+            db.push_block(block);
+            synced_blocks++;
+         }
+         if( !more )
+            break;
       }
    }
 }
 
-void delayed_node_plugin::mainloop()
+void delayed_node_plugin::sync_state_diffs()
 {
+   FC_ASSERT( my->block_api.valid(), "The state diffs are fetched through the block API of the trusted node" );
+   auto& db = database();
    while( true )
    {
-      try
-      {
-         fc::usleep( fc::microseconds( 296645 ) );  // wake up a little over 3Hz
-
-         if( my->last_received_remote_head == my->last_processed_remote_head )
-            continue;
-
-         sync_with_trusted_node();
-         my->last_processed_remote_head = my->last_received_remote_head;
-      }
-      catch( const fc::exception& e )
-      {
-         elog("Error during connection: ${e}", ("e", e.to_detail_string()));
-      }
+      const std::vector<graphene::chain::state_diff> diffs = (*my->block_api)->get_state_diffs(
+            db.head_block_id(), std::min<uint32_t>( 100, my->blocks_per_request ) );
+      // none kept from the head block on, the irreversible blocks are pushed until they are
+      if( diffs.empty() )
+         return;
+      for( const auto& diff : diffs )
+         db.apply_state_diff( diff );
    }
 }
 
-void delayed_node_plugin::plugin_startup()
+void delayed_node_plugin::schedule_sync()
 {
+   my->sync_requested = true;
+   if( my->syncing )
+      return;
+   my->syncing = true;
    fc::async([this]()
    {
-      mainloop();
-   });
+      // the blocks the trusted node applies meanwhile ask for one more round
+      while( my->sync_requested )
+      {
+         my->sync_requested = false;
+         try
+         {
+            if( my->apply_state_diffs )
+               sync_state_diffs();
+            sync_with_trusted_node();
+            if( my->apply_state_diffs )
+               sync_state_diffs();
+         }
+         catch( const fc::exception& e )
+         {
+            elog("Error during connection: ${e}", ("e", e.to_detail_string()));
+         }
+      }
+      my->syncing = false;
+   }, "delayed_node_sync");
+}
 
+void delayed_node_plugin::plugin_startup()
+{
    try
    {
       connect();
-      my->database_api->set_block_applied_callback([this]( const fc::variant& block_id )
-      {
-         fc::from_variant( block_id, my->last_received_remote_head, GRAPHENE_MAX_NESTED_OBJECTS );
-      } );
       return;
    }
    catch (const fc::exception& e)
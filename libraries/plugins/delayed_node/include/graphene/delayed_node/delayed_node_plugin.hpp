@@ -40,12 +40,15 @@ public:
                                            boost::program_options::options_description& cfg) override;
    virtual void plugin_initialize(const boost::program_options::variables_map& options) override;
    virtual void plugin_startup() override;
-   void mainloop();
 
 protected:
    void connection_failed();
    void connect();
    void sync_with_trusted_node();
+   /// applies the state diffs of the blocks of the trusted node after the head block, as long as it keeps them
+   void sync_state_diffs();
+   /// syncs now, or once more after the sync in progress
+   void schedule_sync();
 };
 
 } } //graphene::account_history
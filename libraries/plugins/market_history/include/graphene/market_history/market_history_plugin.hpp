@@ -215,6 +215,50 @@ typedef generic_index<bucket_object, bucket_object_multi_index_type> bucket_inde
 typedef generic_index<order_history_object, order_history_multi_index_type> history_index;
 typedef generic_index<market_ticker_object, market_ticker_object_multi_index_type> market_ticker_index;
 
+/**
+ *  @brief The latest buckets of each market and bucket size, in rings of fixed size indexed by bucket number
+ *
+ *  It follows the changes of the bucket index, including undo, and serves get_market_history without walking it.
+ *  A ring covers its latest bucket and the capacity - 1 before, which is what the plugin keeps; when there are older
+ *  buckets, e.g. after history-per-size was lowered, ranges starting before the ring are left to the bucket index.
+ */
+class bucket_ring_index : public secondary_index
+{
+   public:
+      virtual void object_inserted( const object& obj ) override;
+      virtual void object_removed( const object& obj ) override;
+      virtual void object_modified( const object& after ) override;
+
+      /// number of buckets in each ring, to be set before any bucket is added
+      void set_capacity( uint32_t capacity ) { _capacity = std::max<uint32_t>( capacity, 1 ); }
+
+      /**
+       * Adds to @p result the buckets of the market opened in [start, end], the oldest first, until it has @p limit.
+       * @return false if the range starts before the ring and there are buckets which are not in it
+       */
+      bool get_buckets( asset_aid_type base, asset_aid_type quote, uint32_t seconds,
+                        fc::time_point_sec start, fc::time_point_sec end, size_t limit,
+                        vector<bucket_object>& result )const;
+
+   private:
+      typedef std::tuple<asset_aid_type,asset_aid_type,uint32_t> ring_key;
+      struct ring
+      {
+         uint64_t                          latest_num = 0;
+         /// slot of bucket number n is n % size
+         vector< optional<bucket_object> > slots;
+         uint32_t                          in_ring = 0;
+         /// buckets of the market and size in the bucket index
+         uint32_t                          total = 0;
+
+         uint64_t first_num()const { return latest_num + 1 >= slots.size() ? latest_num + 1 - slots.size() : 0; }
+      };
+
+      static uint64_t bucket_num( const bucket_object& b ) { return b.key.open.sec_since_epoch() / b.key.seconds; }
+
+      uint32_t                  _capacity = 1001;
+      std::map< ring_key, ring > _rings;
+};
 
 namespace detail
 {
@@ -52,6 +52,29 @@ class market_history_plugin_impl
        */
       void update_market_histories( const signed_block& b );
 
+      /** what the maker fills of a block did to the buckets of a market, the buckets are updated once per block */
+      struct bucket_update
+      {
+         share_type base_volume;
+         share_type quote_volume;
+         price      open;
+         price      close;
+         price      high;
+         price      low;
+      };
+      typedef std::map< std::pair<asset_aid_type,asset_aid_type>, bucket_update > bucket_updates;
+
+      /** writes @p updates into the buckets opened at @p now and removes the buckets out of the tracked history */
+      void update_buckets( fc::time_point_sec now, const bucket_updates& updates );
+
+      typedef flat_set< std::pair<asset_aid_type,asset_aid_type> > markets;
+
+      /**
+       * removes the order histories of @p filled_markets beyond both max_order_his_records_per_market and
+       * max_order_his_seconds_per_market at @p now, once per block instead of after every fill
+       */
+      void prune_order_histories( fc::time_point_sec now, const markets& filled_markets );
+
       graphene::chain::database& database()
       {
          return _self.database();
@@ -67,12 +90,18 @@ class market_history_plugin_impl
 
 struct operation_process_fill_order
 {
+   typedef market_history_plugin_impl::bucket_updates bucket_updates;
+   typedef market_history_plugin_impl::markets        markets;
+
    market_history_plugin&            _plugin;
    fc::time_point_sec                _now;
    const market_ticker_meta_object*& _meta;
+   bucket_updates&                   _bucket_updates;
+   markets&                          _filled_markets;
 
-   operation_process_fill_order( market_history_plugin& mhp, fc::time_point_sec n, const market_ticker_meta_object*& meta )
-   :_plugin(mhp),_now(n),_meta(meta) {}
+   operation_process_fill_order( market_history_plugin& mhp, fc::time_point_sec n, const market_ticker_meta_object*& meta,
+                                 bucket_updates& updates, markets& filled_markets )
+   :_plugin(mhp),_now(n),_meta(meta),_bucket_updates(updates),_filled_markets(filled_markets) {}
 
    typedef void result_type;
 
@@ -84,9 +113,7 @@ struct operation_process_fill_order
    {
       //ilog( "processing ${o}", ("o",o) );
       auto& db         = _plugin.database();
-      const auto& order_his_idx = db.get_index_type<history_index>().indices();
-      const auto& history_idx = order_his_idx.get<by_key>();
-      const auto& his_time_idx = order_his_idx.get<by_market_time>();
+      const auto& history_idx = db.get_index_type<history_index>().indices().get<by_key>();
 
       // To save new filled order data
       history_key hkey;
@@ -122,39 +149,8 @@ struct operation_process_fill_order
             _meta = &( *meta_idx.begin() );
       }
 
-      // To remove old filled order data
-      const auto max_records = _plugin.max_order_his_records_per_market();
-      hkey.sequence += max_records;
-      itr = history_idx.lower_bound( hkey );
-      if( itr != history_idx.end() && itr->key.base == hkey.base && itr->key.quote == hkey.quote )
-      {
-         const auto max_seconds = _plugin.max_order_his_seconds_per_market();
-         fc::time_point_sec min_time;
-         if( min_time + max_seconds < _now )
-            min_time = _now - max_seconds;
-         auto time_itr = his_time_idx.lower_bound( std::make_tuple( hkey.base, hkey.quote, min_time ) );
-         if( time_itr != his_time_idx.end() && time_itr->key.base == hkey.base && time_itr->key.quote == hkey.quote )
-         {
-            if( itr->key.sequence >= time_itr->key.sequence )
-            {
-               while( itr != history_idx.end() && itr->key.base == hkey.base && itr->key.quote == hkey.quote )
-               {
-                  auto old_itr = itr;
-                  ++itr;
-                  db.remove( *old_itr );
-               }
-            }
-            else
-            {
-               while( time_itr != his_time_idx.end() && time_itr->key.base == hkey.base && time_itr->key.quote == hkey.quote )
-               {
-                  auto old_itr = time_itr;
-                  ++time_itr;
-                  db.remove( *old_itr );
-               }
-            }
-         }
-      }
+      // old filled order data is removed at the end of the block
+      _filled_markets.insert( std::make_pair( hkey.base, hkey.quote ) );
 
       // To update ticker data and buckets data, only update for maker orders
       if( !o.is_maker )
@@ -202,90 +198,40 @@ struct operation_process_fill_order
          });
       }
 
-      // To update buckets data
-      const auto max_history = _plugin.max_history();
-      if( max_history == 0 ) return;
-
-      const auto& buckets = _plugin.tracked_buckets();
-      if( buckets.size() == 0 ) return;
+      // To update buckets data, gathered for the whole block
+      if( _plugin.max_history() == 0 || _plugin.tracked_buckets().empty() )
+         return;
 
-      const auto& bucket_idx = db.get_index_type<bucket_index>();
-      for( auto bucket : buckets )
+      auto update_itr = _bucket_updates.find( std::make_pair( key.base, key.quote ) );
+      if( update_itr == _bucket_updates.end() )
       {
-          auto bucket_num = _now.sec_since_epoch() / bucket;
-          fc::time_point_sec cutoff;
-          if( bucket_num > max_history )
-             cutoff = cutoff + ( bucket * ( bucket_num - max_history ) );
-
-          key.seconds = bucket;
-          key.open    = fc::time_point_sec() + ( bucket_num * bucket );
-
-          const auto& by_key_idx = bucket_idx.indices().get<by_key>();
-          auto bucket_itr = by_key_idx.find( key );
-          if( bucket_itr == by_key_idx.end() )
-          { // create new bucket
-            /* const auto& obj = */
-            db.create<bucket_object>( [&]( bucket_object& b ){
-                 b.key = key;
-                 b.base_volume = trade_price.base.amount;
-                 b.quote_volume = trade_price.quote.amount;
-                 b.open_base = fill_price.base.amount;
-                 b.open_quote = fill_price.quote.amount;
-                 b.close_base = fill_price.base.amount;
-                 b.close_quote = fill_price.quote.amount;
-                 b.high_base = b.close_base;
-                 b.high_quote = b.close_quote;
-                 b.low_base = b.close_base;
-                 b.low_quote = b.close_quote;
-            });
-            //wlog( "    creating bucket ${b}", ("b",obj) );
-          }
-          else
-          { // update existing bucket
-             //wlog( "    before updating bucket ${b}", ("b",*bucket_itr) );
-             db.modify( *bucket_itr, [&]( bucket_object& b ){
-                  try {
-                     b.base_volume += trade_price.base.amount;
-                  } catch( fc::overflow_exception& ) {
-                     b.base_volume = std::numeric_limits<int64_t>::max();
-                  }
-                  try {
-                     b.quote_volume += trade_price.quote.amount;
-                  } catch( fc::overflow_exception& ) {
-                     b.quote_volume = std::numeric_limits<int64_t>::max();
-                  }
-                  b.close_base = fill_price.base.amount;
-                  b.close_quote = fill_price.quote.amount;
-                  if( b.high() < fill_price )
-                  {
-                      b.high_base = b.close_base;
-                      b.high_quote = b.close_quote;
-                  }
-                  if( b.low() > fill_price )
-                  {
-                      b.low_base = b.close_base;
-                      b.low_quote = b.close_quote;
-                  }
-             });
-             //wlog( "    after bucket bucket ${b}", ("b",*bucket_itr) );
-          }
-
-          {
-             key.open = fc::time_point_sec();
-             bucket_itr = by_key_idx.lower_bound( key );
-
-             while( bucket_itr != by_key_idx.end() &&
-                    bucket_itr->key.base == key.base &&
-                    bucket_itr->key.quote == key.quote &&
-                    bucket_itr->key.seconds == bucket &&
-                    bucket_itr->key.open < cutoff )
-             {
-              //  elog( "    removing old bucket ${b}", ("b", *bucket_itr) );
-                auto old_bucket_itr = bucket_itr;
-                ++bucket_itr;
-                db.remove( *old_bucket_itr );
-             }
-          }
+         market_history_plugin_impl::bucket_update& u = _bucket_updates[ std::make_pair( key.base, key.quote ) ];
+         u.base_volume  = trade_price.base.amount;
+         u.quote_volume = trade_price.quote.amount;
+         u.open  = fill_price;
+         u.close = fill_price;
+         u.high  = fill_price;
+         u.low   = fill_price;
+      }
+      else
+      {
+         market_history_plugin_impl::bucket_update& u = update_itr->second;
+         add_volume( u.base_volume, trade_price.base.amount );
+         add_volume( u.quote_volume, trade_price.quote.amount );
+         u.close = fill_price;
+         if( u.high < fill_price )
+            u.high = fill_price;
+         if( u.low > fill_price )
+            u.low = fill_price;
+      }
+   }
+
+   static void add_volume( share_type& volume, share_type amount )
+   {
+      try {
+         volume += amount;
+      } catch( fc::overflow_exception& ) {
+         volume = std::numeric_limits<int64_t>::max();
       }
    }
 };
@@ -293,6 +239,125 @@ struct operation_process_fill_order
 market_history_plugin_impl::~market_history_plugin_impl()
 {}
 
+void market_history_plugin_impl::update_buckets( fc::time_point_sec now, const bucket_updates& updates )
+{
+   graphene::chain::database& db = database();
+   const auto& by_key_idx = db.get_index_type<bucket_index>().indices().get<by_key>();
+   const auto max_history = _maximum_history_per_bucket_size;
+   for( const auto& item : updates )
+   {
+      const bucket_update& u = item.second;
+      bucket_key key;
+      key.base  = item.first.first;
+      key.quote = item.first.second;
+      for( auto bucket : _tracked_buckets )
+      {
+         auto bucket_num = now.sec_since_epoch() / bucket;
+         fc::time_point_sec cutoff;
+         if( bucket_num > max_history )
+            cutoff = cutoff + ( bucket * ( bucket_num - max_history ) );
+
+         key.seconds = bucket;
+         key.open    = fc::time_point_sec() + ( bucket_num * bucket );
+
+         auto bucket_itr = by_key_idx.find( key );
+         if( bucket_itr == by_key_idx.end() )
+         {
+            db.create<bucket_object>( [&]( bucket_object& b ){
+               b.key = key;
+               b.base_volume  = u.base_volume;
+               b.quote_volume = u.quote_volume;
+               b.open_base   = u.open.base.amount;
+               b.open_quote  = u.open.quote.amount;
+               b.close_base  = u.close.base.amount;
+               b.close_quote = u.close.quote.amount;
+               b.high_base   = u.high.base.amount;
+               b.high_quote  = u.high.quote.amount;
+               b.low_base    = u.low.base.amount;
+               b.low_quote   = u.low.quote.amount;
+            });
+         }
+         else
+         {
+            db.modify( *bucket_itr, [&]( bucket_object& b ){
+               operation_process_fill_order::add_volume( b.base_volume, u.base_volume );
+               operation_process_fill_order::add_volume( b.quote_volume, u.quote_volume );
+               b.close_base  = u.close.base.amount;
+               b.close_quote = u.close.quote.amount;
+               if( b.high() < u.high )
+               {
+                  b.high_base  = u.high.base.amount;
+                  b.high_quote = u.high.quote.amount;
+               }
+               if( b.low() > u.low )
+               {
+                  b.low_base  = u.low.base.amount;
+                  b.low_quote = u.low.quote.amount;
+               }
+            });
+         }
+
+         key.open = fc::time_point_sec();
+         bucket_itr = by_key_idx.lower_bound( key );
+         while( bucket_itr != by_key_idx.end() &&
+                bucket_itr->key.base == key.base &&
+                bucket_itr->key.quote == key.quote &&
+                bucket_itr->key.seconds == bucket &&
+                bucket_itr->key.open < cutoff )
+         {
+            auto old_bucket_itr = bucket_itr;
+            ++bucket_itr;
+            db.remove( *old_bucket_itr );
+         }
+      }
+   }
+}
+
+void market_history_plugin_impl::prune_order_histories( fc::time_point_sec now, const markets& filled_markets )
+{
+   graphene::chain::database& db = database();
+   const auto& order_his_idx = db.get_index_type<history_index>().indices();
+   const auto& history_idx = order_his_idx.get<by_key>();
+   const auto& his_time_idx = order_his_idx.get<by_market_time>();
+
+   fc::time_point_sec min_time;
+   if( min_time + _max_order_his_seconds_per_market < now )
+      min_time = now - _max_order_his_seconds_per_market;
+
+   for( const auto& market : filled_markets )
+   {
+      // the latest record has the lowest sequence
+      history_key hkey;
+      hkey.base = market.first;
+      hkey.quote = market.second;
+      hkey.sequence = std::numeric_limits<int64_t>::min();
+      auto itr = history_idx.lower_bound( hkey );
+      if( itr == history_idx.end() || itr->key.base != hkey.base || itr->key.quote != hkey.quote )
+         continue;
+
+      // the watermark is the later of the first record beyond the records limit and the first one beyond the time limit,
+      // it and the ones before are removed
+      hkey.sequence = itr->key.sequence + _max_order_his_records_per_market;
+      itr = history_idx.lower_bound( hkey );
+      if( itr == history_idx.end() || itr->key.base != hkey.base || itr->key.quote != hkey.quote )
+         continue;
+      auto time_itr = his_time_idx.lower_bound( std::make_tuple( hkey.base, hkey.quote, min_time ) );
+      if( time_itr == his_time_idx.end() || time_itr->key.base != hkey.base || time_itr->key.quote != hkey.quote )
+         continue;
+
+      if( itr->key.sequence >= time_itr->key.sequence )
+      {
+         while( itr != history_idx.end() && itr->key.base == hkey.base && itr->key.quote == hkey.quote )
+            db.remove( *itr++ );
+      }
+      else
+      {
+         while( time_itr != his_time_idx.end() && time_itr->key.base == hkey.base && time_itr->key.quote == hkey.quote )
+            db.remove( *time_itr++ );
+      }
+   }
+}
+
 void market_history_plugin_impl::update_market_histories( const signed_block& b )
 {
    graphene::chain::database& db = database();
@@ -300,6 +365,8 @@ void market_history_plugin_impl::update_market_histories( const signed_block& b
    const auto& meta_idx = db.get_index_type<simple_index<market_ticker_meta_object>>();
    if( meta_idx.size() > 0 )
       _meta = &( *meta_idx.begin() );
+   bucket_updates updates;
+   markets filled_markets;
    const vector<optional< operation_history_object > >& hist = db.get_applied_operations();
    for( const optional< operation_history_object >& o_op : hist )
    {
@@ -307,10 +374,24 @@ void market_history_plugin_impl::update_market_histories( const signed_block& b
       {
          try
          {
-            o_op->op.visit( operation_process_fill_order( _self, b.timestamp, _meta ) );
+            o_op->op.visit( operation_process_fill_order( _self, b.timestamp, _meta, updates, filled_markets ) );
          } FC_CAPTURE_AND_LOG( (o_op) )
       }
    }
+   if( !filled_markets.empty() )
+   {
+      try
+      {
+         prune_order_histories( b.timestamp, filled_markets );
+      } FC_CAPTURE_AND_LOG( (b.block_num()) )
+   }
+   if( !updates.empty() )
+   {
+      try
+      {
+         update_buckets( b.timestamp, updates );
+      } FC_CAPTURE_AND_LOG( (b.block_num()) )
+   }
    // roll out expired data from ticker
    if( _meta != nullptr )
    {
@@ -384,10 +465,108 @@ void market_history_plugin_impl::update_market_histories( const signed_block& b
 
 } // end namespace detail
 
+void bucket_ring_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const bucket_object*>(&obj) ); // for debug only
+   const bucket_object& b = static_cast<const bucket_object&>(obj);
+   ring& r = _rings[ std::make_tuple( b.key.base, b.key.quote, b.key.seconds ) ];
+   ++r.total;
+   const uint64_t num = bucket_num( b );
+   if( r.slots.empty() )
+   {
+      r.slots.resize( _capacity );
+      r.latest_num = num;
+   }
+   else if( num > r.latest_num )
+   {
+      // the buckets the ring no longer covers drop out
+      const uint64_t old_first = r.first_num();
+      r.latest_num = num;
+      const uint64_t new_first = r.first_num();
+      if( new_first - old_first >= r.slots.size() )
+      {
+         for( auto& slot : r.slots )
+            slot.reset();
+         r.in_ring = 0;
+      }
+      else
+      {
+         for( uint64_t n = old_first; n < new_first; ++n )
+         {
+            auto& slot = r.slots[ n % r.slots.size() ];
+            if( slot.valid() && bucket_num( *slot ) == n )
+            {
+               slot.reset();
+               --r.in_ring;
+            }
+         }
+      }
+   }
+   if( num < r.first_num() )
+      return;
+   auto& slot = r.slots[ num % r.slots.size() ];
+   if( !slot.valid() )
+      ++r.in_ring;
+   slot = b;
+}
 
+void bucket_ring_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const bucket_object*>(&obj) ); // for debug only
+   const bucket_object& b = static_cast<const bucket_object&>(obj);
+   auto itr = _rings.find( std::make_tuple( b.key.base, b.key.quote, b.key.seconds ) );
+   if( itr == _rings.end() )
+      return;
+   ring& r = itr->second;
+   --r.total;
+   auto& slot = r.slots[ bucket_num( b ) % r.slots.size() ];
+   if( slot.valid() && slot->key.open == b.key.open )
+   {
+      slot.reset();
+      --r.in_ring;
+   }
+}
 
+void bucket_ring_index::object_modified( const object& after )
+{
+   assert( dynamic_cast<const bucket_object*>(&after) ); // for debug only
+   const bucket_object& b = static_cast<const bucket_object&>(after);
+   auto itr = _rings.find( std::make_tuple( b.key.base, b.key.quote, b.key.seconds ) );
+   if( itr == _rings.end() )
+      return;
+   auto& slot = itr->second.slots[ bucket_num( b ) % itr->second.slots.size() ];
+   if( slot.valid() && slot->key.open == b.key.open )
+      slot = b;
+}
 
-
+bool bucket_ring_index::get_buckets( asset_aid_type base, asset_aid_type quote, uint32_t seconds,
+                                     fc::time_point_sec start, fc::time_point_sec end, size_t limit,
+                                     vector<bucket_object>& result )const
+{
+   if( seconds == 0 )
+      return true;
+   auto itr = _rings.find( std::make_tuple( base, quote, seconds ) );
+   if( itr == _rings.end() )
+      return true;
+   const ring& r = itr->second;
+
+   // the first bucket opened at or after start, the last one opened at or before end
+   uint64_t first = ( uint64_t( start.sec_since_epoch() ) + seconds - 1 ) / seconds;
+   const uint64_t last = std::min<uint64_t>( end.sec_since_epoch() / seconds, r.latest_num );
+   if( first < r.first_num() )
+   {
+      if( r.in_ring != r.total )
+         return false;
+      first = r.first_num();
+   }
+   for( uint64_t n = first; n <= last && result.size() < limit; ++n )
+   {
+      const auto& slot = r.slots[ n % r.slots.size() ];
+      if( slot.valid() && bucket_num( *slot ) == n )
+         result.push_back( *slot );
+   }
+   return true;
+}
 
 market_history_plugin::market_history_plugin() :
    my( new detail::market_history_plugin_impl(*this) )
@@ -424,7 +603,8 @@ void market_history_plugin::plugin_set_program_options(
 void market_history_plugin::plugin_initialize(const boost::program_options::variables_map& options)
 { try {
    database().applied_block.connect( [this]( const signed_block& b){ my->update_market_histories(b); } );
-   database().add_index< primary_index< bucket_index  > >();
+   auto bucket_idx = database().add_index< primary_index< bucket_index  > >();
+   auto bucket_rings = bucket_idx->add_secondary_index< bucket_ring_index >();
    database().add_index< primary_index< history_index  > >();
    database().add_index< primary_index< market_ticker_index  > >();
    database().add_index< primary_index< simple_index< market_ticker_meta_object > > >();
@@ -437,6 +617,8 @@ void market_history_plugin::plugin_initialize(const boost::program_options::vari
    }
    if( options.count( "history-per-size" ) )
       my->_maximum_history_per_bucket_size = options["history-per-size"].as<uint32_t>();
+   // the buckets kept go back history-per-size bucket sizes before the current one
+   bucket_rings->set_capacity( my->_maximum_history_per_bucket_size + 1 );
    if( options.count( "max-order-his-records-per-market" ) )
       my->_max_order_his_records_per_market = options["max-order-his-records-per-market"].as<uint32_t>();
    if( options.count( "max-order-his-seconds-per-market" ) )
@@ -31,6 +31,7 @@
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/evaluator.hpp>
 #include <graphene/chain/operation_history_object.hpp>
+#include <graphene/chain/post_feed_index.hpp>
 #include <graphene/chain/transaction_evaluation_state.hpp>
 
 #include <fc/smart_ref_impl.hpp>
@@ -55,33 +56,56 @@ class non_consensus_plugin_impl
          return _self.database();
       }
    void update_custom_vote(const account_uid_type& account, asset delta);
+   void settle_cast_custom_vote(const cast_custom_vote_object& cast_vote, const custom_vote_weight_object& weight);
    void create_custom_vote_index(const custom_vote_cast_operation & op);
 };
 
+// The balance changes are only added up in the custom_vote_weight_object of the voter, the casts take their share when
+// they expire or are cast again, so a balance change doesn't walk the casts of the voter.
 void non_consensus_plugin_impl::update_custom_vote(const account_uid_type& account,asset delta)
 {  
    graphene::chain::database& db = database();
-   const auto& custom_vote_idx = db.get_index_type<custom_vote_index>().indices().get<by_creater>();
+   const auto& weight_idx = db.get_index_type<custom_vote_weight_index>().indices().get<by_voter_asset>();
+   auto weight_itr = weight_idx.find(std::make_tuple(account, delta.asset_id));
+   if (weight_itr == weight_idx.end())
+      return;
+
+   // the casts expired since the last change don't follow the balance any more
    const auto& cast_vote_idx = db.get_index_type<cast_custom_vote_index>().indices().get<by_custom_vote_asset_id>();
-   auto cast_vote_itr = cast_vote_idx.lower_bound(std::make_tuple(account, delta.asset_id, db.head_block_time()));
+   auto cast_vote_itr = cast_vote_idx.lower_bound(std::make_tuple(account, delta.asset_id, weight_itr->settled_until));
+   auto cast_vote_end = cast_vote_idx.lower_bound(std::make_tuple(account, delta.asset_id, db.head_block_time()));
+   for (; cast_vote_itr != cast_vote_end; ++cast_vote_itr)
+      settle_cast_custom_vote(*cast_vote_itr, *weight_itr);
 
-   while (cast_vote_itr != cast_vote_idx.end() && cast_vote_itr->voter == account
-      && cast_vote_itr->vote_asset_id == delta.asset_id)
+   if (cast_vote_end == cast_vote_idx.end() || cast_vote_end->voter != account || cast_vote_end->vote_asset_id != delta.asset_id)
+      db.remove(*weight_itr);
+   else
    {
-      auto custom_vote_itr = custom_vote_idx.find(std::make_tuple(cast_vote_itr->custom_vote_creator,
-         cast_vote_itr->custom_vote_vid));
-      FC_ASSERT(custom_vote_itr != custom_vote_idx.end(),
-         "custom vote ${id} not found.", ("id", cast_vote_itr->custom_vote_vid));
-
-      db.modify(*custom_vote_itr, [&](custom_vote_object& obj)
+      db.modify(*weight_itr, [&](custom_vote_weight_object& obj)
       {
-         for (const auto& v : cast_vote_itr->vote_result)
-            obj.vote_result.at(v) += delta.amount.value;
+         obj.weight += delta.amount;
+         obj.settled_until = db.head_block_time();
       });
-      ++cast_vote_itr;
    }
+}
 
+void non_consensus_plugin_impl::settle_cast_custom_vote(const cast_custom_vote_object& cast_vote,
+                                                         const custom_vote_weight_object& weight)
+{
+   graphene::chain::database& db = database();
+   auto custom_vote_obj = db.find_custom_vote_by_vid(cast_vote.custom_vote_creator, cast_vote.custom_vote_vid);
+   FC_ASSERT(custom_vote_obj != nullptr, "custom vote ${id} not found.", ("id", cast_vote.custom_vote_vid));
+
+   const share_type unsettled = weight.weight - cast_vote.weight_snapshot;
+   if (unsettled == 0)
+      return;
+   db.modify(*custom_vote_obj, [&](custom_vote_object& obj)
+   {
+      for (const auto& v : cast_vote.vote_result)
+         obj.vote_result.at(v) += unsettled.value;
+   });
 }
+
 void non_consensus_plugin_impl::create_custom_vote_index(const custom_vote_cast_operation & op)
 {
    graphene::chain::database& db = database();
@@ -90,6 +114,16 @@ void non_consensus_plugin_impl::create_custom_vote_index(const custom_vote_cast_
    uint64_t votes = db.get_account_statistics_by_uid(op.voter).get_votes_from_core_balance();
    const auto& cast_idx = db.get_index_type<cast_custom_vote_index>().indices().get<by_custom_voter>();
    auto cast_itr = cast_idx.find(std::make_tuple(op.voter, op.custom_vote_creator, op.custom_vote_vid));
+
+   const auto& weight_idx = db.get_index_type<custom_vote_weight_index>().indices().get<by_voter_asset>();
+   auto weight_itr = weight_idx.find(std::make_tuple(op.voter, custom_vote_obj->vote_asset_id));
+   const custom_vote_weight_object& weight = weight_itr != weight_idx.end() ? *weight_itr :
+      db.create<custom_vote_weight_object>([&](custom_vote_weight_object& obj)
+      {
+         obj.voter = op.voter;
+         obj.vote_asset_id = custom_vote_obj->vote_asset_id;
+         obj.settled_until = db.head_block_time();
+      });
  
    if (cast_itr == cast_idx.end()) {
       db.create<cast_custom_vote_object>([&](cast_custom_vote_object& obj)
@@ -100,6 +134,7 @@ void non_consensus_plugin_impl::create_custom_vote_index(const custom_vote_cast_
          obj.vote_result = op.vote_result;
          obj.vote_asset_id = custom_vote_obj->vote_asset_id;
          obj.vote_expired_time = custom_vote_obj->vote_expired_time;
+         obj.weight_snapshot = weight.weight;
       });
       db.modify(*custom_vote_obj, [&](custom_vote_object& obj)
       {
@@ -108,6 +143,7 @@ void non_consensus_plugin_impl::create_custom_vote_index(const custom_vote_cast_
       });
    }
    else {
+      settle_cast_custom_vote(*cast_itr, weight);
       db.modify(*custom_vote_obj, [&](custom_vote_object& obj)
       {
          for (const auto& v : cast_itr->vote_result)
@@ -118,6 +154,7 @@ void non_consensus_plugin_impl::create_custom_vote_index(const custom_vote_cast_
       db.modify(*cast_itr, [&](cast_custom_vote_object& obj)
       {
          obj.vote_result = op.vote_result;
+         obj.weight_snapshot = weight.weight;
       });     
    }
 }
@@ -136,6 +173,10 @@ void non_consensus_plugin::plugin_initialize(const boost::program_options::varia
             my->create_custom_vote_index(op.get<custom_vote_cast_operation>());
          });      
    }
+
+   // filled from the posts when the database is opened, and maintained with them from then on
+   if(non_consensus_indexs.count("post_feed"))
+      database().add_secondary_index< primary_index<post_index>, post_feed_index >();
 }
 
 void non_consensus_plugin::plugin_startup()
@@ -160,7 +201,7 @@ void non_consensus_plugin::plugin_set_program_options(
                                                         boost::program_options::options_description& cfg
                                                         )
 {
-    cli.add_options()("non_consensus_indexs", boost::program_options::value<std::vector<std::string>>()->composing()->multitoken(), "add non consensus index");
+    cli.add_options()("non_consensus_indexs", boost::program_options::value<std::vector<std::string>>()->composing()->multitoken(), "add non consensus index: customer_vote, post_feed");
     cfg.add(cli);
 }
 } }
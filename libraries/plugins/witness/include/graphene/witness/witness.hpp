@@ -74,12 +74,17 @@ public:
 
 private:
    void schedule_production_loop();
+   /// @return when the production loop is to run next, at the start of a second
+   fc::time_point next_production_wakeup()const;
    block_production_condition::block_production_condition_enum block_production_loop();
    block_production_condition::block_production_condition_enum maybe_produce_block( fc::limited_mutable_variant_object& capture );
+   /// Builds the block ahead when the slot of the next wakeup belongs to one of our witnesses, see database::prepare_block()
+   void maybe_prepare_block();
 
    boost::program_options::variables_map _options;
    bool _production_enabled = false;
    bool _consecutive_production_enabled = false;
+   bool _prepare_blocks = true;
    uint32_t _required_witness_participation = 33 * GRAPHENE_1_PERCENT;
    uint32_t _production_skip_flags = graphene::chain::database::skip_nothing;
 
@@ -72,6 +72,9 @@ void witness_plugin::plugin_set_program_options(
          ("private-key", bpo::value<vector<string>>()->composing()->multitoken()->
           DEFAULT_VALUE_VECTOR(std::make_pair(chain::public_key_type(default_priv_key.get_public_key()), graphene::utilities::key_to_wif(default_priv_key))),
           "Tuple of [PublicKey, WIF private key] (may specify multiple times)")
+         ("prepare-blocks", bpo::value<bool>()->default_value(true),
+          "Build our next block out of the pending transactions during the second before its slot, "
+          "so that only signing it is left at the slot time; transactions arriving in that second go into the next block")
          ;
    config_file_options.add(command_line_options);
 }
@@ -86,6 +89,8 @@ void witness_plugin::plugin_initialize(const boost::program_options::variables_m
    ilog("witness plugin:  plugin_initialize() begin");
    _options = &options;
    LOAD_VALUE_SET(options, "witness", _witnesses, chain::account_uid_type )
+   if( options.count("prepare-blocks") )
+      _prepare_blocks = options["prepare-blocks"].as<bool>();
 
    if( options.count("private-key") )
    {
@@ -140,7 +145,7 @@ void witness_plugin::plugin_shutdown()
    // nothing to do
 }
 
-void witness_plugin::schedule_production_loop()
+fc::time_point witness_plugin::next_production_wakeup()const
 {
    //Schedule for the next second's tick regardless of chain state
    // If we would wait less than 50ms, wait for the whole second.
@@ -149,7 +154,12 @@ void witness_plugin::schedule_production_loop()
    if( time_to_next_second < 50000 )      // we must sleep for at least 50ms
        time_to_next_second += 1000000;
 
-   fc::time_point next_wakeup( now + fc::microseconds( time_to_next_second ) );
+   return now + fc::microseconds( time_to_next_second );
+}
+
+void witness_plugin::schedule_production_loop()
+{
+   fc::time_point next_wakeup = next_production_wakeup();
 
    _block_production_task = fc::schedule([this]{block_production_loop();},
                                          next_wakeup, "Witness Block Production");
@@ -203,6 +213,22 @@ block_production_condition::block_production_condition_enum witness_plugin::bloc
          break;
    }
 
+   if( _prepare_blocks && result != block_production_condition::not_synced )
+   {
+      try
+      {
+         maybe_prepare_block();
+      }
+      catch( const fc::canceled_exception& )
+      {
+         throw;
+      }
+      catch( const fc::exception& e )
+      {
+         wlog( "Got exception while preparing block:\n${e}", ("e", e.to_detail_string()) );
+      }
+   }
+
    schedule_production_loop();
    return result;
 }
@@ -299,3 +325,21 @@ block_production_condition::block_production_condition_enum witness_plugin::mayb
 
    return block_production_condition::exception_producing_block;
 }
+
+void witness_plugin::maybe_prepare_block()
+{
+   chain::database& db = database();
+   // the same slot maybe_produce_block() will look at when it wakes up next
+   fc::time_point_sec next_time = next_production_wakeup() + fc::microseconds( 500000 );
+   uint32_t slot = db.get_slot_at_time( next_time );
+   if( slot == 0 )
+      return;
+
+   graphene::chain::account_uid_type scheduled_witness = db.get_scheduled_witness( slot );
+   if( _witnesses.find( scheduled_witness ) == _witnesses.end() )
+      return;
+   if( _private_keys.find( db.get_witness_by_uid( scheduled_witness ).signing_key ) == _private_keys.end() )
+      return;
+
+   db.prepare_block( db.get_slot_time( slot ), scheduled_witness, _production_skip_flags );
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/utilities/async_file_writer.hpp>
+
+#include <fc/exception/exception.hpp>
+
+namespace graphene { namespace utilities {
+
+async_file_writer::async_file_writer( const std::string& filename, size_t max_buffer_bytes )
+   : _max_buffer_bytes( std::max<size_t>( max_buffer_bytes, 1 ) ),
+     _out( filename, std::ios::out | std::ios::binary | std::ios::trunc ),
+     _thread( "async_file_writer" )
+{
+   FC_ASSERT( _out.is_open(), "Could not open ${f} for writing", ("f",filename) );
+   _buffer.reserve( _max_buffer_bytes );
+   _writer = _thread.async( [this]() { run(); }, "async_file_writer" );
+}
+
+async_file_writer::~async_file_writer()
+{
+   try
+   {
+      close();
+   }
+   catch( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+   }
+}
+
+void async_file_writer::write( const char* data, size_t size )
+{
+   std::unique_lock<std::mutex> lock( _mutex );
+   FC_ASSERT( !_closing, "The file is closed" );
+   if( !_buffer.empty() && _buffer.size() + size > _max_buffer_bytes )
+   {
+      ++_stalls;
+      _changed.wait( lock, [this,size]() { return _buffer.empty() || _buffer.size() + size <= _max_buffer_bytes; } );
+   }
+   const bool was_empty = _buffer.empty();
+   _buffer.insert( _buffer.end(), data, data + size );
+   _queued_bytes += size;
+   if( was_empty )
+      _changed.notify_all();
+}
+
+void async_file_writer::flush()
+{
+   std::unique_lock<std::mutex> lock( _mutex );
+   if( _closing )
+      return;
+   _changed.wait( lock, [this]() { return _written_bytes == _queued_bytes; } );
+   _flush_requested = true;
+   _changed.notify_all();
+   _changed.wait( lock, [this]() { return !_flush_requested; } );
+}
+
+void async_file_writer::close()
+{
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      if( _closed )
+         return;
+      _closed = true;
+      _closing = true;
+      _changed.notify_all();
+   }
+   _writer.wait();
+   _out.close();
+   _thread.quit();
+}
+
+void async_file_writer::run()
+{
+   std::vector<char> chunk;
+   chunk.reserve( _max_buffer_bytes );
+   std::unique_lock<std::mutex> lock( _mutex );
+   for( ;; )
+   {
+      _changed.wait( lock, [this]() { return !_buffer.empty() || _flush_requested || _closing; } );
+      if( !_buffer.empty() )
+      {
+         chunk.swap( _buffer );
+         _changed.notify_all();
+         lock.unlock();
+         _out.write( chunk.data(), chunk.size() );
+         lock.lock();
+         _written_bytes += chunk.size();
+         chunk.clear();
+         _changed.notify_all();
+      }
+      else if( _flush_requested )
+      {
+         lock.unlock();
+         _out.flush();
+         lock.lock();
+         _flush_requested = false;
+         _changed.notify_all();
+      }
+      else
+         return;
+   }
+}
+
+} } // graphene::utilities
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/utilities/async_log.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/thread/thread.hpp>
+
+namespace graphene { namespace utilities {
+
+static fc::thread& log_thread()
+{
+   static fc::thread thread( "log" );
+   return thread;
+}
+
+void async_log( const fc::logger& log, std::function<fc::log_message()> make )
+{
+   fc::logger target = log;
+   log_thread().async( [target,make]() mutable {
+      try
+      {
+         target.log( make() );
+      }
+      catch( const fc::exception& e )
+      {
+         edump( (e.to_detail_string()) );
+      }
+      catch( const std::exception& e )
+      {
+         edump( (e.what()) );
+      }
+   }, "async_log" );
+}
+
+void flush_async_log()
+{
+   log_thread().async( [](){}, "flush_async_log" ).wait();
+}
+
+} } // graphene::utilities
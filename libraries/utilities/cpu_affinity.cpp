@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/utilities/cpu_affinity.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/fstream.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace graphene { namespace utilities {
+
+namespace {
+   uint32_t parse_cpu_number( const std::string& s, const std::string& spec )
+   {
+      FC_ASSERT( !s.empty() && s.find_first_not_of( "0123456789" ) == std::string::npos,
+                 "Invalid CPU number '${s}' in '${spec}'", ("s",s)("spec",spec) );
+      return std::strtoul( s.c_str(), nullptr, 10 );
+   }
+
+   /// the cpulist of a NUMA node, in the same format
+   std::string read_numa_node_cpus( const std::string& node, const std::string& spec )
+   {
+      parse_cpu_number( node, spec );
+      const fc::path file = fc::path( "/sys/devices/system/node" ) / ( "node" + node ) / "cpulist";
+      FC_ASSERT( fc::exists( file ), "NUMA node ${n} not found", ("n",node) );
+      std::string cpus;
+      fc::read_file_contents( file, cpus );
+      boost::algorithm::trim( cpus );
+      return cpus;
+   }
+}
+
+std::vector<uint32_t> parse_cpu_list( const std::string& spec )
+{ try {
+   std::string list = boost::algorithm::trim_copy( spec );
+   if( boost::algorithm::starts_with( list, "node" ) )
+      list = read_numa_node_cpus( list.substr( 4 ), spec );
+
+   std::vector<uint32_t> result;
+   std::vector<std::string> items;
+   boost::split( items, list, boost::is_any_of( "," ) );
+   for( std::string item : items )
+   {
+      boost::algorithm::trim( item );
+      const size_t dash = item.find( '-' );
+      const uint32_t first = parse_cpu_number( item.substr( 0, dash ), spec );
+      const uint32_t last = ( dash == std::string::npos ? first : parse_cpu_number( item.substr( dash + 1 ), spec ) );
+      FC_ASSERT( first <= last && last < 4096, "Invalid CPU range '${r}' in '${spec}'", ("r",item)("spec",spec) );
+      for( uint32_t cpu = first; cpu <= last; ++cpu )
+         result.push_back( cpu );
+   }
+   std::sort( result.begin(), result.end() );
+   result.erase( std::unique( result.begin(), result.end() ), result.end() );
+   FC_ASSERT( !result.empty(), "No CPU in '${spec}'", ("spec",spec) );
+   return result;
+} FC_CAPTURE_AND_RETHROW( (spec) ) }
+
+bool pin_current_thread( const std::vector<uint32_t>& cpus )
+{
+#if defined(__linux__)
+   cpu_set_t set;
+   CPU_ZERO( &set );
+   for( const uint32_t cpu : cpus )
+   {
+      FC_ASSERT( cpu < CPU_SETSIZE, "CPU ${c} is out of range", ("c",cpu) );
+      CPU_SET( cpu, &set );
+   }
+   const int error = pthread_setaffinity_np( pthread_self(), sizeof(set), &set );
+   FC_ASSERT( error == 0, "Unable to pin the thread to CPUs ${c}, error ${e}", ("c",cpus)("e",error) );
+   return true;
+#else
+   return false;
+#endif
+}
+
+bool pin_thread( fc::thread& thread, const std::vector<uint32_t>& cpus )
+{
+   if( &thread == &fc::thread::current() )
+      return pin_current_thread( cpus );
+   return thread.async( [&cpus]() { return pin_current_thread( cpus ); }, "pin_thread" ).wait();
+}
+
+std::vector<uint32_t> current_thread_cpus()
+{
+   std::vector<uint32_t> result;
+#if defined(__linux__)
+   cpu_set_t set;
+   CPU_ZERO( &set );
+   const int error = pthread_getaffinity_np( pthread_self(), sizeof(set), &set );
+   FC_ASSERT( error == 0, "Unable to get the CPUs of the thread, error ${e}", ("e",error) );
+   for( uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+   {
+      if( CPU_ISSET( cpu, &set ) )
+         result.push_back( cpu );
+   }
+#endif
+   return result;
+}
+
+} } // graphene::utilities
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <fc/thread/thread.hpp>
+#include <fc/thread/future.hpp>
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace graphene { namespace utilities {
+
+/**
+ * @brief Writes a file on its own thread, through a bounded buffer
+ *
+ * write() only appends the data to the buffer, the writer thread takes the whole buffer at once and writes it out.
+ * When the buffer holds max_buffer_bytes, write() blocks until the writer thread took it, so nothing is dropped and
+ * at most twice max_buffer_bytes are held: the buffer being filled and the one being written.
+ *
+ * Meant for one producer thread.
+ */
+class async_file_writer
+{
+   public:
+      async_file_writer( const std::string& filename, size_t max_buffer_bytes );
+      /// closes the file, see close()
+      ~async_file_writer();
+
+      void write( const char* data, size_t size );
+      void write( const std::vector<char>& data ) { write( data.data(), data.size() ); }
+
+      /// returns once everything written so far is in the file
+      void flush();
+      /// writes what is buffered, then stops the writer thread and closes the file
+      void close();
+
+      /// the number of calls to write() which had to wait for the writer thread
+      uint64_t stalls()const { return _stalls; }
+
+   private:
+      void run();
+
+      const size_t            _max_buffer_bytes;
+      std::ofstream           _out;
+      std::mutex              _mutex;
+      std::condition_variable _changed;
+      std::vector<char>       _buffer;
+      uint64_t                _queued_bytes = 0;
+      uint64_t                _written_bytes = 0;
+      uint64_t                _stalls = 0;
+      bool                    _flush_requested = false;
+      bool                    _closing = false;
+      bool                    _closed = false;
+      fc::thread              _thread;
+      fc::future<void>        _writer;
+};
+
+} } // graphene::utilities
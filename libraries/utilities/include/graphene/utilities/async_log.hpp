@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <fc/log/logger.hpp>
+
+#include <functional>
+
+namespace graphene { namespace utilities {
+
+/**
+ * Hands a log message to the log thread. make is called there, so the message, its arguments included, is built,
+ * formatted and written off the calling thread; it must only capture what it owns.
+ */
+void async_log( const fc::logger& log, std::function<fc::log_message()> make );
+
+/// Returns once the messages handed to async_log() so far are written
+void flush_async_log();
+
+} } // graphene::utilities
+
+/**
+ * Like ilog() and friends, for hot paths: nothing is evaluated if the level is disabled, otherwise the arguments are
+ * captured by value and turned into the message on the log thread.
+ */
+#define graphene_async_log( LOG_LEVEL, FORMAT, ... ) \
+  FC_MULTILINE_MACRO_BEGIN \
+   if( (fc::logger::get(DEFAULT_LOGGER)).is_enabled( fc::log_level::LOG_LEVEL ) ) \
+   { \
+      const fc::log_context graphene_async_log_context = FC_LOG_CONTEXT(LOG_LEVEL); \
+      graphene::utilities::async_log( fc::logger::get(DEFAULT_LOGGER), [=]() { \
+         return fc::log_message( graphene_async_log_context, FORMAT, fc::mutable_variant_object()__VA_ARGS__ ); \
+      } ); \
+   } \
+  FC_MULTILINE_MACRO_END
+
+#define async_dlog( FORMAT, ... ) graphene_async_log( debug, FORMAT, __VA_ARGS__ )
+#define async_ilog( FORMAT, ... ) graphene_async_log( info, FORMAT, __VA_ARGS__ )
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <fc/thread/thread.hpp>
+
+#include <string>
+#include <vector>
+
+namespace graphene { namespace utilities {
+
+/**
+ * Parses a set of CPUs given as numbers and ranges, e.g. "0-3,8", or as "node<n>" for the CPUs of NUMA node n.
+ * @return the CPU numbers, sorted and without duplicates; throws if @p spec can't be parsed or names no CPU
+ */
+std::vector<uint32_t> parse_cpu_list( const std::string& spec );
+
+/**
+ * Restricts the calling OS thread, and the fc tasks running on it, to @p cpus.
+ * @return false on the platforms where threads can't be pinned, nothing is changed then
+ */
+bool pin_current_thread( const std::vector<uint32_t>& cpus );
+
+/// Restricts @p thread to @p cpus, waiting until it has done it
+bool pin_thread( fc::thread& thread, const std::vector<uint32_t>& cpus );
+
+/**
+ * @return the CPUs the calling OS thread may run on, which the threads it creates start with, empty on the platforms
+ *         where threads can't be pinned
+ */
+std::vector<uint32_t> current_thread_cpus();
+
+} } // graphene::utilities
@@ -24,13 +24,32 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <fc/crypto/elliptic.hpp>
 #include <fc/optional.hpp>
 
 namespace graphene { namespace utilities {
 
+class thread_pool;
+
 std::string                        key_to_wif(const fc::sha256& private_secret );
 std::string                        key_to_wif(const fc::ecc::private_key& key);
 fc::optional<fc::ecc::private_key> wif_to_key( const std::string& wif_key );
 
+/// the key number @p sequence_number derived from @p prefix, the way wallets derive keys from brain keys
+fc::ecc::private_key               derive_private_key( const std::string& prefix, int sequence_number );
+
+struct derived_key
+{
+   fc::ecc::private_key private_key;
+   fc::ecc::public_key  public_key;
+};
+
+/**
+ * Derives the keys number [first, first + count) from @p prefix along with their public keys, which cost most
+ * of the time. The keys are derived on the threads of @p pool if it is given, in order on this thread otherwise.
+ */
+std::vector<derived_key>           derive_keys( const std::string& prefix, int first, uint32_t count,
+                                                thread_pool* pool = nullptr );
+
 } } // end namespace graphene::utilities
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace graphene { namespace utilities {
+
+/// A value which only goes up, e.g. a number of blocks or bytes since the node started
+class metric_counter
+{
+   public:
+      void     add( uint64_t n = 1 ) { _value.fetch_add( n, std::memory_order_relaxed ); }
+      uint64_t value()const { return _value.load( std::memory_order_relaxed ); }
+
+   private:
+      std::atomic<uint64_t> _value{ 0 };
+};
+
+/// A value which goes up and down, e.g. a number of peers
+class metric_gauge
+{
+   public:
+      void    set( int64_t value ) { _value.store( value, std::memory_order_relaxed ); }
+      void    add( int64_t n ) { _value.fetch_add( n, std::memory_order_relaxed ); }
+      int64_t value()const { return _value.load( std::memory_order_relaxed ); }
+
+   private:
+      std::atomic<int64_t> _value{ 0 };
+};
+
+/**
+ * @brief Counts the observed values in buckets with fixed upper bounds, and keeps their sum
+ *
+ * The buckets are cumulative when exported: the bucket of a bound counts the values up to that bound, and the
+ * values above the last bound are only in the total count.
+ */
+class metric_histogram
+{
+   public:
+      explicit metric_histogram( std::vector<double> bounds );
+
+      void observe( double value );
+
+      struct snapshot
+      {
+         std::vector<double>   bounds;
+         /// the values up to each bound, not cumulative
+         std::vector<uint64_t> bucket_counts;
+         uint64_t              count = 0;
+         double                sum = 0;
+      };
+      snapshot get_snapshot()const;
+
+   private:
+      const std::vector<double> _bounds;
+      mutable std::mutex        _mutex;
+      std::vector<uint64_t>     _bucket_counts;
+      uint64_t                  _count = 0;
+      double                    _sum = 0;
+};
+
+/**
+ * @brief Named counters, gauges and histograms of the node, exported in the Prometheus text format
+ *
+ * A metric is created the first time it is asked for and lives as long as the registry, so the callers keep the
+ * reference and update it without going through the registry again. Metrics of the same name differ by their
+ * labels, e.g. one histogram per API method.
+ *
+ * The metrics are updated from any thread. The values which are cheaper to read when exported than to keep up to
+ * date, e.g. the number of connected peers, are set by the collectors, which render() calls first, on its thread.
+ */
+class metrics_registry
+{
+   public:
+      typedef std::vector<std::pair<std::string,std::string>> labels_type;
+
+      metric_counter&   counter( const std::string& name, const std::string& help, const labels_type& labels = labels_type() );
+      metric_gauge&     gauge( const std::string& name, const std::string& help, const labels_type& labels = labels_type() );
+      /// @p bounds are only used when the histogram is created
+      metric_histogram& histogram( const std::string& name, const std::string& help, const std::vector<double>& bounds,
+                                   const labels_type& labels = labels_type() );
+
+      void add_collector( std::function<void()> collector );
+
+      /// runs the collectors, then writes all the metrics, ordered by name
+      std::string render();
+
+      /// @p count bounds from @p start, each @p factor times the previous one
+      static std::vector<double> exponential_bounds( double start, double factor, size_t count );
+
+   private:
+      enum metric_kind { counter_kind, gauge_kind, histogram_kind };
+      struct family
+      {
+         metric_kind kind;
+         std::string help;
+         /// by the rendered labels
+         std::map<std::string,std::unique_ptr<metric_counter>>   counters;
+         std::map<std::string,std::unique_ptr<metric_gauge>>     gauges;
+         std::map<std::string,std::unique_ptr<metric_histogram>> histograms;
+      };
+      family& get_family( const std::string& name, const std::string& help, metric_kind kind );
+
+      std::mutex                         _mutex;
+      std::map<std::string,family>       _families;
+      std::vector<std::function<void()>> _collectors;
+};
+
+} } // graphene::utilities
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <fc/exception/exception.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/thread/future.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace graphene { namespace utilities {
+
+/**
+ * @brief A fixed set of fc::thread workers used to fan out CPU bound work
+ *
+ * Work is always submitted from, and joined on, the calling thread, so callers keep their
+ * single threaded view of the world; only the functor passed to parallel_for() runs on the workers.
+ * A pool created with zero threads runs everything inline.
+ */
+class thread_pool
+{
+   public:
+      explicit thread_pool( uint32_t num_threads, const std::string& name_prefix = "worker" );
+      ~thread_pool();
+
+      uint32_t    size()const { return _threads.size(); }
+      fc::thread& get_thread( uint32_t i ) { return *_threads[ i % _threads.size() ]; }
+
+      /// Restricts every worker to @p cpus, see pin_current_thread()
+      void pin_threads( const std::vector<uint32_t>& cpus );
+
+      /**
+       * Calls f(i) for every i in [0, count), splitting the range into contiguous chunks, one per worker.
+       * Blocks until every chunk is done. If any chunk throws, the first exception is rethrown here after
+       * all chunks have finished.
+       *
+       * The calling thread is blocked rather than yielding to its other fc tasks, so nothing else can touch
+       * the caller's state while the workers read it; this makes it safe to use in the middle of applying a block.
+       */
+      template<typename Functor>
+      void parallel_for( size_t count, Functor&& f )
+      {
+         if( count == 0 )
+            return;
+         if( _threads.empty() || count == 1 )
+         {
+            for( size_t i = 0; i < count; ++i )
+               f( i );
+            return;
+         }
+
+         const size_t chunk_size = ( count + _threads.size() - 1 ) / _threads.size();
+         const size_t chunks = ( count + chunk_size - 1 ) / chunk_size;
+         completion_latch latch( chunks );
+         for( size_t c = 0; c < chunks; ++c )
+         {
+            const size_t begin = c * chunk_size;
+            const size_t end = std::min( count, begin + chunk_size );
+            _threads[c]->async( [&f,&latch,begin,end]() {
+               fc::exception_ptr error;
+               try {
+                  for( size_t i = begin; i < end; ++i )
+                     f( i );
+               } catch( const fc::exception& e ) {
+                  error = e.dynamic_copy_exception();
+               } catch( const std::exception& e ) {
+                  error = fc::std_exception_wrapper::from_current_exception( e ).dynamic_copy_exception();
+               }
+               latch.done( error );
+            }, "parallel_for" );
+         }
+         latch.wait();
+      }
+
+      /**
+       * Waits for every future in the list, then rethrows the first exception encountered, if any.
+       */
+      static void wait_all( std::vector< fc::future<void> >& results );
+
+   private:
+      /// counts finished chunks of a parallel_for(), waiting on it blocks the OS thread
+      class completion_latch
+      {
+         public:
+            explicit completion_latch( size_t count ):_remaining(count){}
+            void done( const fc::exception_ptr& error );
+            /// returns once done() was called count times, rethrowing the first error reported
+            void wait();
+         private:
+            std::mutex              _mutex;
+            std::condition_variable _done;
+            size_t                  _remaining;
+            fc::exception_ptr       _first_error;
+      };
+
+      std::vector< std::unique_ptr<fc::thread> > _threads;
+};
+
+} } // graphene::utilities
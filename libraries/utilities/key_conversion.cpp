@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #include <graphene/utilities/key_conversion.hpp>
+#include <graphene/utilities/thread_pool.hpp>
 #include <fc/crypto/base58.hpp>
 #include <fc/variant.hpp>
 
@@ -69,4 +70,26 @@ fc::optional<fc::ecc::private_key> wif_to_key( const std::string& wif_key )
   return fc::optional<fc::ecc::private_key>();
 }
 
+fc::ecc::private_key derive_private_key( const std::string& prefix, int sequence_number )
+{
+  fc::sha512 h = fc::sha512::hash( prefix + " " + std::to_string( sequence_number ) );
+  return fc::ecc::private_key::regenerate( fc::sha256::hash( h ) );
+}
+
+std::vector<derived_key> derive_keys( const std::string& prefix, int first, uint32_t count, thread_pool* pool )
+{
+  std::vector<derived_key> result( count );
+  auto derive = [&]( size_t i ) {
+    derived_key& k = result[i];
+    k.private_key = derive_private_key( prefix, first + int( i ) );
+    k.public_key = k.private_key.get_public_key();
+  };
+  if( pool != nullptr )
+    pool->parallel_for( count, derive );
+  else
+    for( size_t i = 0; i < count; ++i )
+      derive( i );
+  return result;
+}
+
 } } // end namespace graphene::utilities
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/utilities/metrics.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+namespace graphene { namespace utilities {
+
+namespace {
+
+   std::string format_value( double value )
+   {
+      if( std::isinf( value ) )
+         return value > 0 ? "+Inf" : "-Inf";
+      if( std::isnan( value ) )
+         return "NaN";
+      char buffer[32];
+      std::snprintf( buffer, sizeof(buffer), "%.10g", value );
+      return buffer;
+   }
+
+   std::string render_labels( const metrics_registry::labels_type& labels )
+   {
+      std::string result;
+      for( const auto& label : labels )
+      {
+         if( !result.empty() )
+            result += ',';
+         result += label.first;
+         result += "=\"";
+         for( char c : label.second )
+         {
+            if( c == '\\' )
+               result += "\\\\";
+            else if( c == '"' )
+               result += "\\\"";
+            else if( c == '\n' )
+               result += "\\n";
+            else
+               result += c;
+         }
+         result += '"';
+      }
+      return result;
+   }
+
+   /// the labels of a sample, with @p extra appended
+   std::string sample_labels( const std::string& labels, const std::string& extra = std::string() )
+   {
+      if( labels.empty() && extra.empty() )
+         return std::string();
+      if( labels.empty() || extra.empty() )
+         return "{" + labels + extra + "}";
+      return "{" + labels + "," + extra + "}";
+   }
+
+}
+
+metric_histogram::metric_histogram( std::vector<double> bounds )
+   : _bounds( std::move( bounds ) ), _bucket_counts( _bounds.size(), 0 )
+{
+   FC_ASSERT( std::is_sorted( _bounds.begin(), _bounds.end() ), "The bounds of a histogram must be sorted" );
+}
+
+void metric_histogram::observe( double value )
+{
+   const size_t bucket = std::lower_bound( _bounds.begin(), _bounds.end(), value ) - _bounds.begin();
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( bucket < _bucket_counts.size() )
+      ++_bucket_counts[bucket];
+   ++_count;
+   _sum += value;
+}
+
+metric_histogram::snapshot metric_histogram::get_snapshot()const
+{
+   snapshot result;
+   result.bounds = _bounds;
+   std::lock_guard<std::mutex> lock( _mutex );
+   result.bucket_counts = _bucket_counts;
+   result.count = _count;
+   result.sum = _sum;
+   return result;
+}
+
+metrics_registry::family& metrics_registry::get_family( const std::string& name, const std::string& help,
+                                                        metric_kind kind )
+{
+   auto itr = _families.find( name );
+   if( itr == _families.end() )
+   {
+      itr = _families.emplace( name, family() ).first;
+      itr->second.kind = kind;
+      itr->second.help = help;
+   }
+   FC_ASSERT( itr->second.kind == kind, "The metric ${n} is already registered with another type", ("n",name) );
+   return itr->second;
+}
+
+metric_counter& metrics_registry::counter( const std::string& name, const std::string& help, const labels_type& labels )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   auto& metric = get_family( name, help, counter_kind ).counters[render_labels( labels )];
+   if( !metric )
+      metric.reset( new metric_counter() );
+   return *metric;
+}
+
+metric_gauge& metrics_registry::gauge( const std::string& name, const std::string& help, const labels_type& labels )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   auto& metric = get_family( name, help, gauge_kind ).gauges[render_labels( labels )];
+   if( !metric )
+      metric.reset( new metric_gauge() );
+   return *metric;
+}
+
+metric_histogram& metrics_registry::histogram( const std::string& name, const std::string& help,
+                                               const std::vector<double>& bounds, const labels_type& labels )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   auto& metric = get_family( name, help, histogram_kind ).histograms[render_labels( labels )];
+   if( !metric )
+      metric.reset( new metric_histogram( bounds ) );
+   return *metric;
+}
+
+void metrics_registry::add_collector( std::function<void()> collector )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _collectors.push_back( std::move( collector ) );
+}
+
+std::string metrics_registry::render()
+{
+   std::vector<std::function<void()>> collectors;
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      collectors = _collectors;
+   }
+   // outside of the lock, the collectors set their gauges through the registry
+   for( const auto& collect : collectors )
+      collect();
+
+   std::ostringstream out;
+   std::lock_guard<std::mutex> lock( _mutex );
+   for( const auto& named_family : _families )
+   {
+      const std::string& name = named_family.first;
+      const family& f = named_family.second;
+      static const char* const type_names[] = { "counter", "gauge", "histogram" };
+      out << "# HELP " << name << ' ' << f.help << '\n';
+      out << "# TYPE " << name << ' ' << type_names[f.kind] << '\n';
+      for( const auto& c : f.counters )
+         out << name << sample_labels( c.first ) << ' ' << c.second->value() << '\n';
+      for( const auto& g : f.gauges )
+         out << name << sample_labels( g.first ) << ' ' << g.second->value() << '\n';
+      for( const auto& h : f.histograms )
+      {
+         const metric_histogram::snapshot s = h.second->get_snapshot();
+         uint64_t cumulative = 0;
+         for( size_t i = 0; i < s.bounds.size(); ++i )
+         {
+            cumulative += s.bucket_counts[i];
+            out << name << "_bucket" << sample_labels( h.first, "le=\"" + format_value( s.bounds[i] ) + "\"" )
+                << ' ' << cumulative << '\n';
+         }
+         out << name << "_bucket" << sample_labels( h.first, "le=\"+Inf\"" ) << ' ' << s.count << '\n';
+         out << name << "_sum" << sample_labels( h.first ) << ' ' << format_value( s.sum ) << '\n';
+         out << name << "_count" << sample_labels( h.first ) << ' ' << s.count << '\n';
+      }
+   }
+   return out.str();
+}
+
+std::vector<double> metrics_registry::exponential_bounds( double start, double factor, size_t count )
+{
+   FC_ASSERT( start > 0 && factor > 1, "Exponential bounds need a positive start and a factor above 1" );
+   std::vector<double> bounds;
+   bounds.reserve( count );
+   for( double bound = start; bounds.size() < count; bound *= factor )
+      bounds.push_back( bound );
+   return bounds;
+}
+
+} } // graphene::utilities
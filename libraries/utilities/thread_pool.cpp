@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/utilities/thread_pool.hpp>
+#include <graphene/utilities/cpu_affinity.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/string.hpp>
+
+namespace graphene { namespace utilities {
+
+thread_pool::thread_pool( uint32_t num_threads, const std::string& name_prefix )
+{
+   _threads.reserve( num_threads );
+   for( uint32_t i = 0; i < num_threads; ++i )
+      _threads.emplace_back( new fc::thread( name_prefix + "-" + fc::to_string( uint64_t(i) ) ) );
+}
+
+thread_pool::~thread_pool()
+{
+   for( auto& t : _threads )
+      t->quit();
+}
+
+void thread_pool::pin_threads( const std::vector<uint32_t>& cpus )
+{
+   for( auto& t : _threads )
+   {
+      if( !pin_thread( *t, cpus ) )
+      {
+         wlog( "Thread ${n} can't be pinned to CPUs on this platform", ("n",t->name()) );
+         return;
+      }
+   }
+}
+
+void thread_pool::wait_all( std::vector< fc::future<void> >& results )
+{
+   fc::exception_ptr first_error;
+   for( auto& r : results )
+   {
+      try
+      {
+         r.wait();
+      }
+      catch( const fc::exception& e )
+      {
+         if( !first_error )
+            first_error = e.dynamic_copy_exception();
+      }
+   }
+   if( first_error )
+      first_error->dynamic_rethrow_exception();
+}
+
+void thread_pool::completion_latch::done( const fc::exception_ptr& error )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( error && !_first_error )
+      _first_error = error;
+   if( --_remaining == 0 )
+      _done.notify_all();
+}
+
+void thread_pool::completion_latch::wait()
+{
+   std::unique_lock<std::mutex> lock( _mutex );
+   _done.wait( lock, [this]() { return _remaining == 0; } );
+   if( _first_error )
+      _first_error->dynamic_rethrow_exception();
+}
+
+} } // graphene::utilities
@@ -146,6 +146,19 @@ struct wallet_data
    string                    ws_password;
 };
 
+/**
+ * Changes to a wallet_data appended to the journal of the wallet file, see wallet_api::set_wallet_journal().
+ * Entries are merged into the wallet when it is loaded, replaying one more than once changes nothing.
+ */
+struct wallet_journal_entry
+{
+   /** keys added, encrypted like wallet_data::cipher_keys */
+   vector<char>                                  cipher_keys;
+   vector<account_object>                        accounts;
+   map<account_uid_type, set<public_key_type> >  extra_keys;
+   map<string, vector<string> >                  pending_account_registrations;
+};
+
 struct exported_account_keys
 {
     string account_name;
@@ -313,6 +326,17 @@ class wallet_api
        */
       vector<operation_detail>  get_relative_account_history(string account, optional<uint16_t> op_type, uint32_t stop, int limit, uint32_t start)const;
 
+      /** Returns the relative operations on the account from start number, of any of several types.
+       *
+       * @param account the name or UID of the account
+       * @param op_types the operation types to query, e.g. [18,19] for posts and post updates
+       * @param stop Sequence number of earliest operation.
+       * @param limit the number of entries to return
+       * @param start the sequence number where to start looping back throw the history, set 0 for most recent
+       * @returns a list of \c operation_history_objects
+       */
+      vector<operation_detail>  get_relative_account_history_by_types(string account, flat_set<uint16_t> op_types, uint32_t stop, int limit, uint32_t start)const;
+
       /** Returns the block chain's slowly-changing settings.
        * This object contains all of the properties of the blockchain that are fixed
        * or that change only once per maintenance interval (daily) such as the
@@ -551,6 +575,17 @@ class wallet_api
        */
       void    set_wallet_filename(string wallet_filename);
 
+      /** Sets how changes made by importing keys and creating accounts are saved.
+       *
+       * With a \c flush_interval above 0 each change is appended to a journal next to the wallet file,
+       * named after it with a ".journal" suffix, and the wallet file is only rewritten, and the journal
+       * emptied, once every \c flush_interval changes or when the wallet is saved.  Loading the wallet
+       * merges the journal into it.  0, the default, rewrites the wallet file on every change.
+       *
+       * @param flush_interval number of changes kept in the journal before the wallet file is rewritten
+       */
+      void    set_wallet_journal(uint32_t flush_interval);
+
       /** Suggests a safe brain key to use for creating your account.
        * \c create_account_with_brain_key() requires you to specify a 'brain key',
        * a long passphrase that provides enough entropy to generate cyrptographic
@@ -1377,6 +1412,22 @@ class wallet_api
        */
       transaction_id_type broadcast_transaction( signed_transaction tx );
 
+      /** Signs many operations at once, packed into as few transactions as possible.
+       *
+       * The operations are put in order into transactions of at most \c max_operations_per_transaction
+       * operations which fit in the maximum transaction size, the transactions are signed in parallel
+       * and optionally broadcast one after the other without waiting for them to be included in a block.
+       * @param operations the operations, their fees are set
+       * @param max_operations_per_transaction at most this many operations in a transaction, 0 for no limit
+       * @param csaf_fee true if you wish to pay fees with CSAF
+       * @param broadcast true if you wish to broadcast the transactions
+       * @return the signed transactions, in the order of the operations
+       */
+      vector<signed_transaction> sign_bulk_operations(vector<operation> operations,
+                                                      uint32_t max_operations_per_transaction,
+                                                      bool csaf_fee = true,
+                                                      bool broadcast = false);
+
       /** Returns an uninitialized object representing a given blockchain operation.
        *
        * This returns a default-initialized object of the given type; it can be used 
@@ -1943,6 +1994,9 @@ FC_REFLECT( graphene::wallet::key_label, (label)(key) )
 
 FC_REFLECT( graphene::wallet::plain_keys, (keys)(checksum) )
 
+FC_REFLECT( graphene::wallet::wallet_journal_entry,
+            (cipher_keys)(accounts)(extra_keys)(pending_account_registrations) )
+
 FC_REFLECT( graphene::wallet::wallet_data,
             (chain_id)
             (my_accounts)
@@ -2089,6 +2143,7 @@ FC_API( graphene::wallet::wallet_api,
         (get_block)
         (get_account_count)
         (get_relative_account_history)
+        (get_relative_account_history_by_types)
         //(is_public_key_registered)
         (get_global_properties)
         (get_dynamic_global_properties)
@@ -2098,8 +2153,10 @@ FC_API( graphene::wallet::wallet_api,
         //(set_wallet_filename)
         //(load_wallet_file)
         (save_wallet_file)
+        (set_wallet_journal)
         (serialize_transaction)
         (sign_transaction)
+        (sign_bulk_operations)
         (broadcast_transaction)
         (get_prototype_operation)
         //(dbg_make_uia)
@@ -23,12 +23,15 @@
  */
 #include <algorithm>
 #include <cctype>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <list>
+#include <thread>
 
 #include <boost/version.hpp>
 #include <boost/lexical_cast.hpp>
@@ -60,6 +63,7 @@
 #include <fc/crypto/hex.hpp>
 #include <fc/thread/mutex.hpp>
 #include <fc/thread/scoped_lock.hpp>
+#include <fc/thread/thread.hpp>
 
 #include <graphene/app/api.hpp>
 #include <graphene/chain/asset_object.hpp>
@@ -69,6 +73,7 @@
 #include <graphene/utilities/git_revision.hpp>
 #include <graphene/utilities/key_conversion.hpp>
 #include <graphene/utilities/string_escape.hpp>
+#include <graphene/utilities/thread_pool.hpp>
 #include <graphene/utilities/words.hpp>
 #include <graphene/wallet/wallet.hpp>
 #include <graphene/wallet/api_documentation.hpp>
@@ -147,10 +152,7 @@ optional<T> maybe_id( const string& name_or_id )
 fc::ecc::private_key derive_private_key( const std::string& prefix_string,
                                          int sequence_number )
 {
-   std::string sequence_string = std::to_string(sequence_number);
-   fc::sha512 h = fc::sha512::hash(prefix_string + " " + sequence_string);
-   fc::ecc::private_key derived_key = fc::ecc::private_key::regenerate(fc::sha256::hash(h));
-   return derived_key;
+   return graphene::utilities::derive_private_key( prefix_string, sequence_number );
 }
 
 string normalize_brain_key( string s )
@@ -426,6 +428,7 @@ public:
 
    void on_block_applied( const variant& block_id )
    {
+      clear_object_cache();
       fc::async([this]{resync();}, "Resync after block");
    }
 
@@ -540,21 +543,54 @@ public:
       return result;
    }
 
+   /**
+    * The chain parameters, accounts and assets looked up below are cached until the next block is applied,
+    * a transaction is broadcast or @ref object_cache_ttl has passed, whichever comes first.
+    */
+   void clear_object_cache() const
+   {
+      _cached_global_properties.reset();
+      _cached_dynamic_global_properties.reset();
+      _cached_accounts.clear();
+      _cached_account_uids.clear();
+      _cached_assets.clear();
+      _cached_asset_aids.clear();
+      _object_cache_time = fc::time_point::now();
+   }
+   void check_object_cache() const
+   {
+      if( fc::time_point::now() - _object_cache_time > object_cache_ttl )
+         clear_object_cache();
+   }
+
+   /// Sends @p tx to the node, the objects it changes are looked up again afterwards
+   void send_transaction( const signed_transaction& tx )
+   {
+      _remote_net_broadcast->broadcast_transaction( tx );
+      clear_object_cache();
+   }
+
    chain_property_object get_chain_properties() const
    {
       return _remote_db->get_chain_properties();
    }
    global_property_object get_global_properties() const
    {
-      return _remote_db->get_global_properties();
+      check_object_cache();
+      if( !_cached_global_properties.valid() )
+         _cached_global_properties = _remote_db->get_global_properties();
+      return *_cached_global_properties;
    }
    extension_parameter_type get_global_properties_extensions() const
    {
-      return _remote_db->get_global_properties().parameters.get_extension_params();
+      return get_global_properties().parameters.get_extension_params();
    }
    dynamic_global_property_object get_dynamic_global_properties() const
    {
-      return _remote_db->get_dynamic_global_properties();
+      check_object_cache();
+      if( !_cached_dynamic_global_properties.valid() )
+         _cached_dynamic_global_properties = _remote_db->get_dynamic_global_properties();
+      return *_cached_dynamic_global_properties;
    }
    account_object get_account(account_uid_type uid) const
    {
@@ -565,10 +601,20 @@ public:
       if( itr != idx.end() )
          return *itr;
       */
+      check_object_cache();
+      auto cached = _cached_accounts.find( uid );
+      if( cached != _cached_accounts.end() )
+         return cached->second;
       auto rec = _remote_db->get_accounts_by_uid({uid}).front();
       FC_ASSERT( rec, "Can not find account ${uid}.", ("uid",uid) );
+      cache_account( *rec );
       return *rec;
    }
+   void cache_account( const account_object& account ) const
+   {
+      _cached_accounts[account.uid] = account;
+      _cached_account_uids[account.name] = account.uid;
+   }
    account_object get_account(string account_name_or_id) const
    {
       FC_ASSERT( account_name_or_id.size() > 0 );
@@ -594,8 +640,13 @@ public:
             return *_wallet.my_accounts.get<by_name>().find(account_name_or_id);
          }
          */
+         check_object_cache();
+         auto cached = _cached_account_uids.find( account_name_or_id );
+         if( cached != _cached_account_uids.end() )
+            return get_account( cached->second );
          optional<account_object> rec = _remote_db->get_account_by_name( account_name_or_id );
          FC_ASSERT( rec && rec->name == account_name_or_id, "Can not find account ${a}.", ("a",account_name_or_id) );
+         cache_account( *rec );
          return *rec;
       }
    }
@@ -610,9 +661,20 @@ public:
 
    optional<asset_object_with_data> find_asset(asset_aid_type aid)const
    {
+      check_object_cache();
+      auto cached = _cached_assets.find( aid );
+      if( cached != _cached_assets.end() )
+         return cached->second;
       auto rec = _remote_db->get_assets({aid}).front();
+      if( rec )
+         cache_asset( *rec );
       return rec;
    }
+   void cache_asset( const asset_object_with_data& asset ) const
+   {
+      _cached_assets[asset.asset_id] = asset;
+      _cached_asset_aids[asset.symbol] = asset.asset_id;
+   }
    optional<asset_object_with_data> find_asset(string asset_symbol_or_id)const
    {
       FC_ASSERT( asset_symbol_or_id.size() > 0 );
@@ -627,11 +689,16 @@ public:
       }
       else
       {
+         check_object_cache();
+         auto cached = _cached_asset_aids.find( asset_symbol_or_id );
+         if( cached != _cached_asset_aids.end() )
+            return find_asset( cached->second );
          auto rec = _remote_db->lookup_asset_symbols({asset_symbol_or_id}).front();
          if( rec )
          {
             if( rec->symbol != asset_symbol_or_id )
                return optional<asset_object>();
+            cache_asset( *rec );
          }
          return rec;
       }
@@ -712,6 +779,13 @@ public:
 
       _wallet.extra_keys[account.uid].insert(wif_pub_key);
 
+      if( _journal_flush_interval > 0 )
+      {
+         _journal_keys[wif_pub_key] = wif_key;
+         _journal_entry.accounts.push_back( account );
+         _journal_entry.extra_keys[account.uid].insert( wif_pub_key );
+      }
+
       return all_keys_for_account.find(wif_pub_key) != all_keys_for_account.end();
    }
 
@@ -734,6 +808,9 @@ public:
             ("wallet.chain_id", _wallet.chain_id)
             ("chain_id", _chain_id) );
 
+      // the accounts from the journal are refreshed below along with the others
+      replay_wallet_journal( wallet_filename );
+
       size_t account_pagination = 100;
       vector< account_uid_type > account_uids_to_send;
       size_t n = _wallet.my_accounts.size();
@@ -817,6 +894,106 @@ public:
          disable_umask_protection();
          throw;
       }
+
+      if( wallet_filename == _wallet_filename )
+      {
+         _journal_entry = wallet_journal_entry();
+         if( !is_locked() )
+            _journal_keys.clear();
+         // keys of the journal which could not be decrypted yet are only in the journal
+         if( _journal_cipher_keys.empty() )
+         {
+            fc::remove_all( journal_filename( wallet_filename ) );
+            _journal_entries = 0;
+         }
+      }
+   }
+
+   static string journal_filename( const string& wallet_filename )
+   {
+      return wallet_filename + ".journal";
+   }
+
+   /// Saves the changes made since the last save, in the journal if it is enabled and not due for a flush
+   void save_wallet_changes()
+   {
+      if( _journal_flush_interval == 0 || _wallet_filename.empty() || _journal_entries + 1 >= _journal_flush_interval )
+      {
+         save_wallet_file();
+         return;
+      }
+
+      // keys are encrypted like when saving the wallet, those imported while locked wait for the next save
+      if( !is_locked() && !_journal_keys.empty() )
+      {
+         plain_keys data;
+         data.keys = std::move( _journal_keys );
+         data.checksum = _checksum;
+         _journal_entry.cipher_keys = fc::aes_encrypt( data.checksum, fc::raw::pack( data ) );
+         _journal_keys.clear();
+      }
+
+      // each entry starts a new line, so one cut short by a crash doesn't damage the next
+      string data = "\n" + fc::json::to_string( _journal_entry );
+      try
+      {
+         enable_umask_protection();
+         std::ofstream outfile( journal_filename( _wallet_filename ), std::ios::out | std::ios::binary | std::ios::app );
+         outfile.write( data.c_str(), data.length() );
+         outfile.flush();
+         FC_ASSERT( outfile.good(), "Failed to append to the wallet journal" );
+         outfile.close();
+         disable_umask_protection();
+      }
+      catch(...)
+      {
+         disable_umask_protection();
+         throw;
+      }
+      _journal_entry = wallet_journal_entry();
+      ++_journal_entries;
+   }
+
+   /// Merges the journal of @p wallet_filename into the loaded wallet, its keys are merged by unlock()
+   void replay_wallet_journal( const string& wallet_filename )
+   {
+      _journal_entry = wallet_journal_entry();
+      _journal_keys.clear();
+      _journal_cipher_keys.clear();
+      _journal_entries = 0;
+
+      const string filename = journal_filename( wallet_filename );
+      if( !fc::exists( filename ) )
+         return;
+
+      std::ifstream infile( filename, std::ios::in | std::ios::binary );
+      string line;
+      while( std::getline( infile, line ) )
+      {
+         if( line.empty() )
+            continue;
+         wallet_journal_entry entry;
+         try
+         {
+            entry = fc::json::from_string( line ).as< wallet_journal_entry >( 2 * GRAPHENE_MAX_NESTED_OBJECTS );
+         }
+         catch( const fc::exception& e )
+         {
+            wlog( "Skipping a damaged entry of wallet journal ${fn}: ${e}", ("fn", filename)("e", e.to_string()) );
+            continue;
+         }
+         for( const account_object& account : entry.accounts )
+            _wallet.update_account( account );
+         for( const auto& keys : entry.extra_keys )
+            _wallet.extra_keys[keys.first].insert( keys.second.begin(), keys.second.end() );
+         for( const auto& reg : entry.pending_account_registrations )
+            _wallet.pending_account_registrations[reg.first] = reg.second;
+         if( !entry.cipher_keys.empty() )
+            _journal_cipher_keys.push_back( std::move( entry.cipher_keys ) );
+         ++_journal_entries;
+      }
+      if( _journal_entries > 0 )
+         ilog( "Merged ${n} entries of wallet journal ${fn}", ("n", _journal_entries)("fn", filename) );
    }
 
    transaction_handle_type begin_builder_transaction()
@@ -850,7 +1027,7 @@ public:
       FC_ASSERT(fee_asset_obj.asset_id == GRAPHENE_CORE_ASSET_AID, "Must use core assets as a fee");
 
 
-      auto gprops = _remote_db->get_global_properties().parameters;
+      auto gprops = get_global_properties().parameters;
       for( auto& op : _builder_transactions[handle].operations )
          total_fee += gprops.current_fees->set_fee( op );
 
@@ -884,7 +1061,7 @@ public:
       if( review_period_seconds )
          op.review_period_seconds = review_period_seconds;
       trx.operations = {op};
-      _remote_db->get_global_properties().parameters.current_fees->set_fee( trx.operations.front() );
+      get_global_properties().parameters.current_fees->set_fee( trx.operations.front() );
 
       return trx = sign_transaction(trx, broadcast);
    }
@@ -937,7 +1114,7 @@ public:
 
       tx.operations.push_back( account_create_op );
 
-      auto current_fees = _remote_db->get_global_properties().parameters.current_fees;
+      auto current_fees = get_global_properties().parameters.current_fees;
       set_operation_fees( tx, current_fees, csaf_fee );
 
       vector<public_key_type> paying_keys = registrar_account_object.active.get_keys();
@@ -962,7 +1139,7 @@ public:
       }
 
       if( broadcast )
-         _remote_net_broadcast->broadcast_transaction( tx );
+         send_transaction( tx );
       return tx;
    } FC_CAPTURE_AND_RETHROW( (name)(owner)(active)(registrar_account)(referrer_account)(referrer_percent)(csaf_fee)(broadcast) ) }
 
@@ -1057,7 +1234,7 @@ public:
 
          tx.operations.push_back( account_create_op );
 
-         set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
 
          vector<public_key_type> paying_keys = registrar_account_object.active.get_keys();
 
@@ -1081,10 +1258,12 @@ public:
          //    it is intended to only be used for key recovery
          _wallet.pending_account_registrations[account_name].push_back(key_to_wif( active_privkey ));
          _wallet.pending_account_registrations[account_name].push_back(key_to_wif( memo_privkey ));
+         if( _journal_flush_interval > 0 )
+            _journal_entry.pending_account_registrations[account_name] = _wallet.pending_account_registrations[account_name];
          if( save_wallet )
-            save_wallet_file();
+            save_wallet_changes();
          if( broadcast )
-            _remote_net_broadcast->broadcast_transaction( tx );
+            send_transaction( tx );
          return tx;
    } FC_CAPTURE_AND_RETHROW( (account_name)(registrar_account)(referrer_account)(csaf_fee)(broadcast) ) }
 
@@ -1130,7 +1309,7 @@ public:
 
       signed_transaction tx;
       tx.operations.push_back( create_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1153,7 +1332,7 @@ public:
 
       signed_transaction tx;
       tx.operations.push_back( update_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1175,7 +1354,7 @@ public:
 
       signed_transaction tx;
       tx.operations.push_back( reserve_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1194,7 +1373,7 @@ public:
 
       signed_transaction tx;
       tx.operations.push_back( whitelist_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1222,7 +1401,7 @@ public:
 
       signed_transaction tx;
       tx.operations.push_back( committee_member_create_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1379,7 +1558,7 @@ public:
 
       signed_transaction tx;
       tx.operations.push_back( witness_create_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1409,7 +1588,7 @@ public:
 
       signed_transaction tx;
       tx.operations.push_back( witness_create_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       _wallet.pending_witness_registrations[owner_account] = key_to_wif(witness_private_key);
@@ -1444,7 +1623,7 @@ public:
 
       signed_transaction tx;
       tx.operations.push_back( platform_create_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee );
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee );
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1484,7 +1663,7 @@ signed_transaction update_platform(string platform_account,
 
       signed_transaction tx;
       tx.operations.push_back( platform_update_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee );
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee );
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1532,7 +1711,7 @@ signed_transaction account_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back(op);
-      set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction(tx, broadcast);
@@ -1553,7 +1732,7 @@ signed_transaction account_cancel_auth_platform(string account,
       op.platform = platform_account.uid;
       signed_transaction tx;
       tx.operations.push_back( op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee );
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee );
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1588,7 +1767,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( committee_member_update_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee );
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee );
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1633,7 +1812,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( witness_update_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee );
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee );
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1658,7 +1837,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( witness_update_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee );
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee );
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1681,7 +1860,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( witness_collect_pay_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee );
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee );
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1711,7 +1890,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back(cc_op);
-      set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction(tx, broadcast);
@@ -1740,7 +1919,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( witness_vote_update_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1769,7 +1948,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( platform_vote_update_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee );
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee );
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1798,7 +1977,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( committee_member_vote_update_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1819,7 +1998,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( account_update_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1836,7 +2015,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1865,7 +2044,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -1977,7 +2156,7 @@ signed_transaction account_cancel_auth_platform(string account,
       {
          try
          {
-            _remote_net_broadcast->broadcast_transaction( tx );
+            send_transaction( tx );
          }
          catch (const fc::exception& e)
          {
@@ -1992,7 +2171,7 @@ signed_transaction account_cancel_auth_platform(string account,
    transaction_id_type broadcast_transaction( signed_transaction tx )
    {
       try {
-         _remote_net_broadcast->broadcast_transaction( tx );
+         send_transaction( tx );
       }
       catch (const fc::exception& e)
       {
@@ -2001,6 +2180,124 @@ signed_transaction account_cancel_auth_platform(string account,
       }
       return tx.id();
    }
+
+   vector<signed_transaction> sign_bulk_operations( vector<operation> operations,
+                                                    uint32_t max_operations_per_transaction,
+                                                    bool csaf_fee, bool broadcast )
+   { try {
+      FC_ASSERT( !self.is_locked(), "Should unlock first" );
+      FC_ASSERT( !operations.empty(), "No operations" );
+      if( max_operations_per_transaction == 0 )
+         max_operations_per_transaction = std::numeric_limits<uint32_t>::max();
+
+      const auto params = get_global_properties().parameters;
+      const auto dyn_props = get_dynamic_global_properties();
+
+      // pack the operations in order into as few transactions as fit in the maximum size,
+      // leaving room for a few signatures
+      const size_t signatures_size = 8 * ( sizeof( fc::ecc::compact_signature ) + 1 );
+      FC_ASSERT( params.maximum_transaction_size > signatures_size );
+      const size_t max_size = params.maximum_transaction_size - signatures_size;
+      vector<signed_transaction> txs;
+      size_t tx_size = 0;
+      for( operation& op : operations )
+      {
+         if( csaf_fee )
+            params.current_fees->set_fee_with_csaf( op );
+         else
+            params.current_fees->set_fee( op );
+         const size_t op_size = fc::raw::pack_size( op );
+         if( txs.empty() || txs.back().operations.size() >= max_operations_per_transaction
+               || tx_size + op_size > max_size )
+         {
+            txs.emplace_back();
+            txs.back().set_reference_block( dyn_props.head_block_id );
+            txs.back().set_expiration( dyn_props.time + fc::seconds(120) );
+            tx_size = fc::raw::pack_size( txs.back() );
+         }
+         txs.back().operations.push_back( std::move( op ) );
+         tx_size += op_size;
+      }
+
+      // the keys are looked up one transaction at a time, offering all the keys of the wallet at once,
+      // so a single lookup gives both the keys to sign with and whether the authorities can be satisfied at all
+      fc::time_point_sec oldest_transaction_ids_to_track( dyn_props.time - fc::minutes(5) );
+      auto& recent_by_time = _recently_generated_transactions.get<timestamp_index>();
+      recent_by_time.erase( recent_by_time.begin(), recent_by_time.lower_bound( oldest_transaction_ids_to_track ) );
+      flat_set<public_key_type> wallet_keys;
+      wallet_keys.reserve( _keys.size() );
+      for( const auto& key : _keys )
+         wallet_keys.insert( key.first );
+      vector< vector<fc::ecc::private_key> > signing_keys( txs.size() );
+      for( size_t i = 0; i < txs.size(); ++i )
+      {
+         signed_transaction& tx = txs[i];
+         tx.validate();
+         const auto result = _remote_db->get_required_signatures( tx, wallet_keys ).first;
+         const auto& missed_keys = result.second;
+         FC_ASSERT( missed_keys.find( public_key_type() ) == missed_keys.end(),
+                    "Transaction ${i} can not be signed", ("i", i) );
+         FC_ASSERT( !result.first.empty(), "The wallet has none of the keys to sign transaction ${i}", ("i", i) );
+         for( const auto& pub_key : result.first )
+         {
+            fc::optional<fc::ecc::private_key> privkey = wif_to_key( _keys.at( pub_key ) );
+            FC_ASSERT( privkey.valid(), "Malformed private key in _keys" );
+            signing_keys[i].push_back( *privkey );
+         }
+
+         // signatures don't change the ID, so identical transactions are told apart before signing
+         uint32_t expiration_time_offset = 0;
+         while( _recently_generated_transactions.find( tx.id() ) != _recently_generated_transactions.end() )
+            tx.set_expiration( dyn_props.time + fc::seconds( 120 + ++expiration_time_offset ) );
+         recently_generated_transaction_record this_transaction_record;
+         this_transaction_record.generation_time = dyn_props.time;
+         this_transaction_record.transaction_id = tx.id();
+         _recently_generated_transactions.insert( this_transaction_record );
+      }
+
+      // signing is the costly part, it is spread over a thread per core
+      const size_t thread_count = std::min<size_t>( std::max( 1u, std::thread::hardware_concurrency() ), txs.size() );
+      std::vector< std::unique_ptr<fc::thread> > threads;
+      std::vector< fc::future<void> > signing;
+      const chain_id_type chain_id = _chain_id;
+      for( size_t t = 0; t < thread_count; ++t )
+      {
+         threads.emplace_back( new fc::thread( "wallet_signing" ) );
+         signing.push_back( threads.back()->async( [t,thread_count,chain_id,&txs,&signing_keys]() {
+            for( size_t i = t; i < txs.size(); i += thread_count )
+               for( const auto& key : signing_keys[i] )
+                  txs[i].sign( key, chain_id );
+         }, "sign_bulk_operations" ) );
+      }
+      for( auto& f : signing )
+         f.wait();
+      for( auto& thread : threads )
+         thread->quit();
+
+      // the transactions are sent one after the other without waiting for them to be in a block,
+      // their confirmations are logged as they come
+      if( broadcast )
+      {
+         for( const signed_transaction& tx : txs )
+         {
+            try
+            {
+               _remote_net_broadcast->broadcast_transaction_with_callback( []( const variant& confirmation ) {
+                  ilog( "Transaction ${id} confirmed in block ${b}",
+                        ("id", confirmation["id"])("b", confirmation["block_num"]) );
+               }, tx );
+            }
+            catch (const fc::exception& e)
+            {
+               clear_object_cache();
+               elog("Caught exception while broadcasting tx ${id}:  ${e}", ("id", tx.id().str())("e", e.to_detail_string()) );
+               throw;
+            }
+         }
+         clear_object_cache();
+      }
+      return txs;
+   } FC_CAPTURE_AND_RETHROW( (max_operations_per_transaction)(csaf_fee)(broadcast) ) }
    
    signed_transaction transfer(string from, string to, string amount,
                                string asset_symbol, string memo, bool csaf_fee = true, bool broadcast = false)
@@ -2030,7 +2327,7 @@ signed_transaction account_cancel_auth_platform(string account,
       //xfer_op.fee = fee_type(asset(_remote_db->get_required_fee_data({ xfer_op }).at(0).min_fee));
       signed_transaction tx;
       tx.operations.push_back(xfer_op);
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction(tx, broadcast);
@@ -2077,7 +2374,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(xfer_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2113,7 +2410,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back(xfer_op);
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction(tx, broadcast);
@@ -2143,7 +2440,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back(issue_op);
-      set_operation_fees(tx,_remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees(tx,get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction(tx, broadcast);
@@ -2184,6 +2481,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          return ss.str();
       };
+      m["get_relative_account_history_by_types"] = m["get_relative_account_history"];
 
       m["list_account_balances"] = [this](variant result, const fc::variants& a)
       {
@@ -2224,7 +2522,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -2246,7 +2544,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
       signed_transaction tx;
       tx.operations.push_back( update_op );
-      set_operation_fees( tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+      set_operation_fees( tx, get_global_properties().parameters.current_fees, csaf_fee);
       tx.validate();
 
       return sign_transaction( tx, broadcast );
@@ -2269,7 +2567,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
            signed_transaction tx;
            tx.operations.push_back(op);
-           set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+           set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
            tx.validate();
 
            return sign_transaction(tx, broadcast);
@@ -2307,7 +2605,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
            signed_transaction tx;
            tx.operations.push_back(op);
-           set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+           set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
            tx.validate();
 
            return sign_transaction(tx, broadcast);
@@ -2329,7 +2627,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
            signed_transaction tx;
            tx.operations.push_back(op);
-           set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+           set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
            tx.validate();
 
            return sign_transaction(tx, broadcast);
@@ -2364,7 +2662,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(create_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2394,7 +2692,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(reward_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2427,7 +2725,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(reward_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2458,7 +2756,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(buyout_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2493,7 +2791,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(create_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2566,7 +2864,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(create_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2632,7 +2930,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(update_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2656,7 +2954,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(manage_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2702,7 +3000,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(buy_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2729,7 +3027,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(confirm_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2919,7 +3217,7 @@ signed_transaction account_cancel_auth_platform(string account,
    {
       try {
          account_uid_type account_uid = get_account_uid(account);
-         auto dynamic_props = _remote_db->get_dynamic_global_properties();
+         auto dynamic_props = get_dynamic_global_properties();
          FC_ASSERT(period <= dynamic_props.current_active_post_sequence, "period does not exist");
          return _remote_db->get_score_profit(account_uid, period);
       } FC_CAPTURE_AND_RETHROW((account)(period))
@@ -2959,7 +3257,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(create_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -2995,7 +3293,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(update_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3022,7 +3320,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(ransom_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3061,7 +3359,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(create_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3089,7 +3387,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(vote_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3162,7 +3460,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(balance_lock_update_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3190,7 +3488,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(pledge_mining_update_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3214,7 +3512,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(pledge_bonus_collect_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3238,7 +3536,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(score_bonus_collect_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3273,7 +3571,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(create_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3296,7 +3594,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(cancel_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3325,7 +3623,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(collect_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3349,7 +3647,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(assign_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3388,7 +3686,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(collect_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3415,7 +3713,7 @@ signed_transaction account_cancel_auth_platform(string account,
 
          signed_transaction tx;
          tx.operations.push_back(collect_op);
-         set_operation_fees(tx, _remote_db->get_global_properties().parameters.current_fees, csaf_fee);
+         set_operation_fees(tx, get_global_properties().parameters.current_fees, csaf_fee);
          tx.validate();
 
          return sign_transaction(tx, broadcast);
@@ -3621,6 +3919,26 @@ signed_transaction account_cancel_auth_platform(string account,
    map<public_key_type,string> _keys;
    fc::sha512                  _checksum;
 
+   /// see clear_object_cache()
+   const fc::microseconds                                 object_cache_ttl = fc::seconds( GRAPHENE_DEFAULT_BLOCK_INTERVAL );
+   mutable fc::time_point                                 _object_cache_time;
+   mutable optional<global_property_object>               _cached_global_properties;
+   mutable optional<dynamic_global_property_object>       _cached_dynamic_global_properties;
+   mutable map<account_uid_type, account_object>          _cached_accounts;
+   mutable map<string, account_uid_type>                  _cached_account_uids;
+   mutable map<asset_aid_type, asset_object_with_data>    _cached_assets;
+   mutable map<string, asset_aid_type>                    _cached_asset_aids;
+
+   /// 0 when changes aren't journaled, see wallet_api::set_wallet_journal()
+   uint32_t                    _journal_flush_interval = 0;
+   /// entries in the journal of the wallet file
+   uint32_t                    _journal_entries = 0;
+   /// changes not saved yet, with the keys of the entry kept apart until they are encrypted
+   wallet_journal_entry        _journal_entry;
+   map<public_key_type,string> _journal_keys;
+   /// encrypted keys read from the journal while the wallet was locked
+   vector< vector<char> >      _journal_cipher_keys;
+
    chain_id_type           _chain_id;
    fc::api<login_api>      _remote_api;
    fc::api<database_api>   _remote_db;
@@ -3809,13 +4127,20 @@ namespace graphene { namespace wallet {
       // Create as many derived owner keys as requested
       vector<brain_key_info> results;
       brain_key = graphene::wallet::detail::normalize_brain_key(brain_key);
-      for (int i = 0; i < number_of_desired_keys; ++i) {
-        fc::ecc::private_key priv_key = graphene::wallet::detail::derive_private_key( brain_key, i );
 
+      // deriving a key costs a few hundred microseconds, so long scans are spread over all cores
+      std::unique_ptr<graphene::utilities::thread_pool> pool;
+      if( number_of_desired_keys >= 1000 )
+         pool.reset( new graphene::utilities::thread_pool( std::max( 1u, std::thread::hardware_concurrency() ),
+                                                           "derive" ) );
+      const auto keys = graphene::utilities::derive_keys( brain_key, 0, number_of_desired_keys, pool.get() );
+
+      results.reserve( keys.size() );
+      for( const auto& key : keys ) {
         brain_key_info result;
         result.brain_priv_key = brain_key;
-        result.wif_priv_key = key_to_wif( priv_key );
-        result.pub_key = priv_key.get_public_key();
+        result.wif_priv_key = key_to_wif( key.private_key );
+        result.pub_key = key.public_key;
 
         results.push_back(result);
       }
@@ -3894,6 +4219,29 @@ vector<operation_detail> wallet_api::get_relative_account_history(string account
    return result;
 }
 
+vector<operation_detail> wallet_api::get_relative_account_history_by_types(string account, flat_set<uint16_t> op_types, uint32_t stop, int limit, uint32_t start)const
+{
+   vector<operation_detail> result;
+
+   account_uid_type uid = get_account( account ).uid;
+   while( limit > 0 )
+   {
+      vector <pair<uint32_t,operation_history_object>> current = my->_remote_hist->get_relative_account_history_by_types(uid, op_types, stop, std::min<uint32_t>(100, limit), start);
+      for (auto &p : current) {
+         auto &o = p.second;
+         std::stringstream ss;
+         auto memo = o.op.visit(detail::operation_printer(ss, *my, o.result));
+         result.push_back(operation_detail{memo, ss.str(), p.first, o});
+      }
+      if (current.size() < std::min<uint32_t>(100, limit))
+         break;
+      limit -= current.size();
+      start = result.back().sequence - 1;
+      if( start == 0 || start < stop ) break;
+   }
+   return result;
+}
+
 uint64_t wallet_api::calculate_account_uid(uint64_t n)const
 {
    return calc_account_uid( n );
@@ -4046,7 +4394,7 @@ bool wallet_api::import_key(string account_name_or_id, string wif_key)
    //copy_wallet_file( "before-import-key-" + shorthash );
 
    bool result = my->import_key(account_name_or_id, wif_key);
-   save_wallet_file();
+   my->save_wallet_changes();
    //copy_wallet_file( "after-import-key-" + shorthash );
    return result;
 }
@@ -4161,7 +4509,7 @@ bool wallet_api::import_account_keys( string filename, string password, string s
 
        return true;
    }
-   save_wallet_file();
+   my->save_wallet_changes();
 
    FC_ASSERT( found_account );
 
@@ -4528,6 +4876,13 @@ void wallet_api::set_wallet_filename(string wallet_filename)
    my->_wallet_filename = wallet_filename;
 }
 
+void wallet_api::set_wallet_journal(uint32_t flush_interval)
+{
+   my->_journal_flush_interval = flush_interval;
+   if( flush_interval == 0 && my->_journal_entries > 0 )
+      my->save_wallet_file();
+}
+
 signed_transaction wallet_api::sign_transaction(signed_transaction tx, bool broadcast /* = false */)
 { try {
    return my->sign_transaction( tx, broadcast);
@@ -4538,6 +4893,14 @@ transaction_id_type wallet_api::broadcast_transaction(signed_transaction tx)
    return my->broadcast_transaction( tx );
 } FC_CAPTURE_AND_RETHROW( (tx) ) }
 
+vector<signed_transaction> wallet_api::sign_bulk_operations(vector<operation> operations,
+                                                            uint32_t max_operations_per_transaction,
+                                                            bool csaf_fee,
+                                                            bool broadcast /* = false */)
+{
+   return my->sign_bulk_operations( operations, max_operations_per_transaction, csaf_fee, broadcast );
+}
+
 operation wallet_api::get_prototype_operation(string operation_name)
 {
    return my->get_prototype_operation( operation_name );
@@ -5365,6 +5728,13 @@ void wallet_api::unlock(string password)
    vector<char> decrypted = fc::aes_decrypt(pw, my->_wallet.cipher_keys);
    auto pk = fc::raw::unpack<plain_keys>(decrypted);
    FC_ASSERT(pk.checksum == pw);
+   for( const vector<char>& cipher_keys : my->_journal_cipher_keys )
+   {
+      auto journal_keys = fc::raw::unpack<plain_keys>( fc::aes_decrypt( pw, cipher_keys ) );
+      FC_ASSERT( journal_keys.checksum == pw, "The wallet journal was written with another password" );
+      pk.keys.insert( journal_keys.keys.begin(), journal_keys.keys.end() );
+   }
+   my->_journal_cipher_keys.clear();
    my->_keys = std::move(pk.keys);
    my->_checksum = pk.checksum;
    my->self.lock_changed(false);
@@ -5376,6 +5746,9 @@ void wallet_api::set_password( string password )
       FC_ASSERT( !is_locked(), "The wallet must be unlocked before the password can be set" );
    my->_checksum = fc::sha512::hash( password.c_str(), password.size() );
    lock();
+   // the journal is encrypted with the old password
+   if( my->_journal_entries > 0 )
+      my->save_wallet_file();
 }
 
 map<public_key_type, string> wallet_api::dump_private_keys()
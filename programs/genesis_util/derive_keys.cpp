@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <fc/io/json.hpp>
+
+#include <graphene/chain/protocol/address.hpp>
+#include <graphene/chain/protocol/types.hpp>
+#include <graphene/utilities/key_conversion.hpp>
+#include <graphene/utilities/thread_pool.hpp>
+
+using namespace std;
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      if( argc < 3 || string( argv[1] ) == "-h" || string( argv[1] ) == "--help" )
+      {
+         std::cerr << "derive-keys <prefix> <first>:<end> [threads]\n"
+             "\n"
+             "Derives the keys number first to end - 1 from prefix, as the wallet derives keys from a brain key.\n"
+             "A brain key must be given normalized: upper case words separated by single spaces.\n"
+             "threads defaults to the number of cores.\n"
+             "\n"
+             "example:\n"
+             "\n"
+             "derive-keys \"ALPHA BRAVO CHARLIE\" 0:10000\n"
+             "\n";
+         return 1;
+      }
+
+      const std::string prefix = argv[1];
+      const std::string range = argv[2];
+      const auto colon_pos = range.find(':');
+      FC_ASSERT( colon_pos != string::npos, "the range must be given as <first>:<end>" );
+      const int first = std::stoi( range.substr( 0, colon_pos ) );
+      const int end = std::stoi( range.substr( colon_pos+1 ) );
+      FC_ASSERT( 0 <= first && first <= end, "invalid range" );
+      const uint32_t threads = argc > 3 ? std::stoul( argv[3] ) : std::max( 1u, std::thread::hardware_concurrency() );
+
+      graphene::utilities::thread_pool pool( threads, "derive" );
+      const auto keys = graphene::utilities::derive_keys( prefix, first, end - first, &pool );
+
+      std::cout << "[";
+      for( size_t i = 0; i < keys.size(); ++i )
+      {
+         fc::limited_mutable_variant_object mvo( 5 );
+         graphene::chain::public_key_type pub_key = keys[i].public_key;
+         mvo( "sequence", first + int( i ) )
+            ( "private_key", graphene::utilities::key_to_wif( keys[i].private_key ) )
+            ( "public_key", std::string( pub_key ) )
+            ( "address", graphene::chain::address( pub_key ) )
+            ;
+         if( i > 0 )
+            std::cout << ",\n";
+         std::cout << fc::json::to_string( fc::mutable_variant_object( mvo ) );
+      }
+      std::cout << "]\n";
+   }
+   catch ( const fc::exception& e )
+   {
+      std::cout << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
@@ -65,6 +65,7 @@ int main( int argc, char** argv )
             ("help,h", "Print this help message and exit.")
             ("genesis-json,g", bpo::value<boost::filesystem::path>(), "File to read genesis state from")
             ("out,o", bpo::value<boost::filesystem::path>(), "File to output new genesis to")
+            ("out-binary,b", bpo::value<boost::filesystem::path>(), "File to also output new genesis to in the binary format, which starts the same chain as the JSON output and loads faster")
             ("dev-account-prefix", bpo::value<std::string>()->default_value("devacct"), "Prefix for dev accounts")
             ("dev-key-prefix", bpo::value<std::string>()->default_value("devkey-"), "Prefix for dev key")
             ("dev-account-count", bpo::value<uint32_t>()->default_value(0), "Prefix for dev accounts")
@@ -173,7 +174,24 @@ int main( int argc, char** argv )
       }
 
       fc::path output_filename = options["out"].as<boost::filesystem::path>();
+      // the binary genesis holds the chain id instead, which is checked against the JSON of the genesis without it
+      if( options.count("out-binary") )
+         genesis.initial_chain_id = chain_id_type();
       fc::json::save_to_file( genesis, output_filename );
+
+      if( options.count("out-binary") )
+      {
+         // the chain id of a JSON genesis is the hash of the file
+         std::string genesis_json;
+         read_file_contents( output_filename, genesis_json );
+         FC_ASSERT( fc::sha256::hash( genesis_json ) == json_genesis_chain_id( genesis ),
+                    "The JSON genesis written isn't the one a node would check the binary genesis against" );
+         genesis.initial_chain_id = fc::sha256::hash( genesis_json );
+         fc::path binary_filename = options["out-binary"].as<boost::filesystem::path>();
+         save_binary_genesis_state( genesis, binary_filename );
+         std::cerr << "update_genesis:  Wrote binary genesis of chain " << genesis.initial_chain_id.str()
+                   << " to " << binary_filename.preferred_string() << "\n";
+      }
    }
    catch ( const fc::exception& e )
    {
@@ -22,20 +22,45 @@
  * THE SOFTWARE.
  */
 
+/**
+ * size_checker prints the in-memory and packed size of every operation type.
+ *
+ * With --profile-blocks it profiles the operations of a chain instead: it replays the blocks stored by a node or by
+ * generate_empty_blocks into a temporary state, then reports for each operation type found the packed size and the
+ * time to validate it, to calculate its fee and to recover the signatures of the transactions carrying it, all
+ * against the replayed state, with the time its evaluator took during the replay.
+ */
+
+#include <fc/filesystem.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/io/json.hpp>
 #include <fc/smart_ref_impl.hpp>
 #include <fc/variant.hpp>
 #include <fc/variant_object.hpp>
 
+#include <graphene/chain/block_database.hpp>
+#include <graphene/chain/database.hpp>
 #include <graphene/chain/protocol/protocol.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <boost/program_options.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
 #include <vector>
 
 using namespace graphene::chain;
+namespace bpo = boost::program_options;
+
+// hack:  import create_example_genesis() even though it's a way, way
+// specific internal detail
+namespace graphene { namespace app { namespace detail {
+genesis_state_type create_example_genesis();
+} } } // graphene::app::detail
 
 vector< fc::variant_object > g_op_types;
 
@@ -64,10 +89,201 @@ struct size_check_type_visitor
    }
 };
 
+struct operation_name_visitor
+{
+   typedef string result_type;
+
+   template<typename Type>
+   result_type operator()( const Type& )const
+   {
+      return fc::get_typename<Type>::name();
+   }
+};
+
+/// The operations of one type found in the replayed blocks, with the transactions carrying them
+struct operation_samples
+{
+   uint64_t                   found = 0;
+   vector<operation>          operations;
+   vector<signed_transaction> transactions;
+};
+
+/// Average time of @p f in microseconds over @p repeat runs, the runs which throw count in @p failures
+template<typename Functor>
+double time_us( uint32_t repeat, uint64_t& failures, Functor&& f )
+{
+   const auto start = std::chrono::steady_clock::now();
+   for( uint32_t i = 0; i < repeat; ++i )
+   {
+      try
+      {
+         f();
+      }
+      catch( const fc::exception& )
+      {
+         ++failures;
+      }
+   }
+   const auto elapsed = std::chrono::steady_clock::now() - start;
+   return std::chrono::duration<double,std::micro>( elapsed ).count() / repeat;
+}
+
+int profile_blocks( const bpo::variables_map& options )
+{
+   const fc::path blocks_dir = options["profile-blocks"].as<boost::filesystem::path>();
+   const uint32_t max_samples = std::max( 1u, options["samples"].as<uint32_t>() );
+   const uint32_t repeat = std::max( 1u, options["repeat"].as<uint32_t>() );
+
+   genesis_state_type genesis;
+   if( options.count("genesis-json") )
+   {
+      std::string genesis_json;
+      fc::read_file_contents( options["genesis-json"].as<boost::filesystem::path>(), genesis_json );
+      genesis = fc::json::from_string( genesis_json ).as< genesis_state_type >( 20 );
+   }
+   else
+      genesis = graphene::app::detail::create_example_genesis();
+   if( options["genesis-time"].as<uint32_t>() != 0 )
+      genesis.initial_timestamp = fc::time_point_sec( options["genesis-time"].as<uint32_t>() );
+
+   block_database blocks;
+   blocks.open( blocks_dir / "database" / "block_num_to_block" );
+   fc::optional<block_id_type> last_id = blocks.last_id();
+   if( !last_id.valid() )
+   {
+      std::cerr << "No blocks stored in " << blocks_dir.generic_string() << "\n";
+      return 1;
+   }
+   uint32_t last = block_header::num_from_id( *last_id );
+   if( options["blocks"].as<uint32_t>() != 0 )
+      last = std::min( last, options["blocks"].as<uint32_t>() );
+
+   fc::temp_directory state_dir( graphene::utilities::temp_directory_path() );
+   database db;
+   db.open( state_dir.path(), [&genesis]() { return genesis; }, "size_checker" );
+   db.get_evaluation_profiler().reset();
+
+   std::cerr << "Replaying " << last << " blocks from " << blocks_dir.generic_string() << "\n";
+   std::map<int32_t,operation_samples> samples;
+   for( uint32_t block_num = 1; block_num <= last; ++block_num )
+   {
+      fc::optional<signed_block> block = blocks.fetch_by_number( block_num );
+      FC_ASSERT( block.valid(), "Block ${n} is missing", ("n",block_num) );
+      db.push_block( *block, database::replay_skip_flags | database::skip_fork_db );
+      for( const signed_transaction& trx : block->transactions )
+      {
+         for( const operation& op : trx.operations )
+         {
+            operation_samples& s = samples[op.which()];
+            ++s.found;
+            if( s.operations.size() < max_samples )
+            {
+               s.operations.push_back( op );
+               s.transactions.push_back( trx );
+            }
+         }
+      }
+   }
+   blocks.close();
+
+   std::map<int32_t,operation_profile> evaluation;
+   for( const operation_profile& p : db.get_evaluation_profiler().get_profiles() )
+      evaluation[p.operation_type] = p;
+
+   const fee_schedule& fees = db.current_fee_schedule();
+   const chain_id_type chain_id = db.get_chain_id();
+   vector<fc::variant_object> results;
+   for( const auto& type_and_samples : samples )
+   {
+      const operation_samples& s = type_and_samples.second;
+      uint64_t packed_bytes = 0;
+      uint64_t max_packed_bytes = 0;
+      uint64_t validate_failures = 0;
+      uint64_t fee_failures = 0;
+      uint64_t signature_failures = 0;
+      double validate_us = 0;
+      double fee_us = 0;
+      double signature_us = 0;
+      for( size_t i = 0; i < s.operations.size(); ++i )
+      {
+         const operation& op = s.operations[i];
+         const uint64_t size = fc::raw::pack_size( op );
+         packed_bytes += size;
+         max_packed_bytes = std::max( max_packed_bytes, size );
+         validate_us += time_us( repeat, validate_failures, [&op]() { operation_validate( op ); } );
+         fee_us += time_us( repeat, fee_failures, [&]() { fees.calculate_fee( op ); } );
+         // get_signature_keys() recovers the keys every time, it doesn't use the keys recovered ahead of time
+         const signed_transaction& trx = s.transactions[i];
+         signature_us += time_us( repeat, signature_failures, [&]() { trx.get_signature_keys( chain_id ); } );
+      }
+      const double n = s.operations.size();
+
+      fc::mutable_variant_object vo;
+      vo["operation_type"] = type_and_samples.first;
+      vo["name"] = s.operations.front().visit( operation_name_visitor() );
+      vo["found"] = s.found;
+      vo["samples"] = s.operations.size();
+      vo["avg_packed_size"] = packed_bytes / s.operations.size();
+      vo["max_packed_size"] = max_packed_bytes;
+      vo["validate_us"] = validate_us / n;
+      vo["fee_us"] = fee_us / n;
+      // of the whole transaction carrying the operation
+      vo["signature_us"] = signature_us / n;
+      vo["validate_failures"] = validate_failures / repeat;
+      vo["fee_failures"] = fee_failures / repeat;
+      auto eval_itr = evaluation.find( type_and_samples.first );
+      if( eval_itr != evaluation.end() && eval_itr->second.count > 0 )
+      {
+         const operation_profile& p = eval_itr->second;
+         vo["evaluated"] = p.count;
+         vo["evaluate_us"] = double( p.evaluate_us ) / p.count;
+         vo["apply_us"] = double( p.apply_us ) / p.count;
+      }
+      results.push_back( vo );
+   }
+   db.close();
+
+   std::cout << "[\n";
+   for( size_t i = 0; i < results.size(); ++i )
+      std::cout << "   " << fc::json::to_string( results[i] ) << ( i + 1 < results.size() ? ",\n" : "\n" );
+   std::cout << "]\n";
+   return 0;
+}
+
 int main( int argc, char** argv )
 {
    try
    {
+      bpo::options_description cli_options( "size_checker" );
+      cli_options.add_options()
+            ("help,h", "Print this help message and exit.")
+            ("profile-blocks", bpo::value<boost::filesystem::path>(),
+             "Profile the operations of the blocks stored in this directory, the one the node or generate_empty_blocks "
+             "opened the database in, e.g. <data-dir>/blockchain")
+            ("genesis-json,g", bpo::value<boost::filesystem::path>(), "File to read the genesis state of the profiled blocks from (default: the example genesis)")
+            ("genesis-time,t", bpo::value<uint32_t>()->default_value(0), "Timestamp of the genesis state (0=use value from file/example)")
+            ("blocks", bpo::value<uint32_t>()->default_value(0), "Number of blocks to replay, 0 for all of them")
+            ("samples", bpo::value<uint32_t>()->default_value(100), "Operations of each type timed after the replay")
+            ("repeat", bpo::value<uint32_t>()->default_value(10), "Times each sample is timed")
+            ;
+      bpo::variables_map options;
+      try
+      {
+         bpo::store( bpo::parse_command_line( argc, argv, cli_options ), options );
+      }
+      catch( const bpo::error& e )
+      {
+         std::cerr << "Error parsing command line: " << e.what() << "\n";
+         return 1;
+      }
+      if( options.count("help") )
+      {
+         std::cout << cli_options << "\n";
+         return 0;
+      }
+      if( options.count("profile-blocks") )
+         return profile_blocks( options );
+
       graphene::chain::operation op;
 
 
@@ -107,7 +323,7 @@ int main( int argc, char** argv )
       std::cout << "]\n";
       std::cerr << "Size of block header: " << sizeof( block_header ) << " " << fc::raw::pack_size( block_header() ) << "\n";
    }
-   catch ( const fc::exception& e ){ edump((e.to_detail_string())); }
+   catch ( const fc::exception& e ){ edump((e.to_detail_string())); return 1; }
    idump((sizeof(signed_block)));
    idump((fc::raw::pack_size(signed_block())));
    return 0;
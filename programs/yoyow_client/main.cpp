@@ -85,6 +85,7 @@ int main( int argc, char** argv )
          ("rpc-http-endpoint,H", bpo::value<string>()->implicit_value("127.0.0.1:8093"), "Endpoint for wallet HTTP RPC to listen on")
          ("daemon,d", "Run the wallet in daemon mode" )
          ("wallet-file,w", bpo::value<string>()->implicit_value("wallet.json"), "wallet to load")
+         ("wallet-journal", bpo::value<uint32_t>(), "Journal key imports and account creations, rewriting the wallet file every N of them")
          ("chain-id", bpo::value<string>(), "chain ID to connect to")
          ("version,v", "Display version information");
 
@@ -196,6 +197,8 @@ int main( int argc, char** argv )
       auto wapiptr = std::make_shared<wallet_api>( wdata, remote_api );
       wapiptr->set_wallet_filename( wallet_file.generic_string() );
       wapiptr->load_wallet_file();
+      if( options.count("wallet-journal") )
+         wapiptr->set_wallet_journal( options.at("wallet-journal").as<uint32_t>() );
 
       fc::api<wallet_api> wapi(wapiptr);
 
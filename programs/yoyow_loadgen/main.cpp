@@ -0,0 +1,538 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * yoyow_loadgen pushes a deterministic stream of signed transactions to a node.
+ *
+ * Accounts are derived from --seed, so a second run with the same seed reuses the accounts of the first one
+ * and only creates the missing ones. All transactions of the run are generated and signed before the first
+ * one is pushed, then they are pushed through network_broadcast_api at --tps, and the accepted rate and the
+ * confirmation latency percentiles are printed as JSON.
+ */
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fc/io/json.hpp>
+#include <fc/network/http/websocket.hpp>
+#include <fc/rpc/websocket_api.hpp>
+#include <fc/smart_ref_impl.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <graphene/app/api.hpp>
+#include <graphene/chain/protocol/protocol.hpp>
+#include <graphene/utilities/key_conversion.hpp>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+
+using namespace graphene;
+using namespace graphene::app;
+using namespace graphene::chain;
+using namespace graphene::utilities;
+namespace bpo = boost::program_options;
+
+struct loadgen_account
+{
+   account_uid_type     uid;
+   string               name;
+   fc::ecc::private_key key;
+   post_pid_type        next_post_pid = 1;
+};
+
+struct loadgen_post
+{
+   account_uid_type poster;
+   post_pid_type    post_pid;
+};
+
+struct loadgen_transaction
+{
+   signed_transaction                trx;
+   vector<const fc::ecc::private_key*> keys;
+};
+
+/**
+ * Pushes transactions with broadcast_transaction_with_callback and keeps the time each one was sent,
+ * so the confirmation callback can record how long it took to get into a block.
+ */
+class push_tracker
+{
+   public:
+      push_tracker( fc::api<network_broadcast_api> net ) : _net( net ) {}
+
+      void push( const signed_transaction& trx )
+      {
+         const transaction_id_type id = trx.id();
+         {
+            std::lock_guard<std::mutex> guard( _mutex );
+            _push_times[id] = fc::time_point::now();
+         }
+         try
+         {
+            _net->broadcast_transaction_with_callback( [this]( const variant& confirmation ) {
+               on_confirmation( confirmation );
+            }, trx );
+            std::lock_guard<std::mutex> guard( _mutex );
+            ++_accepted;
+         }
+         catch( const fc::exception& e )
+         {
+            std::lock_guard<std::mutex> guard( _mutex );
+            _push_times.erase( id );
+            ++_rejected;
+            ++_rejections[ e.to_string() ];
+         }
+      }
+
+      /// Waits until every accepted transaction is confirmed or no confirmation came for @p timeout
+      void wait_confirmations( const fc::microseconds& timeout )
+      {
+         fc::time_point last_progress = fc::time_point::now();
+         size_t last_pending = pending();
+         while( last_pending > 0 && fc::time_point::now() - last_progress < timeout )
+         {
+            fc::usleep( fc::milliseconds( 100 ) );
+            const size_t now_pending = pending();
+            if( now_pending != last_pending )
+            {
+               last_pending = now_pending;
+               last_progress = fc::time_point::now();
+            }
+         }
+      }
+
+      size_t pending()const
+      {
+         std::lock_guard<std::mutex> guard( _mutex );
+         return _push_times.size();
+      }
+
+      fc::mutable_variant_object report( const fc::time_point& start, const fc::time_point& pushed )const
+      {
+         std::lock_guard<std::mutex> guard( _mutex );
+         fc::mutable_variant_object result;
+         const double push_seconds = std::max<int64_t>( ( pushed - start ).count(), 1 ) / 1000000.0;
+         result["accepted"] = _accepted;
+         result["rejected"] = _rejected;
+         result["confirmed"] = _latencies.size();
+         result["unconfirmed"] = _push_times.size();
+         result["push_seconds"] = push_seconds;
+         result["accepted_tps"] = _accepted / push_seconds;
+         if( !_latencies.empty() )
+         {
+            const double confirm_seconds = std::max<int64_t>( ( _last_confirmation - start ).count(), 1 ) / 1000000.0;
+            result["confirmed_tps"] = _latencies.size() / confirm_seconds;
+            vector<int64_t> sorted = _latencies;
+            std::sort( sorted.begin(), sorted.end() );
+            auto percentile = [&sorted]( double p ) {
+               return sorted[ size_t( p * ( sorted.size() - 1 ) ) ] / 1000.0;
+            };
+            fc::mutable_variant_object latency;
+            latency["p50"] = percentile( 0.50 );
+            latency["p90"] = percentile( 0.90 );
+            latency["p99"] = percentile( 0.99 );
+            latency["max"] = sorted.back() / 1000.0;
+            result["confirmation_latency_ms"] = latency;
+         }
+         result["rejections"] = fc::variant( _rejections, 2 );
+         return result;
+      }
+
+   private:
+      void on_confirmation( const variant& confirmation )
+      {
+         const fc::time_point now = fc::time_point::now();
+         const transaction_id_type id = confirmation["id"].as<transaction_id_type>( 1 );
+         std::lock_guard<std::mutex> guard( _mutex );
+         auto itr = _push_times.find( id );
+         if( itr == _push_times.end() )
+            return;
+         _latencies.push_back( ( now - itr->second ).count() );
+         _last_confirmation = now;
+         _push_times.erase( itr );
+      }
+
+      fc::api<network_broadcast_api>                _net;
+      mutable std::mutex                            _mutex;
+      std::map<transaction_id_type,fc::time_point>  _push_times;
+      vector<int64_t>                               _latencies;
+      fc::time_point                                _last_confirmation;
+      uint64_t                                      _accepted = 0;
+      uint64_t                                      _rejected = 0;
+      std::map<string,uint64_t>                     _rejections;
+};
+
+/// Signs the transactions over one fc::thread per signing thread, like wallet_api::sign_bulk_operations does
+void sign_transactions( vector<loadgen_transaction>& txs, const chain_id_type& chain_id, size_t thread_count )
+{
+   thread_count = std::max<size_t>( std::min( thread_count, txs.size() ), 1 );
+   std::vector< std::unique_ptr<fc::thread> > threads;
+   std::vector< fc::future<void> > signing;
+   for( size_t t = 0; t < thread_count; ++t )
+   {
+      threads.emplace_back( new fc::thread( "loadgen_signing" ) );
+      signing.push_back( threads.back()->async( [t,thread_count,&chain_id,&txs]() {
+         for( size_t i = t; i < txs.size(); i += thread_count )
+            for( const fc::ecc::private_key* key : txs[i].keys )
+               txs[i].trx.sign( *key, chain_id );
+      }, "sign_transactions" ) );
+   }
+   for( auto& f : signing )
+      f.wait();
+   for( auto& thread : threads )
+      thread->quit();
+}
+
+/// Pushes setup transactions back to back and waits for all of them to be in a block
+void push_and_wait( fc::api<network_broadcast_api> net, const vector<loadgen_transaction>& txs, uint32_t timeout_seconds )
+{
+   push_tracker tracker( net );
+   for( const auto& tx : txs )
+      tracker.push( tx.trx );
+   tracker.wait_confirmations( fc::seconds( timeout_seconds ) );
+   const auto report = tracker.report( fc::time_point::now(), fc::time_point::now() );
+   FC_ASSERT( report["rejected"].as_uint64() == 0 && tracker.pending() == 0,
+              "Setup transactions failed: ${r}", ("r", report) );
+}
+
+/// Parses "post=3,score=2,reward=2,transfer=3" into per-type weights
+std::map<string,uint32_t> parse_mix( const string& mix )
+{
+   std::map<string,uint32_t> weights{ {"post",0}, {"score",0}, {"reward",0}, {"transfer",0} };
+   vector<string> items;
+   boost::split( items, mix, boost::is_any_of( "," ) );
+   for( const string& item : items )
+   {
+      vector<string> kv;
+      boost::split( kv, item, boost::is_any_of( "=" ) );
+      FC_ASSERT( kv.size() == 2 && weights.count( kv[0] ), "Invalid mix item ${i}", ("i", item) );
+      weights[kv[0]] = fc::to_uint64( kv[1] );
+   }
+   return weights;
+}
+
+int main( int argc, char** argv )
+{
+   try {
+      bpo::options_description opts;
+      opts.add_options()
+         ("help,h", "Print this help message and exit.")
+         ("server-rpc-endpoint,s", bpo::value<string>()->default_value("ws://127.0.0.1:8090"), "Server websocket RPC endpoint")
+         ("server-rpc-user,u", bpo::value<string>()->default_value(""), "Server Username")
+         ("server-rpc-password,p", bpo::value<string>()->default_value(""), "Server Password")
+         ("registrar-uid", bpo::value<account_uid_type>(), "Account that registers and funds the generated accounts")
+         ("registrar-wif", bpo::value<string>(), "Active private key of the registrar in WIF format")
+         ("platform-uid", bpo::value<account_uid_type>(), "Platform the posts are made on, required for posts, scores and rewards")
+         ("platform-wif", bpo::value<string>(), "Secondary private key of the platform in WIF format")
+         ("seed", bpo::value<uint64_t>()->default_value(1), "Seed of the accounts, keys and operations generated")
+         ("accounts", bpo::value<uint32_t>()->default_value(100), "Number of accounts the load is spread over")
+         ("uid-base", bpo::value<uint64_t>()->default_value(900000000), "Uids of the generated accounts start at calc_account_uid(uid-base + seed * accounts)")
+         ("initial-balance", bpo::value<int64_t>()->default_value(1000), "Core asset given to each new account, in whole units")
+         ("mix", bpo::value<string>()->default_value("post=3,score=2,reward=2,transfer=3"), "Relative weights of the generated operations")
+         ("score-csaf", bpo::value<int64_t>()->default_value(1), "Coin-seconds spent by each score, the scoring accounts need to have earned them")
+         ("tps", bpo::value<double>()->default_value(100), "Transactions pushed per second")
+         ("duration", bpo::value<uint32_t>()->default_value(60), "Seconds of load, the pool holds tps * duration transactions")
+         ("max-in-flight", bpo::value<uint32_t>()->default_value(1000), "Maximum number of pushes waiting for the node to answer")
+         ("expiration", bpo::value<uint32_t>()->default_value(3600), "Seconds until the pre-signed transactions expire, capped by the chain parameters")
+         ("signing-threads", bpo::value<uint32_t>()->default_value(std::max(1u, std::thread::hardware_concurrency())), "Threads signing the transaction pool")
+         ("confirm-timeout", bpo::value<uint32_t>()->default_value(30), "Seconds to keep waiting for confirmations when none arrives")
+         ;
+
+      bpo::variables_map options;
+      bpo::store( bpo::parse_command_line( argc, argv, opts ), options );
+
+      if( options.count("help") )
+      {
+         std::cout << opts << "\n";
+         return 0;
+      }
+      FC_ASSERT( options.count("registrar-uid") && options.count("registrar-wif"), "--registrar-uid and --registrar-wif are required" );
+      FC_ASSERT( options.count("platform-uid") == options.count("platform-wif"), "--platform-uid and --platform-wif go together" );
+
+      const uint64_t seed = options["seed"].as<uint64_t>();
+      const uint32_t account_count = options["accounts"].as<uint32_t>();
+      const double tps = options["tps"].as<double>();
+      const uint32_t max_in_flight = std::max( 1u, options["max-in-flight"].as<uint32_t>() );
+      const uint32_t confirm_timeout = options["confirm-timeout"].as<uint32_t>();
+      FC_ASSERT( account_count >= 2, "At least 2 accounts are needed" );
+      FC_ASSERT( tps > 0, "--tps should be positive" );
+
+      auto weights = parse_mix( options["mix"].as<string>() );
+      const account_uid_type registrar = options["registrar-uid"].as<account_uid_type>();
+      const fc::optional<fc::ecc::private_key> registrar_key = wif_to_key( options["registrar-wif"].as<string>() );
+      FC_ASSERT( registrar_key.valid(), "Invalid registrar private key" );
+      fc::optional<account_uid_type> platform;
+      fc::optional<fc::ecc::private_key> platform_key;
+      if( options.count("platform-uid") )
+      {
+         platform = options["platform-uid"].as<account_uid_type>();
+         platform_key = wif_to_key( options["platform-wif"].as<string>() );
+         FC_ASSERT( platform_key.valid(), "Invalid platform private key" );
+      }
+      else
+      {
+         FC_ASSERT( weights["post"] == 0 && weights["score"] == 0 && weights["reward"] == 0,
+                    "Posts, scores and rewards need --platform-uid" );
+      }
+      FC_ASSERT( weights["transfer"] > 0 || weights["post"] > 0, "The mix should contain posts or transfers" );
+
+      fc::http::websocket_client client;
+      auto con = client.connect( options["server-rpc-endpoint"].as<string>() );
+      auto apic = std::make_shared<fc::rpc::websocket_api_connection>( *con, GRAPHENE_MAX_NESTED_OBJECTS );
+      auto remote_api = apic->get_remote_api< login_api >( 1 );
+      FC_ASSERT( remote_api->login( options["server-rpc-user"].as<string>(), options["server-rpc-password"].as<string>() ),
+                 "Failed to log in to API server" );
+      fc::api<database_api> db = remote_api->database();
+      fc::api<network_broadcast_api> net = remote_api->network_broadcast();
+
+      const chain_id_type chain_id = db->get_chain_id();
+      const chain_parameters params = db->get_global_properties().parameters;
+      const uint32_t signing_threads = options["signing-threads"].as<uint32_t>();
+
+      auto new_transaction = [&db,&params]( uint32_t expiration ) {
+         const auto dyn_props = db->get_dynamic_global_properties();
+         signed_transaction trx;
+         trx.set_reference_block( dyn_props.head_block_id );
+         trx.set_expiration( dyn_props.time + fc::seconds( std::min( expiration, params.maximum_time_until_expiration ) ) );
+         return trx;
+      };
+
+      // the accounts, their keys and uids only depend on the seed
+      vector<loadgen_account> accounts( account_count );
+      vector<account_uid_type> uids;
+      const uint64_t uid_base = options["uid-base"].as<uint64_t>() + seed * account_count;
+      for( uint32_t i = 0; i < account_count; ++i )
+      {
+         auto& a = accounts[i];
+         a.uid = calc_account_uid( uid_base + i );
+         a.name = "loadgen" + fc::to_string( seed ) + "x" + fc::to_string( i );
+         a.key = fc::ecc::private_key::regenerate( fc::sha256::hash( "yoyow_loadgen " + a.name ) );
+         uids.push_back( a.uid );
+      }
+
+      // create the missing accounts, reuse the ones a previous run with the same seed created
+      vector<loadgen_transaction> setup;
+      vector<size_t> created;
+      const auto existing = db->get_accounts_by_uid( uids );
+      for( uint32_t i = 0; i < account_count; ++i )
+      {
+         auto& a = accounts[i];
+         const public_key_type pub_key = a.key.get_public_key();
+         if( existing[i].valid() )
+         {
+            FC_ASSERT( existing[i]->active.key_auths.count( pub_key ) > 0,
+                       "Account ${u} exists but was not created by this seed, choose another --uid-base", ("u", a.uid) );
+            a.next_post_pid = db->get_account_statistics_by_uid( a.uid ).last_post_sequence + 1;
+            continue;
+         }
+         account_create_operation create_op;
+         create_op.uid = a.uid;
+         create_op.name = a.name;
+         create_op.owner = authority( 1, pub_key, 1 );
+         create_op.active = authority( 1, pub_key, 1 );
+         create_op.secondary = authority( 1, pub_key, 1 );
+         create_op.memo_key = pub_key;
+         create_op.reg_info.registrar = registrar;
+         create_op.reg_info.referrer = registrar;
+
+         transfer_operation fund_op;
+         fund_op.from = registrar;
+         fund_op.to = a.uid;
+         fund_op.amount = asset( options["initial-balance"].as<int64_t>() * GRAPHENE_BLOCKCHAIN_PRECISION );
+
+         loadgen_transaction tx;
+         tx.trx = new_transaction( 120 );
+         tx.trx.operations.push_back( create_op );
+         tx.trx.operations.push_back( fund_op );
+         for( auto& op : tx.trx.operations )
+            params.current_fees->set_fee( op );
+         tx.trx.validate();
+         tx.keys.push_back( &*registrar_key );
+         setup.push_back( std::move( tx ) );
+         created.push_back( i );
+      }
+      if( !setup.empty() )
+      {
+         ilog( "Creating ${n} accounts", ("n", setup.size()) );
+         sign_transactions( setup, chain_id, signing_threads );
+         push_and_wait( net, setup, confirm_timeout );
+         setup.clear();
+      }
+      if( platform.valid() && !created.empty() )
+      {
+         for( size_t i : created )
+         {
+            account_auth_platform_operation auth_op;
+            auth_op.uid = accounts[i].uid;
+            auth_op.platform = *platform;
+            loadgen_transaction tx;
+            tx.trx = new_transaction( 120 );
+            tx.trx.operations.push_back( auth_op );
+            params.current_fees->set_fee( tx.trx.operations.back() );
+            tx.trx.validate();
+            tx.keys.push_back( &accounts[i].key );
+            setup.push_back( std::move( tx ) );
+         }
+         ilog( "Authorizing platform ${p} for ${n} accounts", ("p", *platform)("n", setup.size()) );
+         sign_transactions( setup, chain_id, signing_threads );
+         push_and_wait( net, setup, confirm_timeout );
+         setup.clear();
+      }
+
+      // generate the whole pool before pushing, std::mt19937_64 gives the same sequence everywhere
+      const size_t pool_size = size_t( tps * options["duration"].as<uint32_t>() );
+      FC_ASSERT( pool_size > 0, "Nothing to push" );
+      std::mt19937_64 rng( seed );
+      const uint32_t total_weight = weights["post"] + weights["score"] + weights["reward"] + weights["transfer"];
+      const share_type score_csaf = options["score-csaf"].as<int64_t>();
+      const uint32_t expiration = options["expiration"].as<uint32_t>();
+      const signed_transaction reference = new_transaction( expiration );
+      vector<loadgen_post> posts;
+      uint64_t score_counter = 0;
+      vector<loadgen_transaction> pool( pool_size );
+      for( size_t n = 0; n < pool_size; ++n )
+      {
+         loadgen_transaction& tx = pool[n];
+         tx.trx = reference;
+         uint64_t pick = rng() % total_weight;
+         string type;
+         for( const auto& w : weights )
+         {
+            if( pick < w.second ) { type = w.first; break; }
+            pick -= w.second;
+         }
+         // scores and rewards need an earlier post, every (scorer, post) pair is used at most once
+         if( ( type == "score" || type == "reward" ) && posts.empty() )
+            type = weights["post"] > 0 ? "post" : "transfer";
+         if( type == "score" && score_counter >= posts.size() * ( account_count - 1 ) )
+            type = weights["post"] > 0 ? "post" : "transfer";
+
+         if( type == "post" )
+         {
+            loadgen_account& poster = accounts[ rng() % account_count ];
+            post_operation op;
+            op.post_pid = poster.next_post_pid++;
+            op.platform = *platform;
+            op.poster = poster.uid;
+            op.hash_value = fc::sha256::hash( fc::to_string( poster.uid ) + "/" + fc::to_string( op.post_pid ) ).str();
+            op.title = "loadgen " + fc::to_string( n );
+            op.body = "post " + fc::to_string( op.post_pid ) + " of " + poster.name;
+            tx.trx.operations.push_back( op );
+            tx.keys.push_back( &poster.key );
+            tx.keys.push_back( &*platform_key );
+            posts.push_back( { poster.uid, op.post_pid } );
+         }
+         else if( type == "score" )
+         {
+            const loadgen_post& post = posts[ score_counter / ( account_count - 1 ) ];
+            size_t scorer = score_counter % ( account_count - 1 );
+            if( accounts[scorer].uid == post.poster )
+               scorer = account_count - 1;
+            ++score_counter;
+            score_create_operation op;
+            op.from_account_uid = accounts[scorer].uid;
+            op.platform = *platform;
+            op.poster = post.poster;
+            op.post_pid = post.post_pid;
+            op.score = int8_t( rng() % 11 ) - 5;
+            op.csaf = score_csaf;
+            tx.trx.operations.push_back( op );
+            tx.keys.push_back( &accounts[scorer].key );
+         }
+         else if( type == "reward" )
+         {
+            const loadgen_post& post = posts[ rng() % posts.size() ];
+            const loadgen_account& from = accounts[ rng() % account_count ];
+            reward_operation op;
+            op.from_account_uid = from.uid;
+            op.platform = *platform;
+            op.poster = post.poster;
+            op.post_pid = post.post_pid;
+            // the amount includes the pool index so no two transactions have the same id
+            op.amount = asset( 1 + n );
+            tx.trx.operations.push_back( op );
+            tx.keys.push_back( &from.key );
+         }
+         else
+         {
+            const size_t from = rng() % account_count;
+            const size_t to = ( from + 1 + rng() % ( account_count - 1 ) ) % account_count;
+            transfer_operation op;
+            op.from = accounts[from].uid;
+            op.to = accounts[to].uid;
+            op.amount = asset( 1 + n );
+            tx.trx.operations.push_back( op );
+            tx.keys.push_back( &accounts[from].key );
+         }
+         params.current_fees->set_fee( tx.trx.operations.back() );
+         tx.trx.validate();
+      }
+
+      fc::time_point sign_start = fc::time_point::now();
+      sign_transactions( pool, chain_id, signing_threads );
+      ilog( "Signed ${n} transactions in ${t} ms", ("n", pool.size())("t", ( fc::time_point::now() - sign_start ).count() / 1000) );
+
+      // each push runs in its own task so the round trips overlap, the n-th push is not sent before start + n / tps
+      push_tracker tracker( net );
+      std::deque< fc::future<void> > in_flight;
+      const fc::time_point start = fc::time_point::now();
+      for( size_t n = 0; n < pool.size(); ++n )
+      {
+         const fc::time_point due = start + fc::microseconds( int64_t( n * 1000000.0 / tps ) );
+         const fc::time_point now = fc::time_point::now();
+         if( now < due )
+            fc::usleep( due - now );
+         while( !in_flight.empty() && ( in_flight.size() >= max_in_flight || in_flight.front().ready() ) )
+         {
+            in_flight.front().wait();
+            in_flight.pop_front();
+         }
+         const signed_transaction* trx = &pool[n].trx;
+         in_flight.push_back( fc::async( [&tracker,trx]() { tracker.push( *trx ); }, "loadgen_push" ) );
+      }
+      for( auto& f : in_flight )
+         f.wait();
+      const fc::time_point pushed = fc::time_point::now();
+      ilog( "Pushed ${n} transactions, waiting for confirmations", ("n", pool.size()) );
+      tracker.wait_confirmations( fc::seconds( confirm_timeout ) );
+
+      fc::mutable_variant_object report = tracker.report( start, pushed );
+      report["seed"] = seed;
+      report["target_tps"] = tps;
+      report["transactions"] = pool.size();
+      std::cout << fc::json::to_pretty_string( fc::variant( report ) ) << "\n";
+      return 0;
+   } catch( const fc::exception& e ) {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+}
@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #include <graphene/app/application.hpp>
+#include <graphene/chain/block_database.hpp>
 
 #include <graphene/witness/witness.hpp>
 #include <graphene/account_history/account_history_plugin.hpp>
@@ -179,6 +180,9 @@ int main(int argc, char** argv) {
             ("help,h", "Print this help message and exit.")
             ("data-dir,d", bpo::value<boost::filesystem::path>()->default_value("yoyow_node_data_dir"), "Directory containing databases, configuration file, etc.")
             ("version,v", "Display version information")
+            ("export-blocks", bpo::value<boost::filesystem::path>(), "Copy the stored blocks to a block database in this directory without unpacking them, then exit")
+            ("export-blocks-from", bpo::value<uint32_t>()->default_value(1), "First block to export")
+            ("export-blocks-to", bpo::value<uint32_t>()->default_value(0), "Last block to export, 0 for the last stored block")
             ;
 
       bpo::variables_map options;
@@ -223,6 +227,34 @@ int main(int argc, char** argv) {
             data_dir = fc::current_path() / data_dir;
       }
 
+      if( options.count("export-blocks") )
+      {
+         // the blocks are read straight from the block database, the chain state isn't loaded
+         chain::block_database blocks;
+         blocks.open( data_dir / "blockchain" / "database" / "block_num_to_block" );
+         fc::optional<chain::block_id_type> last_id = blocks.last_id();
+         if( !last_id.valid() )
+         {
+            std::cerr << "No blocks stored in " << data_dir.generic_string() << "\n";
+            return 1;
+         }
+         const uint32_t first = options["export-blocks-from"].as<uint32_t>();
+         uint32_t last = chain::block_header::num_from_id( *last_id );
+         if( options["export-blocks-to"].as<uint32_t>() != 0 )
+            last = std::min( last, options["export-blocks-to"].as<uint32_t>() );
+         if( first > last )
+         {
+            std::cerr << "Nothing to export, the last stored block is " << last << "\n";
+            return 1;
+         }
+         const fc::path export_dir = options["export-blocks"].as<boost::filesystem::path>();
+         const uint32_t exported = blocks.export_range( first, last, export_dir );
+         blocks.close();
+         std::cout << "Exported " << exported << " blocks from " << first << " to " << last
+                   << " to " << export_dir.generic_string() << "\n";
+         return 0;
+      }
+
       fc::path config_ini_path = data_dir / "config.ini";
       if( !fc::exists(config_ini_path) )
          create_new_config_file( config_ini_path, data_dir, cfg_options );
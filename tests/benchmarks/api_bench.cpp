@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Latency of the database_api methods the wallets and front ends call most.
+ *
+ * Each method is called API_BENCH_CALLS times in a row with arguments drawn from the objects of the state, the
+ * ones at the front of each sample being drawn more often, and one machine readable line is printed per method:
+ *
+ *   API_BENCH {"method":"get_full_accounts_by_uid","calls":10000,"p50_us":...,"p99_us":...,"max_us":...}
+ *
+ * The run is configured by environment variables:
+ *
+ *   API_BENCH_DATA_DIR  data directory of a node to load instead of building a synthetic state; open a copy, the
+ *                       directory is written to when it's closed. Plugin indexes aren't loaded.
+ *   API_BENCH_ACCOUNTS  number of extra accounts of the synthetic state, default 10000
+ *   API_BENCH_POSTS     number of posts of the synthetic state, default 10000
+ *   API_BENCH_CALLS     number of calls per method, default 10000
+ *
+ * e.g. API_BENCH_DATA_DIR=/tmp/node_copy ./chain_bench --run_test=api_bench
+ */
+
+#include <graphene/app/database_api.hpp>
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/content_object.hpp>
+
+#include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <functional>
+#include <iostream>
+#include <random>
+
+#include "../common/database_fixture.hpp"
+#include "bench_common.hpp"
+
+using namespace graphene::chain;
+using graphene::chain::bench::bench_param;
+using graphene::chain::bench::latency_percentile;
+
+namespace {
+
+struct api_bench_post
+{
+   account_uid_type platform;
+   account_uid_type poster;
+   post_pid_type    post_pid;
+};
+
+/// arguments of the calls, gathered from the state
+struct api_bench_samples
+{
+   vector<account_uid_type> uids;
+   vector<string>           names;
+   vector<public_key_type>  keys;
+   vector<api_bench_post>   posts;
+   vector<string>           symbols;
+   uint32_t                 head_block_num = 0;
+
+   void gather( const database& db, size_t limit )
+   {
+      for( const auto& a : db.get_index_type<account_index>().indices().get<by_id>() )
+      {
+         if( uids.size() >= limit )
+            break;
+         uids.push_back( a.uid );
+         names.push_back( a.name );
+         if( !a.active.key_auths.empty() )
+            keys.push_back( a.active.key_auths.begin()->first );
+      }
+      for( const auto& p : db.get_index_type<post_index>().indices().get<by_id>() )
+      {
+         if( posts.size() >= limit )
+            break;
+         posts.push_back( { p.platform, p.poster, p.post_pid } );
+      }
+      for( const auto& a : db.get_index_type<asset_index>().indices().get<by_id>() )
+         if( a.asset_id != GRAPHENE_CORE_ASSET_AID )
+            symbols.push_back( a.symbol );
+      head_block_num = db.head_block_num();
+   }
+};
+
+} // anonymous namespace
+
+struct api_bench_fixture : database_fixture
+{
+   api_bench_fixture()
+   : calls( bench_param( "API_BENCH_CALLS", 10000 ) ),
+     rng( 1 ),
+     prec( asset::scaled_precision( asset_id_type()(db).precision ) )
+   {}
+
+   /// an index below n, the low ones more likely, like popular accounts and recent posts are
+   size_t skewed( size_t n )
+   {
+      const double u = std::uniform_real_distribution<double>( 0, 1 )( rng );
+      return std::min( n - 1, size_t( u * u * n ) );
+   }
+
+   void bench( const string& method, std::function<void()> call )
+   {
+      vector<int64_t> latencies;
+      latencies.reserve( calls );
+      for( uint32_t i = 0; i < calls; ++i )
+      {
+         auto start = fc::time_point::now();
+         call();
+         latencies.push_back( ( fc::time_point::now() - start ).count() );
+      }
+      std::sort( latencies.begin(), latencies.end() );
+      fc::mutable_variant_object result;
+      result( "method", method )
+            ( "calls", calls )
+            ( "p50_us", latency_percentile( latencies, 0.50 ) )
+            ( "p99_us", latency_percentile( latencies, 0.99 ) )
+            ( "max_us", latencies.back() );
+      std::cout << "API_BENCH " << fc::json::to_string( result ) << std::endl;
+      wlog( "${m}: p50 ${p50}us, p99 ${p99}us",
+            ("m",method)("p50",latency_percentile( latencies, 0.50 ))("p99",latency_percentile( latencies, 0.99 )) );
+   }
+
+   signed_transaction make_trx( const operation& op, const flat_set<fc::ecc::private_key>& sign_keys )
+   {
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      set_operation_fees( tx, db.current_fee_schedule() );
+      test::set_expiration( db, tx );
+      tx.validate();
+      for( const auto& key : sign_keys )
+         sign( tx, key );
+      return tx;
+   }
+
+   void push_in_blocks( const vector<signed_transaction>& trxs )
+   {
+      for( size_t i = 0; i < trxs.size(); ++i )
+      {
+         db.push_transaction( trxs[i], ~0 );
+         if( i % 100 == 99 )
+            generate_block();
+      }
+      generate_block();
+   }
+
+   /// accounts, posters on a platform with posts and scores, and an asset with an order book
+   void build_state()
+   {
+      const uint32_t accounts = bench_param( "API_BENCH_ACCOUNTS", 10000 );
+      const uint32_t posts = bench_param( "API_BENCH_POSTS", 10000 );
+      flat_map<account_uid_type, fc::ecc::private_key> account_map;
+      actor( 100000, accounts, account_map );
+      for( const auto& item : account_map )
+         add_csaf_for_account( item.first, 1000 );
+
+      ACTORS((1000)(1001)(1002)(1003)(9000));
+      const vector<account_uid_type> posters = { u_1000_id, u_1001_id, u_1002_id, u_1003_id };
+      const vector<fc::ecc::private_key> poster_keys = { u_1000_private_key, u_1001_private_key,
+                                                         u_1002_private_key, u_1003_private_key };
+      transfer( committee_account, u_9000_id, asset( 100000 * prec ) );
+      add_csaf_for_account( u_9000_id, 10000000 );
+      create_platform( u_9000_id, "platform", asset( 10000 * prec ), "www.123456789.com", "", { u_9000_private_key } );
+      for( size_t i = 0; i < posters.size(); ++i )
+      {
+         transfer( committee_account, posters[i], asset( 100000 * prec ) );
+         add_csaf_for_account( posters[i], 10000000 );
+         account_auth_platform( { poster_keys[i] }, posters[i], u_9000_id, 1000 * prec );
+      }
+      generate_block();
+
+      vector<signed_transaction> trxs;
+      vector<post_pid_type> next_pid;
+      for( const auto uid : posters )
+         next_pid.push_back( db.get_account_statistics_by_uid( uid ).last_post_sequence + 1 );
+      for( uint32_t i = 0; i < posts; ++i )
+      {
+         const size_t p = i % posters.size();
+         post_operation op;
+         op.post_pid = next_pid[p]++;
+         op.platform = u_9000_id;
+         op.poster = posters[p];
+         op.hash_value = fc::to_string( i );
+         op.title = "post title " + fc::to_string( i );
+         op.body = "post body " + fc::to_string( i );
+         trxs.push_back( make_trx( op, { poster_keys[p], u_9000_private_key } ) );
+      }
+      push_in_blocks( trxs );
+      trxs.clear();
+
+      // the first posts get a score from each of the accounts
+      auto key_itr = account_map.begin();
+      for( uint32_t i = 0; i < account_map.size() && posts > 0; ++i, ++key_itr )
+      {
+         score_create_operation op;
+         op.from_account_uid = key_itr->first;
+         op.platform = u_9000_id;
+         op.poster = posters[ i % posters.size() ];
+         op.post_pid = 1 + ( i / posters.size() ) % std::max<uint32_t>( 1, posts / posters.size() );
+         op.score = 5;
+         op.csaf = 1;
+         trxs.push_back( make_trx( op, { key_itr->second } ) );
+      }
+      push_in_blocks( trxs );
+      trxs.clear();
+
+      asset_options options;
+      options.max_supply = 100000000 * prec;
+      options.description = "bench asset";
+      create_asset( { u_1000_private_key }, u_1000_id, "BENCH", 5, options, share_type( 100000000 * prec ) );
+      const asset_aid_type bench_aid = db.get_asset_by_aid( 1 ).asset_id;
+      generate_block();
+      const uint32_t expiration = db.head_block_time().sec_since_epoch() + 24 * 3600;
+      for( uint32_t i = 0; i < 1000; ++i )
+      {
+         // sells above 1 YOYO, buys below, so nothing fills
+         limit_order_create_operation op;
+         op.expiration = time_point_sec( expiration );
+         op.fill_or_kill = false;
+         if( i % 2 == 0 )
+         {
+            op.seller = u_1000_id;
+            op.amount_to_sell = asset( prec, bench_aid );
+            op.min_to_receive = asset( prec + share_type( i + 2 ), GRAPHENE_CORE_ASSET_AID );
+            trxs.push_back( make_trx( op, { u_1000_private_key } ) );
+         }
+         else
+         {
+            op.seller = u_1001_id;
+            op.amount_to_sell = asset( prec - share_type( i + 2 ), GRAPHENE_CORE_ASSET_AID );
+            op.min_to_receive = asset( prec, bench_aid );
+            trxs.push_back( make_trx( op, { u_1001_private_key } ) );
+         }
+      }
+      push_in_blocks( trxs );
+   }
+
+   const uint32_t     calls;
+   std::mt19937_64    rng;
+   const share_type   prec;
+};
+
+BOOST_FIXTURE_TEST_CASE( api_bench, api_bench_fixture )
+{
+   try {
+      const char* data_dir_env = std::getenv( "API_BENCH_DATA_DIR" );
+      std::unique_ptr<database> snapshot;
+      if( data_dir_env != nullptr )
+      {
+         const fc::path dir( data_dir_env );
+         std::string version;
+         fc::read_file_contents( dir / "db_version", version );
+         snapshot.reset( new database );
+         snapshot->open( dir, []() -> genesis_state_type {
+            FC_THROW( "API_BENCH_DATA_DIR doesn't contain a state" );
+         }, version );
+      }
+      else
+         build_state();
+      database& state = snapshot ? *snapshot : db;
+
+      api_bench_samples samples;
+      samples.gather( state, 100000 );
+      BOOST_REQUIRE( !samples.uids.empty() );
+      graphene::app::database_api api( state, &app.get_options() );
+
+      graphene::app::full_account_query_options all;
+      all.fetch_account_object = true;
+      all.fetch_statistics = true;
+      all.fetch_csaf_leases_in = true;
+      all.fetch_csaf_leases_out = true;
+      all.fetch_voter_object = true;
+      all.fetch_witness_object = true;
+      all.fetch_witness_votes = true;
+      all.fetch_committee_member_object = true;
+      all.fetch_committee_member_votes = true;
+      all.fetch_platform_object = true;
+      all.fetch_platform_votes = true;
+      all.fetch_assets = true;
+      all.fetch_balances = true;
+      all.fetch_pledges = true;
+
+      bench( "get_full_accounts_by_uid", [&]() {
+         api.get_full_accounts_by_uid( { samples.uids[ skewed( samples.uids.size() ) ] }, all );
+      });
+      bench( "get_accounts_by_uid", [&]() {
+         vector<account_uid_type> uids;
+         for( int i = 0; i < 10; ++i )
+            uids.push_back( samples.uids[ skewed( samples.uids.size() ) ] );
+         api.get_accounts_by_uid( uids );
+      });
+      bench( "lookup_accounts_by_name", [&]() {
+         const string& name = samples.names[ skewed( samples.names.size() ) ];
+         api.lookup_accounts_by_name( name.substr( 0, std::min<size_t>( 3, name.size() ) ), 100 );
+      });
+      if( !samples.keys.empty() )
+      {
+         bench( "get_key_references", [&]() {
+            api.get_key_references( { samples.keys[ skewed( samples.keys.size() ) ] } );
+         });
+      }
+      bench( "get_account_balances", [&]() {
+         api.get_account_balances( samples.uids[ skewed( samples.uids.size() ) ], flat_set<asset_aid_type>() );
+      });
+      if( !samples.posts.empty() )
+      {
+         // the newest posts are the most read
+         auto recent_post = [&]() -> const api_bench_post& {
+            return samples.posts[ samples.posts.size() - 1 - skewed( samples.posts.size() ) ];
+         };
+         bench( "get_post", [&]() {
+            const auto& p = recent_post();
+            api.get_post( p.platform, p.poster, p.post_pid );
+         });
+         bench( "get_posts_by_platform_poster", [&]() {
+            const auto& p = recent_post();
+            api.get_posts_by_platform_poster( p.platform, p.poster, object_id_type(), 100 );
+         });
+         bench( "get_posts_by_platform", [&]() {
+            const auto& p = recent_post();
+            api.get_posts_by_platform_poster( p.platform, optional<account_uid_type>(), object_id_type(), 100 );
+         });
+         bench( "list_scores", [&]() {
+            const auto& p = samples.posts[ skewed( samples.posts.size() ) ];
+            api.list_scores( p.platform, p.poster, p.post_pid, object_id_type(), 100, false );
+         });
+      }
+      if( !samples.symbols.empty() )
+      {
+         const string core_symbol = state.get_core_asset().symbol;
+         bench( "get_order_book", [&]() {
+            api.get_order_book( samples.symbols[ skewed( samples.symbols.size() ) ], core_symbol, 50 );
+         });
+      }
+      bench( "get_block", [&]() {
+         api.get_block( samples.head_block_num - skewed( samples.head_block_num ) );
+      });
+
+      if( snapshot )
+         snapshot->close();
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
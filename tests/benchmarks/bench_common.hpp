@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace graphene { namespace chain { namespace bench {
+
+/// reads a positive integer from the environment variable @p name, @p default_value if it isn't set or not positive
+inline uint32_t bench_param( const char* name, uint32_t default_value )
+{
+   const char* value = std::getenv( name );
+   if( value == nullptr )
+      return default_value;
+   uint32_t parsed = std::strtoul( value, nullptr, 10 );
+   return parsed > 0 ? parsed : default_value;
+}
+
+/// the @p p quantile of the @p sorted latencies, 0 if there are none
+inline int64_t latency_percentile( const std::vector<int64_t>& sorted, double p )
+{
+   if( sorted.empty() )
+      return 0;
+   size_t idx = std::min( sorted.size() - 1, size_t( p * ( sorted.size() - 1 ) + 0.5 ) );
+   return sorted[idx];
+}
+
+} } } // graphene::chain::bench
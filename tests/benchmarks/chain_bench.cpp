@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Throughput and latency of the block apply hot paths.
+ *
+ * Every case prints one machine readable line per run to stdout, e.g.
+ *
+ *   CHAIN_BENCH {"benchmark":"transfer","state_accounts":1000,"ops":1000,"ops_per_sec":...,"p50_us":...,"p99_us":...}
+ *
+ * so that results can be collected and compared between releases. The run is configured by environment variables:
+ *
+ *   CHAIN_BENCH_ACCOUNTS         number of extra accounts created before measuring (state size), default 1000
+ *   CHAIN_BENCH_OPS              number of operations pushed per case, default 1000
+ *   CHAIN_BENCH_FULL_VALIDATION  if set, push with skip_nothing instead of skipping all optional checks
+ *   CHAIN_BENCH_ACCOUNT_CREATES  number of accounts registered by account_create_bench, default CHAIN_BENCH_OPS
+ *
+ * e.g. CHAIN_BENCH_ACCOUNTS=100000 ./chain_bench --run_test=chain_bench/transfer_bench
+ *      CHAIN_BENCH_ACCOUNT_CREATES=1000000 ./chain_bench --run_test=chain_bench/account_create_bench
+ */
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/content_object.hpp>
+
+#include <fc/io/json.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+
+#include "../common/database_fixture.hpp"
+#include "bench_common.hpp"
+
+using namespace graphene::chain;
+
+namespace {
+
+using graphene::chain::bench::bench_param;
+
+/// collects the latency of every operation of one benchmark and reports the summary
+struct bench_recorder
+{
+   explicit bench_recorder( const string& benchmark ):name(benchmark){}
+
+   void record( const fc::microseconds& latency )
+   {
+      latencies.push_back( latency.count() );
+      total += latency.count();
+   }
+
+   static int64_t percentile( const vector<int64_t>& sorted, double p )
+   {
+      return graphene::chain::bench::latency_percentile( sorted, p );
+   }
+
+   void report( uint32_t state_accounts )const
+   {
+      vector<int64_t> sorted = latencies;
+      std::sort( sorted.begin(), sorted.end() );
+      const double ops_per_sec = total > 0 ? double( sorted.size() ) * 1000000.0 / total : 0;
+
+      fc::mutable_variant_object result;
+      result( "benchmark", name )
+            ( "state_accounts", state_accounts )
+            ( "ops", uint64_t( sorted.size() ) )
+            ( "ops_per_sec", ops_per_sec )
+            ( "p50_us", percentile( sorted, 0.50 ) )
+            ( "p99_us", percentile( sorted, 0.99 ) )
+            ( "max_us", sorted.empty() ? 0 : sorted.back() );
+      std::cout << "CHAIN_BENCH " << fc::json::to_string( result ) << std::endl;
+      wlog( "${name}: ${ops} ops, ${aps} ops/s, p50 ${p50}us, p99 ${p99}us",
+            ("name",name)("ops",sorted.size())("aps",uint64_t(ops_per_sec))
+            ("p50",percentile( sorted, 0.50 ))("p99",percentile( sorted, 0.99 )) );
+   }
+
+   string          name;
+   vector<int64_t> latencies;
+   int64_t         total = 0;
+};
+
+} // anonymous namespace
+
+struct chain_bench_fixture : database_fixture
+{
+   chain_bench_fixture()
+   : state_accounts( bench_param( "CHAIN_BENCH_ACCOUNTS", 1000 ) ),
+     ops( bench_param( "CHAIN_BENCH_OPS", 1000 ) ),
+     skip( std::getenv( "CHAIN_BENCH_FULL_VALIDATION" ) != nullptr ? uint32_t( database::skip_nothing ) : ~uint32_t(0) ),
+     prec( asset::scaled_precision( asset_id_type()(db).precision ) )
+   {
+      flat_map<account_uid_type, fc::ecc::private_key> account_map;
+      actor( 100000, state_accounts, account_map );
+      for( const auto& item : account_map )
+      {
+         uids.push_back( item.first );
+         keys.push_back( item.second );
+      }
+      generate_block();
+   }
+
+   asset core( int64_t x )const { return asset( x * prec ); }
+
+   signed_transaction make_trx( const operation& op, const flat_set<fc::ecc::private_key>& sign_keys )
+   {
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      set_operation_fees( tx, db.current_fee_schedule() );
+      test::set_expiration( db, tx );
+      tx.validate();
+      for( const auto& key : sign_keys )
+         sign( tx, key );
+      return tx;
+   }
+
+   /**
+    * Pushes @p count transactions built by @p make, timing each push only. The transactions are built and
+    * signed in batches of one block, and a block is generated after each batch.
+    */
+   void run( bench_recorder& rec, uint32_t count, std::function<signed_transaction(uint32_t)> make )
+   {
+      const uint32_t per_block = 100;
+      rec.latencies.reserve( count );
+      for( uint32_t i = 0; i < count; )
+      {
+         vector<signed_transaction> batch;
+         for( uint32_t n = 0; n < per_block && i + n < count; ++n )
+            batch.push_back( make( i + n ) );
+         for( const auto& trx : batch )
+         {
+            auto start = fc::time_point::now();
+            db.push_transaction( trx, skip );
+            rec.record( fc::time_point::now() - start );
+         }
+         i += batch.size();
+         generate_block();
+      }
+   }
+
+   /// fund every state account with @p amount core from the committee account
+   void fund_state_accounts( const asset& amount )
+   {
+      for( const auto uid : uids )
+         transfer( committee_account, uid, amount );
+      generate_block();
+   }
+
+   const uint32_t                 state_accounts;
+   const uint32_t                 ops;
+   const uint32_t                 skip;
+   const share_type               prec;
+   vector<account_uid_type>       uids;
+   vector<fc::ecc::private_key>   keys;
+};
+
+/// platform u_9000 with a license, poster u_1000 authorized on it, and one post to score and reward
+#define BENCH_PLATFORM_SETUP()                                                                                   \
+   ACTORS((1000)(9000));                                                                                         \
+   transfer( committee_account, u_9000_id, core( 100000 ) );                                                     \
+   transfer( committee_account, u_1000_id, core( 100000 ) );                                                     \
+   add_csaf_for_account( u_9000_id, 100000 );                                                                    \
+   add_csaf_for_account( u_1000_id, 100000 );                                                                    \
+   create_platform( u_9000_id, "platform", core( 10000 ), "www.123456789.com", "", { u_9000_private_key } );     \
+   create_license( u_9000_id, 6, "999999999", "license title", "license body", "extra", { u_9000_private_key } ); \
+   account_auth_platform( { u_1000_private_key }, u_1000_id, u_9000_id, 1000 * prec );                          \
+   post_operation::ext post_exts;                                                                                \
+   post_exts.license_lid = 1;                                                                                    \
+   post_exts.permission_flags = post_object::Post_Permission_Forward |                                           \
+                                post_object::Post_Permission_Liked |                                             \
+                                post_object::Post_Permission_Buyout |                                            \
+                                post_object::Post_Permission_Comment |                                           \
+                                post_object::Post_Permission_Reward;                                             \
+   create_post( { u_1000_private_key, u_9000_private_key }, u_9000_id, u_1000_id, "", "", "", "",                 \
+                optional<account_uid_type>(), optional<account_uid_type>(), optional<post_pid_type>(),            \
+                post_exts );                                                                                     \
+   const post_pid_type bench_post_pid = db.get_account_statistics_by_uid( u_1000_id ).last_post_sequence;        \
+   generate_block();
+
+BOOST_FIXTURE_TEST_SUITE( chain_bench, chain_bench_fixture )
+
+BOOST_AUTO_TEST_CASE( transfer_bench )
+{
+   try {
+      ACTORS((1000));
+      transfer( committee_account, u_1000_id, core( 1000000 ) );
+      generate_block();
+
+      bench_recorder rec( "transfer" );
+      run( rec, ops, [&]( uint32_t i ) -> signed_transaction {
+         transfer_operation op;
+         op.from = u_1000_id;
+         op.to = uids[ i % uids.size() ];
+         op.amount = asset( 1 + i );
+         return make_trx( op, { u_1000_private_key } );
+      });
+      rec.report( state_accounts );
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( post_bench )
+{
+   try {
+      BENCH_PLATFORM_SETUP();
+
+      post_operation op;
+      op.platform = u_9000_id;
+      op.poster = u_1000_id;
+      op.hash_value = "6666666";
+      op.extra_data = "extra";
+      op.title = "document name";
+      op.body = "document body";
+      op.extensions = graphene::chain::extension<post_operation::ext>();
+      op.extensions->value = post_exts;
+
+      bench_recorder rec( "post" );
+      run( rec, ops, [&]( uint32_t i ) -> signed_transaction {
+         op.post_pid = bench_post_pid + i + 1;
+         return make_trx( op, { u_1000_private_key, u_9000_private_key } );
+      });
+      rec.report( state_accounts );
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( score_bench )
+{
+   try {
+      BENCH_PLATFORM_SETUP();
+      for( const auto uid : uids )
+         add_csaf_for_account( uid, 1000 );
+
+      // every account can score a post only once
+      bench_recorder rec( "score" );
+      run( rec, std::min<uint32_t>( ops, uids.size() ), [&]( uint32_t i ) -> signed_transaction {
+         score_create_operation op;
+         op.from_account_uid = uids[i];
+         op.platform = u_9000_id;
+         op.poster = u_1000_id;
+         op.post_pid = bench_post_pid;
+         op.score = 5;
+         op.csaf = 10;
+         return make_trx( op, { keys[i] } );
+      });
+      rec.report( state_accounts );
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( reward_bench )
+{
+   try {
+      BENCH_PLATFORM_SETUP();
+      fund_state_accounts( core( 1000 ) );
+      for( const auto uid : uids )
+         add_csaf_for_account( uid, 1000 );
+
+      bench_recorder rec( "reward" );
+      run( rec, ops, [&]( uint32_t i ) -> signed_transaction {
+         reward_operation op;
+         op.from_account_uid = uids[ i % uids.size() ];
+         op.platform = u_9000_id;
+         op.poster = u_1000_id;
+         op.post_pid = bench_post_pid;
+         op.amount = asset( prec + share_type( i ) );
+         return make_trx( op, { keys[ i % keys.size() ] } );
+      });
+      rec.report( state_accounts );
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( csaf_collect_bench )
+{
+   try {
+      fund_state_accounts( core( 1000 ) );
+      fast_forward_blocks( 3000 ); // let coin seconds accumulate, same as collect_csaf()
+
+      bench_recorder rec( "csaf_collect" );
+      run( rec, ops, [&]( uint32_t i ) -> signed_transaction {
+         csaf_collect_operation op;
+         op.from = uids[ i % uids.size() ];
+         op.to = op.from;
+         op.amount = asset( 1 );
+         op.time = time_point_sec( ( db.head_block_time().sec_since_epoch() / 60 ) * 60 );
+         return make_trx( op, { keys[ i % keys.size() ] } );
+      });
+      rec.report( state_accounts );
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( account_create_bench )
+{
+   try {
+      // a registration burst of a platform, all registered by the same registrar
+      const uint32_t creates = bench_param( "CHAIN_BENCH_ACCOUNT_CREATES", ops );
+      const uint32_t first_seed = 100000 + state_accounts;
+      bench_recorder rec( "account_create" );
+      run( rec, creates, [&]( uint32_t i ) -> signed_transaction {
+         const string name = "bench" + fc::to_string( uint64_t( i ) );
+         const account_create_operation op = make_account( graphene::chain::calc_account_uid( first_seed + i ), name,
+                                                           generate_private_key( name ).get_public_key() );
+         return make_trx( op, { init_account_priv_key } );
+      });
+      rec.report( state_accounts );
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( limit_order_bench )
+{
+   try {
+      ACTORS((1000)(2000));
+      transfer( committee_account, u_1000_id, core( 100000 ) );
+      transfer( committee_account, u_2000_id, core( 1000000 ) );
+      add_csaf_for_account( u_1000_id, 100000 );
+      add_csaf_for_account( u_2000_id, 100000 );
+
+      asset_options options;
+      options.max_supply = 100000000 * prec;
+      options.market_fee_percent = 1 * GRAPHENE_1_PERCENT;
+      options.max_market_fee = 20 * prec;
+      options.issuer_permissions = 15;
+      options.flags = charge_market_fee;
+      options.description = "bench asset";
+      create_asset( { u_1000_private_key }, u_1000_id, "BENCH", 5, options, share_type( 100000000 * prec ) );
+      const asset_aid_type bench_aid = db.get_asset_by_aid( 1 ).asset_id;
+      generate_block();
+
+      // odd orders fill the even order before them, so both order book insertion and matching are measured
+      const uint32_t expiration = db.head_block_time().sec_since_epoch() + 24 * 3600;
+      bench_recorder rec( "limit_order" );
+      run( rec, ops, [&]( uint32_t i ) -> signed_transaction {
+         limit_order_create_operation op;
+         op.expiration = time_point_sec( expiration );
+         op.fill_or_kill = false;
+         if( i % 2 == 0 )
+         {
+            op.seller = u_1000_id;
+            op.amount_to_sell = asset( 10 * prec + share_type( i ), bench_aid );
+            op.min_to_receive = asset( prec, GRAPHENE_CORE_ASSET_AID );
+            return make_trx( op, { u_1000_private_key } );
+         }
+         op.seller = u_2000_id;
+         op.amount_to_sell = asset( prec, GRAPHENE_CORE_ASSET_AID );
+         op.min_to_receive = asset( 10 * prec + share_type( i - 1 ), bench_aid );
+         return make_trx( op, { u_2000_private_key } );
+      });
+      rec.report( state_accounts );
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Propagation of blocks and transactions through a simulated p2p network.
+ *
+ * Every node owns a graphene::net::simulated_network holding its links to its neighbours. A node relays each
+ * block and transaction the first time it receives it, after checking it the way a node does before relaying:
+ * recovering the block signee and merkle root, or the transaction signature keys. Blocks are produced by node 0,
+ * transactions come from nodes picked at random, and every message goes through the latency and bandwidth of
+ * the links it crosses. One machine readable line is printed per item kind, e.g.
+ *
+ *   P2P_BENCH {"topology":"ring","nodes":20,"kind":"block","items":20,"p50_us":...,"p99_us":...,"max_us":...}
+ *
+ * followed by one line with the CPU time the nodes spent checking and relaying. The percentiles of the item
+ * lines are over the delays until every item reached every node but its origin.
+ *
+ * The run is configured by environment variables:
+ *
+ *   P2P_BENCH_TOPOLOGY     ring: every node linked to the degree nearest nodes of a ring, the default;
+ *                          random: every node linked to degree random nodes; star: every node linked to node 0
+ *   P2P_BENCH_NODES        number of nodes, default 20
+ *   P2P_BENCH_DEGREE       links per node of the ring and random topologies, default 4
+ *   P2P_BENCH_LATENCY_MS   latency of every link, default 50
+ *   P2P_BENCH_KBPS         bandwidth of every link in kilobytes per second, default 1000
+ *   P2P_BENCH_BLOCKS       number of blocks produced, default 20
+ *   P2P_BENCH_INTERVAL_MS  time between blocks, default 500
+ *   P2P_BENCH_BLOCK_TRXS   transactions in every block, default 100
+ *   P2P_BENCH_TRXS         transactions sent between two blocks, default 50
+ *
+ * e.g. P2P_BENCH_TOPOLOGY=random P2P_BENCH_NODES=100 ./chain_bench --run_test=p2p_bench
+ */
+
+#include <graphene/chain/protocol/protocol.hpp>
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/node.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/smart_ref_impl.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <set>
+
+#include "bench_common.hpp"
+
+using namespace graphene::chain;
+using graphene::chain::bench::bench_param;
+using graphene::chain::bench::latency_percentile;
+
+namespace {
+
+struct p2p_bench_network;
+
+/// a node checking and relaying what it receives, recording when items reach it and the CPU time it spends
+class bench_node : public graphene::net::node_delegate
+{
+   public:
+      bench_node( p2p_bench_network& network, uint32_t index );
+
+      /// sends @p msg to the neighbours, as the origin of the item
+      void originate( const graphene::net::message& msg );
+      /// sends @p msg to the neighbours
+      void relay( const graphene::net::message& msg );
+
+      bool has_item( const graphene::net::item_id& id ) override { return false; }
+      bool handle_block( const graphene::net::block_message& blk_msg, bool sync_mode,
+                         std::vector<fc::uint160_t>& contained_transaction_message_ids ) override
+      {
+         const fc::time_point start = fc::time_point::now();
+         blk_msg.block.signee();
+         blk_msg.block.calculate_merkle_root();
+         received( graphene::net::message( blk_msg ), start );
+         return false;
+      }
+      void prepare_sync_blocks( const std::vector<const graphene::net::block_message*>& blocks ) override {}
+      void handle_transaction( graphene::net::trx_message&& trx_msg ) override;
+      void handle_message( const graphene::net::message& message_to_process ) override {}
+      std::vector<graphene::net::item_hash_t> get_block_ids( const std::vector<graphene::net::item_hash_t>& synopsis,
+                                                             uint32_t& remaining_item_count,
+                                                             uint32_t limit ) override
+      { return {}; }
+      graphene::net::message get_item( const graphene::net::item_id& id ) override
+      { FC_THROW_EXCEPTION( fc::key_not_found_exception, "no items are served" ); }
+      chain_id_type get_chain_id()const override { return chain_id_type(); }
+      std::vector<graphene::net::item_hash_t> get_blockchain_synopsis( const graphene::net::item_hash_t& reference_point,
+                                                                      uint32_t number_of_blocks_after_reference_point ) override
+      { return {}; }
+      void sync_status( uint32_t item_type, uint32_t item_count ) override {}
+      void connection_count_changed( uint32_t c ) override {}
+      uint32_t get_block_number( const graphene::net::item_hash_t& block_id ) override { return 0; }
+      fc::time_point_sec get_block_time( const graphene::net::item_hash_t& block_id ) override { return fc::time_point_sec(); }
+      graphene::net::item_hash_t get_head_block_id()const override { return graphene::net::item_hash_t(); }
+      uint32_t estimate_last_known_fork_from_git_revision_timestamp( uint32_t unix_timestamp )const override { return 0; }
+      void error_encountered( const std::string& message, const fc::oexception& error ) override {}
+      uint8_t get_current_block_interval_in_seconds()const override { return GRAPHENE_DEFAULT_BLOCK_INTERVAL; }
+
+      int64_t cpu_us = 0;
+
+   private:
+      /// records the arrival of @p msg and relays it, the first time only
+      void received( const graphene::net::message& msg, const fc::time_point& start );
+
+      p2p_bench_network&                  _network;
+      const uint32_t                      _index;
+      std::set<graphene::net::message_hash_type> _seen;
+};
+
+struct p2p_bench_network
+{
+   p2p_bench_network()
+   : topology( std::getenv( "P2P_BENCH_TOPOLOGY" ) != nullptr ? std::getenv( "P2P_BENCH_TOPOLOGY" ) : "ring" ),
+     node_count( std::max( 2u, bench_param( "P2P_BENCH_NODES", 20 ) ) ),
+     degree( std::min( node_count - 1, bench_param( "P2P_BENCH_DEGREE", 4 ) ) ),
+     latency( fc::milliseconds( bench_param( "P2P_BENCH_LATENCY_MS", 50 ) ) ),
+     bytes_per_second( uint64_t( bench_param( "P2P_BENCH_KBPS", 1000 ) ) * 1000 )
+   {
+      for( uint32_t i = 0; i < node_count; ++i )
+      {
+         nodes.emplace_back( new bench_node( *this, i ) );
+         links.emplace_back( new graphene::net::simulated_network( "p2p_bench" ) );
+      }
+
+      std::set< std::pair<uint32_t,uint32_t> > edges;
+      std::mt19937 rng( 42 );
+      for( uint32_t i = 0; i < node_count; ++i )
+      {
+         if( topology == "star" )
+         {
+            if( i > 0 )
+               edges.emplace( 0, i );
+         }
+         else if( topology == "random" )
+         {
+            for( uint32_t d = 0; d < degree; ++d )
+            {
+               uint32_t j = rng() % ( node_count - 1 );
+               j += ( j >= i );
+               edges.emplace( std::min( i, j ), std::max( i, j ) );
+            }
+         }
+         else
+         {
+            BOOST_REQUIRE_MESSAGE( topology == "ring", "unknown topology " + topology );
+            for( uint32_t d = 1; d <= std::max( 1u, degree / 2 ); ++d )
+            {
+               const uint32_t j = ( i + d ) % node_count;
+               edges.emplace( std::min( i, j ), std::max( i, j ) );
+            }
+         }
+      }
+      for( const auto& edge : edges )
+      {
+         links[edge.first]->add_node_delegate( nodes[edge.second].get(), latency, bytes_per_second );
+         links[edge.second]->add_node_delegate( nodes[edge.first].get(), latency, bytes_per_second );
+      }
+      link_count = edges.size();
+   }
+
+   ~p2p_bench_network()
+   {
+      // destroying the links cancels the deliveries still queued, which yields to the others, so the nodes
+      // must stop relaying and outlive all links
+      stopping = true;
+      links.clear();
+   }
+
+   void arrived( const graphene::net::message& msg, uint32_t node, const fc::time_point& now )
+   {
+      auto itr = origins.find( msg.id() );
+      if( itr == origins.end() || itr->second.second == node )
+         return;
+      latencies[msg.msg_type].push_back( ( now - itr->second.first ).count() );
+   }
+
+   void originate( const graphene::net::message& msg, uint32_t node )
+   {
+      origins[msg.id()] = std::make_pair( fc::time_point::now(), node );
+      nodes[node]->originate( msg );
+   }
+
+   /// waits until every item reached every node, or @p timeout passed
+   void wait_for_propagation( fc::microseconds timeout )
+   {
+      const size_t expected = origins.size() * ( node_count - 1 );
+      const fc::time_point deadline = fc::time_point::now() + timeout;
+      auto arrivals = [this]() {
+         size_t result = 0;
+         for( const auto& item : latencies )
+            result += item.second.size();
+         return result;
+      };
+      while( arrivals() < expected && fc::time_point::now() < deadline )
+         fc::usleep( fc::milliseconds( 10 ) );
+   }
+
+   void report( const string& kind, uint32_t msg_type, size_t items )const
+   {
+      auto itr = latencies.find( msg_type );
+      vector<int64_t> sorted = itr == latencies.end() ? vector<int64_t>() : itr->second;
+      std::sort( sorted.begin(), sorted.end() );
+      fc::mutable_variant_object result;
+      result( "topology", topology )
+            ( "nodes", node_count )
+            ( "links", link_count )
+            ( "kind", kind )
+            ( "items", uint64_t( items ) )
+            ( "arrivals", uint64_t( sorted.size() ) )
+            ( "expected_arrivals", uint64_t( items * ( node_count - 1 ) ) )
+            ( "p50_us", latency_percentile( sorted, 0.5 ) )
+            ( "p90_us", latency_percentile( sorted, 0.9 ) )
+            ( "p99_us", latency_percentile( sorted, 0.99 ) )
+            ( "max_us", sorted.empty() ? 0 : sorted.back() );
+      std::cout << "P2P_BENCH " << fc::json::to_string( result ) << std::endl;
+   }
+
+   void report_cpu()const
+   {
+      vector<int64_t> cpu;
+      for( const auto& node : nodes )
+         cpu.push_back( node->cpu_us );
+      std::sort( cpu.begin(), cpu.end() );
+      fc::mutable_variant_object result;
+      result( "topology", topology )
+            ( "nodes", node_count )
+            ( "kind", "cpu_per_node" )
+            ( "p50_us", latency_percentile( cpu, 0.5 ) )
+            ( "max_us", cpu.back() )
+            ( "total_us", std::accumulate( cpu.begin(), cpu.end(), int64_t( 0 ) ) );
+      std::cout << "P2P_BENCH " << fc::json::to_string( result ) << std::endl;
+   }
+
+   const string                               topology;
+   const uint32_t                             node_count;
+   const uint32_t                             degree;
+   const fc::microseconds                     latency;
+   const uint64_t                             bytes_per_second;
+   size_t                                     link_count = 0;
+   vector< std::unique_ptr<bench_node> >      nodes;
+   /// the links of every node to its neighbours
+   vector< graphene::net::simulated_network_ptr > links;
+   bool                                       stopping = false;
+   /// when and by which node every item was sent first
+   std::map< graphene::net::message_hash_type, std::pair<fc::time_point,uint32_t> > origins;
+   /// the arrival latencies by message type
+   std::map< uint32_t, vector<int64_t> >      latencies;
+};
+
+bench_node::bench_node( p2p_bench_network& network, uint32_t index )
+: _network( network ), _index( index )
+{}
+
+void bench_node::originate( const graphene::net::message& msg )
+{
+   _seen.insert( msg.id() );
+   relay( msg );
+}
+
+void bench_node::relay( const graphene::net::message& msg )
+{
+   if( !_network.stopping )
+      _network.links[_index]->broadcast( msg );
+}
+
+void bench_node::handle_transaction( graphene::net::trx_message&& trx_msg )
+{
+   const fc::time_point start = fc::time_point::now();
+   trx_msg.trx.get_signature_keys( chain_id_type() );
+   received( graphene::net::message( trx_msg ), start );
+}
+
+void bench_node::received( const graphene::net::message& msg, const fc::time_point& start )
+{
+   if( _seen.insert( msg.id() ).second )
+   {
+      _network.arrived( msg, _index, start );
+      relay( msg );
+   }
+   cpu_us += ( fc::time_point::now() - start ).count();
+}
+
+signed_transaction make_bench_transaction( const fc::ecc::private_key& key, uint32_t n )
+{
+   transfer_operation op;
+   op.from = calc_account_uid( 1000 );
+   op.to = calc_account_uid( 2000 );
+   op.amount = asset( 1 + n );
+   op.fee = asset( 1000 );
+   signed_transaction trx;
+   trx.operations.push_back( op );
+   trx.ref_block_num = uint16_t( n );
+   trx.expiration = fc::time_point_sec( 1000000 + n );
+   trx.sign( key, chain_id_type() );
+   return trx;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE( p2p_bench )
+{
+   try {
+      const uint32_t blocks = bench_param( "P2P_BENCH_BLOCKS", 20 );
+      const fc::microseconds interval = fc::milliseconds( bench_param( "P2P_BENCH_INTERVAL_MS", 500 ) );
+      const uint32_t block_trxs = bench_param( "P2P_BENCH_BLOCK_TRXS", 100 );
+      const uint32_t trxs = bench_param( "P2P_BENCH_TRXS", 50 );
+      const fc::ecc::private_key key = fc::ecc::private_key::regenerate( fc::sha256::hash( string( "p2p_bench" ) ) );
+
+      p2p_bench_network network;
+      std::mt19937 rng( 7 );
+      uint32_t n = 0;
+      block_id_type previous;
+      for( uint32_t b = 0; b < blocks; ++b )
+      {
+         for( uint32_t t = 0; t < trxs; ++t )
+         {
+            network.originate( graphene::net::message( graphene::net::trx_message( make_bench_transaction( key, n++ ) ) ),
+                               rng() % network.node_count );
+            fc::usleep( fc::microseconds( interval.count() / ( trxs + 1 ) ) );
+         }
+
+         signed_block block;
+         block.previous = previous;
+         block.timestamp = fc::time_point_sec( 1000000 + b * GRAPHENE_DEFAULT_BLOCK_INTERVAL );
+         block.witness = calc_account_uid( 3000 );
+         for( uint32_t t = 0; t < block_trxs; ++t )
+            block.transactions.emplace_back( make_bench_transaction( key, n++ ) );
+         block.transaction_merkle_root = block.calculate_merkle_root();
+         block.sign( key );
+         previous = block.id();
+         network.originate( graphene::net::message( graphene::net::block_message( block ) ), 0 );
+         fc::usleep( fc::microseconds( interval.count() / ( trxs + 1 ) ) );
+      }
+
+      network.wait_for_propagation( fc::seconds( 60 ) );
+      network.report( "block", graphene::net::block_message_type, blocks );
+      network.report( "transaction", graphene::net::trx_message_type, size_t( blocks ) * trxs );
+      network.report_cpu();
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Time and memory of persisting and loading the chain state.
+ *
+ * A synthetic state is built in the fixture database, then flushed and copied so that open, close, replay and
+ * block range reads are measured on a database of its own. Every stage prints one machine readable line, e.g.
+ *
+ *   PERSISTENCE_BENCH {"stage":"open","accounts":10000,"posts":10000,"scores":10000,"ms":...,"peak_rss_kb":...}
+ *
+ * The state is configured by environment variables:
+ *
+ *   PERSISTENCE_BENCH_ACCOUNTS  number of extra accounts, default 10000
+ *   PERSISTENCE_BENCH_POSTS     number of posts, default 10000
+ *   PERSISTENCE_BENCH_SCORES    number of scores, default 10000
+ *
+ * e.g. PERSISTENCE_BENCH_ACCOUNTS=1000000 ./chain_bench --run_test=persistence_bench
+ *
+ * The copy is opened without the plugins of the fixture, so their indexes are neither loaded nor replayed.
+ */
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/content_object.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/io/json.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <iostream>
+
+#include <sys/resource.h>
+
+#include "../common/database_fixture.hpp"
+#include "bench_common.hpp"
+
+using namespace graphene::chain;
+using graphene::chain::bench::bench_param;
+
+namespace {
+
+/// peak resident set size of the process so far, in KiB
+int64_t peak_rss_kb()
+{
+   struct rusage usage;
+   if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+      return 0;
+   return usage.ru_maxrss;
+}
+
+uint64_t directory_bytes( const fc::path& dir )
+{
+   uint64_t total = 0;
+   for( boost::filesystem::recursive_directory_iterator itr( dir ), end; itr != end; ++itr )
+      if( boost::filesystem::is_regular_file( itr->status() ) )
+         total += boost::filesystem::file_size( itr->path() );
+   return total;
+}
+
+void copy_directory( const fc::path& from, const fc::path& to )
+{
+   boost::filesystem::create_directories( to );
+   for( boost::filesystem::recursive_directory_iterator itr( from ), end; itr != end; ++itr )
+   {
+      const auto target = to / boost::filesystem::relative( itr->path(), from );
+      if( boost::filesystem::is_directory( itr->status() ) )
+         boost::filesystem::create_directories( target );
+      else
+         boost::filesystem::copy_file( itr->path(), target, boost::filesystem::copy_option::overwrite_if_exists );
+   }
+}
+
+} // anonymous namespace
+
+struct persistence_bench_fixture : database_fixture
+{
+   persistence_bench_fixture()
+   : accounts( bench_param( "PERSISTENCE_BENCH_ACCOUNTS", 10000 ) ),
+     posts( bench_param( "PERSISTENCE_BENCH_POSTS", 10000 ) ),
+     scores( bench_param( "PERSISTENCE_BENCH_SCORES", 10000 ) ),
+     prec( asset::scaled_precision( asset_id_type()(db).precision ) )
+   {
+      // the block database is flushed after each block, so the copy sees all of them
+      db.set_block_database_mmap( true );
+   }
+
+   void report( const string& stage, const fc::microseconds& elapsed, fc::mutable_variant_object extra = fc::mutable_variant_object() )const
+   {
+      extra( "stage", stage )
+           ( "accounts", accounts )
+           ( "posts", posts )
+           ( "scores", scores )
+           ( "ms", elapsed.count() / 1000 )
+           ( "peak_rss_kb", peak_rss_kb() );
+      std::cout << "PERSISTENCE_BENCH " << fc::json::to_string( extra ) << std::endl;
+      wlog( "${stage}: ${ms} ms", ("stage",stage)("ms",elapsed.count() / 1000) );
+   }
+
+   /// pushes the transactions in blocks of 100 without the optional checks
+   void push_in_blocks( vector<signed_transaction>& trxs )
+   {
+      for( size_t i = 0; i < trxs.size(); ++i )
+      {
+         db.push_transaction( trxs[i], ~0 );
+         if( i % 100 == 99 )
+            generate_block();
+      }
+      trxs.clear();
+      generate_block();
+   }
+
+   signed_transaction make_trx( const operation& op, const flat_set<fc::ecc::private_key>& sign_keys )
+   {
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      set_operation_fees( tx, db.current_fee_schedule() );
+      test::set_expiration( db, tx );
+      tx.validate();
+      for( const auto& key : sign_keys )
+         sign( tx, key );
+      return tx;
+   }
+
+   const uint32_t accounts;
+   const uint32_t posts;
+   const uint32_t scores;
+   const share_type prec;
+};
+
+BOOST_FIXTURE_TEST_CASE( persistence_bench, persistence_bench_fixture )
+{
+   try {
+      fc::time_point start = fc::time_point::now();
+
+      // accounts with coin seconds to score, a platform and a poster authorized on it
+      flat_map<account_uid_type, fc::ecc::private_key> account_map;
+      actor( 100000, accounts, account_map );
+      vector<account_uid_type> uids;
+      vector<fc::ecc::private_key> keys;
+      for( const auto& item : account_map )
+      {
+         uids.push_back( item.first );
+         keys.push_back( item.second );
+         add_csaf_for_account( item.first, 1000 );
+      }
+      ACTORS((1000)(9000));
+      transfer( committee_account, u_9000_id, asset( 100000 * prec ) );
+      transfer( committee_account, u_1000_id, asset( 100000 * prec ) );
+      add_csaf_for_account( u_9000_id, 10000000 );
+      add_csaf_for_account( u_1000_id, 10000000 );
+      create_platform( u_9000_id, "platform", asset( 10000 * prec ), "www.123456789.com", "", { u_9000_private_key } );
+      account_auth_platform( { u_1000_private_key }, u_1000_id, u_9000_id, 1000 * prec );
+      generate_block();
+
+      vector<signed_transaction> trxs;
+      const post_pid_type first_pid = db.get_account_statistics_by_uid( u_1000_id ).last_post_sequence + 1;
+      for( uint32_t i = 0; i < posts; ++i )
+      {
+         post_operation op;
+         op.post_pid = first_pid + i;
+         op.platform = u_9000_id;
+         op.poster = u_1000_id;
+         op.hash_value = fc::to_string( i );
+         op.title = "post title " + fc::to_string( i );
+         op.body = "post body " + fc::to_string( i );
+         trxs.push_back( make_trx( op, { u_1000_private_key, u_9000_private_key } ) );
+      }
+      push_in_blocks( trxs );
+
+      // every account scores a post once, then moves on to the next post
+      for( uint32_t i = 0; i < scores && posts > 0 && uids.size() > 0; ++i )
+      {
+         const uint32_t post = i / uids.size();
+         if( post >= posts )
+            break;
+         score_create_operation op;
+         op.from_account_uid = uids[ i % uids.size() ];
+         op.platform = u_9000_id;
+         op.poster = u_1000_id;
+         op.post_pid = first_pid + post;
+         op.score = 5;
+         op.csaf = 1;
+         trxs.push_back( make_trx( op, { keys[ i % keys.size() ] } ) );
+      }
+      push_in_blocks( trxs );
+      report( "build", fc::time_point::now() - start );
+
+      start = fc::time_point::now();
+      db.flush();
+      report( "flush", fc::time_point::now() - start,
+              fc::mutable_variant_object( "state_bytes", directory_bytes( data_dir->path() / "object_database" ) ) );
+
+      const uint32_t head = db.head_block_num();
+      fc::temp_directory copy_dir( graphene::utilities::temp_directory_path() );
+      copy_directory( data_dir->path(), copy_dir.path() );
+
+      {
+         database copy;
+         start = fc::time_point::now();
+         copy.open( copy_dir.path(), [this]{ return genesis_state; }, "test" );
+         report( "open", fc::time_point::now() - start );
+         BOOST_CHECK_EQUAL( copy.head_block_num(), head );
+
+         vector<block_id_type> ids;
+         vector< vector<char> > data;
+         start = fc::time_point::now();
+         copy.get_block_database().fetch_raw_range( 1, head, ids, data );
+         uint64_t block_bytes = 0;
+         for( const auto& d : data )
+            block_bytes += d.size();
+         report( "block_range_read", fc::time_point::now() - start,
+                 fc::mutable_variant_object( "blocks", head )( "block_bytes", block_bytes ) );
+
+         start = fc::time_point::now();
+         auto blocks = copy.fetch_blocks_by_number( 1, head );
+         report( "block_range_unpack", fc::time_point::now() - start,
+                 fc::mutable_variant_object( "blocks", uint64_t( blocks.size() ) ) );
+
+         start = fc::time_point::now();
+         copy.close();
+         report( "close", fc::time_point::now() - start );
+      }
+      {
+         // a different version string wipes the object database and replays the blocks
+         database copy;
+         start = fc::time_point::now();
+         copy.open( copy_dir.path(), [this]{ return genesis_state; }, "persistence_bench_replay" );
+         report( "replay", fc::time_point::now() - start, fc::mutable_variant_object( "blocks", head ) );
+         BOOST_CHECK_EQUAL( copy.head_block_num(), head );
+         copy.close();
+      }
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
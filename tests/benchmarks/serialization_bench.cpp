@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Throughput of the serialization of the protocol types on the p2p, storage and API paths.
+ *
+ * For every type fc::raw::pack, fc::raw::unpack, fc::raw::pack_size, conversion to a variant and back are timed
+ * over the same value, and one machine readable line is printed per type, e.g.
+ *
+ *   SERIALIZATION_BENCH {"type":"post_operation","wire_size":1234,"iterations":10000,"pack_ns":...,"unpack_ns":...}
+ *
+ * The run is configured by environment variables:
+ *
+ *   SERIALIZATION_BENCH_ITERATIONS  number of times each small value is serialized, default 10000
+ *   SERIALIZATION_BENCH_BLOCK_TRXS  number of transactions in the block, default 1000; the block is serialized
+ *                                   iterations / block_trxs times, at least 10
+ *
+ * json_reader_bench also compares reading a transaction from JSON through fc::variant with graphene::app::read_json.
+ *
+ * e.g. SERIALIZATION_BENCH_ITERATIONS=1000000 ./chain_bench --run_test=serialization_bench
+ */
+
+#include <graphene/app/database_api.hpp>
+#include <graphene/app/json_reader.hpp>
+#include <graphene/chain/protocol/protocol.hpp>
+#include <graphene/chain/account_object.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <iostream>
+
+#include "bench_common.hpp"
+
+using namespace graphene::chain;
+using graphene::chain::bench::bench_param;
+
+namespace {
+
+int64_t ns_per_iteration( const fc::time_point& start, uint32_t iterations )
+{
+   return ( fc::time_point::now() - start ).count() * 1000 / iterations;
+}
+
+/// times the serializations of @p value and prints the result line of @p name
+template<typename T>
+void bench_serialization( const string& name, const T& value, uint32_t iterations )
+{
+   const vector<char> packed = fc::raw::pack( value );
+   const fc::variant var( value, GRAPHENE_MAX_NESTED_OBJECTS );
+   // the sink keeps the results alive so the loops aren't optimized away
+   uint64_t sink = 0;
+
+   fc::time_point start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+      sink += fc::raw::pack( value ).size();
+   const int64_t pack_ns = ns_per_iteration( start, iterations );
+
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+   {
+      T unpacked;
+      fc::datastream<const char*> ds( packed.data(), packed.size() );
+      fc::raw::unpack( ds, unpacked );
+      sink += sizeof( unpacked );
+   }
+   const int64_t unpack_ns = ns_per_iteration( start, iterations );
+
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+      sink += fc::raw::pack_size( value );
+   const int64_t pack_size_ns = ns_per_iteration( start, iterations );
+
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+      sink += fc::variant( value, GRAPHENE_MAX_NESTED_OBJECTS ).is_object();
+   const int64_t to_variant_ns = ns_per_iteration( start, iterations );
+
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+      sink += sizeof( var.as<T>( GRAPHENE_MAX_NESTED_OBJECTS ) );
+   const int64_t from_variant_ns = ns_per_iteration( start, iterations );
+
+   BOOST_CHECK( sink > 0 );
+   BOOST_CHECK( fc::raw::pack( fc::raw::unpack<T>( packed ) ) == packed );
+
+   const double mb_per_sec = pack_ns > 0 ? packed.size() * 1000.0 / pack_ns : 0;
+   fc::mutable_variant_object result;
+   result( "type", name )
+         ( "wire_size", uint64_t( packed.size() ) )
+         ( "iterations", iterations )
+         ( "pack_ns", pack_ns )
+         ( "unpack_ns", unpack_ns )
+         ( "pack_size_ns", pack_size_ns )
+         ( "to_variant_ns", to_variant_ns )
+         ( "from_variant_ns", from_variant_ns )
+         ( "pack_mb_per_sec", mb_per_sec );
+   std::cout << "SERIALIZATION_BENCH " << fc::json::to_string( result ) << std::endl;
+   wlog( "${name}: ${size} bytes, pack ${p}ns, unpack ${u}ns, pack_size ${s}ns",
+         ("name",name)("size",packed.size())("p",pack_ns)("u",unpack_ns)("s",pack_size_ns) );
+}
+
+struct serialization_bench_values
+{
+   serialization_bench_values()
+   : iterations( bench_param( "SERIALIZATION_BENCH_ITERATIONS", 10000 ) ),
+     block_trxs( bench_param( "SERIALIZATION_BENCH_BLOCK_TRXS", 1000 ) ),
+     key( fc::ecc::private_key::regenerate( fc::sha256::hash( string( "serialization_bench" ) ) ) )
+   {
+      post.post_pid = 12345;
+      post.platform = calc_account_uid( 9000 );
+      post.poster = calc_account_uid( 1000 );
+      post.hash_value = fc::sha256::hash( string( "post" ) ).str();
+      post.extra_data = "{\"category\":\"bench\",\"tags\":[\"a\",\"b\"]}";
+      post.title = string( 64, 't' );
+      post.body = string( 1024, 'b' );
+      post_operation::ext exts;
+      exts.license_lid = 1;
+      exts.forward_price = 10000;
+      post.extensions = graphene::chain::extension<post_operation::ext>();
+      post.extensions->value = exts;
+
+      score.from_account_uid = calc_account_uid( 2000 );
+      score.platform = post.platform;
+      score.poster = post.poster;
+      score.post_pid = post.post_pid;
+      score.score = 5;
+      score.csaf = 100;
+
+      trx.set_expiration( fc::time_point_sec( 1559318400 ) );
+      trx.ref_block_num = 1234;
+      trx.ref_block_prefix = 0x12345678;
+      trx.operations.push_back( post );
+      trx.sign( key, chain_id_type() );
+
+      block.timestamp = fc::time_point_sec( 1559318400 );
+      block.witness = calc_account_uid( 10 );
+      for( uint32_t i = 0; i < block_trxs; ++i )
+      {
+         signed_transaction t;
+         t.set_expiration( fc::time_point_sec( 1559318400 ) );
+         score_create_operation op = score;
+         op.from_account_uid = calc_account_uid( 100000 + i );
+         t.operations.push_back( op );
+         t.sign( key, chain_id_type() );
+         block.transactions.push_back( t );
+      }
+      block.transaction_merkle_root = block.calculate_merkle_root();
+      block.sign( key );
+
+      const public_key_type pub_key = key.get_public_key();
+      account.uid = calc_account_uid( 1000 );
+      account.name = "benchaccount";
+      account.owner = authority( 1, pub_key, 1 );
+      account.active = authority( 1, pub_key, 1 );
+      account.secondary = authority( 1, pub_key, 1 );
+      account.memo_key = pub_key;
+      account.registrar = calc_account_uid( 1 );
+      account.referrer = calc_account_uid( 1 );
+   }
+
+   const uint32_t         iterations;
+   const uint32_t         block_trxs;
+   fc::ecc::private_key   key;
+   post_operation         post;
+   score_create_operation score;
+   signed_transaction     trx;
+   signed_block           block;
+   account_object         account;
+};
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE( serialization_bench, serialization_bench_values )
+
+BOOST_AUTO_TEST_CASE( post_operation_bench )
+{
+   bench_serialization( "post_operation", post, iterations );
+}
+
+BOOST_AUTO_TEST_CASE( score_create_operation_bench )
+{
+   bench_serialization( "score_create_operation", score, iterations );
+}
+
+BOOST_AUTO_TEST_CASE( operation_bench )
+{
+   bench_serialization( "operation", operation( post ), iterations );
+}
+
+BOOST_AUTO_TEST_CASE( signed_transaction_bench )
+{
+   bench_serialization( "signed_transaction", trx, iterations );
+}
+
+BOOST_AUTO_TEST_CASE( json_reader_bench )
+{
+   const string json = fc::json::to_string( fc::variant( trx, GRAPHENE_MAX_NESTED_OBJECTS ) );
+   uint64_t sink = 0;
+
+   fc::time_point start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+      sink += fc::json::from_string( json ).as<signed_transaction>( GRAPHENE_MAX_NESTED_OBJECTS ).operations.size();
+   const int64_t variant_ns = ns_per_iteration( start, iterations );
+
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+      sink += graphene::app::read_json<signed_transaction>( json, GRAPHENE_MAX_NESTED_OBJECTS ).operations.size();
+   const int64_t reader_ns = ns_per_iteration( start, iterations );
+
+   BOOST_CHECK( sink > 0 );
+   BOOST_CHECK( fc::raw::pack( graphene::app::read_json<signed_transaction>( json, GRAPHENE_MAX_NESTED_OBJECTS ) )
+                == fc::raw::pack( trx ) );
+
+   fc::mutable_variant_object result;
+   result( "type", "signed_transaction_json" )
+         ( "json_size", uint64_t( json.size() ) )
+         ( "iterations", iterations )
+         ( "from_json_variant_ns", variant_ns )
+         ( "read_json_ns", reader_ns );
+   std::cout << "SERIALIZATION_BENCH " << fc::json::to_string( result ) << std::endl;
+   wlog( "signed_transaction from ${size} bytes of JSON: through fc::variant ${v}ns, read_json ${r}ns",
+         ("size",json.size())("v",variant_ns)("r",reader_ns) );
+}
+
+BOOST_AUTO_TEST_CASE( signed_block_bench )
+{
+   bench_serialization( "signed_block", block, std::max<uint32_t>( 10, iterations / block_trxs ) );
+}
+
+BOOST_AUTO_TEST_CASE( account_object_bench )
+{
+   bench_serialization( "account_object", account, iterations );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
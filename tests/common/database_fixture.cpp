@@ -337,6 +337,12 @@ void database_fixture::generate_blocks(uint32_t block_count)
       generate_block();
 }
 
+void database_fixture::fast_forward_blocks(uint32_t block_count)
+{
+   db.clear_pending();
+   db.generate_empty_blocks(block_count, ~0);
+}
+
 void database_fixture::generate_blocks_miss(uint32_t block_count, uint32_t serial_no, uint32_t skip)
 {
    if(block_count>serial_no)
@@ -785,6 +791,26 @@ void database_fixture::transfer(
    } FC_CAPTURE_AND_RETHROW((from.id)(to.id)(amount)(fee))
 }
 
+signed_transaction database_fixture::make_transfer_transaction(
+   account_uid_type from,
+   account_uid_type to,
+   const asset& amount,
+   const asset& fee /* = asset() */,
+   const optional<fc::ecc::private_key>& key /* = optional<fc::ecc::private_key>() */)
+{
+   signed_transaction tx;
+   transfer_operation op;
+   op.from = from;
+   op.to = to;
+   op.amount = amount;
+   op.fee = fee;
+   tx.operations.push_back(op);
+   set_expiration(db, tx);
+   if (key.valid())
+      sign(tx, *key);
+   return tx;
+}
+
 void database_fixture::enable_fees()
 {
    db.modify(global_property_id_type()(db), [](global_property_object& gpo)
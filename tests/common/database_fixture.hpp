@@ -180,6 +180,12 @@ struct database_fixture {
     * @param block_count number of blocks to generate
     */
    void generate_blocks(uint32_t block_count);
+
+   /**
+    * @brief Generates block_count empty blocks much faster than generate_blocks(), see database::generate_empty_blocks()
+    * @param block_count number of blocks to generate
+    */
+   void fast_forward_blocks(uint32_t block_count);
    
    void generate_blocks_miss(uint32_t block_count, uint32_t serial_no=5, uint32_t skip=~0);
 
@@ -263,6 +269,9 @@ struct database_fixture {
    //   asset cancel_limit_order( const limit_order_object& order );
    void transfer(account_uid_type from, account_uid_type to, const asset& amount, const asset& fee = asset());
    void transfer(const account_object& from, const account_object& to, const asset& amount, const asset& fee = asset());
+   /// a transaction of a single transfer, expiring as set_expiration() sets it, signed if a key is given
+   signed_transaction make_transfer_transaction(account_uid_type from, account_uid_type to, const asset& amount,
+      const asset& fee = asset(), const optional<fc::ecc::private_key>& key = optional<fc::ecc::private_key>());
    void enable_fees();
    void change_fees(const flat_set< fee_parameters >& new_params, uint32_t new_scale = 0);
    //TODO:lifetime member
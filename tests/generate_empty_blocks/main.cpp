@@ -22,21 +22,36 @@
  * THE SOFTWARE.
  */
 
+/**
+ * generate_empty_blocks builds a synthetic chain in a fresh data directory, for replay and storage benchmarks.
+ *
+ * Without --transactions-per-block the blocks are empty. With it, the tool first creates --accounts accounts which
+ * authorize the genesis platform, then fills every block with a deterministic mix of posts, rewards and transfers
+ * between them. The transactions of the next --batch-blocks blocks are generated and signed on worker threads while
+ * the current batch is applied. The blocks bypass the fork database and go straight to the block database.
+ */
+
 #include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <map>
+#include <random>
+#include <thread>
 
 #include <fc/io/fstream.hpp>
 #include <fc/io/json.hpp>
 #include <fc/io/stdio.hpp>
 #include <fc/smart_ref_impl.hpp>
+#include <fc/thread/thread.hpp>
 
 #include <graphene/app/api.hpp>
 #include <graphene/chain/protocol/protocol.hpp>
 #include <graphene/egenesis/egenesis.hpp>
 #include <graphene/utilities/key_conversion.hpp>
+#include <graphene/utilities/thread_pool.hpp>
 
+#include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 
 #ifndef WIN32
@@ -55,6 +70,138 @@ namespace graphene { namespace app { namespace detail {
 genesis_state_type create_example_genesis();
 } } } // graphene::app::detail
 
+struct synthetic_account
+{
+   account_uid_type     uid;
+   fc::ecc::private_key key;
+   post_pid_type        next_post_pid = 1;
+};
+
+struct synthetic_post
+{
+   account_uid_type poster;
+   post_pid_type    post_pid;
+};
+
+struct synthetic_transaction
+{
+   signed_transaction                  trx;
+   vector<const fc::ecc::private_key*> keys;
+};
+
+/// Parses "post=1,reward=1,transfer=2" into per-type weights
+map<string,uint32_t> parse_mix( const string& mix )
+{
+   map<string,uint32_t> weights{ {"post",0}, {"reward",0}, {"transfer",0} };
+   vector<string> items;
+   boost::split( items, mix, boost::is_any_of( "," ) );
+   for( const string& item : items )
+   {
+      vector<string> kv;
+      boost::split( kv, item, boost::is_any_of( "=" ) );
+      FC_ASSERT( kv.size() == 2 && weights.count( kv[0] ), "Invalid mix item ${i}", ("i", item) );
+      weights[kv[0]] = fc::to_uint64( kv[1] );
+   }
+   return weights;
+}
+
+/**
+ * Generates the transactions of the workload, deterministically from the seed. Every transaction is made unique
+ * by its amount and expiration, see next().
+ */
+class synthetic_workload
+{
+   public:
+      synthetic_workload( vector<synthetic_account>& accounts, account_uid_type platform,
+                          const fc::ecc::private_key& platform_key, const map<string,uint32_t>& weights, uint64_t seed )
+         : _accounts( accounts ), _platform( platform ), _platform_key( platform_key ), _weights( weights ),
+           _rng( seed )
+      {
+         for( const auto& w : _weights )
+            _total_weight += w.second;
+         FC_ASSERT( _total_weight > 0, "The mix is empty" );
+      }
+
+      /// the transaction number @p n, referencing the block of @p reference, its fee set with @p fees
+      synthetic_transaction next( uint64_t n, const signed_transaction& reference, const fee_schedule& fees )
+      {
+         synthetic_transaction tx;
+         tx.trx = reference;
+         // at most 1000 transactions of a kind share an expiration, and they have different amounts
+         tx.trx.expiration -= uint32_t( n / 1000 % 3600 );
+         const share_type amount = 1 + n % 1000;
+
+         uint64_t pick = _rng() % _total_weight;
+         string type;
+         for( const auto& w : _weights )
+         {
+            if( pick < w.second ) { type = w.first; break; }
+            pick -= w.second;
+         }
+         if( type == "reward" && _posts.empty() )
+            type = _weights.at( "post" ) > 0 ? "post" : "transfer";
+
+         if( type == "post" )
+         {
+            synthetic_account& poster = _accounts[ _rng() % _accounts.size() ];
+            post_operation op;
+            op.post_pid = poster.next_post_pid++;
+            op.platform = _platform;
+            op.poster = poster.uid;
+            op.hash_value = fc::sha256::hash( fc::to_string( poster.uid ) + "/" + fc::to_string( op.post_pid ) ).str();
+            op.title = "synthetic " + fc::to_string( n );
+            op.body = "post " + fc::to_string( op.post_pid ) + " of " + fc::to_string( poster.uid );
+            tx.trx.operations.push_back( op );
+            tx.keys.push_back( &poster.key );
+            tx.keys.push_back( &_platform_key );
+            _posts.push_back( { poster.uid, op.post_pid } );
+         }
+         else if( type == "reward" )
+         {
+            const synthetic_post& post = _posts[ _rng() % _posts.size() ];
+            const synthetic_account& from = _accounts[ _rng() % _accounts.size() ];
+            reward_operation op;
+            op.from_account_uid = from.uid;
+            op.platform = _platform;
+            op.poster = post.poster;
+            op.post_pid = post.post_pid;
+            op.amount = asset( amount );
+            tx.trx.operations.push_back( op );
+            tx.keys.push_back( &from.key );
+         }
+         else
+         {
+            const size_t from = _rng() % _accounts.size();
+            const size_t to = ( from + 1 + _rng() % ( _accounts.size() - 1 ) ) % _accounts.size();
+            transfer_operation op;
+            op.from = _accounts[from].uid;
+            op.to = _accounts[to].uid;
+            op.amount = asset( amount );
+            tx.trx.operations.push_back( op );
+            tx.keys.push_back( &_accounts[from].key );
+         }
+         fees.set_fee( tx.trx.operations.back() );
+         return tx;
+      }
+
+   private:
+      vector<synthetic_account>& _accounts;
+      const account_uid_type     _platform;
+      const fc::ecc::private_key _platform_key;
+      const map<string,uint32_t> _weights;
+      uint32_t                   _total_weight = 0;
+      std::mt19937_64            _rng;
+      vector<synthetic_post>     _posts;
+};
+
+void sign_transactions( thread_pool& pool, vector<synthetic_transaction>& txs, const chain_id_type& chain_id )
+{
+   pool.parallel_for( txs.size(), [&txs,&chain_id]( size_t i ) {
+      for( const fc::ecc::private_key* key : txs[i].keys )
+         txs[i].trx.sign( *key, chain_id );
+   });
+}
+
 int main( int argc, char** argv )
 {
    try
@@ -67,6 +214,13 @@ int main( int argc, char** argv )
             ("genesis-time,t", bpo::value<uint32_t>()->default_value(0), "Timestamp for genesis state (0=use value from file/example)")
             ("num-blocks,n", bpo::value<uint32_t>()->default_value(1000000), "Number of blocks to generate")
             ("miss-rate,r", bpo::value<uint32_t>()->default_value(3), "Percentage of blocks to miss")
+            ("transactions-per-block", bpo::value<uint32_t>()->default_value(0), "Synthetic transactions in each block, 0 for empty blocks")
+            ("accounts", bpo::value<uint32_t>()->default_value(1000), "Number of accounts the synthetic transactions are spread over")
+            ("initial-balance", bpo::value<int64_t>()->default_value(1000000), "Core asset given to each account, in whole units")
+            ("mix", bpo::value<string>()->default_value("post=2,reward=1,transfer=3"), "Relative weights of the synthetic operations")
+            ("seed", bpo::value<uint64_t>()->default_value(1), "Seed of the synthetic operations")
+            ("batch-blocks", bpo::value<uint32_t>()->default_value(100), "Blocks whose transactions are signed together, ahead of the blocks applied")
+            ("signing-threads", bpo::value<uint32_t>()->default_value(std::max(1u, std::thread::hardware_concurrency())), "Threads signing the transactions")
             ("verbose,v", "Enter verbose mode")
             ;
 
@@ -118,6 +272,8 @@ int main( int argc, char** argv )
 
       uint32_t num_blocks = options["num-blocks"].as<uint32_t>();
       uint32_t miss_rate = options["miss-rate"].as<uint32_t>();
+      const uint32_t transactions_per_block = options["transactions-per-block"].as<uint32_t>();
+      const uint32_t batch_blocks = std::max( 1u, options["batch-blocks"].as<uint32_t>() );
 
       fc::ecc::private_key nathan_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("nathan")));
 
@@ -125,12 +281,17 @@ int main( int argc, char** argv )
       fc::path db_path = data_dir / "db";
       db.open(db_path, [&]() { return genesis; }, "TEST" );
 
+      // the transactions are signed by the workers, the replay of the chain checks the signatures
+      const uint32_t skip = database::skip_transaction_signatures | database::skip_fork_db;
+      const chain_id_type chain_id = db.get_chain_id();
+      thread_pool signers( options["signing-threads"].as<uint32_t>(), "signing" );
+
       uint32_t slot = 1;
       uint32_t missed = 0;
+      uint32_t block_num = 1;
 
-      for( uint32_t i = 1; i < num_blocks; ++i )
-      {
-         signed_block b = db.generate_block(db.get_slot_time(slot), db.get_scheduled_witness(slot), nathan_priv_key, database::skip_nothing);
+      auto generate_block = [&]() {
+         signed_block b = db.generate_block(db.get_slot_time(slot), db.get_scheduled_witness(slot), nathan_priv_key, skip);
          FC_ASSERT( db.head_block_id() == b.id() );
          fc::sha256 h = b.digest();
          uint64_t rand = h._hash[0];
@@ -146,22 +307,151 @@ int main( int argc, char** argv )
             else
                break;
          }
-         
-         witness_id_type prev_witness = b.witness;
-         witness_id_type cur_witness = db.get_scheduled_witness(1);
+
+         account_uid_type prev_witness = b.witness;
+         account_uid_type cur_witness = db.get_scheduled_witness(1);
          if( verbose )
          {
             wdump( (prev_witness)(cur_witness) );
          }
-         else if( (i%10000) == 0 )
+         else if( (block_num%10000) == 0 )
          {
-            std::cerr << "\rblock #" << i << "   missed " << missed;
+            std::cerr << "\rblock #" << block_num << "   missed " << missed;
          }
          if( slot == 1 )  // can possibly get consecutive production if block missed
          {
             FC_ASSERT( cur_witness != prev_witness );
          }
+         ++block_num;
+      };
+      auto new_transaction = [&db]() {
+         signed_transaction trx;
+         trx.set_reference_block( db.head_block_id() );
+         trx.set_expiration( db.head_block_time() + db.get_global_properties().parameters.maximum_time_until_expiration );
+         return trx;
+      };
+
+      // pushed in blocks of transactions_per_block, the setup transactions only depend on each other across blocks
+      auto push_setup = [&]( vector<synthetic_transaction>& txs ) {
+         sign_transactions( signers, txs, chain_id );
+         const size_t per_block = std::max( 1u, transactions_per_block );
+         for( size_t i = 0; i < txs.size() && block_num < num_blocks; )
+         {
+            for( size_t end = std::min( txs.size(), i + per_block ); i < end; ++i )
+               db.push_transaction( txs[i].trx, skip );
+            generate_block();
+         }
+      };
+
+      vector<synthetic_account> accounts;
+      std::unique_ptr<synthetic_workload> workload;
+      if( transactions_per_block > 0 )
+      {
+         const uint32_t account_count = options["accounts"].as<uint32_t>();
+         FC_ASSERT( account_count >= 2, "At least 2 accounts are needed" );
+         // the registrar and the platform of the example genesis, both with the nathan key
+         const account_uid_type registrar = calc_account_uid( 100 );
+         const account_uid_type platform = calc_account_uid( 90 );
+         const fee_schedule& fees = db.current_fee_schedule();
+
+         vector<synthetic_transaction> setup;
+         for( uint32_t i = 0; i < account_count; ++i )
+         {
+            synthetic_account a;
+            a.uid = calc_account_uid( 1000000 + i );
+            a.key = fc::ecc::private_key::regenerate( fc::sha256::hash( "synthetic " + fc::to_string( i ) ) );
+            const public_key_type pub_key = a.key.get_public_key();
+
+            account_create_operation create_op;
+            create_op.uid = a.uid;
+            create_op.name = "synthetic" + fc::to_string( i );
+            create_op.owner = authority( 1, pub_key, 1 );
+            create_op.active = authority( 1, pub_key, 1 );
+            create_op.secondary = authority( 1, pub_key, 1 );
+            create_op.memo_key = pub_key;
+            create_op.reg_info.registrar = registrar;
+            create_op.reg_info.referrer = registrar;
+
+            transfer_operation fund_op;
+            fund_op.from = registrar;
+            fund_op.to = a.uid;
+            fund_op.amount = asset( options["initial-balance"].as<int64_t>() * GRAPHENE_BLOCKCHAIN_PRECISION );
+
+            synthetic_transaction tx;
+            tx.trx = new_transaction();
+            tx.trx.operations.push_back( create_op );
+            tx.trx.operations.push_back( fund_op );
+            for( auto& op : tx.trx.operations )
+               fees.set_fee( op );
+            tx.keys.push_back( &nathan_priv_key );
+            setup.push_back( std::move( tx ) );
+            accounts.push_back( a );
+         }
+         std::cerr << "Creating " << account_count << " accounts\n";
+         push_setup( setup );
+
+         setup.clear();
+         for( const synthetic_account& a : accounts )
+         {
+            account_auth_platform_operation auth_op;
+            auth_op.uid = a.uid;
+            auth_op.platform = platform;
+            synthetic_transaction tx;
+            tx.trx = new_transaction();
+            tx.trx.operations.push_back( auth_op );
+            fees.set_fee( tx.trx.operations.back() );
+            tx.keys.push_back( &a.key );
+            setup.push_back( std::move( tx ) );
+         }
+         std::cerr << "Authorizing platform " << platform << " for " << account_count << " accounts\n";
+         push_setup( setup );
+
+         workload.reset( new synthetic_workload( accounts, platform, nathan_priv_key,
+                                                 parse_mix( options["mix"].as<string>() ), options["seed"].as<uint64_t>() ) );
+      }
+
+      // the transactions of a batch reference the head block before the previous batch is applied, they expire
+      // long after both batches are applied
+      uint64_t generated = 0;
+      auto make_batch = [&]( uint32_t first_block ) {
+         vector<synthetic_transaction> txs;
+         if( !workload )
+            return txs;
+         const uint32_t blocks = std::min( batch_blocks, num_blocks - std::min( num_blocks, first_block ) );
+         const signed_transaction reference = new_transaction();
+         txs.reserve( size_t( blocks ) * transactions_per_block );
+         for( size_t i = 0; i < size_t( blocks ) * transactions_per_block; ++i )
+            txs.push_back( workload->next( generated++, reference, db.current_fee_schedule() ) );
+         return txs;
+      };
+
+      fc::thread signing_thread( "synthetic_signing" );
+      vector<synthetic_transaction> current = make_batch( block_num );
+      sign_transactions( signers, current, chain_id );
+      while( block_num < num_blocks )
+      {
+         const uint32_t count = std::min( batch_blocks, num_blocks - block_num );
+         // the next batch is signed while this one is applied
+         vector<synthetic_transaction> next;
+         fc::future<void> signing;
+         if( block_num + count < num_blocks )
+         {
+            next = make_batch( block_num + count );
+            signing = signing_thread.async( [&signers,&next,&chain_id]() { sign_transactions( signers, next, chain_id ); },
+                                            "sign_transactions" );
+         }
+         size_t pushed = 0;
+         for( uint32_t b = 0; b < count; ++b )
+         {
+            for( uint32_t t = 0; t < transactions_per_block && pushed < current.size(); ++t )
+               db.push_transaction( current[pushed++].trx, skip );
+            generate_block();
+         }
+         if( signing.valid() )
+            signing.wait();
+         current = std::move( next );
       }
+      signing_thread.quit();
       std::cerr << "\n";
       db.close();
    }
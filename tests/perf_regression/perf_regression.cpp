@@ -0,0 +1,531 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Whole node performance regression suite.
+ *
+ * Starting from a state snapshot and the blocks following it, the hot paths of a node are measured in turn:
+ *
+ *   replay      the blocks are put in the block database of a node at the imported snapshot, then database::open()
+ *               replays them, like it does for a node restarted with blocks it hasn't applied
+ *   sync        the blocks reach a second node through a graphene::net::simulated_network, which pushes them
+ *               with full validation like a node catching up does
+ *   mempool     transfers are pushed to the pending state of the synced node
+ *   production  the synced node produces blocks out of them, as the scheduled witness
+ *   api         a mix of database_api calls, weighted like the calls of wallets and front ends
+ *
+ * Replay and sync are repeated PERF_REGRESSION_RUNS times on fresh copies of the snapshot and the median run is
+ * kept; the other stages are summed up over many items. Every metric is printed on one machine readable line,
+ *
+ *   PERF_REGRESSION {"metric":"replay_blocks_per_sec","value":...,"baseline":...,"change_percent":...,"regressed":false}
+ *
+ * and compared with the baseline file: a metric more than PERF_REGRESSION_THRESHOLD percent worse than its baseline
+ * fails the suite. Without a baseline file the metrics are only printed.
+ *
+ * The run is configured by environment variables:
+ *
+ *   PERF_REGRESSION_SNAPSHOT         state snapshot to start from, see database::export_state_snapshot(); without
+ *                                    it a synthetic chain is built on the genesis of the test fixture
+ *   PERF_REGRESSION_BLOCKS_DIR       block database holding the blocks following the snapshot, i.e. the
+ *                                    database/block_num_to_block directory of a node; required with a snapshot
+ *   PERF_REGRESSION_BLOCKS           number of blocks replayed and synced, default 200; with a snapshot, at most
+ *                                    this many of the blocks found after its head block
+ *   PERF_REGRESSION_ACCOUNTS         accounts of the synthetic chain, default 1000
+ *   PERF_REGRESSION_BLOCK_TRXS       transfers in every block of the synthetic chain and every produced block,
+ *                                    default 50
+ *   PERF_REGRESSION_PRODUCED_BLOCKS  number of blocks produced, default 20
+ *   PERF_REGRESSION_API_CALLS        number of database_api calls, default 20000
+ *   PERF_REGRESSION_RUNS             runs of replay and sync, default 3
+ *   PERF_REGRESSION_BASELINE         baseline file, default perf_regression_baseline.json in the working directory
+ *   PERF_REGRESSION_THRESHOLD        allowed regression of a metric in percent, default 20
+ *   PERF_REGRESSION_WRITE_BASELINE   if set, the metrics are written to the baseline file instead of compared
+ *
+ * e.g. PERF_REGRESSION_WRITE_BASELINE=1 ./perf_regression   with the release to compare with, then
+ *      ./perf_regression                                   with the build under test, on the same machine
+ *
+ * The keys of the accounts of a real snapshot aren't known, so with PERF_REGRESSION_SNAPSHOT the transfers of the
+ * mempool and production stages are pushed without signature and authority checks, and the blocks are produced
+ * without a witness signature.
+ */
+
+#include <graphene/app/database_api.hpp>
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/block_database.hpp>
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/node.hpp>
+
+#include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+
+#include "../common/database_fixture.hpp"
+#include "../benchmarks/bench_common.hpp"
+
+using namespace graphene::chain;
+using graphene::chain::bench::bench_param;
+using graphene::chain::bench::latency_percentile;
+
+namespace {
+
+/// a measured value, and whether a higher one is better
+struct perf_metric
+{
+   string name;
+   double value;
+   bool   higher_is_better;
+};
+
+double per_second( size_t items, const fc::microseconds& elapsed )
+{
+   return elapsed.count() > 0 ? items * 1000000.0 / elapsed.count() : 0;
+}
+
+double median( vector<double> values )
+{
+   std::sort( values.begin(), values.end() );
+   return values.empty() ? 0 : values[ values.size() / 2 ];
+}
+
+/// the manifest of a state snapshot, with the database version a node importing it must have
+state_snapshot_manifest read_snapshot_manifest( const fc::path& snapshot_dir )
+{
+   std::string packed;
+   fc::read_file_contents( snapshot_dir / "manifest", packed );
+   return fc::raw::unpack<state_snapshot_manifest>( vector<char>( packed.begin(), packed.end() ) );
+}
+
+/// a node pushing the blocks it receives from the simulated network to its database
+class sync_node : public graphene::net::node_delegate
+{
+   public:
+      explicit sync_node( database& db ) : _db( db ) {}
+
+      bool has_item( const graphene::net::item_id& id ) override { return false; }
+      bool handle_block( const graphene::net::block_message& blk_msg, bool sync_mode,
+                         std::vector<fc::uint160_t>& contained_transaction_message_ids ) override
+      {
+         try {
+            _db.push_block( blk_msg.block, database::skip_nothing );
+         } catch( const fc::exception& e ) {
+            ++failures;
+            elog( "Block ${n} failed to sync: ${e}", ("n",blk_msg.block.block_num())("e",e.to_detail_string()) );
+         }
+         return false;
+      }
+      void prepare_sync_blocks( const std::vector<const graphene::net::block_message*>& blocks ) override {}
+      void handle_transaction( graphene::net::trx_message&& trx_msg ) override {}
+      void handle_message( const graphene::net::message& message_to_process ) override {}
+      std::vector<graphene::net::item_hash_t> get_block_ids( const std::vector<graphene::net::item_hash_t>& synopsis,
+                                                             uint32_t& remaining_item_count,
+                                                             uint32_t limit ) override
+      { return {}; }
+      graphene::net::message get_item( const graphene::net::item_id& id ) override
+      { FC_THROW_EXCEPTION( fc::key_not_found_exception, "no items are served" ); }
+      chain_id_type get_chain_id()const override { return _db.get_chain_id(); }
+      std::vector<graphene::net::item_hash_t> get_blockchain_synopsis( const graphene::net::item_hash_t& reference_point,
+                                                                      uint32_t number_of_blocks_after_reference_point ) override
+      { return {}; }
+      void sync_status( uint32_t item_type, uint32_t item_count ) override {}
+      void connection_count_changed( uint32_t c ) override {}
+      uint32_t get_block_number( const graphene::net::item_hash_t& block_id ) override { return 0; }
+      fc::time_point_sec get_block_time( const graphene::net::item_hash_t& block_id ) override { return fc::time_point_sec(); }
+      graphene::net::item_hash_t get_head_block_id()const override { return _db.head_block_id(); }
+      uint32_t estimate_last_known_fork_from_git_revision_timestamp( uint32_t unix_timestamp )const override { return 0; }
+      void error_encountered( const std::string& message, const fc::oexception& error ) override {}
+      uint8_t get_current_block_interval_in_seconds()const override { return GRAPHENE_DEFAULT_BLOCK_INTERVAL; }
+
+      uint32_t failures = 0;
+
+   private:
+      database& _db;
+};
+
+} // anonymous namespace
+
+struct perf_regression_fixture : database_fixture
+{
+   perf_regression_fixture()
+   : block_count( bench_param( "PERF_REGRESSION_BLOCKS", 200 ) ),
+     block_trxs( bench_param( "PERF_REGRESSION_BLOCK_TRXS", 50 ) ),
+     produced_blocks( bench_param( "PERF_REGRESSION_PRODUCED_BLOCKS", 20 ) ),
+     api_calls( bench_param( "PERF_REGRESSION_API_CALLS", 20000 ) ),
+     runs( bench_param( "PERF_REGRESSION_RUNS", 3 ) ),
+     threshold_percent( bench_param( "PERF_REGRESSION_THRESHOLD", 20 ) ),
+     rng( 1 )
+   {}
+
+   /// accounts with balances, a snapshot of them, then blocks of transfers between them
+   void build_chain()
+   {
+      actor( 100000, bench_param( "PERF_REGRESSION_ACCOUNTS", 1000 ), account_keys );
+      uint32_t n = 0;
+      for( const auto& item : account_keys )
+      {
+         transfer( committee_account, item.first, asset( 10000000 ) );
+         if( ++n % 100 == 0 )
+            generate_block();
+      }
+      generate_block();
+      for( const auto& item : account_keys )
+         uids.push_back( item.first );
+
+      snapshot_dir = data_dir->path() / "perf_regression_snapshot";
+      db.export_state_snapshot( snapshot_dir );
+      db_version = read_snapshot_manifest( snapshot_dir ).db_version;
+      // signed, so that the synced node can check everything
+      for( uint32_t b = 0; b < block_count; ++b )
+      {
+         for( uint32_t t = 0; t < block_trxs; ++t )
+            db.push_transaction( make_transfer( db, next_transfer++ ), ~0 );
+         generate_block( database::skip_nothing );
+         blocks.push_back( *db.fetch_block_by_number( db.head_block_num() ) );
+      }
+   }
+
+   /// the given snapshot, and the blocks following its head block in the block database
+   void load_chain( const fc::path& snapshot, const fc::path& blocks_dir )
+   {
+      snapshot_dir = snapshot;
+      const state_snapshot_manifest manifest = read_snapshot_manifest( snapshot_dir );
+      db_version = manifest.db_version;
+      block_database block_db;
+      block_db.open( blocks_dir );
+      for( uint32_t num = block_header::num_from_id( manifest.head_block_id ) + 1; blocks.size() < block_count; ++num )
+      {
+         optional<signed_block> block = block_db.fetch_by_number( num );
+         if( !block.valid() )
+            break;
+         blocks.push_back( std::move( *block ) );
+      }
+      block_db.close();
+      BOOST_REQUIRE_MESSAGE( !blocks.empty(), "PERF_REGRESSION_BLOCKS_DIR has no blocks after the snapshot" );
+      BOOST_REQUIRE_MESSAGE( blocks.front().previous == manifest.head_block_id,
+                             "the blocks don't follow the head block of the snapshot" );
+   }
+
+   /// a node in @p dir of its own with the state of the snapshot imported, to be opened
+   std::unique_ptr<database> import_node( const fc::path& dir )
+   {
+      std::unique_ptr<database> node( new database );
+      node->import_state_snapshot( snapshot_dir, dir, db_version );
+      return node;
+   }
+
+   void open_node( database& node, const fc::path& dir )
+   {
+      node.open( dir, []() -> genesis_state_type {
+         FC_THROW( "The snapshot doesn't contain a state" );
+      }, db_version );
+   }
+
+   /// a node in @p dir of its own, at the head block of the snapshot
+   std::unique_ptr<database> open_node( const fc::path& dir )
+   {
+      std::unique_ptr<database> node = import_node( dir );
+      open_node( *node, dir );
+      return node;
+   }
+
+   /// accounts of @p state with core balances to transfer from, the synthetic ones have them already
+   void gather_accounts( const database& state )
+   {
+      if( !uids.empty() )
+         return;
+      for( const auto& a : state.get_index_type<account_index>().indices().get<by_id>() )
+      {
+         if( uids.size() >= 1000 )
+            break;
+         if( state.get_balance( a.uid, GRAPHENE_CORE_ASSET_AID ).amount > 100000 )
+            uids.push_back( a.uid );
+      }
+      BOOST_REQUIRE_MESSAGE( uids.size() >= 2, "the snapshot has too few accounts with balances" );
+   }
+
+   /// a transfer between two of the accounts, signed if their keys are known
+   signed_transaction make_transfer( const database& state, uint32_t n )
+   {
+      transfer_operation op;
+      op.from = uids[ n % uids.size() ];
+      op.to = uids[ ( n + 1 ) % uids.size() ];
+      op.amount = asset( 1 + n % 1000 );
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      set_operation_fees( tx, state.current_fee_schedule() );
+      test::set_expiration( state, tx );
+      auto itr = account_keys.find( op.from );
+      if( itr != account_keys.end() )
+         tx.sign( itr->second, state.get_chain_id() );
+      return tx;
+   }
+
+   /// the checks left out for a snapshot whose keys aren't known
+   uint32_t transaction_skip()const
+   {
+      return account_keys.empty() ? database::skip_transaction_signatures | database::skip_authority_check
+                                  : database::skip_nothing;
+   }
+
+   void replay_run( uint32_t run, vector<double>& blocks_per_sec, vector<double>& trxs_per_sec )
+   {
+      const fc::path dir = data_dir->path() / ( "perf_regression_replay_" + fc::to_string( run ) );
+      std::unique_ptr<database> node = import_node( dir );
+      size_t trxs = 0;
+      {
+         block_database block_db;
+         block_db.open( dir / "database" / "block_num_to_block" );
+         for( const auto& block : blocks )
+         {
+            block_db.store( block.id(), block );
+            trxs += block.transactions.size();
+         }
+         block_db.close();
+      }
+      // loading the state of the snapshot is part of it, as it is of a node restarted to replay
+      const fc::time_point start = fc::time_point::now();
+      open_node( *node, dir );
+      const fc::microseconds elapsed = fc::time_point::now() - start;
+      BOOST_REQUIRE( node->head_block_id() == blocks.back().id() );
+      blocks_per_sec.push_back( per_second( blocks.size(), elapsed ) );
+      trxs_per_sec.push_back( per_second( trxs, elapsed ) );
+      node->close( false );
+   }
+
+   /// the node is left open at the end of the blocks, for the stages which follow
+   std::unique_ptr<database> sync_run( uint32_t run, vector<double>& blocks_per_sec )
+   {
+      std::unique_ptr<database> node = open_node( data_dir->path() / ( "perf_regression_sync_" + fc::to_string( run ) ) );
+      sync_node receiver( *node );
+      {
+         graphene::net::simulated_network_ptr link( new graphene::net::simulated_network( "perf_regression" ) );
+         link->add_node_delegate( &receiver );
+         const fc::time_point start = fc::time_point::now();
+         for( const auto& block : blocks )
+            link->broadcast( graphene::net::block_message( block ) );
+         const block_id_type last = blocks.back().id();
+         const fc::time_point deadline = start + fc::minutes( 10 );
+         while( node->head_block_id() != last && receiver.failures == 0 && fc::time_point::now() < deadline )
+            fc::yield();
+         blocks_per_sec.push_back( per_second( blocks.size(), fc::time_point::now() - start ) );
+      }
+      BOOST_REQUIRE_EQUAL( receiver.failures, 0u );
+      BOOST_REQUIRE( node->head_block_id() == blocks.back().id() );
+      return node;
+   }
+
+   /// pushes the transfers of the blocks produced, then produces them
+   void produce( database& node )
+   {
+      gather_accounts( node );
+      const uint32_t trx_skip = transaction_skip();
+      const uint32_t block_skip = trx_skip | ( account_keys.empty() ? database::skip_witness_signature : 0 )
+                                           | database::skip_undo_history_check;
+      vector<int64_t> push_latencies;
+      vector<int64_t> block_latencies;
+      fc::microseconds push_time;
+      for( uint32_t b = 0; b < produced_blocks; ++b )
+      {
+         for( uint32_t t = 0; t < block_trxs; ++t )
+         {
+            const signed_transaction tx = make_transfer( node, next_transfer++ );
+            const fc::time_point start = fc::time_point::now();
+            node.push_transaction( tx, trx_skip );
+            const fc::microseconds elapsed = fc::time_point::now() - start;
+            push_latencies.push_back( elapsed.count() );
+            push_time += elapsed;
+         }
+         const fc::time_point start = fc::time_point::now();
+         const signed_block block = node.generate_block( node.get_slot_time( 1 ), node.get_scheduled_witness( 1 ),
+                                                         init_account_priv_key, block_skip );
+         block_latencies.push_back( ( fc::time_point::now() - start ).count() );
+         BOOST_CHECK_EQUAL( block.transactions.size(), block_trxs );
+      }
+      std::sort( push_latencies.begin(), push_latencies.end() );
+      std::sort( block_latencies.begin(), block_latencies.end() );
+      add_metric( "mempool_trxs_per_sec", per_second( push_latencies.size(), push_time ), true );
+      add_metric( "mempool_p99_us", latency_percentile( push_latencies, 0.99 ), false );
+      add_metric( "produce_block_p50_us", latency_percentile( block_latencies, 0.5 ), false );
+      add_metric( "produce_block_p99_us", latency_percentile( block_latencies, 0.99 ), false );
+   }
+
+   /// calls drawn from a weighted mix, the accounts at the front more likely, like popular accounts are
+   void query( database& node )
+   {
+      gather_accounts( node );
+      graphene::app::database_api api( node, &app.get_options() );
+      graphene::app::full_account_query_options all;
+      all.fetch_account_object = true;
+      all.fetch_statistics = true;
+      all.fetch_voter_object = true;
+      all.fetch_balances = true;
+      all.fetch_pledges = true;
+      auto account = [&]() {
+         const double u = std::uniform_real_distribution<double>( 0, 1 )( rng );
+         return uids[ std::min( uids.size() - 1, size_t( u * u * uids.size() ) ) ];
+      };
+      const uint32_t head = node.head_block_num();
+      const vector< std::pair< uint32_t, std::function<void()> > > mix = {
+         { 30, [&]() { api.get_full_accounts_by_uid( { account() }, all ); } },
+         { 20, [&]() { api.get_account_balances( account(), flat_set<asset_aid_type>() ); } },
+         { 15, [&]() { api.get_dynamic_global_properties(); } },
+         { 15, [&]() { api.get_accounts_by_uid( { account(), account(), account(), account(), account() } ); } },
+         { 10, [&]() { api.get_block_header( head - std::min<uint32_t>( head - 1, rng() % 100 ) ); } },
+         { 10, [&]() { api.get_block( head - std::min<uint32_t>( head - 1, rng() % 100 ) ); } },
+      };
+      uint32_t total_weight = 0;
+      for( const auto& call : mix )
+         total_weight += call.first;
+
+      vector<int64_t> latencies;
+      latencies.reserve( api_calls );
+      fc::microseconds total;
+      for( uint32_t i = 0; i < api_calls; ++i )
+      {
+         uint32_t pick = rng() % total_weight;
+         size_t c = 0;
+         while( pick >= mix[c].first )
+            pick -= mix[c++].first;
+         const fc::time_point start = fc::time_point::now();
+         mix[c].second();
+         const fc::microseconds elapsed = fc::time_point::now() - start;
+         latencies.push_back( elapsed.count() );
+         total += elapsed;
+      }
+      std::sort( latencies.begin(), latencies.end() );
+      add_metric( "api_calls_per_sec", per_second( latencies.size(), total ), true );
+      add_metric( "api_p99_us", latency_percentile( latencies, 0.99 ), false );
+   }
+
+   void add_metric( const string& name, double value, bool higher_is_better )
+   {
+      metrics.push_back( { name, value, higher_is_better } );
+   }
+
+   /// prints the metrics and checks them against the baseline, or writes them to it
+   void compare_with_baseline()
+   {
+      const char* path_env = std::getenv( "PERF_REGRESSION_BASELINE" );
+      const fc::path path( path_env != nullptr ? path_env : "perf_regression_baseline.json" );
+      fc::variant_object baseline;
+      if( std::getenv( "PERF_REGRESSION_WRITE_BASELINE" ) != nullptr )
+      {
+         fc::mutable_variant_object written;
+         for( const auto& m : metrics )
+            written( m.name, m.value );
+         fc::json::save_to_file( fc::variant( written ), path );
+         ilog( "Wrote the baseline to ${p}", ("p",path) );
+      }
+      else if( fc::exists( path ) )
+         baseline = fc::json::from_file( path ).get_object();
+      else
+         wlog( "No baseline at ${p}, the metrics are not compared", ("p",path) );
+
+      for( const auto& m : metrics )
+      {
+         fc::mutable_variant_object result;
+         result( "metric", m.name )( "value", m.value );
+         auto itr = baseline.find( m.name );
+         if( itr != baseline.end() && itr->value().as_double() > 0 )
+         {
+            const double base = itr->value().as_double();
+            const double change_percent = ( m.value - base ) * 100 / base;
+            const bool regressed = m.higher_is_better ? change_percent < -double( threshold_percent )
+                                                      : change_percent > double( threshold_percent );
+            result( "baseline", base )( "change_percent", change_percent )( "regressed", regressed );
+            BOOST_CHECK_MESSAGE( !regressed, m.name << " regressed by " << std::abs( change_percent )
+                                             << "%: " << m.value << " against " << base );
+         }
+         std::cout << "PERF_REGRESSION " << fc::json::to_string( result ) << std::endl;
+      }
+   }
+
+   const uint32_t     block_count;
+   const uint32_t     block_trxs;
+   const uint32_t     produced_blocks;
+   const uint32_t     api_calls;
+   const uint32_t     runs;
+   const uint32_t     threshold_percent;
+   std::mt19937       rng;
+
+   fc::path                                            snapshot_dir;
+   string                                              db_version;
+   /// the blocks following the snapshot
+   vector<signed_block>                                blocks;
+   /// the keys of the synthetic accounts, empty with a given snapshot
+   flat_map<account_uid_type, fc::ecc::private_key>    account_keys;
+   /// the accounts the transfers are between
+   vector<account_uid_type>                            uids;
+   uint32_t                                            next_transfer = 0;
+   vector<perf_metric>                                 metrics;
+};
+
+BOOST_FIXTURE_TEST_CASE( perf_regression, perf_regression_fixture )
+{
+   try {
+      const char* snapshot_env = std::getenv( "PERF_REGRESSION_SNAPSHOT" );
+      if( snapshot_env != nullptr )
+      {
+         const char* blocks_env = std::getenv( "PERF_REGRESSION_BLOCKS_DIR" );
+         BOOST_REQUIRE_MESSAGE( blocks_env != nullptr, "PERF_REGRESSION_SNAPSHOT requires PERF_REGRESSION_BLOCKS_DIR" );
+         load_chain( fc::path( snapshot_env ), fc::path( blocks_env ) );
+      }
+      else
+         build_chain();
+      ilog( "Measuring ${n} blocks after the snapshot", ("n",blocks.size()) );
+
+      vector<double> replay_blocks_per_sec;
+      vector<double> replay_trxs_per_sec;
+      for( uint32_t run = 0; run < runs; ++run )
+         replay_run( run, replay_blocks_per_sec, replay_trxs_per_sec );
+      add_metric( "replay_blocks_per_sec", median( replay_blocks_per_sec ), true );
+      add_metric( "replay_trxs_per_sec", median( replay_trxs_per_sec ), true );
+
+      vector<double> sync_blocks_per_sec;
+      std::unique_ptr<database> node;
+      for( uint32_t run = 0; run < runs; ++run )
+      {
+         if( node )
+            node->close( false );
+         node = sync_run( run, sync_blocks_per_sec );
+      }
+      add_metric( "sync_blocks_per_sec", median( sync_blocks_per_sec ), true );
+
+      produce( *node );
+      query( *node );
+      node->close( false );
+
+      compare_with_baseline();
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
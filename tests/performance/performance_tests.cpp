@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #include <boost/test/unit_test.hpp>
+#include <cstdlib>
 
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/protocol/protocol.hpp>
@@ -757,6 +758,97 @@ BOOST_AUTO_TEST_CASE(content_award_performance_test_3)
    }
 }
 
+BOOST_AUTO_TEST_CASE(content_award_performance_test_4)
+{
+   try{
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+
+      // Return number of core shares (times precision)
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+
+      // 1000000 active posts by default, set CONTENT_AWARD_BENCH_POSTS to change it
+      uint64_t post_count = 1000000;
+      if (const char* env = std::getenv("CONTENT_AWARD_BENCH_POSTS"))
+         post_count = std::strtoull(env, nullptr, 10);
+      const uint64_t platform_count = 100;
+
+      db.modify(db.get_global_properties(), [&](global_property_object& gp)
+      {
+         auto& ext = gp.parameters.extension_parameters;
+         ext.content_award_interval = 3600;
+         ext.total_content_award_amount = _core(1000000).amount;
+         ext.total_platform_content_award_amount = _core(1000000).amount;
+         ext.platform_content_award_min_votes = 0;
+      });
+      add_buget_pool(_core(10000000).amount);
+      // starts the first award period
+      generate_block();
+
+      flat_map<account_uid_type, fc::ecc::private_key> platform_map;
+      actor(700000, platform_count, platform_map);
+
+      vector<account_uid_type> platforms;
+      for (const auto& p : platform_map)
+      {
+         transfer(committee_account, p.first, _core(100000));
+         create_platform(p.first, "platform", _core(10000), "www.123456789.com", "", { p.second });
+         platforms.push_back(p.first);
+      }
+      generate_block();
+
+      // the posts go straight into the database, going through transactions and scores would take hours
+      const auto& dpo = db.get_dynamic_global_properties();
+      const uint64_t period = dpo.current_active_post_sequence;
+      const share_type min_csaf = db.get_global_properties().parameters.extension_parameters.min_effective_csaf;
+      {
+         auto session = db._undo_db.start_undo_session();
+         for (uint64_t i = 0; i < post_count; ++i)
+         {
+            const account_uid_type platform = platforms[i % platform_count];
+            const post_pid_type pid = i / platform_count + 1;
+            db.create<post_object>([&](post_object& post)
+            {
+               post.platform = platform;
+               post.poster = platform;
+               post.post_pid = pid;
+               post.receiptors[platform] = Receiptor_Parameter(GRAPHENE_100_PERCENT, false, 0, 0);
+               post.create_time = db.head_block_time();
+               post.last_update_time = db.head_block_time();
+            });
+            db.create<active_post_object>([&](active_post_object& act)
+            {
+               act.platform = platform;
+               act.poster = platform;
+               act.post_pid = pid;
+               act.total_csaf = min_csaf + int64_t(i % 1000);
+               act.period_sequence = period;
+            });
+         }
+         session.commit();
+      }
+
+      generate_blocks(dpo.next_content_award_time - db.get_global_properties().parameters.block_interval, true);
+
+      wlog("${n} active posts on ${p} platforms, content award begin........,${num}",
+         ("n", post_count)("p", platform_count)("num", db.head_block_num()));
+      auto start = fc::time_point::now();
+      generate_block();
+      auto end = fc::time_point::now();
+      auto elapsed = end - start;
+      wlog("${n} active posts on ${p} platforms, content award spend ${total}ms",
+         ("n", post_count)("p", platform_count)("total", elapsed.count() / 1000));
+
+      BOOST_CHECK(dpo.last_content_award_time == db.head_block_time());
+
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 
 // See https://bitshares.org/blog/2015/06/08/measuring-performance/
 // (note this is not the original test mentioned in the above post, but was
@@ -0,0 +1,568 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/app/api.hpp>
+#include <graphene/app/block_feed.hpp>
+#include <graphene/app/database_api.hpp>
+#include <graphene/app/json_reader.hpp>
+#include <graphene/app/json_stream.hpp>
+#include <graphene/app/object_change_feed.hpp>
+#include <graphene/app/packed_rpc.hpp>
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/protocol/protocol.hpp>
+
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/exceptions.hpp>
+#include <graphene/chain/hardfork.hpp>
+
+#include <graphene/utilities/thread_pool.hpp>
+
+#include <fc/io/json.hpp>
+#include "../common/database_fixture.hpp"
+
+#include <map>
+#include <mutex>
+#include <sstream>
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+BOOST_FIXTURE_TEST_SUITE( api_tests, database_fixture )
+
+BOOST_AUTO_TEST_CASE( block_feed_test )
+{ try {
+   std::mutex mutex;
+   vector< std::pair<string,uint32_t> > processed;
+   auto record = [&]( const string& name, uint32_t block_num ) {
+      std::lock_guard<std::mutex> guard( mutex );
+      processed.emplace_back( name, block_num );
+   };
+
+   {
+      graphene::app::block_feed feed( 2 );
+      // subscribed before its dependency, still gets each block after it
+      feed.subscribe( "second", { "first", "missing" }, [&]( const graphene::app::applied_block_changes& c ) {
+         record( "second", c.block_num );
+      } );
+      feed.subscribe( "first", {}, [&]( const graphene::app::applied_block_changes& c ) {
+         fc::usleep( fc::milliseconds( 5 ) );
+         record( "first", c.block_num );
+      } );
+      BOOST_CHECK_THROW( feed.subscribe( "first", {}, []( const graphene::app::applied_block_changes& ) {} ),
+                         fc::exception );
+
+      for( uint32_t block_num = 1; block_num <= 5; ++block_num )
+      {
+         std::shared_ptr<graphene::app::applied_block_changes> changes = std::make_shared<graphene::app::applied_block_changes>();
+         changes->block_num = block_num;
+         feed.push( changes );
+      }
+      feed.flush();
+   }
+
+   BOOST_REQUIRE_EQUAL( processed.size(), 10u );
+   map<string,uint32_t> last;
+   for( const auto& p : processed )
+   {
+      // in order for each subscriber, and a block reaches the second one after the first
+      BOOST_CHECK_EQUAL( p.second, last[p.first] + 1 );
+      last[p.first] = p.second;
+      if( p.first == "second" )
+         BOOST_CHECK_GE( last["first"], p.second );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_result_cache_test )
+{ try {
+   graphene::app::application_options options;
+   graphene::app::database_api api( db, &options );
+   graphene::app::database_api other_api( db, &options );
+
+   BOOST_CHECK_EQUAL( api.get_dynamic_global_properties().head_block_number, db.head_block_num() );
+   BOOST_CHECK( other_api.get_dynamic_global_properties().head_block_id == db.head_block_id() );
+   const auto witnesses = api.lookup_witnesses( 0, 101, graphene::app::order_by_uid );
+   BOOST_CHECK_EQUAL( other_api.lookup_witnesses( 0, 101, graphene::app::order_by_uid ).size(), witnesses.size() );
+   BOOST_CHECK_EQUAL( other_api.lookup_witnesses( 0, 1, graphene::app::order_by_uid ).size(), 1u );
+
+   // a new block drops what was cached
+   generate_block();
+   BOOST_CHECK_EQUAL( api.get_dynamic_global_properties().head_block_number, db.head_block_num() );
+   BOOST_CHECK( other_api.get_dynamic_global_properties().head_block_id == db.head_block_id() );
+
+   // as does a change of the pending state, what is cached is kept as long as it doesn't change
+   const uint32_t registered = api.get_dynamic_global_properties().accounts_registered_this_interval;
+   auto change_registered = [this]( int32_t delta ) {
+      db.modify( db.get_dynamic_global_properties(), [delta]( dynamic_global_property_object& d ) {
+         d.accounts_registered_this_interval += delta;
+      });
+   };
+   change_registered( 1 );
+   BOOST_CHECK_EQUAL( other_api.get_dynamic_global_properties().accounts_registered_this_interval, registered );
+   const uint64_t revision = db.pending_state_revision();
+   ACTORS((1000));
+   BOOST_CHECK_NE( db.pending_state_revision(), revision );
+   BOOST_CHECK_EQUAL( other_api.get_dynamic_global_properties().accounts_registered_this_interval, registered + 1 );
+   db.clear_pending();
+   change_registered( -1 );
+   generate_block();
+   BOOST_CHECK_EQUAL( api.get_dynamic_global_properties().accounts_registered_this_interval, registered );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( post_notification_content_test )
+{ try {
+   graphene::app::application_options options;
+   graphene::app::database_api api( db, &options );
+   vector<fc::variant> updates;
+   api.set_subscribe_callback( [&updates]( const fc::variant& v ) {
+      for( const fc::variant& update : v.get_array() )
+         updates.push_back( update );
+   }, false );
+
+   auto session = db._undo_db.start_undo_session();
+   const post_object& post = db.create<post_object>( []( post_object& p ) {
+      p.platform = 100;
+      p.poster = 200;
+      p.post_pid = 1;
+   });
+   api.get_objects( { post.id } );
+
+   // a change notification carries the body kept in the post content store, as get_objects() does
+   const string body( GRAPHENE_POST_CONTENT_INLINE_MAX + 1, 'p' );
+   db.modify( post, [&]( post_object& p ) {
+      db.set_post_content( body, p.body, p.body_ref );
+   });
+   BOOST_REQUIRE( post.body_ref.valid() );
+   db.notify_changed_objects();
+   for( int i = 0; i < 100 && updates.empty(); ++i )
+      fc::usleep( fc::milliseconds( 5 ) );
+   BOOST_REQUIRE_EQUAL( updates.size(), 1u );
+   BOOST_CHECK_EQUAL( updates[0]["body"].as_string(), body );
+   const fc::variant_object& update = updates[0].get_object();
+   BOOST_CHECK( update.find( "body_ref" ) == update.end() || update["body_ref"].is_null() );
+   session.undo();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( object_page_test )
+{ try {
+   graphene::app::application_options options;
+   graphene::app::database_api api( db, &options );
+   auto session = db._undo_db.start_undo_session();
+   for( post_pid_type pid = 1; pid <= 5; ++pid )
+   {
+      db.create<post_object>( [pid]( post_object& p ) {
+         p.platform = 100;
+         p.poster = ( pid == 5 ? 300 : 200 );
+         p.post_pid = pid;
+      });
+   }
+
+   const fc::variants args = { fc::variant( 100 ), fc::variant( 200 ) };
+   const vector<string> fields = { "post_pid" };
+   vector<post_pid_type> pids;
+   string cursor;
+   uint32_t pages = 0;
+   do
+   {
+      const graphene::app::object_page page = api.list_objects_page( "posts_by_platform_poster", args, cursor, 3, fields );
+      BOOST_CHECK_EQUAL( page.head_block_num, db.head_block_num() );
+      for( const fc::variant& v : page.objects )
+      {
+         BOOST_REQUIRE_EQUAL( v.get_object().size(), 1u );
+         pids.push_back( v["post_pid"].as_uint64() );
+      }
+      cursor = page.next_cursor;
+      ++pages;
+   } while( !cursor.empty() && pages < 10 );
+   BOOST_CHECK_EQUAL( pages, 2u );
+   BOOST_CHECK( pids == vector<post_pid_type>( { 1, 2, 3, 4 } ) );
+
+   // all fields without a projection, and another list doesn't take the cursor
+   const auto first = api.list_objects_page( "posts_by_platform", { fc::variant( 100 ) }, "", 4, {} );
+   BOOST_CHECK_EQUAL( first.objects.size(), 4u );
+   BOOST_CHECK( first.objects[0].get_object().contains( "poster" ) );
+   BOOST_REQUIRE( !first.next_cursor.empty() );
+   BOOST_CHECK_EQUAL( api.list_objects_page( "posts_by_platform", { fc::variant( 100 ) }, first.next_cursor, 4, {} ).objects.size(), 1u );
+   GRAPHENE_CHECK_THROW( api.list_objects_page( "posts_by_platform_poster", args, first.next_cursor, 4, {} ), fc::exception );
+   GRAPHENE_CHECK_THROW( api.list_objects_page( "no_such_list", args, "", 4, {} ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( json_stream_test )
+{ try {
+   graphene::app::Platform_Period_Profit_Detail detail;
+   detail.cur_period = 7;
+   detail.platform_account = 100;
+   detail.platform_name = "a \"quoted\" name";
+   detail.rewards_profits[ GRAPHENE_CORE_ASSET_AID ] = 5000000000ll;
+   detail.platform_profits = 12;
+   for( post_pid_type pid = 1; pid <= 2; ++pid )
+   {
+      active_post_object post;
+      post.platform = 100;
+      post.poster = 200;
+      post.post_pid = pid;
+      post.period_sequence = 7;
+      detail.active_objects.push_back( post );
+   }
+   graphene::app::Platform_Period_Profit_Detail empty;
+   empty.cur_period = 8;
+   empty.platform_account = 100;
+   const vector<graphene::app::Platform_Period_Profit_Detail> details = { detail, empty };
+
+   std::ostringstream out;
+   graphene::app::write_json( out, details, GRAPHENE_MAX_NESTED_OBJECTS );
+   BOOST_CHECK_EQUAL( out.str(), fc::json::to_string( fc::variant( details, GRAPHENE_MAX_NESTED_OBJECTS ) ) );
+
+   std::ostringstream none;
+   graphene::app::write_json( none, optional<graphene::app::object_page>(), GRAPHENE_MAX_NESTED_OBJECTS );
+   BOOST_CHECK_EQUAL( none.str(), "null" );
+   GRAPHENE_CHECK_THROW( graphene::app::write_json( none, details, 2 ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( packed_rpc_test )
+{ try {
+   graphene::app::application_options options;
+   fc::api<graphene::app::database_api> api = std::make_shared<graphene::app::database_api>( std::ref( db ), &options );
+   graphene::app::packed_rpc_apis apis;
+   BOOST_CHECK_EQUAL( apis.add_api( api ), 0u );
+
+   graphene::app::packed_rpc_request request;
+   request.id = 7;
+   request.method = "get_account_count";
+   auto response = fc::raw::unpack<graphene::app::packed_rpc_response>( apis.call( fc::raw::pack( request ) ) );
+   BOOST_CHECK_EQUAL( response.id, 7u );
+   BOOST_REQUIRE( response.ok );
+   BOOST_CHECK_EQUAL( fc::raw::unpack<uint64_t>( response.result ), api->get_account_count() );
+
+   // arguments are packed one after another
+   request.method = "lookup_witnesses";
+   fc::datastream<size_t> size_stream;
+   fc::raw::pack( size_stream, account_uid_type( 0 ) );
+   fc::raw::pack( size_stream, uint32_t( 101 ) );
+   fc::raw::pack( size_stream, graphene::app::order_by_uid );
+   request.args.resize( size_stream.tellp() );
+   fc::datastream<char*> args_stream( request.args.data(), request.args.size() );
+   fc::raw::pack( args_stream, account_uid_type( 0 ) );
+   fc::raw::pack( args_stream, uint32_t( 101 ) );
+   fc::raw::pack( args_stream, graphene::app::order_by_uid );
+   response = fc::raw::unpack<graphene::app::packed_rpc_response>( apis.call( fc::raw::pack( request ) ) );
+   BOOST_REQUIRE( response.ok );
+   BOOST_CHECK_EQUAL( fc::raw::unpack<vector<witness_object>>( response.result ).size(),
+                      api->lookup_witnesses( 0, 101, graphene::app::order_by_uid ).size() );
+
+   // errors are answered, not thrown
+   request.method = "no_such_method";
+   response = fc::raw::unpack<graphene::app::packed_rpc_response>( apis.call( fc::raw::pack( request ) ) );
+   BOOST_CHECK( !response.ok );
+   BOOST_CHECK( !response.error.empty() );
+   response = fc::raw::unpack<graphene::app::packed_rpc_response>( apis.call( vector<char>() ) );
+   BOOST_CHECK( !response.ok );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( account_batch_api_test )
+{ try {
+   ACTORS((1000)(2000));
+   graphene::app::application_options options;
+   graphene::app::database_api api( db, &options );
+
+   // the accounts of a repeated key are returned once
+   const auto uids = api.get_key_account_uids( { u_1000_public_key, u_2000_public_key, u_1000_public_key } );
+   BOOST_CHECK( uids == flat_set<account_uid_type>( { u_1000_id, u_2000_id } ) );
+
+   graphene::app::full_account_query_options query;
+   query.fetch_balances = true;
+   query.fetch_pledges = true;
+   const auto sections = api.get_full_account_sections( { u_1000_id, u_2000_id, u_1000_id, 1 }, query );
+   BOOST_REQUIRE_EQUAL( sections.size(), 2u );
+   const fc::variant_object& account = sections.at( u_1000_id );
+   BOOST_CHECK_EQUAL( account.size(), 2u );
+   BOOST_CHECK( account.contains( "balances" ) );
+   BOOST_CHECK( account.contains( "pledges" ) );
+
+   const auto full = api.get_full_accounts_by_uid( { u_2000_id, u_2000_id }, query );
+   BOOST_REQUIRE_EQUAL( full.size(), 1u );
+   BOOST_CHECK_EQUAL( full.at( u_2000_id ).balances.size(),
+                      sections.at( u_2000_id )["balances"].get_array().size() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( transaction_requirements_test )
+{ try {
+   ACTORS((1000)(2000));
+   graphene::app::application_options options;
+   graphene::app::database_api api( db, &options );
+
+   vector<signed_transaction> trxs;
+   for( account_uid_type from : { u_1000_id, u_2000_id, u_1000_id } )
+   {
+      signed_transaction trx;
+      transfer_operation op;
+      op.from = from;
+      op.to = ( from == u_1000_id ? u_2000_id : u_1000_id );
+      op.amount = asset( 1 );
+      trx.operations.push_back( op );
+      trxs.push_back( trx );
+   }
+   const flat_set<public_key_type> keys = { u_1000_public_key };
+
+   const auto results = api.get_transaction_requirements( trxs, keys );
+   BOOST_REQUIRE_EQUAL( results.size(), trxs.size() );
+   for( size_t i = 0; i < trxs.size(); ++i )
+   {
+      const auto single = api.get_required_signatures( trxs[i], keys );
+      BOOST_CHECK( results[i].usable_keys == single.first.first );
+      BOOST_CHECK( results[i].missing_keys == single.first.second );
+      BOOST_CHECK( results[i].redundant_signatures == single.second );
+      const auto fees = api.get_required_fee_data( trxs[i].operations );
+      BOOST_REQUIRE_EQUAL( results[i].fees.size(), fees.size() );
+      BOOST_CHECK( results[i].fees[0].fee_payer_uid == fees[0].fee_payer_uid );
+      BOOST_CHECK_EQUAL( results[i].fees[0].min_fee, fees[0].min_fee );
+   }
+   BOOST_CHECK( results[0].usable_keys.count( u_1000_public_key ) );
+   BOOST_CHECK( results[1].usable_keys.empty() );
+
+   GRAPHENE_CHECK_THROW( api.get_transaction_requirements( vector<signed_transaction>( 101 ), keys ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( object_change_feed_test )
+{ try {
+   ACTORS((1000));
+   generate_block();
+   graphene::app::object_change_feed feed( 1000 );
+   feed.connect( db );
+
+   transfer( committee_account, u_1000_id, asset(10000) );
+   generate_block();
+   auto page = feed.get_changes( 0, 1000 );
+   BOOST_CHECK_EQUAL( page.first_sequence, 1u );
+   BOOST_REQUIRE( !page.changes.empty() );
+   BOOST_CHECK_EQUAL( page.next_sequence, page.changes.size() + 1 );
+   for( const auto& change : page.changes )
+      BOOST_CHECK_EQUAL( change.block_num, db.head_block_num() );
+
+   // a reader going on from where it was only gets the new changes
+   const uint64_t next = page.next_sequence;
+   generate_block();
+   page = feed.get_changes( next, 1000 );
+   BOOST_REQUIRE( !page.changes.empty() );
+   BOOST_CHECK_EQUAL( page.changes.front().sequence, next );
+
+   // what the popped blocks changed has to be read again
+   const uint32_t popped_num = db.head_block_num() - 1;
+   db.pop_block();
+   db.pop_block();
+   generate_block();
+   page = feed.get_changes( page.next_sequence, 1000 );
+   BOOST_REQUIRE( !page.changes.empty() );
+   BOOST_CHECK( page.changes.front().type == graphene::app::object_reverted );
+   BOOST_CHECK_EQUAL( page.changes.front().block_num, popped_num );
+
+   // saved and loaded at the same head the changes are kept, at another only the sequence numbers
+   const fc::path file = data_dir->path() / "object_changes.bin";
+   feed.save( file, db.head_block_id() );
+   graphene::app::object_change_feed same_head( 1000 );
+   same_head.load( file, db.head_block_id() );
+   BOOST_CHECK_EQUAL( same_head.get_changes( 0, 1000 ).changes.size(), feed.get_changes( 0, 1000 ).changes.size() );
+   graphene::app::object_change_feed other_head( 1000 );
+   other_head.load( file, block_id_type() );
+   const auto other_page = other_head.get_changes( 0, 1000 );
+   BOOST_CHECK( other_page.changes.empty() );
+   BOOST_CHECK_EQUAL( other_page.first_sequence, page.next_sequence );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( api_threads_test )
+{ try {
+   graphene::utilities::thread_pool pool( 2, "api" );
+   graphene::app::application_options options;
+   options.api_thread_pool = &pool;
+   graphene::app::database_api api( db, &options );
+
+   for( int i = 0; i < 3; ++i )
+   {
+      BOOST_CHECK_EQUAL( api.get_dynamic_global_properties().head_block_number, db.head_block_num() );
+      BOOST_CHECK( !api.lookup_witnesses( 0, 101, graphene::app::order_by_uid ).empty() );
+      generate_block();
+   }
+
+   // the reads wait while the chain thread holds the state
+   fc::future<uint32_t> read;
+   {
+      database::state_write_scope write_scope( db );
+      read = fc::async( [&]() { return api.get_dynamic_global_properties().head_block_number; } );
+      fc::usleep( fc::milliseconds( 50 ) );
+      BOOST_CHECK( !read.ready() );
+      generate_block();
+   }
+   BOOST_CHECK_EQUAL( read.wait(), db.head_block_num() );
+
+   // the calls are recorded by method, the failed ones too
+   graphene::app::api_call_profiler profiler;
+   options.api_calls = &profiler;
+   for( int i = 0; i < 3; ++i )
+      api.get_dynamic_global_properties();
+   GRAPHENE_CHECK_THROW( api.lookup_witnesses( 0, 102, graphene::app::order_by_uid ), fc::exception );
+   const vector<graphene::app::api_call_profile> profiles = api.get_api_call_profile();
+   BOOST_REQUIRE_EQUAL( profiles.size(), 2u );
+   BOOST_CHECK_EQUAL( profiles[0].method, "get_dynamic_global_properties" );
+   BOOST_CHECK_EQUAL( profiles[0].count, 3u );
+   BOOST_CHECK_EQUAL( profiles[0].failed, 0u );
+   BOOST_CHECK_GE( profiles[0].run_us, profiles[0].max_run_us );
+   BOOST_CHECK_EQUAL( profiles[1].method, "lookup_witnesses" );
+   BOOST_CHECK_EQUAL( profiles[1].count, 1u );
+   BOOST_CHECK_EQUAL( profiles[1].failed, 1u );
+
+   // the calls of a session run one at a time, in order
+   vector<fc::future<uint32_t>> reads;
+   for( int i = 0; i < 4; ++i )
+      reads.push_back( fc::async( [&]() { return api.get_dynamic_global_properties().head_block_number; } ) );
+   for( auto& r : reads )
+      BOOST_CHECK_EQUAL( r.wait(), db.head_block_num() );
+   BOOST_CHECK_EQUAL( api.get_api_call_profile()[0].count, 7u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( api_call_budget_test )
+{ try {
+   const fc::time_point start = fc::time_point::now();
+   // 1 ms per second, up to 2 ms saved up
+   graphene::app::api_call_budget budget( 1000, 2000 );
+   budget.admit( "test", start );
+   budget.charge( fc::microseconds( 5000 ) );
+   BOOST_CHECK_EQUAL( budget.available_us( start ), -3000 );
+   GRAPHENE_CHECK_THROW( budget.admit( "test", start ), fc::exception );
+   // refilled at the rate, up to the burst
+   BOOST_CHECK_NO_THROW( budget.admit( "test", start + fc::seconds( 4 ) ) );
+   BOOST_CHECK_EQUAL( budget.available_us( start + fc::seconds( 60 ) ), 2000 );
+
+   // no rate, no limit
+   graphene::app::api_call_budget unlimited;
+   unlimited.charge( fc::seconds( 10 ) );
+   BOOST_CHECK_NO_THROW( unlimited.admit( "test" ) );
+
+   // a session over budget has its calls rejected
+   graphene::app::application_options options;
+   options.api_budget_us_per_second = 1;
+   options.api_budget_burst_us = 1;
+   graphene::app::database_api api( db, &options );
+   bool rejected = false;
+   for( int i = 0; i < 100 && !rejected; ++i )
+   {
+      try
+      {
+         api.get_dynamic_global_properties();
+      }
+      catch( const fc::exception& )
+      {
+         rejected = true;
+      }
+   }
+   BOOST_CHECK( rejected );
+   // so are the calls of the history API of the connection, which read the state through its database API
+   bool history_read = false;
+   GRAPHENE_CHECK_THROW( api.read_state( "get_account_history", [&]() { history_read = true; } ), fc::exception );
+   BOOST_CHECK( !history_read );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( json_reader_test )
+{ try {
+   using graphene::app::read_json;
+   const fc::ecc::private_key key = fc::ecc::private_key::regenerate( fc::sha256::hash( string( "json_reader" ) ) );
+   signed_transaction trx;
+   trx.set_expiration( fc::time_point_sec( 1559318400 ) );
+   trx.ref_block_num = 1234;
+   trx.ref_block_prefix = 0x12345678;
+   transfer_operation op;
+   op.from = 1000;
+   op.to = 1001;
+   op.amount = asset( 5000000000ll );
+   op.memo = memo_data();
+   op.memo->message = vector<char>( 40, 'm' );
+   trx.operations.push_back( op );
+   trx.sign( key, chain_id_type() );
+
+   // read as fc::json and fc::variant would
+   const string json = fc::json::to_string( fc::variant( trx, GRAPHENE_MAX_NESTED_OBJECTS ) );
+   const signed_transaction read = read_json<signed_transaction>( json, GRAPHENE_MAX_NESTED_OBJECTS );
+   BOOST_CHECK( fc::raw::pack( read ) == fc::raw::pack( trx ) );
+   const string pretty = fc::json::to_pretty_string( fc::variant( trx, GRAPHENE_MAX_NESTED_OBJECTS ) );
+   BOOST_CHECK( fc::raw::pack( read_json<signed_transaction>( pretty, GRAPHENE_MAX_NESTED_OBJECTS ) ) == fc::raw::pack( trx ) );
+
+   // unknown members are skipped, missing ones left as they are, integers may be strings
+   const signed_transaction partial = read_json<signed_transaction>(
+         "{ \"unknown\": {\"a\":[1,\"]}\"]}, \"ref_block_num\": \"77\", \"signatures\": [] }", GRAPHENE_MAX_NESTED_OBJECTS );
+   BOOST_CHECK_EQUAL( partial.ref_block_num, 77u );
+   BOOST_CHECK_EQUAL( partial.ref_block_prefix, 0u );
+   BOOST_CHECK( partial.operations.empty() );
+
+   // the escapes, and strings long enough to be scanned 16 bytes at a time
+   const string text = string( 40, 'x' ) + "\"\\/\b\f\n\r\t\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80" + string( 20, 'y' );
+   const string quoted = fc::json::to_string( fc::variant( text ) );
+   BOOST_CHECK_EQUAL( read_json<string>( quoted, 1 ), text );
+   BOOST_CHECK_EQUAL( read_json<string>( "\"\\u00e9\\ud83d\\ude00\"", 1 ), "\xc3\xa9\xf0\x9f\x98\x80" );
+   const vector<optional<bool>> flags = read_json< vector<optional<bool>> >( "[true, null ,false]", 2 );
+   BOOST_REQUIRE_EQUAL( flags.size(), 3u );
+   BOOST_CHECK( flags[0].valid() && *flags[0] );
+   BOOST_CHECK( !flags[1].valid() );
+   BOOST_CHECK( flags[2].valid() && !*flags[2] );
+
+   GRAPHENE_CHECK_THROW( read_json<signed_transaction>( json + "x", GRAPHENE_MAX_NESTED_OBJECTS ), fc::exception );
+   GRAPHENE_CHECK_THROW( read_json<signed_transaction>( json.substr( 0, json.size() / 2 ), GRAPHENE_MAX_NESTED_OBJECTS ),
+                         fc::exception );
+   GRAPHENE_CHECK_THROW( read_json<uint16_t>( "65536", 1 ), fc::exception );
+   GRAPHENE_CHECK_THROW( read_json<uint32_t>( "-1", 1 ), fc::exception );
+   GRAPHENE_CHECK_THROW( read_json<string>( "\"abc", 1 ), fc::exception );
+   GRAPHENE_CHECK_THROW( read_json< vector<vector<uint32_t>> >( "[[1]]", 1 ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( asset_holders_test )
+{ try {
+   ACTORS((1000)(2000)(3000)(4000)(5000)(6000)(7000));
+   transfer( committee_account, u_1000_id, asset( 100000000 ) );
+   transfer( committee_account, u_7000_id, asset( 100000000 ) );
+   add_csaf_for_account( u_1000_id, 10000 );
+   add_csaf_for_account( u_7000_id, 10000 );
+   generate_blocks( HARDFORK_0_5_TIME, true );
+
+   asset_options asset_ops;
+   asset_ops.max_supply = 1000000;
+   asset_ops.issuer_permissions = 15;
+   asset_ops.description = "test asset";
+   create_asset( { u_1000_private_key }, u_1000_id, "ABC", 2, asset_ops, 1000000 );
+   const asset_aid_type abc = 1;
+   const vector<account_uid_type> holders = { u_2000_id, u_3000_id, u_4000_id, u_5000_id, u_6000_id };
+   for( size_t i = 0; i < holders.size(); ++i )
+      transfer( u_1000_id, holders[i], asset( 500 - 100 * i, abc ) );
+   // a balance back at zero doesn't count
+   transfer( u_1000_id, u_7000_id, asset( 50, abc ) );
+   transfer( u_7000_id, u_1000_id, asset( 50, abc ) );
+   generate_block();
+
+   graphene::app::application_options options;
+   options.api_limit_get_asset_holders = 3;
+   graphene::app::asset_api api( db, &options );
+   BOOST_CHECK_EQUAL( api.get_asset_holders_count( abc ), 6u );
+
+   // the pages go through the holders, largest balances first
+   vector<account_uid_type> expected = { u_1000_id };
+   expected.insert( expected.end(), holders.begin(), holders.end() );
+   vector<account_uid_type> paged;
+   for( uint32_t start = 0; start < 6; start += 3 )
+   {
+      const auto page = api.get_asset_holders( abc, start, 3 );
+      BOOST_CHECK_EQUAL( page.size(), 3u );
+      for( const auto& holder : page )
+         paged.push_back( holder.account_uid );
+   }
+   BOOST_CHECK( paged == expected );
+   const auto last = api.get_asset_holders( abc, 5, 3 );
+   BOOST_REQUIRE_EQUAL( last.size(), 1u );
+   BOOST_CHECK_EQUAL( last.front().account_uid, u_6000_id );
+   BOOST_CHECK( last.front().amount == 100 );
+   BOOST_CHECK( api.get_asset_holders( abc, 0, 0 ).empty() );
+
+   // past the last holder
+   BOOST_CHECK( api.get_asset_holders( abc, 6, 3 ).empty() );
+   BOOST_CHECK( api.get_asset_holders( abc, 1000, 3 ).empty() );
+   BOOST_CHECK( api.get_asset_holders( 100, 0, 3 ).empty() );
+
+   // more than the limit
+   GRAPHENE_CHECK_THROW( api.get_asset_holders( abc, 0, 4 ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -26,18 +26,28 @@
 
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/protocol/protocol.hpp>
+#include <graphene/chain/protocol/sign_state.hpp>
 
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/exceptions.hpp>
 
 #include <graphene/db/simple_index.hpp>
+#include <graphene/utilities/async_file_writer.hpp>
+#include <graphene/utilities/async_log.hpp>
+#include <graphene/utilities/cpu_affinity.hpp>
+#include <graphene/utilities/key_conversion.hpp>
+#include <graphene/utilities/metrics.hpp>
+#include <graphene/utilities/tempdir.hpp>
+#include <graphene/utilities/thread_pool.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/hex.hpp>
 #include "../common/database_fixture.hpp"
 
 #include <algorithm>
+#include <mutex>
+#include <numeric>
 #include <random>
 
 using namespace graphene::chain;
@@ -64,7 +74,6 @@ BOOST_AUTO_TEST_CASE( memo_test )
    BOOST_CHECK_EQUAL(m.get_message(receiver, sender.get_public_key()), "Hello, world!");
 } FC_LOG_AND_RETHROW() }
 
-
 BOOST_AUTO_TEST_CASE( scaled_precision )
 {
    const int64_t _k = 1000;
@@ -273,4 +282,190 @@ BOOST_AUTO_TEST_CASE( merkle_root )
    BOOST_CHECK( block.calculate_merkle_root() == c(dO) );
 }
 
+BOOST_AUTO_TEST_CASE( parallel_merkle_root_test )
+{ try {
+   graphene::utilities::thread_pool pool( 3, "merkle" );
+   auto for_each = [&pool]( size_t count, const std::function<void(size_t)>& f ) { pool.parallel_for( count, f ); };
+   signed_block b;
+   for( uint32_t n : { 0, 1, 2, 3, 7, 64, 65, 200 } )
+   {
+      while( b.transactions.size() < n )
+      {
+         signed_transaction tx;
+         tx.ref_block_num = b.transactions.size();
+         b.transactions.push_back( tx );
+      }
+      // odd levels are carried over the same way by both versions
+      BOOST_CHECK( b.calculate_merkle_root( for_each, 2 ) == b.calculate_merkle_root() );
+      BOOST_CHECK( b.calculate_merkle_root( for_each, 64 ) == b.calculate_merkle_root() );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( async_log_test )
+{ try {
+   // the messages are built on the log thread, in the order they were handed over
+   std::mutex mutex;
+   vector<int> built;
+   for( int i = 0; i < 5; ++i )
+      graphene::utilities::async_log( fc::logger::get( "async_log_test" ), [&mutex,&built,i]() {
+         std::lock_guard<std::mutex> lock( mutex );
+         built.push_back( i );
+         return fc::log_message( FC_LOG_CONTEXT(debug), "message ${i}", fc::mutable_variant_object()("i",i) );
+      } );
+   // a message that fails to be built doesn't stop the others
+   graphene::utilities::async_log( fc::logger::get( "async_log_test" ), []() -> fc::log_message {
+      FC_THROW( "not built" );
+   } );
+   graphene::utilities::flush_async_log();
+   std::lock_guard<std::mutex> lock( mutex );
+   BOOST_CHECK( built == vector<int>( { 0, 1, 2, 3, 4 } ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( derive_keys_test )
+{ try {
+   const string prefix = "ALPHA BRAVO CHARLIE";
+   graphene::utilities::thread_pool pool( 3, "derive" );
+   const auto serial = graphene::utilities::derive_keys( prefix, 5, 20 );
+   const auto parallel = graphene::utilities::derive_keys( prefix, 5, 20, &pool );
+   BOOST_REQUIRE_EQUAL( serial.size(), 20u );
+   BOOST_REQUIRE_EQUAL( parallel.size(), 20u );
+   for( int i = 0; i < 20; ++i )
+   {
+      const fc::ecc::private_key expected = graphene::utilities::derive_private_key( prefix, 5 + i );
+      BOOST_CHECK( serial[i].private_key == expected );
+      BOOST_CHECK( parallel[i].private_key == expected );
+      BOOST_CHECK( parallel[i].public_key == expected.get_public_key() );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( signed_information_real_uid_test )
+{
+   typedef signed_information::sign_tree sign_tree;
+   const public_key_type key = fc::ecc::private_key::regenerate( fc::sha256::hash( string( "key" ) ) ).get_public_key();
+
+   // 1 signed through its only authority 2, which signed through 3 with a key
+   sign_tree leaf( 3 );
+   leaf.pub_keys.insert( key );
+   sign_tree middle( 2 );
+   middle.children.insert( leaf );
+   sign_tree root( 1 );
+   root.children.insert( middle );
+
+   signed_information sigs;
+   sigs.secondary[1] = root;
+   sigs.active[1] = root;
+   BOOST_CHECK_EQUAL( sigs.real_secondary_uid( 1, 0 ), 1u );
+   BOOST_CHECK_EQUAL( sigs.real_secondary_uid( 1, 1 ), 2u );
+   BOOST_CHECK_EQUAL( sigs.real_secondary_uid( 1, 5 ), 3u );
+   BOOST_CHECK_EQUAL( sigs.real_active_uid( 1, 1 ), 2u );
+   BOOST_CHECK_EQUAL( sigs.real_owner_uid( 1, 1 ), 0u );
+   BOOST_CHECK_EQUAL( sigs.real_secondary_uid( 4, 1 ), 0u );
+
+   // a key of its own stops the descent
+   sigs.secondary[1].pub_keys.insert( key );
+   BOOST_CHECK_EQUAL( sigs.real_secondary_uid( 1, 5 ), 1u );
+}
+
+BOOST_AUTO_TEST_CASE( async_file_writer_test )
+{ try {
+   fc::temp_directory dir( graphene::utilities::temp_directory_path() );
+   const std::string filename = ( dir.path() / "stream" ).string();
+   std::string expected;
+   auto read_file = [&]() {
+      std::ifstream in( filename, std::ios::binary );
+      return std::string( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+   };
+   {
+      // a tiny buffer makes write() wait for the writer thread
+      graphene::utilities::async_file_writer writer( filename, 16 );
+      for( int i = 0; i < 10000; ++i )
+      {
+         const std::string s = std::to_string( i ) + ",";
+         writer.write( s.data(), s.size() );
+         expected += s;
+      }
+      writer.flush();
+      BOOST_CHECK( read_file() == expected );
+
+      // bigger than the buffer
+      const std::string big( 1000, 'x' );
+      writer.write( big.data(), big.size() );
+      expected += big;
+   }
+   BOOST_CHECK( read_file() == expected );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( metrics_registry_test )
+{ try {
+   graphene::utilities::metrics_registry metrics;
+   metrics.counter( "test_total", "Test counter" ).add( 3 );
+   BOOST_CHECK_EQUAL( &metrics.counter( "test_total", "Test counter" ), &metrics.counter( "test_total", "" ) );
+   BOOST_CHECK_THROW( metrics.gauge( "test_total", "Not a counter" ), fc::exception );
+
+   auto& histogram = metrics.histogram( "test_seconds", "Test histogram", { 0.1, 1 }, { { "method", "get_\"x\"" } } );
+   histogram.observe( 0.05 );
+   histogram.observe( 0.5 );
+   histogram.observe( 5 );
+
+   int64_t collected = 0;
+   metrics.add_collector( [&]() { metrics.gauge( "test_gauge", "Test gauge" ).set( ++collected ); } );
+
+   const string text = metrics.render();
+   BOOST_CHECK_EQUAL( collected, 1 );
+   BOOST_CHECK( text.find( "# TYPE test_total counter\ntest_total 3\n" ) != string::npos );
+   BOOST_CHECK( text.find( "test_gauge 1\n" ) != string::npos );
+   BOOST_CHECK( text.find( "test_seconds_bucket{method=\"get_\\\"x\\\"\",le=\"0.1\"} 1\n" ) != string::npos );
+   BOOST_CHECK( text.find( "test_seconds_bucket{method=\"get_\\\"x\\\"\",le=\"1\"} 2\n" ) != string::npos );
+   BOOST_CHECK( text.find( "test_seconds_bucket{method=\"get_\\\"x\\\"\",le=\"+Inf\"} 3\n" ) != string::npos );
+   BOOST_CHECK( text.find( "test_seconds_count{method=\"get_\\\"x\\\"\"} 3\n" ) != string::npos );
+   BOOST_CHECK_EQUAL( metrics.gauge( "test_gauge", "" ).value(), 1 );
+   BOOST_CHECK( metrics.render().find( "test_gauge 2\n" ) != string::npos );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( slot_timing_tracker_test )
+{ try {
+   slot_timing_tracker tracker( 3 );
+   const fc::time_point_sec slot( 1500000000 );
+   for( int64_t ms : { 50, 400, 1200, 4000 } )
+      tracker.record_received( 7, 10, slot, fc::time_point( slot ) + fc::milliseconds( ms ) );
+   tracker.record_signed( 8, 11, slot, fc::time_point( slot ) + fc::milliseconds( 20 ) );
+
+   vector<witness_slot_timing> timings = tracker.get_timings();
+   BOOST_REQUIRE_EQUAL( timings.size(), 2u );
+   BOOST_CHECK_EQUAL( timings[0].witness, 7u );
+   BOOST_CHECK_EQUAL( timings[0].last_block_num, 10u );
+   const slot_timing_histogram& received = timings[0].received_after_slot;
+   // the oldest sample was dropped
+   BOOST_CHECK_EQUAL( received.count, 3u );
+   BOOST_CHECK_EQUAL( received.min_ms, 400 );
+   BOOST_CHECK_EQUAL( received.median_ms, 1200 );
+   BOOST_CHECK_EQUAL( received.max_ms, 4000 );
+   BOOST_REQUIRE_EQUAL( received.counts.size(), received.bounds_ms.size() + 1 );
+   BOOST_CHECK_EQUAL( std::accumulate( received.counts.begin(), received.counts.end(), 0u ), 3u );
+   BOOST_CHECK_EQUAL( timings[0].signed_after_slot.count, 0u );
+   BOOST_CHECK_EQUAL( timings[1].signed_after_slot.count, 1u );
+   BOOST_CHECK_EQUAL( timings[1].signed_after_slot.counts[1], 1u );
+
+   tracker.set_blocks_kept( 0 );
+   BOOST_CHECK( tracker.get_timings().empty() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( cpu_list_test )
+{ try {
+   using graphene::utilities::parse_cpu_list;
+   BOOST_CHECK( parse_cpu_list( "3" ) == vector<uint32_t>{ 3 } );
+   BOOST_CHECK( parse_cpu_list( " 4-6, 1,5 " ) == vector<uint32_t>( { 1, 4, 5, 6 } ) );
+   GRAPHENE_CHECK_THROW( parse_cpu_list( "" ), fc::exception );
+   GRAPHENE_CHECK_THROW( parse_cpu_list( "2-1" ), fc::exception );
+   GRAPHENE_CHECK_THROW( parse_cpu_list( "a" ), fc::exception );
+   GRAPHENE_CHECK_THROW( parse_cpu_list( "1,,2" ), fc::exception );
+
+   // pinning to CPU 0, which every machine has, changes nothing but where the workers run
+   graphene::utilities::thread_pool pool( 2 );
+   pool.pin_threads( { 0 } );
+   vector<uint32_t> done( 4, 0 );
+   pool.parallel_for( done.size(), [&]( size_t i ) { done[i] = 1; } );
+   BOOST_CHECK( done == vector<uint32_t>( 4, 1 ) );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
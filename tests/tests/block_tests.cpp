@@ -0,0 +1,1194 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/app/api.hpp>
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/protocol/protocol.hpp>
+
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/applied_operations_log.hpp>
+#include <graphene/chain/block_summary_object.hpp>
+#include <graphene/chain/exceptions.hpp>
+#include <graphene/chain/hardfork.hpp>
+#include <graphene/chain/impacted.hpp>
+#include <graphene/chain/operation_history_object.hpp>
+#include <graphene/chain/transaction_object.hpp>
+
+#include <graphene/debug_witness/debug_api.hpp>
+#include <graphene/utilities/key_conversion.hpp>
+#include <graphene/utilities/metrics.hpp>
+
+#include <fc/bitutil.hpp>
+#include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
+#include "../common/database_fixture.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+using namespace graphene::db;
+
+BOOST_FIXTURE_TEST_SUITE( block_tests, database_fixture )
+
+BOOST_AUTO_TEST_CASE( incremental_flush_test )
+{ try {
+   db.set_incremental_flush( true, 2 );
+   db.flush();
+   const fc::path delta_dir = data_dir->path() / "object_database" / "delta";
+   BOOST_CHECK( !fc::exists( delta_dir ) );
+
+   generate_blocks( 5 );
+   db.flush_incremental();
+   BOOST_CHECK( fc::exists( delta_dir / "1" ) );
+
+   generate_blocks( 5 );
+   db.flush_incremental();
+   BOOST_CHECK( fc::exists( delta_dir / "2" ) );
+
+   {
+      // the snapshot plus the deltas must give back the current state
+      database db2;
+      db2.open( data_dir->path(), [this]{ return genesis_state; }, "test" );
+      BOOST_CHECK_EQUAL( db2.head_block_num(), db.head_block_num() );
+      BOOST_CHECK( db2.head_block_id() == db.head_block_id() );
+      BOOST_CHECK( db2.get_index<account_object>().hash() == db.get_index<account_object>().hash() );
+      const auto& load_times = db2.get_index_load_times();
+      BOOST_REQUIRE( !load_times.empty() );
+      for( size_t i = 1; i < load_times.size(); ++i )
+         BOOST_CHECK_GE( load_times[i-1].microseconds, load_times[i].microseconds );
+      BOOST_CHECK( db2.get_index<dynamic_global_property_object>().hash() == db.get_index<dynamic_global_property_object>().hash() );
+      db2.close( false );
+   }
+
+   // the maximum number of deltas is reached, so this compacts them into a full snapshot
+   generate_blocks( 5 );
+   db.flush_incremental();
+   BOOST_CHECK( !fc::exists( delta_dir ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( state_snapshot_test )
+{ try {
+   ACTORS((1000));
+   transfer( committee_account, u_1000_id, asset(10000) );
+   generate_block();
+   // left out of the snapshot
+   transfer( committee_account, u_1000_id, asset(10000) );
+
+   const fc::path snapshot_dir = data_dir->path() / "snapshot";
+   db.export_state_snapshot( snapshot_dir );
+   BOOST_CHECK( fc::exists( snapshot_dir / "manifest" ) );
+   BOOST_CHECK_THROW( db.export_state_snapshot( snapshot_dir ), fc::exception );
+   // the pending transaction is kept
+   BOOST_CHECK_EQUAL( db.get_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 20000 );
+
+   const fc::path node_dir = data_dir->path() / "node";
+   {
+      database db2;
+      BOOST_CHECK_THROW( db2.import_state_snapshot( snapshot_dir, node_dir, "other" ), fc::exception );
+      db2.import_state_snapshot( snapshot_dir, node_dir, "test" );
+      db2.open( node_dir, [this]{ return genesis_state; }, "test" );
+      BOOST_CHECK( db2.head_block_id() == db.head_block_id() );
+      BOOST_CHECK( db2.get_index<account_object>().hash() == db.get_index<account_object>().hash() );
+      BOOST_CHECK_EQUAL( db2.get_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 10000 );
+
+      // it goes on with the blocks following the snapshot
+      generate_block();
+      db2.push_block( *db.fetch_block_by_number( db.head_block_num() ), ~0 );
+      BOOST_CHECK( db2.head_block_id() == db.head_block_id() );
+      db2.close( false );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( debug_run_scenarios_test )
+{ try {
+   // the application keeps a pointer to them
+   static boost::program_options::variables_map options;
+   options.emplace( "plugins", boost::program_options::variable_value( string(), false ) );
+   app.initialize( data_dir->path() / "debug_app", options );
+   graphene::debug_witness::debug_api api( app );
+   const string debug_key = graphene::utilities::key_to_wif( init_account_priv_key );
+   const block_id_type head_id = db.head_block_id();
+
+   vector<graphene::debug_witness::debug_scenario> scenarios( 2 );
+   scenarios[0].blocks = 3;
+   scenarios[0].watched_objects.push_back( dynamic_global_property_id_type() );
+   scenarios[0].watched_objects.push_back( object_id_type( protocol_ids, account_object_type, 999999 ) );
+   // an update can't create an object
+   fc::mutable_variant_object create;
+   create( "_action", "create" )( "id", object_id_type( dynamic_global_property_id_type() ) );
+   scenarios[1].updates.push_back( create );
+   scenarios[1].blocks = 1;
+
+   const vector<graphene::debug_witness::debug_scenario_result> results = api.debug_run_scenarios( debug_key, scenarios );
+   BOOST_REQUIRE_EQUAL( results.size(), 2u );
+   BOOST_CHECK( !results[0].error.valid() );
+   BOOST_CHECK_EQUAL( results[0].head_block_num, db.head_block_num() + 3 );
+   BOOST_REQUIRE_EQUAL( results[0].objects.size(), 2u );
+   BOOST_CHECK_EQUAL( results[0].objects[0]["head_block_number"].as_uint64(), db.head_block_num() + 3 );
+   BOOST_CHECK( results[0].objects[1].is_null() );
+   // a failed scenario doesn't keep the others from finishing
+   BOOST_CHECK( results[1].error.valid() );
+   // the node isn't changed by them
+   BOOST_CHECK( db.head_block_id() == head_id );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( binary_genesis_test )
+{ try {
+   genesis_state_type genesis = genesis_state;
+   genesis.initial_chain_id = chain_id_type();
+   genesis.initial_chain_id = json_genesis_chain_id( genesis );
+   const fc::path filename = data_dir->path() / "genesis.bin";
+
+   // the chain id must be the one of the genesis it comes with
+   genesis_state_type forged = genesis;
+   forged.initial_chain_id = fc::sha256::hash( string( "binary_genesis_test" ) );
+   save_binary_genesis_state( forged, filename );
+   string forged_contents;
+   fc::read_file_contents( filename, forged_contents );
+   GRAPHENE_CHECK_THROW( load_binary_genesis_state( forged_contents ), fc::exception );
+   forged = genesis;
+   forged.initial_accounts.pop_back();
+   save_binary_genesis_state( forged, filename );
+   fc::read_file_contents( filename, forged_contents );
+   GRAPHENE_CHECK_THROW( load_binary_genesis_state( forged_contents ), fc::exception );
+
+   save_binary_genesis_state( genesis, filename );
+
+   string contents;
+   fc::read_file_contents( filename, contents );
+   BOOST_REQUIRE( is_binary_genesis_state( contents ) );
+   BOOST_CHECK( !is_binary_genesis_state( fc::json::to_string( genesis ) ) );
+   const genesis_state_type loaded = load_binary_genesis_state( contents );
+   BOOST_CHECK( fc::raw::pack( loaded ) == fc::raw::pack( genesis ) );
+   GRAPHENE_CHECK_THROW( load_binary_genesis_state( contents.substr( 0, contents.size() - 1 ) ), fc::exception );
+
+   // it starts the same chain as the genesis state it was saved from
+   database from_state;
+   from_state.open( data_dir->path() / "from_state", [&genesis]{ return genesis; }, "test" );
+   database from_binary;
+   from_binary.open( data_dir->path() / "from_binary", [&loaded]{ return loaded; }, "test" );
+   BOOST_CHECK( from_binary.get_chain_id() == genesis.initial_chain_id );
+   BOOST_CHECK( from_binary.get_index<account_object>().hash() == from_state.get_index<account_object>().hash() );
+   BOOST_CHECK( from_binary.get_index<account_balance_object>().hash()
+                == from_state.get_index<account_balance_object>().hash() );
+   from_binary.close( false );
+   from_state.close( false );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( fork_database_spill_test )
+{ try {
+   ACTORS((1000)(2000));
+   generate_blocks( 5 );
+
+   // a limit of one byte spills everything but the head
+   fork_database fork_db;
+   fork_db.set_memory_limit( 1, data_dir->path() / "fork_db_test" );
+   fork_db.start_block( *db.fetch_block_by_number( 1 ) );
+   for( uint32_t i = 2; i <= db.head_block_num(); ++i )
+      fork_db.push_block( *db.fetch_block_by_number( i ) );
+
+   const fork_database_stats stats = fork_db.get_stats();
+   BOOST_CHECK_EQUAL( stats.item_count, db.head_block_num() );
+   BOOST_CHECK_EQUAL( stats.spilled_count, stats.item_count - 1 );
+   BOOST_CHECK( stats.spilled_bytes > 0 );
+
+   for( uint32_t i = 1; i <= db.head_block_num(); ++i )
+   {
+      const signed_block block = *db.fetch_block_by_number( i );
+      const auto item = fork_db.fetch_block( block.id() );
+      BOOST_REQUIRE( item );
+      BOOST_CHECK( fc::raw::pack( item->data ) == fc::raw::pack( block ) );
+   }
+   BOOST_CHECK_EQUAL( fork_db.get_stats().spilled_count, 0u );
+   BOOST_CHECK_EQUAL( fork_db.get_stats().memory_bytes, stats.memory_bytes + stats.spilled_bytes );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( fork_database_spill_compaction_test )
+{ try {
+   ACTORS((1000)(2000));
+   generate_blocks( 30 );
+
+   // only the last few blocks stay in the fork database, all but the head of them spilled
+   const uint32_t max_size = 4;
+   const fc::path spill_dir = data_dir->path() / "fork_db_compaction_test";
+   fork_database fork_db;
+   fork_db.set_max_size( max_size );
+   fork_db.set_memory_limit( 1, spill_dir );
+   fork_db.start_block( *db.fetch_block_by_number( 1 ) );
+   uint64_t max_block_size = 0;
+   for( uint32_t i = 2; i <= db.head_block_num(); ++i )
+   {
+      const signed_block block = *db.fetch_block_by_number( i );
+      max_block_size = std::max<uint64_t>( max_block_size, fc::raw::pack_size( block ) );
+      fork_db.push_block( block );
+
+      // the blocks that left the fork database don't pile up in the spill file
+      const fork_database_stats stats = fork_db.get_stats();
+      BOOST_CHECK( stats.item_count <= max_size + 1 );
+      BOOST_CHECK( fc::file_size( spill_dir / "blocks" ) <= 2 * stats.spilled_bytes + max_block_size );
+   }
+
+   // the moved blocks are still read back as they were
+   for( uint32_t i = db.head_block_num() + 1 - fork_db.get_stats().item_count; i <= db.head_block_num(); ++i )
+   {
+      const signed_block block = *db.fetch_block_by_number( i );
+      const auto item = fork_db.fetch_block( block.id() );
+      BOOST_REQUIRE( item );
+      BOOST_CHECK( fc::raw::pack( item->data ) == fc::raw::pack( block ) );
+   }
+   BOOST_CHECK_EQUAL( fork_db.get_stats().spilled_count, 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( fork_switch_test )
+{ try {
+   const uint32_t skip = database::skip_undo_history_check;
+   generate_block();
+   const signed_block common = *db.fetch_block_by_number( db.head_block_num() );
+   // a second and a third node follow the chain up to the common block
+   database db2, db3;
+   db2.open( data_dir->path() / "db2", [this]{ return genesis_state; }, "test" );
+   db3.open( data_dir->path() / "db3", [this]{ return genesis_state; }, "test" );
+   for( uint32_t i = 1; i <= common.block_num(); ++i )
+   {
+      db2.push_block( *db.fetch_block_by_number( i ), skip );
+      db3.push_block( *db.fetch_block_by_number( i ), skip );
+   }
+
+   const signed_block a1 = db.generate_block( db.get_slot_time( 1 ), db.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   db3.push_block( a1, skip );
+   const signed_block b1 = db2.generate_block( db2.get_slot_time( 2 ), db2.get_scheduled_witness( 2 ), init_account_priv_key, skip );
+   const signed_block b2 = db2.generate_block( db2.get_slot_time( 1 ), db2.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   BOOST_CHECK_EQUAL( db.get_fork_switch_stats().switch_count, 0u );
+
+   // the longer fork wins
+   BOOST_CHECK( !db.push_block( b1, skip ) );
+   BOOST_CHECK( db.head_block_id() == a1.id() );
+   BOOST_CHECK( db.push_block( b2, skip ) );
+   BOOST_CHECK( db.head_block_id() == b2.id() );
+   fork_switch_stats stats = db.get_fork_switch_stats();
+   BOOST_CHECK_EQUAL( stats.switch_count, 1u );
+   BOOST_CHECK_EQUAL( stats.failed_count, 0u );
+   BOOST_CHECK_EQUAL( stats.blocks_popped, 1u );
+   BOOST_CHECK_EQUAL( stats.blocks_applied, 2u );
+   BOOST_CHECK_EQUAL( stats.blocks_reapplied, 0u );
+   BOOST_CHECK_EQUAL( stats.last_head_block_num, b2.block_num() );
+   BOOST_CHECK_GE( stats.max_duration_us, stats.last_duration_us );
+
+   // and back, the block applied before isn't checked again
+   const signed_block a2 = db3.generate_block( db3.get_slot_time( 1 ), db3.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   const signed_block a3 = db3.generate_block( db3.get_slot_time( 1 ), db3.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   BOOST_CHECK( !db.push_block( a2, skip ) );
+   BOOST_CHECK( db.push_block( a3, skip ) );
+   BOOST_CHECK( db.head_block_id() == a3.id() );
+   BOOST_CHECK( db.fetch_block_by_number( a1.block_num() )->id() == a1.id() );
+   stats = db.get_fork_switch_stats();
+   BOOST_CHECK_EQUAL( stats.switch_count, 2u );
+   BOOST_CHECK_EQUAL( stats.blocks_popped, 3u );
+   BOOST_CHECK_EQUAL( stats.blocks_applied, 5u );
+   BOOST_CHECK_EQUAL( stats.blocks_reapplied, 1u );
+   BOOST_CHECK( db.get_dynamic_global_properties().head_block_id == db3.head_block_id() );
+
+   db2.close();
+   db3.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( fork_switch_authority_test )
+{ try {
+   const uint32_t skip = database::skip_undo_history_check;
+   ACTORS((1000)(2000));
+   transfer( committee_account, u_1000_id, asset(10000) );
+   generate_block();
+   const signed_block common = *db.fetch_block_by_number( db.head_block_num() );
+   database db2;
+   db2.open( data_dir->path() / "db2", [this]{ return genesis_state; }, "test" );
+   for( uint32_t i = 1; i <= common.block_num(); ++i )
+      db2.push_block( *db.fetch_block_by_number( i ), skip );
+
+   // a transfer signed with the key of the common block, valid on either fork until the key changes
+   signed_transaction spend;
+   transfer_operation top;
+   top.from = u_1000_id;
+   top.to = u_2000_id;
+   top.amount = asset(100);
+   spend.operations.push_back( top );
+   for( auto& op : spend.operations ) db.current_fee_schedule().set_fee( op );
+   set_expiration( db, spend );
+   sign( spend, u_1000_private_key );
+
+   // the other fork replaces the keys in its first block, and its head block changes nothing
+   const fc::ecc::private_key new_key = generate_private_key( "new_active" );
+   signed_transaction change;
+   account_update_auth_operation aop;
+   aop.uid = u_1000_id;
+   aop.owner = authority( 1, public_key_type( new_key.get_public_key() ), 1 );
+   aop.active = aop.owner;
+   aop.secondary = aop.owner;
+   change.operations.push_back( aop );
+   for( auto& op : change.operations ) db2.current_fee_schedule().set_fee( op );
+   set_expiration( db2, change );
+   change.sign( u_1000_private_key, db2.get_chain_id() );
+   db2.push_transaction( change );
+   const signed_block b1 = db2.generate_block( db2.get_slot_time( 2 ), db2.get_scheduled_witness( 2 ), init_account_priv_key, skip );
+   const signed_block b2 = db2.generate_block( db2.get_slot_time( 1 ), db2.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   BOOST_CHECK_EQUAL( b1.transactions.size(), 1u );
+   BOOST_CHECK( b2.transactions.empty() );
+
+   // the empty block popped by the switch leaves no popped transactions behind
+   const signed_block a1 = db.generate_block( db.get_slot_time( 1 ), db.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   BOOST_CHECK( a1.transactions.empty() );
+   db.push_transaction( spend );
+   BOOST_CHECK_EQUAL( db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 100 );
+
+   BOOST_CHECK( !db.push_block( b1, skip ) );
+   BOOST_CHECK( db.push_block( b2, skip ) );
+   BOOST_CHECK( db.head_block_id() == b2.id() );
+   // its authority is checked again, so the transfer is dropped rather than kept with the outdated check
+   BOOST_CHECK_EQUAL( db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 0 );
+   const signed_block b3 = db.generate_block( db.get_slot_time( 1 ), db.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   BOOST_CHECK( b3.transactions.empty() );
+   BOOST_CHECK_NO_THROW( db2.push_block( b3, skip ) );
+
+   db2.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( checkpoint_sync_test )
+{ try {
+   const uint32_t skip = database::skip_undo_history_check;
+   generate_blocks( 8 );
+   const uint32_t checkpoint = 5;
+
+   database db2;
+   db2.open( data_dir->path() / "db2", [this]{ return genesis_state; }, "test" );
+   db2.add_checkpoints( { { checkpoint, db.fetch_block_by_number( checkpoint )->id() } } );
+   BOOST_CHECK( db2.is_checkpointed( checkpoint ) );
+   BOOST_CHECK( !db2.is_checkpointed( checkpoint + 1 ) );
+
+   // the checkpointed blocks don't go through the fork database
+   for( uint32_t i = 1; i <= checkpoint; ++i )
+      db2.push_block( *db.fetch_block_by_number( i ), skip );
+   BOOST_CHECK( db2.head_block_id() == db.fetch_block_by_number( checkpoint )->id() );
+   BOOST_CHECK_EQUAL( db2.get_fork_database_stats().item_count, 0u );
+
+   // it's caught up with the first block after them
+   for( uint32_t i = checkpoint + 1; i <= db.head_block_num(); ++i )
+      db2.push_block( *db.fetch_block_by_number( i ), skip );
+   BOOST_CHECK( db2.head_block_id() == db.head_block_id() );
+   BOOST_CHECK_GT( db2.get_fork_database_stats().item_count, 0u );
+   BOOST_CHECK_LE( db2.get_fork_database_stats().item_count, db.head_block_num() - checkpoint + 1 );
+   BOOST_CHECK( db2.get_dynamic_global_properties().head_block_id == db.head_block_id() );
+
+   // a block not matching the checkpoint is rejected
+   database db3;
+   db3.open( data_dir->path() / "db3", [this]{ return genesis_state; }, "test" );
+   db3.add_checkpoints( { { 2, db.fetch_block_by_number( 3 )->id() } } );
+   db3.push_block( *db.fetch_block_by_number( 1 ), skip );
+   GRAPHENE_CHECK_THROW( db3.push_block( *db.fetch_block_by_number( 2 ), skip ), fc::exception );
+   BOOST_CHECK_EQUAL( db3.head_block_num(), 1u );
+
+   db2.close();
+   db3.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( fetch_blocks_by_number_test )
+{ try {
+   ACTORS((1000)(2000));
+   generate_blocks( 30 );
+   BOOST_REQUIRE( db.get_dynamic_global_properties().last_irreversible_block_num > 1 );
+
+   // the range covers irreversible and reversible blocks, and stops at the head block
+   const uint32_t last = db.head_block_num();
+   const auto blocks = db.fetch_blocks_by_number( 1, last + 2 );
+   const auto raw_blocks = db.fetch_raw_blocks_by_number( 1, uint32_t(-1) );
+   BOOST_REQUIRE_EQUAL( blocks.size(), last );
+   BOOST_REQUIRE_EQUAL( raw_blocks.size(), last );
+   for( uint32_t i = 1; i <= last; ++i )
+   {
+      const optional<signed_block> block = db.fetch_block_by_number( i );
+      BOOST_REQUIRE_EQUAL( blocks[i-1].valid(), block.valid() );
+      BOOST_REQUIRE_EQUAL( raw_blocks[i-1].valid(), block.valid() );
+      if( block.valid() )
+      {
+         BOOST_CHECK( blocks[i-1]->id() == block->id() );
+         BOOST_CHECK( *raw_blocks[i-1] == fc::raw::pack( *block ) );
+         const optional<vector<char>> raw_block = db.fetch_raw_block_by_id( block->id() );
+         BOOST_REQUIRE( raw_block.valid() );
+         BOOST_CHECK( *raw_block == *raw_blocks[i-1] );
+      }
+   }
+   BOOST_CHECK( db.fetch_blocks_by_number( 2, 1 ).empty() );
+   BOOST_CHECK( db.fetch_blocks_by_number( last + 1, last + 2 ).empty() );
+   BOOST_CHECK( !db.fetch_raw_block_by_id( block_id_type() ).valid() );
+
+   graphene::app::block_api api( db );
+   BOOST_CHECK_EQUAL( api.get_blocks( 1, 1000 ).size(), last );
+   GRAPHENE_CHECK_THROW( api.get_blocks( 1, 1001 ), fc::exception );
+   GRAPHENE_CHECK_THROW( api.get_raw_blocks( 0, uint32_t(-1) ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_database_export_test )
+{ try {
+   generate_blocks( 10 );
+
+   const fc::path export_dir = data_dir->path() / "export";
+   BOOST_CHECK_EQUAL( db.get_block_database().export_range( 3, db.head_block_num(), export_dir ), db.head_block_num() - 2 );
+
+   block_database exported;
+   exported.open( export_dir );
+   BOOST_CHECK( !exported.fetch_by_number( 2 ).valid() );
+   for( uint32_t i = 3; i <= db.head_block_num(); ++i )
+   {
+      const optional<signed_block> block = exported.fetch_by_number( i );
+      BOOST_REQUIRE( block.valid() );
+      BOOST_CHECK( block->id() == db.fetch_block_by_number( i )->id() );
+   }
+   BOOST_CHECK( *exported.last_id() == db.head_block_id() );
+   exported.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_read_ahead_test )
+{ try {
+   generate_blocks( 10 );
+
+   const uint32_t head_num = db.head_block_num();
+   database::block_read_ahead read_ahead( db, db.get_block_database(), 2, head_num + 1, database::replay_skip_flags );
+   for( uint32_t i = 2; i <= head_num; ++i )
+   {
+      uint32_t skip = database::replay_skip_flags;
+      const optional<signed_block> block = read_ahead.next( skip );
+      BOOST_REQUIRE( block.valid() );
+      BOOST_CHECK( block->id() == db.fetch_block_by_number( i )->id() );
+      BOOST_CHECK_EQUAL( skip & ~database::skip_merkle_check, database::replay_skip_flags );
+   }
+   // past the stored blocks, and past the end of the range
+   uint32_t skip = database::replay_skip_flags;
+   BOOST_CHECK( !read_ahead.next( skip ).valid() );
+   BOOST_CHECK( !read_ahead.next( skip ).valid() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_read_ahead_unwind_test )
+{ try {
+   generate_blocks( 10 );
+   db.set_worker_threads( 4 );
+
+   // a replay stopped by an exception leaves blocks being decoded, they are waited for while it unwinds
+   const uint32_t head_num = db.head_block_num();
+   for( uint32_t stop = 2; stop <= head_num; stop += 3 )
+   {
+      try
+      {
+         database::block_read_ahead read_ahead( db, db.get_block_database(), 2, head_num, database::replay_skip_flags );
+         for( uint32_t i = 2; i <= head_num; ++i )
+         {
+            uint32_t skip = database::replay_skip_flags;
+            BOOST_REQUIRE( read_ahead.next( skip ).valid() );
+            FC_ASSERT( i < stop, "block ${i} failed", ("i", i) );
+         }
+      }
+      catch( const fc::assert_exception& ) {}
+   }
+   db.set_worker_threads( 0 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_database_compression_test )
+{ try {
+   generate_block();
+   ACTORS((1000));
+   transfer( committee_account, u_1000_id, asset(10000) );
+   generate_block();
+   const uint32_t big_num = db.head_block_num();
+   generate_blocks( 3 );
+
+   // repeating a transaction makes the block compressible, it doesn't change the block id
+   signed_block big = *db.fetch_block_by_number( big_num );
+   BOOST_REQUIRE( !big.transactions.empty() );
+   for( int i = 0; i < 50; ++i )
+      big.transactions.push_back( big.transactions.front() );
+
+   const fc::path dir = data_dir->path() / "compressed";
+   {
+      block_database bdb;
+      bdb.open( dir );
+      // the blocks stored before enabling compression are kept uncompressed
+      for( uint32_t i = 1; i < big_num; ++i )
+         bdb.store( db.fetch_block_by_number( i )->id(), *db.fetch_block_by_number( i ) );
+      bdb.set_compression( true );
+      bdb.store( big.id(), big );
+      for( uint32_t i = big_num + 1; i <= db.head_block_num(); ++i )
+         bdb.store( db.fetch_block_by_number( i )->id(), *db.fetch_block_by_number( i ) );
+      bdb.close();
+   }
+
+   for( bool mmap : { false, true } )
+   {
+      block_database bdb;
+      bdb.set_use_mmap( mmap );
+      bdb.open( dir );
+
+      vector<index_entry> entries;
+      bdb.fetch_index_entries( big_num - 1, big_num, entries );
+      BOOST_REQUIRE_EQUAL( entries.size(), 2u );
+      BOOST_CHECK( !entries[0].is_compressed() );
+      BOOST_CHECK( entries[1].is_compressed() );
+      BOOST_CHECK_LT( entries[1].stored_size(), fc::raw::pack_size( big ) );
+
+      const optional<signed_block> fetched = bdb.fetch_by_number( big_num );
+      BOOST_REQUIRE( fetched.valid() );
+      BOOST_CHECK_EQUAL( fetched->transactions.size(), big.transactions.size() );
+      for( uint32_t i = 1; i <= db.head_block_num(); ++i )
+         BOOST_CHECK( bdb.fetch_by_number( i )->id() == db.fetch_block_by_number( i )->id() );
+
+      // the raw lookups return the uncompressed blocks
+      block_id_type id;
+      vector<char> data;
+      BOOST_REQUIRE( bdb.fetch_raw_by_number( big_num, id, data ) );
+      BOOST_CHECK( id == big.id() );
+      BOOST_CHECK( data == fc::raw::pack( big ) );
+      vector<block_id_type> ids;
+      vector< vector<char> > range;
+      bdb.fetch_raw_range( 1, db.head_block_num(), ids, range );
+      BOOST_REQUIRE_EQUAL( range.size(), db.head_block_num() );
+      BOOST_CHECK( range[0] == fc::raw::pack( *db.fetch_block_by_number( 1 ) ) );
+      BOOST_CHECK( range[big_num - 1] == data );
+
+      BOOST_CHECK( *bdb.last_id() == db.head_block_id() );
+      bdb.close();
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_database_recent_ids_test )
+{ try {
+   generate_blocks( 6 );
+
+   const fc::path dir = data_dir->path() / "recent_ids";
+   {
+      block_database bdb;
+      bdb.open( dir );
+      // block 4 is left out
+      for( uint32_t i = 1; i <= 5; ++i )
+         if( i != 4 )
+            bdb.store( db.fetch_block_by_number( i )->id(), *db.fetch_block_by_number( i ) );
+      BOOST_CHECK( bdb.contains( db.fetch_block_by_number( 3 )->id() ) );
+      BOOST_CHECK( !bdb.contains( db.fetch_block_by_number( 4 )->id() ) );
+      BOOST_CHECK( !bdb.contains( db.fetch_block_by_number( 6 )->id() ) );
+      BOOST_CHECK( !bdb.fetch_optional( db.fetch_block_by_number( 6 )->id() ).valid() );
+
+      bdb.remove( db.fetch_block_by_number( 3 )->id() );
+      BOOST_CHECK( !bdb.contains( db.fetch_block_by_number( 3 )->id() ) );
+      BOOST_CHECK( !bdb.fetch_optional( db.fetch_block_by_number( 3 )->id() ).valid() );
+      BOOST_CHECK( bdb.fetch_block_id( 5 ) == db.fetch_block_by_number( 5 )->id() );
+      bdb.close();
+   }
+   {
+      // the ids are loaded from the index
+      block_database bdb;
+      bdb.open( dir );
+      BOOST_CHECK( bdb.contains( db.fetch_block_by_number( 2 )->id() ) );
+      BOOST_CHECK( !bdb.contains( db.fetch_block_by_number( 3 )->id() ) );
+      BOOST_CHECK( !bdb.contains( db.fetch_block_by_number( 4 )->id() ) );
+      BOOST_CHECK( bdb.fetch_optional( db.fetch_block_by_number( 5 )->id() ).valid() );
+
+      bdb.store( db.fetch_block_by_number( 4 )->id(), *db.fetch_block_by_number( 4 ) );
+      bdb.store( db.fetch_block_by_number( 6 )->id(), *db.fetch_block_by_number( 6 ) );
+      BOOST_CHECK( bdb.contains( db.fetch_block_by_number( 4 )->id() ) );
+      BOOST_CHECK( bdb.contains( db.fetch_block_by_number( 6 )->id() ) );
+      BOOST_CHECK( *bdb.last_id() == db.fetch_block_by_number( 6 )->id() );
+      bdb.close();
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_database_ids_kept_test )
+{ try {
+   generate_blocks( 3 );
+
+   // a block far ahead makes the ids kept grow past the default
+   signed_block far = *db.fetch_block_by_number( 3 );
+   far.previous = block_id_type();
+   far.previous._hash[0] = fc::endian_reverse_u32( GRAPHENE_BLOCK_DATABASE_RECENT_IDS + 100 );
+   const uint32_t far_num = far.block_num();
+
+   const fc::path dir = data_dir->path() / "ids_kept";
+   for( uint32_t kept : { 0u, 2u } )
+   {
+      fc::remove_all( dir );
+      block_database bdb;
+      bdb.set_ids_kept( kept );
+      bdb.open( dir );
+      for( uint32_t i = 1; i <= 3; ++i )
+         bdb.store( db.fetch_block_by_number( i )->id(), *db.fetch_block_by_number( i ) );
+      bdb.store( far.id(), far );
+
+      for( int reopen = 0; reopen < 2; ++reopen )
+      {
+         for( uint32_t i = 1; i <= 3; ++i )
+         {
+            BOOST_CHECK( bdb.contains( db.fetch_block_by_number( i )->id() ) );
+            BOOST_CHECK( bdb.fetch_block_id( i ) == db.fetch_block_by_number( i )->id() );
+         }
+         BOOST_CHECK( !bdb.contains( db.fetch_block_by_number( 4 )->id() ) );
+         BOOST_CHECK( bdb.contains( far.id() ) );
+         BOOST_CHECK( bdb.fetch_block_id( far_num ) == far.id() );
+         BOOST_CHECK_THROW( bdb.fetch_block_id( far_num - 1 ), fc::exception );
+         bdb.close();
+         bdb.open( dir );
+      }
+      bdb.close();
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_database_cache_test )
+{ try {
+   generate_blocks( 8 );
+
+   const fc::path dir = data_dir->path() / "cache";
+   block_database cached;
+   cached.set_cache_size( 3 );
+   cached.open( dir );
+   for( uint32_t i = 1; i <= 8; ++i )
+      cached.store( db.fetch_block_by_number( i )->id(), *db.fetch_block_by_number( i ) );
+   cached.remove( db.fetch_block_by_number( 7 )->id() );
+
+   // the lookups answered by the cache return what the files hold
+   block_database uncached;
+   uncached.set_cache_size( 0 );
+   uncached.open( dir );
+   for( uint32_t i = 1; i <= 8; ++i )
+   {
+      const block_id_type id = db.fetch_block_by_number( i )->id();
+      const optional<signed_block> by_num = cached.fetch_by_number( i );
+      const optional<signed_block> by_id = cached.fetch_optional( id );
+      BOOST_CHECK_EQUAL( by_num.valid(), uncached.fetch_by_number( i ).valid() );
+      BOOST_CHECK_EQUAL( by_id.valid(), uncached.fetch_optional( id ).valid() );
+      BOOST_CHECK_EQUAL( by_num.valid(), i != 7 );
+      if( by_num.valid() )
+         BOOST_CHECK( by_num->id() == id );
+
+      block_id_type cached_id, uncached_id;
+      vector<char> cached_data, uncached_data;
+      BOOST_CHECK_EQUAL( cached.fetch_raw_by_number( i, cached_id, cached_data ),
+                         uncached.fetch_raw_by_number( i, uncached_id, uncached_data ) );
+      BOOST_CHECK( cached_id == uncached_id );
+      BOOST_CHECK( cached_data == uncached_data );
+   }
+
+   vector<block_id_type> cached_ids, uncached_ids;
+   vector< vector<char> > cached_range, uncached_range;
+   cached.fetch_raw_range( 1, 8, cached_ids, cached_range );
+   uncached.fetch_raw_range( 1, 8, uncached_ids, uncached_range );
+   BOOST_CHECK( cached_ids == uncached_ids );
+   BOOST_CHECK( cached_range == uncached_range );
+   BOOST_CHECK( cached_range[7] == fc::raw::pack( *db.fetch_block_by_number( 8 ) ) );
+
+   uncached.close();
+   cached.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( prepare_block_test )
+{ try {
+   ACTORS((1000)(2000));
+   generate_block();
+   const uint32_t skip = ~0 | database::skip_undo_history_check;
+
+   transfer( committee_account, u_1000_id, asset(10000) );
+   fc::time_point_sec when = db.get_slot_time( 1 );
+   account_uid_type witness = db.get_scheduled_witness( 1 );
+   db.prepare_block( when, witness, skip );
+   // pushed after the block was prepared, left for the next block
+   transfer( committee_account, u_2000_id, asset(10000) );
+
+   signed_block block = db.generate_block( when, witness, init_account_priv_key, skip );
+   BOOST_REQUIRE_EQUAL( block.transactions.size(), 1u );
+   BOOST_CHECK( block.transactions[0].operations[0].get<transfer_operation>().to == u_1000_id );
+   BOOST_CHECK( block.transaction_merkle_root == block.calculate_merkle_root() );
+
+   // the prepared block was used up, the next one is built from the pending transactions
+   block = db.generate_block( db.get_slot_time( 1 ), db.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   BOOST_REQUIRE_EQUAL( block.transactions.size(), 1u );
+   BOOST_CHECK( block.transactions[0].operations[0].get<transfer_operation>().to == u_2000_id );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( cleanup_counts_test )
+{ try {
+   ACTORS((1000));
+   transfer( committee_account, u_1000_id, asset(10000) );
+   generate_block();
+
+   const auto& trx_idx = db.get_index_type<transaction_index>().indices().get<by_expiration>();
+   BOOST_REQUIRE( !trx_idx.empty() );
+   const uint32_t expiring = trx_idx.size();
+   BOOST_CHECK_EQUAL( db.get_last_cleanup_counts().expired_transactions, 0u );
+
+   // a single block after all of them expired removes them all
+   const auto after_expiration = trx_idx.rbegin()->trx.expiration + db.get_global_properties().parameters.block_interval;
+   generate_block( ~0, init_account_priv_key, db.get_slot_at_time( after_expiration ) - 1 );
+   BOOST_CHECK( trx_idx.empty() );
+   BOOST_CHECK_EQUAL( db.get_last_cleanup_counts().expired_transactions, expiring );
+
+   generate_block();
+   BOOST_CHECK_EQUAL( db.get_last_cleanup_counts().expired_transactions, 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( evaluation_profile_test )
+{ try {
+   ACTORS((1000));
+   db.get_evaluation_profiler().reset();
+   transfer( committee_account, u_1000_id, asset(10000) );
+
+   const int32_t transfer_type = operation::tag<transfer_operation>::value;
+   auto profiles = db.get_evaluation_profiler().get_profiles();
+   BOOST_REQUIRE_EQUAL( profiles.size(), 1u );
+   BOOST_CHECK_EQUAL( profiles[0].operation_type, transfer_type );
+   BOOST_CHECK_EQUAL( profiles[0].count, 1u );
+   BOOST_CHECK_EQUAL( profiles[0].histogram.size(), operation_profile::bucket_bounds().size() + 1 );
+   BOOST_CHECK_EQUAL( std::accumulate( profiles[0].histogram.begin(), profiles[0].histogram.end(), uint64_t(0) ), 1u );
+   BOOST_CHECK( profiles[0].objects_modified > 0 );
+
+   // applied again when the block is generated and applied
+   generate_block();
+   profiles = db.get_evaluation_profiler().get_profiles();
+   BOOST_REQUIRE_EQUAL( profiles.size(), 1u );
+   BOOST_CHECK( profiles[0].count >= 2u );
+
+   db.get_evaluation_profiler().reset();
+   BOOST_CHECK( db.get_evaluation_profiler().get_profiles().empty() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_profile_test )
+{ try {
+   db.get_block_profiler().set_max_size( 3 );
+   generate_blocks( 5 );
+
+   auto profiles = db.get_block_profiler().get_recent( 10 );
+   BOOST_REQUIRE_EQUAL( profiles.size(), 3u );
+   BOOST_CHECK_EQUAL( profiles[0].block_num, db.head_block_num() );
+   BOOST_CHECK_EQUAL( profiles[2].block_num, db.head_block_num() - 2 );
+   for( const auto& p : profiles )
+   {
+      // the phases follow one another
+      BOOST_CHECK_EQUAL( p.total_us, p.merkle_check_us + p.header_validation_us + p.block_setup_us + p.transactions_us
+                                     + p.block_end_us + p.maintenance_us + p.witness_schedule_us + p.invariants_us
+                                     + p.applied_block_us + p.notify_changed_objects_us );
+   }
+   BOOST_CHECK_EQUAL( db.get_block_profiler().get_recent( 1 ).size(), 1u );
+
+   db.get_block_profiler().set_max_size( 1 );
+   profiles = db.get_block_profiler().get_recent( 10 );
+   BOOST_REQUIRE_EQUAL( profiles.size(), 1u );
+   BOOST_CHECK_EQUAL( profiles[0].block_num, db.head_block_num() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( applied_operations_impacted_accounts_test )
+{ try {
+   ACTORS((1000)(2000));
+   vector< optional<operation_history_object> > ops;
+   vector< flat_set<account_uid_type> > impacted;
+   bool computed_once = false;
+   {
+      boost::signals2::scoped_connection connection = db.applied_block.connect( [&]( const signed_block& ) {
+         ops = db.get_applied_operations();
+         impacted = db.get_applied_operations_impacted_accounts();
+         computed_once = ( &db.get_applied_operations_impacted_accounts()[0] == &db.get_applied_operations_impacted_accounts()[0] );
+      } );
+      transfer( committee_account, u_1000_id, asset(10000) );
+      transfer( u_1000_id, u_2000_id, asset(1000) );
+      generate_block();
+   }
+   BOOST_REQUIRE_EQUAL( impacted.size(), ops.size() );
+   BOOST_CHECK( computed_once );
+   bool found = false;
+   for( size_t i = 0; i < ops.size(); ++i )
+   {
+      if( !ops[i].valid() )
+         continue;
+      flat_set<account_uid_type> expected;
+      operation_history_get_impacted_account_uids( *ops[i], expected );
+      BOOST_CHECK( impacted[i] == expected );
+      found = found || ( impacted[i].count( u_1000_id ) && impacted[i].count( u_2000_id ) );
+   }
+   BOOST_CHECK( found );
+   // cleared with the operations once the block is applied
+   BOOST_CHECK( db.get_applied_operations_impacted_accounts().empty() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( hardfork_rules_test )
+{ try {
+   generate_block();
+   const dynamic_global_property_object& dpo = db.get_dynamic_global_properties();
+   const hardfork_rules rules = db.get_hardfork_rules();
+   BOOST_CHECK_EQUAL( rules.head_fork_05, dpo.enabled_hardfork_version >= ENABLE_HEAD_FORK_05 );
+   BOOST_CHECK_EQUAL( rules.after_0_6_time, db.head_block_time() >= HARDFORK_0_6_TIME );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_summary_ring_test )
+{ try {
+   generate_blocks( 3 );
+   const auto& bsi = db.get_index_type< flat_index<block_summary_object> >();
+   BOOST_CHECK_EQUAL( bsi.size(), 0x10000u );
+   const uint32_t num = db.head_block_num();
+   BOOST_CHECK( bsi.at( num & 0xffff ).block_id == db.head_block_id() );
+   BOOST_CHECK( bsi.at( num & 0xffff ).id == block_summary_id_type( num & 0xffff ) );
+   BOOST_CHECK( &bsi.at( (num - 1) & 0xffff ) == &block_summary_id_type( (num - 1) & 0xffff )(db) );
+
+   // undo restores the summary in place
+   const block_id_type head_id = db.head_block_id();
+   db.pop_block();
+   BOOST_CHECK( bsi.at( num & 0xffff ).block_id != head_id );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( fast_forward_blocks_test )
+{ try {
+   const uint32_t head_num = db.head_block_num();
+   const fc::time_point_sec head_time = db.head_block_time();
+   const uint32_t interval = db.get_global_properties().parameters.block_interval;
+
+   fast_forward_blocks( 1000 );
+   BOOST_CHECK_EQUAL( db.head_block_num(), head_num + 1000 );
+   BOOST_CHECK( db.head_block_time() == head_time + 1000 * interval );
+
+   // the chain goes on normally
+   set_expiration( db, trx );
+   ACTORS((1000));
+   transfer( committee_account, u_1000_id, asset( 1000 ) );
+   generate_block();
+   BOOST_CHECK_EQUAL( db.get_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 1000 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( compressed_genesis_state_test )
+{ try {
+   const vector<char> compressed = compress_genesis_state( genesis_state );
+   BOOST_CHECK_LT( compressed.size(), fc::raw::pack_size( genesis_state ) );
+   const genesis_state_type decoded = decompress_genesis_state( compressed.data(), compressed.size() );
+   BOOST_CHECK( fc::raw::pack( decoded ) == fc::raw::pack( genesis_state ) );
+
+   vector<char> corrupted = compressed;
+   corrupted.back() ^= 1;
+   BOOST_CHECK_THROW( decompress_genesis_state( corrupted.data(), corrupted.size() ), fc::exception );
+   BOOST_CHECK_THROW( decompress_genesis_state( compressed.data(), 2 ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( database_metrics_test )
+{ try {
+   graphene::utilities::metrics_registry metrics;
+   db.set_metrics( &metrics );
+   generate_blocks( 3 );
+
+   const auto snapshot = metrics.histogram( "yoyow_block_apply_seconds", "", {} ).get_snapshot();
+   BOOST_CHECK_EQUAL( snapshot.count, 3u );
+   BOOST_CHECK_EQUAL( metrics.counter( "yoyow_blocks_applied_total", "" ).value(), 3u );
+   const string text = metrics.render();
+   BOOST_CHECK( text.find( "yoyow_head_block_number " + std::to_string( db.head_block_num() ) + "\n" ) != string::npos );
+   BOOST_CHECK( text.find( "yoyow_pending_transactions 0\n" ) != string::npos );
+   db.set_metrics( nullptr );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( slot_timing_of_generated_blocks_test )
+{ try {
+   generate_blocks( 3 );
+   uint32_t signed_blocks = 0;
+   for( const witness_slot_timing& timing : db.get_slot_timings().get_timings() )
+   {
+      signed_blocks += timing.signed_after_slot.count;
+      BOOST_CHECK_EQUAL( timing.received_after_slot.count, 0u );
+   }
+   BOOST_CHECK_EQUAL( signed_blocks, db.head_block_num() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( fork_database_saved_forks_test )
+{ try {
+   generate_blocks( 6 );
+   const uint32_t head_num = db.head_block_num();
+   auto fill = [&]( fork_database& fork_db ) {
+      fork_db.start_block( *db.fetch_block_by_number( 1 ) );
+      for( uint32_t i = 2; i <= head_num; ++i )
+         fork_db.push_block( *db.fetch_block_by_number( i ) );
+   };
+   // blocks of another fork, built on the head branch below the head
+   signed_block side1 = *db.fetch_block_by_number( head_num - 2 );
+   side1.timestamp += 1;
+   signed_block side2 = *db.fetch_block_by_number( head_num - 1 );
+   side2.previous = side1.id();
+
+   fork_database fork_db;
+   fill( fork_db );
+   fork_db.push_block( side1 );
+   fork_db.push_block( side2 );
+   fork_db.fetch_block( side1.id() )->applied = true;
+   BOOST_REQUIRE( fork_db.head()->id == db.head_block_id() );
+
+   const fc::path file = data_dir->path() / "saved_forks";
+   BOOST_CHECK_EQUAL( fork_db.save_forks( file, head_num - 1 ), 0u );
+   BOOST_CHECK_EQUAL( fork_db.save_forks( file, 1 ), 2u );
+
+   fork_database reloaded;
+   fill( reloaded );
+   BOOST_CHECK_EQUAL( reloaded.load_forks( file ), 2u );
+   BOOST_CHECK( !fc::exists( file ) );
+   BOOST_CHECK( reloaded.head()->id == db.head_block_id() );
+   BOOST_REQUIRE( reloaded.is_known_block( side2.id() ) );
+   BOOST_CHECK( reloaded.fetch_block( side1.id() )->applied );
+   BOOST_CHECK( !reloaded.fetch_block( side2.id() )->applied );
+   BOOST_CHECK( reloaded.fetch_block( side2.id() )->prev.lock()->id == side1.id() );
+   BOOST_CHECK_EQUAL( reloaded.get_stats().item_count, fork_db.get_stats().item_count );
+
+   // nothing links to the blocks of a fork database started at the head
+   fork_db.save_forks( file, 1 );
+   fork_database from_head;
+   from_head.start_block( *db.fetch_block_by_number( head_num ) );
+   BOOST_CHECK_EQUAL( from_head.load_forks( file ), 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( state_diff_replica_test )
+{ try {
+   const uint32_t skip = database::skip_undo_history_check;
+   db.set_state_diffs_kept( 100 );
+   generate_blocks( 5 );
+
+   database replica;
+   replica.open( data_dir->path() / "replica", [this]{ return genesis_state; }, "test" );
+   auto check_replicated = [&]() {
+      BOOST_CHECK( replica.head_block_id() == db.head_block_id() );
+      BOOST_CHECK( replica.fetch_block_by_number( replica.head_block_num() )->id() == db.head_block_id() );
+      for( const auto& key : replica.registered_indexes() )
+      {
+         BOOST_CHECK( replica.get_index( key.first, key.second ).hash() == db.get_index( key.first, key.second ).hash() );
+         BOOST_CHECK( replica.get_index( key.first, key.second ).get_next_id() == db.get_index( key.first, key.second ).get_next_id() );
+      }
+   };
+
+   vector<state_diff> diffs = db.get_state_diffs( replica.head_block_id(), 100 );
+   BOOST_REQUIRE_EQUAL( diffs.size(), db.head_block_num() );
+   // the diffs don't have the operations the applied operations log would miss
+   {
+      database logging_replica;
+      logging_replica.set_applied_operations_log_enabled( true );
+      logging_replica.open( data_dir->path() / "logging_replica", [this]{ return genesis_state; }, "test" );
+      GRAPHENE_CHECK_THROW( logging_replica.apply_state_diff( diffs.front() ), fc::exception );
+      BOOST_CHECK_EQUAL( logging_replica.head_block_num(), 0u );
+      logging_replica.close();
+   }
+   for( const auto& diff : diffs )
+      replica.apply_state_diff( diff );
+   check_replicated();
+   BOOST_CHECK( db.get_state_diffs( replica.head_block_id(), 100 ).empty() );
+
+   // the primary switches to another block, the replica pops its head block for it
+   const block_id_type popped = db.head_block_id();
+   db.pop_block();
+   db.generate_block( db.get_slot_time( 2 ), db.get_scheduled_witness( 2 ), init_account_priv_key, skip );
+   BOOST_REQUIRE( db.head_block_id() != popped );
+   diffs = db.get_state_diffs( db.fetch_block_by_id( db.head_block_id() )->previous, 100 );
+   BOOST_REQUIRE_EQUAL( diffs.size(), 1u );
+   replica.apply_state_diff( diffs.front() );
+   check_replicated();
+
+   // the replica undoes the diffs like blocks
+   replica.pop_block();
+   BOOST_CHECK( replica.head_block_id() == diffs.front().block.previous );
+
+   // only the diffs kept are returned
+   db.set_state_diffs_kept( 1 );
+   BOOST_CHECK( db.get_state_diffs( db.fetch_block_by_number( 1 )->id(), 100 ).empty() );
+   replica.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( shared_applied_operations_test )
+{ try {
+   ACTORS((1000));
+   database::applied_operations_ptr shared_ops;
+   database::applied_operations_impacted_ptr shared_impacted;
+   {
+      boost::signals2::scoped_connection connection = db.applied_block.connect( [&]( const signed_block& ) {
+         if( shared_ops )
+            return;
+         shared_ops = db.share_applied_operations();
+         shared_impacted = db.share_applied_operations_impacted_accounts();
+         BOOST_CHECK( shared_ops.get() == &db.get_applied_operations() );
+      } );
+      transfer( committee_account, u_1000_id, asset(10000) );
+      generate_block();
+      // the next block gets new lists, the shared ones are left as they were
+      transfer( committee_account, u_1000_id, asset(10000) );
+      generate_block();
+   }
+   BOOST_REQUIRE( shared_ops );
+   BOOST_CHECK( shared_ops.get() != &db.get_applied_operations() );
+   BOOST_REQUIRE_EQUAL( shared_impacted->size(), shared_ops->size() );
+   bool found = false;
+   for( const auto& o_op : *shared_ops )
+      found = found || ( o_op.valid() && o_op->op.which() == operation::tag<transfer_operation>::value );
+   BOOST_CHECK( found );
+   BOOST_CHECK( db.get_applied_operations().empty() );
+
+   // virtual operations are moved in
+   operation op = transfer_operation();
+   op.get<transfer_operation>().memo = memo_data();
+   const uint32_t op_id = db.push_applied_operation( std::move( op ) );
+   BOOST_CHECK( db.get_applied_operations()[op_id]->op.get<transfer_operation>().memo.valid() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_database_write_batch_test )
+{ try {
+   generate_blocks( 5 );
+   auto block = [this]( uint32_t num ) { return *db.fetch_block_by_number( num ); };
+
+   const fc::path dir = data_dir->path() / "write_batch";
+   {
+      block_database bdb;
+      bdb.set_write_batch( 4 );
+      bdb.set_sync_writes( true );
+      bdb.set_cache_size( 0 );
+      bdb.open( dir );
+      for( uint32_t i = 1; i <= 3; ++i )
+         bdb.store( block( i ).id(), block( i ) );
+      // nothing is written until the batch is full
+      BOOST_CHECK_EQUAL( fc::file_size( dir / "blocks" ), 0u );
+      BOOST_CHECK( bdb.contains( block( 2 ).id() ) );
+      bdb.remove( block( 2 ).id() );
+      BOOST_CHECK( !bdb.contains( block( 2 ).id() ) );
+      BOOST_CHECK_EQUAL( fc::file_size( dir / "index" ), 0u );
+
+      bdb.store( block( 4 ).id(), block( 4 ) );
+      BOOST_CHECK_EQUAL( fc::file_size( dir / "index" ), 5 * sizeof(index_entry) );
+      uint64_t stored_size = 0;
+      for( uint32_t i = 1; i <= 4; ++i )
+         stored_size += fc::raw::pack_size( block( i ) );
+      BOOST_CHECK_EQUAL( fc::file_size( dir / "blocks" ), stored_size );
+
+      // a lookup going to the files writes the blocks not written yet
+      bdb.store( block( 5 ).id(), block( 5 ) );
+      BOOST_REQUIRE( bdb.fetch_by_number( 5 ).valid() );
+      BOOST_CHECK( bdb.fetch_by_number( 5 )->id() == block( 5 ).id() );
+      BOOST_CHECK_EQUAL( fc::file_size( dir / "index" ), 6 * sizeof(index_entry) );
+      bdb.close();
+   }
+   {
+      block_database bdb;
+      bdb.open( dir );
+      BOOST_CHECK( bdb.contains( block( 1 ).id() ) );
+      BOOST_CHECK( !bdb.contains( block( 2 ).id() ) );
+      BOOST_CHECK( bdb.fetch_by_number( 4 )->id() == block( 4 ).id() );
+      BOOST_CHECK( *bdb.last_id() == block( 5 ).id() );
+      // the blocks not written yet are written when closed
+      bdb.store( block( 2 ).id(), block( 2 ) );
+      bdb.close();
+      bdb.open( dir );
+      BOOST_CHECK( bdb.fetch_by_number( 2 )->id() == block( 2 ).id() );
+      bdb.close();
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( applied_operations_log_test )
+{ try {
+   const fc::path dir = data_dir->path() / "applied_operations";
+   // block n applies n operations, one of them removed again
+   auto operations_of = []( uint32_t n ) {
+      vector< optional<operation_history_object> > ops( n + 1 );
+      for( uint32_t i = 0; i < n; ++i )
+      {
+         ops[i] = operation_history_object();
+         ops[i]->block_num = n;
+         ops[i]->op_in_trx = i;
+      }
+      return ops;
+   };
+   auto check_block = [&]( const applied_operations_log& log, uint32_t n ) {
+      optional< vector<operation_history_object> > ops = log.get_block( n );
+      BOOST_REQUIRE( ops.valid() );
+      BOOST_REQUIRE_EQUAL( ops->size(), n );
+      for( uint32_t i = 0; i < n; ++i )
+         BOOST_CHECK( ops->at(i).block_num == n && ops->at(i).op_in_trx == i );
+   };
+
+   applied_operations_log log;
+   log.open( dir );
+   BOOST_CHECK_EQUAL( log.first_block_num(), 0u );
+   for( uint32_t n = 5; n <= 20; ++n )
+      log.append_block( n, operations_of( n ) );
+   GRAPHENE_CHECK_THROW( log.append_block( 22, operations_of( 22 ) ), fc::exception );
+   log.flush_until_block( 15 );
+   BOOST_CHECK_EQUAL( log.first_block_num(), 5u );
+   BOOST_CHECK_EQUAL( log.flushed_block_num(), 15u );
+   BOOST_CHECK_EQUAL( log.last_block_num(), 20u );
+   for( uint32_t n = 5; n <= 20; ++n )
+      check_block( log, n );
+   BOOST_CHECK( !log.get_block( 4 ).valid() );
+   BOOST_CHECK( !log.get_block( 21 ).valid() );
+
+   // the blocks not written yet can be discarded, and are dropped when opened again
+   GRAPHENE_CHECK_THROW( log.discard_from_block( 15 ), fc::exception );
+   log.discard_from_block( 18 );
+   BOOST_CHECK_EQUAL( log.last_block_num(), 17u );
+   BOOST_CHECK( !log.get_block( 18 ).valid() );
+   log.close();
+   log.open( dir );
+   BOOST_CHECK_EQUAL( log.first_block_num(), 5u );
+   BOOST_CHECK_EQUAL( log.last_block_num(), 15u );
+   for( uint32_t n = 5; n <= 15; ++n )
+      check_block( log, n );
+   log.append_block( 16, operations_of( 16 ) );
+   log.flush_until_block( 16 );
+   check_block( log, 16 );
+   log.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( dynamic_global_property_batch_test )
+{ try {
+   generate_block();
+   const dynamic_global_property_object& stored = db.get( dynamic_global_property_id_type() );
+   const share_type pool = stored.budget_pool;
+   auto add_to_pool = [&]( int64_t amount ) {
+      db.modify_dynamic_global_properties( [&]( dynamic_global_property_object& dpo ) {
+         dpo.budget_pool += amount;
+      } );
+   };
+
+   {
+      database::dynamic_global_property_batch batch( db );
+      add_to_pool( 1 );
+      add_to_pool( 2 );
+      // read through the copy, the object itself is only modified by flush()
+      BOOST_CHECK( &db.get_dynamic_global_properties() != &stored );
+      BOOST_CHECK_EQUAL( db.get_dynamic_global_properties().budget_pool.value, pool.value + 3 );
+      BOOST_CHECK_EQUAL( stored.budget_pool.value, pool.value );
+      {
+         // nested in the first one, it does nothing
+         database::dynamic_global_property_batch inner( db );
+         add_to_pool( 4 );
+         inner.flush();
+         BOOST_CHECK_EQUAL( stored.budget_pool.value, pool.value );
+      }
+      {
+         database::dynamic_global_property_batch_pause pause( db );
+         BOOST_CHECK( &db.get_dynamic_global_properties() == &stored );
+         BOOST_CHECK_EQUAL( stored.budget_pool.value, pool.value + 7 );
+         add_to_pool( 8 );
+         BOOST_CHECK_EQUAL( stored.budget_pool.value, pool.value + 15 );
+      }
+      BOOST_CHECK( &db.get_dynamic_global_properties() != &stored );
+      add_to_pool( 16 );
+      BOOST_CHECK_EQUAL( db.get_dynamic_global_properties().budget_pool.value, pool.value + 31 );
+      batch.flush();
+      BOOST_CHECK( &db.get_dynamic_global_properties() == &stored );
+      BOOST_CHECK_EQUAL( stored.budget_pool.value, pool.value + 31 );
+   }
+
+   {
+      // dropped when left without flush()
+      database::dynamic_global_property_batch batch( db );
+      add_to_pool( 32 );
+   }
+   BOOST_CHECK( &db.get_dynamic_global_properties() == &stored );
+   BOOST_CHECK_EQUAL( stored.budget_pool.value, pool.value + 31 );
+
+   // outside of a batch the object is modified right away
+   add_to_pool( -31 );
+   BOOST_CHECK_EQUAL( stored.budget_pool.value, pool.value );
+
+   // the blocks change the object once at the end, and read their own changes before
+   const uint32_t head = db.head_block_num();
+   generate_blocks( 3 );
+   BOOST_CHECK_EQUAL( stored.head_block_number, head + 3 );
+   BOOST_CHECK( &db.get_dynamic_global_properties() == &stored );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,6 +1,7 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <graphene/app/database_api.hpp>
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/hardfork.hpp>
@@ -15,6 +16,9 @@
 #include <graphene/chain/witness_object.hpp>
 #include <graphene/chain/advertising_object.hpp>
 #include <graphene/chain/custom_vote_object.hpp>
+#include <graphene/chain/object_counts.hpp>
+#include <graphene/chain/post_feed_index.hpp>
+#include <graphene/market_history/market_history_plugin.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include <fc/log/logger.hpp>
@@ -456,6 +460,17 @@ BOOST_AUTO_TEST_CASE(score_test)
       auto active_post = *apt_itr;
       BOOST_CHECK(active_post.total_csaf == 10 * 10);
 
+      // the approvals summed on the worker threads match the ones summed on the chain thread
+      const share_type approval = db.get_post_approval_csaf(*apt_itr);
+      BOOST_CHECK(approval > 0);
+      vector<const active_post_object*> posts(GRAPHENE_PARALLEL_APPROVAL_MIN_POSTS, &(*apt_itr));
+      db.set_worker_threads(4);
+      for (const share_type& a : db.get_post_approval_csafs(posts))
+         BOOST_CHECK(a == approval);
+      db.set_worker_threads(0);
+      for (const share_type& a : db.get_post_approval_csafs(posts))
+         BOOST_CHECK(a == approval);
+
       for (auto a : score_map)
       {
          auto score_obj = db.get_score(u_9000_id, u_1001_id, 1, a.first);
@@ -478,6 +493,79 @@ BOOST_AUTO_TEST_CASE(score_test)
    }
 }
 
+BOOST_AUTO_TEST_CASE(expired_scores_budget_test)
+{
+   try{
+      ACTORS((1001)(1002)(9000));
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+
+      transfer(committee_account, u_9000_id, _core(100000));
+      add_csaf_for_account(u_1002_id, 10000);
+      add_csaf_for_account(u_9000_id, 10000);
+      generate_blocks(HARDFORK_0_6_TIME, true);
+
+      create_platform(u_9000_id, "platform", _core(10000), "www.123456789.com", "", { u_9000_private_key });
+      create_license(u_9000_id, 6, "999999999", "license title", "license body", "extra", { u_9000_private_key });
+      account_auth_platform({ u_1001_private_key }, u_1001_id, u_9000_id, 10000 * prec, account_auth_platform_object::Platform_Permission_Forward |
+         account_auth_platform_object::Platform_Permission_Liked |
+         account_auth_platform_object::Platform_Permission_Buyout |
+         account_auth_platform_object::Platform_Permission_Comment |
+         account_auth_platform_object::Platform_Permission_Reward |
+         account_auth_platform_object::Platform_Permission_Post |
+         account_auth_platform_object::Platform_Permission_Content_Update);
+      post_operation::ext extensions;
+      extensions.license_lid = 1;
+      create_post({ u_1001_private_key, u_9000_private_key }, u_9000_id, u_1001_id, "", "", "", "",
+         optional<account_uid_type>(),
+         optional<account_uid_type>(),
+         optional<post_pid_type>(),
+         extensions);
+      account_auth_platform({ u_1002_private_key }, u_1002_id, u_9000_id, 1000 * prec, 0x1F);
+      account_manage(u_1002_id, { true, true, true });
+      score_a_post({ u_1002_private_key }, u_1002_id, u_9000_id, u_1001_id, 1, 5, 10);
+      generate_block();
+      const time_point_sec score_time = db.get_score(u_9000_id, u_1001_id, 1, u_1002_id).create_time;
+
+      // a full block of older scores expires together with this one, so it is left to the next block
+      for (uint32_t i = 0; i < GRAPHENE_EXPIRED_SCORES_PER_BLOCK; ++i)
+      {
+         db.create<score_object>([&](score_object& s) {
+            s.from_account_uid = 100000 + i;
+            s.platform = 100;
+            s.poster = 200;
+            s.post_pid = 1;
+            s.create_time = score_time - 1;
+         });
+      }
+      const auto& params = db.get_global_properties().parameters;
+      generate_blocks(score_time + params.get_extension_params().approval_expiration + params.block_interval, true);
+      BOOST_CHECK_EQUAL(db.get_last_cleanup_counts().expired_scores, uint32_t(GRAPHENE_EXPIRED_SCORES_PER_BLOCK));
+      BOOST_CHECK_EQUAL(db.get_last_cleanup_counts().expired_scores_backlog, 1u);
+      BOOST_REQUIRE(db.find_score(u_9000_id, u_1001_id, 1, u_1002_id) != nullptr);
+      BOOST_CHECK(db.find_score(u_9000_id, u_1001_id, 1, u_1002_id)->create_time == score_time);
+
+      // the expired score waiting for removal is replaced by a new one
+      score_a_post({ u_1002_private_key }, u_1002_id, u_9000_id, u_1001_id, 1, 3, 10);
+      generate_block();
+      BOOST_CHECK_EQUAL(db.get_last_cleanup_counts().expired_scores, 0u);
+      BOOST_CHECK_EQUAL(db.get_last_cleanup_counts().expired_scores_backlog, 0u);
+      const score_object* score = db.find_score(u_9000_id, u_1001_id, 1, u_1002_id);
+      BOOST_REQUIRE(score != nullptr);
+      BOOST_CHECK(score->create_time > score_time);
+      BOOST_CHECK(score->score == 3);
+      BOOST_CHECK_EQUAL(db.get_index_type<score_index>().indices().size(), 1u);
+
+      // without a backlog it can't be scored again
+      BOOST_CHECK_THROW(score_a_post({ u_1002_private_key }, u_1002_id, u_9000_id, u_1001_id, 1, 3, 10), fc::exception);
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE(reward_test)
 {
    try{
@@ -541,21 +629,24 @@ BOOST_AUTO_TEST_CASE(reward_test)
       BOOST_CHECK(active_post.total_rewards.find(GRAPHENE_CORE_ASSET_AID) != active_post.total_rewards.end());
       BOOST_CHECK(active_post.total_rewards[GRAPHENE_CORE_ASSET_AID] == 10 * 1000 * prec);
 
-      BOOST_CHECK(active_post.receiptor_details.find(u_9000_id) != active_post.receiptor_details.end());
-      auto iter_reward = active_post.receiptor_details[u_9000_id].rewards.find(GRAPHENE_CORE_ASSET_AID);
-      BOOST_CHECK(iter_reward != active_post.receiptor_details[u_9000_id].rewards.end());
+      BOOST_CHECK(active_post.receiptor_count == 2);
+      const active_post_receiptor_object* receipts = db.find_active_post_receiptor(active_post.get_id(), u_9000_id);
+      BOOST_REQUIRE(receipts != nullptr);
+      auto iter_reward = receipts->rewards.find(GRAPHENE_CORE_ASSET_AID);
+      BOOST_CHECK(iter_reward != receipts->rewards.end());
       BOOST_CHECK(iter_reward->second == 10 * 250 * prec);
 
-      BOOST_CHECK(active_post.receiptor_details.find(u_1001_id) != active_post.receiptor_details.end());
-      auto iter_reward2 = active_post.receiptor_details[u_1001_id].rewards.find(GRAPHENE_CORE_ASSET_AID);
-      BOOST_CHECK(iter_reward2 != active_post.receiptor_details[u_1001_id].rewards.end());
+      const active_post_receiptor_object* receipts2 = db.find_active_post_receiptor(active_post.get_id(), u_1001_id);
+      BOOST_REQUIRE(receipts2 != nullptr);
+      auto iter_reward2 = receipts2->rewards.find(GRAPHENE_CORE_ASSET_AID);
+      BOOST_CHECK(iter_reward2 != receipts2->rewards.end());
       BOOST_CHECK(iter_reward2->second == 10 * 750 * prec);
 
       const platform_object& platform = db.get_platform_by_owner(u_9000_id);
-      auto iter_profit = platform.period_profits.find(dpo.current_active_post_sequence);
-      BOOST_CHECK(iter_profit != platform.period_profits.end());
-      auto iter_reward_profit = iter_profit->second.rewards_profits.find(GRAPHENE_CORE_ASSET_AID);
-      BOOST_CHECK(iter_reward_profit != iter_profit->second.rewards_profits.end());
+      const platform_period_profit_object* profit = db.find_platform_period_profit(platform.id, dpo.current_active_post_sequence);
+      BOOST_REQUIRE(profit != nullptr);
+      auto iter_reward_profit = profit->rewards_profits.find(GRAPHENE_CORE_ASSET_AID);
+      BOOST_CHECK(iter_reward_profit != profit->rewards_profits.end());
       BOOST_CHECK(iter_reward_profit->second == 10 * 250 * prec);
 
       post_object post_obj = db.get_post_by_platform(u_9000_id, u_1001_id, 1);
@@ -751,15 +842,16 @@ BOOST_AUTO_TEST_CASE(post_platform_reward_test)
 
       auto platform_obj = db.get_platform_by_owner(u_9000_id);
       auto post_profit = receiptor_earned.convert_to<uint64_t>() - poster_earned;
-      auto iter_profit = platform_obj.period_profits.begin();
-      BOOST_CHECK(iter_profit != platform_obj.period_profits.end());
-      BOOST_CHECK(iter_profit->second.post_profits == post_profit);
-      BOOST_CHECK(iter_profit->second.platform_profits == award_average.convert_to<uint64_t>());
+      const auto& profit_idx = db.get_index_type<platform_period_profit_index>().indices().get<by_platform_period>();
+      auto iter_profit = profit_idx.lower_bound(std::make_tuple(platform_obj.get_id()));
+      BOOST_REQUIRE(iter_profit != profit_idx.end() && iter_profit->platform == platform_obj.get_id());
+      BOOST_CHECK(iter_profit->post_profits == post_profit);
+      BOOST_CHECK(iter_profit->platform_profits == award_average.convert_to<uint64_t>());
 
       const auto& apt_idx = db.get_index_type<active_post_index>().indices().get<by_id>();
       auto active_post_obj = *(apt_idx.begin());
       BOOST_CHECK(active_post_obj.positive_win == true);
-      BOOST_CHECK(active_post_obj.receiptor_details.at(u_1001_id).post_award == poster_earned);
+      BOOST_CHECK(db.find_active_post_receiptor(active_post_obj.get_id(), u_1001_id)->post_award == poster_earned);
       BOOST_CHECK(active_post_obj.post_award == (receiptor_earned.convert_to<uint64_t>() + total_score_balance));
 
 
@@ -821,16 +913,16 @@ BOOST_AUTO_TEST_CASE(post_platform_reward_test)
 
       auto platform_obj2 = db.get_platform_by_owner(u_9000_id);
       auto post_profit2 = receiptor_earned2.convert_to<uint64_t>() - poster_earned2;
-      auto iter_profit2 = platform_obj2.period_profits.rbegin();
-      BOOST_CHECK(iter_profit2->second.post_profits == post_profit2);
-      BOOST_CHECK(iter_profit2->second.platform_profits == award_average2.convert_to<uint64_t>());
+      auto iter_profit2 = std::prev(profit_idx.upper_bound(std::make_tuple(platform_obj2.get_id())));
+      BOOST_CHECK(iter_profit2->post_profits == post_profit2);
+      BOOST_CHECK(iter_profit2->platform_profits == award_average2.convert_to<uint64_t>());
 
       const auto& apt_idx2 = db.get_index_type<active_post_index>().indices().get<by_id>();
       auto itr = apt_idx2.begin();
       itr++;
       auto active_post_obj2 = *itr;
       BOOST_CHECK(active_post_obj2.positive_win == false);
-      BOOST_CHECK(active_post_obj2.receiptor_details.at(u_1002_id).post_award == poster_earned2);
+      BOOST_CHECK(db.find_active_post_receiptor(active_post_obj2.get_id(), u_1002_id)->post_award == poster_earned2);
       BOOST_CHECK(active_post_obj2.post_award == (receiptor_earned2.convert_to<uint64_t>() + total_score_balance2));
 
 
@@ -895,15 +987,15 @@ BOOST_AUTO_TEST_CASE(post_platform_reward_test)
 
       auto platform_obj3 = db.get_platform_by_owner(u_9000_id);
       auto post_profit3 = receiptor_earned3.convert_to<uint64_t>() - poster_earned3;
-      auto iter_profit3 = platform_obj3.period_profits.rbegin();
-      BOOST_CHECK(iter_profit3->second.post_profits == post_profit3);
-      BOOST_CHECK(iter_profit3->second.platform_profits == award_average3.convert_to<uint64_t>());
+      auto iter_profit3 = std::prev(profit_idx.upper_bound(std::make_tuple(platform_obj3.get_id())));
+      BOOST_CHECK(iter_profit3->post_profits == post_profit3);
+      BOOST_CHECK(iter_profit3->platform_profits == award_average3.convert_to<uint64_t>());
 
       const auto& apt_idx3 = db.get_index_type<active_post_index>().indices().get<by_id>();
       auto itr3 = apt_idx3.rbegin();
       auto active_post_obj3 = *itr3;
       BOOST_CHECK(active_post_obj3.positive_win == true);
-      BOOST_CHECK(active_post_obj3.receiptor_details.at(u_1003_id).post_award == poster_earned3);
+      BOOST_CHECK(db.find_active_post_receiptor(active_post_obj3.get_id(), u_1003_id)->post_award == poster_earned3);
       BOOST_CHECK(active_post_obj3.post_award == (receiptor_earned3.convert_to<uint64_t>() + total_score_balance3));
 
    }
@@ -913,6 +1005,90 @@ BOOST_AUTO_TEST_CASE(post_platform_reward_test)
    }
 }
 
+BOOST_AUTO_TEST_CASE(content_award_settlement_test)
+{
+   try{
+      ACTORS((1001)(9000));
+
+      flat_map<account_uid_type, fc::ecc::private_key> score_map;
+      actor(1005, 20, score_map);
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+
+      for (int i = 0; i < 5; ++i)
+         add_csaf_for_account(genesis_state.initial_accounts.at(i).uid, 1000);
+      transfer(committee_account, u_9000_id, _core(100000));
+      generate_blocks(1);
+      add_buget_pool(931298256468);
+
+      committee_update_global_extension_parameter_item_type item;
+      item.value = { 300, 300, 1000, 31536000, 10, 10000000000, 10000000000, 10000000000, 1000, 100 };
+      item.value.platform_content_award_min_votes = 0;
+      auto execute_proposal_head_block = db.head_block_num() + 100;
+      committee_proposal_create(genesis_state.initial_accounts.at(0).uid, { item }, execute_proposal_head_block, voting_opinion_type::opinion_for, execute_proposal_head_block, execute_proposal_head_block);
+      for (int i = 1; i < 5; ++i)
+         committee_proposal_vote(genesis_state.initial_accounts.at(i).uid, 1, voting_opinion_type::opinion_for);
+      generate_blocks(102);
+      generate_blocks(HARDFORK_0_6_TIME, true);
+
+      collect_csaf_from_committee(u_9000_id, 1000);
+      create_platform(u_9000_id, "platform", _core(10000), "www.123456789.com", "", { u_9000_private_key });
+      create_license(u_9000_id, 6, "999999999", "license title", "license body", "extra", { u_9000_private_key });
+      account_auth_platform({ u_1001_private_key }, u_1001_id, u_9000_id, 10000 * prec, account_auth_platform_object::Platform_Permission_Forward |
+         account_auth_platform_object::Platform_Permission_Liked |
+         account_auth_platform_object::Platform_Permission_Buyout |
+         account_auth_platform_object::Platform_Permission_Comment |
+         account_auth_platform_object::Platform_Permission_Reward |
+         account_auth_platform_object::Platform_Permission_Post |
+         account_auth_platform_object::Platform_Permission_Content_Update);
+      post_operation::ext extensions;
+      extensions.license_lid = 1;
+      create_post({ u_1001_private_key, u_9000_private_key }, u_9000_id, u_1001_id, "", "", "", "",
+         optional<account_uid_type>(),
+         optional<account_uid_type>(),
+         optional<post_pid_type>(),
+         extensions);
+      for (auto a : score_map)
+      {
+         collect_csaf_from_committee(a.first, 100);
+         account_auth_platform({ a.second }, a.first, u_9000_id, 1000 * prec, 0x1F);
+         score_a_post({ a.second }, a.first, u_9000_id, u_1001_id, 1, 5, 50);
+      }
+
+      // the block ending the period only starts the settlement
+      const uint64_t period = db.get_dynamic_global_properties().current_active_post_sequence;
+      while (db.get_dynamic_global_properties().current_active_post_sequence == period)
+         generate_block();
+      const content_award_settlement_object* settlement = db.find(content_award_settlement_id_type());
+      BOOST_REQUIRE(settlement != nullptr);
+      BOOST_CHECK(settlement->stage == content_award_settlement_object::scanning);
+      BOOST_CHECK_EQUAL(settlement->period_sequence, period);
+      uint128_t award_average = (uint128_t)10000000000 * 300 / (86400 * 365);
+      BOOST_CHECK(settlement->content_award_amount == award_average.convert_to<int64_t>());
+      BOOST_CHECK(!db.get_dynamic_global_properties().content_award_skip_flag);
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_1001_id).core_balance == 0);
+
+      // the next block scans the post and pays it, the awards are the ones paid at once before the hardfork
+      generate_block();
+      BOOST_CHECK(settlement->stage == content_award_settlement_object::idle);
+      uint128_t score_earned = award_average * GRAPHENE_DEFAULT_PLATFORM_RECEIPTS_RATIO / GRAPHENE_100_PERCENT;
+      uint128_t receiptor_earned = award_average - score_earned;
+      uint64_t  poster_earned = (receiptor_earned * 7500 / 10000).convert_to<uint64_t>();
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_1001_id).core_balance == poster_earned);
+      const auto& apt_idx = db.get_index_type<active_post_index>().indices().get<by_post_pid>();
+      auto apt_itr = apt_idx.find(std::make_tuple(u_9000_id, u_1001_id, period, 1));
+      BOOST_REQUIRE(apt_itr != apt_idx.end());
+      BOOST_CHECK(apt_itr->effective_csaf > 0);
+      BOOST_CHECK(db.find_active_post_receiptor(apt_itr->get_id(), u_1001_id)->post_award == poster_earned);
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 
 //test api: process_platform_voted_awards()
 BOOST_AUTO_TEST_CASE(platform_voted_awards_test)
@@ -1017,6 +1193,7 @@ BOOST_AUTO_TEST_CASE(platform_voted_awards_test)
       uint128_t platform_award_by_votes = award - platform_award_basic;
 
       uint32_t total_vote = 46293 * (10 + 20) * 5;
+      const auto& vote_profit_idx = db.get_index_type<platform_vote_profit_index>().indices().get<by_platform_award_time>();
       for (const auto&p : platform_map1)
       {
          uint32_t votes = 46293 * 10;
@@ -1025,7 +1202,9 @@ BOOST_AUTO_TEST_CASE(platform_voted_awards_test)
          auto pla_act = db.get_account_statistics_by_uid(p.first);
          BOOST_CHECK(pla_act.core_balance == balance + 10000000000);
          auto platform_obj = db.get_platform_by_owner(p.first);
-         BOOST_CHECK(platform_obj.vote_profits.begin()->second == balance);
+         auto iter_vote_profit = vote_profit_idx.lower_bound(std::make_tuple(platform_obj.get_id()));
+         BOOST_REQUIRE(iter_vote_profit != vote_profit_idx.end() && iter_vote_profit->platform == platform_obj.get_id());
+         BOOST_CHECK(iter_vote_profit->profit == balance);
       }
       for (const auto&p : platform_map2)
       {
@@ -1035,7 +1214,9 @@ BOOST_AUTO_TEST_CASE(platform_voted_awards_test)
          auto pla_act = db.get_account_statistics_by_uid(p.first);
          BOOST_CHECK(pla_act.core_balance == balance + 10000000000);
          auto platform_obj = db.get_platform_by_owner(p.first);
-         BOOST_CHECK(platform_obj.vote_profits.begin()->second == balance);
+         auto iter_vote_profit = vote_profit_idx.lower_bound(std::make_tuple(platform_obj.get_id()));
+         BOOST_REQUIRE(iter_vote_profit != vote_profit_idx.end() && iter_vote_profit->platform == platform_obj.get_id());
+         BOOST_CHECK(iter_vote_profit->profit == balance);
       }
    }
    catch (fc::exception& e) {
@@ -1492,17 +1673,17 @@ BOOST_AUTO_TEST_CASE(forward_test)
       BOOST_CHECK(apt_itr != apt_idx.end());
       auto active_post = *apt_itr;
       BOOST_CHECK(active_post.forward_award == 10000 * prec);
-      auto iter_receiptor = active_post.receiptor_details.find(u_1000_id);
-      BOOST_CHECK(iter_receiptor != active_post.receiptor_details.end());
-      BOOST_CHECK(iter_receiptor->second.forward == 7500 * prec);
-      auto iter_receiptor2 = active_post.receiptor_details.find(u_9000_id);
-      BOOST_CHECK(iter_receiptor2 != active_post.receiptor_details.end());
-      BOOST_CHECK(iter_receiptor2->second.forward == 2500 * prec);
+      const active_post_receiptor_object* receipts = db.find_active_post_receiptor(active_post.get_id(), u_1000_id);
+      BOOST_REQUIRE(receipts != nullptr);
+      BOOST_CHECK(receipts->forward == 7500 * prec);
+      const active_post_receiptor_object* receipts2 = db.find_active_post_receiptor(active_post.get_id(), u_9000_id);
+      BOOST_REQUIRE(receipts2 != nullptr);
+      BOOST_CHECK(receipts2->forward == 2500 * prec);
 
       const platform_object& platform = db.get_platform_by_owner(u_9000_id);
-      auto iter_profit = platform.period_profits.find(dpo.current_active_post_sequence);
-      BOOST_CHECK(iter_profit != platform.period_profits.end());
-      BOOST_CHECK(iter_profit->second.foward_profits == 2500 * prec);
+      const platform_period_profit_object* profit = db.find_platform_period_profit(platform.id, dpo.current_active_post_sequence);
+      BOOST_REQUIRE(profit != nullptr);
+      BOOST_CHECK(profit->foward_profits == 2500 * prec);
    }
    catch (fc::exception& e) {
       edump((e.to_detail_string()));
@@ -1772,42 +1953,168 @@ BOOST_AUTO_TEST_CASE(custom_vote_test)
       BOOST_CHECK(obj.options.at(2) == "cc");
       BOOST_CHECK(obj.options.at(3) == "dd");
 
+      // the balance changes of the voters are added to the stored result when the casts expire
+      auto vote_result = [&]() { return db.get_custom_vote_result(obj); };
+
       cast_custom_vote({ u_1000_private_key }, u_1000_id, u_9000_id, 1, { 0, 1 });
-      BOOST_CHECK(obj.vote_result.at(0) == 10000 * prec);
-      BOOST_CHECK(obj.vote_result.at(1) == 10000 * prec);
-      BOOST_CHECK(obj.vote_result.at(2) == 0);
-      BOOST_CHECK(obj.vote_result.at(3) == 0);
+      BOOST_CHECK(vote_result().at(0) == 10000 * prec);
+      BOOST_CHECK(vote_result().at(1) == 10000 * prec);
+      BOOST_CHECK(vote_result().at(2) == 0);
+      BOOST_CHECK(vote_result().at(3) == 0);
 
       cast_custom_vote({ u_2000_private_key }, u_2000_id, u_9000_id, 1, { 0, 1, 2 });
-      BOOST_CHECK(obj.vote_result.at(0) == 20000 * prec);
-      BOOST_CHECK(obj.vote_result.at(1) == 20000 * prec);
-      BOOST_CHECK(obj.vote_result.at(2) == 10000 * prec);
-      BOOST_CHECK(obj.vote_result.at(3) == 0);
+      BOOST_CHECK(vote_result().at(0) == 20000 * prec);
+      BOOST_CHECK(vote_result().at(1) == 20000 * prec);
+      BOOST_CHECK(vote_result().at(2) == 10000 * prec);
+      BOOST_CHECK(vote_result().at(3) == 0);
 
       cast_custom_vote({ u_3000_private_key }, u_3000_id, u_9000_id, 1, { 2, 3 });
-      BOOST_CHECK(obj.vote_result.at(0) == 20000 * prec);
-      BOOST_CHECK(obj.vote_result.at(1) == 20000 * prec);
-      BOOST_CHECK(obj.vote_result.at(2) == 20000 * prec);
-      BOOST_CHECK(obj.vote_result.at(3) == 10000 * prec);
+      BOOST_CHECK(vote_result().at(0) == 20000 * prec);
+      BOOST_CHECK(vote_result().at(1) == 20000 * prec);
+      BOOST_CHECK(vote_result().at(2) == 20000 * prec);
+      BOOST_CHECK(vote_result().at(3) == 10000 * prec);
 
       cast_custom_vote({ u_4000_private_key }, u_4000_id, u_9000_id, 1, { 1, 3 });
-      BOOST_CHECK(obj.vote_result.at(0) == 20000 * prec);
-      BOOST_CHECK(obj.vote_result.at(1) == 30000 * prec);
-      BOOST_CHECK(obj.vote_result.at(2) == 20000 * prec);
-      BOOST_CHECK(obj.vote_result.at(3) == 20000 * prec);
+      BOOST_CHECK(vote_result().at(0) == 20000 * prec);
+      BOOST_CHECK(vote_result().at(1) == 30000 * prec);
+      BOOST_CHECK(vote_result().at(2) == 20000 * prec);
+      BOOST_CHECK(vote_result().at(3) == 20000 * prec);
 
       transfer(committee_account, u_1000_id, _core(40000));
-      BOOST_CHECK(obj.vote_result.at(0) == 60000 * prec);
-      BOOST_CHECK(obj.vote_result.at(1) == 70000 * prec);
-      BOOST_CHECK(obj.vote_result.at(2) == 20000 * prec);
-      BOOST_CHECK(obj.vote_result.at(3) == 20000 * prec);
+      BOOST_CHECK(vote_result().at(0) == 60000 * prec);
+      BOOST_CHECK(vote_result().at(1) == 70000 * prec);
+      BOOST_CHECK(vote_result().at(2) == 20000 * prec);
+      BOOST_CHECK(vote_result().at(3) == 20000 * prec);
 
       transfer(u_3000_id, u_1000_id, _core(5000));
+      BOOST_CHECK(vote_result().at(0) == 65000 * prec);
+      BOOST_CHECK(vote_result().at(1) == 75000 * prec);
+      BOOST_CHECK(vote_result().at(2) == 15000 * prec);
+      BOOST_CHECK(vote_result().at(3) == 15000 * prec);
+      BOOST_CHECK(obj.vote_result.at(0) == 20000 * prec);
+
+      generate_blocks(obj.vote_expired_time + GRAPHENE_DEFAULT_BLOCK_INTERVAL, true);
+      transfer(committee_account, u_1000_id, _core(1000));
       BOOST_CHECK(obj.vote_result.at(0) == 65000 * prec);
       BOOST_CHECK(obj.vote_result.at(1) == 75000 * prec);
-      BOOST_CHECK(obj.vote_result.at(2) == 15000 * prec);
-      BOOST_CHECK(obj.vote_result.at(3) == 15000 * prec);
+      BOOST_CHECK(vote_result().at(0) == 65000 * prec);
+      BOOST_CHECK(vote_result().at(1) == 75000 * prec);
+      BOOST_CHECK(vote_result().at(2) == 15000 * prec);
+      BOOST_CHECK(vote_result().at(3) == 15000 * prec);
+      const auto& weight_idx = db.get_index_type<custom_vote_weight_index>().indices().get<by_voter_asset>();
+      BOOST_CHECK(weight_idx.find(std::make_tuple(u_1000_id, obj.vote_asset_id)) == weight_idx.end());
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(custom_vote_cleanup_test)
+{
+   try{
+      ACTORS((1000)(9000));
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+      transfer(committee_account, u_1000_id, _core(10000));
+      transfer(committee_account, u_9000_id, _core(10000));
+      add_csaf_for_account(u_1000_id, 10000);
+      add_csaf_for_account(u_9000_id, 10000);
+      generate_blocks(HARDFORK_0_4_TIME, true);
+
+      const uint32_t remain_time = 60;
+      db.set_custom_vote_remain_time(remain_time);
+      const auto& vote_idx = db.get_index_type<custom_vote_index>().indices();
+      const auto& cast_idx = db.get_index_type<cast_custom_vote_index>().indices();
+
+      // before HARDFORK_0_6_TIME the expired custom votes are only removed every tenth block
+      create_custom_vote({ u_9000_private_key }, u_9000_id, 1, "title", "description", db.head_block_time() + 100,
+         0, share_type(1000000), 1, 3, { "aa", "bb" });
+      cast_custom_vote({ u_1000_private_key }, u_1000_id, u_9000_id, 1, { 0 });
+      time_point_sec removable = vote_idx.begin()->vote_expired_time + remain_time;
+      while (db.head_block_time() <= removable)
+         generate_block();
+      for (uint32_t i = 0; i < 10 && vote_idx.size() > 0; ++i)
+         generate_block();
+      BOOST_CHECK_EQUAL(vote_idx.size(), 0u);
+      BOOST_CHECK_EQUAL(cast_idx.size(), 0u);
+      BOOST_CHECK_EQUAL(db.head_block_num() % 10, 3u);
+      BOOST_CHECK_EQUAL(db.get_last_cleanup_counts().custom_votes, 1u);
+      BOOST_CHECK_EQUAL(db.get_last_cleanup_counts().cast_custom_votes, 1u);
+
+      // from then on by the first block they expired for, whatever its number, the indexes tell whether to look
+      generate_blocks(HARDFORK_0_6_TIME, true);
+      create_custom_vote({ u_9000_private_key }, u_9000_id, 2, "title", "description", db.head_block_time() + 100,
+         0, share_type(1000000), 1, 3, { "aa", "bb" });
+      cast_custom_vote({ u_1000_private_key }, u_1000_id, u_9000_id, 2, { 1 });
+      removable = vote_idx.begin()->vote_expired_time + remain_time;
+      while (db.head_block_time() <= removable)
+      {
+         BOOST_CHECK_EQUAL(vote_idx.size(), 1u);
+         BOOST_CHECK_EQUAL(cast_idx.size(), 1u);
+         generate_block();
+      }
+      BOOST_CHECK_EQUAL(vote_idx.size(), 0u);
+      BOOST_CHECK_EQUAL(cast_idx.size(), 0u);
+      BOOST_CHECK_EQUAL(db.get_last_cleanup_counts().custom_votes, 1u);
+      BOOST_CHECK_EQUAL(db.get_last_cleanup_counts().cast_custom_votes, 1u);
+      generate_block();
+      BOOST_CHECK_EQUAL(db.get_last_cleanup_counts().custom_votes, 0u);
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(average_pledge_budget_test)
+{
+   try{
+      ACTORS((1000)(9000));
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+      transfer(committee_account, u_1000_id, _core(100000));
+      transfer(committee_account, u_9000_id, _core(100000));
+      add_csaf_for_account(u_1000_id, 10000);
+      add_csaf_for_account(u_9000_id, 10000);
+      generate_blocks(HARDFORK_0_6_TIME, true);
+      // the pledges due must be updated by the block they are due at while the budget isn't used up
+      db.set_check_invariants_interval(1);
 
+      const witness_object& wit = create_witness(u_1000_id, u_1000_private_key, _core(100000));
+      create_platform(u_9000_id, "platform", _core(10000), "www.123456789.com", "", { u_9000_private_key });
+      const platform_object& pla = db.get_platform_by_owner(u_9000_id);
+      const auto& params = db.get_global_properties().parameters;
+      const uint32_t witness_due = wit.average_pledge_next_update_block;
+      const uint32_t platform_due = pla.average_pledge_next_update_block;
+      BOOST_CHECK_EQUAL(witness_due, db.head_block_num() + params.witness_avg_pledge_update_interval);
+      BOOST_CHECK_EQUAL(platform_due, db.head_block_num() + params.platform_avg_pledge_update_interval);
+
+      const share_type witness_average = wit.average_pledge;
+      const share_type platform_average = pla.average_pledge;
+      const uint32_t last_due = std::max(witness_due, platform_due);
+      while (db.head_block_num() < last_due)
+      {
+         generate_block();
+         // the initial witnesses may be due at the same blocks
+         const auto& counts = db.get_last_cleanup_counts();
+         if (db.head_block_num() == witness_due)
+            BOOST_CHECK_GE(counts.witness_average_pledges, 1u);
+         if (db.head_block_num() == platform_due)
+            BOOST_CHECK_GE(counts.platform_average_pledges, 1u);
+         BOOST_CHECK_LE(counts.witness_average_pledges, GRAPHENE_AVERAGE_PLEDGES_PER_BLOCK);
+         BOOST_CHECK_LE(counts.platform_average_pledges, GRAPHENE_AVERAGE_PLEDGES_PER_BLOCK);
+         BOOST_CHECK(wit.average_pledge_next_update_block > db.head_block_num());
+         BOOST_CHECK(pla.average_pledge_next_update_block > db.head_block_num());
+      }
+      BOOST_CHECK(wit.average_pledge > witness_average);
+      BOOST_CHECK(pla.average_pledge > platform_average);
+      BOOST_CHECK_EQUAL(wit.average_pledge_next_update_block, witness_due + params.witness_avg_pledge_update_interval);
+      BOOST_CHECK_EQUAL(pla.average_pledge_next_update_block, platform_due + params.platform_avg_pledge_update_interval);
    }
    catch (fc::exception& e) {
       edump((e.to_detail_string()));
@@ -2024,6 +2331,55 @@ BOOST_AUTO_TEST_CASE(csaf_compute_test)
    }
 }
 
+BOOST_AUTO_TEST_CASE(csaf_batch_compute_test)
+{
+   try{
+      ACTORS((1000)(2000)(3000)(4000));
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+
+      transfer(committee_account, u_1000_id, _core(100000000));
+      transfer(committee_account, u_2000_id, _core(100000));
+      transfer(committee_account, u_3000_id, _core(1));
+      collect_csaf_from_committee(u_1000_id, 100);
+      csaf_lease({ u_1000_private_key }, u_1000_id, u_3000_id, 15000, db.head_block_time() + 1000000);
+      generate_blocks(10);
+      transfer(committee_account, u_2000_id, _core(100));
+      generate_blocks(100);
+
+      const uint64_t window = db.get_global_properties().parameters.csaf_accumulate_window;
+      const vector<account_uid_type> uids = { u_1000_id, u_2000_id, u_3000_id, u_4000_id, committee_account };
+      for (uint8_t fork : { ENABLE_HEAD_FORK_NONE, ENABLE_HEAD_FORK_04, ENABLE_HEAD_FORK_05 })
+      {
+         vector<_account_statistics_object> expected;
+         coin_seconds_batch batch;
+         for (const auto uid : uids)
+         {
+            const _account_statistics_object& s = db.get_account_statistics_by_uid(uid);
+            expected.push_back(s);
+            expected.back().update_coin_seconds_earned(window, db.head_block_time(), db, fork);
+            batch.add(s, db, fork);
+         }
+         db.update_coin_seconds_earned(batch);
+         for (size_t i = 0; i < uids.size(); ++i)
+         {
+            const _account_statistics_object& s = db.get_account_statistics_by_uid(uids[i]);
+            BOOST_CHECK(s.coin_seconds_earned == expected[i].coin_seconds_earned);
+            BOOST_CHECK(s.coin_seconds_earned_last_update == expected[i].coin_seconds_earned_last_update);
+            BOOST_CHECK(s.average_coins == expected[i].average_coins);
+            BOOST_CHECK(s.average_coins_last_update == expected[i].average_coins_last_update);
+         }
+         generate_blocks(30);
+      }
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE(csaf_lease_test)
 {
    try{
@@ -2057,6 +2413,68 @@ BOOST_AUTO_TEST_CASE(csaf_lease_test)
    }
 }
 
+BOOST_AUTO_TEST_CASE(csaf_lease_expiration_test)
+{
+   try{
+      ACTORS((1000)(2000)(3000));
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+
+      transfer(committee_account, u_1000_id, _core(30000));
+      transfer(committee_account, u_2000_id, _core(30000));
+      add_csaf_for_account(u_1000_id, 10000);
+      add_csaf_for_account(u_2000_id, 10000);
+      generate_blocks(1);
+
+      // 1000 leases to 2000 and 3000, and 2000 leases to 3000 too, all expiring in the same block
+      const time_point_sec expiration = db.head_block_time() + 300;
+      csaf_lease({ u_1000_private_key }, u_1000_id, u_2000_id, 5000, expiration);
+      csaf_lease({ u_1000_private_key }, u_1000_id, u_3000_id, 6000, expiration);
+      csaf_lease({ u_2000_private_key }, u_2000_id, u_3000_id, 7000, expiration);
+      csaf_lease({ u_2000_private_key }, u_2000_id, u_1000_id, 1000, expiration + 300);
+      generate_blocks(1);
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_1000_id).core_leased_out == 11000 * prec);
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_1000_id).core_leased_in == 1000 * prec);
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_2000_id).core_leased_out == 8000 * prec);
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_2000_id).core_leased_in == 5000 * prec);
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_3000_id).core_leased_in == 13000 * prec);
+
+      db.set_check_invariants_interval(1);
+      while (db.head_block_time() < expiration)
+      {
+         BOOST_CHECK_EQUAL(db.get_index_type<csaf_lease_index>().indices().size(), 4u);
+         generate_block();
+      }
+      BOOST_CHECK_EQUAL(db.get_last_cleanup_counts().expired_csaf_leases, 3u);
+      BOOST_CHECK_EQUAL(db.get_index_type<csaf_lease_index>().indices().size(), 1u);
+      const _account_statistics_object& ant_1000 = db.get_account_statistics_by_uid(u_1000_id);
+      const _account_statistics_object& ant_2000 = db.get_account_statistics_by_uid(u_2000_id);
+      const _account_statistics_object& ant_3000 = db.get_account_statistics_by_uid(u_3000_id);
+      BOOST_CHECK(ant_1000.core_leased_out == 0);
+      BOOST_CHECK(ant_1000.core_leased_in == 1000 * prec);
+      BOOST_CHECK(ant_2000.core_leased_out == 1000 * prec);
+      BOOST_CHECK(ant_2000.core_leased_in == 0);
+      BOOST_CHECK(ant_3000.core_leased_in == 0);
+      // before the hardfork 0.5 the coin seconds are settled up to the block the leases expired at
+      const time_point_sec now_rounded((db.head_block_time().sec_since_epoch() / 60) * 60);
+      BOOST_CHECK(ant_1000.coin_seconds_earned_last_update == now_rounded);
+      BOOST_CHECK(ant_2000.coin_seconds_earned_last_update == now_rounded);
+      BOOST_CHECK(ant_3000.coin_seconds_earned_last_update == now_rounded);
+
+      while (db.head_block_time() < expiration + 300)
+         generate_block();
+      BOOST_CHECK_EQUAL(db.get_last_cleanup_counts().expired_csaf_leases, 1u);
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_1000_id).core_leased_in == 0);
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_2000_id).core_leased_out == 0);
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE(limit_order_test)
 {
    try{
@@ -2605,6 +3023,151 @@ BOOST_AUTO_TEST_CASE(limit_order_test3_for_votes)
    }
 }
 
+BOOST_AUTO_TEST_CASE(limit_order_taker_proceeds_test)
+{
+   try{
+      ACTORS((1000)(2000)(3000));
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+      transfer(committee_account, u_1000_id, _core(30000));
+      transfer(committee_account, u_2000_id, _core(30000));
+      transfer(committee_account, u_3000_id, _core(30000));
+      add_csaf_for_account(u_1000_id, 10000);
+      add_csaf_for_account(u_2000_id, 10000);
+      add_csaf_for_account(u_3000_id, 10000);
+      generate_blocks(HARDFORK_0_5_TIME, true);
+
+      asset_options options;
+      options.max_supply = 100000000 * prec;
+      options.market_fee_percent = 1 * GRAPHENE_1_PERCENT;
+      options.max_market_fee = 1000 * prec;
+      options.issuer_permissions = 15;
+      options.flags = charge_market_fee;
+      options.description = "test asset";
+      create_asset({ u_1000_private_key }, u_1000_id, "ABC", 5, options, 100000000 * prec);
+      // the first taker already holds the asset it buys, its proceeds are credited once after the fills,
+      // the second one doesn't, it is credited fill by fill as before
+      transfer(u_1000_id, u_2000_id, asset(1000 * prec, 1));
+      generate_blocks(1);
+      BOOST_CHECK(db.get_balance(u_3000_id, 1).amount == 0);
+
+      vector<fill_order_operation> fills;
+      boost::signals2::scoped_connection connection = db.applied_block.connect([&](const signed_block&) {
+         for (const auto& op : db.get_applied_operations())
+            if (op.valid() && op->op.which() == operation::tag<fill_order_operation>::value)
+               fills.push_back(op->op.get<fill_order_operation>());
+      });
+
+      // the taker fills three makers at three prices, the last fill takes the rest of its order
+      const auto expiration_time = db.head_block_time().sec_since_epoch() + 24 * 3600;
+      auto take = [&](account_uid_type taker, const fc::ecc::private_key& key) {
+         create_limit_order({ u_1000_private_key }, u_1000_id, 1, 100 * prec, 0, 10 * prec, expiration_time, false);
+         create_limit_order({ u_1000_private_key }, u_1000_id, 1, 200 * prec, 0, 21 * prec, expiration_time, false);
+         create_limit_order({ u_1000_private_key }, u_1000_id, 1, 300 * prec, 0, 33 * prec, expiration_time, false);
+         fills.clear();
+         const asset core_before = db.get_balance(taker, 0);
+         const asset abc_before = db.get_balance(taker, 1);
+         create_limit_order({ key }, taker, 0, 64 * prec, 1, 600 * prec, expiration_time, false);
+         generate_blocks(1);
+
+         vector<fill_order_operation> taker_fills;
+         for (const auto& fill : fills)
+            if (fill.account_id == taker)
+               taker_fills.push_back(fill);
+         BOOST_REQUIRE_EQUAL(taker_fills.size(), 3u);
+         BOOST_CHECK_EQUAL(fills.size(), 6u);
+         share_type received = 0;
+         for (const auto& fill : taker_fills)
+         {
+            BOOST_CHECK(!fill.is_maker);
+            BOOST_CHECK(fill.fee.total == asset(fill.receives.amount / 100, 1));
+            received += fill.receives.amount - fill.fee.total.amount;
+         }
+         BOOST_CHECK(taker_fills[0].receives == asset(100 * prec, 1));
+         BOOST_CHECK(taker_fills[1].receives == asset(200 * prec, 1));
+         BOOST_CHECK(taker_fills[2].receives == asset(300 * prec, 1));
+         BOOST_CHECK(db.get_balance(taker, 1).amount == abc_before.amount + received);
+         BOOST_CHECK(received == 594 * prec);
+         return std::make_tuple(taker_fills, core_before.amount - db.get_balance(taker, 0).amount);
+      };
+
+      const auto deferred = take(u_2000_id, u_2000_private_key);
+      const auto fill_by_fill = take(u_3000_id, u_3000_private_key);
+
+      // both takers end up paying and receiving the same, fill for fill
+      BOOST_CHECK(std::get<1>(deferred) == std::get<1>(fill_by_fill));
+      const auto& deferred_fills = std::get<0>(deferred);
+      const auto& expected_fills = std::get<0>(fill_by_fill);
+      for (size_t i = 0; i < expected_fills.size(); ++i)
+      {
+         BOOST_CHECK(deferred_fills[i].pays == expected_fills[i].pays);
+         BOOST_CHECK(deferred_fills[i].receives == expected_fills[i].receives);
+         BOOST_CHECK(deferred_fills[i].fee.total == expected_fills[i].fee.total);
+         BOOST_CHECK(deferred_fills[i].fill_price == expected_fills[i].fill_price);
+      }
+      BOOST_CHECK(db.get_balance(u_2000_id, 1).amount == 1594 * prec);
+      BOOST_CHECK(db.get_balance(u_3000_id, 1).amount == 594 * prec);
+      BOOST_CHECK(db.get_asset_by_aid(1).dynamic_asset_data_id(db).accumulated_fees == 12 * prec);
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(market_order_history_prune_test)
+{
+   try{
+      ACTORS((1000)(2000));
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+      transfer(committee_account, u_1000_id, _core(30000));
+      transfer(committee_account, u_2000_id, _core(30000));
+      add_csaf_for_account(u_1000_id, 10000);
+      add_csaf_for_account(u_2000_id, 10000);
+      generate_blocks(HARDFORK_0_5_TIME, true);
+
+      // only the latest 3 filled orders of a market are kept
+      boost::program_options::variables_map options;
+      options.emplace("max-order-his-records-per-market", boost::program_options::variable_value(uint32_t(3), false));
+      options.emplace("max-order-his-seconds-per-market", boost::program_options::variable_value(uint32_t(0), false));
+      auto mhplugin = app.register_plugin<graphene::market_history::market_history_plugin>();
+      mhplugin->plugin_set_app(&app);
+      mhplugin->plugin_initialize(options);
+      mhplugin->plugin_startup();
+
+      asset_options asset_ops;
+      asset_ops.max_supply = 100000000 * prec;
+      asset_ops.issuer_permissions = 15;
+      asset_ops.description = "test asset";
+      create_asset({ u_1000_private_key }, u_1000_id, "ABC", 5, asset_ops, 100000000 * prec);
+      generate_blocks(1);
+
+      const auto& history_idx = db.get_index_type<graphene::market_history::history_index>().indices();
+      const auto expiration_time = db.head_block_time().sec_since_epoch() + 24 * 3600;
+      for (int round = 0; round < 2; ++round)
+      {
+         // the buy order fills all the sell orders in the same block, each fill is recorded for maker and taker
+         for (int i = 0; i < 5; ++i)
+            create_limit_order({ u_1000_private_key }, u_1000_id, 1, (1000 + 10 * round + i) * prec, 0, 100 * prec, expiration_time, false);
+         create_limit_order({ u_2000_private_key }, u_2000_id, 0, 500 * prec, 1, 4000 * prec, expiration_time, false);
+         generate_blocks(1);
+
+         BOOST_CHECK_EQUAL(history_idx.size(), 3u);
+         for (const auto& h : history_idx)
+            BOOST_CHECK(h.time == db.head_block_time());
+      }
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE(pledge_mining_test_1)
 {
    try{
@@ -3145,6 +3708,233 @@ BOOST_AUTO_TEST_CASE(witness_test)
    }
 }
 
+BOOST_AUTO_TEST_CASE(pledge_release_queue_test)
+{
+   try{
+      ACTORS((1000)(2000));
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+      transfer(committee_account, u_1000_id, _core(1000000));
+      transfer(committee_account, u_2000_id, _core(1000000));
+      add_csaf_for_account(u_1000_id, 10000);
+      add_csaf_for_account(u_2000_id, 10000);
+      generate_blocks(HARDFORK_0_5_TIME, true);
+
+      graphene::chain::pledge_mining::ext ext;
+      create_witness({ u_1000_private_key }, u_1000_id, "test pledge witness-1", 50000 * prec, u_1000_public_key, ext);
+      create_witness({ u_2000_private_key }, u_2000_id, "test pledge witness-2", 50000 * prec, u_2000_public_key, ext);
+      generate_blocks(1);
+
+      const auto& pledges = dynamic_cast<const primary_index<pledge_balance_index>&>( db.get_index_type<pledge_balance_index>() );
+      const auto& queue = pledges.get_secondary_index<pledge_release_queue_index>();
+      auto queued = [&](pledge_balance_id_type id, uint32_t block_num) -> bool
+      {
+         const vector<pledge_balance_id_type> due = queue.due_until(block_num);
+         return std::find(due.begin(), due.end(), id) != due.end();
+      };
+      const pledge_balance_id_type pledge1 = db.get_account_statistics_by_uid(u_1000_id).pledge_balance_ids.at(pledge_balance_type::Witness);
+      const pledge_balance_id_type pledge2 = db.get_account_statistics_by_uid(u_2000_id).pledge_balance_ids.at(pledge_balance_type::Witness);
+
+      // both releases are due at the same block
+      update_witness({ u_1000_private_key }, u_1000_id, optional<public_key_type>(), _core(30000), optional<string>());
+      update_witness({ u_2000_private_key }, u_2000_id, optional<public_key_type>(), _core(30000), optional<string>());
+      generate_blocks(1);
+      const uint32_t due = db.head_block_num() + GRAPHENE_DEFAULT_WITNESS_PLEDGE_RELEASE_DELAY;
+      BOOST_CHECK(pledge1(db).earliest_release_block_number() == due);
+      BOOST_CHECK(pledge2(db).earliest_release_block_number() == due);
+      BOOST_CHECK(queued(pledge1, due) && queued(pledge2, due));
+      BOOST_CHECK(!queued(pledge1, due - 1) && !queued(pledge2, due - 1));
+
+      // a later release doesn't move the earliest one
+      update_witness({ u_1000_private_key }, u_1000_id, optional<public_key_type>(), _core(20000), optional<string>());
+      generate_blocks(1);
+      BOOST_CHECK(pledge1(db).releasing_pledges.size() == 2);
+      BOOST_CHECK(pledge1(db).earliest_release_block_number() == due);
+      BOOST_CHECK(queued(pledge1, due));
+
+      while (db.head_block_num() + 1 < due)
+         generate_block();
+      BOOST_CHECK(pledge1(db).total_releasing_pledge == 30000 * prec);
+      BOOST_CHECK(pledge2(db).total_releasing_pledge == 20000 * prec);
+
+      // the block releases both, then the queue is back after the block is undone
+      for (int i = 0; i < 2; ++i)
+      {
+         generate_block();
+         BOOST_CHECK(pledge1(db).total_releasing_pledge == 10000 * prec);
+         BOOST_CHECK(pledge2(db).total_releasing_pledge == 0);
+         BOOST_CHECK(!queued(pledge1, due) && !queued(pledge2, due));
+         BOOST_CHECK(queued(pledge1, due + 1));
+         BOOST_CHECK(!queued(pledge2, uint32_t(-1)));
+         if (i == 0)
+         {
+            db.pop_block();
+            BOOST_CHECK(queued(pledge1, due) && queued(pledge2, due));
+         }
+      }
+
+      generate_block();
+      BOOST_CHECK(pledge1(db).total_releasing_pledge == 0);
+      BOOST_CHECK(pledge1(db).pledge == 20000 * prec);
+      BOOST_CHECK(!queued(pledge1, uint32_t(-1)));
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(witness_schedule_rotation_test)
+{
+   try{
+      ACTORS((1000)(2000));
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+      transfer(committee_account, u_1000_id, _core(100000));
+      transfer(committee_account, u_2000_id, _core(100000));
+      add_csaf_for_account(u_1000_id, 10000);
+      add_csaf_for_account(u_2000_id, 10000);
+
+      graphene::chain::pledge_mining::ext ext;
+      create_witness({ u_1000_private_key }, u_1000_id, "test witness-1", 20000 * prec, u_1000_public_key, ext);
+      create_witness({ u_2000_private_key }, u_2000_id, "test witness-2", 30000 * prec, u_2000_public_key, ext);
+      generate_blocks(1);
+      db.set_check_invariants_interval(1);
+
+      typedef std::map<account_uid_type, vector<fc::uint128_t>> schedule_type;
+      auto schedule = [&]() -> schedule_type
+      {
+         schedule_type result;
+         const auto& wso = witness_schedule_id_type()(db);
+         result[0] = { wso.next_schedule_block_num, wso.current_by_vote_time, wso.current_by_pledge_time };
+         for (const auto& w : db.get_index_type<witness_index>().indices())
+         {
+            result[w.account] = { w.total_votes, w.by_vote_position, w.by_vote_position_last_update, w.by_vote_scheduled_time,
+                                  w.by_pledge_position, w.by_pledge_position_last_update, w.by_pledge_scheduled_time };
+         }
+         return result;
+      };
+
+      // the rotations of a few rounds, each undone and applied again
+      for (int round = 0; round < 3; ++round)
+      {
+         while (db.head_block_num() + 1 < witness_schedule_id_type()(db).next_schedule_block_num)
+            generate_block();
+         const schedule_type before = schedule();
+
+         generate_block();
+         const schedule_type rotated = schedule();
+         BOOST_CHECK(rotated.at(0) != before.at(0));
+         BOOST_CHECK(rotated != before);
+
+         db.pop_block();
+         BOOST_CHECK(schedule() == before);
+
+         generate_block();
+         BOOST_CHECK(schedule() == rotated);
+      }
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(candidate_vote_batch_test)
+{
+   try{
+      ACTORS((1000)(2000)(3000)(4000)(9000));
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+
+      const vector<account_uid_type> voters = { u_1000_id, u_2000_id, u_3000_id, u_4000_id };
+      const vector<fc::ecc::private_key> voter_keys = { u_1000_private_key, u_2000_private_key, u_3000_private_key, u_4000_private_key };
+      for (size_t i = 0; i < voters.size(); ++i)
+      {
+         transfer(committee_account, voters[i], _core(30000 + 1000 * i));
+         add_csaf_for_account(voters[i], 10000);
+      }
+      transfer(committee_account, u_9000_id, _core(100000));
+      add_csaf_for_account(u_9000_id, 10000);
+
+      graphene::chain::pledge_mining::ext ext;
+      create_witness({ u_9000_private_key }, u_9000_id, "test witness", 20000 * prec, u_9000_public_key, ext);
+      create_platform(u_9000_id, "platform", _core(10000), "www.123456789.com", "", { u_9000_private_key });
+      generate_blocks(1);
+
+      db.modify(db.get_global_properties(), [](global_property_object& gpo)
+      {
+         gpo.parameters.governance_votes_update_interval = 5;
+      });
+      db.set_check_invariants_interval(1);
+
+      // all the voters start voting in the same block, so their effective votes are updated in the same block
+      flat_set<account_uid_type> platforms = { u_9000_id };
+      for (size_t i = 0; i < voters.size(); ++i)
+      {
+         witness_vote_update_operation op;
+         op.voter = voters[i];
+         op.witnesses_to_add = { u_9000_id };
+         signed_transaction tx;
+         tx.operations.push_back(op);
+         set_operation_fees(tx, db.current_fee_schedule());
+         set_expiration(db, tx);
+         tx.validate();
+         sign(tx, voter_keys[i]);
+         db.push_transaction(tx, ~0);
+
+         update_platform_votes(voters[i], platforms, flat_set<account_uid_type>(), { voter_keys[i] });
+      }
+      generate_blocks(1);
+
+      auto effective_votes = [&]() -> uint64_t
+      {
+         uint64_t total = 0;
+         for (auto uid : voters)
+         {
+            const auto& stats = db.get_account_statistics_by_uid(uid);
+            total += db.find_voter(uid, stats.last_voter_sequence)->effective_votes;
+         }
+         return total;
+      };
+      const auto& stats = db.get_account_statistics_by_uid(u_1000_id);
+      const auto update_block = db.find_voter(u_1000_id, stats.last_voter_sequence)->effective_votes_next_update_block;
+      for (auto uid : voters)
+         BOOST_REQUIRE_EQUAL(db.find_voter(uid, db.get_account_statistics_by_uid(uid).last_voter_sequence)->effective_votes_next_update_block, update_block);
+      BOOST_CHECK_EQUAL(effective_votes(), 0u);
+
+      // every block until the votes are fully effective, the candidates have the sum of all the effective votes
+      const witness_object* witness = db.find_witness_by_uid(u_9000_id);
+      const platform_object* platform = db.find_platform_by_owner(u_9000_id);
+      BOOST_REQUIRE(witness != nullptr);
+      BOOST_REQUIRE(platform != nullptr);
+      uint32_t updates = 0;
+      for (int i = 0; i < 12; ++i)
+      {
+         const uint64_t last_votes = effective_votes();
+         generate_blocks(1);
+         BOOST_CHECK_EQUAL(witness->total_votes, effective_votes());
+         BOOST_CHECK_EQUAL(platform->total_votes, effective_votes());
+         if (effective_votes() != last_votes)
+         {
+            BOOST_CHECK(db.head_block_num() >= update_block);
+            ++updates;
+         }
+      }
+      BOOST_CHECK(updates >= 2);
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 //check committee after refactoring
 BOOST_AUTO_TEST_CASE(committee_test)
 {
@@ -3253,4 +4043,224 @@ BOOST_AUTO_TEST_CASE(committee_test)
    }
 }
 
+BOOST_AUTO_TEST_CASE( post_feed_test )
+{ try {
+   graphene::app::application_options options;
+   graphene::app::database_api api( db, &options );
+   const fc::variants args = { fc::variant( 100 ) };
+   // only kept when it's configured
+   GRAPHENE_CHECK_THROW( api.list_objects_page( "post_feed", args, "", 10, {} ), fc::exception );
+   db.add_secondary_index< primary_index<post_index>, post_feed_index >();
+
+   const time_point_sec now = db.head_block_time();
+   {
+      auto session = db._undo_db.start_undo_session();
+      // created out of time order, and two of them at the same time
+      const vector<uint32_t> ages = { 30, 10, 50, 10, 20 };
+      for( post_pid_type pid = 1; pid <= ages.size(); ++pid )
+      {
+         db.create<post_object>( [&]( post_object& p ) {
+            p.platform = ( pid == 3 ? 101 : 100 );
+            p.poster = 200;
+            p.post_pid = pid;
+            p.create_time = now - ages[pid - 1];
+         });
+      }
+
+      vector<post_pid_type> pids;
+      string cursor;
+      uint32_t pages = 0;
+      do
+      {
+         const graphene::app::object_page page = api.list_objects_page( "post_feed", args, cursor, 2, { "post_pid" } );
+         for( const fc::variant& v : page.objects )
+            pids.push_back( v["post_pid"].as_uint64() );
+         cursor = page.next_cursor;
+         ++pages;
+      } while( !cursor.empty() && pages < 10 );
+      BOOST_CHECK_EQUAL( pages, 2u );
+      // newest first, the later one first of those created at the same time
+      BOOST_CHECK( pids == vector<post_pid_type>( { 4, 2, 5, 1 } ) );
+   }
+   // and it follows the undo
+   BOOST_CHECK( api.list_objects_page( "post_feed", args, "", 10, {} ).objects.empty() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( post_score_totals_test )
+{ try {
+   graphene::app::application_options options;
+   graphene::app::database_api api( db, &options );
+   const auto& scores = dynamic_cast<const primary_index<score_index>&>( db.get_index_type<score_index>() );
+   const auto& totals = scores.get_secondary_index<post_score_totals_index>();
+   const uint64_t period = db.get_dynamic_global_properties().current_active_post_sequence;
+   {
+      auto session = db._undo_db.start_undo_session();
+      vector<const score_object*> created;
+      const vector<std::pair<int8_t,int64_t>> values = { { 5, 100 }, { -3, 50 }, { 2, 10 } };
+      for( size_t i = 0; i < values.size(); ++i )
+      {
+         created.push_back( &db.create<score_object>( [&]( score_object& s ) {
+            s.from_account_uid = 1000 + i;
+            s.platform = 100;
+            s.poster = 200;
+            s.post_pid = 1;
+            s.score = values[i].first;
+            s.csaf = values[i].second;
+            s.period_sequence = ( i == 2 ? period + 1 : period );
+         }) );
+      }
+      post_score_totals all = totals.totals( 100, 200, 1 );
+      BOOST_CHECK_EQUAL( all.score_count, 3u );
+      BOOST_CHECK_EQUAL( all.total_csaf.value, 160 );
+      BOOST_CHECK_EQUAL( all.total_weighted_score.value, 500 - 150 + 20 );
+      post_score_totals current = api.get_post_score_totals( 100, 200, 1, true );
+      BOOST_CHECK_EQUAL( current.score_count, 2u );
+      BOOST_CHECK_EQUAL( current.total_csaf.value, 150 );
+      BOOST_CHECK_EQUAL( current.total_weighted_score.value, 350 );
+      BOOST_CHECK_EQUAL( totals.period_totals( 100, 200, 1, period + 1 ).score_count, 1u );
+      BOOST_CHECK_EQUAL( totals.totals( 100, 200, 2 ).score_count, 0u );
+
+      // expiring
+      db.remove( *created[0] );
+      all = api.get_post_score_totals( 100, 200, 1, false );
+      BOOST_CHECK_EQUAL( all.score_count, 2u );
+      BOOST_CHECK_EQUAL( all.total_csaf.value, 60 );
+      BOOST_CHECK_EQUAL( all.total_weighted_score.value, -130 );
+   }
+   // and they follow the undo
+   BOOST_CHECK_EQUAL( totals.totals( 100, 200, 1 ).score_count, 0u );
+   BOOST_CHECK_EQUAL( totals.period_totals( 100, 200, 1, period ).total_csaf.value, 0 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( score_create_time_count_test )
+{ try {
+   const auto& scores = dynamic_cast<const primary_index<score_index>&>( db.get_index_type<score_index>() );
+   const auto& counts = scores.get_secondary_index<score_create_time_count_index>();
+   const time_point_sec now = db.head_block_time();
+   {
+      auto session = db._undo_db.start_undo_session();
+      const vector<uint32_t> ages = { 9, 9, 6, 3 };
+      vector<const score_object*> created;
+      for( size_t i = 0; i < ages.size(); ++i )
+      {
+         created.push_back( &db.create<score_object>( [&]( score_object& s ) {
+            s.from_account_uid = 1000 + i;
+            s.platform = 100;
+            s.poster = 200;
+            s.post_pid = 1;
+            s.create_time = now - ages[i];
+         }) );
+      }
+      BOOST_CHECK_EQUAL( counts.created_until( now - 10 ), 0u );
+      BOOST_CHECK_EQUAL( counts.created_until( now - 9 ), 2u );
+      BOOST_CHECK_EQUAL( counts.created_until( now - 4 ), 3u );
+      BOOST_CHECK_EQUAL( counts.created_until( now ), 4u );
+      db.remove( *created[0] );
+      BOOST_CHECK_EQUAL( counts.created_until( now - 9 ), 1u );
+   }
+   BOOST_CHECK_EQUAL( counts.created_until( now ), 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( platform_profits_test )
+{ try {
+   const platform_object& platform = db.create<platform_object>( [&]( platform_object& p ) {
+      p.owner = 100;
+      p.sequence = 1;
+   });
+   const uint32_t periods = db.get_active_post_periods();
+   const auto& idx = db.get_index_type<platform_period_profit_index>().indices().get<by_platform_period>();
+   auto profit_count = [&]() {
+      auto range = idx.equal_range( std::make_tuple( platform.get_id() ) );
+      return (uint32_t)std::distance( range.first, range.second );
+   };
+
+   db.add_platform_period_profits( platform, 1, asset( 10 ), 1, 2, 3, 4 );
+   db.add_platform_period_profits( platform, 1, asset( 5 ), 1, 2, 3, 4 );
+   const platform_period_profit_object* profit = db.find_platform_period_profit( platform.id, 1 );
+   BOOST_REQUIRE( profit != nullptr );
+   BOOST_CHECK( profit->rewards_profits.at( GRAPHENE_CORE_ASSET_AID ) == 15 );
+   BOOST_CHECK( profit->foward_profits == 2 );
+   BOOST_CHECK( profit->post_profits == 4 );
+   BOOST_CHECK( profit->platform_profits == 6 );
+   BOOST_CHECK( profit->post_profits_by_platform == 8 );
+
+   // only the latest periods are kept
+   for( uint32_t period = 2; period <= periods + 1; ++period )
+      db.add_platform_period_profits( platform, period, asset(), 0, 0, period );
+   BOOST_CHECK_EQUAL( profit_count(), periods );
+   BOOST_CHECK( db.find_platform_period_profit( platform.id, 1 ) == nullptr );
+   BOOST_CHECK( db.find_platform_period_profit( platform.id, periods + 1 ) != nullptr );
+
+   for( uint32_t i = 0; i <= periods; ++i )
+      db.add_platform_vote_profit( platform, time_point_sec( 1000 + i ), i );
+   const auto& vote_idx = db.get_index_type<platform_vote_profit_index>().indices().get<by_platform_award_time>();
+   auto range = vote_idx.equal_range( std::make_tuple( platform.get_id() ) );
+   BOOST_CHECK_EQUAL( (uint32_t)std::distance( range.first, range.second ), periods );
+   BOOST_CHECK( range.first->award_time == time_point_sec( 1001 ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( advertising_order_count_index_test )
+{ try {
+   advertising_order_count_index idx;
+   vector<advertising_order_object> orders( 3 );
+   for( size_t i = 0; i < orders.size(); ++i )
+   {
+      orders[i].platform = 100;
+      orders[i].advertising_aid = ( i < 2 ? 1 : 2 );
+      orders[i].status = advertising_undetermined;
+      orders[i].released_balance = 10 * ( i + 1 );
+      idx.object_inserted( orders[i] );
+   }
+   BOOST_CHECK_EQUAL( idx.order_count( 100, 1, advertising_undetermined ), 2u );
+   BOOST_CHECK_EQUAL( idx.order_count( 100, 2, advertising_undetermined ), 1u );
+   BOOST_CHECK_EQUAL( idx.order_count( 100, 1, advertising_accepted ), 0u );
+   BOOST_CHECK( idx.undetermined_balance() == 60 );
+
+   // one accepted, the other one of the same advertising refused
+   idx.about_to_modify( orders[0] );
+   orders[0].status = advertising_accepted;
+   idx.object_modified( orders[0] );
+   idx.about_to_modify( orders[1] );
+   orders[1].status = advertising_refused;
+   idx.object_modified( orders[1] );
+   BOOST_CHECK_EQUAL( idx.order_count( 100, 1, advertising_undetermined ), 0u );
+   BOOST_CHECK_EQUAL( idx.order_count( 100, 1, advertising_accepted ), 1u );
+   BOOST_CHECK( idx.undetermined_balance() == 30 );
+
+   for( const auto& o : orders )
+      idx.object_removed( o );
+   BOOST_CHECK_EQUAL( idx.order_count( 100, 1, advertising_accepted ), 0u );
+   BOOST_CHECK( idx.undetermined_balance() == 0 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( voter_proxy_index_test )
+{ try {
+   voter_proxy_index idx;
+   // 1 -> 2 -> 3 -> 4, 4 votes itself
+   vector<voter_object> voters( 4 );
+   for( size_t i = 0; i < voters.size(); ++i )
+   {
+      voters[i].uid = i + 1;
+      voters[i].sequence = 1;
+      voters[i].proxy_uid = ( i + 1 < voters.size() ? i + 2 : GRAPHENE_PROXY_TO_SELF_ACCOUNT_UID );
+      voters[i].proxy_sequence = 1;
+      idx.object_inserted( voters[i] );
+   }
+   BOOST_CHECK( idx.find( 3, 1 ) == &voters[2] );
+   BOOST_CHECK( idx.find( 3, 2 ) == nullptr );
+
+   BOOST_CHECK( idx.proxy_chain( voters[0], 5 ) == vector<const voter_object*>( { &voters[1], &voters[2], &voters[3] } ) );
+   BOOST_CHECK( idx.proxy_chain( voters[0], 2 ) == vector<const voter_object*>( { &voters[1], &voters[2] } ) );
+   BOOST_CHECK( idx.proxy_chain( voters[3], 2 ).empty() );
+
+   // 2 votes itself now
+   idx.about_to_modify( voters[1] );
+   voters[1].proxy_uid = GRAPHENE_PROXY_TO_SELF_ACCOUNT_UID;
+   idx.object_modified( voters[1] );
+   BOOST_CHECK( idx.proxy_chain( voters[0], 2 ) == vector<const voter_object*>( { &voters[1] } ) );
+
+   idx.object_removed( voters[2] );
+   BOOST_CHECK( idx.find( 3, 1 ) == nullptr );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,1091 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/protocol/protocol.hpp>
+#include <graphene/chain/protocol/sign_state.hpp>
+
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/content_store.hpp>
+#include <graphene/chain/object_archive.hpp>
+#include <graphene/chain/exceptions.hpp>
+#include <graphene/chain/hardfork.hpp>
+#include <graphene/chain/object_counts.hpp>
+#include <graphene/chain/order_book_index.hpp>
+#include <graphene/chain/operation_history_object.hpp>
+#include <graphene/chain/supply_totals.hpp>
+
+#include <graphene/db/node_pool.hpp>
+#include <graphene/market_history/market_history_plugin.hpp>
+
+#include "../common/database_fixture.hpp"
+
+#include <map>
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+using namespace graphene::db;
+
+BOOST_FIXTURE_TEST_SUITE( database_tests, database_fixture )
+
+BOOST_AUTO_TEST_CASE( object_counts_test )
+{ try {
+   const auto& witnesses = dynamic_cast<const primary_index<witness_index>&>( db.get_index_type<witness_index>() );
+   const auto& witness_count = witnesses.get_secondary_index<valid_witness_count_index>();
+   const uint64_t valid_witnesses = witnesses.indices().get<by_valid>().count( true );
+   BOOST_REQUIRE_GT( valid_witnesses, 0u );
+   BOOST_CHECK_EQUAL( witness_count.valid_count(), valid_witnesses );
+
+   const auto& posts = dynamic_cast<const primary_index<post_index>&>( db.get_index_type<post_index>() );
+   const auto& post_counts = posts.get_secondary_index<post_count_index>();
+   {
+      auto session = db._undo_db.start_undo_session();
+      for( post_pid_type pid = 1; pid <= 3; ++pid )
+      {
+         db.create<post_object>( [pid]( post_object& p ) {
+            p.platform = 100;
+            p.poster = ( pid < 3 ? 200 : 300 );
+            p.post_pid = pid;
+         });
+      }
+      BOOST_CHECK_EQUAL( post_counts.post_count( 100 ), 3u );
+      BOOST_CHECK_EQUAL( post_counts.post_count( 100, 200 ), 2u );
+      BOOST_CHECK_EQUAL( post_counts.post_count( 100, 300 ), 1u );
+      BOOST_CHECK_EQUAL( post_counts.post_count( 101 ), 0u );
+
+      const witness_object& wit = *witnesses.indices().get<by_valid>().lower_bound( true );
+      db.modify( wit, []( witness_object& w ) { w.is_valid = false; } );
+      BOOST_CHECK_EQUAL( witness_count.valid_count(), valid_witnesses - 1 );
+   }
+   // and they follow the undo
+   BOOST_CHECK_EQUAL( post_counts.post_count( 100 ), 0u );
+   BOOST_CHECK_EQUAL( post_counts.post_count( 100, 200 ), 0u );
+   BOOST_CHECK_EQUAL( witness_count.valid_count(), valid_witnesses );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( index_file_format_test )
+{ try {
+   ACTORS((1000)(2000));
+   generate_block();
+
+   const fc::path file = data_dir->path() / "account_index";
+   const auto& accounts = db.get_index<account_object>();
+   const_cast<graphene::db::index&>( accounts ).save( file );
+
+   // the objects are stored as packed vectors, as read before the objects were packed straight to the file
+   std::ifstream in( file.generic_string(), std::ios::binary );
+   vector<char> data( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>() );
+   fc::datastream<const char*> ds( data.data(), data.size() );
+   object_id_type next_id;
+   fc::sha256 version;
+   fc::raw::unpack( ds, next_id );
+   fc::raw::unpack( ds, version );
+   BOOST_CHECK( next_id == accounts.get_next_id() );
+   size_t count = 0;
+   while( ds.remaining() > 0 )
+   {
+      vector<char> packed;
+      fc::raw::unpack( ds, packed );
+      const account_object a = fc::raw::unpack<account_object>( packed );
+      BOOST_CHECK( a.name == db.get_account_by_uid( a.uid ).name );
+      ++count;
+   }
+   BOOST_CHECK_EQUAL( count, db.get_index_type<account_index>().indices().size() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( generic_index_find_test )
+{ try {
+   ACTORS((1000));
+   transfer( committee_account, u_1000_id, asset(10000) );
+   const auto& by_account_asset = db.get_index_type<account_balance_index>().indices().get<by_account_asset>();
+   const account_balance_object& existing = *by_account_asset.find( boost::make_tuple( u_1000_id, GRAPHENE_CORE_ASSET_AID ) );
+   const object_id_type existing_id = existing.id;
+   BOOST_CHECK( db.find_object( existing_id ) == &existing );
+
+   object_id_type created_id;
+   {
+      auto session = db._undo_db.start_undo_session();
+      const account_balance_object& created = db.create<account_balance_object>( [&]( account_balance_object& b ) {
+         b.owner = u_1000_id;
+         b.asset_type = 1234;
+      });
+      created_id = created.id;
+      BOOST_CHECK( db.find_object( created_id ) == &created );
+
+      db.remove( existing );
+      BOOST_CHECK( db.find_object( existing_id ) == nullptr );
+   }
+   BOOST_CHECK( db.find_object( created_id ) == nullptr );
+   const object* restored = db.find_object( existing_id );
+   BOOST_REQUIRE( restored != nullptr );
+   BOOST_CHECK( static_cast<const account_balance_object*>( restored )->owner == u_1000_id );
+
+   // ids of another type or past the last instance
+   BOOST_CHECK( db.find_object( object_id_type( existing_id.space(), existing_id.type() + 1, existing_id.instance() ) )
+                != restored );
+   BOOST_CHECK( db.find_object( object_id_type( existing_id.space(), existing_id.type(), existing_id.instance() + 1000000 ) )
+                == nullptr );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( typed_modify_test )
+{ try {
+   static_assert( std::is_same< graphene::db::primary_index_of<account_balance_object>::type,
+                                graphene::db::primary_index<account_balance_index> >::value,
+                  "account balances are modified without type erasure" );
+   ACTORS((1000));
+   transfer( committee_account, u_1000_id, asset(10000) );
+   const auto& by_account_asset = db.get_index_type<account_balance_index>().indices().get<by_account_asset>();
+   const account_balance_object& b = *by_account_asset.find( boost::make_tuple( u_1000_id, GRAPHENE_CORE_ASSET_AID ) );
+   const auto& totals = db.get_index_type< primary_index<account_balance_index> >()
+                           .get_secondary_index<account_balance_totals_index>();
+   const share_type total = totals.total_balances.at( GRAPHENE_CORE_ASSET_AID );
+
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.modify( b, []( account_balance_object& o ) { o.balance += 5; } );
+      // the secondary indexes and the undo history follow the typed path as well
+      BOOST_CHECK_EQUAL( b.balance.value, 10005 );
+      BOOST_CHECK( totals.total_balances.at( GRAPHENE_CORE_ASSET_AID ) == total + 5 );
+   }
+   BOOST_CHECK_EQUAL( b.balance.value, 10000 );
+   BOOST_CHECK( totals.total_balances.at( GRAPHENE_CORE_ASSET_AID ) == total );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( index_registry_test )
+{ try {
+   const auto& accounts = db.get_index_type<account_index>();
+   BOOST_CHECK( &db.get_index( account_object::space_id, account_object::type_id ) == &accounts );
+   BOOST_CHECK( &db.get_index<account_object>() == &accounts );
+   BOOST_CHECK_THROW( db.get_index( 200, 1 ), fc::assert_exception );
+   BOOST_CHECK_THROW( db.get_index( account_object::space_id, 250 ), fc::assert_exception );
+   BOOST_CHECK_THROW( db.find_object( object_id_type( 200, 1, 0 ) ), fc::assert_exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( account_member_index_test )
+{ try {
+   ACTORS((1000)(2000));
+   const auto& members = db.get_index_type< primary_index<account_index> >().get_secondary_index<account_member_index>();
+   const account_object& a = db.get_account_by_uid( u_1000_id );
+   const public_key_type new_key = generate_private_key( "new_key" ).get_public_key();
+   BOOST_CHECK( members.account_to_key_memberships.at( a.memo_key ).count( u_1000_id ) );
+
+   // not a field the memberships depend on
+   db.modify( a, []( account_object& o ) { o.name = o.name + "x"; } );
+   BOOST_CHECK( members.account_to_key_memberships.at( a.memo_key ).count( u_1000_id ) );
+
+   const public_key_type old_key = a.memo_key;
+   db.modify( a, [&]( account_object& o ) {
+      o.memo_key = new_key;
+      o.active.account_uid_auths[ authority::account_uid_auth_type( u_2000_id ) ] = 1;
+   });
+   BOOST_CHECK( members.account_to_key_memberships.at( new_key ).count( u_1000_id ) );
+   BOOST_CHECK( members.account_to_account_memberships.at( u_2000_id ).count( u_1000_id ) );
+   const auto itr = members.account_to_key_memberships.find( old_key );
+   const bool old_key_kept = a.owner.key_auths.count( old_key ) || a.active.key_auths.count( old_key );
+   BOOST_CHECK_EQUAL( itr != members.account_to_key_memberships.end() && itr->second.count( u_1000_id ), old_key_kept );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( account_member_index_erase_test )
+{ try {
+   ACTORS((1000));
+   const auto& members = db.get_index_type< primary_index<account_index> >().get_secondary_index<account_member_index>();
+   const account_object& a = db.get_account_by_uid( u_1000_id );
+   const public_key_type new_key = generate_private_key( "new_key" ).get_public_key();
+   BOOST_CHECK( members.account_to_key_memberships.at( u_1000_public_key ) == flat_set<account_uid_type>( { u_1000_id } ) );
+
+   // an entry is erased with its last account
+   db.modify( a, [&]( account_object& o ) {
+      o.owner = authority( 1, new_key, 1 );
+      o.active = authority( 1, new_key, 1 );
+      o.memo_key = new_key;
+   });
+   BOOST_CHECK( members.account_to_key_memberships.find( u_1000_public_key ) == members.account_to_key_memberships.end() );
+   BOOST_CHECK( members.account_to_key_memberships.at( new_key ).count( u_1000_id ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( account_name_index_test )
+{ try {
+   ACTORS((1000));
+   const account_object& a = db.get_account_by_uid( u_1000_id );
+   BOOST_CHECK( db.find_account_by_name( "u1000" ) == &a );
+   BOOST_CHECK( db.find_account_by_name( "u100" ) == nullptr );
+
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.modify( a, []( account_object& o ) { o.name = "renamed"; } );
+      BOOST_CHECK( db.find_account_by_name( "renamed" ) == &a );
+      BOOST_CHECK( db.find_account_by_name( "u1000" ) == nullptr );
+   }
+   BOOST_CHECK( db.find_account_by_name( "u1000" ) == &a );
+   BOOST_CHECK( db.find_account_by_name( "renamed" ) == nullptr );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( undo_modify_fields_test )
+{ try {
+   ACTORS((1000));
+   const _account_statistics_object& stats = db.get_account_statistics_by_uid( u_1000_id );
+   const _account_statistics_object before = stats;
+   typedef _account_statistics_object::core_balance_fields fields;
+
+   auto check_restored = [&]() {
+      BOOST_CHECK( stats.core_balance == before.core_balance );
+      BOOST_CHECK_EQUAL( stats.total_ops, before.total_ops );
+      BOOST_CHECK( stats.coin_seconds_earned == before.coin_seconds_earned );
+   };
+
+   // only the fields are saved
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.modify_fields<fields>( stats, []( _account_statistics_object& s ) { s.core_balance += 100; } );
+      db.modify_fields<fields>( stats, []( _account_statistics_object& s ) { s.core_balance += 100; } );
+      BOOST_CHECK_EQUAL( db._undo_db.head().old_deltas.count( stats.id ), 1u );
+      BOOST_CHECK_EQUAL( db._undo_db.head().old_values.count( stats.id ), 0u );
+      session.undo();
+   }
+   check_restored();
+
+   // a full modify after the fields turns them into a copy of the object
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.modify_fields<fields>( stats, []( _account_statistics_object& s ) { s.core_balance += 100; } );
+      db.modify( stats, []( _account_statistics_object& s ) { s.total_ops += 1; s.core_balance += 1; } );
+      BOOST_CHECK_EQUAL( db._undo_db.head().old_deltas.count( stats.id ), 0u );
+      BOOST_CHECK_EQUAL( db._undo_db.head().old_values.count( stats.id ), 1u );
+      session.undo();
+   }
+   check_restored();
+
+   // merging sessions, fields then full modify and fields then fields
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.modify_fields<fields>( stats, []( _account_statistics_object& s ) { s.core_balance += 100; } );
+      {
+         auto nested = db._undo_db.start_undo_session();
+         db.modify( stats, []( _account_statistics_object& s ) { s.total_ops += 1; } );
+         nested.merge();
+      }
+      BOOST_CHECK_EQUAL( db._undo_db.head().old_values.count( stats.id ), 1u );
+      session.undo();
+   }
+   check_restored();
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.modify_fields<fields>( stats, []( _account_statistics_object& s ) { s.core_balance += 100; } );
+      {
+         auto nested = db._undo_db.start_undo_session();
+         db.modify_fields<fields>( stats, []( _account_statistics_object& s ) { s.core_balance += 100; } );
+         nested.merge();
+      }
+      BOOST_CHECK_EQUAL( db._undo_db.head().old_deltas.count( stats.id ), 1u );
+      session.undo();
+   }
+   check_restored();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( undo_merge_into_empty_test )
+{ try {
+   ACTORS((1000));
+   const _account_statistics_object& stats = db.get_account_statistics_by_uid( u_1000_id );
+   const uint32_t total_ops = stats.total_ops;
+   object_id_type created_id;
+   {
+      auto outer = db._undo_db.start_undo_session();
+      {
+         // the outer session is still empty, the nested one is taken over as it is
+         auto nested = db._undo_db.start_undo_session();
+         db.modify( stats, []( _account_statistics_object& s ) { s.total_ops += 1; } );
+         created_id = db.create<account_balance_object>( [&]( account_balance_object& b ) {
+            b.owner = u_1000_id;
+            b.asset_type = 1234;
+         }).id;
+         nested.merge();
+      }
+      BOOST_CHECK_EQUAL( db._undo_db.head().old_values.count( stats.id ), 1u );
+      BOOST_CHECK_EQUAL( db._undo_db.head().new_ids.count( created_id ), 1u );
+      {
+         // and the next one is composed with it
+         auto nested = db._undo_db.start_undo_session();
+         db.modify( stats, []( _account_statistics_object& s ) { s.total_ops += 1; } );
+         db.remove( db.get_object( created_id ) );
+         nested.merge();
+      }
+      BOOST_CHECK_EQUAL( db._undo_db.head().new_ids.count( created_id ), 0u );
+      BOOST_CHECK_EQUAL( stats.total_ops, total_ops + 2 );
+      outer.undo();
+   }
+   BOOST_CHECK_EQUAL( stats.total_ops, total_ops );
+   BOOST_CHECK( db.find_object( created_id ) == nullptr );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( undo_database_memory_test )
+{ try {
+   ACTORS((1000));
+   generate_block();
+   const _account_statistics_object& stats = db.get_account_statistics_by_uid( u_1000_id );
+   const uint64_t memory_bytes = db.get_undo_database_stats().memory_bytes;
+   {
+      auto session = db._undo_db.start_undo_session();
+      BOOST_CHECK_EQUAL( db.get_undo_database_stats().head_state_bytes, 0u );
+      db.modify( stats, []( _account_statistics_object& s ) { s.total_ops += 1; } );
+      const uint64_t head_state_bytes = db.get_undo_database_stats().head_state_bytes;
+      BOOST_CHECK_GE( head_state_bytes, stats.clone_size() );
+      // the copy is only made once
+      db.modify( stats, []( _account_statistics_object& s ) { s.total_ops += 1; } );
+      BOOST_CHECK_EQUAL( db.get_undo_database_stats().head_state_bytes, head_state_bytes );
+      BOOST_CHECK_EQUAL( db.get_undo_database_stats().memory_bytes, memory_bytes + head_state_bytes );
+   }
+   BOOST_CHECK_EQUAL( db.get_undo_database_stats().memory_bytes, memory_bytes );
+
+   uint32_t exceeded = 0;
+   boost::signals2::scoped_connection connection =
+         db.undo_memory_limit_exceeded.connect( [&]( uint64_t ) { ++exceeded; } );
+   db.set_undo_database_memory_limit( 1 );
+   BOOST_CHECK_EQUAL( db.get_undo_database_stats().memory_limit, 1u );
+   generate_block();
+   BOOST_CHECK_GT( exceeded, 0u );
+
+   db.set_undo_database_memory_limit( 0 );
+   exceeded = 0;
+   generate_block();
+   BOOST_CHECK_EQUAL( exceeded, 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( object_version_test )
+{ try {
+   ACTORS((1000));
+   generate_block();
+   const uint32_t old_block = db.head_block_num();
+   const account_statistics_id_type stats_id = db.get_account_statistics_by_uid( u_1000_id ).id;
+   const share_type old_balance = stats_id(db).core_balance;
+   auto core_balance_at = [&]( uint32_t block_num ) -> share_type {
+      unique_ptr<object> obj = db.find_object_at_block( stats_id, block_num );
+      BOOST_REQUIRE( obj );
+      return static_cast<const _account_statistics_object&>( *obj ).core_balance;
+   };
+
+   transfer( committee_account, u_1000_id, asset(10000) );
+   ACTORS((1001));
+   // the pending transactions are left out
+   BOOST_CHECK_EQUAL( stats_id(db).core_balance.value, old_balance.value + 10000 );
+   BOOST_CHECK_EQUAL( core_balance_at( old_block ).value, old_balance.value );
+
+   generate_block();
+   BOOST_REQUIRE_LE( db.earliest_versioned_block_num(), old_block );
+   BOOST_CHECK_EQUAL( core_balance_at( db.head_block_num() ).value, old_balance.value + 10000 );
+   BOOST_CHECK_EQUAL( core_balance_at( old_block ).value, old_balance.value );
+   const object_id_type new_account_id = db.get_account_by_uid( u_1001_id ).id;
+   BOOST_CHECK( db.find_object_at_block( new_account_id, db.head_block_num() ) );
+   BOOST_CHECK( !db.find_object_at_block( new_account_id, old_block ) );
+   // the current objects are left as they are
+   BOOST_CHECK_EQUAL( stats_id(db).core_balance.value, old_balance.value + 10000 );
+
+   GRAPHENE_CHECK_THROW( db.find_object_at_block( stats_id, db.head_block_num() + 1 ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( append_only_undo_test )
+{ try {
+   const auto& ohi = db.get_index_type<operation_history_index>();
+   BOOST_REQUIRE( ohi.undo_appends_only() );
+   const object_id_type first_id = ohi.get_next_id();
+   auto create_op = [&]( uint32_t block_num ) -> object_id_type {
+      return db.create<operation_history_object>( [block_num]( operation_history_object& o ) {
+         o.block_num = block_num;
+      } ).id;
+   };
+
+   vector<object_id_type> new_ids;
+   {
+      auto outer = db._undo_db.start_undo_session();
+      const object_id_type old_id = create_op( 1 );
+      const object_id_type after_old = ohi.get_next_id();
+
+      // only the next id is kept, objects from before are tracked as usual
+      {
+         auto session = db._undo_db.start_undo_session();
+         for( uint32_t i = 0; i < 3; ++i )
+            new_ids.push_back( create_op( 2 ) );
+         db.get_mutable_index_type<operation_history_index>().use_next_id();
+         BOOST_CHECK( db._undo_db.head().new_ids.empty() );
+         db.modify( db.get( operation_history_id_type( old_id ) ), []( operation_history_object& o ) { o.block_num = 3; } );
+         BOOST_CHECK_EQUAL( db._undo_db.head().old_values.count( old_id ), 1u );
+         db.remove( db.get_object( new_ids[1] ) );
+         BOOST_CHECK_EQUAL( db._undo_db.head().removed.count( new_ids[1] ), 0u );
+         session.undo();
+      }
+      BOOST_CHECK( ohi.get_next_id() == after_old );
+      BOOST_CHECK_EQUAL( db.get( operation_history_id_type( old_id ) ).block_num, 1u );
+      for( const auto& id : new_ids )
+         BOOST_CHECK( db.find_object( id ) == nullptr );
+
+      // a removed object from before comes back
+      {
+         auto session = db._undo_db.start_undo_session();
+         create_op( 2 );
+         db.remove( db.get_object( old_id ) );
+         session.undo();
+      }
+      BOOST_CHECK( db.find_object( old_id ) != nullptr );
+      BOOST_CHECK( ohi.get_next_id() == after_old );
+
+      // merged into the outer session, everything goes with it
+      {
+         auto nested = db._undo_db.start_undo_session();
+         new_ids.push_back( create_op( 2 ) );
+         db.modify( db.get( operation_history_id_type( old_id ) ), []( operation_history_object& o ) { o.block_num = 3; } );
+         nested.merge();
+      }
+      BOOST_CHECK_EQUAL( db._undo_db.head().old_values.count( old_id ), 0u );
+      outer.undo();
+   }
+   BOOST_CHECK( ohi.get_next_id() == first_id );
+   BOOST_CHECK( db.find_object( first_id ) == nullptr );
+   BOOST_CHECK( db.find_object( new_ids.back() ) == nullptr );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( bucket_ring_index_test )
+{ try {
+   using graphene::market_history::bucket_object;
+   graphene::market_history::bucket_ring_index rings;
+   rings.set_capacity( 3 );
+   auto make_bucket = []( uint32_t num ) -> bucket_object {
+      bucket_object b;
+      b.key = graphene::market_history::bucket_key( 0, 1, 60, fc::time_point_sec( num * 60 ) );
+      b.base_volume = num;
+      return b;
+   };
+   auto opens = [&]( uint32_t start, uint32_t end, bool& in_ring ) -> vector<uint32_t> {
+      vector<bucket_object> buckets;
+      in_ring = rings.get_buckets( 0, 1, 60, fc::time_point_sec( start * 60 ), fc::time_point_sec( end * 60 ), 200, buckets );
+      vector<uint32_t> result;
+      for( const auto& b : buckets )
+         result.push_back( b.key.open.sec_since_epoch() / 60 );
+      return result;
+   };
+   bool in_ring = false;
+
+   for( uint32_t num : { 10, 11, 13 } )
+      rings.object_inserted( make_bucket( num ) );
+   BOOST_CHECK( opens( 11, 100, in_ring ) == vector<uint32_t>( { 11, 13 } ) );
+   BOOST_CHECK( in_ring );
+   opens( 0, 100, in_ring );
+   BOOST_CHECK( !in_ring ); // 10 is still in the bucket index, but no longer in the ring
+
+   rings.object_removed( make_bucket( 10 ) );
+   BOOST_CHECK( opens( 0, 100, in_ring ) == vector<uint32_t>( { 11, 13 } ) );
+   BOOST_CHECK( in_ring );
+   BOOST_CHECK( opens( 12, 13, in_ring ) == vector<uint32_t>( { 13 } ) );
+
+   bucket_object modified = make_bucket( 13 );
+   modified.base_volume = 100;
+   rings.object_modified( modified );
+   vector<bucket_object> buckets;
+   BOOST_CHECK( rings.get_buckets( 0, 1, 60, fc::time_point_sec( 13 * 60 ), fc::time_point_sec( 13 * 60 ), 200, buckets ) );
+   BOOST_REQUIRE_EQUAL( buckets.size(), 1u );
+   BOOST_CHECK_EQUAL( buckets[0].base_volume.value, 100 );
+
+   // far ahead, everything before drops out
+   rings.object_removed( make_bucket( 11 ) );
+   rings.object_removed( make_bucket( 13 ) );
+   rings.object_inserted( make_bucket( 20 ) );
+   BOOST_CHECK( opens( 0, 100, in_ring ) == vector<uint32_t>( { 20 } ) );
+   BOOST_CHECK( in_ring );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( signature_key_cache_test )
+{ try {
+   signature_key_cache cache( 2 );
+   auto key1 = generate_private_key("1");
+   auto key2 = generate_private_key("2");
+   auto key3 = generate_private_key("3");
+   digest_type d = digest_type::hash( std::string("signature_key_cache_test") );
+   signature_type sig1 = key1.sign_compact( d );
+   signature_type sig2 = key2.sign_compact( d );
+   signature_type sig3 = key3.sign_compact( d );
+
+   BOOST_CHECK( cache.get_key( d, sig1 ) == public_key_type( key1.get_public_key() ) );
+   BOOST_CHECK( cache.get_key( d, sig2 ) == public_key_type( key2.get_public_key() ) );
+   BOOST_CHECK_EQUAL( cache.size(), 2u );
+   // a hit makes sig1 the most recently used, so sig2 is dropped for sig3
+   BOOST_CHECK( cache.get_key( d, sig1 ) == public_key_type( key1.get_public_key() ) );
+   BOOST_CHECK( cache.get_key( d, sig3 ) == public_key_type( key3.get_public_key() ) );
+   BOOST_CHECK_EQUAL( cache.size(), 2u );
+   BOOST_CHECK( cache.get_key( d, sig2 ) == public_key_type( key2.get_public_key() ) );
+
+   // the same signature of another digest recovers another key
+   digest_type other = digest_type::hash( std::string("other") );
+   BOOST_CHECK( cache.get_key( other, sig1 ) != public_key_type( key1.get_public_key() ) );
+
+   cache.set_max_size( 0 );
+   BOOST_CHECK_EQUAL( cache.size(), 0u );
+   BOOST_CHECK( cache.get_key( d, sig1 ) == public_key_type( key1.get_public_key() ) );
+   BOOST_CHECK_EQUAL( cache.size(), 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( limit_order_book_index_test )
+{ try {
+   const auto& book = dynamic_cast<const primary_index<limit_order_index>&>(
+         db.get_index_type<limit_order_index>() ).get_secondary_index<limit_order_book_index>();
+   auto add_order = [&]( asset_aid_type sell, share_type for_sale, asset_aid_type receive, share_type amount )
+                    -> limit_order_id_type {
+      return db.create<limit_order_object>( [&]( limit_order_object& o ) {
+         o.seller = committee_account;
+         o.for_sale = for_sale;
+         o.sell_price = asset( for_sale, sell ) / asset( amount, receive );
+         o.expiration = db.head_block_time() + fc::days(1);
+      } ).id;
+   };
+   const price level = asset( 100, 0 ) / asset( 200, 1 );
+
+   BOOST_CHECK( book.find_side( 0, 1 ) == nullptr );
+   book.set_track_changes( true );
+   {
+      auto session = db._undo_db.start_undo_session();
+      const auto first = add_order( 0, 100, 1, 200 );
+      add_order( 0, 50, 1, 100 );
+      add_order( 0, 10, 1, 30 );
+      add_order( 1, 10, 0, 4 );
+
+      const auto* bids = book.find_side( 0, 1 );
+      BOOST_REQUIRE( bids != nullptr );
+      BOOST_REQUIRE_EQUAL( bids->size(), 2u );
+      BOOST_CHECK_EQUAL( bids->at( level ).value, 150 );
+      // the best is the last
+      BOOST_CHECK( bids->rbegin()->first == level );
+      BOOST_REQUIRE( book.find_side( 1, 0 ) != nullptr );
+      BOOST_CHECK_EQUAL( book.take_changed_levels().size(), 3u );
+
+      // a partly filled order only changes its own level
+      db.modify( first( db ), []( limit_order_object& o ) { o.for_sale = 40; } );
+      auto changed = book.take_changed_levels();
+      BOOST_REQUIRE_EQUAL( changed.size(), 1u );
+      BOOST_CHECK( changed.front().first == level );
+      BOOST_CHECK_EQUAL( changed.front().second.value, 90 );
+      BOOST_CHECK( book.take_changed_levels().empty() );
+   }
+   // undone, every level is gone and reported with nothing left
+   BOOST_CHECK( book.find_side( 0, 1 ) == nullptr );
+   BOOST_CHECK( book.find_side( 1, 0 ) == nullptr );
+   const auto changed = book.take_changed_levels();
+   BOOST_CHECK_EQUAL( changed.size(), 3u );
+   for( const auto& l : changed )
+      BOOST_CHECK_EQUAL( l.second.value, 0 );
+   book.set_track_changes( false );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( account_authority_cache_test )
+{ try {
+   ACTORS((1000)(2000));
+   account_authority_cache& cache = db.get_account_authority_cache();
+
+   // bypassed outside of blocks
+   BOOST_CHECK( !cache.is_active() );
+   BOOST_CHECK( cache.active( db, u_1000_id ) == &db.get_account_by_uid( u_1000_id ).active );
+   BOOST_CHECK_EQUAL( cache.size(), 0u );
+   generate_block();
+   BOOST_CHECK( !cache.is_active() );
+   BOOST_CHECK_EQUAL( cache.size(), 0u );
+
+   cache.begin_block();
+   BOOST_CHECK( cache.owner( db, u_1000_id ) == &db.get_account_by_uid( u_1000_id ).owner );
+   BOOST_CHECK( cache.secondary( db, u_2000_id ) == &db.get_account_by_uid( u_2000_id ).secondary );
+   BOOST_CHECK_EQUAL( cache.size(), 2u );
+   cache.invalidate( u_1000_id );
+   BOOST_CHECK_EQUAL( cache.size(), 1u );
+
+   signed_transaction trx;
+   transfer_operation op;
+   op.from = u_1000_id;
+   op.to = u_2000_id;
+   op.amount = asset( 1 );
+   trx.operations.push_back( op );
+   trx.sign( u_1000_private_key, db.get_chain_id() );
+   const auto keys = trx.get_signature_keys( db.get_chain_id() );
+   verify_authority_with( db.get_authority_resolver(), trx.operations, keys, true );
+   BOOST_CHECK_EQUAL( cache.size(), 2u );
+
+   trx.clear();
+   trx.operations.push_back( op );
+   trx.sign( u_2000_private_key, db.get_chain_id() );
+   GRAPHENE_CHECK_THROW( verify_authority_with( db.get_authority_resolver(), trx.operations,
+                                                trx.get_signature_keys( db.get_chain_id() ), true ), fc::exception );
+
+   cache.end_block();
+   BOOST_CHECK( !cache.is_active() );
+   BOOST_CHECK_EQUAL( cache.size(), 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( singleton_getters_test )
+{ try {
+   const dynamic_global_property_object& dgp = db.get_dynamic_global_properties();
+   const fc::time_point_sec time = db.head_block_time();
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.modify( dgp, []( dynamic_global_property_object& p ) { p.time += 3; } );
+      BOOST_CHECK( db.head_block_time() == time + 3 );
+   }
+   // undo restores the objects in place, so the remembered ones stay valid
+   BOOST_CHECK( &db.get_dynamic_global_properties() == &db.get( dynamic_global_property_id_type() ) );
+   BOOST_CHECK( &db.get_global_properties() == &db.get( global_property_id_type() ) );
+   BOOST_CHECK( &db.get_chain_properties() == &db.get( chain_property_id_type() ) );
+   BOOST_CHECK( &db.get_core_asset() == &db.get( asset_id_type() ) );
+   BOOST_CHECK( db.head_block_time() == time );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( index_memory_stats_test )
+{ try {
+   const auto before = db.get_index_memory_stats();
+   ACTORS((1000)(2000));
+   const auto stats = db.get_index_memory_stats();
+   BOOST_CHECK_EQUAL( stats.size(), db.registered_indexes().size() );
+   for( size_t i = 1; i < stats.size(); ++i )
+      BOOST_CHECK_GE( stats[i-1].total_bytes, stats[i].total_bytes );
+
+   auto find_stats = []( const vector<index_memory_stats>& all ) {
+      for( const auto& s : all )
+         if( s.space_id == account_object::space_id && s.type_id == account_object::type_id )
+            return s;
+      BOOST_FAIL( "no stats of the account index" );
+      return index_memory_stats();
+   };
+   const index_memory_stats accounts_before = find_stats( before );
+   const index_memory_stats accounts = find_stats( stats );
+   BOOST_CHECK_EQUAL( accounts.object_count, db.get_index_type<account_index>().indices().size() );
+   BOOST_CHECK_EQUAL( accounts.object_count, accounts_before.object_count + 2 );
+   BOOST_CHECK_EQUAL( accounts.object_bytes, accounts.object_count * sizeof( account_object ) );
+   // the names and the authorities at least
+   BOOST_CHECK_GT( accounts.dynamic_bytes, accounts_before.dynamic_bytes );
+   BOOST_CHECK_GT( accounts.container_bytes, accounts_before.container_bytes );
+   BOOST_CHECK_EQUAL( accounts.total_bytes, accounts.object_bytes + accounts.dynamic_bytes + accounts.container_bytes );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( node_pool_allocator_test )
+{ try {
+   typedef boost::multi_index_container<
+      std::pair<uint64_t, std::string>,
+      indexed_by< ordered_unique< member< std::pair<uint64_t, std::string>, uint64_t,
+                                          &std::pair<uint64_t, std::string>::first > > >,
+      node_pool_allocator< std::pair<uint64_t, std::string> >
+   > pooled_container;
+
+   pooled_container c;
+   for( uint64_t i = 0; i < 1000; ++i )
+      c.emplace( i, std::to_string( i ) );
+   const uint64_t reserved = c.get_allocator().pool()->reserved_bytes();
+   BOOST_CHECK_GT( reserved, 0u );
+   // the freed nodes are reused
+   for( uint64_t i = 0; i < 1000; i += 2 )
+      c.erase( i );
+   for( uint64_t i = 0; i < 500; ++i )
+      c.emplace( 1000 + i, std::to_string( i ) );
+   BOOST_CHECK_EQUAL( c.size(), 1000u );
+   BOOST_CHECK_EQUAL( c.get_allocator().pool()->reserved_bytes(), reserved );
+   BOOST_CHECK_EQUAL( c.find( 999 )->second, "999" );
+
+   // each container has its own pool, shared by its copies
+   pooled_container other;
+   BOOST_CHECK( other.get_allocator() != c.get_allocator() );
+   pooled_container copy( c );
+   BOOST_CHECK( copy.get_allocator() == c.get_allocator() );
+   BOOST_CHECK_EQUAL( copy.size(), c.size() );
+
+   BOOST_CHECK( db.get_index_type<post_index>().indices().get_allocator().pool() != nullptr );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( remove_range_test )
+{ try {
+   const auto& scores = dynamic_cast<const primary_index<score_index>&>( db.get_index_type<score_index>() );
+   const auto& counts = scores.get_secondary_index<score_create_time_count_index>();
+   const auto& by_time = db.get_index_type<score_index>().indices().get<by_create_time>();
+   const time_point_sec now = db.head_block_time();
+   auto session = db._undo_db.start_undo_session();
+   const vector<uint32_t> ages = { 9, 8, 6, 3 };
+   vector<score_id_type> ids;
+   for( size_t i = 0; i < ages.size(); ++i )
+   {
+      ids.push_back( db.create<score_object>( [&]( score_object& s ) {
+         s.from_account_uid = 1000 + i;
+         s.platform = 100;
+         s.poster = 200;
+         s.post_pid = 1;
+         s.create_time = now - ages[i];
+      }).id );
+   }
+   {
+      auto nested = db._undo_db.start_undo_session();
+      // removing the new object of the session again doesn't need to be undone
+      const auto& young = db.create<score_object>( [&]( score_object& s ) {
+         s.from_account_uid = 2000;
+         s.create_time = now - 7;
+      });
+      const score_id_type young_id = young.id;
+      const uint64_t removed_before = db.get_change_counts().removed;
+      BOOST_CHECK_EQUAL( db.remove_range<score_index, by_create_time>( by_time.begin(), by_time.upper_bound( now - 6 ) ), 4u );
+      BOOST_CHECK_EQUAL( db.get_change_counts().removed - removed_before, 4u );
+      BOOST_CHECK( db.find( ids[0] ) == nullptr );
+      BOOST_CHECK( db.find( ids[2] ) == nullptr );
+      BOOST_CHECK( db.find( young_id ) == nullptr );
+      BOOST_CHECK( db.find( ids[3] ) != nullptr );
+      BOOST_CHECK_EQUAL( counts.created_until( now ), 1u );
+      BOOST_CHECK_EQUAL( db._undo_db.head().removed.size(), 3u );
+      BOOST_CHECK_EQUAL( db._undo_db.head().new_ids.count( young_id ), 0u );
+      BOOST_CHECK_EQUAL( db.remove_range<score_index, by_create_time>( by_time.begin(), by_time.begin() ), 0u );
+      nested.undo();
+      BOOST_CHECK( db.find( young_id ) == nullptr );
+   }
+   for( size_t i = 0; i < ids.size(); ++i )
+   {
+      BOOST_REQUIRE( db.find( ids[i] ) != nullptr );
+      BOOST_CHECK( db.get( ids[i] ).create_time == now - ages[i] );
+   }
+   BOOST_CHECK_EQUAL( counts.created_until( now ), 4u );
+   session.undo();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( content_store_test )
+{ try {
+   const fc::path dir = data_dir->path() / "content_store";
+   const string big( 1000, 'b' );
+   content_store store;
+   store.open( dir );
+   const content_ref empty_ref = store.put( string(), 1 );
+   const content_ref big_ref = store.put( big, 2 );
+   // the values are kept in memory until their block is written out
+   BOOST_CHECK_EQUAL( store.file_size(), 0u );
+   BOOST_CHECK_EQUAL( store.get( big_ref ), big );
+   store.flush_until_block( 1 );
+   const uint64_t empty_size = store.file_size();
+   BOOST_CHECK_GT( empty_size, 0u );
+   store.flush_until_block( 2 );
+   const uint64_t size = store.file_size();
+   BOOST_CHECK_EQUAL( size, empty_size * 2 + big.size() );
+   // a value stored again is found by its hash
+   BOOST_CHECK( store.put( big, 3 ).hash == big_ref.hash );
+   store.flush_until_block( 3 );
+   BOOST_CHECK_EQUAL( store.file_size(), size );
+   BOOST_CHECK_EQUAL( store.value_count(), 2u );
+   BOOST_CHECK_EQUAL( store.get( big_ref ), big );
+   BOOST_CHECK_EQUAL( store.get( empty_ref ), string() );
+
+   // the values of pending transactions and popped blocks are never written
+   const content_ref pending_ref = store.put( string( "pending" ), 0 );
+   const content_ref popped_ref = store.put( string( "popped" ), 4 );
+   const content_ref kept_ref = store.put( string( "kept" ), 0 );
+   // the block applying a pending value keeps it
+   store.put( string( "kept" ), 4 );
+   store.discard_pending();
+   BOOST_CHECK( !store.contains( pending_ref ) );
+   BOOST_CHECK( store.contains( kept_ref ) );
+   store.discard_from_block( 4 );
+   BOOST_CHECK( !store.contains( popped_ref ) );
+   BOOST_CHECK( !store.contains( kept_ref ) );
+   store.put( string( "kept" ), 4 );
+   store.flush_until_block( 4 );
+   BOOST_CHECK_EQUAL( store.get( kept_ref ), "kept" );
+   const uint64_t kept_size = store.file_size();
+   BOOST_CHECK_GT( kept_size, size );
+   store.close();
+
+   // a value cut short at the end of the file is dropped when opened again
+   {
+      std::ofstream out( ( dir / "contents" ).generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::app );
+      out.write( big.data(), 10 );
+   }
+   store.open( dir );
+   BOOST_CHECK_EQUAL( store.file_size(), kept_size );
+   BOOST_CHECK( store.contains( big_ref ) );
+   BOOST_CHECK( store.contains( kept_ref ) );
+   BOOST_CHECK_EQUAL( store.get( big_ref ), big );
+   content_ref missing;
+   missing.hash = fc::ripemd160::hash( string( "missing" ) );
+   BOOST_CHECK( !store.contains( missing ) );
+   GRAPHENE_CHECK_THROW( store.get( missing ), fc::exception );
+   store.close();
+
+   // a big post body is kept in the post content store, a small one in the post
+   auto session = db._undo_db.start_undo_session();
+   const string body( GRAPHENE_POST_CONTENT_INLINE_MAX + 1, 'p' );
+   const post_object& post = db.create<post_object>( [&]( post_object& p ) {
+      p.platform = 100;
+      p.poster = 200;
+      p.post_pid = 1;
+      db.set_post_content( body, p.body, p.body_ref );
+      db.set_post_content( "small", p.extra_data, p.extra_data_ref );
+   });
+   BOOST_CHECK( post.body.empty() );
+   BOOST_REQUIRE( post.body_ref.valid() );
+   BOOST_CHECK( !post.extra_data_ref.valid() );
+   BOOST_CHECK( db.get_post_contents().contains( *post.body_ref ) );
+   const post_object full = db.with_post_content( post );
+   BOOST_CHECK_EQUAL( full.body, body );
+   BOOST_CHECK( !full.body_ref.valid() );
+   BOOST_CHECK_EQUAL( full.extra_data, "small" );
+   const content_ref body_ref = *post.body_ref;
+   session.undo();
+   // put outside of a block like a pending transaction, it goes with the pending state
+   db.clear_pending();
+   BOOST_CHECK( !db.get_post_contents().contains( body_ref ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( transaction_balance_lookaside_test )
+{ try {
+   ACTORS((1000)(2000));
+   transfer( committee_account, u_1000_id, asset( 1000000 ) );
+   generate_block();
+
+   {
+      transaction_evaluation_state state( &db );
+      BOOST_CHECK( state.find_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ) == nullptr );
+      const account_balance_object* balance = state.find_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID );
+      BOOST_REQUIRE( balance != nullptr );
+      BOOST_CHECK( balance == db.find_account_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ) );
+      BOOST_CHECK( state.find_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ) == balance );
+   }
+
+   // the balance of the receiver is created by the first transfer and found once by the next ones
+   const int64_t fee = db.current_fee_schedule().calculate_fee( transfer_operation() ).amount.value * 2;
+   signed_transaction trx;
+   for( int64_t amount = 1; amount <= 3; ++amount )
+   {
+      transfer_operation op;
+      op.from = u_1000_id;
+      op.to = u_2000_id;
+      op.amount = asset( amount * 100 );
+      op.fee = asset( fee );
+      trx.operations.push_back( op );
+   }
+   set_expiration( db, trx );
+   sign( trx, u_1000_private_key );
+   const int64_t before = db.get_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ).amount.value;
+   PUSH_TX( db, trx );
+   BOOST_CHECK_EQUAL( db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 600 );
+   BOOST_CHECK_LE( db.get_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, before - 600 );
+   generate_block();
+   BOOST_CHECK_EQUAL( db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 600 );
+
+   // an overdraft within the transaction still fails
+   signed_transaction overdraft;
+   for( int i = 0; i < 2; ++i )
+   {
+      transfer_operation op;
+      op.from = u_2000_id;
+      op.to = u_1000_id;
+      op.amount = asset( 400 );
+      op.fee = asset( fee );
+      overdraft.operations.push_back( op );
+   }
+   set_expiration( db, overdraft );
+   sign( overdraft, u_2000_private_key );
+   GRAPHENE_CHECK_THROW( PUSH_TX( db, overdraft ), fc::exception );
+   BOOST_CHECK_EQUAL( db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 600 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( object_archive_test )
+{ try {
+   const fc::path dir = data_dir->path() / "object_archive";
+   const object_id_type a( 1, 2, 3 );
+   const object_id_type b( 1, 2, 4 );
+   auto value_of = []( uint32_t n ) { return vector<char>( 8, char( n ) ); };
+   auto value_after = [&]( const object_archive& archive, object_id_type id, uint32_t block_num ) -> vector<char> {
+      vector<char> value;
+      BOOST_REQUIRE( archive.find_value_after( id, block_num, value ) );
+      return value;
+   };
+
+   object_archive archive;
+   archive.open( dir );
+   BOOST_CHECK_EQUAL( archive.first_block_num(), 0u );
+   // a changed by every block from 10 on, after its value at the block before, b created by block 12
+   const uint32_t last = 10 + 3 * object_archive::checkpoint_interval;
+   for( uint32_t n = 10; n <= last; ++n )
+   {
+      vector< std::pair<object_id_type, vector<char>> > old_values;
+      old_values.emplace_back( a, value_of( n - 1 ) );
+      if( n == 12 )
+         old_values.emplace_back( b, vector<char>() );
+      archive.append_block( n, std::move( old_values ) );
+   }
+   GRAPHENE_CHECK_THROW( archive.append_block( last + 2, {} ), fc::exception );
+   BOOST_CHECK_EQUAL( archive.first_block_num(), 10u );
+   BOOST_CHECK_EQUAL( archive.last_block_num(), last );
+   BOOST_CHECK_EQUAL( archive.version_count(), last - 10 + 2 );
+   BOOST_CHECK( value_after( archive, a, 20 ) == value_of( 20 ) );
+
+   archive.flush_until_block( last - 5 );
+   BOOST_CHECK_EQUAL( archive.flushed_block_num(), last - 5 );
+   for( uint32_t n = 9; n < last; ++n )
+      BOOST_CHECK( value_after( archive, a, n ) == value_of( n ) );
+   BOOST_CHECK( value_after( archive, b, 11 ).empty() );
+   vector<char> value;
+   BOOST_CHECK( !archive.find_value_after( b, 12, value ) );
+   BOOST_CHECK( !archive.find_value_after( a, last, value ) );
+
+   // the blocks not written yet can be discarded, and are dropped when opened again
+   GRAPHENE_CHECK_THROW( archive.discard_from_block( last - 5 ), fc::exception );
+   archive.discard_from_block( last - 1 );
+   BOOST_CHECK_EQUAL( archive.last_block_num(), last - 2 );
+   archive.close();
+   archive.open( dir );
+   BOOST_CHECK_EQUAL( archive.first_block_num(), 10u );
+   BOOST_CHECK_EQUAL( archive.last_block_num(), last - 5 );
+   for( uint32_t n = 9; n < last - 5; ++n )
+      BOOST_CHECK( value_after( archive, a, n ) == value_of( n ) );
+   BOOST_CHECK( value_after( archive, b, 9 ).empty() );
+   archive.append_block( last - 4, {} );
+   archive.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( object_archive_database_test )
+{ try {
+   const uint32_t skip = database::skip_undo_history_check;
+   ACTORS((1000));
+   transfer( committee_account, u_1000_id, asset(10000) );
+   generate_block();
+   const object_id_type stats_id = db.get_account_statistics_by_uid( u_1000_id ).id;
+   auto balance_at = []( const database& d, object_id_type id, uint32_t block_num ) -> int64_t {
+      unique_ptr<object> obj = d.find_object_at_block( id, block_num );
+      BOOST_REQUIRE( obj );
+      return static_cast<const _account_statistics_object&>( *obj ).core_balance.value;
+   };
+
+   // a node keeping the archive from genesis, which archives every block it applies
+   database db2;
+   db2.set_object_archive_enabled( true );
+   db2.open( data_dir->path() / "db2", [this]{ return genesis_state; }, "test" );
+   for( uint32_t i = 1; i <= db.head_block_num(); ++i )
+      db2.push_block( *db.fetch_block_by_number( i ), skip );
+   BOOST_CHECK_EQUAL( db2.get_object_archive().first_block_num(), 1u );
+   BOOST_CHECK_EQUAL( db2.get_object_archive().last_block_num(), db2.head_block_num() );
+
+   std::map<uint32_t, int64_t> balances;
+   for( int i = 1; i <= 5; ++i )
+   {
+      transfer( committee_account, u_1000_id, asset(i) );
+      generate_block();
+      db2.push_block( *db.fetch_block_by_number( db.head_block_num() ), skip );
+      balances[db.head_block_num()] = db.get_account_statistics_by_uid( u_1000_id ).core_balance.value;
+   }
+   BOOST_CHECK_EQUAL( db2.get_object_archive().last_block_num(), db2.head_block_num() );
+
+   // the block of the losing fork is dropped from the archive when it's popped
+   const uint32_t common = db2.head_block_num();
+   database db3;
+   db3.open( data_dir->path() / "db3", [this]{ return genesis_state; }, "test" );
+   for( uint32_t i = 1; i <= common; ++i )
+      db3.push_block( *db.fetch_block_by_number( i ), skip );
+   signed_transaction trx;
+   transfer_operation top;
+   top.from = GRAPHENE_COMMITTEE_ACCOUNT_UID;
+   top.to = u_1000_id;
+   top.amount = asset(1000);
+   trx.operations.push_back( top );
+   for( auto& op : trx.operations ) db2.current_fee_schedule().set_fee( op );
+   set_expiration( db2, trx );
+   db2.push_transaction( trx, ~0 );
+   const signed_block a1 = db2.generate_block( db2.get_slot_time( 1 ), db2.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   BOOST_CHECK_EQUAL( balance_at( db2, stats_id, a1.block_num() ), balances[common] + 1000 );
+   const signed_block b1 = db3.generate_block( db3.get_slot_time( 2 ), db3.get_scheduled_witness( 2 ), init_account_priv_key, skip );
+   const signed_block b2 = db3.generate_block( db3.get_slot_time( 1 ), db3.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   BOOST_CHECK( !db2.push_block( b1, skip ) );
+   BOOST_CHECK( db2.push_block( b2, skip ) );
+   BOOST_REQUIRE( db2.head_block_id() == b2.id() );
+   BOOST_CHECK_EQUAL( db2.get_object_archive().last_block_num(), b2.block_num() );
+   balances[b1.block_num()] = balances[common];
+   balances[b2.block_num()] = balances[common];
+
+   // once the blocks are irreversible and out of the undo history the versions are read from the archive
+   for( int i = 0; i < 50 && db2.earliest_versioned_block_num() <= b2.block_num(); ++i )
+      db2.generate_block( db2.get_slot_time( 1 ), db2.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   BOOST_REQUIRE_GT( db2.earliest_versioned_block_num(), b2.block_num() );
+   BOOST_CHECK_GE( db2.get_object_archive().flushed_block_num(), b2.block_num() );
+   BOOST_CHECK_LT( db2.earliest_lookup_block_num(), balances.begin()->first );
+   for( const auto& item : balances )
+      BOOST_CHECK_EQUAL( balance_at( db2, stats_id, item.first ), item.second );
+   BOOST_CHECK_EQUAL( balance_at( db2, stats_id, db2.head_block_num() ), balances[common] );
+
+   db2.close();
+   db3.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( supply_totals_undo_test )
+{ try {
+   ACTORS((1000)(2000)(3000));
+   transfer( committee_account, u_1000_id, asset( 100000000 ) );
+   transfer( committee_account, u_2000_id, asset( 100000000 ) );
+   add_csaf_for_account( u_1000_id, 10000 );
+   add_csaf_for_account( u_2000_id, 10000 );
+   generate_blocks( HARDFORK_0_5_TIME, true );
+   // every block applied from here on checks the running totals, and the invariants check them against a scan
+   db.set_check_supply_totals( true );
+   db.set_check_invariants_interval( 1 );
+
+   asset_options options;
+   options.max_supply = 1000000;
+   options.issuer_permissions = 15;
+   options.description = "test asset";
+   create_asset( { u_1000_private_key }, u_1000_id, "ABC", 2, options, 1000000 );
+   generate_block();
+   const asset_aid_type abc = 1;
+
+   const auto& balance_idx = dynamic_cast<const primary_index<account_balance_index>&>(
+                                db.get_index_type<account_balance_index>() );
+   const auto& totals = balance_idx.get_secondary_index<account_balance_totals_index>();
+   auto check_totals = [&]() {
+      map< asset_aid_type, share_type > balances;
+      map< asset_aid_type, uint64_t > holders;
+      for( const account_balance_object& b : db.get_index_type<account_balance_index>().indices() )
+      {
+         balances[b.asset_type] += b.balance;
+         if( b.balance != 0 )
+            ++holders[b.asset_type];
+      }
+      BOOST_CHECK( totals.holder_counts == holders );
+      for( const auto& item : balances )
+      {
+         const auto itr = totals.total_balances.find( item.first );
+         BOOST_CHECK( itr != totals.total_balances.end() ? itr->second == item.second : item.second == 0 );
+      }
+   };
+   check_totals();
+   BOOST_CHECK_EQUAL( totals.holder_count( abc ), 1u );
+
+   // u_2000 gets a balance, then hands all of it to u_3000
+   transfer( u_1000_id, u_2000_id, asset( 300, abc ) );
+   generate_block();
+   check_totals();
+   BOOST_CHECK_EQUAL( totals.holder_count( abc ), 2u );
+   transfer( u_2000_id, u_3000_id, asset( 300, abc ) );
+   generate_block();
+   check_totals();
+   BOOST_CHECK_EQUAL( totals.holder_count( abc ), 2u );
+   BOOST_CHECK( db.get_balance( u_2000_id, abc ).amount == 0 );
+
+   // an undone session takes the balance from zero and back
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.adjust_balance( u_3000_id, asset( -300, abc ) );
+      db.adjust_balance( u_1000_id, asset( 300, abc ) );
+      check_totals();
+      BOOST_CHECK_EQUAL( totals.holder_count( abc ), 1u );
+   }
+   check_totals();
+   BOOST_CHECK_EQUAL( totals.holder_count( abc ), 2u );
+
+   // popping the blocks gives u_2000 its balance back, then takes it
+   db.pop_block();
+   check_totals();
+   BOOST_CHECK_EQUAL( totals.holder_count( abc ), 2u );
+   BOOST_CHECK( db.get_balance( u_2000_id, abc ).amount == 300 );
+   BOOST_CHECK( db.get_balance( u_3000_id, abc ).amount == 0 );
+   db.pop_block();
+   check_totals();
+   BOOST_CHECK_EQUAL( totals.holder_count( abc ), 1u );
+   BOOST_CHECK( db.get_balance( u_2000_id, abc ).amount == 0 );
+
+   // the blocks built on the popped state check the totals again
+   db.clear_pending();
+   transfer( u_1000_id, u_3000_id, asset( 100, abc ) );
+   generate_block();
+   check_totals();
+   BOOST_CHECK_EQUAL( totals.holder_count( abc ), 2u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -74,4 +74,25 @@ BOOST_AUTO_TEST_CASE( nonzero_fee_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( fee_parameters_lookup_test )
+{ try {
+   fee_schedule schedule = fee_schedule::get_default();
+   schedule.get<transfer_operation>().fee = 12345;
+   const int transfer_which = operation::tag<transfer_operation>::value;
+   for( int i = 0; i < fee_parameters().count(); ++i )
+      BOOST_CHECK_EQUAL( schedule.get_parameters( i ).which(), i );
+   BOOST_CHECK_EQUAL( schedule.get_parameters( transfer_which ).get<transfer_operation::fee_parameters_type>().fee,
+                      12345u );
+
+   // without the types before it, the transfer parameters are found by searching, missing ones are the defaults
+   fee_schedule sparse;
+   sparse.parameters.insert( schedule.get_parameters( transfer_which ) );
+   BOOST_CHECK_EQUAL( sparse.get_parameters( transfer_which ).get<transfer_operation::fee_parameters_type>().fee,
+                      12345u );
+   const int other = ( transfer_which == 0 ? 1 : 0 );
+   BOOST_CHECK_EQUAL( sparse.get_parameters( other ).which(), other );
+   BOOST_CHECK( sparse.calculate_fee( transfer_operation() ) == schedule.calculate_fee( transfer_operation() ) );
+   GRAPHENE_CHECK_THROW( sparse.get_parameters( fee_parameters().count() ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
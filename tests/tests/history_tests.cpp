@@ -0,0 +1,314 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/account_history/account_history_plugin.hpp>
+#include <graphene/app/api.hpp>
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/protocol/protocol.hpp>
+
+#include <graphene/chain/account_history_store.hpp>
+#include <graphene/chain/applied_operations_log.hpp>
+#include <graphene/chain/object_counts.hpp>
+#include <graphene/chain/operation_history_object.hpp>
+
+#include "../common/database_fixture.hpp"
+
+#include <algorithm>
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+using namespace graphene::db;
+
+BOOST_FIXTURE_TEST_SUITE( history_tests, database_fixture )
+
+BOOST_AUTO_TEST_CASE( account_history_store_test )
+{ try {
+   const fc::path dir = data_dir->path() / "account_history";
+   auto make_op = []( uint32_t block_num, account_uid_type to ) -> operation_history_object {
+      operation_history_object op;
+      transfer_operation t;
+      t.to = to;
+      op.op = t;
+      op.block_num = block_num;
+      return op;
+   };
+   flat_set<account_uid_type> both;
+   both.insert( 1 );
+   both.insert( 2 );
+   flat_set<account_uid_type> first;
+   first.insert( 1 );
+
+   account_history_store store;
+   store.open( dir );
+   for( uint32_t block_num = 1; block_num <= 3; ++block_num )
+   {
+      store.append( make_op( block_num, 2 ), both );
+      store.append( make_op( block_num, 1 ), first );
+   }
+   store.flush_until_block( 2 );
+   BOOST_CHECK_EQUAL( store.flushed_block_num(), 2u );
+
+   // block 3 is replaced after a fork switch
+   store.discard_from_block( 3 );
+   BOOST_CHECK_EQUAL( store.total_ops( 1 ), 4u );
+   const operation_history_id_type id = store.append( make_op( 3, 3 ), first );
+   BOOST_CHECK_EQUAL( id.instance.value, 4u );
+   BOOST_CHECK_EQUAL( store.total_ops( 1 ), 5u );
+   BOOST_CHECK_EQUAL( store.total_ops( 2 ), 2u );
+
+   auto history = store.get_account_history( 1, optional<uint16_t>(), 0, 0, 10 );
+   BOOST_REQUIRE_EQUAL( history.size(), 5u );
+   for( uint32_t i = 0; i < history.size(); ++i )
+   {
+      BOOST_CHECK_EQUAL( history[i].first, 5 - i );
+      BOOST_CHECK_EQUAL( history[i].second.id.instance.value, 4 - i );
+   }
+   BOOST_CHECK( history[0].second.op.get<transfer_operation>().to == 3 );
+   history = store.get_account_history( 1, optional<uint16_t>(), 2, 4, 2 );
+   BOOST_REQUIRE_EQUAL( history.size(), 2u );
+   BOOST_CHECK_EQUAL( history[0].first, 4u );
+   BOOST_CHECK_EQUAL( history[1].first, 3u );
+   history = store.get_account_history( 2, optional<uint16_t>( operation::tag<transfer_operation>::value ), 0, 0, 10 );
+   BOOST_REQUIRE_EQUAL( history.size(), 2u );
+   BOOST_CHECK( store.get_account_history( 2, optional<uint16_t>( operation::tag<account_create_operation>::value ), 0, 0, 10 ).empty() );
+
+   // only the operations of the flushed blocks are there after opening again
+   store.close();
+   store.open( dir );
+   BOOST_CHECK_EQUAL( store.flushed_block_num(), 2u );
+   BOOST_CHECK_EQUAL( store.total_ops( 1 ), 4u );
+   BOOST_CHECK( !store.get_operation( operation_history_id_type( 4 ) ).valid() );
+   history = store.get_account_history( 2, optional<uint16_t>(), 0, 0, 10 );
+   BOOST_REQUIRE_EQUAL( history.size(), 2u );
+   BOOST_CHECK_EQUAL( history[0].second.id.instance.value, 2u );
+   BOOST_CHECK_EQUAL( history[1].second.id.instance.value, 0u );
+   store.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( account_history_catch_up_test )
+{ try {
+   const fc::path dir = data_dir->path() / "catch_up";
+   const account_uid_type from = calc_account_uid( 10 );
+   const account_uid_type to = calc_account_uid( 11 );
+   auto transfer_in_blocks = [&]( database& d, uint32_t blocks ) {
+      for( uint32_t i = 0; i < blocks; ++i )
+      {
+         signed_transaction tx;
+         transfer_operation op;
+         op.from = from;
+         op.to = to;
+         op.amount = asset( 1 );
+         tx.operations.push_back( op );
+         for( auto& o : tx.operations ) d.current_fee_schedule().set_fee( o );
+         set_expiration( d, tx );
+         d.push_transaction( tx, ~0 );
+         d.generate_block( d.get_slot_time( 1 ), d.get_scheduled_witness( 1 ), init_account_priv_key, ~0 );
+      }
+   };
+
+   // the blocks are only kept in the applied operations log at first
+   {
+      database d;
+      d.set_applied_operations_log_enabled( true );
+      d.open( dir / "blockchain", [this]{ return genesis_state; }, "test" );
+      d.adjust_balance( from, asset( 1000 ) );
+      transfer_in_blocks( d, 30 );
+      d.close();
+   }
+
+   boost::program_options::variables_map options;
+   options.emplace( "plugins", boost::program_options::variable_value( string( "account_history" ), false ) );
+   options.emplace( "history-on-disk", boost::program_options::variable_value( true, false ) );
+   graphene::app::application node;
+   node.register_plugin<graphene::account_history::account_history_plugin>();
+   node.initialize( dir, options );
+   database& d = *node.chain_database();
+   d.set_applied_operations_log_enabled( true );
+   d.open( dir / "blockchain", [this]{ return genesis_state; }, "test" );
+   node.initialize_plugins( options );
+   node.startup_plugins();
+   const std::shared_ptr<account_history_store> store = node.get_account_history_store();
+   BOOST_REQUIRE( store );
+
+   // the blocks of the transfers in the history of the sender, the most recent first
+   auto transfer_blocks = [&]() {
+      vector<uint32_t> blocks;
+      store->visit_account_history( from, optional<uint16_t>( operation::tag<transfer_operation>::value ), 0,
+                                    [&]( uint32_t, operation_history_id_type id ) {
+         blocks.push_back( store->get_operation( id )->block_num );
+         return true;
+      } );
+      return blocks;
+   };
+   auto wait_for = [&]( size_t count ) {
+      for( uint32_t i = 0; i < 500 && transfer_blocks().size() < count; ++i )
+         fc::usleep( fc::milliseconds( 10 ) );
+      const vector<uint32_t> blocks = transfer_blocks();
+      BOOST_REQUIRE_EQUAL( blocks.size(), count );
+      // every block once, whether it was added by the catch up or after it
+      for( size_t i = 1; i < blocks.size(); ++i )
+         BOOST_CHECK_EQUAL( blocks[i - 1], blocks[i] + 1 );
+      BOOST_CHECK_EQUAL( blocks.front(), d.head_block_num() );
+   };
+
+   // the blocks applied while it catches up are left to it
+   transfer_in_blocks( d, 30 );
+   wait_for( 60 );
+   // and handed over once it's done
+   transfer_in_blocks( d, 10 );
+   wait_for( 70 );
+
+   node.shutdown_plugins();
+   d.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( account_history_sequence_index_test )
+{ try {
+   account_history_sequence_index idx;
+   vector<account_transaction_history_object> objs;
+   for( uint32_t seq = 1; seq <= 10; ++seq )
+   {
+      account_transaction_history_object h;
+      h.id = account_transaction_history_id_type( seq );
+      h.account = 100;
+      h.sequence = seq;
+      h.operation_type = ( seq % 3 == 0 ? 1 : 0 );
+      h.operation_id = operation_history_id_type( seq * 10 );
+      objs.push_back( h );
+      idx.object_inserted( h );
+   }
+   const auto sequences = []( const vector<account_history_sequence_index::entry>& entries ) {
+      vector<uint32_t> result;
+      for( const auto& e : entries )
+         result.push_back( e.sequence );
+      return result;
+   };
+
+   // latest first, from start down to stop
+   BOOST_CHECK( sequences( idx.get_history( 100, flat_set<uint16_t>(), 4, 8, 100 ) ) == vector<uint32_t>( { 8, 7, 6, 5, 4 } ) );
+   BOOST_CHECK( sequences( idx.get_history( 100, flat_set<uint16_t>(), 0, 10, 3 ) ) == vector<uint32_t>( { 10, 9, 8 } ) );
+   BOOST_CHECK( sequences( idx.get_history( 100, flat_set<uint16_t>( { 1 } ), 0, 8, 100 ) ) == vector<uint32_t>( { 6, 3 } ) );
+   BOOST_CHECK( idx.get_history( 100, flat_set<uint16_t>( { 2 } ), 0, 10, 100 ).empty() );
+   BOOST_CHECK( idx.get_history( 101, flat_set<uint16_t>(), 0, 10, 100 ).empty() );
+   BOOST_CHECK( idx.get_history( 100, flat_set<uint16_t>(), 0, 10, 1 ).front().operation_id == operation_history_id_type( 100 ) );
+   // several types merged, latest first
+   BOOST_CHECK( sequences( idx.get_history( 100, flat_set<uint16_t>( { 1, 2 } ), 0, 10, 100 ) ) == vector<uint32_t>( { 9, 6, 3 } ) );
+   BOOST_CHECK( sequences( idx.get_history( 100, flat_set<uint16_t>( { 0, 1 } ), 5, 9, 3 ) ) == vector<uint32_t>( { 9, 8, 7 } ) );
+   BOOST_CHECK( sequences( idx.get_history( 100, flat_set<uint16_t>( { 0, 1 } ), 5, 9, 100 ) ) == vector<uint32_t>( { 9, 8, 7, 6, 5 } ) );
+   // by operation id
+   BOOST_CHECK_EQUAL( idx.last_sequence_until( 100, operation_history_id_type( 55 ) ), 5u );
+   BOOST_CHECK_EQUAL( idx.last_sequence_until( 100, operation_history_id_type( 60 ) ), 6u );
+   BOOST_CHECK_EQUAL( idx.last_sequence_until( 100, operation_history_id_type( 5 ) ), 0u );
+
+   // trimmed from the front, undone at the end
+   for( uint32_t i = 0; i < 6; ++i )
+      idx.object_removed( objs[i] );
+   idx.object_removed( objs[9] );
+   BOOST_CHECK_EQUAL( idx.size( 100 ), 3u );
+   BOOST_CHECK_EQUAL( idx.earliest( 100 )->sequence, 7u );
+   BOOST_CHECK( sequences( idx.get_history( 100, flat_set<uint16_t>(), 0, 10, 100 ) ) == vector<uint32_t>( { 9, 8, 7 } ) );
+   BOOST_CHECK( sequences( idx.get_history( 100, flat_set<uint16_t>( { 1 } ), 0, 10, 100 ) ) == vector<uint32_t>( { 9 } ) );
+
+   // the undo of the trimming puts them back at the front
+   for( uint32_t i = 6; i > 3; --i )
+      idx.object_inserted( objs[i - 1] );
+   BOOST_CHECK_EQUAL( idx.earliest( 100 )->sequence, 4u );
+   BOOST_CHECK( sequences( idx.get_history( 100, flat_set<uint16_t>( { 1 } ), 0, 10, 100 ) ) == vector<uint32_t>( { 9, 6 } ) );
+
+   for( uint32_t i = 3; i < 9; ++i )
+      idx.object_removed( objs[i] );
+   BOOST_CHECK( idx.earliest( 100 ) == nullptr );
+   BOOST_CHECK_EQUAL( idx.size( 100 ), 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( operation_reference_count_index_test )
+{ try {
+   operation_reference_count_index idx;
+   vector<account_transaction_history_object> objs;
+   // operation 1 is in the histories of 3 accounts, operation 2 of one
+   for( account_uid_type account = 100; account < 104; ++account )
+   {
+      account_transaction_history_object h;
+      h.account = account;
+      h.operation_id = operation_history_id_type( account < 103 ? 1 : 2 );
+      objs.push_back( h );
+      idx.object_inserted( h );
+   }
+   BOOST_CHECK_EQUAL( idx.references( operation_history_id_type( 1 ) ), 3u );
+   BOOST_CHECK_EQUAL( idx.references( operation_history_id_type( 2 ) ), 1u );
+   BOOST_CHECK_EQUAL( idx.references( operation_history_id_type( 3 ) ), 0u );
+
+   idx.object_removed( objs[0] );
+   idx.object_removed( objs[3] );
+   BOOST_CHECK_EQUAL( idx.references( operation_history_id_type( 1 ) ), 2u );
+   BOOST_CHECK_EQUAL( idx.references( operation_history_id_type( 2 ) ), 0u );
+   idx.object_removed( objs[1] );
+   idx.object_removed( objs[2] );
+   BOOST_CHECK_EQUAL( idx.references( operation_history_id_type( 1 ) ), 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( account_history_prune_test )
+{ try {
+   const fc::path dir = data_dir->path() / "prune";
+   const account_uid_type from = calc_account_uid( 10 );
+   const account_uid_type to = calc_account_uid( 11 );
+   const uint32_t max_ops = 5;
+
+   boost::program_options::variables_map options;
+   options.emplace( "plugins", boost::program_options::variable_value( string( "account_history" ), false ) );
+   options.emplace( "max-ops-per-account", boost::program_options::variable_value( max_ops, false ) );
+   options.emplace( "partial-operations", boost::program_options::variable_value( true, false ) );
+   graphene::app::application node;
+   node.register_plugin<graphene::account_history::account_history_plugin>();
+   node.initialize( dir, options );
+   database& d = *node.chain_database();
+   d.open( dir / "blockchain", [this]{ return genesis_state; }, "test" );
+   node.initialize_plugins( options );
+   node.startup_plugins();
+   d.adjust_balance( from, asset( 1000 ) );
+
+   const auto& histories = dynamic_cast<const primary_index<account_transaction_history_index>&>(
+                              d.get_index_type<account_transaction_history_index>() );
+   const auto& sequences = histories.get_secondary_index<account_history_sequence_index>();
+   const auto& references = histories.get_secondary_index<operation_reference_count_index>();
+
+   // several transfers per block, so that each block prunes more than one entry of both accounts
+   for( uint32_t block = 0; block < 4; ++block )
+   {
+      for( uint32_t i = 0; i < 3; ++i )
+      {
+         signed_transaction tx;
+         transfer_operation op;
+         op.from = from;
+         op.to = to;
+         op.amount = asset( 1 + i );
+         tx.operations.push_back( op );
+         for( auto& o : tx.operations ) d.current_fee_schedule().set_fee( o );
+         set_expiration( d, tx );
+         d.push_transaction( tx, ~0 );
+      }
+      d.generate_block( d.get_slot_time( 1 ), d.get_scheduled_witness( 1 ), init_account_priv_key, ~0 );
+
+      for( const account_uid_type account : { from, to } )
+      {
+         const auto& stats = d.get_account_statistics_by_uid( account );
+         const uint64_t kept = stats.total_ops - stats.removed_ops;
+         BOOST_CHECK_EQUAL( kept, std::min<uint64_t>( stats.total_ops, max_ops ) );
+         BOOST_CHECK_EQUAL( sequences.size( account ), kept );
+         const auto* earliest = sequences.earliest( account );
+         BOOST_REQUIRE( earliest != nullptr );
+         BOOST_CHECK( earliest->next == account_transaction_history_id_type() );
+         BOOST_CHECK_EQUAL( earliest->sequence, stats.removed_ops + 1 );
+      }
+      BOOST_CHECK( d.get_account_statistics_by_uid( to ).total_ops >= 3u * ( block + 1 ) );
+      // only the operations still in a history are kept
+      for( const auto& h : histories.indices() )
+         BOOST_CHECK( d.find( h.operation_id ) != nullptr );
+      for( const auto& o : d.get_index_type<operation_history_index>().indices() )
+         BOOST_CHECK( references.references( o.id ) > 0 );
+   }
+
+   node.shutdown_plugins();
+   d.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
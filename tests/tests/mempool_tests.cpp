@@ -0,0 +1,335 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/protocol/protocol.hpp>
+
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/exceptions.hpp>
+#include <graphene/chain/transaction_object.hpp>
+
+#include "../common/database_fixture.hpp"
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+BOOST_FIXTURE_TEST_SUITE( mempool_tests, database_fixture )
+
+BOOST_AUTO_TEST_CASE( recent_transaction_cache_test )
+{ try {
+   recent_transaction_cache cache( 2 );
+   vector<signed_transaction> trxs( 3 );
+   for( size_t i = 0; i < trxs.size(); ++i )
+   {
+      trxs[i].ref_block_num = i;
+      trxs[i].expiration = fc::time_point_sec( 100 + i * 10 );
+      cache.add( trxs[i].id(), trxs[i] );
+   }
+   // the oldest one is dropped for the third one
+   BOOST_CHECK_EQUAL( cache.size(), 2u );
+   BOOST_CHECK( cache.find( trxs[0].id() ) == nullptr );
+   BOOST_REQUIRE( cache.find( trxs[2].id() ) != nullptr );
+   BOOST_CHECK( cache.find( trxs[2].id() )->ref_block_num == 2 );
+
+   // adding a kept transaction again keeps its place
+   cache.add( trxs[1].id(), trxs[1] );
+   BOOST_CHECK_EQUAL( cache.size(), 2u );
+
+   cache.remove_expired( fc::time_point_sec( 110 ) );
+   BOOST_CHECK_EQUAL( cache.size(), 2u );
+   cache.remove_expired( fc::time_point_sec( 111 ) );
+   BOOST_CHECK_EQUAL( cache.size(), 1u );
+   BOOST_CHECK( cache.find( trxs[1].id() ) == nullptr );
+
+   cache.add( trxs[2].id(), trxs[2] );
+   cache.remove( trxs[2].id() );
+   BOOST_CHECK( cache.find( trxs[2].id() ) == nullptr );
+   BOOST_CHECK_EQUAL( cache.size(), 0u );
+   cache.remove( trxs[2].id() );
+
+   cache.set_max_size( 0 );
+   BOOST_CHECK_EQUAL( cache.size(), 0u );
+   cache.add( trxs[0].id(), trxs[0] );
+   BOOST_CHECK_EQUAL( cache.size(), 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( recent_transaction_test )
+{ try {
+   ACTORS((1000)(2000));
+   transfer( committee_account, u_1000_id, asset(1000) );
+   generate_block();
+   const signed_transaction trx = db.fetch_block_by_number( db.head_block_num() )->transactions.at(0);
+
+   // the dedupe index only keeps the id and the expiration, the transaction is still found by id
+   const auto& trx_idx = db.get_index_type<transaction_index>().indices().get<by_trx_id>();
+   auto itr = trx_idx.find( trx.id() );
+   BOOST_REQUIRE( itr != trx_idx.end() );
+   BOOST_CHECK( itr->expiration == trx.expiration );
+   BOOST_CHECK( db.get_recent_transaction( trx.id() ).id() == trx.id() );
+
+   // one which fails or is only validated isn't kept
+   const signed_transaction failed = make_transfer_transaction( u_1000_id, u_2000_id, asset( 1000000 ), asset(),
+                                                                u_1000_private_key );
+   GRAPHENE_REQUIRE_THROW( PUSH_TX( db, failed ), fc::exception );
+   BOOST_CHECK( db.get_recent_transactions().find( failed.id() ) == nullptr );
+   const signed_transaction validated = make_transfer_transaction( u_1000_id, u_2000_id, asset( 1 ), asset(),
+                                                                   u_1000_private_key );
+   db.validate_transaction( validated );
+   BOOST_CHECK( !db.is_known_transaction( validated.id() ) );
+   BOOST_CHECK( db.get_recent_transactions().find( validated.id() ) == nullptr );
+
+   // nor the ones of a popped block until they apply again
+   db.pop_block();
+   BOOST_CHECK( db.get_recent_transactions().find( trx.id() ) == nullptr );
+   GRAPHENE_REQUIRE_THROW( db.get_recent_transaction( trx.id() ), fc::exception );
+   generate_block();
+   BOOST_CHECK( db.get_recent_transaction( trx.id() ).id() == trx.id() );
+
+   // both are dropped once the transaction expired
+   generate_blocks( trx.expiration + db.get_global_properties().parameters.block_interval );
+   BOOST_CHECK( !db.is_known_transaction( trx.id() ) );
+   GRAPHENE_REQUIRE_THROW( db.get_recent_transaction( trx.id() ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( precomputed_id_test )
+{ try {
+   signed_transaction tx;
+   transfer_operation op;
+   op.from = GRAPHENE_COMMITTEE_ACCOUNT_UID;
+   op.to = GRAPHENE_NULL_ACCOUNT_UID;
+   op.amount = asset( 1 );
+   tx.operations.push_back( op );
+   const transaction_id_type id = tx.id();
+   BOOST_CHECK( tx.precompute_id() == id );
+   BOOST_CHECK( tx.id() == id );
+   // a copy keeps the id, clear() forgets it
+   processed_transaction ptx( tx );
+   BOOST_CHECK( ptx.precomputed_id.valid() );
+   tx.clear();
+   BOOST_CHECK( !tx.precomputed_id.valid() );
+
+   // sign() forgets the id of a block header
+   signed_block b = generate_block();
+   const block_id_type block_id = b.id();
+   BOOST_CHECK( b.precompute_id() == block_id );
+   b.sign( init_account_priv_key );
+   BOOST_CHECK( !b.precomputed_id.valid() );
+
+   // the block of the caller of push_block() doesn't keep the ids
+   b = db.generate_block( db.get_slot_time( 1 ), db.get_scheduled_witness( 1 ), init_account_priv_key,
+                          database::skip_nothing );
+   BOOST_CHECK( !b.precomputed_id.valid() );
+   BOOST_CHECK( db.head_block_id() == b.id() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( precomputed_signee_test )
+{ try {
+   db.set_worker_threads( 2 );
+   vector<signed_block> blocks;
+   for( int i = 0; i < 3; ++i )
+      blocks.push_back( generate_block() );
+   vector<const signed_block*> to_precompute;
+   for( const auto& b : blocks )
+   {
+      // push_block() doesn't leave the key to the caller
+      BOOST_CHECK( !b.precomputed_signee.valid() );
+      to_precompute.push_back( &b );
+   }
+   db.precompute_block_signees( to_precompute );
+   for( const auto& b : blocks )
+   {
+      BOOST_REQUIRE( b.precomputed_signee.valid() );
+      BOOST_CHECK( *b.precomputed_signee == public_key_type( init_account_priv_key.get_public_key() ) );
+      BOOST_CHECK( b.validate_signee( init_account_priv_key.get_public_key() ) );
+   }
+
+   // an invalid signature is left to signee() to report
+   signed_block b = blocks[0];
+   b.precomputed_signee.reset();
+   b.witness_signature = signature_type();
+   b.precompute_signee();
+   BOOST_CHECK( !b.precomputed_signee.valid() );
+   GRAPHENE_CHECK_THROW( b.signee(), fc::exception );
+
+   // sign() forgets the key
+   b = blocks[1];
+   b.sign( init_account_priv_key );
+   BOOST_CHECK( !b.precomputed_signee.valid() );
+   db.set_worker_threads( 0 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( push_transaction_move_test )
+{ try {
+   ACTORS((1000)(2000));
+   transfer( committee_account, u_1000_id, asset(10000) );
+
+   signed_transaction tx;
+   set_expiration( db, tx );
+   transfer_operation op;
+   op.from = u_1000_id;
+   op.to = u_2000_id;
+   op.amount = asset(100000);
+   tx.operations.push_back( op );
+   db.current_fee_schedule().set_fee( tx.operations.back() );
+
+   // a transaction that fails is left untouched
+   signed_transaction failing = tx;
+   GRAPHENE_REQUIRE_THROW( db.push_transaction( std::move(failing), ~0 ), fc::exception );
+   BOOST_CHECK( fc::raw::pack( failing ) == fc::raw::pack( tx ) );
+
+   tx.operations.back().get<transfer_operation>().amount = asset(1000);
+   const transaction_id_type id = tx.id();
+   processed_transaction result = db.push_transaction( std::move(tx), ~0 );
+   BOOST_CHECK( result.id() == id );
+   BOOST_CHECK_EQUAL( result.operation_results.size(), 1u );
+   BOOST_CHECK_EQUAL( db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 1000 );
+
+   // the moved pending transaction is applied again and included in the block
+   const signed_block b = generate_block();
+   BOOST_REQUIRE( !b.transactions.empty() );
+   BOOST_CHECK( b.transactions.back().id() == id );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( parallel_validation_test )
+{ try {
+   ACTORS((1000)(2000));
+   transfer( committee_account, u_1000_id, asset(10000) );
+   db.set_worker_threads( 2 );
+
+   for( int i = 1; i <= 3; ++i )
+   {
+      signed_transaction tx;
+      set_expiration( db, tx );
+      transfer_operation op;
+      op.from = u_1000_id;
+      op.to = u_2000_id;
+      op.amount = asset(i);
+      tx.operations.push_back( op );
+      db.current_fee_schedule().set_fee( tx.operations.back() );
+      db.push_transaction( tx, ~0 );
+   }
+   const signed_block b = generate_block();
+   BOOST_REQUIRE_EQUAL( b.transactions.size(), 3u );
+   BOOST_CHECK_EQUAL( db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 6 );
+
+   // the flag is only a shortcut for the block being applied, it's neither kept nor serialized
+   for( const auto& trx : b.transactions )
+      BOOST_CHECK( !trx.validated );
+   signed_transaction unpacked = fc::raw::unpack<signed_transaction>( fc::raw::pack( b.transactions.front() ) );
+   BOOST_CHECK( !unpacked.validated );
+   db.set_worker_threads( 0 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( order_by_fee_rate_test )
+{ try {
+   const account_uid_type a = calc_account_uid( 1000 );
+   const account_uid_type b = calc_account_uid( 2000 );
+   const account_uid_type to = calc_account_uid( 3000 );
+   vector<processed_transaction> trxs;
+   trxs.emplace_back( make_transfer_transaction( a, to, asset( 1 ), asset( 100 ) ) );
+   trxs.emplace_back( make_transfer_transaction( b, to, asset( 1 ), asset( 300 ) ) );
+   // paying more than the earlier transaction of its payer doesn't put it first
+   trxs.emplace_back( make_transfer_transaction( a, to, asset( 1 ), asset( 500 ) ) );
+   trxs.emplace_back( make_transfer_transaction( b, to, asset( 1 ), asset( 200 ) ) );
+   BOOST_CHECK( database::fee_rate( trxs[2] ) > database::fee_rate( trxs[0] ) );
+   BOOST_CHECK( database::order_by_fee_rate( trxs ) == vector<size_t>( { 1, 3, 0, 2 } ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( max_pending_transactions_test )
+{ try {
+   ACTORS((1000)(2000));
+   transfer( committee_account, u_1000_id, asset( 1000000 ) );
+   generate_block();
+   db.set_max_pending_transactions( 1 );
+
+   const int64_t fee = db.current_fee_schedule().calculate_fee( transfer_operation() ).amount.value;
+   PUSH_TX( db, make_transfer_transaction( u_1000_id, u_2000_id, asset( 1 ), asset( fee * 2 ), u_1000_private_key ) );
+   BOOST_CHECK( db.pending_transactions_full() );
+   // not paying more than the pending one
+   GRAPHENE_CHECK_THROW( PUSH_TX( db, make_transfer_transaction( u_1000_id, u_2000_id, asset( 2 ), asset( fee ),
+                                                                 u_1000_private_key ) ),
+                         pending_transactions_full );
+   PUSH_TX( db, make_transfer_transaction( u_1000_id, u_2000_id, asset( 3 ), asset( fee * 3 ), u_1000_private_key ) );
+   // twice the limit
+   GRAPHENE_CHECK_THROW( PUSH_TX( db, make_transfer_transaction( u_1000_id, u_2000_id, asset( 4 ), asset( fee * 4 ),
+                                                                 u_1000_private_key ) ),
+                         pending_transactions_full );
+
+   db.set_max_pending_transactions( 0 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( pending_transaction_dependency_test )
+{ try {
+   const uint32_t skip = database::skip_undo_history_check;
+   ACTORS((1000)(2000)(3000));
+   transfer( committee_account, u_1000_id, asset( 1000000 ) );
+   generate_block();
+   database db2;
+   db2.open( data_dir->path() / "db2", [this]{ return genesis_state; }, "test" );
+   for( uint32_t i = 1; i <= db.head_block_num(); ++i )
+      db2.push_block( *db.fetch_block_by_number( i ), skip );
+
+   const int64_t fee = db.current_fee_schedule().calculate_fee( transfer_operation() ).amount.value;
+   // the second one can only be paid once the first one funded its payer, though it pays a higher fee rate
+   PUSH_TX( db, make_transfer_transaction( u_1000_id, u_2000_id, asset( 100000 ), asset( fee ), u_1000_private_key ) );
+   PUSH_TX( db, make_transfer_transaction( u_2000_id, u_3000_id, asset( 1000 ), asset( fee + 1000 ), u_2000_private_key ) );
+
+   // a block without them: both are applied again, in the order they arrived in
+   const signed_block b = db2.generate_block( db2.get_slot_time( 1 ), db2.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   BOOST_CHECK( b.transactions.empty() );
+   BOOST_CHECK( !db.push_block( b, skip ) );
+   BOOST_CHECK( db.head_block_id() == b.id() );
+   BOOST_CHECK_EQUAL( db.get_balance( u_3000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 1000 );
+
+   // the block takes the higher fee rate first, and tries it again once the other one applied
+   const signed_block c = db.generate_block( db.get_slot_time( 1 ), db.get_scheduled_witness( 1 ), init_account_priv_key, skip );
+   BOOST_CHECK_EQUAL( c.transactions.size(), 2u );
+   BOOST_CHECK_EQUAL( db.get_balance( u_3000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 1000 );
+   db2.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( pending_transaction_stats_test )
+{ try {
+   ACTORS((1000)(2000));
+   transfer( committee_account, u_1000_id, asset( 1000000 ) );
+   generate_block();
+
+   const asset fee = db.current_fee_schedule().calculate_fee( transfer_operation() );
+   const pending_transaction_stats before = db.get_pending_transaction_stats();
+   BOOST_CHECK_EQUAL( before.count, 0u );
+   BOOST_CHECK_EQUAL( before.bytes, 0u );
+
+   signed_transaction trx = make_transfer_transaction( u_1000_id, u_2000_id, asset( 1 ), fee );
+   sign( trx, u_1000_private_key );
+   PUSH_TX( db, trx );
+   pending_transaction_stats stats = db.get_pending_transaction_stats();
+   BOOST_CHECK_EQUAL( stats.count, 1u );
+   BOOST_CHECK_EQUAL( stats.bytes, fc::raw::pack_size( trx ) );
+   BOOST_CHECK_EQUAL( stats.accepted, before.accepted + 1 );
+   BOOST_CHECK_GE( stats.oldest_age_us, stats.median_age_us );
+   BOOST_CHECK_GE( stats.median_age_us, 0 );
+
+   BOOST_CHECK_THROW( PUSH_TX( db, trx ), fc::exception );
+   signed_transaction unsigned_trx = make_transfer_transaction( u_1000_id, u_2000_id, asset( 2 ), fee );
+   BOOST_CHECK_THROW( PUSH_TX( db, unsigned_trx ), fc::exception );
+   signed_transaction expired_trx = make_transfer_transaction( u_1000_id, u_2000_id, asset( 3 ), fee );
+   expired_trx.expiration = db.head_block_time() - 1;
+   sign( expired_trx, u_1000_private_key );
+   BOOST_CHECK_THROW( PUSH_TX( db, expired_trx ), fc::exception );
+   stats = db.get_pending_transaction_stats();
+   BOOST_CHECK_EQUAL( stats.count, 1u );
+   BOOST_CHECK_EQUAL( stats.accepted, before.accepted + 1 );
+   BOOST_CHECK_EQUAL( stats.rejected_duplicate, before.rejected_duplicate + 1 );
+   BOOST_CHECK_EQUAL( stats.rejected_authority, before.rejected_authority + 1 );
+   BOOST_CHECK_EQUAL( stats.rejected_expired, before.rejected_expired + 1 );
+
+   // the pending transaction gets in the block, nothing is left to apply again
+   generate_block();
+   stats = db.get_pending_transaction_stats();
+   BOOST_CHECK_EQUAL( stats.count, 0u );
+   BOOST_CHECK_EQUAL( stats.bytes, 0u );
+   BOOST_CHECK_EQUAL( stats.oldest_age_us, 0 );
+   BOOST_CHECK_GT( stats.reapply_count, before.reapply_count );
+   BOOST_CHECK_EQUAL( stats.last_reapply_after, 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
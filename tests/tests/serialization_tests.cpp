@@ -122,4 +122,53 @@ BOOST_AUTO_TEST_CASE( extended_public_key_type_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( small_containers_test )
+{
+   try
+   {
+      small_vector<int,2> v;
+      v.push_back( 1 );
+      v.push_back( 3 );
+      BOOST_CHECK( v.is_inline() );
+      v.insert( v.begin() + 1, 2 );
+      BOOST_CHECK( !v.is_inline() );
+      BOOST_REQUIRE_EQUAL( v.size(), 3u );
+      BOOST_CHECK_EQUAL( v[0], 1 );
+      BOOST_CHECK_EQUAL( v[1], 2 );
+      BOOST_CHECK_EQUAL( v[2], 3 );
+      v.erase( v.begin(), v.begin() + 2 );
+      BOOST_REQUIRE_EQUAL( v.size(), 1u );
+      BOOST_CHECK_EQUAL( v.front(), 3 );
+
+      // encoded exactly as the std containers they replace
+      std::vector<int> sv = { 5, 6, 7 };
+      small_vector<int,1> smv( sv );
+      BOOST_CHECK( fc::raw::pack( sv ) == fc::raw::pack( smv ) );
+      BOOST_CHECK( fc::raw::unpack< small_vector<int,1> >( fc::raw::pack( sv ) ) == smv );
+
+      const auto key1 = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "key1" ) ) ).get_public_key();
+      const auto key2 = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "key2" ) ) ).get_public_key();
+      fc::flat_map<public_key_type,weight_type> fm;
+      fm[ key2 ] = 2;
+      fm[ key1 ] = 1;
+      authority::key_auth_map km;
+      km[ key2 ] = 2;
+      km[ key1 ] = 1;
+      BOOST_CHECK( std::equal( km.begin(), km.end(), fm.begin() ) );
+      BOOST_CHECK( fc::raw::pack( fm ) == fc::raw::pack( km ) );
+      BOOST_CHECK( fc::json::to_string( fm ) == fc::json::to_string( km ) );
+      BOOST_CHECK( fc::json::from_string( fc::json::to_string( fm ) ).as<authority::key_auth_map>( 2 ) == km );
+
+      authority auth( 2, key1, 1 );
+      auth.account_uid_auths[ authority::account_uid_auth_type( 25638, authority::active_auth ) ] = 1;
+      auth.add_authority( key2, 1 );
+      const auto packed = fc::raw::pack( auth );
+      BOOST_CHECK( fc::raw::unpack<authority>( packed ) == auth );
+   } catch ( const fc::exception& e )
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
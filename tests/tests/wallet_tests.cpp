@@ -0,0 +1,68 @@
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/app/api.hpp>
+#include <graphene/chain/database.hpp>
+#include <graphene/utilities/key_conversion.hpp>
+#include <graphene/wallet/wallet.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/io/json.hpp>
+
+#include "../common/database_fixture.hpp"
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+BOOST_FIXTURE_TEST_SUITE( wallet_tests, database_fixture )
+
+BOOST_AUTO_TEST_CASE( wallet_journal_test )
+{ try {
+   // the wallets talk to the database of the fixture
+   auto login = std::make_shared<graphene::app::login_api>( app );
+   login->enable_api( "database_api" );
+   login->enable_api( "network_broadcast_api" );
+   login->enable_api( "history_api" );
+   graphene::wallet::wallet_data wdata;
+   wdata.chain_id = db.get_chain_id();
+
+   const string filename = ( data_dir->path() / "wallet.json" ).generic_string();
+   const string journal = filename + ".journal";
+   const fc::ecc::private_key key = generate_private_key( "journal key" );
+
+   {
+      graphene::wallet::wallet_api wallet( wdata, fc::api<graphene::app::login_api>( login ) );
+      wallet.set_wallet_filename( filename );
+      wallet.set_password( "password" );
+      wallet.unlock( "password" );
+      wallet.save_wallet_file( filename );
+
+      // the key import is appended to the journal, the wallet file is left as it was
+      wallet.set_wallet_journal( 10 );
+      wallet.import_key( "init0", graphene::utilities::key_to_wif( key ) );
+      BOOST_CHECK( fc::exists( journal ) );
+      const auto saved = fc::json::from_file( filename ).as<graphene::wallet::wallet_data>( 2 * GRAPHENE_MAX_NESTED_OBJECTS );
+      BOOST_CHECK( saved.my_accounts.empty() );
+      BOOST_CHECK( saved.extra_keys.empty() );
+   }
+
+   {
+      graphene::wallet::wallet_api wallet( wdata, fc::api<graphene::app::login_api>( login ) );
+      wallet.set_wallet_filename( filename );
+      BOOST_REQUIRE( wallet.load_wallet_file( filename ) );
+
+      // loading merges the accounts of the journal, unlocking its keys
+      const vector<account_object> accounts = wallet.list_my_accounts_cached();
+      BOOST_REQUIRE_EQUAL( accounts.size(), 1u );
+      BOOST_CHECK_EQUAL( accounts.front().name, "init0" );
+      wallet.unlock( "password" );
+      BOOST_CHECK( wallet.dump_private_keys().count( key.get_public_key() ) == 1 );
+
+      // a full save takes the journal in
+      wallet.save_wallet_file( filename );
+      BOOST_CHECK( !fc::exists( journal ) );
+      const auto saved = fc::json::from_file( filename ).as<graphene::wallet::wallet_data>( 2 * GRAPHENE_MAX_NESTED_OBJECTS );
+      BOOST_CHECK_EQUAL( saved.my_accounts.size(), 1u );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()